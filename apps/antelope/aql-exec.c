@@ -37,6 +37,7 @@
  * 	Nicolas Tsiftes <nvt@sics.se>
  */
 
+#include <limits.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
@@ -62,6 +63,105 @@ clear_handle(db_handle_t *handle)
   handle->join_rel = NULL;
 }
 
+/*
+ * Compute MIN, MAX, and COUNT aggregates from indexes instead of from
+ * the tuples. This is possible when the condition restricts only the
+ * aggregated attribute to a range, or when there is no condition. If
+ * one of the aggregates cannot be computed in this way, the selection
+ * scans the relation as usual.
+ */
+static void
+aggregate_from_index(db_handle_t *handle, relation_t *rel, aql_adt_t *adt)
+{
+  attribute_t *attr;
+  attribute_t *relattr;
+  index_iterator_t iterator;
+  operand_value_t min;
+  operand_value_t max;
+  attribute_value_t av_min;
+  attribute_value_t av_max;
+  attribute_value_t value;
+  tuple_id_t count;
+  long results[AQL_ATTRIBUTE_LIMIT];
+  int i;
+
+  if(!(AQL_GET_FLAGS(adt) & AQL_FLAG_AGGREGATE)) {
+    return;
+  }
+
+  for(i = 0, attr = list_head(handle->result_rel->attributes);
+      attr != NULL;
+      i++, attr = attr->next) {
+    relattr = relation_attribute_get(rel, attr->name);
+    if(relattr == NULL) {
+      return;
+    }
+
+    if(adt->lvm_instance == NULL) {
+      if(attr->aggregator == AQL_COUNT) {
+        count = relation_cardinality(rel);
+        if(count == INVALID_TUPLE) {
+          return;
+        }
+        results[i] = count;
+        continue;
+      }
+      min.l = LONG_MIN;
+      max.l = LONG_MAX;
+    } else if(LVM_ERROR(lvm_get_exact_range(adt->lvm_instance, attr->name,
+                                            &min, &max))) {
+      return;
+    }
+
+    if(!index_exists(relattr)) {
+      return;
+    }
+    av_min.domain = av_max.domain = DOMAIN_LONG;
+    VALUE_LONG(&av_min) = min.l;
+    VALUE_LONG(&av_max) = max.l;
+    if(index_get_iterator(&iterator, relattr->index,
+                          &av_min, &av_max) != DB_OK) {
+      return;
+    }
+
+    switch(attr->aggregator) {
+    case AQL_MIN:
+    case AQL_MAX:
+      switch(index_get_extreme(&iterator, attr->aggregator == AQL_MAX,
+                               &value)) {
+      case DB_OK:
+        results[i] = db_value_to_long(&value);
+        break;
+      case DB_FINISHED:
+        /* No tuples match, so the aggregate keeps its initial value. */
+        results[i] = attr->aggregation_value;
+        break;
+      default:
+        return;
+      }
+      break;
+    case AQL_COUNT:
+      if(index_count(&iterator, &count) != DB_OK) {
+        return;
+      }
+      results[i] = count;
+      break;
+    default:
+      return;
+    }
+  }
+
+  PRINTF("DB: Computed the aggregates of %s from indexes\n", rel->name);
+
+  for(i = 0, attr = list_head(handle->result_rel->attributes);
+      attr != NULL;
+      i++, attr = attr->next) {
+    attr->aggregation_value = results[i];
+  }
+  handle->flags &= ~(DB_HANDLE_FLAG_SEARCH_INDEX | DB_HANDLE_FLAG_SKIP_SEGMENTS);
+  handle->flags |= DB_HANDLE_FLAG_AGGREGATED;
+}
+
 static db_result_t
 aql_execute(db_handle_t *handle, aql_adt_t *adt)
 {
@@ -152,6 +252,9 @@ aql_execute(db_handle_t *handle, aql_adt_t *adt)
       break;
     }
     result = relation_select(handle, rel, adt);
+    if(result == DB_OK && optype == AQL_TYPE_SELECT) {
+      aggregate_from_index(handle, rel, adt);
+    }
     break;
   case AQL_TYPE_INSERT:
     result = relation_insert(rel, adt->values);
@@ -210,6 +313,83 @@ db_query(db_handle_t *handle, const char *format, ...)
   return aql_execute(handle, &adt);
 }
 
+/* Append rows tuples to a relation without going through the query
+   parser. The values of each tuple are given in the order of the
+   attributes of the relation, one tuple after the other. */
+db_result_t
+db_insert(const char *name, attribute_value_t *values, tuple_id_t rows)
+{
+  relation_t *rel;
+  db_result_t result;
+
+  rel = relation_load((char *)name);
+  if(rel == NULL) {
+    return DB_NAME_ERROR;
+  }
+
+  result = relation_insert_bulk(rel, values, rows);
+  relation_release(rel);
+
+  return result;
+}
+
+db_result_t
+db_prepare(db_statement_t *statement, const char *format, ...)
+{
+  va_list ap;
+  char query_string[AQL_MAX_QUERY_LENGTH];
+  lvm_instance_t *lvm_instance;
+
+  va_start(ap, format);
+  vsnprintf(query_string, sizeof(query_string), format, ap);
+  va_end(ap);
+
+  if(AQL_ERROR(aql_parse(&statement->adt, query_string))) {
+    return DB_PARSING_ERROR;
+  }
+
+  /* The parser compiles every condition into the same LVM instance, so
+     the statement keeps its own copy of the code and the variables. */
+  lvm_instance = statement->adt.lvm_instance;
+  if(lvm_instance != NULL) {
+    lvm_clone(&statement->lvm_instance, lvm_instance);
+    memcpy(statement->vmcode, lvm_instance->code,
+           sizeof(statement->vmcode));
+    statement->lvm_instance.code = statement->vmcode;
+    statement->lvm_instance.size = sizeof(statement->vmcode);
+    AQL_SET_CONDITION(&statement->adt, &statement->lvm_instance);
+  }
+  lvm_save_variables(statement->variables);
+
+  return DB_OK;
+}
+
+db_result_t
+db_bind(db_statement_t *statement, unsigned index, long value)
+{
+  if(statement->adt.lvm_instance == NULL ||
+     lvm_bind_parameter(&statement->lvm_instance, index, value) != TRUE) {
+    return DB_ARGUMENT_ERROR;
+  }
+
+  return DB_OK;
+}
+
+db_result_t
+db_execute(db_handle_t *handle, db_statement_t *statement)
+{
+  if(handle != NULL) {
+    clear_handle(handle);
+  }
+
+  /* The execution modifies the ADT, so it works on a copy. The
+     derivations of the condition are redone with the bound values. */
+  memcpy(&adt, &statement->adt, sizeof(adt));
+  lvm_restore_variables(statement->variables);
+
+  return aql_execute(handle, &adt);
+}
+
 db_result_t
 db_process(db_handle_t *handle)
 {
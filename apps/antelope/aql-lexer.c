@@ -64,6 +64,7 @@ static const struct keyword keywords[] = {
   {"*", MUL},
   {"/", DIV},
   {"#", COMMENT},
+  {"?", PARAMETER},
 
   {">=", GEQ},
   {"<=", LEQ},
@@ -107,11 +108,12 @@ static const struct keyword keywords[] = {
 
   {"RELATION", RELATION},
 
-  {"ATTRIBUTE", ATTRIBUTE}
+  {"ATTRIBUTE", ATTRIBUTE},
+  {"BPLUSTREE", BPLUSTREE}
 };
 
 /* Provides a pointer to the first keyword of a specific length. */
-static const int8_t skip_hint[] = {0, 13, 21, 27, 33, 36, 44, 47, 48};
+static const int8_t skip_hint[] = {0, 14, 22, 28, 34, 37, 45, 48, 49};
 
 static char separators[] = "#.;,() \t\n";
 
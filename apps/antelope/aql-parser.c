@@ -280,6 +280,9 @@ PARSER(operand)
   case INTEGER_VALUE:
     lvm_set_long(&p, *(long *)lexer->value);
     break;
+  case PARAMETER:
+    lvm_set_parameter(&p);
+    break;
   default:
     RETURN(SYNTAX_ERROR);
   }
@@ -645,6 +648,9 @@ PARSER_TOKEN(index_type)
   case MEMHASH:
     type = INDEX_MEMHASH;
     break;
+  case BPLUSTREE:
+    type = INDEX_BPLUSTREE;
+    break;
   default:
     return NONE;
   };
@@ -42,6 +42,7 @@
 
 #include "db-options.h"
 #include "index.h"
+#include "lvm.h"
 #include "relation.h"
 #include "result.h"
 
@@ -104,6 +105,8 @@ enum token {
   MEMHASH = 46,
   RELATION = 47,
   ATTRIBUTE = 48,
+  BPLUSTREE = 49,
+  PARAMETER = 50,
 
   INTEGER_VALUE = 251,
   FLOAT_VALUE = 252,
@@ -160,6 +163,16 @@ struct aql_adt {
 };
 typedef struct aql_adt aql_adt_t;
 
+/* A query that has been compiled once and can be executed repeatedly
+   with new values bound to the parameters ("?") in its condition. */
+struct db_statement {
+  aql_adt_t adt;
+  lvm_instance_t lvm_instance;
+  unsigned char vmcode[DB_VM_BYTECODE_SIZE];
+  lvm_variable_t variables[LVM_VARIABLE_TABLE_SIZE];
+};
+typedef struct db_statement db_statement_t;
+
 #define AQL_TYPE_NONE           	0
 #define AQL_TYPE_SELECT			1
 #define AQL_TYPE_INSERT			2
@@ -217,5 +230,10 @@ db_result_t aql_add_attribute(aql_adt_t *adt, char *name,
 db_result_t aql_add_value(aql_adt_t *adt, domain_t domain, void *value);
 db_result_t db_query(db_handle_t *handle, const char *format, ...);
 db_result_t db_process(db_handle_t *handle);
+db_result_t db_prepare(db_statement_t *statement, const char *format, ...);
+db_result_t db_bind(db_statement_t *statement, unsigned index, long value);
+db_result_t db_execute(db_handle_t *handle, db_statement_t *statement);
+db_result_t db_insert(const char *name, attribute_value_t *values,
+                      tuple_id_t rows);
 
 #endif /* !AQL_H */
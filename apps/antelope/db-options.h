@@ -64,6 +64,12 @@
 #define DB_FEATURE_COFFEE		1
 #endif /* DB_FEATURE_COFFEE */
 
+/* Keep the value range of each attribute in segments of tuples,
+   so that selections can skip segments without reading them. */
+#ifndef DB_FEATURE_SEGMENTS
+#define DB_FEATURE_SEGMENTS		0
+#endif /* DB_FEATURE_SEGMENTS */
+
 /* Enable basic data integrity checks. */
 #ifndef DB_FEATURE_INTEGRITY
 #define DB_FEATURE_INTEGRITY		0
@@ -152,6 +158,18 @@
 #define DB_MAX_CHAR_SIZE_PER_ROW	64
 #endif /* DB_MAX_CHAR_SIZE_PER_ROW */
 
+/* The number of tuples in a segment that is summarized when
+   DB_FEATURE_SEGMENTS is enabled. */
+#ifndef DB_SEGMENT_ROWS
+#define DB_SEGMENT_ROWS			32
+#endif /* DB_SEGMENT_ROWS */
+
+/* The number of tuples that relation_insert_bulk() encodes, indexes and
+   writes together. Each one costs a row of stack space. */
+#ifndef DB_BULK_INSERT_ROWS
+#define DB_BULK_INSERT_ROWS		8
+#endif /* DB_BULK_INSERT_ROWS */
+
 /* The maximum file name length to use for creating various database file. */
 #ifndef DB_MAX_FILENAME_LENGTH
 #define DB_MAX_FILENAME_LENGTH		16
@@ -206,6 +224,17 @@
 #define DB_HEAP_CACHE_LIMIT		1
 #endif /* DB_HEAP_CACHE_LIMIT */
 
+/* The maximum number of B+-tree indexes. */
+#ifndef DB_BPLUSTREE_INDEX_LIMIT
+#define DB_BPLUSTREE_INDEX_LIMIT	1
+#endif /* DB_BPLUSTREE_INDEX_LIMIT */
+
+/* The maximum number of nodes cached in the B+-tree index. It should
+   be at least the depth of the tree for range searches to stay cheap. */
+#ifndef DB_BPLUSTREE_CACHE_LIMIT
+#define DB_BPLUSTREE_CACHE_LIMIT	3
+#endif /* DB_BPLUSTREE_CACHE_LIMIT */
+
 /*----------------------------------------------------------------------------*/
 
 /* LVM options. */
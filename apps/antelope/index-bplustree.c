@@ -0,0 +1,803 @@
+/*
+ * Copyright (c) 2010, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *     A B+-tree index for flash memory.
+ *
+ *     Like the MaxHeap index, the B+-tree never rewrites a byte that
+ *     it has written once. Entries are appended to the unused slots
+ *     of a node and sorted when the node is read into the node cache.
+ *     A full node is replaced by one or two new nodes at the end of
+ *     the file, and its parent gets new entries appended that refer
+ *     to them. An appended parent entry supersedes an older entry
+ *     with the same separator. When the root is replaced, the new
+ *     root is appended to a log at the start of the file.
+ *
+ *     Keys that are larger than all keys in a full leaf, such as
+ *     timestamps of sensor samples, start a new leaf without copying
+ *     the old one. A range search reads O(log n) nodes to find the
+ *     first key, and continues to the next leaf from the lowest inner
+ *     node on its path that covers it.
+ * \author
+ * 	Nicolas Tsiftes <nvt@sics.se>
+ */
+
+#include <limits.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "cfs/cfs.h"
+#include "lib/memb.h"
+
+#include "db-options.h"
+#include "index.h"
+#include "result.h"
+#include "storage.h"
+
+#define DEBUG DEBUG_NONE
+#include "net/uip-debug.h"
+
+#define NODE_ENTRIES	16
+#define NODE_LIMIT	1024
+/* The maximum number of inner nodes on the way to a leaf. */
+#define PATH_LIMIT	8
+
+#define NODE_LEAF	1
+#define NODE_INNER	2
+
+/* The entries of leaves store the tuple ID plus one, and the entries
+   of inner nodes store the child node ID plus one, so that unused
+   slots read as zero. */
+struct bpt_entry {
+  long key;
+  tuple_id_t tuple;
+  uint16_t child;
+};
+
+struct bpt_node {
+  uint8_t type;
+  struct bpt_entry entries[NODE_ENTRIES];
+};
+
+struct bpt_tree {
+  db_storage_id_t storage;
+  uint16_t root;
+  uint16_t root_slots;
+  uint16_t next_node;
+};
+typedef struct bpt_tree bpt_tree_t;
+
+struct bpt_path {
+  uint8_t depth;
+  uint16_t node_id[PATH_LIMIT + 1];
+  struct bpt_entry bound[PATH_LIMIT + 1];
+  uint8_t bounded[PATH_LIMIT + 1];
+};
+
+struct node_cache {
+  bpt_tree_t *tree;
+  uint16_t node_id;
+  uint16_t last_use;
+  /* The number of slots written on storage. */
+  uint8_t used;
+  /* The number of valid entries, sorted in the node below. */
+  uint8_t count;
+  struct bpt_node node;
+};
+
+#define ROOT_LOG_SIZE	((unsigned long)NODE_LIMIT * sizeof(uint16_t))
+#define NODE_OFFSET(id)	(ROOT_LOG_SIZE + (unsigned long)(id) * sizeof(struct bpt_node))
+#define ENTRY_OFFSET(id, slot)						\
+  (NODE_OFFSET(id) + offsetof(struct bpt_node, entries) +		\
+   (unsigned long)(slot) * sizeof(struct bpt_entry))
+
+/* Keep a cache of nodes read from storage. */
+static struct node_cache node_cache[DB_BPLUSTREE_CACHE_LIMIT];
+static uint16_t cache_clock;
+MEMB(trees, bpt_tree_t, DB_BPLUSTREE_INDEX_LIMIT);
+
+/* A copy of the node being replaced in tree_rebuild(). */
+static struct bpt_entry scratch[NODE_ENTRIES];
+
+static db_result_t create(index_t *);
+static db_result_t destroy(index_t *);
+static db_result_t load(index_t *);
+static db_result_t release(index_t *);
+static db_result_t insert(index_t *, attribute_value_t *, tuple_id_t);
+static db_result_t delete(index_t *, attribute_value_t *);
+static tuple_id_t get_next(index_iterator_t *);
+static db_result_t get_extreme(index_iterator_t *, int, attribute_value_t *);
+
+index_api_t index_bplustree = {
+  INDEX_BPLUSTREE,
+  INDEX_API_EXTERNAL | INDEX_API_RANGE_QUERIES | INDEX_API_EXACT,
+  create,
+  destroy,
+  load,
+  release,
+  insert,
+  delete,
+  get_next,
+  get_extreme,
+  NULL
+};
+
+static int
+entry_cmp(const struct bpt_entry *a, const struct bpt_entry *b)
+{
+  if(a->key != b->key) {
+    return a->key < b->key ? -1 : 1;
+  }
+  if(a->tuple != b->tuple) {
+    return a->tuple < b->tuple ? -1 : 1;
+  }
+  return 0;
+}
+
+/* Find the first entry that is not smaller than the key. */
+static int
+lower_bound(struct node_cache *cache, const struct bpt_entry *key)
+{
+  int i;
+
+  for(i = 0; i < cache->count; i++) {
+    if(entry_cmp(&cache->node.entries[i], key) >= 0) {
+      break;
+    }
+  }
+  return i;
+}
+
+static void
+sorted_insert(struct node_cache *cache, const struct bpt_entry *entry)
+{
+  int i;
+
+  i = lower_bound(cache, entry);
+  if(cache->node.type == NODE_INNER && i < cache->count &&
+     entry_cmp(&cache->node.entries[i], entry) == 0) {
+    /* A later entry replaces the child of an equal separator. */
+    cache->node.entries[i] = *entry;
+    return;
+  }
+
+  memmove(&cache->node.entries[i + 1], &cache->node.entries[i],
+          (cache->count - i) * sizeof(struct bpt_entry));
+  cache->node.entries[i] = *entry;
+  cache->count++;
+}
+
+static int
+slot_used(uint8_t type, const struct bpt_entry *entry)
+{
+  return type == NODE_LEAF ? entry->tuple != 0 : entry->child != 0;
+}
+
+static struct node_cache *
+node_load(bpt_tree_t *tree, uint16_t node_id)
+{
+  static struct bpt_node node;
+  struct node_cache *cache;
+  int i;
+
+  cache = NULL;
+  for(i = 0; i < DB_BPLUSTREE_CACHE_LIMIT; i++) {
+    if(node_cache[i].tree == tree && node_cache[i].node_id == node_id) {
+      node_cache[i].last_use = ++cache_clock;
+      return &node_cache[i];
+    }
+    if(cache == NULL || node_cache[i].tree == NULL ||
+       (cache->tree != NULL && node_cache[i].last_use < cache->last_use)) {
+      cache = &node_cache[i];
+    }
+  }
+
+  if(DB_ERROR(storage_read(tree->storage, &node, NODE_OFFSET(node_id),
+                           sizeof(node)))) {
+    return NULL;
+  }
+  if(node.type != NODE_LEAF && node.type != NODE_INNER) {
+    PRINTF("DB: B+-tree node %u is corrupt\n", (unsigned)node_id);
+    return NULL;
+  }
+
+  cache->tree = tree;
+  cache->node_id = node_id;
+  cache->last_use = ++cache_clock;
+  cache->node.type = node.type;
+  cache->count = 0;
+  for(i = 0; i < NODE_ENTRIES && slot_used(node.type, &node.entries[i]); i++) {
+    sorted_insert(cache, &node.entries[i]);
+  }
+  cache->used = i;
+
+  PRINTF("DB: Loaded B+-tree node %u with %d entries\n",
+         (unsigned)node_id, cache->count);
+
+  return cache;
+}
+
+static int
+node_create(bpt_tree_t *tree, uint8_t type,
+            struct bpt_entry *entries, int count)
+{
+  uint16_t node_id;
+
+  if(tree->next_node >= NODE_LIMIT) {
+    PRINTF("DB: The B+-tree is full\n");
+    return -1;
+  }
+  node_id = tree->next_node;
+
+  if(count > 0 &&
+     DB_ERROR(storage_write(tree->storage, entries, ENTRY_OFFSET(node_id, 0),
+                            count * sizeof(struct bpt_entry)))) {
+    return -1;
+  }
+  /* The type marks the node as allocated, so it is written last. */
+  if(DB_ERROR(storage_write(tree->storage, &type, NODE_OFFSET(node_id),
+                            sizeof(type)))) {
+    return -1;
+  }
+
+  tree->next_node++;
+  return node_id;
+}
+
+static int
+node_append(bpt_tree_t *tree, uint16_t node_id, struct bpt_entry *entry)
+{
+  struct node_cache *cache;
+
+  cache = node_load(tree, node_id);
+  if(cache == NULL || cache->used >= NODE_ENTRIES) {
+    return 0;
+  }
+
+  if(DB_ERROR(storage_write(tree->storage, entry,
+                            ENTRY_OFFSET(node_id, cache->used),
+                            sizeof(*entry)))) {
+    return 0;
+  }
+  cache->used++;
+  sorted_insert(cache, entry);
+
+  return 1;
+}
+
+static int
+root_set(bpt_tree_t *tree, uint16_t node_id)
+{
+  uint16_t slot;
+
+  if(tree->root_slots >= NODE_LIMIT) {
+    return 0;
+  }
+
+  slot = node_id + 1;
+  if(DB_ERROR(storage_write(tree->storage, &slot,
+                            tree->root_slots * sizeof(slot), sizeof(slot)))) {
+    return 0;
+  }
+  tree->root_slots++;
+  tree->root = node_id;
+
+  return 1;
+}
+
+/* Count the written items, which are stored contiguously from the
+   start of the area, by using a binary search. */
+static int
+count_written(bpt_tree_t *tree, unsigned long start, unsigned stride,
+              unsigned length, uint16_t *count)
+{
+  uint16_t low, high, middle;
+  uint16_t item;
+
+  low = 0;
+  high = NODE_LIMIT;
+  while(low < high) {
+    middle = low + (high - low) / 2;
+    item = 0;
+    if(DB_ERROR(storage_read(tree->storage, &item,
+                             start + (unsigned long)middle * stride,
+                             length))) {
+      return 0;
+    }
+    if(item != 0) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  *count = low;
+  return 1;
+}
+
+/*
+ * Replace a node that has run out of free slots. The parent is known
+ * to have room for two more entries, because the insertion checks
+ * every node on the way down.
+ */
+static int
+tree_rebuild(bpt_tree_t *tree, uint16_t node_id, int parent_id,
+             struct bpt_entry *separator, struct bpt_entry *pending)
+{
+  struct node_cache *cache;
+  struct bpt_entry entries[2];
+  uint8_t type;
+  int count, half;
+  int left, right;
+
+  cache = node_load(tree, node_id);
+  if(cache == NULL) {
+    return 0;
+  }
+  type = cache->node.type;
+  count = cache->count;
+  memcpy(scratch, cache->node.entries, count * sizeof(struct bpt_entry));
+
+  half = count;
+  if(type == NODE_LEAF && count > 0 &&
+     entry_cmp(pending, &scratch[count - 1]) > 0) {
+    /* Keep the full leaf and start a new one on its right side. */
+    left = node_id;
+    right = node_create(tree, type, NULL, 0);
+    entries[1] = *pending;
+  } else {
+    if(count > NODE_ENTRIES / 2) {
+      half = count / 2;
+    }
+    left = node_create(tree, type, scratch, half);
+    right = -1;
+    if(half < count) {
+      right = node_create(tree, type, &scratch[half], count - half);
+      entries[1] = scratch[half];
+    }
+  }
+  if(left < 0 || (half < count && right < 0) ||
+     (left == node_id && right < 0)) {
+    return 0;
+  }
+
+  entries[0] = *separator;
+  entries[0].child = left + 1;
+  entries[1].child = right + 1;
+
+  PRINTF("DB: Replaced B+-tree node %u with nodes %d and %d\n",
+         (unsigned)node_id, left, right);
+
+  if(parent_id < 0) {
+    if(right < 0) {
+      return root_set(tree, left);
+    }
+    left = node_create(tree, NODE_INNER, entries, 2);
+    return left >= 0 && root_set(tree, left);
+  }
+
+  if(left != node_id && !node_append(tree, parent_id, &entries[0])) {
+    return 0;
+  }
+  return right < 0 || node_append(tree, parent_id, &entries[1]);
+}
+
+static int
+tree_insert(bpt_tree_t *tree, struct bpt_entry *entry)
+{
+  struct node_cache *cache;
+  struct bpt_entry separator;
+  uint16_t node_id;
+  int parent_id;
+  int i;
+
+restart:
+  node_id = tree->root;
+  parent_id = -1;
+  separator.key = LONG_MIN;
+  separator.tuple = 0;
+
+  for(;;) {
+    cache = node_load(tree, node_id);
+    if(cache == NULL) {
+      return 0;
+    }
+
+    if(cache->used + (cache->node.type == NODE_LEAF ? 1 : 2) > NODE_ENTRIES) {
+      if(!tree_rebuild(tree, node_id, parent_id, &separator, entry)) {
+        return 0;
+      }
+      goto restart;
+    }
+
+    if(cache->node.type == NODE_LEAF) {
+      return node_append(tree, node_id, entry);
+    }
+
+    /* Descend into the last child whose separator is not larger
+       than the key. */
+    i = lower_bound(cache, entry);
+    if(i == cache->count ||
+       entry_cmp(&cache->node.entries[i], entry) > 0) {
+      i--;
+    }
+    if(i < 0) {
+      return 0;
+    }
+    separator = cache->node.entries[i];
+    parent_id = node_id;
+    node_id = separator.child - 1;
+  }
+}
+
+/* Find the leaf that may contain the key. The path keeps the nodes
+   from the root down to the leaf along with their upper bounds, so
+   that a larger key can be looked up from the lowest node that covers
+   it instead of from the root. */
+static struct node_cache *
+tree_find_leaf(bpt_tree_t *tree, struct bpt_entry *key,
+               struct bpt_path *path, int from_root)
+{
+  struct node_cache *cache;
+  int level;
+  int i;
+
+  if(from_root) {
+    level = 0;
+    path->node_id[0] = tree->root;
+    path->bounded[0] = 0;
+  } else {
+    for(level = path->depth;
+        level > 0 && path->bounded[level] &&
+        entry_cmp(key, &path->bound[level]) >= 0;
+        level--);
+  }
+
+  for(;;) {
+    cache = node_load(tree, path->node_id[level]);
+    if(cache == NULL || cache->node.type == NODE_LEAF) {
+      path->depth = level;
+      return cache;
+    }
+    if(level == PATH_LIMIT) {
+      return NULL;
+    }
+
+    i = lower_bound(cache, key);
+    if(i == cache->count ||
+       entry_cmp(&cache->node.entries[i], key) > 0) {
+      i--;
+    }
+    if(i < 0) {
+      return NULL;
+    }
+
+    path->node_id[level + 1] = cache->node.entries[i].child - 1;
+    if(i + 1 < cache->count) {
+      path->bound[level + 1] = cache->node.entries[i + 1];
+      path->bounded[level + 1] = 1;
+    } else {
+      path->bound[level + 1] = path->bound[level];
+      path->bounded[level + 1] = path->bounded[level];
+    }
+    level++;
+  }
+}
+
+static db_result_t
+create(index_t *index)
+{
+  char *filename;
+  bpt_tree_t *tree;
+
+  filename = storage_generate_file("bptree",
+                                   NODE_OFFSET(NODE_LIMIT));
+  if(filename == NULL) {
+    PRINTF("DB: Failed to generate a B+-tree file\n");
+    return DB_INDEX_ERROR;
+  }
+
+  memcpy(index->descriptor_file, filename,
+	 sizeof(index->descriptor_file));
+
+  PRINTF("DB: Generated the B+-tree file \"%s\" using %lu bytes of space\n",
+	 index->descriptor_file, NODE_OFFSET(NODE_LIMIT));
+
+  index->opaque_data = tree = memb_alloc(&trees);
+  if(tree == NULL) {
+    PRINTF("DB: Failed to allocate a B+-tree\n");
+    cfs_remove(index->descriptor_file);
+    index->descriptor_file[0] = '\0';
+    return DB_ALLOCATION_ERROR;
+  }
+
+  tree->root_slots = 0;
+  tree->next_node = 0;
+  tree->storage = storage_open(index->descriptor_file);
+  if(tree->storage < 0 ||
+     node_create(tree, NODE_LEAF, NULL, 0) < 0 ||
+     !root_set(tree, 0)) {
+    if(tree->storage >= 0) {
+      storage_close(tree->storage);
+    }
+    memb_free(&trees, tree);
+    cfs_remove(index->descriptor_file);
+    index->descriptor_file[0] = '\0';
+    return DB_STORAGE_ERROR;
+  }
+
+  PRINTF("DB: Created a B+-tree index\n");
+  return DB_OK;
+}
+
+static db_result_t
+destroy(index_t *index)
+{
+  cfs_remove(index->descriptor_file);
+  return DB_OK;
+}
+
+static db_result_t
+load(index_t *index)
+{
+  bpt_tree_t *tree;
+  uint16_t root;
+
+  index->opaque_data = tree = memb_alloc(&trees);
+  if(tree == NULL) {
+    PRINTF("DB: Failed to allocate a B+-tree\n");
+    return DB_ALLOCATION_ERROR;
+  }
+
+  tree->storage = storage_open(index->descriptor_file);
+  if(tree->storage < 0) {
+    memb_free(&trees, tree);
+    return DB_STORAGE_ERROR;
+  }
+
+  root = 0;
+  if(!count_written(tree, 0, sizeof(uint16_t), sizeof(uint16_t),
+                    &tree->root_slots) ||
+     !count_written(tree, NODE_OFFSET(0), sizeof(struct bpt_node),
+                    sizeof(uint8_t), &tree->next_node) ||
+     tree->root_slots == 0 ||
+     DB_ERROR(storage_read(tree->storage, &root,
+                           (tree->root_slots - 1) * sizeof(root),
+                           sizeof(root)))) {
+    storage_close(tree->storage);
+    memb_free(&trees, tree);
+    return DB_STORAGE_ERROR;
+  }
+  tree->root = root - 1;
+
+  PRINTF("DB: Loaded B+-tree index from file %s with %u nodes\n",
+	 index->descriptor_file, (unsigned)tree->next_node);
+
+  return DB_OK;
+}
+
+static db_result_t
+release(index_t *index)
+{
+  bpt_tree_t *tree;
+  int i;
+
+  tree = index->opaque_data;
+
+  for(i = 0; i < DB_BPLUSTREE_CACHE_LIMIT; i++) {
+    if(node_cache[i].tree == tree) {
+      node_cache[i].tree = NULL;
+    }
+  }
+
+  storage_close(tree->storage);
+  memb_free(&trees, tree);
+  return DB_OK;
+}
+
+static db_result_t
+insert(index_t *index, attribute_value_t *key, tuple_id_t value)
+{
+  struct bpt_entry entry;
+
+  entry.key = db_value_to_long(key);
+  entry.tuple = value + 1;
+  entry.child = 0;
+
+  if(!tree_insert((bpt_tree_t *)index->opaque_data, &entry)) {
+    PRINTF("DB: Failed to insert key %ld into a B+-tree index\n", entry.key);
+    return DB_INDEX_ERROR;
+  }
+  return DB_OK;
+}
+
+static db_result_t
+delete(index_t *index, attribute_value_t *value)
+{
+  return DB_INDEX_ERROR;
+}
+
+/* Find the first entry that is not smaller than the key, starting in
+   the given leaf and continuing into the leaves to its right. */
+static struct bpt_entry *
+tree_find_entry(bpt_tree_t *tree, struct bpt_entry *key,
+                struct bpt_path *path, struct node_cache *leaf)
+{
+  int i;
+
+  for(;;) {
+    if(leaf == NULL) {
+      return NULL;
+    }
+
+    /* Resume by key rather than by position, so that entries inserted
+       into the leaf meanwhile do not shift the iteration. */
+    i = lower_bound(leaf, key);
+    if(i < leaf->count) {
+      return &leaf->node.entries[i];
+    }
+
+    if(!path->bounded[path->depth]) {
+      return NULL;
+    }
+    /* Continue in the leaf to the right of this one. */
+    *key = path->bound[path->depth];
+    leaf = tree_find_leaf(tree, key, path, 0);
+  }
+}
+
+/* Find the last entry that is smaller than the key in the subtree of
+   a node. Returns 1 if it was found, 0 if there was none, and -1 on
+   errors. */
+static int
+tree_find_last(bpt_tree_t *tree, uint16_t node_id,
+               const struct bpt_entry *key, struct bpt_entry *last,
+               int level)
+{
+  struct node_cache *cache;
+  int i;
+  int r;
+
+  cache = node_load(tree, node_id);
+  if(cache == NULL) {
+    return -1;
+  }
+
+  i = lower_bound(cache, key);
+  if(cache->node.type == NODE_LEAF) {
+    if(i == 0) {
+      return 0;
+    }
+    *last = cache->node.entries[i - 1];
+    return 1;
+  }
+  if(level == PATH_LIMIT) {
+    return -1;
+  }
+
+  /* Only the children whose separators are smaller than the key can
+     hold smaller entries. If the rightmost of them holds none, the
+     entry is in a child to its left. */
+  while(i-- > 0) {
+    r = tree_find_last(tree, cache->node.entries[i].child - 1, key, last,
+                       level + 1);
+    if(r != 0) {
+      return r;
+    }
+    /* The descent may have evicted the node from the cache. */
+    cache = node_load(tree, node_id);
+    if(cache == NULL) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+static tuple_id_t
+get_next(index_iterator_t *iterator)
+{
+  struct iteration_cache {
+    index_iterator_t *index_iterator;
+    /* The smallest entry that has not been returned yet. */
+    struct bpt_entry key;
+    struct bpt_path path;
+  };
+  static struct iteration_cache cache;
+  bpt_tree_t *tree;
+  struct node_cache *leaf;
+  struct bpt_entry *entry;
+
+  tree = (bpt_tree_t *)iterator->index->opaque_data;
+
+  if(cache.index_iterator != iterator || iterator->next_item_no == 0) {
+    /* Initialize the cache for a new search. */
+    cache.index_iterator = iterator;
+    cache.key.key = db_value_to_long(&iterator->min_value);
+    cache.key.tuple = 0;
+    leaf = tree_find_leaf(tree, &cache.key, &cache.path, 1);
+  } else {
+    leaf = node_load(tree, cache.path.node_id[cache.path.depth]);
+  }
+
+  entry = tree_find_entry(tree, &cache.key, &cache.path, leaf);
+  if(entry == NULL ||
+     entry->key > db_value_to_long(&iterator->max_value)) {
+    return INVALID_TUPLE;
+  }
+
+  cache.key = *entry;
+  cache.key.tuple++;
+  iterator->next_item_no++;
+  return entry->tuple - 1;
+}
+
+static db_result_t
+get_extreme(index_iterator_t *iterator, int maximum, attribute_value_t *value)
+{
+  bpt_tree_t *tree;
+  struct bpt_entry key;
+  struct bpt_entry last;
+  struct bpt_entry *entry;
+  struct bpt_path path;
+  long min;
+  long max;
+  int r;
+
+  tree = (bpt_tree_t *)iterator->index->opaque_data;
+  min = db_value_to_long(&iterator->min_value);
+  max = db_value_to_long(&iterator->max_value);
+
+  if(maximum) {
+    /* The largest entry with a key in the range is the last one that
+       is smaller than the largest possible entry with the maximum key. */
+    key.key = max;
+    key.tuple = INVALID_TUPLE;
+    r = tree_find_last(tree, tree->root, &key, &last, 0);
+    if(r < 0) {
+      return DB_INDEX_ERROR;
+    }
+    entry = r ? &last : NULL;
+  } else {
+    key.key = min;
+    key.tuple = 0;
+    entry = tree_find_entry(tree, &key, &path,
+                            tree_find_leaf(tree, &key, &path, 1));
+  }
+
+  if(entry == NULL || entry->key < min || entry->key > max) {
+    return DB_FINISHED;
+  }
+
+  value->domain = DOMAIN_LONG;
+  VALUE_LONG(value) = entry->key;
+
+  return DB_OK;
+}
@@ -79,7 +79,9 @@ index_api_t index_inline = {
   null_op,
   insert,
   delete,
-  get_next
+  get_next,
+  NULL,
+  NULL
 };
 
 static attribute_value_t *
@@ -139,6 +139,8 @@ static db_result_t destroy(index_t *);
 static db_result_t load(index_t *);
 static db_result_t release(index_t *);
 static db_result_t insert(index_t *, attribute_value_t *, tuple_id_t);
+static db_result_t insert_batch(index_t *, attribute_value_t **,
+                                tuple_id_t *, unsigned);
 static db_result_t delete(index_t *, attribute_value_t *);
 static tuple_id_t get_next(index_iterator_t *);
 
@@ -151,7 +153,9 @@ index_api_t index_maxheap = {
   release,
   insert,
   delete,
-  get_next
+  get_next,
+  NULL,
+  insert_batch
 };
 
 static struct bucket_cache *
@@ -444,12 +448,12 @@ bucket_split(heap_t *heap, int bucket_id)
   return 1;
 }
 
-int
-insert_item(heap_t *heap, maxheap_key_t key, maxheap_value_t value)
+/* Find the bucket that accepts the key, splitting it if it is full. */
+static int
+select_bucket(heap_t *heap, maxheap_key_t key)
 {
   int heap_iterator;
   int bucket_id, last_good_bucket_id;
-  struct key_value_pair pair;
 
   for(heap_iterator = 0, last_good_bucket_id = -1;;) {
     bucket_id = heap_find(heap, key, &heap_iterator);
@@ -462,25 +466,36 @@ insert_item(heap_t *heap, maxheap_key_t key, maxheap_value_t value)
 
   if(bucket_id < 0) {
     PRINTF("DB: No bucket for key %ld\n", (long)key);
-    return 0;
+    return -1;
   }
 
-  pair.key = key;
-  pair.value = value;
-
   if(heap->next_free_slot[bucket_id] == BUCKET_SIZE) {
     PRINTF("DB: Bucket %d is full\n", bucket_id);
     if(bucket_split(heap, bucket_id) == 0) {
-      return 0;
+      return -1;
     }
 
     /* Select one of the newly created buckets. */
     bucket_id = heap_find(heap, key, &heap_iterator);
-    if(bucket_id < 0) {
-      return 0;
-    }
   }
 
+  return bucket_id;
+}
+
+int
+insert_item(heap_t *heap, maxheap_key_t key, maxheap_value_t value)
+{
+  int bucket_id;
+  struct key_value_pair pair;
+
+  bucket_id = select_bucket(heap, key);
+  if(bucket_id < 0) {
+    return 0;
+  }
+
+  pair.key = key;
+  pair.value = value;
+
   if(bucket_append(heap, bucket_id, &pair) == 0) {
     return 0;
   }
@@ -491,6 +506,65 @@ insert_item(heap_t *heap, maxheap_key_t key, maxheap_value_t value)
   return 1;
 }
 
+/* Append the pairs that fall into the same leaf bucket with one write.
+   The pairs must be sorted by their hashed keys. */
+static int
+insert_run(heap_t *heap, struct key_value_pair *pairs,
+           maxheap_key_t *hashes, unsigned count)
+{
+  int bucket_id;
+  int first_child;
+  unsigned free_slots;
+  unsigned run;
+  unsigned long offset;
+  heap_node_t node;
+  heap_node_t child;
+
+  bucket_id = select_bucket(heap, pairs[0].key);
+  if(bucket_id < 0 || heap_read(heap, bucket_id, &node) == 0) {
+    return 0;
+  }
+
+  free_slots = BUCKET_SIZE - heap->next_free_slot[bucket_id];
+  if(free_slots == 0) {
+    PRINTF("DB: Invalid write attempt to the full bucket %d\n", bucket_id);
+    return 0;
+  }
+
+  /* Unless the bucket is a leaf, the following keys may belong to one
+     of its children and must be looked up separately. */
+  first_child = BRANCH_FACTOR * bucket_id + 1;
+  if(first_child < NODE_LIMIT) {
+    if(heap_read(heap, first_child, &child) == 0) {
+      return 0;
+    }
+  } else {
+    child.min = child.max = 0;
+  }
+
+  run = 1;
+  if(EMPTY_NODE(&child)) {
+    while(run < count && run < free_slots && hashes[run] <= node.max) {
+      run++;
+    }
+  }
+
+  offset = (unsigned long)bucket_id * sizeof(bucket_t);
+  offset += heap->next_free_slot[bucket_id] * sizeof(struct key_value_pair);
+
+  if(DB_ERROR(storage_write(heap->bucket_storage, pairs, offset,
+                            run * sizeof(struct key_value_pair)))) {
+    return 0;
+  }
+
+  heap->next_free_slot[bucket_id] += run;
+
+  PRINTF("DB: Inserted %u keys into the heap at bucket_id %d\n",
+         run, bucket_id);
+
+  return run;
+}
+
 static db_result_t
 create(index_t *index)
 {
@@ -659,6 +733,46 @@ insert(index_t *index, attribute_value_t *key, tuple_id_t value)
   return DB_OK;
 }
 
+static db_result_t
+insert_batch(index_t *index, attribute_value_t **keys,
+             tuple_id_t *values, unsigned count)
+{
+  heap_t *heap;
+  struct key_value_pair pairs[count];
+  struct key_value_pair pair;
+  maxheap_key_t hashes[count];
+  maxheap_key_t hash;
+  unsigned i, j;
+  int r;
+
+  heap = (heap_t *)index->opaque_data;
+
+  /* The buckets partition the range of hashed keys, so sorting by hash
+     places the keys of each bucket next to each other. */
+  for(i = 0; i < count; i++) {
+    pair.key = (maxheap_key_t)db_value_to_long(keys[i]);
+    pair.value = (maxheap_value_t)values[i];
+    hash = transform_key(pair.key);
+    for(j = i; j > 0 && hashes[j - 1] > hash; j--) {
+      pairs[j] = pairs[j - 1];
+      hashes[j] = hashes[j - 1];
+    }
+    pairs[j] = pair;
+    hashes[j] = hash;
+  }
+
+  for(i = 0; i < count; i += r) {
+    r = insert_run(heap, &pairs[i], &hashes[i], count - i);
+    if(r == 0) {
+      PRINTF("DB: Failed to insert key %ld into a max-heap index\n",
+             (long)pairs[i].key);
+      return DB_INDEX_ERROR;
+    }
+  }
+
+  return DB_OK;
+}
+
 static db_result_t
 delete(index_t *index, attribute_value_t *value)
 {
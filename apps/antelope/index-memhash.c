@@ -61,7 +61,9 @@ index_api_t index_memhash = {
   release,
   insert,
   delete,
-  get_next
+  get_next,
+  NULL,
+  NULL
 };
 
 struct hash_item {
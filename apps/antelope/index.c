@@ -49,7 +49,7 @@
 #include "storage.h"
 
 static index_api_t *index_components[] = {&index_inline,
-	&index_maxheap};
+	&index_maxheap, &index_bplustree};
 
 LIST(indices);
 MEMB(index_memb, index_t, DB_INDEX_POOL_SIZE);
@@ -230,6 +230,43 @@ index_insert(index_t *index, attribute_value_t *value,
   return index->api->insert(index, value, tuple_id);
 }
 
+/* Insert count items at once. The keys are sorted in place, along
+   with their tuple IDs, so that the index sees them in key order. */
+db_result_t
+index_insert_batch(index_t *index, attribute_value_t **values,
+                   tuple_id_t *tuple_ids, unsigned count)
+{
+  attribute_value_t *value;
+  tuple_id_t tuple_id;
+  long key;
+  unsigned i, j;
+
+  /* The batches are small, so an insertion sort will do. */
+  for(i = 1; i < count; i++) {
+    value = values[i];
+    tuple_id = tuple_ids[i];
+    key = db_value_to_long(value);
+    for(j = i; j > 0 && db_value_to_long(values[j - 1]) > key; j--) {
+      values[j] = values[j - 1];
+      tuple_ids[j] = tuple_ids[j - 1];
+    }
+    values[j] = value;
+    tuple_ids[j] = tuple_id;
+  }
+
+  if(index->api->insert_batch != NULL) {
+    return index->api->insert_batch(index, values, tuple_ids, count);
+  }
+
+  for(i = 0; i < count; i++) {
+    if(DB_ERROR(index->api->insert(index, values[i], tuple_ids[i]))) {
+      return DB_INDEX_ERROR;
+    }
+  }
+
+  return DB_OK;
+}
+
 db_result_t
 index_delete(index_t *index, attribute_value_t *value)
 {
@@ -329,6 +366,31 @@ index_get_next(index_iterator_t *iterator)
   return iterator->index->api->get_next(iterator);
 }
 
+/* Find the smallest key in the range of the iterator, or the largest
+   one if maximum is set, without reading any tuples. */
+db_result_t
+index_get_extreme(index_iterator_t *iterator, int maximum,
+                  attribute_value_t *value)
+{
+  if(iterator->index->api->get_extreme == NULL) {
+    return DB_INDEX_ERROR;
+  }
+
+  return iterator->index->api->get_extreme(iterator, maximum, value);
+}
+
+db_result_t
+index_count(index_iterator_t *iterator, tuple_id_t *count)
+{
+  if(!(iterator->index->api->flags & INDEX_API_EXACT)) {
+    return DB_INDEX_ERROR;
+  }
+
+  for(*count = 0; index_get_next(iterator) != INVALID_TUPLE; (*count)++);
+
+  return DB_OK;
+}
+
 int
 index_exists(attribute_t *attr)
 {
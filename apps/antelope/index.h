@@ -43,7 +43,8 @@ typedef enum {
   INDEX_NONE = 0,
   INDEX_INLINE = 1,
   INDEX_MEMHASH = 2,
-  INDEX_MAXHEAP = 3
+  INDEX_MAXHEAP = 3,
+  INDEX_BPLUSTREE = 4
 } index_type_t;
 
 #define INDEX_READY		0x00
@@ -55,6 +56,9 @@ typedef enum {
 #define INDEX_API_INLINE	0x04
 #define INDEX_API_COMPLETE	0x08
 #define INDEX_API_RANGE_QUERIES	0x10
+/* The iteration finds precisely the tuples whose keys are in the range,
+   so the index can count them without reading the tuples. */
+#define INDEX_API_EXACT		0x20
 
 struct index_api;
 
@@ -90,6 +94,11 @@ struct index_api {
   db_result_t (*insert)(index_t *, attribute_value_t *, tuple_id_t);
   db_result_t (*delete)(index_t *, attribute_value_t *);
   tuple_id_t (*get_next)(index_iterator_t *);
+  db_result_t (*get_extreme)(index_iterator_t *, int, attribute_value_t *);
+  /* Optional. Inserts a number of items whose keys are sorted in
+     ascending order. */
+  db_result_t (*insert_batch)(index_t *, attribute_value_t **, tuple_id_t *,
+                              unsigned);
 };
 
 typedef struct index_api index_api_t;
@@ -97,6 +106,7 @@ typedef struct index_api index_api_t;
 extern index_api_t index_inline;
 extern index_api_t index_maxheap;
 extern index_api_t index_memhash;
+extern index_api_t index_bplustree;
 
 void index_init(void);
 db_result_t index_create(index_type_t, relation_t *, attribute_t *);
@@ -104,10 +114,14 @@ db_result_t index_destroy(index_t *);
 db_result_t index_load(relation_t *, attribute_t *);
 db_result_t index_release(index_t *);
 db_result_t index_insert(index_t *, attribute_value_t *, tuple_id_t);
+db_result_t index_insert_batch(index_t *, attribute_value_t **, tuple_id_t *,
+                               unsigned);
 db_result_t index_delete(index_t *, attribute_value_t *);
 db_result_t index_get_iterator(index_iterator_t *, index_t *, 
                                attribute_value_t *, attribute_value_t *);
 tuple_id_t index_get_next(index_iterator_t *);
+db_result_t index_get_extreme(index_iterator_t *, int, attribute_value_t *);
+db_result_t index_count(index_iterator_t *, tuple_id_t *);
 int index_exists(attribute_t *);
 
 #endif /* !INDEX_H */
@@ -66,12 +66,7 @@
 
 #define IS_CONNECTIVE(op) ((op) & LVM_CONNECTIVE)
 
-struct variable {
-  operand_type_t type;
-  operand_value_t value;
-  char name[LVM_MAX_NAME_LENGTH + 1];
-};
-typedef struct variable variable_t;
+typedef lvm_variable_t variable_t;
 
 struct derivation {
   operand_value_t max;
@@ -82,7 +77,7 @@ typedef struct derivation derivation_t;
 
 /* Registered variables for a LVM expression. Their values may be 
    changed between executions of the expression. */
-static variable_t variables[LVM_MAX_VARIABLE_ID - 1];
+static variable_t variables[LVM_VARIABLE_TABLE_SIZE];
 
 /* Range derivations of variables that are used for index searches. */
 static derivation_t derivations[LVM_MAX_VARIABLE_ID - 1];
@@ -149,6 +144,7 @@ operand_to_long(operand_t *operand)
 {
   switch(operand->type) {
   case LVM_LONG:
+  case LVM_PARAMETER:
     return operand->value.l;
 #if LVM_USE_FLOATS
   case LVM_FLOAT:
@@ -487,6 +483,65 @@ lvm_set_variable(lvm_instance_t *p, char *name)
   }
 }
 
+void
+lvm_set_parameter(lvm_instance_t *p)
+{
+  operand_t op;
+
+  /* A parameter is a constant whose value is bound after the compilation.
+     Until then, it evaluates to 0. */
+  op.type = LVM_PARAMETER;
+  op.value.l = 0;
+
+  lvm_set_operand(p, &op);
+}
+
+lvm_status_t
+lvm_bind_parameter(lvm_instance_t *p, unsigned index, long l)
+{
+  lvm_ip_t ip;
+  operand_t operand;
+
+  /* The operands keep their order of appearance in the source when
+     operators are shifted in front of them, so the parameters are
+     numbered in the order in which the code stores them. */
+  for(ip = 0; ip < p->end;) {
+    switch(*(node_type_t *)(p->code + ip)) {
+    case LVM_CMP_OP:
+    case LVM_ARITH_OP:
+      ip += sizeof(node_type_t) + sizeof(operator_t);
+      break;
+    case LVM_OPERAND:
+      ip += sizeof(node_type_t);
+      memcpy(&operand, p->code + ip, sizeof(operand));
+      if(operand.type == LVM_PARAMETER && index-- == 0) {
+        operand.value.l = l;
+        memcpy(p->code + ip, &operand, sizeof(operand));
+        return TRUE;
+      }
+      ip += sizeof(operand);
+      break;
+    default:
+      return SEMANTIC_ERROR;
+    }
+  }
+
+  return INVALID_IDENTIFIER;
+}
+
+void
+lvm_save_variables(lvm_variable_t *table)
+{
+  memcpy(table, variables, sizeof(variables));
+}
+
+void
+lvm_restore_variables(lvm_variable_t *table)
+{
+  memcpy(variables, table, sizeof(variables));
+  memset(derivations, 0, sizeof(derivations));
+}
+
 void
 lvm_clone(lvm_instance_t *dst, lvm_instance_t *src)
 {
@@ -542,14 +597,10 @@ create_union(derivation_t *result, derivation_t *d1, derivation_t *d2)
   int i;
 
   for(i = 0; i < LVM_MAX_VARIABLE_ID; i++) {
-    if(!d1[i].derived && !d2[i].derived) {
+    if(!d1[i].derived || !d2[i].derived) {
+      /* A variable that is unrestricted on one side of the
+         disjunction may take any value. */
       continue;
-    } else if(d1[i].derived && !d2[i].derived) {
-      result[i].min.l = d1[i].min.l;
-      result[i].max.l = d1[i].max.l;
-    } else if(!d1[i].derived && d2[i].derived) {
-      result[i].min.l = d2[i].min.l;
-      result[i].max.l = d2[i].max.l;
     } else {
       /* Both derivations have been made; create a
          union of the ranges. */
@@ -711,6 +762,46 @@ lvm_get_derived_range(lvm_instance_t *p, char *name,
   return INVALID_IDENTIFIER;
 }
 
+lvm_status_t
+lvm_get_exact_range(lvm_instance_t *p, char *name,
+                    operand_value_t *min, operand_value_t *max)
+{
+  lvm_ip_t ip;
+  operator_t operator;
+  operand_t operand;
+  variable_id_t id;
+
+  /* The derived range equals the set of values that fulfill the
+     expression if the expression is a conjunction of comparisons
+     between the variable and constants. A union of two ranges might
+     include values that neither comparison accepts. */
+  id = lookup(name);
+  for(ip = 0; ip < p->end;) {
+    switch(*(node_type_t *)(p->code + ip)) {
+    case LVM_CMP_OP:
+      ip += sizeof(node_type_t);
+      memcpy(&operator, p->code + ip, sizeof(operator));
+      if(operator == LVM_OR) {
+        return DERIVATION_ERROR;
+      }
+      ip += sizeof(operator);
+      break;
+    case LVM_OPERAND:
+      ip += sizeof(node_type_t);
+      memcpy(&operand, p->code + ip, sizeof(operand));
+      if(operand.type == LVM_VARIABLE && operand.value.id != id) {
+        return DERIVATION_ERROR;
+      }
+      ip += sizeof(operand);
+      break;
+    default:
+      return DERIVATION_ERROR;
+    }
+  }
+
+  return lvm_get_derived_range(p, name, min, max);
+}
+
 #if DEBUG
 static lvm_ip_t
 print_operator(lvm_instance_t *p, lvm_ip_t index)
@@ -768,6 +859,9 @@ print_operand(lvm_instance_t *p, lvm_ip_t index)
   case LVM_LONG:
     PRINTF("long:%ld ", operand.value.l);
     break;
+  case LVM_PARAMETER:
+    PRINTF("param:%ld ", operand.value.l);
+    break;
   default:
     PRINTF("?? ");
     break;
@@ -100,7 +100,8 @@ typedef enum operator operator_t;
 enum operand_type {
   LVM_VARIABLE,
   LVM_FLOAT,
-  LVM_LONG
+  LVM_LONG,
+  LVM_PARAMETER
 };
 typedef enum operand_type operand_type_t;
 
@@ -120,12 +121,27 @@ struct operand {
 };
 typedef struct operand operand_t;
 
+struct lvm_variable {
+  operand_type_t type;
+  operand_value_t value;
+  char name[LVM_MAX_NAME_LENGTH + 1];
+};
+typedef struct lvm_variable lvm_variable_t;
+
+/* The variables registered for an expression, which must be saved along
+   with its code to execute it again after other expressions have been
+   compiled. */
+#define LVM_VARIABLE_TABLE_SIZE	(LVM_MAX_VARIABLE_ID - 1)
+
 void lvm_reset(lvm_instance_t *p, unsigned char *code, lvm_ip_t size);
 void lvm_clone(lvm_instance_t *dst, lvm_instance_t *src);
 lvm_status_t lvm_derive(lvm_instance_t *p);
 lvm_status_t lvm_get_derived_range(lvm_instance_t *p, char *name, 
                                    operand_value_t *min,
                                    operand_value_t *max);
+lvm_status_t lvm_get_exact_range(lvm_instance_t *p, char *name,
+                                 operand_value_t *min,
+                                 operand_value_t *max);
 void lvm_print_derivations(lvm_instance_t *p);
 lvm_status_t lvm_execute(lvm_instance_t *p);
 lvm_status_t lvm_register_variable(char *name, operand_type_t type);
@@ -140,5 +156,9 @@ void lvm_set_relation(lvm_instance_t *p, operator_t op);
 void lvm_set_operand(lvm_instance_t *p, operand_t *op);
 void lvm_set_long(lvm_instance_t *p, long l);
 void lvm_set_variable(lvm_instance_t *p, char *name);
+void lvm_set_parameter(lvm_instance_t *p);
+lvm_status_t lvm_bind_parameter(lvm_instance_t *p, unsigned index, long l);
+void lvm_save_variables(lvm_variable_t *table);
+void lvm_restore_variables(lvm_variable_t *table);
 
 #endif /* LVM_H */
@@ -472,19 +472,15 @@ relation_remove(char *name, int remove_tuples)
   return result;
 }
 
-db_result_t
-relation_insert(relation_t *rel, attribute_value_t *values)
+static db_result_t
+encode_row(relation_t *rel, attribute_value_t *values, unsigned char *record)
 {
   attribute_t *attr;
-  unsigned char record[rel->row_length];
   unsigned char *ptr;
   attribute_value_t *value;
   db_result_t result;
 
   value = values;
-
-  PRINTF("DB: Relation %s has a record size of %u bytes\n",
-	 rel->name, (unsigned)rel->row_length);
   ptr = record;
 
   PRINTF("DB: Insert (");
@@ -533,20 +529,118 @@ relation_insert(relation_t *rel, attribute_value_t *values)
 #endif /* DEBUG */
 
     ptr += attr->element_size;
-    if(attr->index != NULL) {
-      if(DB_ERROR(index_insert(attr->index, value, rel->next_row))) {
+  }
+
+  PRINTF(")\n");
+
+  return DB_OK;
+}
+
+db_result_t
+relation_insert(relation_t *rel, attribute_value_t *values)
+{
+  attribute_t *attr;
+  unsigned char record[rel->row_length];
+  attribute_value_t *value;
+  db_result_t result;
+  tuple_id_t tuple_id;
+
+  /* The tuple goes at the end, also when the relation was just loaded. */
+  tuple_id = relation_cardinality(rel);
+  if(tuple_id == INVALID_TUPLE) {
+    return DB_STORAGE_ERROR;
+  }
+
+  PRINTF("DB: Relation %s has a record size of %u bytes\n",
+	 rel->name, (unsigned)rel->row_length);
+
+  result = encode_row(rel, values, record);
+  if(DB_ERROR(result)) {
+    return result;
+  }
+
+  value = values;
+  for(attr = list_head(rel->attributes); attr != NULL; attr = attr->next, value++) {
+    if(attr->index != NULL && !(attr->flags & ATTRIBUTE_FLAG_INVALID)) {
+      if(DB_ERROR(index_insert(attr->index, value, tuple_id))) {
         return DB_INDEX_ERROR;
       }
     }
   }
 
-  PRINTF(")\n");
-
-  rel->cardinality++;
-  rel->next_row++;
+  rel->cardinality = tuple_id + 1;
+  rel->next_row = tuple_id + 1;
   return storage_put_row(rel, record);
 }
 
+/*
+ * Insert a number of tuples whose values are stored one tuple after
+ * the other in the values array, in the order of the attributes. Up to
+ * DB_BULK_INSERT_ROWS tuples at a time are written to the relation with
+ * one storage operation, and their keys are passed sorted to each index.
+ */
+db_result_t
+relation_insert_bulk(relation_t *rel, attribute_value_t *values,
+                     tuple_id_t rows)
+{
+  attribute_t *attr;
+  unsigned char records[DB_BULK_INSERT_ROWS * rel->row_length];
+  attribute_value_t *keys[DB_BULK_INSERT_ROWS];
+  tuple_id_t tuple_ids[DB_BULK_INSERT_ROWS];
+  db_result_t result;
+  tuple_id_t tuple_id;
+  unsigned batch;
+  unsigned column;
+  unsigned i;
+
+  tuple_id = relation_cardinality(rel);
+  if(tuple_id == INVALID_TUPLE) {
+    return DB_STORAGE_ERROR;
+  }
+
+  while(rows > 0) {
+    batch = rows < DB_BULK_INSERT_ROWS ? rows : DB_BULK_INSERT_ROWS;
+
+    for(i = 0; i < batch; i++) {
+      result = encode_row(rel, &values[i * rel->attribute_count],
+                          &records[i * rel->row_length]);
+      if(DB_ERROR(result)) {
+        return result;
+      }
+    }
+
+    for(attr = list_head(rel->attributes), column = 0;
+        attr != NULL;
+        attr = attr->next, column++) {
+      if(attr->index == NULL || (attr->flags & ATTRIBUTE_FLAG_INVALID)) {
+        continue;
+      }
+      for(i = 0; i < batch; i++) {
+        keys[i] = &values[i * rel->attribute_count + column];
+        tuple_ids[i] = tuple_id + i;
+      }
+      if(DB_ERROR(index_insert_batch(attr->index, keys, tuple_ids, batch))) {
+        return DB_INDEX_ERROR;
+      }
+    }
+
+    tuple_id += batch;
+    rel->cardinality = tuple_id;
+    rel->next_row = tuple_id;
+    result = storage_put_rows(rel, records, batch);
+    if(DB_ERROR(result)) {
+      return result;
+    }
+
+    PRINTF("DB: Inserted %u tuples into relation %s\n", batch, rel->name);
+
+    values += batch * rel->attribute_count;
+    rows -= batch;
+  }
+
+  return DB_OK;
+}
+
 static void
 aggregate(attribute_t *attr, attribute_value_t *value)
 {
@@ -655,7 +749,7 @@ select_index(db_handle_t *handle, lvm_instance_t *lvm_instance)
 
       if(range <= min_range) {
         index = attr->index;
-        av_min.domain = av_max.domain = DOMAIN_INT;
+        av_min.domain = av_max.domain = DOMAIN_LONG;
         VALUE_LONG(&av_min) = min.l;
         VALUE_LONG(&av_max) = max.l;
       }
@@ -671,6 +765,34 @@ select_index(db_handle_t *handle, lvm_instance_t *lvm_instance)
   }
 }
 
+#if DB_FEATURE_SEGMENTS
+/* Check whether the value ranges of the segment starting at the
+   current tuple rule out every tuple in it. */
+static int
+segment_excluded(db_handle_t *handle, lvm_instance_t *lvm_instance)
+{
+  attribute_t *attr;
+  operand_value_t min;
+  operand_value_t max;
+  long segment_min;
+  long segment_max;
+
+  for(attr = list_head(handle->rel->attributes);
+      attr != NULL;
+      attr = attr->next) {
+    if(!LVM_ERROR(lvm_get_derived_range(lvm_instance, attr->name, &min, &max)) &&
+       storage_get_segment_range(handle->rel, handle->tuple_id, attr,
+                                 &segment_min, &segment_max) == DB_OK &&
+       (segment_max < min.l || segment_min > max.l)) {
+      PRINTF("DB: Skipping segment at tuple %lu because of attribute %s\n",
+             (unsigned long)handle->tuple_id, attr->name);
+      return 1;
+    }
+  }
+  return 0;
+}
+#endif /* DB_FEATURE_SEGMENTS */
+
 static db_result_t
 generate_selection_result(db_handle_t *handle, relation_t *rel, aql_adt_t *adt)
 {
@@ -700,6 +822,12 @@ generate_selection_result(db_handle_t *handle, relation_t *rel, aql_adt_t *adt)
     /* Try to establish acceptable ranges for the attribute values. */
     if(!LVM_ERROR(lvm_derive(adt->lvm_instance))) {
       select_index(handle, adt->lvm_instance);
+#if DB_FEATURE_SEGMENTS
+      /* Inverse logic keeps the tuples that fail the predicate. */
+      if(!(AQL_GET_FLAGS(adt) & AQL_FLAG_INVERSE_LOGIC)) {
+        handle->flags |= DB_HANDLE_FLAG_SKIP_SEGMENTS;
+      }
+#endif
     }
   }
 
@@ -753,6 +881,14 @@ relation_process_select(void *handle_ptr)
   attribute_count = handle->result_rel->attribute_count;
   attr_map_end = attr_map + attribute_count;
 
+  if(handle->flags & DB_HANDLE_FLAG_AGGREGATED) {
+    /* The aggregates have been computed from indexes. */
+    if(AQL_GET_FLAGS(adt) & AQL_FLAG_AGGREGATE) {
+      goto end_aggregation;
+    }
+    return DB_FINISHED;
+  }
+
   if(handle->flags & DB_HANDLE_FLAG_SEARCH_INDEX) {
     handle->tuple_id = index_get_next(&handle->index_iterator);
     if(handle->tuple_id == INVALID_TUPLE) {
@@ -769,6 +905,16 @@ relation_process_select(void *handle_ptr)
     }
   }
 
+#if DB_FEATURE_SEGMENTS
+  if((handle->flags & DB_HANDLE_FLAG_SKIP_SEGMENTS) &&
+     !(handle->flags & DB_HANDLE_FLAG_SEARCH_INDEX)) {
+    while(handle->tuple_id % DB_SEGMENT_ROWS == 0 &&
+          segment_excluded(handle, adt->lvm_instance)) {
+      handle->tuple_id += DB_SEGMENT_ROWS;
+    }
+  }
+#endif /* DB_FEATURE_SEGMENTS */
+
   /* Put the tuples fulfilling the given condition into a new relation.
      The tuples may be projected. */
   result = storage_get_row(handle->rel, &handle->tuple_id, row);
@@ -788,11 +934,12 @@ relation_process_select(void *handle_ptr)
     from_ptr = row + attr_map_ptr->from_offset;
     result_attr = attr_map_ptr->to_attr;
 
-    /* Update the internal state of the PLE. */
-    if(result_attr->domain == DOMAIN_INT) {
+    /* Update the internal state of the PLE. The result attributes of
+       aggregates are integers, so the domain is taken from the source. */
+    if(attr_map_ptr->from_attr->domain == DOMAIN_INT) {
       operand_value.l = from_ptr[0] << 8 | from_ptr[1];
       lvm_set_variable_value(result_attr->name, operand_value);
-    } else if(result_attr->domain == DOMAIN_LONG) {
+    } else if(attr_map_ptr->from_attr->domain == DOMAIN_LONG) {
       operand_value.l = (uint32_t)from_ptr[0] << 24 |
                         (uint32_t)from_ptr[1] << 16 |
                         (uint32_t)from_ptr[2] << 8 |
@@ -824,7 +971,7 @@ relation_process_select(void *handle_ptr)
     if(AQL_GET_FLAGS(adt) & AQL_FLAG_AGGREGATE) {
       for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
         from_ptr = row + attr_map_ptr->from_offset;
-        result = db_phy_to_value(&value, attr_map_ptr->to_attr, from_ptr);
+        result = db_phy_to_value(&value, attr_map_ptr->from_attr, from_ptr);
         if(DB_ERROR(result)) {
 	  return result;
         }
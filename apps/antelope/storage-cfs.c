@@ -35,6 +35,7 @@
  * 	Nicolas Tsiftes <nvt@sics.se>
  */
 
+#include <limits.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -46,6 +47,7 @@
 #include "net/uip-debug.h"
 
 #include "db-options.h"
+#include "result.h"
 #include "storage.h"
 
 struct attribute_record {
@@ -66,6 +68,15 @@ struct index_record {
                                sizeof(struct attribute_record))
 #endif
 
+#if DB_FEATURE_SEGMENTS
+/* The segment file of a relation holds one record of these per
+   attribute for every completed segment of its tuple file. */
+struct segment_range {
+  long min;
+  long max;
+};
+#endif /* DB_FEATURE_SEGMENTS */
+
 #define ROW_XOR 0xf6U
 
 static void
@@ -75,6 +86,75 @@ merge_strings(char *dest, char *prefix, char *suffix)
   strcat(dest, suffix);
 }
 
+#if DB_FEATURE_SEGMENTS
+/* Summarize a completed segment by reading its tuples back. */
+static db_result_t
+put_segment(relation_t *rel, tuple_id_t segment)
+{
+  char filename[SEGMENT_NAME_LENGTH];
+  struct segment_range ranges[DB_MAX_ATTRIBUTES_PER_RELATION];
+  unsigned char row[DB_MAX_CHAR_SIZE_PER_ROW];
+  attribute_t *attr;
+  attribute_value_t value;
+  tuple_id_t tuple_id;
+  long long_value;
+  int fd;
+  int i;
+  int r;
+
+  for(i = 0; i < rel->attribute_count; i++) {
+    ranges[i].min = LONG_MAX;
+    ranges[i].max = LONG_MIN;
+  }
+
+  for(tuple_id = segment * DB_SEGMENT_ROWS;
+      tuple_id < (segment + 1) * DB_SEGMENT_ROWS;
+      tuple_id++) {
+    if(storage_get_row(rel, &tuple_id, row) != DB_OK) {
+      return DB_STORAGE_ERROR;
+    }
+    for(i = 0, attr = list_head(rel->attributes);
+        attr != NULL;
+        i++, attr = attr->next) {
+      if(attr->domain != DOMAIN_INT && attr->domain != DOMAIN_LONG) {
+        ranges[i].min = LONG_MIN;
+        ranges[i].max = LONG_MAX;
+      } else if(relation_get_value(rel, attr, row, &value) == DB_OK) {
+        long_value = db_value_to_long(&value);
+        if(long_value < ranges[i].min) {
+          ranges[i].min = long_value;
+        }
+        if(long_value > ranges[i].max) {
+          ranges[i].max = long_value;
+        }
+      }
+    }
+  }
+
+  merge_strings(filename, rel->tuple_filename, SEGMENT_NAME_SUFFIX);
+  fd = cfs_open(filename, CFS_WRITE | CFS_APPEND);
+  if(fd < 0) {
+    return DB_STORAGE_ERROR;
+  }
+
+  /* Summaries are located by their offset, so stop summarizing if an
+     earlier one is missing, e.g., because the feature was enabled
+     after the relation got tuples. Later segments are then scanned. */
+  r = -1;
+  if(cfs_seek(fd, 0, CFS_SEEK_END) ==
+     (cfs_offset_t)segment * rel->attribute_count * sizeof(ranges[0])) {
+    r = cfs_write(fd, ranges, rel->attribute_count * sizeof(ranges[0]));
+  }
+  cfs_close(fd);
+
+  PRINTF("DB: Summarized segment %lu of relation %s\n",
+         (unsigned long)segment, rel->name);
+
+  return r == rel->attribute_count * sizeof(ranges[0]) ?
+         DB_OK : DB_STORAGE_ERROR;
+}
+#endif /* DB_FEATURE_SEGMENTS */
+
 char *
 storage_generate_file(char *prefix, unsigned long size)
 {
@@ -190,6 +270,9 @@ storage_put_relation(relation_t *rel)
   int r;
   char *str;
   unsigned char *last_byte;
+#if DB_FEATURE_SEGMENTS
+  char segment_filename[SEGMENT_NAME_LENGTH];
+#endif
 
   PRINTF("DB: put_relation(%s)\n", rel->name);
 
@@ -221,6 +304,12 @@ storage_put_relation(relation_t *rel)
 
     strncpy(rel->tuple_filename, str, sizeof(rel->tuple_filename) - 1);
     rel->tuple_filename[sizeof(rel->tuple_filename) - 1] = '\0';
+
+#if DB_FEATURE_SEGMENTS
+    /* Drop the summaries of an older tuple file with the same name. */
+    merge_strings(segment_filename, rel->tuple_filename, SEGMENT_NAME_SUFFIX);
+    cfs_remove(segment_filename);
+#endif
   }
 
   /*
@@ -279,8 +368,16 @@ storage_put_attribute(relation_t *rel, attribute_t *attr)
 db_result_t
 storage_drop_relation(relation_t *rel, int remove_tuples)
 {
+#if DB_FEATURE_SEGMENTS
+  char filename[SEGMENT_NAME_LENGTH];
+#endif
+
   if(remove_tuples && RELATION_HAS_TUPLES(rel)) {
     cfs_remove(rel->tuple_filename);
+#if DB_FEATURE_SEGMENTS
+    merge_strings(filename, rel->tuple_filename, SEGMENT_NAME_SUFFIX);
+    cfs_remove(filename);
+#endif
   }
   return cfs_remove(rel->name) < 0 ? DB_STORAGE_ERROR : DB_OK;
 }
@@ -439,16 +536,31 @@ storage_get_row(relation_t *rel, tuple_id_t *tuple_id, storage_row_t row)
 
 db_result_t
 storage_put_row(relation_t *rel, storage_row_t row)
+{
+  return storage_put_rows(rel, row, 1);
+}
+
+/* Append count consecutive rows with as few writes as CFS allows. */
+db_result_t
+storage_put_rows(relation_t *rel, storage_row_t rows, tuple_id_t count)
 {
   cfs_offset_t end;
-  unsigned remaining;
+  unsigned long remaining;
   int r;
-  unsigned char *last_byte;
+  tuple_id_t i;
+  storage_row_t ptr;
+#if DB_FEATURE_SEGMENTS
+  tuple_id_t first;
+#endif
 #if DB_FEATURE_INTEGRITY
   int missing_bytes;
   char buf[rel->row_length];
 #endif
 
+  if(count == 0) {
+    return DB_OK;
+  }
+
   end = cfs_seek(rel->tuple_storage, 0, CFS_SEEK_END);
   if(end == (cfs_offset_t)-1) {
     return DB_STORAGE_ERROR;
@@ -465,26 +577,47 @@ storage_put_row(relation_t *rel, storage_row_t row)
   }
 #endif
 
-  /* Ensure that last written byte is separated from 0, to make file
-     lengths correct in Coffee. */
-  last_byte = row + rel->row_length - 1;
-  *last_byte ^= ROW_XOR;
+  /* Ensure that the last byte of each row is separated from 0, to make
+     file lengths correct in Coffee. */
+  for(i = 0; i < count; i++) {
+    rows[(i + 1) * rel->row_length - 1] ^= ROW_XOR;
+  }
 
-  remaining = rel->row_length;
+  ptr = rows;
+  remaining = (unsigned long)count * rel->row_length;
   do {
-    r = cfs_write(rel->tuple_storage, row, remaining);
+    r = cfs_write(rel->tuple_storage, ptr, remaining);
     if(r < 0) {
-      PRINTF("DB: Failed to store %u bytes\n", remaining);
-      *last_byte ^= ROW_XOR;
-      return DB_STORAGE_ERROR;
+      PRINTF("DB: Failed to store %lu bytes\n", remaining);
+      break;
     }
-    row += r;
+    ptr += r;
     remaining -= r;
   } while(remaining > 0);
 
-  PRINTF("DB: Stored a of %d bytes\n", rel->row_length);
+  for(i = 0; i < count; i++) {
+    rows[(i + 1) * rel->row_length - 1] ^= ROW_XOR;
+  }
 
-  *last_byte ^= ROW_XOR;
+  if(remaining > 0) {
+    return DB_STORAGE_ERROR;
+  }
+
+  PRINTF("DB: Stored %u rows of %d bytes\n", (unsigned)count, rel->row_length);
+
+#if DB_FEATURE_SEGMENTS
+  /* Temporary relations are not worth summarizing. Summarize every
+     segment that the new rows completed. */
+  if(rel->dir == DB_STORAGE) {
+    first = end / rel->row_length;
+    for(i = first; i < first + count; i++) {
+      if((i + 1) % DB_SEGMENT_ROWS == 0 &&
+         put_segment(rel, i / DB_SEGMENT_ROWS) != DB_OK) {
+        PRINTF("DB: Failed to summarize a segment of relation %s\n", rel->name);
+      }
+    }
+  }
+#endif /* DB_FEATURE_SEGMENTS */
 
   return DB_OK;
 }
@@ -581,3 +714,47 @@ storage_write(db_storage_id_t fd,
 
   return DB_OK;
 }
+
+#if DB_FEATURE_SEGMENTS
+db_result_t
+storage_get_segment_range(relation_t *rel, tuple_id_t tuple_id,
+                          attribute_t *attr, long *min, long *max)
+{
+  char filename[SEGMENT_NAME_LENGTH];
+  struct segment_range range;
+  attribute_t *ptr;
+  cfs_offset_t offset;
+  int fd;
+  int r;
+
+  offset = (cfs_offset_t)(tuple_id / DB_SEGMENT_ROWS) *
+           rel->attribute_count * sizeof(range);
+  for(ptr = list_head(rel->attributes); ptr != attr; ptr = ptr->next) {
+    if(ptr == NULL) {
+      return DB_NAME_ERROR;
+    }
+    offset += sizeof(range);
+  }
+
+  merge_strings(filename, rel->tuple_filename, SEGMENT_NAME_SUFFIX);
+  fd = cfs_open(filename, CFS_READ);
+  if(fd < 0) {
+    return DB_FINISHED;
+  }
+
+  r = 0;
+  if(cfs_seek(fd, offset, CFS_SEEK_SET) == offset) {
+    r = cfs_read(fd, &range, sizeof(range));
+  }
+  cfs_close(fd);
+
+  /* The last segment is not summarized until it is complete. */
+  if(r != sizeof(range)) {
+    return DB_FINISHED;
+  }
+
+  *min = range.min;
+  *max = range.max;
+  return DB_OK;
+}
+#endif /* DB_FEATURE_SEGMENTS */
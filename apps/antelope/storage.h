@@ -48,6 +48,10 @@
 #define INDEX_NAME_LENGTH       (RELATION_NAME_LENGTH + \
                                  sizeof(INDEX_NAME_SUFFIX) - 1)
 
+#define SEGMENT_NAME_SUFFIX     ".seg"
+#define SEGMENT_NAME_LENGTH     (RELATION_NAME_LENGTH + \
+                                 sizeof(SEGMENT_NAME_SUFFIX))
+
 typedef unsigned char * storage_row_t;
 
 char *storage_generate_file(char *, unsigned long);
@@ -66,7 +70,10 @@ db_result_t storage_put_index(index_t *);
 
 db_result_t storage_get_row(relation_t *, tuple_id_t *, storage_row_t);
 db_result_t storage_put_row(relation_t *, storage_row_t);
+db_result_t storage_put_rows(relation_t *, storage_row_t, tuple_id_t);
 db_result_t storage_get_row_amount(relation_t *, tuple_id_t *);
+db_result_t storage_get_segment_range(relation_t *, tuple_id_t,
+                                      attribute_t *, long *, long *);
 
 db_storage_id_t storage_open(const char *);
 void storage_close(db_storage_id_t);
@@ -43,8 +43,11 @@
 #include "net/rime/timesynch.h"
 #include "collect-view.h"
 
+#include <stdio.h>
 #include <string.h>
 
+#define RECORD_MAX_VALUES (8 + sizeof(struct collect_view_data_msg) / 2)
+
 /*---------------------------------------------------------------------------*/
 void
 collect_view_construct_message(struct collect_view_data_msg *msg,
@@ -103,3 +106,49 @@ collect_view_construct_message(struct collect_view_data_msg *msg,
   collect_view_arch_read_sensors(msg);
 }
 /*---------------------------------------------------------------------------*/
+static char *
+put_hex16(char *p, uint16_t value)
+{
+  static const char hex[] = "0123456789abcdef";
+
+  p[0] = hex[(value >> 12) & 0xf];
+  p[1] = hex[(value >> 8) & 0xf];
+  p[2] = hex[(value >> 4) & 0xf];
+  p[3] = hex[value & 0xf];
+  return p + 4;
+}
+/*---------------------------------------------------------------------------*/
+void
+collect_view_print_record(unsigned long time, const rimeaddr_t *originator,
+                          uint8_t seqno, uint8_t hops,
+                          const uint8_t *payload, uint16_t payload_len)
+{
+  static char buf[1 + RECORD_MAX_VALUES * 4 + 1];
+  char *p;
+  uint16_t data;
+  int i;
+
+  if(payload_len / 2 > RECORD_MAX_VALUES - 8) {
+    payload_len = (RECORD_MAX_VALUES - 8) * 2;
+  }
+
+  p = buf;
+  *p++ = COLLECT_VIEW_RECORD_PREFIX;
+  p = put_hex16(p, 8 + payload_len / 2);
+  /* Timestamp and latency as in the text format */
+  p = put_hex16(p, (time >> 16) & 0xffff);
+  p = put_hex16(p, time & 0xffff);
+  p = put_hex16(p, 0);
+  p = put_hex16(p, originator->u8[0] + (originator->u8[1] << 8));
+  p = put_hex16(p, seqno);
+  p = put_hex16(p, hops);
+  p = put_hex16(p, 0);
+  for(i = 0; i < payload_len / 2; i++) {
+    memcpy(&data, payload, sizeof(data));
+    payload += sizeof(data);
+    p = put_hex16(p, data);
+  }
+  *p = '\0';
+  printf("%s\n", buf);
+}
+/*---------------------------------------------------------------------------*/
@@ -5,6 +5,20 @@
 #include "net/rime/rimeaddr.h"
 #include "net/rime/collect.h"
 
+/**
+ * Print sensor data on the sink as compact records instead of decimal
+ * text: '@' followed by four hex digits per 16-bit value, in the order
+ * of the text format. This is about half the size on the serial line
+ * and is parsed by the collect-view host application without tokenizing.
+ */
+#ifdef COLLECT_VIEW_CONF_RECORD
+#define COLLECT_VIEW_RECORD COLLECT_VIEW_CONF_RECORD
+#else
+#define COLLECT_VIEW_RECORD 0
+#endif
+
+#define COLLECT_VIEW_RECORD_PREFIX '@'
+
 struct collect_view_data_msg {
   uint16_t len;
   uint16_t clock;
@@ -29,6 +43,12 @@ void collect_view_construct_message(struct collect_view_data_msg *msg,
                                     uint16_t num_neighbors,
                                     uint16_t beacon_interval);
 
+/* Print one sensor data record received by the sink */
+void collect_view_print_record(unsigned long time,
+                               const rimeaddr_t *originator,
+                               uint8_t seqno, uint8_t hops,
+                               const uint8_t *payload, uint16_t payload_len);
+
 void collect_view_arch_read_sensors(struct collect_view_data_msg *msg);
 
 #endif /* COLLECT_VIEW_H */
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2007, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *	Rebuilds a file from a base version and a patch that Deluge has
+ *	disseminated. The patch format is described in deluge-patch.h.
+ * \author
+ * 	Nicolas Tsiftes <nvt@sics.se>
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "dev/watchdog.h"
+#include "lib/crc16.h"
+#include "deluge-patch.h"
+
+#define DEBUG	0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...)	printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+#ifdef DELUGE_PATCH_CONF_BUFFER_SIZE
+#define BUFFER_SIZE	DELUGE_PATCH_CONF_BUFFER_SIZE
+#else
+#define BUFFER_SIZE	64
+#endif
+
+static unsigned char buf[BUFFER_SIZE];
+
+/* The progress of the target file. */
+static uint32_t target_size;
+static uint32_t written;
+static uint16_t target_crc;
+
+static uint32_t
+get_number(const unsigned char *p, int size)
+{
+  uint32_t value;
+
+  for(value = 0; size > 0; size--) {
+    value = (value << 8) | p[size - 1];
+  }
+  return value;
+}
+
+static int
+read_at(int fd, cfs_offset_t offset, unsigned char *data, unsigned length)
+{
+  if(cfs_seek(fd, offset, CFS_SEEK_SET) != offset) {
+    return -1;
+  }
+  return cfs_read(fd, data, length) == length ? 0 : -1;
+}
+
+static int
+write_target(int fd, unsigned length)
+{
+  if(written + length > target_size) {
+    PRINTF("Patch: the target exceeds %lu bytes\n",
+	   (unsigned long)target_size);
+    return DELUGE_PATCH_FORMAT_ERROR;
+  }
+  if(cfs_write(fd, buf, length) != length) {
+    return DELUGE_PATCH_IO_ERROR;
+  }
+  written += length;
+  target_crc = crc16_data(buf, length, target_crc);
+
+  watchdog_periodic();
+
+  return DELUGE_PATCH_OK;
+}
+
+int
+deluge_patch_apply(int patch_fd, int base_fd, int target_fd)
+{
+  unsigned char header[DELUGE_PATCH_HEADER_SIZE];
+  unsigned char op[6];
+  uint32_t base_size;
+  uint32_t offset;
+  uint16_t crc;
+  unsigned length;
+  unsigned n;
+  int r;
+
+  if(cfs_seek(patch_fd, 0, CFS_SEEK_SET) != 0 ||
+     cfs_read(patch_fd, header, sizeof(header)) != sizeof(header) ||
+     header[0] != DELUGE_PATCH_MAGIC_0 || header[1] != DELUGE_PATCH_MAGIC_1 ||
+     header[2] != DELUGE_PATCH_VERSION) {
+    return DELUGE_PATCH_FORMAT_ERROR;
+  }
+  base_size = get_number(&header[4], 4);
+  target_size = get_number(&header[8], 4);
+
+  /* Make sure that the base is the version that the patch was made
+     for, before anything is written. */
+  for(crc = 0, offset = 0; offset < base_size; offset += n) {
+    n = base_size - offset > BUFFER_SIZE ? BUFFER_SIZE : base_size - offset;
+    if(read_at(base_fd, offset, buf, n) < 0) {
+      return DELUGE_PATCH_BASE_ERROR;
+    }
+    crc = crc16_data(buf, n, crc);
+    watchdog_periodic();
+  }
+  if(crc != get_number(&header[12], 2)) {
+    PRINTF("Patch: the base does not match\n");
+    return DELUGE_PATCH_BASE_ERROR;
+  }
+
+  if(cfs_seek(target_fd, 0, CFS_SEEK_SET) != 0) {
+    return DELUGE_PATCH_IO_ERROR;
+  }
+  written = 0;
+  target_crc = 0;
+
+  /* The patch is read sequentially after the header. */
+  for(;;) {
+    if(cfs_read(patch_fd, op, 1) != 1) {
+      return DELUGE_PATCH_FORMAT_ERROR;
+    }
+
+    switch(op[0]) {
+    case DELUGE_PATCH_OP_END:
+      if(written != target_size) {
+	return DELUGE_PATCH_FORMAT_ERROR;
+      }
+      if(target_crc != get_number(&header[14], 2)) {
+	PRINTF("Patch: the target CRC does not match\n");
+	return DELUGE_PATCH_CRC_ERROR;
+      }
+      PRINTF("Patch: wrote %lu bytes\n", (unsigned long)written);
+      return DELUGE_PATCH_OK;
+    case DELUGE_PATCH_OP_COPY:
+      if(cfs_read(patch_fd, op, 6) != 6) {
+	return DELUGE_PATCH_FORMAT_ERROR;
+      }
+      offset = get_number(&op[0], 4);
+      length = get_number(&op[4], 2);
+      if(offset > base_size || length > base_size - offset) {
+	return DELUGE_PATCH_FORMAT_ERROR;
+      }
+      for(; length > 0; length -= n, offset += n) {
+	n = length > BUFFER_SIZE ? BUFFER_SIZE : length;
+	if(read_at(base_fd, offset, buf, n) < 0) {
+	  return DELUGE_PATCH_IO_ERROR;
+	}
+	r = write_target(target_fd, n);
+	if(r != DELUGE_PATCH_OK) {
+	  return r;
+	}
+      }
+      break;
+    case DELUGE_PATCH_OP_INSERT:
+      if(cfs_read(patch_fd, op, 2) != 2) {
+	return DELUGE_PATCH_FORMAT_ERROR;
+      }
+      for(length = get_number(&op[0], 2); length > 0; length -= n) {
+	n = length > BUFFER_SIZE ? BUFFER_SIZE : length;
+	if(cfs_read(patch_fd, buf, n) != n) {
+	  return DELUGE_PATCH_FORMAT_ERROR;
+	}
+	r = write_target(target_fd, n);
+	if(r != DELUGE_PATCH_OK) {
+	  return r;
+	}
+      }
+      break;
+    default:
+      return DELUGE_PATCH_FORMAT_ERROR;
+    }
+  }
+}
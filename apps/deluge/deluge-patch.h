@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2007, Swedish Institute of Computer Science
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *	Header for the Deluge patch applier.
+ *
+ *	A patch rebuilds a new version of a file, such as a firmware image
+ *	or an ELF module, from the version that is already stored on the
+ *	node. Deluge then only needs to disseminate the patch. All numbers
+ *	in a patch are stored in little-endian byte order.
+ *
+ *	The patch starts with a header:
+ *
+ *	  'D' 'P' version(1) reserved(1)
+ *	  base size(4) target size(4) base CRC(2) target CRC(2)
+ *
+ *	The CRCs are CRC-16 checksums (lib/crc16.h) over the whole files.
+ *	The header is followed by a sequence of operations, which write
+ *	the target file from its start:
+ *
+ *	  COPY   0x01 base offset(4) length(2)  Copy bytes from the base.
+ *	  INSERT 0x02 length(2) data            Write the bytes that follow.
+ *	  END    0x00                           The target is complete.
+ *
+ *	tools/deluge-mkpatch generates patches.
+ * \author
+ * 	Nicolas Tsiftes <nvt@sics.se>
+ */
+
+#ifndef DELUGE_PATCH_H
+#define DELUGE_PATCH_H
+
+#define DELUGE_PATCH_MAGIC_0		'D'
+#define DELUGE_PATCH_MAGIC_1		'P'
+#define DELUGE_PATCH_VERSION		1
+#define DELUGE_PATCH_HEADER_SIZE	16
+
+#define DELUGE_PATCH_OP_END		0x00
+#define DELUGE_PATCH_OP_COPY		0x01
+#define DELUGE_PATCH_OP_INSERT		0x02
+
+#define DELUGE_PATCH_OK			0
+#define DELUGE_PATCH_FORMAT_ERROR	1
+#define DELUGE_PATCH_BASE_ERROR		2
+#define DELUGE_PATCH_IO_ERROR		3
+#define DELUGE_PATCH_CRC_ERROR		4
+
+/*
+ * Apply the patch in patch_fd to the base file in base_fd, and write
+ * the result to target_fd, which must be open for writing and must
+ * have room for the target size. The files are read and written
+ * through a small buffer, so that neither has to fit into RAM. The
+ * patch is refused if the base is not the version that the patch was
+ * made for.
+ */
+int deluge_patch_apply(int patch_fd, int base_fd, int target_fd);
+
+#endif /* DELUGE_PATCH_H */
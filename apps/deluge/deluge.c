@@ -110,7 +110,11 @@ transition(int state)
       ctimer_stop(&profile_timer);
       break;
     case DELUGE_STATE_RX:
-      ctimer_stop(&rx_timer);
+      /* Pages that are complete can be forwarded while later pages
+         are being received. */
+      if(state != DELUGE_STATE_TX) {
+        ctimer_stop(&rx_timer);
+      }
       break;
     case DELUGE_STATE_TX:
       ctimer_stop(&tx_timer);
@@ -120,17 +124,29 @@ transition(int state)
   }
 }
 
+/* Stop receiving, but let a transmission in progress finish. */
+static void
+stop_rx(void)
+{
+  if(deluge_state == DELUGE_STATE_RX) {
+    transition(DELUGE_STATE_MAINTAIN);
+  } else {
+    ctimer_stop(&rx_timer);
+  }
+}
+
 static int
-write_page(struct deluge_object *obj, unsigned pagenum, unsigned char *data)
+write_packet(struct deluge_object *obj, unsigned pagenum, unsigned packetnum,
+	     unsigned char *data)
 {
   cfs_offset_t offset;
 
-  offset = pagenum * S_PAGE;
+  offset = pagenum * S_PAGE + packetnum * S_PKT;
 
   if(cfs_seek(obj->cfs_fd, offset, CFS_SEEK_SET) != offset) {
     return -1;
   }
-  return cfs_write(obj->cfs_fd, (char *)data, S_PAGE);
+  return cfs_write(obj->cfs_fd, (char *)data, S_PKT);
 }
 
 static int
@@ -205,6 +221,7 @@ init_object(struct deluge_object *obj, char *filename, unsigned version)
   obj->current_rx_page = 0;
   obj->nrequests = 0;
   obj->tx_set = 0;
+  obj->summary_available = 0;
 
   obj->pages = malloc(OBJECT_PAGE_COUNT(*obj) * sizeof(*obj->pages));
   if(obj->pages == NULL) {
@@ -217,8 +234,6 @@ init_object(struct deluge_object *obj, char *filename, unsigned version)
     init_page(&current_object, i, 1);
   }
 
-  memset(obj->current_page, 0, sizeof(obj->current_page));
-
   return 0;
 }
 
@@ -241,15 +256,29 @@ send_request(void *arg)
 {
   struct deluge_object *obj;
   struct deluge_msg_request request;
+  struct deluge_page *page;
+  int i;
 
   obj = (struct deluge_object *)arg;
 
   request.cmd = DELUGE_CMD_REQUEST;
   request.pagenum = obj->current_rx_page;
   request.version = obj->pages[request.pagenum].version;
-  request.request_set = ~obj->pages[obj->current_rx_page].packet_set;
   request.object_id = obj->object_id;
 
+  /* Request the missing packets of the pages that the advertiser has,
+     up to the pipeline depth. */
+  request.request_set = 0;
+  for(i = 0; i < N_PIPELINE &&
+	request.pagenum + i < OBJECT_PAGE_COUNT(*obj) &&
+	(i == 0 || request.pagenum + i < obj->summary_available); i++) {
+    page = &obj->pages[request.pagenum + i];
+    if(!(page->flags & PAGE_COMPLETE)) {
+      request.request_set |=
+	(uint16_t)(~page->packet_set & ALL_PACKETS) << (i * N_PKT);
+    }
+  }
+
   PRINTF("Sending request for page %d, version %u, request_set %u\n", 
 	request.pagenum, request.version, request.request_set);
   packetbuf_copyfrom(&request, sizeof(request));
@@ -259,7 +288,7 @@ send_request(void *arg)
   if(++obj->nrequests == CONST_LAMBDA) {
     /* XXX check rate here too. */
     obj->nrequests = 0;
-    transition(DELUGE_STATE_MAINTAIN);
+    stop_rx();
   } else {
     ctimer_reset(&rx_timer);
   }
@@ -333,7 +362,10 @@ handle_summary(struct deluge_msg_summary *msg, const rimeaddr_t *sender)
     }
 
     rimeaddr_copy(&current_object.summary_from, sender);
-    transition(DELUGE_STATE_RX);
+    current_object.summary_available = msg->highest_available;
+    if(deluge_state != DELUGE_STATE_TX) {
+      transition(DELUGE_STATE_RX);
+    }
 
     if(ctimer_expired(&rx_timer)) {
       ctimer_set(&rx_timer,
@@ -344,30 +376,39 @@ handle_summary(struct deluge_msg_summary *msg, const rimeaddr_t *sender)
 }
 
 static void
-send_page(struct deluge_object *obj, unsigned pagenum)
+send_pages(struct deluge_object *obj)
 {
   unsigned char buf[S_PAGE];
   struct deluge_msg_packet pkt;
   unsigned char *cp;
+  unsigned packet_set;
+  int i;
 
   pkt.cmd = DELUGE_CMD_PACKET;
-  pkt.pagenum = pagenum;
-  pkt.version = obj->pages[pagenum].version;
-  pkt.packetnum = 0;
   pkt.object_id = obj->object_id;
-  pkt.crc = 0;
 
-  read_page(obj, pagenum, buf);
+  for(i = 0; i < N_PIPELINE; i++) {
+    packet_set = (obj->tx_set >> (i * N_PKT)) & ALL_PACKETS;
+    if(packet_set == 0) {
+      continue;
+    }
+
+    pkt.pagenum = obj->current_tx_page + i;
+    pkt.version = obj->pages[pkt.pagenum].version;
+    pkt.packetnum = 0;
 
-  /* Divide the page into packets and send them one at a time. */
-  for(cp = buf; cp + S_PKT <= (unsigned char *)&buf[S_PAGE]; cp += S_PKT) {
-    if(obj->tx_set & (1 << pkt.packetnum)) {
-      pkt.crc = crc16_data(cp, S_PKT, 0);
-      memcpy(pkt.payload, cp, S_PKT);
-      packetbuf_copyfrom(&pkt, sizeof(pkt));
-      broadcast_send(&deluge_broadcast);
+    read_page(obj, pkt.pagenum, buf);
+
+    /* Divide the page into packets and send them one at a time. */
+    for(cp = buf; cp + S_PKT <= (unsigned char *)&buf[S_PAGE]; cp += S_PKT) {
+      if(packet_set & (1 << pkt.packetnum)) {
+	pkt.crc = crc16_data(cp, S_PKT, 0);
+	memcpy(pkt.payload, cp, S_PKT);
+	packetbuf_copyfrom(&pkt, sizeof(pkt));
+	broadcast_send(&deluge_broadcast);
+      }
+      pkt.packetnum++;
     }
-    pkt.packetnum++;
   }
   obj->tx_set = 0;
 }
@@ -379,7 +420,7 @@ tx_callback(void *arg)
 
   obj = (struct deluge_object *)arg;
   if(obj->current_tx_page >= 0 && obj->tx_set) {
-    send_page(obj, obj->current_tx_page);
+    send_pages(obj);
     /* Deluge T.2. */
     if(obj->tx_set) {
       packetbuf_set_attr(PACKETBUF_ATTR_PACKET_TYPE,
@@ -389,7 +430,11 @@ tx_callback(void *arg)
       packetbuf_set_attr(PACKETBUF_ATTR_PACKET_TYPE,
 			 PACKETBUF_ATTR_PACKET_TYPE_STREAM_END);
       obj->current_tx_page = -1;
-      transition(DELUGE_STATE_MAINTAIN);
+      if(ctimer_expired(&rx_timer)) {
+	transition(DELUGE_STATE_MAINTAIN);
+      } else {
+	transition(DELUGE_STATE_RX);
+      }
     }
   }
 }
@@ -398,6 +443,8 @@ static void
 handle_request(struct deluge_msg_request *msg)
 {
   int highest_available;
+  uint16_t request_set;
+  int i;
 
   if(msg->pagenum >= OBJECT_PAGE_COUNT(current_object)) {
     return;
@@ -412,14 +459,26 @@ handle_request(struct deluge_msg_request *msg)
   /* Deluge M.6 */
   if(msg->version == current_object.version &&
       msg->pagenum <= highest_available) {
-    current_object.pages[msg->pagenum].last_request = clock_time();
+    /* Serve only the requested pages that are complete here. */
+    request_set = msg->request_set;
+    for(i = 0; i < N_PIPELINE; i++) {
+      if(msg->pagenum + i >= OBJECT_PAGE_COUNT(current_object) ||
+	 !(current_object.pages[msg->pagenum + i].flags & PAGE_COMPLETE)) {
+	request_set &= ~((uint16_t)ALL_PACKETS << (i * N_PKT));
+      } else if(request_set & ((uint16_t)ALL_PACKETS << (i * N_PKT))) {
+	current_object.pages[msg->pagenum + i].last_request = clock_time();
+      }
+    }
+    if(request_set == 0) {
+      return;
+    }
 
     /* Deluge T.1 */
     if(msg->pagenum == current_object.current_tx_page) {
-      current_object.tx_set |= msg->request_set;
+      current_object.tx_set |= request_set;
     } else {
       current_object.current_tx_page = msg->pagenum;
-      current_object.tx_set = msg->request_set;
+      current_object.tx_set = request_set;
     }
 
     transition(DELUGE_STATE_TX);
@@ -440,7 +499,12 @@ handle_packet(struct deluge_msg_packet *msg)
 	(unsigned)packet.object_id, (unsigned)packet.version,
 	(unsigned)packet.pagenum, (unsigned)packet.packetnum);
 
-  if(packet.pagenum != current_object.current_rx_page) {
+  /* Packets are accepted for all pages in the pipeline, including
+     those overheard from transmissions to other nodes. */
+  if(packet.pagenum < current_object.current_rx_page ||
+     packet.pagenum >= current_object.current_rx_page + N_PIPELINE ||
+     packet.pagenum >= OBJECT_PAGE_COUNT(current_object) ||
+     packet.packetnum >= N_PKT) {
     return;
   }
 
@@ -449,16 +513,23 @@ handle_packet(struct deluge_msg_packet *msg)
   }
 
   page = &current_object.pages[packet.pagenum];
-  if(packet.version == page->version && !(page->flags & PAGE_COMPLETE)) {
-    memcpy(&current_object.current_page[S_PKT * packet.packetnum],
-	packet.payload, S_PKT);
-
+  if(packet.version == page->version && !(page->flags & PAGE_COMPLETE) &&
+     !(page->packet_set & (1 << packet.packetnum))) {
     crc = crc16_data(packet.payload, S_PKT, 0);
     if(packet.crc != crc) {
       PRINTF("packet crc: %hu, calculated crc: %hu\n", packet.crc, crc);
       return;
     }
 
+    /* Store the packet in the object file right away, so that the
+       pages in flight need no buffers in RAM. */
+    if(write_packet(&current_object, packet.pagenum, packet.packetnum,
+		    packet.payload) != S_PKT) {
+      PRINTF("Failed to store packet %u of page %u\n",
+	     (unsigned)packet.packetnum, (unsigned)packet.pagenum);
+      return;
+    }
+
     page->last_data = clock_time();
     page->packet_set |= (1 << packet.packetnum);
 
@@ -467,27 +538,32 @@ handle_packet(struct deluge_msg_packet *msg)
       packetbuf_set_attr(PACKETBUF_ATTR_PACKET_TYPE,
 			 PACKETBUF_ATTR_PACKET_TYPE_STREAM_END);
 
-      write_page(&current_object, packet.pagenum, current_object.current_page);
       page->version = packet.version;
       page->flags = PAGE_COMPLETE;
       PRINTF("Page %u completed\n", packet.pagenum);
 
-      current_object.current_rx_page++;
+      /* The pages in the pipeline can complete in any order. */
+      current_object.current_rx_page = highest_available_page(&current_object);
 
-      if(packet.pagenum == OBJECT_PAGE_COUNT(current_object) - 1) {
+      if(current_object.current_rx_page == OBJECT_PAGE_COUNT(current_object)) {
 	current_object.version = current_object.update_version;
 	leds_on(LEDS_RED);
 	PRINTF("Update completed for object %u, version %u\n", 
 	       (unsigned)current_object.object_id, packet.version);
-      } else if(current_object.current_rx_page < OBJECT_PAGE_COUNT(current_object)) {
-        if(ctimer_expired(&rx_timer)) {
-	  ctimer_set(&rx_timer,
+	/* Deluge R.3 */
+	stop_rx();
+      } else if(current_object.current_rx_page <
+		current_object.summary_available) {
+	/* Keep the pipeline full by requesting the next pages from the
+	   same advertiser instead of waiting for its next summary. */
+	current_object.nrequests = 0;
+	ctimer_set(&rx_timer,
 		CONST_OMEGA * ESTIMATED_TX_TIME + (random_rand() % T_R),
 		send_request, &current_object);
-	}
+      } else {
+	/* Deluge R.3 */
+	stop_rx();
       }
-      /* Deluge R.3 */
-      transition(DELUGE_STATE_MAINTAIN);
     } else {
       /* More packets to come. Put lower layers in streaming mode. */
       packetbuf_set_attr(PACKETBUF_ATTR_PACKET_TYPE,
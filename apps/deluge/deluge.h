@@ -64,6 +64,19 @@ PROCESS_NAME(deluge_process);
 #define N_PKT		4		/* Packets per page. */
 #define S_PAGE		(S_PKT * N_PKT)	/* Fixed page size. */
 
+/* The number of consecutive pages that can be in flight at the same
+   time. A request carries a bitmap of the missing packets in all of
+   them. */
+#ifdef DELUGE_CONF_PIPELINE_PAGES
+#define N_PIPELINE	DELUGE_CONF_PIPELINE_PAGES
+#else
+#define N_PIPELINE	2
+#endif
+
+#if N_PIPELINE * N_PKT > 16
+#error "The request bitmap cannot hold N_PIPELINE pages."
+#endif
+
 /* Bounds for the round time in seconds. */
 #define T_LOW		2
 #define T_HIGH		64
@@ -107,8 +120,9 @@ struct deluge_msg_request {
   uint8_t cmd;
   uint8_t version;
   uint8_t pagenum;
-  uint8_t request_set;
   deluge_object_id_t object_id;
+  /* Bit N_PKT * i + j is set if packet j of page pagenum + i is missing. */
+  uint16_t request_set;
 };
 
 struct deluge_msg_packet {
@@ -139,10 +153,10 @@ struct deluge_object {
   uint8_t current_rx_page;
   int8_t current_tx_page;
   uint8_t nrequests;
-  uint8_t current_page[S_PAGE];
-  uint8_t tx_set;
+  uint16_t tx_set;
   int cfs_fd;
   rimeaddr_t summary_from;
+  uint8_t summary_available;
 };
 
 struct deluge_page {
@@ -71,6 +71,8 @@ PROCESS(coap_receiver, "CoAP Receiver");
 /*- Variables ----------------------------------------------------------------*/
 /*----------------------------------------------------------------------------*/
 static service_callback_t service_cbk = NULL;
+/* RAM copy of coap_error_message, which is kept in program memory */
+static char error_payload[48];
 /*----------------------------------------------------------------------------*/
 /*----------------------------------------------------------------------------*/
 /*----------------------------------------------------------------------------*/
@@ -146,6 +148,14 @@ coap_receive(void)
           /* Invoke resource handler. */
           if (service_cbk)
           {
+#if COAP_PROXY
+            /* Requests for other servers go to the proxy and bypass the resources. */
+            if (IS_OPTION(message, COAP_OPTION_PROXY_URI))
+            {
+              coap_proxy_handler(message, response);
+            }
+            else
+#endif
             /* Call REST framework and check if found and allowed. */
             if (service_cbk(message, response, transaction->packet+COAP_MAX_HEADER_SIZE, block_size, &new_offset))
             {
@@ -157,7 +167,7 @@ coap_receive(void)
                   PRINTF("Block1 NOT IMPLEMENTED\n");
 
                   coap_error_code = NOT_IMPLEMENTED_5_01;
-                  coap_error_message = "NoBlock1Support";
+                  coap_error_message = PGM_STR("NoBlock1Support");
                 }
                 else if ( IS_OPTION(message, COAP_OPTION_BLOCK2) )
                 {
@@ -209,12 +219,12 @@ coap_receive(void)
           else
           {
             coap_error_code = NOT_IMPLEMENTED_5_01;
-            coap_error_message = "NoServiceCallbck"; // no a to fit 16 bytes
+            coap_error_message = PGM_STR("NoServiceCallbck"); // no a to fit 16 bytes
           } /* if (service callback) */
 
         } else {
             coap_error_code = SERVICE_UNAVAILABLE_5_03;
-            coap_error_message = "NoFreeTraBuffer";
+            coap_error_message = PGM_STR("NoFreeTraBuffer");
         } /* if (transaction buffer) */
       }
       else
@@ -268,7 +278,7 @@ coap_receive(void)
     {
       coap_message_type_t reply_type = COAP_TYPE_ACK;
 
-      PRINTF("ERROR %u: %s\n", coap_error_code, coap_error_message);
+      PRINTF("ERROR %u: " PGM_FMT_S "\n", coap_error_code, coap_error_message);
       coap_clear_transaction(transaction);
 
       /* Set to sendable error code. */
@@ -283,7 +293,8 @@ coap_receive(void)
       }
       /* Reuse input buffer for error message. */
       coap_init_message(message, reply_type, coap_error_code, message->mid);
-      coap_set_payload(message, coap_error_message, strlen(coap_error_message));
+      PGM_STRNCPY(error_payload, coap_error_message, sizeof(error_payload) - 1);
+      coap_set_payload(message, error_payload, strlen(error_payload));
       coap_send_message(&UIP_IP_BUF->srcipaddr, UIP_UDP_BUF->srcport, uip_appdata, coap_serialize_message(message, uip_appdata));
     }
   } /* if (new data) */
@@ -498,6 +509,9 @@ PROCESS_THREAD(coap_receiver, ev, data)
   PRINTF("Starting CoAP-13 receiver...\n");
 
   rest_activate_resource(&resource_well_known_core);
+#if COAP_PROXY
+  coap_proxy_init();
+#endif
 
   coap_register_as_transaction_handler();
   coap_init_connection(SERVER_LISTEN_PORT);
@@ -56,6 +56,19 @@
 MEMB(observers_memb, coap_observer_t, COAP_MAX_OBSERVERS);
 LIST(observers_list);
 
+/* A notification serialized without token, patched for each observer. */
+typedef struct coap_notification {
+  const char *url; /* NULL if unused */
+  uint8_t type; /* preferred type */
+  uint16_t len;
+#if COAP_OBSERVING_MIN_INTERVAL
+  struct ctimer timer; /* until the next rate limited observer may be notified */
+#endif /* COAP_OBSERVING_MIN_INTERVAL */
+  uint8_t data[COAP_MAX_PACKET_SIZE];
+} coap_notification_t;
+
+static coap_notification_t notifications[COAP_OBSERVING_NOTIFICATIONS];
+
 /*-----------------------------------------------------------------------------------*/
 coap_observer_t *
 coap_add_observer(uip_ipaddr_t *addr, uint16_t port, const uint8_t *token, size_t token_len, const char *url)
@@ -75,6 +88,11 @@ coap_add_observer(uip_ipaddr_t *addr, uint16_t port, const uint8_t *token, size_
     o->last_mid = 0;
 
     stimer_set(&o->refresh_timer, COAP_OBSERVING_REFRESH_INTERVAL);
+#if COAP_OBSERVING_MIN_INTERVAL
+    /* The first notification is sent right away. */
+    timer_set(&o->notify_timer, 0);
+    o->pending = 0;
+#endif /* COAP_OBSERVING_MIN_INTERVAL */
 
     PRINTF("Adding observer for /%s [0x%02X%02X]\n", o->url, o->token[0], o->token[1]);
     list_add(observers_list, o);
@@ -166,56 +184,166 @@ coap_remove_observer_by_mid(uip_ipaddr_t *addr, uint16_t port, uint16_t mid)
   return removed;
 }
 /*-----------------------------------------------------------------------------------*/
+static void
+send_notification(coap_observer_t *obs, coap_notification_t *n)
+{
+  coap_transaction_t *transaction = NULL;
+  uint8_t type = n->type;
+
+  if (n->len+obs->token_len>COAP_MAX_PACKET_SIZE)
+  {
+    return;
+  }
+
+  if ( (transaction = coap_new_transaction(coap_get_mid(), &obs->addr, obs->port)) )
+  {
+    PRINTF("           Observer ");
+    PRINT6ADDR(&obs->addr);
+    PRINTF(":%u\n", obs->port);
+
+    /* Update last MID for RST matching. */
+    obs->last_mid = transaction->mid;
+
+    /* Use CON to check whether client is still there/interested after COAP_OBSERVING_REFRESH_INTERVAL. */
+    if (stimer_expired(&obs->refresh_timer))
+    {
+      PRINTF("           Refreshing with CON\n");
+      type = COAP_TYPE_CON;
+      stimer_restart(&obs->refresh_timer);
+    }
+
+    /* Patch type, token and MID into the serialized notification. */
+    transaction->packet[0] = (n->data[0] & ~(COAP_HEADER_TYPE_MASK | COAP_HEADER_TOKEN_LEN_MASK))
+                             | (COAP_HEADER_TYPE_MASK & type<<COAP_HEADER_TYPE_POSITION)
+                             | (COAP_HEADER_TOKEN_LEN_MASK & obs->token_len<<COAP_HEADER_TOKEN_LEN_POSITION);
+    transaction->packet[1] = n->data[1];
+    transaction->packet[2] = (uint8_t) ((transaction->mid)>>8);
+    transaction->packet[3] = (uint8_t) (transaction->mid);
+    memcpy(transaction->packet+COAP_HEADER_LEN, obs->token, obs->token_len);
+    memcpy(transaction->packet+COAP_HEADER_LEN+obs->token_len, n->data+COAP_HEADER_LEN, n->len-COAP_HEADER_LEN);
+    transaction->packet_len = n->len+obs->token_len;
+
+    coap_send_transaction(transaction);
+  }
+}
+/*-----------------------------------------------------------------------------------*/
+#if COAP_OBSERVING_MIN_INTERVAL
+static void notification_timeout(void *ptr);
+
+/* Sends the notification to the observers whose interval is over and waits for the others. */
+static void
+send_pending(coap_notification_t *n, uint8_t force)
+{
+  coap_observer_t* obs = NULL;
+  clock_time_t next = 0;
+  clock_time_t remaining;
+  uint8_t waiting = 0;
+
+  for (obs = (coap_observer_t*)list_head(observers_list); obs; obs = obs->next)
+  {
+    if (obs->url!=n->url || !obs->pending)
+    {
+      continue;
+    }
+    if (force || timer_expired(&obs->notify_timer))
+    {
+      obs->pending = 0;
+      timer_set(&obs->notify_timer, COAP_OBSERVING_MIN_INTERVAL);
+      send_notification(obs, n);
+    }
+    else
+    {
+      remaining = timer_remaining(&obs->notify_timer);
+      if (!waiting || remaining<next)
+      {
+        next = remaining;
+      }
+      waiting = 1;
+    }
+  }
+
+  if (waiting)
+  {
+    ctimer_set(&n->timer, next, notification_timeout, n);
+  }
+  else
+  {
+    ctimer_stop(&n->timer);
+    n->url = NULL;
+  }
+}
+
+static void
+notification_timeout(void *ptr)
+{
+  send_pending((coap_notification_t *) ptr, 0);
+}
+#endif /* COAP_OBSERVING_MIN_INTERVAL */
+/*-----------------------------------------------------------------------------------*/
 void
 coap_notify_observers(resource_t *resource, int32_t obs_counter, void *notification)
 {
   coap_packet_t *const coap_res = (coap_packet_t *) notification;
   coap_observer_t* obs = NULL;
-  uint8_t preferred_type = coap_res->type;
+  coap_notification_t *n = NULL;
+  coap_notification_t *unused = NULL;
 
   PRINTF("Observing: Notification from %s\n", resource->url);
 
+  /* The latest notification of a resource replaces the one still held back. */
+  for (n = notifications; n<&notifications[COAP_OBSERVING_NOTIFICATIONS]; ++n)
+  {
+    if (n->url==resource->url)
+    {
+      break;
+    }
+    if (n->url==NULL)
+    {
+      unused = n;
+    }
+  }
+  if (n==&notifications[COAP_OBSERVING_NOTIFICATIONS])
+  {
+    n = unused;
+#if COAP_OBSERVING_MIN_INTERVAL
+    if (n==NULL)
+    {
+      /* Out of space, notify the observers of another resource early. */
+      n = notifications;
+      send_pending(n, 1);
+    }
+#endif /* COAP_OBSERVING_MIN_INTERVAL */
+  }
+
+  /* Serialize once, without token and MID. */
+  coap_res->mid = 0;
+  coap_res->token_len = 0;
+  if (obs_counter>=0) coap_set_header_observe(coap_res, obs_counter);
+  n->type = coap_res->type;
+  if ((n->len = coap_serialize_message(coap_res, n->data))==0)
+  {
+    return;
+  }
+  n->url = resource->url;
+
   /* Iterate over observers. */
   for (obs = (coap_observer_t*)list_head(observers_list); obs; obs = obs->next)
   {
     if (obs->url==resource->url) /* using RESOURCE url pointer as handle */
     {
-      coap_transaction_t *transaction = NULL;
-
-      /*TODO implement special transaction for CON, sharing the same buffer to allow for more observers. */
-
-      if ( (transaction = coap_new_transaction(coap_get_mid(), &obs->addr, obs->port)) )
-      {
-        PRINTF("           Observer ");
-        PRINT6ADDR(&obs->addr);
-        PRINTF(":%u\n", obs->port);
-
-        /* Update last MID for RST matching. */
-        obs->last_mid = transaction->mid;
-
-        /* Prepare response */
-        coap_res->mid = transaction->mid;
-        if (obs_counter>=0) coap_set_header_observe(coap_res, obs_counter);
-        coap_set_header_token(coap_res, obs->token, obs->token_len);
-
-        /* Use CON to check whether client is still there/interested after COAP_OBSERVING_REFRESH_INTERVAL. */
-        if (stimer_expired(&obs->refresh_timer))
-        {
-          PRINTF("           Refreshing with CON\n");
-          coap_res->type = COAP_TYPE_CON;
-          stimer_restart(&obs->refresh_timer);
-        }
-        else
-        {
-          coap_res->type = preferred_type;
-        }
-
-        transaction->packet_len = coap_serialize_message(coap_res, transaction->packet);
-
-        coap_send_transaction(transaction);
-      }
+#if COAP_OBSERVING_MIN_INTERVAL
+      obs->pending = 1;
+#else /* COAP_OBSERVING_MIN_INTERVAL */
+      send_notification(obs, n);
+#endif /* COAP_OBSERVING_MIN_INTERVAL */
     }
   }
+
+#if COAP_OBSERVING_MIN_INTERVAL
+  send_pending(n, 0);
+#else /* COAP_OBSERVING_MIN_INTERVAL */
+  n->url = NULL;
+#endif /* COAP_OBSERVING_MIN_INTERVAL */
 }
 /*-----------------------------------------------------------------------------------*/
 void
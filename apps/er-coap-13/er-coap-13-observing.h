@@ -50,6 +50,19 @@
 /* Interval in seconds in which NON notifies are changed to CON notifies to check client. */
 #define COAP_OBSERVING_REFRESH_INTERVAL  60
 
+/*
+ * Minimum time in clock ticks between two notifications to an observer, 0 to send every notification.
+ * Notifications within the interval are coalesced, the observer gets the latest one when it ends.
+ */
+#ifndef COAP_OBSERVING_MIN_INTERVAL
+#define COAP_OBSERVING_MIN_INTERVAL  0
+#endif /* COAP_OBSERVING_MIN_INTERVAL */
+
+/* Resources whose latest notification can be held back for rate limited observers at the same time. */
+#ifndef COAP_OBSERVING_NOTIFICATIONS
+#define COAP_OBSERVING_NOTIFICATIONS  1
+#endif /* COAP_OBSERVING_NOTIFICATIONS */
+
 #if COAP_MAX_OPEN_TRANSACTIONS<COAP_MAX_OBSERVERS
 #warning "COAP_MAX_OPEN_TRANSACTIONS smaller than COAP_MAX_OBSERVERS: cannot handle CON notifications"
 #endif
@@ -64,6 +77,10 @@ typedef struct coap_observer {
   uint8_t token[COAP_TOKEN_LEN];
   uint16_t last_mid;
   struct stimer refresh_timer;
+#if COAP_OBSERVING_MIN_INTERVAL
+  struct timer notify_timer;
+  uint8_t pending; /* the latest notification has not been sent yet */
+#endif /* COAP_OBSERVING_MIN_INTERVAL */
 } coap_observer_t;
 
 list_t coap_get_observers(void);
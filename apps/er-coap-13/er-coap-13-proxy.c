@@ -0,0 +1,432 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *      CoAP forward proxy with a response cache
+ *
+ *      GET requests with a Proxy-Uri of the form coap://[addr]:port/path?query
+ *      are answered from the cache while the response is fresh (Max-Age).
+ *      Otherwise the client gets a separate response: the request is forwarded
+ *      to the origin server, a stale entry is revalidated with its ETag, and
+ *      clients asking for the same URI meanwhile wait for the same response.
+ */
+
+#include <string.h>
+#include "contiki.h"
+#include "contiki-net.h"
+#include "net/uiplib.h"
+
+#include "er-coap-13-proxy.h"
+#include "er-coap-13-transactions.h"
+
+#if COAP_PROXY
+
+#if !UIP_CONF_IPV6
+#error "The CoAP proxy only forwards to IPv6 literals"
+#endif
+
+#define DEBUG 0
+#if DEBUG
+#define PRINTF(...) printf(__VA_ARGS__)
+#define PRINT6ADDR(addr) PRINTF("[%02x%02x:%02x%02x:%02x%02x:%02x%02x:%02x%02x:%02x%02x:%02x%02x:%02x%02x]", ((uint8_t *)addr)[0], ((uint8_t *)addr)[1], ((uint8_t *)addr)[2], ((uint8_t *)addr)[3], ((uint8_t *)addr)[4], ((uint8_t *)addr)[5], ((uint8_t *)addr)[6], ((uint8_t *)addr)[7], ((uint8_t *)addr)[8], ((uint8_t *)addr)[9], ((uint8_t *)addr)[10], ((uint8_t *)addr)[11], ((uint8_t *)addr)[12], ((uint8_t *)addr)[13], ((uint8_t *)addr)[14], ((uint8_t *)addr)[15])
+#define PRINTLLADDR(lladdr) PRINTF("[%02x:%02x:%02x:%02x:%02x:%02x]",(lladdr)->addr[0], (lladdr)->addr[1], (lladdr)->addr[2], (lladdr)->addr[3],(lladdr)->addr[4], (lladdr)->addr[5])
+#else
+#define PRINTF(...)
+#define PRINT6ADDR(addr)
+#define PRINTLLADDR(addr)
+#endif
+
+#define ENTRY_FREE          0
+#define ENTRY_PENDING       1 /* forwarded, no response yet */
+#define ENTRY_VALID         2 /* holds a response, fresh until expires */
+#define ENTRY_REVALIDATING  3 /* stale response, forwarded with its ETag */
+
+static coap_proxy_entry_t cache[COAP_PROXY_CACHE_ENTRIES];
+
+MEMB(clients_memb, coap_proxy_client_t, COAP_PROXY_MAX_CLIENTS);
+LIST(clients_list);
+
+/* Writable copy of a Proxy-Uri for parsing. */
+static char target[COAP_PROXY_URI_LEN+1];
+
+/*----------------------------------------------------------------------------*/
+static int
+is_fresh(coap_proxy_entry_t *entry)
+{
+  return (long)(entry->expires - clock_seconds()) > 0;
+}
+/*----------------------------------------------------------------------------*/
+/* Splits target into address, port, path, and query. */
+static int
+parse_target(uip_ipaddr_t *addr, uint16_t *port, char **path, char **query)
+{
+  char *p;
+
+  if (strncmp(target, "coap://[", 8)!=0 || (p = strchr(target, ']'))==NULL || !uiplib_ipaddrconv(target+7, addr))
+  {
+    return 0;
+  }
+
+  *port = COAP_DEFAULT_PORT;
+  if (*++p==':')
+  {
+    for (*port = 0, ++p; *p>='0' && *p<='9'; ++p)
+    {
+      *port = *port*10 + (*p-'0');
+    }
+  }
+  if (*p!='\0' && *p!='/')
+  {
+    return 0;
+  }
+
+  *path = p;
+  if ((*query = strchr(p, '?'))!=NULL)
+  {
+    *(*query)++ = '\0';
+  }
+  return 1;
+}
+/*----------------------------------------------------------------------------*/
+static coap_proxy_entry_t *
+lookup(const char *uri, size_t len)
+{
+  int i;
+
+  for (i = 0; i<COAP_PROXY_CACHE_ENTRIES; ++i)
+  {
+    if (cache[i].state!=ENTRY_FREE && cache[i].uri_len==len && memcmp(cache[i].uri, uri, len)==0)
+    {
+      return &cache[i];
+    }
+  }
+  return NULL;
+}
+/*----------------------------------------------------------------------------*/
+/* Takes a free entry, or else evicts the cached response that expires first. */
+static coap_proxy_entry_t *
+alloc_entry()
+{
+  coap_proxy_entry_t *victim = NULL;
+  int i;
+
+  for (i = 0; i<COAP_PROXY_CACHE_ENTRIES; ++i)
+  {
+    if (cache[i].state==ENTRY_FREE)
+    {
+      return &cache[i];
+    }
+    if (cache[i].state==ENTRY_VALID && (victim==NULL || (long)(cache[i].expires - victim->expires) < 0))
+    {
+      victim = &cache[i];
+    }
+  }
+  return victim;
+}
+/*----------------------------------------------------------------------------*/
+static void
+fill_response(coap_packet_t *response, coap_proxy_entry_t *entry, const uint8_t *etag, uint8_t etag_len)
+{
+  if (entry->code==CONTENT_2_05 && etag_len && etag_len==entry->etag_len && memcmp(etag, entry->etag, etag_len)==0)
+  {
+    /* The client holds this representation already. */
+    coap_set_status_code(response, VALID_2_03);
+  }
+  else
+  {
+    coap_set_status_code(response, entry->code);
+    if (entry->content_type!=-1)
+    {
+      coap_set_header_content_type(response, entry->content_type);
+    }
+    coap_set_payload(response, entry->payload, entry->payload_len);
+  }
+
+  if (entry->etag_len)
+  {
+    coap_set_header_etag(response, entry->etag, entry->etag_len);
+  }
+  if (entry->state==ENTRY_VALID)
+  {
+    coap_set_header_max_age(response, is_fresh(entry) ? entry->expires - clock_seconds() : 0);
+  }
+}
+/*----------------------------------------------------------------------------*/
+/* Sends separate responses to all clients waiting for the entry, from the entry if code is 0. */
+static void
+answer_clients(coap_proxy_entry_t *entry, uint8_t code, const char *message)
+{
+  static coap_packet_t response[1];
+  coap_proxy_client_t *client = NULL;
+  coap_proxy_client_t *next = NULL;
+  coap_transaction_t *t = NULL;
+
+  for (client = (coap_proxy_client_t*)list_head(clients_list); client; client = next)
+  {
+    next = client->next;
+    if (client->entry!=entry)
+    {
+      continue;
+    }
+
+    if ( (t = coap_new_transaction(client->request.mid, &client->request.addr, client->request.port)) )
+    {
+      coap_separate_resume(response, &client->request, code);
+      if (code)
+      {
+        coap_set_payload(response, message, strlen(message));
+      }
+      else
+      {
+        fill_response(response, entry, client->etag, client->etag_len);
+      }
+      t->packet_len = coap_serialize_message(response, t->packet);
+      coap_send_transaction(t);
+    }
+    else
+    {
+      PRINTF("Proxy: no transaction to answer client\n");
+    }
+
+    list_remove(clients_list, client);
+    memb_free(&clients_memb, client);
+  }
+}
+/*----------------------------------------------------------------------------*/
+static void
+origin_response_handler(void *data, void *response)
+{
+  coap_proxy_entry_t *entry = (coap_proxy_entry_t *) data;
+  coap_packet_t *const res = (coap_packet_t *) response;
+  const uint8_t *etag = NULL;
+  uint32_t max_age = 0;
+
+  if (res==NULL)
+  {
+    PRINTF("Proxy: origin timed out for %s\n", entry->uri);
+    answer_clients(entry, GATEWAY_TIMEOUT_5_04, "OriginTimeout");
+    entry->state = entry->state==ENTRY_REVALIDATING ? ENTRY_VALID : ENTRY_FREE;
+    return;
+  }
+
+  coap_get_header_max_age(res, &max_age);
+
+  if (res->code==VALID_2_03 && entry->state==ENTRY_REVALIDATING)
+  {
+    PRINTF("Proxy: revalidated %s for %lus\n", entry->uri, max_age);
+  }
+  else if (res->code==0 || res->payload_len>COAP_PROXY_PAYLOAD_LEN || (IS_OPTION(res, COAP_OPTION_BLOCK2) && res->block2_more))
+  {
+    /* Separate responses and blockwise transfers from the origin are not supported. */
+    answer_clients(entry, BAD_GATEWAY_5_02, "UnsupportedReply");
+    entry->state = ENTRY_FREE;
+    return;
+  }
+  else
+  {
+    entry->code = res->code;
+    entry->content_type = coap_get_header_content_type(res);
+    entry->etag_len = coap_get_header_etag(res, &etag);
+    memcpy(entry->etag, etag, entry->etag_len);
+    entry->payload_len = res->payload_len;
+    memcpy(entry->payload, res->payload, res->payload_len);
+  }
+
+  entry->state = ENTRY_VALID;
+  entry->expires = clock_seconds() + max_age;
+
+  answer_clients(entry, 0, NULL);
+
+  if (entry->code!=CONTENT_2_05 || max_age==0)
+  {
+    entry->state = ENTRY_FREE;
+  }
+}
+/*----------------------------------------------------------------------------*/
+static int
+forward(coap_proxy_entry_t *entry)
+{
+  static coap_packet_t request[1];
+  coap_transaction_t *t = NULL;
+  uip_ipaddr_t addr;
+  uint16_t port;
+  char *path;
+  char *query;
+
+  memcpy(target, entry->uri, entry->uri_len+1);
+  parse_target(&addr, &port, &path, &query);
+
+  coap_init_message(request, COAP_TYPE_CON, COAP_GET, coap_get_mid());
+  while (path[0]=='/') ++path;
+  if (path[0])
+  {
+    coap_set_header_uri_path(request, path);
+  }
+  if (query && query[0])
+  {
+    coap_set_header_uri_query(request, query);
+  }
+  if (entry->state==ENTRY_REVALIDATING)
+  {
+    coap_set_header_etag(request, entry->etag, entry->etag_len);
+  }
+
+  if ( (t = coap_new_transaction(request->mid, &addr, UIP_HTONS(port))) )
+  {
+    t->callback = origin_response_handler;
+    t->callback_data = entry;
+    t->packet_len = coap_serialize_message(request, t->packet);
+
+    PRINTF("Proxy: forwarding to ");
+    PRINT6ADDR(&addr);
+    PRINTF(":%u /%s\n", port, path);
+
+    coap_send_transaction(t);
+    return 1;
+  }
+  return 0;
+}
+/*----------------------------------------------------------------------------*/
+void
+coap_proxy_init()
+{
+  memset(cache, 0, sizeof(cache));
+  memb_init(&clients_memb);
+  list_init(clients_list);
+}
+/*----------------------------------------------------------------------------*/
+void
+coap_proxy_handler(coap_packet_t *request, coap_packet_t *response)
+{
+  coap_proxy_entry_t *entry = NULL;
+  coap_proxy_client_t *client = NULL;
+  const char *uri = NULL;
+  const uint8_t *etag = NULL;
+  size_t len = coap_get_header_proxy_uri(request, &uri);
+  uint8_t etag_len = coap_get_header_etag(request, &etag);
+  uip_ipaddr_t addr;
+  uint16_t port;
+  char *path;
+  char *query;
+  uint8_t old_state;
+
+  PRINTF("Proxy: %.*s\n", len, uri);
+
+  if (request->code!=COAP_GET)
+  {
+    coap_error_code = PROXYING_NOT_SUPPORTED_5_05;
+    coap_error_message = PGM_STR("ProxyOnlyGET");
+    return;
+  }
+  if (len>COAP_PROXY_URI_LEN)
+  {
+    coap_error_code = BAD_OPTION_4_02;
+    coap_error_message = PGM_STR("ProxyUriTooLong");
+    return;
+  }
+
+  entry = lookup(uri, len);
+
+  if (entry && entry->state==ENTRY_VALID && is_fresh(entry))
+  {
+    PRINTF("Proxy: cache hit\n");
+    fill_response(response, entry, etag, etag_len);
+    return;
+  }
+
+  if ((client = memb_alloc(&clients_memb))==NULL)
+  {
+    coap_error_code = SERVICE_UNAVAILABLE_5_03;
+    coap_error_message = PGM_STR("ProxyBusy");
+    return;
+  }
+
+  if (entry==NULL)
+  {
+    memcpy(target, uri, len);
+    target[len] = '\0';
+    if (!parse_target(&addr, &port, &path, &query))
+    {
+      memb_free(&clients_memb, client);
+      coap_error_code = PROXYING_NOT_SUPPORTED_5_05;
+      coap_error_message = PGM_STR("BadProxyUri");
+      return;
+    }
+    if ((entry = alloc_entry())==NULL)
+    {
+      memb_free(&clients_memb, client);
+      coap_error_code = SERVICE_UNAVAILABLE_5_03;
+      coap_error_message = PGM_STR("ProxyBusy");
+      return;
+    }
+
+    /* Copy the URI now, the incoming packet is gone after the ACK. */
+    memcpy(entry->uri, uri, len);
+    entry->uri[len] = '\0';
+    entry->uri_len = len;
+    entry->etag_len = 0;
+    old_state = ENTRY_FREE;
+  }
+  else
+  {
+    old_state = entry->state;
+  }
+
+  /* Send the empty ACK for CON requests. */
+  if (!coap_separate_accept(request, &client->request))
+  {
+    memb_free(&clients_memb, client);
+    entry->state = old_state;
+    return;
+  }
+  client->entry = entry;
+  client->etag_len = etag_len;
+  memcpy(client->etag, etag, etag_len);
+  list_add(clients_list, client);
+
+  if (old_state==ENTRY_PENDING || old_state==ENTRY_REVALIDATING)
+  {
+    PRINTF("Proxy: waiting for pending request\n");
+    return;
+  }
+
+  /* Ask the origin whether a stale response changed. */
+  entry->state = old_state==ENTRY_VALID && entry->etag_len ? ENTRY_REVALIDATING : ENTRY_PENDING;
+
+  if (!forward(entry))
+  {
+    answer_clients(entry, SERVICE_UNAVAILABLE_5_03, "NoFreeTraBuffer");
+    entry->state = entry->state==ENTRY_REVALIDATING ? ENTRY_VALID : ENTRY_FREE;
+  }
+}
+/*----------------------------------------------------------------------------*/
+
+#endif /* COAP_PROXY */
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *      CoAP forward proxy with a response cache
+ */
+
+#ifndef COAP_PROXY_H_
+#define COAP_PROXY_H_
+
+#include "er-coap-13.h"
+#include "er-coap-13-separate.h"
+
+/*
+ * Serve requests carrying a Proxy-Uri option by forwarding them to the origin server.
+ */
+#ifndef COAP_PROXY
+#define COAP_PROXY 0
+#endif /* COAP_PROXY */
+
+/*
+ * The number of cached responses. An entry also tracks the forwarded request while it is pending.
+ */
+#ifndef COAP_PROXY_CACHE_ENTRIES
+#define COAP_PROXY_CACHE_ENTRIES 4
+#endif /* COAP_PROXY_CACHE_ENTRIES */
+
+/*
+ * Requests with longer Proxy-Uris are rejected with 4.02.
+ */
+#ifndef COAP_PROXY_URI_LEN
+#define COAP_PROXY_URI_LEN 48
+#endif /* COAP_PROXY_URI_LEN */
+
+/*
+ * Responses with larger payloads are answered with 5.02.
+ */
+#ifndef COAP_PROXY_PAYLOAD_LEN
+#define COAP_PROXY_PAYLOAD_LEN REST_MAX_CHUNK_SIZE
+#endif /* COAP_PROXY_PAYLOAD_LEN */
+
+/*
+ * The number of clients that can wait for forwarded requests at the same time.
+ */
+#ifndef COAP_PROXY_MAX_CLIENTS
+#define COAP_PROXY_MAX_CLIENTS 4
+#endif /* COAP_PROXY_MAX_CLIENTS */
+
+typedef struct coap_proxy_entry {
+  uint8_t state;
+
+  unsigned long expires; /* clock_seconds() */
+
+  uint8_t uri_len;
+  char uri[COAP_PROXY_URI_LEN+1];
+
+  uint8_t code;
+  int16_t content_type; /* -1 if the response had none */
+  uint8_t etag_len;
+  uint8_t etag[COAP_ETAG_LEN];
+  uint16_t payload_len;
+  uint8_t payload[COAP_PROXY_PAYLOAD_LEN];
+} coap_proxy_entry_t;
+
+/* a client waiting for the response to a forwarded request */
+typedef struct coap_proxy_client {
+  struct coap_proxy_client *next; /* for LIST */
+
+  coap_proxy_entry_t *entry;
+  coap_separate_t request;
+
+  uint8_t etag_len;
+  uint8_t etag[COAP_ETAG_LEN];
+} coap_proxy_client_t;
+
+void coap_proxy_init(void);
+void coap_proxy_handler(coap_packet_t *request, coap_packet_t *response);
+
+#endif /* COAP_PROXY_H_ */
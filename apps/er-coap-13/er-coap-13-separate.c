@@ -58,7 +58,7 @@ void
 coap_separate_reject()
 {
   coap_error_code = SERVICE_UNAVAILABLE_5_03;
-  coap_error_message = "AlreadyInUse";
+  coap_error_message = PGM_STR("AlreadyInUse");
 }
 /*----------------------------------------------------------------------------*/
 int
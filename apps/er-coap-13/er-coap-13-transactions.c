@@ -36,6 +36,7 @@
  *      Matthias Kovatsch <kovatsch@inf.ethz.ch>
  */
 
+#include <string.h>
 #include "contiki.h"
 #include "contiki-net.h"
 
@@ -62,18 +63,80 @@
 #endif
 
 
+struct packet_buffer {
+  uint8_t data[COAP_MAX_PACKET_SIZE+1];
+};
+
+struct small_packet_buffer {
+  uint8_t data[COAP_SMALL_PACKET_SIZE];
+};
+
 MEMB(transactions_memb, coap_transaction_t, COAP_MAX_OPEN_TRANSACTIONS);
+MEMB(packets_memb, struct packet_buffer, COAP_MAX_PACKET_BUFFERS);
+MEMB(small_packets_memb, struct small_packet_buffer, COAP_SMALL_PACKET_BUFFERS);
 LIST(transactions_list);
 
 
 static struct process *transaction_handler_process = NULL;
 
+/* Expires with the earliest retransmission timer of the transactions. */
+static struct etimer retrans_etimer;
+
 void
 coap_register_as_transaction_handler()
 {
   transaction_handler_process = PROCESS_CURRENT();
 }
 
+static void
+free_packet(coap_transaction_t *t)
+{
+  if (memb_inmemb(&packets_memb, t->packet))
+  {
+    memb_free(&packets_memb, t->packet);
+  }
+  else
+  {
+    memb_free(&small_packets_memb, t->packet);
+  }
+}
+
+/* Sets the etimer of the transaction handler to the earliest retransmission. */
+static void
+schedule_retransmission()
+{
+  coap_transaction_t *t = NULL;
+  clock_time_t next = 0;
+  clock_time_t remaining;
+  int pending = 0;
+
+  for (t = (coap_transaction_t*)list_head(transactions_list); t; t = t->next)
+  {
+    if (t->retrans_timer.interval==0)
+    {
+      /* Not sent yet. */
+      continue;
+    }
+    remaining = timer_expired(&t->retrans_timer) ? 0 : timer_remaining(&t->retrans_timer);
+    if (!pending || remaining<next)
+    {
+      next = remaining;
+      pending = 1;
+    }
+  }
+
+  if (pending)
+  {
+    PROCESS_CONTEXT_BEGIN(transaction_handler_process);
+    etimer_set(&retrans_etimer, next);
+    PROCESS_CONTEXT_END(transaction_handler_process);
+  }
+  else
+  {
+    etimer_stop(&retrans_etimer);
+  }
+}
+
 coap_transaction_t *
 coap_new_transaction(uint16_t mid, uip_ipaddr_t *addr, uint16_t port)
 {
@@ -81,8 +144,17 @@ coap_new_transaction(uint16_t mid, uip_ipaddr_t *addr, uint16_t port)
 
   if (t)
   {
+    t->packet = memb_alloc(&packets_memb);
+    if (t->packet==NULL)
+    {
+      PRINTF("No free packet buffer\n");
+      memb_free(&transactions_memb, t);
+      return NULL;
+    }
+
     t->mid = mid;
     t->retrans_counter = 0;
+    t->retrans_timer.interval = 0;
 
     /* save client address */
     uip_ipaddr_copy(&t->addr, addr);
@@ -110,23 +182,29 @@ coap_send_transaction(coap_transaction_t *t)
 
       if (t->retrans_counter==0)
       {
-        t->retrans_timer.timer.interval = COAP_RESPONSE_TIMEOUT_TICKS + (random_rand() % (clock_time_t) COAP_RESPONSE_TIMEOUT_BACKOFF_MASK);
-        PRINTF("Initial interval %f\n", (float)t->retrans_timer.timer.interval/CLOCK_SECOND);
+        t->retrans_timer.interval = COAP_RESPONSE_TIMEOUT_TICKS + (random_rand() % (clock_time_t) COAP_RESPONSE_TIMEOUT_BACKOFF_MASK);
+        PRINTF("Initial interval %f\n", (float)t->retrans_timer.interval/CLOCK_SECOND);
+
+        /* Give the full size buffer back while waiting for the ACK if the message fits a small one. */
+        if (t->packet_len<=COAP_SMALL_PACKET_SIZE && memb_inmemb(&packets_memb, t->packet))
+        {
+          uint8_t *small = memb_alloc(&small_packets_memb);
+          if (small)
+          {
+            memcpy(small, t->packet, t->packet_len);
+            memb_free(&packets_memb, t->packet);
+            t->packet = small;
+          }
+        }
       }
       else
       {
-        t->retrans_timer.timer.interval <<= 1; /* double */
-        PRINTF("Doubled (%u) interval %f\n", t->retrans_counter, (float)t->retrans_timer.timer.interval/CLOCK_SECOND);
+        t->retrans_timer.interval <<= 1; /* double */
+        PRINTF("Doubled (%u) interval %f\n", t->retrans_counter, (float)t->retrans_timer.interval/CLOCK_SECOND);
       }
 
-      /*FIXME
-       * Hack: Setting timer for responsible process.
-       * Maybe there is a better way, but avoid posting everything to the process.
-       */
-      struct process *process_actual = PROCESS_CURRENT();
-      process_current = transaction_handler_process;
-      etimer_restart(&t->retrans_timer); /* interval updated above */
-      process_current = process_actual;
+      timer_restart(&t->retrans_timer); /* interval updated above */
+      schedule_retransmission();
 
       t = NULL;
     }
@@ -160,9 +238,15 @@ coap_clear_transaction(coap_transaction_t *t)
   {
     PRINTF("Freeing transaction %u: %p\n", t->mid, t);
 
-    etimer_stop(&t->retrans_timer);
+    uint8_t was_sent = t->retrans_timer.interval!=0;
+
     list_remove(transactions_list, t);
+    free_packet(t);
     memb_free(&transactions_memb, t);
+    if (was_sent)
+    {
+      schedule_retransmission();
+    }
   }
 }
 
@@ -186,10 +270,13 @@ void
 coap_check_transactions()
 {
   coap_transaction_t *t = NULL;
+  coap_transaction_t *next = NULL;
 
-  for (t = (coap_transaction_t*)list_head(transactions_list); t; t = t->next)
+  for (t = (coap_transaction_t*)list_head(transactions_list); t; t = next)
   {
-    if (etimer_expired(&t->retrans_timer))
+    /* Sending may clear the transaction. */
+    next = t->next;
+    if (t->retrans_timer.interval!=0 && timer_expired(&t->retrans_timer))
     {
       ++(t->retrans_counter);
       PRINTF("Retransmitting %u (%u)\n", t->mid, t->retrans_counter);
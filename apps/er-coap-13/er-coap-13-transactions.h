@@ -45,15 +45,35 @@
  * The number of concurrent messages that can be stored for retransmission in the transaction layer.
  */
 #ifndef COAP_MAX_OPEN_TRANSACTIONS
-#define COAP_MAX_OPEN_TRANSACTIONS 4 
+#define COAP_MAX_OPEN_TRANSACTIONS 6
 #endif /* COAP_MAX_OPEN_TRANSACTIONS */
 
-/* container for transactions with message buffer and retransmission info */
+/*
+ * The number of full size message buffers. A transaction holds one while its message is built and
+ * keeps it until the message is acknowledged if it does not fit into a small buffer.
+ */
+#ifndef COAP_MAX_PACKET_BUFFERS
+#define COAP_MAX_PACKET_BUFFERS 2
+#endif /* COAP_MAX_PACKET_BUFFERS */
+
+/*
+ * Buffers that confirmable messages of at most COAP_SMALL_PACKET_SIZE bytes, such as most
+ * notifications, are moved to while they wait for the ACK.
+ */
+#ifndef COAP_SMALL_PACKET_BUFFERS
+#define COAP_SMALL_PACKET_BUFFERS 4
+#endif /* COAP_SMALL_PACKET_BUFFERS */
+
+#ifndef COAP_SMALL_PACKET_SIZE
+#define COAP_SMALL_PACKET_SIZE 48
+#endif /* COAP_SMALL_PACKET_SIZE */
+
+/* container for transactions with retransmission info, the message is in a pool buffer */
 typedef struct coap_transaction {
   struct coap_transaction *next; /* for LIST */
 
   uint16_t mid;
-  struct etimer retrans_timer;
+  struct timer retrans_timer; /* one etimer for all transactions runs until the earliest expires */
   uint8_t retrans_counter;
 
   uip_ipaddr_t addr;
@@ -63,7 +83,7 @@ typedef struct coap_transaction {
   void *callback_data;
 
   uint16_t packet_len;
-  uint8_t packet[COAP_MAX_PACKET_SIZE+1]; /* +1 for the terminating '\0' to simply and savely use snprintf(buf, len+1, "", ...) in the resource handler. */
+  uint8_t *packet; /* COAP_MAX_PACKET_SIZE+1 bytes until sent, +1 for the terminating '\0' to simply and savely use snprintf(buf, len+1, "", ...) in the resource handler. */
 } coap_transaction_t;
 
 void coap_register_as_transaction_handler();
@@ -64,7 +64,8 @@ static struct uip_udp_conn *udp_conn = NULL;
 static uint16_t current_mid = 0;
 
 coap_status_t coap_error_code = NO_ERROR;
-char *coap_error_message = "";
+static const char no_error_message[] PGM = "";
+const char *coap_error_message = no_error_message;
 /*-----------------------------------------------------------------------------------*/
 /*- LOCAL HELP FUNCTIONS ------------------------------------------------------------*/
 /*-----------------------------------------------------------------------------------*/
@@ -380,7 +381,7 @@ coap_serialize_message(void *packet, uint8_t *buffer)
   {
     /* An error occured. Caller must check for !=0. */
     coap_pkt->buffer = NULL;
-    coap_error_message = "Serialized header exceeds COAP_MAX_HEADER_SIZE";
+    coap_error_message = PGM_STR("Serialized header exceeds COAP_MAX_HEADER_SIZE");
     return 0;
   }
 
@@ -435,7 +436,7 @@ coap_parse_message(void *packet, uint8_t *data, uint16_t data_len)
 
   if (coap_pkt->version != 1)
   {
-    coap_error_message = "CoAP version must be 1";
+    coap_error_message = PGM_STR("CoAP version must be 1");
     return BAD_REQUEST_4_00;
   }
 
@@ -601,7 +602,7 @@ coap_parse_message(void *packet, uint8_t *data, uint16_t data_len)
         coap_pkt->proxy_uri_len = option_length;
         /*TODO length > 270 not implemented (actually not required) */
         PRINTF("Proxy-Uri NOT IMPLEMENTED [%.*s]\n", coap_pkt->proxy_uri_len, coap_pkt->proxy_uri);
-        coap_error_message = "This is a constrained server (Contiki)";
+        coap_error_message = PGM_STR("This is a constrained server (Contiki)");
         return PROXYING_NOT_SUPPORTED_5_05;
         break;
 
@@ -634,7 +635,7 @@ coap_parse_message(void *packet, uint8_t *data, uint16_t data_len)
         /* Check if critical (odd) */
         if (option_number & 1)
         {
-          coap_error_message = "Unsupported critical option";
+          coap_error_message = PGM_STR("Unsupported critical option");
           return BAD_OPTION_4_02;
         }
     }
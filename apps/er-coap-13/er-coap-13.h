@@ -42,6 +42,7 @@
 #include <stddef.h> /* for size_t */
 #include "contiki-net.h"
 #include "erbium.h"
+#include "sys/pgm.h"
 
 #define COAP_LINK_FORMAT_FILTERING           1
 
@@ -308,7 +309,7 @@ typedef struct {
 
 /* To store error code and human-readable payload */
 extern coap_status_t coap_error_code;
-extern char *coap_error_message;
+extern const char *coap_error_message; /* In program memory, see \ref pgm */
 
 void coap_init_connection(uint16_t port);
 uint16_t coap_get_mid(void);
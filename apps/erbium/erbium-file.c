@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *      Resources that serve a CFS file with blockwise transfers
+ */
+
+#include <string.h>
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "erbium-file.h"
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+struct file_handle {
+  const char *path; /* NULL if the handle is free */
+  int fd;
+  int32_t pos; /* offset of the next block */
+  int32_t size;
+  clock_time_t used;
+};
+
+static struct file_handle handles[REST_FILE_HANDLES];
+
+/*---------------------------------------------------------------------------*/
+static void
+close_handle(struct file_handle *h)
+{
+  PRINTF("REST file: closing %s\n", h->path);
+  cfs_close(h->fd);
+  h->path = NULL;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Returns a handle of path positioned at offset. A handle whose next block
+ * starts at offset is preferred, otherwise an open handle of the file is
+ * moved or the least recently used handle is opened for it.
+ */
+static struct file_handle *
+get_handle(const char *path, int32_t offset)
+{
+  struct file_handle *h, *found = NULL, *lru = handles;
+  clock_time_t now = clock_time();
+
+  for(h = handles; h < &handles[REST_FILE_HANDLES]; h++) {
+    if(h->path != NULL && now - h->used > REST_FILE_TIMEOUT) {
+      close_handle(h);
+    }
+    if(h->path != NULL && strcmp(h->path, path) == 0 &&
+       (found == NULL || h->pos == offset)) {
+      found = h;
+    }
+    if(lru->path != NULL &&
+       (h->path == NULL || now - h->used > now - lru->used)) {
+      lru = h;
+    }
+  }
+
+  if(found == NULL) {
+    if(lru->path != NULL) {
+      close_handle(lru);
+    }
+    found = lru;
+    found->fd = cfs_open(path, CFS_READ);
+    if(found->fd < 0) {
+      return NULL;
+    }
+    found->path = path;
+    found->size = cfs_seek(found->fd, 0, CFS_SEEK_END);
+    found->pos = -1;
+    PRINTF("REST file: opened %s, %ld bytes\n", path, (long)found->size);
+  }
+
+  if(found->pos != offset) {
+    if(cfs_seek(found->fd, offset, CFS_SEEK_SET) != offset) {
+      close_handle(found);
+      return NULL;
+    }
+    found->pos = offset;
+  }
+  found->used = now;
+  return found;
+}
+/*---------------------------------------------------------------------------*/
+void
+rest_file_handler(void *request, void *response, uint8_t *buffer,
+                  uint16_t preferred_size, int32_t *offset,
+                  const char *path, unsigned int content_type)
+{
+  struct file_handle *h;
+  uint8_t etag[4];
+  int len;
+
+  h = get_handle(path, *offset);
+  if(h == NULL) {
+    REST.set_response_status(response, REST.status.NOT_FOUND);
+    return;
+  }
+
+  if(*offset > 0 && *offset >= h->size) {
+    REST.set_response_status(response, REST.status.BAD_OPTION);
+    /* A block error message should not exceed the minimum block size (16). */
+    const char *error_msg = "BlockOutOfScope";
+    REST.set_response_payload(response, error_msg, strlen(error_msg));
+    return;
+  }
+
+  /* A file that grows during the transfer is sent with its size at the start */
+  len = cfs_read(h->fd, buffer, MIN(preferred_size, h->size - *offset));
+  if(len < 0) {
+    close_handle(h);
+    REST.set_response_status(response, REST.status.INTERNAL_SERVER_ERROR);
+    return;
+  }
+  h->pos += len;
+
+  etag[0] = h->size >> 24;
+  etag[1] = h->size >> 16;
+  etag[2] = h->size >> 8;
+  etag[3] = h->size;
+  REST.set_header_content_type(response, content_type);
+  REST.set_header_etag(response, etag, sizeof(etag));
+  REST.set_response_payload(response, buffer, len);
+
+  *offset += len;
+  if(*offset >= h->size || len == 0) {
+    /* Signal end of resource representation. */
+    *offset = -1;
+    close_handle(h);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+rest_file_close(const char *path)
+{
+  struct file_handle *h;
+
+  for(h = handles; h < &handles[REST_FILE_HANDLES]; h++) {
+    if(h->path != NULL && strcmp(h->path, path) == 0) {
+      close_handle(h);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *      Resources that serve a CFS file with blockwise transfers
+ *
+ *      Consecutive blocks are read from a file handle that stays open
+ *      between the requests, so a transfer does not open the file and
+ *      seek again for every block.
+ */
+
+#ifndef ERBIUM_FILE_H_
+#define ERBIUM_FILE_H_
+
+#include "erbium.h"
+
+/* Files kept open for transfers in progress */
+#ifdef REST_FILE_CONF_HANDLES
+#define REST_FILE_HANDLES REST_FILE_CONF_HANDLES
+#else
+#define REST_FILE_HANDLES 2
+#endif
+
+/* A handle not used for this long is closed */
+#ifdef REST_FILE_CONF_TIMEOUT
+#define REST_FILE_TIMEOUT REST_FILE_CONF_TIMEOUT
+#else
+#define REST_FILE_TIMEOUT (30 * CLOCK_SECOND)
+#endif
+
+/*
+ * Macro to define a resource that serves the file at path for GET requests
+ * The file is sent in blocks of the size the client asks for, the ETag of
+ * the blocks is the size of the file when the transfer started.
+ */
+#define FILE_RESOURCE(name, url, attributes, path, content_type) \
+void name##_handler(void *request, void *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset) \
+{ \
+  rest_file_handler(request, response, buffer, preferred_size, offset, path, content_type); \
+} \
+resource_t resource_##name = {NULL, METHOD_GET, url, attributes, name##_handler, NULL, NULL, NULL}
+
+/*
+ * Handler of FILE_RESOURCE, may be called from other handlers to serve a
+ * file. path must stay valid while the handle is open.
+ */
+void rest_file_handler(void *request, void *response, uint8_t *buffer,
+                       uint16_t preferred_size, int32_t *offset,
+                       const char *path, unsigned int content_type);
+
+/*
+ * Closes the handles of a file, to be called before it is written or removed.
+ */
+void rest_file_close(const char *path);
+
+#endif /* ERBIUM_FILE_H_ */
@@ -58,6 +58,23 @@ PROCESS_NAME(rest_manager_process);
 LIST(restful_services);
 LIST(restful_periodic_services);
 
+#if REST_RESOURCE_BUCKETS
+/* Activated resources hashed on their URL, chained through bucket_next */
+static resource_t *resource_buckets[REST_RESOURCE_BUCKETS];
+
+static uint8_t
+url_hash(const char *url, size_t len)
+{
+  uint16_t hash = 0;
+
+  while (len--)
+  {
+    hash = (hash << 3) + hash + (uint8_t) *url++;
+  }
+  return hash % REST_RESOURCE_BUCKETS;
+}
+#endif /* REST_RESOURCE_BUCKETS */
+
 
 void
 rest_init_engine(void)
@@ -88,6 +105,23 @@ rest_activate_resource(resource_t* resource)
   }
 
   list_add(restful_services, resource);
+
+#if REST_RESOURCE_BUCKETS
+  {
+    resource_t **bucket;
+
+    /* Append, so that equal URLs are found in the order of activation. */
+    for (bucket = &resource_buckets[url_hash(resource->url, strlen(resource->url))];
+         *bucket && *bucket!=resource;
+         bucket = &(*bucket)->bucket_next);
+
+    if (*bucket==NULL)
+    {
+      resource->bucket_next = NULL;
+      *bucket = resource;
+    }
+  }
+#endif
 }
 
 void
@@ -149,42 +183,62 @@ rest_invoke_restful_service(void* request, void* response, uint8_t *buffer, uint
   uint8_t found = 0;
   uint8_t allowed = 0;
 
-  PRINTF("rest_invoke_restful_service url /%.*s -->\n", url_len, url);
-
   resource_t* resource = NULL;
   const char *url = NULL;
+  size_t url_len, res_len;
+
+  url_len = REST.get_url(request, &url);
+
+  PRINTF("rest_invoke_restful_service url /%.*s -->\n", url_len, url);
+
+#if REST_RESOURCE_BUCKETS
+  for (resource = resource_buckets[url_hash(url, url_len)]; resource; resource = resource->bucket_next)
+  {
+    if (url_len==strlen(resource->url) && strncmp(resource->url, url, url_len) == 0)
+    {
+      break;
+    }
+  }
 
+  if (resource==NULL)
+#endif
   for (resource = (resource_t*)list_head(restful_services); resource; resource = resource->next)
   {
+    res_len = strlen(resource->url);
+
     /*if the web service handles that kind of requests and urls matches*/
-    if ((REST.get_url(request, &url)==strlen(resource->url) || (REST.get_url(request, &url)>strlen(resource->url) && (resource->flags & HAS_SUB_RESOURCES)))
-        && strncmp(resource->url, url, strlen(resource->url)) == 0)
+    if ((url_len==res_len || (url_len>res_len && (resource->flags & HAS_SUB_RESOURCES)))
+        && strncmp(resource->url, url, res_len) == 0)
     {
-      found = 1;
-      rest_resource_flags_t method = REST.get_method_type(request);
+      break;
+    }
+  }
 
-      PRINTF("method %u, resource->flags %u\n", (uint16_t)method, resource->flags);
+  if (resource)
+  {
+    found = 1;
+    rest_resource_flags_t method = REST.get_method_type(request);
 
-      if (resource->flags & method)
+    PRINTF("method %u, resource->flags %u\n", (uint16_t)method, resource->flags);
+
+    if (resource->flags & method)
+    {
+      allowed = 1;
+
+      /*call pre handler if it exists*/
+      if (!resource->pre_handler || resource->pre_handler(resource, request, response))
       {
-        allowed = 1;
+        /* call handler function*/
+        resource->handler(request, response, buffer, buffer_size, offset);
 
-        /*call pre handler if it exists*/
-        if (!resource->pre_handler || resource->pre_handler(resource, request, response))
+        /*call post handler if it exists*/
+        if (resource->post_handler)
         {
-          /* call handler function*/
-          resource->handler(request, response, buffer, buffer_size, offset);
-
-          /*call post handler if it exists*/
-          if (resource->post_handler)
-          {
-            resource->post_handler(resource, request, response);
-          }
+          resource->post_handler(resource, request, response);
         }
-      } else {
-        REST.set_response_status(response, REST.status.METHOD_NOT_ALLOWED);
       }
-      break;
+    } else {
+      REST.set_response_status(response, REST.status.METHOD_NOT_ALLOWED);
     }
   }
 
@@ -52,6 +52,16 @@
 #define REST_MAX_CHUNK_SIZE     128
 #endif
 
+/*
+ * Number of buckets of the table that finds resources by their URL. Without the table, every request compares its
+ * Uri-Path with all resources in turn. Sub-resources are always found by that scan.
+ */
+#ifdef REST_CONF_RESOURCE_BUCKETS
+#define REST_RESOURCE_BUCKETS REST_CONF_RESOURCE_BUCKETS
+#else
+#define REST_RESOURCE_BUCKETS 0
+#endif
+
 #ifndef MIN
 #define MIN(a, b) ((a) < (b)? (a) : (b))
 #endif /* MIN */
@@ -148,6 +158,9 @@ struct resource_s {
   restful_post_handler post_handler; /* to be called after handler, may perform finalizations (cleanup, etc) */
   void* user_data; /* pointer to user specific data */
   unsigned int benchmark; /* to benchmark resource handler, used for separate response */
+#if REST_RESOURCE_BUCKETS
+  struct resource_s *bucket_next; /* next resource in the same bucket of the URL table */
+#endif
 };
 typedef struct resource_s resource_t;
 
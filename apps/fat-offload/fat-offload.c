@@ -0,0 +1,304 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *      Bulk download of cfs-fat files over the UART
+ */
+
+#include "fat/cfs-fat.h"
+#include "fat-offload.h"
+#include "dev/rs232.h"
+#include "dev/serial-frame.h"
+#include "lib/crc16.h"
+
+/* UART used for requests and replies */
+#ifdef FAT_OFFLOAD_CONF_PORT
+#define FAT_OFFLOAD_PORT FAT_OFFLOAD_CONF_PORT
+#else
+#define FAT_OFFLOAD_PORT RS232_PORT_0
+#endif
+
+/* Data bytes per frame */
+#ifdef FAT_OFFLOAD_CONF_CHUNK
+#define FAT_OFFLOAD_CHUNK FAT_OFFLOAD_CONF_CHUNK
+#else
+#define FAT_OFFLOAD_CHUNK 256
+#endif
+
+/* The file is read in units of this many bytes, a multiple of the
+ * sector size lets cfs-fat use multi block reads */
+#ifdef FAT_OFFLOAD_CONF_READ_SIZE
+#define FAT_OFFLOAD_READ_SIZE FAT_OFFLOAD_CONF_READ_SIZE
+#else
+#define FAT_OFFLOAD_READ_SIZE 1024
+#endif
+
+/* Time without acknowledgement until unacknowledged data is sent again */
+#ifdef FAT_OFFLOAD_CONF_TIMEOUT
+#define FAT_OFFLOAD_TIMEOUT FAT_OFFLOAD_CONF_TIMEOUT
+#else
+#define FAT_OFFLOAD_TIMEOUT (CLOCK_SECOND / 2)
+#endif
+
+/* A transfer is given up after this many timeouts in a row */
+#ifdef FAT_OFFLOAD_CONF_RETRIES
+#define FAT_OFFLOAD_RETRIES FAT_OFFLOAD_CONF_RETRIES
+#else
+#define FAT_OFFLOAD_RETRIES 10
+#endif
+
+#if FAT_OFFLOAD_READ_SIZE % 512 || FAT_OFFLOAD_READ_SIZE < FAT_OFFLOAD_CHUNK
+#error FAT_OFFLOAD_CONF_READ_SIZE must be a multiple of 512 and at least FAT_OFFLOAD_CONF_CHUNK
+#endif
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+PROCESS(fat_offload_process, "FAT offload");
+
+static int fd = -1;
+/* Size of the file, acknowledged offset and offset of the next frame */
+static uint32_t size, base, sent;
+static uint8_t window, retries;
+static struct etimer timer;
+
+/* buf holds buf_len bytes of the file from buf_off on */
+static uint8_t buf[FAT_OFFLOAD_READ_SIZE];
+static uint32_t buf_off;
+static uint16_t buf_len;
+
+/*---------------------------------------------------------------------------*/
+static void
+put(uint8_t c, uint16_t *crc)
+{
+  *crc = crc16_add(c, *crc);
+  rs232_send(FAT_OFFLOAD_PORT, c);
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_frame(uint8_t type, uint32_t value, const uint8_t *data, uint16_t len)
+{
+  uint16_t crc = 0;
+  uint8_t i;
+
+  rs232_send(FAT_OFFLOAD_PORT, SERIAL_FRAME_SYNC);
+  put((len + 5) & 0xff, &crc);
+  put((len + 5) >> 8, &crc);
+  put(type, &crc);
+  for(i = 0; i < 4; i++) {
+    put(value & 0xff, &crc);
+    value >>= 8;
+  }
+  while(len--) {
+    put(*data++, &crc);
+  }
+  rs232_send(FAT_OFFLOAD_PORT, crc & 0xff);
+  rs232_send(FAT_OFFLOAD_PORT, crc >> 8);
+}
+/*---------------------------------------------------------------------------*/
+static void
+stop(void)
+{
+  if(fd >= 0) {
+    cfs_close(fd);
+    fd = -1;
+  }
+  etimer_stop(&timer);
+}
+/*---------------------------------------------------------------------------*/
+static void
+list(const char *name)
+{
+  struct cfs_dir dir;
+  struct cfs_dirent dirent;
+
+  if(cfs_opendir(&dir, name) == 0) {
+    while(cfs_readdir(&dir, &dirent) == 0) {
+      send_frame(FAT_OFFLOAD_ENTRY, dirent.size,
+                 (uint8_t *)dirent.name, strlen(dirent.name));
+    }
+    cfs_closedir(&dir);
+  }
+  send_frame(FAT_OFFLOAD_ENTRY, 0, NULL, 0);
+}
+/*---------------------------------------------------------------------------*/
+static void
+get(const char *name, uint32_t offset)
+{
+  uint8_t status = FAT_OFFLOAD_OK;
+
+  stop();
+  fd = cfs_open(name, CFS_READ);
+  if(fd < 0) {
+    status = FAT_OFFLOAD_NOT_FOUND;
+    size = 0;
+  } else {
+    size = cfs_seek(fd, 0, CFS_SEEK_END);
+    base = sent = offset < size ? offset : size;
+    buf_len = 0;
+    retries = 0;
+    etimer_set(&timer, FAT_OFFLOAD_TIMEOUT);
+  }
+  PRINTF("fat-offload: get %s from %lu, size %lu\n", name, offset, size);
+  send_frame(FAT_OFFLOAD_STATUS, size, &status, 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_data(void)
+{
+  uint16_t len;
+  int n;
+
+  if(sent < buf_off || sent >= buf_off + buf_len) {
+    /* Read whole sectors */
+    buf_off = sent & ~511UL;
+    cfs_seek(fd, buf_off, CFS_SEEK_SET);
+    n = cfs_read(fd, buf, sizeof(buf));
+    if(n <= 0) {
+      uint8_t status = FAT_OFFLOAD_READ_ERROR;
+
+      PRINTF("fat-offload: read error at %lu\n", buf_off);
+      send_frame(FAT_OFFLOAD_STATUS, size, &status, 1);
+      buf_len = 0;
+      stop();
+      return;
+    }
+    buf_len = n;
+  }
+
+  len = buf_off + buf_len - sent;
+  if(len > FAT_OFFLOAD_CHUNK) {
+    len = FAT_OFFLOAD_CHUNK;
+  }
+  send_frame(FAT_OFFLOAD_DATA, sent, &buf[sent - buf_off], len);
+  sent += len;
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_frame(struct serial_frame *frame)
+{
+  uint32_t value;
+
+  if(frame->len < 5) {
+    return;
+  }
+  value = frame->data[1] | (uint32_t)frame->data[2] << 8 |
+    (uint32_t)frame->data[3] << 16 | (uint32_t)frame->data[4] << 24;
+
+  /* The names are terminated in place, the frame buffer is ours until
+   * the event has been handled */
+  switch(frame->data[0]) {
+  case FAT_OFFLOAD_LIST:
+    memmove(frame->data, frame->data + 5, frame->len - 5);
+    frame->data[frame->len - 5] = '\0';
+    list((char *)frame->data);
+    break;
+  case FAT_OFFLOAD_GET:
+    if(frame->len < 6) {
+      return;
+    }
+    window = frame->data[5] ? frame->data[5] : 1;
+    memmove(frame->data, frame->data + 6, frame->len - 6);
+    frame->data[frame->len - 6] = '\0';
+    get((char *)frame->data, value);
+    break;
+  case FAT_OFFLOAD_ACK:
+    if(fd >= 0 && value > base && value <= sent) {
+      base = value;
+      retries = 0;
+      if(base == size) {
+        PRINTF("fat-offload: done\n");
+        stop();
+      } else {
+        etimer_restart(&timer);
+      }
+    }
+    break;
+  case FAT_OFFLOAD_NACK:
+    if(fd >= 0 && value >= base && value <= sent) {
+      base = sent = value;
+      etimer_restart(&timer);
+    }
+    break;
+  case FAT_OFFLOAD_ABORT:
+    stop();
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(fat_offload_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT();
+
+    if(ev == serial_frame_event_message) {
+      handle_frame((struct serial_frame *)data);
+    } else if(ev == PROCESS_EVENT_TIMER && data == &timer && fd >= 0) {
+      if(++retries > FAT_OFFLOAD_RETRIES) {
+        PRINTF("fat-offload: host is gone\n");
+        stop();
+        continue;
+      }
+      /* Go back to the last acknowledged offset */
+      sent = base;
+      etimer_restart(&timer);
+    }
+
+    /* Send one frame at a time and poll ourselves for the next one, so
+     * that acknowledgements and other processes get their turn */
+    if(fd >= 0 && sent < size &&
+       sent - base < (uint32_t)window * FAT_OFFLOAD_CHUNK) {
+      send_data();
+      process_poll(&fat_offload_process);
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+fat_offload_init(void)
+{
+#ifdef FAT_OFFLOAD_CONF_BAUD
+  rs232_init(FAT_OFFLOAD_PORT, FAT_OFFLOAD_CONF_BAUD,
+             USART_PARITY_NONE | USART_STOP_BITS_1 | USART_DATA_BITS_8);
+#endif
+  rs232_set_input(FAT_OFFLOAD_PORT, serial_frame_input_byte);
+  serial_frame_init();
+  process_start(&fat_offload_process, NULL);
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *      Bulk download of cfs-fat files over the UART
+ *
+ *      Requests from the host and replies of the node are frames in the
+ *      format of dev/serial-frame.h. The payload of every frame starts
+ *      with a type byte and a 32 bit value (little endian):
+ *
+ *      Host to node:
+ *      - FAT_OFFLOAD_LIST, unused, directory name: list the directory
+ *      - FAT_OFFLOAD_GET, start offset, window, file name: send a file
+ *      - FAT_OFFLOAD_ACK, offset: everything before offset was received
+ *      - FAT_OFFLOAD_NACK, offset: resend everything from offset on
+ *      - FAT_OFFLOAD_ABORT: stop the transfer
+ *
+ *      Node to host:
+ *      - FAT_OFFLOAD_ENTRY, size, name: one directory entry, an empty
+ *        name ends the list
+ *      - FAT_OFFLOAD_STATUS, size, status: reply to FAT_OFFLOAD_GET
+ *      - FAT_OFFLOAD_DATA, offset, data: part of the file
+ *
+ *      At most window data frames are unacknowledged. If no
+ *      acknowledgement arrives for FAT_OFFLOAD_CONF_TIMEOUT, the node
+ *      sends everything again from the last acknowledged offset on.
+ *      tools/inga/inga_offload is the matching host tool.
+ */
+
+#ifndef FAT_OFFLOAD_H_
+#define FAT_OFFLOAD_H_
+
+#include "contiki.h"
+
+#define FAT_OFFLOAD_LIST   'L'
+#define FAT_OFFLOAD_GET    'G'
+#define FAT_OFFLOAD_ACK    'A'
+#define FAT_OFFLOAD_NACK   'N'
+#define FAT_OFFLOAD_ABORT  'X'
+#define FAT_OFFLOAD_ENTRY  'l'
+#define FAT_OFFLOAD_STATUS 'g'
+#define FAT_OFFLOAD_DATA   'd'
+
+#define FAT_OFFLOAD_OK       0
+#define FAT_OFFLOAD_NOT_FOUND 1
+#define FAT_OFFLOAD_READ_ERROR 2
+
+/**
+ * \brief Start the offload service
+ *
+ *        The FAT volume must be mounted and selected as default device.
+ *        The service takes over the input of FAT_OFFLOAD_CONF_PORT and
+ *        switches it to FAT_OFFLOAD_CONF_BAUD if that is defined.
+ */
+void fat_offload_init(void);
+
+PROCESS_NAME(fat_offload_process);
+
+#endif /* FAT_OFFLOAD_H_ */
@@ -87,6 +87,14 @@ static const char http_header_404[] =
   "HTTP/1.0 404 Not found\r\nServer: Contiki\r\nConnection: close\r\n";
 static const char http_header_200[] =
   "HTTP/1.0 200 OK\r\nServer: Contiki\r\nConnection: close\r\n";
+#if HTTPD_WS_KEEPALIVE
+static const char http_11[] = "HTTP/1.1";
+static const char http_connection[] = "Connection:";
+static const char http_header_404_keepalive[] =
+  "HTTP/1.1 404 Not found\r\nServer: Contiki\r\nConnection: keep-alive\r\n";
+static const char http_header_200_keepalive[] =
+  "HTTP/1.1 200 OK\r\nServer: Contiki\r\nConnection: keep-alive\r\n";
+#endif /* HTTPD_WS_KEEPALIVE */
 static const char html_not_found[] =
   "<html><body><h1>Page not found</h1></body></html>";
 /*---------------------------------------------------------------------------*/
@@ -134,39 +142,110 @@ PT_THREAD(send_headers(struct httpd_ws_state *s, const char *statushdr))
 
   SEND_STRING(&s->sout, statushdr, strlen(statushdr));
   s->outbuf_pos = snprintf(s->outbuf, sizeof(s->outbuf),
-                           "%s %s\r\n\r\n", http_content_type,
+                           "%s %s\r\n", http_content_type,
                            s->content_type == NULL
                            ? http_content_type_html : s->content_type);
+#if HTTPD_WS_KEEPALIVE
+  if(s->keepalive) {
+    s->outbuf_pos += snprintf(&s->outbuf[s->outbuf_pos],
+                              sizeof(s->outbuf) - s->outbuf_pos,
+                              "%s %u\r\n", http_content_len,
+                              s->response_len);
+  }
+#endif /* HTTPD_WS_KEEPALIVE */
+  s->outbuf[s->outbuf_pos++] = '\r';
+  s->outbuf[s->outbuf_pos++] = '\n';
   SEND_STRING(&s->sout, s->outbuf, s->outbuf_pos);
   s->outbuf_pos = 0;
 
   PSOCK_END(&s->sout);
 }
 /*---------------------------------------------------------------------------*/
+#if HTTPD_WS_KEEPALIVE
+/* Wait for the next request on a connection that stays open */
+static void
+keep_open(struct httpd_ws_state *s)
+{
+  s->state = HTTPD_WS_STATE_INPUT;
+  PSOCK_INIT(&s->sin, (uint8_t *)s->inputbuf, sizeof(s->inputbuf) - 1);
+  timer_set(&s->timer, CLOCK_SECOND * HTTPD_WS_KEEPALIVE);
+  /* Accept the next request, which we held back during the response */
+  uip_restart();
+}
+/*---------------------------------------------------------------------------*/
+/* Case-insensitive search of a lower case token in a header value */
+static int
+header_has_token(const char *value, const char *token)
+{
+  const char *v, *t;
+
+  for(; *value != '\0'; value++) {
+    for(v = value, t = token;
+        *t != '\0' && (*v | 0x20) == *t; v++, t++);
+    if(*t == '\0') {
+      return 1;
+    }
+  }
+  return 0;
+}
+#endif /* HTTPD_WS_KEEPALIVE */
+/*---------------------------------------------------------------------------*/
 static
 PT_THREAD(handle_output(struct httpd_ws_state *s))
 {
   PT_BEGIN(&s->outputpt);
 
   s->content_type = http_content_type_html;
+  s->response_len = 0;
   s->script = httpd_ws_get_script(s);
   if(s->script == NULL) {
+#if HTTPD_WS_KEEPALIVE
+    if(s->keepalive) {
+      s->response_len = sizeof(html_not_found) - 1;
+      PT_WAIT_THREAD(&s->outputpt,
+                     send_headers(s, http_header_404_keepalive));
+    } else
+#endif /* HTTPD_WS_KEEPALIVE */
     PT_WAIT_THREAD(&s->outputpt, send_headers(s, http_header_404));
     PT_WAIT_THREAD(&s->outputpt,
                    send_string(s, html_not_found, strlen(html_not_found)));
+#if HTTPD_WS_KEEPALIVE
+    if(s->keepalive) {
+      keep_open(s);
+      PT_EXIT(&s->outputpt);
+    }
+#endif /* HTTPD_WS_KEEPALIVE */
     uip_close();
 /*     webserver_log_file(&uip_conn->ripaddr, "404 - not found"); */
     PT_EXIT(&s->outputpt);
   } else {
+#if HTTPD_WS_KEEPALIVE
+    /* The body of a post has been read before the output started */
+    if(s->response_len == 0) {
+      /* Without a length only closing the connection ends the response */
+      s->keepalive = 0;
+    }
+    if(s->keepalive) {
+      PT_WAIT_THREAD(&s->outputpt,
+                     send_headers(s, http_header_200_keepalive));
+    } else
+#else /* HTTPD_WS_KEEPALIVE */
     if(s->request_type == HTTPD_WS_POST) {
       /* A post has a body that needs to be read */
       s->state = HTTPD_WS_STATE_INPUT;
       PT_WAIT_UNTIL(&s->outputpt, s->state == HTTPD_WS_STATE_OUTPUT);
     }
+#endif /* HTTPD_WS_KEEPALIVE */
     PT_WAIT_THREAD(&s->outputpt, send_headers(s, http_header_200));
     PT_WAIT_THREAD(&s->outputpt, s->script(s));
   }
   s->script = NULL;
+#if HTTPD_WS_KEEPALIVE
+  if(s->keepalive) {
+    keep_open(s);
+    PT_EXIT(&s->outputpt);
+  }
+#endif /* HTTPD_WS_KEEPALIVE */
   PSOCK_CLOSE(&s->sout);
   PT_END(&s->outputpt);
 }
@@ -227,6 +306,10 @@ static
 PT_THREAD(handle_input(struct httpd_ws_state *s))
 {
   PSOCK_BEGIN(&s->sin);
+#if HTTPD_WS_KEEPALIVE
+  /* Start reading the next request once the response is sent */
+  PSOCK_WAIT_UNTIL(&s->sin, s->state != HTTPD_WS_STATE_OUTPUT);
+#endif /* HTTPD_WS_KEEPALIVE */
   PSOCK_READTO(&s->sin, ISO_space);
 
   if(strncmp(s->inputbuf, "GET ", 4) == 0) {
@@ -256,7 +339,10 @@ PT_THREAD(handle_input(struct httpd_ws_state *s))
 #endif /* URLCONV */
 
 /*   webserver_log_file(&uip_conn->ripaddr, s->filename); */
+  s->keepalive = 0;
+#if !HTTPD_WS_KEEPALIVE
   s->state = HTTPD_WS_STATE_OUTPUT;
+#endif /* !HTTPD_WS_KEEPALIVE */
 
   while(1) {
     PSOCK_READTO(&s->sin, ISO_nl);
@@ -271,13 +357,44 @@ PT_THREAD(handle_input(struct httpd_ws_state *s))
 
     if(PSOCK_DATALEN(&s->sin) > 2) {
       s->inputbuf[PSOCK_DATALEN(&s->sin) - 2] = 0;
-    } else if(s->request_type == HTTPD_WS_POST) {
-      PSOCK_READBUF_LEN(&s->sin, s->content_len);
-      s->inputbuf[PSOCK_DATALEN(&s->sin)] = 0;
-      /* printf("Content: '%s'\nSize:%d\n", s->inputbuf, PSOCK_DATALEN(&s->sin)); */
-      s->state = HTTPD_WS_STATE_OUTPUT;
+#if HTTPD_WS_KEEPALIVE
+      /* The rest of the request line, then the headers */
+      if(strncmp(s->inputbuf, http_11, 8) == 0) {
+        s->keepalive = 1;
+      } else if(strncmp(s->inputbuf, http_connection, 11) == 0) {
+        if(header_has_token(&s->inputbuf[11], "close")) {
+          s->keepalive = 0;
+        } else if(header_has_token(&s->inputbuf[11], "keep-alive")) {
+          s->keepalive = 1;
+        }
+      }
+#endif /* HTTPD_WS_KEEPALIVE */
+    } else {
+      if(s->request_type == HTTPD_WS_POST) {
+        PSOCK_READBUF_LEN(&s->sin, s->content_len);
+        s->inputbuf[PSOCK_DATALEN(&s->sin)] = 0;
+        /* printf("Content: '%s'\nSize:%d\n", s->inputbuf, PSOCK_DATALEN(&s->sin)); */
+        s->state = HTTPD_WS_STATE_OUTPUT;
+      }
+#if HTTPD_WS_KEEPALIVE
+      break;
+#endif /* HTTPD_WS_KEEPALIVE */
     }
   }
+
+#if HTTPD_WS_KEEPALIVE
+  /* The response is written over uip_appdata, so a pipelined request
+     in the same segment is lost and the client has to send it on a new
+     connection. Requests in later segments are held back until the
+     response is complete. */
+  if(s->sin.readlen > 0) {
+    s->keepalive = 0;
+  }
+  if(s->keepalive) {
+    uip_stop();
+  }
+  s->state = HTTPD_WS_STATE_OUTPUT;
+#endif /* HTTPD_WS_KEEPALIVE */
   PSOCK_END(&s->sin);
 }
 /*---------------------------------------------------------------------------*/
@@ -320,6 +437,7 @@ httpd_ws_appcall(void *state)
 
       tcp_markconn(uip_conn, s);
       s->state = HTTPD_WS_STATE_INPUT;
+      s->keepalive = 0;
     } else {
       /* this is a request that is to be sent! */
       s->state = HTTPD_WS_STATE_REQUEST_OUTPUT;
@@ -65,6 +65,14 @@
 #define  HTTPD_OUTBUF_SIZE WEBSERVER_CONF_OUTBUF_SIZE
 #endif /* WEBSERVER_CONF_OUTBUF_SIZE */
 
+/* Seconds an idle persistent connection is kept open, 0 closes the
+   connection after every response */
+#ifndef WEBSERVER_CONF_KEEPALIVE
+#define HTTPD_WS_KEEPALIVE 0
+#else /* WEBSERVER_CONF_KEEPALIVE */
+#define HTTPD_WS_KEEPALIVE WEBSERVER_CONF_KEEPALIVE
+#endif /* WEBSERVER_CONF_KEEPALIVE */
+
 struct httpd_ws_state;
 typedef char (* httpd_ws_script_t)(struct httpd_ws_state *s);
 typedef int (* httpd_ws_output_headers_t)(struct httpd_ws_state *s,
@@ -90,10 +98,14 @@ struct httpd_ws_state {
   char filename[HTTPD_PATHLEN];
   const char *content_type;
   uint16_t content_len;
+  /* Set by httpd_ws_get_script() when the length of the response is
+     known, so that the connection can be kept open after it */
+  uint16_t response_len;
   char outbuf[HTTPD_OUTBUF_SIZE];
   uint16_t outbuf_pos;
   char state;
   char request_type;
+  char keepalive;
   int response_index;
 
   httpd_ws_output_headers_t output_extra_headers;
@@ -55,6 +55,7 @@
 #define JSON_TYPE_FALSE 'f'
 
 #define JSON_TYPE_CALLBACK 'C'
+#define JSON_TYPE_INT_ARRAY 'A'
 
 enum {
   JSON_ERROR_OK,
@@ -50,15 +50,34 @@
 #define PRINTF(...)
 #endif
 
+/*---------------------------------------------------------------------------*/
+static void
+put(const struct jsontree_context *js_ctx, int c)
+{
+  /* Only const for the callbacks, the context itself is not */
+  struct jsontree_context *ctx = (struct jsontree_context *)js_ctx;
+
+  if(ctx->buf == NULL) {
+    ctx->putchar(c);
+  } else if(ctx->skip > 0) {
+    ctx->skip--;
+  } else {
+    /* Counts on past the end, so that the overflow can be seen */
+    if(ctx->buf_pos < ctx->buf_size) {
+      ctx->buf[ctx->buf_pos] = c;
+    }
+    ctx->buf_pos++;
+  }
+}
 /*---------------------------------------------------------------------------*/
 void
 jsontree_write_atom(const struct jsontree_context *js_ctx, const char *text)
 {
   if(text == NULL) {
-    js_ctx->putchar('0');
+    put(js_ctx, '0');
   } else {
     while(*text != '\0') {
-      js_ctx->putchar(*text++);
+      put(js_ctx, *text++);
     }
   }
 }
@@ -66,16 +85,16 @@ jsontree_write_atom(const struct jsontree_context *js_ctx, const char *text)
 void
 jsontree_write_string(const struct jsontree_context *js_ctx, const char *text)
 {
-  js_ctx->putchar('"');
+  put(js_ctx, '"');
   if(text != NULL) {
     while(*text != '\0') {
       if(*text == '"') {
-        js_ctx->putchar('\\');
+        put(js_ctx, '\\');
       }
-      js_ctx->putchar(*text++);
+      put(js_ctx, *text++);
     }
   }
-  js_ctx->putchar('"');
+  put(js_ctx, '"');
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -85,7 +104,7 @@ jsontree_write_int(const struct jsontree_context *js_ctx, int value)
   int l;
 
   if(value < 0) {
-    js_ctx->putchar('-');
+    put(js_ctx, '-');
     value = -value;
   }
 
@@ -96,7 +115,7 @@ jsontree_write_int(const struct jsontree_context *js_ctx, int value)
   } while(value > 0 && l >= 0);
 
   while(++l < sizeof(buf)) {
-    js_ctx->putchar(buf[l]);
+    put(js_ctx, buf[l]);
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -115,6 +134,9 @@ jsontree_reset(struct jsontree_context *js_ctx)
 {
   js_ctx->depth = 0;
   js_ctx->index[0] = 0;
+  js_ctx->buf = NULL;
+  js_ctx->skip = 0;
+  js_ctx->done = 0;
 }
 /*---------------------------------------------------------------------------*/
 const char *
@@ -144,24 +166,24 @@ jsontree_print_next(struct jsontree_context *js_ctx)
 
     index = js_ctx->index[js_ctx->depth];
     if(index == 0) {
-      js_ctx->putchar(v->type);
-      js_ctx->putchar('\n');
+      put(js_ctx, v->type);
+      put(js_ctx, '\n');
     }
     if(index >= o->count) {
-      js_ctx->putchar('\n');
-      js_ctx->putchar(v->type + 2);
+      put(js_ctx, '\n');
+      put(js_ctx, v->type + 2);
       /* Default operation: back up one level! */
       break;
     }
 
     if(index > 0) {
-      js_ctx->putchar(',');
-      js_ctx->putchar('\n');
+      put(js_ctx, ',');
+      put(js_ctx, '\n');
     }
     if(v->type == JSON_TYPE_OBJECT) {
       jsontree_write_string(js_ctx,
                             ((struct jsontree_object *)o)->pairs[index].name);
-      js_ctx->putchar(':');
+      put(js_ctx, ':');
       ov = ((struct jsontree_object *)o)->pairs[index].value;
     } else {
       ov = o->values[index];
@@ -181,6 +203,25 @@ jsontree_print_next(struct jsontree_context *js_ctx)
     jsontree_write_int(js_ctx, ((struct jsontree_int *)v)->value);
     /* Default operation: back up one level! */
     break;
+  case JSON_TYPE_INT_ARRAY: {
+    struct jsontree_int_array *a = (struct jsontree_int_array *)v;
+
+    index = js_ctx->index[js_ctx->depth];
+    if(index == 0) {
+      put(js_ctx, '[');
+    }
+    if(index >= a->count) {
+      put(js_ctx, ']');
+      /* Default operation: back up one level! */
+      break;
+    }
+    if(index > 0) {
+      put(js_ctx, ',');
+    }
+    jsontree_write_int(js_ctx, a->values[index]);
+    js_ctx->index[js_ctx->depth]++;
+    return 1;
+  }
   case JSON_TYPE_CALLBACK: {   /* pre-formatted json string currently */
     struct jsontree_callback *callback;
 
@@ -212,6 +253,63 @@ jsontree_print_next(struct jsontree_context *js_ctx)
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+int
+jsontree_print_buf(struct jsontree_context *js_ctx, char *buf, int size)
+{
+  uint8_t depth;
+  uint16_t index, parent_index;
+  uint16_t pos, skip;
+  int callback_state;
+  int more;
+
+  if(js_ctx->done) {
+    return 0;
+  }
+
+  js_ctx->buf = buf;
+  js_ctx->buf_size = size;
+  js_ctx->buf_pos = 0;
+
+  while(js_ctx->buf_pos < js_ctx->buf_size) {
+    /* All that a step changes, in case it has to be done again */
+    depth = js_ctx->depth;
+    index = js_ctx->index[depth];
+    parent_index = depth > 0 ? js_ctx->index[depth - 1] : 0;
+    callback_state = js_ctx->callback_state;
+    pos = js_ctx->buf_pos;
+    skip = js_ctx->skip;
+
+    more = jsontree_print_next(js_ctx);
+
+    if(js_ctx->buf_pos > js_ctx->buf_size) {
+      /* The step did not fit. Next time, do it again and skip what it
+         has written now. */
+      js_ctx->depth = depth;
+      js_ctx->index[depth] = index;
+      if(depth > 0) {
+        js_ctx->index[depth - 1] = parent_index;
+      }
+      js_ctx->callback_state = callback_state;
+      js_ctx->skip = skip + (js_ctx->buf_size - pos);
+      js_ctx->buf_pos = js_ctx->buf_size;
+      break;
+    }
+    if(!more || js_ctx->path > js_ctx->depth) {
+      js_ctx->done = 1;
+      break;
+    }
+  }
+
+  js_ctx->buf = NULL;
+  return js_ctx->buf_pos;
+}
+/*---------------------------------------------------------------------------*/
+void
+jsontree_skip(struct jsontree_context *js_ctx, uint16_t len)
+{
+  js_ctx->skip += len;
+}
+/*---------------------------------------------------------------------------*/
 static struct jsontree_value *
 find_next(struct jsontree_context *js_ctx)
 {
@@ -56,6 +56,12 @@ struct jsontree_context {
   uint8_t depth;
   uint8_t path;
   int callback_state;
+  /* Output buffer of jsontree_print_buf(), putchar is used without */
+  char *buf;
+  uint16_t buf_size, buf_pos;
+  /* Bytes not to write again, of the step that did not fit last time */
+  uint16_t skip;
+  uint8_t done;
 };
 
 struct jsontree_value {
@@ -92,6 +98,13 @@ struct jsontree_object {
   struct jsontree_pair *pairs;
 };
 
+/* Printed like an array of JSON_TYPE_INT, without a value per element */
+struct jsontree_int_array {
+  uint8_t type;
+  uint16_t count;
+  int *values;
+};
+
 struct jsontree_array {
   uint8_t type;
   uint8_t count;
@@ -101,6 +114,8 @@ struct jsontree_array {
 #define JSONTREE_STRING(text) {JSON_TYPE_STRING, (text)}
 #define JSONTREE_PAIR(name, value) {(name), (struct jsontree_value *)(value)}
 #define JSONTREE_CALLBACK(output, set) {JSON_TYPE_CALLBACK, (output), (set)}
+#define JSONTREE_INT_ARRAY(values)                                      \
+  {JSON_TYPE_INT_ARRAY, sizeof(values)/sizeof(int), (values)}
 
 #define JSONTREE_OBJECT(name, ...)                                      \
   static struct jsontree_pair jsontree_pair_##name[] = {__VA_ARGS__};   \
@@ -129,6 +144,23 @@ void jsontree_write_atom(const struct jsontree_context *js_ctx,
 void jsontree_write_string(const struct jsontree_context *js_ctx,
                            const char *text);
 int jsontree_print_next(struct jsontree_context *js_ctx);
+
+/**
+ * Writes the next part of the tree into buf, without calling putchar.
+ * Every call continues where the last one stopped, up to the end of the
+ * tree, or of the subtree at path.
+ *
+ * For a CoAP block, set up the context and call jsontree_skip() with
+ * the block offset first. Callbacks must print the same text again
+ * during a skip.
+ *
+ * \return The number of bytes written, less than size at the end
+ */
+int jsontree_print_buf(struct jsontree_context *js_ctx, char *buf, int size);
+
+/* Makes the next jsontree_print_buf() start len bytes further */
+void jsontree_skip(struct jsontree_context *js_ctx, uint16_t len);
+
 struct jsontree_value *jsontree_find_next(struct jsontree_context *js_ctx,
                                           int type);
 
@@ -30,11 +30,13 @@
 #include "contiki.h"
 #include "contiki-lib.h"
 #include "contiki-net.h"
+#include "net/uiplib.h"
 
 #include "mac.h"
 
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #define MACDEBUG 0
 
@@ -49,125 +51,318 @@
 #define PRINT6ADDR(addr)
 #endif
 
+/* Defaults for -c, -s, -i */
 #define PING6_NB 5
 #define PING6_DATALEN 16
+#define PING6_INTERVAL (3 * CLOCK_SECOND)
+/* Step of a payload sweep (-S max[,step]) without an explicit step */
+#define PING6_SWEEP_STEP 16
+/* Time to wait for a reply in flood mode, and for the last replies of a run */
+#define PING6_TIMEOUT (2 * CLOCK_SECOND)
+/* Number of outstanding requests whose send time is remembered */
+#define PING6_WINDOW 8
+
+#define PING6_MAXLEN (UIP_BUFSIZE - UIP_LLH_LEN - UIP_IPH_LEN - \
+                      UIP_ICMPH_LEN - UIP_ICMP6_ECHO_REQUEST_LEN)
+
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
 
 #define UIP_IP_BUF                ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
 #define UIP_ICMP_BUF            ((struct uip_icmp_hdr *)&uip_buf[uip_l2_l3_hdr_len])
+#define UIP_ECHO_BUF            ((uint8_t *)UIP_ICMP_BUF + UIP_ICMPH_LEN)
 
 static struct etimer ping6_periodic_timer;
-static uint8_t count = 0;
-static char command[20];
-static uint16_t addr[8];
+static char command[80];
 uip_ipaddr_t dest_addr;
 
+/* Options of the current run */
+static uint16_t count;
+static clock_time_t interval;
+static uint16_t datalen, datalen_max, datalen_step;
+static uint8_t flood;
+
+/* Progress of the current payload size */
+static uint16_t ident, seq, datalen_cur;
+static clock_time_t sent_at[PING6_WINDOW];
+
+static struct {
+  uint16_t sent, received;
+  clock_time_t min, max, last;
+  unsigned long sum, jitter_sum;
+  uint8_t hlim;
+} stats;
+
 PROCESS(ping6_process, "PING6 process");
 AUTOSTART_PROCESSES(&ping6_process);
 
+/*---------------------------------------------------------------------------*/
+static unsigned long
+ticks_to_ms(unsigned long ticks)
+{
+  return (ticks * 1000 + CLOCK_SECOND / 2) / CLOCK_SECOND;
+}
+/*---------------------------------------------------------------------------*/
+static void
+print_addr(const uip_ipaddr_t *addr)
+{
+  uint8_t i;
 
+  for(i = 0; i < 16; i += 2) {
+    printf(i ? ":%x" : "%x", (addr->u8[i] << 8) | addr->u8[i + 1]);
+  }
+}
 /*---------------------------------------------------------------------------*/
+/*
+ * ping6 [-c count] [-i interval_ms] [-s size] [-S max[,step]] [-f] addr
+ */
 static uint8_t
-ping6handler(process_event_t ev, process_data_t data)
+parse_command(void)
 {
-  if(count == 0){
-#if MACDEBUG
-    // Setup destination address.
-    addr[0] = 0xFE80;
-    addr[4] = 0x6466;
-    addr[5] = 0x6666;
-    addr[6] = 0x6666;
-    addr[7] = 0x6666;
-    uip_ip6addr(&dest_addr, addr[0], addr[1],addr[2],
-                addr[3],addr[4],addr[5],addr[6],addr[7]);
-
-    // Set the command to fool the 'if' below.
-    memcpy(command, (void *)"ping6", 5);
+  char *arg, *value;
+
+  count = PING6_NB;
+  interval = PING6_INTERVAL;
+  datalen = PING6_DATALEN;
+  datalen_max = 0;
+  datalen_step = PING6_SWEEP_STEP;
+  flood = 0;
+
+  arg = strtok(command, " \t\r\n");
+  if(arg == NULL || strcmp(arg, "ping6") != 0) {
+    printf("> invalid command\n");
+    return 0;
+  }
 
-#else
-/* prompt */
-    printf("> ");
-    /** \note the scanf here is blocking (the all stack is blocked waiting
-     *  for user input). This is far from ideal and could be improved
-     */
-    scanf("%s", command);
-
-    if(strcmp(command,"ping6") != 0){
-      PRINTF("> invalid command\n");
-      return 0;
+  while((arg = strtok(NULL, " \t\r\n")) != NULL) {
+    if(arg[0] != '-') {
+      if(!uiplib_ipaddrconv(arg, &dest_addr)) {
+        printf("> invalid ipv6 address format\n");
+        return 0;
+      }
+      datalen_max = MAX(datalen_max, datalen);
+      if(datalen_max > PING6_MAXLEN) {
+        printf("> payload larger than %u bytes\n", PING6_MAXLEN);
+        return 0;
+      }
+      return count > 0;
     }
-
-    if(scanf(" %04x:%04x:%04x:%04x:%04x:%04x:%04x:%04x",
-             &addr[0],&addr[1],&addr[2],&addr[3],
-             &addr[4],&addr[5],&addr[6],&addr[7]) == 8){
-
-      uip_ip6addr(&dest_addr, addr[0], addr[1],addr[2],
-                  addr[3],addr[4],addr[5],addr[6],addr[7]);
-    } else {
-      PRINTF("> invalid ipv6 address format\n");
+    if(arg[1] == 'f') {
+      flood = 1;
+      continue;
+    }
+    if((value = strtok(NULL, " \t\r\n")) == NULL) {
+      break;
+    }
+    switch(arg[1]) {
+    case 'c':
+      count = atoi(value);
+      break;
+    case 'i':
+      interval = (clock_time_t)(atol(value) * CLOCK_SECOND / 1000);
+      break;
+    case 's':
+      datalen = atoi(value);
+      break;
+    case 'S':
+      datalen_max = atoi(value);
+      if((value = strchr(value, ',')) != NULL && atoi(value + 1) > 0) {
+        datalen_step = atoi(value + 1);
+      }
+      break;
+    default:
+      printf("> unknown option %s\n", arg);
       return 0;
     }
-#endif
-
   }
+  printf("> usage: ping6 [-c count] [-i ms] [-s size] [-S max[,step]] [-f] addr\n");
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_request(void)
+{
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->tcflow = 1;
+  UIP_IP_BUF->flow = 0;
+  UIP_IP_BUF->proto = UIP_PROTO_ICMP6;
+  UIP_IP_BUF->ttl = uip_ds6_if.cur_hop_limit;
+  uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, &dest_addr);
+  uip_ds6_select_src(&UIP_IP_BUF->srcipaddr, &UIP_IP_BUF->destipaddr);
+
+  UIP_ICMP_BUF->type = ICMP6_ECHO_REQUEST;
+  UIP_ICMP_BUF->icode = 0;
+  UIP_ECHO_BUF[0] = ident >> 8;
+  UIP_ECHO_BUF[1] = ident & 0xff;
+  UIP_ECHO_BUF[2] = seq >> 8;
+  UIP_ECHO_BUF[3] = seq & 0xff;
+  memset(UIP_ECHO_BUF + UIP_ICMP6_ECHO_REQUEST_LEN, seq, datalen_cur);
+
+  uip_len = UIP_ICMPH_LEN + UIP_ICMP6_ECHO_REQUEST_LEN + UIP_IPH_LEN + datalen_cur;
+  UIP_IP_BUF->len[0] = (uint8_t)((uip_len - 40) >> 8);
+  UIP_IP_BUF->len[1] = (uint8_t)((uip_len - 40) & 0x00FF);
+
+  UIP_ICMP_BUF->icmpchksum = 0;
+  UIP_ICMP_BUF->icmpchksum = ~uip_icmp6chksum();
+
+
+  PRINTF("Sending Echo Request to");
+  PRINT6ADDR(&UIP_IP_BUF->destipaddr);
+  PRINTF("from");
+  PRINT6ADDR(&UIP_IP_BUF->srcipaddr);
+  PRINTF("\n");
+  UIP_STAT(++uip_stat.icmp.sent);
+
+  sent_at[seq % PING6_WINDOW] = clock_time();
+  tcpip_ipv6_output();
+
+  seq++;
+  stats.sent++;
+  if(flood) {
+    putchar('.');
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Called for every incoming ICMPv6 message, returns 1 for our replies. */
+static uint8_t
+handle_reply(void)
+{
+  uint16_t reply_seq;
+  clock_time_t rtt;
 
-  if((strcmp(command,"ping6") == 0) && (count < PING6_NB)){
-
-    UIP_IP_BUF->vtc = 0x60;
-    UIP_IP_BUF->tcflow = 1;
-    UIP_IP_BUF->flow = 0;
-    UIP_IP_BUF->proto = UIP_PROTO_ICMP6;
-    UIP_IP_BUF->ttl = uip_ds6_if.cur_hop_limit;
-    uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, &dest_addr);
-    uip_ds6_select_src(&UIP_IP_BUF->srcipaddr, &UIP_IP_BUF->destipaddr);
-
-    UIP_ICMP_BUF->type = ICMP6_ECHO_REQUEST;
-    UIP_ICMP_BUF->icode = 0;
-    /* set identifier and sequence number to 0 */
-    memset((uint8_t *)UIP_ICMP_BUF + UIP_ICMPH_LEN, 0, 4);
-    /* put one byte of data */
-    memset((uint8_t *)UIP_ICMP_BUF + UIP_ICMPH_LEN + UIP_ICMP6_ECHO_REQUEST_LEN,
-           count, PING6_DATALEN);
-
-
-    uip_len = UIP_ICMPH_LEN + UIP_ICMP6_ECHO_REQUEST_LEN + UIP_IPH_LEN + PING6_DATALEN;
-    UIP_IP_BUF->len[0] = (uint8_t)((uip_len - 40) >> 8);
-    UIP_IP_BUF->len[1] = (uint8_t)((uip_len - 40) & 0x00FF);
-
-    UIP_ICMP_BUF->icmpchksum = 0;
-    UIP_ICMP_BUF->icmpchksum = ~uip_icmp6chksum();
-
-
-    PRINTF("Sending Echo Request to");
-    PRINT6ADDR(&UIP_IP_BUF->destipaddr);
-    PRINTF("from");
-    PRINT6ADDR(&UIP_IP_BUF->srcipaddr);
-    PRINTF("\n");
-    UIP_STAT(++uip_stat.icmp.sent);
+  if(UIP_ICMP_BUF->type != ICMP6_ECHO_REPLY ||
+     ((UIP_ECHO_BUF[0] << 8) | UIP_ECHO_BUF[1]) != ident) {
+    return 0;
+  }
+  reply_seq = (UIP_ECHO_BUF[2] << 8) | UIP_ECHO_BUF[3];
+  /* Too old to know its send time, or a duplicate */
+  if((uint16_t)(seq - reply_seq - 1) >= PING6_WINDOW ||
+     sent_at[reply_seq % PING6_WINDOW] == 0) {
+    return 0;
+  }
 
-    tcpip_ipv6_output();
+  rtt = clock_time() - sent_at[reply_seq % PING6_WINDOW];
+  sent_at[reply_seq % PING6_WINDOW] = 0;
 
-    count++;
-    etimer_set(&ping6_periodic_timer, 3 * CLOCK_SECOND);
-    return 1;
+  if(stats.received == 0) {
+    stats.min = stats.max = rtt;
+  } else {
+    stats.min = MIN(stats.min, rtt);
+    stats.max = MAX(stats.max, rtt);
+    stats.jitter_sum += rtt > stats.last ? rtt - stats.last : stats.last - rtt;
   }
-  return 0;
+  stats.last = rtt;
+  stats.sum += rtt;
+  stats.received++;
+  stats.hlim = UIP_IP_BUF->ttl;
+
+  if(flood) {
+    putchar('\b');
+  } else {
+    printf("%u bytes from ", datalen_cur);
+    print_addr(&UIP_IP_BUF->srcipaddr);
+    printf(": seq=%u hlim=%u time=%lu ms\n", reply_seq, UIP_IP_BUF->ttl,
+           ticks_to_ms(rtt));
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+print_stats(void)
+{
+  printf("--- %u bytes: %u sent, %u received, %u%% loss", datalen_cur,
+         stats.sent, stats.received,
+         stats.sent ? (unsigned)((stats.sent - stats.received) * 100UL / stats.sent) : 0);
+  if(stats.received > 0) {
+    /* jitter is the mean difference of consecutive round trip times */
+    printf(", hlim %u, rtt min/avg/max/jitter = %lu/%lu/%lu/%lu ms",
+           stats.hlim, ticks_to_ms(stats.min),
+           ticks_to_ms(stats.sum / stats.received), ticks_to_ms(stats.max),
+           stats.received > 1 ? ticks_to_ms(stats.jitter_sum / (stats.received - 1)) : 0);
+  }
+  printf("\n");
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+read_command(void)
+{
+#if MACDEBUG
+  // Setup destination address.
+  uip_ip6addr(&dest_addr, 0xFE80, 0, 0, 0, 0x6466, 0x6666, 0x6666, 0x6666);
+  count = PING6_NB;
+  interval = PING6_INTERVAL;
+  datalen = datalen_max = PING6_DATALEN;
+  datalen_step = PING6_SWEEP_STEP;
+  flood = 0;
+  return 1;
+#else
+/* prompt */
+  printf("> ");
+  /** \note reading here is blocking (the all stack is blocked waiting
+   *  for user input). This is far from ideal and could be improved
+   */
+  if(fgets(command, sizeof(command), stdin) == NULL) {
+    return 0;
+  }
+  return parse_command();
+#endif
 }
-
 /*---------------------------------------------------------------------------*/
 PROCESS_THREAD(ping6_process, ev, data)
 {
-
-  uint8_t cont = 1;
-
   PROCESS_BEGIN();
   PRINTF("In Process PING6\n");
   PRINTF("Wait for DAD\n");
 
+  icmp6_new(NULL);
+
   etimer_set(&ping6_periodic_timer, 15*CLOCK_SECOND);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&ping6_periodic_timer));
+
+  while(1) {
+    if(!read_command()) {
+      continue;
+    }
 
-  while(cont) {
-    PROCESS_YIELD();
-    cont = ping6handler(ev, data);
+    for(datalen_cur = datalen; datalen_cur <= datalen_max;
+        datalen_cur += datalen_step) {
+      memset(&stats, 0, sizeof(stats));
+      memset(sent_at, 0, sizeof(sent_at));
+      ident = random_rand();
+      seq = 0;
+
+      while(seq < count) {
+        send_request();
+        etimer_set(&ping6_periodic_timer,
+                   flood && interval == 0 ? PING6_TIMEOUT : interval);
+        /* A flood sends the next request as soon as the reply is in. */
+        do {
+          PROCESS_YIELD();
+        } while(!etimer_expired(&ping6_periodic_timer) &&
+                !(ev == tcpip_icmp6_event && handle_reply() && flood));
+      }
+
+      /* Collect the replies that are still on their way. */
+      etimer_set(&ping6_periodic_timer, PING6_TIMEOUT);
+      while(stats.received < stats.sent &&
+            !etimer_expired(&ping6_periodic_timer)) {
+        PROCESS_YIELD();
+        if(ev == tcpip_icmp6_event) {
+          handle_reply();
+        }
+      }
+      if(flood) {
+        printf("\n");
+      }
+      print_stats();
+    }
+#if MACDEBUG
+    break;
+#endif
   }
 
   PRINTF("END PING6\n");
@@ -42,6 +42,10 @@
 #include "sys/compower.h"
 #include "powertrace.h"
 #include "net/rime.h"
+#include "lib/crc16.h"
+#if UIP_CONF_IPV6
+#include "net/simple-udp.h"
+#endif /* UIP_CONF_IPV6 */
 
 #include <stdio.h>
 #include <string.h>
@@ -67,6 +71,39 @@ struct powertrace_sniff_stats {
 MEMB(stats_memb, struct powertrace_sniff_stats, MAX_NUM_STATS);
 LIST(stats_list);
 
+/* Peripherals printed in the PD line, totals followed by the deltas */
+static const uint8_t device_types[] = {
+  ENERGEST_TYPE_SDCARD,
+  ENERGEST_TYPE_FLASH_READ,
+  ENERGEST_TYPE_FLASH_WRITE,
+  ENERGEST_TYPE_I2C,
+  ENERGEST_TYPE_ADC,
+};
+#define NUM_DEVICE_TYPES (sizeof(device_types) / sizeof(device_types[0]))
+
+/* Rime channels (two) of the collect connection to the sink */
+#ifdef POWERTRACE_CONF_CHANNEL
+#define CHANNEL POWERTRACE_CONF_CHANNEL
+#else
+#define CHANNEL 140
+#endif
+
+/* UDP port of the sink in IPv6 networks */
+#ifdef POWERTRACE_CONF_PORT
+#define PORT POWERTRACE_CONF_PORT
+#else
+#define PORT 4718
+#endif
+
+static powertrace_output_t output;
+static uint8_t sink_conn_is_open;
+#if UIP_CONF_IPV6
+static struct simple_udp_connection sink_conn;
+static uip_ipaddr_t sink_addr;
+#else
+static struct collect_conn sink_conn;
+#endif
+
 PROCESS(powertrace_process, "Periodic power output");
 /*---------------------------------------------------------------------------*/
 void
@@ -74,6 +111,9 @@ powertrace_print(char *str)
 {
   static uint32_t last_cpu, last_lpm, last_transmit, last_listen;
   static uint32_t last_idle_transmit, last_idle_listen;
+  static uint32_t last_device[NUM_DEVICE_TYPES];
+  uint32_t all_device[NUM_DEVICE_TYPES];
+  uint8_t i;
 
   uint32_t cpu, lpm, transmit, listen;
   uint32_t all_cpu, all_lpm, all_transmit, all_listen;
@@ -133,6 +173,21 @@ powertrace_print(char *str)
          (int)((100L * listen) / time),
          (int)((10000L * listen) / time - (100L * listen / time) * 100));
 
+  for(i = 0; i < NUM_DEVICE_TYPES; i++) {
+    all_device[i] = energest_type_time(device_types[i]);
+  }
+  /* sd flash_read flash_write i2c adc */
+  printf("%s %lu PD %d.%d %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu\n",
+         str,
+         clock_time(), rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1], seqno,
+         all_device[0], all_device[1], all_device[2], all_device[3], all_device[4],
+         all_device[0] - last_device[0], all_device[1] - last_device[1],
+         all_device[2] - last_device[2], all_device[3] - last_device[3],
+         all_device[4] - last_device[4]);
+  for(i = 0; i < NUM_DEVICE_TYPES; i++) {
+    last_device[i] = all_device[i];
+  }
+
   for(s = list_head(stats_list); s != NULL; s = list_item_next(s)) {
 
 #if ! UIP_CONF_IPV6
@@ -191,6 +246,160 @@ powertrace_print(char *str)
   seqno++;
 }
 /*---------------------------------------------------------------------------*/
+void
+powertrace_record(struct powertrace_record *r)
+{
+  static uint32_t last[POWERTRACE_NUM_CHANNELS];
+  static uint16_t seqno;
+  uint32_t now[POWERTRACE_NUM_CHANNELS];
+  uint8_t i;
+
+  energest_flush();
+
+  now[POWERTRACE_CPU] = energest_type_time(ENERGEST_TYPE_CPU);
+  now[POWERTRACE_LPM] = energest_type_time(ENERGEST_TYPE_LPM);
+  now[POWERTRACE_TRANSMIT] = energest_type_time(ENERGEST_TYPE_TRANSMIT);
+  now[POWERTRACE_LISTEN] = energest_type_time(ENERGEST_TYPE_LISTEN);
+  now[POWERTRACE_IDLE_TRANSMIT] = compower_idle_activity.transmit;
+  now[POWERTRACE_IDLE_LISTEN] = compower_idle_activity.listen;
+  for(i = 0; i < NUM_DEVICE_TYPES; i++) {
+    now[POWERTRACE_SDCARD + i] = energest_type_time(device_types[i]);
+  }
+
+  r->version = POWERTRACE_RECORD_VERSION;
+  r->nchannels = POWERTRACE_NUM_CHANNELS;
+  r->seqno = seqno++;
+  r->node[0] = rimeaddr_node_addr.u8[0];
+  r->node[1] = rimeaddr_node_addr.u8[1];
+  r->dummy = 0;
+  r->clock = clock_time();
+  for(i = 0; i < POWERTRACE_NUM_CHANNELS; i++) {
+    r->ticks[i] = now[i] - last[i];
+    last[i] = now[i];
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+write_record(const struct powertrace_record *r)
+{
+  const uint8_t *ptr;
+  unsigned short crc;
+  uint8_t i;
+
+  ptr = (const uint8_t *)r;
+  crc = crc16_data(ptr, sizeof(struct powertrace_record), 0);
+
+  putchar(POWERTRACE_FRAME_START);
+  putchar(sizeof(struct powertrace_record));
+  for(i = 0; i < sizeof(struct powertrace_record); i++) {
+    putchar(ptr[i]);
+  }
+  putchar(crc & 0xff);
+  putchar(crc >> 8);
+}
+/*---------------------------------------------------------------------------*/
+static void
+sink_received(const uint8_t *data, uint16_t len)
+{
+  struct powertrace_record r;
+
+  if(len != sizeof(r)) {
+    return;
+  }
+  memcpy(&r, data, sizeof(r));
+  if(r.version == POWERTRACE_RECORD_VERSION) {
+    write_record(&r);
+  }
+}
+/*---------------------------------------------------------------------------*/
+#if UIP_CONF_IPV6
+static void
+udp_recv(struct simple_udp_connection *c,
+         const uip_ipaddr_t *source_addr, uint16_t source_port,
+         const uip_ipaddr_t *dest_addr, uint16_t dest_port,
+         const uint8_t *data, uint16_t datalen)
+{
+  sink_received(data, datalen);
+}
+/*---------------------------------------------------------------------------*/
+void
+powertrace_set_sink_addr(const uip_ipaddr_t *addr)
+{
+  uip_ipaddr_copy(&sink_addr, addr);
+}
+#else /* UIP_CONF_IPV6 */
+static void
+collect_recv(const rimeaddr_t *originator, uint8_t seqno, uint8_t hops)
+{
+  sink_received(packetbuf_dataptr(), packetbuf_datalen());
+}
+static const struct collect_callbacks collect_callbacks = { collect_recv };
+#endif /* UIP_CONF_IPV6 */
+/*---------------------------------------------------------------------------*/
+static void
+open_sink_conn(void)
+{
+  if(sink_conn_is_open) {
+    return;
+  }
+  sink_conn_is_open = 1;
+#if UIP_CONF_IPV6
+  simple_udp_register(&sink_conn, PORT, NULL, PORT, udp_recv);
+#else
+  collect_open(&sink_conn, CHANNEL, COLLECT_ROUTER, &collect_callbacks);
+#endif
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_record(const struct powertrace_record *r)
+{
+#if UIP_CONF_IPV6
+  simple_udp_sendto(&sink_conn, r, sizeof(struct powertrace_record),
+                    &sink_addr);
+#else
+  packetbuf_clear();
+  packetbuf_copyfrom(r, sizeof(struct powertrace_record));
+  collect_send(&sink_conn, 4);
+#endif
+}
+/*---------------------------------------------------------------------------*/
+void
+powertrace_set_output(powertrace_output_t o)
+{
+  output = o;
+  if(output == POWERTRACE_OUTPUT_SINK) {
+    open_sink_conn();
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+powertrace_sink(void)
+{
+  open_sink_conn();
+#if ! UIP_CONF_IPV6
+  collect_set_sink(&sink_conn, 1);
+#endif
+  /* The own records of the sink go straight to the serial line. */
+  output = POWERTRACE_OUTPUT_BINARY;
+}
+/*---------------------------------------------------------------------------*/
+static void
+powertrace_output(void)
+{
+  struct powertrace_record r;
+
+  if(output == POWERTRACE_OUTPUT_TEXT) {
+    powertrace_print("");
+    return;
+  }
+  powertrace_record(&r);
+  if(output == POWERTRACE_OUTPUT_BINARY) {
+    write_record(&r);
+  } else {
+    send_record(&r);
+  }
+}
+/*---------------------------------------------------------------------------*/
 PROCESS_THREAD(powertrace_process, ev, data)
 {
   static struct etimer periodic;
@@ -207,7 +416,7 @@ PROCESS_THREAD(powertrace_process, ev, data)
   while(1) {
     PROCESS_WAIT_UNTIL(etimer_expired(&periodic));
     etimer_reset(&periodic);
-    powertrace_print("");
+    powertrace_output();
   }
 
   PROCESS_END();
@@ -41,6 +41,10 @@
 #define POWERTRACE_H
 
 #include "sys/clock.h"
+#include "contiki-conf.h"
+#if UIP_CONF_IPV6
+#include "net/uip.h"
+#endif /* UIP_CONF_IPV6 */
 
 void powertrace_start(clock_time_t perioc);
 void powertrace_stop(void);
@@ -54,4 +58,61 @@ void powertrace_sniff(powertrace_onoff_t onoff);
 
 void powertrace_print(char *str);
 
+/* Energest counters carried in a binary record, in this order */
+enum {
+  POWERTRACE_CPU,
+  POWERTRACE_LPM,
+  POWERTRACE_TRANSMIT,
+  POWERTRACE_LISTEN,
+  POWERTRACE_IDLE_TRANSMIT,
+  POWERTRACE_IDLE_LISTEN,
+  POWERTRACE_SDCARD,
+  POWERTRACE_FLASH_READ,
+  POWERTRACE_FLASH_WRITE,
+  POWERTRACE_I2C,
+  POWERTRACE_ADC,
+  POWERTRACE_NUM_CHANNELS
+};
+
+#define POWERTRACE_RECORD_VERSION 1
+
+/**
+ * A binary powertrace record. The ticks are the energest deltas since
+ * the previous record of the node. All fields are in the byte order
+ * of the node, which is little-endian on all supported CPUs.
+ */
+struct powertrace_record {
+  uint8_t version;
+  uint8_t nchannels;
+  uint16_t seqno;
+  uint8_t node[2];
+  uint16_t dummy;
+  uint32_t clock;
+  uint32_t ticks[POWERTRACE_NUM_CHANNELS];
+};
+
+/* A record on the serial line is framed as start byte, length,
+   record and a little-endian CRC16 of the record. */
+#define POWERTRACE_FRAME_START 0xa5
+
+typedef enum {
+  POWERTRACE_OUTPUT_TEXT,
+  POWERTRACE_OUTPUT_BINARY,
+  POWERTRACE_OUTPUT_SINK
+} powertrace_output_t;
+
+void powertrace_record(struct powertrace_record *r);
+void powertrace_set_output(powertrace_output_t output);
+
+/**
+ * Make this node the powertrace sink. Records from the other nodes
+ * are written to the serial line as binary frames.
+ */
+void powertrace_sink(void);
+
+#if UIP_CONF_IPV6
+/* Address that the records are sent to in POWERTRACE_OUTPUT_SINK. */
+void powertrace_set_sink_addr(const uip_ipaddr_t *addr);
+#endif /* UIP_CONF_IPV6 */
+
 #endif /* POWERTRACE_H */
@@ -90,11 +90,13 @@ shell_exit(void)
 {
 }
 /*---------------------------------------------------------------------------*/
+PROCESS_SUBSCRIPTION(serial_line_subscription);
 PROCESS_THREAD(serial_shell_process, ev, data)
 {
   PROCESS_BEGIN();
 
   shell_init();
+  process_subscribe(&serial_line_subscription, serial_line_event_message);
 
   while(1) {
     PROCESS_WAIT_EVENT_UNTIL(ev == serial_line_event_message && data != NULL);
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *         Shell command for the diskio I/O statistics
+ *
+ *         Prints one line per detected device:
+ *         index type partition ops blocks_read blocks_written blocks_erased
+ *         retries waits errors latency[0] ... latency[DISKIO_STATS_BUCKETS - 1]
+ *
+ *         The latency histogram counts operations by their duration in
+ *         rtimer ticks, see DISKIO_STATS_BUCKETS.
+ *         Requires DISKIO_STATS to be set.
+ */
+
+#include "contiki.h"
+#include "shell-diskio.h"
+#include "diskio.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/*---------------------------------------------------------------------------*/
+PROCESS(shell_diskstat_process, "diskstat");
+SHELL_COMMAND(diskstat_command,
+	      "diskstat",
+	      "diskstat [reset]: print (or reset) the I/O statistics of the disk devices",
+	      &shell_diskstat_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(shell_diskstat_process, ev, data)
+{
+#if DISKIO_STATS
+  struct diskio_device_info *dev;
+  const char *args;
+  char buf[160];
+  int len;
+  uint8_t i, j, reset;
+
+  PROCESS_BEGIN();
+
+  args = data;
+  reset = (args != NULL && strncmp(args, "reset", 5) == 0);
+
+  dev = diskio_devices();
+  for(i = 0; i < DISKIO_MAX_DEVICES; i++) {
+    if(dev[i].type == DISKIO_DEVICE_TYPE_NOT_RECOGNIZED) {
+      continue;
+    }
+
+    if(reset) {
+      diskio_reset_stats(&dev[i]);
+      continue;
+    }
+
+    len = snprintf(buf, sizeof(buf), "%u %u %u %lu %lu %lu %lu %lu %lu %lu",
+                   i, dev[i].type, dev[i].partition, dev[i].stats.ops,
+                   dev[i].stats.blocks_read, dev[i].stats.blocks_written,
+                   dev[i].stats.blocks_erased, dev[i].stats.retries,
+                   dev[i].stats.waits, dev[i].stats.errors);
+    for(j = 0; j < DISKIO_STATS_BUCKETS && len < (int) sizeof(buf); j++) {
+      len += snprintf(buf + len, sizeof(buf) - len, " %u", dev[i].stats.latency[j]);
+    }
+    shell_output_str(&diskstat_command, buf, "");
+  }
+
+  PROCESS_END();
+#else /* DISKIO_STATS */
+  PROCESS_BEGIN();
+  shell_output_str(&diskstat_command, "diskstat: DISKIO_STATS not enabled", "");
+  PROCESS_END();
+#endif /* DISKIO_STATS */
+}
+/*---------------------------------------------------------------------------*/
+void
+shell_diskio_init(void)
+{
+  shell_register_command(&diskstat_command);
+}
+/*---------------------------------------------------------------------------*/
@@ -47,6 +47,14 @@
 #define MAX_FILENAME_LEN 40
 #define MAX_BLOCKSIZE 40
 
+/* The number of blocks that read passes on before it lets other
+   processes run. */
+#ifdef SHELL_FILE_CONF_READ_BURST
+#define READ_BURST SHELL_FILE_CONF_READ_BURST
+#else
+#define READ_BURST 4
+#endif
+
 /*---------------------------------------------------------------------------*/
 PROCESS(shell_ls_process, "ls");
 SHELL_COMMAND(ls_command,
@@ -191,6 +199,7 @@ PROCESS_THREAD(shell_read_process, ev, data)
   char filename[MAX_FILENAME_LEN];
   int len;
   int offset = 0;
+  int i;
   char buf[MAX_BLOCKSIZE];
   struct shell_input *input;
 
@@ -238,16 +247,22 @@ PROCESS_THREAD(shell_read_process, ev, data)
     } else {
       
       while(1) {
-	len = cfs_read(fd, buf, block_size);
-	if(len <= 0) {
-	  cfs_close(fd);
-	  PROCESS_EXIT();
+	for(i = 0; i < READ_BURST && shell_output_ready(&read_command); i++) {
+	  len = cfs_read(fd, buf, block_size);
+	  if(len <= 0) {
+	    cfs_close(fd);
+	    PROCESS_EXIT();
+	  }
+	  shell_output(&read_command,
+		       buf, len, "", 0);
+	}
+
+	/* A busy pipeline posts shell_event_ready when it catches up. */
+	if(shell_output_ready(&read_command)) {
+	  process_post(&shell_read_process, PROCESS_EVENT_CONTINUE, NULL);
 	}
-	shell_output(&read_command,
-		     buf, len, "", 0);
-	
-	process_post(&shell_read_process, PROCESS_EVENT_CONTINUE, NULL);
 	PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_CONTINUE ||
+				 ev == shell_event_ready ||
 				 ev == shell_event_input);
 	
 	if(ev == shell_event_input) {
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Shell command for the interrupt handler statistics on AVR
+ *
+ *         Prints one line per instrumented vector:
+ *         name count avg_cycles max_cycles avg_latency max_latency
+ *
+ *         Durations are in CPU cycles, latencies in ticks of the timer
+ *         that triggered the handler, 0 where they cannot be measured.
+ *         Requires AVR_CONF_ISR_STATS to be set.
+ */
+
+#include "contiki.h"
+#include "shell-isr.h"
+#include "isr-stats.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/*---------------------------------------------------------------------------*/
+PROCESS(shell_isrstat_process, "isrstat");
+SHELL_COMMAND(isrstat_command,
+	      "isrstat",
+	      "isrstat [reset]: print (and reset) the interrupt handler statistics",
+	      &shell_isrstat_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(shell_isrstat_process, ev, data)
+{
+#if ISR_STATS
+  struct isr_stats s;
+  const char *args;
+  char buf[64];
+  uint8_t i, reset;
+
+  PROCESS_BEGIN();
+
+  args = data;
+  reset = (args != NULL && strncmp(args, "reset", 5) == 0);
+
+  for(i = 0; i < ISR_STATS_NUM; i++) {
+    isr_stats_get(i, &s, reset);
+    snprintf(buf, sizeof(buf), "%s %lu %lu %u %lu %u", isr_stats_name(i),
+             s.count, s.count ? s.cycles / s.count : 0, s.max_cycles,
+             s.count ? s.latency / s.count : 0, s.max_latency);
+    shell_output_str(&isrstat_command, buf, "");
+  }
+
+  PROCESS_END();
+#else /* ISR_STATS */
+  PROCESS_BEGIN();
+  shell_output_str(&isrstat_command, "isrstat: AVR_CONF_ISR_STATS not enabled", "");
+  PROCESS_END();
+#endif /* ISR_STATS */
+}
+/*---------------------------------------------------------------------------*/
+void
+shell_isr_init(void)
+{
+  shell_register_command(&isrstat_command);
+}
+/*---------------------------------------------------------------------------*/
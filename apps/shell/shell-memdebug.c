@@ -40,6 +40,11 @@
 
 #include "contiki.h"
 #include "shell-memdebug.h"
+#include "lib/memb.h"
+#include "sys/mt.h"
+#ifdef __AVR__
+#include "stack-arch.h"
+#endif
 
 #include <stdio.h>
 #include <string.h>
@@ -55,6 +60,18 @@ SHELL_COMMAND(peek_command,
 	      "peek",
 	      "peek <address>: read a byte from address <address>",
 	      &shell_peek_process);
+PROCESS(shell_stack_process, "stack");
+SHELL_COMMAND(stack_command,
+	      "stack",
+	      "stack: show the stack usage of the main stack and of mt threads",
+	      &shell_stack_process);
+#if MEMB_CONF_STATS
+PROCESS(shell_memb_process, "memb");
+SHELL_COMMAND(memb_command,
+	      "memb",
+	      "memb: list used, maximum used and total blocks of each memory block",
+	      &shell_memb_process);
+#endif /* MEMB_CONF_STATS */
 /*---------------------------------------------------------------------------*/
 PROCESS_THREAD(shell_poke_process, ev, data)
 {
@@ -119,10 +136,57 @@ PROCESS_THREAD(shell_peek_process, ev, data)
   PROCESS_END();
 }
 /*---------------------------------------------------------------------------*/
+PROCESS_THREAD(shell_stack_process, ev, data)
+{
+#if MT_CONF_THREAD_LIST
+  struct mt_thread *t;
+#endif
+  char buf[32];
+
+  PROCESS_BEGIN();
+
+#ifdef __AVR__
+  snprintf(buf, sizeof(buf), "%u/%u", stack_arch_size() - stack_arch_unused(),
+           stack_arch_size());
+  shell_output_str(&stack_command, "main ", buf);
+#endif /* __AVR__ */
+#if MT_CONF_THREAD_LIST
+  for(t = mt_threads(); t != NULL; t = t->next) {
+    snprintf(buf, sizeof(buf), "mt %p %d/%d", t, mtarch_stack_usage(t),
+             (int)sizeof(t->thread));
+    shell_output_str(&stack_command, buf, "");
+  }
+#endif /* MT_CONF_THREAD_LIST */
+  (void)buf;
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+#if MEMB_CONF_STATS
+PROCESS_THREAD(shell_memb_process, ev, data)
+{
+  struct memb *m;
+  char buf[24];
+
+  PROCESS_BEGIN();
+
+  for(m = memb_list(); m != NULL; m = m->next) {
+    snprintf(buf, sizeof(buf), "%u/%u/%u ", m->used, m->max_used, m->num);
+    shell_output_str(&memb_command, buf, m->name);
+  }
+
+  PROCESS_END();
+}
+#endif /* MEMB_CONF_STATS */
+/*---------------------------------------------------------------------------*/
 void
 shell_memdebug_init(void)
 {
   shell_register_command(&poke_command);
   shell_register_command(&peek_command);
+  shell_register_command(&stack_command);
+#if MEMB_CONF_STATS
+  shell_register_command(&memb_command);
+#endif /* MEMB_CONF_STATS */
 }
 /*---------------------------------------------------------------------------*/
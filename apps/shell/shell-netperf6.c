@@ -0,0 +1,748 @@
+/*
+ * Copyright (c) 2013, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         UDP and TCP performance measurements over IPv6
+ * \author
+ *         Adam Dunkels <adam@sics.se>
+ */
+
+#include "contiki.h"
+#include "contiki-net.h"
+#include "shell-netperf6.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if UIP_CONF_IPV6
+
+/* UDP and TCP port used both by the benchmark and by the responder
+   that runs on every node. */
+#ifdef SHELL_NETPERF6_CONF_PORT
+#define PORT SHELL_NETPERF6_CONF_PORT
+#else
+#define PORT 5047
+#endif
+
+/* Largest payload that can be requested. */
+#ifdef SHELL_NETPERF6_CONF_MAX_PAYLOAD
+#define MAX_PAYLOAD SHELL_NETPERF6_CONF_MAX_PAYLOAD
+#else
+#define MAX_PAYLOAD 80
+#endif
+
+/* Number of round-trip-time samples kept for the percentiles. If more
+   packets are sent, the latest ones are kept. */
+#ifdef SHELL_NETPERF6_CONF_MAX_SAMPLES
+#define MAX_SAMPLES SHELL_NETPERF6_CONF_MAX_SAMPLES
+#else
+#define MAX_SAMPLES 32
+#endif
+
+/* Path lengths that get their own line in the per-hop breakdown. */
+#ifdef SHELL_NETPERF6_CONF_MAX_HOPS
+#define MAX_HOPS SHELL_NETPERF6_CONF_MAX_HOPS
+#else
+#define MAX_HOPS 8
+#endif
+
+#define DEFAULT_PAYLOAD 32
+#define ECHO_TIMEOUT    CLOCK_SECOND
+#define CTRL_TIMEOUT    CLOCK_SECOND
+#define CTRL_RETRIES    4
+
+#define UIP_IP_BUF  ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+#define UIP_UDP_BUF ((struct uip_udp_hdr *)&uip_buf[uip_l2_l3_hdr_len])
+
+enum {
+  TYPE_NONE,
+  TYPE_UDP,
+  TYPE_UDP_PINGPONG,
+  TYPE_TCP,
+};
+
+enum {
+  MSG_DATA,
+  MSG_ECHO_REQUEST,
+  MSG_ECHO_REPLY,
+  MSG_CLEAR,
+  MSG_CLEAR_ACK,
+  MSG_STATS,
+  MSG_STATS_REPLY,
+};
+
+struct power {
+  uint32_t lpm, cpu, rx, tx;
+};
+
+/* Header of every UDP packet, followed by padding up to the payload
+   size. */
+struct msg {
+  uint8_t type;
+  uint8_t hops;
+  uint16_t seqno;
+  rtimer_clock_t timestamp;
+};
+
+struct stats_msg {
+  uint8_t type;
+  uint8_t dummy;
+  uint16_t received;
+  uint32_t bytes;
+  struct power power;
+};
+
+struct hop_stats {
+  uint16_t received;
+  uint32_t total_rtt;
+};
+
+struct stats {
+  uint16_t sent, received, timedout, rexmit;
+  uint32_t bytes;
+  uint32_t total_rtt;
+  uint32_t total_hops_forward, total_hops_return;
+  rtimer_clock_t min_rtt, max_rtt;
+  rtimer_clock_t samples[MAX_SAMPLES];
+  struct hop_stats hops[MAX_HOPS];
+  clock_time_t start, end;
+  struct power power0, power;
+};
+
+/* What the responder has seen since the last MSG_CLEAR. */
+static struct {
+  uint16_t received;
+  uint32_t bytes;
+  struct power power0;
+} server;
+
+static struct stats stats;
+static struct stats_msg remote;
+static uint8_t current_type;
+static uint8_t payload[MAX_PAYLOAD], reply[MAX_PAYLOAD];
+static uint16_t payload_size;
+static uip_ipaddr_t receiver;
+static struct uip_udp_conn *client_conn, *server_conn;
+
+/*---------------------------------------------------------------------------*/
+PROCESS(shell_netperf6_process, "netperf6");
+PROCESS(netperf6_server_process, "netperf6 responder");
+SHELL_COMMAND(netperf6_command,
+	      "netperf6",
+	      "netperf6 [-u|p|t] <host> <num packets> [size] [rate]: perform IPv6 network measurements",
+	      &shell_netperf6_process);
+/*---------------------------------------------------------------------------*/
+static void
+sample_power_profile(struct power *p)
+{
+  energest_flush();
+  p->lpm = energest_type_time(ENERGEST_TYPE_LPM);
+  p->cpu = energest_type_time(ENERGEST_TYPE_CPU);
+  p->rx = energest_type_time(ENERGEST_TYPE_LISTEN);
+  p->tx = energest_type_time(ENERGEST_TYPE_TRANSMIT);
+}
+/*---------------------------------------------------------------------------*/
+static void
+clear_stats(void)
+{
+  memset(&stats, 0, sizeof(stats));
+  memset(&remote, 0, sizeof(remote));
+  stats.min_rtt = (rtimer_clock_t)-1;
+  stats.start = clock_time();
+  sample_power_profile(&stats.power0);
+}
+/*---------------------------------------------------------------------------*/
+static void
+finalize_stats(void)
+{
+  stats.end = clock_time();
+  sample_power_profile(&stats.power);
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+received_hops(void)
+{
+  /* Every router on the way has decremented the hop limit once. */
+  return uip_ds6_if.cur_hop_limit - UIP_IP_BUF->ttl + 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_rtt_sample(rtimer_clock_t rtt, uint8_t hops)
+{
+  stats.samples[stats.received % MAX_SAMPLES] = rtt;
+  stats.received++;
+  stats.total_rtt += rtt;
+  if(rtt < stats.min_rtt) {
+    stats.min_rtt = rtt;
+  }
+  if(rtt > stats.max_rtt) {
+    stats.max_rtt = rtt;
+  }
+  if(hops > 0) {
+    if(hops > MAX_HOPS) {
+      hops = MAX_HOPS;
+    }
+    stats.hops[hops - 1].received++;
+    stats.hops[hops - 1].total_rtt += rtt;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+rtt_ms(unsigned long rtt)
+{
+  return (1000UL * rtt) / RTIMER_ARCH_SECOND;
+}
+/*---------------------------------------------------------------------------*/
+static rtimer_clock_t
+percentile(int p)
+{
+  int i, j, n;
+  rtimer_clock_t tmp;
+
+  n = stats.received < MAX_SAMPLES ? stats.received : MAX_SAMPLES;
+  if(n == 0) {
+    return 0;
+  }
+
+  /* Insertion sort; the samples are not needed in sending order any
+     more once the measurement is over. */
+  for(i = 1; i < n; ++i) {
+    tmp = stats.samples[i];
+    for(j = i; j > 0 && stats.samples[j - 1] > tmp; --j) {
+      stats.samples[j] = stats.samples[j - 1];
+    }
+    stats.samples[j] = tmp;
+  }
+  return stats.samples[(p * (n - 1) + 50) / 100];
+}
+/*---------------------------------------------------------------------------*/
+static void
+print_duty_cycle(const char *who, struct power *p0, struct power *p)
+{
+  unsigned long total_time;
+
+  total_time = p->cpu + p->lpm - p0->cpu - p0->lpm;
+  if(total_time == 0) {
+    return;
+  }
+  printf("  %s radio duty cycle: rx %lu.%02lu%% tx %lu.%02lu%%\n",
+	 who,
+	 (100 * (unsigned long)(p->rx - p0->rx)) / total_time,
+	 ((10000 * (unsigned long)(p->rx - p0->rx)) / total_time) % 100,
+	 (100 * (unsigned long)(p->tx - p0->tx)) / total_time,
+	 ((10000 * (unsigned long)(p->tx - p0->tx)) / total_time) % 100);
+}
+/*---------------------------------------------------------------------------*/
+static void
+print_stats(void)
+{
+  unsigned long time;
+  uint16_t delivered;
+  struct power remote0;
+  int i;
+
+  time = stats.end - stats.start;
+  if(time == 0) {
+    time = 1;
+  }
+
+  /* One-way UDP relies on the receiver's count, the echo and TCP modes
+     on what came back. */
+  delivered = current_type == TYPE_UDP ? remote.received : stats.received;
+
+  printf("%d 0 %u %u %u %u %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu # for automatic processing\n",
+	 current_type,
+	 stats.sent, delivered, stats.timedout, stats.rexmit,
+	 (unsigned long)stats.bytes, time,
+	 rtt_ms(stats.received ? stats.total_rtt / stats.received : 0),
+	 rtt_ms(percentile(50)), rtt_ms(percentile(90)), rtt_ms(percentile(99)),
+	 (unsigned long)(stats.power.cpu - stats.power0.cpu),
+	 (unsigned long)(stats.power.lpm - stats.power0.lpm),
+	 (unsigned long)(stats.power.rx - stats.power0.rx),
+	 (unsigned long)(stats.power.tx - stats.power0.tx));
+  printf("%d 1 %u %lu %lu %lu %lu %lu # for automatic processing\n",
+	 current_type, remote.received, (unsigned long)remote.bytes,
+	 (unsigned long)remote.power.cpu, (unsigned long)remote.power.lpm,
+	 (unsigned long)remote.power.rx, (unsigned long)remote.power.tx);
+
+  printf("Local node statistics:\n");
+  printf("  Total transfer time:       %lu.%02lu seconds, %lu.%02lu packets/second, %lu bytes/second\n",
+	 time / CLOCK_SECOND,
+	 ((100 * time) / CLOCK_SECOND) % 100,
+	 (1UL * CLOCK_SECOND * stats.sent) / time,
+	 ((100UL * CLOCK_SECOND * stats.sent) / time) % 100,
+	 (1UL * CLOCK_SECOND * (current_type == TYPE_UDP ?
+				remote.bytes : stats.bytes)) / time);
+  if(stats.sent > 0) {
+    printf("  Packets delivered:         %u.%lu%%, %u of %u, %u retransmissions\n",
+	   (100U * delivered) / stats.sent,
+	   ((1000UL * delivered) / stats.sent) % 10,
+	   delivered, stats.sent, stats.rexmit);
+  }
+  if(stats.received > 0) {
+    printf("  Round-trip-time:           min %lu avg %lu max %lu ms\n",
+	   rtt_ms(stats.min_rtt), rtt_ms(stats.total_rtt / stats.received),
+	   rtt_ms(stats.max_rtt));
+    printf("  Round-trip-time percentiles: 50%% %lu 90%% %lu 99%% %lu ms\n",
+	   rtt_ms(percentile(50)), rtt_ms(percentile(90)),
+	   rtt_ms(percentile(99)));
+  }
+  if(current_type == TYPE_UDP_PINGPONG && stats.received > 0) {
+    printf("  Average path length:       forward %lu.%lu return %lu.%lu hops\n",
+	   (unsigned long)stats.total_hops_forward / stats.received,
+	   ((10UL * stats.total_hops_forward) / stats.received) % 10,
+	   (unsigned long)stats.total_hops_return / stats.received,
+	   ((10UL * stats.total_hops_return) / stats.received) % 10);
+    for(i = 0; i < MAX_HOPS; ++i) {
+      if(stats.hops[i].received > 0) {
+	printf("  %2d%s hops forward:        %u replies, avg rtt %lu ms, %lu ms/hop\n",
+	       i + 1, i + 1 == MAX_HOPS ? "+" : " ", stats.hops[i].received,
+	       rtt_ms(stats.hops[i].total_rtt / stats.hops[i].received),
+	       rtt_ms(stats.hops[i].total_rtt / stats.hops[i].received) /
+	       (i + 1));
+      }
+    }
+  }
+  print_duty_cycle("Local", &stats.power0, &stats.power);
+
+  memset(&remote0, 0, sizeof(remote0));
+  print_duty_cycle("Remote", &remote0, &remote.power);
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_msg(uint8_t type, uint16_t seqno, uint16_t len)
+{
+  struct msg m;
+
+  m.type = type;
+  m.hops = 0;
+  m.seqno = seqno;
+  m.timestamp = RTIMER_NOW();
+  memcpy(payload, &m, sizeof(m));
+  uip_udp_packet_send(client_conn, payload, len);
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_echo_reply(uint16_t seqno)
+{
+  struct msg m;
+  rtimer_clock_t rtt;
+  uint8_t hops;
+
+  memcpy(&m, uip_appdata, sizeof(m));
+  rtt = RTIMER_NOW() - m.timestamp;
+  hops = received_hops();
+
+  stats.bytes += uip_datalen();
+  stats.total_hops_forward += m.hops;
+  stats.total_hops_return += hops;
+  add_rtt_sample(rtt, m.hops);
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the type of the UDP packet the client just received, or
+   MSG_DATA if there is none. */
+static uint8_t
+received_type(void)
+{
+  if(!uip_newdata() || !uip_udpconnection() ||
+     uip_datalen() < sizeof(struct msg)) {
+    return MSG_DATA;
+  }
+  return ((struct msg *)uip_appdata)->type;
+}
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(ctrl_request(struct pt *pt, process_event_t ev, uint8_t type))
+{
+  static struct etimer e;
+  static uint8_t tries;
+
+  PT_BEGIN(pt);
+
+  for(tries = 0; tries < CTRL_RETRIES; ++tries) {
+    send_msg(type, 0, sizeof(struct msg));
+    etimer_set(&e, CTRL_TIMEOUT);
+    PT_YIELD(pt);
+    while(!etimer_expired(&e)) {
+      /* Every request is answered by the message type following it. */
+      if(ev == tcpip_event && received_type() == type + 1) {
+	if(type == MSG_STATS) {
+	  memcpy(&remote, uip_appdata, sizeof(remote));
+	}
+	etimer_stop(&e);
+	PT_EXIT(pt);
+      }
+      PT_YIELD(pt);
+    }
+  }
+  shell_output_str(&netperf6_command, "No reply from responder", "");
+  PT_END(pt);
+}
+/*---------------------------------------------------------------------------*/
+static void
+server_udp_input(void)
+{
+  struct msg m;
+  struct stats_msg s;
+  uip_ipaddr_t addr;
+  uint16_t port, len;
+  struct power p;
+
+  len = uip_datalen();
+  if(len < sizeof(m) || len > MAX_PAYLOAD) {
+    return;
+  }
+  memcpy(reply, uip_appdata, len);
+  memcpy(&m, reply, sizeof(m));
+  uip_ipaddr_copy(&addr, &UIP_IP_BUF->srcipaddr);
+  port = UIP_UDP_BUF->srcport;
+
+  switch(m.type) {
+  case MSG_DATA:
+    server.received++;
+    server.bytes += len;
+    break;
+  case MSG_ECHO_REQUEST:
+    server.received++;
+    server.bytes += len;
+    m.type = MSG_ECHO_REPLY;
+    m.hops = received_hops();
+    memcpy(reply, &m, sizeof(m));
+    uip_udp_packet_sendto(server_conn, reply, len, &addr, port);
+    break;
+  case MSG_CLEAR:
+    memset(&server, 0, sizeof(server));
+    sample_power_profile(&server.power0);
+    m.type = MSG_CLEAR_ACK;
+    uip_udp_packet_sendto(server_conn, &m, sizeof(m), &addr, port);
+    break;
+  case MSG_STATS:
+    sample_power_profile(&p);
+    memset(&s, 0, sizeof(s));
+    s.type = MSG_STATS_REPLY;
+    s.received = server.received;
+    s.bytes = server.bytes;
+    s.power.lpm = p.lpm - server.power0.lpm;
+    s.power.cpu = p.cpu - server.power0.cpu;
+    s.power.rx = p.rx - server.power0.rx;
+    s.power.tx = p.tx - server.power0.tx;
+    uip_udp_packet_sendto(server_conn, &s, sizeof(s), &addr, port);
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(netperf6_server_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  server_conn = udp_new(NULL, 0, NULL);
+  udp_bind(server_conn, UIP_HTONS(PORT));
+  tcp_listen(UIP_HTONS(PORT));
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == tcpip_event);
+    if(uip_udpconnection()) {
+      if(uip_newdata()) {
+	server_udp_input();
+      }
+    } else if(uip_newdata()) {
+      /* TCP data is only counted, uIP acknowledges it for us. */
+      server.received++;
+      server.bytes += uip_datalen();
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+static void
+close_client(void)
+{
+  if(client_conn != NULL) {
+    uip_udp_remove(client_conn);
+    client_conn = NULL;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+print_usage(void)
+{
+  shell_output_str(&netperf6_command,
+		   "netperf6 [-u|p|t] <host> <num packets> [size] [rate]: perform IPv6 network measurements to host", "");
+  shell_output_str(&netperf6_command,
+		   "        -u measure one-way UDP performance", "");
+  shell_output_str(&netperf6_command,
+		   "        -p measure ping-pong UDP performance", "");
+  shell_output_str(&netperf6_command,
+		   "        -t measure TCP stream performance", "");
+  shell_output_str(&netperf6_command,
+		   "        size is the payload in bytes, rate is in packets/second (0 = as fast as possible)", "");
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(shell_netperf6_process, ev, data)
+{
+  static struct etimer e, interval;
+  static struct pt ctrl_pt;
+  static struct uip_conn *tcp_conn;
+  static rtimer_clock_t tcp_sent;
+  static char recvstr[40];
+  static uint16_t i, num_packets;
+  static clock_time_t period;
+  static uint8_t do_udp, do_pingpong, do_tcp, replied;
+  const char *nextptr;
+  const char *args;
+  char *next;
+  unsigned long rate;
+
+  PROCESS_EXITHANDLER(close_client());
+  PROCESS_BEGIN();
+
+  current_type = TYPE_NONE;
+  do_udp = do_pingpong = do_tcp = 0;
+
+  args = data;
+
+  /* Parse the -upt options */
+  while(*args == '-') {
+    ++args;
+    while(*args != ' ' &&
+	  *args != 0) {
+      if(*args == 'u') {
+	do_udp = 1;
+      }
+      if(*args == 'p') {
+	do_pingpong = 1;
+      }
+      if(*args == 't') {
+	do_tcp = 1;
+      }
+      ++args;
+    }
+    while(*args == ' ') {
+      args++;
+    }
+  }
+  if(!do_udp && !do_pingpong && !do_tcp) {
+    do_pingpong = 1;
+  }
+
+  /* Parse the receiver address */
+  next = strchr(args, ' ');
+  if(next == NULL || next - args >= (int)sizeof(recvstr)) {
+    print_usage();
+    PROCESS_EXIT();
+  }
+  memcpy(recvstr, args, next - args);
+  recvstr[next - args] = 0;
+  if(uiplib_ipaddrconv(recvstr, &receiver) == 0) {
+    shell_output_str(&netperf6_command, "Bad address ", recvstr);
+    PROCESS_EXIT();
+  }
+
+  /* Parse the number of packets, the payload size and the rate */
+  args = next;
+  num_packets = shell_strtolong(args, &nextptr);
+  if(nextptr == args || num_packets == 0) {
+    print_usage();
+    PROCESS_EXIT();
+  }
+  args = nextptr;
+  payload_size = shell_strtolong(args, &nextptr);
+  if(nextptr == args) {
+    payload_size = DEFAULT_PAYLOAD;
+  }
+  if(payload_size < sizeof(struct msg)) {
+    payload_size = sizeof(struct msg);
+  }
+  if(payload_size > MAX_PAYLOAD) {
+    payload_size = MAX_PAYLOAD;
+  }
+  args = nextptr;
+  rate = shell_strtolong(args, &nextptr);
+  period = rate > 0 ? CLOCK_SECOND / rate : 0;
+
+  for(i = 0; i < sizeof(payload); ++i) {
+    payload[i] = i;
+  }
+
+  client_conn = udp_new(&receiver, UIP_HTONS(PORT), NULL);
+  if(client_conn == NULL) {
+    shell_output_str(&netperf6_command, "No UDP connection available", "");
+    PROCESS_EXIT();
+  }
+
+  if(do_udp) {
+    current_type = TYPE_UDP;
+    shell_output_str(&netperf6_command, "-------- UDP one-way --------", "");
+
+    shell_output_str(&netperf6_command, "Contacting ", recvstr);
+    PROCESS_PT_SPAWN(&ctrl_pt, ctrl_request(&ctrl_pt, ev, MSG_CLEAR));
+
+    shell_output_str(&netperf6_command, "Measuring one-way UDP performance to ", recvstr);
+    clear_stats();
+    for(i = 0; i < num_packets; ++i) {
+      etimer_set(&interval, period);
+      send_msg(MSG_DATA, i, payload_size);
+      stats.sent++;
+      stats.bytes += payload_size;
+      if(period > 0) {
+	PROCESS_WAIT_UNTIL(etimer_expired(&interval));
+      } else {
+	PROCESS_PAUSE();
+      }
+    }
+    finalize_stats();
+
+    /* Let the last packets drain before asking for the count. */
+    etimer_set(&e, CLOCK_SECOND / 2);
+    PROCESS_WAIT_UNTIL(etimer_expired(&e));
+
+    shell_output_str(&netperf6_command, "Requesting statistics from ", recvstr);
+    PROCESS_PT_SPAWN(&ctrl_pt, ctrl_request(&ctrl_pt, ev, MSG_STATS));
+    print_stats();
+  }
+
+  if(do_pingpong) {
+    current_type = TYPE_UDP_PINGPONG;
+    shell_output_str(&netperf6_command, "-------- UDP ping-pong --------", "");
+
+    shell_output_str(&netperf6_command, "Contacting ", recvstr);
+    PROCESS_PT_SPAWN(&ctrl_pt, ctrl_request(&ctrl_pt, ev, MSG_CLEAR));
+
+    shell_output_str(&netperf6_command, "Measuring two-way UDP performance to ", recvstr);
+    clear_stats();
+    for(i = 0; i < num_packets; ++i) {
+      etimer_set(&interval, period);
+      send_msg(MSG_ECHO_REQUEST, i, payload_size);
+      stats.sent++;
+
+      /* Replies that arrive after the timeout have a stale sequence
+	 number and are counted as lost. */
+      etimer_set(&e, ECHO_TIMEOUT);
+      replied = 0;
+      while(!replied && !etimer_expired(&e)) {
+	PROCESS_WAIT_EVENT();
+	if(ev == tcpip_event && received_type() == MSG_ECHO_REPLY &&
+	   ((struct msg *)uip_appdata)->seqno == i) {
+	  handle_echo_reply(i);
+	  replied = 1;
+	}
+      }
+      if(!replied) {
+	stats.timedout++;
+      }
+      if(period > 0) {
+	PROCESS_WAIT_UNTIL(etimer_expired(&interval));
+      }
+    }
+    finalize_stats();
+
+    shell_output_str(&netperf6_command, "Requesting statistics from ", recvstr);
+    PROCESS_PT_SPAWN(&ctrl_pt, ctrl_request(&ctrl_pt, ev, MSG_STATS));
+    print_stats();
+  }
+
+  if(do_tcp) {
+    current_type = TYPE_TCP;
+    shell_output_str(&netperf6_command, "-------- TCP stream --------", "");
+
+    shell_output_str(&netperf6_command, "Contacting ", recvstr);
+    PROCESS_PT_SPAWN(&ctrl_pt, ctrl_request(&ctrl_pt, ev, MSG_CLEAR));
+
+    shell_output_str(&netperf6_command, "Measuring TCP stream performance to ", recvstr);
+    clear_stats();
+    tcp_conn = tcp_connect(&receiver, UIP_HTONS(PORT), NULL);
+    if(tcp_conn == NULL) {
+      shell_output_str(&netperf6_command, "No TCP connection available", "");
+      close_client();
+      PROCESS_EXIT();
+    }
+
+    /* uIP keeps a single segment in flight, so every acknowledgement
+       gives one round-trip-time sample. */
+    while(1) {
+      PROCESS_WAIT_EVENT_UNTIL(ev == tcpip_event);
+      if(uip_aborted() || uip_timedout() || uip_closed()) {
+	break;
+      }
+      if(uip_connected() && payload_size > uip_mss()) {
+	payload_size = uip_mss();
+      }
+      if(uip_acked()) {
+	add_rtt_sample(RTIMER_NOW() - tcp_sent, 0);
+	stats.bytes += payload_size;
+	if(stats.received == num_packets) {
+	  uip_close();
+	  continue;
+	}
+      }
+      if(uip_rexmit()) {
+	stats.rexmit++;
+	uip_send(payload, payload_size);
+      } else if(stats.sent < num_packets &&
+		(uip_connected() || uip_acked() || uip_poll())) {
+	if(stats.sent == stats.received) {
+	  uip_send(payload, payload_size);
+	  tcp_sent = RTIMER_NOW();
+	  stats.sent++;
+	}
+      }
+    }
+    finalize_stats();
+    if(!uip_closed()) {
+      shell_output_str(&netperf6_command, "Connection lost to ", recvstr);
+    }
+
+    shell_output_str(&netperf6_command, "Requesting statistics from ", recvstr);
+    PROCESS_PT_SPAWN(&ctrl_pt, ctrl_request(&ctrl_pt, ev, MSG_STATS));
+    print_stats();
+  }
+
+  close_client();
+  shell_output_str(&netperf6_command, "Done", "");
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+shell_netperf6_init(void)
+{
+  process_start(&netperf6_server_process, NULL);
+  shell_register_command(&netperf6_command);
+}
+/*---------------------------------------------------------------------------*/
+#else /* UIP_CONF_IPV6 */
+void
+shell_netperf6_init(void)
+{
+}
+#endif /* UIP_CONF_IPV6 */
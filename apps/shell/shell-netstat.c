@@ -104,16 +104,64 @@ static const char *states[] = {
 PROCESS(shell_netstat_process, "netstat");
 SHELL_COMMAND(netstat_command,
 	      "netstat",
-	      "netstat: show UDP and TCP connections",
+	      "netstat [-s|-z]: show UDP and TCP connections, -s netstack statistics, -z resets them",
 	      &shell_netstat_process);
 /*---------------------------------------------------------------------------*/
+#if RIMESTATS_CONF_ENABLED
+static void
+print_stats(void)
+{
+  char buf[BUFLEN];
+
+  snprintf(buf, BUFLEN, "tx %lu (%lu bytes), rx %lu (%lu bytes)",
+           RIMESTATS_GET(lltx), RIMESTATS_GET(lltxbytes),
+           RIMESTATS_GET(rx), RIMESTATS_GET(llrxbytes));
+  shell_output_str(&netstat_command, "radio ", buf);
+  snprintf(buf, BUFLEN, "cca failed %lu, noack %lu, crc %lu, short %lu, long %lu, synch %lu",
+           RIMESTATS_GET(contentiondrop), RIMESTATS_GET(badackrx),
+           RIMESTATS_GET(badcrc), RIMESTATS_GET(tooshort),
+           RIMESTATS_GET(toolong), RIMESTATS_GET(badsynch));
+  shell_output_str(&netstat_command, "radio ", buf);
+  snprintf(buf, BUFLEN, "filtered %lu", RIMESTATS_GET(rdcdrop));
+  shell_output_str(&netstat_command, "rdc ", buf);
+  snprintf(buf, BUFLEN, "collision %lu, noack %lu, dropped %lu, queue full %lu",
+           RIMESTATS_GET(maccollision), RIMESTATS_GET(macnoack),
+           RIMESTATS_GET(macdrop), RIMESTATS_GET(macqueuedrop));
+  shell_output_str(&netstat_command, "mac ", buf);
+  snprintf(buf, BUFLEN, "tx %lu (%lu fragments), rx %lu (%lu fragments)",
+           RIMESTATS_GET(lowpantx), RIMESTATS_GET(lowpanfragtx),
+           RIMESTATS_GET(lowpanrx), RIMESTATS_GET(lowpanfragrx));
+  shell_output_str(&netstat_command, "6lowpan ", buf);
+  snprintf(buf, BUFLEN, "reassembly failed %lu, dropped %lu",
+           RIMESTATS_GET(lowpanreassfail), RIMESTATS_GET(lowpandrop));
+  shell_output_str(&netstat_command, "6lowpan ", buf);
+}
+#endif /* RIMESTATS_CONF_ENABLED */
+/*---------------------------------------------------------------------------*/
 PROCESS_THREAD(shell_netstat_process, ev, data)
 {
   char buf[BUFLEN];
   int i;
   struct uip_conn *conn;
+  char *args;
   PROCESS_BEGIN();
 
+  args = data;
+  if(args != NULL && args[0] == '-' &&
+     (args[1] == 's' || args[1] == 'z')) {
+#if RIMESTATS_CONF_ENABLED
+    if(args[1] == 's') {
+      print_stats();
+    } else {
+      RIMESTATS_RESET();
+    }
+#else /* RIMESTATS_CONF_ENABLED */
+    shell_output_str(&netstat_command,
+                     "netstat: statistics need RIMESTATS_CONF_ENABLED", "");
+#endif /* RIMESTATS_CONF_ENABLED */
+    PROCESS_EXIT();
+  }
+
   for(i = 0; i < UIP_CONNS; ++i) {
     conn = &uip_conns[i];
     snprintf(buf, BUFLEN,
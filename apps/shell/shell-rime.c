@@ -65,6 +65,14 @@ int snprintf(char *str, size_t size, const char *format, ...);
 
 #define DEFAULT_COLLECT_REXMITS 15
 
+/* send holds back its producers while this many packets wait in the
+   sending queue of collect, which takes 3/4 of the queue buffers. */
+#ifdef SHELL_RIME_CONF_SEND_QUEUE_LIMIT
+#define SEND_QUEUE_LIMIT SHELL_RIME_CONF_SEND_QUEUE_LIMIT
+#else
+#define SEND_QUEUE_LIMIT (3 * QUEUEBUF_NUM / 8)
+#endif
+
 
 #define COLLECT_MSG_HDRSIZE 4
 struct collect_msg {
@@ -251,8 +259,10 @@ PROCESS_THREAD(shell_send_process, ev, data)
   int len;
   struct collect_msg *msg;
   static int num_rexmits;
+  static struct etimer etimer;
   const char *next;
 
+  PROCESS_EXITHANDLER(shell_set_busy(&send_command, 0));
   PROCESS_BEGIN();
 
   num_rexmits = shell_strtolong((char *)data, &next);
@@ -264,7 +274,18 @@ PROCESS_THREAD(shell_send_process, ev, data)
   }
 
   while(1) {
-    PROCESS_WAIT_EVENT_UNTIL(ev == shell_event_input);
+    PROCESS_WAIT_EVENT_UNTIL(ev == shell_event_input ||
+			     (ev == PROCESS_EVENT_TIMER && data == &etimer));
+    if(ev == PROCESS_EVENT_TIMER) {
+      /* Collect has no callback for sent packets, so the queue is
+	 polled while the producers are held back. */
+      if(packetqueue_len(&shell_collect_conn.send_queue) < SEND_QUEUE_LIMIT) {
+	shell_set_busy(&send_command, 0);
+      } else {
+	etimer_reset(&etimer);
+      }
+      continue;
+    }
     input = data;
 
     len = input->len1 + input->len2;
@@ -286,6 +307,11 @@ PROCESS_THREAD(shell_send_process, ev, data)
 #endif
       msg->crc = crc16_data(msg->data, len, 0);
       collect_send(&shell_collect_conn, num_rexmits);
+      if(!send_command.busy &&
+	 packetqueue_len(&shell_collect_conn.send_queue) >= SEND_QUEUE_LIMIT) {
+	shell_set_busy(&send_command, 1);
+	etimer_set(&etimer, CLOCK_SECOND / 16);
+      }
     }
   }
   PROCESS_END();
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Shell command that lists the CPU time used by each process.
+ *
+ *         Requires PROCESS_CONF_CPU_STATS. For every process the share of
+ *         the uptime, the share since the previous invocation of top and
+ *         the number of handled events are shown.
+ */
+
+#include "contiki.h"
+#include "shell-top.h"
+#include "sys/rtimer.h"
+
+#include <stdio.h>
+
+/*---------------------------------------------------------------------------*/
+PROCESS(shell_top_process, "top");
+SHELL_COMMAND(top_command,
+	      "top",
+	      "top: list the CPU time used by each process",
+	      &shell_top_process);
+/*---------------------------------------------------------------------------*/
+#if PROCESS_CONF_CPU_STATS
+static clock_time_t last_sample;
+/*---------------------------------------------------------------------------*/
+static unsigned long
+clock_to_rtimer(clock_time_t t)
+{
+  return (t / CLOCK_SECOND) * RTIMER_SECOND +
+    (t % CLOCK_SECOND) * RTIMER_SECOND / CLOCK_SECOND;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned
+permille(unsigned long part, unsigned long whole)
+{
+  /* Scale both down until part * 1000 does not overflow */
+  while(part > 0xffffffffUL / 1000) {
+    part >>= 1;
+    whole >>= 1;
+  }
+  if(whole == 0) {
+    return 0;
+  }
+  part = part * 1000 / whole;
+  return part > 1000 ? 1000 : part;
+}
+#endif /* PROCESS_CONF_CPU_STATS */
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(shell_top_process, ev, data)
+{
+#if PROCESS_CONF_CPU_STATS
+  struct process *p;
+  unsigned long uptime, interval;
+  unsigned total, recent;
+  clock_time_t now;
+  char buf[40];
+#endif
+  PROCESS_BEGIN();
+
+#if PROCESS_CONF_CPU_STATS
+  now = clock_time();
+  uptime = clock_to_rtimer(now);
+  interval = clock_to_rtimer(now - last_sample);
+  last_sample = now;
+
+  shell_output_str(&top_command, "  total recent events name", "");
+  for(p = PROCESS_LIST(); p != NULL; p = p->next) {
+    total = permille(p->cpu_time, uptime);
+    recent = permille(p->cpu_time - p->cpu_mark, interval);
+    p->cpu_mark = p->cpu_time;
+    snprintf(buf, sizeof(buf), "%3u.%u%% %3u.%u%% %6u ",
+             total / 10, total % 10, recent / 10, recent % 10,
+             p->cpu_events);
+    shell_output_str(&top_command, buf, PROCESS_NAME_STRING(p));
+  }
+#else
+  shell_output_str(&top_command, "top: PROCESS_CONF_CPU_STATS is disabled", "");
+#endif /* PROCESS_CONF_CPU_STATS */
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+shell_top_init(void)
+{
+  shell_register_command(&top_command);
+}
+/*---------------------------------------------------------------------------*/
@@ -68,6 +68,7 @@ static char shell_banner_text[] = "Contiki command shell";
 LIST(commands);
 
 int shell_event_input;
+int shell_event_ready;
 
 static struct process *front_process;
 
@@ -111,11 +112,23 @@ PROCESS_THREAD(shell_null_process, ev, data)
   PROCESS_END();
 }
 /*---------------------------------------------------------------------------*/
+/* Copies the name or description of a command out of program memory */
+static char *
+command_text(const char *text)
+{
+  static char buf[128];
+
+  PGM_STRNCPY(buf, text, sizeof(buf) - 1);
+  buf[sizeof(buf) - 1] = '\0';
+  return buf;
+}
+/*---------------------------------------------------------------------------*/
 static void
 command_kill(struct shell_command *c)
 {
   if(c != NULL) {
-    shell_output_str(&killall_command, "Stopping command ", c->command);
+    shell_output_str(&killall_command, "Stopping command ",
+                     command_text(c->command));
     process_exit(c->process);
   }
 }
@@ -158,7 +171,7 @@ PROCESS_THREAD(shell_kill_process, ev, data)
   for(c = list_head(commands);
       c != NULL;
       c = c->next) {
-    if(strcmp(name, c->command) == 0 &&
+    if(PGM_STRCMP(name, c->command) == 0 &&
        c != &kill_command &&
        process_is_running(c->process)) {
       command_kill(c);
@@ -180,7 +193,7 @@ PROCESS_THREAD(help_command_process, ev, data)
   for(c = list_head(commands);
       c != NULL;
       c = c->next) {
-    shell_output_str(&help_command, c->description, "");
+    shell_output_str(&help_command, command_text(c->description), "");
   }
 
   PROCESS_END();
@@ -282,8 +295,8 @@ start_command(char *commandline, struct shell_command *child)
      the command line. */
   for(c = list_head(commands);
       c != NULL &&
-	!(strncmp(c->command, commandline, command_len) == 0 &&
-	  c->command[command_len] == 0);
+	!(PGM_STRNCMP(commandline, c->command, command_len) == 0 &&
+	  PGM_READ_CHAR(&c->command[command_len]) == 0);
       c = c->next);
   
   if(c == NULL) {
@@ -296,6 +309,7 @@ start_command(char *commandline, struct shell_command *child)
     c = NULL;
   } else {
     c->child = child;
+    c->busy = 0;
     /*    printf("shell: start_command starting '%s'\n", c->process->name);*/
     /* Start a new process for the command. */
     process_start(c->process, args);
@@ -403,6 +417,35 @@ shell_output(struct shell_command *c,
   }
 }
 /*---------------------------------------------------------------------------*/
+int
+shell_output_ready(struct shell_command *c)
+{
+  for(c = c->child; c != NULL; c = c->child) {
+    if(c->busy && process_is_running(c->process)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+shell_set_busy(struct shell_command *c, int busy)
+{
+  struct shell_command *p, *q;
+
+  if(c->busy && !busy) {
+    c->busy = 0;
+    /* Wake up every command that has c later in its pipeline. */
+    for(p = list_head(commands); p != NULL; p = p->next) {
+      for(q = p->child; q != NULL && q != c; q = q->child);
+      if(q != NULL && process_is_running(p->process)) {
+	process_post(p->process, shell_event_ready, NULL);
+      }
+    }
+  }
+  c->busy = busy;
+}
+/*---------------------------------------------------------------------------*/
 void
 shell_unregister_command(struct shell_command *c)
 {
@@ -417,7 +460,7 @@ shell_register_command(struct shell_command *c)
   p = NULL;
   for(i = list_head(commands);
       i != NULL &&
-	strcmp(i->command, c->command) < 0;
+	PGM_STRCMP(command_text(i->command), c->command) < 0;
       i = i->next) {
     p = i;
   }
@@ -510,6 +553,7 @@ shell_init(void)
   shell_register_command(&quit_command);
   
   shell_event_input = process_alloc_event();
+  shell_event_ready = process_alloc_event();
   
   process_start(&shell_process, NULL);
   process_start(&shell_server_process, NULL);
@@ -61,6 +61,7 @@
 #define SHELL_H_
 
 #include "sys/process.h"
+#include "sys/pgm.h"
 
 /**
  * \brief      Holds a information about a shell command
@@ -72,10 +73,11 @@
  */
 struct shell_command {
   struct shell_command *next;
-  char *command;
-  char *description;
+  const char *command;     /* In program memory, see \ref pgm */
+  const char *description; /* In program memory */
   struct process *process;
   struct shell_command *child;
+  unsigned char busy;
 };
 
 /**
@@ -212,13 +214,16 @@ void shell_exit(void);
  *             This macro defines and declares a shell command (struct
  *             shell_command). This is used with the
  *             shell_register_command() function to register the
- *             command with the shell.
+ *             command with the shell. The name and the description
+ *             are kept in program memory.
  *
   * \hideinitializer
  */
 #define SHELL_COMMAND(name, command, description, process) \
-static struct shell_command name = { NULL, command, \
-                                     description, process }
+static const char name##_pgm_command[] PGM = command; \
+static const char name##_pgm_description[] PGM = description; \
+static struct shell_command name = { NULL, name##_pgm_command, \
+                                     name##_pgm_description, process }
 
 
 /**
@@ -257,6 +262,32 @@ void shell_output(struct shell_command *c,
 void shell_output_str(struct shell_command *c,
 		      char *str1, const char *str2);
 
+/**
+ * \brief      Check if the commands after a command take more data
+ * \param c    The command that outputs data
+ * \return     Non-zero if no command later in the pipeline is busy
+ *
+ *             Commands that produce data in bulk, such as read,
+ *             check this before each output. When it returns zero,
+ *             they wait for a shell_event_ready event instead of
+ *             producing more data.
+ *
+ */
+int shell_output_ready(struct shell_command *c);
+
+/**
+ * \brief      Tell the commands that feed a command to hold back
+ * \param c    The command that receives the data
+ * \param busy Non-zero if the command cannot take more data now
+ *
+ *             A command that cannot keep up with its input, such as
+ *             send waiting for the radio, marks itself busy. When
+ *             it is no longer busy, each command that feeds it gets
+ *             a shell_event_ready event.
+ *
+ */
+void shell_set_busy(struct shell_command *c, int busy);
+
 /**
  * \brief      Register a command with the shell
  * \param c    A pointer to a shell command structure, defined with SHELL_COMMAND()
@@ -352,6 +383,16 @@ enum shell_retval {
  */
 extern int shell_event_input;
 
+/**
+ * \brief      The event number for a pipeline that is ready again
+ *
+ *             This event is posted to the commands that feed a
+ *             command when that command stops being busy, see
+ *             shell_set_busy().
+ *
+ */
+extern int shell_event_ready;
+
 /**
  * \brief      Structure for shell input data
  *
@@ -376,14 +417,17 @@ struct shell_input {
 #include "shell-blink.h"
 #include "shell-collect-view.h"
 #include "shell-coffee.h"
+#include "shell-diskio.h"
 #include "shell-download.h"
 #include "shell-exec.h"
 #include "shell-file.h"
 #include "shell-httpd.h"
 #include "shell-irc.h"
+#include "shell-isr.h"
 #include "shell-memdebug.h"
 #include "shell-netfile.h"
 #include "shell-netperf.h"
+#include "shell-netperf6.h"
 #include "shell-netstat.h"
 #include "shell-ping.h"
 #include "shell-power.h"
@@ -406,6 +450,7 @@ struct shell_input {
 #include "shell-tcpsend.h"
 #include "shell-text.h"
 #include "shell-time.h"
+#include "shell-top.h"
 #include "shell-udpsend.h"
 #include "shell-vars.h"
 #include "shell-wget.h"
@@ -53,6 +53,11 @@ AUTOSTART_PROCESSES(&telnetd_process);
 #ifndef TELNETD_CONF_NUMLINES
 #define TELNETD_CONF_NUMLINES 25
 #endif
+/* Output that does not fill a segment is held back this long, so that
+   the lines of a command go out in as few segments as possible. */
+#ifndef TELNETD_CONF_FLUSH_TIME
+#define TELNETD_CONF_FLUSH_TIME (CLOCK_SECOND / 16)
+#endif
 
 #ifdef TELNETD_CONF_REJECT
 extern char telnetd_reject_text[];
@@ -65,6 +70,7 @@ struct telnetd_state {
   char buf[TELNETD_CONF_LINELEN + 1];
   char bufptr;
   uint16_t numsent;
+  uint8_t flush;
   uint8_t state;
 #define STATE_NORMAL 0
 #define STATE_IAC    1
@@ -74,6 +80,8 @@ struct telnetd_state {
 #define STATE_DONT   5
 #define STATE_CLOSE  6
   struct timer silence_timer;
+  struct ctimer flush_timer;
+  struct uip_conn *conn;
 };
 static struct telnetd_state s;
 
@@ -149,6 +157,29 @@ buf_len(struct telnetd_buf *buf)
   return buf->ptr;
 }
 /*---------------------------------------------------------------------------*/
+static void
+flush(void *ptr)
+{
+  s.flush = 1;
+  if(connected) {
+    tcpip_poll_tcp(s.conn);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+output_added(void)
+{
+  if(!connected) {
+    return;
+  }
+  if(buf_len(&buf) >= s.conn->mss) {
+    /* A full segment is ready. */
+    tcpip_poll_tcp(s.conn);
+  } else if(ctimer_expired(&s.flush_timer)) {
+    ctimer_set(&s.flush_timer, TELNETD_CONF_FLUSH_TIME, flush, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
 void
 telnetd_quit(void)
 {
@@ -164,6 +195,8 @@ void
 shell_prompt(char *str)
 {
   buf_append(&buf, str, (int)strlen(str));
+  /* The command is done, the user is waiting for the prompt. */
+  flush(NULL);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -184,6 +217,7 @@ shell_default_output(const char *str1, int len1, const char *str2, int len2)
   buf_append(&buf, str1, len1);
   buf_append(&buf, str2, len2);
   buf_append(&buf, "\r\n", 2);
+  output_added();
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -226,13 +260,31 @@ static void
 acked(void)
 {
   buf_pop(&buf, s.numsent);
+  s.numsent = 0;
 }
 /*---------------------------------------------------------------------------*/
 static void
 senddata(void)
 {
   int len;
-  len = MIN(buf_len(&buf), uip_mss());
+
+  if(uip_rexmit()) {
+    /* The segment must be sent again as it was. */
+    len = s.numsent;
+  } else if(s.numsent > 0) {
+    /* Only one segment of ours is unacknowledged at a time; with a TCP
+       send window, uIP acknowledges it once it is buffered. */
+    return;
+  } else {
+    len = MIN(buf_len(&buf), uip_mss());
+    if(len < uip_mss() && !s.flush) {
+      /* Wait for more output to fill the segment. */
+      return;
+    }
+    if(len == buf_len(&buf)) {
+      s.flush = 0;
+    }
+  }
   PRINTF("senddata len %d\n", len);
   buf_copyto(&buf, uip_appdata, len);
   uip_send(uip_appdata, len);
@@ -274,6 +326,7 @@ sendopt(uint8_t option, uint8_t value)
   line[3] = 0;
   petsciiconv_topetscii(line, 4);
   buf_append(&buf, line, 4);
+  s.flush = 1;
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -356,6 +409,9 @@ telnetd_appcall(void *ts)
     if(!connected) {
       buf_init(&buf);
       s.bufptr = 0;
+      s.numsent = 0;
+      s.flush = 0;
+      s.conn = uip_conn;
       s.state = STATE_NORMAL;
       connected = 1;
       shell_start();
@@ -379,6 +435,7 @@ telnetd_appcall(void *ts)
        uip_timedout()) {
       shell_stop();
       connected = 0;
+      ctimer_stop(&s.flush_timer);
     }
     if(uip_acked()) {
       timer_set(&s.silence_timer, MAX_SILENCE_TIME);
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *	A test program for the microbenchmark library.
+ */
+
+#include "contiki.h"
+#include "lib/memb.h"
+#include "lib/list.h"
+#include "lib/crc16.h"
+#include "net/mac/frame802154.h"
+#include "unit-bench.h"
+
+#include <string.h>
+
+struct item {
+  struct item *next;
+  uint8_t data[8];
+};
+
+MEMB(items, struct item, 4);
+LIST(item_list);
+
+static struct item item;
+static uint8_t buf[128];
+static unsigned short crc;
+
+/* A data frame with compressed PAN ID and long addresses */
+static uint8_t frame[] = {
+  0x41, 0xcc, 0x2a, 0xcd, 0xab,
+  0x08, 0x07, 0x06, 0x05, 0x04, 0x03, 0x02, 0x01,
+  0x18, 0x17, 0x16, 0x15, 0x14, 0x13, 0x12, 0x11,
+  'H', 'e', 'l', 'l', 'o'
+};
+static frame802154_t parsed;
+
+/* Register the benchmarks together with the number of runs. */
+UNIT_BENCH_REGISTER(memb_alloc, "memb_alloc", 64);
+UNIT_BENCH_REGISTER(list_add, "list_add", 64);
+UNIT_BENCH_REGISTER(crc16, "crc16_data 128 bytes", 64);
+UNIT_BENCH_REGISTER(frame802154_parse, "frame802154_parse", 64);
+
+PROCESS(bench_process, "Unit benchmarks");
+AUTOSTART_PROCESSES(&bench_process);
+
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static struct item *allocated;
+
+  PROCESS_BEGIN();
+
+  memb_init(&items);
+  list_init(item_list);
+  memset(buf, 0x55, sizeof(buf));
+
+  /* The allocation is freed after every run without being measured. */
+  UNIT_BENCH_RUN_SETUP(memb_alloc, ,
+                       allocated = memb_alloc(&items),
+                       memb_free(&items, allocated));
+
+  UNIT_BENCH_RUN_SETUP(list_add, ,
+                       list_add(item_list, &item),
+                       list_remove(item_list, &item));
+
+  UNIT_BENCH_RUN(crc16, crc = crc16_data(buf, sizeof(buf), 0));
+
+  UNIT_BENCH_RUN(frame802154_parse,
+                 frame802154_parse(frame, sizeof(frame), &parsed));
+
+  PROCESS_END();
+}
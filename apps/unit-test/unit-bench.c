@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *	Microbenchmarks for Contiki software.
+ */
+
+#include <stdio.h>
+
+#include "unit-bench.h"
+
+#if CONTIKI_TARGET_NATIVE && !defined(UNIT_BENCH_CONF_NOW)
+#include <time.h>
+
+/*---------------------------------------------------------------------------*/
+unit_bench_ticks_t
+unit_bench_native_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unit_bench_ticks_t)(ts.tv_sec * 1000000000UL + ts.tv_nsec);
+}
+#endif /* CONTIKI_TARGET_NATIVE */
+/*---------------------------------------------------------------------------*/
+/**
+ * Subtract the calibrated overhead from the samples of a benchmark and
+ * compute the minimum, median and maximum of them.
+ *
+ * The samples are sorted in place.
+ *
+ * \param ubp The benchmark descriptor.
+ */
+void
+unit_bench_evaluate(unit_bench_t *ubp)
+{
+  unit_bench_ticks_t ticks;
+  unsigned i, j;
+
+  if(ubp->runs == 0) {
+    return;
+  }
+
+  for(i = 0; i < ubp->runs; i++) {
+    ticks = ubp->samples[i];
+    ticks = ticks > ubp->overhead ? ticks - ubp->overhead : 0;
+
+    /* Insertion sort, the number of runs is small */
+    for(j = i; j > 0 && ubp->samples[j - 1] > ticks; j--) {
+      ubp->samples[j] = ubp->samples[j - 1];
+    }
+    ubp->samples[j] = ticks;
+  }
+
+  ubp->min = ubp->samples[0];
+  ubp->max = ubp->samples[ubp->runs - 1];
+  if(ubp->runs & 1) {
+    ubp->median = ubp->samples[ubp->runs / 2];
+  } else {
+    ubp->median = ubp->samples[ubp->runs / 2 - 1] +
+                  (ubp->samples[ubp->runs / 2] -
+                   ubp->samples[ubp->runs / 2 - 1]) / 2;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Print the results of a benchmark.
+ *
+ * \param ubp The benchmark descriptor.
+ */
+void
+unit_bench_print_report(const unit_bench_t *ubp)
+{
+  printf("\nUnit bench: %s\n", ubp->descr);
+  printf("Runs: %u\n", ubp->runs);
+  printf("Overhead: %lu\n", (unsigned long)ubp->overhead);
+  printf("Min: %lu\n", (unsigned long)ubp->min);
+  printf("Median: %lu\n", (unsigned long)ubp->median);
+  printf("Max: %lu\n", (unsigned long)ubp->max);
+  printf("Ticks per second: %lu\n", (unsigned long)UNIT_BENCH_SECOND);
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *	Microbenchmarks for Contiki software.
+ *
+ *	A benchmark executes a piece of code a number of times and measures
+ *	every run with the benchmark clock. The cost of reading the clock
+ *	is calibrated before each benchmark and subtracted. The report
+ *	gives the minimum, median and maximum of the runs; the median is
+ *	robust against runs that were hit by an interrupt.
+ *
+ *	The benchmark clock counts CPU cycles on AVRs that run the rtimer
+ *	on Timer3 (INGA, Raven), where Timer1 is used unprescaled, and
+ *	nanoseconds on the native platform. Elsewhere it falls back to the
+ *	rtimer. On AVR a single run must take less than 65536 cycles.
+ */
+
+#ifndef UNIT_BENCH_H
+#define UNIT_BENCH_H
+
+#include "contiki.h"
+#include "sys/rtimer.h"
+#ifdef __AVR__
+#include <avr/io.h>
+#endif
+
+#ifdef UNIT_BENCH_CONF_NOW
+/* The platform provides the benchmark clock */
+#define UNIT_BENCH_NOW()  UNIT_BENCH_CONF_NOW()
+#define UNIT_BENCH_SECOND UNIT_BENCH_CONF_SECOND
+#define UNIT_BENCH_ARCH_INIT()
+typedef UNIT_BENCH_CONF_TICKS_T unit_bench_ticks_t;
+#elif defined(__AVR__) && defined(TCNT1) && defined(TCNT3)
+#define UNIT_BENCH_NOW()  TCNT1
+#define UNIT_BENCH_SECOND F_CPU
+/* The radio interrupt uses the input capture of Timer1 regardless of
+   its prescaler, so it can run at the CPU clock */
+#define UNIT_BENCH_ARCH_INIT() (TCCR1B = (TCCR1B & ~0x07) | (1 << CS10))
+typedef uint16_t unit_bench_ticks_t;
+#elif CONTIKI_TARGET_NATIVE
+#define UNIT_BENCH_NOW()  unit_bench_native_now()
+#define UNIT_BENCH_SECOND 1000000000UL
+#define UNIT_BENCH_ARCH_INIT()
+typedef uint32_t unit_bench_ticks_t;
+unit_bench_ticks_t unit_bench_native_now(void);
+#else
+#define UNIT_BENCH_NOW()  RTIMER_NOW()
+#define UNIT_BENCH_SECOND RTIMER_SECOND
+#define UNIT_BENCH_ARCH_INIT()
+typedef rtimer_clock_t unit_bench_ticks_t;
+#endif
+
+/* Number of empty runs used to measure the cost of reading the clock */
+#ifndef UNIT_BENCH_CALIBRATION_RUNS
+#define UNIT_BENCH_CALIBRATION_RUNS 16
+#endif
+
+/**
+ * The unit_bench structure describes the results of a benchmark. Each
+ * registered benchmark statically allocates an object of this type and
+ * the samples of its runs.
+ */
+typedef struct unit_bench {
+  const char * const descr;
+  const unsigned runs;
+  unit_bench_ticks_t * const samples;
+  unit_bench_ticks_t overhead;
+  unit_bench_ticks_t min;
+  unit_bench_ticks_t median;
+  unit_bench_ticks_t max;
+} unit_bench_t;
+
+/**
+ * Register a benchmark.
+ *
+ * \param name The name of the benchmark.
+ * \param descr A string that briefly describes the benchmark.
+ * \param runs The number of times the benchmarked code is executed.
+ */
+#define UNIT_BENCH_REGISTER(name, descr, runs)                                \
+  static unit_bench_ticks_t unit_bench_samples_##name[runs];                   \
+  static unit_bench_t unit_bench_##name = {descr, runs,                        \
+                                           unit_bench_samples_##name, 0, 0, 0, 0}
+
+/*
+ * The benchmark result is printed with a function that is selected by
+ * defining UNIT_BENCH_PRINT_FUNCTION, which must be of the type
+ * "void (*)(const unit_bench_t *)". The default selection is
+ * unit_bench_print_report, which is available in unit-bench.c.
+ */
+#ifndef UNIT_BENCH_PRINT_FUNCTION
+#define UNIT_BENCH_PRINT_FUNCTION unit_bench_print_report
+#endif /* !UNIT_BENCH_PRINT_FUNCTION */
+
+/**
+ * Print a report of the last execution of a benchmark.
+ *
+ * \param name The name of the benchmark.
+ */
+#define UNIT_BENCH_PRINT_REPORT(name) UNIT_BENCH_PRINT_FUNCTION(&unit_bench_##name)
+
+/**
+ * Execute a benchmark with setup and cleanup code and print a report.
+ *
+ * The setup and cleanup code is executed before and after every run but
+ * is not measured, e.g. to free what the benchmarked code allocated.
+ *
+ * \param name The name of the benchmark.
+ * \param setup Code executed before every run.
+ * \param code The benchmarked code.
+ * \param cleanup Code executed after every run.
+ */
+#define UNIT_BENCH_RUN_SETUP(name, setup, code, cleanup)                      \
+  do {                                                                         \
+    unit_bench_t *ubp = &unit_bench_##name;                                    \
+    unit_bench_ticks_t unit_bench_start, unit_bench_ticks;                     \
+    unsigned unit_bench_i;                                                     \
+                                                                               \
+    UNIT_BENCH_ARCH_INIT();                                                    \
+    ubp->overhead = (unit_bench_ticks_t)~0;                                    \
+    for(unit_bench_i = 0; unit_bench_i < UNIT_BENCH_CALIBRATION_RUNS;          \
+        unit_bench_i++) {                                                      \
+      unit_bench_start = UNIT_BENCH_NOW();                                     \
+      unit_bench_ticks = UNIT_BENCH_NOW() - unit_bench_start;                  \
+      if(unit_bench_ticks < ubp->overhead) {                                   \
+        ubp->overhead = unit_bench_ticks;                                      \
+      }                                                                        \
+    }                                                                          \
+                                                                               \
+    for(unit_bench_i = 0; unit_bench_i < ubp->runs; unit_bench_i++) {          \
+      setup;                                                                   \
+      unit_bench_start = UNIT_BENCH_NOW();                                     \
+      code;                                                                    \
+      ubp->samples[unit_bench_i] = UNIT_BENCH_NOW() - unit_bench_start;        \
+      cleanup;                                                                 \
+    }                                                                          \
+                                                                               \
+    unit_bench_evaluate(ubp);                                                  \
+    UNIT_BENCH_PRINT_FUNCTION(ubp);                                            \
+  } while(0)
+
+/**
+ * Execute a benchmark and print a report on the results.
+ *
+ * \param name The name of the benchmark.
+ * \param code The benchmarked code, e.g. a function call.
+ */
+#define UNIT_BENCH_RUN(name, code) UNIT_BENCH_RUN_SETUP(name, , code, )
+
+/**
+ * Obtain the results of the last execution of a benchmark, in ticks
+ * of the benchmark clock with the calibrated overhead subtracted.
+ *
+ * \param name The name of the benchmark.
+ */
+#define UNIT_BENCH_MIN(name)    (unit_bench_##name.min)
+#define UNIT_BENCH_MEDIAN(name) (unit_bench_##name.median)
+#define UNIT_BENCH_MAX(name)    (unit_bench_##name.max)
+
+/* Subtracts the overhead from the samples and computes the results. */
+void unit_bench_evaluate(unit_bench_t *ubp);
+
+/* The default print function. */
+void unit_bench_print_report(const unit_bench_t *ubp);
+
+#endif /* !UNIT_BENCH_H */
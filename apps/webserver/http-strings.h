@@ -13,8 +13,12 @@ extern const char http_index_htm[11];
 extern const char http_index_html[12];
 extern const char http_404_html[10];
 extern const char http_referer[9];
+extern const char http_accept_encoding[17];
+extern const char http_gzip[5];
 extern const char http_header_200[85];
 extern const char http_header_404[92];
+extern const char http_header_406[97];
+extern const char http_content_encoding_gzip[48];
 extern const char http_content_type_plain[29];
 extern const char http_content_type_html[28];
 extern const char http_content_type_css [27];
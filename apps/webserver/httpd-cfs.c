@@ -72,6 +72,38 @@ MEMB(conns, struct httpd_state, CONNS);
 #define ISO_slash   0x2f
 
 /*---------------------------------------------------------------------------*/
+#if HTTPD_SENDFILE
+static unsigned short
+generate(void *state)
+{
+  struct httpd_state *s = (struct httpd_state *)state;
+
+  /* Called again for a retransmission, so always read from the
+     position of the first unacknowledged byte. */
+  cfs_seek(s->fd, s->pos, CFS_SEEK_SET);
+  s->len = cfs_read(s->fd, uip_appdata, uip_mss());
+  if(s->len < 0) {
+    s->len = 0;
+  }
+  return s->len;
+}
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(send_file(struct httpd_state *s))
+{
+  PSOCK_BEGIN(&s->sout);
+
+  s->size = cfs_seek(s->fd, 0, CFS_SEEK_END);
+  for(s->pos = 0; s->pos < s->size; s->pos += s->len) {
+    PSOCK_GENERATOR_SEND(&s->sout, generate, s);
+    if(s->len == 0) {
+      break;
+    }
+  }
+
+  PSOCK_END(&s->sout);
+}
+#else /* HTTPD_SENDFILE */
 static
 PT_THREAD(send_file(struct httpd_state *s))
 {
@@ -91,6 +123,7 @@ PT_THREAD(send_file(struct httpd_state *s))
       
   PSOCK_END(&s->sout);
 }
+#endif /* HTTPD_SENDFILE */
 /*---------------------------------------------------------------------------*/
 static
 PT_THREAD(send_string(struct httpd_state *s, const char *str))
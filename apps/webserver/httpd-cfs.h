@@ -35,6 +35,7 @@
 #define HTTPD_CFS_H_
 
 #include "contiki-net.h"
+#include "cfs/cfs.h"
 
 #ifndef WEBSERVER_CONF_CFS_PATHLEN
 #define HTTPD_PATHLEN 80
@@ -42,12 +43,23 @@
 #define HTTPD_PATHLEN WEBSERVER_CONF_CFS_PATHLEN
 #endif /* WEBSERVER_CONF_CFS_CONNS */
 
+/* Read files straight into uip_appdata, seek back on retransmissions */
+#ifndef WEBSERVER_CONF_CFS_SENDFILE
+#define HTTPD_SENDFILE 0
+#else /* WEBSERVER_CONF_CFS_SENDFILE */
+#define HTTPD_SENDFILE WEBSERVER_CONF_CFS_SENDFILE
+#endif /* WEBSERVER_CONF_CFS_SENDFILE */
+
 struct httpd_state {
   struct timer timer;
   struct psock sin, sout;
   struct pt outputpt;
   char inputbuf[HTTPD_PATHLEN + 30];
+#if HTTPD_SENDFILE
+  cfs_offset_t pos, size;
+#else /* HTTPD_SENDFILE */
   char outputbuf[UIP_TCP_MSS];
+#endif /* HTTPD_SENDFILE */
   char filename[HTTPD_PATHLEN];
   char state;
   int fd;
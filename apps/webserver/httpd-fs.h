@@ -43,6 +43,22 @@ struct httpd_fs_file {
   int len;
 };
 
+#ifdef HTTPD_FS_CONF_GZIP
+#define HTTPD_FS_GZIP HTTPD_FS_CONF_GZIP
+#else
+#define HTTPD_FS_GZIP 1
+#endif
+
+#if HTTPD_FS_GZIP
+/* Files precompressed by makefsdata -z are stored as gzip streams and
+   are recognized by the gzip magic bytes. */
+#define httpd_fs_is_gzip(file) ((file)->len > 2 &&                   \
+                                (file)->data[0] == (char)0x1f &&     \
+                                (file)->data[1] == (char)0x8b)
+#else
+#define httpd_fs_is_gzip(file) 0
+#endif
+
 /* file must be allocated by caller and will be filled in
    by the function. */
 int httpd_fs_open(const char *name, struct httpd_fs_file *file);
@@ -54,6 +54,12 @@
 #define STATE_WAITING 0
 #define STATE_OUTPUT  1
 
+/* What the client said in Accept-Encoding. Without the header any
+   content-coding is acceptable (RFC 2616, 14.3). */
+#define ENCODING_ANY      0
+#define ENCODING_GZIP     1
+#define ENCODING_IDENTITY 2
+
 #define SEND_STRING(s, str) PSOCK_SEND(s, (uint8_t *)str, (unsigned int)strlen(str))
 MEMB(conns, struct httpd_state, CONNS);
 
@@ -193,6 +199,10 @@ PT_THREAD(send_headers(struct httpd_state *s, const char *statushdr))
 
   SEND_STRING(&s->sout, statushdr);
 
+  if(httpd_fs_is_gzip(&s->file)) {
+    SEND_STRING(&s->sout, http_content_encoding_gzip);
+  }
+
   ptr = strrchr(s->filename, ISO_period);
   if(ptr == NULL) {
     ptr = http_content_type_binary;
@@ -229,6 +239,13 @@ PT_THREAD(handle_output(struct httpd_state *s))
 		   http_header_404));
     PT_WAIT_THREAD(&s->outputpt,
 		   send_file(s));
+  } else if(httpd_fs_is_gzip(&s->file) &&
+	    s->encoding == ENCODING_IDENTITY) {
+    /* Only the compressed copy is stored, and the client refuses it. */
+    s->file.len = 0;
+    PT_WAIT_THREAD(&s->outputpt,
+		   send_headers(s,
+		   http_header_406));
   } else {
     PT_WAIT_THREAD(&s->outputpt,
 		   send_headers(s,
@@ -281,6 +298,13 @@ PT_THREAD(handle_input(struct httpd_state *s))
       s->inputbuf[PSOCK_DATALEN(&s->sin) - 2] = 0;
       petsciiconv_topetscii(s->inputbuf, PSOCK_DATALEN(&s->sin) - 2);
       webserver_log(s->inputbuf);
+    } else if(strncmp(s->inputbuf, http_accept_encoding, 16) == 0) {
+      s->inputbuf[PSOCK_DATALEN(&s->sin) - 1] = 0;
+      if(strstr(s->inputbuf + 16, http_gzip) != NULL) {
+	s->encoding = ENCODING_GZIP;
+      } else {
+	s->encoding = ENCODING_IDENTITY;
+      }
     }
   }
   
@@ -316,6 +340,7 @@ httpd_appcall(void *state)
     PSOCK_INIT(&s->sout, (uint8_t *)s->inputbuf, sizeof(s->inputbuf) - 1);
     PT_INIT(&s->outputpt);
     s->state = STATE_WAITING;
+    s->encoding = ENCODING_ANY;
     /*    timer_set(&s->timer, CLOCK_SECOND * 100);*/
     s->timer = 0;
     handle_connection(s);
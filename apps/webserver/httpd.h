@@ -45,6 +45,7 @@ struct httpd_state {
   char inputbuf[50];
   char filename[20];
   char state;
+  char encoding;
   struct httpd_fs_file file;  
   int len;
   char *scriptptr;
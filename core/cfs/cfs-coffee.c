@@ -91,6 +91,45 @@
 #define COFFEE_EXTENDED_WEAR_LEVELLING	1
 #endif
 
+/*
+ * Collect garbage incrementally. When a file does not fit, only as many
+ * sectors are erased as needed instead of all erasable ones, and the
+ * remaining ones are erased one at a time by cfs_coffee_gc_process,
+ * which is started by the first cfs_open().
+ */
+#ifndef COFFEE_GC_INCREMENTAL
+#define COFFEE_GC_INCREMENTAL	0
+#endif
+
+/* Interval of cfs_coffee_gc_process in clock ticks. */
+#ifndef COFFEE_GC_INTERVAL
+#define COFFEE_GC_INTERVAL	(10 * CLOCK_SECOND)
+#endif
+
+/*
+ * Keep the number of free pages at the end of each sector in RAM. It is
+ * built with one scan of the headers at the first access and lets page
+ * reservations and the garbage collector skip free areas without reading
+ * them. COFFEE_SUMMARY_TYPE must be able to hold the pages per sector.
+ */
+#ifndef COFFEE_PAGE_SUMMARY
+#define COFFEE_PAGE_SUMMARY	0
+#endif
+
+#ifndef COFFEE_SUMMARY_TYPE
+#define COFFEE_SUMMARY_TYPE	coffee_page_t
+#endif
+
+/*
+ * Number of files in an in-RAM index of name hashes and header pages,
+ * which is built together with the page summary. Names that are not in
+ * a complete index do not need a scan of the file system. 0 disables
+ * the index.
+ */
+#ifndef COFFEE_NAME_INDEX
+#define COFFEE_NAME_INDEX	0
+#endif
+
 #if COFFEE_START & (COFFEE_SECTOR_SIZE - 1)
 #error COFFEE_START must point to the first byte in a sector.
 #endif
@@ -113,6 +152,10 @@
 #define GC_GREEDY		0
 /* "Reluctant" garbage collection stops after erasing one sector. */
 #define GC_RELUCTANT		1
+/* A garbage collection step erases one sector with obsolete pages, or
+   the sectors of one obsolete extent spanning them. Following steps
+   continue after it until the last sector. */
+#define GC_STEP			2
 
 /* File descriptor macros. */
 #define FD_VALID(fd)					\
@@ -160,6 +203,8 @@ struct sector_status {
   coffee_page_t active;
   coffee_page_t obsolete;
   coffee_page_t free;
+  /* An obsolete extent covers the whole next sector as well. */
+  char spans_next;
 };
 
 /* The structure of cached file objects. */
@@ -218,6 +263,38 @@ static struct file_desc * const coffee_fd_set = protected_mem.coffee_fd_set;
 static coffee_page_t * const next_free = &protected_mem.next_free;
 static char * const gc_wait = &protected_mem.gc_wait;
 
+/* The sector where the next garbage collection step continues. */
+static uint16_t gc_sector;
+
+#if COFFEE_PAGE_SUMMARY || COFFEE_NAME_INDEX
+/* The summary and the index reflect the headers in the storage. */
+static char summary_built;
+#endif
+
+#if COFFEE_PAGE_SUMMARY
+/* The number of free pages at the end of each sector. */
+static COFFEE_SUMMARY_TYPE free_tail[COFFEE_SECTOR_COUNT];
+#endif
+
+#if COFFEE_NAME_INDEX
+struct name_entry {
+  coffee_page_t page;
+  uint8_t hash;
+};
+
+static struct name_entry name_index[COFFEE_NAME_INDEX];
+static uint8_t name_index_count;
+/* All active files are in the index. */
+static char name_index_complete;
+#endif
+
+#if COFFEE_GC_INCREMENTAL
+/* Files were removed since the last garbage collection step found nothing. */
+static char gc_pending = 1;
+
+PROCESS(cfs_coffee_gc_process, "Coffee GC");
+#endif
+
 /*---------------------------------------------------------------------------*/
 static void
 write_header(struct file_header *hdr, coffee_page_t page)
@@ -245,6 +322,109 @@ absolute_offset(coffee_page_t page, cfs_offset_t offset)
   return page * COFFEE_PAGE_SIZE + sizeof(struct file_header) + offset;
 }
 /*---------------------------------------------------------------------------*/
+#if COFFEE_NAME_INDEX
+static uint8_t
+name_hash(const char *name)
+{
+  uint8_t hash;
+  int i;
+
+  hash = 0;
+  for(i = 0; i < COFFEE_NAME_LENGTH && name[i] != '\0'; i++) {
+    hash = hash * 31 + name[i];
+  }
+  return hash;
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_add(coffee_page_t page, const char *name)
+{
+  if(name_index_count == COFFEE_NAME_INDEX) {
+    name_index_complete = 0;
+    return;
+  }
+  name_index[name_index_count].page = page;
+  name_index[name_index_count].hash = name_hash(name);
+  name_index_count++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_remove(coffee_page_t page)
+{
+  int i;
+
+  for(i = 0; i < name_index_count; i++) {
+    if(name_index[i].page == page) {
+      name_index[i] = name_index[--name_index_count];
+      return;
+    }
+  }
+}
+#endif /* COFFEE_NAME_INDEX */
+/*---------------------------------------------------------------------------*/
+#if COFFEE_PAGE_SUMMARY
+static void
+summary_reserve(coffee_page_t start, coffee_page_t pages)
+{
+  coffee_page_t end, sector_end;
+  uint16_t sector;
+
+  /* The reserved pages were free, so whatever follows them in the last
+     sector is still free. */
+  end = start + pages;
+  for(sector = start / COFFEE_PAGES_PER_SECTOR;
+      sector * COFFEE_PAGES_PER_SECTOR < end; sector++) {
+    sector_end = (sector + 1) * COFFEE_PAGES_PER_SECTOR;
+    free_tail[sector] = end < sector_end ? sector_end - end : 0;
+  }
+}
+#endif /* COFFEE_PAGE_SUMMARY */
+/*---------------------------------------------------------------------------*/
+#if COFFEE_PAGE_SUMMARY || COFFEE_NAME_INDEX
+static coffee_page_t next_file(coffee_page_t page, struct file_header *hdr);
+
+static void
+build_summary(void)
+{
+  struct file_header hdr;
+  coffee_page_t page;
+
+#if COFFEE_PAGE_SUMMARY
+  memset(free_tail, 0, sizeof(free_tail));
+#endif
+#if COFFEE_NAME_INDEX
+  name_index_count = 0;
+  name_index_complete = 1;
+#endif
+
+  for(page = 0; page < COFFEE_PAGE_COUNT; page = next_file(page, &hdr)) {
+    read_header(&hdr, page);
+#if COFFEE_PAGE_SUMMARY
+    if(HDR_FREE(hdr)) {
+      free_tail[page / COFFEE_PAGES_PER_SECTOR] =
+        COFFEE_PAGES_PER_SECTOR - page % COFFEE_PAGES_PER_SECTOR;
+    }
+#endif
+#if COFFEE_NAME_INDEX
+    if(HDR_ACTIVE(hdr) && !HDR_LOG(hdr)) {
+      index_add(page, hdr.name);
+    }
+#endif
+  }
+
+  summary_built = 1;
+  PRINTF("Coffee: Built the page summary and name index\n");
+}
+/*---------------------------------------------------------------------------*/
+static void
+check_summary(void)
+{
+  if(!summary_built) {
+    build_summary();
+  }
+}
+#endif /* COFFEE_PAGE_SUMMARY || COFFEE_NAME_INDEX */
+/*---------------------------------------------------------------------------*/
 static coffee_page_t
 get_sector_status(uint16_t sector, struct sector_status *stats)
 {
@@ -287,6 +467,7 @@ get_sector_status(uint16_t sector, struct sector_status *stats)
     if(skip_pages >= COFFEE_PAGES_PER_SECTOR) {
       stats->obsolete = COFFEE_PAGES_PER_SECTOR;
       skip_pages -= COFFEE_PAGES_PER_SECTOR;
+      stats->spans_next = skip_pages >= COFFEE_PAGES_PER_SECTOR;
       return skip_pages >= COFFEE_PAGES_PER_SECTOR ? 0 : skip_pages;
     }
     obsolete = skip_pages;
@@ -295,6 +476,14 @@ get_sector_status(uint16_t sector, struct sector_status *stats)
   /* Determine the amount of pages of each type that have not been 
      accounted for yet in the current sector. */
   for(page = sector_start + skip_pages; page < sector_end;) {
+#if COFFEE_PAGE_SUMMARY
+    /* The free pages at the end need not be read. */
+    if(page >= sector_end - free_tail[sector]) {
+      last_pages_are_active = 0;
+      free = sector_end - page;
+      break;
+    }
+#endif
     read_header(&hdr, page);
     last_pages_are_active = 0;
     if(HDR_ACTIVE(hdr)) {
@@ -333,6 +522,8 @@ get_sector_status(uint16_t sector, struct sector_status *stats)
   stats->active = active;
   stats->obsolete = obsolete;
   stats->free = free;
+  stats->spans_next = !last_pages_are_active &&
+	(skip_pages >= COFFEE_PAGES_PER_SECTOR);
 
   /*
    * To avoid unnecessary page isolation, we notify the caller that 
@@ -365,15 +556,20 @@ isolate_pages(coffee_page_t start, coffee_page_t skip_pages)
 
 }
 /*---------------------------------------------------------------------------*/
-static void
+static int
 collect_garbage(int mode)
 {
   uint16_t sector;
   struct sector_status stats;
   coffee_page_t first_page, isolation_count;
+  int erased = 0;
 
   PRINTF("Coffee: Running the file system garbage collector in %s mode\n",
-	 mode == GC_RELUCTANT ? "reluctant" : "greedy");
+	 mode == GC_RELUCTANT ? "reluctant" :
+	 mode == GC_STEP ? "step" : "greedy");
+#if COFFEE_PAGE_SUMMARY || COFFEE_NAME_INDEX
+  check_summary();
+#endif
   /*
    * The garbage collector erases as many sectors as possible. A sector is
    * erasable if there are only free or obsolete pages in it.
@@ -384,12 +580,12 @@ collect_garbage(int mode)
         sector, (unsigned)stats.active,
 	(unsigned)stats.obsolete, (unsigned)stats.free);
 
-    if(stats.active > 0) {
+    if(stats.active > 0 || (mode == GC_STEP && sector < gc_sector)) {
       continue;
     }
 
     if((mode == GC_RELUCTANT && stats.free == 0) ||
-       (mode == GC_GREEDY && stats.obsolete > 0)) {
+       (mode != GC_RELUCTANT && stats.obsolete > 0)) {
       first_page = sector * COFFEE_PAGES_PER_SECTOR;
       if(first_page < *next_free) {
         *next_free = first_page;
@@ -401,12 +597,35 @@ collect_garbage(int mode)
 
       COFFEE_ERASE(sector);
       PRINTF("Coffee: Erased sector %d!\n", sector);
+      erased++;
+
+      /* The pages of the next sector are not isolated in this case,
+         so it has to be erased in the same step. */
+      if(mode == GC_STEP && !stats.spans_next) {
+        gc_sector = sector + 1;
+        break;
+      }
 
       if(mode == GC_RELUCTANT && isolation_count > 0) {
         break;
       }
     }
   }
+
+  if(mode == GC_STEP && erased == 0) {
+    /* The next step starts a new pass. */
+    gc_sector = 0;
+  }
+
+#if COFFEE_PAGE_SUMMARY
+  /* An erased sector may still be covered by an obsolete extent that
+     starts in a sector that was kept, so the summary is rebuilt. */
+  if(erased > 0) {
+    summary_built = 0;
+  }
+#endif
+
+  return erased;
 }
 /*---------------------------------------------------------------------------*/
 static coffee_page_t
@@ -478,6 +697,9 @@ find_file(const char *name)
   int i;
   struct file_header hdr;
   coffee_page_t page;
+#if COFFEE_NAME_INDEX
+  uint8_t hash;
+#endif
   
   /* First check if the file metadata is cached. */
   for(i = 0; i < COFFEE_MAX_OPEN_FILES; i++) {
@@ -491,6 +713,24 @@ find_file(const char *name)
     }
   }
   
+#if COFFEE_NAME_INDEX
+  check_summary();
+  hash = name_hash(name);
+  for(i = 0; i < name_index_count; i++) {
+    if(name_index[i].hash != hash) {
+      continue;
+    }
+    read_header(&hdr, name_index[i].page);
+    if(HDR_ACTIVE(hdr) && !HDR_LOG(hdr) && strcmp(name, hdr.name) == 0) {
+      return load_file(name_index[i].page, &hdr);
+    }
+  }
+
+  if(name_index_complete) {
+    return NULL;
+  }
+#endif /* COFFEE_NAME_INDEX */
+
   /* Scan the flash memory sequentially otherwise. */
   for(page = 0; page < COFFEE_PAGE_COUNT; page = next_file(page, &hdr)) {
     read_header(&hdr, page);
@@ -540,6 +780,39 @@ static coffee_page_t
 find_contiguous_pages(coffee_page_t amount)
 {
   coffee_page_t page, start;
+#if COFFEE_PAGE_SUMMARY
+  coffee_page_t sector_end;
+
+  check_summary();
+
+  /* The same search as below, but the free pages of each sector are
+     known without reading any headers. */
+  start = INVALID_PAGE;
+  for(page = *next_free; page < COFFEE_PAGE_COUNT;) {
+    sector_end = (page / COFFEE_PAGES_PER_SECTOR + 1) * COFFEE_PAGES_PER_SECTOR;
+    if(page < sector_end - free_tail[page / COFFEE_PAGES_PER_SECTOR]) {
+      start = INVALID_PAGE;
+      page = sector_end - free_tail[page / COFFEE_PAGES_PER_SECTOR];
+      continue;
+    }
+
+    if(start == INVALID_PAGE) {
+      start = page;
+      if(start + amount >= COFFEE_PAGE_COUNT) {
+        break;
+      }
+    }
+
+    page = sector_end;
+    if(start + amount <= page) {
+      if(start == *next_free) {
+        *next_free = start + amount;
+      }
+      return start;
+    }
+  }
+  return INVALID_PAGE;
+#else /* COFFEE_PAGE_SUMMARY */
   struct file_header hdr;
 
   start = INVALID_PAGE;
@@ -570,6 +843,7 @@ find_contiguous_pages(coffee_page_t amount)
     }
   }
   return INVALID_PAGE;
+#endif /* COFFEE_PAGE_SUMMARY */
 }
 /*---------------------------------------------------------------------------*/
 static int
@@ -592,8 +866,14 @@ remove_by_page(coffee_page_t page, int remove_log, int close_fds,
 
   hdr.flags |= HDR_FLAG_OBSOLETE;
   write_header(&hdr, page);
+#if COFFEE_NAME_INDEX
+  index_remove(page);
+#endif
 
   *gc_wait = 0;
+#if COFFEE_GC_INCREMENTAL
+  gc_pending = 1;
+#endif
 
   /* Close all file descriptors that reference the removed file. */
   if(close_fds) {
@@ -645,8 +925,15 @@ reserve(const char *name, coffee_page_t pages,
     if(*gc_wait) {
       return NULL;
     }
+#if COFFEE_GC_INCREMENTAL
+    /* Erase only until the file fits. */
+    while(page == INVALID_PAGE && collect_garbage(GC_STEP) > 0) {
+      page = find_contiguous_pages(pages);
+    }
+#else
     collect_garbage(GC_GREEDY);
     page = find_contiguous_pages(pages);
+#endif
     if(page == INVALID_PAGE) {
       *gc_wait = 1;
       return NULL;
@@ -658,6 +945,14 @@ reserve(const char *name, coffee_page_t pages,
   hdr.max_pages = pages;
   hdr.flags = HDR_FLAG_ALLOCATED | flags;
   write_header(&hdr, page);
+#if COFFEE_PAGE_SUMMARY
+  summary_reserve(page, pages);
+#endif
+#if COFFEE_NAME_INDEX
+  if(!(flags & HDR_FLAG_LOG)) {
+    index_add(page, hdr.name);
+  }
+#endif
 
   PRINTF("Coffee: Reserved %u pages starting from %u for file %s\n",
       pages, page, name);
@@ -1002,6 +1297,11 @@ cfs_open(const char *name, int flags)
   int fd;
   struct file_desc *fdp;
 
+#if COFFEE_GC_INCREMENTAL
+  /* Does nothing if the process is running already. */
+  process_start(&cfs_coffee_gc_process, NULL);
+#endif
+
   fd = get_available_fd();
   if(fd < 0) {
     PRINTF("Coffee: Failed to allocate a new file descriptor!\n");
@@ -1354,12 +1654,51 @@ cfs_coffee_format(void)
 
   /* Formatting invalidates the file information. */
   memset(&protected_mem, 0, sizeof(protected_mem));
+#if COFFEE_PAGE_SUMMARY || COFFEE_NAME_INDEX
+  summary_built = 0;
+#endif
 
   PRINTF(" done!\n");
 
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+int
+cfs_coffee_gc_step(void)
+{
+  if(collect_garbage(GC_STEP) == 0) {
+#if COFFEE_GC_INCREMENTAL
+    gc_pending = 0;
+#endif
+    return 0;
+  }
+
+  *gc_wait = 0;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+#if COFFEE_GC_INCREMENTAL
+PROCESS_THREAD(cfs_coffee_gc_process, ev, data)
+{
+  static struct etimer et;
+
+  PROCESS_BEGIN();
+
+  etimer_set(&et, COFFEE_GC_INTERVAL);
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+    etimer_reset(&et);
+
+    /* One sector per step, other processes run in between. */
+    while(gc_pending && cfs_coffee_gc_step()) {
+      PROCESS_PAUSE();
+    }
+  }
+
+  PROCESS_END();
+}
+#endif /* COFFEE_GC_INCREMENTAL */
+/*---------------------------------------------------------------------------*/
 void *
 cfs_coffee_get_protected_mem(unsigned *size)
 {
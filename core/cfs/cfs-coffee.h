@@ -126,6 +126,21 @@ int cfs_coffee_set_io_semantics(int fd, unsigned flags);
  */
 int cfs_coffee_format(void);
 
+/**
+ * \brief Erase one sector that holds obsolete pages only.
+ * \return 1 if a sector was erased, 0 if there is nothing to collect.
+ *
+ * Coffee normally collects garbage when a file does not fit, erasing 
+ * all sectors it can at once. Calling this function regularly spreads 
+ * the erase operations over time. With COFFEE_GC_INCREMENTAL set, 
+ * cfs_coffee_gc_process does so in the background.
+ */
+int cfs_coffee_gc_step(void);
+
+#if COFFEE_GC_INCREMENTAL
+PROCESS_NAME(cfs_coffee_gc_process);
+#endif
+
 /**
  * \brief Points out a memory region that may not be altered during
  * checkpointing operations that use the file system.
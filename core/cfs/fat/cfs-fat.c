@@ -48,6 +48,17 @@
  */
 
 #include "cfs-fat.h"
+#include "lib/assert.h"
+
+#if FAT_DISCARD_RUNS && !defined(FAT_COOPERATIVE)
+#define FAT_DISCARD 1
+#else
+#define FAT_DISCARD 0
+#endif
+
+#if FAT_SYNC_INTERVAL || FAT_DISCARD
+#include "contiki.h"
+#endif
 
 #ifndef CFS_FAT_DEBUG
 #define CFS_FAT_DEBUG 1
@@ -76,31 +87,153 @@
 #define ATTR_DIRECTORY 0x10
 #define ATTR_ARCHIVE   0x20
 #define ATTR_LONG_NAME (ATTR_READ_ONLY | ATTR_HIDDEN | ATTR_SYSTEM | ATTR_VOLUME_ID)
+#define ATTR_LONG_NAME_MASK (ATTR_LONG_NAME | ATTR_DIRECTORY | ATTR_ARCHIVE)
+
+/* Long name entries */
+#define LFN_LAST_ENTRY    0x40
+#define LFN_ORD_MASK      0x1F
+#define LFN_CHARS         13
+#define LFN_CHECKSUM_OFF  13
 
 #define FAT_FLAG_FREE     0x00
 #define FAT_FLAG_DELETED  0xE5
 
-uint8_t sector_buffer[512];
-uint32_t sector_buffer_addr = 0;
-uint8_t sector_buffer_dirty = 0;
+/** One cached sector.
+ * An address of 0 marks the entry as unused.
+ */
+struct sector_cache_entry {
+  uint8_t buffer[512];
+  uint32_t addr;
+  uint8_t dirty;
+  /** Value of sector_cache_clock at last access, used for LRU eviction */
+  uint16_t last_used;
+};
+
+#if FAT_DIR_CACHE_SIZE > 0
+/** Remembers where recently resolved path parts are located. */
+struct dir_cache_entry {
+  /** First sector of the parent directory, 0 marks the entry as unused */
+  uint32_t parent;
+  uint32_t dir_entry_sector;
+  uint16_t dir_entry_offset;
+  /** Copy of the directory entry, also holds the name used as key */
+  struct dir_entry dir_entry;
+#if FAT_LFN
+  /** Hash of the path part the entry was found with */
+  uint32_t name_hash;
+#endif
+};
+#endif
+
+#if FAT_READ_AHEAD > 0 && !defined(FAT_COOPERATIVE)
+#define READ_AHEAD 1
+/** Number of continued reads after which a file counts as read sequentially */
+#define READ_AHEAD_SEQ_READS 2
+#else
+#define READ_AHEAD 0
+#endif
 
-uint16_t cfs_readdir_offset = 0;
+/*
+ * The cursor of an open directory, kept in the struct cfs_dir. cfs_readdir()
+ * follows the cluster chain one link per cluster of directory entries
+ * instead of walking it from the start for every entry.
+ */
+struct dir_cursor {
+  uint32_t cluster;       /* Cluster holding the entry index */
+  uint16_t cluster_pos;   /* Position of cluster in the chain */
+  uint16_t index;         /* Next entry to read */
+  uint8_t volume;
+};
+CTASSERT(sizeof (struct dir_cursor) <= sizeof (struct cfs_dir));
 
 struct file_system {
   struct diskio_device_info *dev;
   struct FAT_Info info;
   uint32_t first_data_sector;
-} mounted; // TODO: volume?
+  /** Highest cluster number that is available for data */
+  uint32_t max_cluster;
+  /** Cluster number to start searching for free clusters at */
+  uint32_t next_free;
+  /** Number of free clusters, FSI_UNKNOWN if unknown */
+  uint32_t free_count;
+  /** Sector number of the FSInfo structure, 0 if there is none */
+  uint16_t fsinfo_sector;
+  /** Set if next_free or free_count changed since FSInfo was read */
+  uint8_t fsinfo_dirty;
+#if FAT_SYNC
+  /** Range of sectors of the first FAT changed since the other FATs were
+   * synced, first > last if there is none */
+  uint32_t fat_dirty_first;
+  uint32_t fat_dirty_last;
+#endif
+#if FAT_DISCARD
+  /** Freed runs of clusters that were not erased yet */
+  struct cluster_run discard[FAT_DISCARD_RUNS];
+  uint8_t num_discard;
+#endif
+  /** Path prefix the volume is mounted at, NULL if not mounted */
+  const char *prefix;
+  struct sector_cache_entry sector_cache[FAT_SECTOR_CACHE_SIZE];
+  /** Entry that was accessed last. All sector buffer operations refer to it. */
+  struct sector_cache_entry *cur_sector;
+  /** Entries holding the FAT sector and data sector accessed last */
+  struct sector_cache_entry *pinned_fat_sector;
+  struct sector_cache_entry *pinned_data_sector;
+  uint16_t sector_cache_clock;
+#if READ_AHEAD
+  /** Sectors fetched ahead for sequential reads, bypassing the cache */
+  uint8_t read_ahead[FAT_READ_AHEAD * 512];
+  /** First sector held in read_ahead, 0 if there is none */
+  uint32_t read_ahead_addr;
+  uint8_t read_ahead_num;
+#endif
+#if FAT_DIR_CACHE_SIZE > 0
+  struct dir_cache_entry dir_cache[FAT_DIR_CACHE_SIZE];
+  /** Entry to be replaced next */
+  uint8_t dir_cache_next;
+#endif
+};
 
-#define CLUSTER_TO_SECTOR(cluster_num) (((cluster_num - 2) * mounted.info.BPB_SecPerClus) + mounted.first_data_sector)
-#define SECTOR_TO_CLUSTER(sector_num) (((sector_num - mounted.first_data_sector) / mounted.info.BPB_SecPerClus) + 2)
+static struct file_system volumes[FAT_MAX_VOLUMES];
+/** Volume all internal functions operate on, see select_volume() */
+static struct file_system *mounted = &volumes[0];
+
+/** FSInfo value for unknown free count or next free cluster */
+#define FSI_UNKNOWN 0xFFFFFFFF
+
+#define CLUSTER_TO_SECTOR(cluster_num) (((cluster_num - 2) * mounted->info.BPB_SecPerClus) + mounted->first_data_sector)
+#define SECTOR_TO_CLUSTER(sector_num) (((sector_num - mounted->first_data_sector) / mounted->info.BPB_SecPerClus) + 2)
+#define IS_FAT_SECTOR(sector_num) ((sector_num) >= mounted->info.BPB_RsvdSecCnt && (sector_num) < mounted->info.BPB_RsvdSecCnt + mounted->info.BPB_NumFATs * mounted->info.BPB_FATSz)
 
 struct PathResolver {
   uint16_t start, end;
   const char *path;
   char name[11];
+  /** Length of the current path part */
+  uint8_t len;
+  /** Set if name holds a valid 8.3 name for the current path part */
+  uint8_t valid;
+#if FAT_LFN
+  /** Case insensitive hash of the current path part */
+  uint32_t hash;
+#endif
+};
+
+#if FAT_LFN
+/** State of the long name entries read so far while scanning a directory */
+struct lfn_state {
+  /** Ordinal of the last long name entry read, 0 if there is none */
+  uint8_t ord;
+  /** Checksum of the short name the long name belongs to */
+  uint8_t checksum;
+  /** Set as long as the long name matches the searched path part */
+  uint8_t match;
 };
 
+/* Offsets of the 13 UCS-2 characters in a long name entry */
+static const uint8_t lfn_char_offsets[LFN_CHARS] = {1, 3, 5, 7, 9, 14, 16, 18, 20, 22, 24, 28, 30};
+#endif
+
 struct file fat_file_pool[FAT_FD_POOL_SIZE];
 struct file_desc fat_fd_pool[FAT_FD_POOL_SIZE];
 
@@ -120,14 +253,33 @@ extern QueueEntry queue[FAT_COOP_QUEUE_SIZE];
 extern uint16_t queue_start, queue_len;
 #endif
 
+#if FAT_SYNC_INTERVAL && !defined(FAT_COOPERATIVE)
+PROCESS(cfs_fat_sync_process, "FAT sync");
+#endif
+
+#if FAT_DISCARD
+PROCESS(cfs_fat_discard_process, "FAT discard");
+
+/** Maximum number of clusters erased at once by the discard process */
+#define DISCARD_STEP 64
+#endif
+
 /* Declerations */
 static uint8_t is_EOC(uint32_t fat_entry);
 static uint32_t get_free_cluster(uint32_t start_cluster);
-static uint16_t _get_free_cluster_16();
-static uint16_t _get_free_cluster_32();
-static uint32_t find_nth_cluster(uint32_t start_cluster, uint32_t n);
+static uint16_t _get_free_cluster_16(uint16_t start);
+static uint16_t _get_free_cluster_32(uint16_t start);
+static uint32_t get_free_cluster_run(uint32_t start_cluster, uint32_t count);
+static void reset_cluster_runs(struct file *file);
+static uint8_t add_cluster_to_runs(struct file *file, uint32_t cluster);
+static uint32_t find_file_cluster(struct file *file, uint32_t n);
+static void free_cluster_chain(uint32_t cluster);
 static void reset_cluster_chain(struct dir_entry *dir_ent);
-static void add_cluster_to_file(int fd);
+#if FAT_DISCARD
+static void discard_add(uint32_t start, uint16_t length);
+#endif
+static uint8_t add_cluster_to_file(int fd);
+static void trim_cluster_chain(int fd);
 static uint32_t read_fat_entry(uint32_t cluster_num);
 static void write_fat_entry(uint32_t cluster_num, uint32_t value);
 static void calc_fat_block(uint32_t cur_cluster, uint32_t *fat_sec_num, uint32_t *ent_offset);
@@ -135,14 +287,48 @@ static uint8_t _make_valid_name(const char *path, uint8_t start, uint8_t end, ch
 static void pr_reset(struct PathResolver *rsolv);
 static uint8_t pr_get_next_path_part(struct PathResolver *rsolv);
 static uint8_t pr_is_current_path_part_a_file(struct PathResolver *rsolv);
+static const char *select_volume(const char *path);
+static uint8_t select_file_volume(int fd);
+static void umount_volume();
+static void sync_volume();
+static void flush_sector(struct sector_cache_entry *entry);
+static void flush_sector_cache();
+static void invalidate_sector_cache();
+static void drop_cached_sectors(uint32_t sector_addr, uint32_t num);
+static void use_cache_entry(struct sector_cache_entry *entry);
+static struct sector_cache_entry *find_cache_entry(uint32_t sector_addr);
+static struct sector_cache_entry *evict_cache_entry(uint32_t sector_addr);
 static uint8_t read_sector(uint32_t sector_addr);
+static void clear_sector(uint32_t sector_addr);
+#ifndef FAT_COOPERATIVE
+static uint8_t read_sectors(uint32_t sector_addr, uint8_t num, uint8_t *buffer);
+static uint8_t write_sectors(uint32_t sector_addr, uint8_t num, const uint8_t *buffer);
+#endif
 static uint8_t read_next_sector();
-static uint8_t lookup(const char *name, struct dir_entry *dir_entry, uint32_t *dir_entry_sector, uint16_t *dir_entry_offset);
+#if READ_AHEAD
+static void read_ahead_drop(uint32_t sector_addr, uint32_t num);
+static const uint8_t *read_ahead_get(int fd, uint32_t sector, uint32_t clusters, uint8_t clus_offset);
+#endif
+static void dir_cache_invalidate();
+static uint8_t dir_cache_lookup(uint32_t parent, struct PathResolver *pr, struct dir_entry *dir_entry, uint32_t *dir_entry_sector, uint16_t *dir_entry_offset);
+static void dir_cache_add(uint32_t parent, struct PathResolver *pr, struct dir_entry *dir_entry, uint32_t dir_entry_sector, uint16_t dir_entry_offset);
+static void dir_cache_update(uint32_t dir_entry_sector, uint16_t dir_entry_offset, struct dir_entry *dir_entry);
+static uint8_t lookup(struct PathResolver *pr, struct dir_entry *dir_entry, uint32_t *dir_entry_sector, uint16_t *dir_entry_offset);
+#if FAT_LFN
+static uint8_t lfn_checksum(const uint8_t *short_name);
+static uint32_t lfn_hash(const char *name, uint8_t len);
+static void lfn_match_entry(const uint8_t *entry, struct PathResolver *pr, struct lfn_state *lfn);
+#endif
 static uint8_t get_dir_entry(const char *path, struct dir_entry *dir_ent, uint32_t *dir_entry_sector, uint16_t *dir_entry_offset, uint8_t create);
 static uint8_t add_directory_entry_to_current(struct dir_entry *dir_ent, uint32_t *dir_entry_sector, uint16_t *dir_entry_offset);
 static void update_dir_entry(int fd);
+static void read_fsinfo();
+static void write_fsinfo();
+#if FAT_SYNC
+static void sync_dirty_fats();
+#endif
 static void remove_dir_entry(uint32_t dir_entry_sector, uint16_t dir_entry_offset);
-static uint8_t load_next_sector_of_file(int fd, uint32_t clusters, uint8_t clus_offset, uint8_t write);
+static uint32_t get_next_sector_of_file(int fd, uint32_t clusters, uint8_t clus_offset, uint8_t write);
 static void make_readable_entry(struct dir_entry *dir, struct cfs_dirent *dirent);
 static uint8_t _is_file(struct dir_entry *dir_ent);
 static uint8_t _cfs_flags_ok(int flags, struct dir_entry *dir_ent);
@@ -154,12 +340,12 @@ static int fat_read_write(int fd, const void *buf, unsigned int len, unsigned ch
 static uint8_t
 is_EOC(uint32_t fat_entry)
 {
-  if (mounted.info.type == FAT16) {
+  if (mounted->info.type == FAT16) {
     if (fat_entry >= 0xFFF8) {
       return 1;
     }
 
-  } else if (mounted.info.type == FAT32) {
+  } else if (mounted->info.type == FAT32) {
     if ((fat_entry & 0x0FFFFFFF) >= 0x0FFFFFF8) {
       return 1;
     }
@@ -168,58 +354,84 @@ is_EOC(uint32_t fat_entry)
 }
 /*----------------------------------------------------------------------------*/
 /**
- * \brief Looks through the FAT to find a free cluster. Sets the sector adress pointer to the start
- * of the new cluster.
+ * \brief Looks through the FAT to find a free cluster.
  *
- * \TODO Check for end of FAT and no free clusters.
- * \param start_cluster cluster number to start for searching
- * \return Returns the number of a free cluster.
+ * The search starts at the given cluster, or at the next free cluster hint
+ * (from FSInfo or last allocation) if start_cluster is 0, and wraps around
+ * at the end of the FAT.
+ * \param start_cluster cluster number to start for searching, 0 to use the hint
+ * \return Returns the number of a free cluster or 0 if the volume is full.
  */
 static uint32_t
 get_free_cluster(uint32_t start_cluster)
 {
   uint32_t fat_sec_num = 0;
   uint32_t ent_offset = 0;
+  uint32_t cluster = 0;
+  uint32_t searched = 0;
   uint16_t i = 0;
+  uint8_t ent_size = (mounted->info.type == FAT16) ? 2 : 4;
 
-  /* calculate sector to start search from */
-  calc_fat_block(start_cluster, &fat_sec_num, &ent_offset);
+  if (start_cluster < 2 || start_cluster > mounted->max_cluster) {
+    start_cluster = mounted->next_free;
+  }
+  cluster = start_cluster;
+
+  /* iterate over fat sectors until free cluster found */
+  while (searched < mounted->max_cluster - 1) {
+    calc_fat_block(cluster, &fat_sec_num, &ent_offset);
+    i = 512;
 
-  /* iterate over fat sectors until free sector found */
-  do {
-    //    printf("\nfat_sec_num: %lu", fat_sec_num);
     if (read_sector(fat_sec_num) != 0) {
       PRINTERROR("\nERROR: read_sector() failed!");
-      fat_sec_num++;
-      continue;
+    } else if (mounted->info.type == FAT16) {
+      i = _get_free_cluster_16((uint16_t) ent_offset);
+    } else if (mounted->info.type == FAT32) {
+      i = _get_free_cluster_32((uint16_t) ent_offset);
     }
-    if (mounted.info.type == FAT16) {
-      i = _get_free_cluster_16();
-    } else if (mounted.info.type == FAT32) {
-      i = _get_free_cluster_32();
+
+    if (i < 512 && cluster + (i - ent_offset) / ent_size <= mounted->max_cluster) {
+      cluster += (i - ent_offset) / ent_size;
+      break;
+    }
+
+    /* continue with first cluster of next fat sector */
+    searched += (512 - ent_offset) / ent_size;
+    cluster += (512 - ent_offset) / ent_size;
+    if (cluster > mounted->max_cluster) {
+      cluster = 2;
     }
-    fat_sec_num++;
-  } while (i == 512);
+  }
+
+  if (searched >= mounted->max_cluster - 1) {
+    PRINTERROR("\nfat.c: get_free_cluster(): No free cluster left!");
+    return 0;
+  }
 
-  ent_offset = ((fat_sec_num - 1) - mounted.info.BPB_RsvdSecCnt) * mounted.info.BPB_BytesPerSec + i;
-  if (mounted.info.type == FAT16) {
-    ent_offset /= 2;
-  } else if (mounted.info.type == FAT32) {
-    ent_offset /= 4;
+  mounted->next_free = (cluster < mounted->max_cluster) ? cluster + 1 : 2;
+  if (mounted->free_count != FSI_UNKNOWN && mounted->free_count > 0) {
+    mounted->free_count--;
   }
+  mounted->fsinfo_dirty = 1;
 
-  PRINTF("\nfat.c: get_free_cluster(start_cluster = %lu) = %lu", start_cluster, ent_offset);
-  return ent_offset;
+  PRINTF("\nfat.c: get_free_cluster(start_cluster = %lu) = %lu", start_cluster, cluster);
+  return cluster;
 }
 /*----------------------------------------------------------------------------*/
+/**
+ * Iterates over currently loaded (FAT16) sector and searches for free cluster.
+ * \param start offset to start searching at
+ * \return 0,2,...,510: cluster number offset relative to current fat sector,
+ * 512: no free cluster found
+ */
 static uint16_t
-_get_free_cluster_16()
+_get_free_cluster_16(uint16_t start)
 {
   uint16_t entry = 0;
   uint16_t i = 0;
 
-  for (i = 0; i < 512; i += 2) {
-    entry = (((uint16_t) sector_buffer[i]) << 8) + ((uint16_t) sector_buffer[i + 1]);
+  for (i = start; i < 512; i += 2) {
+    entry = (((uint16_t) mounted->cur_sector->buffer[i + 1]) << 8) + ((uint16_t) mounted->cur_sector->buffer[i]);
     if (entry == 0) {
       return i;
     }
@@ -229,21 +441,19 @@ _get_free_cluster_16()
 }
 /*----------------------------------------------------------------------------*/
 /**
- * Iterates over currently loaded (FAT) sector and searches for free cluster.
- * \return 0,4,...,511: cluster number offset relative to current fat sector,
+ * Iterates over currently loaded (FAT32) sector and searches for free cluster.
+ * \param start offset to start searching at
+ * \return 0,4,...,508: cluster number offset relative to current fat sector,
  * 512: no free cluster found
  */
 static uint16_t
-_get_free_cluster_32()
+_get_free_cluster_32(uint16_t start)
 {
   uint32_t entry = 0;
   uint16_t i = 0;
 
-  // TODO check...
-  //if (sector_buffer_addr > data start sector) .... ERROR
-
-  for (i = 0; i < 512; i += 4) {
-    entry = (((uint32_t) sector_buffer[i + 3]) << 24) + (((uint32_t) sector_buffer[i + 2]) << 16) + (((uint32_t) sector_buffer[i + 1]) << 8) + ((uint32_t) sector_buffer[i]);
+  for (i = start; i < 512; i += 4) {
+    entry = (((uint32_t) mounted->cur_sector->buffer[i + 3]) << 24) + (((uint32_t) mounted->cur_sector->buffer[i + 2]) << 16) + (((uint32_t) mounted->cur_sector->buffer[i + 1]) << 8) + ((uint32_t) mounted->cur_sector->buffer[i]);
 
     if ((entry & 0x0FFFFFFF) == 0) {
       return i;
@@ -253,79 +463,363 @@ _get_free_cluster_32()
   return 512;
 }
 /*----------------------------------------------------------------------------*/
-/* With a given start cluster it looks for the nth cluster in the corresponding chain
+/**
+ * Searches for count consecutive free clusters.
+ * \param start_cluster cluster number to start for searching, 0 to use the hint
+ * \param count number of free clusters required
+ * \return Returns the first cluster of the free run or 0 if there is none.
+ */
+static uint32_t
+get_free_cluster_run(uint32_t start_cluster, uint32_t count)
+{
+  uint32_t cluster, start = 0, length = 0, searched;
+
+  if (start_cluster < 2 || start_cluster > mounted->max_cluster) {
+    start_cluster = mounted->next_free;
+  }
+  cluster = start_cluster;
+
+  for (searched = 0; searched < mounted->max_cluster - 1; searched++) {
+    if (read_fat_entry(cluster) == 0) {
+      if (length == 0) {
+        start = cluster;
+      }
+      if (++length == count) {
+        PRINTF("\nfat.c: get_free_cluster_run( start_cluster = %lu, count = %lu ) = %lu", start_cluster, count, start);
+        return start;
+      }
+    } else {
+      length = 0;
+    }
+
+    /* runs can not wrap around the end of the FAT */
+    if (++cluster > mounted->max_cluster) {
+      cluster = 2;
+      length = 0;
+    }
+  }
+
+  PRINTERROR("\nfat.c: get_free_cluster_run(): No run of %lu free clusters left!", count);
+  return 0;
+}
+/*----------------------------------------------------------------------------*/
+/* Forgets everything known about the cluster chain of the given file. */
+static void
+reset_cluster_runs(struct file *file)
+{
+  file->num_runs = 0;
+  file->run_clusters = 0;
+  file->last_cluster = 0;
+  file->num_clusters = 0;
+}
+/*----------------------------------------------------------------------------*/
+/*
+ * Appends the given cluster (which must be the cluster following the known
+ * runs) to the runs of the file.
+ * Returns 1 if it was added, 0 if all runs are used up.
+ */
+static uint8_t
+add_cluster_to_runs(struct file *file, uint32_t cluster)
+{
+  struct cluster_run *run = NULL;
+
+  if (file->num_runs > 0) {
+    run = &(file->runs[file->num_runs - 1]);
+  }
+
+  if (run != NULL && run->start + run->length == cluster && run->length < 0xFFFF) {
+    run->length++;
+  } else if (file->num_runs < FAT_CLUSTER_RUNS) {
+    run = &(file->runs[file->num_runs]);
+    run->start = cluster;
+    run->length = 1;
+    file->num_runs++;
+  } else {
+    return 0;
+  }
+
+  file->run_clusters++;
+  return 1;
+}
+/*----------------------------------------------------------------------------*/
+/*
+ * Returns the nth cluster (starting at 0) of the files cluster chain.
+ * Clusters covered by the runs are calculated without any disk access,
+ * otherwise the FAT is walked from the last known cluster on and the runs
+ * are extended.
+ * Returns 0 if the file has no cluster and EOC if the chain is shorter.
  */
 static uint32_t
-find_nth_cluster(uint32_t start_cluster, uint32_t n)
+find_file_cluster(struct file *file, uint32_t n)
 {
-  uint32_t cluster = start_cluster,
-          i = 0;
+  uint32_t cluster, next, i;
+  uint8_t r;
+
+  if (file->cluster == 0) {
+    return 0;
+  }
+
+  if (file->num_runs == 0) {
+    reset_cluster_runs(file);
+    add_cluster_to_runs(file, file->cluster);
+  }
+
+  if (file->last_cluster != 0 && n >= file->num_clusters) {
+    return EOC;
+  }
+
+  for (r = 0, i = 0; r < file->num_runs; i += file->runs[r].length, r++) {
+    if (n < i + file->runs[r].length) {
+      return file->runs[r].start + (n - i);
+    }
+  }
+
+  /* Walk the chain from the end of the runs or from the files cursor */
+  i = file->run_clusters - 1;
+  cluster = file->runs[file->num_runs - 1].start + file->runs[file->num_runs - 1].length - 1;
+  if (file->n > i && file->n <= n && file->nth_cluster >= 2 && !is_EOC(file->nth_cluster)) {
+    i = file->n;
+    cluster = file->nth_cluster;
+  }
+
+  while (i < n) {
+    next = read_fat_entry(cluster);
+    if (next < 2 || is_EOC(next)) {
+      file->last_cluster = cluster;
+      file->num_clusters = i + 1;
+      return EOC;
+    }
 
-  for (i = 0; i < n; i++) {
-    cluster = read_fat_entry(cluster);
+    cluster = next;
+    i++;
+    if (i == file->run_clusters) {
+      add_cluster_to_runs(file, cluster);
+    }
   }
 
-  PRINTF("\nfat.c: find_nth_cluster( start_cluster = %lu, n = %lu ) = %lu", start_cluster, n, cluster);
+  PRINTF("\nfat.c: find_file_cluster( file = %p, n = %lu ) = %lu", file, n, cluster);
   return cluster;
 }
 /*----------------------------------------------------------------------------*/
 /*
- * Iterates over a cluster chain corresponding to a given dir entry and removes all entries.
+ * Iterates over the cluster chain starting at the given cluster and frees all
+ * entries.
  */
 static void
-reset_cluster_chain(struct dir_entry *dir_ent)
+free_cluster_chain(uint32_t cluster)
 {
-  uint32_t cluster = (((uint32_t) dir_ent->DIR_FstClusHI) << 16) + dir_ent->DIR_FstClusLO;
-  uint32_t next_cluster = read_fat_entry(cluster);
+  uint32_t next_cluster = 0;
+#if FAT_DISCARD
+  uint32_t run_start = cluster;
+  uint16_t run_length = 0;
+#endif
 
-  while (!is_EOC(cluster) && cluster >= 2) {
+  while (cluster >= 2 && cluster <= mounted->max_cluster) {
+    next_cluster = read_fat_entry(cluster);
     write_fat_entry(cluster, 0L);
+
+    if (mounted->free_count != FSI_UNKNOWN) {
+      mounted->free_count++;
+    }
+    mounted->fsinfo_dirty = 1;
+
+#if FAT_DISCARD
+    /* Queue every contiguous part of the chain as one run */
+    run_length++;
+    if (next_cluster != cluster + 1 || run_length == 0xFFFF) {
+      discard_add(run_start, run_length);
+      run_start = next_cluster;
+      run_length = 0;
+    }
+#endif
+
     cluster = next_cluster;
-    next_cluster = read_fat_entry(cluster);
+  }
+}
+/*----------------------------------------------------------------------------*/
+#if FAT_DISCARD
+/*
+ * Queues a run of freed clusters to be erased by the discard process.
+ * Runs adjacent to an already queued one are merged with it.
+ */
+static void
+discard_add(uint32_t start, uint16_t length)
+{
+  struct cluster_run *run;
+  uint8_t i;
+
+  for (i = 0; i < mounted->num_discard; i++) {
+    run = &mounted->discard[i];
+    if ((uint32_t) run->length + length > 0xFFFF) {
+      continue;
+    }
+    if (run->start + run->length == start) {
+      run->length += length;
+      break;
+    }
+    if (start + length == run->start) {
+      run->start = start;
+      run->length += length;
+      break;
+    }
+  }
+
+  if (i == mounted->num_discard) {
+    /* Erasing is an optimization only, so a full queue is fine */
+    if (mounted->num_discard == FAT_DISCARD_RUNS) {
+      return;
+    }
+    mounted->discard[i].start = start;
+    mounted->discard[i].length = length;
+    mounted->num_discard++;
+  }
+
+  process_poll(&cfs_fat_discard_process);
+}
+/*----------------------------------------------------------------------------*/
+/*
+ * Erases up to DISCARD_STEP clusters at the start of the last queued run of
+ * the current volume. Clusters that were allocated again in the meantime are
+ * skipped.
+ */
+static void
+discard_step()
+{
+  struct cluster_run *run = &mounted->discard[mounted->num_discard - 1];
+  uint32_t sector;
+  uint16_t n = 0;
+
+  while (n < run->length && n < DISCARD_STEP && read_fat_entry(run->start + n) == 0) {
+    n++;
+  }
+
+  if (n > 0) {
+    PRINTF("\nfat.c: discard_step(): Erasing clusters %lu - %lu", run->start, run->start + n - 1);
+    sector = CLUSTER_TO_SECTOR(run->start);
+    drop_cached_sectors(sector, (uint32_t) n * mounted->info.BPB_SecPerClus);
+    diskio_erase_blocks(mounted->dev, sector, (uint32_t) n * mounted->info.BPB_SecPerClus);
+  } else {
+    n = 1;
   }
 
-  write_fat_entry(cluster, 0L);
+  run->start += n;
+  run->length -= n;
+  if (run->length == 0) {
+    mounted->num_discard--;
+  }
+}
+#endif /* FAT_DISCARD */
+/*----------------------------------------------------------------------------*/
+/*
+ * Iterates over a cluster chain corresponding to a given dir entry and removes all entries.
+ */
+static void
+reset_cluster_chain(struct dir_entry *dir_ent)
+{
+  free_cluster_chain((((uint32_t) dir_ent->DIR_FstClusHI) << 16) + dir_ent->DIR_FstClusLO);
 }
 /*----------------------------------------------------------------------------*/
 /*
  * Searches for next free cluster to add id to the file associated with the
  * given file descriptor.
+ * Returns 0 on success, 1 if there is no free cluster left.
  */
-static void
+static uint8_t
 add_cluster_to_file(int fd)
 {
   /* get the address of any free cluster */
   uint32_t free_cluster = get_free_cluster(0);
-  uint32_t cluster = fat_file_pool[fd].nth_cluster;
-  uint32_t n = cluster;
-  PRINTF("\nfat.c: add_cluster_to_file( fd = %d ) = void", fd);
+  struct file *file = &(fat_file_pool[fd]);
+  PRINTF("\nfat.c: add_cluster_to_file( fd = %d ) = ?", fd);
+
+  if (free_cluster == 0) {
+    return 1;
+  }
 
   // if file has no cluster yet, add first
   if (fat_file_pool[fd].cluster == 0) {
     write_fat_entry(free_cluster, EOC);
     fat_file_pool[fd].dir_entry.DIR_FstClusHI = (uint16_t) (free_cluster >> 16);
     fat_file_pool[fd].dir_entry.DIR_FstClusLO = (uint16_t) (free_cluster);
-
-    update_dir_entry(fd);
+    fat_file_pool[fd].dir_entry_dirty = 1;
 
     fat_file_pool[fd].cluster = free_cluster;
     fat_file_pool[fd].n = 0;
     fat_file_pool[fd].nth_cluster = free_cluster;
 
+    reset_cluster_runs(file);
+    add_cluster_to_runs(file, free_cluster);
+    file->last_cluster = free_cluster;
+    file->num_clusters = 1;
+
     PRINTF("\n\tfat.c: File was empty, now has first cluster %lu added to Chain", free_cluster);
-    return;
+    return 0;
   }
 
-  while (!is_EOC(n)) {
-    cluster = n;
-    n = read_fat_entry(cluster);
-    fat_file_pool[fd].n++;
+  /* Walk to the end of the chain once, afterwards the tail is remembered */
+  if (file->last_cluster == 0) {
+    find_file_cluster(file, 0xFFFFFFFF);
   }
 
-  write_fat_entry(cluster, free_cluster);
+  write_fat_entry(file->last_cluster, free_cluster);
   write_fat_entry(free_cluster, EOC);
+
+  if (file->run_clusters == file->num_clusters) {
+    add_cluster_to_runs(file, free_cluster);
+  }
+  file->last_cluster = free_cluster;
+  fat_file_pool[fd].n = file->num_clusters++;
   fat_file_pool[fd].nth_cluster = free_cluster;
   PRINTF("\n\tfat.c: File was NOT empty, now has cluster %lu as %lu. cluster to Chain", free_cluster, fat_file_pool[fd].n);
+  return 0;
+}
+/*----------------------------------------------------------------------------*/
+/*
+ * Frees the clusters of the files chain that are not needed to hold the
+ * current file size, i.e. the unused part of a reservation.
+ */
+static void
+trim_cluster_chain(int fd)
+{
+  struct file *file = &(fat_file_pool[fd]);
+  uint32_t cluster_size = (uint32_t) mounted->info.BPB_BytesPerSec * mounted->info.BPB_SecPerClus;
+  uint32_t needed = (file->dir_entry.DIR_FileSize + cluster_size - 1) / cluster_size;
+  uint32_t last;
+
+  if (file->cluster == 0) {
+    return;
+  }
+
+  if (file->last_cluster == 0) {
+    find_file_cluster(file, 0xFFFFFFFF);
+  }
+
+  if (needed >= file->num_clusters) {
+    return;
+  }
+
+  PRINTF("\nfat.c: trim_cluster_chain( fd = %d ): %lu of %lu clusters needed", fd, needed, file->num_clusters);
+
+  if (needed == 0) {
+    free_cluster_chain(file->cluster);
+    file->cluster = 0;
+    file->dir_entry.DIR_FstClusHI = 0;
+    file->dir_entry.DIR_FstClusLO = 0;
+    file->nth_cluster = 0;
+    file->n = 0;
+    file->dir_entry_dirty = 1;
+    reset_cluster_runs(file);
+    return;
+  }
+
+  last = find_file_cluster(file, needed - 1);
+  free_cluster_chain(read_fat_entry(last));
+  write_fat_entry(last, EOC);
+
+  /* the cursor may point into the freed part */
+  file->nth_cluster = file->cluster;
+  file->n = 0;
+  reset_cluster_runs(file);
 }
 /*----------------------------------------------------------------------------*/
 /*Debug Functions*/
@@ -336,7 +830,7 @@ print_current_sector()
 
   printf("\n");
   for (i = 0; i < 512; i++) {
-    printf("%02x", sector_buffer[i]);
+    printf("%02x", mounted->cur_sector->buffer[i]);
     if (((i + 1) % 2) == 0) {
       printf(" ");
     }
@@ -349,7 +843,13 @@ print_current_sector()
 void
 print_cluster_chain(int fd)
 {
-  uint32_t cluster = fat_file_pool[fd].cluster;
+  uint32_t cluster;
+
+  if (select_file_volume(fd) != 0) {
+    return;
+  }
+
+  cluster = fat_file_pool[fd].cluster;
   printf("\nClusterchain for fd = %d\n", fd);
   do {
     printf("%lu ->", cluster);
@@ -405,7 +905,11 @@ cfs_fat_print_dir_entry(struct dir_entry *dir_entry)
 void
 cfs_fat_get_fat_info(struct FAT_Info *info)
 {
-  memcpy(info, &(mounted.info), sizeof (struct FAT_Info));
+  if (select_volume("/") == NULL) {
+    memset(info, 0, sizeof (struct FAT_Info));
+    return;
+  }
+  memcpy(info, &(mounted->info), sizeof (struct FAT_Info));
 }
 /*---------------------------------------------------------------------------*/
 uint16_t
@@ -447,21 +951,21 @@ read_fat_entry(uint32_t cluster_num)
     return EOC;
   }
 
-  if (mounted.info.type == FAT16) {
-    PRINTF("\nfat.c: read_fat_entry( cluster_num = %lu ) = %lu", cluster_num, (uint32_t) (((uint16_t) sector_buffer[ent_offset + 1]) << 8) + ((uint16_t) sector_buffer[ent_offset]));
-    return (uint32_t) (((uint16_t) sector_buffer[ent_offset + 1]) << 8) + ((uint16_t) sector_buffer[ent_offset]);
-  } else if (mounted.info.type == FAT32) {
+  if (mounted->info.type == FAT16) {
+    PRINTF("\nfat.c: read_fat_entry( cluster_num = %lu ) = %lu", cluster_num, (uint32_t) (((uint16_t) mounted->cur_sector->buffer[ent_offset + 1]) << 8) + ((uint16_t) mounted->cur_sector->buffer[ent_offset]));
+    return (uint32_t) (((uint16_t) mounted->cur_sector->buffer[ent_offset + 1]) << 8) + ((uint16_t) mounted->cur_sector->buffer[ent_offset]);
+  } else if (mounted->info.type == FAT32) {
     PRINTF("\nfat.c: read_fat_entry( cluster_num = %lu ) = %lu", cluster_num,
-            (((((uint32_t) sector_buffer[ent_offset + 3]) << 24) +
-            (((uint32_t) sector_buffer[ent_offset + 2]) << 16) +
-            (((uint32_t) sector_buffer[ent_offset + 1]) << 8) +
-            ((uint32_t) sector_buffer[ent_offset + 0]))
+            (((((uint32_t) mounted->cur_sector->buffer[ent_offset + 3]) << 24) +
+            (((uint32_t) mounted->cur_sector->buffer[ent_offset + 2]) << 16) +
+            (((uint32_t) mounted->cur_sector->buffer[ent_offset + 1]) << 8) +
+            ((uint32_t) mounted->cur_sector->buffer[ent_offset + 0]))
             & 0x0FFFFFFF));
-    /* First read a uint32_t out of the sector_buffer (first 4 lines) and then mask the highest order bit (5th line)*/
-    return (((((uint32_t) sector_buffer[ent_offset + 3]) << 24) +
-            (((uint32_t) sector_buffer[ent_offset + 2]) << 16) +
-            (((uint32_t) sector_buffer[ent_offset + 1]) << 8) +
-            ((uint32_t) sector_buffer[ent_offset + 0]))
+    /* First read a uint32_t out of the sector buffer (first 4 lines) and then mask the highest order bit (5th line)*/
+    return (((((uint32_t) mounted->cur_sector->buffer[ent_offset + 3]) << 24) +
+            (((uint32_t) mounted->cur_sector->buffer[ent_offset + 2]) << 16) +
+            (((uint32_t) mounted->cur_sector->buffer[ent_offset + 1]) << 8) +
+            ((uint32_t) mounted->cur_sector->buffer[ent_offset + 0]))
             & 0x0FFFFFFF);
   }
 
@@ -479,20 +983,29 @@ write_fat_entry(uint32_t cluster_num, uint32_t value)
 
   calc_fat_block(cluster_num, &fat_sec_num, &ent_offset);
   read_sector(fat_sec_num);
+#if FAT_SYNC
+  if (mounted->fat_dirty_first > mounted->fat_dirty_last) {
+    mounted->fat_dirty_first = mounted->fat_dirty_last = fat_sec_num;
+  } else if (fat_sec_num < mounted->fat_dirty_first) {
+    mounted->fat_dirty_first = fat_sec_num;
+  } else if (fat_sec_num > mounted->fat_dirty_last) {
+    mounted->fat_dirty_last = fat_sec_num;
+  }
+#endif
   PRINTF("\nfat.c: write_fat_entry( cluster_num = %lu, value = %lu ) = void", cluster_num, value);
 
   /* Write value to sector buffer and set dirty flag (little endian) */
-  if (mounted.info.type == FAT16) {
-    sector_buffer[ent_offset + 1] = (uint8_t) (value >> 8);
-    sector_buffer[ent_offset] = (uint8_t) (value);
-  } else if (mounted.info.type == FAT32) {
-    sector_buffer[ent_offset + 3] = ((uint8_t) (value >> 24) & 0x0FFF) + (0xF000 & sector_buffer[ent_offset + 3]);
-    sector_buffer[ent_offset + 2] = (uint8_t) (value >> 16);
-    sector_buffer[ent_offset + 1] = (uint8_t) (value >> 8);
-    sector_buffer[ent_offset] = (uint8_t) (value);
+  if (mounted->info.type == FAT16) {
+    mounted->cur_sector->buffer[ent_offset + 1] = (uint8_t) (value >> 8);
+    mounted->cur_sector->buffer[ent_offset] = (uint8_t) (value);
+  } else if (mounted->info.type == FAT32) {
+    mounted->cur_sector->buffer[ent_offset + 3] = ((uint8_t) (value >> 24) & 0x0FFF) + (0xF000 & mounted->cur_sector->buffer[ent_offset + 3]);
+    mounted->cur_sector->buffer[ent_offset + 2] = (uint8_t) (value >> 16);
+    mounted->cur_sector->buffer[ent_offset + 1] = (uint8_t) (value >> 8);
+    mounted->cur_sector->buffer[ent_offset] = (uint8_t) (value);
   }
 
-  sector_buffer_dirty = 1;
+  mounted->cur_sector->dirty = 1;
 }
 /*----------------------------------------------------------------------------*/
 /*
@@ -504,14 +1017,14 @@ calc_fat_block(uint32_t cur_cluster, uint32_t *fat_sec_num, uint32_t *ent_offset
 {
   uint32_t N = cur_cluster;
 
-  if (mounted.info.type == FAT16) {
+  if (mounted->info.type == FAT16) {
     *ent_offset = N * 2;
-  } else if (mounted.info.type == FAT32) {
+  } else if (mounted->info.type == FAT32) {
     *ent_offset = N * 4;
   }
 
-  *fat_sec_num = mounted.info.BPB_RsvdSecCnt + (*ent_offset / mounted.info.BPB_BytesPerSec);
-  *ent_offset = *ent_offset % mounted.info.BPB_BytesPerSec;
+  *fat_sec_num = mounted->info.BPB_RsvdSecCnt + (*ent_offset / mounted->info.BPB_BytesPerSec);
+  *ent_offset = *ent_offset % mounted->info.BPB_BytesPerSec;
   PRINTF("\nfat.c: calc_fat_block( cur_cluster = %lu, *fat_sec_num = %lu, *ent_offset = %lu ) = void", cur_cluster, *fat_sec_num, *ent_offset);
 }
 /*----------------------------------------------------------------------------*/
@@ -563,6 +1076,8 @@ pr_reset(struct PathResolver *rsolv)
   rsolv->start = 0;
   rsolv->end = 0;
   rsolv->path = NULL;
+  rsolv->len = 0;
+  rsolv->valid = 0;
   memset(rsolv->name, '\0', 11);
 }
 /*----------------------------------------------------------------------------*/
@@ -587,7 +1102,19 @@ pr_get_next_path_part(struct PathResolver *rsolv)
     }
 
     if (rsolv->path[rsolv->end] == '/' || rsolv->path[rsolv->end] == '\0') {
+#if FAT_LFN
+      if (rsolv->end - rsolv->start > 255) {
+        return 2;
+      }
+      rsolv->len = rsolv->end - rsolv->start;
+      rsolv->valid = (_make_valid_name(rsolv->path, rsolv->start, rsolv->end, rsolv->name) == 0);
+      rsolv->hash = lfn_hash(&rsolv->path[rsolv->start], rsolv->len);
+      return 0;
+#else /* FAT_LFN */
+      rsolv->len = rsolv->end - rsolv->start;
+      rsolv->valid = 1;
       return _make_valid_name(rsolv->path, rsolv->start, rsolv->end, rsolv->name);
+#endif /* FAT_LFN */
     }
   }
 
@@ -608,12 +1135,12 @@ pr_is_current_path_part_a_file(struct PathResolver *rsolv)
 /*----------------------------------------------------------------------------*/
 /*Sector Buffer Functions*/
 /**
- * Writes the current buffered block back to the disk if it was changed.
+ * Writes the given cache entry back to the disk if it was changed.
  */
-void
-cfs_fat_flush()
+static void
+flush_sector(struct sector_cache_entry *entry)
 {
-  if (!sector_buffer_dirty) {
+  if (!entry->dirty) {
     return;
   }
 
@@ -626,71 +1153,397 @@ cfs_fat_flush()
   }
 #endif
 
-  PRINTF("\nfat.c: fat_flush(): Flushing sector %lu", sector_buffer_addr);
-  if (diskio_write_block(mounted.dev, sector_buffer_addr, sector_buffer) != DISKIO_SUCCESS) {
-    PRINTERROR("\nfat.c: fat_flush(): DiskIO-Error occured");
+  PRINTF("\nfat.c: flush_sector(): Flushing sector %lu", entry->addr);
+#if READ_AHEAD
+  read_ahead_drop(entry->addr, 1);
+#endif
+  if (diskio_write_block(mounted->dev, entry->addr, entry->buffer) != DISKIO_SUCCESS) {
+    PRINTERROR("\nfat.c: flush_sector(): DiskIO-Error occured");
   }
 
-  sector_buffer_dirty = 0;
+  entry->dirty = 0;
 }
 /*----------------------------------------------------------------------------*/
-/* Reads sector at given address.
- * If sector is already loaded, this version is used.
- * If sector is not loaded, previous sector is flushed and new sector is loaded
- * from medium.
+/**
+ * Writes all changed sectors of the sector cache of the current volume back
+ * to the disk.
  */
-static uint8_t
-read_sector(uint32_t sector_addr)
+static void
+flush_sector_cache()
 {
-  if (sector_buffer_addr == sector_addr && sector_addr != 0) {
-    PRINTF("\nfat.c: fat_read_sector( sector_addr = 0x%lX ) = 0", sector_addr);
-    return 0;
-  }
-
-  cfs_fat_flush();
+  uint8_t i;
 
-  sector_buffer_addr = sector_addr;
+  for (i = 0; i < FAT_SECTOR_CACHE_SIZE; i++) {
+    flush_sector(&mounted->sector_cache[i]);
+  }
+}
+/*----------------------------------------------------------------------------*/
+void
+cfs_fat_flush()
+{
+  uint8_t i;
 
-#ifdef FAT_COOPERATIVE
-  if (!coop_step_allowed) {
-    next_step_type = READ;
-    coop_switch_sp();
-  } else {
-    coop_step_allowed = 0;
+  for (i = 0; i < FAT_MAX_VOLUMES; i++) {
+    if (volumes[i].dev != 0) {
+      mounted = &volumes[i];
+      flush_sector_cache();
+    }
   }
-#endif
+}
+/*----------------------------------------------------------------------------*/
+/* Drops all cached sectors without writing them back. */
+static void
+invalidate_sector_cache()
+{
+  uint8_t i;
 
-  if (diskio_read_block(mounted.dev, sector_addr, sector_buffer) != 0) {
-    PRINTERROR("\nfat.c: Error while reading sector 0x%lX", sector_addr);
-    sector_buffer_addr = 0;
-    return 1;
+  for (i = 0; i < FAT_SECTOR_CACHE_SIZE; i++) {
+    mounted->sector_cache[i].addr = 0;
+    mounted->sector_cache[i].dirty = 0;
   }
 
-  PRINTF("\nfat.c: read_sector( sector_addr = 0x%lX ) = 0", sector_addr);
-  return 0;
+  mounted->cur_sector = &mounted->sector_cache[0];
+  mounted->pinned_fat_sector = NULL;
+  mounted->pinned_data_sector = NULL;
+#if READ_AHEAD
+  mounted->read_ahead_addr = 0;
+#endif
 }
 /*----------------------------------------------------------------------------*/
-/** Loads the next sector of current sector_buffer_addr.
- * \return
- *  Returns 0 if sector could be read
- *  If this was the last sector in a cluster chain, it returns error code 128.
+/* Drops cached copies of the num sectors starting at sector_addr without
+ * writing them back, because they are overwritten on the medium.
  */
-static uint8_t
-read_next_sector()
+static void
+drop_cached_sectors(uint32_t sector_addr, uint32_t num)
 {
-  PRINTF("\nread_next_sector()");
-  cfs_fat_flush();
+  uint8_t i;
 
-  /* To restore start sector buffer address if reading next sector failed. */
-  uint32_t save_sbuff_addr = sector_buffer_addr;
-  /* Are we on a Cluster edge? */
-  if ((sector_buffer_addr - mounted.first_data_sector + 1) % mounted.info.BPB_SecPerClus == 0) {
-    PRINTDEBUG("\nCluster end, trying to load next");
-    /* We need to change the cluster, for this we have to read the FAT entry corresponding to the current sector number */
-    uint32_t entry = read_fat_entry(SECTOR_TO_CLUSTER(sector_buffer_addr));
-    /* If the returned entry is an End Of Clusterchain, return error code 128 */
-    if (is_EOC(entry)) {
-      PRINTDEBUG("\nis_EOC! (%ld)", sector_buffer_addr);
+#if READ_AHEAD
+  read_ahead_drop(sector_addr, num);
+#endif
+
+  for (i = 0; i < FAT_SECTOR_CACHE_SIZE; i++) {
+    if (mounted->sector_cache[i].addr >= sector_addr && mounted->sector_cache[i].addr < sector_addr + num) {
+      mounted->sector_cache[i].addr = 0;
+      mounted->sector_cache[i].dirty = 0;
+    }
+  }
+}
+/*----------------------------------------------------------------------------*/
+/* Makes the given entry the current one and pins it as last used FAT or data
+ * sector.
+ */
+static void
+use_cache_entry(struct sector_cache_entry *entry)
+{
+  mounted->cur_sector = entry;
+  entry->last_used = ++mounted->sector_cache_clock;
+
+  if (IS_FAT_SECTOR(entry->addr)) {
+    mounted->pinned_fat_sector = entry;
+    if (mounted->pinned_data_sector == entry) {
+      mounted->pinned_data_sector = NULL;
+    }
+  } else {
+    mounted->pinned_data_sector = entry;
+    if (mounted->pinned_fat_sector == entry) {
+      mounted->pinned_fat_sector = NULL;
+    }
+  }
+}
+/*----------------------------------------------------------------------------*/
+/* Returns the cache entry holding the given sector or NULL if not cached. */
+static struct sector_cache_entry *
+find_cache_entry(uint32_t sector_addr)
+{
+  uint8_t i;
+
+  if (sector_addr == 0) {
+    return NULL;
+  }
+
+  if (mounted->cur_sector->addr == sector_addr) {
+    return mounted->cur_sector;
+  }
+
+  for (i = 0; i < FAT_SECTOR_CACHE_SIZE; i++) {
+    if (mounted->sector_cache[i].addr == sector_addr) {
+      return &mounted->sector_cache[i];
+    }
+  }
+
+  return NULL;
+}
+/*----------------------------------------------------------------------------*/
+/* Selects the entry that should be used to load the given sector and writes
+ * it back if required.
+ * Unused entries are taken first, then the least recently used entry that is
+ * not pinned. If all entries are pinned, the pinned entry of the same kind
+ * (FAT or data) as the new sector is replaced.
+ */
+static struct sector_cache_entry *
+evict_cache_entry(uint32_t sector_addr)
+{
+  struct sector_cache_entry *victim = NULL;
+  uint16_t age, max_age = 0;
+  uint8_t i;
+
+  for (i = 0; i < FAT_SECTOR_CACHE_SIZE; i++) {
+    if (mounted->sector_cache[i].addr == 0) {
+      victim = &mounted->sector_cache[i];
+      break;
+    }
+
+    if (&mounted->sector_cache[i] == mounted->pinned_fat_sector || &mounted->sector_cache[i] == mounted->pinned_data_sector) {
+      continue;
+    }
+
+    age = mounted->sector_cache_clock - mounted->sector_cache[i].last_used;
+    if (victim == NULL || age > max_age) {
+      victim = &mounted->sector_cache[i];
+      max_age = age;
+    }
+  }
+
+  if (victim == NULL) {
+    victim = IS_FAT_SECTOR(sector_addr) ? mounted->pinned_fat_sector : mounted->pinned_data_sector;
+  }
+
+  if (victim == NULL) {
+    victim = mounted->cur_sector;
+  }
+
+  flush_sector(victim);
+  victim->addr = 0;
+
+  return victim;
+}
+/*----------------------------------------------------------------------------*/
+/* Reads sector at given address.
+ * If sector is already cached, the cached version is used.
+ * If sector is not cached, an entry is evicted (and written back if it was
+ * changed) and the sector is loaded from medium.
+ */
+static uint8_t
+read_sector(uint32_t sector_addr)
+{
+  struct sector_cache_entry *entry = find_cache_entry(sector_addr);
+
+  if (entry != NULL) {
+    use_cache_entry(entry);
+    PRINTF("\nfat.c: fat_read_sector( sector_addr = 0x%lX ) = 0", sector_addr);
+    return 0;
+  }
+
+  entry = evict_cache_entry(sector_addr);
+
+#ifdef FAT_COOPERATIVE
+  if (!coop_step_allowed) {
+    next_step_type = READ;
+    coop_switch_sp();
+  } else {
+    coop_step_allowed = 0;
+  }
+#endif
+
+  if (diskio_read_block(mounted->dev, sector_addr, entry->buffer) != 0) {
+    PRINTERROR("\nfat.c: Error while reading sector 0x%lX", sector_addr);
+    mounted->cur_sector = entry;
+    return 1;
+  }
+
+  entry->addr = sector_addr;
+  use_cache_entry(entry);
+
+  PRINTF("\nfat.c: read_sector( sector_addr = 0x%lX ) = 0", sector_addr);
+  return 0;
+}
+/*----------------------------------------------------------------------------*/
+#ifndef FAT_COOPERATIVE
+/* Reads num consecutive sectors directly into the given buffer, bypassing
+ * the sector cache. Several sectors are read with a single multi block read.
+ * Changed cached copies of these sectors are written back first, so the
+ * medium holds the current data.
+ */
+static uint8_t
+read_sectors(uint32_t sector_addr, uint8_t num, uint8_t *buffer)
+{
+  struct sector_cache_entry *entry;
+  uint8_t i;
+
+  if (num == 1 && (entry = find_cache_entry(sector_addr)) != NULL) {
+    memcpy(buffer, entry->buffer, 512);
+    return 0;
+  }
+
+  for (i = 0; i < FAT_SECTOR_CACHE_SIZE; i++) {
+    if (mounted->sector_cache[i].addr >= sector_addr && mounted->sector_cache[i].addr < sector_addr + num) {
+      flush_sector(&mounted->sector_cache[i]);
+    }
+  }
+
+  if (num == 1) {
+    if (diskio_read_block(mounted->dev, sector_addr, buffer) != DISKIO_SUCCESS) {
+      PRINTERROR("\nfat.c: Error while reading sector 0x%lX", sector_addr);
+      return 1;
+    }
+    return 0;
+  }
+
+  if (diskio_read_blocks(mounted->dev, sector_addr, num, buffer) != DISKIO_SUCCESS) {
+    PRINTERROR("\nfat.c: Error while reading %u sectors at 0x%lX", num, sector_addr);
+    return 1;
+  }
+
+  PRINTF("\nfat.c: read_sectors( sector_addr = 0x%lX, num = %u ) = 0", sector_addr, num);
+  return 0;
+}
+/*----------------------------------------------------------------------------*/
+/* Writes num consecutive sectors directly from the given buffer, bypassing
+ * the sector cache. Several sectors are written with a single multi block
+ * write. Cached copies of these sectors are dropped, since they are
+ * overwritten entirely.
+ */
+static uint8_t
+write_sectors(uint32_t sector_addr, uint8_t num, const uint8_t *buffer)
+{
+  uint8_t i;
+
+  drop_cached_sectors(sector_addr, num);
+
+  if (num == 1) {
+    if (diskio_write_block(mounted->dev, sector_addr, (uint8_t *) buffer) != DISKIO_SUCCESS) {
+      PRINTERROR("\nfat.c: Error while writing sector 0x%lX", sector_addr);
+      return 1;
+    }
+    return 0;
+  }
+
+  if (diskio_write_blocks_start(mounted->dev, sector_addr, num) != DISKIO_SUCCESS) {
+    PRINTERROR("\nfat.c: Error while starting to write %u sectors at 0x%lX", num, sector_addr);
+    return 1;
+  }
+
+  for (i = 0; i < num; i++) {
+    if (diskio_write_blocks_next(mounted->dev, (uint8_t *) buffer + i * 512) != DISKIO_SUCCESS) {
+      break;
+    }
+  }
+
+  if (diskio_write_blocks_done(mounted->dev) != DISKIO_SUCCESS || i < num) {
+    PRINTERROR("\nfat.c: Error while writing %u sectors at 0x%lX", num, sector_addr);
+    return 1;
+  }
+
+  PRINTF("\nfat.c: write_sectors( sector_addr = 0x%lX, num = %u ) = 0", sector_addr, num);
+  return 0;
+}
+#endif /* !FAT_COOPERATIVE */
+/*----------------------------------------------------------------------------*/
+#if READ_AHEAD
+/* Forgets the read ahead sectors if they overlap the given range, because
+ * the medium was changed there.
+ */
+static void
+read_ahead_drop(uint32_t sector_addr, uint32_t num)
+{
+  if (mounted->read_ahead_addr != 0
+      && mounted->read_ahead_addr < sector_addr + num
+      && sector_addr < mounted->read_ahead_addr + mounted->read_ahead_num) {
+    mounted->read_ahead_addr = 0;
+  }
+}
+/*----------------------------------------------------------------------------*/
+/* Returns the contents of the given sector of a sequentially read file from
+ * the read ahead buffer. If it is not held there, the rest of the cluster is
+ * fetched first and the next cluster of the file is looked up in the FAT.
+ * Returns NULL if the sector should be read through the sector cache, i.e.
+ * if it is cached (the cache may hold newer data) or only a single sector
+ * of the cluster is left.
+ */
+static const uint8_t *
+read_ahead_get(int fd, uint32_t sector, uint32_t clusters, uint8_t clus_offset)
+{
+  uint32_t left;
+  uint8_t num;
+
+  if (find_cache_entry(sector) != NULL) {
+    return NULL;
+  }
+
+  if (mounted->read_ahead_addr != 0 && sector >= mounted->read_ahead_addr
+      && sector < mounted->read_ahead_addr + mounted->read_ahead_num) {
+    return &mounted->read_ahead[(sector - mounted->read_ahead_addr) * 512];
+  }
+
+  /* rest of the cluster, but not beyond the end of the file */
+  num = mounted->info.BPB_SecPerClus - clus_offset;
+  if (num > FAT_READ_AHEAD) {
+    num = FAT_READ_AHEAD;
+  }
+  left = fat_file_pool[fd].dir_entry.DIR_FileSize - (fat_fd_pool[fd].offset & ~511UL);
+  if (num > (left + 511) / 512) {
+    num = (left + 511) / 512;
+  }
+  if (num < 2) {
+    return NULL;
+  }
+
+  mounted->read_ahead_addr = 0;
+  if (read_sectors(sector, num, mounted->read_ahead) != 0) {
+    return NULL;
+  }
+  mounted->read_ahead_addr = sector;
+  mounted->read_ahead_num = num;
+
+  /* the next cluster is found in the runs of the file later on */
+  if (clus_offset + num == mounted->info.BPB_SecPerClus) {
+    find_file_cluster(&fat_file_pool[fd], clusters + 1);
+  }
+
+  PRINTF("\nfat.c: read_ahead_get( fd = %d, sector = %lu ): read %u sectors", fd, sector, num);
+  return mounted->read_ahead;
+}
+#endif /* READ_AHEAD */
+/*----------------------------------------------------------------------------*/
+/* Makes the sector at given address the current one, filled with zeros and
+ * marked as changed, without reading it from medium first.
+ */
+static void
+clear_sector(uint32_t sector_addr)
+{
+  struct sector_cache_entry *entry = find_cache_entry(sector_addr);
+
+  if (entry == NULL) {
+    entry = evict_cache_entry(sector_addr);
+    entry->addr = sector_addr;
+  }
+
+  use_cache_entry(entry);
+  memset(entry->buffer, 0x00, 512);
+  entry->dirty = 1;
+}
+/*----------------------------------------------------------------------------*/
+/** Loads the next sector of the current sector.
+ * \return
+ *  Returns 0 if sector could be read
+ *  If this was the last sector in a cluster chain, it returns error code 128.
+ */
+static uint8_t
+read_next_sector()
+{
+  PRINTF("\nread_next_sector()");
+
+  /* To restore start sector buffer address if reading next sector failed. */
+  uint32_t save_sbuff_addr = mounted->cur_sector->addr;
+  /* Are we on a Cluster edge? */
+  if ((mounted->cur_sector->addr - mounted->first_data_sector + 1) % mounted->info.BPB_SecPerClus == 0) {
+    PRINTDEBUG("\nCluster end, trying to load next");
+    /* We need to change the cluster, for this we have to read the FAT entry corresponding to the current sector number */
+    uint32_t entry = read_fat_entry(SECTOR_TO_CLUSTER(mounted->cur_sector->addr));
+    /* If the returned entry is an End Of Clusterchain, return error code 128 */
+    if (is_EOC(entry)) {
+      PRINTDEBUG("\nis_EOC! (%ld)", mounted->cur_sector->addr);
       /* Restore previous sector adress. */
       read_sector(save_sbuff_addr);
       return 128;
@@ -700,7 +1553,7 @@ read_next_sector()
     return read_sector(CLUSTER_TO_SECTOR(entry));
   } else {
     /* We are still inside a cluster, so we only need to read the next sector */
-    return read_sector(sector_buffer_addr + 1);
+    return read_sector(mounted->cur_sector->addr + 1);
   }
 }
 /*----------------------------------------------------------------------------*/
@@ -806,60 +1659,300 @@ parse_bootsector(uint8_t *buffer, struct FAT_Info *info)
 #define DIR_ENTRY_SIZE  32
 uint8_t
 cfs_fat_mount_device(struct diskio_device_info *dev)
+{
+  return cfs_fat_mount_volume(dev, "");
+}
+/*----------------------------------------------------------------------------*/
+uint8_t
+cfs_fat_mount_volume(struct diskio_device_info *dev, const char *prefix)
 {
   uint32_t RootDirSectors = 0;
+  uint8_t i;
 
-  if (mounted.dev != 0) {
-    cfs_fat_umount_device();
+  // A volume mounted at the same prefix is replaced
+  for (i = 0; i < FAT_MAX_VOLUMES; i++) {
+    if (volumes[i].dev != 0 && strcmp(volumes[i].prefix, prefix) == 0) {
+      mounted = &volumes[i];
+      umount_volume();
+    }
   }
 
+  for (i = 0; i < FAT_MAX_VOLUMES; i++) {
+    if (volumes[i].dev == 0) {
+      break;
+    }
+  }
+
+  if (i == FAT_MAX_VOLUMES) {
+    return 3;
+  }
+
+  mounted = &volumes[i];
+  invalidate_sector_cache();
+
   //read first sector into buffer
-  diskio_read_block(dev, 0, sector_buffer);
+  diskio_read_block(dev, 0, mounted->cur_sector->buffer);
 
   //parse bootsector
-  if (parse_bootsector(sector_buffer, &(mounted.info)) != 0) {
+  if (parse_bootsector(mounted->cur_sector->buffer, &(mounted->info)) != 0) {
     return 1;
   }
 
   //return 2 if unsupported
-  if (mounted.info.type != FAT16 && mounted.info.type != FAT32) {
+  if (mounted->info.type != FAT16 && mounted->info.type != FAT32) {
     return 2;
   }
 
-  mounted.dev = dev;
+  mounted->dev = dev;
+  mounted->prefix = prefix;
+  dir_cache_invalidate();
+  mounted->fsinfo_sector = 0;
+  if (mounted->info.type == FAT32) {
+    mounted->fsinfo_sector = mounted->cur_sector->buffer[48] + (((uint16_t) mounted->cur_sector->buffer[49]) << 8);
+  }
 
   //sync every FAT to the first on mount
   //Addendum: Takes so frigging long to do that
   //fat_sync_fats();
 
   //Calculated the first_data_sector (Note: BPB_RootEntCnt is 0 for FAT32)
-  RootDirSectors = ((mounted.info.BPB_RootEntCnt * DIR_ENTRY_SIZE) + (mounted.info.BPB_BytesPerSec - 1)) / mounted.info.BPB_BytesPerSec;
-  mounted.first_data_sector = mounted.info.BPB_RsvdSecCnt + (mounted.info.BPB_NumFATs * mounted.info.BPB_FATSz) + RootDirSectors;
+  RootDirSectors = ((mounted->info.BPB_RootEntCnt * DIR_ENTRY_SIZE) + (mounted->info.BPB_BytesPerSec - 1)) / mounted->info.BPB_BytesPerSec;
+  mounted->first_data_sector = mounted->info.BPB_RsvdSecCnt + (mounted->info.BPB_NumFATs * mounted->info.BPB_FATSz) + RootDirSectors;
+
+  //Highest cluster number, limited by the data region and the size of the FAT
+  mounted->max_cluster = (mounted->info.BPB_TotSec - mounted->first_data_sector) / mounted->info.BPB_SecPerClus + 1;
+  if (mounted->max_cluster > (mounted->info.BPB_FATSz * mounted->info.BPB_BytesPerSec) / (mounted->info.type == FAT16 ? 2 : 4) - 1) {
+    mounted->max_cluster = (mounted->info.BPB_FATSz * mounted->info.BPB_BytesPerSec) / (mounted->info.type == FAT16 ? 2 : 4) - 1;
+  }
+
+  read_fsinfo();
+
+#if FAT_SYNC
+  mounted->fat_dirty_first = 1;
+  mounted->fat_dirty_last = 0;
+#endif
+
+#if FAT_SYNC_INTERVAL && !defined(FAT_COOPERATIVE)
+  process_start(&cfs_fat_sync_process, NULL);
+#endif
+
+#if FAT_DISCARD
+  mounted->num_discard = 0;
+  process_start(&cfs_fat_discard_process, NULL);
+#endif
 
   return 0;
 }
 /*----------------------------------------------------------------------------*/
+/**
+ * Reads free cluster count and next free cluster hint from the FSInfo sector.
+ * If there is no (valid) FSInfo, the search for free clusters starts at the
+ * beginning of the FAT.
+ */
+static void
+read_fsinfo()
+{
+  uint8_t *buf;
+  uint32_t nxt_free;
+
+  mounted->next_free = 2;
+  mounted->free_count = FSI_UNKNOWN;
+  mounted->fsinfo_dirty = 0;
+
+  if (mounted->fsinfo_sector == 0 || mounted->fsinfo_sector >= mounted->info.BPB_RsvdSecCnt) {
+    mounted->fsinfo_sector = 0;
+    return;
+  }
+
+  if (read_sector(mounted->fsinfo_sector) != 0) {
+    mounted->fsinfo_sector = 0;
+    return;
+  }
+
+  buf = mounted->cur_sector->buffer;
+  /* FSI_LeadSig and FSI_StrucSig */
+  if (buf[0] != 0x52 || buf[1] != 0x52 || buf[2] != 0x61 || buf[3] != 0x41 ||
+          buf[484] != 0x72 || buf[485] != 0x72 || buf[486] != 0x41 || buf[487] != 0x61) {
+    PRINTERROR("\nfat.c: read_fsinfo(): Invalid FSInfo signature");
+    mounted->fsinfo_sector = 0;
+    return;
+  }
+
+  mounted->free_count = buf[488] + (((uint32_t) buf[489]) << 8) + (((uint32_t) buf[490]) << 16) + (((uint32_t) buf[491]) << 24);
+  if (mounted->free_count != FSI_UNKNOWN && mounted->free_count > mounted->max_cluster - 1) {
+    mounted->free_count = FSI_UNKNOWN;
+  }
+
+  nxt_free = buf[492] + (((uint32_t) buf[493]) << 8) + (((uint32_t) buf[494]) << 16) + (((uint32_t) buf[495]) << 24);
+  if (nxt_free >= 2 && nxt_free <= mounted->max_cluster) {
+    mounted->next_free = nxt_free;
+  }
+
+  PRINTF("\nfat.c: read_fsinfo(): free_count = %lu, next_free = %lu", mounted->free_count, mounted->next_free);
+}
+/*----------------------------------------------------------------------------*/
+/**
+ * Writes free cluster count and next free cluster hint back to the FSInfo
+ * sector if they were changed.
+ */
+static void
+write_fsinfo()
+{
+  uint8_t *buf;
+
+  if (mounted->fsinfo_sector == 0 || !mounted->fsinfo_dirty) {
+    return;
+  }
+
+  if (read_sector(mounted->fsinfo_sector) != 0) {
+    return;
+  }
+
+  buf = mounted->cur_sector->buffer;
+  buf[488] = (uint8_t) mounted->free_count;
+  buf[489] = (uint8_t) (mounted->free_count >> 8);
+  buf[490] = (uint8_t) (mounted->free_count >> 16);
+  buf[491] = (uint8_t) (mounted->free_count >> 24);
+  buf[492] = (uint8_t) mounted->next_free;
+  buf[493] = (uint8_t) (mounted->next_free >> 8);
+  buf[494] = (uint8_t) (mounted->next_free >> 16);
+  buf[495] = (uint8_t) (mounted->next_free >> 24);
+  mounted->cur_sector->dirty = 1;
+
+  mounted->fsinfo_dirty = 0;
+}
+/*----------------------------------------------------------------------------*/
+/**
+ * Umounts the current volume and invalidates its file descriptors.
+ */
+static void
+umount_volume()
+{
+  uint8_t i = 0;
+
+  // Write directory entries of open files, FSInfo and last buffers
+  sync_volume();
+
+  // invalidate file-descriptors
+  for (i = 0; i < FAT_FD_POOL_SIZE; i++) {
+    if (&volumes[fat_file_pool[i].volume] == mounted) {
+      fat_fd_pool[i].file = 0;
+    }
+  }
+
+  // Reset the device pointer, sector and directory cache
+  mounted->dev = 0;
+  mounted->prefix = NULL;
+  invalidate_sector_cache();
+  dir_cache_invalidate();
+#if FAT_DISCARD
+  mounted->num_discard = 0;
+#endif
+}
+/*----------------------------------------------------------------------------*/
 void
 cfs_fat_umount_device()
 {
   uint8_t i = 0;
 
-  // Write last buffer
-  cfs_fat_flush();
+#if FAT_SYNC_INTERVAL && !defined(FAT_COOPERATIVE)
+  process_exit(&cfs_fat_sync_process);
+#endif
 
-#if FAT_SYNC
-  // Write second FAT
-  cfs_fat_sync_fats();
+  for (i = 0; i < FAT_MAX_VOLUMES; i++) {
+    if (volumes[i].dev != 0) {
+      mounted = &volumes[i];
+      umount_volume();
+    }
+  }
+}
+/*----------------------------------------------------------------------------*/
+void
+cfs_fat_umount_volume(const char *prefix)
+{
+  uint8_t i = 0;
+  uint8_t left = 0;
+
+  for (i = 0; i < FAT_MAX_VOLUMES; i++) {
+    if (volumes[i].dev != 0 && strcmp(volumes[i].prefix, prefix) == 0) {
+      mounted = &volumes[i];
+      umount_volume();
+    }
+    if (volumes[i].dev != 0) {
+      left++;
+    }
+  }
+
+#if FAT_SYNC_INTERVAL && !defined(FAT_COOPERATIVE)
+  if (left == 0) {
+    process_exit(&cfs_fat_sync_process);
+  }
 #endif
+}
+/*----------------------------------------------------------------------------*/
+/**
+ * Makes the volume the given path belongs to the current one. The volume
+ * with the longest prefix the path starts with is used.
+ *
+ * \param path Absolute path including the volume prefix
+ * \return The path on the volume, NULL if no mounted volume matches
+ */
+static const char *
+select_volume(const char *path)
+{
+  struct file_system *vol = NULL;
+  size_t len, vol_len = 0;
+  uint8_t i;
 
-  // invalidate file-descriptors
-  for (i = 0; i < FAT_FD_POOL_SIZE; i++) {
-    fat_fd_pool[i].file = 0;
+  for (i = 0; i < FAT_MAX_VOLUMES; i++) {
+    if (volumes[i].dev == 0) {
+      continue;
+    }
+
+    len = strlen(volumes[i].prefix);
+    if (strncmp(path, volumes[i].prefix, len) != 0) {
+      continue;
+    }
+
+    // Prefix has to match a whole path part
+    if (len > 0 && path[len] != '/' && path[len] != '\0') {
+      continue;
+    }
+
+    if (vol == NULL || len > vol_len) {
+      vol = &volumes[i];
+      vol_len = len;
+    }
+  }
+
+  if (vol == NULL) {
+    return NULL;
   }
 
-  // Reset the device pointer and sector buffer
-  mounted.dev = 0;
-  sector_buffer_addr = 0;
+  mounted = vol;
+
+  // The prefix alone names the root directory of the volume
+  if (path[vol_len] == '\0') {
+    return "/";
+  }
+  return path + vol_len;
+}
+/*----------------------------------------------------------------------------*/
+/**
+ * Makes the volume the file of the given file descriptor lies on the
+ * current one.
+ *
+ * \return 0 on success, 1 if fd is invalid
+ */
+static uint8_t
+select_file_volume(int fd)
+{
+  if (fd < 0 || fd >= FAT_FD_POOL_SIZE || fat_fd_pool[fd].file == NULL) {
+    return 1;
+  }
+
+  mounted = &volumes[fat_file_pool[fd].volume];
+  return 0;
 }
 /*----------------------------------------------------------------------------*/
 /*CFS frontend functions*/
@@ -894,6 +1987,12 @@ cfs_open(const char *name, int flags)
     cfs_remove(name);
   }
 
+  name = select_volume(name);
+  if (name == NULL) {
+    PRINTF("\nfat.c: cfs_open(): No volume mounted!");
+    return -1;
+  }
+
   // find file on Disk
   if (!get_dir_entry(name, &dir_ent, &fat_file_pool[fd].dir_entry_sector, &fat_file_pool[fd].dir_entry_offset, (flags & CFS_WRITE) || (flags & CFS_APPEND))) {
     PRINTF("\nfat.c: cfs_open(): Could not fetch the directory entry!");
@@ -913,11 +2012,19 @@ cfs_open(const char *name, int flags)
   fat_file_pool[fd].cluster = dir_ent.DIR_FstClusLO + (((uint32_t) dir_ent.DIR_FstClusHI) << 16);
   fat_file_pool[fd].nth_cluster = fat_file_pool[fd].cluster;
   fat_file_pool[fd].n = 0;
+  reset_cluster_runs(&(fat_file_pool[fd]));
+  fat_file_pool[fd].reserved = 0;
+  fat_file_pool[fd].dir_entry_dirty = 0;
+  fat_file_pool[fd].volume = (uint8_t) (mounted - volumes);
   fat_fd_pool[fd].file = &(fat_file_pool[fd]);
   fat_fd_pool[fd].flags = (uint8_t) flags;
 
   // put read/write position in the right spot
   fat_fd_pool[fd].offset = 0;
+#if FAT_READ_AHEAD > 0
+  fat_fd_pool[fd].read_end = 0;
+  fat_fd_pool[fd].seq_reads = 0;
+#endif
   memcpy(&(fat_file_pool[fd].dir_entry), &dir_ent, sizeof (struct dir_entry));
 
   if (flags & CFS_APPEND) {
@@ -938,13 +2045,19 @@ cfs_close(int fd)
     return;
   }
 
-  if (fat_fd_pool[fd].file == NULL) {
+  if (select_file_volume(fd) != 0) {
     PRINTERROR("\nfat.c: cfs_close: file not found\n");
     return;
   }
 
-  update_dir_entry(fd);
-  cfs_fat_flush(fd);
+  if (fat_file_pool[fd].reserved) {
+    trim_cluster_chain(fd);
+  }
+
+  if (fat_file_pool[fd].dir_entry_dirty) {
+    update_dir_entry(fd);
+  }
+  flush_sector_cache();
   fat_fd_pool[fd].file = NULL;
 }
 /*----------------------------------------------------------------------------*/
@@ -956,6 +2069,10 @@ cfs_read(int fd, void *buf, unsigned int len)
   if ((fd < 0 || fd >= FAT_FD_POOL_SIZE) || (!(fat_fd_pool[fd].flags & CFS_READ))) {
     return -1;
   }
+
+  if (select_file_volume(fd) != 0) {
+    return -1;
+  }
   
   return fat_read_write(fd, buf, len, 0);
 }
@@ -963,6 +2080,10 @@ cfs_read(int fd, void *buf, unsigned int len)
 int
 cfs_write(int fd, const void *buf, unsigned int len)
 {
+  if (select_file_volume(fd) != 0) {
+    return -1;
+  }
+
   return fat_read_write(fd, buf, len, 1);
 }
 /*----------------------------------------------------------------------------*/
@@ -970,13 +2091,18 @@ static int
 fat_read_write(int fd, const void *buf, unsigned int len, unsigned char write)
 {
   /* offset within sector [bytes] */
-  uint16_t offset = fat_fd_pool[fd].offset % (uint32_t) mounted.info.BPB_BytesPerSec;
+  uint16_t offset = fat_fd_pool[fd].offset % (uint32_t) mounted->info.BPB_BytesPerSec;
   /* cluster offset */
-  uint32_t clusters = (fat_fd_pool[fd].offset / mounted.info.BPB_BytesPerSec) / mounted.info.BPB_SecPerClus;
+  uint32_t clusters = (fat_fd_pool[fd].offset / mounted->info.BPB_BytesPerSec) / mounted->info.BPB_SecPerClus;
   /* offset within cluster [sectors] */
-  uint8_t clus_offset = (fat_fd_pool[fd].offset / mounted.info.BPB_BytesPerSec) % mounted.info.BPB_SecPerClus;
+  uint8_t clus_offset = (fat_fd_pool[fd].offset / mounted->info.BPB_BytesPerSec) % mounted->info.BPB_SecPerClus;
   uint16_t i, j = 0;
   uint8_t *buffer = (uint8_t *) buf;
+  uint32_t sector;
+  const uint8_t *data;
+#ifndef FAT_COOPERATIVE
+  unsigned int num;
+#endif
 
   /* For read acces, check file length. */
   if (write == 0) {
@@ -992,17 +2118,69 @@ fat_read_write(int fd, const void *buf, unsigned int len, unsigned char write)
       PRINTDEBUG("Empty cluster or zero file size");
       return 0;
     }
-  }
 
-  while (load_next_sector_of_file(fd, clusters, clus_offset, write) == 0) {
-    PRINTF("\nfat.c: cfs_write(): Writing in sector %lu", sector_buffer_addr);
-    for (i = offset; i < mounted.info.BPB_BytesPerSec && j < len; i++, j++, fat_fd_pool[fd].offset++) {
+#if FAT_READ_AHEAD > 0
+    if (fat_fd_pool[fd].offset == fat_fd_pool[fd].read_end) {
+      if (fat_fd_pool[fd].seq_reads < 0xFF) {
+        fat_fd_pool[fd].seq_reads++;
+      }
+    } else {
+      fat_fd_pool[fd].seq_reads = 0;
+    }
+    fat_fd_pool[fd].read_end = fat_fd_pool[fd].offset + len;
+#endif
+  }
+
+  while ((sector = get_next_sector_of_file(fd, clusters, clus_offset, write)) != 0) {
+#ifndef FAT_COOPERATIVE
+    /* Whole sectors up to the end of the cluster are transferred at once
+     * directly between the medium and the callers buffer. */
+    if (offset == 0) {
+      num = (len - j) / mounted->info.BPB_BytesPerSec;
+      if (num > (unsigned int) (mounted->info.BPB_SecPerClus - clus_offset)) {
+        num = mounted->info.BPB_SecPerClus - clus_offset;
+      }
+
+      if (num > 0 && (write ? write_sectors(sector, num, &buffer[j]) : read_sectors(sector, num, &buffer[j])) == 0) {
+        j += num * mounted->info.BPB_BytesPerSec;
+        fat_fd_pool[fd].offset += num * mounted->info.BPB_BytesPerSec;
+        if (write) {
+          /* Enlarge file size if required */
+          if (fat_fd_pool[fd].offset > fat_file_pool[fd].dir_entry.DIR_FileSize) {
+            fat_file_pool[fd].dir_entry.DIR_FileSize = fat_fd_pool[fd].offset;
+          }
+          fat_file_pool[fd].dir_entry_dirty = 1;
+        }
+        clus_offset = (clus_offset + num) % mounted->info.BPB_SecPerClus;
+        if (clus_offset == 0) {
+          clusters++;
+        }
+
+        if (j >= len) {
+          break;
+        }
+        continue;
+      }
+    }
+#endif /* !FAT_COOPERATIVE */
+
+    data = NULL;
+#if READ_AHEAD
+    if (!write && fat_fd_pool[fd].seq_reads >= READ_AHEAD_SEQ_READS) {
+      data = read_ahead_get(fd, sector, clusters, clus_offset);
+    }
+#endif
+    if (data == NULL) {
+      if (read_sector(sector) != 0) {
+        break;
+      }
+      data = mounted->cur_sector->buffer;
+    }
+
+    PRINTF("\nfat.c: cfs_write(): Writing in sector %lu", mounted->cur_sector->addr);
+    for (i = offset; i < mounted->info.BPB_BytesPerSec && j < len; i++, j++, fat_fd_pool[fd].offset++) {
       if (write) {
-#ifndef FAT_COOPERATIVE
-        sector_buffer[i] = buffer[j];
-#else
-        sector_buffer[i] = get_item_from_buffer(buffer, j);
-#endif
+        mounted->cur_sector->buffer[i] = buffer[j];
         /* Enlarge file size if required */
         if (fat_fd_pool[fd].offset == fat_file_pool[fd].dir_entry.DIR_FileSize) {
           fat_file_pool[fd].dir_entry.DIR_FileSize++;
@@ -1010,16 +2188,17 @@ fat_read_write(int fd, const void *buf, unsigned int len, unsigned char write)
           fat_file_pool[fd].dir_entry.DIR_FileSize = fat_fd_pool[fd].offset;
         }
       } else {/* read */
-        buffer[j] = sector_buffer[i];
+        buffer[j] = data[i];
       }
     }
 
     if (write) {
-      sector_buffer_dirty = 1;
+      mounted->cur_sector->dirty = 1;
+      fat_file_pool[fd].dir_entry_dirty = 1;
     }
     
     offset = 0;
-    clus_offset = (clus_offset + 1) % mounted.info.BPB_SecPerClus;
+    clus_offset = (clus_offset + 1) % mounted->info.BPB_SecPerClus;
     if (clus_offset == 0) {
       clusters++;
     }
@@ -1047,18 +2226,15 @@ cfs_seek(int fd, cfs_offset_t offset, int whence)
       fat_fd_pool[fd].offset += offset;
       break;
     case CFS_SEEK_END:
-      fat_fd_pool[fd].offset = (fat_file_pool[fd].dir_entry.DIR_FileSize - 1) + offset;
+      fat_fd_pool[fd].offset = fat_file_pool[fd].dir_entry.DIR_FileSize + offset;
       break;
     default:
       break;
   }
 
-  if (fat_fd_pool[fd].offset >= fat_file_pool[fd].dir_entry.DIR_FileSize) {
-    fat_fd_pool[fd].offset = (fat_file_pool[fd].dir_entry.DIR_FileSize - 1);
-  }
-
-  if (fat_fd_pool[fd].offset < 0) {
-    fat_fd_pool[fd].offset = 0;
+  /* The end of the file is a valid position, following writes append */
+  if (fat_fd_pool[fd].offset > fat_file_pool[fd].dir_entry.DIR_FileSize) {
+    fat_fd_pool[fd].offset = fat_file_pool[fd].dir_entry.DIR_FileSize;
   }
 
   return fat_fd_pool[fd].offset;
@@ -1071,6 +2247,11 @@ cfs_remove(const char *name)
   uint32_t sector;
   uint16_t offset;
 
+  name = select_volume(name);
+  if (name == NULL) {
+    return -1;
+  }
+
   if (!get_dir_entry(name, &dir_ent, &sector, &offset, 0)) {
     return -1;
   }
@@ -1078,7 +2259,7 @@ cfs_remove(const char *name)
   if (_is_file(&dir_ent)) {
     reset_cluster_chain(&dir_ent);
     remove_dir_entry(sector, offset);
-    cfs_fat_flush();
+    flush_sector_cache();
     return 0;
   }
 
@@ -1088,105 +2269,372 @@ cfs_remove(const char *name)
 int
 cfs_opendir(struct cfs_dir *dirp, const char *name)
 {
+  struct dir_cursor *cursor = (struct dir_cursor *) dirp;
   struct dir_entry dir_ent;
   uint32_t sector;
   uint16_t offset;
-  uint32_t dir_cluster = get_dir_entry(name, &dir_ent, &sector, &offset, 0);
+  uint32_t dir_cluster;
 
-  cfs_readdir_offset = 0;
+  name = select_volume(name);
+  if (name == NULL) {
+    return -1;
+  }
 
+  dir_cluster = get_dir_entry(name, &dir_ent, &sector, &offset, 0);
   if (dir_cluster == 0) {
     return -1;
   }
 
-  memcpy(dirp, &dir_ent, sizeof (struct dir_entry));
+  cursor->cluster = (((uint32_t) dir_ent.DIR_FstClusHI) << 16) + dir_ent.DIR_FstClusLO;
+  cursor->cluster_pos = 0;
+  cursor->index = 0;
+  cursor->volume = (uint8_t) (mounted - volumes);
   return 0;
 }
 /*----------------------------------------------------------------------------*/
 int
 cfs_readdir(struct cfs_dir *dirp, struct cfs_dirent *dirent)
 {
-  struct dir_entry *dir_ent = (struct dir_entry *) dirp;
+  struct dir_cursor *cursor = (struct dir_cursor *) dirp;
   struct dir_entry entry;
+  uint32_t cluster_size, dir_off;
+  uint8_t *raw;
+#if FAT_LFN
+  uint8_t lfn_ord = 0, lfn_sum = 0, ord, i;
+  uint16_t pos, c;
+#endif
+
+  if (cursor->volume >= FAT_MAX_VOLUMES || volumes[cursor->volume].dev == 0) {
+    return -1;
+  }
+  mounted = &volumes[cursor->volume];
+
+  cluster_size = (uint32_t) mounted->info.BPB_BytesPerSec * mounted->info.BPB_SecPerClus;
+
+  for (;;) { /* Get the next directory_entry */
+    dir_off = (uint32_t) cursor->index * 32;
 
-  { /* Get the next directory_entry */
-    uint32_t dir_off = cfs_readdir_offset * 32;
-    uint16_t cluster_num = dir_off / mounted.info.BPB_SecPerClus;
-    uint32_t cluster;
+    if (dir_off / cluster_size != cursor->cluster_pos) {
+      /* Entries are read in order, this is the next cluster of the chain */
+      if (cursor->cluster < 2 || is_EOC(cursor->cluster)) {
+        return -1;
+      }
+      cursor->cluster = read_fat_entry(cursor->cluster);
+      cursor->cluster_pos++;
+    }
+    if (cursor->cluster < 2 || is_EOC(cursor->cluster)) {
+      return -1;
+    }
 
-    cluster = find_nth_cluster((((uint32_t) dir_ent->DIR_FstClusHI) << 16) + dir_ent->DIR_FstClusLO, (uint32_t) cluster_num);
-    if (cluster == 0) {
+    if (read_sector(CLUSTER_TO_SECTOR(cursor->cluster) + (dir_off % cluster_size) / mounted->info.BPB_BytesPerSec) != 0) {
       return -1;
     }
 
-    if (read_sector(CLUSTER_TO_SECTOR(cluster) + dir_off / mounted.info.BPB_BytesPerSec) != 0) {
+    raw = &(mounted->cur_sector->buffer[dir_off % mounted->info.BPB_BytesPerSec]);
+
+    // There are no more entries in this directory
+    if (raw[0] == FAT_FLAG_FREE) {
       return -1;
     }
 
-    memcpy(&entry, &(sector_buffer[dir_off % mounted.info.BPB_BytesPerSec]), sizeof (struct dir_entry));
+    cursor->index++;
+
+#if FAT_LFN
+    /* Assemble the long name in dirent->name, the last part comes first */
+    if ((raw[11] & ATTR_LONG_NAME_MASK) == ATTR_LONG_NAME) {
+      ord = raw[0] & LFN_ORD_MASK;
+      if (raw[0] == FAT_FLAG_DELETED || ord == 0) {
+        lfn_ord = 0;
+        continue;
+      }
+
+      if (raw[0] & LFN_LAST_ENTRY) {
+        lfn_sum = raw[LFN_CHECKSUM_OFF];
+        memset(dirent->name, 0, sizeof (dirent->name));
+      } else if (lfn_ord != ord + 1 || lfn_sum != raw[LFN_CHECKSUM_OFF]) {
+        lfn_ord = 0;
+        continue;
+      }
+      lfn_ord = ord;
+
+      for (i = 0, pos = (ord - 1) * LFN_CHARS; i < LFN_CHARS && pos < sizeof (dirent->name) - 1; i++, pos++) {
+        c = raw[lfn_char_offsets[i]] | ((uint16_t) raw[lfn_char_offsets[i] + 1] << 8);
+        if (c == 0) {
+          break;
+        }
+        dirent->name[pos] = (c > 0x7F) ? '?' : c;
+      }
+      continue;
+    }
+#endif
+
+    if (raw[0] == FAT_FLAG_DELETED || (raw[11] & ATTR_VOLUME_ID)) {
+#if FAT_LFN
+      lfn_ord = 0;
+#endif
+      continue;
+    }
+
+    memcpy(&entry, raw, sizeof (struct dir_entry));
+    break;
   }
 
+#if FAT_LFN
+  /* Long names longer than the dirent name are truncated */
+  if (lfn_ord != 1 || lfn_sum != lfn_checksum(entry.DIR_Name)) {
+    make_readable_entry(&entry, dirent);
+  }
+#else
   make_readable_entry(&entry, dirent);
+#endif
   dirent->size = entry.DIR_FileSize;
-  cfs_readdir_offset++;
   return 0;
 }
 /*----------------------------------------------------------------------------*/
 void
 cfs_closedir(struct cfs_dir *dirp)
 {
-  cfs_readdir_offset = 0;
+}
+/*----------------------------------------------------------------------------*/
+/*Directory Cache Functions*/
+/* Forgets all cached directory entries. */
+static void
+dir_cache_invalidate()
+{
+#if FAT_DIR_CACHE_SIZE > 0
+  uint8_t i;
+
+  for (i = 0; i < FAT_DIR_CACHE_SIZE; i++) {
+    mounted->dir_cache[i].parent = 0;
+  }
+#endif
+}
+/*----------------------------------------------------------------------------*/
+/*
+ * Looks for the entry of the current path part in the directory starting at
+ * sector parent in the directory cache. Entries match by their 8.3 name or,
+ * with FAT_LFN, by the hash of the path part they were found with, so long
+ * names are found without scanning the directory.
+ * Returns 0 if it was found, 1 otherwise.
+ */
+static uint8_t
+dir_cache_lookup(uint32_t parent, struct PathResolver *pr, struct dir_entry *dir_entry, uint32_t *dir_entry_sector, uint16_t *dir_entry_offset)
+{
+#if FAT_DIR_CACHE_SIZE > 0
+  uint8_t i;
+
+  for (i = 0; i < FAT_DIR_CACHE_SIZE; i++) {
+    if (mounted->dir_cache[i].parent != parent) {
+      continue;
+    }
+
+    if ((pr->valid && memcmp(pr->name, mounted->dir_cache[i].dir_entry.DIR_Name, 11) == 0)
+#if FAT_LFN
+            || mounted->dir_cache[i].name_hash == pr->hash
+#endif
+            ) {
+      memcpy(dir_entry, &(mounted->dir_cache[i].dir_entry), sizeof (struct dir_entry));
+      *dir_entry_sector = mounted->dir_cache[i].dir_entry_sector;
+      *dir_entry_offset = mounted->dir_cache[i].dir_entry_offset;
+      PRINTF("\nfat.c: dir_cache_lookup( parent = %lu ): hit, *dir_entry_sector = %lu, *dir_entry_offset = %u", parent, *dir_entry_sector, *dir_entry_offset);
+      return 0;
+    }
+  }
+#endif
+
+  return 1;
+}
+/*----------------------------------------------------------------------------*/
+/* Adds the directory entry of the current path part, replacing the oldest
+ * cached one. */
+static void
+dir_cache_add(uint32_t parent, struct PathResolver *pr, struct dir_entry *dir_entry, uint32_t dir_entry_sector, uint16_t dir_entry_offset)
+{
+#if FAT_DIR_CACHE_SIZE > 0
+  struct dir_cache_entry *entry = &mounted->dir_cache[mounted->dir_cache_next];
+
+  mounted->dir_cache_next = (mounted->dir_cache_next + 1) % FAT_DIR_CACHE_SIZE;
+
+  entry->parent = parent;
+#if FAT_LFN
+  entry->name_hash = pr->hash;
+#endif
+  entry->dir_entry_sector = dir_entry_sector;
+  entry->dir_entry_offset = dir_entry_offset;
+  memcpy(&(entry->dir_entry), dir_entry, sizeof (struct dir_entry));
+#endif
+}
+/*----------------------------------------------------------------------------*/
+/*
+ * Updates the cached copy of the directory entry at the given position.
+ * If dir_entry is NULL the entry was removed and is dropped from the cache.
+ */
+static void
+dir_cache_update(uint32_t dir_entry_sector, uint16_t dir_entry_offset, struct dir_entry *dir_entry)
+{
+#if FAT_DIR_CACHE_SIZE > 0
+  uint8_t i;
+
+  for (i = 0; i < FAT_DIR_CACHE_SIZE; i++) {
+    if (mounted->dir_cache[i].parent != 0 && mounted->dir_cache[i].dir_entry_sector == dir_entry_sector && mounted->dir_cache[i].dir_entry_offset == dir_entry_offset) {
+      if (dir_entry == NULL) {
+        mounted->dir_cache[i].parent = 0;
+      } else {
+        memcpy(&(mounted->dir_cache[i].dir_entry), dir_entry, sizeof (struct dir_entry));
+      }
+    }
+  }
+#endif
 }
 /*----------------------------------------------------------------------------*/
 /*Dir_entry Functions*/
 /**
- * Looks for file name starting at current sector buffer address.
+ * Looks for the current path part of pr starting at current sector buffer
+ * address. Entries match by their 8.3 name or, with FAT_LFN, by their long
+ * name (case insensitive).
  * \note sector buffer address must point to the sector to start search from.
  * \note 
- * @param name  name of the directory/file to find
+ * @param pr    path resolver holding the directory/file name to find
  * @param dir_entry   Pointer to directory entry to store infos about file if found
  * @param dir_entry_sector  Pointer to variable to store sector address of found file
  * @param dir_entry_offset  Pointer to variable to store sector address offset of found file
  * @return returns 0 if found, 1 if not found, 128 if end of cluster chain reached
  */
 static uint8_t
-lookup(const char *name, struct dir_entry *dir_entry, uint32_t *dir_entry_sector, uint16_t *dir_entry_offset)
+lookup(struct PathResolver *pr, struct dir_entry *dir_entry, uint32_t *dir_entry_sector, uint16_t *dir_entry_offset)
 {
   uint16_t i = 0;
-  PRINTF("\nfat.c: BEGIN lookup( name = %c%c%c%c%c%c%c%c%c%c%c, dir_entry = %p, *dir_entry_sector = %lu, *dir_entry_offset = %u) = ?", name[0], name[1], name[2], name[3], name[4], name[5], name[6], name[7], name[8], name[9], name[10], dir_entry, *dir_entry_sector, *dir_entry_offset);
+  uint8_t *entry;
+#if FAT_LFN
+  struct lfn_state lfn;
+
+  memset(&lfn, 0, sizeof(lfn));
+#endif
+  PRINTF("\nfat.c: BEGIN lookup( name = %.11s, dir_entry = %p, *dir_entry_sector = %lu, *dir_entry_offset = %u) = ?", pr->name, dir_entry, *dir_entry_sector, *dir_entry_offset);
   for (;;) {
     /* iterate over all directory entries in current sector */
     for (i = 0; i < 512; i += 32) {
-      PRINTF("\nfat.c: lookup(): name = %c%c%c%c%c%c%c%c%c%c%c", name[0], name[1], name[2], name[3], name[4], name[5], name[6], name[7], name[8], name[9], name[10]);
-      PRINTF("\nfat.c: lookup(): sec_buf = %c%c%c%c%c%c%c%c%c%c%c", sector_buffer[i + 0], sector_buffer[i + 1], sector_buffer[i + 2], sector_buffer[i + 3], sector_buffer[i + 4], sector_buffer[i + 5], sector_buffer[i + 6], sector_buffer[i + 7], sector_buffer[i + 8], sector_buffer[i + 9], sector_buffer[i + 10]);
-      if (memcmp(name, &(sector_buffer[i]), 11) == 0) {
-        memcpy(dir_entry, &(sector_buffer[i]), sizeof (struct dir_entry));
-        *dir_entry_sector = sector_buffer_addr;
-        *dir_entry_offset = i;
-        PRINTF("\nfat.c: END lookup( name = %c%c%c%c%c%c%c%c%c%c%c, dir_entry = %p, *dir_entry_sector = %lu, *dir_entry_offset = %u) = 0", name[0], name[1], name[2], name[3], name[4], name[5], name[6], name[7], name[8], name[9], name[10], dir_entry, *dir_entry_sector, *dir_entry_offset);
-        return 0;
-      }
+      entry = &(mounted->cur_sector->buffer[i]);
+      PRINTF("\nfat.c: lookup(): sec_buf = %.11s", entry);
 
       // There are no more entries in this directory
-      if (sector_buffer[i] == FAT_FLAG_FREE) {
+      if (entry[0] == FAT_FLAG_FREE) {
         PRINTF("\nfat.c: lookup(): No more directory entries");
-        PRINTF("\nfat.c: END lookup( name = %c%c%c%c%c%c%c%c%c%c%c, dir_entry = %p, *dir_entry_sector = %lu, *dir_entry_offset = %u) = 1", name[0], name[1], name[2], name[3], name[4], name[5], name[6], name[7], name[8], name[9], name[10], dir_entry, *dir_entry_sector, *dir_entry_offset);
+        PRINTF("\nfat.c: END lookup( name = %.11s, dir_entry = %p, *dir_entry_sector = %lu, *dir_entry_offset = %u) = 1", pr->name, dir_entry, *dir_entry_sector, *dir_entry_offset);
         return 1;
       }
+
+#if FAT_LFN
+      if ((entry[11] & ATTR_LONG_NAME_MASK) == ATTR_LONG_NAME) {
+        lfn_match_entry(entry, pr, &lfn);
+        continue;
+      }
+#endif
+
+      if ((pr->valid && memcmp(pr->name, entry, 11) == 0)
+#if FAT_LFN
+              || (entry[0] != FAT_FLAG_DELETED && lfn.ord == 1 && lfn.match && lfn.checksum == lfn_checksum(entry))
+#endif
+              ) {
+        memcpy(dir_entry, entry, sizeof (struct dir_entry));
+        *dir_entry_sector = mounted->cur_sector->addr;
+        *dir_entry_offset = i;
+        PRINTF("\nfat.c: END lookup( name = %.11s, dir_entry = %p, *dir_entry_sector = %lu, *dir_entry_offset = %u) = 0", pr->name, dir_entry, *dir_entry_sector, *dir_entry_offset);
+        return 0;
+      }
+
+#if FAT_LFN
+      lfn.ord = 0;
+#endif
     }
 
     /* Read next sector */
     uint8_t fns;
     if ((fns = read_next_sector()) != 0) {
-      PRINTF("\nfat.c: END lookup( name = %c%c%c%c%c%c%c%c%c%c%c, dir_entry = %p, *dir_entry_sector = %lu, *dir_entry_offset = %u) = 2", name[0], name[1], name[2], name[3], name[4], name[5], name[6], name[7], name[8], name[9], name[10], dir_entry, *dir_entry_sector, *dir_entry_offset);
+      PRINTF("\nfat.c: END lookup( name = %.11s, dir_entry = %p, *dir_entry_sector = %lu, *dir_entry_offset = %u) = 2", pr->name, dir_entry, *dir_entry_sector, *dir_entry_offset);
       return fns;
     }
   }
 
-  PRINTF("\nfat.c: END lookup( name = %c%c%c%c%c%c%c%c%c%c%c, dir_entry = %p, *dir_entry_sector = %lu, *dir_entry_offset = %u) = 0", name[0], name[1], name[2], name[3], name[4], name[5], name[6], name[7], name[8], name[9], name[10], dir_entry, *dir_entry_sector, *dir_entry_offset);
   return 0;
 }
 /*----------------------------------------------------------------------------*/
+#if FAT_LFN
+/**
+ * Calculates the checksum of a short name stored in its long name entries.
+ */
+static uint8_t
+lfn_checksum(const uint8_t *short_name)
+{
+  uint8_t i, sum = 0;
+
+  for (i = 0; i < 11; i++) {
+    sum = ((sum & 1) << 7) + (sum >> 1) + short_name[i];
+  }
+
+  return sum;
+}
+/*----------------------------------------------------------------------------*/
+/**
+ * Calculates a case insensitive hash (FNV-1a) of a name.
+ */
+static uint32_t
+lfn_hash(const char *name, uint8_t len)
+{
+  uint32_t hash = 2166136261UL;
+
+  while (len-- > 0) {
+    hash ^= (uint8_t) tolower((uint8_t) *name++);
+    hash *= 16777619UL;
+  }
+
+  return hash;
+}
+/*----------------------------------------------------------------------------*/
+/**
+ * Compares the part of the long name stored in the given long name entry
+ * to the current path part of pr and updates the state of the long name.
+ *
+ * Long names are matched part by part while the entries are read, so a
+ * mismatching or orphaned long name is skipped without assembling it.
+ * A long name of the wrong length is recognized by its first entry.
+ */
+static void
+lfn_match_entry(const uint8_t *entry, struct PathResolver *pr, struct lfn_state *lfn)
+{
+  uint8_t ord = entry[0] & LFN_ORD_MASK;
+  uint16_t pos, c;
+  uint8_t i;
+
+  if (entry[0] == FAT_FLAG_DELETED || ord == 0) {
+    lfn->ord = 0;
+    return;
+  }
+
+  if (entry[0] & LFN_LAST_ENTRY) {
+    // First entry on disk, holds the end of the name
+    lfn->checksum = entry[LFN_CHECKSUM_OFF];
+    lfn->match = (pr->len > (ord - 1) * LFN_CHARS && pr->len <= ord * LFN_CHARS);
+  } else if (lfn->ord != ord + 1 || lfn->checksum != entry[LFN_CHECKSUM_OFF]) {
+    lfn->ord = 0;
+    return;
+  }
+
+  lfn->ord = ord;
+
+  for (i = 0, pos = (ord - 1) * LFN_CHARS; i < LFN_CHARS && lfn->match; i++, pos++) {
+    c = entry[lfn_char_offsets[i]] | ((uint16_t) entry[lfn_char_offsets[i] + 1] << 8);
+    if (pos == pr->len) {
+      lfn->match = (c == 0);
+      break;
+    }
+    if (c > 0x7F || tolower(c) != tolower((uint8_t) pr->path[pr->start + pos])) {
+      lfn->match = 0;
+    }
+  }
+}
+#endif /* FAT_LFN */
+/*----------------------------------------------------------------------------*/
 /**
  * 
  * @param path
@@ -1208,28 +2656,36 @@ get_dir_entry(const char *path, struct dir_entry *dir_ent, uint32_t *dir_entry_s
   pr_reset(&pr);
   pr.path = path;
 
-  if (mounted.info.type == FAT16) {
+  if (mounted->info.type == FAT16) {
     // calculate the first cluster of the root dir
-    first_root_dir_sec_num = mounted.info.BPB_RsvdSecCnt + (mounted.info.BPB_NumFATs * mounted.info.BPB_FATSz); // TODO Verify this is correct
-  } else if (mounted.info.type == FAT32) {
+    first_root_dir_sec_num = mounted->info.BPB_RsvdSecCnt + (mounted->info.BPB_NumFATs * mounted->info.BPB_FATSz); // TODO Verify this is correct
+  } else if (mounted->info.type == FAT32) {
     // BPB_RootClus is the first cluster of the root dir
-    first_root_dir_sec_num = CLUSTER_TO_SECTOR(mounted.info.BPB_RootClus);
+    first_root_dir_sec_num = CLUSTER_TO_SECTOR(mounted->info.BPB_RootClus);
   }
   PRINTF("\nfat.c: get_dir_entry(): first_root_dir_sec_num = %lu", first_root_dir_sec_num);
 
   file_sector_num = first_root_dir_sec_num;
   for (i = 0; pr_get_next_path_part(&pr) == 0 && i < 255; i++) {
-    read_sector(file_sector_num);
-    if (lookup(pr.name, dir_ent, dir_entry_sector, dir_entry_offset) != 0) {
-      PRINTF("\nfat.c: get_dir_entry(): Current path part doesn't exist!");
-      if (pr_is_current_path_part_a_file(&pr) && create) {
-        PRINTF("\nfat.c: get_dir_entry(): Current path part describes a file and it should be created!");
-        memset(dir_ent, 0, sizeof (struct dir_entry));
-        memcpy(dir_ent->DIR_Name, pr.name, 11);
-        dir_ent->DIR_Attr = 0;
-        return add_directory_entry_to_current(dir_ent, dir_entry_sector, dir_entry_offset);
+    if (dir_cache_lookup(file_sector_num, &pr, dir_ent, dir_entry_sector, dir_entry_offset) != 0) {
+      read_sector(file_sector_num);
+      if (lookup(&pr, dir_ent, dir_entry_sector, dir_entry_offset) != 0) {
+        PRINTF("\nfat.c: get_dir_entry(): Current path part doesn't exist!");
+        /* Only files with a valid 8.3 name can be created */
+        if (pr_is_current_path_part_a_file(&pr) && create && pr.valid) {
+          PRINTF("\nfat.c: get_dir_entry(): Current path part describes a file and it should be created!");
+          memset(dir_ent, 0, sizeof (struct dir_entry));
+          memcpy(dir_ent->DIR_Name, pr.name, 11);
+          dir_ent->DIR_Attr = 0;
+          if (add_directory_entry_to_current(dir_ent, dir_entry_sector, dir_entry_offset) == 0) {
+            return 0;
+          }
+          dir_cache_add(file_sector_num, &pr, dir_ent, *dir_entry_sector, *dir_entry_offset);
+          return 1;
+        }
+        return 0;
       }
-      return 0;
+      dir_cache_add(file_sector_num, &pr, dir_ent, *dir_entry_sector, *dir_entry_offset);
     }
     file_sector_num = CLUSTER_TO_SECTOR(dir_ent->DIR_FstClusLO + (((uint32_t) dir_ent->DIR_FstClusHI) << 16));
     PRINTF("\nfat.c: get_dir_entry(): file_sector_num = %lu", file_sector_num);
@@ -1256,16 +2712,16 @@ add_directory_entry_to_current(struct dir_entry *dir_ent, uint32_t *dir_entry_se
   uint8_t ret = 0;
 
   // TODO: security check
-  // if (sector_buffer_addr < first data sector) ... Error, we try to write dir into FAT region...
+  // if (mounted->cur_sector->addr < first data sector) ... Error, we try to write dir into FAT region...
 
   PRINTF("\nfat.c: add_directory_entry_to_current( dir_ent = %p, *dir_entry_sector = %lu, *dir_entry_offset = %u ) = ?", dir_ent, *dir_entry_sector, *dir_entry_offset);
   for (;;) {
     /* iterate over all directory entries in current sector */
     for (i = 0; i < 512; i += 32) {
-      if (sector_buffer[i] == FAT_FLAG_FREE || sector_buffer[i] == FAT_FLAG_DELETED) {
-        memcpy(&(sector_buffer[i]), dir_ent, sizeof (struct dir_entry));
-        sector_buffer_dirty = 1;
-        *dir_entry_sector = sector_buffer_addr;
+      if (mounted->cur_sector->buffer[i] == FAT_FLAG_FREE || mounted->cur_sector->buffer[i] == FAT_FLAG_DELETED) {
+        memcpy(&(mounted->cur_sector->buffer[i]), dir_ent, sizeof (struct dir_entry));
+        mounted->cur_sector->dirty = 1;
+        *dir_entry_sector = mounted->cur_sector->addr;
         *dir_entry_offset = i;
         PRINTF("\nfat.c: add_directory_entry_to_current(): Found empty directory entry! *dir_entry_sector = %lu, *dir_entry_offset = %u", *dir_entry_sector, *dir_entry_offset);
         return 1;
@@ -1273,32 +2729,33 @@ add_directory_entry_to_current(struct dir_entry *dir_ent, uint32_t *dir_entry_se
     }
 
     /* If no free directory entry was found, switch to next sector */
-    PRINTF("\nfat.c: add_directory_entry_to_current(): No free entry in current sector (sector_buffer_addr = %lu) reading next sector!", sector_buffer_addr);
+    PRINTF("\nfat.c: add_directory_entry_to_current(): No free entry in current sector (sector = %lu) reading next sector!", mounted->cur_sector->addr);
     if ((ret = read_next_sector()) != 0) {
       /* if end of cluster reached, get free cluster */
       if (ret == 128) {
-        uint32_t last_sector = sector_buffer_addr;
-        uint32_t free_cluster = get_free_cluster(SECTOR_TO_CLUSTER(sector_buffer_addr)); // TODO: any free cluster? start at (0)
+        uint32_t last_sector = mounted->cur_sector->addr;
+        uint32_t free_cluster = get_free_cluster(0);
         PRINTF("\nfat.c: add_directory_entry_to_current(): The directory cluster chain is too short, we need to add another cluster!");
 
+        if (free_cluster == 0) {
+          return 0;
+        }
+
         write_fat_entry(SECTOR_TO_CLUSTER(last_sector), free_cluster);
         write_fat_entry(free_cluster, EOC);
-        PRINTF("\nfat.c: add_directory_entry_to_current(): cluster %lu added to chain of sector_buffer_addr cluster %lu", free_cluster, SECTOR_TO_CLUSTER(sector_buffer_addr));
+        PRINTF("\nfat.c: add_directory_entry_to_current(): cluster %lu added to chain of current sector cluster %lu", free_cluster, SECTOR_TO_CLUSTER(mounted->cur_sector->addr));
 
-        cfs_fat_flush();
-        /* Iterate over all sectors in new allocated cluster and clear them. */
+        /* Iterate over all sectors in new allocated cluster and clear them.
+         * Done backwards to keep the first sector cached for the new entry. */
         uint32_t first_free_sector = CLUSTER_TO_SECTOR(free_cluster);
-        memset(sector_buffer, 0x00, 512);
-        for (i = 0; i < mounted.info.BPB_SecPerClus; i++) {
-          sector_buffer_addr = first_free_sector + i;
-          sector_buffer_dirty = 1;
-          cfs_fat_flush();
+        for (i = mounted->info.BPB_SecPerClus; i > 0; i--) {
+          clear_sector(first_free_sector + i - 1);
         }
 
         if (read_sector(CLUSTER_TO_SECTOR(free_cluster)) == 0) {
-          memcpy(&(sector_buffer[0]), dir_ent, sizeof (struct dir_entry));
-          sector_buffer_dirty = 1;
-          *dir_entry_sector = sector_buffer_addr;
+          memcpy(&(mounted->cur_sector->buffer[0]), dir_ent, sizeof (struct dir_entry));
+          mounted->cur_sector->dirty = 1;
+          *dir_entry_sector = mounted->cur_sector->addr;
           *dir_entry_offset = 0;
           PRINTF("\nfat.c: add_directory_entry_to_current(): read of the newly added cluster successful! *dir_entry_sector = %lu, *dir_entry_offset = %u", *dir_entry_sector, *dir_entry_offset);
           return 1;
@@ -1320,8 +2777,10 @@ update_dir_entry(int fd)
     return;
   }
 
-  memcpy(&(sector_buffer[fat_file_pool[fd].dir_entry_offset]), &(fat_file_pool[fd].dir_entry), sizeof (struct dir_entry));
-  sector_buffer_dirty = 1;
+  memcpy(&(mounted->cur_sector->buffer[fat_file_pool[fd].dir_entry_offset]), &(fat_file_pool[fd].dir_entry), sizeof (struct dir_entry));
+  mounted->cur_sector->dirty = 1;
+  fat_file_pool[fd].dir_entry_dirty = 0;
+  dir_cache_update(fat_file_pool[fd].dir_entry_sector, fat_file_pool[fd].dir_entry_offset, &(fat_file_pool[fd].dir_entry));
 }
 /*----------------------------------------------------------------------------*/
 static void
@@ -1333,53 +2792,162 @@ remove_dir_entry(uint32_t dir_entry_sector, uint16_t dir_entry_offset)
     return;
   }
 
-  memset(&(sector_buffer[dir_entry_offset]), 0, sizeof (struct dir_entry));
-  sector_buffer[dir_entry_offset] = FAT_FLAG_DELETED;
-  sector_buffer_dirty = 1;
+#if FAT_LFN
+  { /* Delete the long name entries in front of the short entry as well.
+     * Ones in the previous sector are left, their checksum does not match
+     * a short entry anymore. */
+    uint8_t checksum = lfn_checksum(&(mounted->cur_sector->buffer[dir_entry_offset]));
+    uint8_t *entry;
+    uint16_t offset = dir_entry_offset;
+
+    while (offset >= 32) {
+      offset -= 32;
+      entry = &(mounted->cur_sector->buffer[offset]);
+      if ((entry[11] & ATTR_LONG_NAME_MASK) != ATTR_LONG_NAME || entry[0] == FAT_FLAG_DELETED
+              || entry[LFN_CHECKSUM_OFF] != checksum) {
+        break;
+      }
+      if (entry[0] & LFN_LAST_ENTRY) {
+        entry[0] = FAT_FLAG_DELETED;
+        break;
+      }
+      entry[0] = FAT_FLAG_DELETED;
+    }
+  }
+#endif
+
+  memset(&(mounted->cur_sector->buffer[dir_entry_offset]), 0, sizeof (struct dir_entry));
+  mounted->cur_sector->buffer[dir_entry_offset] = FAT_FLAG_DELETED;
+  mounted->cur_sector->dirty = 1;
+  dir_cache_update(dir_entry_sector, dir_entry_offset, NULL);
 }
 /*----------------------------------------------------------------------------*/
 /*FAT Implementation Functions*/
-static uint8_t
-load_next_sector_of_file(int fd, uint32_t clusters, uint8_t clus_offset, uint8_t write)
+/* Returns the address of the sector clus_offset of the clusters-th cluster
+ * of the file, adding a cluster to the file if required for writing.
+ * Returns 0 if there is no such sector.
+ */
+static uint32_t
+get_next_sector_of_file(int fd, uint32_t clusters, uint8_t clus_offset, uint8_t write)
 {
   uint32_t cluster = 0;
-  PRINTF("\nfat.c: load_next_sector_of_file( fd = %d, clusters = %lu, clus_offset = %u, write = %u ) = ?", fd, clusters, clus_offset, write);
+  PRINTF("\nfat.c: get_next_sector_of_file( fd = %d, clusters = %lu, clus_offset = %u, write = %u ) = ?", fd, clusters, clus_offset, write);
 
   //If we know the nth Cluster already we do not have to recalculate it
   if (clusters == fat_file_pool[fd].n) {
-    PRINTF("\nfat.c: load_next_sector_of_file(): we know nth cluster already");
+    PRINTF("\nfat.c: get_next_sector_of_file(): we know nth cluster already");
     cluster = fat_file_pool[fd].nth_cluster;
-    //If we are now at the nth-1 Cluster it is easy to get the next cluster
-  } else if (clusters == fat_file_pool[fd].n + 1) {
-    PRINTF("\nfat.c: load_next_sector_of_file(): we need the cluster n and are at n-1");
-    cluster = read_fat_entry(fat_file_pool[fd].nth_cluster);
-    //Somehow our cluster-information is out of sync. We have to calculate the cluster the hard way.
+    //Otherwise look it up in the known cluster runs or walk the chain from the nearest known cluster
   } else {
-    PRINTF("\nfat.c: load_next_sector_of_file(): We are somewhere else, need to iterate the chain until nth cluster");
-    cluster = find_nth_cluster(fat_file_pool[fd].cluster, clusters);
+    PRINTF("\nfat.c: get_next_sector_of_file(): We are somewhere else, need to find the nth cluster");
+    cluster = find_file_cluster(&(fat_file_pool[fd]), clusters);
   }
-  PRINTF("\nfat.c: load_next_sector_of_file(): fat_file_pool[%d].nth_cluster = %lu, fat_file_pool[%d].n = %lu", fd, fat_file_pool[fd].nth_cluster, fd, fat_file_pool[fd].n);
+  PRINTF("\nfat.c: get_next_sector_of_file(): fat_file_pool[%d].nth_cluster = %lu, fat_file_pool[%d].n = %lu", fd, fat_file_pool[fd].nth_cluster, fd, fat_file_pool[fd].n);
 
   // If there is no cluster allocated to the file or the current cluster is EOC then add another cluster to the file
   if (cluster == 0 || is_EOC(cluster)) {
-    PRINTF("\nfat.c: load_next_sector_of_file(): Either file is empty or current cluster is EOC!");
+    PRINTF("\nfat.c: get_next_sector_of_file(): Either file is empty or current cluster is EOC!");
     if (write) {
-      PRINTF("\nfat.c: load_next_sector_of_file(): write flag enabled! adding cluster to file!");
-      add_cluster_to_file(fd);
+      PRINTF("\nfat.c: get_next_sector_of_file(): write flag enabled! adding cluster to file!");
+      if (add_cluster_to_file(fd) != 0) {
+        return 0;
+      }
       // Remember that after the add_cluster_to_file-Function the nth_cluster and n is set to the added cluster
       cluster = fat_file_pool[fd].nth_cluster;
     } else {
-      return 1;
+      return 0;
     }
   } else {
     fat_file_pool[fd].nth_cluster = cluster;
     fat_file_pool[fd].n = clusters;
   }
 
-  return read_sector(CLUSTER_TO_SECTOR(cluster) + clus_offset);
+  return CLUSTER_TO_SECTOR(cluster) + clus_offset;
 }
+
 /*----------------------------------------------------------------------------*/
 /*FAT Interface Functions*/
+uint8_t
+cfs_fat_reserve(int fd, uint32_t bytes)
+{
+  struct file *file;
+  uint32_t cluster_size;
+  uint32_t needed, count, start, i, sector;
+
+  if (select_file_volume(fd) != 0) {
+    return 1;
+  }
+  cluster_size = (uint32_t) mounted->info.BPB_BytesPerSec * mounted->info.BPB_SecPerClus;
+
+  if (!(fat_fd_pool[fd].flags & (CFS_WRITE | CFS_APPEND))) {
+    return 1;
+  }
+
+  file = fat_fd_pool[fd].file;
+  needed = (file->dir_entry.DIR_FileSize + bytes + cluster_size - 1) / cluster_size;
+
+  if (file->cluster != 0 && file->last_cluster == 0) {
+    find_file_cluster(file, 0xFFFFFFFF);
+  }
+
+  if (file->cluster == 0) {
+    count = needed;
+  } else if (needed > file->num_clusters) {
+    count = needed - file->num_clusters;
+  } else {
+    return 0;
+  }
+
+  /* Prefer the clusters directly following the chain */
+  start = get_free_cluster_run(file->cluster ? file->last_cluster + 1 : 0, count);
+  if (start == 0) {
+    return 2;
+  }
+
+  PRINTF("\nfat.c: cfs_fat_reserve( fd = %d, bytes = %lu ): clusters %lu - %lu", fd, bytes, start, start + count - 1);
+
+  for (i = start; i < start + count - 1; i++) {
+    write_fat_entry(i, i + 1);
+  }
+  write_fat_entry(start + count - 1, EOC);
+
+  if (file->cluster == 0) {
+    file->cluster = start;
+    file->dir_entry.DIR_FstClusHI = (uint16_t) (start >> 16);
+    file->dir_entry.DIR_FstClusLO = (uint16_t) (start);
+    file->nth_cluster = start;
+    file->n = 0;
+    reset_cluster_runs(file);
+    file->dir_entry_dirty = 1;
+  } else {
+    write_fat_entry(file->last_cluster, start);
+  }
+
+  for (i = start; i < start + count; i++) {
+    if (file->run_clusters == file->num_clusters) {
+      add_cluster_to_runs(file, i);
+    }
+    file->num_clusters++;
+  }
+  file->last_cluster = start + count - 1;
+  file->reserved = 1;
+
+  /* Erase the reserved clusters up front, so the card does not have to
+   * erase while the data is written. This is an optimization only, so
+   * devices without erase support are fine. */
+  sector = CLUSTER_TO_SECTOR(start);
+  drop_cached_sectors(sector, count * mounted->info.BPB_SecPerClus);
+  diskio_erase_blocks(mounted->dev, sector, count * mounted->info.BPB_SecPerClus);
+
+  mounted->next_free = (file->last_cluster < mounted->max_cluster) ? file->last_cluster + 1 : 2;
+  if (mounted->free_count != FSI_UNKNOWN) {
+    mounted->free_count = (mounted->free_count > count) ? mounted->free_count - count : 0;
+  }
+  mounted->fsinfo_dirty = 1;
+
+  return 0;
+}
+/*----------------------------------------------------------------------------*/
 uint32_t
 cfs_fat_file_size(int fd)
 {
@@ -1394,6 +2962,118 @@ cfs_fat_file_size(int fd)
   return fat_file_pool[fd].dir_entry.DIR_FileSize;
 }
 /*----------------------------------------------------------------------------*/
+/**
+ * Writes back everything that was changed on the current volume.
+ */
+static void
+sync_volume()
+{
+  uint8_t i;
+
+  if (mounted->dev == 0) {
+    return;
+  }
+
+  for (i = 0; i < FAT_FD_POOL_SIZE; i++) {
+    if (fat_fd_pool[i].file != NULL && fat_file_pool[i].dir_entry_dirty
+            && &volumes[fat_file_pool[i].volume] == mounted) {
+      update_dir_entry(i);
+    }
+  }
+
+  write_fsinfo();
+  flush_sector_cache();
+
+#if FAT_SYNC
+  sync_dirty_fats();
+#endif
+
+  diskio_sync(mounted->dev);
+}
+/*----------------------------------------------------------------------------*/
+void
+cfs_fat_sync()
+{
+  uint8_t i;
+
+  for (i = 0; i < FAT_MAX_VOLUMES; i++) {
+    if (volumes[i].dev != 0) {
+      mounted = &volumes[i];
+      sync_volume();
+    }
+  }
+}
+/*----------------------------------------------------------------------------*/
+#if FAT_SYNC
+/**
+ * Copies the sectors of the first FAT that changed since the last call to
+ * the other FATs.
+ */
+static void
+sync_dirty_fats()
+{
+  uint8_t fat_number;
+  uint32_t fat_block;
+
+  for (fat_block = mounted->fat_dirty_first; fat_block <= mounted->fat_dirty_last; fat_block++) {
+    if (read_sector(fat_block) != 0) {
+      continue;
+    }
+    for (fat_number = 2; fat_number <= mounted->info.BPB_NumFATs; fat_number++) {
+      diskio_write_block(mounted->dev, fat_block + ((fat_number - 1) * mounted->info.BPB_FATSz), mounted->cur_sector->buffer);
+    }
+  }
+
+  mounted->fat_dirty_first = 1;
+  mounted->fat_dirty_last = 0;
+}
+#endif /* FAT_SYNC */
+/*----------------------------------------------------------------------------*/
+#if FAT_SYNC_INTERVAL && !defined(FAT_COOPERATIVE)
+/* Bounds the time changed data stays in RAM only, started on mount */
+PROCESS_THREAD(cfs_fat_sync_process, ev, data)
+{
+  static struct etimer sync_timer;
+
+  PROCESS_BEGIN();
+
+  etimer_set(&sync_timer, FAT_SYNC_INTERVAL * CLOCK_SECOND);
+
+  while (1) {
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&sync_timer));
+    cfs_fat_sync();
+    etimer_reset(&sync_timer);
+  }
+
+  PROCESS_END();
+}
+#endif /* FAT_SYNC_INTERVAL && !FAT_COOPERATIVE */
+/*----------------------------------------------------------------------------*/
+#if FAT_DISCARD
+/* Erases the queued runs of freed clusters step by step, started on mount */
+PROCESS_THREAD(cfs_fat_discard_process, ev, data)
+{
+  static uint8_t i;
+
+  PROCESS_BEGIN();
+
+  while (1) {
+    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
+
+    for (i = 0; i < FAT_MAX_VOLUMES; i++) {
+      while (volumes[i].dev != 0 && volumes[i].num_discard > 0) {
+        mounted = &volumes[i];
+        discard_step();
+        /* Let other processes run between the steps */
+        PROCESS_PAUSE();
+      }
+    }
+  }
+
+  PROCESS_END();
+}
+#endif /* FAT_DISCARD */
+/*----------------------------------------------------------------------------*/
 /**
  * Syncs every FAT with the first.
  */
@@ -1402,14 +3082,28 @@ cfs_fat_sync_fats()
 {
   uint8_t fat_number;
   uint32_t fat_block;
+  uint8_t i;
 
-  cfs_fat_flush();
+  for (i = 0; i < FAT_MAX_VOLUMES; i++) {
+    if (volumes[i].dev == 0) {
+      continue;
+    }
+    mounted = &volumes[i];
+    flush_sector_cache();
 
-  for (fat_block = 0; fat_block < mounted.info.BPB_FATSz; fat_block++) {
-    diskio_read_block(mounted.dev, fat_block + mounted.info.BPB_RsvdSecCnt, sector_buffer);
-    for (fat_number = 2; fat_number <= mounted.info.BPB_NumFATs; fat_number++) {
-      diskio_write_block(mounted.dev, (fat_block + mounted.info.BPB_RsvdSecCnt) + ((fat_number - 1) * mounted.info.BPB_FATSz), sector_buffer);
+    for (fat_block = 0; fat_block < mounted->info.BPB_FATSz; fat_block++) {
+      if (read_sector(fat_block + mounted->info.BPB_RsvdSecCnt) != 0) {
+        continue;
+      }
+      for (fat_number = 2; fat_number <= mounted->info.BPB_NumFATs; fat_number++) {
+        diskio_write_block(mounted->dev, (fat_block + mounted->info.BPB_RsvdSecCnt) + ((fat_number - 1) * mounted->info.BPB_FATSz), mounted->cur_sector->buffer);
+      }
     }
+
+#if FAT_SYNC
+    mounted->fat_dirty_first = 1;
+    mounted->fat_dirty_last = 0;
+#endif
   }
 }
 /*----------------------------------------------------------------------------*/
@@ -1425,11 +3119,13 @@ make_readable_entry(struct dir_entry *dir, struct cfs_dirent *dirent)
       j++;
     }
 
-    if (i == 7) {
+    // Only add the dot if there is an extension
+    if (i == 7 && dir->DIR_Name[8] != ' ') {
       dirent->name[j] = '.';
       j++;
     }
   }
+  dirent->name[j] = '\0';
 }
 /*----------------------------------------------------------------------------*/
 /**
@@ -63,6 +63,7 @@
 
 #include "diskio.h"
 #include "cfs/cfs.h"
+#include "sys/process.h"
 
 
 #ifdef FAT_CONF_COOPERATIVE
@@ -80,7 +81,40 @@
 #define FAT_SYNC 0
 #endif
 
+/** Interval [s] in which changed directory entries, the FSInfo and the
+ * sector cache are written back (see cfs_fat_sync()). This bounds the data
+ * lost on a power failure. 0 disables the periodic sync, data is then
+ * written back on cfs_close(), cfs_fat_sync() and umount only.
+ * Not available in cooperative mode.
+ */
+#ifndef FAT_SYNC_INTERVAL
+#define FAT_SYNC_INTERVAL 0
+#endif
+
+/** Cluster size [bytes] cfs_fat_mkfs() uses if it is larger than the one
+ * suggested by the FAT specification, 0 always uses the suggested one.
+ * Large clusters mean fewer FAT updates for big, sequentially written files
+ * like logs, but more slack for small ones. The size is ignored if the
+ * volume would end up with too few clusters for its FAT type.
+ */
+#ifndef FAT_MKFS_CLUSTER_SIZE
+#define FAT_MKFS_CLUSTER_SIZE 0
+#endif
+
+/** Number of freed cluster runs queued for erasing, 0 disables discarding.
+ * Clusters freed by cfs_remove() or by truncation are erased on the medium
+ * by a background process, so later writes to them do not have to wait for
+ * the device to erase. Runs that do not fit into the queue are not erased.
+ * Not available in cooperative mode.
+ */
+#ifndef FAT_DISCARD_RUNS
+#define FAT_DISCARD_RUNS 0
+#endif
+
+/** Number of operations the cooperative file system process can queue */
+#ifndef FAT_COOP_QUEUE_SIZE
 #define FAT_COOP_QUEUE_SIZE 15
+#endif
 
 #define FAT12 0
 #define FAT16 1
@@ -94,6 +128,64 @@
 #define FAT_FD_POOL_SIZE 5
 #endif
 
+/** Number of sectors kept in the sector cache (each costs 512 bytes of RAM).
+ * With at least 2 entries the current FAT sector and the current data sector
+ * are pinned separately and do not evict each other anymore.
+ */
+#ifndef FAT_SECTOR_CACHE_SIZE
+#define FAT_SECTOR_CACHE_SIZE 2
+#endif
+
+/** Number of sectors read ahead at once for files that are read
+ * sequentially (each costs 512 bytes of RAM per volume), 0 disables it.
+ * Once a file descriptor read twice in a row where the previous read
+ * ended, the rest of the current cluster (up to this number of sectors)
+ * is fetched with one multi block read and the FAT entry of the next
+ * cluster is resolved. Not available with FAT_COOPERATIVE.
+ */
+#ifndef FAT_READ_AHEAD
+#define FAT_READ_AHEAD 0
+#endif
+
+/** Number of volumes that can be mounted at the same time. Each volume has
+ * its own sector cache, so every additional volume costs
+ * FAT_SECTOR_CACHE_SIZE * 512 bytes of RAM.
+ */
+#ifndef FAT_MAX_VOLUMES
+#define FAT_MAX_VOLUMES 1
+#endif
+
+/** Number of resolved path parts remembered by the directory cache
+ * (each costs about 42 bytes of RAM), 0 disables the cache.
+ * Opening a cached file again does not require to scan its directory.
+ */
+#ifndef FAT_DIR_CACHE_SIZE
+#define FAT_DIR_CACHE_SIZE 4
+#endif
+
+/** Enables reading VFAT long file names. Files can be opened by their long
+ * name and cfs_readdir() returns it (truncated to the size of the dirent
+ * name). New files are still created with 8.3 names only.
+ */
+#ifndef FAT_LFN
+#define FAT_LFN 1
+#endif
+
+/** Number of contiguous cluster runs remembered per open file.
+ * Seeking and appending inside the remembered part of the cluster chain
+ * does not require to walk the FAT.
+ */
+#ifndef FAT_CLUSTER_RUNS
+#define FAT_CLUSTER_RUNS 4
+#endif
+
+/** Number of 512 byte staging buffers of a stream, see cfs_fat_stream_open().
+ * Must be a power of two.
+ */
+#ifndef FAT_STREAM_BUFFERS
+#define FAT_STREAM_BUFFERS 2
+#endif
+
 /** Holds boot sector information. */
 struct FAT_Info {
   uint8_t type; /** Either FAT16, FAT32 or FAT_INVALID */
@@ -129,6 +221,14 @@ struct dir_entry {
   uint32_t DIR_FileSize;
 };
 
+/** Contiguous part of a cluster chain */
+struct cluster_run {
+  /** First cluster of the run */
+  uint32_t start;
+  /** Number of clusters in the run */
+  uint16_t length;
+};
+
 struct file {
   //metadata
   /** Cluster Position on disk */
@@ -138,6 +238,20 @@ struct file {
   struct dir_entry dir_entry;
   uint32_t nth_cluster;
   uint32_t n;
+  /** Runs describing the first run_clusters clusters of the chain */
+  struct cluster_run runs[FAT_CLUSTER_RUNS];
+  uint8_t num_runs;
+  uint32_t run_clusters;
+  /** Last cluster of the chain, 0 if not known yet */
+  uint32_t last_cluster;
+  /** Number of clusters in the chain, only valid if last_cluster is known */
+  uint32_t num_clusters;
+  /** Set if clusters were reserved, the unused ones are freed on close */
+  uint8_t reserved;
+  /** Set if dir_entry changed and was not written back yet */
+  uint8_t dir_entry_dirty;
+  /** Index of the volume the file lies on */
+  uint8_t volume;
 };
 
 struct file_desc {
@@ -145,6 +259,12 @@ struct file_desc {
   uint32_t offset;
   struct file *file;
   uint8_t flags;
+#if FAT_READ_AHEAD > 0
+  /** Offset the previous read ended at */
+  uint32_t read_end;
+  /** Number of reads in a row that continued the previous one */
+  uint8_t seq_reads;
+#endif
 };
 
 //int cfs_fat_rmdir(char *);
@@ -159,22 +279,46 @@ struct file_desc {
 int cfs_fat_mkfs(struct diskio_device_info *dev);
 
 /**
- * Tries to mount the defined device.
+ * Tries to mount the defined device as the default volume, i.e. with
+ * an empty path prefix.
  *
  * \param dev The device on which a FAT-FS should be mounted.
  * \return 0 on success, 1 if the bootsector was not found or corrupted,
- * 2 if the FAT-Type wasn't supported.
+ * 2 if the FAT-Type wasn't supported, 3 if all volumes are in use.
  */
 uint8_t cfs_fat_mount_device(struct diskio_device_info *dev);
 
 /**
- * Umounts the mounted device. Invalidates all file descriptors.
+ * Tries to mount the defined device at the given path prefix, e.g. "/sd".
+ * Paths starting with the prefix are looked up on this volume, the volume
+ * with the longest matching prefix wins. A volume already mounted at the
+ * same prefix is umounted first.
+ *
+ * \param dev The device on which a FAT-FS should be mounted.
+ * \param prefix Path prefix without trailing '/', "" for the default volume.
+ * The string is not copied and has to stay valid until umount.
+ * \return 0 on success, 1 if the bootsector was not found or corrupted,
+ * 2 if the FAT-Type wasn't supported, 3 if all volumes are in use.
+ */
+uint8_t cfs_fat_mount_volume(struct diskio_device_info *dev, const char *prefix);
+
+/**
+ * Umounts all mounted volumes. Invalidates all file descriptors.
  * (Syncs all FATs (only if FAT_SYNC is set)) and flushes cached data.
  */
 void cfs_fat_umount_device();
 
 /**
- * Populates the given FAT_Info with the mounted FAT_Info.
+ * Umounts the volume mounted at the given prefix and invalidates the file
+ * descriptors of the files on it.
+ *
+ * \param prefix Path prefix the volume was mounted at
+ */
+void cfs_fat_umount_volume(const char *prefix);
+
+/**
+ * Populates the given FAT_Info with the FAT_Info of the default volume,
+ * i.e. the volume "/" belongs to.
  *
  * \param *info The FAT_Info struct which should be populated.
  */
@@ -214,15 +358,115 @@ uint16_t cfs_fat_get_create_date(int fd);
 uint16_t cfs_fat_get_create_time(int fd);
 
 /**
- * Syncs every FAT with the first FAT. Can take much time.
+ * Syncs every FAT with the first FAT on all volumes. Can take much time.
  */
 void cfs_fat_sync_fats();
 
 /**
- * Writes the current buffered block back to the disk if it was changed.
+ * Writes all changed sectors of the sector caches of all volumes back to
+ * the disk.
  */
 void cfs_fat_flush();
 
+/**
+ * Writes back everything that was changed on all volumes: the directory
+ * entries of all open files, the FSInfo and the sector cache. If FAT_SYNC is
+ * set, the changed sectors of the first FAT are copied to the other FATs as
+ * well.
+ */
+void cfs_fat_sync();
+
+/**
+ * Reserves space for the next bytes bytes written to the file as one
+ * contiguous run of clusters. The cluster chain is written once, so
+ * following writes into the reserved space do not update the FAT.
+ * The file size stays unchanged. Reserved clusters that are still unused
+ * are freed when the file is closed.
+ *
+ * \param fd File descriptor of a file opened for writing
+ * \param bytes Number of bytes to reserve beyond the current file size
+ * \return 0 on success, 1 if fd is invalid or not writable,
+ * 2 if there is no contiguous free space large enough.
+ */
+uint8_t cfs_fat_reserve(int fd, uint32_t bytes);
+
+#ifndef FAT_COOPERATIVE
+/**
+ * Append-only stream into a file. Data is collected in sector sized staging
+ * buffers by cfs_fat_stream_append(), which may be called from an interrupt.
+ * Full buffers are written to the file by cfs_fat_stream_commit() from the
+ * process that opened the stream, while the next buffer is filled.
+ */
+struct cfs_fat_stream {
+  int fd;
+  /** Process polled when a buffer becomes full */
+  struct process *process;
+  uint8_t buffer[FAT_STREAM_BUFFERS][512];
+  /** Number of bytes stored in each full buffer */
+  uint16_t length[FAT_STREAM_BUFFERS];
+  /** Buffers filled so far, only changed by cfs_fat_stream_append() */
+  volatile uint8_t produced;
+  /** Buffers written so far, only changed by cfs_fat_stream_commit() */
+  volatile uint8_t consumed;
+  /** Bytes in the buffer being filled */
+  volatile uint16_t fill;
+  /** Size of the buffer being filled, less than 512 for the first one to
+   * align the following ones to the sectors of the file */
+  uint16_t limit;
+  /** Number of bytes dropped because all buffers were full */
+  volatile uint16_t dropped;
+};
+
+/**
+ * Opens a file for appending through a stream. The calling process is polled
+ * whenever a staging buffer is full and should call cfs_fat_stream_commit().
+ *
+ * \param stream The stream, must stay valid until it is closed
+ * \param name Name of the file, it is created if it does not exist
+ * \return 0 on success, -1 if the file could not be opened
+ */
+int cfs_fat_stream_open(struct cfs_fat_stream *stream, const char *name);
+
+/**
+ * Copies data into the staging buffers of the stream. Does not access the
+ * disk, so it is safe to be called from an interrupt. Data that does not
+ * fit into a free buffer is dropped and counted.
+ *
+ * \param stream The stream
+ * \param data Data to append
+ * \param len Number of bytes to append
+ * \return Number of bytes stored
+ */
+uint16_t cfs_fat_stream_append(struct cfs_fat_stream *stream, const void *data, uint16_t len);
+
+/**
+ * Returns the number of bytes cfs_fat_stream_append() can currently store
+ * without dropping any. Callers that must not split records check this first.
+ *
+ * \param stream The stream
+ * \return Free bytes in the staging buffers
+ */
+uint16_t cfs_fat_stream_space(struct cfs_fat_stream *stream);
+
+/**
+ * Writes all full staging buffers to the file. Consecutive full buffers
+ * are written with one multi block write.
+ *
+ * \param stream The stream
+ * \return Number of bytes written, -1 on error
+ */
+int cfs_fat_stream_commit(struct cfs_fat_stream *stream);
+
+/**
+ * Commits all full buffers, writes the partially filled one and closes
+ * the file.
+ *
+ * \param stream The stream
+ * \return 0 on success, -1 on error
+ */
+int cfs_fat_stream_close(struct cfs_fat_stream *stream);
+#endif /* FAT_COOPERATIVE */
+
 /**
  * Returns the file size of the associated file
  * 
@@ -46,6 +46,7 @@
 
 #include "diskio.h"
 #include "mbr.h"
+#include <stdio.h>
 #include <string.h>
 #include "diskio-arch.h"
 
@@ -68,6 +69,45 @@ static struct diskio_device_info *default_device = 0;
 static struct diskio_device_info devices[DISKIO_MAX_DEVICES];
 
 static int diskio_rw_op(struct diskio_device_info *dev, uint32_t block_start_address, uint32_t num_blocks, uint8_t *buffer, uint8_t op);
+static int diskio_do_rw_op(struct diskio_device_info *dev, uint32_t block_start_address, uint32_t num_blocks, uint8_t *buffer, uint8_t op);
+
+#if DISKIO_STATS
+#include <stdio.h>
+#include "sys/rtimer.h"
+
+/* Retries and waits of the current operation */
+static uint32_t rw_retries;
+static uint32_t rw_waits;
+#define STATS_RETRY() rw_retries++
+#define STATS_WAIT()  rw_waits++
+#else
+#define STATS_RETRY()
+#define STATS_WAIT()
+#endif /* DISKIO_STATS */
+
+#if DISKIO_SD_POWER_TIMEOUT && defined(SD_POWER_OFF)
+#include "sys/ctimer.h"
+
+#define SD_POWER_MANAGED 1
+
+static struct ctimer sd_power_timer;
+static clock_time_t sd_last_access;
+static uint8_t sd_powered = 0;
+/* Set while a multi block write is in progress */
+static uint8_t sd_multi_block = 0;
+
+static int sd_power_up(void);
+#else
+#define SD_POWER_MANAGED 0
+#endif /* DISKIO_SD_POWER_TIMEOUT */
+
+#if DISKIO_ASYNC
+#include "lib/list.h"
+
+process_event_t diskio_event;
+LIST(diskio_requests);
+PROCESS(diskio_process, "DiskIO");
+#endif /* DISKIO_ASYNC */
 /*----------------------------------------------------------------------------*/
 void
 diskio_print_device_info(struct diskio_device_info *dev)
@@ -135,10 +175,323 @@ diskio_write_blocks_done(struct diskio_device_info *dev)
   return diskio_rw_op(dev, 0, 0, NULL, DISKIO_OP_WRITE_BLOCKS_DONE);
 }
 /*----------------------------------------------------------------------------*/
+int
+diskio_erase_blocks(struct diskio_device_info *dev, uint32_t block_start_address, uint32_t num_blocks)
+{
+  if (num_blocks == 0) {
+    return DISKIO_SUCCESS;
+  }
+  return diskio_rw_op(dev, block_start_address, num_blocks, NULL, DISKIO_OP_ERASE_BLOCKS);
+}
+/*----------------------------------------------------------------------------*/
+int
+diskio_sync(struct diskio_device_info *dev)
+{
+  return diskio_rw_op(dev, 0, 0, NULL, DISKIO_OP_SYNC);
+}
+/*----------------------------------------------------------------------------*/
+uint32_t
+diskio_get_erase_unit(struct diskio_device_info *dev)
+{
+  uint32_t unit = 0;
+
+  if (dev == NULL) {
+    dev = default_device;
+  }
+
+  if (dev == NULL) {
+    return 1;
+  }
+
+  switch (dev->type & DISKIO_DEVICE_TYPE_MASK) {
+#if defined(SD_INIT) && defined(SD_GET_ERASE_UNIT)
+    case DISKIO_DEVICE_TYPE_SD_CARD:
+#if SD_POWER_MANAGED
+      if (sd_power_up() != DISKIO_SUCCESS) {
+        break;
+      }
+#endif /* SD_POWER_MANAGED */
+      unit = SD_GET_ERASE_UNIT();
+      break;
+#endif /* SD_INIT && SD_GET_ERASE_UNIT */
+    default:
+      break;
+  }
+
+  return (unit != 0) ? unit : 1;
+}
+/*----------------------------------------------------------------------------*/
+#if DISKIO_ASYNC
+/**
+ * Checks if the device is busy and can not accept a new command yet.
+ */
+static uint8_t
+diskio_device_busy(struct diskio_device_info *dev)
+{
+  if (dev == NULL) {
+    dev = default_device;
+  }
+
+  if (dev == NULL) {
+    return 0;
+  }
+
+#if defined(SD_INIT) && defined(SD_IS_BUSY)
+  if ((dev->type & DISKIO_DEVICE_TYPE_MASK) == DISKIO_DEVICE_TYPE_SD_CARD) {
+    return SD_IS_BUSY();
+  }
+#endif
+
+  return 0;
+}
+/*----------------------------------------------------------------------------*/
+int
+diskio_submit(struct diskio_request *req)
+{
+  static uint8_t initialized = 0;
+
+  if (req->op != DISKIO_OP_READ_BLOCK && req->op != DISKIO_OP_WRITE_BLOCK) {
+    return DISKIO_ERROR_OPERATION_NOT_SUPPORTED;
+  }
+
+  if (!initialized) {
+    diskio_event = process_alloc_event();
+    initialized = 1;
+  }
+
+  if (!process_is_running(&diskio_process)) {
+    process_start(&diskio_process, NULL);
+  }
+
+  req->done = 0;
+  req->status = DISKIO_ERROR_TRY_AGAIN;
+  req->process = PROCESS_CURRENT();
+  list_add(diskio_requests, req);
+  process_poll(&diskio_process);
+
+  return DISKIO_SUCCESS;
+}
+/*----------------------------------------------------------------------------*/
+/* Transfers one block of the first queued request per poll. */
+PROCESS_THREAD(diskio_process, ev, data)
+{
+  struct diskio_request *req;
+
+  PROCESS_BEGIN();
+
+  while (1) {
+    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
+
+    req = list_head(diskio_requests);
+    if (req == NULL) {
+      continue;
+    }
+
+    /* Come back later instead of spinning until the device is ready */
+    if (diskio_device_busy(req->dev)) {
+      process_poll(&diskio_process);
+      continue;
+    }
+
+    if (req->done < req->num_blocks) {
+      req->status = diskio_rw_op(req->dev, req->block_address + req->done, 1, req->buffer + req->done * 512, req->op);
+      req->done++;
+    } else {
+      req->status = DISKIO_SUCCESS;
+    }
+
+    if (req->status != DISKIO_SUCCESS || req->done >= req->num_blocks) {
+      PRINTF("\ndiskio_process: request %p done, status %d", req, req->status);
+      list_remove(diskio_requests, req);
+      process_post(req->process, diskio_event, req);
+    }
+
+    if (list_head(diskio_requests) != NULL) {
+      process_poll(&diskio_process);
+    }
+  }
+
+  PROCESS_END();
+}
+#endif /* DISKIO_ASYNC */
+/*----------------------------------------------------------------------------*/
+#if SD_POWER_MANAGED
+/**
+ * Powers the SD card off once it was not accessed for
+ * DISKIO_SD_POWER_TIMEOUT seconds and is not in the middle of a transfer.
+ */
+static void
+sd_power_check(void *ptr)
+{
+  clock_time_t idle = clock_time() - sd_last_access;
+
+  if (idle < DISKIO_SD_POWER_TIMEOUT * CLOCK_SECOND) {
+    ctimer_set(&sd_power_timer, DISKIO_SD_POWER_TIMEOUT * CLOCK_SECOND - idle, sd_power_check, NULL);
+    return;
+  }
+
+  if (sd_multi_block
+#ifdef SD_IS_BUSY
+      || SD_IS_BUSY()
+#endif
+      ) {
+    ctimer_set(&sd_power_timer, CLOCK_SECOND, sd_power_check, NULL);
+    return;
+  }
+
+  PRINTF("\nsd_power_check(): Powering SD card off");
+  SD_POWER_OFF();
+  sd_powered = 0;
+}
+/*----------------------------------------------------------------------------*/
+/**
+ * Marks the SD card as powered and starts the idle timer.
+ */
+static void
+sd_power_start(void)
+{
+  sd_powered = 1;
+  sd_last_access = clock_time();
+  ctimer_set(&sd_power_timer, DISKIO_SD_POWER_TIMEOUT * CLOCK_SECOND, sd_power_check, NULL);
+}
+/*----------------------------------------------------------------------------*/
+/**
+ * Makes sure the SD card is powered and initialized before it is accessed.
+ * Only the card is initialized again, the file system is not touched.
+ */
+static int
+sd_power_up(void)
+{
+  if (sd_powered) {
+    sd_last_access = clock_time();
+    return DISKIO_SUCCESS;
+  }
+
+  PRINTF("\nsd_power_up(): Resuming SD card");
+  SD_POWER_ON();
+  if (SD_RESUME() != 0) {
+    SD_POWER_OFF();
+    return DISKIO_ERROR_INTERNAL_ERROR;
+  }
+  sd_power_start();
+
+  return DISKIO_SUCCESS;
+}
+#endif /* SD_POWER_MANAGED */
+/*----------------------------------------------------------------------------*/
+/**
+ * Reads num_blocks sequential blocks by issuing one single block read
+ * per block. Used if the device has no (working) multi block read.
+ *
+ * \param block_start_address already includes the partition offset
+ */
+static int
+diskio_read_blocks_single(struct diskio_device_info *dev, uint32_t block_start_address, uint32_t num_blocks, uint8_t *buffer)
+{
+  uint32_t i;
+  int ret;
+
+  for (i = 0; i < num_blocks; i++) {
+    ret = diskio_do_rw_op(dev, block_start_address - dev->first_sector + i, 1, buffer + i * 512, DISKIO_OP_READ_BLOCK);
+    if (ret != DISKIO_SUCCESS) {
+      return ret;
+    }
+  }
+
+  return DISKIO_SUCCESS;
+}
+/*----------------------------------------------------------------------------*/
+#if DISKIO_STATS
+/**
+ * Adds the result of one operation to the statistics of the device.
+ */
+static void
+diskio_update_stats(struct diskio_device_info *dev, uint32_t num_blocks, uint8_t op, int ret, rtimer_clock_t ticks)
+{
+  struct diskio_stats *stats = &dev->stats;
+  uint8_t bucket;
+
+  stats->ops++;
+  stats->retries += rw_retries;
+  stats->waits += rw_waits;
+
+  if (ret != DISKIO_SUCCESS) {
+    stats->errors++;
+  } else if (op == DISKIO_OP_READ_BLOCK || op == DISKIO_OP_READ_BLOCKS) {
+    stats->blocks_read += num_blocks;
+  } else if (op == DISKIO_OP_WRITE_BLOCK || op == DISKIO_OP_WRITE_BLOCKS_NEXT) {
+    stats->blocks_written++;
+  } else if (op == DISKIO_OP_ERASE_BLOCKS) {
+    stats->blocks_erased += num_blocks;
+  }
+
+  for (bucket = 0; ticks != 0 && bucket < DISKIO_STATS_BUCKETS - 1; bucket++) {
+    ticks >>= 1;
+  }
+
+  if (stats->latency[bucket] != 0xFFFF) {
+    stats->latency[bucket]++;
+  }
+}
+/*----------------------------------------------------------------------------*/
+void
+diskio_print_stats(struct diskio_device_info *dev)
+{
+  uint8_t i;
+
+  printf("%lu %lu %lu %lu %lu %lu %lu", dev->stats.ops, dev->stats.blocks_read,
+          dev->stats.blocks_written, dev->stats.blocks_erased, dev->stats.retries,
+          dev->stats.waits, dev->stats.errors);
+  for (i = 0; i < DISKIO_STATS_BUCKETS; i++) {
+    printf(" %u", dev->stats.latency[i]);
+  }
+  printf("\n");
+}
+/*----------------------------------------------------------------------------*/
+void
+diskio_reset_stats(struct diskio_device_info *dev)
+{
+  memset(&dev->stats, 0, sizeof (struct diskio_stats));
+}
+#endif /* DISKIO_STATS */
+/*----------------------------------------------------------------------------*/
+/**
+ * Executes the operation and records it in the statistics of the device.
+ */
 static int
 diskio_rw_op(struct diskio_device_info *dev, uint32_t block_start_address, uint32_t num_blocks, uint8_t *buffer, uint8_t op)
+{
+#if DISKIO_STATS
+  rtimer_clock_t start;
+  int ret;
+
+  if (dev == NULL) {
+    dev = default_device;
+  }
+
+  if (dev == NULL) {
+    return DISKIO_ERROR_NO_DEVICE_SELECTED;
+  }
+
+  rw_retries = 0;
+  rw_waits = 0;
+  start = RTIMER_NOW();
+  ret = diskio_do_rw_op(dev, block_start_address, num_blocks, buffer, op);
+  diskio_update_stats(dev, num_blocks, op, ret, RTIMER_NOW() - start);
+
+  return ret;
+#else /* DISKIO_STATS */
+  return diskio_do_rw_op(dev, block_start_address, num_blocks, buffer, op);
+#endif /* DISKIO_STATS */
+}
+/*----------------------------------------------------------------------------*/
+static int
+diskio_do_rw_op(struct diskio_device_info *dev, uint32_t block_start_address, uint32_t num_blocks, uint8_t *buffer, uint8_t op)
 {
   static uint32_t multi_block_nr = 0;
+#ifdef SD_READ_BLOCKS_START
+  uint32_t i;
+#endif
 
   if (dev == NULL) {
     if (default_device == 0) {
@@ -156,6 +509,11 @@ diskio_rw_op(struct diskio_device_info *dev, uint32_t block_start_address, uint3
 
 #ifdef SD_INIT
     case DISKIO_DEVICE_TYPE_SD_CARD:
+#if SD_POWER_MANAGED
+      if (sd_power_up() != DISKIO_SUCCESS) {
+        return DISKIO_ERROR_INTERNAL_ERROR;
+      }
+#endif /* SD_POWER_MANAGED */
       switch (op) {
         case DISKIO_OP_READ_BLOCK:
 #ifndef DISKIO_OLD_STYLE
@@ -166,15 +524,18 @@ diskio_rw_op(struct diskio_device_info *dev, uint32_t block_start_address, uint3
             } else {
               //PRINTF("\nret_code: %u", ret_code);
             }
+            STATS_RETRY();
 
 #ifdef FAT_COOPERATIVE
             if (!coop_step_allowed) {
               next_step_type = READ;
+              STATS_WAIT();
               coop_switch_sp();
             } else {
               coop_step_allowed = 0;
             }
 #else /* FAT_COOPERATIVE */
+            STATS_WAIT();
             _delay_ms(DISKIO_RW_DELAY_MS);
 #endif /* FAT_COOPERATIVE */
 
@@ -197,7 +558,23 @@ diskio_rw_op(struct diskio_device_info *dev, uint32_t block_start_address, uint3
           break;
 
         case DISKIO_OP_READ_BLOCKS:
-          return DISKIO_ERROR_TO_BE_IMPLEMENTED;
+#ifdef SD_READ_BLOCKS_START
+          ret_code = SD_READ_BLOCKS_START(block_start_address, num_blocks);
+          if (ret_code == 0) {
+            for (i = 0; i < num_blocks; i++) {
+              ret_code = SD_READ_BLOCKS_NEXT(buffer + i * 512);
+              if (ret_code != 0) {
+                break;
+              }
+            }
+            ret_code |= SD_READ_BLOCKS_DONE();
+          }
+          if (ret_code == 0) {
+            return DISKIO_SUCCESS;
+          }
+          PRINTF("\ndiskio_rw_op(): Multi block read failed, reading single blocks");
+#endif /* SD_READ_BLOCKS_START */
+          return diskio_read_blocks_single(dev, block_start_address, num_blocks, buffer);
           break;
 
         case DISKIO_OP_WRITE_BLOCK:
@@ -207,15 +584,18 @@ diskio_rw_op(struct diskio_device_info *dev, uint32_t block_start_address, uint3
             if (ret_code == 0) {
               return DISKIO_SUCCESS;
             }
+            STATS_RETRY();
 
 #ifdef FAT_COOPERATIVE
             if (!coop_step_allowed) {
               next_step_type = WRITE;
+              STATS_WAIT();
               coop_switch_sp();
             } else {
               coop_step_allowed = 0;
             }
 #else /* FAT_COOPERATIVE */
+            STATS_WAIT();
             _delay_ms(DISKIO_RW_DELAY_MS);
 #endif /* FAT_COOPERATIVE */
             if ((reinit == 0) && (tries == DISKIO_RW_RETRIES - 1)) {
@@ -238,6 +618,9 @@ diskio_rw_op(struct diskio_device_info *dev, uint32_t block_start_address, uint3
         case DISKIO_OP_WRITE_BLOCKS_START:
           ret_code = SD_WRITE_BLOCKS_START(block_start_address, num_blocks);
           if (ret_code == 0) {
+#if SD_POWER_MANAGED
+            sd_multi_block = 1;
+#endif
             return DISKIO_SUCCESS;
           } else {
             return DISKIO_ERROR_INTERNAL_ERROR;
@@ -255,6 +638,9 @@ diskio_rw_op(struct diskio_device_info *dev, uint32_t block_start_address, uint3
 
         case DISKIO_OP_WRITE_BLOCKS_DONE:
           ret_code = SD_WRITE_BLOCKS_DONE();
+#if SD_POWER_MANAGED
+          sd_multi_block = 0;
+#endif
           if (ret_code == 0) {
             return DISKIO_SUCCESS;
           } else {
@@ -262,6 +648,22 @@ diskio_rw_op(struct diskio_device_info *dev, uint32_t block_start_address, uint3
           }
           break;
 
+#ifdef SD_ERASE_BLOCKS
+        case DISKIO_OP_ERASE_BLOCKS:
+          ret_code = SD_ERASE_BLOCKS(block_start_address, num_blocks);
+          if (ret_code == 0) {
+            return DISKIO_SUCCESS;
+          } else {
+            return DISKIO_ERROR_INTERNAL_ERROR;
+          }
+          break;
+#endif /* SD_ERASE_BLOCKS */
+
+        case DISKIO_OP_SYNC:
+          /* The card does not cache written blocks */
+          return DISKIO_SUCCESS;
+          break;
+
         default:
           return DISKIO_ERROR_OPERATION_NOT_SUPPORTED;
           break;
@@ -273,14 +675,14 @@ diskio_rw_op(struct diskio_device_info *dev, uint32_t block_start_address, uint3
     case DISKIO_DEVICE_TYPE_GENERIC_FLASH:
       switch (op) {
         case DISKIO_OP_READ_BLOCK:
-          FLASH_READ_BLOCK(block_start_address, 0, buffer, 512);
+          FLASH_READ_BLOCK(block_start_address, buffer);
           return DISKIO_SUCCESS;
           break;
         case DISKIO_OP_READ_BLOCKS:
-          return DISKIO_ERROR_TO_BE_IMPLEMENTED;
+          return diskio_read_blocks_single(dev, block_start_address, num_blocks, buffer);
           break;
         case DISKIO_OP_WRITE_BLOCK:
-          FLASH_WRITE_BLOCK(block_start_address, 0, buffer, 512);
+          FLASH_WRITE_BLOCK(block_start_address, buffer);
           return DISKIO_SUCCESS;
           break;
         // fake multi block write
@@ -292,13 +694,19 @@ diskio_rw_op(struct diskio_device_info *dev, uint32_t block_start_address, uint3
           return DISKIO_SUCCESS;
           break;
         case DISKIO_OP_WRITE_BLOCKS_NEXT:
-          FLASH_WRITE_BLOCK(multi_block_nr, 0, buffer, 512);
+          FLASH_WRITE_BLOCK(multi_block_nr, buffer);
           multi_block_nr++;
           return DISKIO_SUCCESS;
         case DISKIO_OP_WRITE_BLOCKS_DONE:
           multi_block_nr = 0;
           return DISKIO_SUCCESS;
           break;
+        case DISKIO_OP_SYNC:
+#ifdef FLASH_SYNC
+          FLASH_SYNC();
+#endif
+          return DISKIO_SUCCESS;
+          break;
         default:
           return DISKIO_ERROR_OPERATION_NOT_SUPPORTED;
           break;
@@ -330,7 +738,7 @@ diskio_detect_devices()
 {
   struct mbr mbr;
   int dev_num = 0;
-  int i = 0, index = 0;
+  int i = 0, index = 0, sd_index;
 
   memset(devices, 0, DISKIO_MAX_DEVICES * sizeof (struct diskio_device_info));
 
@@ -356,6 +764,12 @@ diskio_detect_devices()
 #endif /* FLASH_INIT */
   
 #ifdef SD_INIT
+#if SD_POWER_MANAGED
+  if (!sd_powered) {
+    SD_POWER_ON();
+  }
+  sd_power_start();
+#endif /* SD_POWER_MANAGED */
   if (SD_INIT() == 0) {
     devices[index].type = DISKIO_DEVICE_TYPE_SD_CARD;
     devices[index].number = dev_num;
@@ -368,22 +782,22 @@ diskio_detect_devices()
     
     mbr_init(&mbr);
     mbr_read(&devices[index], &mbr);
+    sd_index = index;
     index += 1;
-    // test for max 5 partitions
-    for (i = 0; i < 4; ++i) {
+    // test for max 4 partitions, as long as there are free device slots
+    for (i = 0; i < 4 && index < DISKIO_MAX_DEVICES; ++i) {
       if (mbr_hasPartition(&mbr, i + 1) != 0) {
         devices[index].type = DISKIO_DEVICE_TYPE_SD_CARD | DISKIO_DEVICE_TYPE_PARTITION;
         devices[index].number = dev_num;
         devices[index].partition = i + 1;
         devices[index].num_sectors = mbr.partition[i].lba_num_sectors;
-        devices[index].sector_size = devices[dev_num].sector_size;
+        devices[index].sector_size = devices[sd_index].sector_size;
         devices[index].first_sector = mbr.partition[i].lba_first_sector;
         index += 1;
       }
     }
 
     dev_num += 1;
-    index += 1;
   }
 #endif /* SD_INIT */
 
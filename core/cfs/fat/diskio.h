@@ -81,15 +81,73 @@
 #define DISKIO_MAX_DEVICES 5
 #endif
 
+/** Enables the asynchronous request queue (diskio_submit()) */
+#ifndef DISKIO_ASYNC
+#define DISKIO_ASYNC 0
+#endif
+
+/** Seconds without access after which the SD card is powered off, 0 keeps
+ * it powered. The next access powers it on and re-initializes it with
+ * SD_RESUME(), mounted file systems stay valid because their state is kept
+ * in RAM. Requires SD_POWER_ON(), SD_POWER_OFF() and SD_RESUME() from
+ * diskio-arch.h, the card must not be changed while switched off.
+ */
+#ifndef DISKIO_SD_POWER_TIMEOUT
+#define DISKIO_SD_POWER_TIMEOUT 0
+#endif
+
+/** Enables per-device I/O statistics (see struct diskio_stats) */
+#ifndef DISKIO_STATS
+#define DISKIO_STATS 0
+#endif
+
+/** Number of latency histogram buckets. Bucket 0 counts operations that
+ * took less than one rtimer tick, bucket n those that took
+ * [2^(n-1), 2^n) ticks, the last bucket everything above.
+ */
+#ifndef DISKIO_STATS_BUCKETS
+#define DISKIO_STATS_BUCKETS 12
+#endif
+
 #define DISKIO_OP_WRITE_BLOCK  1
 #define DISKIO_OP_READ_BLOCK   2
 #define DISKIO_OP_WRITE_BLOCKS_START 10
 #define DISKIO_OP_WRITE_BLOCKS_NEXT  11
 #define DISKIO_OP_WRITE_BLOCKS_DONE  12
 #define DISKIO_OP_READ_BLOCKS  4
+#define DISKIO_OP_ERASE_BLOCKS 13
+#define DISKIO_OP_SYNC         14
 
 
 #include <stdint.h>
+#if DISKIO_ASYNC
+#include "contiki.h"
+#endif
+
+#if DISKIO_STATS
+/**
+ * I/O statistics of a device, updated by every diskio operation on it.
+ */
+struct diskio_stats {
+  /** Number of diskio operations */
+  uint32_t ops;
+  /** Number of blocks read */
+  uint32_t blocks_read;
+  /** Number of blocks written */
+  uint32_t blocks_written;
+  /** Number of blocks erased */
+  uint32_t blocks_erased;
+  /** Number of failed accesses that were tried again */
+  uint32_t retries;
+  /** Number of DISKIO_RW_DELAY_MS waits (or yields in cooperative mode)
+   * between retries */
+  uint32_t waits;
+  /** Number of operations that returned an error */
+  uint32_t errors;
+  /** Latency histogram in rtimer ticks, saturates at 0xFFFF */
+  uint16_t latency[DISKIO_STATS_BUCKETS];
+};
+#endif /* DISKIO_STATS */
 
 /**
  * Stores the necessary information to identify a device using the diskio-Library.
@@ -109,6 +167,10 @@ struct diskio_device_info {
   /** If this is a Partition, this indicates which is the
    * first_sector belonging to this partition on this device */
   uint32_t first_sector;
+#if DISKIO_STATS
+  /** I/O statistics of this device */
+  struct diskio_stats stats;
+#endif
 };
 
 /**
@@ -127,6 +189,26 @@ struct diskio_device_info {
  */
 void diskio_print_device_info(struct diskio_device_info *dev);
 
+#if DISKIO_STATS
+/**
+ * Prints the I/O statistics of the specified device in one line.
+ *
+ * <b>Output Format:</b> \n
+ * ops blocks_read blocks_written blocks_erased retries waits errors
+ * latency[0] ... latency[DISKIO_STATS_BUCKETS - 1]
+ *
+ * \param *dev the pointer to the device info struct
+ */
+void diskio_print_stats(struct diskio_device_info *dev);
+
+/**
+ * Resets the I/O statistics of the specified device.
+ *
+ * \param *dev the pointer to the device info struct
+ */
+void diskio_reset_stats(struct diskio_device_info *dev);
+#endif /* DISKIO_STATS */
+
 /**
  * Reads one block from the specified device and stores it in buffer.
  *
@@ -165,7 +247,8 @@ int diskio_write_block(struct diskio_device_info *dev, uint32_t block_address, u
  *
  * \param *dev the pointer to the device info
  * \param block_start_address the address of the first block to be written
- * \param num_blocks number of blocks to be written
+ * \param num_blocks number of blocks to be written. This is a hint for the
+ * device to pre-erase the blocks, 0 if the number is not known in advance.
  * \return DISKIO_SUCCESS on success, !0 on error
  */
 int diskio_write_blocks_start(struct diskio_device_info *dev, uint32_t block_start_address, uint32_t num_blocks);
@@ -187,6 +270,87 @@ int diskio_write_blocks_next(struct diskio_device_info *dev, uint8_t *buffer);
  */
 int diskio_write_blocks_done(struct diskio_device_info *dev);
 
+/**
+ * Erases a range of blocks on the specified device, so later writes to them
+ * do not have to wait for the device to erase internally.
+ * Erased blocks read as all 0x00 or all 0xFF, depending on the device.
+ *
+ * This may or may not be supported for every device. DISKIO_ERROR_OPERATION_NOT_SUPPORTED will be
+ * returned in that case.
+ * \param *dev the pointer to the device info
+ * \param block_start_address the address of the first block to be erased
+ * \param num_blocks number of blocks to be erased
+ * \return DISKIO_SUCCESS on success, !0 on error
+ */
+int diskio_erase_blocks(struct diskio_device_info *dev, uint32_t block_start_address, uint32_t num_blocks);
+
+/**
+ * Writes back data that the device caches internally, e.g. partially
+ * written flash pages.
+ *
+ * \param *dev the pointer to the device info
+ * \return DISKIO_SUCCESS on success, !0 on error
+ */
+int diskio_sync(struct diskio_device_info *dev);
+
+/**
+ * Returns the size of the units the device erases and manages its memory in,
+ * e.g. the allocation unit of SD cards. Placing partitions and file system
+ * structures on multiples of it avoids accesses that straddle two units.
+ *
+ * \param *dev the pointer to the device info
+ * \return size of the erase unit in blocks, 1 if it is not known
+ */
+uint32_t diskio_get_erase_unit(struct diskio_device_info *dev);
+
+#if DISKIO_ASYNC
+/**
+ * Asynchronous read or write request, see diskio_submit().
+ * The request must not be changed or reused until it is completed.
+ */
+struct diskio_request {
+  /** Used internally to queue requests */
+  struct diskio_request *next;
+  /** Device to access, NULL for the default device */
+  struct diskio_device_info *dev;
+  /** Address of the first block */
+  uint32_t block_address;
+  /** Number of consecutive blocks to read or write */
+  uint32_t num_blocks;
+  /** Buffer holding num_blocks blocks */
+  uint8_t *buffer;
+  /** DISKIO_OP_READ_BLOCK or DISKIO_OP_WRITE_BLOCK */
+  uint8_t op;
+  /** Number of blocks transferred so far */
+  uint32_t done;
+  /** Result of the request, valid once it is completed */
+  int status;
+  /** Process that is notified on completion */
+  struct process *process;
+};
+
+/**
+ * Event posted to the submitting process when a request is completed,
+ * the data pointer points to the request.
+ */
+extern process_event_t diskio_event;
+
+/**
+ * Queues a request to be executed in the background.
+ *
+ * The blocks are transferred one at a time by the diskio process, so other
+ * processes keep running in between. While a device is busy (e.g. the
+ * SD card is programming) it is polled instead of waited for.
+ * On completion diskio_event is posted to the calling process.
+ * Synchronous calls to the same device must not be mixed with pending
+ * requests.
+ *
+ * \param *req the request, must stay valid until it is completed
+ * \return DISKIO_SUCCESS if the request was queued, !0 on error
+ */
+int diskio_submit(struct diskio_request *req);
+#endif /* DISKIO_ASYNC */
+
 /**
  * Returns the device-Database.
  *
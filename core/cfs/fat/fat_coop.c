@@ -58,10 +58,12 @@
 #endif
 
 #define MS_TO_TICKS(ms) ((uint32_t)(ms * (RTIMER_SECOND / 1000.0f)))
+#define TICKS_TO_MS(ticks) ((uint16_t)(((uint32_t)(ticks) * 1000) / RTIMER_SECOND))
 
 #define FAT_COOP_SLOT_SIZE_TICKS MS_TO_TICKS(FAT_COOP_SLOT_SIZE_MS)
-#define FAT_COOP_TIME_READ_BLOCK_TICKS MS_TO_TICKS(FAT_COOP_TIME_READ_BLOCK_MS)
-#define FAT_COOP_TIME_WRITE_BLOCK_TICKS MS_TO_TICKS(FAT_COOP_TIME_WRITE_BLOCK_MS)
+
+/* Safety margin added to every step estimate */
+#define FAT_COOP_STEP_MARGIN_TICKS 5
 
 enum {
   READ = 1,
@@ -72,8 +74,15 @@ enum {
 static process_event_t coop_global_event_id = 0;
 static uint8_t next_token = 0;
 
+/* The write buffer holds the data of queued writes, every write gets a
+ * contiguous part, so it can be passed to cfs_write() directly.
+ * Data lies in [start, end), or in [start, wrap) and [0, end) if wrap != 0. */
 uint8_t writeBuffer[FAT_COOP_BUFFER_SIZE];
-uint16_t writeBuffer_start, writeBuffer_len;
+uint16_t writeBuffer_start, writeBuffer_end, writeBuffer_wrap, writeBuffer_len;
+
+/* Measured duration [ticks] of a step starting with a block read or write */
+static uint16_t step_ticks_read = MS_TO_TICKS(FAT_COOP_TIME_READ_BLOCK_MS);
+static uint16_t step_ticks_write = MS_TO_TICKS(FAT_COOP_TIME_WRITE_BLOCK_MS);
 
 QueueEntry queue[FAT_COOP_QUEUE_SIZE];
 Event_OperationFinished op_results[FAT_COOP_QUEUE_SIZE];
@@ -83,9 +92,6 @@ uint8_t coop_step_allowed = 0;
 
 uint8_t next_step_type = INTERNAL;
 
-/** From fat.c */
-extern struct file_system mounted;
-
 /** From fat.c */
 extern struct file fat_file_pool[FAT_FD_POOL_SIZE];
 
@@ -101,9 +107,12 @@ uint8_t time_left_for_step(uint8_t step_type);
 uint8_t try_internal_operation();
 uint8_t queue_rm_top_entry();
 uint8_t queue_add_entry(QueueEntry *entry);
-void pop_from_buffer(uint16_t length);
+void queue_select_next();
+uint8_t *push_on_buffer(uint8_t *source, uint16_t length);
+void pop_from_buffer(uint8_t *start, uint16_t length);
 uint32_t time_left();
-uint8_t time_for_step(uint8_t step_type);
+uint16_t time_for_step(uint8_t step_type);
+static void update_step_time(uint8_t step_type, uint16_t ticks);
 
 PROCESS(fsp, "FileSystemProcess");
 /*----------------------------------------------------------------------------*/
@@ -201,10 +210,9 @@ operation(void *data)
       break;
     case COOP_CFS_WRITE:
       PRINTF("FSP: write to file\n");
-      /** FIXME: Ring Buffer functionality does not work, because cfs_write does not know, that the buffer may wrap around */
       entry->ret_value = cfs_write(entry->parameters.generic.fd, entry->parameters.generic.buffer,
               entry->parameters.generic.length);
-      pop_from_buffer(entry->parameters.generic.length);
+      pop_from_buffer(entry->parameters.generic.buffer, entry->parameters.generic.length);
       break;
     case COOP_CFS_READ:
       PRINTF("FSP: read from file\n");
@@ -238,9 +246,12 @@ operation(void *data)
 /*----------------------------------------------------------------------------*/
 PROCESS_THREAD(fsp, ev, data)
 {
-	static uint32_t deadline = 0;
+	static rtimer_clock_t deadline = 0;
+	static rtimer_clock_t step_start;
 	static QueueEntry *entry;
 	static uint16_t operations = 0;
+	static uint8_t steps;
+	static uint8_t step_type;
 
 	PROCESS_BEGIN();
 
@@ -249,14 +260,30 @@ PROCESS_THREAD(fsp, ev, data)
 
 		// How long is time for processing?
 		deadline = RTIMER_NOW() + time_left();
+		steps = 0;
 
 		entry = queue_current_entry();
 
-		while (entry != NULL && deadline > RTIMER_NOW()) {
-			uint32_t my_end = RTIMER_NOW() + time_for_step(next_step_type);
+		while (entry != NULL) {
+			if (entry->state == STATUS_QUEUED) {
+				// Not started yet, so a more urgent operation may go first
+				queue_select_next();
+				entry = queue_current_entry();
+			}
+
+			/* Only start a step that ends before the deadline. A step longer
+			 * than a whole slot may only run alone in an unrestricted slot. */
+			step_type = next_step_type;
+			if (RTIMER_CLOCK_LT(deadline, RTIMER_NOW() + time_for_step(step_type))
+					&& (steps > 0 || time_left() < FAT_COOP_SLOT_SIZE_TICKS)) {
+				break;
+			}
 
 			watchdog_periodic();
+			step_start = RTIMER_NOW();
 			perform_next_step(entry);
+			update_step_time(step_type, RTIMER_NOW() - step_start);
+			steps++;
 
 			if (entry->state == STATUS_DONE) {
 				PRINTF("FSP: Operation finished\n");
@@ -265,6 +292,11 @@ PROCESS_THREAD(fsp, ev, data)
 				operations ++;
 			}
 		}
+
+		// Continue in the next slot, after the other processes had their turn
+		if (entry != NULL) {
+			process_poll(&fsp);
+		}
 	}
 
 	PROCESS_END();
@@ -293,8 +325,10 @@ finish_operation(QueueEntry *entry)
 
   // Remove entry
   queue_rm_top_entry();
+  next_step_type = INTERNAL;
 
   /* Init the internal Stack for the next Operation */
+  queue_select_next();
   entry = queue_current_entry();
 
   if (entry != NULL) {
@@ -313,10 +347,16 @@ uint32_t time_left()
 
 	  // If we do have a timer, maximum time may also be shorter
 	  if( etimer_next_expiration_time() != 0 ) {
-		  uint32_t time_left_etimer = (((uint32_t) (etimer_next_expiration_time() - clock_time())) * ((uint32_t) RTIMER_ARCH_SECOND)) / CLOCK_SECOND;
+		  clock_time_t until = etimer_next_expiration_time() - clock_time();
+		  uint32_t time_left_etimer = 0;
+
+		  // An expired timer wraps around to a large value
+		  if( until < ((clock_time_t) ~0) / 2 ) {
+			  time_left_etimer = (((uint32_t) until) * ((uint32_t) RTIMER_ARCH_SECOND)) / CLOCK_SECOND;
+		  }
 
 		  // Safety margin
-		  time_left_etimer -= 5;
+		  time_left_etimer = (time_left_etimer > 5) ? time_left_etimer - 5 : 0;
 
 		  if( time_left_etimer < time_left ) {
 			  time_left = time_left_etimer;
@@ -326,29 +366,52 @@ uint32_t time_left()
 	  return time_left;
 }
 /*----------------------------------------------------------------------------*/
-uint8_t
+uint16_t
 time_for_step(uint8_t step_type)
 {
-	uint8_t result = 0;
+	uint16_t result = 0;
 
 	if (step_type == INTERNAL ) {
 		result = 0;
 	}
 
 	if (step_type == READ ) {
-		result = FAT_COOP_TIME_READ_BLOCK_TICKS;
+		result = step_ticks_read;
 	}
 
 	if (step_type == WRITE ) {
-		result = FAT_COOP_TIME_WRITE_BLOCK_TICKS;
+		result = step_ticks_write;
 	}
 
-	// Add a 5 tick safety margin
-	result += 5;
+	result += FAT_COOP_STEP_MARGIN_TICKS;
 
 	return result;
 }
 /*----------------------------------------------------------------------------*/
+/**
+ * Updates the estimate of a step with its measured duration. The estimate
+ * follows longer steps fast and shorter ones slowly, to stay conservative.
+ */
+static void
+update_step_time(uint8_t step_type, uint16_t ticks)
+{
+	uint16_t *estimate;
+
+	if (step_type == READ) {
+		estimate = &step_ticks_read;
+	} else if (step_type == WRITE) {
+		estimate = &step_ticks_write;
+	} else {
+		return;
+	}
+
+	if (ticks > *estimate) {
+		*estimate += (ticks - *estimate + 1) / 2;
+	} else {
+		*estimate -= (*estimate - ticks) / 8;
+	}
+}
+/*----------------------------------------------------------------------------*/
 uint8_t
 time_left_for_step(uint8_t step_type)
 {
@@ -378,11 +441,94 @@ queue_add_entry(QueueEntry *entry)
   }
 
   memcpy(&(queue[pos]), entry, sizeof (QueueEntry));
+  queue[pos].overtaken = 0;
   queue_len++;
 
   return 0;
 }
 /*----------------------------------------------------------------------------*/
+/**
+ * Returns the file descriptor an entry operates on, -1 if there is none.
+ */
+static int
+queue_entry_fd(QueueEntry *entry)
+{
+  switch (entry->op) {
+    case COOP_CFS_CLOSE:
+    case COOP_CFS_WRITE:
+    case COOP_CFS_READ:
+      return entry->parameters.generic.fd;
+    case COOP_CFS_SEEK:
+      return entry->parameters.seek.fd;
+    default:
+      return -1;
+  }
+}
+/*----------------------------------------------------------------------------*/
+/**
+ * Checks if an entry is small and may overtake queued writes.
+ */
+static uint8_t
+queue_entry_urgent(QueueEntry *entry)
+{
+  switch (entry->op) {
+    case COOP_CFS_READ:
+      return entry->parameters.generic.length <= FAT_COOP_SMALL_READ;
+    case COOP_CFS_SEEK:
+    case COOP_CFS_OPENDIR:
+    case COOP_CFS_READDIR:
+    case COOP_CFS_CLOSEDIR:
+      return 1;
+    default:
+      return 0;
+  }
+}
+/*----------------------------------------------------------------------------*/
+/**
+ * Moves the first urgent entry to the top of the queue, if only writes to
+ * other files are queued before it. Must only be called if the top entry
+ * was not started yet.
+ */
+void
+queue_select_next()
+{
+  uint16_t i, j;
+  QueueEntry *entry;
+  QueueEntry selected;
+  int fd;
+
+  for (i = 0; i < queue_len; i++) {
+    entry = &(queue[(queue_start + i) % FAT_COOP_QUEUE_SIZE]);
+    if (entry->op != COOP_CFS_WRITE) {
+      break;
+    }
+  }
+
+  if (i == 0 || i == queue_len || !queue_entry_urgent(entry)) {
+    return;
+  }
+
+  /* Keep the order of operations on the same file and do not starve writes */
+  fd = queue_entry_fd(entry);
+  for (j = 0; j < i; j++) {
+    QueueEntry *write = &(queue[(queue_start + j) % FAT_COOP_QUEUE_SIZE]);
+    if ((fd != -1 && write->parameters.generic.fd == fd)
+            || write->overtaken >= FAT_COOP_MAX_OVERTAKE) {
+      return;
+    }
+  }
+
+  PRINTF("FSP: token %u overtakes %u writes\n", entry->token, i);
+
+  memcpy(&selected, entry, sizeof (QueueEntry));
+  for (j = i; j > 0; j--) {
+    memcpy(&(queue[(queue_start + j) % FAT_COOP_QUEUE_SIZE]),
+            &(queue[(queue_start + j - 1) % FAT_COOP_QUEUE_SIZE]), sizeof (QueueEntry));
+    queue[(queue_start + j) % FAT_COOP_QUEUE_SIZE].overtaken++;
+  }
+  memcpy(&(queue[queue_start]), &selected, sizeof (QueueEntry));
+}
+/*----------------------------------------------------------------------------*/
 uint8_t
 queue_rm_top_entry()
 {
@@ -397,67 +543,88 @@ queue_rm_top_entry()
 }
 /*----------------------------------------------------------------------------*/
 /**
- * This function is used to buffer the payload of write requests in a ring buffer
- * However, the ring functionality does not work
+ * Finds a contiguous free part of the write buffer.
+ *
+ * \return The offset of the free part, -1 if there is not enough space
  */
-uint8_t
-push_on_buffer(uint8_t *source, uint16_t length)
+static int16_t
+buffer_find_space(uint16_t length)
 {
-  uint16_t pos = (writeBuffer_start + writeBuffer_len) % FAT_COOP_BUFFER_SIZE;
-  uint16_t free = 0;
+  if (length == 0 || length > FAT_COOP_BUFFER_SIZE) {
+    return -1;
+  }
 
-  // Test if writeBuffer is full
-  if (pos == writeBuffer_start - 1) {
-    return 1;
+  if (writeBuffer_len == 0) {
+    return 0;
   }
 
-  // Calculate free space in Buffer
-  if (pos < writeBuffer_start) {
-    free = writeBuffer_start - pos;
-  } else {
-    free = (FAT_COOP_BUFFER_SIZE - pos) + writeBuffer_start;
+  if (writeBuffer_wrap == 0) {
+    if (FAT_COOP_BUFFER_SIZE - writeBuffer_end >= length) {
+      return writeBuffer_end;
+    }
+    // Wrap around, if there is enough space in front of the data
+    if (writeBuffer_start >= length) {
+      return 0;
+    }
+  } else if (writeBuffer_start - writeBuffer_end >= length) {
+    return writeBuffer_end;
   }
 
-  if (length > free) {
-    return 2;
+  return -1;
+}
+/*----------------------------------------------------------------------------*/
+/**
+ * This function is used to buffer the payload of write requests.
+ * Every payload is stored contiguously.
+ *
+ * \return Pointer to the stored payload, NULL if the buffer is full
+ */
+uint8_t *
+push_on_buffer(uint8_t *source, uint16_t length)
+{
+  int16_t pos = buffer_find_space(length);
+
+  if (pos < 0) {
+    return NULL;
   }
 
-  if (pos + length > FAT_COOP_BUFFER_SIZE) {
-    memcpy(&(writeBuffer[pos]), source, FAT_COOP_BUFFER_SIZE - pos);
-    memcpy(&(writeBuffer[0]), source, length - (FAT_COOP_BUFFER_SIZE - pos));
-  } else {
-    memcpy(&(writeBuffer[pos]), source, length);
+  if (writeBuffer_len != 0 && writeBuffer_wrap == 0 && pos == 0) {
+    writeBuffer_wrap = writeBuffer_end;
   }
 
+  memcpy(&(writeBuffer[pos]), source, length);
+  writeBuffer_end = pos + length;
   writeBuffer_len += length;
 
-  return 0;
+  return &(writeBuffer[pos]);
 }
 /*----------------------------------------------------------------------------*/
+/**
+ * Releases the oldest payload of the write buffer.
+ */
 void
-pop_from_buffer(uint16_t length)
+pop_from_buffer(uint8_t *start, uint16_t length)
 {
   if (length > writeBuffer_len) {
     return;
   }
 
-  writeBuffer_start = (writeBuffer_start + length) % FAT_COOP_BUFFER_SIZE;
+  writeBuffer_start = (uint16_t) (start - writeBuffer) + length;
   writeBuffer_len -= length;
 
+  if (writeBuffer_wrap != 0 && writeBuffer_start == writeBuffer_wrap) {
+    writeBuffer_start = 0;
+    writeBuffer_wrap = 0;
+  }
+
   if (writeBuffer_len == 0) {
-    // If the buffer is empty, we can set the start pointer to the beginning
+    // If the buffer is empty, we can set the pointers to the beginning
     writeBuffer_start = 0;
+    writeBuffer_end = 0;
+    writeBuffer_wrap = 0;
   }
 }
 /*----------------------------------------------------------------------------*/
-uint8_t
-get_item_from_buffer(uint8_t *start, uint16_t index)
-{
-  // Calculate the start_index from the start-Buffer Offset from the writeBuffer
-  uint16_t start_index = (uint16_t) (start - writeBuffer);
-  return writeBuffer[(start_index + index) % FAT_COOP_BUFFER_SIZE];
-}
-/*----------------------------------------------------------------------------*/
 int8_t
 ccfs_open(const char *name, int flags, uint8_t *token)
 {
@@ -596,10 +763,8 @@ ccfs_write(int fd, uint8_t *buf, uint16_t length, uint8_t *token)
     return 2;
   }
 
-  entry.parameters.generic.buffer = &(writeBuffer[(writeBuffer_start + writeBuffer_len) % FAT_COOP_BUFFER_SIZE]);
-
-  /** FIXME: We push information in a ring buffer, which actually does not work as a ring, because the eventual cfs_write call does not know anything about rings */
-  if (push_on_buffer(buf, length) != 0) {
+  entry.parameters.generic.buffer = push_on_buffer(buf, length);
+  if (entry.parameters.generic.buffer == NULL) {
     return 4;
   }
   entry.parameters.generic.length = length;
@@ -785,14 +950,14 @@ _get_time_of_operation(Operation op, uint16_t length)
     case COOP_CFS_READDIR:
     case COOP_CFS_READ:
     case COOP_CFS_OPEN:
-      return (FAT_COOP_TIME_READ_BLOCK_MS) * op_multiplikator;
+      return TICKS_TO_MS(step_ticks_read) * op_multiplikator;
     case COOP_CFS_CLOSEDIR:
     case COOP_CFS_SEEK:
     case COOP_CFS_CLOSE:
       return 0;
     case COOP_CFS_REMOVE:
     case COOP_CFS_WRITE:
-      return (FAT_COOP_TIME_READ_BLOCK_MS + FAT_COOP_TIME_WRITE_BLOCK_MS) * op_multiplikator;
+      return TICKS_TO_MS(step_ticks_read + step_ticks_write) * op_multiplikator;
   }
 
   return 0;
@@ -847,23 +1012,6 @@ fat_estimate_by_parameter(Operation type, uint16_t length)
 uint8_t
 fat_buffer_available(uint16_t length)
 {
-  uint16_t pos = (writeBuffer_start + writeBuffer_len) % FAT_COOP_BUFFER_SIZE;
-  uint16_t free = 0;
-
-  if (pos == writeBuffer_start && writeBuffer_len != 0) {
-    return 0;
-  }
-
-  if (pos < writeBuffer_start) {
-    free = writeBuffer_start - pos;
-  } else {
-    free = (FAT_COOP_BUFFER_SIZE - pos) + writeBuffer_start;
-  }
-
-  if (length > free) {
-    return 0;
-  }
-
-  return 1;
+  return buffer_find_space(length) >= 0;
 }
 /*----------------------------------------------------------------------------*/
@@ -53,12 +53,36 @@
 #include <stdint.h>
 #include "cfs-fat.h"
 
+/** Size of the buffer holding the data of queued write requests */
+#ifndef FAT_COOP_BUFFER_SIZE
 #define FAT_COOP_BUFFER_SIZE 128
-#define FAT_COOP_QUEUE_SIZE 15
+#endif
+
+/** Maximum duration of the work done in one run of the file system process */
+#ifndef FAT_COOP_SLOT_SIZE_MS
 #define FAT_COOP_SLOT_SIZE_MS 50L
+#endif
 
+/** Initial estimates of a block read and write, the estimates are
+ * updated with the measured duration of every step afterwards. */
+#ifndef FAT_COOP_TIME_READ_BLOCK_MS
 #define FAT_COOP_TIME_READ_BLOCK_MS 8
+#endif
+#ifndef FAT_COOP_TIME_WRITE_BLOCK_MS
 #define FAT_COOP_TIME_WRITE_BLOCK_MS 12
+#endif
+
+/** Reads up to this length, seeks and directory operations may
+ * overtake queued writes to other files. */
+#ifndef FAT_COOP_SMALL_READ
+#define FAT_COOP_SMALL_READ 512
+#endif
+
+/** Maximum number of operations that may overtake a queued write,
+ * so bulk writes are not starved. 0 keeps the queue in FIFO order. */
+#ifndef FAT_COOP_MAX_OVERTAKE
+#define FAT_COOP_MAX_OVERTAKE 4
+#endif
 
 #define FAT_COOP_STACK_SIZE 192
 
@@ -118,6 +142,8 @@ typedef struct q_entry {
 	} parameters;
 	uint8_t state;
 	int16_t ret_value;
+	/** Number of operations that overtook this one */
+	uint8_t overtaken;
 } QueueEntry;
 
 typedef struct event_op_finished {
@@ -140,7 +166,6 @@ uint16_t fat_estimate_by_parameter( Operation type, uint16_t length );
 uint8_t fat_buffer_available( uint16_t length );
 void printQueueEntry( QueueEntry *entry );
 process_event_t get_coop_event_id();
-uint8_t get_item_from_buffer( uint8_t *start, uint16_t index);
 
 void operation(void *data);
 
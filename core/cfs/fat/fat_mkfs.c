@@ -46,6 +46,7 @@
  */
 
 #include "cfs-fat.h"
+#include "dev/watchdog.h"
 
 #define DEBUG 0
 #if DEBUG
@@ -58,6 +59,8 @@
 /* specifies divisor of fat size to erase during mkfs, because erasing the whole FAT
  * may take some time.
  * e.g. FAT_ERASE_DIV set to 4 means 1/4 of the fat will be erased.
+ * Only used if the device can not erase blocks, otherwise the whole FAT is
+ * erased at once.
  */
 #define FAT_ERASE_DIV 2
 
@@ -66,9 +69,11 @@ static int mkfs_write_boot_sector(uint8_t *buffer, struct diskio_device_info *de
 static void mkfs_write_fats(uint8_t *buffer, struct diskio_device_info *dev, struct FAT_Info *fi);
 static void mkfs_write_fsinfo(uint8_t *buffer, struct diskio_device_info *dev, struct FAT_Info *fi);
 static void mkfs_write_root_directory(uint8_t *buffer, struct diskio_device_info *dev, struct FAT_Info *fi);
+static uint8_t mkfs_erase_blocks(uint8_t *buffer, struct diskio_device_info *dev, uint32_t start, uint32_t num);
 static uint8_t mkfs_calc_cluster_size(uint16_t sec_size, uint16_t bytes);
 static uint16_t mkfs_determine_fat_type_and_SPC(uint32_t total_sec_count, uint16_t bytes_per_sec);
 static uint32_t mkfs_compute_fat_size(struct FAT_Info *fi);
+static void mkfs_align_data_region(struct diskio_device_info *dev, struct FAT_Info *fi);
 /*----------------------------------------------------------------------------*/
 int
 cfs_fat_mkfs(struct diskio_device_info *dev)
@@ -203,16 +208,64 @@ mkfs_compute_fat_size(struct FAT_Info *fi)
   return FATSz;
 }
 /*----------------------------------------------------------------------------*/
+/**
+ * Increases the number of reserved sectors so that the data region starts on
+ * a multiple of the erase unit of the device. Clusters then never straddle
+ * two erase units. Falls back to aligning to the cluster size if the unit is
+ * unknown or too large for the volume.
+ *
+ * \param dev the Device the FS is created on
+ * \param fi FAT_Info structure that must contain everything
+ * mkfs_compute_fat_size() needs and BPB_FATSz.
+ */
+static void
+mkfs_align_data_region(struct diskio_device_info *dev, struct FAT_Info *fi)
+{
+  uint32_t align = diskio_get_erase_unit(dev);
+  uint16_t RootDirSectors = ((fi->BPB_RootEntCnt * 32) + (fi->BPB_BytesPerSec - 1)) / fi->BPB_BytesPerSec;
+  uint32_t data_start;
+  uint32_t pad;
+
+  // do not spend more than 1/32 of the volume on alignment
+  if (align < fi->BPB_SecPerClus || align > fi->BPB_TotSec / 32) {
+    align = fi->BPB_SecPerClus;
+  }
+
+  data_start = dev->first_sector + fi->BPB_RsvdSecCnt + fi->BPB_NumFATs * fi->BPB_FATSz + RootDirSectors;
+  pad = (align - data_start % align) % align;
+
+  PRINTF("\nAlign: unit = %lu; data_start = %lu; pad = %lu", align, data_start, pad);
+  if (fi->BPB_RsvdSecCnt + pad > 0xFFFF) {
+    return;
+  }
+
+  // Fewer data sectors are left, so the FAT size computed before still fits
+  fi->BPB_RsvdSecCnt += pad;
+}
+/*----------------------------------------------------------------------------*/
 static int
 mkfs_write_boot_sector(uint8_t *buffer, struct diskio_device_info *dev, struct FAT_Info *fi)
 {
   // Test if we can make FAT16 or FAT32
   uint16_t type_SPC = mkfs_determine_fat_type_and_SPC(dev->num_sectors, dev->sector_size);
   uint8_t sectors_per_cluster = (uint8_t) type_SPC;
+#if FAT_MKFS_CLUSTER_SIZE
+  uint8_t spc = mkfs_calc_cluster_size(dev->sector_size, FAT_MKFS_CLUSTER_SIZE);
+  // lower bound of the number of clusters, reserved sectors and FATs take less than 1/16
+  uint32_t clusters = (dev->num_sectors - dev->num_sectors / 16) / spc;
+#endif
 
   fi->BPB_FATSz = 0;
   fi->type = (uint8_t) (type_SPC >> 8);
 
+#if FAT_MKFS_CLUSTER_SIZE
+  // FAT16 needs at least 4085 clusters, FAT32 at least 65525
+  if (spc > sectors_per_cluster && ((fi->type == FAT16 && clusters >= 4085)
+          || (fi->type == FAT32 && clusters >= 65525))) {
+    sectors_per_cluster = spc;
+  }
+#endif
+
   PRINTF("\nA: SPC = %u; type = %u; dev->num_sectors = %lu", sectors_per_cluster, fi->type, dev->num_sectors);
   if (fi->type == FAT12 || fi->type == FAT_INVALID) {
     return -1;
@@ -278,6 +331,11 @@ mkfs_write_boot_sector(uint8_t *buffer, struct diskio_device_info *dev, struct F
   // BPB_FATSz16
   fi->BPB_FATSz = mkfs_compute_fat_size(fi);
 
+  // BPB_RsvdSecCnt, again after moving the data region to an erase unit boundary
+  mkfs_align_data_region(dev, fi);
+  buffer[0x00E] = (uint8_t) fi->BPB_RsvdSecCnt;
+  buffer[0x00F] = (uint8_t) (fi->BPB_RsvdSecCnt >> 8);
+
   if (fi->type == FAT16 && fi->BPB_FATSz < 0x10000) {
     buffer[0x016] = (uint8_t) fi->BPB_FATSz;
     buffer[0x017] = (uint8_t) (fi->BPB_FATSz >> 8);
@@ -402,6 +460,49 @@ mkfs_write_boot_sector(uint8_t *buffer, struct diskio_device_info *dev, struct F
   return 0;
 }
 /*----------------------------------------------------------------------------*/
+/**
+ * Clears blocks by erasing them, which is much faster than writing zeros.
+ * Devices may erase to 0xFF instead of 0x00, so the first and the last
+ * erased block are read back to check this.
+ *
+ * \param buffer Used to read back, filled with zeros afterwards
+ * \param dev the Device to erase
+ * \param start First block to erase
+ * \param num Number of blocks to erase
+ * \return 0 if the blocks were cleared to 0x00, 1 if the device can not erase,
+ * 2 if the blocks were erased to some other value and must be written
+ */
+static uint8_t
+mkfs_erase_blocks(uint8_t *buffer, struct diskio_device_info *dev, uint32_t start, uint32_t num)
+{
+  uint32_t check[2] = {start, start + num - 1};
+  uint8_t ret = 0;
+  uint16_t i;
+  uint8_t j;
+
+  if (diskio_erase_blocks(dev, start, num) != DISKIO_SUCCESS) {
+    ret = 1;
+  }
+
+  for (j = 0; j < 2 && ret == 0; j++) {
+    if (diskio_read_block(dev, check[j], buffer) != DISKIO_SUCCESS) {
+      ret = 2;
+      break;
+    }
+    for (i = 0; i < 512; i++) {
+      if (buffer[i] != 0x00) {
+        ret = 2;
+        break;
+      }
+    }
+  }
+
+  memset(buffer, 0x00, 512);
+  PRINTF("\nmkfs_erase_blocks(%lu, %lu) = %u", start, num, ret);
+
+  return ret;
+}
+/*----------------------------------------------------------------------------*/
 /**
  * Writes the FAT-Portions of the FS.
  *
@@ -414,11 +515,12 @@ mkfs_write_fats(uint8_t *buffer, struct diskio_device_info *dev, struct FAT_Info
   uint32_t *fat32_buf = (uint32_t *) buffer;
   uint16_t *fat16_buf = (uint16_t *) buffer;
   uint32_t i = 0;
-#if FAT_SYNC
   uint32_t j = 0;
-#endif
+  uint32_t num;
+  uint8_t erased;
+
+  erased = mkfs_erase_blocks(buffer, dev, fi->BPB_RsvdSecCnt, fi->BPB_FATSz * fi->BPB_NumFATs);
 
-  memset(buffer, 0x00, 512);
   if (fi->type == FAT32) {
     // BPB_Media Copy
     fat32_buf[0] = 0x0FFFFF00 + fi->BPB_Media;
@@ -435,33 +537,40 @@ mkfs_write_fats(uint8_t *buffer, struct diskio_device_info *dev, struct FAT_Info
 
   // Write first sector of the FATs
   diskio_write_block(dev, fi->BPB_RsvdSecCnt, buffer);
-#if FAT_SYNC
-  // Write first sector of the secondary FAT(s)
-  for (j = 1; j < fi->BPB_NumFATs; ++j) {
-    diskio_write_block(dev, fi->BPB_RsvdSecCnt + fi->BPB_FATSz * j, buffer);
+  // Write first sector of the secondary FAT(s), which are cleared already if erased
+  if (FAT_SYNC || erased != 1) {
+    for (j = 1; j < fi->BPB_NumFATs; ++j) {
+      diskio_write_block(dev, fi->BPB_RsvdSecCnt + fi->BPB_FATSz * j, buffer);
+    }
+  }
+
+  if (erased == 0) {
+    return;
   }
-#endif
 
   // Reset previously written first 96 bits = 12 Bytes of the buffer
   memset(buffer, 0x00, 12);
 
-  // Write additional Sectors of the FATs
-  diskio_write_blocks_start(dev, fi->BPB_RsvdSecCnt + 1, fi->BPB_FATSz / 2);
-  for (i = 1; i < fi->BPB_FATSz / FAT_ERASE_DIV; ++i) {
+  // Write additional Sectors of the FATs, all of them if erasing left garbage
+  num = (erased == 2) ? fi->BPB_FATSz : fi->BPB_FATSz / FAT_ERASE_DIV;
+  diskio_write_blocks_start(dev, fi->BPB_RsvdSecCnt + 1, num - 1);
+  for (i = 1; i < num; ++i) {
     watchdog_periodic();
     diskio_write_blocks_next(dev, buffer);
-    //diskio_write_block(dev, fi->BPB_RsvdSecCnt + i, buffer);
   }
   diskio_write_blocks_done(dev);
 
-#if FAT_SYNC
   // Write additional Sectors of the secondary FAT(s)
-  for (j = 1; j < fi->BPB_NumFATs; ++j) {
-    for (i = 1; i < fi->BPB_FATSz; ++i) {
-      diskio_write_block(dev, fi->BPB_RsvdSecCnt + i + fi->BPB_FATSz * j, buffer);
+  if (FAT_SYNC || erased == 2) {
+    for (j = 1; j < fi->BPB_NumFATs; ++j) {
+      diskio_write_blocks_start(dev, fi->BPB_RsvdSecCnt + 1 + fi->BPB_FATSz * j, fi->BPB_FATSz - 1);
+      for (i = 1; i < fi->BPB_FATSz; ++i) {
+        watchdog_periodic();
+        diskio_write_blocks_next(dev, buffer);
+      }
+      diskio_write_blocks_done(dev);
     }
   }
-#endif
 }
 /*----------------------------------------------------------------------------*/
 static void
@@ -485,20 +594,15 @@ mkfs_write_fsinfo(uint8_t *buffer, struct diskio_device_info *dev, struct FAT_In
   buffer[486] = 0x41;
   buffer[487] = 0x61;
 
-  // FSI_Free_Count
-  fsi_free_count = (fi->BPB_TotSec - ((fi->BPB_FATSz * fi->BPB_NumFATs) + fi->BPB_RsvdSecCnt)) / fi->BPB_SecPerClus;
+  // FSI_Free_Count, all data clusters except the one of the root directory
+  fsi_free_count = (fi->BPB_TotSec - ((fi->BPB_FATSz * fi->BPB_NumFATs) + fi->BPB_RsvdSecCnt)) / fi->BPB_SecPerClus - 1;
   buffer[488] = (uint8_t) fsi_free_count;
   buffer[489] = (uint8_t) (fsi_free_count >> 8);
   buffer[490] = (uint8_t) (fsi_free_count >> 16);
   buffer[491] = (uint8_t) (fsi_free_count >> 24);
 
-  // FSI_Nxt_Free
-  fsi_nxt_free = (fi->BPB_RsvdSecCnt + (fi->BPB_NumFATs * fi->BPB_FATSz));
-  if (fsi_nxt_free % fi->BPB_SecPerClus) {
-    fsi_nxt_free = (fsi_nxt_free / fi->BPB_SecPerClus) + 1;
-  } else {
-    fsi_nxt_free = (fsi_nxt_free / fi->BPB_SecPerClus);
-  }
+  // FSI_Nxt_Free, the cluster following the root directory cluster (2)
+  fsi_nxt_free = 3;
   buffer[492] = (uint8_t) fsi_nxt_free;
   buffer[493] = (uint8_t) (fsi_nxt_free >> 8);
   buffer[494] = (uint8_t) (fsi_nxt_free >> 16);
@@ -521,11 +625,16 @@ mkfs_write_root_directory(uint8_t *buffer, struct diskio_device_info *dev, struc
   // TODO: respect root cluster entry in boot sector
   uint16_t i;
   uint32_t firstDataSector = fi->BPB_RsvdSecCnt + (fi->BPB_NumFATs * fi->BPB_FATSz);// TODO: + RootDirSectors
-  memset(buffer, 0x00, 512);
-  
+
+  if (mkfs_erase_blocks(buffer, dev, firstDataSector, fi->BPB_SecPerClus) == 0) {
+    return;
+  }
+
   // clear first root cluster
+  diskio_write_blocks_start(dev, firstDataSector, fi->BPB_SecPerClus);
   for (i = 0; i < fi->BPB_SecPerClus; i++) {
-    diskio_write_block(dev, firstDataSector + i, buffer);
+    diskio_write_blocks_next(dev, buffer);
   }
+  diskio_write_blocks_done(dev);
 }
 /*----------------------------------------------------------------------------*/
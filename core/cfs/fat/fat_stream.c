@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \addtogroup fat_driver
+ * @{
+ */
+
+/**
+ * \file
+ *      Append-only streaming writer for the FAT driver
+ */
+
+#include <string.h>
+
+#include "contiki.h"
+#include "cfs-fat.h"
+
+#ifndef FAT_COOPERATIVE
+
+#define BUFFER_INDEX(n) ((n) % FAT_STREAM_BUFFERS)
+
+/*----------------------------------------------------------------------------*/
+int
+cfs_fat_stream_open(struct cfs_fat_stream *stream, const char *name)
+{
+  uint32_t size;
+
+  stream->fd = cfs_open(name, CFS_APPEND);
+  if (stream->fd < 0) {
+    return -1;
+  }
+
+  size = cfs_fat_file_size(stream->fd);
+
+  stream->process = PROCESS_CURRENT();
+  stream->produced = 0;
+  stream->consumed = 0;
+  stream->fill = 0;
+  stream->dropped = 0;
+  /* The first buffer fills up the last sector of the file */
+  stream->limit = 512 - (size % 512);
+
+  return 0;
+}
+/*----------------------------------------------------------------------------*/
+uint16_t
+cfs_fat_stream_append(struct cfs_fat_stream *stream, const void *data, uint16_t len)
+{
+  const uint8_t *src = data;
+  uint8_t idx;
+  uint16_t n, done = 0;
+
+  while (done < len) {
+    // All buffers are full and wait to be committed
+    if ((uint8_t) (stream->produced - stream->consumed) >= FAT_STREAM_BUFFERS) {
+      stream->dropped += len - done;
+      break;
+    }
+
+    idx = BUFFER_INDEX(stream->produced);
+    n = stream->limit - stream->fill;
+    if (n > len - done) {
+      n = len - done;
+    }
+
+    memcpy(&stream->buffer[idx][stream->fill], src + done, n);
+    stream->fill += n;
+    done += n;
+
+    if (stream->fill == stream->limit) {
+      stream->length[idx] = stream->limit;
+      stream->fill = 0;
+      stream->limit = 512;
+      stream->produced++;
+      process_poll(stream->process);
+    }
+  }
+
+  return done;
+}
+/*----------------------------------------------------------------------------*/
+uint16_t
+cfs_fat_stream_space(struct cfs_fat_stream *stream)
+{
+  uint8_t used = stream->produced - stream->consumed;
+
+  if (used >= FAT_STREAM_BUFFERS) {
+    return 0;
+  }
+
+  return (stream->limit - stream->fill) + (FAT_STREAM_BUFFERS - 1 - used) * 512U;
+}
+/*----------------------------------------------------------------------------*/
+int
+cfs_fat_stream_commit(struct cfs_fat_stream *stream)
+{
+  uint8_t idx, num;
+  uint16_t len;
+  int written = 0;
+
+  while (stream->consumed != stream->produced) {
+    idx = BUFFER_INDEX(stream->consumed);
+    len = stream->length[idx];
+
+    /* Join following full buffers that are consecutive in memory, all but
+     * the last one have to be complete sectors */
+    for (num = 1; idx + num < FAT_STREAM_BUFFERS
+            && (uint8_t) (stream->produced - stream->consumed) > num
+            && stream->length[idx + num - 1] == 512; num++) {
+      len += stream->length[idx + num];
+    }
+
+    if (cfs_write(stream->fd, stream->buffer[idx], len) != len) {
+      return -1;
+    }
+
+    written += len;
+    stream->consumed += num;
+  }
+
+  return written;
+}
+/*----------------------------------------------------------------------------*/
+int
+cfs_fat_stream_close(struct cfs_fat_stream *stream)
+{
+  int ret = 0;
+  uint16_t fill;
+
+  if (cfs_fat_stream_commit(stream) < 0) {
+    ret = -1;
+  }
+
+  // The buffer being filled if there is no full one left
+  fill = stream->fill;
+  if (ret == 0 && fill > 0 && stream->consumed == stream->produced) {
+    if (cfs_write(stream->fd, stream->buffer[BUFFER_INDEX(stream->produced)], fill) != fill) {
+      ret = -1;
+    }
+  }
+
+  cfs_close(stream->fd);
+  stream->fd = -1;
+
+  return ret;
+}
+/*----------------------------------------------------------------------------*/
+#endif /* FAT_COOPERATIVE */
+
+/** @} */
@@ -137,6 +137,27 @@ mbr_addPartition(struct mbr *mbr, uint8_t part_num, uint8_t part_type, uint32_t
 }
 /*----------------------------------------------------------------------------*/
 int
+mbr_addAlignedPartition(struct mbr *mbr, uint8_t part_num, uint8_t part_type, uint32_t start, uint32_t len, uint32_t align) {
+  uint32_t skip;
+
+  if (align > 1) {
+    skip = (align - start % align) % align;
+    if (skip >= len) {
+      return MBR_ERROR_INVALID_PARTITION;
+    }
+    start += skip;
+    len -= skip;
+
+    // end on a boundary as well, unless less than one unit is left
+    if (len > align) {
+      len -= len % align;
+    }
+  }
+
+  return mbr_addPartition(mbr, part_num, part_type, start, len);
+}
+/*----------------------------------------------------------------------------*/
+int
 mbr_delPartition(struct mbr *mbr, uint8_t part_num) {
   if (part_num > 4 || part_num < 1) {
     return MBR_ERROR_INVALID_PARTITION;
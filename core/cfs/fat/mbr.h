@@ -135,6 +135,22 @@ int mbr_write( struct mbr *from, struct diskio_device_info *to );
  */
 int mbr_addPartition(struct mbr *mbr, uint8_t part_num, uint8_t part_type, uint32_t start, uint32_t len );
 
+/**
+ * Adds a Partition to the mbr-structure that starts and ends on multiples
+ * of align, e.g. the erase unit of the device (see diskio_get_erase_unit()).
+ * The start is moved up to the next boundary and the length is reduced
+ * accordingly.
+ * \param *mbr The mbr-structure in which to insert the partition.
+ * \param part_num Number of the Partition which should be added.
+ * \param part_type Type of the partition.
+ * \param start LBA-style first sector the partition may start at.
+ * \param len LBA-style number of sectors available from start on.
+ * \param align Alignment in sectors, 0 or 1 for none.
+ * \return MBR_SUCCESS on success, MBR_ERROR_PARTITION_EXISTS or
+ * MBR_ERROR_INVALID_PARTITION if no aligned sector is left.
+ */
+int mbr_addAlignedPartition(struct mbr *mbr, uint8_t part_num, uint8_t part_type, uint32_t start, uint32_t len, uint32_t align );
+
 /**
  * Deletes a Partition from the mbr-structure.
  *
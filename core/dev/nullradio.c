@@ -1,4 +1,5 @@
 #include "dev/nullradio.h"
+#include "net/netstack.h"
 
 
 /*---------------------------------------------------------------------------*/
@@ -76,4 +77,16 @@ const struct radio_driver nullradio_driver =
     on,
     off,
   };
+#if NETSTACK_CONF_STATIC
+NETSTACK_STATIC_EXPORT(nullradio_driver_init, init);
+NETSTACK_STATIC_EXPORT(nullradio_driver_prepare, prepare);
+NETSTACK_STATIC_EXPORT(nullradio_driver_transmit, transmit);
+NETSTACK_STATIC_EXPORT(nullradio_driver_send, send);
+NETSTACK_STATIC_EXPORT(nullradio_driver_read, read);
+NETSTACK_STATIC_EXPORT(nullradio_driver_channel_clear, channel_clear);
+NETSTACK_STATIC_EXPORT(nullradio_driver_receiving_packet, receiving_packet);
+NETSTACK_STATIC_EXPORT(nullradio_driver_pending_packet, pending_packet);
+NETSTACK_STATIC_EXPORT(nullradio_driver_on, on);
+NETSTACK_STATIC_EXPORT(nullradio_driver_off, off);
+#endif /* NETSTACK_CONF_STATIC */
 /*---------------------------------------------------------------------------*/
@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *      Binary framed serial input
+ */
+
+#include "dev/serial-frame.h"
+#include "dev/serial-line.h"
+#include "lib/crc16.h"
+
+/* Maximum payload length of a frame */
+#ifdef SERIAL_FRAME_CONF_SIZE
+#define FRAME_SIZE SERIAL_FRAME_CONF_SIZE
+#else
+#define FRAME_SIZE 256
+#endif
+
+/* Number of frame buffers, one is filled while the others wait for the
+ * application */
+#ifdef SERIAL_FRAME_CONF_BUFFERS
+#define BUFFERS SERIAL_FRAME_CONF_BUFFERS
+#else
+#define BUFFERS 2
+#endif
+
+/* A frame is discarded if the next byte does not arrive in time */
+#ifdef SERIAL_FRAME_CONF_TIMEOUT
+#define TIMEOUT SERIAL_FRAME_CONF_TIMEOUT
+#else
+#define TIMEOUT (CLOCK_SECOND / 10)
+#endif
+
+/* Pass bytes outside of frames on to serial-line */
+#ifdef SERIAL_FRAME_CONF_LINE_INPUT
+#define LINE_INPUT SERIAL_FRAME_CONF_LINE_INPUT
+#else
+#define LINE_INPUT 0
+#endif
+
+#if BUFFERS < 2
+#error SERIAL_FRAME_CONF_BUFFERS must be at least 2
+#endif
+
+enum {
+  STATE_SYNC,
+  STATE_LEN_LO,
+  STATE_LEN_HI,
+  STATE_DATA,
+  STATE_CRC_LO,
+  STATE_CRC_HI,
+  STATE_SKIP
+};
+
+struct frame_buf {
+  /* Set by the interrupt when the frame is complete, cleared by the
+   * process when the frame has been handled */
+  volatile uint8_t full;
+  uint16_t len;
+  uint16_t crc;
+  uint8_t data[FRAME_SIZE];
+};
+
+static struct frame_buf frames[BUFFERS];
+static uint8_t rx_frame, rx_state;
+static uint16_t rx_len, rx_ptr;
+static clock_time_t rx_time;
+static volatile uint16_t dropped;
+
+PROCESS(serial_frame_process, "Serial frames");
+
+process_event_t serial_frame_event_message;
+
+/*---------------------------------------------------------------------------*/
+int
+serial_frame_input_byte(unsigned char c)
+{
+  struct frame_buf *f = &frames[rx_frame];
+  clock_time_t now = clock_time();
+
+  if(rx_state != STATE_SYNC && (clock_time_t)(now - rx_time) > TIMEOUT) {
+    /* The line was idle, the host gave up on the frame */
+    dropped++;
+    rx_state = STATE_SYNC;
+  }
+  rx_time = now;
+
+  switch(rx_state) {
+  case STATE_SYNC:
+    if(c == SERIAL_FRAME_SYNC) {
+      rx_state = STATE_LEN_LO;
+      return 0;
+    }
+#if LINE_INPUT
+    return serial_line_input_byte(c);
+#else
+    return 0;
+#endif
+  case STATE_LEN_LO:
+    rx_len = c;
+    rx_state = STATE_LEN_HI;
+    return 0;
+  case STATE_LEN_HI:
+    rx_len |= (uint16_t)c << 8;
+    rx_ptr = 0;
+    if(rx_len > FRAME_SIZE) {
+      /* Not a frame of ours, look for the next sync byte */
+      dropped++;
+      rx_state = STATE_SYNC;
+    } else if(f->full) {
+      /* The application still owns the buffer, skip payload and CRC */
+      dropped++;
+      rx_len += 2;
+      rx_state = STATE_SKIP;
+    } else {
+      f->len = rx_len;
+      rx_state = rx_len ? STATE_DATA : STATE_CRC_LO;
+    }
+    return 0;
+  case STATE_SKIP:
+    if(++rx_ptr == rx_len) {
+      rx_state = STATE_SYNC;
+    }
+    return 0;
+  case STATE_DATA:
+    f->data[rx_ptr++] = c;
+    if(rx_ptr == f->len) {
+      rx_state = STATE_CRC_LO;
+    }
+    return 0;
+  case STATE_CRC_LO:
+    f->crc = c;
+    rx_state = STATE_CRC_HI;
+    return 0;
+  case STATE_CRC_HI:
+    f->crc |= (uint16_t)c << 8;
+    f->full = 1;
+    rx_state = STATE_SYNC;
+    if(++rx_frame == BUFFERS) {
+      rx_frame = 0;
+    }
+    /* The CRC is checked by the process, not in the interrupt */
+    process_poll(&serial_frame_process);
+    return 1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+serial_frame_dropped(void)
+{
+  return dropped;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(serial_frame_process, ev, data)
+{
+  static uint8_t next;
+  static struct serial_frame frame;
+  uint8_t len[2];
+
+  PROCESS_BEGIN();
+
+  /* Only handles events posted to it */
+  process_ignore_broadcasts();
+
+  serial_frame_event_message = process_alloc_event();
+  next = 0;
+
+  while(1) {
+    PROCESS_WAIT_UNTIL(frames[next].full);
+
+    len[0] = frames[next].len & 0xff;
+    len[1] = frames[next].len >> 8;
+    if(crc16_data(frames[next].data, frames[next].len,
+                  crc16_data(len, 2, 0)) == frames[next].crc) {
+      frame.len = frames[next].len;
+      frame.data = frames[next].data;
+
+      /* Broadcast event */
+      process_post(PROCESS_BROADCAST, serial_frame_event_message, &frame);
+
+      /* Wait until all processes have handled the serial frame event */
+      if(PROCESS_ERR_OK ==
+        process_post(PROCESS_CURRENT(), PROCESS_EVENT_CONTINUE, NULL)) {
+        PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_CONTINUE);
+      }
+    } else {
+      dropped++;
+    }
+
+    frames[next].full = 0;
+    if(++next == BUFFERS) {
+      next = 0;
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+serial_frame_init(void)
+{
+  process_start(&serial_frame_process, NULL);
+}
+/*---------------------------------------------------------------------------*/
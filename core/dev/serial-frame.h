@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *      Binary framed serial input
+ *
+ *      A frame is the sync byte SERIAL_FRAME_SYNC, the length of the
+ *      payload (16 bit, little endian), the payload and the CRC-16 of
+ *      length and payload (crc16_data(), little endian). Frames are
+ *      received into one of SERIAL_FRAME_CONF_BUFFERS buffers directly
+ *      from the UART interrupt, so that bulk transfers from the host
+ *      may run at the full UART rate as long as the application
+ *      consumes frames as fast as they arrive.
+ */
+
+#ifndef SERIAL_FRAME_H_
+#define SERIAL_FRAME_H_
+
+#include "contiki.h"
+
+/** First byte of a frame, it never appears in text input */
+#define SERIAL_FRAME_SYNC 0xfe
+
+/** A received frame, valid only during the event */
+struct serial_frame {
+  uint16_t len;
+  uint8_t *data;
+};
+
+/**
+ * Event posted when a frame with a valid CRC has been received.
+ *
+ * The data pointer points to a struct serial_frame. The buffer is
+ * reused as soon as all processes have handled the event.
+ */
+extern process_event_t serial_frame_event_message;
+
+/**
+ * Get one byte of input from the serial driver.
+ *
+ * This function is to be called from the actual RS232 driver, e.g.
+ * with rs232_set_input(). With SERIAL_FRAME_CONF_LINE_INPUT, bytes
+ * outside of frames are passed on to serial_line_input_byte().
+ *
+ * \param c The data that is received.
+ *
+ * \return Non-zero if the CPU should be powered up, zero otherwise.
+ */
+int serial_frame_input_byte(unsigned char c);
+
+/**
+ * Number of frames lost because all buffers were in use, the frame
+ * was too long or its CRC did not match.
+ */
+uint16_t serial_frame_dropped(void);
+
+void serial_frame_init(void);
+
+PROCESS_NAME(serial_frame_process);
+
+#endif /* SERIAL_FRAME_H_ */
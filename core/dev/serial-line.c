@@ -91,6 +91,9 @@ PROCESS_THREAD(serial_line_process, ev, data)
 
   PROCESS_BEGIN();
 
+  /* Only handles events posted to it */
+  process_ignore_broadcasts();
+
   serial_line_event_message = process_alloc_event();
   ptr = 0;
 
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Interface to AES-128 block ciphers
+ *
+ *         Modes such as CCM* only need the encryption of single
+ *         blocks. A platform selects its cipher, usually a hardware
+ *         engine of the radio, with AES_128_CONF.
+ */
+
+#ifndef AES_128_H_
+#define AES_128_H_
+
+#include <stdint.h>
+
+#define AES_128_BLOCK_SIZE 16
+#define AES_128_KEY_LENGTH 16
+
+/**
+ * Structure of an AES-128 driver
+ */
+struct aes_128_driver {
+
+  /**
+   * \brief     Set the key used by encrypt()
+   * \param key A pointer to a 16-byte AES key
+   */
+  void (* set_key)(const uint8_t *key);
+
+  /**
+   * \brief       Encrypt one block in place (ECB)
+   * \param block A pointer to the 16-byte block to encrypt
+   */
+  void (* encrypt)(uint8_t *block);
+};
+
+#ifdef AES_128_CONF
+#define AES_128 AES_128_CONF
+extern const struct aes_128_driver AES_128;
+#endif /* AES_128_CONF */
+
+#endif /* AES_128_H_ */
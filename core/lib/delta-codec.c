@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \addtogroup delta-codec
+ * @{
+ */
+
+/**
+ * \file
+ *      Delta, zigzag and varint coding of sensor samples
+ */
+
+#include <string.h>
+
+#include "delta-codec.h"
+
+#if DELTA_CODEC_CONF_PACKETBUF
+#include "net/packetbuf.h"
+#endif
+#if DELTA_CODEC_CONF_FAT_STREAM
+#include "cfs-fat.h"
+#endif
+
+#define ZIGZAG(d)   ((uint16_t) (((uint16_t) (d) << 1) ^ (uint16_t) ((d) >> 15)))
+#define UNZIGZAG(z) ((int16_t) (((z) >> 1) ^ -((int16_t) ((z) & 1))))
+
+#define VARINT_SIZE(z) ((z) < 0x80 ? 1 : ((z) < 0x4000 ? 2 : 3))
+
+static const uint8_t resync_mark[3] = {0xff, 0xff, 0x7f};
+
+/*----------------------------------------------------------------------------*/
+void
+delta_codec_init(struct delta_codec *codec, uint8_t channels)
+{
+  if (channels > DELTA_CODEC_MAX_CHANNELS) {
+    channels = DELTA_CODEC_MAX_CHANNELS;
+  }
+  memset(codec->prev, 0, sizeof(codec->prev));
+  codec->channels = channels;
+  codec->resync = 0;
+}
+/*----------------------------------------------------------------------------*/
+void
+delta_codec_resync(struct delta_codec *codec)
+{
+  memset(codec->prev, 0, sizeof(codec->prev));
+  codec->resync = 1;
+}
+/*----------------------------------------------------------------------------*/
+void
+delta_codec_delta(struct delta_codec *codec, const int16_t *values,
+                  uint16_t *zz)
+{
+  uint8_t i;
+  int16_t d;
+
+  for (i = 0; i < codec->channels; i++) {
+    /* Wraps around, the decoder wraps the same way */
+    d = (int16_t) ((uint16_t) values[i] - (uint16_t) codec->prev[i]);
+    zz[i] = ZIGZAG(d);
+    codec->prev[i] = values[i];
+  }
+}
+/*----------------------------------------------------------------------------*/
+void
+delta_codec_undelta(struct delta_codec *codec, const uint16_t *zz,
+                    int16_t *values)
+{
+  uint8_t i;
+
+  for (i = 0; i < codec->channels; i++) {
+    codec->prev[i] = (int16_t) ((uint16_t) codec->prev[i] + (uint16_t) UNZIGZAG(zz[i]));
+    values[i] = codec->prev[i];
+  }
+}
+/*----------------------------------------------------------------------------*/
+int
+delta_codec_encode(struct delta_codec *codec, const int16_t *values,
+                   uint8_t *buf, uint16_t len)
+{
+  int16_t prev[DELTA_CODEC_MAX_CHANNELS];
+  uint16_t zz[DELTA_CODEC_MAX_CHANNELS];
+  uint16_t size = 0, z;
+  uint8_t i;
+
+  /* Work on a copy so a sample that does not fit leaves no trace */
+  memcpy(prev, codec->prev, sizeof(prev));
+  delta_codec_delta(codec, values, zz);
+
+  if (codec->resync) {
+    size = sizeof(resync_mark);
+  }
+  for (i = 0; i < codec->channels; i++) {
+    size += VARINT_SIZE(zz[i]);
+  }
+  if (size > len) {
+    memcpy(codec->prev, prev, sizeof(prev));
+    return -1;
+  }
+
+  if (codec->resync) {
+    memcpy(buf, resync_mark, sizeof(resync_mark));
+    buf += sizeof(resync_mark);
+    codec->resync = 0;
+  }
+  for (i = 0; i < codec->channels; i++) {
+    z = zz[i];
+    while (z >= 0x80) {
+      *buf++ = (z & 0x7f) | 0x80;
+      z >>= 7;
+    }
+    *buf++ = z;
+  }
+
+  return size;
+}
+/*----------------------------------------------------------------------------*/
+int
+delta_codec_decode(struct delta_codec *codec, const uint8_t *buf,
+                   uint16_t len, int16_t *values)
+{
+  uint16_t zz[DELTA_CODEC_MAX_CHANNELS];
+  uint16_t pos = 0;
+  uint8_t i, shift, b;
+
+  if (len >= sizeof(resync_mark)
+      && memcmp(buf, resync_mark, sizeof(resync_mark)) == 0) {
+    /* Resetting again when called with the same data later does no harm */
+    memset(codec->prev, 0, sizeof(codec->prev));
+    pos = sizeof(resync_mark);
+  }
+
+  for (i = 0; i < codec->channels; i++) {
+    zz[i] = 0;
+    for (shift = 0; ; shift += 7) {
+      if (pos >= len) {
+        return 0;
+      }
+      b = buf[pos++];
+      /* The third byte only carries the two top bits */
+      if (shift == 14 && b > 0x03) {
+        return -1;
+      }
+      zz[i] |= (uint16_t) (b & 0x7f) << shift;
+      if (!(b & 0x80)) {
+        break;
+      }
+    }
+  }
+
+  delta_codec_undelta(codec, zz, values);
+
+  return pos;
+}
+#if DELTA_CODEC_CONF_SIMPLE8B
+/* Values per word and bits per value of selectors 1 to 14 */
+static const uint8_t s8b_count[14] = {60, 30, 20, 15, 12, 10, 8, 7, 6, 5, 4, 3, 2, 1};
+static const uint8_t s8b_bits[14]  = { 1,  2,  3,  4,  5,  6, 7, 8, 10, 12, 15, 20, 30, 60};
+
+/*----------------------------------------------------------------------------*/
+uint8_t
+delta_codec_pack(const uint16_t *zz, uint8_t n, uint8_t *word)
+{
+  uint64_t w;
+  uint8_t sel, i, count = 0, bits = 0;
+
+  if (n == 0) {
+    return 0;
+  }
+
+  for (sel = 0; sel < sizeof(s8b_count); sel++) {
+    count = s8b_count[sel];
+    bits = s8b_bits[sel];
+    if (count > n) {
+      continue;
+    }
+    if (bits >= 16) {
+      break;
+    }
+    for (i = 0; i < count && zz[i] < (1U << bits); i++);
+    if (i == count) {
+      break;
+    }
+  }
+
+  w = (uint64_t) (sel + 1) << 60;
+  for (i = 0; i < count; i++) {
+    w |= (uint64_t) zz[i] << (i * bits);
+  }
+  for (i = 0; i < 8; i++) {
+    word[i] = w >> (i * 8);
+  }
+
+  return count;
+}
+/*----------------------------------------------------------------------------*/
+int
+delta_codec_unpack(const uint8_t *word, uint16_t *zz, uint8_t max)
+{
+  uint64_t w = 0;
+  uint8_t sel, i, count, bits;
+
+  for (i = 0; i < 8; i++) {
+    w |= (uint64_t) word[i] << (i * 8);
+  }
+
+  sel = w >> 60;
+  if (sel < 1 || sel > sizeof(s8b_count)) {
+    return -1;
+  }
+  count = s8b_count[sel - 1];
+  bits = s8b_bits[sel - 1];
+  if (count > max) {
+    return -1;
+  }
+
+  for (i = 0; i < count; i++) {
+    zz[i] = (w >> (i * bits)) & (((uint64_t) 1 << bits) - 1);
+  }
+
+  return count;
+}
+#endif /* DELTA_CODEC_CONF_SIMPLE8B */
+/*----------------------------------------------------------------------------*/
+#if DELTA_CODEC_CONF_PACKETBUF
+int
+delta_codec_encode_packetbuf(struct delta_codec *codec, const int16_t *values)
+{
+  uint16_t datalen = packetbuf_datalen();
+  int n;
+
+  if (datalen == 0) {
+    /* Every packet starts absolute, earlier packets may be lost */
+    delta_codec_init(codec, codec->channels);
+  }
+
+  n = delta_codec_encode(codec, values,
+                         (uint8_t *) packetbuf_dataptr() + datalen,
+                         PACKETBUF_SIZE - datalen);
+  if (n > 0) {
+    packetbuf_set_datalen(datalen + n);
+  }
+
+  return n;
+}
+#endif /* DELTA_CODEC_CONF_PACKETBUF */
+/*----------------------------------------------------------------------------*/
+#if DELTA_CODEC_CONF_FAT_STREAM
+int
+delta_codec_encode_stream(struct delta_codec *codec,
+                          struct cfs_fat_stream *stream,
+                          const int16_t *values)
+{
+  uint8_t buf[DELTA_CODEC_MAX_SAMPLE_SIZE(DELTA_CODEC_MAX_CHANNELS)];
+  int n;
+
+  n = delta_codec_encode(codec, values, buf, sizeof(buf));
+
+  /* Never store part of a sample, the rest of the log would be garbage */
+  if (cfs_fat_stream_space(stream) < n) {
+    stream->dropped += n;
+    delta_codec_resync(codec);
+    return -1;
+  }
+
+  return cfs_fat_stream_append(stream, buf, n);
+}
+#endif /* DELTA_CODEC_CONF_FAT_STREAM */
+/*----------------------------------------------------------------------------*/
+
+/** @} */
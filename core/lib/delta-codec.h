@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/** \addtogroup lib
+ * @{ */
+
+/**
+ * \defgroup delta-codec Delta codec for sensor streams
+ * @{
+ *
+ * Compresses multi channel 16 bit sensor samples before they are logged or
+ * sent. Each channel is stored as the difference to its previous value,
+ * zigzag mapped to an unsigned number and written as a varint of one to
+ * three bytes (seven bits per byte, least significant group first, bit 7
+ * set if another byte follows). Slowly changing signals mostly need one
+ * byte per channel instead of two.
+ *
+ * The sequence 0xff 0xff 0x7f can never be a value and marks a resync: the
+ * previous values are reset to zero and the sample that follows is absolute.
+ * It is emitted after a sample had to be dropped.
+ *
+ * The library is not part of the default build, add delta-codec.c to
+ * PROJECT_SOURCEFILES. tools/delta-decode converts logs back to text.
+ */
+
+/**
+ * \file
+ *      Delta, zigzag and varint coding of sensor samples
+ */
+
+#ifndef DELTA_CODEC_H_
+#define DELTA_CODEC_H_
+
+#include "contiki-conf.h"
+
+/** Maximum number of channels per sample. */
+#ifndef DELTA_CODEC_CONF_MAX_CHANNELS
+#define DELTA_CODEC_CONF_MAX_CHANNELS 4
+#endif
+
+/** Enables delta_codec_encode_packetbuf(). */
+#ifndef DELTA_CODEC_CONF_PACKETBUF
+#define DELTA_CODEC_CONF_PACKETBUF 0
+#endif
+
+/** Enables delta_codec_encode_stream(), requires the FAT driver. */
+#ifndef DELTA_CODEC_CONF_FAT_STREAM
+#define DELTA_CODEC_CONF_FAT_STREAM 0
+#endif
+
+/** Enables the Simple-8b block packing functions. */
+#ifndef DELTA_CODEC_CONF_SIMPLE8B
+#define DELTA_CODEC_CONF_SIMPLE8B 0
+#endif
+
+#define DELTA_CODEC_MAX_CHANNELS DELTA_CODEC_CONF_MAX_CHANNELS
+
+/** Upper bound of the encoded size of one sample, including a resync mark. */
+#define DELTA_CODEC_MAX_SAMPLE_SIZE(channels) (3 * (channels) + 3)
+
+/** State of one encoder or decoder. */
+struct delta_codec {
+  int16_t prev[DELTA_CODEC_MAX_CHANNELS];
+  uint8_t channels;
+  /** Set if the next encoded sample has to start with a resync mark */
+  uint8_t resync;
+};
+
+/**
+ * Initializes a codec. The first sample is coded relative to zero.
+ *
+ * \param codec The codec
+ * \param channels Number of values per sample, at most DELTA_CODEC_MAX_CHANNELS
+ */
+void delta_codec_init(struct delta_codec *codec, uint8_t channels);
+
+/**
+ * Resets the previous values and makes the encoder emit a resync mark with
+ * the next sample. Call this when encoded data was lost.
+ *
+ * \param codec The codec
+ */
+void delta_codec_resync(struct delta_codec *codec);
+
+/**
+ * Encodes one sample. Nothing is written and the state is not changed if
+ * the sample does not fit into the buffer.
+ *
+ * \param codec The codec
+ * \param values One value per channel
+ * \param buf Output buffer
+ * \param len Size of the output buffer
+ * \return Number of bytes written, -1 if the buffer is too small
+ */
+int delta_codec_encode(struct delta_codec *codec, const int16_t *values,
+                       uint8_t *buf, uint16_t len);
+
+/**
+ * Decodes one sample.
+ *
+ * \param codec The codec
+ * \param buf Encoded data
+ * \param len Number of bytes available
+ * \param values Receives one value per channel
+ * \return Number of bytes consumed, 0 if the data ends inside the sample,
+ * -1 if the data is malformed
+ */
+int delta_codec_decode(struct delta_codec *codec, const uint8_t *buf,
+                       uint16_t len, int16_t *values);
+
+/**
+ * Computes the zigzag coded differences of a sample and updates the state,
+ * without the varint coding. Used to feed delta_codec_pack().
+ *
+ * \param codec The codec
+ * \param values One value per channel
+ * \param zz Receives one coded difference per channel
+ */
+void delta_codec_delta(struct delta_codec *codec, const int16_t *values,
+                       uint16_t *zz);
+
+/**
+ * Reverses delta_codec_delta().
+ *
+ * \param codec The codec
+ * \param zz One coded difference per channel
+ * \param values Receives one value per channel
+ */
+void delta_codec_undelta(struct delta_codec *codec, const uint16_t *zz,
+                         int16_t *values);
+
+#if DELTA_CODEC_CONF_SIMPLE8B
+/**
+ * Packs as many coded differences as possible into one 64 bit Simple-8b
+ * word, stored little endian. The upper four bits select one of 14 layouts
+ * from 60 values of 1 bit to a single value of 60 bits.
+ *
+ * \param zz Coded differences from delta_codec_delta()
+ * \param n Number of values available, at least 1
+ * \param word Receives 8 bytes
+ * \return Number of values packed
+ */
+uint8_t delta_codec_pack(const uint16_t *zz, uint8_t n, uint8_t *word);
+
+/**
+ * Unpacks one Simple-8b word.
+ *
+ * \param word 8 bytes written by delta_codec_pack()
+ * \param zz Receives the values
+ * \param max Size of zz, 60 values are always enough
+ * \return Number of values, -1 if the word is invalid or does not fit
+ */
+int delta_codec_unpack(const uint8_t *word, uint16_t *zz, uint8_t max);
+#endif /* DELTA_CODEC_CONF_SIMPLE8B */
+
+#if DELTA_CODEC_CONF_PACKETBUF
+/**
+ * Appends one sample to the payload in the packetbuf. A sample that would
+ * start an empty payload is coded absolute, so every packet can be
+ * decoded on its own.
+ *
+ * \param codec The codec
+ * \param values One value per channel
+ * \return Number of bytes added, -1 if the packet is full and should be sent
+ */
+int delta_codec_encode_packetbuf(struct delta_codec *codec, const int16_t *values);
+#endif /* DELTA_CODEC_CONF_PACKETBUF */
+
+#if DELTA_CODEC_CONF_FAT_STREAM
+struct cfs_fat_stream;
+
+/**
+ * Appends one sample to a FAT stream. A sample that does not fit into the
+ * staging buffers is dropped as a whole and counted by the stream, the
+ * next one is preceded by a resync mark. May be called from an interrupt.
+ *
+ * \param codec The codec
+ * \param stream An open stream
+ * \param values One value per channel
+ * \return Number of bytes appended, -1 if the sample was dropped
+ */
+int delta_codec_encode_stream(struct delta_codec *codec,
+                              struct cfs_fat_stream *stream,
+                              const int16_t *values);
+#endif /* DELTA_CODEC_CONF_FAT_STREAM */
+
+#endif /* DELTA_CODEC_H_ */
+
+/** @} */
+/** @} */
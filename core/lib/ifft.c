@@ -37,6 +37,14 @@
  */
 #include "lib/ifft.h"
 
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#define TWIDDLE(i) ((int16_t)pgm_read_word(&QSIN_TAB[i]))
+#else
+#define PROGMEM
+#define TWIDDLE(i) (QSIN_TAB[i])
+#endif
+
 /*---------------------------------------------------------------------------*/
 /* constant table of sin values in 8/7 bits resolution */
 /* NOTE: symmetry can be used to reduce this to 1/2 or 1/4 the size */
@@ -166,3 +174,181 @@ ifft(int16_t xre[], int16_t xim[], uint16_t n)
     xre[i] = (ABS(xre[i]) + ABS(xim[i]));
   }
 }
+/*---------------------------------------------------------------------------*/
+/* Quarter wave of sin in Q15 for IFFT_MAX_POINTS, sin(pi/2 * i / 64) */
+#define QUARTER (IFFT_MAX_POINTS / 4)
+
+static const int16_t QSIN_TAB[QUARTER + 1] PROGMEM = {
+ 0,804,1608,2410,3212,4011,4808,5602,
+ 6393,7179,7962,8739,9512,10278,11039,11793,
+ 12539,13279,14010,14732,15446,16151,16846,17530,
+ 18204,18868,19519,20159,20787,21403,22005,22594,
+ 23170,23731,24279,24811,25329,25832,26319,26790,
+ 27245,27683,28105,28510,28898,29268,29621,29956,
+ 30273,30571,30852,31113,31356,31580,31785,31971,
+ 32137,32285,32412,32521,32609,32678,32728,32757,
+ 32767,
+};
+
+/* Q15 sine and cosine of 2 * pi * k / IFFT_MAX_POINTS */
+static int16_t
+qsin(uint16_t k)
+{
+  uint16_t r;
+
+  k %= IFFT_MAX_POINTS;
+  r = k % QUARTER;
+  switch(k / QUARTER) {
+  case 0:
+    return TWIDDLE(r);
+  case 1:
+    return TWIDDLE(QUARTER - r);
+  case 2:
+    return -TWIDDLE(r);
+  default:
+    return -TWIDDLE(QUARTER - r);
+  }
+}
+
+#define qcos(k) qsin((k) + QUARTER)
+
+/* (re + i im) * (c - i s), the twiddle factor of a forward transform */
+#define CMUL_RE(re, im, c, s) (((int32_t)(re) * (c) + (int32_t)(im) * (s)) >> 15)
+#define CMUL_IM(re, im, c, s) (((int32_t)(im) * (c) - (int32_t)(re) * (s)) >> 15)
+/*---------------------------------------------------------------------------*/
+int
+ifft_complex(int16_t z[], uint16_t n)
+{
+  uint16_t nu, h, j, k, base, step, p;
+  int32_t ar, ai, br, bi, cr, ci, dr, di;
+  int16_t c, s, t;
+
+  if(n < 2 || n > IFFT_MAX_POINTS || (n & (n - 1)) != 0) {
+    return -1;
+  }
+  nu = ilog2(n);
+
+  for(k = 0; k < n; k++) {
+    p = bitrev(k, nu);
+    if(p > k) {
+      t = z[2 * k];
+      z[2 * k] = z[2 * p];
+      z[2 * p] = t;
+      t = z[2 * k + 1];
+      z[2 * k + 1] = z[2 * p + 1];
+      z[2 * p + 1] = t;
+    }
+  }
+
+  /* An odd number of radix-2 stages starts with one without twiddles */
+  h = 1;
+  if(nu & 1) {
+    for(k = 0; k < 2 * n; k += 4) {
+      ar = z[k];
+      ai = z[k + 1];
+      br = z[k + 2];
+      bi = z[k + 3];
+      z[k] = (ar + br) >> 1;
+      z[k + 1] = (ai + bi) >> 1;
+      z[k + 2] = (ar - br) >> 1;
+      z[k + 3] = (ai - bi) >> 1;
+    }
+    h = 2;
+  }
+
+  /* Radix-4 butterflies, each does two radix-2 stages with three instead
+     of four twiddle multiplications. The input is in bit reversed order,
+     so the second and third input are swapped compared to the textbook
+     butterfly. Scaling by 1/4 keeps the result in range. */
+  for(; h < n; h *= 4) {
+    step = IFFT_MAX_POINTS / (4 * h);
+    for(j = 0; j < h; j++) {
+      for(base = 0; base < n; base += 4 * h) {
+        k = 2 * (base + j);
+        ar = z[k];
+        ai = z[k + 1];
+        if(j == 0) {
+          br = z[k + 2 * h];
+          bi = z[k + 2 * h + 1];
+          cr = z[k + 4 * h];
+          ci = z[k + 4 * h + 1];
+          dr = z[k + 6 * h];
+          di = z[k + 6 * h + 1];
+        } else {
+          c = qcos(2 * j * step);
+          s = qsin(2 * j * step);
+          br = CMUL_RE(z[k + 2 * h], z[k + 2 * h + 1], c, s);
+          bi = CMUL_IM(z[k + 2 * h], z[k + 2 * h + 1], c, s);
+          c = qcos(j * step);
+          s = qsin(j * step);
+          cr = CMUL_RE(z[k + 4 * h], z[k + 4 * h + 1], c, s);
+          ci = CMUL_IM(z[k + 4 * h], z[k + 4 * h + 1], c, s);
+          c = qcos(3 * j * step);
+          s = qsin(3 * j * step);
+          dr = CMUL_RE(z[k + 6 * h], z[k + 6 * h + 1], c, s);
+          di = CMUL_IM(z[k + 6 * h], z[k + 6 * h + 1], c, s);
+        }
+
+        /* y0 = a + b + c + d, y2 = a + b - c - d,
+           y1 = a - b - i (c - d), y3 = a - b + i (c - d) */
+        z[k] = (ar + br + cr + dr) >> 2;
+        z[k + 1] = (ai + bi + ci + di) >> 2;
+        z[k + 4 * h] = (ar + br - cr - dr) >> 2;
+        z[k + 4 * h + 1] = (ai + bi - ci - di) >> 2;
+        z[k + 2 * h] = (ar - br + ci - di) >> 2;
+        z[k + 2 * h + 1] = (ai - bi - cr + dr) >> 2;
+        z[k + 6 * h] = (ar - br - ci + di) >> 2;
+        z[k + 6 * h + 1] = (ai - bi + cr - dr) >> 2;
+      }
+    }
+  }
+
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+ifft_real(int16_t x[], uint16_t n)
+{
+  uint16_t k, m, step;
+  int32_t fer, fei, for_, foi, tr, ti;
+  int16_t c, s;
+
+  if(n < 4 || n > IFFT_MAX_POINTS || (n & (n - 1)) != 0) {
+    return -1;
+  }
+
+  /* Even samples are the real, odd ones the imaginary part */
+  ifft_complex(x, n / 2);
+
+  /* X[0] and X[n/2] are real and share the first slot */
+  fer = x[0];
+  fei = x[1];
+  x[0] = (fer + fei) >> 1;
+  x[1] = (fer - fei) >> 1;
+
+  step = IFFT_MAX_POINTS / n;
+  for(k = 1; k <= n / 4; k++) {
+    m = n / 2 - k;
+    /* Spectra of the even and odd samples, from Z[k] and conj(Z[n/2-k]) */
+    fer = ((int32_t)x[2 * k] + x[2 * m]) >> 1;
+    fei = ((int32_t)x[2 * k + 1] - x[2 * m + 1]) >> 1;
+    for_ = ((int32_t)x[2 * k + 1] + x[2 * m + 1]) >> 1;
+    foi = ((int32_t)x[2 * m] - x[2 * k]) >> 1;
+
+    c = qcos(k * step);
+    s = qsin(k * step);
+    tr = CMUL_RE(for_, foi, c, s);
+    ti = CMUL_IM(for_, foi, c, s);
+
+    /* X[k] = Fe + W^k Fo, X[n/2-k] = conj(Fe - W^k Fo) */
+    x[2 * k] = (fer + tr) >> 1;
+    x[2 * k + 1] = (fei + ti) >> 1;
+    if(m != k) {
+      x[2 * m] = (fer - tr) >> 1;
+      x[2 * m + 1] = (ti - fei) >> 1;
+    }
+  }
+
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
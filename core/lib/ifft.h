@@ -55,4 +55,31 @@
 */
 void ifft(int16_t xre[], int16_t xim[], uint16_t n);
 
+/* Largest transform of ifft_complex() and ifft_real(), the size of the
+   twiddle table. */
+#define IFFT_MAX_POINTS 256
+
+/* ifft_complex(z[], n) - fixpoint FFT on n complex samples
+   The samples are stored interleaved, z[2k] is the real and z[2k+1] the
+   imaginary part of sample k, and are replaced by the spectrum in natural
+   order. Uses radix-4 butterflies with 16 bit twiddle factors from a table
+   in program memory, and a single radix-2 stage if n is not a power of 4.
+   The result is scaled by 1/n so full 16 bit input can not overflow.
+
+   n must be a power of two from 2 to IFFT_MAX_POINTS.
+   Returns 0, or -1 if n is not supported.
+*/
+int ifft_complex(int16_t z[], uint16_t n);
+
+/* ifft_real(x[], n) - fixpoint FFT on n real samples
+   Runs a complex transform of n/2 points on the samples in place, so no
+   array for the imaginary part is needed. Afterwards x[2k] and x[2k+1]
+   are the real and imaginary part of bin k for 0 < k < n/2. The real bins
+   0 (DC) and n/2 are stored in x[0] and x[1]. The result is scaled by 1/n.
+
+   n must be a power of two from 4 to IFFT_MAX_POINTS.
+   Returns 0, or -1 if n is not supported.
+*/
+int ifft_real(int16_t x[], uint16_t n);
+
 #endif /* IFFT_H */
@@ -0,0 +1,191 @@
+/**
+ * \file
+ *         Fixed-point IMU orientation estimator
+ */
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "lib/imu-fusion.h"
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#define ATAN(i) ((int16_t)pgm_read_word(&atan_tab[i]))
+#else
+#define PROGMEM
+#define ATAN(i) (atan_tab[i])
+#endif
+
+/* Binary angles of quarter and half a turn */
+#define QUARTER 16384
+#define HALF    32768U
+
+/* atan(i / 64) as binary angle */
+#define ATAN_TAB_BITS 6
+static const int16_t atan_tab[(1 << ATAN_TAB_BITS) + 1] PROGMEM = {
+  0, 163, 326, 489, 651, 813, 975, 1136, 1297, 1457, 1617, 1775, 1933,
+  2090, 2246, 2401, 2555, 2708, 2860, 3010, 3159, 3307, 3453, 3599, 3742,
+  3884, 4025, 4164, 4302, 4438, 4572, 4705, 4836, 4966, 5094, 5220, 5344,
+  5467, 5589, 5708, 5826, 5943, 6058, 6171, 6282, 6392, 6500, 6607, 6712,
+  6815, 6917, 7018, 7117, 7214, 7310, 7405, 7498, 7589, 7679, 7768, 7856,
+  7942, 8026, 8110, 8192
+};
+/*---------------------------------------------------------------------------*/
+int16_t
+imu_fusion_atan2(int32_t y, int32_t x)
+{
+  uint32_t ax = x < 0 ? -x : x;
+  uint32_t ay = y < 0 ? -y : y;
+  uint32_t min, max;
+  uint16_t q, i, a;
+
+  if(ax == 0 && ay == 0) {
+    return 0;
+  }
+  min = ax < ay ? ax : ay;
+  max = ax < ay ? ay : ax;
+
+  /* ratio min / max in Q14, table index and 8 bit of interpolation */
+  q = (min << 14) / max;
+  i = q >> (14 - ATAN_TAB_BITS);
+  a = ATAN(i);
+  if(i < (1 << ATAN_TAB_BITS)) {
+    a += ((uint32_t)(ATAN(i + 1) - ATAN(i)) * (q & 0xFF)) >> 8;
+  }
+
+  if(ay > ax) {
+    a = QUARTER - a;
+  }
+  if(x < 0) {
+    a = HALF - a;
+  }
+  return (int16_t)(y < 0 ? -a : a);
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+isqrt(uint32_t v)
+{
+  uint32_t bit = 1UL << 30;
+  uint32_t r = 0;
+
+  while(bit > v) {
+    bit >>= 2;
+  }
+  while(bit) {
+    if(v >= r + bit) {
+      v -= r + bit;
+      r = (r >> 1) + bit;
+    } else {
+      r >>= 1;
+    }
+    bit >>= 2;
+  }
+  return r;
+}
+/*---------------------------------------------------------------------------*/
+static void
+correct(uint32_t *angle, int16_t measured, uint16_t alpha)
+{
+  int16_t err = measured - (int16_t)(*angle >> 16);
+
+  *angle += (uint32_t)((int32_t)err * alpha);
+}
+/*---------------------------------------------------------------------------*/
+int
+imu_fusion_init(struct imu_fusion *f, uint16_t rate, uint32_t gyro_udps,
+                uint16_t acc_1g, uint16_t alpha)
+{
+  uint32_t k;
+  uint32_t g2;
+
+  /* 2^31 / 180e6 ~ 11.930, i.e. micro dps to fractional binary angle */
+  if(rate == 0 || gyro_udps > 350000UL || acc_1g > 30000) {
+    return -1;
+  }
+  k = (gyro_udps * 11930UL + rate * 500UL) / (rate * 1000UL);
+  if(k == 0 || k > 0xFFFF) {
+    return -1;
+  }
+  g2 = (uint32_t)acc_1g * acc_1g;
+
+  f->roll = f->pitch = f->yaw = 0;
+  f->gyro_k = k;
+  f->alpha = alpha;
+  f->acc_min2 = g2 / 4;
+  f->acc_max2 = acc_1g ? g2 / 4 * 9 : 0xFFFFFFFFUL;
+  f->seeded = 0;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+imu_fusion_gyro(struct imu_fusion *f, const int16_t *gyro, uint8_t n)
+{
+  while(n--) {
+    f->roll += (uint32_t)((int32_t)gyro[0] * f->gyro_k);
+    f->pitch += (uint32_t)((int32_t)gyro[1] * f->gyro_k);
+    f->yaw += (uint32_t)((int32_t)gyro[2] * f->gyro_k);
+    gyro += 3;
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+imu_fusion_acc(struct imu_fusion *f, const int16_t *acc)
+{
+  int32_t x = acc[0], y = acc[1], z = acc[2];
+  uint32_t yz2 = (uint32_t)(y * y) + (uint32_t)(z * z);
+  uint32_t mag2 = yz2 + (uint32_t)(x * x);
+  int16_t roll, pitch;
+
+  if(mag2 < f->acc_min2 || mag2 > f->acc_max2) {
+    return 0;
+  }
+  roll = imu_fusion_atan2(y, z);
+  pitch = imu_fusion_atan2(-x, isqrt(yz2));
+
+  if(!f->seeded) {
+    f->roll = (uint32_t)(uint16_t)roll << 16;
+    f->pitch = (uint32_t)(uint16_t)pitch << 16;
+    f->seeded = 1;
+  } else {
+    correct(&f->roll, roll, f->alpha);
+    correct(&f->pitch, pitch, f->alpha);
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+imu_fusion_update(struct imu_fusion *f, const int16_t *acc,
+                  const int16_t *gyro, uint8_t n)
+{
+  while(n--) {
+    imu_fusion_gyro(f, gyro, 1);
+    imu_fusion_acc(f, acc);
+    gyro += 3;
+    acc += 3;
+  }
+}
+/*---------------------------------------------------------------------------*/
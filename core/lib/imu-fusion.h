@@ -0,0 +1,148 @@
+/** \addtogroup lib
+ * @{ */
+/**
+ * \defgroup imu-fusion Fixed-point IMU orientation estimator
+ *
+ * Complementary filter estimating roll and pitch from a 3-axis gyro and
+ * a 3-axis accelerometer without floating point. Gyro rates are
+ * integrated at the gyro sample rate; every accelerometer sample pulls
+ * roll and pitch a fraction alpha towards the tilt it measures. Yaw is
+ * only integrated and therefore drifts.
+ *
+ * Angles are binary angles: an int16_t where 32768 is 180 degrees, so
+ * they wrap around like the orientation does. Internally each angle
+ * keeps 16 more fractional bits. The accelerometer tilt is computed
+ * with an atan2() from a table in program memory.
+ *
+ * Samples are x, y, z triplets of raw sensor values, so the FIFO
+ * batches of the streaming sensor modes can be passed directly, e.g.
+ * on INGA
+\code
+const struct gyro_batch *b = gyro_sensor_batch();
+imu_fusion_gyro(&f, (const int16_t *)b->samples, b->count);
+while(acc_sensor_stream_get(&a)) {
+  imu_fusion_acc(&f, (const int16_t *)&a);
+}
+\endcode
+ * Both sensors are expected to share their axes. Roll is about x and
+ * pitch about y, with the usual small-angle coupling of a complementary
+ * filter.
+ *
+ * @{
+ */
+/**
+ * \file
+ *         Fixed-point IMU orientation estimator
+ */
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef IMU_FUSION_H_
+#define IMU_FUSION_H_
+
+#include "contiki-conf.h"
+
+/** Converts a binary angle to hundredths of a degree */
+#define IMU_FUSION_TO_CDEG(a) ((int16_t)(((int32_t)(a) * 9000) >> 14))
+
+/** Converts a fraction in percent to an alpha for imu_fusion_init() */
+#define IMU_FUSION_ALPHA(percent) ((uint16_t)((percent) * 65535UL / 100))
+
+struct imu_fusion {
+  /* binary angles, 16 fractional bits */
+  uint32_t roll, pitch, yaw;
+  /* gyro LSB per sample to fractional binary angle */
+  uint16_t gyro_k;
+  /* share of the accelerometer tilt, Q16 */
+  uint16_t alpha;
+  /* squared bounds of an accepted acceleration magnitude */
+  uint32_t acc_min2, acc_max2;
+  uint8_t seeded;
+};
+
+/**
+ * \brief Initializes an estimator
+ * \param f         The estimator
+ * \param rate      Gyro sample rate [Hz]
+ * \param gyro_udps Gyro sensitivity [micro dps per LSB], e.g. 8750 for
+ *                  the L3G4200D at 250 dps
+ * \param acc_1g    Accelerometer reading at 1 g [LSB], e.g. 256 for the
+ *                  ADXL345 in full resolution. Samples with a magnitude
+ *                  outside 0.5 g to 1.5 g are not used for correction.
+ *                  0 uses all samples.
+ * \param alpha     Share of the accelerometer tilt mixed in per sample,
+ *                  see IMU_FUSION_ALPHA()
+ * \retval 0        OK
+ * \retval -1       The gyro resolution does not fit this rate, or
+ *                  acc_1g is above 30000
+ *
+ * The first accelerometer sample sets roll and pitch directly.
+ */
+int imu_fusion_init(struct imu_fusion *f, uint16_t rate, uint32_t gyro_udps,
+                    uint16_t acc_1g, uint16_t alpha);
+
+/**
+ * \brief Integrates gyro samples
+ * \param f    The estimator
+ * \param gyro n raw x, y, z triplets, oldest first
+ * \param n    Number of samples
+ */
+void imu_fusion_gyro(struct imu_fusion *f, const int16_t *gyro, uint8_t n);
+
+/**
+ * \brief Corrects roll and pitch with an accelerometer sample
+ * \param f   The estimator
+ * \param acc Raw x, y, z triplet
+ * \return    1 if the sample was used, 0 if its magnitude was rejected
+ */
+int imu_fusion_acc(struct imu_fusion *f, const int16_t *acc);
+
+/**
+ * \brief Feeds n pairs of simultaneous gyro and accelerometer samples
+ */
+void imu_fusion_update(struct imu_fusion *f, const int16_t *acc,
+                       const int16_t *gyro, uint8_t n);
+
+/** \brief Roll as binary angle */
+#define imu_fusion_roll(f)  ((int16_t)((f)->roll >> 16))
+/** \brief Pitch as binary angle */
+#define imu_fusion_pitch(f) ((int16_t)((f)->pitch >> 16))
+/** \brief Integrated yaw as binary angle */
+#define imu_fusion_yaw(f)   ((int16_t)((f)->yaw >> 16))
+
+/**
+ * \brief Fixed-point atan2
+ * \return Binary angle of the vector (x, y), 0 for (0, 0)
+ *
+ * |x| and |y| must be below 2^18. The error is below 0.01 degree.
+ */
+int16_t imu_fusion_atan2(int32_t y, int32_t x);
+
+#endif /* IMU_FUSION_H_ */
+/** @} */
+/** @} */
@@ -326,4 +326,185 @@ list_item_next(void *item)
   return item == NULL? NULL: ((struct list *)item)->next;
 }
 /*---------------------------------------------------------------------------*/
+/**
+ * Initialize a list with a tail pointer.
+ *
+ * \param list The list to be initialized.
+ */
+void
+list_tailed_init(list_tailed_t list)
+{
+  list->head = list->tail = NULL;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Get a pointer to the first element of a list with a tail pointer.
+ *
+ * \param list The list.
+ * \return A pointer to the first element on the list.
+ */
+void *
+list_tailed_head(list_tailed_t list)
+{
+  return list->head;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Get the last element of a list with a tail pointer in constant time.
+ *
+ * \param list The list
+ * \return A pointer to the last element on the list.
+ */
+void *
+list_tailed_tail(list_tailed_t list)
+{
+  return list->tail;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Add an item at the end of a list with a tail pointer.
+ *
+ * Unlike list_add(), the list is not searched for the item, so this
+ * takes constant time. The item \b must not already be on the list,
+ * remove it with list_tailed_remove() first if it might be.
+ *
+ * \param list The list.
+ * \param item A pointer to the item to be added.
+ */
+void
+list_tailed_add(list_tailed_t list, void *item)
+{
+  ((struct list *)item)->next = NULL;
+
+  if(list->tail == NULL) {
+    list->head = item;
+  } else {
+    ((struct list *)list->tail)->next = item;
+  }
+  list->tail = item;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Add an item to the start of a list with a tail pointer.
+ */
+void
+list_tailed_push(list_tailed_t list, void *item)
+{
+  /* Make sure not to add the same element twice */
+  list_tailed_remove(list, item);
+
+  ((struct list *)item)->next = list->head;
+  list->head = item;
+  if(list->tail == NULL) {
+    list->tail = item;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Remove the first object on a list with a tail pointer.
+ *
+ * \param list The list.
+ * \return Pointer to the removed element of list.
+ */
+void *
+list_tailed_pop(list_tailed_t list)
+{
+  struct list *l;
+
+  l = list->head;
+  if(l != NULL) {
+    list->head = l->next;
+    if(list->head == NULL) {
+      list->tail = NULL;
+    }
+  }
+
+  return l;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Remove the last object on a list with a tail pointer.
+ *
+ * \param list The list
+ * \return The removed object
+ */
+void *
+list_tailed_chop(list_tailed_t list)
+{
+  void *r;
+
+  r = list->tail;
+  if(r != NULL) {
+    list_tailed_remove(list, r);
+  }
+
+  return r;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Remove a specific element from a list with a tail pointer.
+ *
+ * \param list The list.
+ * \param item The item that is to be removed from the list.
+ */
+void
+list_tailed_remove(list_tailed_t list, void *item)
+{
+  struct list *l, *r;
+
+  r = NULL;
+  for(l = list->head; l != NULL; l = l->next) {
+    if(l == item) {
+      if(r == NULL) {
+	/* First on list */
+	list->head = l->next;
+      } else {
+	/* Not first on list */
+	r->next = l->next;
+      }
+      if(list->tail == l) {
+        list->tail = r;
+      }
+      l->next = NULL;
+      return;
+    }
+    r = l;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Get the length of a list with a tail pointer.
+ *
+ * \param list The list.
+ * \return The length of the list.
+ */
+int
+list_tailed_length(list_tailed_t list)
+{
+  return list_length(LIST_TAILED_LIST(list));
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Insert an item after a specified item on a list with a tail pointer.
+ *
+ * If previtem is NULL, the new item is placed at the start of the list.
+ *
+ * \param list The list
+ * \param previtem The item after which the new item should be inserted
+ * \param newitem  The new item that is to be inserted
+ */
+void
+list_tailed_insert(list_tailed_t list, void *previtem, void *newitem)
+{
+  if(previtem == NULL) {
+    list_tailed_push(list, newitem);
+  } else {
+    ((struct list *)newitem)->next = ((struct list *)previtem)->next;
+    ((struct list *)previtem)->next = newitem;
+    if(list->tail == previtem) {
+      list->tail = newitem;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
 /** @} */
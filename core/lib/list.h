@@ -134,6 +134,41 @@
  */
 typedef void ** list_t;
 
+/**
+ * A linked list that also keeps a pointer to its last element, so
+ * list_tailed_add() and list_tailed_tail() take constant time. Use it
+ * for lists that are used as FIFO queues.
+ *
+ * The head is the first member, so LIST_TAILED_LIST() can be passed to
+ * the functions that only read a list, such as list_head(),
+ * list_length() and list_item_next(). Lists must only be changed with
+ * the list_tailed functions.
+ */
+struct list_tailed {
+  void *head;
+  void *tail;
+};
+
+typedef struct list_tailed * list_tailed_t;
+
+/**
+ * Declare a linked list with a tail pointer.
+ *
+ * Same as LIST(), but the list has to be used with the list_tailed
+ * functions.
+ *
+ * \param name The name of the list.
+ */
+#define LIST_TAILED(name) \
+         static struct list_tailed LIST_CONCAT(name,_list) = { NULL, NULL }; \
+         static list_tailed_t name = &LIST_CONCAT(name,_list)
+
+/**
+ * Get a plain list_t view of a list with a tail pointer, for the
+ * functions that do not change the list.
+ */
+#define LIST_TAILED_LIST(tlist) ((list_t)&(tlist)->head)
+
 void   list_init(list_t list);
 void * list_head(list_t list);
 void * list_tail(list_t list);
@@ -153,6 +188,17 @@ void   list_insert(list_t list, void *previtem, void *newitem);
 
 void * list_item_next(void *item);
 
+void   list_tailed_init(list_tailed_t list);
+void * list_tailed_head(list_tailed_t list);
+void * list_tailed_tail(list_tailed_t list);
+void * list_tailed_pop(list_tailed_t list);
+void   list_tailed_push(list_tailed_t list, void *item);
+void * list_tailed_chop(list_tailed_t list);
+void   list_tailed_add(list_tailed_t list, void *item);
+void   list_tailed_remove(list_tailed_t list, void *item);
+int    list_tailed_length(list_tailed_t list);
+void   list_tailed_insert(list_tailed_t list, void *previtem, void *newitem);
+
 #endif /* LIST_H_ */
 
 /** @} */
@@ -47,14 +47,82 @@
 #include "contiki.h"
 #include "lib/memb.h"
 
+#if MEMB_CONF_STATS
+static struct memb *memb_pools;
+#endif
 /*---------------------------------------------------------------------------*/
 void
 memb_init(struct memb *m)
 {
+#if MEMB_CONF_STATS
+  struct memb *p;
+
+  for(p = memb_pools; p != NULL && p != m; p = p->next);
+  if(p == NULL) {
+    m->next = memb_pools;
+    memb_pools = m;
+  }
+  m->used = m->max_used = 0;
+#endif /* MEMB_CONF_STATS */
+#if MEMB_CONF_FREELIST
+  m->nfree = 0;
+  m->unused = 0;
+#endif /* MEMB_CONF_FREELIST */
   memset(m->count, 0, m->num);
   memset(m->mem, 0, m->size * m->num);
 }
 /*---------------------------------------------------------------------------*/
+#if MEMB_CONF_FREELIST
+void *
+memb_alloc(struct memb *m)
+{
+  unsigned short i;
+
+  if(m->nfree > 0) {
+    /* Reuse the block that was freed last. */
+    i = m->free[--m->nfree];
+  } else if(m->unused < m->num) {
+    i = m->unused++;
+  } else {
+    return NULL;
+  }
+
+  ++(m->count[i]);
+#if MEMB_CONF_STATS
+  if(++m->used > m->max_used) {
+    m->max_used = m->used;
+  }
+#endif /* MEMB_CONF_STATS */
+  return (char *)m->mem + i * m->size;
+}
+/*---------------------------------------------------------------------------*/
+char
+memb_free(struct memb *m, void *ptr)
+{
+  unsigned short offset;
+  int i;
+
+  if(!memb_inmemb(m, ptr)) {
+    return -1;
+  }
+  offset = (char *)ptr - (char *)m->mem;
+  if(offset % m->size != 0) {
+    return -1;
+  }
+  i = offset / m->size;
+
+  /* Make sure that we don't deallocate free memory. */
+  if(m->count[i] > 0) {
+    if(--(m->count[i]) == 0) {
+      m->free[m->nfree++] = i;
+#if MEMB_CONF_STATS
+      --m->used;
+#endif /* MEMB_CONF_STATS */
+    }
+  }
+  return m->count[i];
+}
+#else /* MEMB_CONF_FREELIST */
 void *
 memb_alloc(struct memb *m)
 {
@@ -66,6 +134,11 @@ memb_alloc(struct memb *m)
 	 indicate that it now is used and return a pointer to the
 	 memory block. */
       ++(m->count[i]);
+#if MEMB_CONF_STATS
+      if(++m->used > m->max_used) {
+        m->max_used = m->used;
+      }
+#endif /* MEMB_CONF_STATS */
       return (void *)((char *)m->mem + (i * m->size));
     }
   }
@@ -92,6 +165,11 @@ memb_free(struct memb *m, void *ptr)
       if(m->count[i] > 0) {
 	/* Make sure that we don't deallocate free memory. */
 	--(m->count[i]);
+#if MEMB_CONF_STATS
+        if(m->count[i] == 0) {
+          --m->used;
+        }
+#endif /* MEMB_CONF_STATS */
       }
       return m->count[i];
     }
@@ -99,6 +177,7 @@ memb_free(struct memb *m, void *ptr)
   }
   return -1;
 }
+#endif /* MEMB_CONF_FREELIST */
 /*---------------------------------------------------------------------------*/
 int
 memb_inmemb(struct memb *m, void *ptr)
@@ -107,5 +186,27 @@ memb_inmemb(struct memb *m, void *ptr)
     (char *)ptr < (char *)m->mem + (m->num * m->size);
 }
 /*---------------------------------------------------------------------------*/
+int
+memb_numfree(struct memb *m)
+{
+  int i;
+  int num_free = 0;
+
+  for(i = 0; i < m->num; ++i) {
+    if(m->count[i] == 0) {
+      ++num_free;
+    }
+  }
+  return num_free;
+}
+/*---------------------------------------------------------------------------*/
+#if MEMB_CONF_STATS
+struct memb *
+memb_list(void)
+{
+  return memb_pools;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* MEMB_CONF_STATS */
 
 /** @} */
@@ -86,18 +86,74 @@ MEMB(connections, struct connection, 16);
  * \param num The total number of memory chunks in the block.
  *
  */
+/**
+ * Keeps the indices of the free blocks of a memory block on a stack,
+ * so memb_alloc() and memb_free() take constant time instead of
+ * scanning the block. The stack costs two bytes per block and is kept
+ * outside the blocks, so a freed block keeps its contents until it is
+ * allocated again. Blocks that were never allocated are handed out in
+ * order, so a MEMB() that was not initialized with memb_init() still
+ * works.
+ */
+#ifndef MEMB_CONF_FREELIST
+#define MEMB_CONF_FREELIST 0
+#endif
+
+/**
+ * Tracks the number of allocated blocks and its maximum for every
+ * memory block. Memory blocks are registered by memb_init() and can be
+ * iterated with memb_list().
+ */
+#ifndef MEMB_CONF_STATS
+#define MEMB_CONF_STATS 0
+#endif
+
+#if MEMB_CONF_FREELIST
+#define MEMB_FREELIST(name, num) \
+        static unsigned short CC_CONCAT(name,_memb_free)[num];
+#define MEMB_FREELIST_INIT(name) , CC_CONCAT(name,_memb_free), 0, 0
+#else
+#define MEMB_FREELIST(name, num)
+#define MEMB_FREELIST_INIT(name)
+#endif
+
+#if MEMB_CONF_STATS
+#define MEMB_STATS_INIT(name) , #name, NULL, 0, 0
+#else
+#define MEMB_STATS_INIT(name)
+#endif
+
 #define MEMB(name, structure, num) \
         static char CC_CONCAT(name,_memb_count)[num]; \
+        MEMB_FREELIST(name, num) \
         static structure CC_CONCAT(name,_memb_mem)[num]; \
         static struct memb name = {sizeof(structure), num, \
                                           CC_CONCAT(name,_memb_count), \
-                                          (void *)CC_CONCAT(name,_memb_mem)}
+                                          (void *)CC_CONCAT(name,_memb_mem) \
+                                          MEMB_FREELIST_INIT(name) \
+                                          MEMB_STATS_INIT(name)}
 
 struct memb {
   unsigned short size;
   unsigned short num;
   char *count;
   void *mem;
+#if MEMB_CONF_FREELIST
+  /** Stack of the indices of the blocks that were freed */
+  unsigned short *free;
+  /** Number of indices on the stack */
+  unsigned short nfree;
+  /** Index of the first block that was never allocated */
+  unsigned short unused;
+#endif
+#if MEMB_CONF_STATS
+  const char *name;
+  struct memb *next;
+  /** Number of allocated blocks */
+  unsigned short used;
+  /** Highest number of allocated blocks since memb_init() */
+  unsigned short max_used;
+#endif
 };
 
 /**
@@ -130,6 +186,21 @@ char  memb_free(struct memb *m, void *ptr);
 
 int memb_inmemb(struct memb *m, void *ptr);
 
+/**
+ * Count the blocks that can still be allocated.
+ *
+ * \param m A memory block previously declared with MEMB().
+ */
+int memb_numfree(struct memb *m);
+
+#if MEMB_CONF_STATS
+/**
+ * Get the first of all memory blocks initialized with memb_init(),
+ * follow the next member for the others.
+ */
+struct memb *memb_list(void);
+#endif /* MEMB_CONF_STATS */
+
 
 /** @} */
 /** @} */
@@ -47,6 +47,9 @@
 #include "mmem.h"
 #include "list.h"
 #include "contiki-conf.h"
+#if MMEM_CONF_COMPACT == MMEM_COMPACT_BACKGROUND
+#include "sys/process.h"
+#endif
 #include <string.h>
 
 #ifdef MMEM_CONF_SIZE
@@ -59,6 +62,17 @@ LIST(mmemlist);
 unsigned int avail_memory;
 static char memory[MMEM_SIZE];
 
+#if MMEM_CONF_COMPACT != MMEM_COMPACT_IMMEDIATE
+/* Offset of the first byte behind the last block. Everything between
+   the blocks below it is a hole left by mmem_free(). */
+static unsigned int top;
+#endif
+static unsigned short compactions, failures;
+
+#if MMEM_CONF_COMPACT == MMEM_COMPACT_BACKGROUND
+PROCESS(mmem_process, "mmem");
+#endif
+
 /*---------------------------------------------------------------------------*/
 /**
  * \brief      Allocate a managed memory block
@@ -84,16 +98,30 @@ mmem_alloc(struct mmem *m, unsigned int size)
 {
   /* Check if we have enough memory left for this allocation. */
   if(avail_memory < size) {
+    ++failures;
     return 0;
   }
 
+#if MMEM_CONF_COMPACT != MMEM_COMPACT_IMMEDIATE
+  /* The free memory is there, but partly in holes. Close all of them. */
+  if(MMEM_SIZE - top < size) {
+    while(mmem_compact_step());
+    ++compactions;
+  }
+#endif
+
   /* We had enough memory so we add this memory block to the end of
      the list of allocated memory blocks. */
   list_add(mmemlist, m);
 
   /* Set up the pointer so that it points to the first available byte
      in the memory block. */
+#if MMEM_CONF_COMPACT != MMEM_COMPACT_IMMEDIATE
+  m->ptr = &memory[top];
+  top += size;
+#else
   m->ptr = &memory[MMEM_SIZE - avail_memory];
+#endif
 
   /* Remember the size of this memory block. */
   m->size = size;
@@ -120,6 +148,20 @@ mmem_free(struct mmem *m)
 {
   struct mmem *n;
 
+#if MMEM_CONF_COMPACT != MMEM_COMPACT_IMMEDIATE
+  avail_memory += m->size;
+  list_remove(mmemlist, m);
+
+  /* Only the end of the used memory is updated, the hole is closed
+     later. */
+  n = list_tail(mmemlist);
+  top = n == NULL ? 0 : (char *)n->ptr + n->size - memory;
+#if MMEM_CONF_COMPACT == MMEM_COMPACT_BACKGROUND
+  if(top > MMEM_SIZE - avail_memory) {
+    process_poll(&mmem_process);
+  }
+#endif
+#else /* MMEM_CONF_COMPACT != MMEM_COMPACT_IMMEDIATE */
   if(m->next != NULL) {
     /* Compact the memory after the allocation that is to be removed
        by moving it downwards. */
@@ -137,6 +179,57 @@ mmem_free(struct mmem *m)
 
   /* Remove the memory block from the list. */
   list_remove(mmemlist, m);
+#endif /* MMEM_CONF_COMPACT != MMEM_COMPACT_IMMEDIATE */
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Close one hole in the managed memory
+ * \return     Non-zero if more holes remain
+ *
+ *             Moves the first block that does not directly follow
+ *             the block before it down. Does nothing with
+ *             MMEM_COMPACT_IMMEDIATE, where there are no holes.
+ */
+int
+mmem_compact_step(void)
+{
+#if MMEM_CONF_COMPACT != MMEM_COMPACT_IMMEDIATE
+  struct mmem *n;
+  char *end;
+
+  /* The blocks are kept in address order. */
+  end = memory;
+  for(n = list_head(mmemlist); n != NULL; n = n->next) {
+    if((char *)n->ptr != end) {
+      memmove(end, n->ptr, n->size);
+      n->ptr = end;
+      if(n->next == NULL) {
+        top = end + n->size - memory;
+      }
+      return top > MMEM_SIZE - avail_memory;
+    }
+    end += n->size;
+  }
+#endif /* MMEM_CONF_COMPACT != MMEM_COMPACT_IMMEDIATE */
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Get allocation statistics
+ * \param stats Filled with the current values
+ */
+void
+mmem_stats(struct mmem_stats *stats)
+{
+  stats->used = MMEM_SIZE - avail_memory;
+  stats->free = avail_memory;
+#if MMEM_CONF_COMPACT != MMEM_COMPACT_IMMEDIATE
+  stats->fragmented = top - stats->used;
+#else
+  stats->fragmented = 0;
+#endif
+  stats->compactions = compactions;
+  stats->failures = failures;
 }
 /*---------------------------------------------------------------------------*/
 /**
@@ -153,7 +246,30 @@ mmem_init(void)
 {
   list_init(mmemlist);
   avail_memory = MMEM_SIZE;
+#if MMEM_CONF_COMPACT != MMEM_COMPACT_IMMEDIATE
+  top = 0;
+#endif
+#if MMEM_CONF_COMPACT == MMEM_COMPACT_BACKGROUND
+  process_start(&mmem_process, NULL);
+#endif
+}
+/*---------------------------------------------------------------------------*/
+#if MMEM_CONF_COMPACT == MMEM_COMPACT_BACKGROUND
+PROCESS_THREAD(mmem_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+    /* One block per poll, so other processes run in between. */
+    if(mmem_compact_step()) {
+      process_poll(&mmem_process);
+    }
+  }
+
+  PROCESS_END();
 }
 /*---------------------------------------------------------------------------*/
+#endif /* MMEM_CONF_COMPACT == MMEM_COMPACT_BACKGROUND */
 
 /** @} */
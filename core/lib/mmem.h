@@ -59,6 +59,8 @@
 #ifndef MMEM_H_
 #define MMEM_H_
 
+#include "contiki-conf.h"
+
 /*---------------------------------------------------------------------------*/
 /**
  * \brief      Get a pointer to the managed memory
@@ -80,12 +82,57 @@ struct mmem {
   void *ptr;
 };
 
+/**
+ * \name Compaction modes
+ * @{
+ */
+/** Compact the memory in mmem_free(), the original behaviour. */
+#define MMEM_COMPACT_IMMEDIATE  0
+/** Leave holes behind freed blocks and compact only when an allocation
+    does not fit behind the last block. */
+#define MMEM_COMPACT_ON_DEMAND  1
+/** Like MMEM_COMPACT_ON_DEMAND, but a process also closes the holes
+    in the background, moving one block each time it is polled. */
+#define MMEM_COMPACT_BACKGROUND 2
+/** @} */
+
+/**
+ * When the memory is compacted. The deferred modes bound the time
+ * spent in mmem_free() but may pause in mmem_alloc() when the memory
+ * is fragmented.
+ */
+#ifndef MMEM_CONF_COMPACT
+#define MMEM_CONF_COMPACT MMEM_COMPACT_IMMEDIATE
+#endif
+
+/** Allocation statistics, see mmem_stats(). */
+struct mmem_stats {
+  /** Bytes in allocated blocks */
+  unsigned int used;
+  /** Bytes that are not allocated */
+  unsigned int free;
+  /** Free bytes in holes that are not usable before compaction */
+  unsigned int fragmented;
+  /** Number of full compactions done by mmem_alloc() */
+  unsigned short compactions;
+  /** Number of allocations that failed */
+  unsigned short failures;
+};
+
 /* XXX: tagga minne med "interrupt usage", vilke gr att man r
    speciellt varsam under free(). */
 
 int  mmem_alloc(struct mmem *m, unsigned int size);
 void mmem_free(struct mmem *);
 void mmem_init(void);
+void mmem_stats(struct mmem_stats *stats);
+
+/**
+ * Moves the first block that has a hole in front of it down.
+ *
+ * \return Non-zero if holes remain
+ */
+int  mmem_compact_step(void);
 
 #endif /* MMEM_H_ */
 
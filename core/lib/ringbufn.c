@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *      Ring buffer with fixed size elements and bulk access
+ */
+
+#include "lib/ringbufn.h"
+
+#include <string.h>
+
+/* Keeps the compiler from moving the copy of an element past the
+   index update that hands it to the other side. */
+#ifdef __GNUC__
+#define BARRIER() __asm__ __volatile__("" ::: "memory")
+#else
+#define BARRIER()
+#endif
+
+/*---------------------------------------------------------------------------*/
+/* Reads an index written by the other side, which may be interrupted
+   halfway on 8-bit targets. */
+static uint16_t
+read_index(volatile uint16_t *index)
+{
+  uint16_t v;
+
+  do {
+    v = *index;
+  } while(v != *index);
+  return v;
+}
+/*---------------------------------------------------------------------------*/
+void
+ringbufn_init(struct ringbufn *r, void *a, uint8_t elem_size,
+              uint16_t elements)
+{
+  r->data = a;
+  r->elem_size = elem_size;
+  r->mask = elements - 1;
+  r->put_ptr = 0;
+  r->get_ptr = 0;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+ringbufn_reserve(struct ringbufn *r, void **ptr)
+{
+  uint16_t put, get, n;
+
+  put = r->put_ptr;
+  get = read_index(&r->get_ptr);
+  n = (get - put - 1) & r->mask;
+  if(n > r->mask + 1 - put) {
+    n = r->mask + 1 - put;
+  }
+  *ptr = r->data + put * r->elem_size;
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+void
+ringbufn_commit(struct ringbufn *r, uint16_t n)
+{
+  BARRIER();
+  r->put_ptr = (r->put_ptr + n) & r->mask;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+ringbufn_peek(struct ringbufn *r, void **ptr)
+{
+  uint16_t put, get, n;
+
+  get = r->get_ptr;
+  put = read_index(&r->put_ptr);
+  n = (put - get) & r->mask;
+  if(n > r->mask + 1 - get) {
+    n = r->mask + 1 - get;
+  }
+  *ptr = r->data + get * r->elem_size;
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+void
+ringbufn_consume(struct ringbufn *r, uint16_t n)
+{
+  BARRIER();
+  r->get_ptr = (r->get_ptr + n) & r->mask;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+ringbufn_put_n(struct ringbufn *r, const void *elems, uint16_t n)
+{
+  const uint8_t *src = elems;
+  uint16_t done, len;
+  void *dst;
+
+  /* At most two contiguous regions, before and after the wrap. */
+  for(done = 0; done < n; done += len) {
+    len = ringbufn_reserve(r, &dst);
+    if(len == 0) {
+      break;
+    }
+    if(len > n - done) {
+      len = n - done;
+    }
+    memcpy(dst, src + done * r->elem_size, len * r->elem_size);
+    ringbufn_commit(r, len);
+  }
+  return done;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+ringbufn_get_n(struct ringbufn *r, void *elems, uint16_t n)
+{
+  uint8_t *dst = elems;
+  uint16_t done, len;
+  void *src;
+
+  for(done = 0; done < n; done += len) {
+    len = ringbufn_peek(r, &src);
+    if(len == 0) {
+      break;
+    }
+    if(len > n - done) {
+      len = n - done;
+    }
+    memcpy(dst + done * r->elem_size, src, len * r->elem_size);
+    ringbufn_consume(r, len);
+  }
+  return done;
+}
+/*---------------------------------------------------------------------------*/
+int
+ringbufn_put(struct ringbufn *r, const void *elem)
+{
+  return ringbufn_put_n(r, elem, 1);
+}
+/*---------------------------------------------------------------------------*/
+int
+ringbufn_get(struct ringbufn *r, void *elem)
+{
+  return ringbufn_get_n(r, elem, 1);
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+ringbufn_size(struct ringbufn *r)
+{
+  return r->mask + 1;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+ringbufn_elements(struct ringbufn *r)
+{
+  return (read_index(&r->put_ptr) - read_index(&r->get_ptr)) & r->mask;
+}
+/*---------------------------------------------------------------------------*/
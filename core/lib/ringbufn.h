@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/** \addtogroup lib
+ * @{ */
+
+/**
+ * \defgroup ringbufn Ring buffer with fixed size elements
+ * @{
+ *
+ * A ring buffer of up to 32768 slots of a fixed element size, with
+ * calls that move several elements at once. It is safe for one
+ * producer and one consumer, where one of them may run in an interrupt
+ * handler. Unlike \ref ringbuf "ringbuf" the indices are 16 bits wide,
+ * so each side reads the index of the other one until it gets the same
+ * value twice.
+ *
+ * ringbufn_peek() and ringbufn_reserve() return the contiguous region
+ * that can be read or written in place, ringbufn_consume() and
+ * ringbufn_commit() then release it. One slot always stays empty.
+ *
+ * The library is not part of the default build, add ringbufn.c to
+ * PROJECT_SOURCEFILES.
+ */
+
+/**
+ * \file
+ *      Ring buffer with fixed size elements and bulk access
+ */
+
+#ifndef RINGBUFN_H_
+#define RINGBUFN_H_
+
+#include "contiki-conf.h"
+
+/** State of a ring buffer, the slots are stored in a separate array. */
+struct ringbufn {
+  uint8_t *data;
+  uint16_t mask;
+  uint8_t elem_size;
+  /* Written by the producer and the consumer only */
+  volatile uint16_t put_ptr, get_ptr;
+};
+
+/**
+ * Initializes a ring buffer.
+ *
+ * \param r The ring buffer
+ * \param a Array of elements * elem_size bytes
+ * \param elem_size Size of one element in bytes
+ * \param elements Number of slots, a power of two of at most 32768
+ */
+void ringbufn_init(struct ringbufn *r, void *a, uint8_t elem_size,
+                   uint16_t elements);
+
+/**
+ * Copies one element into the ring buffer.
+ *
+ * \return Non-zero if the element was written, zero if the buffer was full
+ */
+int ringbufn_put(struct ringbufn *r, const void *elem);
+
+/**
+ * Copies one element out of the ring buffer.
+ *
+ * \return Non-zero if an element was read, zero if the buffer was empty
+ */
+int ringbufn_get(struct ringbufn *r, void *elem);
+
+/**
+ * Copies up to n elements into the ring buffer.
+ *
+ * \return Number of elements written
+ */
+uint16_t ringbufn_put_n(struct ringbufn *r, const void *elems, uint16_t n);
+
+/**
+ * Copies up to n elements out of the ring buffer.
+ *
+ * \return Number of elements read
+ */
+uint16_t ringbufn_get_n(struct ringbufn *r, void *elems, uint16_t n);
+
+/**
+ * Gets the elements that can be read in place, up to the end of the
+ * array.
+ *
+ * \param r The ring buffer
+ * \param ptr Receives a pointer to the first element
+ * \return Number of contiguous elements
+ */
+uint16_t ringbufn_peek(struct ringbufn *r, void **ptr);
+
+/**
+ * Removes elements returned by ringbufn_peek().
+ *
+ * \param r The ring buffer
+ * \param n Number of elements, at most the value ringbufn_peek() returned
+ */
+void ringbufn_consume(struct ringbufn *r, uint16_t n);
+
+/**
+ * Gets the free slots that can be written in place, up to the end of
+ * the array.
+ *
+ * \param r The ring buffer
+ * \param ptr Receives a pointer to the first free slot
+ * \return Number of contiguous free slots
+ */
+uint16_t ringbufn_reserve(struct ringbufn *r, void **ptr);
+
+/**
+ * Adds elements written to the region returned by ringbufn_reserve().
+ *
+ * \param r The ring buffer
+ * \param n Number of elements, at most the value ringbufn_reserve() returned
+ */
+void ringbufn_commit(struct ringbufn *r, uint16_t n);
+
+/** Number of slots of the ring buffer, one more than it can hold. */
+uint16_t ringbufn_size(struct ringbufn *r);
+
+/** Number of elements currently in the ring buffer. */
+uint16_t ringbufn_elements(struct ringbufn *r);
+
+#endif /* RINGBUFN_H_ */
+
+/** @} */
+/** @} */
@@ -80,6 +80,24 @@ sensors_changed(const struct sensors_sensor *s)
   process_poll(&sensors_process);
 }
 /*---------------------------------------------------------------------------*/
+int
+sensors_read_block(const struct sensors_sensor *s, unsigned type_mask,
+                   int16_t *out)
+{
+  int type;
+  int n = 0;
+
+  if(s->read_block != NULL) {
+    return s->read_block(type_mask, out);
+  }
+  for(type = 0; type < 16; type++) {
+    if(type_mask & (1U << type)) {
+      out[n++] = s->value(type);
+    }
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
 const struct sensors_sensor *
 sensors_find(const char *prefix)
 {
@@ -105,6 +123,9 @@ PROCESS_THREAD(sensors_process, ev, data)
 
   PROCESS_BEGIN();
 
+  /* Only handles events posted to it */
+  process_ignore_broadcasts();
+
   sensors_event = process_alloc_event();
 
   for(i = 0; sensors[i] != NULL; ++i) {
@@ -75,6 +75,14 @@ static int my_status(int type) {...}
 SENSORS_SENSOR(my_sensor, "MY_TYPE", my_value, my_configure, my_status);
 \endcode
  * 
+ * Sensors delivering several values from one hardware readout may
+ * additionally provide a read_block function and use SENSORS_SENSOR_BLOCK().
+ * sensors_read_block() then returns a coherent vector in a single call.
+\code
+static int my_read_block(unsigned type_mask, int16_t *out) {...}
+SENSORS_SENSOR_BLOCK(my_sensor, "MY_TYPE", my_value, my_configure, my_status, my_read_block);
+\endcode
+ *
  * Finally add the sensor to your platforms sensor list.
 \code
 SENSORS(..., &my_sensor, ...);
@@ -109,6 +117,17 @@ SENSORS(..., &my_sensor, ...);
 #define SENSORS_SENSOR(name, type, value, configure, status)        \
 const struct sensors_sensor name = { type, value, configure, status }
 
+/** Defines new sensor with a block read function
+ * @param name of the sensor
+ * @param String type name of the sensor
+ * @param pointer to sensors value function
+ * @param pointer to sensors configure function
+ * @param pointer to sensors status function
+ * @param pointer to sensors read_block function
+ */
+#define SENSORS_SENSOR_BLOCK(name, type, value, configure, status, read_block) \
+const struct sensors_sensor name = { type, value, configure, status, read_block }
+
 /** Provides the number of available sensors. */
 #define SENSORS_NUM (sizeof(sensors) / sizeof(struct sensors_sensor *))
 
@@ -155,6 +174,13 @@ struct sensors_sensor {
    * \retval 0 if type is unknown
    */
   int          (* status)    (int type);
+  /** Get several sensor values from a single readout (optional).
+   *
+   * @param type_mask Bit i set selects value type i (types 0 to 15)
+   * @param out       Values of the selected types, in ascending type order
+   * @return Number of values written to out
+   */
+  int          (* read_block) (unsigned type_mask, int16_t *out);
 };
 
 /** Returns sensor associated with type name if existing
@@ -171,6 +197,17 @@ const struct sensors_sensor *sensors_next(const struct sensors_sensor *s);
  */
 const struct sensors_sensor *sensors_first(void);
 
+/** Reads several values of a sensor at once.
+ * Uses the read_block function of the sensor if available, otherwise
+ * value() is called for each selected type.
+ * @param s         Sensor to read
+ * @param type_mask Bit i set selects value type i (types 0 to 15)
+ * @param out       Values of the selected types, in ascending type order
+ * @return Number of values written to out
+ */
+int sensors_read_block(const struct sensors_sensor *s, unsigned type_mask,
+                       int16_t *out);
+
 /** To be called from sensor readout interrupt.
  * Polls sensor process.
  * @param s Reference to the sensor that updated
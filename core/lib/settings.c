@@ -78,6 +78,22 @@ typedef struct {
   settings_key_t key;
 } item_header_t;
 
+#if SETTINGS_CONF_INDEX_SIZE
+/** Items of the store in EEPROM order */
+static struct {
+  settings_key_t key;
+  settings_iter_t iter;
+} settings_index[SETTINGS_CONF_INDEX_SIZE];
+
+#define SETTINGS_INDEX_INVALID  0
+#define SETTINGS_INDEX_VALID    1
+/** The store has more items than the index can hold */
+#define SETTINGS_INDEX_OVERFLOW 2
+
+static uint8_t settings_index_state = SETTINGS_INDEX_INVALID;
+static uint8_t settings_index_count;
+#endif /* SETTINGS_CONF_INDEX_SIZE */
+
 /*****************************************************************************/
 // MARK: - Public Travesal Functions
 /*****************************************************************************/
@@ -211,14 +227,18 @@ settings_iter_delete(settings_iter_t iter)
 
     eeprom_write(iter - sizeof(header), (uint8_t *)&header, sizeof(header));
 
+#if SETTINGS_CONF_INDEX_SIZE
+    settings_index_state = SETTINGS_INDEX_INVALID;
+#endif
+
     ret = SETTINGS_STATUS_OK;
+  } else {
+    /* This case requires the settings store to be shifted.
+     * Currently unimplemented. TODO: Writeme!
+     */
+    ret = SETTINGS_STATUS_UNIMPLEMENTED;
   }
 
-  /* This case requires the settings store to be shifted.
-   * Currently unimplemented. TODO: Writeme!
-   */
-  ret = SETTINGS_STATUS_UNIMPLEMENTED;
-
   return ret;
 }
 
@@ -226,54 +246,108 @@ settings_iter_delete(settings_iter_t iter)
 // MARK: - Public Functions
 /*****************************************************************************/
 
+#if SETTINGS_CONF_INDEX_SIZE
 /*---------------------------------------------------------------------------*/
-uint8_t
-settings_check(settings_key_t key, uint8_t index)
+static void
+settings_index_build(void)
 {
-  uint8_t ret = 0;
-
   settings_iter_t iter;
 
+  settings_index_count = 0;
+  settings_index_state = SETTINGS_INDEX_VALID;
+
   for(iter = settings_iter_begin(); iter; iter = settings_iter_next(iter)) {
-    if(settings_iter_get_key(iter) == key) {
+    if(settings_index_count == SETTINGS_CONF_INDEX_SIZE) {
+      settings_index_state = SETTINGS_INDEX_OVERFLOW;
+      return;
+    }
+    settings_index[settings_index_count].key = settings_iter_get_key(iter);
+    settings_index[settings_index_count].iter = iter;
+    settings_index_count++;
+  }
+}
+
+/*---------------------------------------------------------------------------*/
+/**
+ * Looks up the item in the index.
+ *
+ * \retval 1 the index is usable, *iter is the item or EEPROM_NULL
+ * \retval 0 the store has to be scanned
+ */
+static uint8_t
+settings_index_find(settings_key_t key, uint8_t index, settings_iter_t *iter)
+{
+  uint8_t i;
+
+  if(settings_index_state == SETTINGS_INDEX_INVALID) {
+    settings_index_build();
+  }
+
+  if(settings_index_state != SETTINGS_INDEX_VALID) {
+    return 0;
+  }
+
+  *iter = EEPROM_NULL;
+  for(i = 0; i < settings_index_count; i++) {
+    if(settings_index[i].key == key) {
       if(!index) {
-        ret = 1;
+        *iter = settings_index[i].iter;
         break;
-      } else {
-        index--;
       }
+      index--;
     }
   }
 
-  return ret;
+  return 1;
 }
+#endif /* SETTINGS_CONF_INDEX_SIZE */
 
 /*---------------------------------------------------------------------------*/
-settings_status_t
-settings_get(settings_key_t key, uint8_t index, uint8_t *value,
-             settings_length_t value_size)
+/** Finds the item with the given key and index, EEPROM_NULL if missing. */
+static settings_iter_t
+settings_find(settings_key_t key, uint8_t index)
 {
-  settings_status_t ret = SETTINGS_STATUS_NOT_FOUND;
-
   settings_iter_t iter;
 
+#if SETTINGS_CONF_INDEX_SIZE
+  if(settings_index_find(key, index, &iter)) {
+    return iter;
+  }
+#endif
+
   for(iter = settings_iter_begin(); iter; iter = settings_iter_next(iter)) {
     if(settings_iter_get_key(iter) == key) {
       if(!index) {
-        /* We found it! */
-        value_size = settings_iter_get_value_bytes(iter,
-                                                    (void *)value,
-                                                    value_size);
-        ret = SETTINGS_STATUS_OK;
         break;
-      } else {
-        /* Nope, keep looking */
-        index--;
       }
+      index--;
     }
   }
 
-  return ret;
+  return iter;
+}
+
+/*---------------------------------------------------------------------------*/
+uint8_t
+settings_check(settings_key_t key, uint8_t index)
+{
+  return settings_find(key, index) != EEPROM_NULL;
+}
+
+/*---------------------------------------------------------------------------*/
+settings_status_t
+settings_get(settings_key_t key, uint8_t index, uint8_t *value,
+             settings_length_t value_size)
+{
+  settings_iter_t iter = settings_find(key, index);
+
+  if(!iter) {
+    return SETTINGS_STATUS_NOT_FOUND;
+  }
+
+  settings_iter_get_value_bytes(iter, (void *)value, value_size);
+
+  return SETTINGS_STATUS_OK;
 }
 
 /*---------------------------------------------------------------------------*/
@@ -287,10 +361,21 @@ settings_add(settings_key_t key, const uint8_t *value,
 
   item_header_t header;
 
-  /* Find the last item. */
-  for(iter = settings_iter_begin(); settings_iter_next(iter);
-      iter = settings_iter_next(iter)) {
-    /* This block intentionally left blank. */
+#if SETTINGS_CONF_INDEX_SIZE
+  if(settings_index_state == SETTINGS_INDEX_INVALID) {
+    settings_index_build();
+  }
+
+  if(settings_index_state == SETTINGS_INDEX_VALID) {
+    iter = settings_index_count ? settings_index[settings_index_count - 1].iter : 0;
+  } else
+#endif
+  {
+    /* Find the last item. */
+    for(iter = settings_iter_begin(); settings_iter_next(iter);
+        iter = settings_iter_next(iter)) {
+      /* This block intentionally left blank. */
+    }
   }
 
   if(iter) {
@@ -348,6 +433,18 @@ settings_add(settings_key_t key, const uint8_t *value,
   /* Now write the data */
   eeprom_write(settings_iter_get_value_addr(iter), (uint8_t *)value, value_size);
 
+#if SETTINGS_CONF_INDEX_SIZE
+  if(settings_index_state == SETTINGS_INDEX_VALID) {
+    if(settings_index_count < SETTINGS_CONF_INDEX_SIZE) {
+      settings_index[settings_index_count].key = key;
+      settings_index[settings_index_count].iter = iter;
+      settings_index_count++;
+    } else {
+      settings_index_state = SETTINGS_INDEX_OVERFLOW;
+    }
+  }
+#endif
+
   /* This should be the last item. If this is not the case,
    * then we need to clear out the phantom setting.
    */
@@ -370,13 +467,13 @@ settings_set(settings_key_t key, const uint8_t *value,
 {
   settings_status_t ret = SETTINGS_STATUS_FAILURE;
 
-  settings_iter_t iter;
+  settings_iter_t iter = settings_find(key, 0);
 
-  for(iter = settings_iter_begin(); iter; iter = settings_iter_next(iter)) {
-    if(settings_iter_get_key(iter) == key) {
-      break;
-    }
-  }
+  eeprom_addr_t addr;
+
+  settings_length_t i, len;
+
+  uint8_t old[16];
 
   if((iter == EEPROM_NULL) || !settings_iter_is_valid(iter)) {
     ret = settings_add(key, value, value_size);
@@ -389,9 +486,17 @@ settings_set(settings_key_t key, const uint8_t *value,
     goto bail;
   }
 
-  /* Now write the data */
-  eeprom_write(settings_iter_get_value_addr(iter),
-               (uint8_t *)value, value_size);
+  /* Now write the data. Unchanged parts are skipped to save EEPROM
+   * write cycles, as the same values are set again on every boot.
+   */
+  addr = settings_iter_get_value_addr(iter);
+  for(i = 0; i < value_size; i += len) {
+    len = MIN(value_size - i, sizeof(old));
+    eeprom_read(addr + i, old, len);
+    if(memcmp(old, value + i, len)) {
+      eeprom_write(addr + i, (uint8_t *)value + i, len);
+    }
+  }
 
   ret = SETTINGS_STATUS_OK;
 
@@ -405,19 +510,10 @@ settings_delete(settings_key_t key, uint8_t index)
 {
   settings_status_t ret = SETTINGS_STATUS_NOT_FOUND;
 
-  settings_iter_t iter;
+  settings_iter_t iter = settings_find(key, index);
 
-  for(iter = settings_iter_begin(); iter; iter = settings_iter_next(iter)) {
-    if(settings_iter_get_key(iter) == key) {
-      if(!index) {
-        /* We found it! */
-        ret = settings_iter_delete(iter);
-        break;
-      } else {
-        /* Nope, keep looking */
-        index--;
-      }
-    }
+  if(iter) {
+    ret = settings_iter_delete(iter);
   }
 
   return ret;
@@ -433,6 +529,10 @@ settings_wipe(void)
   const uint32_t x = 0x000000;
 
   eeprom_write(SETTINGS_TOP_ADDR - sizeof(x), (uint8_t *)&x, sizeof(x));
+
+#if SETTINGS_CONF_INDEX_SIZE
+  settings_index_state = SETTINGS_INDEX_INVALID;
+#endif
 }
 
 /*****************************************************************************/
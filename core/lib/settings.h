@@ -142,6 +142,14 @@ typedef uint16_t settings_length_t;
 #define SETTINGS_CONF_SUPPORT_LARGE_VALUES  0
 #endif
 
+/** Number of items kept in a RAM index, which is built by a single scan
+ *  of the EEPROM on first use. Lookups then do not have to walk the
+ *  store. With more items the store is scanned as before, 0 disables it.
+ */
+#ifndef SETTINGS_CONF_INDEX_SIZE
+#define SETTINGS_CONF_INDEX_SIZE  8
+#endif
+
 #if SETTINGS_CONF_SUPPORT_LARGE_VALUES
 #define SETTINGS_MAX_VALUE_SIZE    0x3FFF        /* 16383 bytes */
 #else
@@ -0,0 +1,242 @@
+/**
+ * \addtogroup trickle-group
+ * @{
+ */
+/**
+ * \file
+ *         Shared scheduler for many trickle instances
+ */
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "contiki-conf.h"
+#include "lib/trickle-group.h"
+#include "lib/random.h"
+/*---------------------------------------------------------------------------*/
+#define DEBUG 0
+
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+/*---------------------------------------------------------------------------*/
+#if TRICKLE_TIMER_WIDE_RAND
+#define tg_rand() ((uint32_t)random_rand() << 16 | random_rand())
+#else
+#define tg_rand() random_rand()
+#endif
+
+#define INTERVAL(g, key) \
+  ((g)->i_min << ((key)->state & TRICKLE_KEY_DOUBLINGS))
+
+static void run(void *ptr);
+/*---------------------------------------------------------------------------*/
+/* Ticks from now until when, 0 if when is in the past */
+static clock_time_t
+remaining(clock_time_t when, clock_time_t now)
+{
+  when -= now;
+  if(when > (TRICKLE_TIMER_CLOCK_MAX >> 1)) {
+    return 0;
+  }
+  return when;
+}
+/*---------------------------------------------------------------------------*/
+/* Starts a new interval at start, with a random t in [I/2, I) */
+static void
+new_interval(struct trickle_group *g, struct trickle_key *key,
+             clock_time_t start)
+{
+  clock_time_t half = INTERVAL(g, key) >> 1;
+
+  key->state &= TRICKLE_KEY_DOUBLINGS;
+  key->c = 0;
+  key->i_start = start;
+  key->next = start + half + (tg_rand() % half);
+}
+/*---------------------------------------------------------------------------*/
+/* Pulls the shared timer forward if the key is due before it */
+static void
+schedule_key(struct trickle_group *g, struct trickle_key *key)
+{
+  clock_time_t now = clock_time();
+  clock_time_t in = remaining(key->next, now);
+
+  if(ctimer_expired(&g->ct) ||
+     in < remaining(g->ct.etimer.timer.start + g->ct.etimer.timer.interval,
+                    now)) {
+    ctimer_set(&g->ct, in, run, g);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* The shared ctimer callback: handles all due keys and sets the timer to
+ * the earliest next deadline */
+static void
+run(void *ptr)
+{
+  struct trickle_group *g = ptr;
+  struct trickle_key *key;
+  clock_time_t now, in, min;
+  uint8_t i, pending;
+
+  now = clock_time();
+  for(i = 0; i < g->count; i++) {
+    key = &g->keys[i];
+    if(key->state == TRICKLE_KEY_STOPPED ||
+       remaining(key->next, now) != 0) {
+      continue;
+    }
+
+    if(!(key->state & TRICKLE_KEY_FIRED)) {
+      /* Time t, the interval ends at I */
+      key->state |= TRICKLE_KEY_FIRED;
+      key->next = key->i_start + INTERVAL(g, key);
+      PRINTF("trickle_group fire: key %u c=%u\n", i, key->c);
+      g->cb(g->cb_arg, i, g->k == TRICKLE_TIMER_INFINITE_REDUNDANCY ||
+            key->c < g->k);
+    } else {
+      /* End of the interval, double */
+      if((key->state & TRICKLE_KEY_DOUBLINGS) < g->i_max) {
+        key->state++;
+      }
+#if TRICKLE_TIMER_COMPENSATE_DRIFT
+      new_interval(g, key, key->next);
+#else
+      new_interval(g, key, now);
+#endif
+      PRINTF("trickle_group doubling: key %u I=%lu\n", i,
+             (unsigned long)INTERVAL(g, key));
+    }
+  }
+
+  /* The callbacks may have changed the timer, start over from the keys */
+  now = clock_time();
+  min = TRICKLE_TIMER_CLOCK_MAX;
+  pending = 0;
+  for(i = 0; i < g->count; i++) {
+    key = &g->keys[i];
+    if(key->state != TRICKLE_KEY_STOPPED) {
+      in = remaining(key->next, now);
+      if(in < min) {
+        min = in;
+      }
+      pending = 1;
+    }
+  }
+
+  if(pending) {
+    ctimer_set(&g->ct, min, run, g);
+  } else {
+    ctimer_stop(&g->ct);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+trickle_group_init(struct trickle_group *g, struct trickle_key *keys,
+                   uint8_t count, trickle_group_cb_t proto_cb, void *ptr)
+{
+  uint8_t i;
+
+  ctimer_stop(&g->ct);
+  g->keys = keys;
+  g->count = count;
+  g->cb = proto_cb;
+  g->cb_arg = ptr;
+  for(i = 0; i < count; i++) {
+    keys[i].state = TRICKLE_KEY_STOPPED;
+  }
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+trickle_group_config(struct trickle_group *g, clock_time_t i_min,
+                     uint8_t i_max, uint8_t k)
+{
+#if TRICKLE_TIMER_ERROR_CHECKING
+  if(TRICKLE_TIMER_IMIN_IS_BAD(i_min) || i_max == 0 || k == 0) {
+    PRINTF("trickle_group config: Bad arguments\n");
+    return TRICKLE_TIMER_ERROR;
+  }
+
+  while(i_max > 0 && TRICKLE_TIMER_IPAIR_IS_BAD(i_min, i_max)) {
+    i_max--;
+  }
+#endif
+
+  g->i_min = i_min;
+  g->i_max = i_max > TRICKLE_KEY_DOUBLINGS ? TRICKLE_KEY_DOUBLINGS : i_max;
+  g->k = k;
+
+  PRINTF("trickle_group config: Imin=%lu, Imax=%u, k=%u\n",
+         (unsigned long)g->i_min, g->i_max, g->k);
+
+  return TRICKLE_TIMER_SUCCESS;
+}
+/*---------------------------------------------------------------------------*/
+void
+trickle_group_set(struct trickle_group *g, uint8_t key)
+{
+  struct trickle_key *tk = &g->keys[key];
+
+  /* Random I among Imin, 2 * Imin, ..., Imax */
+  tk->state = random_rand() % (g->i_max + 1);
+  new_interval(g, tk, clock_time());
+  schedule_key(g, tk);
+}
+/*---------------------------------------------------------------------------*/
+void
+trickle_group_stop(struct trickle_group *g, uint8_t key)
+{
+  /* The shared timer may still run once for it, run() skips stopped keys */
+  g->keys[key].state = TRICKLE_KEY_STOPPED;
+}
+/*---------------------------------------------------------------------------*/
+void
+trickle_group_consistency(struct trickle_group *g, uint8_t key)
+{
+  if(g->keys[key].c < 0xFF) {
+    g->keys[key].c++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+trickle_group_inconsistency(struct trickle_group *g, uint8_t key)
+{
+  struct trickle_key *tk = &g->keys[key];
+
+  /* Nothing to do if I is Imin already, as for a single trickle timer */
+  if(tk->state != TRICKLE_KEY_STOPPED &&
+     (tk->state & TRICKLE_KEY_DOUBLINGS) != 0) {
+    tk->state = 0;
+    new_interval(g, tk, clock_time());
+    schedule_key(g, tk);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
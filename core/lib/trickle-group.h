@@ -0,0 +1,179 @@
+/** \addtogroup trickle-timer
+ * @{ */
+/**
+ * \defgroup trickle-group Shared trickle scheduler
+ *
+ * Runs many trickle instances ("keys") with a common configuration off a
+ * single \ref ctimer. This is meant for protocols that disseminate many
+ * items, e.g. one trickle instance per configuration value, where a
+ * struct ::trickle_timer per item would cost a ctimer and ~40 bytes of
+ * RAM each.
+ *
+ * The keys are kept in an array of struct ::trickle_key provided by the
+ * protocol and are addressed by their index. All keys of a group share
+ * Imin, Imax, k and the TX callback. The callback is called with the
+ * index of the key whose time t was reached.
+ *
+ * Unlike trickle_timer_set(), trickle_group_set() picks the initial
+ * interval among the doublings of Imin only.
+ *
+ * @{
+ */
+/**
+ * \file
+ *         Shared scheduler for many trickle instances
+ */
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#ifndef TRICKLE_GROUP_H_
+#define TRICKLE_GROUP_H_
+
+#include "contiki-conf.h"
+#include "sys/ctimer.h"
+#include "lib/trickle-timer.h"
+
+/**
+ * \brief Value of trickle_key::state of a stopped key
+ */
+#define TRICKLE_KEY_STOPPED     0xFF
+/**
+ * \brief Set in trickle_key::state once t was reached in this interval
+ */
+#define TRICKLE_KEY_FIRED       0x40
+/**
+ * \brief Mask of the number of doublings in trickle_key::state
+ */
+#define TRICKLE_KEY_DOUBLINGS   0x3F
+
+/**
+ * \brief Callback invoked at time t within the interval of a key
+ *
+ * \param ptr The opaque pointer passed to trickle_group_init()
+ * \param key The index of the key
+ * \param suppress TRICKLE_TIMER_TX_OK or TRICKLE_TIMER_TX_SUPPRESS
+ */
+typedef void (* trickle_group_cb_t)(void *ptr, uint8_t key, uint8_t suppress);
+
+/**
+ * \brief The state of one trickle instance of a group
+ *
+ * Protocol implementations must not modify its contents directly.
+ */
+struct trickle_key {
+  clock_time_t i_start; /**< Start of this interval (absolute clock_time) */
+  clock_time_t next;    /**< Time t, or the end of the interval once fired */
+  uint8_t state;        /**< Doublings of Imin, TRICKLE_KEY_FIRED flag */
+  uint8_t c;            /**< c: Consistency Counter */
+};
+
+/**
+ * \brief A group of trickle instances sharing one timer
+ */
+struct trickle_group {
+  struct ctimer ct;         /**< The shared \ref ctimer */
+  struct trickle_key *keys; /**< The protocol's array of keys */
+  trickle_group_cb_t cb;    /**< The protocol's TX callback */
+  void *cb_arg;             /**< Opaque argument of the callback */
+  clock_time_t i_min;       /**< Imin: Clock ticks */
+  uint8_t count;            /**< Number of keys */
+  uint8_t i_max;            /**< Imax: Max number of doublings */
+  uint8_t k;                /**< k: Redundancy Constant */
+};
+
+/**
+ * \brief           Initialize a group, all keys are stopped
+ * \param g         A pointer to a ::trickle_group structure
+ * \param keys      An array of \e count keys
+ * \param count     The number of keys
+ * \param proto_cb  Callback invoked at time t within the interval of a key
+ * \param ptr       An opaque pointer passed as the argument to proto_cb
+ */
+void trickle_group_init(struct trickle_group *g, struct trickle_key *keys,
+                        uint8_t count, trickle_group_cb_t proto_cb, void *ptr);
+
+/**
+ * \brief           Configure the trickle parameters of a group
+ * \param g         A pointer to a ::trickle_group structure
+ * \param i_min     Imin in units of clock_time_t
+ * \param i_max     Imax as number of doublings
+ * \param k         The redundancy constant, or
+ *                  #TRICKLE_TIMER_INFINITE_REDUNDANCY
+ * \retval 0        Error (Bad argument)
+ * \retval non-zero Success.
+ *
+ * As with trickle_timer_config(), Imax is adjusted down if Imin << Imax
+ * would exceed the boundaries of clock_time_t.
+ */
+uint8_t trickle_group_config(struct trickle_group *g, clock_time_t i_min,
+                             uint8_t i_max, uint8_t k);
+
+/**
+ * \brief     Start a key of a configured group
+ * \param g   A pointer to a ::trickle_group structure
+ * \param key The index of the key
+ */
+void trickle_group_set(struct trickle_group *g, uint8_t key);
+
+/**
+ * \brief     Stop a key
+ * \param g   A pointer to a ::trickle_group structure
+ * \param key The index of the key
+ */
+void trickle_group_stop(struct trickle_group *g, uint8_t key);
+
+/**
+ * \brief     To be called when the protocol hears a consistent transmission
+ *            for a key
+ * \param g   A pointer to a ::trickle_group structure
+ * \param key The index of the key
+ */
+void trickle_group_consistency(struct trickle_group *g, uint8_t key);
+
+/**
+ * \brief     To be called when the protocol hears an inconsistent
+ *            transmission for a key
+ * \param g   A pointer to a ::trickle_group structure
+ * \param key The index of the key
+ */
+void trickle_group_inconsistency(struct trickle_group *g, uint8_t key);
+
+/**
+ * \brief     To be called when an external event should reset a key
+ */
+#define trickle_group_reset_event(g, key) trickle_group_inconsistency(g, key)
+
+/**
+ * \brief     Checks whether a key is running
+ */
+#define trickle_group_is_running(g, key) \
+  ((g)->keys[key].state != TRICKLE_KEY_STOPPED)
+
+#endif /* TRICKLE_GROUP_H_ */
+/** @} */
+/** @} */
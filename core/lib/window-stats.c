@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \addtogroup window-stats
+ * @{
+ */
+
+/**
+ * \file
+ *      Windowed statistics and threshold triggers
+ */
+
+#include <string.h>
+
+#include "lib/window-stats.h"
+#include "lib/ifft.h"
+
+/*----------------------------------------------------------------------------*/
+static uint32_t
+isqrt(uint32_t x)
+{
+  uint32_t root = 0, bit = 1UL << 30;
+
+  while (bit > x) {
+    bit >>= 2;
+  }
+  while (bit != 0) {
+    if (x >= root + bit) {
+      x -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+
+  return root;
+}
+/*----------------------------------------------------------------------------*/
+void
+window_acc_reset(struct window_acc *acc)
+{
+  acc->min = INT16_MAX;
+  acc->max = INT16_MIN;
+  acc->sum = 0;
+  acc->sumsq = 0;
+  acc->count = 0;
+}
+/*----------------------------------------------------------------------------*/
+void
+window_acc_add(struct window_acc *acc, int16_t x)
+{
+  if (x < acc->min) {
+    acc->min = x;
+  }
+  if (x > acc->max) {
+    acc->max = x;
+  }
+  acc->sum += x;
+  /* 16x16 bit multiply, only the sum needs 64 bits */
+  acc->sumsq += (uint32_t) ((int32_t) x * x);
+  acc->count++;
+}
+/*----------------------------------------------------------------------------*/
+int16_t
+window_acc_mean(const struct window_acc *acc)
+{
+  if (acc->count == 0) {
+    return 0;
+  }
+  return acc->sum / (int32_t) acc->count;
+}
+/*----------------------------------------------------------------------------*/
+uint16_t
+window_acc_rms(const struct window_acc *acc)
+{
+  if (acc->count == 0) {
+    return 0;
+  }
+  /* The mean square of 16 bit samples fits into 32 bits */
+  return isqrt((uint32_t) (acc->sumsq / acc->count));
+}
+/*----------------------------------------------------------------------------*/
+void
+window_stats_init(struct window_stats *w, uint16_t length, int16_t *raw,
+                  window_stats_callback_t callback)
+{
+  window_acc_reset(&w->acc);
+  w->triggers = 0;
+  w->fired = 0;
+  w->length = length ? length : 1;
+  w->raw = raw;
+  w->callback = callback;
+}
+/*----------------------------------------------------------------------------*/
+int
+window_stats_add_trigger(struct window_stats *w, uint8_t source,
+                         uint8_t above, int16_t level)
+{
+  struct window_trigger *t;
+
+  if (w->triggers >= WINDOW_STATS_MAX_TRIGGERS) {
+    return -1;
+  }
+
+  t = &w->trigger[w->triggers];
+  t->source = source;
+  t->above = above;
+  t->level = level;
+
+  return w->triggers++;
+}
+/*----------------------------------------------------------------------------*/
+static uint8_t
+compare(const struct window_trigger *t, int32_t value)
+{
+  return t->above ? value > t->level : value < t->level;
+}
+/*----------------------------------------------------------------------------*/
+uint8_t
+window_stats_sample(struct window_stats *w, int16_t x)
+{
+  struct window_trigger *t;
+  int32_t value;
+  uint8_t i;
+
+  if (w->raw != NULL) {
+    w->raw[w->acc.count] = x;
+  }
+  window_acc_add(&w->acc, x);
+
+  for (i = 0; i < w->triggers; i++) {
+    t = &w->trigger[i];
+    if (t->source == WINDOW_TRIGGER_SAMPLE && compare(t, x)) {
+      w->fired |= 1 << i;
+    }
+  }
+
+  if (w->acc.count < w->length) {
+    return 0;
+  }
+
+  for (i = 0; i < w->triggers; i++) {
+    t = &w->trigger[i];
+    switch (t->source) {
+      case WINDOW_TRIGGER_MEAN:
+        value = window_acc_mean(&w->acc);
+        break;
+      case WINDOW_TRIGGER_RMS:
+        value = window_acc_rms(&w->acc);
+        break;
+      case WINDOW_TRIGGER_PEAK:
+        value = (int32_t) w->acc.max - w->acc.min;
+        break;
+      default:
+        continue;
+    }
+    if (compare(t, value)) {
+      w->fired |= 1 << i;
+    }
+  }
+
+  if (w->callback != NULL) {
+    w->callback(w, w->fired);
+  }
+
+  window_acc_reset(&w->acc);
+  w->fired = 0;
+
+  return 1;
+}
+/*----------------------------------------------------------------------------*/
+int
+window_stats_spectrum(const struct window_stats *w, int16_t *re,
+                      int16_t *im, uint16_t *bins, uint8_t nbins)
+{
+  uint16_t i, n = w->length, width;
+  int32_t peak, mag;
+  uint8_t shift = 0;
+
+  if (w->raw == NULL || nbins == 0 || (n / 2) % nbins != 0) {
+    return -1;
+  }
+
+  /* Scale the window into the 8 bit range ifft() is made for */
+  peak = 0;
+  for (i = 0; i < n; i++) {
+    mag = w->raw[i] < 0 ? -(int32_t) w->raw[i] : w->raw[i];
+    if (mag > peak) {
+      peak = mag;
+    }
+  }
+  while ((peak >> shift) > 127) {
+    shift++;
+  }
+  for (i = 0; i < n; i++) {
+    re[i] = w->raw[i] >> shift;
+  }
+
+  ifft(re, im, n);
+
+  width = (n / 2) / nbins;
+  memset(bins, 0, nbins * sizeof(bins[0]));
+  for (i = 0; i < n / 2; i++) {
+    bins[i / width] += re[i];
+  }
+
+  return 0;
+}
+/*----------------------------------------------------------------------------*/
+
+/** @} */
@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/** \addtogroup lib
+ * @{ */
+
+/**
+ * \defgroup window-stats Windowed statistics and triggers on sensor streams
+ * @{
+ *
+ * Computes min, max, mean and RMS of fixed length windows of a sample
+ * stream incrementally, so only the running sums are kept in RAM. Triggers
+ * compare single samples or the finished window against a level. A
+ * callback gets the summary at the end of every window, and the raw window
+ * if the caller supplied a buffer for it, so an application can send
+ * summaries and only the raw data of windows that fired a trigger.
+ *
+ * window_stats_spectrum() reduces the raw window to a few spectral bins
+ * with ifft().
+ *
+ * The library is not part of the default build, add window-stats.c to
+ * PROJECT_SOURCEFILES.
+ */
+
+/**
+ * \file
+ *      Windowed statistics and threshold triggers
+ */
+
+#ifndef WINDOW_STATS_H_
+#define WINDOW_STATS_H_
+
+#include "contiki-conf.h"
+
+/** Maximum number of triggers per window. */
+#ifndef WINDOW_STATS_CONF_MAX_TRIGGERS
+#define WINDOW_STATS_CONF_MAX_TRIGGERS 4
+#endif
+#define WINDOW_STATS_MAX_TRIGGERS WINDOW_STATS_CONF_MAX_TRIGGERS
+
+/** Running sums of one window. */
+struct window_acc {
+  int16_t min;
+  int16_t max;
+  int32_t sum;
+  /** Sum of squares, 64 bit so long windows of 16 bit samples fit */
+  uint64_t sumsq;
+  uint16_t count;
+};
+
+/**
+ * \name Trigger sources
+ * @{
+ */
+/** Every sample is compared */
+#define WINDOW_TRIGGER_SAMPLE 0
+/** The mean of the finished window is compared */
+#define WINDOW_TRIGGER_MEAN   1
+/** The RMS of the finished window is compared */
+#define WINDOW_TRIGGER_RMS    2
+/** The peak to peak value (max - min) of the finished window is compared */
+#define WINDOW_TRIGGER_PEAK   3
+/** @} */
+
+struct window_trigger {
+  uint8_t source;
+  /** Fire if the value is above the level, otherwise if it is below */
+  uint8_t above;
+  int16_t level;
+};
+
+struct window_stats;
+
+/**
+ * Called at the end of every window.
+ *
+ * \param w The window, w->acc holds the summary and w->raw the samples
+ * \param fired Bit i is set if trigger i fired in this window
+ */
+typedef void (*window_stats_callback_t)(struct window_stats *w, uint8_t fired);
+
+/** State of a windowed statistics engine. */
+struct window_stats {
+  struct window_acc acc;
+  struct window_trigger trigger[WINDOW_STATS_MAX_TRIGGERS];
+  uint8_t triggers;
+  /** Triggers fired in the current window */
+  uint8_t fired;
+  /** Samples per window */
+  uint16_t length;
+  /** Optional buffer of length samples for the raw window, or NULL */
+  int16_t *raw;
+  window_stats_callback_t callback;
+};
+
+/**
+ * Clears the accumulator.
+ */
+void window_acc_reset(struct window_acc *acc);
+
+/**
+ * Adds one sample to the accumulator.
+ */
+void window_acc_add(struct window_acc *acc, int16_t x);
+
+/**
+ * \return Mean of the samples added, 0 if there are none
+ */
+int16_t window_acc_mean(const struct window_acc *acc);
+
+/**
+ * \return Root mean square of the samples added, 0 if there are none
+ */
+uint16_t window_acc_rms(const struct window_acc *acc);
+
+/**
+ * Initializes a windowed statistics engine without triggers.
+ *
+ * \param w The engine
+ * \param length Samples per window, at least 1
+ * \param raw Buffer for length samples, or NULL if raw windows are not needed
+ * \param callback Called at the end of every window, may be NULL
+ */
+void window_stats_init(struct window_stats *w, uint16_t length, int16_t *raw,
+                       window_stats_callback_t callback);
+
+/**
+ * Adds a trigger.
+ *
+ * \param w The engine
+ * \param source One of the WINDOW_TRIGGER_ sources
+ * \param above Non-zero to fire above the level, zero to fire below it
+ * \param level The level
+ * \return Index of the trigger, which is its bit in the fired mask,
+ * -1 if all WINDOW_STATS_MAX_TRIGGERS are used
+ */
+int window_stats_add_trigger(struct window_stats *w, uint8_t source,
+                             uint8_t above, int16_t level);
+
+/**
+ * Adds one sample. The callback is called from here when the window is
+ * complete, so this has to run in the context the callback expects.
+ *
+ * \param w The engine
+ * \param x The sample
+ * \return 1 if this sample completed a window, else 0
+ */
+uint8_t window_stats_sample(struct window_stats *w, int16_t x);
+
+/**
+ * Reduces the raw window to spectral bins, for use from the callback.
+ * The window length must be a power of two. The samples are scaled to the
+ * 8 bit range ifft() is made for and transformed in re and im, so raw is
+ * left unchanged. The n / 2 magnitudes are summed into nbins equal bins.
+ *
+ * \param w The engine, with a raw buffer
+ * \param re Scratch buffer of length samples
+ * \param im Scratch buffer of length samples
+ * \param bins Receives nbins sums, bin 0 contains the DC part
+ * \param nbins Number of bins, a divisor of length / 2
+ * \return 0 on success, -1 if there is no raw window or nbins does not fit
+ */
+int window_stats_spectrum(const struct window_stats *w, int16_t *re,
+                          int16_t *im, uint16_t *bins, uint8_t nbins);
+
+#endif /* WINDOW_STATS_H_ */
+
+/** @} */
+/** @} */
@@ -0,0 +1,311 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Loader for compact modules made by tools/avr-make-celf.
+ */
+
+#include <string.h>
+#include <avr/boot.h>
+#include <avr/pgmspace.h>
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "lib/crc16.h"
+#include "loader/celfloader.h"
+#include "loader/elfloader-arch.h"
+#include "loader/symbols.h"
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(FORMAT,args...) printf_P(PSTR(FORMAT),##args)
+#else
+#define PRINTF(...)
+#endif
+
+/* Relocations are read in chunks of this many entries. */
+#ifdef CELFLOADER_CONF_RELOC_BUFFER
+#define RELOC_BUFFER CELFLOADER_CONF_RELOC_BUFFER
+#else
+#define RELOC_BUFFER 8
+#endif
+
+/* An instruction that a relocation patches may reach this far into
+   the next page. */
+#define PAGE_OVERLAP 4
+
+static struct celf_reloc relocs[RELOC_BUFFER];
+static uint16_t reloc_pos, reloc_len, reloc_left;
+static cfs_offset_t reloc_offset;
+
+static char *rom, *data, *bss;
+
+/*---------------------------------------------------------------------------*/
+static int
+read_at(int fd, cfs_offset_t offset, void *buf, int len)
+{
+  if(len == 0) {
+    return 0;
+  }
+  if(cfs_seek(fd, offset, CFS_SEEK_SET) != offset ||
+     cfs_read(fd, buf, len) != len) {
+    return -1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static struct celf_reloc *
+next_reloc(int fd)
+{
+  int n;
+
+  if(reloc_pos == reloc_len) {
+    if(reloc_left == 0) {
+      return NULL;
+    }
+    n = reloc_left > RELOC_BUFFER ? RELOC_BUFFER : reloc_left;
+    if(read_at(fd, reloc_offset, relocs, n * sizeof(relocs[0])) < 0) {
+      reloc_left = 0;
+      return NULL;
+    }
+    reloc_offset += n * sizeof(relocs[0]);
+    reloc_left -= n;
+    reloc_len = n;
+    reloc_pos = 0;
+  }
+  return &relocs[reloc_pos];
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+symbols_crc(void)
+{
+  static uint8_t computed;
+  static uint16_t crc;
+  const char *name;
+  char c;
+  int i;
+
+  if(!computed) {
+    for(i = 0; i < symbols_nelts; i++) {
+      name = (const char *)pgm_read_word(&symbols[i].name);
+      do {
+	c = pgm_read_byte(name++);
+	crc = crc16_add(c, crc);
+      } while(c != 0);
+    }
+    computed = 1;
+  }
+  return crc;
+}
+/*---------------------------------------------------------------------------*/
+static char *
+address(uint8_t target, uint16_t value)
+{
+  switch(target) {
+  case CELF_TARGET_SYMBOL:
+    if(value >= symbols_nelts) {
+      return NULL;
+    }
+    return (char *)pgm_read_word(&symbols[value].value);
+  case CELF_TARGET_ROM:
+    return rom + value;
+  case CELF_TARGET_DATA:
+    return data + value;
+  case CELF_TARGET_BSS:
+    return bss + value;
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static int
+relocate(const struct celf_reloc *r, unsigned char *instr)
+{
+  struct elf32_rela rela;
+  char *addr;
+
+  addr = address(r->target, r->value);
+  if(addr == NULL) {
+    PRINTF("celfloader: bad target %d:%u\n", r->target, r->value);
+    return ELFLOADER_SEGMENT_NOT_FOUND;
+  }
+
+  rela.r_offset = r->offset;
+  rela.r_info = r->type;
+  rela.r_addend = r->addend;
+  elfloader_arch_patch(instr, &rela, addr);
+
+  return ELFLOADER_OK;
+}
+/*---------------------------------------------------------------------------*/
+static int
+load_rom(int fd, const struct celf_header *h)
+{
+  /* The page, followed by the start of the next one. */
+  unsigned char page[SPM_PAGESIZE + PAGE_OVERLAP];
+  struct celf_reloc *r;
+  uint16_t offset, relnum;
+  int len, ret;
+
+  memset(&page[SPM_PAGESIZE], 0, PAGE_OVERLAP);
+  len = h->romsize < PAGE_OVERLAP ? h->romsize : PAGE_OVERLAP;
+  if(read_at(fd, sizeof(*h), &page[SPM_PAGESIZE], len) < 0) {
+    return ELFLOADER_BAD_ELF_HEADER;
+  }
+
+  relnum = h->romrelnum;
+  for(offset = 0; offset < h->romsize; offset += SPM_PAGESIZE) {
+    memcpy(page, &page[SPM_PAGESIZE], PAGE_OVERLAP);
+    memset(&page[PAGE_OVERLAP], 0, SPM_PAGESIZE);
+    if(offset + PAGE_OVERLAP < h->romsize) {
+      len = h->romsize - offset - PAGE_OVERLAP;
+      if(len > SPM_PAGESIZE) {
+	len = SPM_PAGESIZE;
+      }
+      if(read_at(fd, sizeof(*h) + offset + PAGE_OVERLAP,
+		 &page[PAGE_OVERLAP], len) < 0) {
+	return ELFLOADER_BAD_ELF_HEADER;
+      }
+    }
+
+    for(; relnum > 0; relnum--, reloc_pos++) {
+      r = next_reloc(fd);
+      if(r == NULL || r->offset < offset) {
+	return ELFLOADER_BAD_ELF_HEADER;
+      }
+      if(r->offset >= offset + SPM_PAGESIZE) {
+	break;
+      }
+      ret = relocate(r, &page[r->offset - offset]);
+      if(ret != ELFLOADER_OK) {
+	return ret;
+      }
+    }
+
+    elfloader_arch_write_page(rom + offset, page);
+  }
+
+  return relnum == 0 ? ELFLOADER_OK : ELFLOADER_BAD_ELF_HEADER;
+}
+/*---------------------------------------------------------------------------*/
+static int
+load_data(int fd, const struct celf_header *h)
+{
+  unsigned char instr[4];
+  struct celf_reloc *r;
+  uint16_t relnum;
+  int len, ret;
+
+  if(read_at(fd, sizeof(*h) + h->romsize, data, h->datasize) < 0) {
+    return ELFLOADER_BAD_ELF_HEADER;
+  }
+
+  for(relnum = h->datarelnum; relnum > 0; relnum--, reloc_pos++) {
+    r = next_reloc(fd);
+    if(r == NULL || r->offset >= h->datasize) {
+      return ELFLOADER_BAD_ELF_HEADER;
+    }
+
+    /* Patch a copy, so that nothing is written past .data. */
+    len = h->datasize - r->offset;
+    if(len > sizeof(instr)) {
+      len = sizeof(instr);
+    }
+    memset(instr, 0, sizeof(instr));
+    memcpy(instr, &data[r->offset], len);
+    ret = relocate(r, instr);
+    if(ret != ELFLOADER_OK) {
+      return ret;
+    }
+    memcpy(&data[r->offset], instr, len);
+  }
+
+  memset(bss, 0, h->bsssize);
+  return ELFLOADER_OK;
+}
+/*---------------------------------------------------------------------------*/
+int
+celfloader_load(int fd)
+{
+  struct celf_header h;
+  int ret;
+
+  elfloader_unknown[0] = 0;
+
+  if(read_at(fd, 0, &h, sizeof(h)) < 0 ||
+     memcmp(h.magic, CELF_MAGIC, sizeof(h.magic)) != 0 ||
+     h.version != CELF_VERSION) {
+    PRINTF("celfloader: bad header\n");
+    return ELFLOADER_BAD_ELF_HEADER;
+  }
+
+  if(h.symbols_nelts != symbols_nelts || h.symbols_crc != symbols_crc()) {
+    PRINTF("celfloader: made for another firmware\n");
+    return CELFLOADER_WRONG_FIRMWARE;
+  }
+
+  /* The same layout as elfloader_load() uses. */
+  bss = (char *)elfloader_arch_allocate_ram(h.bsssize + h.datasize);
+  if(bss == NULL && h.bsssize + h.datasize > 0) {
+    return CELFLOADER_NO_MEMORY;
+  }
+  data = bss + h.bsssize;
+  rom = (char *)elfloader_arch_allocate_rom(h.romsize);
+
+  reloc_offset = sizeof(h) + h.romsize + h.datasize;
+  reloc_left = h.romrelnum + h.datarelnum;
+  reloc_pos = reloc_len = 0;
+
+  PRINTF("celfloader: rom %u data %u bss %u\n",
+	 h.romsize, h.datasize, h.bsssize);
+
+  ret = load_rom(fd, &h);
+  if(ret != ELFLOADER_OK) {
+    return ret;
+  }
+  ret = load_data(fd, &h);
+  if(ret != ELFLOADER_OK) {
+    return ret;
+  }
+
+  elfloader_autostart_processes = NULL;
+  if(h.autostart_target != CELF_TARGET_SYMBOL) {
+    elfloader_autostart_processes = (struct process * const *)
+      address(h.autostart_target, h.autostart_value);
+  }
+  if(elfloader_autostart_processes == NULL) {
+    return ELFLOADER_NO_STARTPOINT;
+  }
+  return ELFLOADER_OK;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,127 @@
+/**
+ * \addtogroup elfloader
+ * @{
+ */
+
+/**
+ * \file
+ *         Header file for the compact module loader.
+ *
+ *         Compact modules are ELF modules that tools/avr-make-celf has
+ *         linked against the symbol table (symbols.c) of the firmware
+ *         that will load them. Names are replaced by indices into
+ *         symbols[], and the relocations of each segment are sorted by
+ *         offset, so that the loader can patch and flash one page at a
+ *         time while it reads the file sequentially.
+ *
+ *         All numbers are little-endian. A module holds, in order:
+ *
+ *         struct celf_header
+ *         ROM image: .text followed by .rodata (romsize bytes)
+ *         .data (datasize bytes)
+ *         romrelnum struct celf_reloc, sorted by offset into the ROM image
+ *         datarelnum struct celf_reloc, sorted by offset into .data
+ */
+
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+#ifndef CELFLOADER_H_
+#define CELFLOADER_H_
+
+#include "loader/elfloader.h"
+
+#define CELF_MAGIC   "CELF"
+#define CELF_VERSION 1
+
+/* What struct celf_reloc.value refers to. */
+#define CELF_TARGET_SYMBOL 0	/* An index into the firmware's symbols[]. */
+#define CELF_TARGET_ROM    1	/* An offset into the ROM image. */
+#define CELF_TARGET_DATA   2	/* An offset into .data. */
+#define CELF_TARGET_BSS    3	/* An offset into .bss. */
+#define CELF_TARGET_NONE   0xff
+
+struct celf_header {
+  uint8_t magic[4];
+  uint8_t version;
+  uint8_t autostart_target;	/* Where autostart_processes is. */
+  uint16_t autostart_value;
+  uint16_t symbols_nelts;	/* The firmware the module was made for. */
+  uint16_t symbols_crc;		/* CRC16 of all names, with their NULs. */
+  uint16_t romsize;
+  uint16_t datasize;
+  uint16_t bsssize;
+  uint16_t romrelnum;
+  uint16_t datarelnum;
+};
+
+struct celf_reloc {
+  uint16_t offset;
+  uint8_t type;			/* The ELF relocation type. */
+  uint8_t target;
+  uint16_t value;
+  int16_t addend;
+};
+
+/**
+ * Return value from celfloader_load() indicating that the module was
+ * made for a different firmware.
+ */
+#define CELFLOADER_WRONG_FIRMWARE     8
+
+/**
+ * Return value from celfloader_load() indicating that there was no
+ * RAM for the module.
+ */
+#define CELFLOADER_NO_MEMORY          9
+
+/**
+ * \brief      Load and relocate a compact module.
+ * \param fd   An open CFS file descriptor.
+ * \return     ELFLOADER_OK if loading and relocation worked.
+ *             Otherwise an ELFLOADER_ or CELFLOADER_ error value.
+ *
+ *             The loaded processes are stored in
+ *             elfloader_autostart_processes, as with elfloader_load().
+ *             Unlike elfloader_load(), this function does not modify
+ *             the file.
+ */
+int celfloader_load(int fd);
+
+/* Implemented by the architecture, in elfloader-avr.c. */
+int elfloader_arch_patch(unsigned char *instr, const struct elf32_rela *rela,
+			 char *addr);
+void elfloader_arch_write_page(char *mem, const unsigned char *buf);
+
+#endif /* CELFLOADER_H_ */
+
+/** @} */
@@ -35,6 +35,7 @@
 #include <avr/pgmspace.h>
 #include <avr/interrupt.h>
 #include "elfloader-arch.h"
+#include "loader/celfloader.h"
 #include "lib/mmem.h"
 #include <string.h> //memset
 
@@ -87,16 +88,6 @@ elfloader_arch_allocate_ram(int size)
   return (char*)MMEM_PTR(&module_heap);
 }
 
-/*---------------------------------------------------------------------------*/
-/* TODO: Currently, modules are written to the fixed address 0x10000. Since
- *        flash rom uses word addresses on the AVR, we return 0x8000 here
- */
-void*
-elfloader_arch_allocate_rom(int size)
-{
-  return (void *)0x8000;
-}
-
 /*---------------------------------------------------------------------------*/
 /* Eliminate compiler warnings for (non-functional) code when flash requires 32 bit addresses and pointers are 16 bit */
 #define INCLUDE_APPLICATE_SOURCE 1
@@ -109,82 +100,122 @@ elfloader_arch_allocate_rom(int size)
 #define INCLUDE_32BIT_CODE 1
 #endif
 #endif
+
+#if INCLUDE_APPLICATE_SOURCE
+/* The flash page collected in RAM by elfloader_arch_write_rom(). It is
+ * kept after writing, so rodata following text within the same page is
+ * merged instead of erasing the end of the text. */
+static unsigned char page_buf[SPM_PAGESIZE];
+static char *page_addr;
+#endif
+/*---------------------------------------------------------------------------*/
+/* TODO: Currently, modules are written to the fixed address 0x10000. Since
+ *        flash rom uses word addresses on the AVR, we return 0x8000 here
+ */
+void*
+elfloader_arch_allocate_rom(int size)
+{
+#if INCLUDE_APPLICATE_SOURCE
+  page_addr = NULL;
+#endif
+  return (void *)0x8000;
+}
+
+/*---------------------------------------------------------------------------*/
 #if INCLUDE_APPLICATE_SOURCE
 
+/* Interrupts are disabled only while the RWW section is busy with the
+ * erase and the write, since the interrupt handlers are located there.
+ * The page buffer is filled with interrupts enabled, only the timed SPM
+ * sequence of each word is protected.
+ */
 BOOTLOADER_SECTION void
-elfloader_arch_write_rom(int fd, unsigned short textoff, unsigned int size, char *mem)
+elfloader_arch_write_page(char *mem, const unsigned char *buf)
 {
-    unsigned char   buf[SPM_PAGESIZE];
     unsigned short* flashptr = (unsigned short *) mem;
+    uint8_t sreg;
+    int i;
+
+    // Erase flash page and reenable the RWW section for the handlers
+    sreg = SREG;
+    cli ();
+    boot_page_erase (flashptr);
+    boot_spm_busy_wait ();
+    boot_rww_enable ();
+    boot_spm_busy_wait ();
+    SREG = sreg;
+
+    // Store data into page buffer
+    for(i = 0; i < SPM_PAGESIZE; i+=2) {
+	sreg = SREG;
+	cli ();
+	boot_page_fill (flashptr, (uint16_t)((buf[i+1] << 8) | buf[i]));
+	SREG = sreg;
+	++flashptr;
+    }
 
+    // Burn page and reenable RWW section
+    sreg = SREG;
+    cli ();
+    boot_page_write ((unsigned short *) mem);
+    boot_spm_busy_wait();
+    boot_rww_enable ();
+    boot_spm_busy_wait ();
+
+    // Restore original interrupt settings
+    SREG = sreg;
+}
+
+BOOTLOADER_SECTION void
+elfloader_arch_write_rom(int fd, unsigned short textoff, unsigned int size, char *mem)
+{
+    char *pageptr;
+    unsigned int offset, len;
 
     // Sanity-check size of loadable module
     if (size <= 0)
 	return;
 
-  
-    // Seek to patched module and burn it to flash (in chunks of
-    // size SPM_PAGESIZE, i.e. 256 bytes on the ATmega128)
+    // Seek to patched module and collect it page by page (SPM_PAGESIZE,
+    // i.e. 256 bytes on the ATmega128) in RAM, each page is burned once
+    // it is complete or the section ends
     cfs_seek(fd, textoff, CFS_SEEK_SET);
-    for (flashptr=(unsigned short *)mem; flashptr < (unsigned short *) mem + size; flashptr += SPM_PAGESIZE) {
-	memset (buf, 0, SPM_PAGESIZE);
-	cfs_read(fd, buf, SPM_PAGESIZE);
+    while (size > 0) {
+	pageptr = (char *) ((unsigned int) mem & ~(SPM_PAGESIZE - 1));
+	if (pageptr != page_addr) {
+	    memset (page_buf, 0, SPM_PAGESIZE);
+	    page_addr = pageptr;
+	}
 
-	// Disable interrupts
-	uint8_t sreg;
-	sreg = SREG;
-	cli ();
-  
-	// Erase flash page
-	boot_page_erase (flashptr);
-	boot_spm_busy_wait ();
-	
-	unsigned short *origptr =  flashptr;
-
-	int i;	
-	// Store data into page buffer
-	for(i = 0; i < SPM_PAGESIZE; i+=2) {
-	    boot_page_fill (flashptr, (uint16_t)((buf[i+1] << 8) | buf[i]));
-	    PORTB = 0xff - 7;
-	    ++flashptr;
+	offset = mem - pageptr;
+	len = SPM_PAGESIZE - offset;
+	if (len > size) {
+	    len = size;
 	}
-	
-	// Burn page
-	boot_page_write (origptr);
-	boot_spm_busy_wait();
-	
-	// Reenable RWW sectin
-	boot_rww_enable ();
-	boot_spm_busy_wait ();	
-
-	// Restore original interrupt settings
-	SREG = sreg;
+	cfs_read(fd, &page_buf[offset], len);
+	mem += len;
+	size -= len;
+
+	elfloader_arch_write_page(pageptr, page_buf);
     }
 }
 #endif /* INCLUDE_APPLICATE_SOURCE */
 
 /*---------------------------------------------------------------------------*/
-static void
-write_ldi(int fd, unsigned char *instr, unsigned char byte)
+static int
+write_ldi(unsigned char *instr, unsigned char byte)
 {
   instr[0] = (instr[0] & 0xf0) | (byte & 0x0f);
   instr[1] = (instr[1] & 0xf0) | (byte >> 4);
-  cfs_write (fd, instr, 2);
+  return 2;
 }
 /*---------------------------------------------------------------------------*/
-void
-elfloader_arch_relocate(int fd, unsigned int sectionoffset,
-	//			struct elf32_rela *rela, elf32_addr addr)
-			char *sectionaddr,
-			struct elf32_rela *rela, char *addr)
+int
+elfloader_arch_patch(unsigned char *instr, const struct elf32_rela *rela,
+		     char *addr)
 {
   unsigned int type;
-  unsigned char instr[4];
 
-  cfs_seek(fd, sectionoffset + rela->r_offset, CFS_SEEK_SET);
-  cfs_read(fd, instr, 4);
-  cfs_seek(fd, sectionoffset + rela->r_offset, CFS_SEEK_SET);
-  
   type = ELF32_R_TYPE(rela->r_info);
 
   addr += rela->r_addend;
@@ -205,9 +236,8 @@ elfloader_arch_relocate(int fd, unsigned int sectionoffset,
     int16_t a = (((int)addr - rela->r_offset -2) / 2);
     instr[0] |= (a << 3) & 0xf8;
     instr[1] |= (a >> 5) & 0x03;
-    cfs_write(fd, instr, 2);
+    return 2;
   }
-    break;
   case R_AVR_13_PCREL: { /* 3 */
     /*
      * Relocation is relative to PC. -2: RJMP adds 2 to PC.
@@ -218,81 +248,66 @@ elfloader_arch_relocate(int fd, unsigned int sectionoffset,
     a--;
     instr[0] |= a & 0xff;
     instr[1] |= (a >> 8) & 0x0f;
-    cfs_write(fd, instr, 2);
+    return 2;
   }
-    break;
 
   case R_AVR_16:    /* 4 */
     instr[0] = (int)addr  & 0xff;
     instr[1] = ((int)addr >> 8) & 0xff;
 
-    cfs_write(fd, instr, 2);
-    break;
+    return 2;
 
   case R_AVR_16_PM: /* 5 */
     addr = (char *)((int)addr >> 1);
     instr[0] = (int)addr  & 0xff;
     instr[1] = ((int)addr >> 8) & 0xff;
 
-    cfs_write(fd, instr, 2);
-    break;
+    return 2;
 
   case R_AVR_LO8_LDI: /* 6 */
-    write_ldi(fd, instr, (int)addr);
-    break;
+    return write_ldi(instr, (int)addr);
   case R_AVR_HI8_LDI: /* 7 */
-    write_ldi(fd, instr, (int)addr >> 8);
-    break;
+    return write_ldi(instr, (int)addr >> 8);
 
 #if INCLUDE_32BIT_CODE       /* 32 bit AVRs */
   case R_AVR_HH8_LDI: /* 8 */
-    write_ldi(fd, instr, (int)addr >> 16);
-    break;
+    return write_ldi(instr, (int)addr >> 16);
 #endif
 
   case R_AVR_LO8_LDI_NEG: /* 9 */
     addr = (char *) (0 - (int)addr);
-    write_ldi(fd, instr, (int)addr);
-    break;
+    return write_ldi(instr, (int)addr);
   case R_AVR_HI8_LDI_NEG: /* 10 */
     addr = (char *) (0 - (int)addr);
-    write_ldi(fd, instr, (int)addr >> 8);
-    break;
+    return write_ldi(instr, (int)addr >> 8);
     
 #if INCLUDE_32BIT_CODE         /* 32 bit AVRs */
   case R_AVR_HH8_LDI_NEG: /* 11 */
     addr = (char *)(0 - (int)addr);
-    write_ldi(fd, instr, (int)addr >> 16);
-    break;
+    return write_ldi(instr, (int)addr >> 16);
 #endif
 
   case R_AVR_LO8_LDI_PM: /* 12 */
-    write_ldi(fd, instr, (int)addr >> 1);
-    break;
+    return write_ldi(instr, (int)addr >> 1);
   case R_AVR_HI8_LDI_PM: /* 13 */
-    write_ldi(fd, instr, (int)addr >> 9);
-    break;
+    return write_ldi(instr, (int)addr >> 9);
 
 #if INCLUDE_32BIT_CODE         /* 32 bit AVRs */
   case R_AVR_HH8_LDI_PM: /* 14 */
-    write_ldi(fd, instr, (int)addr >> 17);
-    break;
+    return write_ldi(instr, (int)addr >> 17);
 #endif
 
   case R_AVR_LO8_LDI_PM_NEG: /* 15 */
     addr = (char *) (0 - (int)addr);
-    write_ldi(fd, instr, (int)addr >> 1);
-    break;
+    return write_ldi(instr, (int)addr >> 1);
   case R_AVR_HI8_LDI_PM_NEG: /* 16 */
     addr = (char *) (0 - (int)addr);
-    write_ldi(fd, instr, (int)addr >> 9);
-    break;
+    return write_ldi(instr, (int)addr >> 9);
     
 #if INCLUDE_32BIT_CODE         /* 32 bit AVRs */
   case R_AVR_HH8_LDI_PM_NEG: /* 17 */
     addr = (char *) (0 - (int)addr);
-    write_ldi(fd, instr, (int)addr >> 17);
-    break;
+    return write_ldi(instr, (int)addr >> 17);
 #endif
 
   case R_AVR_CALL: /* 18 */
@@ -305,13 +320,31 @@ elfloader_arch_relocate(int fd, unsigned int sectionoffset,
 	/* new solution */
     instr[2] = (uint8_t) ((int)addr) & 0xff;
     instr[3] = ((int)addr) >> 8;
-    cfs_write(fd, instr, 4);
-    break;
+    return 4;
 
   default:
     PRINTF(PSTR ("Unknown relocation type!\n"));
     break;
   }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+elfloader_arch_relocate(int fd, unsigned int sectionoffset,
+			char *sectionaddr,
+			struct elf32_rela *rela, char *addr)
+{
+  unsigned char instr[4];
+  int n;
+
+  cfs_seek(fd, sectionoffset + rela->r_offset, CFS_SEEK_SET);
+  cfs_read(fd, instr, 4);
+
+  n = elfloader_arch_patch(instr, rela, addr);
+  if(n > 0) {
+    cfs_seek(fd, sectionoffset + rela->r_offset, CFS_SEEK_SET);
+    cfs_write(fd, instr, n);
+  }
 }
 /*---------------------------------------------------------------------------*/
 void
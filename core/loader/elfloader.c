@@ -125,6 +125,20 @@ struct elf32_sym {
 #define ELF32_R_SYM(info)       ((info) >> 8)
 #define ELF32_R_TYPE(info)      ((unsigned char)(info))
 
+/* Relocations and symbols are read through small buffers, so that the
+   file system sees a few block reads instead of one read per entry. */
+#ifdef ELFLOADER_CONF_READ_BUFFER_SIZE
+#define READ_BUFFER_SIZE ELFLOADER_CONF_READ_BUFFER_SIZE
+#else
+#define READ_BUFFER_SIZE 64
+#endif
+
+struct read_buffer {
+  unsigned int offset;
+  int len;
+  char data[READ_BUFFER_SIZE];
+};
+
 struct relevant_section {
   unsigned char number;
   unsigned int offset;
@@ -137,6 +151,8 @@ struct process * const * elfloader_autostart_processes;
 
 static struct relevant_section bss, data, rodata, text;
 
+static struct read_buffer relbuf, symbuf, strbuf;
+
 static const unsigned char elf_magic_header[] =
   {0x7f, 0x45, 0x4c, 0x46,  /* 0x7f, 'E', 'L', 'F' */
    0x01,                    /* Only 32-bit objects. */
@@ -163,6 +179,51 @@ seek_read(int fd, unsigned int offset, char *buf, int len)
 #endif /* DEBUG */
 }
 /*---------------------------------------------------------------------------*/
+static void
+buffered_read(int fd, struct read_buffer *b,
+	      unsigned int offset, char *buf, int len)
+{
+  int n;
+
+  if(len > READ_BUFFER_SIZE) {
+    seek_read(fd, offset, buf, len);
+    return;
+  }
+
+  if(b->len <= 0 || offset < b->offset ||
+     offset + len > b->offset + b->len) {
+    cfs_seek(fd, offset, CFS_SEEK_SET);
+    b->offset = offset;
+    b->len = cfs_read(fd, b->data, READ_BUFFER_SIZE);
+    if(b->len < 0) {
+      b->len = 0;
+    }
+  }
+
+  /* The end of the file may cut the read short. */
+  n = b->offset + b->len - offset;
+  if(n > len) {
+    n = len;
+  }
+  memcpy(buf, &b->data[offset - b->offset], n);
+  memset(buf + n, 0, len - n);
+}
+/*---------------------------------------------------------------------------*/
+static struct relevant_section *
+find_section(unsigned short shndx)
+{
+  if(shndx == bss.number) {
+    return &bss;
+  } else if(shndx == data.number) {
+    return &data;
+  } else if(shndx == rodata.number) {
+    return &rodata;
+  } else if(shndx == text.number) {
+    return &text;
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
 /*
 static void
 seek_write(int fd, unsigned int offset, char *buf, int len)
@@ -183,20 +244,13 @@ find_local_symbol(int fd, const char *symbol,
   struct relevant_section *sect;
   
   for(a = symtab; a < symtab + symtabsize; a += sizeof(s)) {
-    seek_read(fd, a, (char *)&s, sizeof(s));
+    buffered_read(fd, &symbuf, a, (char *)&s, sizeof(s));
 
     if(s.st_name != 0) {
-      seek_read(fd, strtab + s.st_name, name, sizeof(name));
+      buffered_read(fd, &strbuf, strtab + s.st_name, name, sizeof(name));
       if(strcmp(name, symbol) == 0) {
-	if(s.st_shndx == bss.number) {
-	  sect = &bss;
-	} else if(s.st_shndx == data.number) {
-	  sect = &data;
-  } else if(s.st_shndx == rodata.number) {
-    sect = &rodata;
-	} else if(s.st_shndx == text.number) {
-	  sect = &text;
-	} else {
+	sect = find_section(s.st_shndx);
+	if(sect == NULL) {
 	  return NULL;
 	}
 	return &(sect->address[s.st_value]);
@@ -233,47 +287,31 @@ relocate_section(int fd,
   }
   
   for(a = section; a < section + size; a += rel_size) {
-    seek_read(fd, a, (char *)&rela, rel_size);
-    seek_read(fd,
-	      symtab + sizeof(struct elf32_sym) * ELF32_R_SYM(rela.r_info),
-	      (char *)&s, sizeof(s));
+    buffered_read(fd, &relbuf, a, (char *)&rela, rel_size);
+    buffered_read(fd, &symbuf,
+		  symtab + sizeof(struct elf32_sym) * ELF32_R_SYM(rela.r_info),
+		  (char *)&s, sizeof(s));
     if(s.st_name != 0) {
-      seek_read(fd, strtab + s.st_name, name, sizeof(name));
+      buffered_read(fd, &strbuf, strtab + s.st_name, name, sizeof(name));
       PRINTF("name: %s\n", name);
       addr = (char *)symtab_lookup(name);
-      /* ADDED */
       if(addr == NULL) {
+	/* A local symbol: its entry already holds the section and the
+	   value, so the symbol table need not be searched by name. */
 	PRINTF("name not found in global: %s\n", name);
-	addr = find_local_symbol(fd, name, symtab, symtabsize, strtab);
-	PRINTF("found address %p\n", addr);
-      }
-      if(addr == NULL) {
-	if(s.st_shndx == bss.number) {
-	  sect = &bss;
-	} else if(s.st_shndx == data.number) {
-	  sect = &data;
-	} else if(s.st_shndx == rodata.number) {
-	  sect = &rodata;
-	} else if(s.st_shndx == text.number) {
-	  sect = &text;
-	} else {
+	sect = find_section(s.st_shndx);
+	if(sect == NULL) {
 	  PRINTF("elfloader unknown name: '%30s'\n", name);
 	  memcpy(elfloader_unknown, name, sizeof(elfloader_unknown));
 	  elfloader_unknown[sizeof(elfloader_unknown) - 1] = 0;
 	  return ELFLOADER_SYMBOL_NOT_FOUND;
 	}
-	addr = sect->address;
+	addr = &sect->address[s.st_value];
+	PRINTF("found address %p\n", addr);
       }
     } else {
-      if(s.st_shndx == bss.number) {
-	sect = &bss;
-      } else if(s.st_shndx == data.number) {
-	sect = &data;
-      } else if(s.st_shndx == rodata.number) {
-	sect = &rodata;
-      } else if(s.st_shndx == text.number) {
-	sect = &text;
-      } else {
+      sect = find_section(s.st_shndx);
+      if(sect == NULL) {
 	return ELFLOADER_SEGMENT_NOT_FOUND;
       }
       
@@ -300,10 +338,10 @@ find_program_processes(int fd,
   char name[30];
   
   for(a = symtab; a < symtab + size; a += sizeof(s)) {
-    seek_read(fd, a, (char *)&s, sizeof(s));
+    buffered_read(fd, &symbuf, a, (char *)&s, sizeof(s));
 
     if(s.st_name != 0) {
-      seek_read(fd, strtab + s.st_name, name, sizeof(name));
+      buffered_read(fd, &strbuf, strtab + s.st_name, name, sizeof(name));
       if(strcmp(name, "autostart_processes") == 0) {
 	return &data.address[s.st_value];
       }
@@ -361,6 +399,7 @@ elfloader_load(int fd)
   int ret;
 
   elfloader_unknown[0] = 0;
+  relbuf.len = symbuf.len = strbuf.len = 0;
 
   /* The ELF header is located at the start of the buffer. */
   seek_read(fd, 0, (char *)&ehdr, sizeof(ehdr));
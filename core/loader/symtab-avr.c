@@ -36,9 +36,36 @@
 #include "symtab.h"
 #include "loader/symbols.h"
 
-#define SYMTAB_CONF_BINARY_SEARCH 0
+/* The table is sorted by tools/avr-make-symbols. */
+#ifndef SYMTAB_CONF_BINARY_SEARCH
+#define SYMTAB_CONF_BINARY_SEARCH 1
+#endif
 
 /*---------------------------------------------------------------------------*/
+#if SYMTAB_CONF_BINARY_SEARCH
+void *
+symtab_lookup(const char *name)
+{
+  int start, middle, end;
+  int r;
+
+  start = 0;
+  end = symbols_nelts - 1;	/* Last entry is { 0, 0 }. */
+
+  while(start <= end) {
+    middle = (start + end) / 2;
+    r = strcmp_P(name, (const char *)pgm_read_word(&symbols[middle].name));
+    if(r < 0) {
+      end = middle - 1;
+    } else if(r > 0) {
+      start = middle + 1;
+    } else {
+      return (void *)pgm_read_word(&symbols[middle].value);
+    }
+  }
+  return NULL;
+}
+#else /* SYMTAB_CONF_BINARY_SEARCH */
 void *
 symtab_lookup(const char *name)
 {
@@ -55,7 +82,7 @@ symtab_lookup(const char *name)
   }
   return NULL;
 }
-
+#endif /* SYMTAB_CONF_BINARY_SEARCH */
 /*---------------------------------------------------------------------------*/
 
 #if 0
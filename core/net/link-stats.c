@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Link statistics of the neighbors
+ */
+
+#include "net/link-stats.h"
+#include "net/nbr-table.h"
+#include "net/packetbuf.h"
+#include "net/mac/mac.h"
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else /* DEBUG */
+#define PRINTF(...)
+#endif /* DEBUG */
+
+/* Weight of the old ETX in the moving average, in percent. The first
+ * samples of a link get less weight to converge quickly. */
+#define ETX_ALPHA       90
+#define ETX_ALPHA_FAST  50
+#define ETX_FAST_COUNT  4
+
+/* Weight of the old RSSI and LQI, in 1/8 */
+#define RX_ALPHA        6
+
+NBR_TABLE(struct link_stats, link_stats);
+/*---------------------------------------------------------------------------*/
+void
+link_stats_init(void)
+{
+  nbr_table_register(link_stats, NULL);
+}
+/*---------------------------------------------------------------------------*/
+const struct link_stats *
+link_stats_from_lladdr(const rimeaddr_t *lladdr)
+{
+  return nbr_table_get_from_lladdr(link_stats, lladdr);
+}
+/*---------------------------------------------------------------------------*/
+static struct link_stats *
+get_or_add(const rimeaddr_t *lladdr)
+{
+  struct link_stats *stats;
+
+  stats = nbr_table_get_from_lladdr(link_stats, lladdr);
+  if(stats == NULL) {
+    stats = nbr_table_add_lladdr(link_stats, lladdr);
+    if(stats != NULL) {
+      stats->etx = 0;
+      stats->rssi = 0;
+      stats->lqi = 0;
+      stats->tx_count = 0;
+      stats->rx_count = 0;
+#if LINK_STATS_TXPOWER
+      stats->txpower = 0;
+      stats->tx_good = 0;
+#endif /* LINK_STATS_TXPOWER */
+    }
+  }
+  return stats;
+}
+/*---------------------------------------------------------------------------*/
+#if LINK_STATS_INIT_ETX_FROM_RSSI
+static uint16_t
+guess_etx_from_rssi(int16_t rssi)
+{
+  if(rssi >= LINK_STATS_RSSI_HIGH) {
+    return LINK_STATS_ETX_DIVISOR;
+  }
+  if(rssi <= LINK_STATS_RSSI_LOW) {
+    return LINK_STATS_INIT_ETX * LINK_STATS_ETX_DIVISOR;
+  }
+  return LINK_STATS_ETX_DIVISOR +
+    (uint32_t)(LINK_STATS_INIT_ETX - 1) * LINK_STATS_ETX_DIVISOR *
+    (LINK_STATS_RSSI_HIGH - rssi) / (LINK_STATS_RSSI_HIGH - LINK_STATS_RSSI_LOW);
+}
+#endif /* LINK_STATS_INIT_ETX_FROM_RSSI */
+/*---------------------------------------------------------------------------*/
+void
+link_stats_packet_sent(const rimeaddr_t *lladdr, int status, int numtx)
+{
+  struct link_stats *stats;
+  uint16_t packet_etx;
+  uint8_t alpha;
+
+  /* Collisions and radio errors say nothing about the link */
+  if(rimeaddr_cmp(lladdr, &rimeaddr_null) ||
+     (status != MAC_TX_OK && status != MAC_TX_NOACK) || numtx <= 0) {
+    return;
+  }
+
+  stats = get_or_add(lladdr);
+  if(stats == NULL) {
+    return;
+  }
+
+  if(status == MAC_TX_NOACK) {
+    packet_etx = LINK_STATS_ETX_NOACK * LINK_STATS_ETX_DIVISOR;
+  } else {
+    packet_etx = numtx * LINK_STATS_ETX_DIVISOR;
+  }
+
+  if(stats->etx == 0) {
+    stats->etx = packet_etx;
+  } else {
+    alpha = stats->tx_count < ETX_FAST_COUNT ? ETX_ALPHA_FAST : ETX_ALPHA;
+    stats->etx = ((uint32_t)stats->etx * alpha +
+                  (uint32_t)packet_etx * (100 - alpha)) / 100;
+  }
+  if(stats->tx_count < 255) {
+    stats->tx_count++;
+  }
+
+#if LINK_STATS_TXPOWER
+  if(status == MAC_TX_OK && numtx == 1) {
+    /* Step down slowly while the first attempts get through */
+    if(++stats->tx_good >= LINK_STATS_TXPOWER_GOOD) {
+      stats->tx_good = 0;
+      if(stats->txpower < LINK_STATS_TXPOWER_STEPS) {
+        stats->txpower++;
+      }
+    }
+  } else {
+    /* Back up quickly on retransmissions, at once on a lost frame */
+    stats->tx_good = 0;
+    if(status == MAC_TX_NOACK) {
+      stats->txpower = 0;
+    } else if(stats->txpower > 0) {
+      stats->txpower--;
+    }
+  }
+#endif /* LINK_STATS_TXPOWER */
+
+  PRINTF("link-stats: ETX %u.%02u after %d tx, status %d\n",
+         stats->etx / LINK_STATS_ETX_DIVISOR,
+         (stats->etx % LINK_STATS_ETX_DIVISOR) * 100 / LINK_STATS_ETX_DIVISOR,
+         numtx, status);
+}
+/*---------------------------------------------------------------------------*/
+void
+link_stats_input_callback(const rimeaddr_t *lladdr)
+{
+  struct link_stats *stats;
+  int16_t rssi;
+  uint8_t lqi;
+
+  if(rimeaddr_cmp(lladdr, &rimeaddr_null)) {
+    return;
+  }
+
+  stats = get_or_add(lladdr);
+  if(stats == NULL) {
+    return;
+  }
+
+  rssi = (int16_t)packetbuf_attr(PACKETBUF_ATTR_RSSI);
+  lqi = packetbuf_attr(PACKETBUF_ATTR_LINK_QUALITY);
+  if(stats->rx_count == 0) {
+    stats->rssi = rssi;
+    stats->lqi = lqi;
+  } else {
+    stats->rssi = (stats->rssi * RX_ALPHA + rssi * (8 - RX_ALPHA)) / 8;
+    stats->lqi = ((uint16_t)stats->lqi * RX_ALPHA + lqi * (8 - RX_ALPHA)) / 8;
+  }
+  if(stats->rx_count < 255) {
+    stats->rx_count++;
+  }
+
+#if LINK_STATS_INIT_ETX_FROM_RSSI
+  /* Until we transmit to the neighbor, the RSSI is all we know */
+  if(stats->tx_count == 0) {
+    stats->etx = guess_etx_from_rssi(stats->rssi);
+  }
+#endif /* LINK_STATS_INIT_ETX_FROM_RSSI */
+}
+/*---------------------------------------------------------------------------*/
+#if LINK_STATS_TXPOWER
+uint8_t
+link_stats_txpower(const rimeaddr_t *lladdr)
+{
+  const struct link_stats *stats;
+  int16_t margin;
+  uint8_t steps;
+
+  stats = nbr_table_get_from_lladdr(link_stats, lladdr);
+  if(stats == NULL || stats->rx_count == 0) {
+    return 0;
+  }
+
+  /* Keep the margin of the RSSI we hear the neighbor with */
+  margin = stats->rssi - LINK_STATS_TXPOWER_RSSI_MIN;
+  if(margin <= 0) {
+    return 0;
+  }
+  steps = stats->txpower;
+  if(margin / LINK_STATS_TXPOWER_RSSI_STEP < steps) {
+    steps = margin / LINK_STATS_TXPOWER_RSSI_STEP;
+  }
+  return steps;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* LINK_STATS_TXPOWER */
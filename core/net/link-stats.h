@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Link statistics of the neighbors, shared by the routing protocols.
+ *         The MAC transmission status gives the ETX, received packets give
+ *         the RSSI and LQI.
+ */
+
+#ifndef LINK_STATS_H_
+#define LINK_STATS_H_
+
+#include "net/rime/rimeaddr.h"
+
+/* ETX fixed point divisor, the same as RPL_DAG_MC_ETX_DIVISOR */
+#define LINK_STATS_ETX_DIVISOR 128
+
+/* ETX sample of a transmission that was never acknowledged */
+#ifdef LINK_STATS_CONF_ETX_NOACK
+#define LINK_STATS_ETX_NOACK LINK_STATS_CONF_ETX_NOACK
+#else /* LINK_STATS_CONF_ETX_NOACK */
+#define LINK_STATS_ETX_NOACK 10
+#endif /* LINK_STATS_CONF_ETX_NOACK */
+
+/* Guess the ETX of new links from the RSSI of their first packets. The
+ * guess goes from 1 at LINK_STATS_RSSI_HIGH to LINK_STATS_INIT_ETX at
+ * LINK_STATS_RSSI_LOW, in the units of PACKETBUF_ATTR_RSSI. */
+#ifdef LINK_STATS_CONF_INIT_ETX_FROM_RSSI
+#define LINK_STATS_INIT_ETX_FROM_RSSI LINK_STATS_CONF_INIT_ETX_FROM_RSSI
+#else /* LINK_STATS_CONF_INIT_ETX_FROM_RSSI */
+#define LINK_STATS_INIT_ETX_FROM_RSSI 0
+#endif /* LINK_STATS_CONF_INIT_ETX_FROM_RSSI */
+
+#ifdef LINK_STATS_CONF_INIT_ETX
+#define LINK_STATS_INIT_ETX LINK_STATS_CONF_INIT_ETX
+#else /* LINK_STATS_CONF_INIT_ETX */
+#define LINK_STATS_INIT_ETX 5
+#endif /* LINK_STATS_CONF_INIT_ETX */
+
+#ifdef LINK_STATS_CONF_RSSI_HIGH
+#define LINK_STATS_RSSI_HIGH LINK_STATS_CONF_RSSI_HIGH
+#else /* LINK_STATS_CONF_RSSI_HIGH */
+#define LINK_STATS_RSSI_HIGH -60
+#endif /* LINK_STATS_CONF_RSSI_HIGH */
+
+#ifdef LINK_STATS_CONF_RSSI_LOW
+#define LINK_STATS_RSSI_LOW LINK_STATS_CONF_RSSI_LOW
+#else /* LINK_STATS_CONF_RSSI_LOW */
+#define LINK_STATS_RSSI_LOW -90
+#endif /* LINK_STATS_CONF_RSSI_LOW */
+
+/* Lower the TX power towards neighbors that acknowledge the first
+ * attempt and are heard well. link_stats_txpower() gives the steps below
+ * the configured power for a frame, the radio driver applies them. */
+#ifdef LINK_STATS_CONF_TXPOWER
+#define LINK_STATS_TXPOWER LINK_STATS_CONF_TXPOWER
+#else /* LINK_STATS_CONF_TXPOWER */
+#define LINK_STATS_TXPOWER 0
+#endif /* LINK_STATS_CONF_TXPOWER */
+
+/* Maximum steps below the configured power */
+#ifdef LINK_STATS_CONF_TXPOWER_STEPS
+#define LINK_STATS_TXPOWER_STEPS LINK_STATS_CONF_TXPOWER_STEPS
+#else /* LINK_STATS_CONF_TXPOWER_STEPS */
+#define LINK_STATS_TXPOWER_STEPS 8
+#endif /* LINK_STATS_CONF_TXPOWER_STEPS */
+
+/* Transmissions acknowledged at the first attempt before one more step */
+#ifdef LINK_STATS_CONF_TXPOWER_GOOD
+#define LINK_STATS_TXPOWER_GOOD LINK_STATS_CONF_TXPOWER_GOOD
+#else /* LINK_STATS_CONF_TXPOWER_GOOD */
+#define LINK_STATS_TXPOWER_GOOD 8
+#endif /* LINK_STATS_CONF_TXPOWER_GOOD */
+
+/* The RSSI of the neighbor caps the steps: one step per
+ * LINK_STATS_TXPOWER_RSSI_STEP above LINK_STATS_TXPOWER_RSSI_MIN */
+#ifdef LINK_STATS_CONF_TXPOWER_RSSI_MIN
+#define LINK_STATS_TXPOWER_RSSI_MIN LINK_STATS_CONF_TXPOWER_RSSI_MIN
+#else /* LINK_STATS_CONF_TXPOWER_RSSI_MIN */
+#define LINK_STATS_TXPOWER_RSSI_MIN (LINK_STATS_RSSI_LOW + 10)
+#endif /* LINK_STATS_CONF_TXPOWER_RSSI_MIN */
+
+#ifdef LINK_STATS_CONF_TXPOWER_RSSI_STEP
+#define LINK_STATS_TXPOWER_RSSI_STEP LINK_STATS_CONF_TXPOWER_RSSI_STEP
+#else /* LINK_STATS_CONF_TXPOWER_RSSI_STEP */
+#define LINK_STATS_TXPOWER_RSSI_STEP 2
+#endif /* LINK_STATS_CONF_TXPOWER_RSSI_STEP */
+
+/* Statistics of the link to a neighbor */
+struct link_stats {
+  uint16_t etx;      /* In units of 1/LINK_STATS_ETX_DIVISOR, 0 if unknown */
+  int16_t rssi;      /* Moving average of the received packets */
+  uint8_t lqi;       /* Moving average of the received packets */
+  uint8_t tx_count;  /* Transmissions with an ETX sample, saturates */
+  uint8_t rx_count;  /* Received packets, saturates */
+#if LINK_STATS_TXPOWER
+  uint8_t txpower;   /* Steps below the configured TX power */
+  uint8_t tx_good;   /* First attempt ACKs since the last step */
+#endif /* LINK_STATS_TXPOWER */
+};
+
+void link_stats_init(void);
+
+/* Returns the statistics of a neighbor, NULL if we never heard from it */
+const struct link_stats *link_stats_from_lladdr(const rimeaddr_t *lladdr);
+
+/* Called with the MAC status of every unicast transmission */
+void link_stats_packet_sent(const rimeaddr_t *lladdr, int status, int numtx);
+
+/* Called for every received packet, with its attributes in packetbuf */
+void link_stats_input_callback(const rimeaddr_t *lladdr);
+
+#if LINK_STATS_TXPOWER
+/* Returns the TX power steps below the configured power for a frame to
+ * lladdr, 0 for broadcast and unknown neighbors */
+uint8_t link_stats_txpower(const rimeaddr_t *lladdr);
+#endif /* LINK_STATS_TXPOWER */
+
+#endif /* LINK_STATS_H_ */
@@ -80,10 +80,20 @@
 #ifndef RDC_CONF_HARDWARE_ACK
 #define RDC_CONF_HARDWARE_ACK        0
 #endif
+/* Radio drops frames not addressed to us, only the others become pending */
+#ifndef RDC_CONF_HARDWARE_FILTER
+#define RDC_CONF_HARDWARE_FILTER     0
+#endif
 /* MCU can sleep during radio off */
 #ifndef RDC_CONF_MCU_SLEEP
 #define RDC_CONF_MCU_SLEEP           0
 #endif
+/* Channel check interval adapts to incoming traffic and residual energy */
+#ifdef CONTIKIMAC_CONF_ADAPTIVE_CHECK_RATE
+#define WITH_ADAPTIVE_CHECK_RATE     CONTIKIMAC_CONF_ADAPTIVE_CHECK_RATE
+#else
+#define WITH_ADAPTIVE_CHECK_RATE     0
+#endif
 
 #if NETSTACK_RDC_CHANNEL_CHECK_RATE >= 64
 #undef WITH_PHASE_OPTIMIZATION
@@ -117,6 +127,53 @@ struct hdr {
 #define SYNC_CYCLE_STARTS                    1
 #endif
 
+/* With WITH_ADAPTIVE_CHECK_RATE, a node does the channel check of only
+   every 2^check_shift-th cycle, so that its wake-ups stay on the grid of
+   CYCLE_TIME. Every ADAPT_CYCLES cycles, the shift grows by one if fewer
+   than ADAPT_IDLE_FRAMES frames were received for us, and shrinks by one
+   if more than ADAPT_BUSY_FRAMES were. CONTIKIMAC_CONF_RESIDUAL_ENERGY(),
+   e.g. battery_sensor_residual_energy, returns 0 (empty) to 255 (full)
+   and raises the lowest shift as the energy runs out.
+
+   The shift is advertised in the low bits of the ContikiMAC header id
+   of every frame we send and recorded per neighbor by the phase module,
+   senders strobe for the interval of the receiver. A larger shift only
+   takes effect after a broadcast announced it, a smaller one at once.
+   All nodes of a network have to enable it, others reject the header. */
+#if WITH_ADAPTIVE_CHECK_RATE
+#if !WITH_CONTIKIMAC_HEADER
+#error "CONTIKIMAC_CONF_ADAPTIVE_CHECK_RATE requires the ContikiMAC header"
+#endif
+#define CHECK_SHIFT_MASK                   0x07
+#ifdef CONTIKIMAC_CONF_MAX_CHECK_SHIFT
+#define MAX_CHECK_SHIFT                    CONTIKIMAC_CONF_MAX_CHECK_SHIFT
+#else
+#define MAX_CHECK_SHIFT                    3
+#endif
+#if MAX_CHECK_SHIFT > CHECK_SHIFT_MASK
+#error "CONTIKIMAC_CONF_MAX_CHECK_SHIFT must not exceed 7"
+#endif
+#ifdef CONTIKIMAC_CONF_ADAPT_CYCLES
+#define ADAPT_CYCLES                       CONTIKIMAC_CONF_ADAPT_CYCLES
+#else
+#define ADAPT_CYCLES                       (8 * NETSTACK_RDC_CHANNEL_CHECK_RATE)
+#endif
+#ifdef CONTIKIMAC_CONF_ADAPT_IDLE_FRAMES
+#define ADAPT_IDLE_FRAMES                  CONTIKIMAC_CONF_ADAPT_IDLE_FRAMES
+#else
+#define ADAPT_IDLE_FRAMES                  1
+#endif
+#ifdef CONTIKIMAC_CONF_ADAPT_BUSY_FRAMES
+#define ADAPT_BUSY_FRAMES                  CONTIKIMAC_CONF_ADAPT_BUSY_FRAMES
+#else
+#define ADAPT_BUSY_FRAMES                  8
+#endif
+#ifdef CONTIKIMAC_CONF_RESIDUAL_ENERGY
+#define RESIDUAL_ENERGY                    CONTIKIMAC_CONF_RESIDUAL_ENERGY
+uint8_t RESIDUAL_ENERGY(void);
+#endif
+#endif /* WITH_ADAPTIVE_CHECK_RATE */
+
 /* Are we currently receiving a burst? */
 static int we_are_receiving_burst = 0;
 
@@ -152,7 +209,9 @@ static int we_are_receiving_burst = 0;
 
 /* CCA_SLEEP_TIME is the time between two successive CCA checks. */
 /* Add 1 when rtimer ticks are coarse */
-#if RTIMER_ARCH_SECOND > 8000
+#ifdef CONTIKIMAC_CONF_CCA_SLEEP_TIME
+#define CCA_SLEEP_TIME                     (CONTIKIMAC_CONF_CCA_SLEEP_TIME)
+#elif RTIMER_ARCH_SECOND > 8000
 #define CCA_SLEEP_TIME                     RTIMER_ARCH_SECOND / 2000
 #else
 #define CCA_SLEEP_TIME                     (RTIMER_ARCH_SECOND / 2000) + 1
@@ -178,14 +237,20 @@ static int we_are_receiving_burst = 0;
 
 /* MAX_NONACTIVITY_PERIODS is the maximum number of periods we allow
    the radio to be turned on without any packet being received, when
-   WITH_FAST_SLEEP is enabled. */
+   WITH_FAST_SLEEP is enabled. Radios that report the start of a frame
+   without delay can use fewer periods. */
+#ifdef CONTIKIMAC_CONF_MAX_NONACTIVITY_PERIODS
+#define MAX_NONACTIVITY_PERIODS            CONTIKIMAC_CONF_MAX_NONACTIVITY_PERIODS
+#else
 #define MAX_NONACTIVITY_PERIODS            10
+#endif
 
 
 
 /* STROBE_TIME is the maximum amount of time a transmitted packet
-   should be repeatedly transmitted as part of a transmission. */
-#define STROBE_TIME                        (CYCLE_TIME + 2 * CHECK_TIME)
+   should be repeatedly transmitted as part of a transmission to a
+   receiver that checks the channel every cycle_time. */
+#define STROBE_TIME(cycle_time)            ((cycle_time) + 2 * CHECK_TIME)
 
 /* GUARD_TIME is the time before the expected phase of a neighbor that
    a transmitted should begin transmitting packets. */
@@ -226,6 +291,34 @@ static int we_are_receiving_burst = 0;
 #endif
 
 
+/* TX_TIMESTAMP(t) is the time the acknowledged strobe started on air,
+   given the time t before NETSTACK_RADIO.transmit() was called. Radios
+   with hardware CSMA or retries can report the time more accurately
+   through CONTIKIMAC_CONF_TX_TIMESTAMP. */
+#ifdef CONTIKIMAC_CONF_TX_TIMESTAMP
+#define TX_TIMESTAMP(t)                    CONTIKIMAC_CONF_TX_TIMESTAMP(t)
+#else
+#define TX_TIMESTAMP(t)                    (t)
+#endif
+
+/* With CONTIKIMAC_CONF_CHANNELS, e.g. { 11, 16, 21 }, unicast frames go
+   on one channel of the list per receiver, chosen from the link-layer
+   address, so that every neighbor knows it without signalling.
+   Broadcasts stay on the channel the radio was set to at init. Each
+   channel check then covers the unicast channel of the node and the
+   broadcast channel. CONTIKIMAC_CONF_SET_CHANNEL(c) switches the radio,
+   CONTIKIMAC_CONF_GET_CHANNEL() returns its channel. */
+#if defined(CONTIKIMAC_CONF_CHANNELS) && defined(CONTIKIMAC_CONF_SET_CHANNEL)
+#define WITH_MULTICHANNEL                  1
+#define SET_CHANNEL(c)                     CONTIKIMAC_CONF_SET_CHANNEL(c)
+static const uint8_t unicast_channels[] = CONTIKIMAC_CONF_CHANNELS;
+static uint8_t broadcast_channel;
+#define CCA_COUNT                          (2 * CCA_COUNT_MAX)
+#else
+#define WITH_MULTICHANNEL                  0
+#define CCA_COUNT                          CCA_COUNT_MAX
+#endif
+
 #define ACK_LEN 3
 
 #include <stdio.h>
@@ -252,11 +345,19 @@ static volatile unsigned char radio_is_on = 0;
 static struct compower_activity current_packet;
 #endif /* CONTIKIMAC_CONF_COMPOWER */
 
-#if WITH_PHASE_OPTIMIZATION
+#if WITH_PHASE_OPTIMIZATION || WITH_ADAPTIVE_CHECK_RATE
 
 #include "net/mac/phase.h"
 
-#endif /* WITH_PHASE_OPTIMIZATION */
+#endif /* WITH_PHASE_OPTIMIZATION || WITH_ADAPTIVE_CHECK_RATE */
+
+#if WITH_ADAPTIVE_CHECK_RATE
+/* The shift in effect and the one we advertise */
+static volatile uint8_t check_shift;
+static volatile uint8_t target_shift;
+/* Frames received for us since the last adaptation */
+static volatile uint8_t rx_frames;
+#endif /* WITH_ADAPTIVE_CHECK_RATE */
 
 #define DEFAULT_STREAM_TIME (4 * CYCLE_TIME)
 
@@ -269,6 +370,52 @@ static struct timer broadcast_rate_timer;
 static int broadcast_rate_counter;
 #endif /* CONTIKIMAC_CONF_BROADCAST_RATE_LIMIT */
 
+/*---------------------------------------------------------------------------*/
+#if WITH_MULTICHANNEL
+/* The channel a node listens for unicast frames on */
+static uint8_t
+unicast_channel(const rimeaddr_t *addr)
+{
+  uint8_t i, hash = 0;
+
+  for(i = 0; i < sizeof(rimeaddr_t); i++) {
+    hash += addr->u8[i];
+  }
+  return unicast_channels[hash % sizeof(unicast_channels)];
+}
+#endif /* WITH_MULTICHANNEL */
+/*---------------------------------------------------------------------------*/
+#if WITH_ADAPTIVE_CHECK_RATE
+/* Called from powercycle() once per cycle */
+static void
+adapt_check_rate(void)
+{
+  static uint16_t cycles;
+  uint8_t min_shift = 0;
+
+  if(++cycles < ADAPT_CYCLES) {
+    return;
+  }
+  cycles = 0;
+
+  if(rx_frames > ADAPT_BUSY_FRAMES && target_shift > 0) {
+    target_shift--;
+  } else if(rx_frames < ADAPT_IDLE_FRAMES && target_shift < MAX_CHECK_SHIFT) {
+    target_shift++;
+  }
+  rx_frames = 0;
+
+#ifdef RESIDUAL_ENERGY
+  min_shift = ((uint16_t)(255 - RESIDUAL_ENERGY()) * (MAX_CHECK_SHIFT + 1)) >> 8;
+#endif
+  if(target_shift < min_shift) {
+    target_shift = min_shift;
+  }
+  if(check_shift > target_shift) {
+    check_shift = target_shift;
+  }
+}
+#endif /* WITH_ADAPTIVE_CHECK_RATE */
 /*---------------------------------------------------------------------------*/
 static void
 on(void)
@@ -395,9 +542,28 @@ powercycle(struct rtimer *t, void *ptr)
 
     packet_seen = 0;
 
-    for(count = 0; count < CCA_COUNT_MAX; ++count) {
+#if WITH_ADAPTIVE_CHECK_RATE
+    {
+      static uint8_t cycle_count;
+
+      adapt_check_rate();
+      if(cycle_count++ & ((1 << check_shift) - 1)) {
+        /* Not a wake-up at the current interval */
+        schedule_powercycle_fixed(t, CYCLE_TIME + cycle_start);
+        PT_YIELD(&pt);
+        continue;
+      }
+    }
+#endif /* WITH_ADAPTIVE_CHECK_RATE */
+
+    for(count = 0; count < CCA_COUNT; ++count) {
       t0 = RTIMER_NOW();
       if(we_are_sending == 0 && we_are_receiving_burst == 0) {
+#if WITH_MULTICHANNEL
+        /* Our unicast channel first, then the broadcast channel */
+        SET_CHANNEL(count < CCA_COUNT_MAX ?
+                    unicast_channel(&rimeaddr_node_addr) : broadcast_channel);
+#endif
         powercycle_turn_radio_on();
         /* Check if a packet is seen in the air. If so, we keep the
              radio on for a while (LISTEN_TIME_AFTER_PACKET_DETECTED) to
@@ -418,6 +584,10 @@ powercycle(struct rtimer *t, void *ptr)
     if(packet_seen) {
       static rtimer_clock_t start;
       static uint8_t silence_periods, periods;
+#if RDC_CONF_HARDWARE_FILTER
+      static uint8_t frame_seen;
+      frame_seen = 0;
+#endif
       start = RTIMER_NOW();
 
       periods = silence_periods = 0;
@@ -445,6 +615,15 @@ powercycle(struct rtimer *t, void *ptr)
 
         if(NETSTACK_RADIO.receiving_packet()) {
           silence_periods = 0;
+#if RDC_CONF_HARDWARE_FILTER
+          frame_seen = 1;
+        } else if(frame_seen && !NETSTACK_RADIO.pending_packet()) {
+          /* The frame has ended without becoming pending, the radio
+             dropped it as addressed to another node. The rest of the
+             strobe train is not for us either. */
+          powercycle_turn_radio_off();
+          break;
+#endif
         }
         if(silence_periods > MAX_SILENCE_PERIODS) {
           powercycle_turn_radio_off();
@@ -537,6 +716,11 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
   int ret;
   uint8_t contikimac_was_on;
   uint8_t seqno;
+  rtimer_clock_t cycle_time = CYCLE_TIME;
+#if WITH_ADAPTIVE_CHECK_RATE
+  uint8_t shift;
+  uint8_t announced_shift;
+#endif /* WITH_ADAPTIVE_CHECK_RATE */
 #if WITH_CONTIKIMAC_HEADER
   struct hdr *chdr;
 #endif /* WITH_CONTIKIMAC_HEADER */
@@ -593,7 +777,12 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
     return MAC_TX_ERR_FATAL;
   }
   chdr = packetbuf_hdrptr();
+#if WITH_ADAPTIVE_CHECK_RATE
+  announced_shift = target_shift;
+  chdr->id = CONTIKIMAC_ID | announced_shift;
+#else
   chdr->id = CONTIKIMAC_ID;
+#endif
   chdr->len = hdrlen;
   
   /* Create the MAC header for the data packet. */
@@ -642,10 +831,17 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
   /* Remove the MAC-layer header since it will be recreated next time around. */
   packetbuf_hdr_remove(hdrlen);
 
+#if WITH_ADAPTIVE_CHECK_RATE
+  /* A broadcast has to reach the neighbor with the longest interval */
+  shift = is_broadcast ? phase_max_cycle_shift() :
+    phase_cycle_shift(packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
+  cycle_time = CYCLE_TIME << MIN(shift, MAX_CHECK_SHIFT);
+#endif /* WITH_ADAPTIVE_CHECK_RATE */
+
   if(!is_broadcast && !is_receiver_awake) {
 #if WITH_PHASE_OPTIMIZATION
     ret = phase_wait(packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
-                     CYCLE_TIME, GUARD_TIME,
+                     cycle_time, GUARD_TIME,
                      mac_callback, mac_callback_ptr, buf_list);
     if(ret == PHASE_DEFERRED) {
       return MAC_TX_DEFERRED;
@@ -692,6 +888,12 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
   contikimac_was_on = contikimac_is_on;
   contikimac_is_on = 1;
 
+#if WITH_MULTICHANNEL
+  /* The radio tunes to the channel of the receiver as it wakes up */
+  SET_CHANNEL(is_broadcast ? broadcast_channel :
+              unicast_channel(packetbuf_addr(PACKETBUF_ADDR_RECEIVER)));
+#endif
+
 #if !RDC_CONF_HARDWARE_CSMA
     /* Check if there are any transmissions by others. */
     /* TODO: why does this give collisions before sending with the mc1322x? */
@@ -718,6 +920,9 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
     we_are_sending = 0;
     off();
     PRINTF("contikimac: collisions before sending\n");
+#if WITH_MULTICHANNEL
+    SET_CHANNEL(broadcast_channel);
+#endif
     contikimac_is_on = contikimac_was_on;
     return MAC_TX_COLLISION;
   }
@@ -737,7 +942,8 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
   seqno = packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO);
   for(strobes = 0, collisions = 0;
       got_strobe_ack == 0 && collisions == 0 &&
-      RTIMER_CLOCK_LT(RTIMER_NOW(), t0 + STROBE_TIME); strobes++) {
+      RTIMER_CLOCK_LT(RTIMER_NOW(), t0 + STROBE_TIME(cycle_time));
+      strobes++) {
 
     watchdog_periodic();
 
@@ -763,7 +969,7 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
       if(ret == RADIO_TX_OK) {
         if(!is_broadcast) {
           got_strobe_ack = 1;
-          encounter_time = txtime;
+          encounter_time = TX_TIMESTAMP(txtime);
           break;
         }
       } else if (ret == RADIO_TX_NOACK) {
@@ -788,7 +994,7 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
         len = NETSTACK_RADIO.read(ackbuf, ACK_LEN);
         if(len == ACK_LEN && seqno == ackbuf[ACK_LEN - 1]) {
           got_strobe_ack = 1;
-          encounter_time = txtime;
+          encounter_time = TX_TIMESTAMP(txtime);
           break;
         } else {
           PRINTF("contikimac: collisions while sending\n");
@@ -821,6 +1027,9 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
   compower_clear(&current_packet);
 #endif /* CONTIKIMAC_CONF_COMPOWER */
 
+#if WITH_MULTICHANNEL
+  SET_CHANNEL(broadcast_channel);
+#endif
   contikimac_is_on = contikimac_was_on;
   we_are_sending = 0;
 
@@ -835,6 +1044,13 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
     ret = MAC_TX_OK;
   }
 
+#if WITH_ADAPTIVE_CHECK_RATE
+  /* All neighbors heard the longer interval, we may use it now */
+  if(is_broadcast && ret == MAC_TX_OK) {
+    check_shift = MIN(announced_shift, target_shift);
+  }
+#endif /* WITH_ADAPTIVE_CHECK_RATE */
+
 #if WITH_PHASE_OPTIMIZATION
   if(is_known_receiver && got_strobe_ack) {
     PRINTF("no miss %d wake-ups %d\n",
@@ -940,12 +1156,21 @@ input_packet(void)
 #if WITH_CONTIKIMAC_HEADER
     struct hdr *chdr;
     chdr = packetbuf_dataptr();
+#if WITH_ADAPTIVE_CHECK_RATE
+    if((chdr->id & ~CHECK_SHIFT_MASK) != CONTIKIMAC_ID) {
+#else
     if(chdr->id != CONTIKIMAC_ID) {
+#endif
       PRINTF("contikimac: failed to parse hdr (%u)\n", packetbuf_totlen());
       return;
     }
     packetbuf_hdrreduce(sizeof(struct hdr));
     packetbuf_set_datalen(chdr->len);
+#if WITH_ADAPTIVE_CHECK_RATE
+    /* The interval the sender checks the channel at */
+    phase_set_cycle_shift(packetbuf_addr(PACKETBUF_ADDR_SENDER),
+                          chdr->id & CHECK_SHIFT_MASK);
+#endif /* WITH_ADAPTIVE_CHECK_RATE */
 #endif /* WITH_CONTIKIMAC_HEADER */
 
     if(packetbuf_datalen() > 0 &&
@@ -963,7 +1188,7 @@ input_packet(void)
         on();
         /* Set a timer to turn the radio off in case we do not receive
 	   a next packet */
-        ctimer_set(&ct, INTER_PACKET_DEADLINE, recv_burst_off, NULL);
+        ctimer_set_urgent(&ct, INTER_PACKET_DEADLINE, recv_burst_off, NULL);
       } else {
         off();
         ctimer_stop(&ct);
@@ -977,6 +1202,12 @@ input_packet(void)
       }
       mac_sequence_register_seqno();
 
+#if WITH_ADAPTIVE_CHECK_RATE
+      if(rx_frames < 0xff) {
+        rx_frames++;
+      }
+#endif /* WITH_ADAPTIVE_CHECK_RATE */
+
 #if CONTIKIMAC_CONF_COMPOWER
       /* Accumulate the power consumption for the packet reception. */
       compower_accumulate(&current_packet);
@@ -1007,15 +1238,18 @@ init(void)
 {
   radio_is_on = 0;
   PT_INIT(&pt);
+#if WITH_MULTICHANNEL
+  broadcast_channel = CONTIKIMAC_CONF_GET_CHANNEL();
+#endif
 
   rtimer_set(&rt, RTIMER_NOW() + CYCLE_TIME, 1,
              (void (*)(struct rtimer *, void *))powercycle, NULL);
 
   contikimac_is_on = 1;
 
-#if WITH_PHASE_OPTIMIZATION
+#if WITH_PHASE_OPTIMIZATION || WITH_ADAPTIVE_CHECK_RATE
   phase_init();
-#endif /* WITH_PHASE_OPTIMIZATION */
+#endif /* WITH_PHASE_OPTIMIZATION || WITH_ADAPTIVE_CHECK_RATE */
 
 }
 /*---------------------------------------------------------------------------*/
@@ -1048,7 +1282,11 @@ turn_off(int keep_radio_on)
 static unsigned short
 duty_cycle(void)
 {
+#if WITH_ADAPTIVE_CHECK_RATE
+  return (1ul * CLOCK_SECOND * CYCLE_TIME << check_shift) / RTIMER_ARCH_SECOND;
+#else
   return (1ul * CLOCK_SECOND * CYCLE_TIME) / RTIMER_ARCH_SECOND;
+#endif
 }
 /*---------------------------------------------------------------------------*/
 const struct rdc_driver contikimac_driver = {
@@ -1061,6 +1299,15 @@ const struct rdc_driver contikimac_driver = {
   turn_off,
   duty_cycle,
 };
+#if NETSTACK_CONF_STATIC
+NETSTACK_STATIC_EXPORT(contikimac_driver_init, init);
+NETSTACK_STATIC_EXPORT(contikimac_driver_send, qsend_packet);
+NETSTACK_STATIC_EXPORT(contikimac_driver_send_list, qsend_list);
+NETSTACK_STATIC_EXPORT(contikimac_driver_input, input_packet);
+NETSTACK_STATIC_EXPORT(contikimac_driver_on, turn_on);
+NETSTACK_STATIC_EXPORT(contikimac_driver_off, turn_off);
+NETSTACK_STATIC_EXPORT(contikimac_driver_channel_check_interval, duty_cycle);
+#endif /* NETSTACK_CONF_STATIC */
 /*---------------------------------------------------------------------------*/
 uint16_t
 contikimac_debug_print(void)
@@ -40,6 +40,7 @@
 #include "net/mac/csma.h"
 #include "net/packetbuf.h"
 #include "net/queuebuf.h"
+#include "net/rime/rimestats.h"
 
 #include "sys/ctimer.h"
 #include "sys/clock.h"
@@ -55,6 +56,50 @@
 
 #include <stdio.h>
 
+/* Packets that find no free queue buffer spill to a FIFO in CFS, so a
+   node can keep forwarding data queued during long parent outages.
+   Only the head and length of the FIFO are kept in RAM. The packets
+   are moved back into the RAM queues in order as buffers are freed. */
+#ifdef CSMA_CONF_SPILL
+#define CSMA_SPILL CSMA_CONF_SPILL
+#else
+#define CSMA_SPILL 0
+#endif /* CSMA_CONF_SPILL */
+
+#if CSMA_SPILL
+/* The FIFO is made of append-only files that are renewed when it wraps
+   around, so the storage never modifies data in place */
+#ifdef CSMA_CONF_SPILL_FILES
+#define CSMA_SPILL_FILES CSMA_CONF_SPILL_FILES
+#else
+#define CSMA_SPILL_FILES 4
+#endif /* CSMA_CONF_SPILL_FILES */
+
+#ifdef CSMA_CONF_SPILL_PER_FILE
+#define CSMA_SPILL_PER_FILE CSMA_CONF_SPILL_PER_FILE
+#else
+#define CSMA_SPILL_PER_FILE 256
+#endif /* CSMA_CONF_SPILL_PER_FILE */
+
+#define CSMA_SPILL_NUM ((uint32_t)CSMA_SPILL_FILES * CSMA_SPILL_PER_FILE)
+
+#if CSMA_SPILL_FILES < 2 || CSMA_SPILL_FILES * CSMA_SPILL_PER_FILE > 0xffff
+#error CSMA_CONF_SPILL_FILES must be at least 2 and the FIFO hold at most 65535 packets.
+#endif
+
+/* Reserve the files in Coffee so that they never have to be moved */
+#ifdef CSMA_CONF_SPILL_COFFEE
+#define CSMA_SPILL_COFFEE CSMA_CONF_SPILL_COFFEE
+#else
+#define CSMA_SPILL_COFFEE 1
+#endif /* CSMA_CONF_SPILL_COFFEE */
+
+#include "cfs/cfs.h"
+#if CSMA_SPILL_COFFEE
+#include "cfs/cfs-coffee.h"
+#endif /* CSMA_SPILL_COFFEE */
+#endif /* CSMA_SPILL */
+
 #define DEBUG 0
 #if DEBUG
 #include <stdio.h>
@@ -84,6 +129,16 @@
 #error Change CSMA_CONF_MAX_MAC_TRANSMISSIONS in contiki-conf.h or in your Makefile.
 #endif /* CSMA_CONF_MAX_MAC_TRANSMISSIONS < 1 */
 
+/* The radio backs off before every attempt and retries unacknowledged
+   frames itself, e.g. the RF230 in extended operating mode. The
+   transmissions it reports count towards the maximum, and the packet is
+   retransmitted without another backoff. */
+#ifdef CSMA_CONF_HARDWARE_CSMA
+#define CSMA_HARDWARE_CSMA CSMA_CONF_HARDWARE_CSMA
+#else
+#define CSMA_HARDWARE_CSMA 0
+#endif /* CSMA_CONF_HARDWARE_CSMA */
+
 /* Packet metadata */
 struct qbuf_metadata {
   mac_callback_t sent;
@@ -98,6 +153,7 @@ struct neighbor_queue {
   struct ctimer transmit_timer;
   uint8_t transmissions;
   uint8_t collisions, deferrals;
+  uint8_t ack_score;
   LIST_STRUCT(queued_packet_list);
 };
 
@@ -109,6 +165,35 @@ struct neighbor_queue {
 #endif /* CSMA_CONF_MAX_NEIGHBOR_QUEUES */
 
 #define MAX_QUEUED_PACKETS QUEUEBUF_NUM
+
+/* The maximum number of packets queued for one neighbor. When all
+   buffers are in use, a new packet replaces the last packet of the
+   longest queue, so an unreachable neighbor cannot hold all of them. */
+#ifdef CSMA_CONF_MAX_PACKET_PER_NEIGHBOR
+#define CSMA_MAX_PACKET_PER_NEIGHBOR CSMA_CONF_MAX_PACKET_PER_NEIGHBOR
+#else
+#define CSMA_MAX_PACKET_PER_NEIGHBOR MAX_QUEUED_PACKETS
+#endif /* CSMA_CONF_MAX_PACKET_PER_NEIGHBOR */
+
+/* The ACK score is a moving average of the acknowledged share of
+   unicast transmissions, ACK_SCORE_MAX meaning all. The retransmission
+   backoff grows up to 5 times as the score drops. The scores of the
+   last CSMA_LINK_HISTORY neighbors are kept when their queue is freed. */
+#define ACK_SCORE_MAX 16
+#ifdef CSMA_CONF_LINK_HISTORY
+#define CSMA_LINK_HISTORY CSMA_CONF_LINK_HISTORY
+#else
+#define CSMA_LINK_HISTORY 4
+#endif /* CSMA_CONF_LINK_HISTORY */
+
+#if CSMA_LINK_HISTORY
+struct link_history {
+  rimeaddr_t addr;
+  uint8_t ack_score;
+};
+static struct link_history link_history[CSMA_LINK_HISTORY];
+static uint8_t link_history_next;
+#endif /* CSMA_LINK_HISTORY */
 MEMB(neighbor_memb, struct neighbor_queue, CSMA_MAX_NEIGHBOR_QUEUES);
 MEMB(packet_memb, struct rdc_buf_list, MAX_QUEUED_PACKETS);
 MEMB(metadata_memb, struct qbuf_metadata, MAX_QUEUED_PACKETS);
@@ -116,6 +201,29 @@ LIST(neighbor_list);
 
 static void packet_sent(void *ptr, int status, int num_transmissions);
 static void transmit_packet_list(void *ptr);
+static void queue_packet(mac_callback_t sent, void *ptr);
+
+#if CSMA_SPILL
+/* A spilled packet is stored as this header, the packetbuf attributes
+   and addresses and the packet */
+struct spill_header {
+  mac_callback_t sent;
+  void *cptr;
+  uint16_t len;
+};
+
+#define SPILL_RECORD_SIZE (sizeof(struct spill_header) +                 \
+                           PACKETBUF_NUM_ATTRS * sizeof(struct packetbuf_attr) + \
+                           PACKETBUF_NUM_ADDRS * sizeof(struct packetbuf_addr) + \
+                           PACKETBUF_SIZE)
+
+static uint16_t spill_head, spill_count;
+static struct ctimer spill_timer;
+/* The file that is being appended to */
+static int spill_fd = -1;
+
+static void spill_refill(void *ptr);
+#endif /* CSMA_SPILL */
 
 /*---------------------------------------------------------------------------*/
 static struct neighbor_queue *
@@ -131,6 +239,51 @@ neighbor_queue_from_addr(const rimeaddr_t *addr)
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
+static void
+update_ack_score(struct neighbor_queue *n, int acked)
+{
+  /* Move a quarter of the way to the new observation */
+  if(acked) {
+    n->ack_score += (ACK_SCORE_MAX - n->ack_score + 3) / 4;
+  } else {
+    n->ack_score -= (n->ack_score + 3) / 4;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+restore_ack_score(const rimeaddr_t *addr)
+{
+#if CSMA_LINK_HISTORY
+  int i;
+  for(i = 0; i < CSMA_LINK_HISTORY; i++) {
+    if(rimeaddr_cmp(&link_history[i].addr, addr)) {
+      return link_history[i].ack_score;
+    }
+  }
+#endif /* CSMA_LINK_HISTORY */
+  return ACK_SCORE_MAX;
+}
+/*---------------------------------------------------------------------------*/
+static void
+save_ack_score(struct neighbor_queue *n)
+{
+#if CSMA_LINK_HISTORY
+  int i;
+  for(i = 0; i < CSMA_LINK_HISTORY; i++) {
+    if(rimeaddr_cmp(&link_history[i].addr, &n->addr)) {
+      break;
+    }
+  }
+  if(i == CSMA_LINK_HISTORY) {
+    /* Replace the oldest entry */
+    i = link_history_next;
+    link_history_next = (link_history_next + 1) % CSMA_LINK_HISTORY;
+    rimeaddr_copy(&link_history[i].addr, &n->addr);
+  }
+  link_history[i].ack_score = n->ack_score;
+#endif /* CSMA_LINK_HISTORY */
+}
+/*---------------------------------------------------------------------------*/
 static clock_time_t
 default_timebase(void)
 {
@@ -175,23 +328,70 @@ free_packet(struct neighbor_queue *n, struct rdc_buf_list *p)
     memb_free(&packet_memb, p);
     PRINTF("csma: free_queued_packet, queue length %d\n",
         list_length(n->queued_packet_list));
+#if CSMA_SPILL
+    if(spill_count > 0) {
+      /* Refill after the sent callback, which still uses the packetbuf */
+      ctimer_set(&spill_timer, 0, spill_refill, NULL);
+    }
+#endif /* CSMA_SPILL */
     if(list_head(n->queued_packet_list) != NULL) {
       /* There is a next packet. We reset current tx information */
       n->transmissions = 0;
       n->collisions = 0;
       n->deferrals = 0;
       /* Set a timer for next transmissions */
-      ctimer_set(&n->transmit_timer, default_timebase(),
-                 transmit_packet_list, n);
+      ctimer_set_urgent(&n->transmit_timer, default_timebase(),
+                        transmit_packet_list, n);
     } else {
       /* This was the last packet in the queue, we free the neighbor */
       ctimer_stop(&n->transmit_timer);
+      save_ack_score(n);
       list_remove(neighbor_list, n);
       memb_free(&neighbor_memb, n);
     }
   }
 }
 /*---------------------------------------------------------------------------*/
+/* Drop the last packet of the longest queue, preferring the neighbor
+   with the worse ACK score, to make room for a packet to another
+   neighbor. The head of a queue may be in transmission and is kept. */
+static int
+drop_from_longest_queue(const struct neighbor_queue *except)
+{
+  struct neighbor_queue *n, *victim;
+  struct rdc_buf_list *q;
+  struct qbuf_metadata *metadata;
+  int len, victim_len;
+
+  victim = NULL;
+  victim_len = 1;
+  for(n = list_head(neighbor_list); n != NULL; n = list_item_next(n)) {
+    if(n == except) {
+      continue;
+    }
+    len = list_length(n->queued_packet_list);
+    if(len > victim_len ||
+       (len == victim_len && victim != NULL && n->ack_score < victim->ack_score)) {
+      victim = n;
+      victim_len = len;
+    }
+  }
+  if(victim == NULL) {
+    return 0;
+  }
+
+  q = list_tail(victim->queued_packet_list);
+  metadata = (struct qbuf_metadata *)q->ptr;
+  PRINTF("csma: dropping a packet of the queue of length %d\n", victim_len);
+  RIMESTATS_ADD(macqueuedrop);
+  list_remove(victim->queued_packet_list, q);
+  queuebuf_free(q->buf);
+  memb_free(&packet_memb, q);
+  mac_call_sent_callback(metadata->sent, metadata->cptr, MAC_TX_ERR, 0);
+  memb_free(&metadata_memb, metadata);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
 static void
 packet_sent(void *ptr, int status, int num_transmissions)
 {
@@ -202,8 +402,10 @@ packet_sent(void *ptr, int status, int num_transmissions)
   mac_callback_t sent;
   void *cptr;
   int num_tx;
+#if !CSMA_HARDWARE_CSMA
   int backoff_exponent;
   int backoff_transmissions;
+#endif /* !CSMA_HARDWARE_CSMA */
 
   n = ptr;
   if(n == NULL) {
@@ -212,9 +414,21 @@ packet_sent(void *ptr, int status, int num_transmissions)
   switch(status) {
   case MAC_TX_OK:
   case MAC_TX_NOACK:
+#if CSMA_HARDWARE_CSMA
+    n->transmissions += num_transmissions > 0 ? num_transmissions : 1;
+#else /* CSMA_HARDWARE_CSMA */
     n->transmissions++;
+#endif /* CSMA_HARDWARE_CSMA */
+    if(!rimeaddr_cmp(&n->addr, &rimeaddr_null)) {
+      update_ack_score(n, status == MAC_TX_OK);
+    }
     break;
   case MAC_TX_COLLISION:
+#if CSMA_HARDWARE_CSMA
+    /* Frames may have gone out unacknowledged before the channel
+       access failed */
+    n->transmissions += num_transmissions;
+#endif /* CSMA_HARDWARE_CSMA */
     n->collisions++;
     break;
   case MAC_TX_DEFERRED:
@@ -246,17 +460,26 @@ packet_sent(void *ptr, int status, int num_transmissions)
         switch(status) {
         case MAC_TX_COLLISION:
           PRINTF("csma: rexmit collision %d\n", n->transmissions);
+          RIMESTATS_ADD(maccollision);
           break;
         case MAC_TX_NOACK:
           PRINTF("csma: rexmit noack %d\n", n->transmissions);
+          RIMESTATS_ADD(macnoack);
           break;
         default:
           PRINTF("csma: rexmit err %d, %d\n", status, n->transmissions);
         }
 
+#if CSMA_HARDWARE_CSMA
+        /* The radio already backed off and retried. Only a busy channel
+           waits a channel check interval before the next attempt. */
+        time = status == MAC_TX_COLLISION ? default_timebase() : 0;
+#else /* CSMA_HARDWARE_CSMA */
         /* The retransmission time must be proportional to the channel
-           check interval of the underlying radio duty cycling layer. */
+           check interval of the underlying radio duty cycling layer.
+           Links that lose many ACKs back off longer. */
         time = default_timebase();
+        time = time * (4 + ACK_SCORE_MAX - n->ack_score) / 4;
 
         /* The retransmission time uses a truncated exponential backoff
          * so that the interval between the transmissions increase with
@@ -274,17 +497,19 @@ packet_sent(void *ptr, int status, int num_transmissions)
         /* Pick a time for next transmission, within the interval:
          * [time, time + 2^backoff_exponent * time[ */
         time = time + (random_rand() % (backoff_transmissions * time));
+#endif /* CSMA_HARDWARE_CSMA */
 
         if(n->transmissions < metadata->max_transmissions) {
           PRINTF("csma: retransmitting with time %lu %p\n", time, q);
-          ctimer_set(&n->transmit_timer, time,
-                     transmit_packet_list, n);
+          ctimer_set_urgent(&n->transmit_timer, time,
+                            transmit_packet_list, n);
           /* This is needed to correctly attribute energy that we spent
              transmitting this packet. */
           queuebuf_update_attr_from_packetbuf(q->buf);
         } else {
           PRINTF("csma: drop with status %d after %d transmissions, %d collisions\n",
                  status, n->transmissions, n->collisions);
+          RIMESTATS_ADD(macdrop);
           free_packet(n, q);
           mac_call_sent_callback(sent, cptr, status, num_tx);
         }
@@ -301,14 +526,154 @@ packet_sent(void *ptr, int status, int num_transmissions)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if CSMA_SPILL
+/* Returns non-zero if a packet to addr can be queued in RAM */
+static int
+has_room(const rimeaddr_t *addr)
+{
+  struct neighbor_queue *n;
+
+  if(memb_numfree(&packet_memb) == 0 || memb_numfree(&metadata_memb) == 0 ||
+     queuebuf_numfree() == 0) {
+    return 0;
+  }
+  n = neighbor_queue_from_addr(addr);
+  if(n == NULL) {
+    return memb_numfree(&neighbor_memb) > 0;
+  }
+  return list_length(n->queued_packet_list) < CSMA_MAX_PACKET_PER_NEIGHBOR;
+}
+/*---------------------------------------------------------------------------*/
+static void
+spill_file_name(char *name, uint16_t slot)
+{
+  memcpy(name, "csmaq", 5);
+  name[5] = 'a' + slot / CSMA_SPILL_PER_FILE;
+  name[6] = '\0';
+}
+/*---------------------------------------------------------------------------*/
+/* Appends the packet in the packetbuf to the spill FIFO */
+static int
+spill_push(mac_callback_t sent, void *ptr)
+{
+  struct spill_header h;
+  uint16_t slot;
+  char name[7];
+  int ok;
+
+  if(spill_count >= CSMA_SPILL_NUM) {
+    return 0;
+  }
+  slot = ((uint32_t)spill_head + spill_count) % CSMA_SPILL_NUM;
+  if(slot % CSMA_SPILL_PER_FILE == 0) {
+    /* The file is only reused once the head has left it */
+    if(spill_count > 0 &&
+       spill_head / CSMA_SPILL_PER_FILE == slot / CSMA_SPILL_PER_FILE) {
+      return 0;
+    }
+    if(spill_fd >= 0) {
+      cfs_close(spill_fd);
+    }
+    spill_file_name(name, slot);
+    cfs_remove(name);
+#if CSMA_SPILL_COFFEE
+    if(cfs_coffee_reserve(name, (cfs_offset_t)CSMA_SPILL_PER_FILE *
+                          SPILL_RECORD_SIZE) < 0) {
+      PRINTF("csma: could not reserve spill file\n");
+      spill_fd = -1;
+      return 0;
+    }
+#endif /* CSMA_SPILL_COFFEE */
+    spill_fd = cfs_open(name, CFS_READ | CFS_WRITE);
+  }
+  if(spill_fd < 0) {
+    return 0;
+  }
+
+  /* The data of referenced packets is given back once it is stored */
+  packetbuf_compact();
+  h.sent = sent;
+  h.cptr = ptr;
+  h.len = packetbuf_totlen();
+  ok = cfs_seek(spill_fd, (cfs_offset_t)(slot % CSMA_SPILL_PER_FILE) *
+                SPILL_RECORD_SIZE, CFS_SEEK_SET) != -1 &&
+    cfs_write(spill_fd, &h, sizeof(h)) == sizeof(h) &&
+    cfs_write(spill_fd, packetbuf_attrs,
+              PACKETBUF_NUM_ATTRS * sizeof(struct packetbuf_attr)) ==
+    PACKETBUF_NUM_ATTRS * sizeof(struct packetbuf_attr) &&
+    cfs_write(spill_fd, packetbuf_addrs,
+              PACKETBUF_NUM_ADDRS * sizeof(struct packetbuf_addr)) ==
+    PACKETBUF_NUM_ADDRS * sizeof(struct packetbuf_addr) &&
+    cfs_write(spill_fd, packetbuf_hdrptr(), h.len) == h.len;
+  if(!ok) {
+    PRINTF("csma: could not write spill file\n");
+    return 0;
+  }
+  spill_count++;
+  PRINTF("csma: spilled packet, %u spilled\n", spill_count);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Loads the head of the spill FIFO into the packetbuf */
+static int
+spill_peek(struct spill_header *h)
+{
+  char name[7];
+  int fd, ok;
+
+  spill_file_name(name, spill_head);
+  fd = cfs_open(name, CFS_READ);
+  if(fd < 0) {
+    return 0;
+  }
+  packetbuf_clear();
+  ok = cfs_seek(fd, (cfs_offset_t)(spill_head % CSMA_SPILL_PER_FILE) *
+                SPILL_RECORD_SIZE, CFS_SEEK_SET) != -1 &&
+    cfs_read(fd, h, sizeof(*h)) == sizeof(*h) &&
+    h->len <= PACKETBUF_SIZE &&
+    cfs_read(fd, packetbuf_attrs,
+             PACKETBUF_NUM_ATTRS * sizeof(struct packetbuf_attr)) ==
+    PACKETBUF_NUM_ATTRS * sizeof(struct packetbuf_attr) &&
+    cfs_read(fd, packetbuf_addrs,
+             PACKETBUF_NUM_ADDRS * sizeof(struct packetbuf_addr)) ==
+    PACKETBUF_NUM_ADDRS * sizeof(struct packetbuf_addr) &&
+    cfs_read(fd, packetbuf_dataptr(), h->len) == h->len;
+  cfs_close(fd);
+  if(ok) {
+    packetbuf_set_datalen(h->len);
+  }
+  return ok;
+}
+/*---------------------------------------------------------------------------*/
+/* Moves spilled packets back into the RAM queues */
+static void
+spill_refill(void *ptr)
+{
+  struct spill_header h;
+  int ok;
+
+  while(spill_count > 0) {
+    ok = spill_peek(&h);
+    if(ok && !has_room(packetbuf_addr(PACKETBUF_ADDR_RECEIVER))) {
+      /* The head waits for its neighbor, so the order is kept */
+      return;
+    }
+    spill_head = ((uint32_t)spill_head + 1) % CSMA_SPILL_NUM;
+    spill_count--;
+    if(ok) {
+      queue_packet(h.sent, h.cptr);
+    } else {
+      PRINTF("csma: could not read spilled packet\n");
+    }
+  }
+}
+#endif /* CSMA_SPILL */
+/*---------------------------------------------------------------------------*/
 static void
 send_packet(mac_callback_t sent, void *ptr)
 {
-  struct rdc_buf_list *q;
-  struct neighbor_queue *n;
   static uint8_t initialized = 0;
   static uint16_t seqno;
-  const rimeaddr_t *addr = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
 
   if(!initialized) {
     initialized = 1;
@@ -323,6 +688,28 @@ send_packet(mac_callback_t sent, void *ptr)
   }
   packetbuf_set_attr(PACKETBUF_ATTR_MAC_SEQNO, seqno++);
 
+#if CSMA_SPILL
+  /* Keep the order of the packets: once packets have spilled, new ones
+     are queued behind them. ACKs are urgent and never spill. */
+  if(packetbuf_attr(PACKETBUF_ATTR_PACKET_TYPE) !=
+     PACKETBUF_ATTR_PACKET_TYPE_ACK &&
+     (spill_count > 0 ||
+      !has_room(packetbuf_addr(PACKETBUF_ADDR_RECEIVER))) &&
+     spill_push(sent, ptr)) {
+    return;
+  }
+#endif /* CSMA_SPILL */
+
+  queue_packet(sent, ptr);
+}
+/*---------------------------------------------------------------------------*/
+static void
+queue_packet(mac_callback_t sent, void *ptr)
+{
+  struct rdc_buf_list *q;
+  struct neighbor_queue *n;
+  const rimeaddr_t *addr = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
+
   /* Look for the neighbor entry */
   n = neighbor_queue_from_addr(addr);
   if(n == NULL) {
@@ -334,6 +721,7 @@ send_packet(mac_callback_t sent, void *ptr)
       n->transmissions = 0;
       n->collisions = 0;
       n->deferrals = 0;
+      n->ack_score = restore_ack_score(addr);
       /* Init packet list for this neighbor */
       LIST_STRUCT_INIT(n, queued_packet_list);
       /* Add neighbor to the list */
@@ -342,6 +730,16 @@ send_packet(mac_callback_t sent, void *ptr)
   }
 
   if(n != NULL) {
+    if(list_length(n->queued_packet_list) >= CSMA_MAX_PACKET_PER_NEIGHBOR) {
+      PRINTF("csma: neighbor queue full, dropping packet\n");
+      RIMESTATS_ADD(macqueuedrop);
+      mac_call_sent_callback(sent, ptr, MAC_TX_ERR, 1);
+      return;
+    }
+    /* Make room if other neighbors use all buffers */
+    if(memb_numfree(&packet_memb) == 0 || queuebuf_numfree() == 0) {
+      drop_from_longest_queue(n);
+    }
     /* Add packet to the neighbor's queue */
     q = memb_alloc(&packet_memb);
     if(q != NULL) {
@@ -370,7 +768,7 @@ send_packet(mac_callback_t sent, void *ptr)
 
 	  /* If q is the first packet in the neighbor's queue, send asap */
 	  if(list_head(n->queued_packet_list) == q) {
-	    ctimer_set(&n->transmit_timer, 0, transmit_packet_list, n);
+	    ctimer_set_urgent(&n->transmit_timer, 0, transmit_packet_list, n);
 	  }
 	  return;
 	}
@@ -389,6 +787,7 @@ send_packet(mac_callback_t sent, void *ptr)
   } else {
     PRINTF("csma: could not allocate neighbor, dropping packet\n");
   }
+  RIMESTATS_ADD(macqueuedrop);
   mac_call_sent_callback(sent, ptr, MAC_TX_ERR, 1);
 }
 /*---------------------------------------------------------------------------*/
@@ -436,4 +835,12 @@ const struct mac_driver csma_driver = {
   off,
   channel_check_interval,
 };
+#if NETSTACK_CONF_STATIC
+NETSTACK_STATIC_EXPORT(csma_driver_init, init);
+NETSTACK_STATIC_EXPORT(csma_driver_send, send_packet);
+NETSTACK_STATIC_EXPORT(csma_driver_input, input_packet);
+NETSTACK_STATIC_EXPORT(csma_driver_on, on);
+NETSTACK_STATIC_EXPORT(csma_driver_off, off);
+NETSTACK_STATIC_EXPORT(csma_driver_channel_check_interval, channel_check_interval);
+#endif /* NETSTACK_CONF_STATIC */
 /*---------------------------------------------------------------------------*/
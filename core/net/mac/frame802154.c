@@ -65,82 +65,59 @@
 #include "net/mac/frame802154.h"
 #include <string.h>
 
-/**
- *  \brief Structure that contains the lengths of the various addressing and security fields
- *  in the 802.15.4 header.  This structure is used in \ref frame802154_create()
+/*
+ * Precomputed header layouts. The length of the header only depends on
+ * the address modes and the PAN ID compression bit of the FCF, so it is
+ * looked up instead of being added up from the field lengths for every
+ * frame. LAYOUT() builds the index from the two raw FCF bytes.
  */
-typedef struct {
-  uint8_t dest_pid_len;    /**<  Length (in bytes) of destination PAN ID field */
-  uint8_t dest_addr_len;   /**<  Length (in bytes) of destination address field */
-  uint8_t src_pid_len;     /**<  Length (in bytes) of source PAN ID field */
-  uint8_t src_addr_len;    /**<  Length (in bytes) of source address field */
-  uint8_t aux_sec_len;     /**<  Length (in bytes) of aux security header field */
-} field_length_t;
+#define LAYOUT(fcf0, fcf1) ((((fcf1) >> 2) & 3) | (((fcf1) >> 4) & 0x0c) | \
+                            (((fcf0) >> 2) & 0x10))
+#define LAYOUT_ACK         LAYOUT(0, 0)
 
-/*----------------------------------------------------------------------------*/
-CC_INLINE static uint8_t
-addr_len(uint8_t mode)
-{
-  switch(mode) {
-  case FRAME802154_SHORTADDRMODE:  /* 16-bit address */
-    return 2;
-  case FRAME802154_LONGADDRMODE:   /* 64-bit address */
-    return 8;
-  default:
-    return 0;
-  }
-}
+#define PID_LEN(mode)  ((mode) ? 2 : 0)
+#define ADDR_LEN(mode) ((mode) == FRAME802154_SHORTADDRMODE ? 2 : \
+                        ((mode) == FRAME802154_LONGADDRMODE ? 8 : 0))
+#define HDR_LEN(dest, src, comp) (3 + PID_LEN(dest) + ADDR_LEN(dest) + \
+                                  ((comp) ? 0 : PID_LEN(src)) + ADDR_LEN(src))
+#define HDR_LENS(src, comp) HDR_LEN(0, src, comp), HDR_LEN(1, src, comp), \
+                            HDR_LEN(2, src, comp), HDR_LEN(3, src, comp)
+
+static const uint8_t hdr_lens[32] = {
+  HDR_LENS(0, 0), HDR_LENS(1, 0), HDR_LENS(2, 0), HDR_LENS(3, 0),
+  HDR_LENS(0, 1), HDR_LENS(1, 1), HDR_LENS(2, 1), HDR_LENS(3, 1)
+};
+
+static const uint8_t addr_lens[4] = {
+  ADDR_LEN(0), ADDR_LEN(1), ADDR_LEN(2), ADDR_LEN(3)
+};
 /*----------------------------------------------------------------------------*/
 static void
-field_len(frame802154_t *p, field_length_t *flen)
+create_fcf(frame802154_t *p, uint8_t *fcf)
 {
-  /* init flen to zeros */
-  memset(flen, 0, sizeof(field_length_t));
-
-  /* Determine lengths of each field based on fcf and other args */
-  if(p->fcf.dest_addr_mode & 3) {
-    flen->dest_pid_len = 2;
-  }
-  if(p->fcf.src_addr_mode & 3) {
-    flen->src_pid_len = 2;
-  }
-
   /* Set PAN ID compression bit if src pan id matches dest pan id. */
-  if(p->fcf.dest_addr_mode & 3 && p->fcf.src_addr_mode & 3 &&
-     p->src_pid == p->dest_pid) {
-    p->fcf.panid_compression = 1;
+  p->fcf.panid_compression = (p->fcf.dest_addr_mode & 3) &&
+    (p->fcf.src_addr_mode & 3) && p->src_pid == p->dest_pid;
 
-    /* compressed header, only do dest pid */
-    flen->src_pid_len = 0;
-  } else {
-    p->fcf.panid_compression = 0;
-  }
-
-  /* determine address lengths */
-  flen->dest_addr_len = addr_len(p->fcf.dest_addr_mode & 3);
-  flen->src_addr_len = addr_len(p->fcf.src_addr_mode & 3);
+  fcf[0] = (p->fcf.frame_type & 7) |
+    ((p->fcf.security_enabled & 1) << 3) |
+    ((p->fcf.frame_pending & 1) << 4) |
+    ((p->fcf.ack_required & 1) << 5) |
+    ((p->fcf.panid_compression & 1) << 6);
+  fcf[1] = ((p->fcf.dest_addr_mode & 3) << 2) |
+    ((p->fcf.frame_version & 3) << 4) |
+    ((p->fcf.src_addr_mode & 3) << 6);
 
-  /* Aux security header */
-  if(p->fcf.security_enabled & 1) {
-    /* TODO Aux security header not yet implemented */
-#if 0
-    switch(p->aux_hdr.security_control.key_id_mode) {
-    case 0:
-      flen->aux_sec_len = 5; /* minimum value */
-      break;
-    case 1:
-      flen->aux_sec_len = 6;
-      break;
-    case 2:
-      flen->aux_sec_len = 10;
-      break;
-    case 3:
-      flen->aux_sec_len = 14;
-      break;
-    default:
-      break;
-    }
-#endif
+  /* TODO Aux security header not yet implemented */
+}
+/*----------------------------------------------------------------------------*/
+/* Copies an address in the reversed byte order of the air. */
+CC_INLINE static void
+copy_addr(uint8_t *dst, const uint8_t *src, uint8_t len)
+{
+  src += len;
+  while(len-- > 0) {
+    *dst++ = *--src;
   }
 }
 /*----------------------------------------------------------------------------*/
@@ -156,10 +133,9 @@ field_len(frame802154_t *p, field_length_t *flen)
 int
 frame802154_hdrlen(frame802154_t *p)
 {
-  field_length_t flen;
-  field_len(p, &flen);
-  return 3 + flen.dest_pid_len + flen.dest_addr_len +
-    flen.src_pid_len + flen.src_addr_len + flen.aux_sec_len;
+  uint8_t fcf[2];
+  create_fcf(p, fcf);
+  return hdr_lens[LAYOUT(fcf[0], fcf[1])];
 }
 /*----------------------------------------------------------------------------*/
 /**
@@ -179,64 +155,42 @@ frame802154_hdrlen(frame802154_t *p)
 int
 frame802154_create(frame802154_t *p, uint8_t *buf, int buf_len)
 {
-  int c;
-  field_length_t flen;
-  uint8_t *tx_frame_buffer;
+  uint8_t fcf[2];
+  uint8_t len;
   uint8_t pos;
 
-  field_len(p, &flen);
-
-  if(3 + flen.dest_pid_len + flen.dest_addr_len +
-     flen.src_pid_len + flen.src_addr_len + flen.aux_sec_len > buf_len) {
+  create_fcf(p, fcf);
+  len = hdr_lens[LAYOUT(fcf[0], fcf[1])];
+  if(len > buf_len) {
     /* Too little space for headers. */
     return 0;
   }
 
-  /* OK, now we have field lengths.  Time to actually construct */
-  /* the outgoing frame, and store it in tx_frame_buffer */
-  tx_frame_buffer = buf;
-  tx_frame_buffer[0] = (p->fcf.frame_type & 7) |
-    ((p->fcf.security_enabled & 1) << 3) |
-    ((p->fcf.frame_pending & 1) << 4) |
-    ((p->fcf.ack_required & 1) << 5) |
-    ((p->fcf.panid_compression & 1) << 6);
-  tx_frame_buffer[1] = ((p->fcf.dest_addr_mode & 3) << 2) |
-    ((p->fcf.frame_version & 3) << 4) |
-    ((p->fcf.src_addr_mode & 3) << 6);
+  buf[0] = fcf[0];
+  buf[1] = fcf[1];
 
   /* sequence number */
-  tx_frame_buffer[2] = p->seq;
+  buf[2] = p->seq;
   pos = 3;
 
-  /* Destination PAN ID */
-  if(flen.dest_pid_len == 2) {
-    tx_frame_buffer[pos++] = p->dest_pid & 0xff;
-    tx_frame_buffer[pos++] = (p->dest_pid >> 8) & 0xff;
-  }
-
-  /* Destination address */
-  for(c = flen.dest_addr_len; c > 0; c--) {
-    tx_frame_buffer[pos++] = p->dest_addr[c - 1];
-  }
-
-  /* Source PAN ID */
-  if(flen.src_pid_len == 2) {
-    tx_frame_buffer[pos++] = p->src_pid & 0xff;
-    tx_frame_buffer[pos++] = (p->src_pid >> 8) & 0xff;
-  }
-
-  /* Source address */
-  for(c = flen.src_addr_len; c > 0; c--) {
-    tx_frame_buffer[pos++] = p->src_addr[c - 1];
+  /* Destination PAN ID and address */
+  if(p->fcf.dest_addr_mode & 3) {
+    buf[pos++] = p->dest_pid & 0xff;
+    buf[pos++] = (p->dest_pid >> 8) & 0xff;
+    copy_addr(&buf[pos], p->dest_addr, addr_lens[p->fcf.dest_addr_mode & 3]);
+    pos += addr_lens[p->fcf.dest_addr_mode & 3];
   }
 
-  /* Aux header */
-  if(flen.aux_sec_len) {
-    /* TODO Aux security header not yet implemented */
-/*     pos += flen.aux_sec_len; */
+  /* Source PAN ID and address */
+  if(p->fcf.src_addr_mode & 3) {
+    if(!p->fcf.panid_compression) {
+      buf[pos++] = p->src_pid & 0xff;
+      buf[pos++] = (p->src_pid >> 8) & 0xff;
+    }
+    copy_addr(&buf[pos], p->src_addr, addr_lens[p->fcf.src_addr_mode & 3]);
   }
 
-  return (int)pos;
+  return len;
 }
 /*----------------------------------------------------------------------------*/
 /**
@@ -253,13 +207,19 @@ frame802154_parse(uint8_t *data, int len, frame802154_t *pf)
 {
   uint8_t *p;
   frame802154_fcf_t fcf;
-  int c;
+  uint8_t layout;
+  uint8_t hdr_len;
 
   if(len < 3) {
     return 0;
   }
 
   p = data;
+  layout = LAYOUT(p[0], p[1]);
+  hdr_len = hdr_lens[layout];
+  if(hdr_len > len) {
+    return 0;
+  }
 
   /* decode the FCF */
   fcf.frame_type = p[0] & 7;
@@ -275,6 +235,20 @@ frame802154_parse(uint8_t *data, int len, frame802154_t *pf)
   /* copy fcf and seqNum */
   memcpy(&pf->fcf, &fcf, sizeof(frame802154_fcf_t));
   pf->seq = p[2];
+
+  /* header length, the aux security header is not yet implemented */
+  pf->payload_len = len - hdr_len;
+  pf->payload = data + hdr_len;
+
+  if(layout == LAYOUT_ACK) {
+    /* ACK, no addressing fields */
+    rimeaddr_copy((rimeaddr_t *)&(pf->dest_addr), &rimeaddr_null);
+    rimeaddr_copy((rimeaddr_t *)&(pf->src_addr), &rimeaddr_null);
+    pf->dest_pid = 0;
+    pf->src_pid = 0;
+    return hdr_len;
+  }
+
   p += 3;                             /* Skip first three bytes */
 
   /* Destination address, if any */
@@ -284,22 +258,11 @@ frame802154_parse(uint8_t *data, int len, frame802154_t *pf)
     p += 2;
 
     /* Destination address */
-/*     l = addr_len(fcf.dest_addr_mode); */
-/*     for(c = 0; c < l; c++) { */
-/*       pf->dest_addr.u8[c] = p[l - c - 1]; */
-/*     } */
-/*     p += l; */
     if(fcf.dest_addr_mode == FRAME802154_SHORTADDRMODE) {
       rimeaddr_copy((rimeaddr_t *)&(pf->dest_addr), &rimeaddr_null);
-      pf->dest_addr[0] = p[1];
-      pf->dest_addr[1] = p[0];
-      p += 2;
-    } else if(fcf.dest_addr_mode == FRAME802154_LONGADDRMODE) {
-      for(c = 0; c < 8; c++) {
-        pf->dest_addr[c] = p[7 - c];
-      }
-      p += 8;
     }
+    copy_addr(pf->dest_addr, p, addr_lens[fcf.dest_addr_mode]);
+    p += addr_lens[fcf.dest_addr_mode];
   } else {
     rimeaddr_copy((rimeaddr_t *)&(pf->dest_addr), &rimeaddr_null);
     pf->dest_pid = 0;
@@ -316,40 +279,16 @@ frame802154_parse(uint8_t *data, int len, frame802154_t *pf)
     }
 
     /* Source address */
-/*     l = addr_len(fcf.src_addr_mode); */
-/*     for(c = 0; c < l; c++) { */
-/*       pf->src_addr.u8[c] = p[l - c - 1]; */
-/*     } */
-/*     p += l; */
     if(fcf.src_addr_mode == FRAME802154_SHORTADDRMODE) {
       rimeaddr_copy((rimeaddr_t *)&(pf->src_addr), &rimeaddr_null);
-      pf->src_addr[0] = p[1];
-      pf->src_addr[1] = p[0];
-      p += 2;
-    } else if(fcf.src_addr_mode == FRAME802154_LONGADDRMODE) {
-      for(c = 0; c < 8; c++) {
-        pf->src_addr[c] = p[7 - c];
-      }
-      p += 8;
     }
+    copy_addr(pf->src_addr, p, addr_lens[fcf.src_addr_mode]);
   } else {
     rimeaddr_copy((rimeaddr_t *)&(pf->src_addr), &rimeaddr_null);
     pf->src_pid = 0;
   }
 
-  if(fcf.security_enabled) {
-    /* TODO aux security header, not yet implemented */
-/*     return 0; */
-  }
-
-  /* header length */
-  c = p - data;
-  /* payload length */
-  pf->payload_len = (len - c);
-  /* payload */
-  pf->payload = p;
-
   /* return header length if successful */
-  return c > len ? 0 : c;
+  return hdr_len;
 }
 /** \}   */
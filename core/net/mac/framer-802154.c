@@ -39,6 +39,7 @@
 #include "net/mac/framer-802154.h"
 #include "net/mac/frame802154.h"
 #include "net/packetbuf.h"
+#include "net/netstack.h"
 #include "lib/random.h"
 #include <string.h>
 
@@ -220,3 +221,7 @@ parse(void)
 const struct framer framer_802154 = {
   create, parse
 };
+#if NETSTACK_CONF_STATIC
+NETSTACK_STATIC_EXPORT(framer_802154_create, create);
+NETSTACK_STATIC_EXPORT(framer_802154_parse, parse);
+#endif /* NETSTACK_CONF_STATIC */
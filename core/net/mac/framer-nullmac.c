@@ -38,6 +38,7 @@
 
 #include "net/mac/framer-nullmac.h"
 #include "net/packetbuf.h"
+#include "net/netstack.h"
 
 #define DEBUG 0
 
@@ -93,3 +94,7 @@ parse(void)
 const struct framer framer_nullmac = {
   create, parse
 };
+#if NETSTACK_CONF_STATIC
+NETSTACK_STATIC_EXPORT(framer_nullmac_create, create);
+NETSTACK_STATIC_EXPORT(framer_nullmac_parse, parse);
+#endif /* NETSTACK_CONF_STATIC */
@@ -48,19 +48,114 @@
 #include "net/mac/mac-sequence.h"
 #include "net/packetbuf.h"
 #include "net/rime.h"
-
-struct seqno {
-  rimeaddr_t sender;
-  uint8_t seqno;
-};
+#include "net/nbr-table.h"
 
 #ifdef NETSTACK_CONF_MAC_SEQNO_HISTORY
 #define MAX_SEQNOS NETSTACK_CONF_MAC_SEQNO_HISTORY
 #else /* NETSTACK_CONF_MAC_SEQNO_HISTORY */
 #define MAX_SEQNOS 16
 #endif /* NETSTACK_CONF_MAC_SEQNO_HISTORY */
+
+/* Keep the sequence numbers with the neighbor in the nbr-table rather
+   than in a history of the last MAX_SEQNOS senders */
+#ifdef NETSTACK_CONF_MAC_SEQNO_NBR_TABLE
+#define MAC_SEQNO_NBR_TABLE NETSTACK_CONF_MAC_SEQNO_NBR_TABLE
+#else /* NETSTACK_CONF_MAC_SEQNO_NBR_TABLE */
+#define MAC_SEQNO_NBR_TABLE 0
+#endif /* NETSTACK_CONF_MAC_SEQNO_NBR_TABLE */
+
+/* Number of sequence numbers before the last one that are remembered */
+#define WINDOW 8
+
+/* The last sequence number of a sender, and a bitmap of the ones
+   before it that were received, bit 0 is seqno - 1. A late
+   retransmission is caught even after a newer frame of the sender. */
+struct seqno_window {
+  uint8_t seqno;
+  uint8_t seen;
+};
+
+#if MAC_SEQNO_NBR_TABLE
+NBR_TABLE(struct seqno_window, seqno_windows);
+#else /* MAC_SEQNO_NBR_TABLE */
+struct seqno {
+  rimeaddr_t sender;
+  struct seqno_window window;
+};
+
 static struct seqno received_seqnos[MAX_SEQNOS];
+#endif /* MAC_SEQNO_NBR_TABLE */
+
+/*---------------------------------------------------------------------------*/
+static int
+window_has(const struct seqno_window *w, uint8_t seqno)
+{
+  uint8_t d;
+
+  d = w->seqno - seqno;
+  if(d == 0) {
+    return 1;
+  }
+  return d <= WINDOW && (w->seen & (1 << (d - 1)));
+}
+/*---------------------------------------------------------------------------*/
+static void
+window_add(struct seqno_window *w, uint8_t seqno)
+{
+  int8_t d;
+
+  d = (int8_t)(seqno - w->seqno);
+  if(d > 0) {
+    /* A newer frame moves the window */
+    w->seen = d > WINDOW ? 0 : (uint8_t)((w->seen << d) | (1 << (d - 1)));
+    w->seqno = seqno;
+  } else if(d < 0 && d >= -WINDOW) {
+    w->seen |= 1 << (-d - 1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+#if MAC_SEQNO_NBR_TABLE
+void
+mac_sequence_init(void)
+{
+  nbr_table_register(seqno_windows, NULL);
+}
+/*---------------------------------------------------------------------------*/
+int
+mac_sequence_is_duplicate(void)
+{
+  struct seqno_window *w;
 
+  w = nbr_table_get_from_lladdr(seqno_windows,
+                                packetbuf_addr(PACKETBUF_ADDR_SENDER));
+  return w != NULL && window_has(w, packetbuf_attr(PACKETBUF_ATTR_PACKET_ID));
+}
+/*---------------------------------------------------------------------------*/
+void
+mac_sequence_register_seqno(void)
+{
+  struct seqno_window *w;
+  const rimeaddr_t *sender;
+
+  sender = packetbuf_addr(PACKETBUF_ADDR_SENDER);
+  w = nbr_table_get_from_lladdr(seqno_windows, sender);
+  if(w == NULL) {
+    w = nbr_table_add_lladdr(seqno_windows, sender);
+    if(w == NULL) {
+      return;
+    }
+    w->seqno = packetbuf_attr(PACKETBUF_ATTR_PACKET_ID);
+    w->seen = 0;
+    return;
+  }
+  window_add(w, packetbuf_attr(PACKETBUF_ATTR_PACKET_ID));
+}
+#else /* MAC_SEQNO_NBR_TABLE */
+/*---------------------------------------------------------------------------*/
+void
+mac_sequence_init(void)
+{
+}
 /*---------------------------------------------------------------------------*/
 int
 mac_sequence_is_duplicate(void)
@@ -74,11 +169,8 @@ mac_sequence_is_duplicate(void)
   for(i = 0; i < MAX_SEQNOS; ++i) {
     if(rimeaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_SENDER),
                     &received_seqnos[i].sender)) {
-      if(packetbuf_attr(PACKETBUF_ATTR_PACKET_ID) == received_seqnos[i].seqno) {
-        /* Duplicate packet. */
-        return 1;
-      }
-      break;
+      return window_has(&received_seqnos[i].window,
+                        packetbuf_attr(PACKETBUF_ATTR_PACKET_ID));
     }
   }
   return 0;
@@ -87,23 +179,32 @@ mac_sequence_is_duplicate(void)
 void
 mac_sequence_register_seqno(void)
 {
+  struct seqno s;
   int i, j;
 
   /* Locate possible previous sequence number for this address. */
   for(i = 0; i < MAX_SEQNOS; ++i) {
     if(rimeaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_SENDER),
                     &received_seqnos[i].sender)) {
-      i++;
       break;
     }
   }
 
+  if(i < MAX_SEQNOS) {
+    memcpy(&s, &received_seqnos[i], sizeof(struct seqno));
+    window_add(&s.window, packetbuf_attr(PACKETBUF_ATTR_PACKET_ID));
+  } else {
+    i = MAX_SEQNOS - 1;
+    rimeaddr_copy(&s.sender, packetbuf_addr(PACKETBUF_ADDR_SENDER));
+    s.window.seqno = packetbuf_attr(PACKETBUF_ATTR_PACKET_ID);
+    s.window.seen = 0;
+  }
+
   /* Keep the last sequence number for each address as per 802.15.4e. */
-  for(j = i - 1; j > 0; --j) {
+  for(j = i; j > 0; --j) {
     memcpy(&received_seqnos[j], &received_seqnos[j - 1], sizeof(struct seqno));
   }
-  received_seqnos[0].seqno = packetbuf_attr(PACKETBUF_ATTR_PACKET_ID);
-  rimeaddr_copy(&received_seqnos[0].sender,
-                packetbuf_addr(PACKETBUF_ADDR_SENDER));
+  memcpy(&received_seqnos[0], &s, sizeof(struct seqno));
 }
+#endif /* MAC_SEQNO_NBR_TABLE */
 /*---------------------------------------------------------------------------*/
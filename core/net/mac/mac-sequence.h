@@ -45,13 +45,20 @@
 #ifndef MAC_SEQUENCE_H
 #define MAC_SEQUENCE_H
 
+/**
+ * \brief      Initialize the sequence number history
+ *
+ *             This function is called by netstack_init().
+ */
+void mac_sequence_init(void);
+
 /**
  * \brief      Tell whether the packetbuf is a duplicate packet
  * \return     Non-zero if the packetbuf is a duplicate packet, zero otherwise
  *
  *             This function is used to check for duplicate packet by comparing
  *             the sequence number of the incoming packet with the last few ones
- *             we saw, filtering with the Rime address.
+ *             we saw from the same sender, filtering with the Rime address.
  */
 int mac_sequence_is_duplicate(void);
 
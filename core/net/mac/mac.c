@@ -31,6 +31,8 @@
  */
 
 #include "net/mac/mac.h"
+#include "net/link-stats.h"
+#include "net/packetbuf.h"
 
 #define DEBUG 0
 #if DEBUG
@@ -60,6 +62,12 @@ mac_call_sent_callback(mac_callback_t sent, void *ptr, int status, int num_tx)
     PRINTF("mac: error %d after %d tx\n", status, num_tx);
   }
 
+  link_stats_packet_sent(packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
+                         status, num_tx);
+
+  /* Hand attached payloads back before the sender may queue the next */
+  packetbuf_release();
+
   if(sent) {
     sent(ptr, status, num_tx);
   }
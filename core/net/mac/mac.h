@@ -46,6 +46,8 @@
 
 typedef void (* mac_callback_t)(void *ptr, int status, int transmissions);
 
+struct rdc_buf_list;
+
 void mac_call_sent_callback(mac_callback_t sent, void *ptr, int status, int num_tx);
 
 /**
@@ -71,6 +73,9 @@ struct mac_driver {
 
   /** Returns the channel check interval, expressed in clock_time_t ticks. */
   unsigned short (* channel_check_interval)(void);
+
+  /** Send a packet list in one burst, NULL if not supported */
+  void (* send_list)(mac_callback_t sent_callback, void *ptr, struct rdc_buf_list *list);
 };
 
 /* Generic MAC return values. */
@@ -49,6 +49,12 @@ send_packet(mac_callback_t sent, void *ptr)
 }
 /*---------------------------------------------------------------------------*/
 static void
+send_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list)
+{
+  NETSTACK_RDC.send_list(sent, ptr, buf_list);
+}
+/*---------------------------------------------------------------------------*/
+static void
 packet_input(void)
 {
   NETSTACK_NETWORK.input();
@@ -85,5 +91,15 @@ const struct mac_driver nullmac_driver = {
   on,
   off,
   channel_check_interval,
+  send_list,
 };
+#if NETSTACK_CONF_STATIC
+NETSTACK_STATIC_EXPORT(nullmac_driver_init, init);
+NETSTACK_STATIC_EXPORT(nullmac_driver_send, send_packet);
+NETSTACK_STATIC_EXPORT(nullmac_driver_input, packet_input);
+NETSTACK_STATIC_EXPORT(nullmac_driver_on, on);
+NETSTACK_STATIC_EXPORT(nullmac_driver_off, off);
+NETSTACK_STATIC_EXPORT(nullmac_driver_channel_check_interval, channel_check_interval);
+NETSTACK_STATIC_EXPORT(nullmac_driver_send_list, send_list);
+#endif /* NETSTACK_CONF_STATIC */
 /*---------------------------------------------------------------------------*/
@@ -114,6 +114,7 @@ send_one_packet(mac_callback_t sent, void *ptr)
 {
   int ret;
   int last_sent_ok = 0;
+  int num_tx;
 
   packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &rimeaddr_node_addr);
 #if NULLRDC_802154_AUTOACK || NULLRDC_802154_AUTOACK_HW
@@ -126,10 +127,16 @@ send_one_packet(mac_callback_t sent, void *ptr)
     ret = MAC_TX_ERR_FATAL;
   } else {
 
+    /* The radio needs the header and referenced data in one piece */
+    packetbuf_compact();
+
 #ifdef NETSTACK_ENCRYPT
     NETSTACK_ENCRYPT();
 #endif /* NETSTACK_ENCRYPT */
 
+    /* Radios that retry in hardware set the number of frames they sent */
+    packetbuf_set_attr(PACKETBUF_ATTR_MAC_TRANSMISSIONS, 0);
+
 #if NULLRDC_802154_AUTOACK
     int is_broadcast;
     uint8_t dsn;
@@ -207,6 +214,10 @@ send_one_packet(mac_callback_t sent, void *ptr)
       case RADIO_TX_COLLISION:
         ret = MAC_TX_COLLISION;
         break;
+      case RADIO_TX_NOACK:
+        /* The radio waited for the ACK itself */
+        ret = MAC_TX_NOACK;
+        break;
       default:
         ret = MAC_TX_ERR;
         break;
@@ -235,7 +246,12 @@ send_one_packet(mac_callback_t sent, void *ptr)
   if(ret == MAC_TX_OK) {
     last_sent_ok = 1;
   }
-  mac_call_sent_callback(sent, ptr, ret, 1);
+  num_tx = packetbuf_attr(PACKETBUF_ATTR_MAC_TRANSMISSIONS);
+  if(num_tx == 0 && ret != MAC_TX_COLLISION) {
+    /* The radio sent the frame once, or did not count */
+    num_tx = 1;
+  }
+  mac_call_sent_callback(sent, ptr, ret, num_tx);
   return last_sent_ok;
 }
 /*---------------------------------------------------------------------------*/
@@ -287,12 +303,14 @@ packet_input(void)
 #endif /* NULLRDC_802154_AUTOACK */
   if(NETSTACK_FRAMER.parse() < 0) {
     PRINTF("nullrdc: failed to parse %u\n", packetbuf_datalen());
+    RIMESTATS_ADD(rdcdrop);
 #if NULLRDC_ADDRESS_FILTER
   } else if(!rimeaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
                                          &rimeaddr_node_addr) &&
             !rimeaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
                           &rimeaddr_null)) {
     PRINTF("nullrdc: not for us\n");
+    RIMESTATS_ADD(rdcdrop);
 #endif /* NULLRDC_ADDRESS_FILTER */
   } else {
     int duplicate = 0;
@@ -304,6 +322,7 @@ packet_input(void)
       /* Drop the packet. */
       PRINTF("nullrdc: drop duplicate link layer packet %u\n",
              packetbuf_attr(PACKETBUF_ATTR_PACKET_ID));
+      RIMESTATS_ADD(rdcdrop);
     } else {
       mac_sequence_register_seqno();
     }
@@ -370,4 +389,13 @@ const struct rdc_driver nullrdc_driver = {
   off,
   channel_check_interval,
 };
+#if NETSTACK_CONF_STATIC
+NETSTACK_STATIC_EXPORT(nullrdc_driver_init, init);
+NETSTACK_STATIC_EXPORT(nullrdc_driver_send, send_packet);
+NETSTACK_STATIC_EXPORT(nullrdc_driver_send_list, send_list);
+NETSTACK_STATIC_EXPORT(nullrdc_driver_input, packet_input);
+NETSTACK_STATIC_EXPORT(nullrdc_driver_on, on);
+NETSTACK_STATIC_EXPORT(nullrdc_driver_off, off);
+NETSTACK_STATIC_EXPORT(nullrdc_driver_channel_check_interval, channel_check_interval);
+#endif /* NETSTACK_CONF_STATIC */
 /*---------------------------------------------------------------------------*/
@@ -57,6 +57,10 @@ struct phase {
 #endif
   uint8_t noacks;
   struct timer noacks_timer;
+#if PHASE_CYCLE_SHIFT
+  uint8_t cycle_shift;
+  uint8_t locked;
+#endif
 };
 
 struct phase_queueitem {
@@ -101,6 +105,9 @@ phase_update(const rimeaddr_t *neighbor, rtimer_clock_t time,
       e->drift = time-e->time;
 #endif
       e->time = time;
+#if PHASE_CYCLE_SHIFT
+      e->locked = 1;
+#endif
     }
     /* If the neighbor didn't reply to us, it may have switched
        phase (rebooted). We try a number of transmissions to it
@@ -113,7 +120,13 @@ phase_update(const rimeaddr_t *neighbor, rtimer_clock_t time,
       }
       if(e->noacks >= MAX_NOACKS || timer_expired(&e->noacks_timer)) {
         PRINTF("drop %d\n", neighbor->u8[0]);
+#if PHASE_CYCLE_SHIFT
+        /* Keep the advertised interval, forget the phase only */
+        e->locked = 0;
+        e->noacks = 0;
+#else
         nbr_table_remove(nbr_phase, e);
+#endif
         return;
       }
     } else if(mac_status == MAC_TX_OK) {
@@ -129,6 +142,10 @@ phase_update(const rimeaddr_t *neighbor, rtimer_clock_t time,
       e->drift = 0;
 #endif
       e->noacks = 0;
+#if PHASE_CYCLE_SHIFT
+      e->cycle_shift = 0;
+      e->locked = 1;
+#endif
       }
     }
   }
@@ -163,7 +180,11 @@ phase_wait(const rimeaddr_t *neighbor, rtimer_clock_t cycle_time,
      time for the next expected phase and setup a ctimer to switch on
      the radio just before the phase. */
   e = nbr_table_get_from_lladdr(nbr_phase, neighbor);
+#if PHASE_CYCLE_SHIFT
+  if(e != NULL && e->locked) {
+#else
   if(e != NULL) {
+#endif
     rtimer_clock_t wait, now, expected, sync;
     clock_time_t ctimewait;
     
@@ -237,6 +258,57 @@ phase_wait(const rimeaddr_t *neighbor, rtimer_clock_t cycle_time,
   return PHASE_UNKNOWN;
 }
 /*---------------------------------------------------------------------------*/
+#if PHASE_CYCLE_SHIFT
+void
+phase_set_cycle_shift(const rimeaddr_t *neighbor, uint8_t shift)
+{
+  struct phase *e;
+
+  e = nbr_table_get_from_lladdr(nbr_phase, neighbor);
+  if(e == NULL) {
+    if(shift == 0) {
+      /* The default, no need to spend an entry on it */
+      return;
+    }
+    e = nbr_table_add_lladdr(nbr_phase, neighbor);
+    if(e == NULL) {
+      return;
+    }
+    e->noacks = 0;
+    e->locked = 0;
+  } else if(shift > e->cycle_shift) {
+    /* The neighbor now skips wake-ups of the shorter interval, the
+       recorded one may be among them. */
+    e->locked = 0;
+  }
+  e->cycle_shift = shift;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+phase_cycle_shift(const rimeaddr_t *neighbor)
+{
+  struct phase *e;
+
+  e = nbr_table_get_from_lladdr(nbr_phase, neighbor);
+  return e != NULL ? e->cycle_shift : 0;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+phase_max_cycle_shift(void)
+{
+  struct phase *e;
+  uint8_t shift = 0;
+
+  for(e = nbr_table_head(nbr_phase); e != NULL;
+      e = nbr_table_next(nbr_phase, e)) {
+    if(e->cycle_shift > shift) {
+      shift = e->cycle_shift;
+    }
+  }
+  return shift;
+}
+#endif /* PHASE_CYCLE_SHIFT */
+/*---------------------------------------------------------------------------*/
 void
 phase_init(void)
 {
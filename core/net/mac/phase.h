@@ -53,6 +53,16 @@ typedef enum {
   PHASE_DEFERRED,
 } phase_status_t;
 
+/* With PHASE_CYCLE_SHIFT, the phase module also records the channel check
+   interval each neighbor advertises, as the number of doublings of the
+   base cycle time. A neighbor may then be known without a phase lock. */
+#ifdef PHASE_CONF_CYCLE_SHIFT
+#define PHASE_CYCLE_SHIFT PHASE_CONF_CYCLE_SHIFT
+#elif defined(CONTIKIMAC_CONF_ADAPTIVE_CHECK_RATE)
+#define PHASE_CYCLE_SHIFT CONTIKIMAC_CONF_ADAPTIVE_CHECK_RATE
+#else
+#define PHASE_CYCLE_SHIFT 0
+#endif
 
 void phase_init(void);
 phase_status_t phase_wait(const rimeaddr_t *neighbor,
@@ -63,4 +73,10 @@ void phase_update(const rimeaddr_t *neighbor,
                   rtimer_clock_t time, int mac_status);
 void phase_remove(const rimeaddr_t *neighbor);
 
+#if PHASE_CYCLE_SHIFT
+void phase_set_cycle_shift(const rimeaddr_t *neighbor, uint8_t shift);
+uint8_t phase_cycle_shift(const rimeaddr_t *neighbor);
+uint8_t phase_max_cycle_shift(void);
+#endif /* PHASE_CYCLE_SHIFT */
+
 #endif /* PHASE_H */
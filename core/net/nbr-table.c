@@ -62,6 +62,30 @@ static unsigned num_tables;
 MEMB(neighbor_addr_mem, nbr_table_key_t, NBR_TABLE_MAX_NEIGHBORS);
 LIST(nbr_table_keys);
 
+#if NBR_TABLE_HASH
+/* Open addressing with linear probing, a slot holds the neighbor index + 1
+ * or 0 when empty. The size is a power of two, at least twice the number of
+ * neighbors to keep the probe sequences short. */
+#if NBR_TABLE_MAX_NEIGHBORS > 254
+#error NBR_TABLE_CONF_HASH supports up to 254 neighbors
+#endif
+#if NBR_TABLE_MAX_NEIGHBORS <= 8
+#define NBR_TABLE_HASH_SIZE 16
+#elif NBR_TABLE_MAX_NEIGHBORS <= 16
+#define NBR_TABLE_HASH_SIZE 32
+#elif NBR_TABLE_MAX_NEIGHBORS <= 32
+#define NBR_TABLE_HASH_SIZE 64
+#elif NBR_TABLE_MAX_NEIGHBORS <= 64
+#define NBR_TABLE_HASH_SIZE 128
+#elif NBR_TABLE_MAX_NEIGHBORS <= 128
+#define NBR_TABLE_HASH_SIZE 256
+#else
+#define NBR_TABLE_HASH_SIZE 512
+#endif
+#define HASH_MASK (NBR_TABLE_HASH_SIZE - 1)
+static uint8_t hash_slots[NBR_TABLE_HASH_SIZE];
+#endif /* NBR_TABLE_HASH */
+
 /*---------------------------------------------------------------------------*/
 /* Get a key from a neighbor index */
 static nbr_table_key_t *
@@ -105,6 +129,54 @@ key_from_item(nbr_table_t *table, const nbr_table_item_t *item)
   return key_from_index(index_from_item(table, item));
 }
 /*---------------------------------------------------------------------------*/
+#if NBR_TABLE_HASH
+/* Home slot of a link-layer address */
+static uint16_t
+hash_home(const rimeaddr_t *lladdr)
+{
+  uint16_t h = 0;
+  int i;
+  for(i = 0; i < RIMEADDR_SIZE; i++) {
+    h = (h << 3) + (h >> 13) + lladdr->u8[i];
+  }
+  return (h ^ (h >> 8)) & HASH_MASK;
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_add(nbr_table_key_t *key)
+{
+  uint16_t i = hash_home(&key->lladdr);
+  while(hash_slots[i] != 0) {
+    i = (i + 1) & HASH_MASK;
+  }
+  hash_slots[i] = index_from_key(key) + 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_remove(nbr_table_key_t *key)
+{
+  uint16_t i, j, home;
+  uint8_t slot = index_from_key(key) + 1;
+
+  for(i = hash_home(&key->lladdr); hash_slots[i] != slot;
+      i = (i + 1) & HASH_MASK) {
+    if(hash_slots[i] == 0) {
+      return;
+    }
+  }
+  /* Move later entries of the probe sequence into the gap, so lookups
+   * can stop at the first empty slot */
+  for(j = (i + 1) & HASH_MASK; hash_slots[j] != 0; j = (j + 1) & HASH_MASK) {
+    home = hash_home(&key_from_index(hash_slots[j] - 1)->lladdr);
+    if(((j - home) & HASH_MASK) >= ((j - i) & HASH_MASK)) {
+      hash_slots[i] = hash_slots[j];
+      i = j;
+    }
+  }
+  hash_slots[i] = 0;
+}
+#endif /* NBR_TABLE_HASH */
+/*---------------------------------------------------------------------------*/
 /* Get the index of a neighbor from its link-layer address */
 static int
 index_from_lladdr(const rimeaddr_t *lladdr)
@@ -115,6 +187,18 @@ index_from_lladdr(const rimeaddr_t *lladdr)
   if(lladdr == NULL) {
     lladdr = &rimeaddr_null;
   }
+#if NBR_TABLE_HASH
+  {
+    uint16_t i;
+    for(i = hash_home(lladdr); hash_slots[i] != 0; i = (i + 1) & HASH_MASK) {
+      key = key_from_index(hash_slots[i] - 1);
+      if(rimeaddr_cmp(lladdr, &key->lladdr)) {
+        return hash_slots[i] - 1;
+      }
+    }
+    return -1;
+  }
+#endif /* NBR_TABLE_HASH */
   key = list_head(nbr_table_keys);
   while(key != NULL) {
     if(lladdr && rimeaddr_cmp(lladdr, &key->lladdr)) {
@@ -218,6 +302,9 @@ nbr_table_allocate(void)
       used_map[index_from_key(least_used_key)] = 0;
       /* Remove neighbor from list */
       list_remove(nbr_table_keys, least_used_key);
+#if NBR_TABLE_HASH
+      hash_remove(least_used_key);
+#endif /* NBR_TABLE_HASH */
       /* Return associated key */
       return least_used_key;
     }
@@ -298,6 +385,9 @@ nbr_table_add_lladdr(nbr_table_t *table, const rimeaddr_t *lladdr)
 
     /* Set link-layer address */
     rimeaddr_copy(&key->lladdr, lladdr);
+#if NBR_TABLE_HASH
+    hash_add(key);
+#endif /* NBR_TABLE_HASH */
   }
 
   /* Get item in the current table */
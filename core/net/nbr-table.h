@@ -46,6 +46,14 @@
 #define NBR_TABLE_MAX_NEIGHBORS 8
 #endif /* NBR_TABLE_CONF_MAX_NEIGHBORS */
 
+/* Find neighbors through a hash of their link-layer address instead of
+ * walking all of them. Costs NBR_TABLE_HASH_SIZE bytes of RAM. */
+#ifdef NBR_TABLE_CONF_HASH
+#define NBR_TABLE_HASH NBR_TABLE_CONF_HASH
+#else /* NBR_TABLE_CONF_HASH */
+#define NBR_TABLE_HASH 0
+#endif /* NBR_TABLE_CONF_HASH */
+
 /* An item in a neighbor table */
 typedef void nbr_table_item_t;
 
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2010, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+/**
+ * \file
+ *         Compile-time binding of the NETSTACK layers
+ *
+ *         With NETSTACK_CONF_STATIC set, NETSTACK_RDC and the other
+ *         layer macros expand to a constant driver struct that names
+ *         the functions of the configured driver directly. The compiler
+ *         then turns NETSTACK_RDC.send(...) into a direct call to
+ *         contikimac_driver_send(). Only the drivers listed below can be
+ *         bound this way; each exports its functions as
+ *         <driver>_<member> with NETSTACK_STATIC_EXPORT().
+ */
+
+#ifndef NETSTACK_STATIC_H_
+#define NETSTACK_STATIC_H_
+
+#include "sys/cc.h"
+#include <stddef.h>
+
+/* Makes the static function fn visible to the layers as name. */
+#define NETSTACK_STATIC_EXPORT(name, fn) \
+  extern __typeof__(fn) name __attribute__((alias(#fn)))
+
+#define NETSTACK_STATIC_FUNCTION(type, driver, member) \
+  extern __typeof__(*((type *)0)->member) driver##_##member
+
+#define NETSTACK_STATIC_NETWORK(driver)                                 \
+  extern const struct network_driver driver;                            \
+  NETSTACK_STATIC_FUNCTION(struct network_driver, driver, init);        \
+  NETSTACK_STATIC_FUNCTION(struct network_driver, driver, input)
+
+#define NETSTACK_STATIC_MAC(driver)                                     \
+  extern const struct mac_driver driver;                                \
+  NETSTACK_STATIC_FUNCTION(struct mac_driver, driver, init);            \
+  NETSTACK_STATIC_FUNCTION(struct mac_driver, driver, send);            \
+  NETSTACK_STATIC_FUNCTION(struct mac_driver, driver, input);           \
+  NETSTACK_STATIC_FUNCTION(struct mac_driver, driver, on);              \
+  NETSTACK_STATIC_FUNCTION(struct mac_driver, driver, off);             \
+  NETSTACK_STATIC_FUNCTION(struct mac_driver, driver, channel_check_interval); \
+  NETSTACK_STATIC_FUNCTION(struct mac_driver, driver, send_list)
+
+#define NETSTACK_STATIC_RDC(driver)                                     \
+  extern const struct rdc_driver driver;                                \
+  NETSTACK_STATIC_FUNCTION(struct rdc_driver, driver, init);            \
+  NETSTACK_STATIC_FUNCTION(struct rdc_driver, driver, send);            \
+  NETSTACK_STATIC_FUNCTION(struct rdc_driver, driver, send_list);       \
+  NETSTACK_STATIC_FUNCTION(struct rdc_driver, driver, input);           \
+  NETSTACK_STATIC_FUNCTION(struct rdc_driver, driver, on);              \
+  NETSTACK_STATIC_FUNCTION(struct rdc_driver, driver, off);             \
+  NETSTACK_STATIC_FUNCTION(struct rdc_driver, driver, channel_check_interval)
+
+#define NETSTACK_STATIC_RADIO(driver)                                   \
+  extern const struct radio_driver driver;                              \
+  NETSTACK_STATIC_FUNCTION(struct radio_driver, driver, init);          \
+  NETSTACK_STATIC_FUNCTION(struct radio_driver, driver, prepare);       \
+  NETSTACK_STATIC_FUNCTION(struct radio_driver, driver, transmit);      \
+  NETSTACK_STATIC_FUNCTION(struct radio_driver, driver, send);          \
+  NETSTACK_STATIC_FUNCTION(struct radio_driver, driver, read);          \
+  NETSTACK_STATIC_FUNCTION(struct radio_driver, driver, channel_clear); \
+  NETSTACK_STATIC_FUNCTION(struct radio_driver, driver, receiving_packet); \
+  NETSTACK_STATIC_FUNCTION(struct radio_driver, driver, pending_packet); \
+  NETSTACK_STATIC_FUNCTION(struct radio_driver, driver, on);            \
+  NETSTACK_STATIC_FUNCTION(struct radio_driver, driver, off)
+
+#define NETSTACK_STATIC_FRAMER(driver)                                  \
+  extern const struct framer driver;                                    \
+  NETSTACK_STATIC_FUNCTION(struct framer, driver, create);              \
+  NETSTACK_STATIC_FUNCTION(struct framer, driver, parse)
+
+/* The name strings stay in the driver structs, so they exist only once. */
+
+NETSTACK_STATIC_NETWORK(rime_driver);
+#define rime_driver_static \
+  ((const struct network_driver){ rime_driver.name, rime_driver_init, \
+      rime_driver_input })
+
+NETSTACK_STATIC_NETWORK(sicslowpan_driver);
+#define sicslowpan_driver_static \
+  ((const struct network_driver){ sicslowpan_driver.name, \
+      sicslowpan_driver_init, sicslowpan_driver_input })
+
+NETSTACK_STATIC_MAC(nullmac_driver);
+#define nullmac_driver_static \
+  ((const struct mac_driver){ nullmac_driver.name, nullmac_driver_init, \
+      nullmac_driver_send, nullmac_driver_input, nullmac_driver_on, \
+      nullmac_driver_off, nullmac_driver_channel_check_interval, \
+      nullmac_driver_send_list })
+
+NETSTACK_STATIC_MAC(csma_driver);
+#define csma_driver_static \
+  ((const struct mac_driver){ csma_driver.name, csma_driver_init, \
+      csma_driver_send, csma_driver_input, csma_driver_on, \
+      csma_driver_off, csma_driver_channel_check_interval, NULL })
+
+NETSTACK_STATIC_RDC(nullrdc_driver);
+#define nullrdc_driver_static \
+  ((const struct rdc_driver){ nullrdc_driver.name, nullrdc_driver_init, \
+      nullrdc_driver_send, nullrdc_driver_send_list, nullrdc_driver_input, \
+      nullrdc_driver_on, nullrdc_driver_off, \
+      nullrdc_driver_channel_check_interval })
+
+NETSTACK_STATIC_RDC(contikimac_driver);
+#define contikimac_driver_static \
+  ((const struct rdc_driver){ contikimac_driver.name, \
+      contikimac_driver_init, contikimac_driver_send, \
+      contikimac_driver_send_list, contikimac_driver_input, \
+      contikimac_driver_on, contikimac_driver_off, \
+      contikimac_driver_channel_check_interval })
+
+NETSTACK_STATIC_RADIO(nullradio_driver);
+#define nullradio_driver_static \
+  ((const struct radio_driver){ nullradio_driver_init, \
+      nullradio_driver_prepare, nullradio_driver_transmit, \
+      nullradio_driver_send, nullradio_driver_read, \
+      nullradio_driver_channel_clear, nullradio_driver_receiving_packet, \
+      nullradio_driver_pending_packet, nullradio_driver_on, \
+      nullradio_driver_off })
+
+NETSTACK_STATIC_RADIO(rf230_driver);
+#define rf230_driver_static \
+  ((const struct radio_driver){ rf230_driver_init, rf230_driver_prepare, \
+      rf230_driver_transmit, rf230_driver_send, rf230_driver_read, \
+      rf230_driver_channel_clear, rf230_driver_receiving_packet, \
+      rf230_driver_pending_packet, rf230_driver_on, rf230_driver_off })
+
+NETSTACK_STATIC_FRAMER(framer_nullmac);
+#define framer_nullmac_static \
+  ((const struct framer){ framer_nullmac_create, framer_nullmac_parse })
+
+NETSTACK_STATIC_FRAMER(framer_802154);
+#define framer_802154_static \
+  ((const struct framer){ framer_802154_create, framer_802154_parse })
+
+#endif /* NETSTACK_STATIC_H_ */
@@ -38,10 +38,15 @@
  */
 
 #include "net/netstack.h"
+#include "net/link-stats.h"
+#include "net/mac/mac-sequence.h"
 /*---------------------------------------------------------------------------*/
 void
 netstack_init(void)
 {
+  link_stats_init();
+  mac_sequence_init();
+
   NETSTACK_RADIO.init();
   NETSTACK_RDC.init();
   NETSTACK_MAC.init();
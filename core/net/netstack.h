@@ -42,27 +42,32 @@
 
 #include "contiki-conf.h"
 
+/* Bind the layers at compile time, see net/netstack-static.h */
+#ifndef NETSTACK_CONF_STATIC
+#define NETSTACK_CONF_STATIC 0
+#endif /* NETSTACK_CONF_STATIC */
+
 #ifndef NETSTACK_NETWORK
 #ifdef NETSTACK_CONF_NETWORK
-#define NETSTACK_NETWORK NETSTACK_CONF_NETWORK
+#define NETSTACK_NETWORK NETSTACK_BIND(NETSTACK_CONF_NETWORK)
 #else /* NETSTACK_CONF_NETWORK */
-#define NETSTACK_NETWORK rime_driver
+#define NETSTACK_NETWORK NETSTACK_BIND(rime_driver)
 #endif /* NETSTACK_CONF_NETWORK */
 #endif /* NETSTACK_NETWORK */
 
 #ifndef NETSTACK_MAC
 #ifdef NETSTACK_CONF_MAC
-#define NETSTACK_MAC NETSTACK_CONF_MAC
+#define NETSTACK_MAC NETSTACK_BIND(NETSTACK_CONF_MAC)
 #else /* NETSTACK_CONF_MAC */
-#define NETSTACK_MAC     nullmac_driver
+#define NETSTACK_MAC NETSTACK_BIND(nullmac_driver)
 #endif /* NETSTACK_CONF_MAC */
 #endif /* NETSTACK_MAC */
 
 #ifndef NETSTACK_RDC
 #ifdef NETSTACK_CONF_RDC
-#define NETSTACK_RDC NETSTACK_CONF_RDC
+#define NETSTACK_RDC NETSTACK_BIND(NETSTACK_CONF_RDC)
 #else /* NETSTACK_CONF_RDC */
-#define NETSTACK_RDC     nullrdc_driver
+#define NETSTACK_RDC NETSTACK_BIND(nullrdc_driver)
 #endif /* NETSTACK_CONF_RDC */
 #endif /* NETSTACK_RDC */
 
@@ -82,17 +87,17 @@
 
 #ifndef NETSTACK_RADIO
 #ifdef NETSTACK_CONF_RADIO
-#define NETSTACK_RADIO NETSTACK_CONF_RADIO
+#define NETSTACK_RADIO NETSTACK_BIND(NETSTACK_CONF_RADIO)
 #else /* NETSTACK_CONF_RADIO */
-#define NETSTACK_RADIO   nullradio_driver
+#define NETSTACK_RADIO NETSTACK_BIND(nullradio_driver)
 #endif /* NETSTACK_CONF_RADIO */
 #endif /* NETSTACK_RADIO */
 
 #ifndef NETSTACK_FRAMER
 #ifdef NETSTACK_CONF_FRAMER
-#define NETSTACK_FRAMER NETSTACK_CONF_FRAMER
+#define NETSTACK_FRAMER NETSTACK_BIND(NETSTACK_CONF_FRAMER)
 #else /* NETSTACK_CONF_FRAMER */
-#define NETSTACK_FRAMER   framer_nullmac
+#define NETSTACK_FRAMER NETSTACK_BIND(framer_nullmac)
 #endif /* NETSTACK_CONF_FRAMER */
 #endif /* NETSTACK_FRAMER */
 
@@ -114,11 +119,17 @@ struct network_driver {
   void (* input)(void);
 };
 
+#if NETSTACK_CONF_STATIC
+#include "net/netstack-static.h"
+#define NETSTACK_BIND(driver) CC_CONCAT(driver, _static)
+#else /* NETSTACK_CONF_STATIC */
+#define NETSTACK_BIND(driver) driver
 extern const struct network_driver NETSTACK_NETWORK;
 extern const struct rdc_driver     NETSTACK_RDC;
 extern const struct mac_driver     NETSTACK_MAC;
 extern const struct radio_driver   NETSTACK_RADIO;
 extern const struct framer         NETSTACK_FRAMER;
+#endif /* NETSTACK_CONF_STATIC */
 
 void netstack_init(void);
 
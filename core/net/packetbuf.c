@@ -64,6 +64,12 @@ static uint8_t *packetbuf = (uint8_t *)packetbuf_aligned;
 
 static uint8_t *packetbufptr;
 
+/* Set if packetbufptr is a buffer lent by packetbuf_borrow() */
+static uint8_t borrowed;
+
+/* Called when the data attached with packetbuf_attach() is released */
+static packetbuf_release_callback_t release_callback;
+
 #define DEBUG 0
 #if DEBUG
 #include <stdio.h>
@@ -72,14 +78,28 @@ static uint8_t *packetbufptr;
 #define PRINTF(...)
 #endif
 
+/*---------------------------------------------------------------------------*/
+static void
+release_external(void)
+{
+  packetbuf_release_callback_t callback;
+
+  if(release_callback != NULL) {
+    callback = release_callback;
+    release_callback = NULL;
+    callback(packetbufptr);
+  }
+}
 /*---------------------------------------------------------------------------*/
 void
 packetbuf_clear(void)
 {
+  release_external();
   buflen = bufptr = 0;
   hdrptr = PACKETBUF_HDR_SIZE;
 
   packetbufptr = &packetbuf[PACKETBUF_HDR_SIZE];
+  borrowed = 0;
   packetbuf_attr_clear();
 }
 /*---------------------------------------------------------------------------*/
@@ -106,9 +126,18 @@ packetbuf_compact(void)
 {
   int i, len;
 
-  if(packetbuf_is_reference()) {
+  if(borrowed) {
+    memmove(&packetbuf[PACKETBUF_HDR_SIZE], packetbufptr + bufptr,
+            packetbuf_datalen());
+    packetbufptr = &packetbuf[PACKETBUF_HDR_SIZE];
+    bufptr = 0;
+    borrowed = 0;
+  } else if(packetbuf_is_reference()) {
     memcpy(&packetbuf[PACKETBUF_HDR_SIZE], packetbuf_reference_ptr(),
 	   packetbuf_datalen());
+    /* The external data is not needed anymore */
+    release_external();
+    packetbufptr = &packetbuf[PACKETBUF_HDR_SIZE];
   } else if(bufptr > 0) {
     len = packetbuf_datalen() + PACKETBUF_HDR_SIZE;
     for(i = PACKETBUF_HDR_SIZE; i < len; i++) {
@@ -171,6 +200,10 @@ packetbuf_copyto(void *to)
 int
 packetbuf_hdralloc(int size)
 {
+  if(borrowed) {
+    /* The header must precede the data */
+    packetbuf_compact();
+  }
   if(hdrptr >= size && packetbuf_totlen() + size <= PACKETBUF_SIZE) {
     hdrptr -= size;
     return 1;
@@ -206,6 +239,9 @@ packetbuf_set_datalen(uint16_t len)
 void *
 packetbuf_dataptr(void)
 {
+  if(borrowed) {
+    return (void *)(packetbufptr + bufptr);
+  }
   return (void *)(&packetbuf[bufptr + PACKETBUF_HDR_SIZE]);
 }
 /*---------------------------------------------------------------------------*/
@@ -223,10 +259,46 @@ packetbuf_reference(void *ptr, uint16_t len)
   buflen = len;
 }
 /*---------------------------------------------------------------------------*/
+void
+packetbuf_attach(void *ptr, uint16_t len, packetbuf_release_callback_t release)
+{
+  packetbuf_reference(ptr, len);
+  release_callback = release;
+}
+/*---------------------------------------------------------------------------*/
+packetbuf_release_callback_t
+packetbuf_take_release(void)
+{
+  packetbuf_release_callback_t callback;
+
+  callback = release_callback;
+  release_callback = NULL;
+  return callback;
+}
+/*---------------------------------------------------------------------------*/
+void
+packetbuf_release(void)
+{
+  if(release_callback != NULL) {
+    release_external();
+    packetbufptr = &packetbuf[PACKETBUF_HDR_SIZE];
+    buflen = bufptr = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+packetbuf_borrow(void *ptr, uint16_t len)
+{
+  packetbuf_clear();
+  packetbufptr = ptr;
+  buflen = len;
+  borrowed = 1;
+}
+/*---------------------------------------------------------------------------*/
 int
 packetbuf_is_reference(void)
 {
-  return packetbufptr != &packetbuf[PACKETBUF_HDR_SIZE];
+  return packetbufptr != &packetbuf[PACKETBUF_HDR_SIZE] && !borrowed;
 }
 /*---------------------------------------------------------------------------*/
 void *
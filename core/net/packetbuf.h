@@ -218,6 +218,72 @@ int packetbuf_is_reference(void);
  */
 void *packetbuf_reference_ptr(void);
 
+/**
+ * \brief      Callback that hands external data back to its owner
+ * \param ptr  A pointer to the external data
+ *
+ *             The callback runs inside the network stack and must not
+ *             use the packetbuf or send packets. Poll a process
+ *             instead to send the next packet.
+ */
+typedef void (*packetbuf_release_callback_t)(void *ptr);
+
+/**
+ * \brief         Point the packetbuf to external data owned by the caller
+ * \param ptr     A pointer to the external data
+ * \param len     The length of the external data
+ * \param release Called when the data is not referenced anymore
+ *
+ *             Like packetbuf_reference(), but the caller gets the data
+ *             back through the \a release callback. The callback is
+ *             called once the data has been copied into the packetbuf
+ *             for transmission, when the MAC layer is done with the
+ *             packet or when the packetbuf is cleared before that. A
+ *             queuebuf created from the packetbuf takes over the
+ *             callback and calls it when it is freed. The data must
+ *             not be modified until the callback has been called.
+ *
+ *             This lets large payloads, e.g. from a sensor ring
+ *             buffer or a storage sector, be sent and queued without
+ *             being copied into the packetbuf and every queuebuf.
+ */
+void packetbuf_attach(void *ptr, uint16_t len,
+                      packetbuf_release_callback_t release);
+
+/**
+ * \brief      Take over the release callback of attached data
+ * \return     The callback set with packetbuf_attach(), or NULL
+ *
+ *             The caller becomes responsible for calling the callback
+ *             when it does not reference the data anymore. This is
+ *             used by the queuebuf module.
+ */
+packetbuf_release_callback_t packetbuf_take_release(void);
+
+/**
+ * \brief      Release data attached with packetbuf_attach()
+ *
+ *             Calls the release callback, if any, and empties the
+ *             packetbuf data. This function is called by the MAC layer
+ *             when it is done with the outgoing packet.
+ */
+void packetbuf_release(void);
+
+/**
+ * \brief      Let the packetbuf use an external buffer as data area
+ * \param ptr  A pointer to the external buffer
+ * \param len  The length of the data in the external buffer
+ *
+ *             For inbound packets, this function lets a driver hand
+ *             over its receive buffer without copying the data. As
+ *             opposed to packetbuf_reference(), packetbuf_dataptr()
+ *             points into the buffer and a queuebuf copies the data.
+ *             The data is moved into the packetbuf when a header is
+ *             allocated. The buffer must stay valid until the
+ *             packetbuf is cleared or the packet has been processed.
+ */
+void packetbuf_borrow(void *ptr, uint16_t len);
+
 /**
  * \brief      Compact the packetbuf
  *
@@ -345,6 +411,7 @@ enum {
   PACKETBUF_ATTR_LISTEN_TIME,
   PACKETBUF_ATTR_TRANSMIT_TIME,
   PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
+  PACKETBUF_ATTR_MAC_TRANSMISSIONS,
   PACKETBUF_ATTR_MAC_SEQNO,
   PACKETBUF_ATTR_MAC_ACK,
 
@@ -379,11 +446,11 @@ enum {
 
 #define PACKETBUF_IS_ADDR(type) ((type) >= PACKETBUF_ADDR_FIRST)
 
-#if PACKETBUF_CONF_ATTRS_INLINE
-
 extern struct packetbuf_attr packetbuf_attrs[];
 extern struct packetbuf_addr packetbuf_addrs[];
 
+#if PACKETBUF_CONF_ATTRS_INLINE
+
 static int               packetbuf_set_attr(uint8_t type, const packetbuf_attr_t val);
 static packetbuf_attr_t    packetbuf_attr(uint8_t type);
 static int               packetbuf_set_addr(uint8_t type, const rimeaddr_t *addr);
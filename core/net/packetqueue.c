@@ -48,7 +48,7 @@
 void
 packetqueue_init(struct packetqueue *q)
 {
-  list_init(*q->list);
+  list_tailed_init(q->list);
   memb_init(q->memb);
 }
 /*---------------------------------------------------------------------------*/
@@ -58,7 +58,7 @@ remove_queued_packet(void *item)
   struct packetqueue_item *i = item;
   struct packetqueue *q = i->queue;
 
-  list_remove(*q->list, i);
+  list_tailed_remove(q->list, i);
   queuebuf_free(i->buf);
   ctimer_stop(&i->lifetimer);
   memb_free(q->memb, i);
@@ -97,7 +97,7 @@ packetqueue_enqueue_packetbuf(struct packetqueue *q, clock_time_t lifetime,
   }
 
   /* Add the item to the queue. */
-  list_add(*q->list, i);
+  list_tailed_add(q->list, i);
 
   return 1;
 }
@@ -105,7 +105,13 @@ packetqueue_enqueue_packetbuf(struct packetqueue *q, clock_time_t lifetime,
 struct packetqueue_item *
 packetqueue_first(struct packetqueue *q)
 {
-  return list_head(*q->list);
+  return list_tailed_head(q->list);
+}
+/*---------------------------------------------------------------------------*/
+struct packetqueue_item *
+packetqueue_last(struct packetqueue *q)
+{
+  return list_tailed_tail(q->list);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -113,9 +119,9 @@ packetqueue_dequeue(struct packetqueue *q)
 {
   struct packetqueue_item *i;
   
-  i = list_head(*q->list);
+  i = list_tailed_head(q->list);
   if(i != NULL) {
-    list_remove(*q->list, i);
+    list_tailed_remove(q->list, i);
     queuebuf_free(i->buf);
     ctimer_stop(&i->lifetimer);
     memb_free(q->memb, i);
@@ -125,7 +131,7 @@ packetqueue_dequeue(struct packetqueue *q)
 int
 packetqueue_len(struct packetqueue *q)
 {
-  return list_length(*q->list);
+  return list_tailed_length(q->list);
 }
 /*---------------------------------------------------------------------------*/
 struct queuebuf *
@@ -68,7 +68,7 @@
  *             an opaque structure with no user-visible elements.
  */
 struct packetqueue {
-  list_t *list;
+  struct list_tailed *list;
   struct memb *memb;
 };
 
@@ -101,7 +101,7 @@ struct packetqueue_item {
  *             is defined on a per-module basis.
  *
  */
-#define PACKETQUEUE(name, size) LIST(name##_list); \
+#define PACKETQUEUE(name, size) static struct list_tailed name##_list; \
                                 MEMB(name##_memb, struct packetqueue_item, size); \
 				static struct packetqueue name = { &name##_list, \
 								   &name##_memb }
@@ -165,6 +165,17 @@ int packetqueue_enqueue_packetbuf(struct packetqueue *q, clock_time_t lifetime,
  */
 struct packetqueue_item *packetqueue_first(struct packetqueue *q);
 
+/**
+ * \brief      Access the last item on the packet buffer.
+ * \param q    A pointer to a struct packetqueue.
+ * \return     A pointer to the last item on the packet queue.
+ *
+ *             This function returns the item that was enqueued
+ *             last. The packet queue is unchanged by this function.
+ *
+ */
+struct packetqueue_item *packetqueue_last(struct packetqueue *q);
+
 /**
  * \brief      Remove the first item on the packet buffer.
  * \param q    A pointer to a struct packetqueue.
@@ -88,6 +88,7 @@ struct queuebuf_ref {
   uint8_t *ref;
   uint8_t hdr[PACKETBUF_HDR_SIZE];
   uint8_t hdrlen;
+  packetbuf_release_callback_t release;
 };
 
 MEMB(bufmem, struct queuebuf, QUEUEBUF_NUM);
@@ -327,6 +328,7 @@ queuebuf_new_from_packetbuf(void)
       rbuf->len = packetbuf_datalen();
       rbuf->ref = packetbuf_reference_ptr();
       rbuf->hdrlen = packetbuf_copyto_hdr(rbuf->hdr);
+      rbuf->release = packetbuf_take_release();
     } else {
       PRINTF("queuebuf_new_from_packetbuf: could not allocate a reference queuebuf\n");
     }
@@ -392,6 +394,26 @@ queuebuf_new_from_packetbuf(void)
   }
 }
 /*---------------------------------------------------------------------------*/
+int
+queuebuf_update_from_packetbuf(struct queuebuf *buf)
+{
+  struct queuebuf_data *buframptr;
+
+  /* A reference queuebuf has no room for data of its own */
+  if(!memb_inmemb(&bufmem, buf)) {
+    return 0;
+  }
+  buframptr = queuebuf_load_to_ram(buf);
+  buframptr->len = packetbuf_copyto(buframptr->data);
+  packetbuf_attr_copyto(buframptr->attrs, buframptr->addrs);
+#if WITH_SWAP
+  if(buf->location == IN_CFS) {
+    return queuebuf_flush_tmpdata() != -1;
+  }
+#endif
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
 void
 queuebuf_update_attr_from_packetbuf(struct queuebuf *buf)
 {
@@ -404,6 +426,12 @@ queuebuf_update_attr_from_packetbuf(struct queuebuf *buf)
 #endif
 }
 /*---------------------------------------------------------------------------*/
+int
+queuebuf_numfree(void)
+{
+  return memb_numfree(&bufmem);
+}
+/*---------------------------------------------------------------------------*/
 void
 queuebuf_free(struct queuebuf *buf)
 {
@@ -426,6 +454,10 @@ queuebuf_free(struct queuebuf *buf)
     list_remove(queuebuf_list, buf);
 #endif /* QUEUEBUF_DEBUG */
   } else if(memb_inmemb(&refbufmem, buf)) {
+    struct queuebuf_ref *r = (struct queuebuf_ref *)buf;
+    if(r->release != NULL) {
+      r->release(r->ref);
+    }
     memb_free(&refbufmem, buf);
 #if QUEUEBUF_STATS
     --queuebuf_ref_len;
@@ -443,8 +475,9 @@ queuebuf_to_packetbuf(struct queuebuf *b)
     packetbuf_attr_copyfrom(buframptr->attrs, buframptr->addrs);
   } else if(memb_inmemb(&refbufmem, b)) {
     r = (struct queuebuf_ref *)b;
-    packetbuf_clear();
-    packetbuf_copyfrom(r->ref, r->len);
+    /* The queuebuf keeps the release callback, so the reference stays
+       valid until the queuebuf is freed */
+    packetbuf_reference(r->ref, r->len);
     packetbuf_hdralloc(r->hdrlen);
     memcpy(packetbuf_hdrptr(), r->hdr, r->hdrlen);
   }
@@ -468,7 +501,12 @@ queuebuf_dataptr(struct queuebuf *b)
 int
 queuebuf_datalen(struct queuebuf *b)
 {
-  struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
+  struct queuebuf_data *buframptr;
+
+  if(memb_inmemb(&refbufmem, b)) {
+    return ((struct queuebuf_ref *)b)->len;
+  }
+  buframptr = queuebuf_load_to_ram(b);
   return buframptr->len;
 }
 /*---------------------------------------------------------------------------*/
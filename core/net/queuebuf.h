@@ -96,6 +96,10 @@ struct queuebuf *queuebuf_new_from_packetbuf_debug(const char *file, int line);
 struct queuebuf *queuebuf_new_from_packetbuf(void);
 #endif /* QUEUEBUF_DEBUG */
 void queuebuf_update_attr_from_packetbuf(struct queuebuf *b);
+/* Replace data and attributes, returns 0 for reference queuebufs */
+int queuebuf_update_from_packetbuf(struct queuebuf *b);
+/* Number of queuebufs that can still be allocated */
+int queuebuf_numfree(void);
 
 void queuebuf_to_packetbuf(struct queuebuf *b);
 void queuebuf_free(struct queuebuf *b);
@@ -157,6 +157,29 @@ strcasecmp(const char *s1, const char *s2)
 #define RESOLV_SUPPORTS_RECORD_EXPIRATION 1
 #endif
 
+/* Seconds a name that was not found stays cached, unless the SOA record
+   of the negative answer gives a shorter time */
+#ifdef RESOLV_CONF_NEGATIVE_TTL
+#define RESOLV_NEGATIVE_TTL RESOLV_CONF_NEGATIVE_TTL
+#else
+#define RESOLV_NEGATIVE_TTL 30
+#endif
+
+/* Upper bound for the TTL of cached records, in seconds */
+#ifdef RESOLV_CONF_MAX_TTL
+#define RESOLV_MAX_TTL RESOLV_CONF_MAX_TTL
+#else
+#define RESOLV_MAX_TTL 86400UL
+#endif
+
+/* A name that is looked up less than this many seconds before its
+   record expires is queried again in the background, 0 to disable */
+#ifdef RESOLV_CONF_REFRESH_TIME
+#define RESOLV_REFRESH_TIME RESOLV_CONF_REFRESH_TIME
+#else
+#define RESOLV_REFRESH_TIME 0
+#endif
+
 #if RESOLV_CONF_SUPPORTS_MDNS && !RESOLV_VERIFY_ANSWER_NAMES
 #error RESOLV_CONF_SUPPORTS_MDNS cannot be set without RESOLV_CONF_VERIFY_ANSWER_NAMES
 #endif
@@ -177,6 +200,7 @@ strcasecmp(const char *s1, const char *s2)
 
 #define DNS_TYPE_A      1
 #define DNS_TYPE_CNAME  5
+#define DNS_TYPE_SOA    6
 #define DNS_TYPE_PTR   12
 #define DNS_TYPE_MX    15
 #define DNS_TYPE_TXT   16
@@ -262,10 +286,14 @@ struct namemap {
 #define STATE_NEW    2
 #define STATE_ASKING 3
 #define STATE_DONE   4
+/* Done, a query for a new record is being sent */
+#define STATE_REFRESH 5
   uint8_t state;
   uint8_t tmr;
   uint8_t retries;
   uint8_t seqno;
+  /* Compared before the name, see name_hash() */
+  uint8_t hash;
 #if RESOLV_SUPPORTS_RECORD_EXPIRATION
   unsigned long expiration;
 #endif /* RESOLV_SUPPORTS_RECORD_EXPIRATION */
@@ -642,6 +670,59 @@ mdns_prep_host_announce_packet(void)
 }
 #endif /* RESOLV_CONF_SUPPORTS_MDNS */
 /*---------------------------------------------------------------------------*/
+/** \internal
+ * Hashes a name so that a lookup only compares the names of the entries
+ * whose hash matches. Setting bit 5 folds upper case letters to lower
+ * case, the other characters of host names already have it set.
+ */
+static uint8_t
+name_hash(const char *name)
+{
+  uint8_t hash = 0;
+
+  while(*name != 0) {
+    hash = ((hash << 1) | (hash >> 7)) ^ (*name++ | 0x20);
+  }
+  return hash;
+}
+/*---------------------------------------------------------------------------*/
+#if RESOLV_SUPPORTS_RECORD_EXPIRATION
+/** \internal
+ * Returns the seconds to cache a negative answer for, the smaller of the
+ * TTL and the minimum field of the SOA record in the authority section
+ * (RFC 2308). authptr points to the first authority record.
+ */
+static unsigned long
+negative_ttl(unsigned char *authptr, uint8_t nauthrr)
+{
+  unsigned char *end = (unsigned char *)uip_appdata + uip_datalen();
+  unsigned long ttl, minimum;
+  unsigned char *rr;
+
+  if(nauthrr == 0) {
+    return RESOLV_NEGATIVE_TTL;
+  }
+  /* type, class, ttl and length, 10 bytes */
+  rr = skip_name(authptr);
+  if(rr + 10 > end || rr[0] != 0 || rr[1] != DNS_TYPE_SOA) {
+    return RESOLV_NEGATIVE_TTL;
+  }
+  ttl = ((unsigned long)rr[4] << 24) | ((unsigned long)rr[5] << 16) |
+    ((unsigned)rr[6] << 8) | rr[7];
+  /* mname, rname, serial, refresh, retry, expire and minimum */
+  rr = skip_name(skip_name(rr + 10));
+  if(rr + 20 > end) {
+    return RESOLV_NEGATIVE_TTL;
+  }
+  minimum = ((unsigned long)rr[16] << 24) | ((unsigned long)rr[17] << 16) |
+    ((unsigned)rr[18] << 8) | rr[19];
+  if(minimum < ttl) {
+    ttl = minimum;
+  }
+  return ttl < RESOLV_MAX_TTL ? ttl : RESOLV_MAX_TTL;
+}
+#endif /* RESOLV_SUPPORTS_RECORD_EXPIRATION */
+/*---------------------------------------------------------------------------*/
 /** \internal
  * Runs through the list of names to see if there are any that have
  * not yet been queried and, if so, sends out a query.
@@ -659,9 +740,10 @@ check_entries(void)
 
   for(i = 0; i < RESOLV_ENTRIES; ++i) {
     namemapptr = &names[i];
-    if(namemapptr->state == STATE_NEW || namemapptr->state == STATE_ASKING) {
+    if(namemapptr->state == STATE_NEW || namemapptr->state == STATE_ASKING ||
+       namemapptr->state == STATE_REFRESH) {
       etimer_set(&retry, CLOCK_SECOND / 4);
-      if(namemapptr->state == STATE_ASKING) {
+      if(namemapptr->state != STATE_NEW) {
         if(--namemapptr->tmr == 0) {
 #if RESOLV_CONF_SUPPORTS_MDNS
           if(++namemapptr->retries ==
@@ -671,12 +753,18 @@ check_entries(void)
           if(++namemapptr->retries == RESOLV_CONF_MAX_RETRIES)
 #endif /* RESOLV_CONF_SUPPORTS_MDNS */
           {
+            if(namemapptr->state == STATE_REFRESH) {
+              /* The old record stays usable until it expires */
+              namemapptr->state = STATE_DONE;
+              continue;
+            }
+
             /* STATE_ERROR basically means "not found". */
             namemapptr->state = STATE_ERROR;
 
 #if RESOLV_SUPPORTS_RECORD_EXPIRATION
-            /* Keep the "not found" error valid for 30 seconds */
-            namemapptr->expiration = clock_seconds() + 30;
+            /* Keep the "not found" error valid for a while */
+            namemapptr->expiration = clock_seconds() + RESOLV_NEGATIVE_TTL;
 #endif /* RESOLV_SUPPORTS_RECORD_EXPIRATION */
 
             resolv_found(namemapptr->name, NULL);
@@ -885,8 +973,9 @@ newdata(void)
 
 /** ANSWER HANDLING SECTION **************************************************/
 
-  if(nanswers == 0) {
-    /* Skip responses with no answers. */
+  if(nanswers == 0 && (hdr->flags1 & DNS_FLAG1_RESPONSE) == 0) {
+    /* Skip requests with no answers. A response without answers is a
+       negative answer to one of our queries. */
     return;
   }
 
@@ -907,29 +996,44 @@ newdata(void)
 
     namemapptr = &names[i];
 
-    if(i >= RESOLV_ENTRIES || i < 0 || namemapptr->state != STATE_ASKING) {
+    if(i >= RESOLV_ENTRIES || i < 0 ||
+       (namemapptr->state != STATE_ASKING &&
+        namemapptr->state != STATE_REFRESH)) {
       PRINTF("resolver: DNS response has bad ID (%04X) \n", uip_ntohs(hdr->id));
       return;
     }
 
     PRINTF("resolver: Incoming response for \"%s\".\n", namemapptr->name);
 
-    /* We'll change this to DONE when we find the record. */
-    namemapptr->state = STATE_ERROR;
-
     namemapptr->err = hdr->flags2 & DNS_FLAG2_ERR_MASK;
 
+    /* Check for error or an empty answer. If so, call callback to inform. */
+    if(namemapptr->err != 0 || nanswers == 0) {
+      if(namemapptr->state == STATE_REFRESH &&
+         namemapptr->err != DNS_FLAG2_ERR_NONE &&
+         namemapptr->err != DNS_FLAG2_ERR_NAME) {
+        /* The server failed, the old record stays usable until it
+           expires */
+        namemapptr->state = STATE_DONE;
+        return;
+      }
+      namemapptr->state = STATE_ERROR;
 #if RESOLV_SUPPORTS_RECORD_EXPIRATION
-    /* If we remain in the error state, keep it cached for 30 seconds. */
-    namemapptr->expiration = clock_seconds() + 30;
+      namemapptr->expiration = clock_seconds() +
+        (nanswers == 0 ? negative_ttl(queryptr, uip_ntohs(hdr->numauthrr)) :
+         RESOLV_NEGATIVE_TTL);
 #endif /* RESOLV_SUPPORTS_RECORD_EXPIRATION */
-
-    /* Check for error. If so, call callback to inform. */
-    if(namemapptr->err != 0) {
-      namemapptr->state = STATE_ERROR;
       resolv_found(namemapptr->name, NULL);
       return;
     }
+
+    /* We'll change this to DONE when we find the record. */
+    namemapptr->state = STATE_ERROR;
+
+#if RESOLV_SUPPORTS_RECORD_EXPIRATION
+    /* If we remain in the error state, keep it cached for a while. */
+    namemapptr->expiration = clock_seconds() + RESOLV_NEGATIVE_TTL;
+#endif /* RESOLV_SUPPORTS_RECORD_EXPIRATION */
   }
 
   i = 0;
@@ -1000,6 +1104,7 @@ newdata(void)
           namemapptr = NULL;
           goto skip_to_next_answer;
         }
+        namemapptr->hash = name_hash(namemapptr->name);
       }
       if(i == RESOLV_ENTRIES) {
         DEBUG_PRINTF
@@ -1034,7 +1139,11 @@ newdata(void)
 
     namemapptr->state = STATE_DONE;
 #if RESOLV_SUPPORTS_RECORD_EXPIRATION
-    namemapptr->expiration = ans->ttl[1] + (ans->ttl[0] << 8);
+    namemapptr->expiration = ((unsigned long)uip_ntohs(ans->ttl[0]) << 16) |
+      uip_ntohs(ans->ttl[1]);
+    if(namemapptr->expiration > RESOLV_MAX_TTL) {
+      namemapptr->expiration = RESOLV_MAX_TTL;
+    }
     namemapptr->expiration += clock_seconds();
 #endif /* RESOLV_SUPPORTS_RECORD_EXPIRATION */
 
@@ -1232,14 +1341,17 @@ resolv_query(const char *name)
 
   register struct namemap *nameptr = 0;
 
+  uint8_t hash;
+
   lseq = lseqi = 0;
 
   /* Remove trailing dots, if present. */
   name = remove_trailing_dots(name);
+  hash = name_hash(name);
 
   for(i = 0; i < RESOLV_ENTRIES; ++i) {
     nameptr = &names[i];
-    if(0 == strcasecmp(nameptr->name, name)) {
+    if(nameptr->hash == hash && 0 == strcasecmp(nameptr->name, name)) {
       break;
     }
     if((nameptr->state == STATE_UNUSED)
@@ -1265,6 +1377,7 @@ resolv_query(const char *name)
   memset(nameptr, 0, sizeof(*nameptr));
 
   strncpy(nameptr->name, name, sizeof(nameptr->name));
+  nameptr->hash = hash;
   nameptr->state = STATE_NEW;
   nameptr->seqno = seqno;
   ++seqno;
@@ -1309,8 +1422,11 @@ resolv_lookup(const char *name, uip_ipaddr_t ** ipaddr)
 
   struct namemap *nameptr;
 
+  uint8_t hash;
+
   /* Remove trailing dots, if present. */
   name = remove_trailing_dots(name);
+  hash = name_hash(name);
 
 #if UIP_CONF_LOOPBACK_INTERFACE
   if(strcmp(name, "localhost")) {
@@ -1332,14 +1448,27 @@ resolv_lookup(const char *name, uip_ipaddr_t ** ipaddr)
   for(i = 0; i < RESOLV_ENTRIES; ++i) {
     nameptr = &names[i];
 
-    if(strcasecmp(name, nameptr->name) == 0) {
+    if(nameptr->hash == hash && strcasecmp(name, nameptr->name) == 0) {
       switch (nameptr->state) {
       case STATE_DONE:
+      case STATE_REFRESH:
         ret = RESOLV_STATUS_CACHED;
 #if RESOLV_SUPPORTS_RECORD_EXPIRATION
         if(clock_seconds() > nameptr->expiration) {
           ret = RESOLV_STATUS_EXPIRED;
         }
+#if RESOLV_REFRESH_TIME
+        else if(nameptr->state == STATE_DONE &&
+                nameptr->expiration - clock_seconds() < RESOLV_REFRESH_TIME) {
+          /* Ask again before a name in use expires, the old address
+             is returned until the answer arrives */
+          PRINTF("resolver: Refreshing \"%s\".\n", nameptr->name);
+          nameptr->state = STATE_REFRESH;
+          nameptr->tmr = 1;
+          nameptr->retries = 0;
+          process_post(&resolv_process, PROCESS_EVENT_TIMER, 0);
+        }
+#endif /* RESOLV_REFRESH_TIME */
 #endif /* RESOLV_SUPPORTS_RECORD_EXPIRATION */
         break;
       case STATE_NEW:
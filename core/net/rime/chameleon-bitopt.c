@@ -53,10 +53,50 @@
 #define CHAMELEON_WITH_MAC_LINK_ADDRESSES 0
 #endif /* !CHAMELEON_CONF_WITH_MAC_LINK_ADDRESSES */
 
+/* The layout of the header is fixed for each attribute list. It is
+   computed once into a program of fields when a channel sets its
+   attributes. Fields that start and end on byte boundaries are then
+   copied as bytes, only the others are packed bit by bit. Attribute
+   lists that find no room in the tables are packed as before. */
+#ifdef CHAMELEON_BITOPT_CONF_PROGRAMS
+#define PROGRAMS CHAMELEON_BITOPT_CONF_PROGRAMS
+#else /* CHAMELEON_BITOPT_CONF_PROGRAMS */
+#define PROGRAMS 8
+#endif /* CHAMELEON_BITOPT_CONF_PROGRAMS */
+
+/* Number of fields shared by all programs */
+#ifdef CHAMELEON_BITOPT_CONF_FIELDS
+#define FIELDS CHAMELEON_BITOPT_CONF_FIELDS
+#else /* CHAMELEON_BITOPT_CONF_FIELDS */
+#define FIELDS 32
+#endif /* CHAMELEON_BITOPT_CONF_FIELDS */
+
 struct bitopt_hdr {
   uint8_t channel[2];
 };
 
+#if PROGRAMS
+struct field {
+  uint8_t type;
+  uint8_t bitptr;
+  uint8_t len;
+};
+
+struct program {
+  const struct packetbuf_attrlist *attrlist;
+  uint8_t first;
+  uint8_t num;
+  /* All fields are whole bytes, the header needs no clearing */
+  uint8_t aligned;
+};
+
+static struct field fields[FIELDS];
+static struct program programs[PROGRAMS];
+static uint8_t num_fields, num_programs;
+
+#define FIELD_ALIGNED(f) ((((f)->bitptr | (f)->len) & 7) == 0)
+#endif /* PROGRAMS */
+
 static const uint8_t bitmask[9] = { 0x00, 0x80, 0xc0, 0xe0, 0xf0,
 				 0xf8, 0xfc, 0xfe, 0xff };
 
@@ -118,34 +158,6 @@ get_bits(uint8_t *to, uint8_t *from, int bitpos, int vallen)
   }
 }
 /*---------------------------------------------------------------------------*/
-static int
-header_size(const struct packetbuf_attrlist *a)
-{
-  int size, len;
-  
-  /* Compute the total size of the final header by summing the size of
-     all attributes that are used on this channel. */
-  
-  size = 0;
-  for(; a->type != PACKETBUF_ATTR_NONE; ++a) {
-#if CHAMELEON_WITH_MAC_LINK_ADDRESSES
-    if(a->type == PACKETBUF_ADDR_SENDER ||
-       a->type == PACKETBUF_ADDR_RECEIVER) {
-      /* Let the link layer handle sender and receiver */
-      continue;
-    }
-#endif /* CHAMELEON_WITH_MAC_LINK_ADDRESSES */
-    /*    PRINTF("chameleon header_size: header type %d len %d\n",
-	   a->type, a->len);*/
-    len = a->len;
-    /*    if(len < 8) {
-      len = 8;
-      }*/
-    size += len;
-  }
-  return size;
-}
-/*---------------------------------------------------------------------------*/
 void CC_INLINE
 set_bits_in_byte(uint8_t *target, int bitpos, uint8_t val, int vallen)
 {
@@ -192,6 +204,151 @@ set_bits(uint8_t *ptr, int bitpos, uint8_t *val, int vallen)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if PROGRAMS
+static struct program *
+find_program(const struct packetbuf_attrlist *attrlist)
+{
+  uint8_t i;
+
+  for(i = 0; i < num_programs; i++) {
+    if(programs[i].attrlist == attrlist) {
+      return &programs[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+compile_program(const struct packetbuf_attrlist *a)
+{
+  struct program *p;
+  struct field *f;
+  int bitptr;
+
+  if(num_programs == PROGRAMS || find_program(a) != NULL) {
+    return;
+  }
+  p = &programs[num_programs];
+  p->attrlist = a;
+  p->first = num_fields;
+  p->num = 0;
+  p->aligned = 1;
+
+  bitptr = 0;
+  for(; a->type != PACKETBUF_ATTR_NONE; ++a) {
+#if CHAMELEON_WITH_MAC_LINK_ADDRESSES
+    if(a->type == PACKETBUF_ADDR_SENDER ||
+       a->type == PACKETBUF_ADDR_RECEIVER) {
+      continue;
+    }
+#endif /* CHAMELEON_WITH_MAC_LINK_ADDRESSES */
+    if(p->first + p->num == FIELDS || bitptr > 0xff) {
+      /* Out of fields, the list is packed bit by bit */
+      return;
+    }
+    f = &fields[p->first + p->num];
+    f->type = a->type;
+    f->bitptr = bitptr;
+    f->len = a->len;
+    if(!FIELD_ALIGNED(f)) {
+      p->aligned = 0;
+    }
+    p->num++;
+    bitptr += a->len;
+  }
+  num_fields += p->num;
+  num_programs++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_pack(const struct program *p, uint8_t *hdrptr, int hdrbytesize)
+{
+  const struct field *f, *end;
+  packetbuf_attr_t val;
+  uint8_t *from;
+
+  if(!p->aligned) {
+    memset(hdrptr, 0, hdrbytesize);
+  }
+  end = &fields[p->first + p->num];
+  for(f = &fields[p->first]; f < end; f++) {
+    if(PACKETBUF_IS_ADDR(f->type)) {
+      from = (uint8_t *)packetbuf_addr(f->type);
+    } else {
+      val = packetbuf_attr(f->type);
+      from = (uint8_t *)&val;
+    }
+    if(FIELD_ALIGNED(f)) {
+      memcpy(&hdrptr[f->bitptr >> 3], from, f->len >> 3);
+    } else {
+      set_bits(&hdrptr[f->bitptr >> 3], f->bitptr & 7, from, f->len);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_unpack(const struct program *p, uint8_t *hdrptr)
+{
+  const struct field *f, *end;
+
+  end = &fields[p->first + p->num];
+  for(f = &fields[p->first]; f < end; f++) {
+    if(PACKETBUF_IS_ADDR(f->type)) {
+      rimeaddr_t addr;
+      if(FIELD_ALIGNED(f)) {
+        memcpy(&addr, &hdrptr[f->bitptr >> 3], f->len >> 3);
+      } else {
+        get_bits((uint8_t *)&addr, &hdrptr[f->bitptr >> 3], f->bitptr & 7,
+                 f->len);
+      }
+      packetbuf_set_addr(f->type, &addr);
+    } else {
+      packetbuf_attr_t val = 0;
+      if(FIELD_ALIGNED(f)) {
+        memcpy(&val, &hdrptr[f->bitptr >> 3], f->len >> 3);
+      } else {
+        get_bits((uint8_t *)&val, &hdrptr[f->bitptr >> 3], f->bitptr & 7,
+                 f->len);
+      }
+      packetbuf_set_attr(f->type, val);
+    }
+  }
+}
+#endif /* PROGRAMS */
+/*---------------------------------------------------------------------------*/
+static int
+header_size(const struct packetbuf_attrlist *a)
+{
+  int size, len;
+
+#if PROGRAMS
+  /* Called once for the attribute list of each channel */
+  compile_program(a);
+#endif /* PROGRAMS */
+  
+  /* Compute the total size of the final header by summing the size of
+     all attributes that are used on this channel. */
+  
+  size = 0;
+  for(; a->type != PACKETBUF_ATTR_NONE; ++a) {
+#if CHAMELEON_WITH_MAC_LINK_ADDRESSES
+    if(a->type == PACKETBUF_ADDR_SENDER ||
+       a->type == PACKETBUF_ADDR_RECEIVER) {
+      /* Let the link layer handle sender and receiver */
+      continue;
+    }
+#endif /* CHAMELEON_WITH_MAC_LINK_ADDRESSES */
+    /*    PRINTF("chameleon header_size: header type %d len %d\n",
+	   a->type, a->len);*/
+    len = a->len;
+    /*    if(len < 8) {
+      len = 8;
+      }*/
+    size += len;
+  }
+  return size;
+}
+/*---------------------------------------------------------------------------*/
 #if 0
 static void
 printbin(int n, int digits)
@@ -238,6 +395,9 @@ pack_header(struct channel *c)
   int byteptr, bitptr, len;
   uint8_t *hdrptr;
   struct bitopt_hdr *hdr;
+#if PROGRAMS
+  struct program *p;
+#endif /* PROGRAMS */
   
   /* Compute the total size of the final header by summing the size of
      all attributes that are used on this channel. */
@@ -252,6 +412,15 @@ pack_header(struct channel *c)
   hdr->channel[1] = (c->channelno >> 8) & 0xff;
 
   hdrptr = ((uint8_t *)packetbuf_hdrptr()) + sizeof(struct bitopt_hdr);
+
+#if PROGRAMS
+  p = find_program(c->attrlist);
+  if(p != NULL) {
+    run_pack(p, hdrptr, hdrbytesize);
+    return 1; /* Send out packet */
+  }
+#endif /* PROGRAMS */
+
   memset(hdrptr, 0, hdrbytesize);
   
   byteptr = bitptr = 0;
@@ -304,6 +473,9 @@ unpack_header(void)
   uint8_t *hdrptr;
   struct bitopt_hdr *hdr;
   struct channel *c;
+#if PROGRAMS
+  struct program *p;
+#endif /* PROGRAMS */
   
 
   /* The packet has a header that tells us what channel the packet is
@@ -326,6 +498,15 @@ unpack_header(void)
     PRINTF("chameleon-bitopt: too short packet\n");
     return NULL;
   }
+
+#if PROGRAMS
+  p = find_program(c->attrlist);
+  if(p != NULL) {
+    run_unpack(p, hdrptr);
+    return c;
+  }
+#endif /* PROGRAMS */
+
   byteptr = bitptr = 0;
   for(a = c->attrlist; a->type != PACKETBUF_ATTR_NONE; ++a) {
 #if CHAMELEON_WITH_MAC_LINK_ADDRESSES
@@ -41,13 +41,43 @@
 #include "net/rime.h"
 #include "lib/list.h"
 
+#include <string.h>
+
 LIST(channel_list);
 
+#if CHANNEL_TABLE_SIZE
+/* First opened channel of each slot, the others are found in the list */
+static struct channel *channel_table[CHANNEL_TABLE_SIZE];
+#define SLOT(channelno) ((channelno) & (CHANNEL_TABLE_SIZE - 1))
+
+/*---------------------------------------------------------------------------*/
+static void
+table_remove(struct channel *c)
+{
+  struct channel *other;
+  uint8_t slot = SLOT(c->channelno);
+
+  if(channel_table[slot] != c) {
+    return;
+  }
+  channel_table[slot] = NULL;
+  for(other = list_head(channel_list); other != NULL;
+      other = list_item_next(other)) {
+    if(other != c && SLOT(other->channelno) == slot) {
+      channel_table[slot] = other;
+      break;
+    }
+  }
+}
+#endif /* CHANNEL_TABLE_SIZE */
 /*---------------------------------------------------------------------------*/
 void
 channel_init(void)
 {
   list_init(channel_list);
+#if CHANNEL_TABLE_SIZE
+  memset(channel_table, 0, sizeof(channel_table));
+#endif /* CHANNEL_TABLE_SIZE */
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -65,13 +95,25 @@ channel_set_attributes(uint16_t channelno,
 void
 channel_open(struct channel *c, uint16_t channelno)
 {
+#if CHANNEL_TABLE_SIZE
+  /* c may be reopened on another channel */
+  table_remove(c);
+#endif /* CHANNEL_TABLE_SIZE */
   c->channelno = channelno;
   list_add(channel_list, c);
+#if CHANNEL_TABLE_SIZE
+  if(channel_table[SLOT(channelno)] == NULL) {
+    channel_table[SLOT(channelno)] = c;
+  }
+#endif /* CHANNEL_TABLE_SIZE */
 }
 /*---------------------------------------------------------------------------*/
 void
 channel_close(struct channel *c)
 {
+#if CHANNEL_TABLE_SIZE
+  table_remove(c);
+#endif /* CHANNEL_TABLE_SIZE */
   list_remove(channel_list, c);
 }
 /*---------------------------------------------------------------------------*/
@@ -79,6 +121,12 @@ struct channel *
 channel_lookup(uint16_t channelno)
 {
   struct channel *c;
+#if CHANNEL_TABLE_SIZE
+  c = channel_table[SLOT(channelno)];
+  if(c != NULL && c->channelno == channelno) {
+    return c;
+  }
+#endif /* CHANNEL_TABLE_SIZE */
   for(c = list_head(channel_list); c != NULL; c = list_item_next(c)) {
     if(c->channelno == channelno) {
       return c;
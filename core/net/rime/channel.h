@@ -46,6 +46,15 @@ struct channel;
 #include "net/packetbuf.h"
 #include "net/rime/chameleon.h"
 
+/* Number of slots of the lookup table in front of the channel list,
+   indexed by the low bits of the channel number. A power of two, 0 for
+   list lookups only. */
+#ifdef CHANNEL_CONF_TABLE_SIZE
+#define CHANNEL_TABLE_SIZE CHANNEL_CONF_TABLE_SIZE
+#else /* CHANNEL_CONF_TABLE_SIZE */
+#define CHANNEL_TABLE_SIZE 8
+#endif /* CHANNEL_CONF_TABLE_SIZE */
+
 struct channel {
   struct channel *next;
   uint16_t channelno;
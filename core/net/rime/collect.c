@@ -111,6 +111,35 @@ struct ack_msg {
 #define ACK_FLAGS_LIFETIME_EXCEEDED     0x20
 #define ACK_FLAGS_RTMETRIC_NEEDS_UPDATE 0x10
 
+/* With COLLECT_CONF_AGGREGATE, a forwarder merges a packet into the
+   packet that waits last on its send queue, as long as the merged
+   frame stays within COLLECT_CONF_AGGREGATE_SIZE bytes. The frame has
+   the DATA_FLAGS_AGGREGATE flag set and carries the packets as
+   records that keep their originator, sequence number and hop
+   count. The sink unpacks the records, so all nodes of a network must
+   use the same setting. */
+#ifdef COLLECT_CONF_AGGREGATE
+#define AGGREGATE COLLECT_CONF_AGGREGATE
+#else /* COLLECT_CONF_AGGREGATE */
+#define AGGREGATE 0
+#endif /* COLLECT_CONF_AGGREGATE */
+
+/* Leaves room for the Rime and MAC headers in an 802.15.4 frame */
+#ifdef COLLECT_CONF_AGGREGATE_SIZE
+#define AGGREGATE_SIZE COLLECT_CONF_AGGREGATE_SIZE
+#else /* COLLECT_CONF_AGGREGATE_SIZE */
+#define AGGREGATE_SIZE 80
+#endif /* COLLECT_CONF_AGGREGATE_SIZE */
+
+#define DATA_FLAGS_AGGREGATE            0x01
+
+struct aggregate_hdr {
+  rimeaddr_t originator;
+  uint8_t eseqno;
+  uint8_t hops;
+  uint8_t len;
+};
+
 
 /* These are configuration knobs that normally should not be
    tweaked. MAX_MAC_REXMITS defines how many times the underlying CSMA
@@ -193,6 +222,7 @@ struct {
   uint32_t ttldrop;
   uint32_t ackdrop;
   uint32_t timedout;
+  uint32_t aggregated;
 } stats;
 
 /* Debug definition: draw routing tree in Cooja. */
@@ -210,6 +240,7 @@ static void send_queued_packet(struct collect_conn *c);
 static void retransmit_callback(void *ptr);
 static void retransmit_not_sent_callback(void *ptr);
 static void set_keepalive_timer(struct collect_conn *c);
+static uint8_t new_eseqno(struct collect_conn *tc);
 
 /*---------------------------------------------------------------------------*/
 /**
@@ -466,6 +497,7 @@ enqueue_dummy_packet(struct collect_conn *c, int rexmits)
 
   /* Allocate space for the header. */
   packetbuf_hdralloc(sizeof(struct data_msg_hdr));
+  memset(packetbuf_hdrptr(), 0, sizeof(struct data_msg_hdr));
 
   n = collect_neighbor_list_find(&c->neighbor_list, &c->parent);
   if(n != NULL) {
@@ -631,6 +663,7 @@ send_queued_packet(struct collect_conn *c)
       /* Copy our rtmetric into the packet header of the outgoing
          packet. */
       memset(&hdr, 0, sizeof(hdr));
+      hdr.flags = ((struct data_msg_hdr *)packetbuf_dataptr())->flags;
       hdr.rtmetric = c->rtmetric;
       memcpy(packetbuf_dataptr(), &hdr, sizeof(struct data_msg_hdr));
 
@@ -732,6 +765,7 @@ retransmit_current_packet(struct collect_conn *c)
       /* Copy our rtmetric into the packet header of the outgoing
          packet. */
       memset(&hdr, 0, sizeof(hdr));
+      hdr.flags = ((struct data_msg_hdr *)packetbuf_dataptr())->flags;
       hdr.rtmetric = c->rtmetric;
       memcpy(packetbuf_dataptr(), &hdr, sizeof(struct data_msg_hdr));
 
@@ -907,6 +941,187 @@ add_packet_to_recent_packets(struct collect_conn *tc)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if AGGREGATE
+static int
+records_len(uint8_t flags, int len)
+{
+  if(len <= 0 || (flags & DATA_FLAGS_AGGREGATE)) {
+    return len;
+  }
+  return len + sizeof(struct aggregate_hdr);
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Copies the packet in the packetbuf to dst as records and returns
+ * their length. hdrlen is the size of the data header in front of the
+ * data, 0 for a packet that is just being originated. The hops of the
+ * records are counted up to this node, the merged frame starts again
+ * from zero.
+ */
+static int
+packetbuf_records(uint8_t *dst, int hdrlen)
+{
+  uint8_t *data;
+  uint8_t flags;
+  struct aggregate_hdr *rec;
+  int len, offset;
+
+  data = (uint8_t *)packetbuf_dataptr() + hdrlen;
+  flags = hdrlen > 0 ? ((struct data_msg_hdr *)packetbuf_dataptr())->flags : 0;
+  len = packetbuf_datalen() - hdrlen;
+
+  if(flags & DATA_FLAGS_AGGREGATE) {
+    memcpy(dst, data, len);
+    for(offset = 0; offset + sizeof(struct aggregate_hdr) <= len;
+        offset += sizeof(struct aggregate_hdr) + rec->len) {
+      rec = (struct aggregate_hdr *)(dst + offset);
+      rec->hops += packetbuf_attr(PACKETBUF_ATTR_HOPS);
+    }
+    return len;
+  }
+
+  rec = (struct aggregate_hdr *)dst;
+  rimeaddr_copy(&rec->originator, packetbuf_addr(PACKETBUF_ADDR_ESENDER));
+  rec->eseqno = packetbuf_attr(PACKETBUF_ATTR_EPACKET_ID);
+  rec->hops = packetbuf_attr(PACKETBUF_ATTR_HOPS);
+  rec->len = len;
+  memcpy(dst + sizeof(struct aggregate_hdr), data, len);
+  return sizeof(struct aggregate_hdr) + len;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Returns the queued packet that the packet in the packetbuf can be
+ * merged into, or NULL. A packet that has been transmitted already
+ * must not change, or the parent may take it for a duplicate.
+ */
+static struct packetqueue_item *
+aggregation_target(struct collect_conn *tc, int hdrlen)
+{
+  struct packetqueue_item *i;
+  struct queuebuf *q;
+  int len, taillen;
+  uint8_t flags;
+
+  flags = hdrlen > 0 ? ((struct data_msg_hdr *)packetbuf_dataptr())->flags : 0;
+  len = records_len(flags, packetbuf_datalen() - hdrlen);
+
+  i = packetqueue_last(&tc->send_queue);
+  if(len <= 0 || i == NULL) {
+    return NULL;
+  }
+  if(i == packetqueue_first(&tc->send_queue) &&
+     (tc->sending || tc->transmissions > 0)) {
+    return NULL;
+  }
+
+  q = packetqueue_queuebuf(i);
+  taillen = records_len(((struct data_msg_hdr *)queuebuf_dataptr(q))->flags,
+                        queuebuf_datalen(q) - sizeof(struct data_msg_hdr));
+  if(taillen <= 0 || taillen + len > AGGREGATE_SIZE) {
+    return NULL;
+  }
+  return i;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Merges the packet in the packetbuf into the queued packet i, which
+ * was returned by aggregation_target(). The packetbuf is overwritten.
+ */
+static void
+aggregate(struct collect_conn *tc, struct packetqueue_item *i, int hdrlen)
+{
+  uint8_t buf[AGGREGATE_SIZE];
+  struct queuebuf *q;
+  struct data_msg_hdr hdr;
+  int len, taillen;
+  uint8_t ttl, rexmits;
+
+  q = packetqueue_queuebuf(i);
+  taillen = records_len(((struct data_msg_hdr *)queuebuf_dataptr(q))->flags,
+                        queuebuf_datalen(q) - sizeof(struct data_msg_hdr));
+
+  /* The new packet goes after the queued ones */
+  len = packetbuf_records(&buf[taillen], hdrlen);
+  ttl = packetbuf_attr(PACKETBUF_ATTR_TTL);
+  rexmits = packetbuf_attr(PACKETBUF_ATTR_MAX_REXMIT);
+
+  queuebuf_to_packetbuf(q);
+  packetbuf_records(buf, sizeof(struct data_msg_hdr));
+  len += taillen;
+
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.flags = DATA_FLAGS_AGGREGATE;
+  memcpy(packetbuf_dataptr(), &hdr, sizeof(struct data_msg_hdr));
+  memcpy((uint8_t *)packetbuf_dataptr() + sizeof(struct data_msg_hdr), buf, len);
+  packetbuf_set_datalen(sizeof(struct data_msg_hdr) + len);
+
+  /* The frame is a new packet of this node */
+  packetbuf_set_addr(PACKETBUF_ADDR_ESENDER, &rimeaddr_node_addr);
+  packetbuf_set_attr(PACKETBUF_ATTR_EPACKET_ID, new_eseqno(tc));
+  packetbuf_set_attr(PACKETBUF_ATTR_HOPS, 0);
+  if(ttl < packetbuf_attr(PACKETBUF_ATTR_TTL)) {
+    packetbuf_set_attr(PACKETBUF_ATTR_TTL, ttl);
+  }
+  if(rexmits > packetbuf_attr(PACKETBUF_ATTR_MAX_REXMIT)) {
+    packetbuf_set_attr(PACKETBUF_ATTR_MAX_REXMIT, rexmits);
+  }
+
+  /* Only collect packets are queued, they are never references */
+  queuebuf_update_from_packetbuf(q);
+  stats.aggregated++;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Calls the receive callback for each record of the aggregate frame
+ * in the packetbuf, with the data header already removed.
+ */
+static void
+deliver_aggregate(struct collect_conn *tc)
+{
+  struct queuebuf *q;
+  struct aggregate_hdr rec;
+  rimeaddr_t originator;
+  int datalen, offset, consumed;
+  uint8_t hops;
+
+  hops = packetbuf_attr(PACKETBUF_ATTR_HOPS);
+  datalen = packetbuf_datalen();
+
+  /* The callback may use the packetbuf, so every record is taken from
+     a copy of the frame. Without a free queuebuf the records are
+     passed up in place. */
+  q = queuebuf_new_from_packetbuf();
+  consumed = 0;
+  for(offset = 0; offset + sizeof(rec) <= datalen;
+      offset += sizeof(rec) + rec.len) {
+    if(q != NULL) {
+      queuebuf_to_packetbuf(q);
+      consumed = 0;
+    }
+    packetbuf_set_datalen(datalen - consumed);
+    packetbuf_hdrreduce(offset - consumed);
+    memcpy(&rec, packetbuf_dataptr(), sizeof(rec));
+    if(offset + sizeof(rec) + rec.len > datalen) {
+      break;
+    }
+    packetbuf_hdrreduce(sizeof(rec));
+    packetbuf_set_datalen(rec.len);
+    consumed = offset + sizeof(rec);
+
+    rimeaddr_copy(&originator, &rec.originator);
+    packetbuf_set_addr(PACKETBUF_ADDR_ESENDER, &originator);
+    packetbuf_set_attr(PACKETBUF_ATTR_EPACKET_ID, rec.eseqno);
+    packetbuf_set_attr(PACKETBUF_ATTR_HOPS, rec.hops + hops);
+    if(rec.len > 0 && tc->cb->recv != NULL) {
+      tc->cb->recv(&originator, rec.eseqno, rec.hops + hops);
+    }
+  }
+  if(q != NULL) {
+    queuebuf_free(q);
+  }
+}
+#endif /* AGGREGATE */
+/*---------------------------------------------------------------------------*/
 static void
 node_packet_received(struct unicast_conn *c, const rimeaddr_t *from)
 {
@@ -916,6 +1131,9 @@ node_packet_received(struct unicast_conn *c, const rimeaddr_t *from)
   struct data_msg_hdr hdr;
   uint8_t ackflags = 0;
   struct collect_neighbor *n;
+#if AGGREGATE
+  struct packetqueue_item *q;
+#endif /* AGGREGATE */
 
   memcpy(&hdr, packetbuf_dataptr(), sizeof(struct data_msg_hdr));
 
@@ -1005,6 +1223,12 @@ node_packet_received(struct unicast_conn *c, const rimeaddr_t *from)
              from->u8[0], from->u8[1]);
 
       packetbuf_hdrreduce(sizeof(struct data_msg_hdr));
+#if AGGREGATE
+      if(hdr.flags & DATA_FLAGS_AGGREGATE) {
+        deliver_aggregate(tc);
+        return;
+      }
+#endif /* AGGREGATE */
       /* Call receive function. */
       if(packetbuf_datalen() > 0 && tc->cb->recv != NULL) {
         tc->cb->recv(packetbuf_addr(PACKETBUF_ADDR_ESENDER),
@@ -1046,6 +1270,18 @@ node_packet_received(struct unicast_conn *c, const rimeaddr_t *from)
          memory problems. We first check the size of our sending queue
          to ensure that we always have entries for packets that
          are originated by this node. */
+#if AGGREGATE
+      /* A packet that fits into a queued one takes no queue entry. */
+      q = aggregation_target(tc, sizeof(struct data_msg_hdr));
+      if(q != NULL) {
+        add_packet_to_recent_packets(tc);
+        aggregate(tc, q, sizeof(struct data_msg_hdr));
+        /* send_ack() takes the packet id from the packetbuf. */
+        packetbuf_set_attr(PACKETBUF_ATTR_PACKET_ID, packet_seqno);
+        send_ack(tc, &ack_to, ackflags);
+        send_queued_packet(tc);
+      } else
+#endif /* AGGREGATE */
       if(packetqueue_len(&tc->send_queue) <= MAX_SENDING_QUEUE - MIN_AVAILABLE_QUEUE_ENTRIES &&
          packetqueue_enqueue_packetbuf(&tc->send_queue,
                                        FORWARD_PACKET_LIFETIME_BASE *
@@ -1289,7 +1525,7 @@ collect_open(struct collect_conn *tc, uint16_t channels,
   tc->is_router = is_router;
   tc->seqno = 10;
   tc->eseqno = 0;
-  LIST_STRUCT_INIT(tc, send_queue_list);
+  list_tailed_init(&tc->send_queue_list);
   collect_neighbor_list_new(&tc->neighbor_list);
   tc->send_queue.list = &(tc->send_queue_list);
   tc->send_queue.memb = &send_queue_memb;
@@ -1402,13 +1638,12 @@ collect_set_sink(struct collect_conn *tc, int should_be_sink)
   }
 }
 /*---------------------------------------------------------------------------*/
-int
-collect_send(struct collect_conn *tc, int rexmits)
+static uint8_t
+new_eseqno(struct collect_conn *tc)
 {
-  struct collect_neighbor *n;
-  int ret;
-  
-  packetbuf_set_attr(PACKETBUF_ATTR_EPACKET_ID, tc->eseqno);
+  uint8_t eseqno;
+
+  eseqno = tc->eseqno;
 
   /* Increase the sequence number for the packet we send out. We
      employ a trick that allows us to see that a node has been
@@ -1423,6 +1658,19 @@ collect_send(struct collect_conn *tc, int rexmits)
   if(tc->eseqno == 0) {
     tc->eseqno = ((int)(1 << COLLECT_PACKET_ID_BITS)) / 2;
   }
+  return eseqno;
+}
+/*---------------------------------------------------------------------------*/
+int
+collect_send(struct collect_conn *tc, int rexmits)
+{
+  struct collect_neighbor *n;
+  int ret;
+#if AGGREGATE
+  struct packetqueue_item *i;
+#endif /* AGGREGATE */
+  
+  packetbuf_set_attr(PACKETBUF_ATTR_EPACKET_ID, new_eseqno(tc));
   packetbuf_set_addr(PACKETBUF_ADDR_ESENDER, &rimeaddr_node_addr);
   packetbuf_set_attr(PACKETBUF_ATTR_HOPS, 1);
   packetbuf_set_attr(PACKETBUF_ATTR_TTL, MAX_HOPLIM);
@@ -1447,8 +1695,19 @@ collect_send(struct collect_conn *tc, int rexmits)
     return 1;
   } else {
 
+#if AGGREGATE
+    /* The queue is not empty, so a parent was looked for already. */
+    i = aggregation_target(tc, 0);
+    if(i != NULL) {
+      aggregate(tc, i, 0);
+      send_queued_packet(tc);
+      return 1;
+    }
+#endif /* AGGREGATE */
+
     /* Allocate space for the header. */
     packetbuf_hdralloc(sizeof(struct data_msg_hdr));
+    memset(packetbuf_hdrptr(), 0, sizeof(struct data_msg_hdr));
 
     if(packetqueue_enqueue_packetbuf(&tc->send_queue,
                                      FORWARD_PACKET_LIFETIME_BASE *
@@ -1530,12 +1789,12 @@ collect_purge(struct collect_conn *tc)
 void
 collect_print_stats(void)
 {
-  PRINTF("collect stats foundroute %lu newparent %lu routelost %lu acksent %lu datasent %lu datarecv %lu ackrecv %lu badack %lu duprecv %lu qdrop %lu rtdrop %lu ttldrop %lu ackdrop %lu timedout %lu\n",
+  PRINTF("collect stats foundroute %lu newparent %lu routelost %lu acksent %lu datasent %lu datarecv %lu ackrecv %lu badack %lu duprecv %lu qdrop %lu rtdrop %lu ttldrop %lu ackdrop %lu timedout %lu aggregated %lu\n",
          stats.foundroute, stats.newparent, stats.routelost,
          stats.acksent, stats.datasent, stats.datarecv,
          stats.ackrecv, stats.badack, stats.duprecv,
          stats.qdrop, stats.rtdrop, stats.ttldrop, stats.ackdrop,
-         stats.timedout);
+         stats.timedout, stats.aggregated);
 }
 /*---------------------------------------------------------------------------*/
 /** @} */
@@ -102,7 +102,7 @@ struct collect_conn {
 #endif /* COLLECT_ANNOUNCEMENTS */
   const struct collect_callbacks *cb;
   struct ctimer retransmission_timer;
-  LIST_STRUCT(send_queue_list);
+  struct list_tailed send_queue_list;
   struct packetqueue send_queue;
   struct collect_neighbor_list neighbor_list;
 
@@ -0,0 +1,443 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \addtogroup rimembulk
+ * @{
+ */
+
+/**
+ * \file
+ *         Multi-hop bulk transfer with a window and selective acks
+ */
+
+#include "net/rime/mbulk.h"
+#include "net/rime.h"
+#include "lib/random.h"
+#include <string.h>
+
+/* Time between two chunks, leaves the forwarders room to pass them on */
+#ifdef MBULK_CONF_SEND_INTERVAL
+#define SEND_INTERVAL MBULK_CONF_SEND_INTERVAL
+#else
+#define SEND_INTERVAL (CLOCK_SECOND / 16)
+#endif
+
+/* Time without progress before the oldest chunk is sent again */
+#ifdef MBULK_CONF_TIMEOUT
+#define TIMEOUT MBULK_CONF_TIMEOUT
+#else
+#define TIMEOUT (CLOCK_SECOND * 4)
+#endif
+
+#ifdef MBULK_CONF_MAX_RETRIES
+#define MAX_RETRIES MBULK_CONF_MAX_RETRIES
+#else
+#define MAX_RETRIES 8
+#endif
+
+/* The receiver acks every ACK_EVERY chunks in order, or after ACK_DELAY */
+#define ACK_EVERY ((MBULK_WINDOW + 1) / 2)
+#define ACK_DELAY (CLOCK_SECOND / 2)
+
+/* A receiver that heard nothing for this long takes another sender */
+#define RX_IDLE (TIMEOUT * MAX_RETRIES)
+
+#define TYPE_DATA   0x01
+#define TYPE_ACK    0x02
+#define TYPE_MASK   0x7f
+#define FLAG_LAST   0x80
+
+#define NO_CHUNK    0xffff
+
+#define WINDOW_MASK ((uint16_t)((1UL << MBULK_WINDOW) - 1))
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+/* Followed by the chunk data, or by the received bitmap of an ack */
+struct mbulk_hdr {
+  uint8_t type;
+  uint8_t id;
+  uint16_t chunk;
+};
+
+static void send_next(void *ptr);
+/*---------------------------------------------------------------------------*/
+static void
+send_ack(struct mbulk_conn *c)
+{
+  struct mbulk_hdr *hdr;
+
+  ctimer_stop(&c->ack_timer);
+  c->unacked = 0;
+
+  packetbuf_clear();
+  hdr = packetbuf_dataptr();
+  hdr->type = TYPE_ACK;
+  hdr->id = c->rx_id;
+  hdr->chunk = c->expected;
+  memcpy(hdr + 1, &c->received, sizeof(c->received));
+  packetbuf_set_datalen(sizeof(struct mbulk_hdr) + sizeof(c->received));
+  mesh_send(&c->mesh, &c->sender);
+}
+/*---------------------------------------------------------------------------*/
+static void
+ack_timeout(void *ptr)
+{
+  send_ack(ptr);
+}
+/*---------------------------------------------------------------------------*/
+static void
+recv_data(struct mbulk_conn *c, const rimeaddr_t *from,
+          struct mbulk_hdr *hdr, int len)
+{
+  uint16_t off, holes;
+
+  if(!rimeaddr_cmp(from, &c->sender) || hdr->id != c->rx_id) {
+    if(c->receiving && !rimeaddr_cmp(from, &c->sender) &&
+       clock_time() - c->rx_time < RX_IDLE) {
+      return;
+    }
+    PRINTF("mbulk: new transfer %u from %d.%d\n", hdr->id,
+           from->u8[0], from->u8[1]);
+    rimeaddr_copy(&c->sender, from);
+    c->rx_id = hdr->id;
+    c->expected = 0;
+    c->received = 0;
+    c->rx_last = NO_CHUNK;
+    c->unacked = 0;
+    c->receiving = 1;
+  }
+  c->rx_time = clock_time();
+
+  if(hdr->chunk < c->expected) {
+    /* Our ack got lost */
+    send_ack(c);
+    return;
+  }
+  off = hdr->chunk - c->expected;
+  if(off > 16 || (off > 0 && (c->received & (1 << (off - 1))))) {
+    return;
+  }
+
+  if(c->cb->write_chunk != NULL) {
+    c->cb->write_chunk(c, from, (cfs_offset_t)hdr->chunk * MBULK_DATASIZE,
+                       (uint8_t *)(hdr + 1), len);
+  }
+  if(hdr->type & FLAG_LAST) {
+    c->rx_last = hdr->chunk;
+  }
+
+  holes = c->received;
+  if(off == 0) {
+    c->expected++;
+    while(c->received & 1) {
+      c->received >>= 1;
+      c->expected++;
+    }
+    c->received >>= 1;
+  } else {
+    c->received |= 1 << (off - 1);
+  }
+
+  if(c->rx_last != NO_CHUNK && c->expected > c->rx_last) {
+    send_ack(c);
+    if(c->receiving) {
+      c->receiving = 0;
+      if(c->cb->done != NULL) {
+        c->cb->done(c, from);
+      }
+    }
+    return;
+  }
+
+  /* Report a new hole at once, in order chunks now and then */
+  if((off > 0 && holes == 0) || ++c->unacked >= ACK_EVERY) {
+    send_ack(c);
+  } else if(ctimer_expired(&c->ack_timer)) {
+    ctimer_set(&c->ack_timer, ACK_DELAY, ack_timeout, c);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Returns -1 if the file cannot be read */
+static int
+send_chunk(struct mbulk_conn *c, uint16_t chunk)
+{
+  struct mbulk_hdr *hdr;
+  cfs_offset_t offset;
+  int len;
+
+  offset = (cfs_offset_t)chunk * MBULK_DATASIZE;
+  packetbuf_clear();
+  hdr = packetbuf_dataptr();
+  len = -1;
+  if(cfs_seek(c->fd, offset, CFS_SEEK_SET) == offset) {
+    len = cfs_read(c->fd, (uint8_t *)(hdr + 1), MBULK_DATASIZE);
+  }
+  if(len < 0) {
+    return -1;
+  }
+
+  hdr->type = TYPE_DATA;
+  hdr->id = c->id;
+  hdr->chunk = chunk;
+  if(len < MBULK_DATASIZE) {
+    hdr->type |= FLAG_LAST;
+    c->last = chunk;
+  }
+  packetbuf_set_datalen(sizeof(struct mbulk_hdr) + len);
+  PRINTF("mbulk: sending chunk %u\n", chunk);
+  /* Without a route, mesh keeps the chunk until one is found */
+  mesh_send(&c->mesh, &c->receiver);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Lost chunks first, then new ones as far as the window allows */
+static uint16_t
+next_chunk(struct mbulk_conn *c)
+{
+  uint16_t bit;
+  uint8_t i;
+
+  for(i = 0, bit = 1; i < MBULK_WINDOW && c->base + i < c->next;
+      i++, bit <<= 1) {
+    if(c->missing & bit) {
+      c->missing &= ~bit;
+      c->resent |= bit;
+      return c->base + i;
+    }
+  }
+  if(c->next < c->base + MBULK_WINDOW &&
+     (c->last == NO_CHUNK || c->next <= c->last)) {
+    return c->next++;
+  }
+  return NO_CHUNK;
+}
+/*---------------------------------------------------------------------------*/
+static void
+finish(struct mbulk_conn *c, int ok)
+{
+  mbulk_stop(c);
+  if(ok) {
+    if(c->cb->done != NULL) {
+      c->cb->done(c, &c->receiver);
+    }
+  } else if(c->cb->timedout != NULL) {
+    c->cb->timedout(c);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_next(void *ptr)
+{
+  struct mbulk_conn *c = ptr;
+  uint16_t chunk;
+
+  if(!c->sending) {
+    return;
+  }
+  if(mesh_ready(&c->mesh)) {
+    chunk = next_chunk(c);
+    if(chunk == NO_CHUNK) {
+      /* The window is full, an ack restarts us */
+      return;
+    }
+    if(send_chunk(c, chunk) < 0) {
+      finish(c, 0);
+      return;
+    }
+  }
+  ctimer_set(&c->send_timer, SEND_INTERVAL, send_next, c);
+}
+/*---------------------------------------------------------------------------*/
+static void
+kick(struct mbulk_conn *c)
+{
+  if(ctimer_expired(&c->send_timer)) {
+    send_next(c);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+rtx_timeout(void *ptr)
+{
+  struct mbulk_conn *c = ptr;
+
+  if(++c->retries > MAX_RETRIES) {
+    PRINTF("mbulk: timed out\n");
+    finish(c, 0);
+    return;
+  }
+  /* Send the oldest chunk again, and allow another round of the holes */
+  c->missing |= 1;
+  c->resent = 0;
+  ctimer_set(&c->rtx_timer, TIMEOUT, rtx_timeout, c);
+  kick(c);
+}
+/*---------------------------------------------------------------------------*/
+static void
+recv_ack(struct mbulk_conn *c, const rimeaddr_t *from,
+         struct mbulk_hdr *hdr, uint16_t received)
+{
+  uint16_t shift, rel, top, holes;
+  uint8_t progress;
+
+  if(!c->sending || hdr->id != c->id || !rimeaddr_cmp(from, &c->receiver) ||
+     hdr->chunk < c->base || hdr->chunk > c->next) {
+    return;
+  }
+
+  shift = hdr->chunk - c->base;
+  if(shift >= 16) {
+    c->missing = c->resent = c->acked = 0;
+  } else {
+    c->missing >>= shift;
+    c->resent >>= shift;
+    c->acked >>= shift;
+  }
+  c->base = hdr->chunk;
+
+  if(c->last != NO_CHUNK && c->base > c->last) {
+    PRINTF("mbulk: transfer done\n");
+    finish(c, 1);
+    return;
+  }
+
+  /* Bit i of rel is chunk base + i, base itself is missing */
+  rel = (received << 1) & WINDOW_MASK;
+  progress = shift > 0 || (rel & ~c->acked) != 0;
+  c->acked = rel;
+  holes = 0;
+  if(rel != 0) {
+    for(top = 0x8000; !(rel & top); top >>= 1);
+    holes = (top - 1) & ~rel;
+  }
+  c->missing = (c->missing | (holes & ~c->resent)) & ~rel;
+
+  if(progress) {
+    c->retries = 0;
+    ctimer_set(&c->rtx_timer, TIMEOUT, rtx_timeout, c);
+  }
+  kick(c);
+}
+/*---------------------------------------------------------------------------*/
+static void
+recv(struct mesh_conn *mesh, const rimeaddr_t *from, uint8_t hops)
+{
+  struct mbulk_conn *c = (struct mbulk_conn *)mesh;
+  struct mbulk_hdr *hdr;
+  uint16_t received;
+  int len;
+
+  len = packetbuf_datalen() - sizeof(struct mbulk_hdr);
+  if(len < 0) {
+    return;
+  }
+  hdr = packetbuf_dataptr();
+
+  switch(hdr->type & TYPE_MASK) {
+  case TYPE_DATA:
+    recv_data(c, from, hdr, len);
+    break;
+  case TYPE_ACK:
+    if(len >= sizeof(received)) {
+      memcpy(&received, hdr + 1, sizeof(received));
+      recv_ack(c, from, hdr, received);
+    }
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static const struct mesh_callbacks mesh_callbacks = { recv, NULL, NULL };
+/*---------------------------------------------------------------------------*/
+void
+mbulk_open(struct mbulk_conn *c, uint16_t channels,
+           const struct mbulk_callbacks *callbacks)
+{
+  mesh_open(&c->mesh, channels, &mesh_callbacks);
+  c->cb = callbacks;
+  c->id = random_rand();
+  c->sending = 0;
+  c->receiving = 0;
+  rimeaddr_copy(&c->sender, &rimeaddr_null);
+  ctimer_stop(&c->send_timer);
+  ctimer_stop(&c->rtx_timer);
+  ctimer_stop(&c->ack_timer);
+}
+/*---------------------------------------------------------------------------*/
+void
+mbulk_close(struct mbulk_conn *c)
+{
+  mbulk_stop(c);
+  ctimer_stop(&c->ack_timer);
+  mesh_close(&c->mesh);
+}
+/*---------------------------------------------------------------------------*/
+int
+mbulk_send(struct mbulk_conn *c, const rimeaddr_t *receiver, int fd)
+{
+  if(c->sending) {
+    return 0;
+  }
+
+  rimeaddr_copy(&c->receiver, receiver);
+  c->fd = fd;
+  c->base = 0;
+  c->next = 0;
+  c->last = NO_CHUNK;
+  c->missing = 0;
+  c->resent = 0;
+  c->acked = 0;
+  c->retries = 0;
+  c->id++;
+  c->sending = 1;
+
+  ctimer_set(&c->rtx_timer, TIMEOUT, rtx_timeout, c);
+  send_next(c);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+mbulk_stop(struct mbulk_conn *c)
+{
+  c->sending = 0;
+  ctimer_stop(&c->send_timer);
+  ctimer_stop(&c->rtx_timer);
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \addtogroup rime
+ * @{
+ */
+
+/**
+ * \defgroup rimembulk Multi-hop bulk transfer
+ * @{
+ *
+ * The mbulk module transfers a file to a node several hops away. The
+ * sender reads the chunks of the file directly from CFS and keeps a
+ * window of MBULK_WINDOW chunks in flight over mesh. The receiver
+ * acknowledges the chunks it has cumulatively and with a bitmap of the
+ * chunks after the first missing one, so the sender only resends the
+ * chunks that were actually lost.
+ *
+ * \section channels Channels
+ *
+ * The mbulk module uses 3 channels, those of mesh.
+ *
+ */
+
+/**
+ * \file
+ *         Header file for the multi-hop bulk transfer module
+ */
+
+#ifndef MBULK_H_
+#define MBULK_H_
+
+#include "net/rime/mesh.h"
+#include "sys/ctimer.h"
+#include "cfs/cfs.h"
+
+/* Chunks in flight, at most 16 */
+#ifdef MBULK_CONF_WINDOW
+#define MBULK_WINDOW MBULK_CONF_WINDOW
+#else
+#define MBULK_WINDOW 8
+#endif
+
+/* Payload bytes per chunk */
+#ifdef MBULK_CONF_DATASIZE
+#define MBULK_DATASIZE MBULK_CONF_DATASIZE
+#else
+#define MBULK_DATASIZE 64
+#endif
+
+struct mbulk_conn;
+
+struct mbulk_callbacks {
+  /** Called on the receiver for every new chunk, in any order. */
+  void (* write_chunk)(struct mbulk_conn *c, const rimeaddr_t *from,
+                       cfs_offset_t offset, const uint8_t *data, int len);
+  /** Called on both sides when the whole file has arrived. */
+  void (* done)(struct mbulk_conn *c, const rimeaddr_t *peer);
+  /** Called on the sender when the receiver stopped acknowledging. */
+  void (* timedout)(struct mbulk_conn *c);
+};
+
+struct mbulk_conn {
+  struct mesh_conn mesh;
+  const struct mbulk_callbacks *cb;
+
+  /* Sender */
+  struct ctimer send_timer, rtx_timer;
+  rimeaddr_t receiver;
+  int fd;
+  uint16_t base, next, last;
+  /* Relative to base: chunks to send again, chunks already resent and
+     chunks the receiver has */
+  uint16_t missing, resent, acked;
+  uint8_t id, retries, sending;
+
+  /* Receiver */
+  struct ctimer ack_timer;
+  rimeaddr_t sender;
+  /* Chunks after expected that arrived, bit 0 is expected + 1 */
+  uint16_t expected, received, rx_last;
+  clock_time_t rx_time;
+  uint8_t rx_id, unacked, receiving;
+};
+
+/**
+ * \brief      Open a bulk transfer connection
+ * \param c    A pointer to a struct mbulk_conn
+ * \param channels The first of the 3 channels of the connection
+ * \param callbacks Pointer to callback structure
+ */
+void mbulk_open(struct mbulk_conn *c, uint16_t channels,
+                const struct mbulk_callbacks *callbacks);
+
+/**
+ * \brief      Close a bulk transfer connection
+ * \param c    A pointer to a struct mbulk_conn
+ */
+void mbulk_close(struct mbulk_conn *c);
+
+/**
+ * \brief      Send a file
+ * \param c    A pointer to an open struct mbulk_conn
+ * \param receiver The final destination of the file
+ * \param fd   A file opened with CFS_READ, read from offset 0 to its end
+ * \retval 0   If a transfer is already running on c
+ * \retval 1   If the transfer was started
+ *
+ *             The file must stay open until the done or the timedout
+ *             callback is called.
+ */
+int mbulk_send(struct mbulk_conn *c, const rimeaddr_t *receiver, int fd);
+
+/**
+ * \brief      Stop the transfer that is sent on a connection
+ * \param c    A pointer to a struct mbulk_conn
+ */
+void mbulk_stop(struct mbulk_conn *c);
+
+#endif /* MBULK_H_ */
+/** @} */
+/** @} */
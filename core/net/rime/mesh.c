@@ -91,6 +91,16 @@ data_packet_forward(struct multihop_conn *multihop,
   struct mesh_conn *c = (struct mesh_conn *)
     ((char *)multihop - offsetof(struct mesh_conn, multihop));
 
+  /* The route discovery left a route back to the originator on every
+     node of the path. Data from the originator refreshes it, so that
+     replies do not need a new discovery flood. */
+  if(prevhop != NULL) {
+    rt = route_lookup(originator);
+    if(rt != NULL && rimeaddr_cmp(&rt->nexthop, prevhop)) {
+      route_refresh(rt);
+    }
+  }
+
   rt = route_lookup(dest);
   if(rt == NULL) {
     if(c->queued_data != NULL) {
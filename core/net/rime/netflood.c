@@ -62,6 +62,29 @@ struct netflood_hdr {
 #define PRINTF(...)
 #endif
 
+/*---------------------------------------------------------------------------*/
+static int
+seen(struct netflood_conn *c, const rimeaddr_t *originator, uint8_t seqno)
+{
+  int i;
+
+  for(i = 0; i < NETFLOOD_SEEN; i++) {
+    if(c->seen[i].seqno == seqno &&
+       rimeaddr_cmp(&c->seen[i].originator, originator)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+remember(struct netflood_conn *c, const rimeaddr_t *originator, uint8_t seqno)
+{
+  /* The oldest flood is forgotten first */
+  rimeaddr_copy(&c->seen[c->seen_next].originator, originator);
+  c->seen[c->seen_next].seqno = seqno;
+  c->seen_next = (c->seen_next + 1) % NETFLOOD_SEEN;
+}
 /*---------------------------------------------------------------------------*/
 static int
 send(struct netflood_conn *c)
@@ -87,8 +110,10 @@ recv_from_ipolite(struct ipolite_conn *ipolite, const rimeaddr_t *from)
 
   packetbuf_hdrreduce(sizeof(struct netflood_hdr));
   if(c->u->recv != NULL) {
-    if(!(rimeaddr_cmp(&hdr.originator, &c->last_originator) &&
-	 hdr.originator_seqno <= c->last_originator_seqno)) {
+    /* Several floods may be under way at the same time, each of them
+       is passed up and rebroadcast only once. */
+    if(!seen(c, &hdr.originator, hdr.originator_seqno)) {
+      remember(c, &hdr.originator, hdr.originator_seqno);
 
       if(c->u->recv(c, from, &hdr.originator, hdr.originator_seqno,
 		    hops)) {
@@ -101,18 +126,14 @@ recv_from_ipolite(struct ipolite_conn *ipolite, const rimeaddr_t *from)
 	  
 	  /* Rebroadcast received packet. */
 	  if(hops < HOPS_MAX) {
-	    PRINTF("%d.%d: netflood rebroadcasting %d.%d/%d (%d.%d/%d) hops %d\n",
+	    PRINTF("%d.%d: netflood rebroadcasting %d.%d/%d hops %d\n",
 		   rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1],
 		   hdr.originator.u8[0], hdr.originator.u8[1],
 		   hdr.originator_seqno,
-		   c->last_originator.u8[0], c->last_originator.u8[1],
-		   c->last_originator_seqno,
 		  hops);
 	    hdr.hops++;
 	    memcpy(packetbuf_dataptr(), &hdr, sizeof(struct netflood_hdr));
 	    send(c);
-	    rimeaddr_copy(&c->last_originator, &hdr.originator);
-	    c->last_originator_seqno = hdr.originator_seqno;
 	  }
 	}
       }
@@ -150,6 +171,8 @@ netflood_open(struct netflood_conn *c, clock_time_t queue_time,
   ipolite_open(&c->c, channel, 1, &netflood);
   c->u = u;
   c->queue_time = queue_time;
+  memset(c->seen, 0, sizeof(c->seen));
+  c->seen_next = 0;
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -164,8 +187,8 @@ netflood_send(struct netflood_conn *c, uint8_t seqno)
   if(packetbuf_hdralloc(sizeof(struct netflood_hdr))) {
     struct netflood_hdr *hdr = packetbuf_hdrptr();
     rimeaddr_copy(&hdr->originator, &rimeaddr_node_addr);
-    rimeaddr_copy(&c->last_originator, &hdr->originator);
-    c->last_originator_seqno = hdr->originator_seqno = seqno;
+    hdr->originator_seqno = seqno;
+    remember(c, &rimeaddr_node_addr, seqno);
     hdr->hops = 0;
     PRINTF("%d.%d: netflood sending '%s'\n",
 	   rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1],
@@ -79,6 +79,13 @@
 
 struct netflood_conn;
 
+/* Number of recent floods that are recognized when heard again */
+#ifdef NETFLOOD_CONF_SEEN
+#define NETFLOOD_SEEN NETFLOOD_CONF_SEEN
+#else /* NETFLOOD_CONF_SEEN */
+#define NETFLOOD_SEEN 4
+#endif /* NETFLOOD_CONF_SEEN */
+
 #define NETFLOOD_ATTRIBUTES   { PACKETBUF_ADDR_ESENDER, PACKETBUF_ADDRSIZE }, \
                               { PACKETBUF_ATTR_HOPS, PACKETBUF_ATTR_BIT * 5 }, \
                               { PACKETBUF_ATTR_EPACKET_ID, PACKETBUF_ATTR_BIT * 4 }, \
@@ -91,12 +98,17 @@ struct netflood_callbacks {
   void (* dropped)(struct netflood_conn *c);
 };
 
+struct netflood_seen {
+  rimeaddr_t originator;
+  uint8_t seqno;
+};
+
 struct netflood_conn {
   struct ipolite_conn c;
   const struct netflood_callbacks *u;
   clock_time_t queue_time;
-  rimeaddr_t last_originator;
-  uint8_t last_originator_seqno;
+  struct netflood_seen seen[NETFLOOD_SEEN];
+  uint8_t seen_next;
 };
 
 void netflood_open(struct netflood_conn *c, clock_time_t queue_time,
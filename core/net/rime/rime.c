@@ -57,6 +57,7 @@
 #include "net/rime/announcement.h"
 #include "net/rime/broadcast-announcement.h"
 #include "net/mac/mac.h"
+#include "net/link-stats.h"
 
 #include "lib/list.h"
 
@@ -107,6 +108,7 @@ input(void)
   struct channel *c;
 
   RIMESTATS_ADD(rx);
+  link_stats_input_callback(packetbuf_addr(PACKETBUF_ADDR_SENDER));
   c = chameleon_parse();
   
   for(s = list_head(sniffers); s != NULL; s = list_item_next(s)) {
@@ -191,4 +193,8 @@ const struct network_driver rime_driver = {
   init,
   input
 };
+#if NETSTACK_CONF_STATIC
+NETSTACK_STATIC_EXPORT(rime_driver_init, init);
+NETSTACK_STATIC_EXPORT(rime_driver_input, input);
+#endif /* NETSTACK_CONF_STATIC */
 /** @} */
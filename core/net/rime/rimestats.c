@@ -38,8 +38,15 @@
  */
 
 #include "net/rime/rimestats.h"
+#include <string.h>
 /*---------------------------------------------------------------------------*/
 
 struct rimestats rimestats;
 
 /*---------------------------------------------------------------------------*/
+void
+rimestats_reset(void)
+{
+  memset(&rimestats, 0, sizeof(rimestats));
+}
+/*---------------------------------------------------------------------------*/
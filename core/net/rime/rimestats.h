@@ -53,17 +53,40 @@ struct rimestats {
     sendingdrop; /* Packet dropped when we were sending a packet */
 
   unsigned long lltx, llrx;
+
+  /* Bytes of the frames counted in lltx and llrx */
+  unsigned long lltxbytes, llrxbytes;
+
+  /* MAC and RDC: frames that collided or were not acked, packets given
+     up, packets with no room in the queue and received frames the RDC
+     filtered (unparsable, not for us or duplicates) */
+  unsigned long maccollision, macnoack, macdrop, macqueuedrop, rdcdrop;
+
+  /* 6LoWPAN: IP packets and fragments sent and received, reassemblies
+     that timed out or were discarded, and packets or fragments dropped
+     for any other reason */
+  unsigned long lowpantx, lowpanrx, lowpanfragtx, lowpanfragrx,
+    lowpanreassfail, lowpandrop;
 };
 
+/**
+ * \brief      Set all counters to 0
+ */
+void rimestats_reset(void);
+
 #if RIMESTATS_CONF_ENABLED
 /* Don't access this variable directly, use RIMESTATS_ADD and RIMESTATS_GET */
 extern struct rimestats rimestats;
 
 #define RIMESTATS_ADD(x) rimestats.x++
+#define RIMESTATS_ADD_VALUE(x, v) rimestats.x += (v)
 #define RIMESTATS_GET(x) rimestats.x
+#define RIMESTATS_RESET() rimestats_reset()
 #else /* RIMESTATS_CONF_ENABLED */
 #define RIMESTATS_ADD(x)
+#define RIMESTATS_ADD_VALUE(x, v)
 #define RIMESTATS_GET(x) 0
+#define RIMESTATS_RESET()
 #endif /* RIMESTATS_CONF_ENABLED */
 
 #endif /* RIMESTATS_H_ */
@@ -43,6 +43,7 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "lib/list.h"
 #include "lib/memb.h"
@@ -74,6 +75,21 @@
 LIST(route_table);
 MEMB(route_mem, struct route_entry, NUM_RT_ENTRIES);
 
+#if ROUTE_HASH
+/* Routes are chained into buckets by the hash of their destination */
+#if NUM_RT_ENTRIES <= 4
+#define HASH_SIZE 4
+#elif NUM_RT_ENTRIES <= 8
+#define HASH_SIZE 8
+#elif NUM_RT_ENTRIES <= 16
+#define HASH_SIZE 16
+#else
+#define HASH_SIZE 32
+#endif
+#define HASH_MASK (HASH_SIZE - 1)
+static struct route_entry *hash_table[HASH_SIZE];
+#endif /* ROUTE_HASH */
+
 static struct ctimer t;
 
 static int max_time = DEFAULT_LIFETIME;
@@ -87,21 +103,62 @@ static int max_time = DEFAULT_LIFETIME;
 #endif
 
 
+/*---------------------------------------------------------------------------*/
+#if ROUTE_HASH
+static uint8_t
+hash(const rimeaddr_t *addr)
+{
+  uint8_t h;
+  int i;
+
+  h = 0;
+  for(i = 0; i < sizeof(rimeaddr_t); i++) {
+    h ^= addr->u8[i];
+  }
+  return (h ^ (h >> 5)) & HASH_MASK;
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_add(struct route_entry *e)
+{
+  uint8_t b;
+
+  b = hash(&e->dest);
+  e->hash_next = hash_table[b];
+  hash_table[b] = e;
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_remove(struct route_entry *e)
+{
+  struct route_entry **p;
+
+  for(p = &hash_table[hash(&e->dest)]; *p != NULL; p = &(*p)->hash_next) {
+    if(*p == e) {
+      *p = e->hash_next;
+      return;
+    }
+  }
+}
+#else /* ROUTE_HASH */
+#define hash_add(e)
+#define hash_remove(e)
+#endif /* ROUTE_HASH */
 /*---------------------------------------------------------------------------*/
 static void
 periodic(void *ptr)
 {
-  struct route_entry *e;
+  struct route_entry *e, *next;
 
-  for(e = list_head(route_table); e != NULL; e = list_item_next(e)) {
+  for(e = list_head(route_table); e != NULL; e = next) {
+    next = list_item_next(e);
     e->time++;
     if(e->time >= max_time) {
       PRINTF("route periodic: removing entry to %d.%d with nexthop %d.%d and cost %d\n",
 	     e->dest.u8[0], e->dest.u8[1],
 	     e->nexthop.u8[0], e->nexthop.u8[1],
 	     e->cost);
-      list_remove(route_table, e);
-      memb_free(&route_mem, e);
+      route_remove(e);
     }
   }
 
@@ -113,6 +170,9 @@ route_init(void)
 {
   list_init(route_table);
   memb_init(&route_mem);
+#if ROUTE_HASH
+  memset(hash_table, 0, sizeof(hash_table));
+#endif /* ROUTE_HASH */
 
   ctimer_set(&t, CLOCK_SECOND, periodic, NULL);
 }
@@ -127,12 +187,24 @@ route_add(const rimeaddr_t *dest, const rimeaddr_t *nexthop,
   e = route_lookup(dest);
   if(e != NULL && rimeaddr_cmp(&e->nexthop, nexthop)) {
     list_remove(route_table, e);
+    hash_remove(e);
   } else {
-    /* Allocate a new entry or reuse the oldest entry with highest cost. */
+    /* Allocate a new entry or reuse the entry that was idle longest. */
     e = memb_alloc(&route_mem);
     if(e == NULL) {
-      /* Remove oldest entry.  XXX */
-      e = list_chop(route_table);
+      /* route_refresh() clears the time of routes in use, so this
+         keeps the routes of active destinations. Of equally idle
+         routes, the oldest one goes. */
+      struct route_entry *i;
+
+      e = list_head(route_table);
+      for(i = list_item_next(e); i != NULL; i = list_item_next(i)) {
+        if(i->time >= e->time) {
+          e = i;
+        }
+      }
+      list_remove(route_table, e);
+      hash_remove(e);
       PRINTF("route_add: removing entry to %d.%d with nexthop %d.%d and cost %d\n",
 	     e->dest.u8[0], e->dest.u8[1],
 	     e->nexthop.u8[0], e->nexthop.u8[1],
@@ -149,6 +221,7 @@ route_add(const rimeaddr_t *dest, const rimeaddr_t *nexthop,
 
   /* New entry goes first. */
   list_push(route_table, e);
+  hash_add(e);
 
   PRINTF("route_add: new entry to %d.%d with nexthop %d.%d and cost %d\n",
 	 e->dest.u8[0], e->dest.u8[1],
@@ -169,7 +242,11 @@ route_lookup(const rimeaddr_t *dest)
   best_entry = NULL;
   
   /* Find the route with the lowest cost. */
+#if ROUTE_HASH
+  for(e = hash_table[hash(dest)]; e != NULL; e = e->hash_next) {
+#else /* ROUTE_HASH */
   for(e = list_head(route_table); e != NULL; e = list_item_next(e)) {
+#endif /* ROUTE_HASH */
     /*    printf("route_lookup: comparing %d.%d.%d.%d with %d.%d.%d.%d\n",
 	   uip_ipaddr_to_quad(dest), uip_ipaddr_to_quad(&e->dest));*/
 
@@ -232,6 +309,7 @@ void
 route_remove(struct route_entry *e)
 {
   list_remove(route_table, e);
+  hash_remove(e);
   memb_free(&route_mem, e);
 }
 /*---------------------------------------------------------------------------*/
@@ -248,6 +326,9 @@ route_flush_all(void)
       break;
     }
   }
+#if ROUTE_HASH
+  memset(hash_table, 0, sizeof(hash_table));
+#endif /* ROUTE_HASH */
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -53,8 +53,19 @@
 
 #include "net/rime/rimeaddr.h"
 
+/* Find routes through a hash of the destination instead of walking
+   the route table */
+#ifdef ROUTE_CONF_HASH
+#define ROUTE_HASH ROUTE_CONF_HASH
+#else /* ROUTE_CONF_HASH */
+#define ROUTE_HASH 0
+#endif /* ROUTE_CONF_HASH */
+
 struct route_entry {
   struct route_entry *next;
+#if ROUTE_HASH
+  struct route_entry *hash_next;
+#endif /* ROUTE_HASH */
   rimeaddr_t dest;
   rimeaddr_t nexthop;
   uint8_t seqno;
@@ -50,7 +50,11 @@
 #include <string.h>
 
 #if TIMESYNCH_CONF_ENABLED
+#if TIMESYNCH_PIGGYBACK
+static int authority_level = TIMESYNCH_UNSYNCHED;
+#else /* TIMESYNCH_PIGGYBACK */
 static int authority_level;
+#endif /* TIMESYNCH_PIGGYBACK */
 static rtimer_clock_t offset;
 
 #define TIMESYNCH_CHANNEL  7
@@ -89,7 +93,7 @@ timesynch_set_authority_level(int level)
 
   authority_level = level;
 
-  if(old_level != authority_level) {
+  if(old_level != authority_level && !TIMESYNCH_PIGGYBACK) {
     /* Restart the timesynch process to restart with a low
        transmission interval. */
     process_exit(&timesynch_process);
@@ -127,6 +131,20 @@ adjust_offset(rtimer_clock_t authoritative_time, rtimer_clock_t local_time)
   offset = authoritative_time - local_time;
 }
 /*---------------------------------------------------------------------------*/
+void
+timesynch_incoming_packet(int level, rtimer_clock_t authoritative_time,
+                          rtimer_clock_t local_time)
+{
+  /* Also follow the current source of our time (level one less than
+     ours) so that the offset tracks the drift of the clocks. */
+  if(level < authority_level) {
+    adjust_offset(authoritative_time, local_time);
+    if(level + 1 < authority_level) {
+      timesynch_set_authority_level(level + 1);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
 static void
 broadcast_recv(struct broadcast_conn *c, const rimeaddr_t *from)
 {
@@ -192,7 +210,9 @@ PROCESS_THREAD(timesynch_process, ev, data)
 void
 timesynch_init(void)
 {
+#if !TIMESYNCH_PIGGYBACK
   process_start(&timesynch_process, NULL);
+#endif /* !TIMESYNCH_PIGGYBACK */
 }
 /*---------------------------------------------------------------------------*/
 #endif /* TIMESYNCH_CONF_ENABLED */
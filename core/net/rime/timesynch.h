@@ -23,6 +23,13 @@
  * The timesynch module is implemented as a meta-MAC protocol, so that
  * the module is invoked for every incoming packet.
  *
+ * With TIMESYNCH_CONF_PIGGYBACK the radio driver carries the time and
+ * the authority level in every frame it sends and calls
+ * timesynch_incoming_packet() for every frame it receives, as the rf230
+ * driver does with RF230_CONF_TIMESTAMPS. The module then sends no
+ * messages of its own. Nodes start at #TIMESYNCH_UNSYNCHED and the
+ * node with the time source, e.g. the sink, sets itself to level 0.
+ *
  */
 
 /*
@@ -70,6 +77,17 @@
 #include "net/mac/mac.h"
 #include "sys/rtimer.h"
 
+#ifdef TIMESYNCH_CONF_PIGGYBACK
+#define TIMESYNCH_PIGGYBACK TIMESYNCH_CONF_PIGGYBACK
+#else
+#define TIMESYNCH_PIGGYBACK 0
+#endif
+
+/**
+ * \brief      The authority level of a node that has no time source
+ */
+#define TIMESYNCH_UNSYNCHED 0xff
+
 /**
  * \brief      Initialize the timesynch module
  *
@@ -144,6 +162,19 @@ int timesynch_authority_level(void);
  */
 void timesynch_set_authority_level(int level);
 
+/**
+ * \brief      Synchronize to the time carried by a received frame
+ * \param authority_level The authority level of the sender
+ * \param authoritative_time The time of the sender when \e local_time was taken
+ * \param local_time The rtimer time at which the frame was received
+ *
+ *             This function is called by the radio driver for every
+ *             received frame when TIMESYNCH_CONF_PIGGYBACK is set.
+ */
+void timesynch_incoming_packet(int authority_level,
+                               rtimer_clock_t authoritative_time,
+                               rtimer_clock_t local_time);
+
 #endif /* TIMESYNCH_H_ */
 
 /** @} */
@@ -70,6 +70,18 @@
 #define RPL_OF rpl_mrhof
 #endif /* RPL_CONF_OF */
 
+/*
+ * Objective functions this node can join instances with. A root runs
+ * an instance with RPL_OF unless it is given another one with
+ * rpl_set_root_with_of(), e.g. { &rpl_of0, &rpl_mrhof } for a hop
+ * count instance next to an ETX one.
+ */
+#ifdef RPL_CONF_SUPPORTED_OFS
+#define RPL_SUPPORTED_OFS RPL_CONF_SUPPORTED_OFS
+#else
+#define RPL_SUPPORTED_OFS { &RPL_OF }
+#endif /* RPL_CONF_SUPPORTED_OFS */
+
 /* This value decides which DAG instance we should participate in by default. */
 #ifdef RPL_CONF_DEFAULT_INSTANCE
 #define RPL_DEFAULT_INSTANCE RPL_CONF_DEFAULT_INSTANCE
@@ -105,6 +117,27 @@
 #define RPL_MAX_DAG_PER_INSTANCE     2
 #endif /* RPL_CONF_MAX_DAG_PER_INSTANCE */
 
+/*
+ * The DAGs of all instances come from one pool, each instance may hold
+ * up to RPL_MAX_DAG_PER_INSTANCE of them. A smaller pool budgets the
+ * memory, e.g. one DAG for an alarm instance and two for another.
+ */
+#ifdef RPL_CONF_DAG_NUM
+#define RPL_DAG_NUM                  RPL_CONF_DAG_NUM
+#else
+#define RPL_DAG_NUM                  (RPL_MAX_INSTANCES * RPL_MAX_DAG_PER_INSTANCE)
+#endif /* RPL_CONF_DAG_NUM */
+
+/*
+ * With several instances, RPL_CONF_TCLASS_INSTANCE(tc) maps the IPv6
+ * traffic class of a packet to the ID of the instance that routes it
+ * upwards, see uip_udp_conn->tclass. The default route serves packets
+ * of instances that are not joined.
+ */
+#ifdef RPL_CONF_TCLASS_INSTANCE
+#define RPL_TCLASS_INSTANCE(tc)      RPL_CONF_TCLASS_INSTANCE(tc)
+#endif /* RPL_CONF_TCLASS_INSTANCE */
+
 /*
  * 
  */
@@ -186,4 +219,89 @@
 #define RPL_DEFAULT_LIFETIME            RPL_CONF_DEFAULT_LIFETIME
 #endif
 
+/*
+ * Function returning the residual energy of this node, from 0 (empty)
+ * to 255 (full). When the energy metric is used, MRHOF adds the spent
+ * part to the path cost this node advertises, so routes avoid nodes with
+ * drained batteries. The function is called for every DIO and should
+ * return a cached value.
+ */
+#ifdef RPL_CONF_RESIDUAL_ENERGY
+#define RPL_RESIDUAL_ENERGY             RPL_CONF_RESIDUAL_ENERGY
+uint8_t RPL_RESIDUAL_ENERGY(void);
+#endif
+
+/*
+ * Number of nodes the root of a non-storing DODAG (RPL_CONF_MOP set to
+ * RPL_MOP_NON_STORING) can build source routes to.
+ */
+#ifdef RPL_CONF_NS_NODE_NUM
+#define RPL_NS_NODE_NUM                 RPL_CONF_NS_NODE_NUM
+#else
+#define RPL_NS_NODE_NUM                 32
+#endif
+
+/*
+ * Longest source route the root of a non-storing DODAG inserts, in hops.
+ */
+#ifdef RPL_CONF_NS_MAX_HOPS
+#define RPL_NS_MAX_HOPS                 RPL_CONF_NS_MAX_HOPS
+#else
+#define RPL_NS_MAX_HOPS                 16
+#endif
+
+/*
+ * DAO aggregation. A storing mode router does not pass every DAO of its
+ * children on right away, but waits RPL_DAO_FORWARD_LATENCY and sends
+ * the targets of all DAOs received in the meantime together with its
+ * own target in one DAO.
+ */
+#ifdef RPL_CONF_DAO_AGGREGATION
+#define RPL_DAO_AGGREGATION             RPL_CONF_DAO_AGGREGATION
+#else
+#define RPL_DAO_AGGREGATION             1
+#endif
+
+/*
+ * Maximum number of target options in one DAO, both when receiving
+ * and when aggregating.
+ */
+#ifdef RPL_CONF_DAO_MAX_TARGETS
+#define RPL_DAO_MAX_TARGETS             RPL_CONF_DAO_MAX_TARGETS
+#else
+#define RPL_DAO_MAX_TARGETS             4
+#endif
+
+/*
+ * Trickle hysteresis. Inconsistencies that do not require an immediate
+ * reaction (a parent switch without rank change, a DIO with an old
+ * version or infinite rank, a multicast DIS, a rank error in a data
+ * packet) only reset the DIO timer when its interval has grown more
+ * than this many doublings beyond the minimum. 0 resets on every
+ * inconsistency.
+ */
+#ifdef RPL_CONF_DIO_RESET_HYSTERESIS
+#define RPL_DIO_RESET_HYSTERESIS        RPL_CONF_DIO_RESET_HYSTERESIS
+#else
+#define RPL_DIO_RESET_HYSTERESIS        2
+#endif
+
+/*
+ * Multicast forwarding in a storing DODAG with multicast (RPL_CONF_MOP
+ * set to RPL_MOP_STORING_MULTICAST). The last RPL_MCAST_SEEN_NUM
+ * packets are remembered for RPL_MCAST_SEEN_LIFETIME clock ticks so
+ * that duplicates are neither forwarded nor delivered again.
+ */
+#ifdef RPL_CONF_MCAST_SEEN_NUM
+#define RPL_MCAST_SEEN_NUM              RPL_CONF_MCAST_SEEN_NUM
+#else
+#define RPL_MCAST_SEEN_NUM              8
+#endif
+
+#ifdef RPL_CONF_MCAST_SEEN_LIFETIME
+#define RPL_MCAST_SEEN_LIFETIME         RPL_CONF_MCAST_SEEN_LIFETIME
+#else
+#define RPL_MCAST_SEEN_LIFETIME         (60 * CLOCK_SECOND)
+#endif
+
 #endif /* RPL_CONF_H */
@@ -46,6 +46,10 @@
 #include "net/uip.h"
 #include "net/uip-nd6.h"
 #include "net/nbr-table.h"
+#include "net/link-stats.h"
+#ifdef RPL_PREFIX_CONTEXT
+#include "net/sicslowpan.h"
+#endif /* RPL_PREFIX_CONTEXT */
 #include "lib/list.h"
 #include "lib/memb.h"
 #include "sys/ctimer.h"
@@ -59,11 +63,13 @@
 #if UIP_CONF_IPV6
 /*---------------------------------------------------------------------------*/
 extern rpl_of_t RPL_OF;
-static rpl_of_t * const objective_functions[] = {&RPL_OF};
+static rpl_of_t * const objective_functions[] = RPL_SUPPORTED_OFS;
 
 /*---------------------------------------------------------------------------*/
 /* RPL definitions. */
 
+#define UIP_IP_BUF ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+
 #ifndef RPL_CONF_GROUNDED
 #define RPL_GROUNDED                    0
 #else
@@ -71,12 +77,25 @@ static rpl_of_t * const objective_functions[] = {&RPL_OF};
 #endif /* !RPL_CONF_GROUNDED */
 
 /*---------------------------------------------------------------------------*/
-/* Per-parent RPL information */
-NBR_TABLE(rpl_parent_t, rpl_parents);
+/* Per-parent RPL information, in one neighbor table per instance so
+   that a neighbor can be a parent in several instances. */
+static rpl_parent_t parent_mem[RPL_MAX_INSTANCES][NBR_TABLE_MAX_NEIGHBORS];
+static nbr_table_t parent_tables[RPL_MAX_INSTANCES];
 /*---------------------------------------------------------------------------*/
 /* Allocate instance table. */
 rpl_instance_t instance_table[RPL_MAX_INSTANCES];
 rpl_instance_t *default_instance;
+/* DAGs of all instances */
+static rpl_dag_t dag_table[RPL_DAG_NUM];
+/*---------------------------------------------------------------------------*/
+#define INSTANCE_PARENTS(instance) (&parent_tables[(instance) - instance_table])
+
+static nbr_table_t *
+parent_table(const rpl_parent_t *p)
+{
+  return &parent_tables[((const char *)p - (const char *)parent_mem) /
+                        sizeof(parent_mem[0])];
+}
 /*---------------------------------------------------------------------------*/
 static void
 nbr_callback(void *ptr)
@@ -87,13 +106,29 @@ nbr_callback(void *ptr)
 void
 rpl_dag_init(void)
 {
-  nbr_table_register(rpl_parents, (nbr_table_callback *)nbr_callback);
+  int i;
+
+  for(i = 0; i < RPL_MAX_INSTANCES; i++) {
+    parent_tables[i].item_size = sizeof(rpl_parent_t);
+    parent_tables[i].data = parent_mem[i];
+    nbr_table_register(&parent_tables[i], (nbr_table_callback *)nbr_callback);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static rpl_parent_t *
+default_instance_parent(const uip_lladdr_t *addr)
+{
+  if(default_instance == NULL) {
+    return NULL;
+  }
+  return nbr_table_get_from_lladdr(INSTANCE_PARENTS(default_instance),
+                                   (const rimeaddr_t *)addr);
 }
 /*---------------------------------------------------------------------------*/
 rpl_rank_t
 rpl_get_parent_rank(uip_lladdr_t *addr)
 {
-  rpl_parent_t *p = nbr_table_get_from_lladdr(rpl_parents, (rimeaddr_t *)addr);
+  rpl_parent_t *p = default_instance_parent(addr);
   if(p != NULL) {
     return p->rank;
   } else {
@@ -104,7 +139,7 @@ rpl_get_parent_rank(uip_lladdr_t *addr)
 uint16_t
 rpl_get_parent_link_metric(const uip_lladdr_t *addr)
 {
-  rpl_parent_t *p = nbr_table_get_from_lladdr(rpl_parents, (const rimeaddr_t *)addr);
+  rpl_parent_t *p = default_instance_parent(addr);
   if(p != NULL) {
     return p->link_metric;
   } else {
@@ -115,10 +150,16 @@ rpl_get_parent_link_metric(const uip_lladdr_t *addr)
 uip_ipaddr_t *
 rpl_get_parent_ipaddr(rpl_parent_t *p)
 {
-  rimeaddr_t *lladdr = nbr_table_get_lladdr(rpl_parents, p);
+  rimeaddr_t *lladdr = rpl_get_parent_lladdr(p);
   return uip_ds6_nbr_ipaddr_from_lladdr((uip_lladdr_t *)lladdr);
 }
 /*---------------------------------------------------------------------------*/
+rimeaddr_t *
+rpl_get_parent_lladdr(rpl_parent_t *p)
+{
+  return p != NULL ? nbr_table_get_lladdr(parent_table(p), p) : NULL;
+}
+/*---------------------------------------------------------------------------*/
 static void
 rpl_set_preferred_parent(rpl_dag_t *dag, rpl_parent_t *p)
 {
@@ -139,8 +180,8 @@ rpl_set_preferred_parent(rpl_dag_t *dag, rpl_parent_t *p)
 
     /* Always keep the preferred parent locked, so it remains in the
      * neighbor table. */
-    nbr_table_unlock(rpl_parents, dag->preferred_parent);
-    nbr_table_lock(rpl_parents, p);
+    nbr_table_unlock(INSTANCE_PARENTS(dag->instance), dag->preferred_parent);
+    nbr_table_lock(INSTANCE_PARENTS(dag->instance), p);
     dag->preferred_parent = p;
   }
 }
@@ -170,12 +211,12 @@ remove_parents(rpl_dag_t *dag, rpl_rank_t minimum_rank)
   PRINTF("RPL: Removing parents (minimum rank %u)\n",
 	minimum_rank);
 
-  p = nbr_table_head(rpl_parents);
+  p = nbr_table_head(INSTANCE_PARENTS(dag->instance));
   while(p != NULL) {
     if(dag == p->dag && p->rank >= minimum_rank) {
       rpl_remove_parent(p);
     }
-    p = nbr_table_next(rpl_parents, p);
+    p = nbr_table_next(INSTANCE_PARENTS(dag->instance), p);
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -187,12 +228,12 @@ nullify_parents(rpl_dag_t *dag, rpl_rank_t minimum_rank)
   PRINTF("RPL: Nullifying parents (minimum rank %u)\n",
 	minimum_rank);
 
-  p = nbr_table_head(rpl_parents);
+  p = nbr_table_head(INSTANCE_PARENTS(dag->instance));
   while(p != NULL) {
     if(dag == p->dag && p->rank >= minimum_rank) {
       rpl_nullify_parent(p);
     }
-    p = nbr_table_next(rpl_parents, p);
+    p = nbr_table_next(INSTANCE_PARENTS(dag->instance), p);
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -220,17 +261,16 @@ static rpl_dag_t *
 get_dag(uint8_t instance_id, uip_ipaddr_t *dag_id)
 {
   rpl_instance_t *instance;
-  rpl_dag_t *dag;
-  int i;
+  rpl_dag_t *dag, *end;
 
   instance = rpl_get_instance(instance_id);
   if(instance == NULL) {
     return NULL;
   }
 
-  for(i = 0; i < RPL_MAX_DAG_PER_INSTANCE; ++i) {
-    dag = &instance->dag_table[i];
-    if(dag->used && uip_ipaddr_cmp(&dag->dag_id, dag_id)) {
+  for(dag = &dag_table[0], end = dag + RPL_DAG_NUM; dag < end; ++dag) {
+    if(dag->used && dag->instance == instance &&
+       uip_ipaddr_cmp(&dag->dag_id, dag_id)) {
       return dag;
     }
   }
@@ -240,6 +280,12 @@ get_dag(uint8_t instance_id, uip_ipaddr_t *dag_id)
 /*---------------------------------------------------------------------------*/
 rpl_dag_t *
 rpl_set_root(uint8_t instance_id, uip_ipaddr_t *dag_id)
+{
+  return rpl_set_root_with_of(instance_id, dag_id, &RPL_OF);
+}
+/*---------------------------------------------------------------------------*/
+rpl_dag_t *
+rpl_set_root_with_of(uint8_t instance_id, uip_ipaddr_t *dag_id, rpl_of_t *of)
 {
   rpl_dag_t *dag;
   rpl_instance_t *instance;
@@ -269,7 +315,7 @@ rpl_set_root(uint8_t instance_id, uip_ipaddr_t *dag_id)
   dag->joined = 1;
   dag->grounded = RPL_GROUNDED;
   instance->mop = RPL_MOP_DEFAULT;
-  instance->of = &RPL_OF;
+  instance->of = of;
   rpl_set_preferred_parent(dag, NULL);
 
   memcpy(&dag->dag_id, dag_id, sizeof(dag->dag_id));
@@ -353,6 +399,9 @@ check_prefix(rpl_prefix_t *last_prefix, rpl_prefix_t *new_prefix)
   }
 
   if(last_prefix != NULL) {
+#ifdef RPL_PREFIX_CONTEXT
+    sicslowpan_remove_context(RPL_PREFIX_CONTEXT);
+#endif /* RPL_PREFIX_CONTEXT */
     set_ip_from_prefix(&ipaddr, last_prefix);
     rep = uip_ds6_addr_lookup(&ipaddr);
     if(rep != NULL) {
@@ -365,6 +414,12 @@ check_prefix(rpl_prefix_t *last_prefix, rpl_prefix_t *new_prefix)
   
   if(new_prefix != NULL) {
     set_ip_from_prefix(&ipaddr, new_prefix);
+#ifdef RPL_PREFIX_CONTEXT
+    /* The context covers the first 64 bits of the address */
+    if(new_prefix->length <= 64) {
+      sicslowpan_set_context(RPL_PREFIX_CONTEXT, &ipaddr);
+    }
+#endif /* RPL_PREFIX_CONTEXT */
     if(uip_ds6_addr_lookup(&ipaddr) == NULL) {
       PRINTF("RPL: adding global IP address ");
       PRINT6ADDR(&ipaddr);
@@ -403,6 +458,24 @@ rpl_set_prefix(rpl_dag_t *dag, uip_ipaddr_t *prefix, unsigned len)
   return 1;
 }
 /*---------------------------------------------------------------------------*/
+/* Instances with the same preferred parent share its default route */
+static void
+remove_default_route(rpl_instance_t *instance)
+{
+  rpl_instance_t *other, *end;
+
+  for(other = &instance_table[0], end = other + RPL_MAX_INSTANCES;
+      other < end; ++other) {
+    if(other != instance && other->used &&
+       other->def_route == instance->def_route) {
+      instance->def_route = NULL;
+      return;
+    }
+  }
+  uip_ds6_defrt_rm(instance->def_route);
+  instance->def_route = NULL;
+}
+/*---------------------------------------------------------------------------*/
 int
 rpl_set_default_route(rpl_instance_t *instance, uip_ipaddr_t *from)
 {
@@ -410,8 +483,7 @@ rpl_set_default_route(rpl_instance_t *instance, uip_ipaddr_t *from)
     PRINTF("RPL: Removing default route through ");
     PRINT6ADDR(&instance->def_route->ipaddr);
     PRINTF("\n");
-    uip_ds6_defrt_rm(instance->def_route);
-    instance->def_route = NULL;
+    remove_default_route(instance);
   }
 
   if(from != NULL) {
@@ -456,8 +528,9 @@ rpl_alloc_instance(uint8_t instance_id)
 rpl_dag_t *
 rpl_alloc_dag(uint8_t instance_id, uip_ipaddr_t *dag_id)
 {
-  rpl_dag_t *dag, *end;
+  rpl_dag_t *dag, *end, *free_dag;
   rpl_instance_t *instance;
+  int count;
 
   instance = rpl_get_instance(instance_id);
   if(instance == NULL) {
@@ -468,19 +541,32 @@ rpl_alloc_dag(uint8_t instance_id, uip_ipaddr_t *dag_id)
     }
   }
 
-  for(dag = &instance->dag_table[0], end = dag + RPL_MAX_DAG_PER_INSTANCE; dag < end; ++dag) {
+  free_dag = NULL;
+  count = 0;
+  for(dag = &dag_table[0], end = dag + RPL_DAG_NUM; dag < end; ++dag) {
     if(!dag->used) {
-      memset(dag, 0, sizeof(*dag));
-      dag->used = 1;
-      dag->rank = INFINITE_RANK;
-      dag->min_rank = INFINITE_RANK;
-      dag->instance = instance;
-      return dag;
+      if(free_dag == NULL) {
+        free_dag = dag;
+      }
+    } else if(dag->instance == instance) {
+      count++;
     }
   }
 
+  if(free_dag != NULL && count < RPL_MAX_DAG_PER_INSTANCE) {
+    dag = free_dag;
+    memset(dag, 0, sizeof(*dag));
+    dag->used = 1;
+    dag->rank = INFINITE_RANK;
+    dag->min_rank = INFINITE_RANK;
+    dag->instance = instance;
+    return dag;
+  }
+
   RPL_STAT(rpl_stats.mem_overflows++);
-  rpl_free_instance(instance);
+  if(count == 0) {
+    rpl_free_instance(instance);
+  }
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
@@ -499,8 +585,8 @@ rpl_free_instance(rpl_instance_t *instance)
   PRINTF("RPL: Leaving the instance %u\n", instance->instance_id);
 
   /* Remove any DAG inside this instance */
-  for(dag = &instance->dag_table[0], end = dag + RPL_MAX_DAG_PER_INSTANCE; dag < end; ++dag) {
-    if(dag->used) {
+  for(dag = &dag_table[0], end = dag + RPL_DAG_NUM; dag < end; ++dag) {
+    if(dag->used && dag->instance == instance) {
       rpl_free_dag(dag);
     }
   }
@@ -551,15 +637,24 @@ rpl_add_parent(rpl_dag_t *dag, rpl_dio_t *dio, uip_ipaddr_t *addr)
   PRINT6ADDR(addr);
   PRINTF("\n");
   if(lladdr != NULL) {
-    /* Add parent in rpl_parents */
-    p = nbr_table_add_lladdr(rpl_parents, (rimeaddr_t *)lladdr);
+    /* Add parent in the parent table of the instance */
+    p = nbr_table_add_lladdr(INSTANCE_PARENTS(dag->instance), (rimeaddr_t *)lladdr);
     if(p == NULL) {
       PRINTF("RPL: rpl_add_parent p NULL\n");
     } else {
+      const struct link_stats *stats;
+
       p->dag = dag;
       p->rank = dio->rank;
       p->dtsn = dio->dtsn;
-      p->link_metric = RPL_INIT_LINK_METRIC * RPL_DAG_MC_ETX_DIVISOR;
+      /* Start from what the link statistics know of the neighbor, at
+         least the RSSI of this DIO if enabled. */
+      stats = link_stats_from_lladdr((rimeaddr_t *)lladdr);
+      if(stats != NULL && stats->etx != 0) {
+        p->link_metric = stats->etx;
+      } else {
+        p->link_metric = RPL_INIT_LINK_METRIC * RPL_DAG_MC_ETX_DIVISOR;
+      }
 #if RPL_DAG_MC != RPL_DAG_MC_NONE
       memcpy(&p->mc, &dio->mc, sizeof(p->mc));
 #endif /* RPL_DAG_MC != RPL_DAG_MC_NONE */
@@ -570,17 +665,17 @@ rpl_add_parent(rpl_dag_t *dag, rpl_dio_t *dio, uip_ipaddr_t *addr)
 }
 /*---------------------------------------------------------------------------*/
 static rpl_parent_t *
-find_parent_any_dag_any_instance(uip_ipaddr_t *addr)
+find_parent_any_dag(rpl_instance_t *instance, uip_ipaddr_t *addr)
 {
   uip_ds6_nbr_t *ds6_nbr = uip_ds6_nbr_lookup(addr);
   const uip_lladdr_t *lladdr = uip_ds6_nbr_get_ll(ds6_nbr);
-  return nbr_table_get_from_lladdr(rpl_parents, (rimeaddr_t *)lladdr);
+  return nbr_table_get_from_lladdr(INSTANCE_PARENTS(instance), (rimeaddr_t *)lladdr);
 }
 /*---------------------------------------------------------------------------*/
 rpl_parent_t *
 rpl_find_parent(rpl_dag_t *dag, uip_ipaddr_t *addr)
 {
-  rpl_parent_t *p = find_parent_any_dag_any_instance(addr);
+  rpl_parent_t *p = find_parent_any_dag(dag->instance, addr);
   if(p != NULL && p->dag == dag) {
     return p;
   } else {
@@ -591,7 +686,7 @@ rpl_find_parent(rpl_dag_t *dag, uip_ipaddr_t *addr)
 static rpl_dag_t *
 find_parent_dag(rpl_instance_t *instance, uip_ipaddr_t *addr)
 {
-  rpl_parent_t *p = find_parent_any_dag_any_instance(addr);
+  rpl_parent_t *p = find_parent_any_dag(instance, addr);
   if(p != NULL) {
     return p->dag;
   } else {
@@ -602,12 +697,7 @@ find_parent_dag(rpl_instance_t *instance, uip_ipaddr_t *addr)
 rpl_parent_t *
 rpl_find_parent_any_dag(rpl_instance_t *instance, uip_ipaddr_t *addr)
 {
-  rpl_parent_t *p = find_parent_any_dag_any_instance(addr);
-  if(p && p->dag && p->dag->instance == instance) {
-    return p;
-  } else {
-    return NULL;
-  }
+  return find_parent_any_dag(instance, addr);
 }
 /*---------------------------------------------------------------------------*/
 rpl_dag_t *
@@ -628,8 +718,8 @@ rpl_select_dag(rpl_instance_t *instance, rpl_parent_t *p)
       }
     } else if(p->dag == best_dag) {
       best_dag = NULL;
-      for(dag = &instance->dag_table[0], end = dag + RPL_MAX_DAG_PER_INSTANCE; dag < end; ++dag) {
-        if(dag->used && dag->preferred_parent != NULL && dag->preferred_parent->rank != INFINITE_RANK) {
+      for(dag = &dag_table[0], end = dag + RPL_DAG_NUM; dag < end; ++dag) {
+        if(dag->used && dag->instance == instance && dag->preferred_parent != NULL && dag->preferred_parent->rank != INFINITE_RANK) {
           if(best_dag == NULL) {
             best_dag = dag;
           } else {
@@ -693,7 +783,12 @@ rpl_select_dag(rpl_instance_t *instance, rpl_parent_t *p)
       RPL_LOLLIPOP_INCREMENT(instance->dtsn_out);
       rpl_schedule_dao(instance);
     }
-    rpl_reset_dio_timer(instance);
+    /* Children only need to hear about it quickly if our rank changed. */
+    if(DAG_RANK(best_dag->rank, instance) != DAG_RANK(old_rank, instance)) {
+      rpl_reset_dio_timer(instance);
+    } else {
+      rpl_dio_inconsistency(instance);
+    }
   } else if(best_dag->rank != old_rank) {
     PRINTF("RPL: Preferred parent update, rank changed from %u to %u\n",
   	(unsigned)old_rank, best_dag->rank);
@@ -708,7 +803,7 @@ best_parent(rpl_dag_t *dag)
 
   best = NULL;
 
-  p = nbr_table_head(rpl_parents);
+  p = nbr_table_head(INSTANCE_PARENTS(dag->instance));
   while(p != NULL) {
     if(p->rank == INFINITE_RANK) {
       /* ignore this neighbor */
@@ -717,7 +812,7 @@ best_parent(rpl_dag_t *dag)
     } else {
       best = dag->instance->of->best_parent(best, p);
     }
-    p = nbr_table_next(rpl_parents, p);
+    p = nbr_table_next(INSTANCE_PARENTS(dag->instance), p);
   }
 
   return best;
@@ -744,7 +839,7 @@ rpl_remove_parent(rpl_parent_t *parent)
 
   rpl_nullify_parent(parent);
 
-  nbr_table_remove(rpl_parents, parent);
+  nbr_table_remove(parent_table(parent), parent);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -761,8 +856,7 @@ rpl_nullify_parent(rpl_parent_t *parent)
         PRINTF("RPL: Removing default route ");
         PRINT6ADDR(rpl_get_parent_ipaddr(parent));
         PRINTF("\n");
-        uip_ds6_defrt_rm(dag->instance->def_route);
-        dag->instance->def_route = NULL;
+        remove_default_route(dag->instance);
       }
       dao_output(parent, RPL_ZERO_LIFETIME);
     }
@@ -784,8 +878,7 @@ rpl_move_parent(rpl_dag_t *dag_src, rpl_dag_t *dag_dst, rpl_parent_t *parent)
       PRINT6ADDR(rpl_get_parent_ipaddr(parent));
       PRINTF("\n");
       PRINTF("rpl_move_parent\n");
-      uip_ds6_defrt_rm(dag_src->instance->def_route);
-      dag_src->instance->def_route = NULL;
+      remove_default_route(dag_src->instance);
     }
   } else if(dag_src->joined) {
     /* Remove uIPv6 routes that have this parent as the next hop. */
@@ -825,6 +918,26 @@ rpl_get_instance(uint8_t instance_id)
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
+uip_ipaddr_t *
+rpl_get_tclass_nexthop(void)
+{
+#ifdef RPL_TCLASS_INSTANCE
+  rpl_instance_t *instance;
+  rpl_dag_t *dag;
+  uint8_t tclass;
+
+  tclass = (UIP_IP_BUF->vtc << 4) | (UIP_IP_BUF->tcflow >> 4);
+  instance = rpl_get_instance(RPL_TCLASS_INSTANCE(tclass));
+  if(instance != NULL) {
+    dag = instance->current_dag;
+    if(dag != NULL && dag->joined && dag->preferred_parent != NULL) {
+      return rpl_get_parent_ipaddr(dag->preferred_parent);
+    }
+  }
+#endif /* RPL_TCLASS_INSTANCE */
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
 rpl_of_t *
 rpl_find_of(rpl_ocp_t ocp)
 {
@@ -1049,17 +1162,17 @@ global_repair(uip_ipaddr_t *from, rpl_dag_t *dag, rpl_dio_t *dio)
 void
 rpl_local_repair(rpl_instance_t *instance)
 {
-  int i;
+  rpl_dag_t *dag, *end;
 
   if(instance == NULL) {
     PRINTF("RPL: local repair requested for instance NULL\n");
     return;
   }
   PRINTF("RPL: Starting a local instance repair\n");
-  for(i = 0; i < RPL_MAX_DAG_PER_INSTANCE; i++) {
-    if(instance->dag_table[i].used) {
-      instance->dag_table[i].rank = INFINITE_RANK;
-      nullify_parents(&instance->dag_table[i], 0);
+  for(dag = &dag_table[0], end = dag + RPL_DAG_NUM; dag < end; ++dag) {
+    if(dag->used && dag->instance == instance) {
+      dag->rank = INFINITE_RANK;
+      nullify_parents(dag, 0);
     }
   }
 
@@ -1072,22 +1185,25 @@ void
 rpl_recalculate_ranks(void)
 {
   rpl_parent_t *p;
+  int i;
 
   /*
    * We recalculate ranks when we receive feedback from the system rather
    * than RPL protocol messages. This periodical recalculation is called
    * from a timer in order to keep the stack depth reasonably low.
    */
-  p = nbr_table_head(rpl_parents);
-  while(p != NULL) {
-    if(p->dag != NULL && p->dag->instance && p->updated) {
-      p->updated = 0;
-      PRINTF("RPL: rpl_process_parent_event recalculate_ranks\n");
-      if(!rpl_process_parent_event(p->dag->instance, p)) {
-        PRINTF("RPL: A parent was dropped\n");
+  for(i = 0; i < RPL_MAX_INSTANCES; i++) {
+    p = nbr_table_head(&parent_tables[i]);
+    while(p != NULL) {
+      if(p->dag != NULL && p->dag->instance && p->updated) {
+        p->updated = 0;
+        PRINTF("RPL: rpl_process_parent_event recalculate_ranks\n");
+        if(!rpl_process_parent_event(p->dag->instance, p)) {
+          PRINTF("RPL: A parent was dropped\n");
+        }
       }
+      p = nbr_table_next(&parent_tables[i], p);
     }
-    p = nbr_table_next(rpl_parents, p);
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -1179,7 +1295,7 @@ rpl_process_dio(uip_ipaddr_t *from, rpl_dio_t *dio)
       /* The DIO sender is on an older version of the DAG. */
       PRINTF("RPL: old version received => inconsistency detected\n");
       if(dag->joined) {
-        rpl_reset_dio_timer(instance);
+        rpl_dio_inconsistency(instance);
         return;
       }
     }
@@ -1208,7 +1324,7 @@ rpl_process_dio(uip_ipaddr_t *from, rpl_dio_t *dio)
            (unsigned)dio->rank);
     return;
   } else if(dio->rank == INFINITE_RANK && dag->joined) {
-    rpl_reset_dio_timer(instance);
+    rpl_dio_inconsistency(instance);
   }
 
   /* Prefix Information Option treated to add new prefix */
@@ -1298,7 +1414,7 @@ rpl_process_dio(uip_ipaddr_t *from, rpl_dio_t *dio)
 void
 rpl_lock_parent(rpl_parent_t *p)
 {
-  nbr_table_lock(rpl_parents, p);
+  nbr_table_lock(parent_table(p), p);
 }
 /*---------------------------------------------------------------------------*/
 #endif /* UIP_CONF_IPV6 */
@@ -61,8 +61,75 @@
 #define UIP_EXT_HDR_OPT_BUF       ((struct uip_ext_hdr_opt *)&uip_buf[uip_l2_l3_hdr_len + uip_ext_opt_offset])
 #define UIP_EXT_HDR_OPT_PADN_BUF  ((struct uip_ext_hdr_opt_padn *)&uip_buf[uip_l2_l3_hdr_len + uip_ext_opt_offset])
 #define UIP_EXT_HDR_OPT_RPL_BUF   ((struct uip_ext_hdr_opt_rpl *)&uip_buf[uip_l2_l3_hdr_len + uip_ext_opt_offset])
+#define UIP_RH_BUF(offset)        ((struct uip_routing_hdr *)&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN + (offset)])
+#define UIP_HBHO_HDR_BUF          ((struct uip_hbho_hdr *)&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN])
+
+/* Source Routing Header: the fixed part is followed by the addresses,
+   of which the first CmprI (CmprE for the last) bytes are elided. */
+#define RPL_SRH_FIXED_LEN               8
+#define RPL_SRH_ADDR_CMPR(rh)           (((uint8_t *)(rh))[4] >> 4)
+#define RPL_SRH_LAST_ADDR_CMPR(rh)      (((uint8_t *)(rh))[4] & 0x0f)
+#define RPL_SRH_PAD(rh)                 (((uint8_t *)(rh))[5] >> 4)
 /*---------------------------------------------------------------------------*/
 #if UIP_CONF_IPV6
+#if RPL_WITH_NON_STORING
+/* Offset of the source routing header after the IPv6 header, or -1 if
+   the packet has none. Only a hop-by-hop header may precede it. */
+static int
+srh_offset(void)
+{
+  int offset;
+  uint8_t next;
+
+  offset = 0;
+  next = UIP_IP_BUF->proto;
+  if(next == UIP_PROTO_HBHO) {
+    offset = (UIP_HBHO_HDR_BUF->len << 3) + 8;
+    next = UIP_HBHO_HDR_BUF->next;
+  }
+  if(next == UIP_PROTO_ROUTING &&
+     UIP_RH_BUF(offset)->routing_type == RPL_RH_TYPE_SRH) {
+    return offset;
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the DAG if we are the root of a non-storing DODAG. */
+static rpl_dag_t *
+get_root_dag(void)
+{
+  rpl_dag_t *dag;
+
+  if(default_instance == NULL || !default_instance->used) {
+    return NULL;
+  }
+  dag = default_instance->current_dag;
+  if(dag == NULL || !dag->joined ||
+     dag->rank != ROOT_RANK(default_instance)) {
+    return NULL;
+  }
+  return dag;
+}
+#endif /* RPL_WITH_NON_STORING */
+/*---------------------------------------------------------------------------*/
+/* Tells if the packet follows a route down the DODAG. */
+static int
+has_route_down(void)
+{
+#if RPL_WITH_NON_STORING
+  rpl_dag_t *dag;
+
+  if(srh_offset() >= 0) {
+    return 1;
+  }
+  dag = get_root_dag();
+  return dag != NULL &&
+    rpl_ns_get_path(dag, &UIP_IP_BUF->destipaddr, NULL, RPL_NS_MAX_HOPS) > 0;
+#else /* RPL_WITH_NON_STORING */
+  return uip_ds6_route_lookup(&UIP_IP_BUF->destipaddr) != NULL;
+#endif /* RPL_WITH_NON_STORING */
+}
+/*---------------------------------------------------------------------------*/
 int
 rpl_verify_header(int uip_ext_opt_offset)
 {
@@ -132,7 +199,7 @@ rpl_verify_header(int uip_ext_opt_offset)
     if(UIP_EXT_HDR_OPT_RPL_BUF->flags & RPL_HDR_OPT_RANK_ERR) {
       PRINTF("RPL: Rank error signalled in RPL option!\n");
       /* We should try to repair it, not implemented for the moment */
-      rpl_reset_dio_timer(instance);
+      rpl_dio_inconsistency(instance);
       /* Forward the packet anyway. */
       return 0;
     }
@@ -146,6 +213,59 @@ rpl_verify_header(int uip_ext_opt_offset)
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+/* Verifies and updates the RPL option of a packet that is forwarded
+   without being decompressed into uip_buf. Anything that would need
+   repair or signalling returns 1, so the packet takes the full path
+   through rpl_verify_header() and rpl_update_header_empty(). The option
+   is only modified when 0 is returned. */
+int
+rpl_fast_forward_option(uip_ext_hdr_opt_rpl *opt, uip_ipaddr_t *dest)
+{
+  rpl_instance_t *instance;
+  int down;
+  int route_down;
+  uint8_t sender_closer;
+
+  if(opt->opt_type != UIP_EXT_HDR_OPT_RPL ||
+     opt->opt_len != RPL_HDR_OPT_LEN ||
+     (opt->flags & (RPL_HDR_OPT_FWD_ERR | RPL_HDR_OPT_RANK_ERR))) {
+    return 1;
+  }
+
+  instance = rpl_get_instance(opt->instance);
+  if(instance == NULL || !instance->used ||
+     instance->current_dag == NULL || !instance->current_dag->joined) {
+    return 1;
+  }
+
+  down = (opt->flags & RPL_HDR_OPT_DOWN) != 0;
+  sender_closer = opt->senderrank < instance->current_dag->rank;
+  if(down != sender_closer) {
+    return 1;
+  }
+
+#if RPL_WITH_NON_STORING
+  /* The root has to insert a source routing header */
+  if(get_root_dag() != NULL) {
+    return 1;
+  }
+  route_down = 0;
+#else /* RPL_WITH_NON_STORING */
+  route_down = uip_ds6_route_lookup(dest) != NULL;
+#endif /* RPL_WITH_NON_STORING */
+  if(down && !route_down) {
+    return 1;
+  }
+
+  opt->senderrank = instance->current_dag->rank;
+  if(route_down) {
+    opt->flags |= RPL_HDR_OPT_DOWN;
+  } else {
+    opt->flags &= ~RPL_HDR_OPT_DOWN;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
 static void
 set_rpl_opt(unsigned uip_ext_opt_offset)
 {
@@ -217,7 +337,7 @@ rpl_update_header_empty(void)
        general not go back up again. If this happens, a
        RPL_HDR_OPT_FWD_ERR should be flagged. */
     if((UIP_EXT_HDR_OPT_RPL_BUF->flags & RPL_HDR_OPT_DOWN)) {
-      if(uip_ds6_route_lookup(&UIP_IP_BUF->destipaddr) == NULL) {
+      if(!has_route_down()) {
         UIP_EXT_HDR_OPT_RPL_BUF->flags |= RPL_HDR_OPT_FWD_ERR;
         PRINTF("RPL forwarding error\n");
       }
@@ -225,7 +345,7 @@ rpl_update_header_empty(void)
       /* Set the down extension flag correctly as described in Section
          11.2 of RFC6550. If the packet progresses along a DAO route,
          the down flag should be set. */
-      if(uip_ds6_route_lookup(&UIP_IP_BUF->destipaddr) == NULL) {
+      if(!has_route_down()) {
         /* No route was found, so this packet will go towards the RPL
            root. If so, we should not set the down flag. */
         UIP_EXT_HDR_OPT_RPL_BUF->flags &= ~RPL_HDR_OPT_DOWN;
@@ -356,4 +476,153 @@ rpl_insert_header(void)
   }
 }
 /*---------------------------------------------------------------------------*/
+int
+rpl_srh_insert(void)
+{
+#if RPL_WITH_NON_STORING
+  rpl_ns_node_t *hops[RPL_NS_MAX_HOPS];
+  rpl_dag_t *dag;
+  uint8_t *rh;
+  uint8_t *next;
+  int count;
+  int offset;
+  int len;
+  int i;
+
+  dag = get_root_dag();
+  if(dag == NULL || uip_is_addr_mcast(&UIP_IP_BUF->destipaddr) ||
+     srh_offset() >= 0) {
+    return 0;
+  }
+
+  count = rpl_ns_get_path(dag, &UIP_IP_BUF->destipaddr,
+                          hops, RPL_NS_MAX_HOPS);
+  if(count <= 1) {
+    /* Unknown destinations take the default route, our children need
+       no source route. */
+    return 0;
+  }
+
+  /* All hops share the prefix of the destination, so only their
+     interface identifiers are carried. */
+  len = RPL_SRH_FIXED_LEN + (count - 1) * 8;
+  if(uip_len + len > UIP_LINK_MTU) {
+    PRINTF("RPL: Packet too long for a source route of %d hops\n", count);
+    return 1;
+  }
+
+  offset = 0;
+  next = &UIP_IP_BUF->proto;
+  if(*next == UIP_PROTO_HBHO) {
+    offset = (UIP_HBHO_HDR_BUF->len << 3) + 8;
+    next = &UIP_HBHO_HDR_BUF->next;
+  }
+  rh = (uint8_t *)UIP_RH_BUF(offset);
+  memmove(rh + len, rh, uip_len - UIP_IPH_LEN - offset);
+
+  rh[0] = *next;
+  rh[1] = count - 1;
+  rh[2] = RPL_RH_TYPE_SRH;
+  rh[3] = count - 1;
+  rh[4] = (8 << 4) | 8;
+  rh[5] = 0;
+  rh[6] = 0;
+  rh[7] = 0;
+  for(i = 1; i < count; i++) {
+    memcpy(rh + RPL_SRH_FIXED_LEN + (i - 1) * 8, hops[i]->iid, 8);
+  }
+  *next = UIP_PROTO_ROUTING;
+
+  /* The first hop becomes the destination of the packet */
+  memcpy(&UIP_IP_BUF->destipaddr.u8[8], hops[0]->iid, 8);
+
+  uip_len += len;
+  uip_ext_len += len;
+  UIP_IP_BUF->len[0] = (uip_len - UIP_IPH_LEN) >> 8;
+  UIP_IP_BUF->len[1] = (uip_len - UIP_IPH_LEN) & 0xff;
+
+  PRINTF("RPL: Inserted a source route of %d hops to ", count);
+  PRINT6ADDR(&UIP_IP_BUF->destipaddr);
+  PRINTF("\n");
+#endif /* RPL_WITH_NON_STORING */
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+rpl_srh_process(void)
+{
+#if RPL_WITH_NON_STORING
+  struct uip_routing_hdr *rh;
+  uip_ipaddr_t next_addr;
+  uint8_t *addr;
+  int cmpr;
+  int n;
+  int i;
+
+  /* uip6.c calls us with uip_ext_len at the routing header */
+  rh = UIP_RH_BUF(uip_ext_len);
+  if(rh->routing_type != RPL_RH_TYPE_SRH || rh->seg_left == 0) {
+    return 0;
+  }
+
+  /* Number of addresses, RFC 6554 section 4.2 */
+  n = (rh->len << 3) - RPL_SRH_PAD(rh) - (16 - RPL_SRH_LAST_ADDR_CMPR(rh));
+  if(n < 0) {
+    return 0;
+  }
+  n = n / (16 - RPL_SRH_ADDR_CMPR(rh)) + 1;
+  if(rh->seg_left > n) {
+    PRINTF("RPL: Bad source routing header\n");
+    return 0;
+  }
+
+  i = n - rh->seg_left;
+  cmpr = i == n - 1 ? RPL_SRH_LAST_ADDR_CMPR(rh) : RPL_SRH_ADDR_CMPR(rh);
+  addr = (uint8_t *)rh + RPL_SRH_FIXED_LEN +
+    i * (16 - RPL_SRH_ADDR_CMPR(rh));
+
+  uip_ipaddr_copy(&next_addr, &UIP_IP_BUF->destipaddr);
+  memcpy(&next_addr.u8[cmpr], addr, 16 - cmpr);
+  if(uip_is_addr_mcast(&next_addr) || uip_ds6_is_my_addr(&next_addr)) {
+    PRINTF("RPL: Source route to a multicast address or a loop\n");
+    return 0;
+  }
+
+  /* Swap our address for the next hop */
+  memcpy(addr, &UIP_IP_BUF->destipaddr.u8[cmpr], 16 - cmpr);
+  uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, &next_addr);
+  rh->seg_left--;
+
+  PRINTF("RPL: Source routing to ");
+  PRINT6ADDR(&next_addr);
+  PRINTF("\n");
+  return 1;
+#else /* RPL_WITH_NON_STORING */
+  return 0;
+#endif /* RPL_WITH_NON_STORING */
+}
+/*---------------------------------------------------------------------------*/
+int
+rpl_srh_get_next_hop(uip_ipaddr_t *ipaddr)
+{
+#if RPL_WITH_NON_STORING
+  rpl_dag_t *dag;
+
+  /* Source routed packets and those from the root to its children go
+     to the link-local address of their destination. */
+  if(srh_offset() < 0) {
+    dag = get_root_dag();
+    if(dag == NULL ||
+       rpl_ns_get_path(dag, &UIP_IP_BUF->destipaddr, NULL, 1) != 1) {
+      return 0;
+    }
+  }
+  uip_ip6addr(ipaddr, 0xfe80, 0, 0, 0, 0, 0, 0, 0);
+  memcpy(&ipaddr->u8[8], &UIP_IP_BUF->destipaddr.u8[8], 8);
+  return 1;
+#else /* RPL_WITH_NON_STORING */
+  return 0;
+#endif /* RPL_WITH_NON_STORING */
+}
+/*---------------------------------------------------------------------------*/
 #endif /* UIP_CONF_IPV6 */
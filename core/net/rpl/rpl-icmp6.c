@@ -155,7 +155,7 @@ dis_input(void)
 #else /* !RPL_LEAF_ONLY */
       if(uip_is_addr_mcast(&UIP_IP_BUF->destipaddr)) {
         PRINTF("RPL: Multicast DIS => reset DIO timer\n");
-        rpl_reset_dio_timer(instance);
+        rpl_dio_inconsistency(instance);
       } else {
 #endif /* !RPL_LEAF_ONLY */
         PRINTF("RPL: Unicast DIS, reply to sender\n");
@@ -190,6 +190,7 @@ dis_output(uip_ipaddr_t *addr)
   PRINT6ADDR(addr);
   PRINTF("\n");
 
+  RPL_STAT(rpl_stats.dis_sent++);
   uip_icmp6_send(addr, ICMP6_RPL, RPL_CODE_DIS, 2);
 }
 /*---------------------------------------------------------------------------*/
@@ -230,6 +231,7 @@ dio_input(void)
                               0, NBR_REACHABLE)) != NULL) {
       /* set reachable timer */
       stimer_set(&nbr->reachable, UIP_ND6_REACHABLE_TIME / 1000);
+      uip_ds6_schedule_stimer(&nbr->reachable);
       PRINTF("RPL: Neighbor added to neighbor cache ");
       PRINT6ADDR(&from);
       PRINTF(", ");
@@ -526,6 +528,7 @@ dio_output(rpl_instance_t *instance, uip_ipaddr_t *uc_addr)
            dag->prefix_info.length);
   }
 
+  RPL_STAT(rpl_stats.dio_sent++);
 #if RPL_LEAF_ONLY
 #if (DEBUG) & DEBUG_PRINT
   if(uc_addr == NULL) {
@@ -554,6 +557,32 @@ dio_output(rpl_instance_t *instance, uip_ipaddr_t *uc_addr)
 #endif /* RPL_LEAF_ONLY */
 }
 /*---------------------------------------------------------------------------*/
+static uint8_t
+get_target(unsigned char *buffer, int pos, uip_ipaddr_t *prefix)
+{
+  uint8_t prefixlen;
+
+  prefixlen = buffer[pos + 3];
+  if(prefixlen > sizeof(*prefix) * CHAR_BIT) {
+    prefixlen = sizeof(*prefix) * CHAR_BIT;
+  }
+  memset(prefix, 0, sizeof(*prefix));
+  memcpy(prefix, buffer + pos + 4, (prefixlen + 7) / CHAR_BIT);
+  return prefixlen;
+}
+/*---------------------------------------------------------------------------*/
+static int
+set_target(unsigned char *buffer, int pos, uip_ipaddr_t *prefix,
+           uint8_t prefixlen)
+{
+  buffer[pos++] = RPL_OPTION_TARGET;
+  buffer[pos++] = 2 + ((prefixlen + 7) / CHAR_BIT);
+  buffer[pos++] = 0; /* reserved */
+  buffer[pos++] = prefixlen;
+  memcpy(buffer + pos, prefix, (prefixlen + 7) / CHAR_BIT);
+  return pos + (prefixlen + 7) / CHAR_BIT;
+}
+/*---------------------------------------------------------------------------*/
 static void
 dao_input(void)
 {
@@ -572,16 +601,29 @@ dao_input(void)
   uint8_t pathsequence;
   */
   uip_ipaddr_t prefix;
+  /* Offsets of the target options in the buffer */
+  uint8_t targets[RPL_DAO_MAX_TARGETS];
+  uint8_t num_targets;
+#if RPL_WITH_NON_STORING
+  uip_ipaddr_t parent_addr;
+  uint8_t has_parent_addr;
+#else /* RPL_WITH_NON_STORING */
+  uint8_t forward;
   uip_ds6_route_t *rep;
+  int learned_from;
+  rpl_parent_t *p;
+  uip_ds6_nbr_t *nbr;
+#endif /* RPL_WITH_NON_STORING */
   uint8_t buffer_length;
   int pos;
   int len;
   int i;
-  int learned_from;
-  rpl_parent_t *p;
-  uip_ds6_nbr_t *nbr;
+  int t;
 
-  prefixlen = 0;
+  num_targets = 0;
+#if RPL_WITH_NON_STORING
+  has_parent_addr = 0;
+#endif /* RPL_WITH_NON_STORING */
 
   uip_ipaddr_copy(&dao_sender_addr, &UIP_IP_BUF->srcipaddr);
 
@@ -634,42 +676,91 @@ dao_input(void)
 
     switch(subopt_type) {
     case RPL_OPTION_TARGET:
-      /* Handle the target option. */
-      prefixlen = buffer[i + 3];
-      memset(&prefix, 0, sizeof(prefix));
-      memcpy(&prefix, buffer + i + 4, (prefixlen + 7) / CHAR_BIT);
+      /* The targets are handled once the transit information is known. */
+      if(num_targets < RPL_DAO_MAX_TARGETS) {
+        targets[num_targets++] = i;
+      }
       break;
     case RPL_OPTION_TRANSIT:
       /* The path sequence and control are ignored. */
       /*      pathcontrol = buffer[i + 3];
               pathsequence = buffer[i + 4];*/
       lifetime = buffer[i + 5];
+#if RPL_WITH_NON_STORING
+      /* The root needs the parent address for the source routes. */
+      if(len >= 6 + sizeof(parent_addr) && i + len <= buffer_length) {
+        memcpy(&parent_addr, buffer + i + 6, sizeof(parent_addr));
+        has_parent_addr = 1;
+      }
+#else /* RPL_WITH_NON_STORING */
       /* The parent address is also ignored. */
+#endif /* RPL_WITH_NON_STORING */
       break;
     }
   }
 
-  PRINTF("RPL: DAO lifetime: %u, prefix length: %u prefix: ",
-          (unsigned)lifetime, (unsigned)prefixlen);
-  PRINT6ADDR(&prefix);
-  PRINTF("\n");
+  PRINTF("RPL: DAO lifetime: %u, targets: %u\n",
+          (unsigned)lifetime, (unsigned)num_targets);
+
+  if(num_targets == 0) {
+    PRINTF("RPL: Ignoring a DAO without a target\n");
+    return;
+  }
 
-  rep = uip_ds6_route_lookup(&prefix);
+#if RPL_WITH_NON_STORING
+  /* Non-storing DAOs are addressed to the root, which only records the
+     parent of the targets. */
+  if(dag->rank != ROOT_RANK(instance) || !has_parent_addr) {
+    PRINTF("RPL: Ignoring a non-storing DAO\n");
+    return;
+  }
+
+  for(t = 0; t < num_targets; t++) {
+    prefixlen = get_target(buffer, targets[t], &prefix);
+    if(prefixlen != sizeof(prefix) * CHAR_BIT) {
+      continue;
+    }
+    if(lifetime == RPL_ZERO_LIFETIME) {
+      PRINTF("RPL: No-Path DAO received\n");
+      rpl_ns_remove_parent(dag, &prefix, &parent_addr);
+    } else if(rpl_ns_update_node(dag, &prefix, &parent_addr,
+                                  RPL_LIFETIME(instance, lifetime)) == NULL) {
+      RPL_STAT(rpl_stats.mem_overflows++);
+      PRINTF("RPL: Could not add a node after receiving a DAO\n");
+      return;
+    }
+  }
+
+  if(flags & RPL_DAO_K_FLAG) {
+    dao_ack_output(instance, &dao_sender_addr, sequence);
+  }
+  return;
+#else /* RPL_WITH_NON_STORING */
 
   if(lifetime == RPL_ZERO_LIFETIME) {
     PRINTF("RPL: No-Path DAO received\n");
-    /* No-Path DAO received; invoke the route purging routine. */
-    if(rep != NULL &&
-       rep->state.nopath_received == 0 &&
-       rep->length == prefixlen &&
-       uip_ds6_route_nexthop(rep) != NULL &&
-       uip_ipaddr_cmp(uip_ds6_route_nexthop(rep), &dao_sender_addr)) {
-      PRINTF("RPL: Setting expiration timer for prefix ");
-      PRINT6ADDR(&prefix);
-      PRINTF("\n");
-      rep->state.nopath_received = 1;
-      rep->state.lifetime = DAO_EXPIRATION_TIMEOUT;
+    forward = 0;
+    for(t = 0; t < num_targets; t++) {
+      prefixlen = get_target(buffer, targets[t], &prefix);
+      rep = uip_ds6_route_lookup(&prefix);
+
+      /* No-Path DAO received; invoke the route purging routine. */
+      if(rep != NULL &&
+         rep->state.nopath_received == 0 &&
+         rep->length == prefixlen &&
+         uip_ds6_route_nexthop(rep) != NULL &&
+         uip_ipaddr_cmp(uip_ds6_route_nexthop(rep), &dao_sender_addr)) {
+        PRINTF("RPL: Setting expiration timer for prefix ");
+        PRINT6ADDR(&prefix);
+        PRINTF("\n");
+        rep->state.nopath_received = 1;
+        rep->state.dao_pending = 0;
+        rep->state.lifetime = DAO_EXPIRATION_TIMEOUT;
+        forward = 1;
+      }
+    }
 
+    if(forward) {
       /* We forward the incoming no-path DAO to our parent, if we have
          one. */
       if(dag->preferred_parent != NULL &&
@@ -677,6 +768,7 @@ dao_input(void)
         PRINTF("RPL: Forwarding no-path DAO to parent ");
         PRINT6ADDR(rpl_get_parent_ipaddr(dag->preferred_parent));
         PRINTF("\n");
+        RPL_STAT(rpl_stats.dao_sent++);
         uip_icmp6_send(rpl_get_parent_ipaddr(dag->preferred_parent),
                        ICMP6_RPL, RPL_CODE_DAO, buffer_length);
       }
@@ -723,6 +815,7 @@ dao_input(void)
                               0, NBR_REACHABLE)) != NULL) {
       /* set reachable timer */
       stimer_set(&nbr->reachable, UIP_ND6_REACHABLE_TIME / 1000);
+      uip_ds6_schedule_stimer(&nbr->reachable);
       PRINTF("RPL: Neighbor added to neighbor cache ");
       PRINT6ADDR(&dao_sender_addr);
       PRINTF(", ");
@@ -742,54 +835,71 @@ dao_input(void)
 
   rpl_lock_parent(p);
 
-  rep = rpl_add_route(dag, &prefix, prefixlen, &dao_sender_addr);
-  if(rep == NULL) {
-    RPL_STAT(rpl_stats.mem_overflows++);
-    PRINTF("RPL: Could not add a route after receiving a DAO\n");
-    return;
-  }
+  for(t = 0; t < num_targets; t++) {
+    prefixlen = get_target(buffer, targets[t], &prefix);
+    rep = rpl_add_route(dag, &prefix, prefixlen, &dao_sender_addr);
+    if(rep == NULL) {
+      RPL_STAT(rpl_stats.mem_overflows++);
+      PRINTF("RPL: Could not add a route after receiving a DAO\n");
+      return;
+    }
 
-  rep->state.lifetime = RPL_LIFETIME(instance, lifetime);
-  rep->state.learned_from = learned_from;
+    rep->state.lifetime = RPL_LIFETIME(instance, lifetime);
+    rep->state.learned_from = learned_from;
+#if RPL_WITH_DAO_AGGREGATION
+    rep->state.dao_pending = learned_from == RPL_ROUTE_FROM_UNICAST_DAO;
+#endif /* RPL_WITH_DAO_AGGREGATION */
+  }
 
   if(learned_from == RPL_ROUTE_FROM_UNICAST_DAO) {
+#if RPL_WITH_DAO_AGGREGATION
+    /* The targets go to the parent together with those of other DAOs. */
+    rpl_schedule_dao_forward(instance);
+#else /* RPL_WITH_DAO_AGGREGATION */
     if(dag->preferred_parent != NULL &&
        rpl_get_parent_ipaddr(dag->preferred_parent) != NULL) {
       PRINTF("RPL: Forwarding DAO to parent ");
       PRINT6ADDR(rpl_get_parent_ipaddr(dag->preferred_parent));
       PRINTF("\n");
+      RPL_STAT(rpl_stats.dao_sent++);
       uip_icmp6_send(rpl_get_parent_ipaddr(dag->preferred_parent),
                      ICMP6_RPL, RPL_CODE_DAO, buffer_length);
     }
+#endif /* RPL_WITH_DAO_AGGREGATION */
     if(flags & RPL_DAO_K_FLAG) {
       dao_ack_output(instance, &dao_sender_addr, sequence);
     }
   }
+#endif /* RPL_WITH_NON_STORING */
 }
 /*---------------------------------------------------------------------------*/
-void
-dao_output(rpl_parent_t *parent, uint8_t lifetime)
+#if RPL_WITH_DAO_AGGREGATION
+int
+rpl_dao_pending(rpl_dag_t *dag)
 {
-  /* Destination Advertisement Object */
-  uip_ipaddr_t prefix;
+  uip_ds6_route_t *r;
 
-  if(get_global_addr(&prefix) == 0) {
-    PRINTF("RPL: No global address set for this node - suppressing DAO\n");
-    return;
+  for(r = uip_ds6_route_head(); r != NULL; r = uip_ds6_route_next(r)) {
+    if(r->state.dao_pending && r->state.dag == dag) {
+      return 1;
+    }
   }
-
-  /* Sending a DAO with own prefix as target */
-  dao_output_target(parent, &prefix, lifetime);
+  return 0;
 }
+#endif /* RPL_WITH_DAO_AGGREGATION */
 /*---------------------------------------------------------------------------*/
-void
-dao_output_target(rpl_parent_t *parent, uip_ipaddr_t *prefix, uint8_t lifetime)
+static void
+dao_output_targets(rpl_parent_t *parent, uip_ipaddr_t *prefix,
+                   uint8_t lifetime, int aggregate)
 {
   rpl_dag_t *dag;
   rpl_instance_t *instance;
   unsigned char *buffer;
-  uint8_t prefixlen;
+  int num_targets;
   int pos;
+#if RPL_WITH_DAO_AGGREGATION
+  uip_ds6_route_t *r;
+#endif /* RPL_WITH_DAO_AGGREGATION */
 
   /* Destination Advertisement Object */
 
@@ -815,17 +925,18 @@ dao_output_target(rpl_parent_t *parent, uip_ipaddr_t *prefix, uint8_t lifetime)
     PRINTF("RPL dao_output_target error instance NULL\n");
     return;
   }
-  if(prefix == NULL) {
-    PRINTF("RPL dao_output_target error prefix NULL\n");
+#if RPL_WITH_NON_STORING
+  if(rpl_get_parent_ipaddr(parent) == NULL) {
+    PRINTF("RPL dao_output_target error parent address NULL\n");
     return;
   }
+#endif /* RPL_WITH_NON_STORING */
 #ifdef RPL_DEBUG_DAO_OUTPUT
   RPL_DEBUG_DAO_OUTPUT(parent);
 #endif
 
   buffer = UIP_ICMP_PAYLOAD;
 
-  RPL_LOLLIPOP_INCREMENT(dao_sequence);
   pos = 0;
 
   buffer[pos++] = instance->instance_id;
@@ -838,38 +949,113 @@ dao_output_target(rpl_parent_t *parent, uip_ipaddr_t *prefix, uint8_t lifetime)
 #endif /* RPL_CONF_DAO_ACK */
   ++pos;
   buffer[pos++] = 0; /* reserved */
-  buffer[pos++] = dao_sequence;
+  pos++; /* sequence, set below */
 #if RPL_DAO_SPECIFY_DAG
   memcpy(buffer + pos, &dag->dag_id, sizeof(dag->dag_id));
   pos+=sizeof(dag->dag_id);
 #endif /* RPL_DAO_SPECIFY_DAG */
 
-  /* create target subopt */
-  prefixlen = sizeof(*prefix) * CHAR_BIT;
-  buffer[pos++] = RPL_OPTION_TARGET;
-  buffer[pos++] = 2 + ((prefixlen + 7) / CHAR_BIT);
-  buffer[pos++] = 0; /* reserved */
-  buffer[pos++] = prefixlen;
-  memcpy(buffer + pos, prefix, (prefixlen + 7) / CHAR_BIT);
-  pos += ((prefixlen + 7) / CHAR_BIT);
+  /* create target subopts */
+  num_targets = 0;
+  if(prefix != NULL) {
+    pos = set_target(buffer, pos, prefix, sizeof(*prefix) * CHAR_BIT);
+    num_targets++;
+  }
+#if RPL_WITH_DAO_AGGREGATION
+  /* Add the targets of the DAOs received from children since the last
+     DAO. */
+  for(r = uip_ds6_route_head();
+      aggregate && r != NULL && num_targets < RPL_DAO_MAX_TARGETS;
+      r = uip_ds6_route_next(r)) {
+    if(!r->state.dao_pending || r->state.dag != dag) {
+      continue;
+    }
+    r->state.dao_pending = 0;
+    if(uip_ds6_route_nexthop(r) != NULL &&
+       rpl_get_parent_ipaddr(parent) != NULL &&
+       uip_ipaddr_cmp(uip_ds6_route_nexthop(r), rpl_get_parent_ipaddr(parent))) {
+      /* Advertising the route to its own next hop would create a loop. */
+      continue;
+    }
+    pos = set_target(buffer, pos, &r->ipaddr, r->length);
+    num_targets++;
+  }
+#endif /* RPL_WITH_DAO_AGGREGATION */
+  if(num_targets == 0) {
+    return;
+  }
+
+  RPL_LOLLIPOP_INCREMENT(dao_sequence);
+  buffer[3] = dao_sequence;
 
   /* Create a transit information sub-option. */
   buffer[pos++] = RPL_OPTION_TRANSIT;
+#if RPL_WITH_NON_STORING
+  buffer[pos++] = 4 + sizeof(uip_ipaddr_t);
+#else /* RPL_WITH_NON_STORING */
   buffer[pos++] = 4;
+#endif /* RPL_WITH_NON_STORING */
   buffer[pos++] = 0; /* flags - ignored */
   buffer[pos++] = 0; /* path control - ignored */
   buffer[pos++] = 0; /* path seq - ignored */
   buffer[pos++] = lifetime;
+#if RPL_WITH_NON_STORING
+  /* Global address of the parent: the prefix of the DAG ID and the
+     interface identifier of its link-local address. */
+  memcpy(buffer + pos, &dag->dag_id, 8);
+  memcpy(buffer + pos + 8, &rpl_get_parent_ipaddr(parent)->u8[8], 8);
+  pos += sizeof(uip_ipaddr_t);
+#endif /* RPL_WITH_NON_STORING */
+
+#if RPL_WITH_NON_STORING
+  PRINTF("RPL: Sending DAO with %d targets to the root ", num_targets);
+  PRINT6ADDR(&dag->dag_id);
+  PRINTF("\n");
 
-  PRINTF("RPL: Sending DAO with prefix ");
-  PRINT6ADDR(prefix);
-  PRINTF(" to ");
+  RPL_STAT(rpl_stats.dao_sent++);
+  uip_icmp6_send(&dag->dag_id, ICMP6_RPL, RPL_CODE_DAO, pos);
+#else /* RPL_WITH_NON_STORING */
+  PRINTF("RPL: Sending DAO with %d targets to ", num_targets);
   PRINT6ADDR(rpl_get_parent_ipaddr(parent));
   PRINTF("\n");
 
   if(rpl_get_parent_ipaddr(parent) != NULL) {
+    RPL_STAT(rpl_stats.dao_sent++);
     uip_icmp6_send(rpl_get_parent_ipaddr(parent), ICMP6_RPL, RPL_CODE_DAO, pos);
   }
+#endif /* RPL_WITH_NON_STORING */
+}
+/*---------------------------------------------------------------------------*/
+void
+dao_output(rpl_parent_t *parent, uint8_t lifetime)
+{
+  /* Destination Advertisement Object */
+  uip_ipaddr_t prefix;
+
+  if(get_global_addr(&prefix) == 0) {
+    PRINTF("RPL: No global address set for this node - suppressing DAO\n");
+#if RPL_WITH_DAO_AGGREGATION
+    /* The targets of the children still have to go up. */
+    if(lifetime != RPL_ZERO_LIFETIME) {
+      dao_output_targets(parent, NULL, lifetime, 1);
+    }
+#endif /* RPL_WITH_DAO_AGGREGATION */
+    return;
+  }
+
+  /* Sending a DAO with own prefix as target, and the pending targets of
+     the children unless this is a No-Path DAO. */
+  dao_output_targets(parent, &prefix, lifetime, lifetime != RPL_ZERO_LIFETIME);
+}
+/*---------------------------------------------------------------------------*/
+void
+dao_output_target(rpl_parent_t *parent, uip_ipaddr_t *prefix, uint8_t lifetime)
+{
+  if(prefix == NULL) {
+    PRINTF("RPL dao_output_target error prefix NULL\n");
+    return;
+  }
+  dao_output_targets(parent, prefix, lifetime, 0);
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -912,6 +1098,7 @@ dao_ack_output(rpl_instance_t *instance, uip_ipaddr_t *dest, uint8_t sequence)
   buffer[2] = sequence;
   buffer[3] = 0;
 
+  RPL_STAT(rpl_stats.dao_ack_sent++);
   uip_icmp6_send(dest, ICMP6_RPL, RPL_CODE_DAO_ACK, 4);
 }
 /*---------------------------------------------------------------------------*/
@@ -921,15 +1108,19 @@ uip_rpl_input(void)
   PRINTF("Received an RPL control message\n");
   switch(UIP_ICMP_BUF->icode) {
   case RPL_CODE_DIO:
+    RPL_STAT(rpl_stats.dio_recv++);
     dio_input();
     break;
   case RPL_CODE_DIS:
+    RPL_STAT(rpl_stats.dis_recv++);
     dis_input();
     break;
   case RPL_CODE_DAO:
+    RPL_STAT(rpl_stats.dao_recv++);
     dao_input();
     break;
   case RPL_CODE_DAO_ACK:
+    RPL_STAT(rpl_stats.dao_ack_recv++);
     dao_ack_input();
     break;
   default:
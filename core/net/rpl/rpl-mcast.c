@@ -0,0 +1,137 @@
+/**
+ * \addtogroup uip6
+ * @{
+ */
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+/**
+ * \file
+ *         Multicast forwarding down a storing RPL DODAG. A router passes
+ *         multicast packets of a scope wider than link-local on with a
+ *         link-layer broadcast if they come from its preferred parent,
+ *         so that one packet sent by the root reaches every node with
+ *         one transmission per router.
+ */
+
+#include "net/uip.h"
+#include "net/tcpip.h"
+#include "net/uip-ds6.h"
+#include "net/packetbuf.h"
+#include "net/rpl/rpl-private.h"
+#include "lib/crc16.h"
+
+#define DEBUG DEBUG_NONE
+#include "net/uip-debug.h"
+
+#define UIP_IP_BUF                ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+
+#if UIP_CONF_IPV6 && RPL_WITH_MULTICAST
+/*---------------------------------------------------------------------------*/
+/* Recently seen packets, identified by a CRC over the addresses and the
+   payload, which the hop limit is not part of. */
+struct seen_packet {
+  clock_time_t time;
+  uint16_t crc;
+};
+
+static struct seen_packet seen[RPL_MCAST_SEEN_NUM];
+static uint8_t seen_next;
+/*---------------------------------------------------------------------------*/
+static int
+check_seen(void)
+{
+  uint16_t crc;
+  uint8_t i;
+
+  crc = crc16_data((unsigned char *)&UIP_IP_BUF->srcipaddr,
+                   2 * sizeof(uip_ipaddr_t), 0);
+  crc = crc16_data(&uip_buf[UIP_LLIPH_LEN], uip_len - UIP_IPH_LEN, crc);
+
+  for(i = 0; i < RPL_MCAST_SEEN_NUM; i++) {
+    if(seen[i].time != 0 && seen[i].crc == crc &&
+       clock_time() - seen[i].time < RPL_MCAST_SEEN_LIFETIME) {
+      return 1;
+    }
+  }
+
+  seen[seen_next].crc = crc;
+  /* Zero marks unused entries */
+  seen[seen_next].time = clock_time() | 1;
+  seen_next = (seen_next + 1) % RPL_MCAST_SEEN_NUM;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+rpl_mcast_in(void)
+{
+  rpl_dag_t *dag;
+  rimeaddr_t *parent;
+
+  if(default_instance == NULL || !default_instance->used) {
+    return 1;
+  }
+  dag = default_instance->current_dag;
+  if(dag == NULL || !dag->joined || dag->preferred_parent == NULL) {
+    /* There is no one to take packets from, e.g. at the root */
+    return 0;
+  }
+
+  parent = rpl_get_parent_lladdr(dag->preferred_parent);
+  if(parent == NULL ||
+     !rimeaddr_cmp(parent, packetbuf_addr(PACKETBUF_ADDR_SENDER))) {
+    PRINTF("RPL: Multicast not from the preferred parent, dropping\n");
+    return 0;
+  }
+
+  if(check_seen()) {
+    PRINTF("RPL: Duplicate multicast, dropping\n");
+    return 0;
+  }
+
+  /* Routers without routes have no children to forward to */
+  if(UIP_IP_BUF->ttl > 1 && uip_ds6_route_num_routes() > 0) {
+    PRINTF("RPL: Forwarding multicast to ");
+    PRINT6ADDR(&UIP_IP_BUF->destipaddr);
+    PRINTF("\n");
+    UIP_IP_BUF->ttl--;
+    tcpip_output(NULL);
+    UIP_IP_BUF->ttl++;
+    UIP_STAT(++uip_stat.ip.forwarded);
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+#else /* UIP_CONF_IPV6 && RPL_WITH_MULTICAST */
+int
+rpl_mcast_in(void)
+{
+  return 1;
+}
+#endif /* UIP_CONF_IPV6 && RPL_WITH_MULTICAST */
+/** @} */
@@ -46,6 +46,7 @@
 
 #include "net/rpl/rpl-private.h"
 #include "net/nbr-table.h"
+#include "net/link-stats.h"
 
 #define DEBUG DEBUG_NONE
 #include "net/uip-debug.h"
@@ -67,12 +68,9 @@ rpl_of_t rpl_mrhof = {
   1
 };
 
-/* Constants for the ETX moving average */
-#define ETX_SCALE   100
-#define ETX_ALPHA   90
-
-/* Reject parents that have a higher link metric than the following. */
-#define MAX_LINK_METRIC			10
+#if LINK_STATS_ETX_DIVISOR != RPL_DAG_MC_ETX_DIVISOR
+#error "The link statistics must use the same ETX divisor as RPL"
+#endif
 
 /* Reject parents that have a higher path cost than the following. */
 #define MAX_PATH_COST			100
@@ -112,24 +110,15 @@ reset(rpl_dag_t *sag)
 static void
 neighbor_link_callback(rpl_parent_t *p, int status, int numtx)
 {
-  uint16_t recorded_etx = p->link_metric;
-  uint16_t packet_etx = numtx * RPL_DAG_MC_ETX_DIVISOR;
-  uint16_t new_etx;
-
-  /* Do not penalize the ETX when collisions or transmission errors occur. */
-  if(status == MAC_TX_OK || status == MAC_TX_NOACK) {
-    if(status == MAC_TX_NOACK) {
-      packet_etx = MAX_LINK_METRIC * RPL_DAG_MC_ETX_DIVISOR;
-    }
-
-    new_etx = ((uint32_t)recorded_etx * ETX_ALPHA +
-               (uint32_t)packet_etx * (ETX_SCALE - ETX_ALPHA)) / ETX_SCALE;
-
-    PRINTF("RPL: ETX changed from %u to %u (packet ETX = %u)\n",
-        (unsigned)(recorded_etx / RPL_DAG_MC_ETX_DIVISOR),
-        (unsigned)(new_etx  / RPL_DAG_MC_ETX_DIVISOR),
-        (unsigned)(packet_etx / RPL_DAG_MC_ETX_DIVISOR));
-    p->link_metric = new_etx;
+  const struct link_stats *stats;
+
+  /* The link statistics already took the transmission into account */
+  stats = link_stats_from_lladdr(rpl_get_parent_lladdr(p));
+  if(stats != NULL && stats->etx != 0) {
+    PRINTF("RPL: ETX changed from %u to %u\n",
+        (unsigned)(p->link_metric / RPL_DAG_MC_ETX_DIVISOR),
+        (unsigned)(stats->etx / RPL_DAG_MC_ETX_DIVISOR));
+    p->link_metric = stats->etx;
   }
 }
 
@@ -257,6 +246,12 @@ update_metric_container(rpl_instance_t *instance)
     type = RPL_DAG_MC_ENERGY_TYPE_MAINS;
   } else {
     type = RPL_DAG_MC_ENERGY_TYPE_BATTERY;
+#ifdef RPL_RESIDUAL_ENERGY
+    path_metric += 255 - RPL_RESIDUAL_ENERGY();
+    if(path_metric > 0xff) {
+      path_metric = 0xff;
+    }
+#endif
   }
 
   instance->mc.obj.energy.flags = type << RPL_DAG_MC_ENERGY_TYPE;
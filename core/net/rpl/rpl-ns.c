@@ -0,0 +1,231 @@
+/**
+ * \addtogroup uip6
+ * @{
+ */
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+/**
+ * \file
+ *         The DODAG as seen by the root in RPL non-storing mode. Every
+ *         DAO tells the root the parent of its target, the source routes
+ *         follow the parent links back from the destination.
+ */
+
+#include "net/rpl/rpl-private.h"
+#include "lib/list.h"
+#include "lib/memb.h"
+
+#define DEBUG DEBUG_NONE
+#include "net/uip-debug.h"
+
+#include <string.h>
+
+#if UIP_CONF_IPV6 && RPL_WITH_NON_STORING
+/*---------------------------------------------------------------------------*/
+MEMB(nodememb, rpl_ns_node_t, RPL_NS_NODE_NUM);
+LIST(nodelist);
+
+/* Parent of the nodes that are attached to the root itself */
+static rpl_ns_node_t root_node;
+/*---------------------------------------------------------------------------*/
+void
+rpl_ns_init(void)
+{
+  memb_init(&nodememb);
+  list_init(nodelist);
+}
+/*---------------------------------------------------------------------------*/
+static rpl_ns_node_t *
+find_node(rpl_dag_t *dag, uip_ipaddr_t *addr)
+{
+  rpl_ns_node_t *n;
+
+  /* Only addresses under the prefix of the DAG can be stored */
+  if(!uip_ipaddr_prefixcmp(addr, &dag->dag_id, 64)) {
+    return NULL;
+  }
+
+  for(n = list_head(nodelist); n != NULL; n = list_item_next(n)) {
+    if(n->dag == dag && memcmp(n->iid, &addr->u8[8], sizeof(n->iid)) == 0) {
+      return n;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static rpl_ns_node_t *
+add_node(rpl_dag_t *dag, uip_ipaddr_t *addr)
+{
+  rpl_ns_node_t *n;
+
+  n = find_node(dag, addr);
+  if(n != NULL || !uip_ipaddr_prefixcmp(addr, &dag->dag_id, 64)) {
+    return n;
+  }
+
+  n = memb_alloc(&nodememb);
+  if(n == NULL) {
+    return NULL;
+  }
+  n->dag = dag;
+  n->parent = NULL;
+  n->lifetime = 0;
+  n->children = 0;
+  memcpy(n->iid, &addr->u8[8], sizeof(n->iid));
+  list_add(nodelist, n);
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_parent(rpl_ns_node_t *node, rpl_ns_node_t *parent)
+{
+  if(node->parent != NULL && node->parent != &root_node) {
+    node->parent->children--;
+  }
+  node->parent = parent;
+  if(parent != NULL && parent != &root_node) {
+    parent->children++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+rpl_ns_node_t *
+rpl_ns_update_node(rpl_dag_t *dag, uip_ipaddr_t *child,
+                   uip_ipaddr_t *parent, uint32_t lifetime)
+{
+  rpl_ns_node_t *c;
+  rpl_ns_node_t *p;
+  rpl_ns_node_t *a;
+
+  c = add_node(dag, child);
+  if(c == NULL) {
+    PRINTF("RPL: No room for non-storing node ");
+    PRINT6ADDR(child);
+    PRINTF("\n");
+    return NULL;
+  }
+
+  if(uip_ipaddr_cmp(parent, &dag->dag_id)) {
+    p = &root_node;
+  } else {
+    /* The parent may not have sent its own DAO yet. It stays in the
+       table as long as it has children. */
+    p = add_node(dag, parent);
+    if(p == NULL) {
+      PRINTF("RPL: No room for non-storing parent ");
+      PRINT6ADDR(parent);
+      PRINTF("\n");
+      return NULL;
+    }
+  }
+
+  /* Refuse a parent below the child, it would make a routing loop */
+  for(a = p; a != &root_node && a != NULL; a = a->parent) {
+    if(a == c) {
+      PRINTF("RPL: Non-storing DAO would create a loop\n");
+      return NULL;
+    }
+  }
+  set_parent(c, p);
+  c->lifetime = lifetime;
+  return c;
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_ns_remove_parent(rpl_dag_t *dag, uip_ipaddr_t *child,
+                     uip_ipaddr_t *parent)
+{
+  rpl_ns_node_t *c;
+  rpl_ns_node_t *p;
+
+  c = find_node(dag, child);
+  if(c == NULL) {
+    return;
+  }
+  p = uip_ipaddr_cmp(parent, &dag->dag_id) ? &root_node :
+    find_node(dag, parent);
+
+  /* A No-Path DAO for a parent the node already left is stale */
+  if(p != NULL && c->parent == p) {
+    set_parent(c, NULL);
+    c->lifetime = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+rpl_ns_get_path(rpl_dag_t *dag, uip_ipaddr_t *addr,
+                rpl_ns_node_t **hops, int max_hops)
+{
+  rpl_ns_node_t *n;
+  rpl_ns_node_t *p;
+  int count;
+
+  n = find_node(dag, addr);
+  count = 0;
+  for(p = n; p != NULL && p != &root_node; p = p->parent) {
+    if(++count > max_hops) {
+      return 0;
+    }
+  }
+  if(p == NULL) {
+    /* The chain of parents does not reach the root */
+    return 0;
+  }
+
+  /* The first hop first, the destination last */
+  if(hops != NULL) {
+    hops += count;
+    for(p = n; p != &root_node; p = p->parent) {
+      *--hops = p;
+    }
+  }
+  return count;
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_ns_periodic(void)
+{
+  rpl_ns_node_t *n;
+  rpl_ns_node_t *next;
+
+  for(n = list_head(nodelist); n != NULL; n = next) {
+    next = list_item_next(n);
+    if(n->lifetime > 0) {
+      n->lifetime--;
+    } else if(n->children == 0) {
+      set_parent(n, NULL);
+      list_remove(nodelist, n);
+      memb_free(&nodememb, n);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+#endif /* UIP_CONF_IPV6 && RPL_WITH_NON_STORING */
+/** @} */
@@ -109,6 +109,13 @@
 #define RPL_DAO_LATENCY                 (CLOCK_SECOND * 4)
 #endif /* RPL_DAO_LATENCY */
 
+/* The delay for aggregating the DAOs of children before passing them on. */
+#ifdef RPL_CONF_DAO_FORWARD_LATENCY
+#define RPL_DAO_FORWARD_LATENCY         RPL_CONF_DAO_FORWARD_LATENCY
+#else /* RPL_CONF_DAO_FORWARD_LATENCY */
+#define RPL_DAO_FORWARD_LATENCY         CLOCK_SECOND
+#endif /* RPL_CONF_DAO_FORWARD_LATENCY */
+
 /* Special value indicating immediate removal. */
 #define RPL_ZERO_LIFETIME               0
 
@@ -157,6 +164,22 @@
 #define RPL_DIO_REDUNDANCY          10
 #endif
 
+/* With RPL_CONF_PREFIX_CONTEXT, the DAG prefix is installed as the
+   6LoWPAN address context of that number while the node is in the DAG,
+   see sicslowpan_set_context(). Needs SICSLOWPAN_CONF_DYNAMIC_CONTEXTS. */
+#ifdef RPL_CONF_PREFIX_CONTEXT
+#define RPL_PREFIX_CONTEXT          RPL_CONF_PREFIX_CONTEXT
+#endif
+
+/* Link-layer ACKs from parents confirm their reachability to ND, see
+   uip_ds6_nbr_confirm_reachable(), so NUD probes a parent only after its
+   link went quiet. UIP_CONF_DS6_LL_NUD does the same for all neighbors. */
+#ifdef RPL_CONF_NUD_HINT
+#define RPL_NUD_HINT                RPL_CONF_NUD_HINT
+#else
+#define RPL_NUD_HINT                1
+#endif
+
 /* Expire DAOs from neighbors that do not respond in this time. (seconds) */
 #define DAO_EXPIRATION_TIMEOUT          60
 /*---------------------------------------------------------------------------*/
@@ -181,6 +204,21 @@
 #define RPL_MOP_DEFAULT                 RPL_MOP_STORING_NO_MULTICAST
 #endif
 
+/* In non-storing mode DAOs go to the root, which source routes packets
+   down the DODAG. The other nodes keep no downward routes. */
+#define RPL_WITH_NON_STORING    (RPL_MOP_DEFAULT == RPL_MOP_NON_STORING)
+
+/* In storing mode with multicast, routers forward multicast packets of
+   a scope wider than link-local that come from their preferred parent
+   down the DODAG. */
+#define RPL_WITH_MULTICAST      (RPL_MOP_DEFAULT == RPL_MOP_STORING_MULTICAST)
+
+/* Only storing mode routers pass DAOs on, so only they aggregate them. */
+#define RPL_WITH_DAO_AGGREGATION (RPL_DAO_AGGREGATION && !RPL_WITH_NON_STORING)
+
+/* Source Routing Header, RFC 6554 */
+#define RPL_RH_TYPE_SRH                 3
+
 /*
  * The ETX in the metric container is expressed as a fixed-point value 
  * whose integer part can be obtained by dividing the value by 
@@ -248,6 +286,15 @@ struct rpl_stats {
   uint16_t malformed_msgs;
   uint16_t resets;
   uint16_t parent_switch;
+  /* Control messages sent and received, per type. */
+  uint16_t dio_sent;
+  uint16_t dio_recv;
+  uint16_t dis_sent;
+  uint16_t dis_recv;
+  uint16_t dao_sent;
+  uint16_t dao_recv;
+  uint16_t dao_ack_sent;
+  uint16_t dao_ack_recv;
 };
 typedef struct rpl_stats rpl_stats_t;
 
@@ -272,6 +319,9 @@ void dio_output(rpl_instance_t *, uip_ipaddr_t *uc_addr);
 void dao_output(rpl_parent_t *, uint8_t lifetime);
 void dao_output_target(rpl_parent_t *, uip_ipaddr_t *, uint8_t lifetime);
 void dao_ack_output(rpl_instance_t *, uip_ipaddr_t *, uint8_t);
+#if RPL_WITH_DAO_AGGREGATION
+int rpl_dao_pending(rpl_dag_t *);
+#endif /* RPL_WITH_DAO_AGGREGATION */
 
 /* RPL logic functions. */
 void rpl_join_dag(uip_ipaddr_t *from, rpl_dio_t *dio);
@@ -304,18 +354,48 @@ uip_ds6_route_t *rpl_add_route(rpl_dag_t *dag, uip_ipaddr_t *prefix,
                                int prefix_len, uip_ipaddr_t *next_hop);
 void rpl_purge_routes(void);
 
+#if RPL_WITH_NON_STORING
+/* A node of a non-storing DODAG, learned by the root from DAOs. Nodes
+   share the prefix of the DAG ID, so only the interface identifier is
+   stored. */
+struct rpl_ns_node {
+  struct rpl_ns_node *next;
+  rpl_dag_t *dag;
+  struct rpl_ns_node *parent;
+  uint32_t lifetime;
+  uint16_t children;
+  uint8_t iid[8];
+};
+typedef struct rpl_ns_node rpl_ns_node_t;
+
+/* Non-storing mode functions of the root. */
+void rpl_ns_init(void);
+rpl_ns_node_t *rpl_ns_update_node(rpl_dag_t *dag, uip_ipaddr_t *child,
+                                  uip_ipaddr_t *parent, uint32_t lifetime);
+void rpl_ns_remove_parent(rpl_dag_t *dag, uip_ipaddr_t *child,
+                          uip_ipaddr_t *parent);
+/* Number of hops from the root to addr, 0 if it is unreachable or
+   further than max_hops. hops, if not NULL, gets the nodes on the way. */
+int rpl_ns_get_path(rpl_dag_t *dag, uip_ipaddr_t *addr,
+                    rpl_ns_node_t **hops, int max_hops);
+void rpl_ns_periodic(void);
+#endif /* RPL_WITH_NON_STORING */
+
 /* Lock a parent in the neighbor cache. */
 void rpl_lock_parent(rpl_parent_t *p);
 
-/* Objective function. */
+/* Objective functions. */
+extern rpl_of_t rpl_of0, rpl_mrhof;
 rpl_of_t *rpl_find_of(rpl_ocp_t);
 
 /* Timer functions. */
 void rpl_schedule_dao(rpl_instance_t *);
 void rpl_schedule_dao_immediately(rpl_instance_t *);
+void rpl_schedule_dao_forward(rpl_instance_t *);
 void rpl_cancel_dao(rpl_instance_t *instance);
 
 void rpl_reset_dio_timer(rpl_instance_t *);
+void rpl_dio_inconsistency(rpl_instance_t *);
 void rpl_reset_periodic_timer(void);
 
 /* Route poisoning. */
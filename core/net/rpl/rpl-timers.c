@@ -66,6 +66,9 @@ static void
 handle_periodic_timer(void *ptr)
 {
   rpl_purge_routes();
+#if RPL_WITH_NON_STORING
+  rpl_ns_periodic();
+#endif /* RPL_WITH_NON_STORING */
   rpl_recalculate_ranks();
 
   /* handle DIS */
@@ -194,6 +197,19 @@ rpl_reset_dio_timer(rpl_instance_t *instance)
 #endif /* RPL_LEAF_ONLY */
 }
 /*---------------------------------------------------------------------------*/
+/* Resets the DIO timer after an inconsistency that can wait, unless the
+   interval is still close to the minimum. */
+void
+rpl_dio_inconsistency(rpl_instance_t *instance)
+{
+  if(instance->dio_intcurrent > instance->dio_intmin + RPL_DIO_RESET_HYSTERESIS) {
+    rpl_reset_dio_timer(instance);
+  } else {
+    PRINTF("RPL: Inconsistency, DIO interval %u is short enough\n",
+           instance->dio_intcurrent);
+  }
+}
+/*---------------------------------------------------------------------------*/
 static void handle_dao_timer(void *ptr);
 static void
 set_dao_lifetime_timer(rpl_instance_t *instance)
@@ -243,6 +259,14 @@ handle_dao_timer(void *ptr)
   if(etimer_expired(&instance->dao_lifetime_timer.etimer)) {
     set_dao_lifetime_timer(instance);
   }
+
+#if RPL_WITH_DAO_AGGREGATION
+  /* The targets that did not fit go out with the next DAO. */
+  if(instance->current_dag->preferred_parent != NULL &&
+     rpl_dao_pending(instance->current_dag)) {
+    rpl_schedule_dao_forward(instance);
+  }
+#endif /* RPL_WITH_DAO_AGGREGATION */
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -287,6 +311,12 @@ rpl_schedule_dao_immediately(rpl_instance_t *instance)
 }
 /*---------------------------------------------------------------------------*/
 void
+rpl_schedule_dao_forward(rpl_instance_t *instance)
+{
+  schedule_dao(instance, RPL_DAO_FORWARD_LATENCY);
+}
+/*---------------------------------------------------------------------------*/
+void
 rpl_cancel_dao(rpl_instance_t *instance)
 {
   ctimer_stop(&instance->dao_timer);
@@ -229,6 +229,11 @@ rpl_link_neighbor_callback(const rimeaddr_t *addr, int status, int numtx)
         if(instance->of->neighbor_link_callback != NULL) {
           instance->of->neighbor_link_callback(parent, status, numtx);
         }
+#if RPL_NUD_HINT && !UIP_DS6_LL_NUD
+        if(status == MAC_TX_OK) {
+          uip_ds6_nbr_confirm_reachable(uip_ds6_nbr_ll_lookup((uip_lladdr_t *)addr));
+        }
+#endif /* RPL_NUD_HINT && !UIP_DS6_LL_NUD */
       }
     }
   }
@@ -265,6 +270,9 @@ rpl_init(void)
   default_instance = NULL;
 
   rpl_dag_init();
+#if RPL_WITH_NON_STORING
+  rpl_ns_init();
+#endif /* RPL_WITH_NON_STORING */
   rpl_reset_periodic_timer();
 
   /* add rpl multicast address */
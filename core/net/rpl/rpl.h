@@ -196,7 +196,6 @@ struct rpl_instance {
   rpl_metric_container_t mc;
   rpl_of_t *of;
   rpl_dag_t *current_dag;
-  rpl_dag_t dag_table[RPL_MAX_DAG_PER_INSTANCE];
   /* The current default router - used for routing "upwards" */
   uip_ds6_defrt_t *def_route;
   uint8_t instance_id;
@@ -229,6 +228,8 @@ struct rpl_instance {
 void rpl_init(void);
 void uip_rpl_input(void);
 rpl_dag_t *rpl_set_root(uint8_t instance_id, uip_ipaddr_t * dag_id);
+rpl_dag_t *rpl_set_root_with_of(uint8_t instance_id, uip_ipaddr_t *dag_id,
+                                rpl_of_t *of);
 int rpl_set_prefix(rpl_dag_t *dag, uip_ipaddr_t *prefix, unsigned len);
 int rpl_repair_root(uint8_t instance_id);
 int rpl_set_default_route(rpl_instance_t *instance, uip_ipaddr_t *from);
@@ -237,10 +238,17 @@ rpl_instance_t *rpl_get_instance(uint8_t instance_id);
 void rpl_update_header_empty(void);
 int rpl_update_header_final(uip_ipaddr_t *addr);
 int rpl_verify_header(int);
+int rpl_fast_forward_option(uip_ext_hdr_opt_rpl *opt, uip_ipaddr_t *dest);
 void rpl_insert_header(void);
 void rpl_remove_header(void);
 uint8_t rpl_invert_header(void);
+int rpl_srh_insert(void);
+int rpl_srh_process(void);
+int rpl_srh_get_next_hop(uip_ipaddr_t *ipaddr);
+int rpl_mcast_in(void);
+uip_ipaddr_t *rpl_get_tclass_nexthop(void);
 uip_ipaddr_t *rpl_get_parent_ipaddr(rpl_parent_t *nbr);
+rimeaddr_t *rpl_get_parent_lladdr(rpl_parent_t *nbr);
 rpl_rank_t rpl_get_parent_rank(uip_lladdr_t *addr);
 uint16_t rpl_get_parent_link_metric(const uip_lladdr_t *addr);
 void rpl_dag_init(void);
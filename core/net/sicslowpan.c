@@ -66,6 +66,11 @@
 #include "net/rime.h"
 #include "net/sicslowpan.h"
 #include "net/netstack.h"
+#include "net/link-stats.h"
+#include "sys/pgm.h"
+#if UIP_CONF_IPV6_RPL
+#include "net/rpl/rpl.h"
+#endif /* UIP_CONF_IPV6_RPL */
 
 #if UIP_CONF_IPV6
 
@@ -104,6 +109,41 @@ void uip_log(char *msg);
 #define SICSLOWPAN_MAX_MAC_TRANSMISSIONS 4
 #endif
 
+/*
+ * With SICSLOWPAN_CONF_FRAG_BURST, the fragments of a datagram are
+ * queued and handed to the MAC as one packet list, so the RDC can send
+ * them in a single burst. Datagrams with more than
+ * SICSLOWPAN_FRAG_BURST_MAX fragments are sent fragment by fragment.
+ */
+#ifdef SICSLOWPAN_CONF_FRAG_BURST
+#define SICSLOWPAN_FRAG_BURST (SICSLOWPAN_CONF_FRAG_BURST && SICSLOWPAN_CONF_FRAG)
+#else
+#define SICSLOWPAN_FRAG_BURST 0
+#endif
+
+#ifdef SICSLOWPAN_CONF_FRAG_BURST_MAX
+#define SICSLOWPAN_FRAG_BURST_MAX SICSLOWPAN_CONF_FRAG_BURST_MAX
+#else
+#define SICSLOWPAN_FRAG_BURST_MAX QUEUEBUF_NUM
+#endif
+
+/*
+ * With SICSLOWPAN_CONF_INPUT_QUEUE, a complete packet stays in its
+ * reassembly context and is handed to uIP by sicslowpan_input_process.
+ * input() returns to the radio driver right away, so the next frames are
+ * received while earlier packets are processed or forwarded. The
+ * SICSLOWPAN_REASS_CONTEXTS contexts form the packet buffer pool: each is
+ * free, reassembling, or queued for uIP. A queued packet is copied to
+ * uip_buf right before uIP processes it, and the MAC takes its own copy
+ * of every outgoing frame, so nothing else needs to own a buffer.
+ * Needs at least two reassembly contexts to have any effect.
+ */
+#ifdef SICSLOWPAN_CONF_INPUT_QUEUE
+#define SICSLOWPAN_INPUT_QUEUE (SICSLOWPAN_CONF_INPUT_QUEUE && SICSLOWPAN_CONF_FRAG)
+#else
+#define SICSLOWPAN_INPUT_QUEUE 0
+#endif
+
 #ifndef SICSLOWPAN_COMPRESSION
 #ifdef SICSLOWPAN_CONF_COMPRESSION
 #define SICSLOWPAN_COMPRESSION SICSLOWPAN_CONF_COMPRESSION
@@ -112,6 +152,55 @@ void uip_log(char *msg);
 #endif /* SICSLOWPAN_CONF_COMPRESSION */
 #endif /* SICSLOWPAN_COMPRESSION */
 
+/*
+ * SICSLOWPAN_CONF_DYNAMIC_CONTEXTS address contexts follow the static
+ * ones of SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS. They are set at run time
+ * with sicslowpan_set_context(), e.g. by RPL for the DAG prefix.
+ */
+#ifdef SICSLOWPAN_CONF_DYNAMIC_CONTEXTS
+#define SICSLOWPAN_DYNAMIC_CONTEXTS SICSLOWPAN_CONF_DYNAMIC_CONTEXTS
+#else
+#define SICSLOWPAN_DYNAMIC_CONTEXTS 0
+#endif
+
+#define SICSLOWPAN_ADDR_CONTEXTS (SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS + \
+                                  SICSLOWPAN_DYNAMIC_CONTEXTS)
+
+/*
+ * With SICSLOWPAN_CONF_FAST_FORWARD, a router forwards unfragmented
+ * IPHC packets to a reachable neighbor directly from packetbuf: only
+ * the hop limit and the addresses are compressed again for the next
+ * link. All other packets are decompressed into uip_buf as usual.
+ */
+#ifdef SICSLOWPAN_CONF_FAST_FORWARD
+#define SICSLOWPAN_FAST_FORWARD (SICSLOWPAN_CONF_FAST_FORWARD && UIP_CONF_ROUTER && \
+                                 SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06)
+#else
+#define SICSLOWPAN_FAST_FORWARD 0
+#endif
+
+/*
+ * SICSLOWPAN_CONF_UDP_PORT_MAP lists up to 16 application ports, e.g.
+ * { 5683, 61616 }, that IPHC carries in 4 bits like the ports 0xF0B0 +
+ * index they stand in for. Those ports are then sent in full. All nodes
+ * of the network must use the same map.
+ */
+#ifdef SICSLOWPAN_CONF_UDP_PORT_MAP
+static const uint16_t udp_port_map[] PGM = SICSLOWPAN_CONF_UDP_PORT_MAP;
+#define UDP_PORT_MAP_LEN (sizeof(udp_port_map) / sizeof(udp_port_map[0]))
+#endif
+
+/*
+ * With SICSLOWPAN_CONF_UDP_CHECKSUM_ELISION, IPHC leaves out the UDP
+ * checksum. Only enable it where the link layer authenticates all frames
+ * with a MIC, the receiver then skips the check.
+ */
+#ifdef SICSLOWPAN_CONF_UDP_CHECKSUM_ELISION
+#define UDP_CHECKSUM_ELISION SICSLOWPAN_CONF_UDP_CHECKSUM_ELISION
+#else
+#define UDP_CHECKSUM_ELISION 0
+#endif
+
 #define GET16(ptr,index) (((uint16_t)((ptr)[index] << 8)) | ((ptr)[(index) + 1]))
 #define SET16(ptr,index,value) do {     \
   (ptr)[index] = ((value) >> 8) & 0xff; \
@@ -219,35 +308,69 @@ static int last_tx_status;
  *  @{
  */
 
-static uint16_t sicslowpan_len;
-
 /**
- * The buffer used for the 6lowpan reassembly.
- * This buffer contains only the IPv6 packet (no MAC header, 6lowpan, etc).
- * It has a fix size as we do not use dynamic memory allocation.
+ * A datagram being reassembled. The fragments are matched to it by the
+ * sender, the datagram tag and the datagram size, so the fragments of
+ * several senders can be reassembled at the same time.
  */
-static uip_buf_t sicslowpan_aligned_buf;
-#define sicslowpan_buf (sicslowpan_aligned_buf.u8)
+struct sicslowpan_reass {
+  /**
+   * The buffer used for the 6lowpan reassembly.
+   * This buffer contains only the IPv6 packet (no MAC header, 6lowpan, etc).
+   * It has a fix size as we do not use dynamic memory allocation.
+   */
+  uip_buf_t buf;
+  /** The total length of the IPv6 packet in buf. */
+  uint16_t len;
+  /**
+   * length of the ip packet already received, 0 if the context is free.
+   * It includes IP and transport headers.
+   */
+  uint16_t processed;
+  /** The tag in the fragments being merged. */
+  uint16_t tag;
+  /** The source address of the fragments being merged */
+  rimeaddr_t sender;
+  /** Reassembly %process %timer. */
+  struct timer timer;
+#if SICSLOWPAN_INPUT_QUEUE
+  /** Set while the packet waits for sicslowpan_input_process */
+  uint8_t queued;
+  /** RSSI of the last frame of the packet */
+  int16_t rssi;
+#endif /* SICSLOWPAN_INPUT_QUEUE */
+};
 
-/** The total length of the IPv6 packet in the sicslowpan_buf. */
+static struct sicslowpan_reass reass_contexts[SICSLOWPAN_REASS_CONTEXTS];
 
-/**
- * length of the ip packet already sent / received.
- * It includes IP and transport headers.
- */
-static uint16_t processed_ip_in_len;
+/** The reassembly context of the packet input() is processing. */
+static struct sicslowpan_reass *reass = &reass_contexts[0];
 
-/** Datagram tag to be put in the fragments I send. */
-static uint16_t my_tag;
+#define sicslowpan_buf (reass->buf.u8)
+#define sicslowpan_len (reass->len)
+#define processed_ip_in_len (reass->processed)
+
+#if SICSLOWPAN_INPUT_QUEUE
+/** Contexts with a complete packet, oldest first */
+static struct sicslowpan_reass *input_queue[SICSLOWPAN_REASS_CONTEXTS];
+static uint8_t input_queue_head, input_queue_len;
 
-/** When reassembling, the tag in the fragments being merged. */
-static uint16_t reass_tag;
+PROCESS(sicslowpan_input_process, "6LoWPAN input");
+#endif /* SICSLOWPAN_INPUT_QUEUE */
 
-/** When reassembling, the source address of the fragments being merged */
-rimeaddr_t frag_sender;
+/** Datagram tag to be put in the fragments I send. */
+static uint16_t my_tag;
 
-/** Reassembly %process %timer. */
-static struct timer reass_timer;
+#if SICSLOWPAN_FRAG_BURST
+/** The fragments queued for the burst, linked in order. */
+static struct rdc_buf_list frag_burst[SICSLOWPAN_FRAG_BURST_MAX];
+/** Number of fragments in frag_burst. */
+static uint8_t frag_burst_len;
+/** Set while the fragments of a datagram are queued instead of sent. */
+static uint8_t frag_bursting;
+#else /* SICSLOWPAN_FRAG_BURST */
+#define frag_bursting 0
+#endif /* SICSLOWPAN_FRAG_BURST */
 
 /** @} */
 #else /* SICSLOWPAN_CONF_FRAG */
@@ -314,9 +437,9 @@ set_packet_attrs()
  */
 
 /** Addresses contexts for IPHC. */
-#if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0
+#if SICSLOWPAN_ADDR_CONTEXTS > 0
 static struct sicslowpan_addr_context 
-addr_contexts[SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS];
+addr_contexts[SICSLOWPAN_ADDR_CONTEXTS];
 #endif
 
 /** pointer to an address context. */
@@ -332,27 +455,27 @@ static uint8_t *hc06_ptr;
 /*   3 -> 2 bytes from prefix - infer 8 bytes from lladdr */
 /*   NOTE: => the uncompress function does change 0xf to 0x10 */
 /*   NOTE: 0x00 => no-autoconfig => unspecified */
-const uint8_t unc_llconf[] = {0x0f,0x28,0x22,0x20};
+static const uint8_t unc_llconf[] PGM = {0x0f,0x28,0x22,0x20};
 
 /* Uncompression of ctx-based */
 /*   0 -> 0 bits from packet [unspecified / reserved] */
 /*   1 -> 8 bytes from prefix - bunch of zeroes and 8 from packet */
 /*   2 -> 8 bytes from prefix - 0000::00ff:fe00:XXXX + 2 from packet */
 /*   3 -> 8 bytes from prefix - infer 8 bytes from lladdr */
-const uint8_t unc_ctxconf[] = {0x00,0x88,0x82,0x80};
+static const uint8_t unc_ctxconf[] PGM = {0x00,0x88,0x82,0x80};
 
 /* Uncompression of ctx-based */
 /*   0 -> 0 bits from packet  */
 /*   1 -> 2 bytes from prefix - bunch of zeroes 5 from packet */
 /*   2 -> 2 bytes from prefix - zeroes + 3 from packet */
 /*   3 -> 2 bytes from prefix - infer 1 bytes from lladdr */
-const uint8_t unc_mxconf[] = {0x0f, 0x25, 0x23, 0x21};
+static const uint8_t unc_mxconf[] PGM = {0x0f, 0x25, 0x23, 0x21};
 
-/* Link local prefix */
+/* Link local prefix, in RAM like the context prefixes */
 const uint8_t llprefix[] = {0xfe, 0x80};
 
 /* TTL uncompression values */
-static const uint8_t ttl_values[] = {0, 1, 64, 255};
+static const uint8_t ttl_values[] PGM = {0, 1, 64, 255};
 
 /*--------------------------------------------------------------------*/
 /** \name HC06 related functions
@@ -363,15 +486,15 @@ static struct sicslowpan_addr_context*
 addr_context_lookup_by_prefix(uip_ipaddr_t *ipaddr)
 {
 /* Remove code to avoid warnings and save flash if no context is used */
-#if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0
+#if SICSLOWPAN_ADDR_CONTEXTS > 0
   int i;
-  for(i = 0; i < SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS; i++) {
+  for(i = 0; i < SICSLOWPAN_ADDR_CONTEXTS; i++) {
     if((addr_contexts[i].used == 1) &&
        uip_ipaddr_prefixcmp(&addr_contexts[i].prefix, ipaddr, 64)) {
       return &addr_contexts[i];
     }
   }
-#endif /* SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0 */
+#endif /* SICSLOWPAN_ADDR_CONTEXTS > 0 */
   return NULL;
 }
 /*--------------------------------------------------------------------*/
@@ -380,15 +503,15 @@ static struct sicslowpan_addr_context*
 addr_context_lookup_by_number(uint8_t number)
 {
 /* Remove code to avoid warnings and save flash if no context is used */ 
-#if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0
+#if SICSLOWPAN_ADDR_CONTEXTS > 0
   int i;
-  for(i = 0; i < SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS; i++) {
+  for(i = 0; i < SICSLOWPAN_ADDR_CONTEXTS; i++) {
     if((addr_contexts[i].used == 1) &&
        addr_contexts[i].number == number) {
       return &addr_contexts[i];
     }
   }
-#endif /* SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0 */
+#endif /* SICSLOWPAN_ADDR_CONTEXTS > 0 */
   return NULL;
 }
 /*--------------------------------------------------------------------*/
@@ -451,6 +574,41 @@ uncompress_addr(uip_ipaddr_t *ipaddr, uint8_t const prefix[],
   PRINT6ADDR(ipaddr);
   PRINTF("\n");
 }
+/*--------------------------------------------------------------------*/
+/* Returns the 4 bit short form of a UDP port, or 0xff if there is none */
+static uint8_t
+udp_port_4_bit(uint16_t port)
+{
+#ifdef SICSLOWPAN_CONF_UDP_PORT_MAP
+  uint8_t i;
+
+  for(i = 0; i < UDP_PORT_MAP_LEN; i++) {
+    if(port == PGM_READ_WORD(&udp_port_map[i])) {
+      return i;
+    }
+  }
+  if((port & 0xfff0) == SICSLOWPAN_UDP_4_BIT_PORT_MIN &&
+     (port & 0x0f) < UDP_PORT_MAP_LEN) {
+    /* The short form stands for a mapped port */
+    return 0xff;
+  }
+#endif /* SICSLOWPAN_CONF_UDP_PORT_MAP */
+  if((port & 0xfff0) == SICSLOWPAN_UDP_4_BIT_PORT_MIN) {
+    return port & 0x0f;
+  }
+  return 0xff;
+}
+/*--------------------------------------------------------------------*/
+static uint16_t
+udp_port_from_4_bit(uint8_t port4)
+{
+#ifdef SICSLOWPAN_CONF_UDP_PORT_MAP
+  if(port4 < UDP_PORT_MAP_LEN) {
+    return PGM_READ_WORD(&udp_port_map[port4]);
+  }
+#endif /* SICSLOWPAN_CONF_UDP_PORT_MAP */
+  return SICSLOWPAN_UDP_4_BIT_PORT_MIN + port4;
+}
 
 /*--------------------------------------------------------------------*/
 /**
@@ -703,19 +861,18 @@ compress_hdr_hc06(rimeaddr_t *rime_destaddr)
 #if UIP_CONF_UDP || UIP_CONF_ROUTER
   /* UDP header compression */
   if(UIP_IP_BUF->proto == UIP_PROTO_UDP) {
+    uint8_t *nhc_ptr = hc06_ptr;
+    uint8_t src4, dest4;
+
     PRINTF("IPHC: Uncompressed UDP ports on send side: %x, %x\n",
 	   UIP_HTONS(UIP_UDP_BUF->srcport), UIP_HTONS(UIP_UDP_BUF->destport));
-    /* Mask out the last 4 bits can be used as a mask */
-    if(((UIP_HTONS(UIP_UDP_BUF->srcport) & 0xfff0) == SICSLOWPAN_UDP_4_BIT_PORT_MIN) &&
-       ((UIP_HTONS(UIP_UDP_BUF->destport) & 0xfff0) == SICSLOWPAN_UDP_4_BIT_PORT_MIN)) {
+    src4 = udp_port_4_bit(UIP_HTONS(UIP_UDP_BUF->srcport));
+    dest4 = udp_port_4_bit(UIP_HTONS(UIP_UDP_BUF->destport));
+    if(src4 <= 0x0f && dest4 <= 0x0f) {
       /* we can compress 12 bits of both source and dest */
       *hc06_ptr = SICSLOWPAN_NHC_UDP_CS_P_11;
       PRINTF("IPHC: remove 12 b of both source & dest with prefix 0xFOB\n");
-      *(hc06_ptr + 1) =
-	(uint8_t)((UIP_HTONS(UIP_UDP_BUF->srcport) -
-		SICSLOWPAN_UDP_4_BIT_PORT_MIN) << 4) +
-	(uint8_t)((UIP_HTONS(UIP_UDP_BUF->destport) -
-		SICSLOWPAN_UDP_4_BIT_PORT_MIN));
+      *(hc06_ptr + 1) = (src4 << 4) + dest4;
       hc06_ptr += 2;
     } else if((UIP_HTONS(UIP_UDP_BUF->destport) & 0xff00) == SICSLOWPAN_UDP_8_BIT_PORT_MIN) {
       /* we can compress 8 bits of dest, leave source. */
@@ -742,8 +899,9 @@ compress_hdr_hc06(rimeaddr_t *rime_destaddr)
       memcpy(hc06_ptr + 1, &UIP_UDP_BUF->srcport, 4);
       hc06_ptr += 5;
     }
-    /* always inline the checksum  */
-    if(1) {
+    if(UDP_CHECKSUM_ELISION) {
+      *nhc_ptr |= SICSLOWPAN_NHC_UDP_CHECKSUMC;
+    } else {
       memcpy(hc06_ptr, &UIP_UDP_BUF->udpchksum, 2);
       hc06_ptr += 2;
     }
@@ -846,7 +1004,7 @@ uncompress_hdr_hc06(uint16_t ip_len)
 
   /* Hop limit */
   if((iphc0 & 0x03) != SICSLOWPAN_IPHC_TTL_I) {
-    SICSLOWPAN_IP_BUF->ttl = ttl_values[iphc0 & 0x03];
+    SICSLOWPAN_IP_BUF->ttl = PGM_READ_BYTE(&ttl_values[iphc0 & 0x03]);
   } else {
     SICSLOWPAN_IP_BUF->ttl = *hc06_ptr;
     hc06_ptr += 1;
@@ -870,11 +1028,13 @@ uncompress_hdr_hc06(uint16_t ip_len)
     }
     /* if tmp == 0 we do not have a context and therefore no prefix */
     uncompress_addr(&SICSLOWPAN_IP_BUF->srcipaddr,
-                    tmp != 0 ? context->prefix : NULL, unc_ctxconf[tmp],
+                    tmp != 0 ? context->prefix : NULL,
+                    PGM_READ_BYTE(&unc_ctxconf[tmp]),
                     (uip_lladdr_t *)packetbuf_addr(PACKETBUF_ADDR_SENDER));
   } else {
     /* no compression and link local */
-    uncompress_addr(&SICSLOWPAN_IP_BUF->srcipaddr, llprefix, unc_llconf[tmp],
+    uncompress_addr(&SICSLOWPAN_IP_BUF->srcipaddr, llprefix,
+                    PGM_READ_BYTE(&unc_llconf[tmp]),
                     (uip_lladdr_t *)packetbuf_addr(PACKETBUF_ADDR_SENDER));
   }
 
@@ -900,7 +1060,7 @@ uncompress_hdr_hc06(uint16_t ip_len)
       }
 
       uncompress_addr(&SICSLOWPAN_IP_BUF->destipaddr, prefix,
-                      unc_mxconf[tmp], NULL);
+                      PGM_READ_BYTE(&unc_mxconf[tmp]), NULL);
     }
   } else {
     /* no multicast */
@@ -916,12 +1076,12 @@ uncompress_hdr_hc06(uint16_t ip_len)
 	return;
       }
       uncompress_addr(&SICSLOWPAN_IP_BUF->destipaddr, context->prefix,
-                      unc_ctxconf[tmp],
+                      PGM_READ_BYTE(&unc_ctxconf[tmp]),
                       (uip_lladdr_t *)packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
     } else {
       /* not context based => link local M = 0, DAC = 0 - same as SAC */
       uncompress_addr(&SICSLOWPAN_IP_BUF->destipaddr, llprefix,
-                      unc_llconf[tmp],
+                      PGM_READ_BYTE(&unc_llconf[tmp]),
                       (uip_lladdr_t *)packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
     }
   }
@@ -968,10 +1128,8 @@ uncompress_hdr_hc06(uint16_t ip_len)
 
       case SICSLOWPAN_NHC_UDP_CS_P_11:
 	/* 1 byte for NHC, 1 byte for ports */
-	SICSLOWPAN_UDP_BUF->srcport = UIP_HTONS(SICSLOWPAN_UDP_4_BIT_PORT_MIN +
-					    (*(hc06_ptr + 1) >> 4));
-	SICSLOWPAN_UDP_BUF->destport = UIP_HTONS(SICSLOWPAN_UDP_4_BIT_PORT_MIN +
-					     ((*(hc06_ptr + 1)) & 0x0F));
+	SICSLOWPAN_UDP_BUF->srcport = UIP_HTONS(udp_port_from_4_bit(*(hc06_ptr + 1) >> 4));
+	SICSLOWPAN_UDP_BUF->destport = UIP_HTONS(udp_port_from_4_bit(*(hc06_ptr + 1) & 0x0F));
 	PRINTF("IPHC: Uncompressed UDP ports (ptr+2): %x, %x\n",
 	       UIP_HTONS(SICSLOWPAN_UDP_BUF->srcport), UIP_HTONS(SICSLOWPAN_UDP_BUF->destport));
 	hc06_ptr += 2;
@@ -986,6 +1144,8 @@ uncompress_hdr_hc06(uint16_t ip_len)
 	hc06_ptr += 2;
 	PRINTF("IPHC: sicslowpan uncompress_hdr: checksum included\n");
       } else {
+	/* A zero checksum is not verified by uIP */
+	SICSLOWPAN_UDP_BUF->udpchksum = 0;
 	PRINTF("IPHC: sicslowpan uncompress_hdr: checksum *NOT* included\n");
       }
       uncomp_hdr_len += UIP_UDPH_LEN;
@@ -1316,12 +1476,11 @@ packet_sent(void *ptr, int status, int transmissions)
 }
 /*--------------------------------------------------------------------*/
 /**
- * \brief This function is called by the 6lowpan code to send out a
- * packet.
+ * \brief Sets the packetbuf attributes for sending to dest
  * \param dest the link layer destination address of the packet
  */
 static void
-send_packet(rimeaddr_t *dest)
+set_packet_dest(rimeaddr_t *dest)
 {
   /* Set the link layer destination address for the packet as a
    * packetbuf attribute. The MAC layer can access the destination
@@ -1338,6 +1497,17 @@ send_packet(rimeaddr_t *dest)
 #if SICSLOWPAN_CONF_ACK_ALL
     packetbuf_set_attr(PACKETBUF_ATTR_RELIABLE, 1);
 #endif
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief This function is called by the 6lowpan code to send out a
+ * packet.
+ * \param dest the link layer destination address of the packet
+ */
+static void
+send_packet(rimeaddr_t *dest)
+{
+  set_packet_dest(dest);
 
   /* Provide a callback function to receive the result of
      a packet transmission. */
@@ -1347,6 +1517,73 @@ send_packet(rimeaddr_t *dest)
      watchdog know that we are still alive. */
   watchdog_periodic();
 }
+#if SICSLOWPAN_CONF_FRAG
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Sends the fragment in packetbuf, the fragment stays in packetbuf
+ * \param dest the link layer destination address of the fragment
+ * \return 0 if no queuebuf could be allocated, 1 otherwise
+ *
+ * During a burst the fragment is only queued, send_burst() sends it.
+ */
+static int
+send_fragment(rimeaddr_t *dest)
+{
+  struct queuebuf *q;
+
+#if SICSLOWPAN_FRAG_BURST
+  if(frag_bursting) {
+    set_packet_dest(dest);
+    q = queuebuf_new_from_packetbuf();
+    if(q == NULL) {
+      return 0;
+    }
+    frag_burst[frag_burst_len].next = NULL;
+    frag_burst[frag_burst_len].buf = q;
+    frag_burst[frag_burst_len].ptr = NULL;
+    if(frag_burst_len > 0) {
+      frag_burst[frag_burst_len - 1].next = &frag_burst[frag_burst_len];
+    }
+    frag_burst_len++;
+    RIMESTATS_ADD(lowpanfragtx);
+    return 1;
+  }
+#endif /* SICSLOWPAN_FRAG_BURST */
+
+  /* The MAC modifies packetbuf, keep a copy for the next fragment */
+  q = queuebuf_new_from_packetbuf();
+  if(q == NULL) {
+    return 0;
+  }
+  send_packet(dest);
+  queuebuf_to_packetbuf(q);
+  queuebuf_free(q);
+  RIMESTATS_ADD(lowpanfragtx);
+  return 1;
+}
+#endif /* SICSLOWPAN_CONF_FRAG */
+#if SICSLOWPAN_FRAG_BURST
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Ends a burst, frees the queued fragments
+ * \param send nonzero to hand the fragments to the MAC first
+ */
+static void
+end_burst(int send)
+{
+  uint8_t i;
+
+  if(send && frag_burst_len > 0) {
+    NETSTACK_MAC.send_list(&packet_sent, NULL, frag_burst);
+    watchdog_periodic();
+  }
+  for(i = 0; i < frag_burst_len; i++) {
+    queuebuf_free(frag_burst[i].buf);
+  }
+  frag_burst_len = 0;
+  frag_bursting = 0;
+}
+#endif /* SICSLOWPAN_FRAG_BURST */
 /*--------------------------------------------------------------------*/
 /** \brief Take an IP packet and format it to be sent on an 802.15.4
  *  network using 6lowpan.
@@ -1453,7 +1690,6 @@ output(const uip_lladdr_t *localdest)
 
   if((int)uip_len - (int)uncomp_hdr_len > (int)MAC_MAX_PAYLOAD - framer_hdrlen - (int)rime_hdr_len) {
 #if SICSLOWPAN_CONF_FRAG
-    struct queuebuf *q;
     /*
      * The outbound IPv6 packet is too large to fit into a single 15.4
      * packet, so we fragment it into multiple packets and send them.
@@ -1464,6 +1700,22 @@ output(const uip_lladdr_t *localdest)
 
     PRINTFO("Fragmentation sending packet len %d\n", uip_len);
 
+#if SICSLOWPAN_FRAG_BURST
+    if(NETSTACK_MAC.send_list != NULL) {
+      /* The IP bytes in the first fragment and in the following ones */
+      int frag1_len = uncomp_hdr_len + ((MAC_MAX_PAYLOAD - framer_hdrlen -
+          (int)rime_hdr_len - SICSLOWPAN_FRAG1_HDR_LEN) & 0xfffffff8);
+      int fragn_len = (MAC_MAX_PAYLOAD - framer_hdrlen -
+          SICSLOWPAN_FRAGN_HDR_LEN) & 0xfffffff8;
+      if(1 + (uip_len - frag1_len + fragn_len - 1) / fragn_len <=
+         SICSLOWPAN_FRAG_BURST_MAX) {
+        frag_bursting = 1;
+        /* The receiver keeps its radio on for the next fragment */
+        packetbuf_set_attr(PACKETBUF_ATTR_PENDING, 1);
+      }
+    }
+#endif /* SICSLOWPAN_FRAG_BURST */
+
     /* Create 1st Fragment */
     PRINTFO("sicslowpan output: 1rst fragment ");
 
@@ -1489,21 +1741,22 @@ output(const uip_lladdr_t *localdest)
     memcpy(rime_ptr + rime_hdr_len,
            (uint8_t *)UIP_IP_BUF + uncomp_hdr_len, rime_payload_len);
     packetbuf_set_datalen(rime_payload_len + rime_hdr_len);
-    q = queuebuf_new_from_packetbuf();
-    if(q == NULL) {
+    if(!send_fragment(&dest)) {
       PRINTFO("could not allocate queuebuf for first fragment, dropping packet\n");
+      RIMESTATS_ADD(lowpandrop);
+#if SICSLOWPAN_FRAG_BURST
+      end_burst(0);
+#endif /* SICSLOWPAN_FRAG_BURST */
       return 0;
     }
-    send_packet(&dest);
-    queuebuf_to_packetbuf(q);
-    queuebuf_free(q);
-    q = NULL;
 
     /* Check tx result. */
-    if((last_tx_status == MAC_TX_COLLISION) ||
+    if(!frag_bursting &&
+       ((last_tx_status == MAC_TX_COLLISION) ||
        (last_tx_status == MAC_TX_ERR) ||
-       (last_tx_status == MAC_TX_ERR_FATAL)) {
+       (last_tx_status == MAC_TX_ERR_FATAL))) {
       PRINTFO("error in fragment tx, dropping subsequent fragments.\n");
+      RIMESTATS_ADD(lowpandrop);
       return 0;
     }
 
@@ -1530,32 +1783,47 @@ output(const uip_lladdr_t *localdest)
         /* last fragment */
         rime_payload_len = uip_len - processed_ip_out_len;
       }
+#if SICSLOWPAN_FRAG_BURST
+      if(frag_bursting) {
+        packetbuf_set_attr(PACKETBUF_ATTR_PENDING,
+                           processed_ip_out_len + rime_payload_len < uip_len);
+      }
+#endif /* SICSLOWPAN_FRAG_BURST */
       PRINTFO("(offset %d, len %d, tag %d)\n",
              processed_ip_out_len >> 3, rime_payload_len, my_tag);
       memcpy(rime_ptr + rime_hdr_len,
              (uint8_t *)UIP_IP_BUF + processed_ip_out_len, rime_payload_len);
       packetbuf_set_datalen(rime_payload_len + rime_hdr_len);
-      q = queuebuf_new_from_packetbuf();
-      if(q == NULL) {
+      if(!send_fragment(&dest)) {
         PRINTFO("could not allocate queuebuf, dropping fragment\n");
+        RIMESTATS_ADD(lowpandrop);
+#if SICSLOWPAN_FRAG_BURST
+        end_burst(0);
+#endif /* SICSLOWPAN_FRAG_BURST */
         return 0;
       }
-      send_packet(&dest);
-      queuebuf_to_packetbuf(q);
-      queuebuf_free(q);
-      q = NULL;
       processed_ip_out_len += rime_payload_len;
 
       /* Check tx result. */
-      if((last_tx_status == MAC_TX_COLLISION) ||
-         (last_tx_status == MAC_TX_ERR) ||
-         (last_tx_status == MAC_TX_ERR_FATAL)) {
+      if(!frag_bursting &&
+         ((last_tx_status == MAC_TX_COLLISION) ||
+          (last_tx_status == MAC_TX_ERR) ||
+          (last_tx_status == MAC_TX_ERR_FATAL))) {
         PRINTFO("error in fragment tx, dropping subsequent fragments.\n");
+        RIMESTATS_ADD(lowpandrop);
         return 0;
       }
     }
+#if SICSLOWPAN_FRAG_BURST
+    if(frag_bursting) {
+      PRINTFO("sicslowpan output: sending %d fragments in a burst\n",
+              frag_burst_len);
+      end_burst(1);
+    }
+#endif /* SICSLOWPAN_FRAG_BURST */
 #else /* SICSLOWPAN_CONF_FRAG */
     PRINTFO("sicslowpan output: Packet too large to be sent without fragmentation support; dropping packet\n");
+    RIMESTATS_ADD(lowpandrop);
     return 0;
 #endif /* SICSLOWPAN_CONF_FRAG */
   } else {
@@ -1569,8 +1837,369 @@ output(const uip_lladdr_t *localdest)
     packetbuf_set_datalen(uip_len - uncomp_hdr_len + rime_hdr_len);
     send_packet(&dest);
   }
+  RIMESTATS_ADD(lowpantx);
+  return 1;
+}
+
+#if SICSLOWPAN_CONF_FRAG
+#if SICSLOWPAN_INPUT_QUEUE
+/*--------------------------------------------------------------------*/
+/** \brief Queues the complete packet in reass for uIP */
+static void
+input_enqueue(void)
+{
+  reass->queued = 1;
+  reass->processed = 0;
+  rimeaddr_copy(&reass->sender, packetbuf_addr(PACKETBUF_ADDR_SENDER));
+  reass->rssi = last_rssi;
+  input_queue[(input_queue_head + input_queue_len) %
+              SICSLOWPAN_REASS_CONTEXTS] = reass;
+  input_queue_len++;
+  RIMESTATS_ADD(lowpanrx);
+  process_poll(&sicslowpan_input_process);
+}
+/*--------------------------------------------------------------------*/
+PROCESS_THREAD(sicslowpan_input_process, ev, data)
+{
+  struct sicslowpan_reass *r;
+
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
+    if(input_queue_len == 0) {
+      continue;
+    }
+    r = input_queue[input_queue_head];
+    input_queue_head = (input_queue_head + 1) % SICSLOWPAN_REASS_CONTEXTS;
+    input_queue_len--;
+
+    memcpy(UIP_IP_BUF, &r->buf.u8[UIP_LLH_LEN], r->len);
+    uip_len = r->len;
+    r->len = 0;
+    r->queued = 0;
+
+    /* uIP and RPL look at the link layer sender of the packet */
+    packetbuf_clear();
+    packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &r->sender);
+    packetbuf_set_attr(PACKETBUF_ATTR_RSSI, r->rssi);
+    last_rssi = r->rssi;
+
+    tcpip_input();
+
+    /* one packet per poll, so that the radio gets its turn */
+    if(input_queue_len > 0) {
+      process_poll(&sicslowpan_input_process);
+    }
+  }
+
+  PROCESS_END();
+}
+#endif /* SICSLOWPAN_INPUT_QUEUE */
+/*--------------------------------------------------------------------*/
+/** \brief Frees the reassembly contexts that timed out */
+static void
+reass_expire(void)
+{
+  struct sicslowpan_reass *r;
+
+  for(r = reass_contexts; r < &reass_contexts[SICSLOWPAN_REASS_CONTEXTS]; r++) {
+    if(r->processed > 0 && timer_expired(&r->timer)) {
+      PRINTFI("sicslowpan input: reassembly of tag %u timed out\n", r->tag);
+      RIMESTATS_ADD(lowpanreassfail);
+      r->len = 0;
+      r->processed = 0;
+    }
+  }
+}
+/*--------------------------------------------------------------------*/
+/** \brief Returns the context reassembling the datagram, NULL if none */
+static struct sicslowpan_reass *
+reass_lookup(const rimeaddr_t *sender, uint16_t tag, uint16_t size)
+{
+  struct sicslowpan_reass *r;
+
+  for(r = reass_contexts; r < &reass_contexts[SICSLOWPAN_REASS_CONTEXTS]; r++) {
+    if(r->processed > 0 && r->tag == tag && r->len == size &&
+       rimeaddr_cmp(&r->sender, sender)) {
+      return r;
+    }
+  }
+  return NULL;
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Returns an empty context for a new packet
+ * \param sender The sender of a first fragment, NULL for a packet that
+ * is not fragmented
+ *
+ * A datagram still being reassembled from the same sender is given up,
+ * senders transmit their datagrams one after the other. Otherwise a free
+ * context is used. If there is none, the oldest reassembly is discarded.
+ * Returns NULL if all contexts hold packets queued for uIP.
+ */
+static struct sicslowpan_reass *
+reass_alloc(const rimeaddr_t *sender)
+{
+  struct sicslowpan_reass *r, *found = NULL;
+
+  for(r = reass_contexts; r < &reass_contexts[SICSLOWPAN_REASS_CONTEXTS]; r++) {
+#if SICSLOWPAN_INPUT_QUEUE
+    if(r->queued) {
+      continue;
+    }
+#endif /* SICSLOWPAN_INPUT_QUEUE */
+    if(r->processed > 0 && sender != NULL && rimeaddr_cmp(&r->sender, sender)) {
+      found = r;
+      break;
+    }
+    if(found == NULL) {
+      found = r;
+    } else if(found->processed > 0 &&
+              (r->processed == 0 ||
+               timer_remaining(&r->timer) < timer_remaining(&found->timer))) {
+      found = r;
+    }
+  }
+#if SICSLOWPAN_INPUT_QUEUE
+  if(found == NULL) {
+    /* all packets wait for uIP */
+    return NULL;
+  }
+#endif /* SICSLOWPAN_INPUT_QUEUE */
+  if(found->processed > 0) {
+    PRINTFI("sicslowpan input: discarding reassembly of tag %u\n", found->tag);
+    RIMESTATS_ADD(lowpanreassfail);
+  }
+  found->len = 0;
+  found->processed = 0;
+  return found;
+}
+#endif /* SICSLOWPAN_CONF_FRAG */
+
+#if SICSLOWPAN_FAST_FORWARD
+/* Upper layer headers that may follow the forwarded headers */
+#define FAST_FORWARD_PROTO(p) ((p) == UIP_PROTO_TCP || (p) == UIP_PROTO_UDP || \
+                               (p) == UIP_PROTO_ICMP6)
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Forwards the IPHC packet in packetbuf without decompressing it
+ * \return 1 if the packet was forwarded, 0 if it needs the full path
+ *
+ * Only unicast packets with global addresses whose next hop is a
+ * reachable neighbor are handled. The hop limit is decremented and the
+ * addresses are compressed again for the next link, the traffic class,
+ * flow label, next header and payload are sent unchanged.
+ */
+static uint8_t
+fast_forward(void)
+{
+  /* IPHC, CID, TF, NH, HLIM and two inline addresses */
+  uint8_t hdr[2 + 1 + 4 + 1 + 1 + 16 + 16];
+  uint8_t iphc0, iphc1, tmp, ttl, fixed_len;
+  uint16_t old_len, hdr_len, rest_len;
+  uip_ipaddr_t src, dest;
+  uip_ipaddr_t *nexthop;
+  uip_ds6_route_t *route;
+  uip_ds6_nbr_t *nbr;
+  const uip_lladdr_t *lladdr;
+  struct sicslowpan_addr_context *ctx;
+#if UIP_CONF_IPV6_RPL
+  uint8_t *rest;
+  uip_ext_hdr_opt_rpl *opt;
+#endif /* UIP_CONF_IPV6_RPL */
+
+  if(callback != NULL || packetbuf_datalen() < 3 ||
+     (rime_ptr[0] & 0xe0) != SICSLOWPAN_DISPATCH_IPHC) {
+    return 0;
+  }
+  iphc0 = rime_ptr[0];
+  iphc1 = rime_ptr[1];
+  if(iphc1 & SICSLOWPAN_IPHC_M) {
+    return 0;
+  }
+
+  /* CID, traffic class, flow label and next header are kept as they are */
+  hc06_ptr = rime_ptr + 2;
+  if(iphc1 & SICSLOWPAN_IPHC_CID) {
+    hc06_ptr++;
+  }
+  if((iphc0 & SICSLOWPAN_IPHC_FL_C) == 0) {
+    hc06_ptr += (iphc0 & SICSLOWPAN_IPHC_TC_C) ? 3 : 4;
+  } else if((iphc0 & SICSLOWPAN_IPHC_TC_C) == 0) {
+    hc06_ptr++;
+  }
+  if(iphc0 & SICSLOWPAN_IPHC_NH_C) {
+#if UIP_CONF_IPV6_RPL
+    /* The hop-by-hop option is added on the full path */
+    return 0;
+#endif /* UIP_CONF_IPV6_RPL */
+  } else {
+    tmp = *hc06_ptr++;
+#if UIP_CONF_IPV6_RPL
+    if(tmp != UIP_PROTO_HBHO) {
+      return 0;
+    }
+#else /* UIP_CONF_IPV6_RPL */
+    if(!FAST_FORWARD_PROTO(tmp)) {
+      return 0;
+    }
+#endif /* UIP_CONF_IPV6_RPL */
+  }
+  fixed_len = hc06_ptr - rime_ptr;
+
+  if((iphc0 & 0x03) == SICSLOWPAN_IPHC_TTL_I) {
+    ttl = *hc06_ptr++;
+  } else {
+    ttl = PGM_READ_BYTE(&ttl_values[iphc0 & 0x03]);
+  }
+  if(ttl <= 1) {
+    return 0;
+  }
+
+  /* Source address, the unspecified and link-local ones stay local */
+  tmp = (iphc1 & SICSLOWPAN_IPHC_SAM_11) >> SICSLOWPAN_IPHC_SAM_BIT;
+  if(iphc1 & SICSLOWPAN_IPHC_SAC) {
+    ctx = addr_context_lookup_by_number(iphc1 & SICSLOWPAN_IPHC_CID ?
+                                        rime_ptr[2] >> 4 : 0);
+    if(tmp == 0 || ctx == NULL) {
+      return 0;
+    }
+    uncompress_addr(&src, ctx->prefix, PGM_READ_BYTE(&unc_ctxconf[tmp]),
+                    (uip_lladdr_t *)packetbuf_addr(PACKETBUF_ADDR_SENDER));
+  } else {
+    if(tmp != 0) {
+      return 0;
+    }
+    uncompress_addr(&src, llprefix, PGM_READ_BYTE(&unc_llconf[0]), NULL);
+    if(uip_is_addr_link_local(&src) || uip_is_addr_unspecified(&src)) {
+      return 0;
+    }
+  }
+
+  /* Destination address, addresses derived from our own link-layer
+     address are ours */
+  tmp = iphc1 & SICSLOWPAN_IPHC_DAM_11;
+  if(iphc1 & SICSLOWPAN_IPHC_DAC) {
+    ctx = addr_context_lookup_by_number(iphc1 & SICSLOWPAN_IPHC_CID ?
+                                        rime_ptr[2] & 0x0f : 0);
+    if(tmp == 0 || tmp == 3 || ctx == NULL) {
+      return 0;
+    }
+    uncompress_addr(&dest, ctx->prefix, PGM_READ_BYTE(&unc_ctxconf[tmp]), NULL);
+  } else {
+    if(tmp != 0) {
+      return 0;
+    }
+    uncompress_addr(&dest, llprefix, PGM_READ_BYTE(&unc_llconf[0]), NULL);
+    if(uip_is_addr_link_local(&dest) || uip_is_addr_mcast(&dest) ||
+       uip_is_addr_loopback(&dest)) {
+      return 0;
+    }
+  }
+  if(uip_ds6_is_my_addr(&dest)) {
+    return 0;
+  }
+
+  old_len = hc06_ptr - rime_ptr;
+  if(old_len > packetbuf_datalen()) {
+    return 0;
+  }
+  rest_len = packetbuf_datalen() - old_len;
+
+#if UIP_CONF_IPV6_RPL
+  rest = hc06_ptr;
+  /* Only a hop-by-hop header with the RPL option directly in front of
+     the upper layer header */
+  if(rest_len < 2 + sizeof(uip_ext_hdr_opt_rpl) || rest[1] != 0 ||
+     !FAST_FORWARD_PROTO(rest[0])) {
+    return 0;
+  }
+  opt = (uip_ext_hdr_opt_rpl *)&rest[2];
+#endif /* UIP_CONF_IPV6_RPL */
+
+  /* Next hop, as in tcpip_ipv6_output() */
+  if(uip_ds6_is_addr_onlink(&dest)) {
+    nexthop = &dest;
+  } else if((route = uip_ds6_route_lookup(&dest)) != NULL) {
+    nexthop = uip_ds6_route_nexthop(route);
+  } else {
+    nexthop = uip_ds6_defrt_choose();
+  }
+  if(nexthop == NULL || (nbr = uip_ds6_nbr_lookup(nexthop)) == NULL) {
+    return 0;
+  }
+#if UIP_ND6_SEND_NA
+  if(nbr->state != NBR_REACHABLE) {
+    return 0;
+  }
+#endif /* UIP_ND6_SEND_NA */
+  lladdr = uip_ds6_nbr_get_ll(nbr);
+  if(lladdr == NULL ||
+     rimeaddr_cmp((rimeaddr_t *)lladdr, packetbuf_addr(PACKETBUF_ADDR_SENDER))) {
+    return 0;
+  }
+
+  /* Build the new header, the source is compressed against our own
+     link-layer address and the destination against the next hop's */
+  memcpy(hdr, rime_ptr, fixed_len);
+  hc06_ptr = hdr + fixed_len;
+  hdr[0] = iphc0 & ~0x03;
+  hdr[1] = iphc1 & (SICSLOWPAN_IPHC_CID | SICSLOWPAN_IPHC_SAC |
+                    SICSLOWPAN_IPHC_DAC);
+  ttl--;
+  if(ttl == 1) {
+    hdr[0] |= SICSLOWPAN_IPHC_TTL_1;
+  } else if(ttl == 64) {
+    hdr[0] |= SICSLOWPAN_IPHC_TTL_64;
+  } else {
+    *hc06_ptr++ = ttl;
+  }
+  if(iphc1 & SICSLOWPAN_IPHC_SAC) {
+    hdr[1] |= compress_addr_64(SICSLOWPAN_IPHC_SAM_BIT, &src, &uip_lladdr);
+  } else {
+    memcpy(hc06_ptr, &src, 16);
+    hc06_ptr += 16;
+  }
+  if(iphc1 & SICSLOWPAN_IPHC_DAC) {
+    hdr[1] |= compress_addr_64(SICSLOWPAN_IPHC_DAM_BIT, &dest,
+                               (uip_lladdr_t *)lladdr);
+  } else {
+    memcpy(hc06_ptr, &dest, 16);
+    hc06_ptr += 16;
+  }
+  hdr_len = hc06_ptr - hdr;
+
+  /* A header that grows must still fit the largest MAC header */
+  if(hdr_len > old_len &&
+     hdr_len + rest_len > MAC_MAX_PAYLOAD - 21) {
+    return 0;
+  }
+
+#if UIP_CONF_IPV6_RPL
+  if(rpl_fast_forward_option(opt, &dest)) {
+    return 0;
+  }
+#endif /* UIP_CONF_IPV6_RPL */
+
+  PRINTFI("sicslowpan input: fast forwarding to ");
+  PRINTLLADDR(lladdr);
+  PRINTFI("\n");
+
+  packetbuf_compact();
+  rime_ptr = packetbuf_dataptr();
+  memmove(rime_ptr + hdr_len, rime_ptr + old_len, rest_len);
+  memcpy(rime_ptr, hdr, hdr_len);
+  packetbuf_set_datalen(hdr_len + rest_len);
+
+  packetbuf_attr_clear();
+  packetbuf_set_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
+                     SICSLOWPAN_MAX_MAC_TRANSMISSIONS);
+  UIP_STAT(++uip_stat.ip.forwarded);
+  send_packet((rimeaddr_t *)lladdr);
   return 1;
 }
+#endif /* SICSLOWPAN_FAST_FORWARD */
 
 /*--------------------------------------------------------------------*/
 /** \brief Process a received 6lowpan packet.
@@ -1609,12 +2238,15 @@ input(void)
   /* Save the RSSI of the incoming packet in case the upper layer will
      want to query us for it later. */
   last_rssi = (signed short)packetbuf_attr(PACKETBUF_ATTR_RSSI);
-#if SICSLOWPAN_CONF_FRAG
-  /* if reassembly timed out, cancel it */
-  if(timer_expired(&reass_timer)) {
-    sicslowpan_len = 0;
-    processed_ip_in_len = 0;
+  link_stats_input_callback(packetbuf_addr(PACKETBUF_ADDR_SENDER));
+#if SICSLOWPAN_FAST_FORWARD
+  if(fast_forward()) {
+    return;
   }
+#endif /* SICSLOWPAN_FAST_FORWARD */
+#if SICSLOWPAN_CONF_FRAG
+  /* cancel the reassemblies that timed out */
+  reass_expire();
   /*
    * Since we don't support the mesh and broadcast header, the first header
    * we look for is the fragmentation header
@@ -1633,6 +2265,7 @@ input(void)
       /*      printf("frag1 %d %d\n", reass_tag, frag_tag);*/
       first_fragment = 1;
       is_fragment = 1;
+      RIMESTATS_ADD(lowpanfragrx);
       break;
     case SICSLOWPAN_DISPATCH_FRAGN:
       /*
@@ -1646,76 +2279,62 @@ input(void)
       PRINTFI("size %d, tag %d, offset %d)\n",
              frag_size, frag_tag, frag_offset);
       rime_hdr_len += SICSLOWPAN_FRAGN_HDR_LEN;
-
-      /* If this is the last fragment, we may shave off any extrenous
-         bytes at the end. We must be liberal in what we accept. */
-      PRINTFI("last_fragment?: processed_ip_in_len %d rime_payload_len %d frag_size %d\n",
-              processed_ip_in_len, packetbuf_datalen() - rime_hdr_len, frag_size);
-
-      if(processed_ip_in_len + packetbuf_datalen() - rime_hdr_len >= frag_size) {
-        last_fragment = 1;
-      }
       is_fragment = 1;
+      RIMESTATS_ADD(lowpanfragrx);
       break;
     default:
       break;
   }
 
-  /* We are currently reassembling a packet, but have just received the first
-   * fragment of another packet. We can either ignore it and hope to receive
-   * the rest of the under-reassembly packet fragments, or we can discard the
-   * previous packet altogether, and start reassembling the new packet.
-   *
-   * We discard the previous packet, and start reassembling the new packet.
-   * This lessens the negative impacts of too high SICSLOWPAN_REASS_MAXAGE.
-   */
-#define PRIORITIZE_NEW_PACKETS 1
-#if PRIORITIZE_NEW_PACKETS
-
   if(!is_fragment) {
-    /* Prioritize non-fragment packets too. */
-    sicslowpan_len = 0;
-    processed_ip_in_len = 0;
-  } else if(processed_ip_in_len > 0 && first_fragment
-      && !rimeaddr_cmp(&frag_sender, packetbuf_addr(PACKETBUF_ADDR_SENDER))) {
-    sicslowpan_len = 0;
-    processed_ip_in_len = 0;
-  }
-#endif /* PRIORITIZE_NEW_PACKETS */
-
-  if(processed_ip_in_len > 0) {
-    /* reassembly is ongoing */
-    /*    printf("frag %d %d\n", reass_tag, frag_tag);*/
-    if((frag_size > 0 &&
-        (frag_size != sicslowpan_len ||
-         reass_tag  != frag_tag ||
-         !rimeaddr_cmp(&frag_sender, packetbuf_addr(PACKETBUF_ADDR_SENDER))))  ||
-       frag_size == 0) {
-      /*
-       * the packet is a fragment that does not belong to the packet
-       * being reassembled or the packet is not a fragment.
-       */
-      PRINTFI("sicslowpan input: Dropping 6lowpan packet that is not a fragment of the packet currently being reassembled\n");
+    /* Decompressed in a free context, the reassemblies go on */
+    reass = reass_alloc(NULL);
+    if(reass == NULL) {
+      PRINTFI("sicslowpan input: no buffer, dropping packet\n");
+      RIMESTATS_ADD(lowpandrop);
       return;
     }
-  } else {
+  } else if(frag_size == 0 || frag_size > UIP_BUFSIZE) {
+    PRINTFI("sicslowpan input: Dropping fragment of size %d\n", frag_size);
+    RIMESTATS_ADD(lowpandrop);
+    return;
+  } else if(first_fragment) {
     /*
-     * reassembly is off
-     * start it if we received a fragment
+     * Start the reassembly. This also starts over if the first fragment
+     * of the datagram is received again.
      */
-    if((frag_size > 0) && (frag_size <= UIP_BUFSIZE)) {
-      /* We are currently not reassembling a packet, but have received a packet fragment
-       * that is not the first one. */
-      if(is_fragment && !first_fragment) {
-        return;
-      }
+    reass = reass_alloc(packetbuf_addr(PACKETBUF_ADDR_SENDER));
+    if(reass == NULL) {
+      PRINTFI("sicslowpan input: no buffer, dropping fragment\n");
+      RIMESTATS_ADD(lowpandrop);
+      return;
+    }
+    sicslowpan_len = frag_size;
+    reass->tag = frag_tag;
+    timer_set(&reass->timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
+    PRINTFI("sicslowpan input: INIT FRAGMENTATION (len %d, tag %d)\n",
+           sicslowpan_len, reass->tag);
+    rimeaddr_copy(&reass->sender, packetbuf_addr(PACKETBUF_ADDR_SENDER));
+  } else {
+    reass = reass_lookup(packetbuf_addr(PACKETBUF_ADDR_SENDER), frag_tag,
+                         frag_size);
+    if(reass == NULL) {
+      /*
+       * We are not reassembling the datagram, its first fragment was
+       * lost or the reassembly timed out.
+       */
+      PRINTFI("sicslowpan input: Dropping 6lowpan packet that is not a fragment of a packet being reassembled\n");
+      RIMESTATS_ADD(lowpandrop);
+      return;
+    }
+
+    /* If this is the last fragment, we may shave off any extrenous
+       bytes at the end. We must be liberal in what we accept. */
+    PRINTFI("last_fragment?: processed_ip_in_len %d rime_payload_len %d frag_size %d\n",
+            processed_ip_in_len, packetbuf_datalen() - rime_hdr_len, frag_size);
 
-      sicslowpan_len = frag_size;
-      reass_tag = frag_tag;
-      timer_set(&reass_timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
-      PRINTFI("sicslowpan input: INIT FRAGMENTATION (len %d, tag %d)\n",
-             sicslowpan_len, reass_tag);
-      rimeaddr_copy(&frag_sender, packetbuf_addr(PACKETBUF_ADDR_SENDER));
+    if(processed_ip_in_len + packetbuf_datalen() - rime_hdr_len >= frag_size) {
+      last_fragment = 1;
     }
   }
 
@@ -1754,6 +2373,7 @@ input(void)
       /* unknown header */
       PRINTFI("sicslowpan input: unknown dispatch: %u\n",
              RIME_HC1_PTR[RIME_HC1_DISPATCH]);
+      RIMESTATS_ADD(lowpandrop);
       return;
   }
    
@@ -1770,6 +2390,7 @@ input(void)
    */
   if(packetbuf_datalen() < rime_hdr_len) {
     PRINTF("SICSLOWPAN: packet dropped due to header > total packet\n");
+    RIMESTATS_ADD(lowpandrop);
     return;
   }
   rime_payload_len = packetbuf_datalen() - rime_hdr_len;
@@ -1783,6 +2404,7 @@ input(void)
           "SICSLOWPAN: packet dropped, minimum required SICSLOWPAN_IP_BUF size: %d+%d+%d+%d=%d (current size: %d)\n",
           UIP_LLH_LEN, uncomp_hdr_len, (uint16_t)(frag_offset << 3),
           rime_payload_len, req_size, sizeof(sicslowpan_buf));
+      RIMESTATS_ADD(lowpandrop);
       return;
     }
   }
@@ -1821,6 +2443,13 @@ input(void)
   if(processed_ip_in_len == 0 || (processed_ip_in_len == sicslowpan_len)) {
     PRINTFI("sicslowpan input: IP packet ready (length %d)\n",
            sicslowpan_len);
+#if SICSLOWPAN_INPUT_QUEUE
+    /* the sniffer expects the packet in uip_buf */
+    if(callback == NULL) {
+      input_enqueue();
+      return;
+    }
+#endif /* SICSLOWPAN_INPUT_QUEUE */
     memcpy((uint8_t *)UIP_IP_BUF, (uint8_t *)SICSLOWPAN_IP_BUF, sicslowpan_len);
     uip_len = sicslowpan_len;
     sicslowpan_len = 0;
@@ -1845,6 +2474,7 @@ input(void)
       callback->input_callback();
     }
 
+    RIMESTATS_ADD(lowpanrx);
     tcpip_input();
 #if SICSLOWPAN_CONF_FRAG
   }
@@ -1864,6 +2494,10 @@ sicslowpan_init(void)
    */
   tcpip_set_outputfunc(output);
 
+#if SICSLOWPAN_INPUT_QUEUE
+  process_start(&sicslowpan_input_process, NULL);
+#endif /* SICSLOWPAN_INPUT_QUEUE */
+
 #if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06
 /* Preinitialize any address contexts for better header compression
  * (Saves up to 13 bytes per 6lowpan packet)
@@ -1907,9 +2541,60 @@ sicslowpan_init(void)
   }
 #endif /* SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 1 */
 
+#if SICSLOWPAN_DYNAMIC_CONTEXTS > 0
+  memset(&addr_contexts[SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS], 0,
+         SICSLOWPAN_DYNAMIC_CONTEXTS * sizeof(struct sicslowpan_addr_context));
+#endif /* SICSLOWPAN_DYNAMIC_CONTEXTS > 0 */
+
 #endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06 */
 }
 /*--------------------------------------------------------------------*/
+#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06 && SICSLOWPAN_DYNAMIC_CONTEXTS > 0
+int
+sicslowpan_set_context(uint8_t number, const uip_ipaddr_t *prefix)
+{
+  struct sicslowpan_addr_context *found;
+  int i;
+
+  found = NULL;
+  for(i = 0; i < SICSLOWPAN_ADDR_CONTEXTS; i++) {
+    if(addr_contexts[i].used == 1 && addr_contexts[i].number == number) {
+      if(i < SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS) {
+        /* Static contexts are never replaced */
+        return 0;
+      }
+      found = &addr_contexts[i];
+    } else if(found == NULL && addr_contexts[i].used == 0 &&
+              i >= SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS) {
+      found = &addr_contexts[i];
+    }
+  }
+  if(found == NULL) {
+    return 0;
+  }
+
+  PRINTF("sicslowpan: context %u set to ", number);
+  PRINT6ADDR(prefix);
+  PRINTF("\n");
+  found->number = number;
+  memcpy(found->prefix, prefix, sizeof(found->prefix));
+  found->used = 1;
+  return 1;
+}
+/*--------------------------------------------------------------------*/
+void
+sicslowpan_remove_context(uint8_t number)
+{
+  int i;
+
+  for(i = SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS; i < SICSLOWPAN_ADDR_CONTEXTS; i++) {
+    if(addr_contexts[i].used == 1 && addr_contexts[i].number == number) {
+      addr_contexts[i].used = 0;
+    }
+  }
+}
+#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06 && SICSLOWPAN_DYNAMIC_CONTEXTS > 0 */
+/*--------------------------------------------------------------------*/
 int
 sicslowpan_get_last_rssi(void)
 {
@@ -1921,6 +2606,10 @@ const struct network_driver sicslowpan_driver = {
   sicslowpan_init,
   input
 };
+#if NETSTACK_CONF_STATIC
+NETSTACK_STATIC_EXPORT(sicslowpan_driver_init, sicslowpan_init);
+NETSTACK_STATIC_EXPORT(sicslowpan_driver_input, input);
+#endif /* NETSTACK_CONF_STATIC */
 /*--------------------------------------------------------------------*/
 /** @} */
 #endif /* UIP_CONF_IPV6 */
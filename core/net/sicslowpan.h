@@ -319,6 +319,23 @@ struct sicslowpan_nh_compressor {
 
 int sicslowpan_get_last_rssi(void);
 
+/**
+ * \brief Sets a run-time address context, see SICSLOWPAN_CONF_DYNAMIC_CONTEXTS
+ * \param number The context number carried in the CID byte, 0-15
+ * \param prefix The address whose first 64 bits are the context prefix
+ * \return 1 if the context was set, 0 if the number belongs to a static
+ *         context or all slots are taken
+ *
+ * All nodes on the link must use the same contexts, or the addresses
+ * cannot be decompressed.
+ */
+int sicslowpan_set_context(uint8_t number, const uip_ipaddr_t *prefix);
+
+/**
+ * \brief Removes a context set by sicslowpan_set_context()
+ */
+void sicslowpan_remove_context(uint8_t number);
+
 extern const struct network_driver sicslowpan_driver;
 
 #endif /* SICSLOWPAN_H_ */
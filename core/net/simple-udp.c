@@ -141,6 +141,92 @@ simple_udp_sendto_port(struct simple_udp_connection *c,
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+static void
+batch_timeout(void *ptr)
+{
+  simple_udp_batch_flush(ptr);
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Set up a batch of records for one destination
+ * \param b    A pointer to a struct simple_udp_batch
+ * \param c    The connection the batch is sent with
+ * \param to   The IP address of the receiver
+ * \param to_port The UDP port of the receiver, in host byte order
+ * \param buf  The buffer the records are collected in
+ * \param size The size of buf, the largest datagram the batch sends
+ * \param max_delay The longest time a record waits in the batch
+ *
+ *             The batch keeps pointers to c and buf, both must stay
+ *             valid as long as the batch is used. A size that lets
+ *             the datagram fit into a single radio frame saves the
+ *             most airtime.
+ *
+ * \sa simple_udp_batch_add()
+ */
+void
+simple_udp_batch_init(struct simple_udp_batch *b,
+                      struct simple_udp_connection *c,
+                      const uip_ipaddr_t *to, uint16_t to_port,
+                      uint8_t *buf, uint16_t size,
+                      clock_time_t max_delay)
+{
+  b->c = c;
+  uip_ipaddr_copy(&b->to, to);
+  b->to_port = to_port;
+  b->buf = buf;
+  b->size = size;
+  b->len = 0;
+  b->max_delay = max_delay;
+  ctimer_stop(&b->timer);
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Add a record to a batch
+ * \param b    A pointer to a struct simple_udp_batch
+ * \param data A pointer to the record
+ * \param datalen The length of the record
+ * \retval 0   If the record is larger than the batch
+ * \retval 1   If the record was added
+ *
+ *             The batch is sent first if the record does not fit in
+ *             anymore. The first record of a batch starts the
+ *             max_delay timer.
+ */
+int
+simple_udp_batch_add(struct simple_udp_batch *b,
+                     const void *data, uint16_t datalen)
+{
+  if(datalen > b->size) {
+    return 0;
+  }
+  if(b->len + datalen > b->size) {
+    simple_udp_batch_flush(b);
+  }
+  if(b->len == 0) {
+    ctimer_set(&b->timer, b->max_delay, batch_timeout, b);
+  }
+  memcpy(b->buf + b->len, data, datalen);
+  b->len += datalen;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Send the records of a batch now
+ * \param b    A pointer to a struct simple_udp_batch
+ *
+ *             Nothing is sent if the batch is empty.
+ */
+void
+simple_udp_batch_flush(struct simple_udp_batch *b)
+{
+  ctimer_stop(&b->timer);
+  if(b->len > 0) {
+    simple_udp_sendto_port(b->c, b->buf, b->len, &b->to, b->to_port);
+    b->len = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
 /**
  * \brief      Register a UDP connection
  * \param c    A pointer to a struct simple_udp_connection
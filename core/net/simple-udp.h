@@ -54,6 +54,7 @@
 #define SIMPLE_UDP_H
 
 #include "net/uip.h"
+#include "sys/ctimer.h"
 
 struct simple_udp_connection;
 
@@ -92,6 +93,33 @@ int simple_udp_sendto_port(struct simple_udp_connection *c,
 
 void simple_udp_init(void);
 
+/**
+ * A batch collects small records for one destination and sends them
+ * as one UDP datagram, when the next record does not fit or when
+ * max_delay has passed since the first record. The records are sent
+ * back to back, the receiver must be able to tell them apart.
+ */
+struct simple_udp_batch {
+  struct simple_udp_connection *c;
+  uip_ipaddr_t to;
+  uint16_t to_port;
+  uint8_t *buf;
+  uint16_t size, len;
+  clock_time_t max_delay;
+  struct ctimer timer;
+};
+
+void simple_udp_batch_init(struct simple_udp_batch *b,
+                           struct simple_udp_connection *c,
+                           const uip_ipaddr_t *to, uint16_t to_port,
+                           uint8_t *buf, uint16_t size,
+                           clock_time_t max_delay);
+
+int simple_udp_batch_add(struct simple_udp_batch *b,
+                         const void *data, uint16_t datalen);
+
+void simple_udp_batch_flush(struct simple_udp_batch *b);
+
 #endif /* SIMPLE_UDP_H */
 
 /** @} */
@@ -163,6 +163,18 @@ start_periodic_tcp_timer(void)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if UIP_TCP_WINDOW > 1
+static void
+poll_tcp_window(struct uip_conn *conn)
+{
+  /* Let the application fill the send window right away instead of
+     at the next periodic poll. */
+  if(conn != NULL && uip_tcp_window_ready(conn)) {
+    tcpip_poll_tcp(conn);
+  }
+}
+#endif /* UIP_TCP_WINDOW > 1 */
+/*---------------------------------------------------------------------------*/
 static void
 check_for_tcp_syn(void)
 {
@@ -221,6 +233,9 @@ packet_input(void)
 #endif
 #endif /* UIP_CONF_TCP_SPLIT */
     }
+#if UIP_TCP_WINDOW > 1
+    poll_tcp_window(uip_conn);
+#endif /* UIP_TCP_WINDOW > 1 */
   }
 #endif /* UIP_CONF_IP_FORWARD */
 }
@@ -436,6 +451,9 @@ eventhandler(process_event_t ev, process_data_t data)
               uip_periodic(i);
 #if UIP_CONF_IPV6
               tcpip_ipv6_output();
+#if UIP_TCP_WINDOW > 1
+              poll_tcp_window(&uip_conns[i]);
+#endif /* UIP_TCP_WINDOW > 1 */
 #else
               if(uip_len > 0) {
 		PRINTF("tcpip_output from periodic len %d\n", uip_len);
@@ -493,6 +511,9 @@ eventhandler(process_event_t ev, process_data_t data)
         uip_poll_conn(data);
 #if UIP_CONF_IPV6
         tcpip_ipv6_output();
+#if UIP_TCP_WINDOW > 1
+        poll_tcp_window(data);
+#endif /* UIP_TCP_WINDOW > 1 */
 #else /* UIP_CONF_IPV6 */
         if(uip_len > 0) {
 	  PRINTF("tcpip_output from tcp poll len %d\n", uip_len);
@@ -541,6 +562,9 @@ tcpip_ipv6_output(void)
 {
   uip_ds6_nbr_t *nbr = NULL;
   uip_ipaddr_t *nexthop;
+#if UIP_CONF_IPV6_RPL
+  uip_ipaddr_t srh_nexthop;
+#endif /* UIP_CONF_IPV6_RPL */
 
   if(uip_len == 0) {
     return;
@@ -562,6 +586,17 @@ tcpip_ipv6_output(void)
     /* Next hop determination */
     nbr = NULL;
 
+#if UIP_CONF_IPV6_RPL
+    /* The root of a non-storing RPL network source routes the packet,
+       the next hop is then the new destination. */
+    if(rpl_srh_insert()) {
+      uip_len = 0;
+      return;
+    }
+    if(rpl_srh_get_next_hop(&srh_nexthop)) {
+      nexthop = &srh_nexthop;
+    } else
+#endif /* UIP_CONF_IPV6_RPL */
     /* We first check if the destination address is on our immediate
        link. If so, we simply use the destination address as our
        nexthop address. */
@@ -575,6 +610,11 @@ tcpip_ipv6_output(void)
       /* No route was found - we send to the default route instead. */
       if(route == NULL) {
         PRINTF("tcpip_ipv6_output: no route found, using default route\n");
+#if UIP_CONF_IPV6_RPL
+        /* The RPL instance of the traffic class routes it upwards */
+        nexthop = rpl_get_tclass_nexthop();
+        if(nexthop == NULL)
+#endif /* UIP_CONF_IPV6_RPL */
         nexthop = uip_ds6_defrt_choose();
         if(nexthop == NULL) {
 #ifdef UIP_FALLBACK_INTERFACE
@@ -674,6 +714,7 @@ tcpip_ipv6_output(void)
         }
 
         stimer_set(&nbr->sendns, uip_ds6_if.retrans_timer / 1000);
+        uip_ds6_schedule_stimer(&nbr->sendns);
         nbr->nscount = 1;
       }
 #endif /* UIP_ND6_SEND_NA */
@@ -697,6 +738,7 @@ tcpip_ipv6_output(void)
       if(nbr->state == NBR_STALE) {
         nbr->state = NBR_DELAY;
         stimer_set(&nbr->reachable, UIP_ND6_DELAY_FIRST_PROBE_TIME);
+        uip_ds6_schedule_stimer(&nbr->reachable);
         nbr->nscount = 0;
         PRINTF("tcpip_ipv6_output: nbr cache entry stale moving to delay\n");
       }
@@ -795,6 +837,9 @@ tcpip_uipcall(void)
 PROCESS_THREAD(tcpip_process, ev, data)
 {
   PROCESS_BEGIN();
+
+  /* Only handles events posted to it */
+  process_ignore_broadcasts();
   
 #if UIP_TCP
  {
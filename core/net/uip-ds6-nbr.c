@@ -191,6 +191,23 @@ uip_ds6_nbr_lladdr_from_ipaddr(const uip_ipaddr_t *ipaddr)
 }
 /*---------------------------------------------------------------------------*/
 void
+uip_ds6_nbr_confirm_reachable(uip_ds6_nbr_t *nbr)
+{
+  if(nbr == NULL || nbr->state == NBR_INCOMPLETE) {
+    return;
+  }
+  if(nbr->state != NBR_REACHABLE) {
+    PRINTF("uip-ds6-neighbor : ");
+    PRINT6ADDR(&nbr->ipaddr);
+    PRINTF(" confirmed reachable.\n");
+  }
+  nbr->state = NBR_REACHABLE;
+  nbr->nscount = 0;
+  stimer_set(&nbr->reachable, UIP_ND6_REACHABLE_TIME / 1000);
+  uip_ds6_schedule_stimer(&nbr->reachable);
+}
+/*---------------------------------------------------------------------------*/
+void
 uip_ds6_link_neighbor_callback(int status, int numtx)
 {
   const rimeaddr_t *dest = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
@@ -202,17 +219,8 @@ uip_ds6_link_neighbor_callback(int status, int numtx)
 
 #if UIP_DS6_LL_NUD
   if(status == MAC_TX_OK) {
-    uip_ds6_nbr_t *nbr;
-    nbr = uip_ds6_nbr_ll_lookup((uip_lladdr_t *)dest);
-    if(nbr != NULL &&
-        (nbr->state == NBR_STALE || nbr->state == NBR_DELAY ||
-         nbr->state == NBR_PROBE)) {
-      nbr->state = NBR_REACHABLE;
-      stimer_set(&nbr->reachable, UIP_ND6_REACHABLE_TIME / 1000);
-      PRINTF("uip-ds6-neighbor : received a link layer ACK : ");
-      PRINTLLADDR((uip_lladdr_t *)dest);
-      PRINTF(" is reachable.\n");
-    }
+    /* also keeps REACHABLE entries from going STALE */
+    uip_ds6_nbr_confirm_reachable(uip_ds6_nbr_ll_lookup((uip_lladdr_t *)dest));
   }
 #endif /* UIP_DS6_LL_NUD */
 
@@ -231,18 +239,23 @@ uip_ds6_neighbor_periodic(void)
         PRINT6ADDR(&nbr->ipaddr);
         PRINTF(")\n");
         nbr->state = NBR_STALE;
+      } else {
+        uip_ds6_schedule_stimer(&nbr->reachable);
       }
       break;
 #if UIP_ND6_SEND_NA
     case NBR_INCOMPLETE:
       if(nbr->nscount >= UIP_ND6_MAX_MULTICAST_SOLICIT) {
         uip_ds6_nbr_rm(nbr);
+        break;
       } else if(stimer_expired(&nbr->sendns) && (uip_len == 0)) {
         nbr->nscount++;
         PRINTF("NBR_INCOMPLETE: NS %u\n", nbr->nscount);
         uip_nd6_ns_output(NULL, NULL, &nbr->ipaddr);
         stimer_set(&nbr->sendns, uip_ds6_if.retrans_timer / 1000);
       }
+      /* Also retries an NS that was held back by a pending packet */
+      uip_ds6_schedule_stimer(&nbr->sendns);
       break;
     case NBR_DELAY:
       if(stimer_expired(&nbr->reachable)) {
@@ -250,6 +263,9 @@ uip_ds6_neighbor_periodic(void)
         nbr->nscount = 0;
         PRINTF("DELAY: moving to PROBE\n");
         stimer_set(&nbr->sendns, 0);
+        uip_ds6_schedule(0);
+      } else {
+        uip_ds6_schedule_stimer(&nbr->reachable);
       }
       break;
     case NBR_PROBE:
@@ -262,12 +278,14 @@ uip_ds6_neighbor_periodic(void)
           }
         }
         uip_ds6_nbr_rm(nbr);
+        break;
       } else if(stimer_expired(&nbr->sendns) && (uip_len == 0)) {
         nbr->nscount++;
         PRINTF("PROBE: NS %u\n", nbr->nscount);
         uip_nd6_ns_output(NULL, &nbr->ipaddr, &nbr->ipaddr);
         stimer_set(&nbr->sendns, uip_ds6_if.retrans_timer / 1000);
       }
+      uip_ds6_schedule_stimer(&nbr->sendns);
       break;
 #endif /* UIP_ND6_SEND_NA */
     default:
@@ -93,6 +93,16 @@ uip_ds6_nbr_t *uip_ds6_nbr_ll_lookup(const uip_lladdr_t *lladdr);
 uip_ipaddr_t *uip_ds6_nbr_ipaddr_from_lladdr(const uip_lladdr_t *lladdr);
 const uip_lladdr_t *uip_ds6_nbr_lladdr_from_ipaddr(const uip_ipaddr_t *ipaddr);
 void uip_ds6_link_neighbor_callback(int status, int numtx);
+
+/**
+ * \brief Upper-layer reachability confirmation (RFC 4861, 7.3.1)
+ *
+ * Marks the neighbor REACHABLE for another ReachableTime, e.g. after a
+ * link-layer ACK from it, so that NUD sends no NS while the hints keep
+ * coming. INCOMPLETE entries are left alone, they have no link-layer
+ * address yet.
+ */
+void uip_ds6_nbr_confirm_reachable(uip_ds6_nbr_t *nbr);
 void uip_ds6_neighbor_periodic(void);
 int uip_ds6_nbr_num(void);
 
@@ -65,12 +65,129 @@ LIST(notificationlist);
 
 static int num_routes = 0;
 
+#if UIP_DS6_ROUTE_HASH
+/* Host routes are found through an open-addressing hash table with
+   linear probing. A slot holds the index of the route in routememb
+   plus one, or 0 when empty. The table has at least twice as many
+   slots as there are routes to keep the probe sequences short. Prefix
+   routes are only counted, the route list is walked for them when no
+   host route matches. */
+#if UIP_DS6_ROUTE_NB > 127
+#error UIP_DS6_ROUTE_CONF_HASH supports up to 127 routes
+#endif
+#if UIP_DS6_ROUTE_NB <= 4
+#define HOST_HASH_SIZE 8
+#elif UIP_DS6_ROUTE_NB <= 8
+#define HOST_HASH_SIZE 16
+#elif UIP_DS6_ROUTE_NB <= 16
+#define HOST_HASH_SIZE 32
+#elif UIP_DS6_ROUTE_NB <= 32
+#define HOST_HASH_SIZE 64
+#elif UIP_DS6_ROUTE_NB <= 64
+#define HOST_HASH_SIZE 128
+#else
+#define HOST_HASH_SIZE 256
+#endif
+#define HOST_HASH_MASK (HOST_HASH_SIZE - 1)
+static uint8_t host_hash[HOST_HASH_SIZE];
+static int num_prefix_routes;
+
+/* Result of the last lookup, cleared whenever the table changes */
+static uip_ipaddr_t last_addr;
+static uip_ds6_route_t *last_route;
+#endif /* UIP_DS6_ROUTE_HASH */
+
 #undef DEBUG
 #define DEBUG DEBUG_NONE
 #include "net/uip-debug.h"
 
 static void rm_routelist_callback(nbr_table_item_t *ptr);
 /*---------------------------------------------------------------------------*/
+#if UIP_DS6_ROUTE_HASH
+static uint16_t
+host_hash_home(const uip_ipaddr_t *addr)
+{
+  /* The interface identifier tells the hosts of a prefix apart */
+  uint16_t h = addr->u16[4] ^ addr->u16[5] ^ addr->u16[6] ^ addr->u16[7];
+  h ^= h >> 8;
+  return (h ^ (h >> 5)) & HOST_HASH_MASK;
+}
+/*---------------------------------------------------------------------------*/
+static uip_ds6_route_t *
+route_from_slot(uint8_t slot)
+{
+  return (uip_ds6_route_t *)routememb.mem + (slot - 1);
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+slot_from_route(uip_ds6_route_t *r)
+{
+  return (r - (uip_ds6_route_t *)routememb.mem) + 1;
+}
+/*---------------------------------------------------------------------------*/
+static uip_ds6_route_t *
+host_hash_lookup(uip_ipaddr_t *addr)
+{
+  uint16_t i;
+  uip_ds6_route_t *r;
+
+  for(i = host_hash_home(addr); host_hash[i] != 0;
+      i = (i + 1) & HOST_HASH_MASK) {
+    r = route_from_slot(host_hash[i]);
+    if(uip_ipaddr_cmp(addr, &r->ipaddr)) {
+      return r;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_add(uip_ds6_route_t *r)
+{
+  uint16_t i;
+
+  last_route = NULL;
+  if(r->length < 128) {
+    num_prefix_routes++;
+    return;
+  }
+  for(i = host_hash_home(&r->ipaddr); host_hash[i] != 0;
+      i = (i + 1) & HOST_HASH_MASK);
+  host_hash[i] = slot_from_route(r);
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_rm(uip_ds6_route_t *r)
+{
+  uint16_t i, j, home;
+  uint8_t slot;
+
+  last_route = NULL;
+  if(r->length < 128) {
+    num_prefix_routes--;
+    return;
+  }
+  slot = slot_from_route(r);
+  for(i = host_hash_home(&r->ipaddr); host_hash[i] != slot;
+      i = (i + 1) & HOST_HASH_MASK) {
+    if(host_hash[i] == 0) {
+      return;
+    }
+  }
+  /* Move later entries of the probe sequence into the gap, so lookups
+     can stop at the first empty slot. */
+  for(j = (i + 1) & HOST_HASH_MASK; host_hash[j] != 0;
+      j = (j + 1) & HOST_HASH_MASK) {
+    home = host_hash_home(&route_from_slot(host_hash[j])->ipaddr);
+    if(((j - home) & HOST_HASH_MASK) >= ((j - i) & HOST_HASH_MASK)) {
+      host_hash[i] = host_hash[j];
+      i = j;
+    }
+  }
+  host_hash[i] = 0;
+}
+#endif /* UIP_DS6_ROUTE_HASH */
+/*---------------------------------------------------------------------------*/
 #if DEBUG != DEBUG_NONE
 static void
 assert_nbr_routes_list_sane(void)
@@ -141,6 +258,11 @@ uip_ds6_route_init(void)
 {
   memb_init(&routememb);
   list_init(routelist);
+#if UIP_DS6_ROUTE_HASH
+  memset(host_hash, 0, sizeof(host_hash));
+  num_prefix_routes = 0;
+  last_route = NULL;
+#endif /* UIP_DS6_ROUTE_HASH */
   nbr_table_register(nbr_routes,
                      (nbr_table_callback *)rm_routelist_callback);
 
@@ -195,18 +317,13 @@ uip_ds6_route_num_routes(void)
   return num_routes;
 }
 /*---------------------------------------------------------------------------*/
-uip_ds6_route_t *
-uip_ds6_route_lookup(uip_ipaddr_t *addr)
+static uip_ds6_route_t *
+longest_prefix_match(uip_ipaddr_t *addr)
 {
   uip_ds6_route_t *r;
   uip_ds6_route_t *found_route;
   uint8_t longestmatch;
 
-  PRINTF("uip-ds6-route: Looking up route for ");
-  PRINT6ADDR(addr);
-  PRINTF("\n");
-
-
   found_route = NULL;
   longestmatch = 0;
   for(r = uip_ds6_route_head();
@@ -218,6 +335,35 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
       found_route = r;
     }
   }
+  return found_route;
+}
+/*---------------------------------------------------------------------------*/
+uip_ds6_route_t *
+uip_ds6_route_lookup(uip_ipaddr_t *addr)
+{
+  uip_ds6_route_t *found_route;
+
+  PRINTF("uip-ds6-route: Looking up route for ");
+  PRINT6ADDR(addr);
+  PRINTF("\n");
+
+#if UIP_DS6_ROUTE_HASH
+  if(last_route != NULL && uip_ipaddr_cmp(addr, &last_addr)) {
+    found_route = last_route;
+  } else {
+    /* A host route is always the longest match */
+    found_route = host_hash_lookup(addr);
+    if(found_route == NULL && num_prefix_routes > 0) {
+      found_route = longest_prefix_match(addr);
+    }
+    if(found_route != NULL) {
+      uip_ipaddr_copy(&last_addr, addr);
+      last_route = found_route;
+    }
+  }
+#else /* UIP_DS6_ROUTE_HASH */
+  found_route = longest_prefix_match(addr);
+#endif /* UIP_DS6_ROUTE_HASH */
 
   if(found_route != NULL) {
     PRINTF("uip-ds6-route: Found route: ");
@@ -230,12 +376,18 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
   }
 
   if(found_route != NULL) {
+#if UIP_DS6_ROUTE_HASH
+    /* Reordering the list would walk it, just mark the route so the
+       next eviction gives it a second chance. */
+    found_route->used = 1;
+#else /* UIP_DS6_ROUTE_HASH */
     /* If we found a route, we put it at the end of the routeslist
        list. The list is ordered by how recently we looked them up:
        the least recently used route will be at the start of the
        list. */
     list_remove(routelist, found_route);
     list_add(routelist, found_route);
+#endif /* UIP_DS6_ROUTE_HASH */
   }
 
   return found_route;
@@ -269,6 +421,9 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
     PRINTF("uip_ds6_route_add: old route already found, updating this one instead: ");
     PRINT6ADDR(ipaddr);
     PRINTF("\n");
+#if UIP_DS6_ROUTE_HASH
+    index_rm(r);
+#endif /* UIP_DS6_ROUTE_HASH */
   } else {
     struct uip_ds6_route_neighbor_routes *routes;
     /* If there is no routing entry, create one. We first need to
@@ -281,6 +436,16 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
       uip_ds6_route_t *oldest;
 
       oldest = uip_ds6_route_head();
+#if UIP_DS6_ROUTE_HASH
+      /* Routes looked up since the last pass move to the end of the
+         list instead. */
+      while(oldest->used) {
+        oldest->used = 0;
+        list_remove(routelist, oldest);
+        list_add(routelist, oldest);
+        oldest = uip_ds6_route_head();
+      }
+#endif /* UIP_DS6_ROUTE_HASH */
       PRINTF("uip_ds6_route_add: dropping route to ");
       PRINT6ADDR(&oldest->ipaddr);
       PRINTF("\n");
@@ -327,6 +492,9 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
     }
 
     list_add(routelist, r);
+#if UIP_DS6_ROUTE_HASH
+    r->used = 0;
+#endif /* UIP_DS6_ROUTE_HASH */
 
     nbrr = memb_alloc(&neighborroutememb);
     if(nbrr == NULL) {
@@ -348,6 +516,9 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
 
   uip_ipaddr_copy(&(r->ipaddr), ipaddr);
   r->length = length;
+#if UIP_DS6_ROUTE_HASH
+  index_add(r);
+#endif /* UIP_DS6_ROUTE_HASH */
 
 #ifdef UIP_DS6_ROUTE_STATE_TYPE
   memset(&r->state, 0, sizeof(UIP_DS6_ROUTE_STATE_TYPE));
@@ -386,6 +557,9 @@ uip_ds6_route_rm(uip_ds6_route_t *route)
 
     /* Remove the neighbor from the route list */
     list_remove(routelist, route);
+#if UIP_DS6_ROUTE_HASH
+    index_rm(route);
+#endif /* UIP_DS6_ROUTE_HASH */
 
     /* Find the corresponding neighbor_route and remove it. */
     for(neighbor_route = list_head(route->neighbor_routes->route_list);
@@ -513,6 +687,7 @@ uip_ds6_defrt_add(uip_ipaddr_t *ipaddr, unsigned long interval)
   if(interval != 0) {
     stimer_set(&d->lifetime, interval);
     d->isinfinite = 0;
+    uip_ds6_schedule_stimer(&d->lifetime);
   } else {
     d->isinfinite = 1;
   }
@@ -617,6 +792,9 @@ uip_ds6_defrt_periodic(void)
       uip_ds6_defrt_rm(d);
       d = list_head(defaultrouterlist);
     } else {
+      if(!d->isinfinite) {
+        uip_ds6_schedule_stimer(&d->lifetime);
+      }
       d = list_item_next(d);
     }
   }
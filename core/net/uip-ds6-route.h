@@ -80,6 +80,15 @@ void uip_ds6_notification_rm(struct uip_ds6_notification *n);
 #define UIP_DS6_ROUTE_NB UIP_CONF_MAX_ROUTES
 #endif /* UIP_CONF_MAX_ROUTES */
 
+/** \brief Index host routes (/128) in a hash table and remember the
+ *  last lookup, so forwarding does not walk the whole route list.
+ *  Replaces the move-to-front LRU order by a second-chance bit. */
+#ifdef UIP_DS6_ROUTE_CONF_HASH
+#define UIP_DS6_ROUTE_HASH UIP_DS6_ROUTE_CONF_HASH
+#else /* UIP_DS6_ROUTE_CONF_HASH */
+#define UIP_DS6_ROUTE_HASH 0
+#endif /* UIP_DS6_ROUTE_CONF_HASH */
+
 /** \brief define some additional RPL related route state and
  *  neighbor callback for RPL - if not a DS6_ROUTE_STATE is already set */
 #ifndef UIP_DS6_ROUTE_STATE_TYPE
@@ -90,6 +99,7 @@ typedef struct rpl_route_entry {
   void *dag;
   uint8_t learned_from;
   uint8_t nopath_received;
+  uint8_t dao_pending;
 } rpl_route_entry_t;
 #endif /* UIP_DS6_ROUTE_STATE_TYPE */
 
@@ -113,6 +123,10 @@ typedef struct uip_ds6_route {
   UIP_DS6_ROUTE_STATE_TYPE state;
 #endif
   uint8_t length;
+#if UIP_DS6_ROUTE_HASH
+  /* Set by lookups, cleared when the route survives an eviction pass */
+  uint8_t used;
+#endif /* UIP_DS6_ROUTE_HASH */
 } uip_ds6_route_t;
 
 /** \brief A neighbor route list entry, used on the
@@ -47,6 +47,7 @@
 #include "net/uip-nd6.h"
 #include "net/uip-ds6.h"
 #include "net/uip-packetqueue.h"
+#include "net/tcpip.h"
 
 #if UIP_CONF_IPV6
 
@@ -54,6 +55,10 @@
 #include "net/uip-debug.h"
 
 struct etimer uip_ds6_timer_periodic;                           /** \brief Timer for maintenance of data structures */
+#if UIP_DS6_SCHEDULE
+static uint8_t periodic_running;                                /** \brief uip_ds6_periodic() collects the next expiry */
+static clock_time_t periodic_next;                              /** \brief Time until the next expiry */
+#endif /* UIP_DS6_SCHEDULE */
 
 #if UIP_CONF_ROUTER
 struct stimer uip_ds6_timer_ra;                                 /** \brief RA timer, to schedule RA sending */
@@ -86,6 +91,42 @@ static uip_ds6_maddr_t *locmaddr;
 static uip_ds6_aaddr_t *locaaddr;
 static uip_ds6_prefix_t *locprefix;
 
+#if UIP_DS6_ADDR_FILTER
+uint8_t uip_ds6_addr_filter[32];
+
+#define FILTER_ADD(a) \
+  (uip_ds6_addr_filter[(a)->u8[15] >> 3] |= 1 << ((a)->u8[15] & 7))
+
+/*---------------------------------------------------------------------------*/
+static void
+addr_filter_rebuild(void)
+{
+  uint8_t i;
+
+  memset(uip_ds6_addr_filter, 0, sizeof(uip_ds6_addr_filter));
+  for(i = 0; i < UIP_DS6_ADDR_NB; i++) {
+    if(uip_ds6_if.addr_list[i].isused) {
+      FILTER_ADD(&uip_ds6_if.addr_list[i].ipaddr);
+    }
+  }
+  for(i = 0; i < UIP_DS6_MADDR_NB; i++) {
+    if(uip_ds6_if.maddr_list[i].isused) {
+      FILTER_ADD(&uip_ds6_if.maddr_list[i].ipaddr);
+    }
+  }
+#if UIP_DS6_AADDR_NB
+  for(i = 0; i < UIP_DS6_AADDR_NB; i++) {
+    if(uip_ds6_if.aaddr_list[i].isused) {
+      FILTER_ADD(&uip_ds6_if.aaddr_list[i].ipaddr);
+    }
+  }
+#endif /* UIP_DS6_AADDR_NB */
+}
+#else /* UIP_DS6_ADDR_FILTER */
+#define FILTER_ADD(a)
+#define addr_filter_rebuild()
+#endif /* UIP_DS6_ADDR_FILTER */
+
 /*---------------------------------------------------------------------------*/
 void
 uip_ds6_init(void)
@@ -100,6 +141,7 @@ uip_ds6_init(void)
      UIP_DS6_ADDR_NB, UIP_DS6_MADDR_NB, UIP_DS6_AADDR_NB);
   memset(uip_ds6_prefix_list, 0, sizeof(uip_ds6_prefix_list));
   memset(&uip_ds6_if, 0, sizeof(uip_ds6_if));
+  addr_filter_rebuild();
   uip_ds6_addr_size = sizeof(struct uip_ds6_addr);
   uip_ds6_netif_addr_list_offset = offsetof(struct uip_ds6_netif, addr_list);
 
@@ -144,6 +186,10 @@ uip_ds6_init(void)
 void
 uip_ds6_periodic(void)
 {
+#if UIP_DS6_SCHEDULE
+  periodic_running = 1;
+  periodic_next = UIP_DS6_PERIOD_MAX;
+#endif /* UIP_DS6_SCHEDULE */
 
   /* Periodic processing on unicast addresses */
   for(locaddr = uip_ds6_if.addr_list;
@@ -151,6 +197,7 @@ uip_ds6_periodic(void)
     if(locaddr->isused) {
       if((!locaddr->isinfinite) && (stimer_expired(&locaddr->vlifetime))) {
         uip_ds6_addr_rm(locaddr);
+        continue;
 #if UIP_ND6_DEF_MAXDADNS > 0
       } else if((locaddr->state == ADDR_TENTATIVE)
                 && (locaddr->dadnscount <= uip_ds6_if.maxdadns)
@@ -159,6 +206,16 @@ uip_ds6_periodic(void)
         uip_ds6_dad(locaddr);
 #endif /* UIP_ND6_DEF_MAXDADNS > 0 */
       }
+      if(!locaddr->isinfinite) {
+        uip_ds6_schedule_stimer(&locaddr->vlifetime);
+      }
+#if UIP_ND6_DEF_MAXDADNS > 0
+      if(locaddr->state == ADDR_TENTATIVE) {
+        /* Also retries a DAD that was held back by a pending packet */
+        uip_ds6_schedule(timer_expired(&locaddr->dadtimer) ? 0 :
+                         timer_remaining(&locaddr->dadtimer));
+      }
+#endif /* UIP_ND6_DEF_MAXDADNS > 0 */
     }
   }
 
@@ -177,9 +234,12 @@ uip_ds6_periodic(void)
   for(locprefix = uip_ds6_prefix_list;
       locprefix < uip_ds6_prefix_list + UIP_DS6_PREFIX_NB;
       locprefix++) {
-    if(locprefix->isused && !locprefix->isinfinite
-       && stimer_expired(&(locprefix->vlifetime))) {
-      uip_ds6_prefix_rm(locprefix);
+    if(locprefix->isused && !locprefix->isinfinite) {
+      if(stimer_expired(&(locprefix->vlifetime))) {
+        uip_ds6_prefix_rm(locprefix);
+      } else {
+        uip_ds6_schedule_stimer(&locprefix->vlifetime);
+      }
     }
   }
 #endif /* !UIP_CONF_ROUTER */
@@ -191,10 +251,56 @@ uip_ds6_periodic(void)
   if(stimer_expired(&uip_ds6_timer_ra) && (uip_len == 0)) {
     uip_ds6_send_ra_periodic();
   }
+  uip_ds6_schedule_stimer(&uip_ds6_timer_ra);
 #endif /* UIP_CONF_ROUTER & UIP_ND6_SEND_RA */
+#if UIP_DS6_SCHEDULE
+  periodic_running = 0;
+  etimer_set(&uip_ds6_timer_periodic, periodic_next);
+#else /* UIP_DS6_SCHEDULE */
   etimer_reset(&uip_ds6_timer_periodic);
+#endif /* UIP_DS6_SCHEDULE */
   return;
 }
+#if UIP_DS6_SCHEDULE
+/*---------------------------------------------------------------------------*/
+void
+uip_ds6_schedule(clock_time_t delay)
+{
+  if(delay < UIP_DS6_PERIOD) {
+    delay = UIP_DS6_PERIOD;
+  }
+
+  if(periodic_running) {
+    /* uip_ds6_periodic() sets the timer when it is done */
+    if(delay < periodic_next) {
+      periodic_next = delay;
+    }
+    return;
+  }
+
+  if(etimer_expired(&uip_ds6_timer_periodic) ||
+     timer_remaining(&uip_ds6_timer_periodic.timer) > delay) {
+    /* May be called from outside of tcpip_process, e.g. a MAC callback */
+    PROCESS_CONTEXT_BEGIN(&tcpip_process);
+    etimer_set(&uip_ds6_timer_periodic, delay);
+    PROCESS_CONTEXT_END(&tcpip_process);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_ds6_schedule_stimer(struct stimer *t)
+{
+  unsigned long remaining;
+
+  if(stimer_expired(t)) {
+    uip_ds6_schedule(0);
+    return;
+  }
+  remaining = stimer_remaining(t);
+  uip_ds6_schedule(remaining > UIP_DS6_PERIOD_MAX / CLOCK_SECOND ?
+                   UIP_DS6_PERIOD_MAX : remaining * CLOCK_SECOND);
+}
+#endif /* UIP_DS6_SCHEDULE */
 
 /*---------------------------------------------------------------------------*/
 uint8_t
@@ -269,6 +375,7 @@ uip_ds6_prefix_add(uip_ipaddr_t *ipaddr, uint8_t ipaddrlen,
     if(interval != 0) {
       stimer_set(&(locprefix->vlifetime), interval);
       locprefix->isinfinite = 0;
+      uip_ds6_schedule_stimer(&locprefix->vlifetime);
     } else {
       locprefix->isinfinite = 1;
     }
@@ -326,12 +433,14 @@ uip_ds6_addr_add(uip_ipaddr_t *ipaddr, unsigned long vlifetime, uint8_t type)
       (uip_ds6_element_t **)&locaddr) == FREESPACE) {
     locaddr->isused = 1;
     uip_ipaddr_copy(&locaddr->ipaddr, ipaddr);
+    FILTER_ADD(ipaddr);
     locaddr->type = type;
     if(vlifetime == 0) {
       locaddr->isinfinite = 1;
     } else {
       locaddr->isinfinite = 0;
       stimer_set(&(locaddr->vlifetime), vlifetime);
+      uip_ds6_schedule_stimer(&locaddr->vlifetime);
     }
 #if UIP_ND6_DEF_MAXDADNS > 0
     locaddr->state = ADDR_TENTATIVE;
@@ -339,6 +448,7 @@ uip_ds6_addr_add(uip_ipaddr_t *ipaddr, unsigned long vlifetime, uint8_t type)
               random_rand() % (UIP_ND6_MAX_RTR_SOLICITATION_DELAY *
                                CLOCK_SECOND));
     locaddr->dadnscount = 0;
+    uip_ds6_schedule(timer_remaining(&locaddr->dadtimer));
 #else /* UIP_ND6_DEF_MAXDADNS > 0 */
     locaddr->state = ADDR_PREFERRED;
 #endif /* UIP_ND6_DEF_MAXDADNS > 0 */
@@ -359,6 +469,7 @@ uip_ds6_addr_rm(uip_ds6_addr_t *addr)
       uip_ds6_maddr_rm(locmaddr);
     }
     addr->isused = 0;
+    addr_filter_rebuild();
   }
   return;
 }
@@ -367,6 +478,9 @@ uip_ds6_addr_rm(uip_ds6_addr_t *addr)
 uip_ds6_addr_t *
 uip_ds6_addr_lookup(uip_ipaddr_t *ipaddr)
 {
+  if(!uip_ds6_addr_maybe_mine(ipaddr)) {
+    return NULL;
+  }
   if(uip_ds6_list_loop
      ((uip_ds6_element_t *)uip_ds6_if.addr_list, UIP_DS6_ADDR_NB,
       sizeof(uip_ds6_addr_t), ipaddr, 128,
@@ -424,6 +538,7 @@ uip_ds6_maddr_add(const uip_ipaddr_t *ipaddr)
       (uip_ds6_element_t **)&locmaddr) == FREESPACE) {
     locmaddr->isused = 1;
     uip_ipaddr_copy(&locmaddr->ipaddr, ipaddr);
+    FILTER_ADD(ipaddr);
     return locmaddr;
   }
   return NULL;
@@ -435,6 +550,7 @@ uip_ds6_maddr_rm(uip_ds6_maddr_t *maddr)
 {
   if(maddr != NULL) {
     maddr->isused = 0;
+    addr_filter_rebuild();
   }
   return;
 }
@@ -443,6 +559,9 @@ uip_ds6_maddr_rm(uip_ds6_maddr_t *maddr)
 uip_ds6_maddr_t *
 uip_ds6_maddr_lookup(const uip_ipaddr_t *ipaddr)
 {
+  if(!uip_ds6_addr_maybe_mine(ipaddr)) {
+    return NULL;
+  }
   if(uip_ds6_list_loop
      ((uip_ds6_element_t *)uip_ds6_if.maddr_list, UIP_DS6_MADDR_NB,
       sizeof(uip_ds6_maddr_t), (void*)ipaddr, 128,
@@ -463,6 +582,7 @@ uip_ds6_aaddr_add(uip_ipaddr_t *ipaddr)
       (uip_ds6_element_t **)&locaaddr) == FREESPACE) {
     locaaddr->isused = 1;
     uip_ipaddr_copy(&locaaddr->ipaddr, ipaddr);
+    FILTER_ADD(ipaddr);
     return locaaddr;
   }
   return NULL;
@@ -474,6 +594,7 @@ uip_ds6_aaddr_rm(uip_ds6_aaddr_t *aaddr)
 {
   if(aaddr != NULL) {
     aaddr->isused = 0;
+    addr_filter_rebuild();
   }
   return;
 }
@@ -482,6 +603,9 @@ uip_ds6_aaddr_rm(uip_ds6_aaddr_t *aaddr)
 uip_ds6_aaddr_t *
 uip_ds6_aaddr_lookup(uip_ipaddr_t *ipaddr)
 {
+  if(!uip_ds6_addr_maybe_mine(ipaddr)) {
+    return NULL;
+  }
   if(uip_ds6_list_loop((uip_ds6_element_t *)uip_ds6_if.aaddr_list,
 		       UIP_DS6_AADDR_NB, sizeof(uip_ds6_aaddr_t), ipaddr, 128,
 		       (uip_ds6_element_t **)&locaaddr) == FOUND) {
@@ -635,6 +759,7 @@ uip_ds6_send_ra_sollicited(void)
                  stimer_elapsed(&uip_ds6_timer_ra));
   */ } else {
       stimer_set(&uip_ds6_timer_ra, rand_time);
+      uip_ds6_schedule_stimer(&uip_ds6_timer_ra);
     }
   }
 }
@@ -119,6 +119,15 @@
 #define UIP_DS6_LL_NUD UIP_CONF_DS6_LL_NUD
 #endif
 
+/* Keep a bitmap of the last bytes of all own unicast, multicast and
+   anycast addresses, so that foreign addresses fail the lookups after a
+   single bit test */
+#ifndef UIP_CONF_DS6_ADDR_FILTER
+#define UIP_DS6_ADDR_FILTER 1
+#else
+#define UIP_DS6_ADDR_FILTER UIP_CONF_DS6_ADDR_FILTER
+#endif
+
 /** \brief Possible states for the an address  (RFC 4862) */
 #define ADDR_TENTATIVE 0
 #define ADDR_PREFERRED 1
@@ -132,6 +141,22 @@
 
 /** \brief General DS6 definitions */
 #define UIP_DS6_PERIOD   (CLOCK_SECOND/10)  /** Period for uip-ds6 periodic task*/
+
+/*--------------------------------------------------*/
+/* Run the periodic task only when the next timer of an entry expires,
+ * instead of every UIP_DS6_PERIOD. UIP_DS6_PERIOD is then the minimum
+ * and UIP_DS6_PERIOD_MAX the maximum time between two runs. */
+#ifndef UIP_CONF_DS6_SCHEDULE
+#define UIP_DS6_SCHEDULE 1
+#else
+#define UIP_DS6_SCHEDULE UIP_CONF_DS6_SCHEDULE
+#endif
+
+#ifndef UIP_CONF_DS6_PERIOD_MAX
+#define UIP_DS6_PERIOD_MAX (60 * CLOCK_SECOND)
+#else
+#define UIP_DS6_PERIOD_MAX UIP_CONF_DS6_PERIOD_MAX
+#endif
 #define FOUND 0
 #define FREESPACE 1
 #define NOSPACE 2
@@ -240,6 +265,16 @@ void uip_ds6_init(void);
 /** \brief Periodic processing of data structures */
 void uip_ds6_periodic(void);
 
+/** \brief Make sure the periodic processing runs within delay, to be
+ * called whenever the timer of an entry is set */
+#if UIP_DS6_SCHEDULE
+void uip_ds6_schedule(clock_time_t delay);
+void uip_ds6_schedule_stimer(struct stimer *t);
+#else /* UIP_DS6_SCHEDULE */
+#define uip_ds6_schedule(delay)
+#define uip_ds6_schedule_stimer(t)
+#endif /* UIP_DS6_SCHEDULE */
+
 /** \brief Generic loop routine on an abstract data structure, which generalizes
  * all data structures used in DS6 */
 uint8_t uip_ds6_list_loop(uip_ds6_element_t *list, uint8_t size,
@@ -331,9 +366,20 @@ uint32_t uip_ds6_compute_reachable_time(void); /** \brief compute random reachab
 
 /** \name Macros to check if an IP address (unicast, multicast or anycast) is mine */
 /** @{ */
-#define uip_ds6_is_my_addr(addr)  (uip_ds6_addr_lookup(addr) != NULL)
-#define uip_ds6_is_my_maddr(addr) (uip_ds6_maddr_lookup(addr) != NULL)
-#define uip_ds6_is_my_aaddr(addr) (uip_ds6_aaddr_lookup(addr) != NULL)
+#if UIP_DS6_ADDR_FILTER
+extern uint8_t uip_ds6_addr_filter[32];
+/** \brief 0 if addr is none of the own addresses, 1 if it may be one */
+#define uip_ds6_addr_maybe_mine(addr) \
+  ((uip_ds6_addr_filter[(addr)->u8[15] >> 3] >> ((addr)->u8[15] & 7)) & 1)
+#else /* UIP_DS6_ADDR_FILTER */
+#define uip_ds6_addr_maybe_mine(addr) 1
+#endif /* UIP_DS6_ADDR_FILTER */
+#define uip_ds6_is_my_addr(addr)  (uip_ds6_addr_maybe_mine(addr) && \
+                                   uip_ds6_addr_lookup(addr) != NULL)
+#define uip_ds6_is_my_maddr(addr) (uip_ds6_addr_maybe_mine(addr) && \
+                                   uip_ds6_maddr_lookup(addr) != NULL)
+#define uip_ds6_is_my_aaddr(addr) (uip_ds6_addr_maybe_mine(addr) && \
+                                   uip_ds6_aaddr_lookup(addr) != NULL)
 /** @} */
 /** @} */
 
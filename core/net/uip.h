@@ -1356,11 +1356,32 @@ struct uip_conn {
   uint8_t timer;         /**< The retransmission timer. */
   uint8_t nrtx;          /**< The number of retransmissions for the last
 			 segment sent. */
+#if UIP_TCP_WINDOW > 1
+  uint16_t snd_wnd;      /**< The window advertised by the remote host. */
+  uint8_t wsegs[UIP_TCP_WINDOW]; /**< The retransmission buffers of the
+                                    segments in flight, oldest first. */
+  uint8_t wnum;          /**< The number of segments in flight. */
+  uint8_t wflags;        /**< Send window flags. */
+#endif /* UIP_TCP_WINDOW > 1 */
 
   /** The application state. */
   uip_tcp_appstate_t appstate;
 };
 
+#if UIP_TCP_WINDOW > 1
+/**
+ * Check if the application of a connection may send another segment
+ * into the send window.
+ *
+ * This is the case when the last segment of the application has been
+ * buffered but not yet acknowledged to the application and there is
+ * room for one more. The caller should then poll the connection.
+ */
+int uip_tcp_window_ready(struct uip_conn *conn);
+#else /* UIP_TCP_WINDOW > 1 */
+#define uip_tcp_window_ready(conn) 0
+#endif /* UIP_TCP_WINDOW > 1 */
+
 
 /**
  * Pointer to the current TCP connection.
@@ -1394,6 +1415,9 @@ struct uip_udp_conn {
   uint16_t lport;        /**< The local port number in network byte order. */
   uint16_t rport;        /**< The remote port number in network byte order. */
   uint8_t  ttl;          /**< Default time-to-live. */
+#if UIP_CONF_IPV6
+  uint8_t  tclass;       /**< IPv6 traffic class of sent packets. */
+#endif /* UIP_CONF_IPV6 */
 
   /** The application state. */
   uip_udp_appstate_t appstate;
@@ -2093,6 +2117,15 @@ CCIF extern uip_lladdr_t uip_lladdr;
 #define uip_is_addr_mcast(a)                    \
   (((a)->u8[0]) == 0xFF)
 
+/**
+ * \brief is address a multicast address of a scope wider than
+ * link-local, see RFC 4291
+ * a is of type uip_ipaddr_t*
+ * */
+#define uip_is_addr_mcast_routable(a)           \
+  ((((a)->u8[0]) == 0xFF) &&                    \
+   (((a)->u8[1]) & 0x0F) > 0x02)
+
 /**
  * \brief is group-id of multicast address a
  * the all nodes group-id
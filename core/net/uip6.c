@@ -243,6 +243,11 @@ static uint8_t iss[4];
 uint8_t uip_acc32[4];
 static uint8_t opt;
 static uint16_t tmp16;
+#if UIP_TCP_WINDOW > 1
+/* Offset of a data segment of the send window from snd_nxt. */
+static uint16_t wseqoff;
+static void window_reset(struct uip_conn *conn);
+#endif /* UIP_TCP_WINDOW > 1 */
 #endif /* UIP_TCP */
 /** @} */
 
@@ -494,6 +499,9 @@ uip_connect(uip_ipaddr_t *ripaddr, uint16_t rport)
   conn->rto = UIP_RTO;
   conn->sa = 0;
   conn->sv = 16;   /* Initial value of the RTT variance. */
+#if UIP_TCP_WINDOW > 1
+  window_reset(conn);
+#endif /* UIP_TCP_WINDOW > 1 */
   conn->lport = uip_htons(lastport);
   conn->rport = rport;
   uip_ipaddr_copy(&conn->ripaddr, ripaddr);
@@ -567,6 +575,7 @@ uip_udp_new(const uip_ipaddr_t *ripaddr, uint16_t rport)
     uip_ipaddr_copy(&conn->ripaddr, ripaddr);
   }
   conn->ttl = uip_ds6_if.cur_hop_limit;
+  conn->tclass = 0;
   
   return conn;
 }
@@ -822,8 +831,170 @@ uip_add_rcv_nxt(uint16_t n)
   uip_conn->rcv_nxt[2] = uip_acc32[2];
   uip_conn->rcv_nxt[3] = uip_acc32[3];
 }
+/*---------------------------------------------------------------------------*/
+static void
+update_rtt(struct uip_conn *conn)
+{
+  signed char m;
+
+  m = conn->rto - conn->timer;
+  /* This is taken directly from VJs original code in his paper */
+  m = m - (conn->sa >> 3);
+  conn->sa += m;
+  if(m < 0) {
+    m = -m;
+  }
+  m = m - (conn->sv >> 2);
+  conn->sv += m;
+  conn->rto = (conn->sa >> 3) + conn->sv;
+}
 #endif
 /*---------------------------------------------------------------------------*/
+#if UIP_TCP_WINDOW > 1
+/* Retransmission buffers for the segments in the send windows */
+struct tcp_wseg {
+  struct uip_conn *conn;
+  uint16_t len;
+  uint8_t data[UIP_TCP_MSS];
+};
+static struct tcp_wseg tcp_wsegs[UIP_TCP_WINDOW_BUFFERS];
+
+/* The application was not yet told that its last segment is acked. */
+#define TCP_WF_APPACK 0x01
+/* The application has closed the connection, the FIN is sent once all
+   segments are acknowledged. */
+#define TCP_WF_CLOSE  0x02
+
+static void
+window_reset(struct uip_conn *conn)
+{
+  uint8_t i;
+
+  for(i = 0; i < UIP_TCP_WINDOW_BUFFERS; ++i) {
+    if(tcp_wsegs[i].conn == conn) {
+      tcp_wsegs[i].conn = NULL;
+    }
+  }
+  conn->wnum = 0;
+  conn->wflags = 0;
+  conn->snd_wnd = UIP_TCP_MSS;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+window_free_seg(void)
+{
+  uint8_t i;
+  struct uip_conn *owner;
+
+  for(i = 0; i < UIP_TCP_WINDOW_BUFFERS; ++i) {
+    owner = tcp_wsegs[i].conn;
+    /* The buffers of closed connections are free as well. */
+    if(owner == NULL || (owner->tcpstateflags & UIP_TS_MASK) == UIP_CLOSED) {
+      return i;
+    }
+  }
+  return UIP_TCP_WINDOW_BUFFERS;
+}
+/*---------------------------------------------------------------------------*/
+/* Returns non-zero if the application may send another full segment. */
+static uint8_t
+window_open(struct uip_conn *conn)
+{
+  if((conn->tcpstateflags & UIP_TS_MASK) != UIP_ESTABLISHED ||
+     (conn->wflags & TCP_WF_CLOSE) || conn->wnum >= UIP_TCP_WINDOW ||
+     window_free_seg() == UIP_TCP_WINDOW_BUFFERS) {
+    return 0;
+  }
+  if(conn->len == 0) {
+    return 1;
+  }
+  /* Data sent without a buffer must be acknowledged first. */
+  return conn->wnum > 0 && conn->len + conn->mss <= conn->snd_wnd;
+}
+/*---------------------------------------------------------------------------*/
+int
+uip_tcp_window_ready(struct uip_conn *conn)
+{
+  return (conn->wflags & TCP_WF_APPACK) && window_open(conn);
+}
+/*---------------------------------------------------------------------------*/
+/* Tells the application that its buffered segment is acknowledged, so
+   that it sends the next one. */
+static void
+window_ack_app(struct uip_conn *conn)
+{
+  if(uip_tcp_window_ready(conn)) {
+    conn->wflags &= ~TCP_WF_APPACK;
+    uip_flags |= UIP_ACKDATA;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Appends the uip_slen bytes of the application to the send window. */
+static uint8_t
+window_add(struct uip_conn *conn)
+{
+  uint8_t i;
+  struct tcp_wseg *seg;
+
+  i = window_free_seg();
+  if(i == UIP_TCP_WINDOW_BUFFERS) {
+    return 0;
+  }
+  seg = &tcp_wsegs[i];
+  seg->conn = conn;
+  seg->len = uip_slen;
+  memcpy(seg->data, uip_sappdata, uip_slen);
+  conn->wsegs[conn->wnum++] = i;
+  wseqoff = conn->len;
+  conn->len += uip_slen;
+  conn->wflags |= TCP_WF_APPACK;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+seq32(const uint8_t *seq)
+{
+  return (uint32_t)seq[0] << 24 | (uint32_t)seq[1] << 16 |
+    (uint32_t)seq[2] << 8 | seq[3];
+}
+/*---------------------------------------------------------------------------*/
+/* Frees the segments acknowledged by the incoming packet. Returns
+   non-zero if it acknowledged new data. */
+static uint8_t
+window_acked(struct uip_conn *conn)
+{
+  uint32_t acked;
+  struct tcp_wseg *seg;
+
+  acked = seq32(UIP_TCP_BUF->ackno) - seq32(conn->snd_nxt);
+  if(acked == 0 || acked > conn->len) {
+    return 0;
+  }
+
+  uip_add32(conn->snd_nxt, acked);
+  conn->snd_nxt[0] = uip_acc32[0];
+  conn->snd_nxt[1] = uip_acc32[1];
+  conn->snd_nxt[2] = uip_acc32[2];
+  conn->snd_nxt[3] = uip_acc32[3];
+  conn->len -= acked;
+
+  while(acked > 0 && conn->wnum > 0) {
+    seg = &tcp_wsegs[conn->wsegs[0]];
+    if(seg->len > acked) {
+      /* A split segment was acknowledged in part. */
+      seg->len -= acked;
+      memmove(seg->data, seg->data + acked, seg->len);
+      break;
+    }
+    acked -= seg->len;
+    seg->conn = NULL;
+    --conn->wnum;
+    memmove(conn->wsegs, conn->wsegs + 1, conn->wnum);
+  }
+  return 1;
+}
+#endif /* UIP_TCP_WINDOW > 1 */
+/*---------------------------------------------------------------------------*/
 
 /**
  * \brief Process the options in Destination and Hop By Hop extension headers
@@ -927,8 +1098,11 @@ uip_process(uint8_t flag)
   if(flag == UIP_POLL_REQUEST) {
 #if UIP_TCP
     if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
-       !uip_outstanding(uip_connr)) {
+       (!uip_outstanding(uip_connr) || uip_tcp_window_ready(uip_connr))) {
       uip_flags = UIP_POLL;
+#if UIP_TCP_WINDOW > 1
+      window_ack_app(uip_connr);
+#endif /* UIP_TCP_WINDOW > 1 */
       UIP_APPCALL();
       goto appsend;
 #if UIP_ACTIVE_OPEN
@@ -1023,6 +1197,19 @@ uip_process(uint8_t flag)
 #endif /* UIP_ACTIVE_OPEN */
                      
             case UIP_ESTABLISHED:
+#if UIP_TCP_WINDOW > 1
+              /* Segments of the send window are retransmitted from
+                 their buffer, oldest first. */
+              if(uip_connr->wnum > 0) {
+                uip_len = tcp_wsegs[uip_connr->wsegs[0]].len;
+                memcpy(uip_sappdata, tcp_wsegs[uip_connr->wsegs[0]].data,
+                       uip_len);
+                uip_len += UIP_TCPIP_HLEN;
+                wseqoff = 0;
+                UIP_TCP_BUF->flags = TCP_ACK | TCP_PSH;
+                goto tcp_send_noopts;
+              }
+#endif /* UIP_TCP_WINDOW > 1 */
               /*
                * In the ESTABLISHED state, we call upon the application
                * to do the actual retransmit after which we jump into
@@ -1040,12 +1227,17 @@ uip_process(uint8_t flag)
               goto tcp_send_finack;
           }
         }
-      } else if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED) {
+      }
+      if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
+         (!uip_outstanding(uip_connr) || uip_tcp_window_ready(uip_connr))) {
         /*
          * If there was no need for a retransmission, we poll the
          * application for new data.
          */
         uip_flags = UIP_POLL;
+#if UIP_TCP_WINDOW > 1
+        window_ack_app(uip_connr);
+#endif /* UIP_TCP_WINDOW > 1 */
         UIP_APPCALL();
         goto appsend;
       }
@@ -1155,6 +1347,16 @@ uip_process(uint8_t flag)
   }
 
 
+#if UIP_CONF_IPV6_RPL
+  /* Multicast packets beyond the link pass down the DODAG, members of
+   * the group also take them in below */
+  if(uip_is_addr_mcast_routable(&UIP_IP_BUF->destipaddr) &&
+     !rpl_mcast_in()) {
+    UIP_STAT(++uip_stat.ip.drop);
+    goto drop;
+  }
+#endif /* UIP_CONF_IPV6_RPL */
+
   /* TBD Some Parameter problem messages */
   if(!uip_ds6_is_my_addr(&UIP_IP_BUF->destipaddr) &&
      !uip_ds6_is_my_maddr(&UIP_IP_BUF->destipaddr)) {
@@ -1312,6 +1514,24 @@ uip_process(uint8_t flag)
 
         PRINTF("Processing Routing header\n");
         if(UIP_ROUTING_BUF->seg_left > 0) {
+#if UIP_CONF_IPV6_RPL && UIP_CONF_ROUTER
+          /* An RPL source route, forward to its next address */
+          if(rpl_srh_process()) {
+            if(UIP_IP_BUF->ttl <= 1) {
+              uip_icmp6_error_output(ICMP6_TIME_EXCEEDED,
+                                     ICMP6_TIME_EXCEED_TRANSIT, 0);
+              UIP_STAT(++uip_stat.ip.drop);
+              goto send;
+            }
+            rpl_update_header_empty();
+            UIP_IP_BUF->ttl = UIP_IP_BUF->ttl - 1;
+            PRINTF("Forwarding source routed packet to ");
+            PRINT6ADDR(&UIP_IP_BUF->destipaddr);
+            PRINTF("\n");
+            UIP_STAT(++uip_stat.ip.forwarded);
+            goto send;
+          }
+#endif /* UIP_CONF_IPV6_RPL && UIP_CONF_ROUTER */
           uip_icmp6_error_output(ICMP6_PARAM_PROB, ICMP6_PARAMPROB_HEADER, UIP_IPH_LEN + uip_ext_len + 2);
           UIP_STAT(++uip_stat.ip.drop);
           UIP_LOG("ip6: unrecognized routing type");
@@ -1572,7 +1792,10 @@ uip_process(uint8_t flag)
   }
 #endif /* UIP_UDP_CHECKSUMS */
   UIP_STAT(++uip_stat.udp.sent);
-  goto ip_send_nolen;
+  UIP_IP_BUF->vtc = 0x60 | (uip_udp_conn->tclass >> 4);
+  UIP_IP_BUF->tcflow = uip_udp_conn->tclass << 4;
+  UIP_IP_BUF->flow = 0x00;
+  goto send;
 #endif /* UIP_UDP */
 
 #if UIP_TCP
@@ -1723,6 +1946,9 @@ uip_process(uint8_t flag)
   uip_connr->sa = 0;
   uip_connr->sv = 4;
   uip_connr->nrtx = 0;
+#if UIP_TCP_WINDOW > 1
+  window_reset(uip_connr);
+#endif /* UIP_TCP_WINDOW > 1 */
   uip_connr->lport = UIP_TCP_BUF->destport;
   uip_connr->rport = UIP_TCP_BUF->srcport;
   uip_ipaddr_copy(&uip_connr->ripaddr, &UIP_IP_BUF->srcipaddr);
@@ -1851,6 +2077,19 @@ uip_process(uint8_t flag)
      the outstanding data, calculate RTT estimations, and reset the
      retransmission timer. */
   if((UIP_TCP_BUF->flags & TCP_ACK) && uip_outstanding(uip_connr)) {
+#if UIP_TCP_WINDOW > 1
+    /* The segments of a send window can be acknowledged one by one. The
+       application learns about it through window_ack_app(). */
+    if(uip_connr->wnum > 0) {
+      if(window_acked(uip_connr)) {
+        if(uip_connr->nrtx == 0) {
+          update_rtt(uip_connr);
+        }
+        uip_connr->timer = uip_connr->rto;
+        uip_connr->nrtx = 0;
+      }
+    } else {
+#endif /* UIP_TCP_WINDOW > 1 */
     uip_add32(uip_connr->snd_nxt, uip_connr->len);
 
     if(UIP_TCP_BUF->ackno[0] == uip_acc32[0] &&
@@ -1865,18 +2104,7 @@ uip_process(uint8_t flag)
    
       /* Do RTT estimation, unless we have done retransmissions. */
       if(uip_connr->nrtx == 0) {
-        signed char m;
-        m = uip_connr->rto - uip_connr->timer;
-        /* This is taken directly from VJs original code in his paper */
-        m = m - (uip_connr->sa >> 3);
-        uip_connr->sa += m;
-        if(m < 0) {
-          m = -m;
-        }
-        m = m - (uip_connr->sv >> 2);
-        uip_connr->sv += m;
-        uip_connr->rto = (uip_connr->sa >> 3) + uip_connr->sv;
-
+        update_rtt(uip_connr);
       }
       /* Set the acknowledged flag. */
       uip_flags = UIP_ACKDATA;
@@ -1886,6 +2114,9 @@ uip_process(uint8_t flag)
       /* Reset length of outstanding data. */
       uip_connr->len = 0;
     }
+#if UIP_TCP_WINDOW > 1
+    }
+#endif /* UIP_TCP_WINDOW > 1 */
     
   }
 
@@ -1904,6 +2135,10 @@ uip_process(uint8_t flag)
         uip_connr->tcpstateflags = UIP_ESTABLISHED;
         uip_flags = UIP_CONNECTED;
         uip_connr->len = 0;
+#if UIP_TCP_WINDOW > 1
+        uip_connr->snd_wnd = ((uint16_t)UIP_TCP_BUF->wnd[0] << 8) +
+          UIP_TCP_BUF->wnd[1];
+#endif /* UIP_TCP_WINDOW > 1 */
         if(uip_len > 0) {
           uip_flags |= UIP_NEWDATA;
           uip_add_rcv_nxt(uip_len);
@@ -1966,6 +2201,10 @@ uip_process(uint8_t flag)
         uip_add_rcv_nxt(1);
         uip_flags = UIP_CONNECTED | UIP_NEWDATA;
         uip_connr->len = 0;
+#if UIP_TCP_WINDOW > 1
+        uip_connr->snd_wnd = ((uint16_t)UIP_TCP_BUF->wnd[0] << 8) +
+          UIP_TCP_BUF->wnd[1];
+#endif /* UIP_TCP_WINDOW > 1 */
         uip_len = 0;
         uip_slen = 0;
         UIP_APPCALL();
@@ -1991,6 +2230,15 @@ uip_process(uint8_t flag)
          state. We require that there is no outstanding data; otherwise the
          sequence numbers will be screwed up. */
 
+#if UIP_TCP_WINDOW > 1
+      /* The application closed the connection while segments were in
+         flight. Now that all are acknowledged, we send the FIN. */
+      if((uip_connr->wflags & TCP_WF_CLOSE) && !uip_outstanding(uip_connr)) {
+        uip_connr->wflags = 0;
+        goto tcp_send_close;
+      }
+#endif /* UIP_TCP_WINDOW > 1 */
+
       if(UIP_TCP_BUF->flags & TCP_FIN && !(uip_connr->tcpstateflags & UIP_STOPPED)) {
         if(uip_outstanding(uip_connr)) {
           goto drop;
@@ -2053,6 +2301,9 @@ uip_process(uint8_t flag)
          "persistent timer" and uses the retransmission mechanim.
       */
       tmp16 = ((uint16_t)UIP_TCP_BUF->wnd[0] << 8) + (uint16_t)UIP_TCP_BUF->wnd[1];
+#if UIP_TCP_WINDOW > 1
+      uip_connr->snd_wnd = tmp16;
+#endif /* UIP_TCP_WINDOW > 1 */
       if(tmp16 > uip_connr->initialmss ||
          tmp16 == 0) {
         tmp16 = uip_connr->initialmss;
@@ -2075,6 +2326,9 @@ uip_process(uint8_t flag)
          put into the uip_appdata and the length of the data should be
          put into uip_len. If the application don't have any data to
          send, uip_len must be set to 0. */
+#if UIP_TCP_WINDOW > 1
+      window_ack_app(uip_connr);
+#endif /* UIP_TCP_WINDOW > 1 */
       if(uip_flags & (UIP_NEWDATA | UIP_ACKDATA)) {
         uip_slen = 0;
         UIP_APPCALL();
@@ -2090,6 +2344,13 @@ uip_process(uint8_t flag)
 
         if(uip_flags & UIP_CLOSE) {
           uip_slen = 0;
+#if UIP_TCP_WINDOW > 1
+          if(uip_connr->wnum > 0) {
+            uip_connr->wflags |= TCP_WF_CLOSE;
+            goto apprexmit;
+          }
+        tcp_send_close:
+#endif /* UIP_TCP_WINDOW > 1 */
           uip_connr->len = 1;
           uip_connr->tcpstateflags = UIP_FIN_WAIT_1;
           uip_connr->nrtx = 0;
@@ -2097,6 +2358,26 @@ uip_process(uint8_t flag)
           goto tcp_send_nodata;
         }
 
+#if UIP_TCP_WINDOW > 1
+        /* Put the data into the send window if possible, so that the
+           application does not have to wait for the acknowledgement. */
+        if(uip_slen > 0 && (uip_connr->len == 0 || uip_connr->wnum > 0)) {
+          if(uip_slen > uip_connr->mss) {
+            uip_slen = uip_connr->mss;
+          }
+          if(window_open(uip_connr) && window_add(uip_connr)) {
+            uip_len = uip_slen + UIP_TCPIP_HLEN;
+            UIP_TCP_BUF->flags = TCP_ACK | TCP_PSH;
+            goto tcp_send_noopts;
+          }
+          if(uip_connr->wnum > 0) {
+            /* The window is full. The application must wait for
+               UIP_ACKDATA before it sends. */
+            uip_slen = 0;
+          }
+        }
+#endif /* UIP_TCP_WINDOW > 1 */
+
         /* If uip_slen > 0, the application has data to be sent. */
         if(uip_slen > 0) {
 
@@ -2129,6 +2410,11 @@ uip_process(uint8_t flag)
             uip_slen = uip_connr->len;
           }
         }
+#if UIP_TCP_WINDOW > 1
+        /* The retransmissions in a send window count until an
+           acknowledgement makes progress. */
+        if(uip_connr->wnum == 0)
+#endif /* UIP_TCP_WINDOW > 1 */
         uip_connr->nrtx = 0;
       apprexmit:
         uip_appdata = uip_sappdata;
@@ -2242,10 +2528,24 @@ uip_process(uint8_t flag)
   UIP_TCP_BUF->ackno[2] = uip_connr->rcv_nxt[2];
   UIP_TCP_BUF->ackno[3] = uip_connr->rcv_nxt[3];
   
+#if UIP_TCP_WINDOW > 1
+  if(uip_connr->wnum > 0) {
+    /* Segments without data carry the sequence number after the
+       segments in flight. */
+    uip_add32(uip_connr->snd_nxt, uip_len > UIP_TCPIP_HLEN ?
+              wseqoff : uip_connr->len);
+    UIP_TCP_BUF->seqno[0] = uip_acc32[0];
+    UIP_TCP_BUF->seqno[1] = uip_acc32[1];
+    UIP_TCP_BUF->seqno[2] = uip_acc32[2];
+    UIP_TCP_BUF->seqno[3] = uip_acc32[3];
+  } else
+#endif /* UIP_TCP_WINDOW > 1 */
+  {
   UIP_TCP_BUF->seqno[0] = uip_connr->snd_nxt[0];
   UIP_TCP_BUF->seqno[1] = uip_connr->snd_nxt[1];
   UIP_TCP_BUF->seqno[2] = uip_connr->snd_nxt[2];
   UIP_TCP_BUF->seqno[3] = uip_connr->snd_nxt[3];
+  }
 
   UIP_IP_BUF->proto = UIP_PROTO_TCP;
 
@@ -2282,9 +2582,6 @@ uip_process(uint8_t flag)
   UIP_STAT(++uip_stat.tcp.sent);
 
 #endif /* UIP_TCP */
-#if UIP_UDP
- ip_send_nolen:
-#endif
   UIP_IP_BUF->vtc = 0x60;
   UIP_IP_BUF->tcflow = 0x00;
   UIP_IP_BUF->flow = 0x00;
@@ -485,6 +485,34 @@ void uip_log(char *msg);
 #define UIP_TCP_MSS     (UIP_BUFSIZE - UIP_LLH_LEN - UIP_TCPIP_HLEN)
 #endif
 
+/**
+ * The number of TCP segments a connection may have in flight.
+ *
+ * Normally uIP waits for the acknowledgement of a segment before the
+ * application may send the next one, i.e., a connection sends one
+ * segment per round-trip time. With a larger window, the IPv6 stack
+ * copies each segment into a retransmission buffer, retransmits it
+ * from there and lets the application send the next segment right
+ * away. The applications need no changes.
+ *
+ * Each buffer takes UIP_TCP_MSS bytes. UIP_CONF_TCP_WINDOW_BUFFERS of
+ * them, by default enough for one connection, are shared by all
+ * connections.
+ *
+ * \hideinitializer
+ */
+#if defined(UIP_CONF_TCP_WINDOW) && UIP_CONF_IPV6
+#define UIP_TCP_WINDOW (UIP_CONF_TCP_WINDOW)
+#else /* UIP_CONF_TCP_WINDOW */
+#define UIP_TCP_WINDOW 1
+#endif /* UIP_CONF_TCP_WINDOW */
+
+#ifdef UIP_CONF_TCP_WINDOW_BUFFERS
+#define UIP_TCP_WINDOW_BUFFERS (UIP_CONF_TCP_WINDOW_BUFFERS)
+#else /* UIP_CONF_TCP_WINDOW_BUFFERS */
+#define UIP_TCP_WINDOW_BUFFERS UIP_TCP_WINDOW
+#endif /* UIP_CONF_TCP_WINDOW_BUFFERS */
+
 /**
  * The size of the advertised receiver's window.
  *
@@ -570,6 +598,16 @@ void uip_log(char *msg);
 #define SICSLOWPAN_REASS_MAXAGE 20
 #endif
 
+/**
+ * Number of datagrams reassembled at the same time at the 6lowpan
+ * layer, each needs a buffer of UIP_BUFSIZE bytes
+ */
+#ifdef SICSLOWPAN_CONF_REASS_CONTEXTS
+#define SICSLOWPAN_REASS_CONTEXTS (SICSLOWPAN_CONF_REASS_CONTEXTS)
+#else
+#define SICSLOWPAN_REASS_CONTEXTS 1
+#endif
+
 /**
  * Do we compress the IP header or not (default: no)
  */
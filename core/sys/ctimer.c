@@ -65,6 +65,9 @@ PROCESS_THREAD(ctimer_process, ev, data)
   struct ctimer *c;
   PROCESS_BEGIN();
 
+  /* Only handles events posted to it */
+  process_ignore_broadcasts();
+
   for(c = list_head(ctimer_list); c != NULL; c = c->next) {
     etimer_set(&c->etimer, c->etimer.timer.interval);
   }
@@ -103,6 +106,9 @@ ctimer_set(struct ctimer *c, clock_time_t t,
   c->p = PROCESS_CURRENT();
   c->f = f;
   c->ptr = ptr;
+#if PROCESS_CONF_URGENT_NUMEVENTS
+  c->etimer.urgent = 0;
+#endif
   if(initialized) {
     PROCESS_CONTEXT_BEGIN(&ctimer_process);
     etimer_set(&c->etimer, t);
@@ -115,6 +121,16 @@ ctimer_set(struct ctimer *c, clock_time_t t,
   list_add(ctimer_list, c);
 }
 /*---------------------------------------------------------------------------*/
+#if PROCESS_CONF_URGENT_NUMEVENTS
+void
+ctimer_set_urgent(struct ctimer *c, clock_time_t t,
+                  void (*f)(void *), void *ptr)
+{
+  ctimer_set(c, t, f, ptr);
+  c->etimer.urgent = 1;
+}
+#endif /* PROCESS_CONF_URGENT_NUMEVENTS */
+/*---------------------------------------------------------------------------*/
 void
 ctimer_reset(struct ctimer *c)
 {
@@ -113,6 +113,24 @@ void ctimer_restart(struct ctimer *c);
 void ctimer_set(struct ctimer *c, clock_time_t t,
 		void (*f)(void *), void *ptr);
 
+/**
+ * \brief      Set a callback timer whose expiry is an urgent event.
+ *
+ *             Same as ctimer_set(), but the timer event is posted with
+ *             process_post_urgent(), so the callback is not delayed by
+ *             a burst of normal events. Meant for the MAC and radio
+ *             drivers. ctimer_reset() and ctimer_restart() keep the
+ *             priority, ctimer_set() makes the timer normal again.
+ *
+ * \sa ctimer_set()
+ */
+#if PROCESS_CONF_URGENT_NUMEVENTS
+void ctimer_set_urgent(struct ctimer *c, clock_time_t t,
+                       void (*f)(void *), void *ptr);
+#else
+#define ctimer_set_urgent(c, t, f, ptr) ctimer_set(c, t, f, ptr)
+#endif
+
 /**
  * \brief      Stop a pending callback timer.
  * \param c    A pointer to the pending callback timer.
@@ -59,11 +59,18 @@ enum energest_type {
 
   ENERGEST_TYPE_FLASH_READ,
   ENERGEST_TYPE_FLASH_WRITE,
+  /* Flash powered up, i.e. not in deep power-down */
+  ENERGEST_TYPE_FLASH_STANDBY,
 
   ENERGEST_TYPE_SENSORS,
 
   ENERGEST_TYPE_SERIAL,
 
+  /* Peripherals outside the CPU and radio */
+  ENERGEST_TYPE_SDCARD,
+  ENERGEST_TYPE_I2C,
+  ENERGEST_TYPE_ADC,
+
   ENERGEST_TYPE_MAX
 };
 
@@ -90,6 +97,13 @@ extern energest_t energest_leveldevice_current_leveltime[ENERGEST_CONF_LEVELDEVI
                            energest_current_time[type] = RTIMER_NOW(); \
 			   energest_current_mode[type] = 1; \
                            } while(0)
+/* Like ENERGEST_ON(), but keeps the running interval if already on */
+#define ENERGEST_SWITCH_ON(type) do { \
+                           if(energest_current_mode[type] == 0) { \
+                             ENERGEST_ON(type); \
+                           } \
+                           } while(0)
+
 #ifdef __AVR__
 /* Handle 16 bit rtimer wraparound */
 #define ENERGEST_OFF(type) if(energest_current_mode[type] != 0) do {	\
@@ -122,6 +136,7 @@ extern energest_t energest_leveldevice_current_leveltime[ENERGEST_CONF_LEVELDEVI
 
 #else /* ENERGEST_CONF_ON */
 #define ENERGEST_ON(type) do { } while(0)
+#define ENERGEST_SWITCH_ON(type) do { } while(0)
 #define ENERGEST_OFF(type) do { } while(0)
 #define ENERGEST_OFF_LEVEL(type,level) do { } while(0)
 #endif /* ENERGEST_CONF_ON */
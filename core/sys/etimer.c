@@ -49,40 +49,60 @@
 #include "sys/etimer.h"
 #include "sys/process.h"
 
+/* Pending timers, sorted by expiration time. Timers with the same
+   expiration time are kept in the order they were added. */
 static struct etimer *timerlist;
 static clock_time_t next_expiration;
 
+/* Expiration time a lies before b, takes wraps into account */
+#define EXPIRES_BEFORE(a, b) ((clock_time_t)((a) - (b)) > ((clock_time_t)-1 >> 1))
+#define EXPIRATION(t) ((t)->timer.start + (t)->timer.interval)
+
 PROCESS(etimer_process, "Event timer");
 /*---------------------------------------------------------------------------*/
 static void
 update_time(void)
 {
-  clock_time_t tdist;
-  clock_time_t now;
-  struct etimer *t;
+  next_expiration = timerlist == NULL ? 0 : EXPIRATION(timerlist);
+}
+/*---------------------------------------------------------------------------*/
+static void
+insert_timer(struct etimer *timer)
+{
+  struct etimer **t;
+  clock_time_t expiration = EXPIRATION(timer);
 
-  if (timerlist == NULL) {
-    next_expiration = 0;
-  } else {
-    now = clock_time();
-    t = timerlist;
-    /* Must calculate distance to next time into account due to wraps */
-    tdist = t->timer.start + t->timer.interval - now;
-    for(t = t->next; t != NULL; t = t->next) {
-      if(t->timer.start + t->timer.interval - now < tdist) {
-	tdist = t->timer.start + t->timer.interval - now;
-      }
+  for(t = &timerlist; *t != NULL && !EXPIRES_BEFORE(expiration, EXPIRATION(*t));
+      t = &(*t)->next);
+  timer->next = *t;
+  *t = timer;
+}
+/*---------------------------------------------------------------------------*/
+/* Removes the timer from the list, returns 0 if it is not on it. */
+static int
+remove_timer(struct etimer *timer)
+{
+  struct etimer **t;
+
+  for(t = &timerlist; *t != NULL; t = &(*t)->next) {
+    if(*t == timer) {
+      *t = timer->next;
+      timer->next = NULL;
+      return 1;
     }
-    next_expiration = now + tdist;
   }
+  return 0;
 }
 /*---------------------------------------------------------------------------*/
 PROCESS_THREAD(etimer_process, ev, data)
 {
-  struct etimer *t, *u;
+  struct etimer *t;
 	
   PROCESS_BEGIN();
 
+  /* Only handles events posted to it */
+  process_ignore_broadcasts();
+
   timerlist = NULL;
   
   while(1) {
@@ -104,38 +124,36 @@ PROCESS_THREAD(etimer_process, ev, data)
 	    t = t->next;
 	}
       }
+      update_time();
       continue;
     } else if(ev != PROCESS_EVENT_POLL) {
       continue;
     }
 
-  again:
-    
-    u = NULL;
-    
-    for(t = timerlist; t != NULL; t = t->next) {
-      if(timer_expired(&t->timer)) {
-	if(process_post(t->p, PROCESS_EVENT_TIMER, t) == PROCESS_ERR_OK) {
-	  
-	  /* Reset the process ID of the event timer, to signal that the
-	     etimer has expired. This is later checked in the
-	     etimer_expired() function. */
-	  t->p = PROCESS_NONE;
-	  if(u != NULL) {
-	    u->next = t->next;
-	  } else {
-	    timerlist = t->next;
-	  }
-	  t->next = NULL;
-	  update_time();
-	  goto again;
-	} else {
-	  etimer_request_poll();
-	}
+    /* Only the timers at the head of the sorted list can be due */
+    while(timerlist != NULL && timer_expired(&timerlist->timer)) {
+      t = timerlist;
+#if PROCESS_CONF_URGENT_NUMEVENTS
+      if((t->urgent ?
+          process_post_urgent(t->p, PROCESS_EVENT_TIMER, t) :
+          process_post(t->p, PROCESS_EVENT_TIMER, t)) != PROCESS_ERR_OK) {
+#else
+      if(process_post(t->p, PROCESS_EVENT_TIMER, t) != PROCESS_ERR_OK) {
+#endif
+	/* The event queue is full, try again later */
+	etimer_request_poll();
+	break;
       }
-      u = t;
+
+      /* Reset the process ID of the event timer, to signal that the
+	 etimer has expired. This is later checked in the
+	 etimer_expired() function. */
+      t->p = PROCESS_NONE;
+      timerlist = t->next;
+      t->next = NULL;
     }
-    
+    update_time();
+
   }
   
   PROCESS_END();
@@ -150,25 +168,15 @@ etimer_request_poll(void)
 static void
 add_timer(struct etimer *timer)
 {
-  struct etimer *t;
-
   etimer_request_poll();
 
+  /* A timer already on the list moves to its new place */
   if(timer->p != PROCESS_NONE) {
-    for(t = timerlist; t != NULL; t = t->next) {
-      if(t == timer) {
-	/* Timer already on list, bail out. */
-        timer->p = PROCESS_CURRENT();
-	update_time();
-	return;
-      }
-    }
+    remove_timer(timer);
   }
 
-  /* Timer not on list. */
   timer->p = PROCESS_CURRENT();
-  timer->next = timerlist;
-  timerlist = timer;
+  insert_timer(timer);
 
   update_time();
 }
@@ -198,6 +206,9 @@ void
 etimer_adjust(struct etimer *et, int timediff)
 {
   et->timer.start += timediff;
+  if(et->p != PROCESS_NONE && remove_timer(et)) {
+    insert_timer(et);
+  }
   update_time();
 }
 /*---------------------------------------------------------------------------*/
@@ -234,29 +245,10 @@ etimer_next_expiration_time(void)
 void
 etimer_stop(struct etimer *et)
 {
-  struct etimer *t;
-
-  /* First check if et is the first event timer on the list. */
-  if(et == timerlist) {
-    timerlist = timerlist->next;
+  if(remove_timer(et)) {
     update_time();
-  } else {
-    /* Else walk through the list and try to find the item before the
-       et timer. */
-    for(t = timerlist; t != NULL && t->next != et; t = t->next);
-
-    if(t != NULL) {
-      /* We've found the item before the event timer that we are about
-	 to remove. We point the items next pointer to the event after
-	 the removed item. */
-      t->next = et->next;
-
-      update_time();
-    }
   }
 
-  /* Remove the next pointer from the item to be removed. */
-  et->next = NULL;
   /* Set the timer as expired */
   et->p = PROCESS_NONE;
 }
@@ -77,6 +77,10 @@ struct etimer {
   struct timer timer;
   struct etimer *next;
   struct process *p;
+#if PROCESS_CONF_URGENT_NUMEVENTS
+  /** Post the timer event with process_post_urgent(), see ctimer_set_urgent() */
+  unsigned char urgent;
+#endif
 };
 
 /**
@@ -51,6 +51,9 @@
 #define MT_STATE_EXITED  5
 
 static struct mt_thread *current;
+#if MT_CONF_THREAD_LIST
+static struct mt_thread *threads;
+#endif
 
 /*--------------------------------------------------------------------------*/
 void
@@ -73,6 +76,18 @@ mt_start(struct mt_thread *thread, void (* function)(void *), void *data)
   mtarch_start(&thread->thread, function, data);
 
   thread->state = MT_STATE_READY;
+
+#if MT_CONF_THREAD_LIST
+  {
+    struct mt_thread *t;
+
+    for(t = threads; t != NULL && t != thread; t = t->next);
+    if(t == NULL) {
+      thread->next = threads;
+      threads = thread;
+    }
+  }
+#endif /* MT_CONF_THREAD_LIST */
 }
 /*--------------------------------------------------------------------------*/
 void
@@ -113,5 +128,26 @@ void
 mt_stop(struct mt_thread *thread)
 {
   mtarch_stop(&thread->thread);
+
+#if MT_CONF_THREAD_LIST
+  {
+    struct mt_thread **t;
+
+    for(t = &threads; *t != NULL; t = &(*t)->next) {
+      if(*t == thread) {
+        *t = thread->next;
+        break;
+      }
+    }
+  }
+#endif /* MT_CONF_THREAD_LIST */
+}
+/*--------------------------------------------------------------------------*/
+#if MT_CONF_THREAD_LIST
+struct mt_thread *
+mt_threads(void)
+{
+  return threads;
 }
 /*--------------------------------------------------------------------------*/
+#endif /* MT_CONF_THREAD_LIST */
@@ -178,11 +178,22 @@ void mtarch_pstop(void);
 
 #include "mtarch.h"
 
+/**
+ * Keeps all started threads in a list, see mt_threads(). Used to
+ * report the stack usage of each thread.
+ */
+#ifndef MT_CONF_THREAD_LIST
+#define MT_CONF_THREAD_LIST 0
+#endif
+
 struct mt_thread {
   int state;
   process_event_t *evptr;
   process_data_t *dataptr;
   struct mtarch_thread thread;
+#if MT_CONF_THREAD_LIST
+  struct mt_thread *next;
+#endif
 };
 
 /**
@@ -265,6 +276,14 @@ void mt_exit(void);
  */
 void mt_stop(struct mt_thread *thread);
 
+#if MT_CONF_THREAD_LIST
+/**
+ * Get the first thread that was started and not stopped, follow the
+ * next member for the others.
+ */
+struct mt_thread *mt_threads(void);
+#endif /* MT_CONF_THREAD_LIST */
+
 /** @} */
 /** @} */
 #endif /* MT_H_ */
@@ -0,0 +1,103 @@
+/**
+ * \addtogroup sys
+ * @{
+ */
+
+/**
+ * \defgroup pgm Constant data in program memory
+ * @{
+ *
+ * On Harvard CPUs like the AVR, initialized const data is copied into
+ * RAM at startup unless it is placed in program memory. Tables and
+ * strings declared with #PGM and literals wrapped in PGM_STR() stay in
+ * flash, and must then only be accessed with the macros below. On all
+ * other CPUs the macros map to plain C.
+ *
+ * \code
+ * static const uint8_t table[] PGM = { 1, 2, 3 };
+ * x = PGM_READ_BYTE(&table[i]);
+ * printf("%u: " PGM_FMT_S "\n", i, PGM_STR("flash string"));
+ * \endcode
+ */
+
+/**
+ * \file
+ *         Constant tables and strings in program memory
+ */
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef PGM_H_
+#define PGM_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+
+/** Places a const variable in program memory */
+#define PGM                        PROGMEM
+/** A string literal in program memory, only usable inside functions */
+#define PGM_STR(s)                 PSTR(s)
+/** printf() conversion of a string in program memory */
+#define PGM_FMT_S                  "%S"
+
+#define PGM_READ_BYTE(p)           pgm_read_byte(p)
+#define PGM_READ_WORD(p)           pgm_read_word(p)
+#define PGM_MEMCPY(dst, src, n)    memcpy_P(dst, src, n)
+#define PGM_STRLEN(s)              strlen_P(s)
+#define PGM_STRNCPY(dst, src, n)   strncpy_P(dst, src, n)
+/** Compares the RAM string \e s with the string \e p in program memory */
+#define PGM_STRCMP(s, p)           strcmp_P(s, p)
+#define PGM_STRNCMP(s, p, n)       strncmp_P(s, p, n)
+
+#else /* __AVR__ */
+
+#define PGM
+#define PGM_STR(s)                 (s)
+#define PGM_FMT_S                  "%s"
+
+#define PGM_READ_BYTE(p)           (*(const uint8_t *)(p))
+#define PGM_READ_WORD(p)           (*(const uint16_t *)(p))
+#define PGM_MEMCPY(dst, src, n)    memcpy(dst, src, n)
+#define PGM_STRLEN(s)              strlen(s)
+#define PGM_STRNCPY(dst, src, n)   strncpy(dst, src, n)
+#define PGM_STRCMP(s, p)           strcmp(s, p)
+#define PGM_STRNCMP(s, p, n)       strncmp(s, p, n)
+
+#endif /* __AVR__ */
+
+/** Reads a character of a string in program memory */
+#define PGM_READ_CHAR(p)           ((char)PGM_READ_BYTE(p))
+
+#endif /* PGM_H_ */
+
+/** @} */
+/** @} */
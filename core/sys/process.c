@@ -47,6 +47,9 @@
 
 #include "sys/process.h"
 #include "sys/arg.h"
+#if PROCESS_CONF_CPU_STATS
+#include "sys/rtimer.h"
+#endif
 
 /*
  * Pointer to the currently running process structure.
@@ -65,8 +68,29 @@ struct event_data {
   struct process *p;
 };
 
-static process_num_events_t nevents, fevent;
+/*
+ * A ring of events for each priority, nevents counts all of them.
+ */
+struct event_queue {
+  struct event_data *events;
+  process_num_events_t size, nevents, fevent;
+};
+
 static struct event_data events[PROCESS_CONF_NUMEVENTS];
+#if PROCESS_CONF_URGENT_NUMEVENTS
+static struct event_data urgent_events[PROCESS_CONF_URGENT_NUMEVENTS];
+#endif
+
+static struct event_queue queues[PROCESS_PRIORITIES] = {
+  { events, PROCESS_CONF_NUMEVENTS },
+#if PROCESS_CONF_URGENT_NUMEVENTS
+  { urgent_events, PROCESS_CONF_URGENT_NUMEVENTS },
+#endif
+};
+
+static process_num_events_t nevents;
+
+unsigned short process_overflows[PROCESS_PRIORITIES];
 
 #if PROCESS_CONF_STATS
 process_num_events_t process_maxevents;
@@ -74,12 +98,24 @@ process_num_events_t process_maxevents;
 
 static volatile unsigned char poll_requested;
 
+#if PROCESS_CONF_CPU_STATS
+/* Ticks spent in nested calls during the current call_process() */
+static rtimer_clock_t cpu_nested;
+#endif
+
 #define PROCESS_STATE_NONE        0
 #define PROCESS_STATE_RUNNING     1
 #define PROCESS_STATE_CALLED      2
 
 static void call_process(struct process *p, process_event_t ev, process_data_t data);
 
+#if PROCESS_CONF_SUBSCRIPTIONS
+/* Processes that get every broadcast event, linked by next_broadcast */
+static struct process *broadcast_list;
+/* The subscriptions of all processes, grouped by event */
+static struct process_subscription *subscription_list;
+#endif
+
 #define DEBUG 0
 #if DEBUG
 #include <stdio.h>
@@ -95,6 +131,35 @@ process_alloc_event(void)
   return lastevent++;
 }
 /*---------------------------------------------------------------------------*/
+#if PROCESS_CONF_SUBSCRIPTIONS
+static void
+stop_broadcasts(struct process *p)
+{
+  struct process **pp;
+
+  for(pp = &broadcast_list; *pp != NULL; pp = &(*pp)->next_broadcast) {
+    if(*pp == p) {
+      *pp = p->next_broadcast;
+      break;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_subscriptions(struct process *p)
+{
+  struct process_subscription **sp;
+
+  for(sp = &subscription_list; *sp != NULL;) {
+    if((*sp)->p == p) {
+      *sp = (*sp)->next;
+    } else {
+      sp = &(*sp)->next;
+    }
+  }
+}
+#endif /* PROCESS_CONF_SUBSCRIPTIONS */
+/*---------------------------------------------------------------------------*/
 void
 process_start(struct process *p, const char *arg)
 {
@@ -113,6 +178,14 @@ process_start(struct process *p, const char *arg)
   process_list = p;
   p->state = PROCESS_STATE_RUNNING;
   PT_INIT(&p->pt);
+#if PROCESS_CONF_SUBSCRIPTIONS
+  p->next_broadcast = broadcast_list;
+  broadcast_list = p;
+#endif
+#if PROCESS_CONF_CPU_STATS
+  p->cpu_time = p->cpu_mark = 0;
+  p->cpu_events = 0;
+#endif
 
   PRINTF("process: starting '%s'\n", PROCESS_NAME_STRING(p));
 
@@ -157,6 +230,11 @@ exit_process(struct process *p, struct process *fromprocess)
     }
   }
 
+#if PROCESS_CONF_SUBSCRIPTIONS
+  stop_broadcasts(p);
+  remove_subscriptions(p);
+#endif
+
   if(p == process_list) {
     process_list = process_list->next;
   } else {
@@ -175,6 +253,9 @@ static void
 call_process(struct process *p, process_event_t ev, process_data_t data)
 {
   int ret;
+#if PROCESS_CONF_CPU_STATS
+  rtimer_clock_t start, elapsed, outer;
+#endif
 
 #if DEBUG
   if(p->state == PROCESS_STATE_CALLED) {
@@ -187,7 +268,18 @@ call_process(struct process *p, process_event_t ev, process_data_t data)
     PRINTF("process: calling process '%s' with event %d\n", PROCESS_NAME_STRING(p), ev);
     process_current = p;
     p->state = PROCESS_STATE_CALLED;
+#if PROCESS_CONF_CPU_STATS
+    outer = cpu_nested;
+    cpu_nested = 0;
+    start = RTIMER_NOW();
+#endif
     ret = p->thread(&p->pt, ev, data);
+#if PROCESS_CONF_CPU_STATS
+    elapsed = RTIMER_NOW() - start;
+    p->cpu_time += (rtimer_clock_t)(elapsed - cpu_nested);
+    p->cpu_events++;
+    cpu_nested = outer + elapsed;
+#endif
     if(ret == PT_EXITED ||
        ret == PT_ENDED ||
        ev == PROCESS_EVENT_EXIT) {
@@ -207,9 +299,15 @@ process_exit(struct process *p)
 void
 process_init(void)
 {
+  int i;
+
   lastevent = PROCESS_EVENT_MAX;
 
-  nevents = fevent = 0;
+  nevents = 0;
+  for(i = 0; i < PROCESS_PRIORITIES; i++) {
+    queues[i].nevents = queues[i].fevent = 0;
+    process_overflows[i] = 0;
+  }
 #if PROCESS_CONF_STATS
   process_maxevents = 0;
 #endif /* PROCESS_CONF_STATS */
@@ -237,6 +335,36 @@ do_poll(void)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if PROCESS_CONF_SUBSCRIPTIONS
+/* Deliver a broadcast event to the processes that get all of them and
+   to the subscribers of the event. */
+static void
+do_broadcast(process_event_t ev, process_data_t data)
+{
+  static struct process *p, *next;
+  static struct process_subscription *s, *next_s;
+
+  for(p = broadcast_list; p != NULL; p = next) {
+    /* The process may leave the list while it is called. */
+    next = p->next_broadcast;
+    if(poll_requested) {
+      do_poll();
+    }
+    call_process(p, ev, data);
+  }
+
+  /* The subscriptions to an event are kept next to each other. */
+  for(s = subscription_list; s != NULL && s->ev != ev; s = s->next);
+  for(; s != NULL && s->ev == ev; s = next_s) {
+    next_s = s->next;
+    if(poll_requested) {
+      do_poll();
+    }
+    call_process(s->p, ev, data);
+  }
+}
+#endif /* PROCESS_CONF_SUBSCRIPTIONS */
+/*---------------------------------------------------------------------------*/
 /*
  * Process the next event in the event queue and deliver it to
  * listening processes.
@@ -248,7 +376,10 @@ do_event(void)
   static process_event_t ev;
   static process_data_t data;
   static struct process *receiver;
+#if !PROCESS_CONF_SUBSCRIPTIONS
   static struct process *p;
+#endif
+  static struct event_queue *q;
   
   /*
    * If there are any events in the queue, take the first one and walk
@@ -259,21 +390,33 @@ do_event(void)
    */
 
   if(nevents > 0) {
+
+    /* Urgent events are delivered first. */
+    q = &queues[PROCESS_PRIORITIES - 1];
+    while(q->nevents == 0) {
+      --q;
+    }
     
     /* There are events that we should deliver. */
-    ev = events[fevent].ev;
+    ev = q->events[q->fevent].ev;
     
-    data = events[fevent].data;
-    receiver = events[fevent].p;
+    data = q->events[q->fevent].data;
+    receiver = q->events[q->fevent].p;
 
     /* Since we have seen the new event, we move pointer upwards
        and decrese the number of events. */
-    fevent = (fevent + 1) % PROCESS_CONF_NUMEVENTS;
+    if(++q->fevent == q->size) {
+      q->fevent = 0;
+    }
+    --q->nevents;
     --nevents;
 
     /* If this is a broadcast event, we deliver it to all events, in
        order of their priority. */
     if(receiver == PROCESS_BROADCAST) {
+#if PROCESS_CONF_SUBSCRIPTIONS
+      do_broadcast(ev, data);
+#else
       for(p = process_list; p != NULL; p = p->next) {
 
 	/* If we have been requested to poll a process, we do this in
@@ -283,6 +426,7 @@ do_event(void)
 	}
 	call_process(p, ev, data);
       }
+#endif /* PROCESS_CONF_SUBSCRIPTIONS */
     } else {
       /* This is not a broadcast event, so we deliver it to the
 	 specified process. */
@@ -318,8 +462,8 @@ process_nevents(void)
   return nevents + poll_requested;
 }
 /*---------------------------------------------------------------------------*/
-int
-process_post(struct process *p, process_event_t ev, process_data_t data)
+static int
+post(struct event_queue *q, struct process *p, process_event_t ev, process_data_t data)
 {
   static process_num_events_t snum;
 
@@ -332,7 +476,8 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
 	   p == PROCESS_BROADCAST? "<broadcast>": PROCESS_NAME_STRING(p), nevents);
   }
   
-  if(nevents == PROCESS_CONF_NUMEVENTS) {
+  if(q->nevents == q->size) {
+    process_overflows[q - queues]++;
 #if DEBUG
     if(p == PROCESS_BROADCAST) {
       printf("soft panic: event queue is full when broadcast event %d was posted from %s\n", ev, PROCESS_NAME_STRING(process_current));
@@ -343,10 +488,14 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
     return PROCESS_ERR_FULL;
   }
   
-  snum = (process_num_events_t)(fevent + nevents) % PROCESS_CONF_NUMEVENTS;
-  events[snum].ev = ev;
-  events[snum].data = data;
-  events[snum].p = p;
+  snum = q->fevent + q->nevents;
+  if(snum >= q->size) {
+    snum -= q->size;
+  }
+  q->events[snum].ev = ev;
+  q->events[snum].data = data;
+  q->events[snum].p = p;
+  ++q->nevents;
   ++nevents;
 
 #if PROCESS_CONF_STATS
@@ -358,6 +507,20 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
   return PROCESS_ERR_OK;
 }
 /*---------------------------------------------------------------------------*/
+int
+process_post(struct process *p, process_event_t ev, process_data_t data)
+{
+  return post(&queues[PROCESS_PRIO_NORMAL], p, ev, data);
+}
+/*---------------------------------------------------------------------------*/
+#if PROCESS_CONF_URGENT_NUMEVENTS
+int
+process_post_urgent(struct process *p, process_event_t ev, process_data_t data)
+{
+  return post(&queues[PROCESS_PRIO_URGENT], p, ev, data);
+}
+#endif
+/*---------------------------------------------------------------------------*/
 void
 process_post_synch(struct process *p, process_event_t ev, process_data_t data)
 {
@@ -367,6 +530,45 @@ process_post_synch(struct process *p, process_event_t ev, process_data_t data)
   process_current = caller;
 }
 /*---------------------------------------------------------------------------*/
+#if PROCESS_CONF_SUBSCRIPTIONS
+void
+process_subscribe(struct process_subscription *s, process_event_t ev)
+{
+  struct process_subscription **sp;
+
+  process_unsubscribe(s);
+  s->p = PROCESS_CURRENT();
+  s->ev = ev;
+
+  /* Keep the subscriptions to the same event together. */
+  for(sp = &subscription_list; *sp != NULL && (*sp)->ev != ev;
+      sp = &(*sp)->next);
+  s->next = *sp;
+  *sp = s;
+
+  stop_broadcasts(s->p);
+}
+/*---------------------------------------------------------------------------*/
+void
+process_unsubscribe(struct process_subscription *s)
+{
+  struct process_subscription **sp;
+
+  for(sp = &subscription_list; *sp != NULL; sp = &(*sp)->next) {
+    if(*sp == s) {
+      *sp = s->next;
+      break;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+process_ignore_broadcasts(void)
+{
+  stop_broadcasts(PROCESS_CURRENT());
+}
+#endif /* PROCESS_CONF_SUBSCRIPTIONS */
+/*---------------------------------------------------------------------------*/
 void
 process_poll(struct process *p)
 {
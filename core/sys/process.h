@@ -88,6 +88,48 @@ typedef unsigned char process_num_events_t;
 #define PROCESS_CONF_NUMEVENTS 32
 #endif /* PROCESS_CONF_NUMEVENTS */
 
+/*
+ * Size of a second event queue for urgent events, posted with
+ * process_post_urgent() and delivered before all normal events. 0
+ * disables it, process_post_urgent() is then the same as process_post().
+ */
+#ifndef PROCESS_CONF_URGENT_NUMEVENTS
+#define PROCESS_CONF_URGENT_NUMEVENTS 0
+#endif /* PROCESS_CONF_URGENT_NUMEVENTS */
+
+/*
+ * Measures the time every process spends handling events, in rtimer
+ * ticks, and counts the events it handled. Time spent in processes
+ * called synchronously from another process is only charged to the
+ * callee. Shown by the top shell command.
+ */
+#ifndef PROCESS_CONF_CPU_STATS
+#define PROCESS_CONF_CPU_STATS 0
+#endif /* PROCESS_CONF_CPU_STATS */
+
+/*
+ * Lets processes subscribe to the broadcast events they handle with
+ * process_subscribe(). Broadcast events are then no longer delivered
+ * to them unless subscribed. Processes that never subscribe still get
+ * every broadcast event. Costs a pointer in every struct process.
+ */
+#ifndef PROCESS_CONF_SUBSCRIPTIONS
+#define PROCESS_CONF_SUBSCRIPTIONS 0
+#endif /* PROCESS_CONF_SUBSCRIPTIONS */
+
+/**
+ * \name Event priorities
+ * @{
+ */
+#define PROCESS_PRIO_NORMAL   0
+#define PROCESS_PRIO_URGENT   1
+#if PROCESS_CONF_URGENT_NUMEVENTS
+#define PROCESS_PRIORITIES    2
+#else
+#define PROCESS_PRIORITIES    1
+#endif
+/* @} */
+
 #define PROCESS_EVENT_NONE            0x80
 #define PROCESS_EVENT_INIT            0x81
 #define PROCESS_EVENT_POLL            0x82
@@ -323,6 +365,18 @@ struct process {
   PT_THREAD((* thread)(struct pt *, process_event_t, process_data_t));
   struct pt pt;
   unsigned char state, needspoll;
+#if PROCESS_CONF_SUBSCRIPTIONS
+  /** Next process that gets every broadcast event */
+  struct process *next_broadcast;
+#endif /* PROCESS_CONF_SUBSCRIPTIONS */
+#if PROCESS_CONF_CPU_STATS
+  /** rtimer ticks spent handling events since the process was started */
+  unsigned long cpu_time;
+  /** Value of cpu_time at the last sample of the top command */
+  unsigned long cpu_mark;
+  /** Number of events handled */
+  unsigned short cpu_events;
+#endif /* PROCESS_CONF_CPU_STATS */
 };
 
 /**
@@ -364,6 +418,34 @@ CCIF void process_start(struct process *p, const char *arg);
  */
 CCIF int process_post(struct process *p, process_event_t ev, void* data);
 
+#if PROCESS_CONF_URGENT_NUMEVENTS
+/**
+ * Post an asynchronous event that is delivered before all events
+ * posted with process_post(). Meant for network and radio events that
+ * must not wait behind a burst of sensor or application events.
+ *
+ * \param p The process to which the event should be posted, or
+ * PROCESS_BROADCAST.
+ *
+ * \param ev The event to be posted.
+ *
+ * \param data The auxiliary data to be sent with the event
+ *
+ * \retval PROCESS_ERR_OK The event could be posted.
+ *
+ * \retval PROCESS_ERR_FULL The urgent event queue was full.
+ */
+CCIF int process_post_urgent(struct process *p, process_event_t ev, void* data);
+#else
+#define process_post_urgent(p, ev, data) process_post(p, ev, data)
+#endif
+
+/**
+ * Number of events that could not be posted because the queue was
+ * full, indexed by PROCESS_PRIO_NORMAL or PROCESS_PRIO_URGENT.
+ */
+CCIF extern unsigned short process_overflows[PROCESS_PRIORITIES];
+
 /**
  * Post a synchronous event to a process.
  *
@@ -377,6 +459,56 @@ CCIF int process_post(struct process *p, process_event_t ev, void* data);
 CCIF void process_post_synch(struct process *p,
 			     process_event_t ev, void* data);
 
+#if PROCESS_CONF_SUBSCRIPTIONS
+/**
+ * A subscription of a process to a broadcast event, allocated by the
+ * caller, e.g. as a static variable of the process.
+ */
+struct process_subscription {
+  struct process_subscription *next;
+  struct process *p;
+  process_event_t ev;
+};
+
+/**
+ * Declare a static subscription for process_subscribe(). Declares
+ * nothing that takes memory without PROCESS_CONF_SUBSCRIPTIONS.
+ */
+#define PROCESS_SUBSCRIPTION(name) static struct process_subscription name
+
+/**
+ * Subscribe the current process to a broadcast event.
+ *
+ * From now on, the process only receives the broadcast events it
+ * subscribed to. Events posted to the process itself are always
+ * delivered. The subscriptions end when the process exits.
+ *
+ * \param s The subscription, must stay valid until it is removed.
+ *
+ * \param ev The event.
+ */
+CCIF void process_subscribe(struct process_subscription *s, process_event_t ev);
+
+/**
+ * Remove a subscription of the current process.
+ *
+ * \param s The subscription passed to process_subscribe().
+ */
+CCIF void process_unsubscribe(struct process_subscription *s);
+
+/**
+ * Stop delivering broadcast events to the current process, unless it
+ * subscribes to them. Meant for services that only handle events
+ * posted to them.
+ */
+CCIF void process_ignore_broadcasts(void);
+#else /* PROCESS_CONF_SUBSCRIPTIONS */
+#define PROCESS_SUBSCRIPTION(name) extern struct process_subscription name
+#define process_subscribe(s, ev)
+#define process_unsubscribe(s)
+#define process_ignore_broadcasts()
+#endif /* PROCESS_CONF_SUBSCRIPTIONS */
+
 /**
  * \brief      Cause a process to exit
  * \param p    The process that is to be exited
@@ -55,7 +55,15 @@
 #define PRINTF(...)
 #endif
 
+#if RTIMER_MULTIPLE
+/* Pending tasks sorted by time, tasks with the same time in the order
+   they were set */
+static struct rtimer *queue;
+static uint8_t running;
+static uint16_t late;
+#else
 static struct rtimer *next_rtimer;
+#endif
 
 /*---------------------------------------------------------------------------*/
 void
@@ -64,6 +72,109 @@ rtimer_init(void)
   rtimer_arch_init();
 }
 /*---------------------------------------------------------------------------*/
+#if RTIMER_MULTIPLE
+/* Removes the task from the queue, call with the queue locked */
+static int
+unlink_task(struct rtimer *task)
+{
+  struct rtimer **t;
+
+  for(t = &queue; *t != NULL; t = &(*t)->next) {
+    if(*t == task) {
+      *t = task->next;
+      task->next = NULL;
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+rtimer_set(struct rtimer *rtimer, rtimer_clock_t time,
+	   rtimer_clock_t duration,
+	   rtimer_callback_t func, void *ptr)
+{
+  struct rtimer **t;
+  RTIMER_ARCH_LOCK();
+
+  PRINTF("rtimer_set time %d\n", time);
+
+  /* Setting a pending task again moves it */
+  unlink_task(rtimer);
+
+  rtimer->func = func;
+  rtimer->ptr = ptr;
+  rtimer->time = time;
+
+  for(t = &queue; *t != NULL && !RTIMER_CLOCK_LT(time, (*t)->time);
+      t = &(*t)->next);
+  rtimer->next = *t;
+  *t = rtimer;
+
+  /* rtimer_run_next() schedules the head itself when it is done */
+  if(queue == rtimer && !running) {
+    rtimer_arch_schedule(time);
+  }
+
+  RTIMER_ARCH_UNLOCK();
+  return RTIMER_OK;
+}
+/*---------------------------------------------------------------------------*/
+int
+rtimer_cancel(struct rtimer *task)
+{
+  int removed;
+  RTIMER_ARCH_LOCK();
+
+  removed = unlink_task(task);
+  /* A compare left for a removed head finds nothing due */
+
+  RTIMER_ARCH_UNLOCK();
+  return removed;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+rtimer_late_count(void)
+{
+  return late;
+}
+/*---------------------------------------------------------------------------*/
+void
+rtimer_run_next(void)
+{
+  struct rtimer *t;
+  rtimer_clock_t now;
+
+  running = 1;
+  while(1) {
+    RTIMER_ARCH_LOCK();
+    t = queue;
+    now = RTIMER_NOW();
+    /* Also ends a compare match of a cancelled or moved task */
+    if(t == NULL || RTIMER_CLOCK_LT(now + RTIMER_GUARD_TIME, t->time)) {
+      RTIMER_ARCH_UNLOCK();
+      break;
+    }
+    if(RTIMER_CLOCK_LT(t->time + RTIMER_GUARD_TIME, now)) {
+      late++;
+    }
+    queue = t->next;
+    t->next = NULL;
+    RTIMER_ARCH_UNLOCK();
+
+    t->func(t, t->ptr);
+  }
+  running = 0;
+
+  RTIMER_ARCH_LOCK();
+  if(queue != NULL) {
+    rtimer_arch_schedule(queue->time);
+  }
+  RTIMER_ARCH_UNLOCK();
+}
+/*---------------------------------------------------------------------------*/
+#else /* RTIMER_MULTIPLE */
+
 int
 rtimer_set(struct rtimer *rtimer, rtimer_clock_t time,
 	   rtimer_clock_t duration,
@@ -105,3 +216,5 @@ rtimer_run_next(void)
   return;
 }
 /*---------------------------------------------------------------------------*/
+#endif /* RTIMER_MULTIPLE */
+/*---------------------------------------------------------------------------*/
@@ -62,6 +62,35 @@ typedef unsigned short rtimer_clock_t;
 
 #include "rtimer-arch.h"
 
+/*
+ * Keep a queue of real-time tasks sorted by time instead of a single
+ * pending one. The architecture only needs to provide the single compare
+ * of rtimer_arch_schedule().
+ */
+#ifdef RTIMER_CONF_MULTIPLE
+#define RTIMER_MULTIPLE RTIMER_CONF_MULTIPLE
+#else
+#define RTIMER_MULTIPLE 0
+#endif
+
+/*
+ * Tasks due within this many ticks of each other run in the same
+ * interrupt, as there is no time to reprogram the compare in between. A
+ * task that runs more than this late is counted by rtimer_late_count().
+ */
+#ifdef RTIMER_CONF_GUARD_TIME
+#define RTIMER_GUARD_TIME RTIMER_CONF_GUARD_TIME
+#else
+#define RTIMER_GUARD_TIME 2
+#endif
+
+/* Protects the task queue from the rtimer interrupt, may be provided by
+   rtimer-arch.h */
+#ifndef RTIMER_ARCH_LOCK
+#define RTIMER_ARCH_LOCK()
+#define RTIMER_ARCH_UNLOCK()
+#endif
+
 /**
  * \brief      Initialize the real-time scheduler.
  *
@@ -85,6 +114,9 @@ struct rtimer {
   rtimer_clock_t time;
   rtimer_callback_t func;
   void *ptr;
+#if RTIMER_MULTIPLE
+  struct rtimer *next;
+#endif
 };
 
 enum {
@@ -120,6 +152,21 @@ int rtimer_set(struct rtimer *task, rtimer_clock_t time,
  */
 void rtimer_run_next(void);
 
+#if RTIMER_MULTIPLE
+/**
+ * \brief      Remove a real-time task from the queue
+ * \param task The task
+ * \return     Non-zero if the task was scheduled and has been removed
+ */
+int rtimer_cancel(struct rtimer *task);
+
+/**
+ * \brief      Get the number of tasks that ran too late
+ * \return     Tasks executed more than RTIMER_GUARD_TIME ticks after their time
+ */
+uint16_t rtimer_late_count(void);
+#endif /* RTIMER_MULTIPLE */
+
 /**
  * \brief      Get the current clock time
  * \return     The current time
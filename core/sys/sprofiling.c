@@ -39,6 +39,7 @@
 
 #include "contiki.h"
 #include "sys/sprofiling.h"
+#include "lib/crc16.h"
 
 #ifdef SPROFILES_CONF_MAX
 #define MAX_PROFILES SPROFILES_CONF_MAX
@@ -69,6 +70,46 @@ void sprofiling_report(const char* name, uint8_t pretty)
 	}
 }
 
+static uint16_t put_le(uint32_t v, uint8_t len, uint16_t crc)
+{
+	for (; len > 0; len--) {
+		sprofiling_arch_putc(v & 0xff);
+		crc = crc16_add(v & 0xff, crc);
+		v >>= 8;
+	}
+	return crc;
+}
+
+/*
+ * Compact report for tools/profiling/sprof-report.py: "\nSPROFB", then
+ * little endian u16 sites, u32 samples, u16 pc and u16 calls per site
+ * and a CRC-16 over everything after the marker. Written raw with
+ * sprofiling_arch_putc(), so no newline translation corrupts it.
+ */
+void sprofiling_report_binary(void)
+{
+	const char *marker = "\nSPROFB";
+	uint16_t crc = 0;
+	uint16_t i;
+
+	while (*marker) {
+		sprofiling_arch_putc(*marker++);
+	}
+	crc = put_le(stat_profile.num_sites, 2, crc);
+	crc = put_le(stat_profile.num_samples, 4, crc);
+	for (i = 0; i < stat_profile.num_sites; i++) {
+		crc = put_le((uint16_t)stat_profile.sites[i].addr, 2, crc);
+		crc = put_le(stat_profile.sites[i].calls, 2, crc);
+	}
+	put_le(crc, 2, 0);
+}
+
+void sprofiling_reset(void)
+{
+	stat_profile.num_sites = 0;
+	stat_profile.num_samples = 0;
+}
+
 struct sprofile_t *sprofiling_get()
 {
 	return &stat_profile;
@@ -22,12 +22,15 @@ void sprofiling_init(void);
 void sprofiling_start(void);
 void sprofiling_stop(void);
 void sprofiling_report(const char* name, uint8_t pretty);
+void sprofiling_report_binary(void);
+void sprofiling_reset(void);
 struct sprofile_t *sprofiling_get(void);
 inline void sprofiling_add_sample(void *pc);
 
 /* Arch functions */
 void sprofiling_arch_init(void);
 inline void sprofiling_arch_start(void);
+void sprofiling_arch_putc(uint8_t c);
 inline void sprofiling_arch_stop(void);
 
 #endif /* __SPROFILING_H__ */
@@ -322,4 +322,25 @@
 #error "Setup CPU in clock-avr.h"
 #endif
 
+#if AVR_CONF_USE32KCRYSTAL && defined (__AVR_ATmega1284P__)
+/* TIMER2 keeps counting from the crystal in power-save mode, so the clock
+   can sleep through ticks without an etimer due. */
+#define CLOCK_IDLE_MAX 256
+/* TIMER2 prescaler for one count per tick while idle */
+#if CLOCK_CONF_SECOND == 32
+#define CLOCK_IDLE_PRESCALE (_BV(CS22) | _BV(CS21) | _BV(CS20))
+#elif CLOCK_CONF_SECOND == 128
+#define CLOCK_IDLE_PRESCALE (_BV(CS22) | _BV(CS21))
+#elif CLOCK_CONF_SECOND == 256
+#define CLOCK_IDLE_PRESCALE (_BV(CS22) | _BV(CS20))
+#elif CLOCK_CONF_SECOND == 512
+#define CLOCK_IDLE_PRESCALE _BV(CS22)
+#elif CLOCK_CONF_SECOND == 1024
+#define CLOCK_IDLE_PRESCALE (_BV(CS21) | _BV(CS20))
+#else
+#error "clock_idle() needs a CLOCK_CONF_SECOND of 32, 128, 256, 512 or 1024"
+#endif
+clock_time_t clock_idle(clock_time_t ticks);
+#endif
+
 #endif //CONTIKI_CLOCK_AVR_H
@@ -71,6 +71,17 @@
 #include <avr/io.h>
 #include <avr/interrupt.h>
 
+#ifdef CLOCK_IDLE_MAX
+#include <avr/sleep.h>
+#include "sys/process.h"
+#include "sys/energest.h"
+#include "dev/watchdog.h"
+#include "isr-stats.h"
+
+/* Set by every tick interrupt, tells clock_idle() why it woke up */
+static volatile uint8_t idle_tick;
+#endif
+
 /* Two tick counters avoid a software divide when CLOCK_SECOND is not a power of two. */
 #if CLOCK_SECOND && (CLOCK_SECOND - 1)
 #define TWO_COUNTERS 1
@@ -307,6 +318,95 @@ clock_adjust_ticks(clock_time_t howmany)
   SREG=sreg;
 }
 /*---------------------------------------------------------------------------*/
+#ifdef CLOCK_IDLE_MAX
+/**
+ * Sleep in power-save mode for up to CLOCK_IDLE_MAX ticks.
+ * \param ticks   How many ticks to sleep at most
+ * \return        The number of ticks slept
+ *
+ * TIMER2 is switched to one count per tick and its compare match ends the
+ * sleep, any other interrupt ends it early. The clock is adjusted for the
+ * ticks slept. The part of the current tick that passed before the sleep
+ * is kept in TCNT2, an early wakeup loses the fraction of the tick it
+ * happens in.
+ * Nothing is done if an event or poll is pending, the check is atomic with
+ * going to sleep so an interrupt can not post an event unnoticed.
+ * Only interrupts that work in power-save mode can wake the MCU, the caller
+ * has to make sure nothing depends on other ones.
+ */
+clock_time_t
+clock_idle(clock_time_t ticks)
+{
+  clock_time_t slept;
+  uint8_t phase;
+
+  if(ticks < 2) {
+    return 0;
+  }
+  if(ticks > CLOCK_IDLE_MAX) {
+    ticks = CLOCK_IDLE_MAX;
+  }
+
+  cli();
+  /* A pending tick would end the sleep right away and look like a full one */
+  if(process_nevents() > 0 || (TIFR2 & _BV(OCF2A))) {
+    sei();
+    return 0;
+  }
+  watchdog_stop();
+
+  /* How far the current tick has got, restored after the sleep */
+  phase = AVR_CLOCK_COUNTER;
+
+  /* One count per tick, counting from a freshly reset prescaler */
+  TCCR2B = CLOCK_IDLE_PRESCALE;
+  OCR2A = ticks - 1;
+  AVR_CLOCK_COUNTER = 0;
+  GTCCR |= _BV(PSRASY);
+  while(ASSR & (_BV(TCN2UB) | _BV(OCR2AUB) | _BV(TCR2BUB)));
+  while(GTCCR & _BV(PSRASY));
+  idle_tick = 0;
+
+  set_sleep_mode(SLEEP_MODE_PWR_SAVE);
+  sleep_enable();
+  ENERGEST_OFF(ENERGEST_TYPE_CPU);
+  /* sei takes effect after the next instruction, no interrupt in between */
+  sei();
+  sleep_cpu();
+  //...zzZZZzz...Ding!//
+  sleep_disable();
+  ENERGEST_ON(ENERGEST_TYPE_CPU);
+
+  cli();
+  /* TCNT2 is only valid one crystal cycle after the wakeup */
+  TCCR2B = TCCR2B;
+  while(ASSR & _BV(TCR2BUB));
+  if(idle_tick) {
+    /* The compare match interrupt has counted one of the ticks */
+    slept = ticks;
+    ticks--;
+  } else {
+    ticks = slept = AVR_CLOCK_COUNTER;
+  }
+
+  /* Restore the OCRSetup() configuration and carry the part of the tick
+     that passed before the sleep. Writing TCNT2 blocks the compare match
+     on the next count, so the last count of a tick can not be carried. */
+  TCCR2B = _BV(CS21);
+  OCR2A = AVR_CLOCK_MAX;
+  AVR_CLOCK_COUNTER = phase < AVR_CLOCK_MAX ? phase : 0;
+  GTCCR |= _BV(PSRASY);
+  while(ASSR & (_BV(TCN2UB) | _BV(OCR2AUB) | _BV(TCR2BUB)));
+  while(GTCCR & _BV(PSRASY));
+  sei();
+
+  watchdog_start();
+  clock_adjust_ticks(ticks);
+
+  return slept;
+}
+#endif /* CLOCK_IDLE_MAX */
+/*---------------------------------------------------------------------------*/
 /* This it the timer comparison match interrupt.
  * It maintains the tick counter, clock_seconds, and etimer updates.
  *
@@ -325,7 +425,14 @@ void AVR_OUTPUT_COMPARE_INT(void);
 #else
 ISR(AVR_OUTPUT_COMPARE_INT)
 {
+    ISR_STATS_ENTER(ISR_STATS_CLOCK);
+    /* The counter restarted from zero at the compare match */
+    ISR_STATS_LATENCY(ISR_STATS_CLOCK, AVR_CLOCK_COUNTER);
+
     count++;
+#ifdef CLOCK_IDLE_MAX
+    idle_tick = 1;
+#endif
 #if TWO_COUNTERS
   if(++scount >= CLOCK_SECOND) {
     scount = 0;
@@ -409,6 +516,7 @@ volatile static uint8_t osccalhigh,osccallow;
     }
   }
 #endif
+  ISR_STATS_EXIT(ISR_STATS_CLOCK);
 }
 #endif /* defined(DOXYGEN) */
 /*---------------------------------------------------------------------------*/
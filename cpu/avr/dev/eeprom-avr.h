@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2004, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ */
+
+/**
+ * \file
+ *        Interrupt driven EEPROM writes for AVR
+ */
+
+#ifndef EEPROM_AVR_H_
+#define EEPROM_AVR_H_
+
+#include "contiki.h"
+#include "dev/eeprom.h"
+
+/**
+ * Posted to the process of an asynchronous write when all bytes are
+ * written. The data is the buffer that was passed to the write.
+ */
+extern process_event_t eeprom_event_written;
+
+/**
+ * Queue a write into EEPROM.
+ *
+ * The bytes are programmed one by one from the EEPROM ready interrupt,
+ * skipping bytes that hold the value already. The buffer must not be
+ * changed until the write is complete. eeprom_read() waits for queued
+ * writes to the bytes it reads, eeprom_write() for all queued writes.
+ *
+ * \param addr The address in EEPROM to which the buffer should be written.
+ * \param buf The buffer from which the data is read.
+ * \param size The number of bytes to write.
+ * \param p The process that gets eeprom_event_written, or NULL.
+ * \return 1 if the write is queued, 0 if the queue is full.
+ */
+int eeprom_write_async(eeprom_addr_t addr, const unsigned char *buf, int size,
+                       struct process *p);
+
+/**
+ * \return Non-zero while queued writes are not complete.
+ */
+int eeprom_write_pending(void);
+
+#endif /* EEPROM_AVR_H_ */
@@ -37,18 +37,81 @@
  *        Enrico Joerns <e.joerns@tu-bs.de>
  */
 
+#include "contiki.h"
 #include "dev/eeprom.h"
+#include "dev/eeprom-avr.h"
 #include "dev/watchdog.h"
 
 #include <avr/eeprom.h>
+#include <avr/interrupt.h>
 #include <stdio.h>
 #include <util/delay.h>
 
 #define EEPROM_WRITE_MAX_TRIES  100
 
+#ifdef EEPROM_CONF_QUEUE_SIZE
+#define EEPROM_QUEUE_SIZE EEPROM_CONF_QUEUE_SIZE
+#else
+#define EEPROM_QUEUE_SIZE 4
+#endif
+
+struct eeprom_job {
+  eeprom_addr_t addr;
+  const unsigned char *buf;
+  int size;
+  struct process *p;
+};
+
+/* Jobs from first to busy are written and wait to be reported, jobs
+   from busy to last are programmed by the EE_READY interrupt. */
+static struct eeprom_job queue[EEPROM_QUEUE_SIZE];
+static volatile uint8_t first, busy, last;
+/* Bytes of the busy job that are programmed already. */
+static volatile int busy_done;
+
+process_event_t eeprom_event_written;
+
+PROCESS(eeprom_process, "EEPROM");
+
+#define NEXT(i) ((i) + 1 == EEPROM_QUEUE_SIZE ? 0 : (i) + 1)
+
 /*---------------------------------------------------------------------------*/
-void
-eeprom_write(eeprom_addr_t addr, unsigned char *buf, int size)
+/* Starts programming a byte unless it holds the value already. The
+   EEPROM must be ready and the interrupts must be disabled. */
+static uint8_t
+program_byte(eeprom_addr_t addr, uint8_t data)
+{
+  uint8_t old, mode;
+
+  EEAR = addr;
+  EECR |= _BV(EERE);
+  old = EEDR;
+  if(old == data) {
+    return 0;
+  }
+
+  /* Erase-only and write-only take half the time of an atomic write. */
+#ifdef EEPM0
+  if(data == 0xff) {
+    mode = _BV(EEPM0);
+  } else if((old & data) == data) {
+    mode = _BV(EEPM1);
+  } else {
+    mode = 0;
+  }
+#else
+  mode = 0;
+#endif
+
+  EECR = (EECR & _BV(EERIE)) | mode;
+  EEDR = data;
+  EECR |= _BV(EEMPE);
+  EECR |= _BV(EEPE);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+wait_ready(void)
 {
   uint8_t tries = 0;
 
@@ -57,32 +120,149 @@ eeprom_write(eeprom_addr_t addr, unsigned char *buf, int size)
     watchdog_periodic();
     _delay_ms(1);
     tries++;
+    if(tries > EEPROM_WRITE_MAX_TRIES) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Waits until the EEPROM is ready and keeps the interrupt from using it. */
+static uint8_t
+lock(void)
+{
+  EECR &= ~_BV(EERIE);
+  return wait_ready();
+}
+/*---------------------------------------------------------------------------*/
+static void
+unlock(void)
+{
+  if(busy != last) {
+    EECR |= _BV(EERIE);
+  }
+}
+/*---------------------------------------------------------------------------*/
+ISR(EE_READY_vect)
+{
+  struct eeprom_job *job;
 
-    if (tries > EEPROM_WRITE_MAX_TRIES) {
-      printf("Error: EEPROM write failed (%d,%u,%d)\n", 0, addr, size);
-      return;
+  while(busy != last) {
+    job = &queue[busy];
+    while(busy_done < job->size) {
+      busy_done++;
+      if(program_byte(job->addr + busy_done - 1, job->buf[busy_done - 1])) {
+        return;
+      }
     }
+    busy = NEXT(busy);
+    busy_done = 0;
+    process_poll(&eeprom_process);
   }
 
-  eeprom_write_block(buf, (unsigned short *)addr, size);
+  /* Nothing left to do, so the interrupt would fire continuously. */
+  EECR &= ~_BV(EERIE);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(eeprom_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+
+    while(first != busy) {
+      if(queue[first].p != NULL) {
+        process_post(queue[first].p, eeprom_event_written,
+                     (void *)queue[first].buf);
+      }
+      first = NEXT(first);
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+int
+eeprom_write_async(eeprom_addr_t addr, const unsigned char *buf, int size,
+                   struct process *p)
+{
+  uint8_t next;
+
+  if(!process_is_running(&eeprom_process)) {
+    eeprom_event_written = process_alloc_event();
+    process_start(&eeprom_process, NULL);
+  }
+
+  next = NEXT(last);
+  if(next == first) {
+    return 0;
+  }
+
+  queue[last].addr = addr;
+  queue[last].buf = buf;
+  queue[last].size = size;
+  queue[last].p = p;
+
+  /* The interrupt sees the job once it is complete. */
+  last = next;
+  EECR |= _BV(EERIE);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+eeprom_write_pending(void)
+{
+  return busy != last;
 }
 /*---------------------------------------------------------------------------*/
 void
-eeprom_read(eeprom_addr_t addr, unsigned char *buf, int size)
+eeprom_write(eeprom_addr_t addr, unsigned char *buf, int size)
 {
-  uint8_t tries = 0;
+  int i;
+  uint8_t sreg;
 
-  // nonblocking wait
-  while(!eeprom_is_ready()) {
+  /* Queued writes go first, so that they do not overwrite this one. */
+  while(eeprom_write_pending()) {
     watchdog_periodic();
-    _delay_ms(1);
-    tries++;
-    if (tries > EEPROM_WRITE_MAX_TRIES) {
-      printf("Error: EEPROM read failed\n");
-      return;
+  }
+
+  for(i = 0; i < size; i++) {
+    if(!lock()) {
+      printf("Error: EEPROM write failed (%d,%u,%d)\n", i, addr, size);
+      break;
+    }
+    sreg = SREG;
+    cli();
+    program_byte(addr + i, buf[i]);
+    SREG = sreg;
+  }
+  unlock();
+}
+/*---------------------------------------------------------------------------*/
+void
+eeprom_read(eeprom_addr_t addr, unsigned char *buf, int size)
+{
+  uint8_t i;
+
+  /* Wait for queued writes to the same bytes. */
+  for(i = busy; i != last; i = NEXT(i)) {
+    if(addr < queue[i].addr + queue[i].size &&
+       queue[i].addr < addr + size) {
+      while(eeprom_write_pending()) {
+        watchdog_periodic();
+      }
+      break;
     }
   }
 
+  if(!lock()) {
+    printf("Error: EEPROM read failed\n");
+    unlock();
+    return;
+  }
+
   eeprom_read_block(buf, (unsigned short *)addr, size);
+  unlock();
 }
 /*---------------------------------------------------------------------------*/
@@ -40,6 +40,7 @@
 
 #include "dev/slip.h"
 #include "dev/rs232.h"
+#include "isr-stats.h"
 
 /*ATmega32 and smaller have UBRRH/UCSRC at the same I/O address.
  *USART_UCSRC_SEL (bit7) selects writing to UBRHH(0) or UCSRC(1).
@@ -72,6 +73,64 @@
 #define RS232_TX_INTERRUPTS 0
 #endif
 
+/* With a TX buffer, rs232_send() only blocks while the buffer is full
+ * and the data register empty interrupt drains it. The buffer size must
+ * be a power of two up to 128, 0 sends every byte by polling.
+ */
+#ifdef RS232_CONF_TX_BUFFER_SIZE
+#define RS232_TX_BUFFER_SIZE RS232_CONF_TX_BUFFER_SIZE
+#else
+#define RS232_TX_BUFFER_SIZE 0
+#endif
+
+#if RS232_TX_BUFFER_SIZE
+#if RS232_TX_INTERRUPTS
+#error RS232_CONF_TX_BUFFER_SIZE cannot be used with RS232_CONF_TX_INTERRUPTS
+#endif
+#if RS232_TX_BUFFER_SIZE > 128 || (RS232_TX_BUFFER_SIZE & (RS232_TX_BUFFER_SIZE - 1))
+#error RS232_CONF_TX_BUFFER_SIZE must be a power of two up to 128
+#endif
+
+/* head and tail run freely, head - tail is the number of buffered bytes */
+struct txbuf {
+  volatile uint8_t head;
+  volatile uint8_t tail;
+  uint8_t data[RS232_TX_BUFFER_SIZE];
+};
+
+#define TXBUF_FULL(b) ((uint8_t)((b).head - (b).tail) >= RS232_TX_BUFFER_SIZE)
+#define TXBUF_EMPTY(b) ((b).head == (b).tail)
+#define TXBUF_PUT(b, c) do { \
+    (b).data[(b).head & (RS232_TX_BUFFER_SIZE - 1)] = (c); \
+    (b).head++; \
+  } while(0)
+#define TXBUF_GET(b) ((b).data[(b).tail++ & (RS232_TX_BUFFER_SIZE - 1)])
+
+/* Interrupts are disabled inside of an interrupt handler. Then the
+ * buffer cannot drain and a byte is sent by polling to make room. */
+#define TXBUF_WAIT(b, ucsra, udrem, udr) \
+  while(TXBUF_FULL(b)) { \
+    if(!(SREG & _BV(SREG_I))) { \
+      while(!((ucsra) & (udrem))); \
+      (udr) = TXBUF_GET(b); \
+    } \
+  }
+#endif /* RS232_TX_BUFFER_SIZE */
+
+/* Drop stdout characters instead of waiting when the TX buffer is full.
+ * The rest of the line is dropped as well, so that the output stays line
+ * aligned. rs232_stdout_dropped() returns the number of lost characters.
+ */
+#ifdef RS232_CONF_STDOUT_DROP
+#define RS232_STDOUT_DROP RS232_CONF_STDOUT_DROP
+#else
+#define RS232_STDOUT_DROP 0
+#endif
+
+#if RS232_STDOUT_DROP && !RS232_TX_BUFFER_SIZE
+#error RS232_CONF_STDOUT_DROP requires RS232_CONF_TX_BUFFER_SIZE
+#endif
+
 /* Insert a carriage return after a line feed. This is the default. */
 #ifndef ADD_CARRIAGE_RETURN_AFTER_NEWLINE
 #define ADD_CARRIAGE_RETURN_AFTER_NEWLINE 1
@@ -100,6 +159,7 @@
 #define D_UCSR0C UCSR0C
 #define D_USART0_RX_vect USART0_RX_vect
 #define D_USART0_TX_vect USART0_TX_vect
+#define D_USART0_UDRE_vect USART0_UDRE_vect
 
 #if NUMPORTS > 1
 #define D_UDR1   UDR1
@@ -111,6 +171,7 @@
 #define D_UCSR1C UCSR1C
 #define D_USART1_RX_vect USART1_RX_vect
 #define D_USART1_TX_vect USART1_TX_vect
+#define D_USART1_UDRE_vect USART1_UDRE_vect
 #endif
 
 #endif
@@ -133,6 +194,7 @@
 #define D_UCSR0C UCSR1C
 #define D_USART0_RX_vect USART1_RX_vect
 #define D_USART0_TX_vect USART1_TX_vect
+#define D_USART0_UDRE_vect USART1_UDRE_vect
 #endif
 
 #elif defined (__AVR_ATmega8515__)
@@ -152,6 +214,7 @@
 #define D_UCSR0C UCSRC
 #define D_USART0_RX_vect USART_RX_vect
 #define D_USART0_TX_vect USART_TX_vect
+#define D_USART0_UDRE_vect USART_UDRE_vect
 #endif
 
 #elif defined (__AVR_ATmega328P__)
@@ -171,6 +234,7 @@
 #define D_UCSR0C UCSR0C
 #define D_USART0_RX_vect USART_RX_vect
 #define D_USART0_TX_vect USART_TX_vect
+#define D_USART0_UDRE_vect USART_UDRE_vect
 #endif
 
 #elif defined (__AVR_ATmega8__) || defined (__AVR_ATmega16__) || defined (__AVR_ATmega32__)
@@ -190,6 +254,7 @@
 #define D_UCSR0C UCSRC
 #define D_USART0_RX_vect USART_RXC_vect
 #define D_USART0_TX_vect USART_TXC_vect
+#define D_USART0_UDRE_vect USART_UDRE_vect
 #endif
 
 #elif defined (__AVR_ATmega644__)
@@ -209,6 +274,7 @@
 #define D_UCSR0C UCSR0C
 #define D_USART0_RX_vect USART0_RX_vect
 #define D_USART0_TX_vect USART0_TX_vect
+#define D_USART0_UDRE_vect USART0_UDRE_vect
 #endif
 
 #else
@@ -220,8 +286,10 @@ int (* input_handler_0)(unsigned char);
 ISR(D_USART0_RX_vect)
 {
   unsigned char c;
+  ISR_STATS_ENTER(ISR_STATS_UART0_RX);
   c = D_UDR0;
   if (input_handler_0 != NULL) input_handler_0(c);
+  ISR_STATS_EXIT(ISR_STATS_UART0_RX);
 }
 #if RS232_TX_INTERRUPTS
 volatile uint8_t txwait_0;
@@ -229,6 +297,15 @@ ISR(D_USART0_TX_vect)
 {
   txwait_0 = 0;
 }
+#elif RS232_TX_BUFFER_SIZE
+static struct txbuf txbuf_0;
+ISR(D_USART0_UDRE_vect)
+{
+  D_UDR0 = TXBUF_GET(txbuf_0);
+  if(TXBUF_EMPTY(txbuf_0)) {
+    D_UCSR0B &= ~USART_INTERRUPT_DATA_REG_EMPTY;
+  }
+}
 #endif
 
 #if NUMPORTS > 1
@@ -236,8 +313,10 @@ int (* input_handler_1)(unsigned char);
 ISR(D_USART1_RX_vect)
 {
   unsigned char c;
+  ISR_STATS_ENTER(ISR_STATS_UART1_RX);
   c = D_UDR1;
   if (input_handler_1 != NULL) input_handler_1(c);
+  ISR_STATS_EXIT(ISR_STATS_UART1_RX);
 }
 #if RS232_TX_INTERRUPTS
 volatile uint8_t txwait_1;
@@ -245,6 +324,15 @@ ISR(USART1_TX_vect)
 {
   txwait_1 = 0;
 }
+#elif RS232_TX_BUFFER_SIZE
+static struct txbuf txbuf_1;
+ISR(D_USART1_UDRE_vect)
+{
+  D_UDR1 = TXBUF_GET(txbuf_1);
+  if(TXBUF_EMPTY(txbuf_1)) {
+    D_UCSR1B &= ~USART_INTERRUPT_DATA_REG_EMPTY;
+  }
+}
 #endif
 
 #if NUMPORTS > 2
@@ -261,6 +349,15 @@ ISR(USART2_TX_vect)
 {
   txwait_2= 0;
 }
+#elif RS232_TX_BUFFER_SIZE
+static struct txbuf txbuf_2;
+ISR(D_USART2_UDRE_vect)
+{
+  D_UDR2 = TXBUF_GET(txbuf_2);
+  if(TXBUF_EMPTY(txbuf_2)) {
+    D_UCSR2B &= ~USART_INTERRUPT_DATA_REG_EMPTY;
+  }
+}
 #endif
 #endif
 
@@ -284,6 +381,9 @@ rs232_init (uint8_t port, uint8_t bd, uint8_t ffmt)
 #endif
    D_UCSR0C = USART_UCSRC_SEL | ffmt;
    input_handler_0 = NULL;
+#if RS232_TX_BUFFER_SIZE
+   txbuf_0.head = txbuf_0.tail = 0;
+#endif
 
 #if NUMPORTS > 1
  } else if (port == 1) {
@@ -299,6 +399,9 @@ rs232_init (uint8_t port, uint8_t bd, uint8_t ffmt)
 #endif
    D_UCSR1C = USART_UCSRC_SEL | ffmt;
    input_handler_1 = NULL;
+#if RS232_TX_BUFFER_SIZE
+   txbuf_1.head = txbuf_1.tail = 0;
+#endif
 
 #if NUMPORTS > 2
  } else if (port == 2) {
@@ -314,6 +417,9 @@ rs232_init (uint8_t port, uint8_t bd, uint8_t ffmt)
 #endif
    D_UCSR2C = USART_UCSRC_SEL | ffmt;
    input_handler_2 = NULL;
+#if RS232_TX_BUFFER_SIZE
+   txbuf_2.head = txbuf_2.tail = 0;
+#endif
 #endif
 #endif
  }
@@ -345,6 +451,27 @@ rs232_send(uint8_t port, unsigned char c)
 #endif
   }
 #endif
+#elif RS232_TX_BUFFER_SIZE
+  /* Block until there is room in the buffer and queue the character */
+#if NUMPORTS > 0
+  if (port == 0 ) {
+    TXBUF_WAIT(txbuf_0, D_UCSR0A, D_UDRE0M, D_UDR0);
+    TXBUF_PUT(txbuf_0, c);
+    D_UCSR0B |= USART_INTERRUPT_DATA_REG_EMPTY;
+#if NUMPORTS > 1
+  } else if (port == 1) {
+    TXBUF_WAIT(txbuf_1, D_UCSR1A, D_UDRE1M, D_UDR1);
+    TXBUF_PUT(txbuf_1, c);
+    D_UCSR1B |= USART_INTERRUPT_DATA_REG_EMPTY;
+#if NUMPORTS > 2
+  } else if (port == 2) {
+    TXBUF_WAIT(txbuf_2, D_UCSR2A, D_UDRE2M, D_UDR2);
+    TXBUF_PUT(txbuf_2, c);
+    D_UCSR2B |= USART_INTERRUPT_DATA_REG_EMPTY;
+#endif
+#endif
+  }
+#endif
 #else /* RS232_TX_INTERRUPTS */
   /* Block until tx ready and output character */
 #if NUMPORTS > 0
@@ -366,6 +493,29 @@ rs232_send(uint8_t port, unsigned char c)
 #endif /* RS232_TX_INTERRUPTS */
 }
 /*---------------------------------------------------------------------------*/
+#if RS232_STDOUT_DROP
+/* Free space in the TX buffer. It only grows while the interrupt drains
+ * the buffer, so that this many bytes can be sent without blocking. */
+static uint8_t
+rs232_tx_free(uint8_t port)
+{
+#if NUMPORTS > 0
+  if (port == 0) {
+    return RS232_TX_BUFFER_SIZE - (uint8_t)(txbuf_0.head - txbuf_0.tail);
+#if NUMPORTS > 1
+  } else if (port == 1) {
+    return RS232_TX_BUFFER_SIZE - (uint8_t)(txbuf_1.head - txbuf_1.tail);
+#if NUMPORTS > 2
+  } else if (port == 2) {
+    return RS232_TX_BUFFER_SIZE - (uint8_t)(txbuf_2.head - txbuf_2.tail);
+#endif
+#endif
+  }
+#endif
+  return 0;
+}
+#endif /* RS232_STDOUT_DROP */
+/*---------------------------------------------------------------------------*/
 void
 rs232_set_input(uint8_t port, int (*f)(unsigned char))
 {
@@ -426,8 +576,28 @@ static FILE rs232_stdout = FDEV_SETUP_STREAM(rs232_stdout_putchar,
 					     NULL,
 					     _FDEV_SETUP_WRITE);
 
+#if RS232_STDOUT_DROP
+static uint8_t stdout_dropping;
+static uint16_t stdout_dropped;
+#endif
+
 int rs232_stdout_putchar(char c, FILE *stream)
 {
+#if RS232_STDOUT_DROP
+  /* A line feed needs room for the carriage return, too. It ends a
+   * dropped line as soon as it fits. */
+  if(rs232_tx_free(stdout_rs232_port) <
+     (ADD_CARRIAGE_RETURN_AFTER_NEWLINE && c=='\n' ? 2 : 1)) {
+    stdout_dropping = 1;
+    stdout_dropped++;
+    return 0;
+  }
+  if(stdout_dropping && c!='\n') {
+    stdout_dropped++;
+    return 0;
+  }
+  stdout_dropping = 0;
+#endif
 #if ADD_CARRIAGE_RETURN_AFTER_NEWLINE
   if(c=='\n') rs232_send(stdout_rs232_port, '\r');
   if(c!='\r') rs232_send (stdout_rs232_port, c);
@@ -436,6 +606,38 @@ int rs232_stdout_putchar(char c, FILE *stream)
 #endif
   return 0;
 }
+#if RS232_STDOUT_DROP
+/*---------------------------------------------------------------------------*/
+uint16_t
+rs232_stdout_dropped(void)
+{
+  return stdout_dropped;
+}
+#endif
+#if RS232_LOG_ID
+/*---------------------------------------------------------------------------*/
+void
+rs232_log_id(uint16_t id, const void *data, uint8_t len)
+{
+  const uint8_t *p = data;
+
+#if RS232_STDOUT_DROP
+  /* Records are never cut, a record that does not fit is dropped whole */
+  if(stdout_dropping || len > RS232_TX_BUFFER_SIZE - 4 ||
+     rs232_tx_free(stdout_rs232_port) < len + 4) {
+    stdout_dropped += len + 4;
+    return;
+  }
+#endif
+  rs232_send(stdout_rs232_port, RS232_LOG_ID_MARKER);
+  rs232_send(stdout_rs232_port, id & 0xff);
+  rs232_send(stdout_rs232_port, id >> 8);
+  rs232_send(stdout_rs232_port, len);
+  while(len--) {
+    rs232_send(stdout_rs232_port, *p++);
+  }
+}
+#endif /* RS232_LOG_ID */
 /*---------------------------------------------------------------------------*/
 void rs232_redirect_stdout (uint8_t port) {
   stdout_rs232_port = port;
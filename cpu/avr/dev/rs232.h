@@ -158,6 +158,49 @@ rs232_send(uint8_t port, unsigned char c);
 void
 rs232_redirect_stdout (uint8_t port);
 
+/**
+ * \brief      Number of characters dropped from stdout
+ *
+ *             With RS232_CONF_STDOUT_DROP, characters written to stdout
+ *             while the TX buffer is full are dropped instead of
+ *             waiting for the transmitter. The rest of the line is
+ *             dropped, too. This counts all of them, including bytes of
+ *             dropped log records.
+ */
+uint16_t
+rs232_stdout_dropped(void);
+
+#ifdef RS232_CONF_LOG_ID
+#define RS232_LOG_ID RS232_CONF_LOG_ID
+#else
+#define RS232_LOG_ID 0
+#endif
+
+/** First byte of a binary log record, it never appears in text output */
+#define RS232_LOG_ID_MARKER 0xfe
+
+/**
+ * \brief      Write a binary log record to stdout
+ * \param id   The id of the log message
+ * \param data The arguments of the message
+ * \param len  The length of the arguments
+ *
+ *             Instead of formatting a message on the node, only
+ *             RS232_LOG_ID_MARKER, the id (little endian), len and the
+ *             raw arguments are written to the stdout port. The host
+ *             maps the id back to a format string. The function is
+ *             only available with RS232_CONF_LOG_ID, otherwise
+ *             RS232_LOG() expands to nothing.
+ */
+void
+rs232_log_id(uint16_t id, const void *data, uint8_t len);
+
+#if RS232_LOG_ID
+#define RS232_LOG(id, var) rs232_log_id((id), &(var), sizeof(var))
+#else
+#define RS232_LOG(id, var)
+#endif
+
 void 
 
 s232_set_baud(uint16_t bd);
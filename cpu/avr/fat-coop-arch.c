@@ -50,6 +50,8 @@
 #include "cfs-fat.h"
 #include "fat_coop.h"
 #include "fat-coop-arch.h"
+#include "stack-arch.h"
+#include "mtarch.h"
 
 static uint8_t stack[FAT_COOP_STACK_SIZE];
 static uint8_t *sp = 0;
@@ -64,31 +66,12 @@ void coop_finished_op() {
 }
 
 /**
- * This function is mostly copied from the arm/mtarch.c file.
+ * Prepares the internal stack to start operation().
  */
 void coop_mt_init( void *data ) {
-  memset(stack, 0, FAT_COOP_STACK_SIZE);
+  memset(stack, STACK_ARCH_PAINT, FAT_COOP_STACK_SIZE);
 
-  /* coop_init function that is to be invoked if the thread dies */
-  stack[FAT_COOP_STACK_SIZE -  1] = (unsigned char)((unsigned short)coop_finished_op) & 0xff;
-  stack[FAT_COOP_STACK_SIZE -  2] = (unsigned char)((unsigned short)coop_finished_op >> 8) & 0xff;
-
-  /* The thread handler. Invoked when RET is called in coop_switch_sp */
-  stack[FAT_COOP_STACK_SIZE -  3] = (unsigned char)((unsigned short)operation) & 0xff;
-  stack[FAT_COOP_STACK_SIZE -  4] = (unsigned char)((unsigned short)operation >> 8) & 0xff;
-
-  /* Register r0-r23 in t->stack[MTARCH_STACKSIZE -  5] to
-   *  t->stack[MTARCH_STACKSIZE -  28].
-   *
-   * Per calling convention, the argument to the thread handler function
-   *  (i.e. the 'data' pointer) is passed via r24-r25.
-   * See http://www.nongnu.org/avr-libc/user-manual/FAQ.html#faq_reg_usage) */
-  stack[FAT_COOP_STACK_SIZE - 29] = (unsigned char)((unsigned short)data) & 0xff;
-  stack[FAT_COOP_STACK_SIZE - 30] = (unsigned char)((unsigned short)data >> 8) & 0xff;
-
-  /* Initialize stack pointer: Space for 2 2-byte-addresses and 32 registers,
-   * post-decrement POP / pre-increment PUSH scheme */
-  sp = &stack[FAT_COOP_STACK_SIZE - 1 - 4 - 32];
+  sp = mtarch_frame(stack, FAT_COOP_STACK_SIZE, operation, data, coop_finished_op);
 }
 
 /**
@@ -99,92 +82,18 @@ void coop_mt_stop() {
 }
 
 /**
- * Function switches the stack pointers for Atmel based devices (32 GPR's).
+ * Switches between the internal stack and the caller of perform_next_step().
  */
 void coop_switch_sp() {
-/* Disable interrupts while we perform the context switch */
-  cli ();
+  uint8_t *next;
 
-  /* Push 32 general purpuse registers */
-  __asm__("push r0");
-  __asm__("push r1");
-  __asm__("push r2");
-  __asm__("push r3");
-  __asm__("push r4");
-  __asm__("push r5");
-  __asm__("push r6");
-  __asm__("push r7");
-  __asm__("push r8");
-  __asm__("push r9");
-  __asm__("push r10");
-  __asm__("push r11");
-  __asm__("push r12");
-  __asm__("push r13");
-  __asm__("push r14");
-  __asm__("push r15");
-  __asm__("push r16");
-  __asm__("push r17");
-  __asm__("push r18");
-  __asm__("push r19");
-  __asm__("push r20");
-  __asm__("push r21");
-  __asm__("push r22");
-  __asm__("push r23");
-  __asm__("push r24");
-  __asm__("push r25");
-  __asm__("push r26");
-  __asm__("push r27");
-  __asm__("push r28");
-  __asm__("push r29");
-  __asm__("push r30");
-  __asm__("push r31");
-
-  /* Switch stack pointer */
   if( sp_save == NULL ) {
-	sp_save = (uint8_t *) SP;
-	SP = (uint16_t) sp;
+	mtarch_switch(&sp_save, sp);
   } else {
-	sp = (uint8_t *) SP;
-	SP = (uint16_t) sp_save;
+	next = sp_save;
 	sp_save = NULL;
+	mtarch_switch(&sp, next);
   }
-
-  /* Pop 32 general purpose registers */
-  __asm__("pop r31");
-  __asm__("pop r30");
-  __asm__("pop r29");
-  __asm__("pop r28");
-  __asm__("pop r27");
-  __asm__("pop r26");
-  __asm__("pop r25");
-  __asm__("pop r24");
-  __asm__("pop r23");
-  __asm__("pop r22");
-  __asm__("pop r21");
-  __asm__("pop r20");
-  __asm__("pop r19");
-  __asm__("pop r18");
-  __asm__("pop r17");
-  __asm__("pop r16");
-  __asm__("pop r15");
-  __asm__("pop r14");
-  __asm__("pop r13");
-  __asm__("pop r12");
-  __asm__("pop r11");
-  __asm__("pop r10");
-  __asm__("pop r9");
-  __asm__("pop r8");
-  __asm__("pop r7");
-  __asm__("pop r6");
-  __asm__("pop r5");
-  __asm__("pop r4");
-  __asm__("pop r3");
-  __asm__("pop r2");
-  __asm__("pop r1");
-  __asm__("pop r0");
-
-  /* Reenable interrupts */
-  sei ();
 }
 
 /**
@@ -207,7 +116,7 @@ int calc_free_stack() {
 	int i;
 
 	for( i = 0; i < FAT_COOP_STACK_SIZE; i++ ) {
-		if(stack[i] != 0) {
+		if(stack[i] != STACK_ARCH_PAINT) {
 			break;
 		}
 	}
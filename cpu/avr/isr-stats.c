@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Duration and latency statistics of interrupt handlers on AVR
+ */
+
+#include "isr-stats.h"
+
+#if ISR_STATS
+#include <avr/interrupt.h>
+#include <string.h>
+
+struct isr_stats isr_stats[ISR_STATS_NUM];
+
+static const char *const names[ISR_STATS_NUM] = {
+  "rtimer", "clock", "radio", "uart0-rx", "uart1-rx", "twi"
+};
+/*---------------------------------------------------------------------------*/
+void
+isr_stats_init(void)
+{
+  /* The radio interrupt uses the input capture of Timer1 regardless of
+     its prescaler, so it can run at the CPU clock */
+  TCCR1B = (TCCR1B & ~0x07) | (1 << CS10);
+}
+/*---------------------------------------------------------------------------*/
+void
+isr_stats_get(uint8_t id, struct isr_stats *s, uint8_t reset)
+{
+  uint8_t sreg;
+
+  sreg = SREG;
+  cli();
+  memcpy(s, &isr_stats[id], sizeof(*s));
+  if(reset) {
+    memset(&isr_stats[id], 0, sizeof(isr_stats[id]));
+  }
+  SREG = sreg;
+}
+/*---------------------------------------------------------------------------*/
+const char *
+isr_stats_name(uint8_t id)
+{
+  return names[id];
+}
+/*---------------------------------------------------------------------------*/
+#endif /* ISR_STATS */
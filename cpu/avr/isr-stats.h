@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Duration and latency statistics of interrupt handlers on AVR
+ *
+ *         With AVR_CONF_ISR_STATS set, the instrumented handlers record
+ *         per vector the number of calls and the average and maximum
+ *         duration. The duration is counted in CPU cycles with Timer1,
+ *         as for the unit benchmarks, so a handler must not take more
+ *         than 65536 cycles. Nested interrupts count towards the handler
+ *         they interrupt. Where the handler was triggered by a compare
+ *         match, the entry latency is recorded as well, in ticks of the
+ *         triggering timer.
+ *
+ *         A handler is instrumented with ISR_STATS_ENTER() at its start
+ *         and ISR_STATS_EXIT() on every return path.
+ */
+
+#ifndef ISR_STATS_H_
+#define ISR_STATS_H_
+
+#include <stdint.h>
+#include "contiki-conf.h"
+
+#ifdef AVR_CONF_ISR_STATS
+#define ISR_STATS AVR_CONF_ISR_STATS
+#else
+#define ISR_STATS 0
+#endif
+
+/** The instrumented vectors */
+enum {
+  ISR_STATS_RTIMER,
+  ISR_STATS_CLOCK,
+  ISR_STATS_RADIO,
+  ISR_STATS_UART0_RX,
+  ISR_STATS_UART1_RX,
+  ISR_STATS_TWI,
+  ISR_STATS_NUM
+};
+
+struct isr_stats {
+  uint32_t count;         /**< Number of calls */
+  uint32_t cycles;        /**< Sum of the durations */
+  uint16_t max_cycles;    /**< Longest duration */
+  uint16_t max_latency;   /**< Longest entry latency */
+  uint32_t latency;       /**< Sum of the entry latencies */
+};
+
+#if ISR_STATS
+#include <avr/io.h>
+
+#if !defined(TCNT1) || !defined(TCNT3)
+#error "AVR_CONF_ISR_STATS requires Timer1 and the rtimer on Timer3"
+#endif
+
+extern struct isr_stats isr_stats[ISR_STATS_NUM];
+
+#define ISR_STATS_ENTER(id)  uint16_t isr_stats_start = TCNT1
+#define ISR_STATS_EXIT(id)   isr_stats_record(id, TCNT1 - isr_stats_start)
+/** Records the entry latency of a handler, in ticks of its timer */
+#define ISR_STATS_LATENCY(id, ticks) isr_stats_latency(id, ticks)
+
+static inline void
+isr_stats_record(uint8_t id, uint16_t cycles)
+{
+  struct isr_stats *s = &isr_stats[id];
+
+  s->count++;
+  s->cycles += cycles;
+  if(cycles > s->max_cycles) {
+    s->max_cycles = cycles;
+  }
+}
+
+static inline void
+isr_stats_latency(uint8_t id, uint16_t ticks)
+{
+  struct isr_stats *s = &isr_stats[id];
+
+  s->latency += ticks;
+  if(ticks > s->max_latency) {
+    s->max_latency = ticks;
+  }
+}
+
+/**
+ * Starts Timer1 at the CPU clock, called by the platform at startup
+ */
+void isr_stats_init(void);
+
+/**
+ * Copies the statistics of a vector with interrupts disabled
+ * \param id    One of ISR_STATS_RTIMER ... ISR_STATS_TWI
+ * \param s     Receives the statistics
+ * \param reset Clears the statistics of the vector if non-zero
+ */
+void isr_stats_get(uint8_t id, struct isr_stats *s, uint8_t reset);
+
+/**
+ * \return The name of a vector
+ */
+const char *isr_stats_name(uint8_t id);
+
+#else /* ISR_STATS */
+
+#define ISR_STATS_ENTER(id)
+#define ISR_STATS_EXIT(id)
+#define ISR_STATS_LATENCY(id, ticks)
+#define isr_stats_init()
+
+#endif /* ISR_STATS */
+
+#endif /* ISR_STATS_H_ */
@@ -46,6 +46,113 @@ void
 mtarch_init(void)
 {
   
+}
+/*--------------------------------------------------------------------------*/
+/*
+ * Entry of a new thread, reached by the RET of mtarch_switch(). The
+ * initial frame holds the thread function in r14:r15 and its argument
+ * in r16:r17, below them the address the thread returns to.
+ */
+static void trampoline(void) __attribute__((naked, used));
+static void
+trampoline(void)
+{
+  __asm__ volatile("movw r24, r16\n\t"
+                   "movw r30, r14\n\t"
+                   "ijmp\n\t");
+}
+/*--------------------------------------------------------------------------*/
+unsigned char *
+mtarch_frame(unsigned char *stack, uint16_t size,
+             void (*function)(void *), void *data, void (*exit)(void))
+{
+  unsigned char *top = &stack[size - 1];
+
+  /*
+   * Caveats:
+   *  - Function pointers are 16-bit word addresses in flash ROM, but e.g.
+   *    avr-objdump displays byte addresses
+   *  - RET pops the high byte first, so it is at the lower address
+   */
+
+  /* Invoked if the thread function returns */
+  top[0] = (unsigned short)exit & 0xff;
+  top[-1] = (unsigned short)exit >> 8;
+
+  /* Invoked by the RET in mtarch_switch() */
+  top[-2] = (unsigned short)trampoline & 0xff;
+  top[-3] = (unsigned short)trampoline >> 8;
+
+  /* r2 to r17 in top[-4] to top[-19], then r28 and r29 */
+  top[-4 - (14 - 2)] = (unsigned short)function & 0xff;
+  top[-4 - (15 - 2)] = (unsigned short)function >> 8;
+  top[-4 - (16 - 2)] = (unsigned short)data & 0xff;
+  top[-4 - (17 - 2)] = (unsigned short)data >> 8;
+
+  /* Post-decrement PUSH / pre-increment POP scheme */
+  return top - 4 - MTARCH_FRAME_REGS;
+}
+/*--------------------------------------------------------------------------*/
+void
+mtarch_switch(unsigned char **save, unsigned char *next)
+{
+  /*
+   * Called like any function, so the compiler already assumes r18-r27,
+   * r30, r31 and r0 to be clobbered and r1 to be zero. Only the
+   * callee-saved registers need to survive on the stack.
+   */
+  __asm__ volatile("push r2\n\t"
+                   "push r3\n\t"
+                   "push r4\n\t"
+                   "push r5\n\t"
+                   "push r6\n\t"
+                   "push r7\n\t"
+                   "push r8\n\t"
+                   "push r9\n\t"
+                   "push r10\n\t"
+                   "push r11\n\t"
+                   "push r12\n\t"
+                   "push r13\n\t"
+                   "push r14\n\t"
+                   "push r15\n\t"
+                   "push r16\n\t"
+                   "push r17\n\t"
+                   "push r28\n\t"
+                   "push r29\n\t"
+
+                   /* *save = SP */
+                   "movw r30, r24\n\t"
+                   "in r0, __SP_L__\n\t"
+                   "st Z, r0\n\t"
+                   "in r0, __SP_H__\n\t"
+                   "std Z+1, r0\n\t"
+
+                   /* SP = next, the same way the compiler's prologue does */
+                   "in r0, __SREG__\n\t"
+                   "cli\n\t"
+                   "out __SP_H__, r23\n\t"
+                   "out __SREG__, r0\n\t"
+                   "out __SP_L__, r22\n\t"
+
+                   "pop r29\n\t"
+                   "pop r28\n\t"
+                   "pop r17\n\t"
+                   "pop r16\n\t"
+                   "pop r15\n\t"
+                   "pop r14\n\t"
+                   "pop r13\n\t"
+                   "pop r12\n\t"
+                   "pop r11\n\t"
+                   "pop r10\n\t"
+                   "pop r9\n\t"
+                   "pop r8\n\t"
+                   "pop r7\n\t"
+                   "pop r6\n\t"
+                   "pop r5\n\t"
+                   "pop r4\n\t"
+                   "pop r3\n\t"
+                   "pop r2\n\t"
+                   "ret\n\t");
 }
 /*--------------------------------------------------------------------------*/
 void
@@ -60,133 +167,19 @@ mtarch_start(struct mtarch_thread *t,
     t->stack[i] = i;
   }
 
-  /*
-   * Push pointer to mt_exit and the thread onto our stack:
-   * Caveats:
-   *  - The stack is defined as an array of bytes, but pointers are 16 bit wide
-   *  - Function pointers are 16-bit addresses in flash ROM, but e.g.
-   *    avr-objdump displays byte addresses
-   *  - Get the high and low byte of the addresses onto the stack in the
-   *    right order
-   */
-
-  /* Initialize stack. This is done in reverse order ("pushing") the
-   *  pre-allocated array */
-
-  /* mt_exit function that is to be invoked if the thread dies */
-  t->stack[MTARCH_STACKSIZE -  1] = (unsigned char)((unsigned short)mt_exit) & 0xff;
-  t->stack[MTARCH_STACKSIZE -  2] = (unsigned char)((unsigned short)mt_exit >> 8) & 0xff;
-
-  /* The thread handler. Invoked when RET is called in mtarch_exec */
-  t->stack[MTARCH_STACKSIZE -  3] = (unsigned char)((unsigned short)function) & 0xff;
-  t->stack[MTARCH_STACKSIZE -  4] = (unsigned char)((unsigned short)function >> 8) & 0xff;
-
-  /* Register r0-r23 in t->stack[MTARCH_STACKSIZE -  5] to
-   *  t->stack[MTARCH_STACKSIZE -  28].
-   *
-   * Per calling convention, the argument to the thread handler function 
-   *  (i.e. the 'data' pointer) is passed via r24-r25.
-   * See http://www.nongnu.org/avr-libc/user-manual/FAQ.html#faq_reg_usage) */
-  t->stack[MTARCH_STACKSIZE - 29] = (unsigned char)((unsigned short)data) & 0xff;
-  t->stack[MTARCH_STACKSIZE - 30] = (unsigned char)((unsigned short)data >> 8) & 0xff;
-
-  /* Initialize stack pointer: Space for 2 2-byte-addresses and 32 registers,
-   * post-decrement POP / pre-increment PUSH scheme */
-  t->sp = &t->stack[MTARCH_STACKSIZE - 1 - 4 - 32];
+  t->sp = mtarch_frame(t->stack, MTARCH_STACKSIZE, function, data, mt_exit);
 }
 
 /*--------------------------------------------------------------------------*/
-static unsigned char *sptmp;
+static unsigned char *kernel_sp;
 static struct mtarch_thread *running;
 
-static void
-sw(void)
-{
-  /* Disable interrupts while we perform the context switch */
-  cli ();
-
-  /* Push 32 general purpuse registers */
-  __asm__("push r0");
-  __asm__("push r1");
-  __asm__("push r2");
-  __asm__("push r3");
-  __asm__("push r4");
-  __asm__("push r5");
-  __asm__("push r6");
-  __asm__("push r7");
-  __asm__("push r8");
-  __asm__("push r9");
-  __asm__("push r10");
-  __asm__("push r11");
-  __asm__("push r12");
-  __asm__("push r13");
-  __asm__("push r14");
-  __asm__("push r15");
-  __asm__("push r16");
-  __asm__("push r17");
-  __asm__("push r18");
-  __asm__("push r19");
-  __asm__("push r20");
-  __asm__("push r21");
-  __asm__("push r22");
-  __asm__("push r23");
-  __asm__("push r24");
-  __asm__("push r25");
-  __asm__("push r26");
-  __asm__("push r27");
-  __asm__("push r28");
-  __asm__("push r29");
-  __asm__("push r30");
-  __asm__("push r31");
-
-  /* Switch stack pointer */
-  sptmp = running->sp;
-  running->sp = (unsigned char*)SP;
-  SP = (unsigned short)sptmp;
-
-  /* Pop 32 general purpose registers */
-  __asm__("pop r31");
-  __asm__("pop r30");
-  __asm__("pop r29");
-  __asm__("pop r28");
-  __asm__("pop r27");
-  __asm__("pop r26");
-  __asm__("pop r25");
-  __asm__("pop r24");
-  __asm__("pop r23");
-  __asm__("pop r22");
-  __asm__("pop r21");
-  __asm__("pop r20");
-  __asm__("pop r19");
-  __asm__("pop r18");
-  __asm__("pop r17");
-  __asm__("pop r16");
-  __asm__("pop r15");
-  __asm__("pop r14");
-  __asm__("pop r13");
-  __asm__("pop r12");
-  __asm__("pop r11");
-  __asm__("pop r10");
-  __asm__("pop r9");
-  __asm__("pop r8");
-  __asm__("pop r7");
-  __asm__("pop r6");
-  __asm__("pop r5");
-  __asm__("pop r4");
-  __asm__("pop r3");
-  __asm__("pop r2");
-  __asm__("pop r1");
-  __asm__("pop r0");
-
-  /* Renable interrupts */
-  sei ();
-}
 /*--------------------------------------------------------------------------*/
 void
 mtarch_exec(struct mtarch_thread *t)
 {
   running = t;
-  sw();
+  mtarch_switch(&kernel_sp, t->sp);
   running = NULL;
 }
 
@@ -200,7 +193,7 @@ mtarch_remove(void)
 void
 mtarch_yield(void)
 {
-  sw();
+  mtarch_switch(&running->sp, kernel_sp);
 }
 /*--------------------------------------------------------------------------*/
 void
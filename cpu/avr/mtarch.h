@@ -55,5 +55,43 @@ struct mtarch_thread {
   unsigned char *sp;
 };
 
+struct mt_thread;
+
+/** Registers saved by mtarch_switch(): r2-r17, r28 and r29 */
+#define MTARCH_FRAME_REGS 18
+
+/**
+ * \brief Switches to another stack
+ * \param save Stores the current stack pointer, to switch back to later
+ * \param next Stack pointer to continue on, saved by an earlier call or
+ *             returned by mtarch_frame()
+ *
+ * Only the callee-saved registers are kept on the stack, so this is
+ * meant for cooperative yield points and costs about half of a switch of
+ * the whole register file.
+ * Returns when something switches back to the saved stack pointer.
+ */
+void mtarch_switch(unsigned char **save, unsigned char *next)
+  __attribute__((naked, noinline));
+
+/**
+ * \brief Prepares a stack to run a function on
+ * \param stack Stack memory
+ * \param size  Size of \p stack
+ * \param function Function started by the first mtarch_switch() to the
+ *                 returned stack pointer
+ * \param data  Argument of \p function
+ * \param exit  Called if \p function returns, must not return itself
+ * \return Initial stack pointer
+ */
+unsigned char *mtarch_frame(unsigned char *stack, uint16_t size,
+                            void (*function)(void *), void *data,
+                            void (*exit)(void));
+
+/**
+ * \return Number of stack bytes the thread used since it was started
+ */
+int mtarch_stack_usage(struct mt_thread *t);
+
 #endif /* MTARCH_H_ */
 	
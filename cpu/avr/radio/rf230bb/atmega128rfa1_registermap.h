@@ -153,6 +153,12 @@
 #define RG_TRX_CTRL_0                    (0x03)
 /** Offset for register TRX_CTRL_1 */
 #define RG_TRX_CTRL_1                    (0x04)
+/** Offset for register TRX_CTRL_2 */
+#define RG_TRX_CTRL_2                    (0x0c)
+/** Access parameters for sub-register RX_SAFE_MODE in register @ref RG_TRX_CTRL_2 */
+#define SR_RX_SAFE_MODE              0x0c, 0x80, 7
+/** Access parameters for sub-register OQPSK_DATA_RATE in register @ref RG_TRX_CTRL_2 */
+#define SR_OQPSK_DATA_RATE           0x0c, 0x03, 0
 /** Access parameters for sub-register PAD_IO in register @ref RG_TRX_CTRL_0 */
 #define SR_PAD_IO                    0x03, 0xc0, 6
 /** Access parameters for sub-register PAD_IO_CLKM in register @ref RG_TRX_CTRL_0 */
@@ -278,6 +284,8 @@
 #define RG_RX_SYN                        0x15
 /** Offset for register XAH_CTRL_1 */
 #define RG_XAH_CTRL_1                      0x17
+/** Access parameters for sub-register AACK_ACK_TIME in register @ref RG_XAH_CTRL_1 */
+#define SR_AACK_ACK_TIME             0x17, 0x04, 2
 /** Access parameters for sub-register XTAL_MODE in register @ref RG_XOSC_CTRL */
 #define SR_XTAL_MODE                 0x12, 0xf0, 4
 /** Access parameters for sub-register XTAL_TRIM in register @ref RG_XOSC_CTRL */
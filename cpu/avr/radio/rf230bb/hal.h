@@ -58,6 +58,9 @@
 #include <stdbool.h>
 //#include <util/crc16.h>
 #include "contiki-conf.h"
+#if RF230_CONF_TIMESTAMPS
+#include "sys/rtimer.h"
+#endif
 /*============================ MACROS ========================================*/
 
 /** \name This is the list of pin configurations needed for a given platform.
@@ -471,6 +474,9 @@ typedef struct{
     uint8_t data[ HAL_MAX_FRAME_LENGTH ]; /**< Actual frame data. */
     uint8_t lqi;                          /**< LQI value for received frame. */
     bool crc;                             /**< Flag - did CRC pass for received frame? */
+#if RF230_CONF_TIMESTAMPS
+    rtimer_clock_t time;                  /**< Local rtimer time of the RX_START interrupt. */
+#endif
 } hal_rx_frame_t;
 
 
@@ -73,6 +73,13 @@ extern uint8_t debugflowsize,debugflow[DEBUGFLOWSIZE];
 
 #include "hal.h"
 
+#ifdef __AVR__
+#include "isr-stats.h"
+#else
+#define ISR_STATS_ENTER(id)
+#define ISR_STATS_EXIT(id)
+#endif
+
 #if defined(__AVR_ATmega128RFA1__)
 #include <avr/io.h>
 #include "atmega128rfa1_registermap.h"
@@ -685,7 +692,8 @@ hal_frame_write(uint8_t *write_buffer, uint8_t length)
  * \param length Length of the read burst
  * \param data Pointer to buffer where data is stored.
  */
-#if 0  //Uses 80 bytes (on Raven) omit unless needed
+/* Unused SRAM functions are dropped by the linker (--gc-sections) */
+#if !defined(__AVR_ATmega128RFA1__)
 void
 hal_sram_read(uint8_t address, uint8_t length, uint8_t *data)
 {
@@ -718,7 +726,7 @@ hal_sram_read(uint8_t address, uint8_t length, uint8_t *data)
  * \param length  Length of the write burst
  * \param data    Pointer to an array of bytes that should be written
  */
-#if 0  //omit unless needed
+#if !defined(__AVR_ATmega128RFA1__)
 void
 hal_sram_write(uint8_t address, uint8_t length, uint8_t *data)
 {
@@ -752,9 +760,15 @@ void RADIO_VECT(void);
 #else  /* !DOXYGEN */
 /* These link to the RF230BB driver in rf230.c */
 void rf230_interrupt(void);
+void rf230_rx_overflow(void);
+extern volatile uint8_t rf230_rx_started;
 
 extern hal_rx_frame_t rxframe[RF230_CONF_RX_BUFFERS];
 extern uint8_t rxframe_head,rxframe_tail;
+#if RF230_CONF_TIMESTAMPS
+/* Time of the last RX_START interrupt, stored with the frame at TRX_END */
+static rtimer_clock_t rx_start_time;
+#endif
 
 /* rf230interruptflag can be printed in the main idle loop for debugging */
 #define DEBUG 0
@@ -789,15 +803,31 @@ ISR(TRX24_RX_END_vect)
 	if (1) {
 #endif
 //		DEBUGFLOW('2');
-		hal_frame_read(&rxframe[rxframe_tail]);
-		rxframe_tail++;if (rxframe_tail >= RF230_CONF_RX_BUFFERS) rxframe_tail=0;
-		rf230_interrupt();
+		if (rxframe[rxframe_tail].length) {
+			/* All buffers in use, do not overwrite the oldest frame */
+			rf230_rx_overflow();
+		} else {
+			hal_frame_read(&rxframe[rxframe_tail]);
+			/* hal_frame_read leaves the length zero for invalid frames */
+			if (rxframe[rxframe_tail].length) {
+#if RF230_CONF_TIMESTAMPS
+				rxframe[rxframe_tail].time = rx_start_time;
+#endif
+				rxframe_tail++;if (rxframe_tail >= RF230_CONF_RX_BUFFERS) rxframe_tail=0;
+				rf230_interrupt();
+			}
+		}
 	}
+	rf230_rx_started = 0;
 }
 /* Preamble detected, starting frame reception */
 ISR(TRX24_RX_START_vect)
 {
 //	DEBUGFLOW('3');
+#if RF230_CONF_TIMESTAMPS
+	rx_start_time = RTIMER_NOW();
+#endif
+	rf230_rx_started = 1;
 /* Save RSSI for this packet if not in extended mode, scaling to 1dB resolution */
 #if !RF230_CONF_AUTOACK
     rf230_last_rssi = 3 * hal_subregister_read(SR_RSSI);
@@ -852,6 +882,7 @@ HAL_RF230_ISR()
 {
     volatile uint8_t state;
     uint8_t interrupt_source; /* used after HAL_SPI_TRANSFER_OPEN/CLOSE block */
+    ISR_STATS_ENTER(ISR_STATS_RADIO);
 
     INTERRUPTDEBUG(1);
 
@@ -873,6 +904,10 @@ HAL_RF230_ISR()
     /*Handle the incomming interrupt. Prioritized.*/
     if ((interrupt_source & HAL_RX_START_MASK)){
 	   INTERRUPTDEBUG(10);
+#if RF230_CONF_TIMESTAMPS
+	   rx_start_time = RTIMER_NOW();
+#endif
+	   rf230_rx_started = 1;
     /* Save RSSI for this packet if not in extended mode, scaling to 1dB resolution */
 #if !RF230_CONF_AUTOACK
 #if 0  // 3-clock shift and add is faster on machines with no hardware multiply
@@ -884,8 +919,11 @@ HAL_RF230_ISR()
 #endif
 #endif
 
-    } else if (interrupt_source & HAL_TRX_END_MASK){
+    }
+    /* RX_START and TRX_END of a short frame can be pending together */
+    if (interrupt_source & HAL_TRX_END_MASK){
 	   INTERRUPTDEBUG(11);	    	    
+       rf230_rx_started = 0;
         
        state = hal_subregister_read(SR_TRX_STATUS);
        if((state == BUSY_RX_AACK) || (state == RX_ON) || (state == BUSY_RX) || (state == RX_AACK_ON)){
@@ -902,9 +940,20 @@ HAL_RF230_ISR()
 #endif
          if (rf230_last_rssi >= RF230_MIN_RX_POWER) {
 #endif
-           hal_frame_read(&rxframe[rxframe_tail]);
-           rxframe_tail++;if (rxframe_tail >= RF230_CONF_RX_BUFFERS) rxframe_tail=0;
-           rf230_interrupt();
+           if (rxframe[rxframe_tail].length) {
+             /* All buffers in use, do not overwrite the oldest frame */
+             rf230_rx_overflow();
+           } else {
+             hal_frame_read(&rxframe[rxframe_tail]);
+             /* hal_frame_read leaves the length zero for invalid frames */
+             if (rxframe[rxframe_tail].length) {
+#if RF230_CONF_TIMESTAMPS
+               rxframe[rxframe_tail].time = rx_start_time;
+#endif
+               rxframe_tail++;if (rxframe_tail >= RF230_CONF_RX_BUFFERS) rxframe_tail=0;
+               rf230_interrupt();
+             }
+           }
 #ifdef RF230_MIN_RX_POWER
          }
 #endif
@@ -933,6 +982,7 @@ HAL_RF230_ISR()
         INTERRUPTDEBUG(99);
 	    ;
     }
+    ISR_STATS_EXIT(ISR_STATS_RADIO);
 }
 #endif /* defined(__AVR_ATmega128RFA1__) */ 
 #   endif /* defined(DOXYGEN) */
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         AES encryption with the AT86RF231 security module
+ */
+
+#include <string.h>
+#include "contiki.h"
+#include "hal.h"
+#include "rf230-aes.h"
+
+#include <util/delay_basic.h>
+
+/* Security module registers in the transceiver SRAM address space */
+#define AES_STATUS       0x82
+#define AES_CTRL         0x83
+#define AES_STATE_KEY    0x84
+#define AES_CTRL_MIRROR  0x94
+
+#define AES_STATUS_DONE  0x01
+#define AES_REQUEST      0x80
+#define AES_MODE_ECB     0x00
+#define AES_MODE_KEY     0x10
+#define AES_MODE_CBC     0x20
+
+/* Transition time from SLEEP to TRX_OFF in microseconds, doubled as in
+ * rf230bb.c for the board capacitance */
+#define AES_WAKE_TIME    (2 * 880UL)
+
+static uint8_t key[AES_128_KEY_LENGTH];
+
+/*---------------------------------------------------------------------------*/
+/* Load the key and wake the transceiver if needed, returns the SLP_TR state */
+static uint8_t
+aes_begin(void)
+{
+  uint8_t cmd[AES_128_KEY_LENGTH + 1];
+  uint8_t sleeping;
+
+  sleeping = hal_get_slptr();
+  if(sleeping) {
+    hal_set_slptr_low();
+    _delay_loop_2(AES_WAKE_TIME * F_CPU / 4000000UL);
+  }
+
+  cmd[0] = AES_MODE_KEY;
+  memcpy(&cmd[1], key, AES_128_KEY_LENGTH);
+  hal_sram_write(AES_CTRL, sizeof(cmd), cmd);
+  return sleeping;
+}
+/*---------------------------------------------------------------------------*/
+static void
+aes_end(uint8_t sleeping)
+{
+  if(sleeping) {
+    hal_set_slptr_high();
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Write one block and start the engine, the request in AES_CTRL_MIRROR
+ * starts it within the same SPI burst */
+static void
+aes_block(uint8_t mode, const uint8_t *block)
+{
+  uint8_t cmd[AES_128_BLOCK_SIZE + 2];
+  uint8_t status;
+
+  cmd[0] = mode;
+  memcpy(&cmd[1], block, AES_128_BLOCK_SIZE);
+  cmd[AES_128_BLOCK_SIZE + 1] = AES_REQUEST | mode;
+  hal_sram_write(AES_CTRL, sizeof(cmd), cmd);
+
+  do {
+    hal_sram_read(AES_STATUS, 1, &status);
+  } while(!(status & AES_STATUS_DONE));
+}
+/*---------------------------------------------------------------------------*/
+void
+rf230_aes_set_key(const uint8_t *k)
+{
+  memcpy(key, k, AES_128_KEY_LENGTH);
+}
+/*---------------------------------------------------------------------------*/
+void
+rf230_aes_encrypt(uint8_t *block)
+{
+  uint8_t sleeping;
+
+  /* The RDC may switch the radio off from an rtimer interrupt */
+  HAL_ENTER_CRITICAL_REGION();
+  sleeping = aes_begin();
+  aes_block(AES_MODE_ECB, block);
+  hal_sram_read(AES_STATE_KEY, AES_128_BLOCK_SIZE, block);
+  aes_end(sleeping);
+  HAL_LEAVE_CRITICAL_REGION();
+}
+/*---------------------------------------------------------------------------*/
+void
+rf230_aes_cbc_mac(uint8_t *mac, const uint8_t *data, uint16_t len)
+{
+  uint8_t block[AES_128_BLOCK_SIZE];
+  uint8_t sleeping;
+  uint8_t mode;
+  uint8_t i, n;
+
+  if(len == 0) {
+    return;
+  }
+
+  HAL_ENTER_CRITICAL_REGION();
+  sleeping = aes_begin();
+  /* The first block is chained with mac in software, the engine
+   * XORs the following blocks with its previous result in CBC mode */
+  mode = AES_MODE_ECB;
+  memcpy(block, mac, AES_128_BLOCK_SIZE);
+  while(len > 0) {
+    n = len < AES_128_BLOCK_SIZE ? len : AES_128_BLOCK_SIZE;
+    if(mode == AES_MODE_ECB) {
+      for(i = 0; i < n; i++) {
+        block[i] ^= data[i];
+      }
+    } else {
+      memcpy(block, data, n);
+      memset(block + n, 0, AES_128_BLOCK_SIZE - n);
+    }
+    aes_block(mode, block);
+    mode = AES_MODE_CBC;
+    data += n;
+    len -= n;
+  }
+  hal_sram_read(AES_STATE_KEY, AES_128_BLOCK_SIZE, mac);
+  aes_end(sleeping);
+  HAL_LEAVE_CRITICAL_REGION();
+}
+/*---------------------------------------------------------------------------*/
+const struct aes_128_driver rf230_aes_128_driver = {
+  rf230_aes_set_key,
+  rf230_aes_encrypt
+};
+/*---------------------------------------------------------------------------*/
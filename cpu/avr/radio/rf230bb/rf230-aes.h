@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Interface to the AES engine of the AT86RF231
+ *
+ *         The transceiver encrypts a 16-byte block in about 24 us. The
+ *         key is kept in RAM and loaded for every call, so it does not
+ *         depend on the transceiver state. Decryption is not provided,
+ *         CCM* only uses the forward cipher.
+ */
+
+#ifndef RF230_AES_H_
+#define RF230_AES_H_
+
+#include <stdint.h>
+#include "lib/aes-128.h"
+
+/**
+ * \brief     Set up the AES key
+ * \param key A pointer to a 16-byte AES key
+ */
+void rf230_aes_set_key(const uint8_t *key);
+
+/**
+ * \brief       Encrypt one block in place (ECB)
+ * \param block A pointer to the 16-byte block to encrypt
+ *
+ *              A sleeping transceiver is woken up for the operation
+ *              and put back to sleep, which takes about 2 ms with
+ *              interrupts disabled.
+ */
+void rf230_aes_encrypt(uint8_t *block);
+
+/**
+ * \brief      Continue a CBC-MAC over data
+ * \param mac  The 16-byte chaining value, zero to start a new MAC
+ * \param data The data to authenticate
+ * \param len  The length of data, the last block is padded with zeroes
+ *
+ *             The blocks are chained in the transceiver, only the
+ *             result is read back to mac.
+ */
+void rf230_aes_cbc_mac(uint8_t *mac, const uint8_t *data, uint16_t len);
+
+extern const struct aes_128_driver rf230_aes_128_driver;
+
+#endif /* RF230_AES_H_ */
@@ -61,6 +61,7 @@
 
 #include "dev/leds.h"
 #include "dev/spi.h"
+#include "net/link-stats.h"
 #include "rf230bb.h"
 
 #include "net/packetbuf.h"
@@ -69,7 +70,10 @@
 
 #define WITH_SEND_CCA 0
 
-/* Timestamps have not been tested */
+/* With timestamps every frame carries the network time of its transmission
+ * in a trailer before the FCS, see struct timestamp. Receivers synchronize
+ * to it with the time of the RX_START interrupt, so the time synchronization
+ * needs no frames of its own. */
 #if RF230_CONF_TIMESTAMPS
 #include "net/rime/timesynch.h"
 #define TIMESTAMP_LEN 3
@@ -92,6 +96,43 @@
 /* We need to turn off autoack in promiscuous mode */
 #if RF230_CONF_AUTOACK
 static bool is_promiscuous;
+/* Promiscuous mode receives in RX_ON, without address filter and ACKs */
+#define RX_STATE (is_promiscuous ? RX_ON : RX_AACK_ON)
+#else
+#define RX_STATE RX_ON
+#endif
+
+/* In RX_AACK_ON the transceiver drops the frames that are neither broadcast
+ * nor addressed to the PAN and addresses set with rf230_set_pan_addr(), only
+ * the others raise TRX_END. With the RX_START interrupt masked too, the MCU
+ * does not wake up for the dropped frames at all and rf230_receiving_packet()
+ * reads TRX_STATUS instead. Non-extended mode samples the RSSI at RX_START.
+ */
+#ifndef RF230_CONF_RX_START_IRQ
+#define RF230_CONF_RX_START_IRQ !RF230_CONF_AUTOACK
+#endif
+
+#if RF230_CONF_RX_START_IRQ
+#define RF230_INTERRUPT_MASK RF230_SUPPORTED_INTERRUPT_MASK
+#else
+#define RF230_INTERRUPT_MASK (RF230_SUPPORTED_INTERRUPT_MASK & ~HAL_RX_START_MASK)
+#endif
+
+/* Time from lowering SLP_TR until the SPI may be used. It depends on board
+ * capacitance, the default is 2x the nominal RF230 value for safety.
+ * With RF230_CONF_FAST_WAKE the transceiver, known to be in TRX_OFF after a
+ * wakeup, is sent straight to the receive or transmit state and given the
+ * documented PLL settling time instead of polling TRX_STATUS. Only enable
+ * it on boards where WAKE_DELAY was checked against the hardware.
+ */
+#ifdef RF230_CONF_WAKE_DELAY
+#define WAKE_DELAY RF230_CONF_WAKE_DELAY
+#else
+#define WAKE_DELAY (2*TIME_SLEEP_TO_TRX_OFF)
+#endif
+
+#ifndef RF230_CONF_FAST_WAKE
+#define RF230_CONF_FAST_WAKE 0
 #endif
 
 /* RF230_CONF_FRAME_RETRIES is 1 plus the number written to the hardware. */
@@ -104,6 +145,20 @@ static bool is_promiscuous;
 #endif
 #endif
 
+/* With RF230_CONF_COUNT_FRAME_RETRIES the driver repeats the attempts
+ * itself, one hardware CSMA-CA and ACK wait each, instead of leaving
+ * the retries to the transceiver. The transceiver does not tell how many
+ * were needed, the driver knows it exactly. In extended mode the number
+ * of frames sent goes to PACKETBUF_ATTR_MAC_TRANSMISSIONS either way.
+ */
+#ifndef RF230_CONF_COUNT_FRAME_RETRIES
+#define RF230_CONF_COUNT_FRAME_RETRIES 0
+#endif
+
+#if RF230_CONF_COUNT_FRAME_RETRIES && RF230_CONF_FRAME_RETRIES > 1
+#define RF230_COUNT_FRAME_RETRIES 1
+#endif
+
 /* In extended mode (FRAME_RETRIES>0) the tx routine waits for hardware
  * processing of an expected ACK and returns RADIO_TX_OK/NOACK result.
  * In non-extended mode the ACK is treated as a normal rx packet.
@@ -131,6 +186,21 @@ uint8_t ack_pending,ack_seqnum;
 #define RF230_CONF_CSMA_RETRIES 5
 #endif
 
+#if RF230_CONF_TIMESTAMPS
+/* From the SLP_TR strobe until the end of the PHR, when the receiver
+ * signals RX_START: 16 us TX start, 5 bytes SHR and the 1 byte PHR at
+ * 250 kb/s, which is the same for the high data rates. In TX_ARET mode
+ * the first CSMA attempt adds the 128 us CCA, the minimum backoff
+ * exponent is 0. */
+#ifdef RF230_CONF_TIMESTAMP_DELAY
+#define TIMESTAMP_DELAY RF230_CONF_TIMESTAMP_DELAY
+#elif RF230_CONF_FRAME_RETRIES && RF230_CONF_CSMA_RETRIES != 7
+#define TIMESTAMP_DELAY ((RTIMER_ARCH_SECOND * 336UL + 500000UL) / 1000000UL)
+#else
+#define TIMESTAMP_DELAY ((RTIMER_ARCH_SECOND * 208UL + 500000UL) / 1000000UL)
+#endif
+#endif /* RF230_CONF_TIMESTAMPS */
+
 //Automatic and manual CRC both append 2 bytes to packets 
 #if RF230_CONF_CHECKSUM || defined(RF230BB_HOOK_TX_PACKET)
 #include "lib/crc16.h"
@@ -139,7 +209,7 @@ uint8_t ack_pending,ack_seqnum;
 
 /* Note the AUX_LEN is equal to the CHECKSUM_LEN in any tested configurations to date! */
 #define AUX_LEN (CHECKSUM_LEN + TIMESTAMP_LEN + FOOTER_LEN)
-#if AUX_LEN != CHECKSUM_LEN
+#if AUX_LEN != CHECKSUM_LEN + TIMESTAMP_LEN
 #warning RF230 Untested Configuration!
 #endif
 
@@ -184,6 +254,16 @@ struct timestamp {
 #endif
 #if RADIOSTATS
 uint16_t RF230_sendpackets,RF230_receivepackets,RF230_sendfail,RF230_receivefail;
+/* Frames lost because all receive buffers were in use */
+uint16_t RF230_receivedropped;
+#endif
+
+/* RF230_CONF_RX_ZEROCOPY=1 hands the receive buffer to the MAC as packetbuf
+ * data area with packetbuf_borrow() instead of copying the frame. The buffer
+ * is held while the stack processes the frame, so use two or more buffers.
+ */
+#ifndef RF230_CONF_RX_ZEROCOPY
+#define RF230_CONF_RX_ZEROCOPY 0
 #endif
 
 #if RADIO_CONF_CALIBRATE_INTERVAL
@@ -203,13 +283,11 @@ extern uint8_t debugflowsize,debugflow[DEBUGFLOWSIZE];
 
 /* XXX hack: these will be made as Chameleon packet attributes */
 #if RF230_CONF_TIMESTAMPS
+/* Local rtimer time of the RX_START of the last received frame and the
+ * network time of the sender at that moment */
 rtimer_clock_t rf230_time_of_arrival, rf230_time_of_departure;
 
 int rf230_authority_level_of_sender;
-
-static rtimer_clock_t setup_time_for_transmission;
-static unsigned long total_time_for_transmission, total_transmission_len;
-static int num_transmissions;
 #endif
 
 #if defined(__AVR_ATmega128RFA1__)
@@ -269,13 +347,46 @@ const struct radio_driver rf230_driver =
     rf230_on,
     rf230_off
   };
+#if NETSTACK_CONF_STATIC
+NETSTACK_STATIC_EXPORT(rf230_driver_init, rf230_init);
+NETSTACK_STATIC_EXPORT(rf230_driver_prepare, rf230_prepare);
+NETSTACK_STATIC_EXPORT(rf230_driver_transmit, rf230_transmit);
+NETSTACK_STATIC_EXPORT(rf230_driver_send, rf230_send);
+NETSTACK_STATIC_EXPORT(rf230_driver_read, rf230_read_fakeack);
+NETSTACK_STATIC_EXPORT(rf230_driver_channel_clear, rf230_cca);
+NETSTACK_STATIC_EXPORT(rf230_driver_receiving_packet, rf230_receiving_packet);
+NETSTACK_STATIC_EXPORT(rf230_driver_pending_packet, rf230_pending_packet);
+NETSTACK_STATIC_EXPORT(rf230_driver_on, rf230_on);
+NETSTACK_STATIC_EXPORT(rf230_driver_off, rf230_off);
+#endif /* NETSTACK_CONF_STATIC */
 
 uint8_t RF230_receive_on;
 static uint8_t channel;
-
-/* Received frames are buffered to rxframe in the interrupt routine in hal.c */
+/* Set while sleeping, written to the transceiver as it wakes up */
+static uint8_t channel_pending;
+/* Current RF230_DATA_RATE_*, also used to scale the RDC timing */
+uint8_t rf230_data_rate = RF230_CONF_DATA_RATE;
+/* Set by the RX_START interrupt in halbb.c until the frame has been buffered */
+volatile uint8_t rf230_rx_started;
+/* Start of the last transmission on air, see rf230_last_tx_time() */
+static rtimer_clock_t last_tx_time;
+
+/* On-air time in us of len bytes of PSDU with the 6-byte PHY header, and of
+ * an ACK with its turnaround of 12 symbols (2 with AACK_ACK_TIME) */
+#define FRAME_AIRTIME_US(len)  ((((len) + 6) * 32UL) >> rf230_data_rate)
+#define ACK_AIRTIME_US         ((rf230_data_rate ? 32UL : 192UL) + FRAME_AIRTIME_US(5))
+#define US_TO_RTIMER(us)       ((rtimer_clock_t)((us) * RTIMER_ARCH_SECOND / 1000000UL))
+
+/* Received frames are buffered to rxframe in the interrupt routine in hal.c.
+ * The ring is empty at rxframe_head and full at rxframe_tail when the length
+ * field of the buffer is nonzero.
+ */
 uint8_t rxframe_head,rxframe_tail;
 hal_rx_frame_t rxframe[RF230_CONF_RX_BUFFERS];
+#if RF230_CONF_RX_ZEROCOPY
+/* Set while the stack processes the frame at rxframe_head in place */
+static uint8_t rxframe_held;
+#endif
 
 /*----------------------------------------------------------------------------*/
 /** \brief  This function return the Radio Transceivers current state.
@@ -370,6 +481,13 @@ radio_reset_state_machine(void)
     delay_us(TIME_CMD_FORCE_TRX_OFF);
 }
 /*---------------------------------------------------------------------------*/
+static void
+radio_wake_to_state(uint8_t new_state)
+{
+    hal_subregister_write(SR_TRX_CMD, new_state);
+    delay_us(TIME_TRX_OFF_TO_PLL_ACTIVE);
+}
+/*---------------------------------------------------------------------------*/
 static char
 rf230_isidle(void)
 {
@@ -507,8 +625,12 @@ void
 rf230_set_promiscuous_mode(bool isPromiscuous) {
 #if RF230_CONF_AUTOACK
     is_promiscuous = isPromiscuous;
-/* TODO: Figure out when to pass promisc state to 802.15.4 */
-//    radio_set_trx_state(is_promiscuous?RX_ON:RX_AACK_ON);
+    if (RF230_receive_on && !hal_get_slptr()) {
+      /* No direct transition between basic and extended receive states */
+      rf230_waitidle();
+      radio_set_trx_state(PLL_ON);
+      radio_set_trx_state(RX_STATE);
+    }
 #endif
 }
 
@@ -524,15 +646,40 @@ rf230_is_ready_to_send() {
 }
 
 
+/* Free the buffer at rxframe_head for the ISR and move to the next frame.
+ * Must be called with interrupts disabled.
+ */
 static void
 flushrx(void)
 {
   rxframe[rxframe_head].length=0;
+  rxframe_head++;
+  if (rxframe_head >= RF230_CONF_RX_BUFFERS) {
+    rxframe_head=0;
+  }
+  /* If another packet has been buffered, schedule another receive poll */
+  if (rxframe[rxframe_head].length) {
+    process_poll(&rf230_process);
+  } else {
+    rf230_pending = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Called by the ISR in halbb.c when a frame arrives while all buffers are full */
+void
+rf230_rx_overflow(void)
+{
+  DEBUGFLOW('0');
+#if RADIOSTATS
+  RF230_receivedropped++;
+#endif
 }
 /*---------------------------------------------------------------------------*/
 static void
 radio_on(void)
 {
+  uint8_t woke = 0;
+
 //   ENERGEST_OFF(ENERGEST_TYPE_LISTEN);//testing
   ENERGEST_ON(ENERGEST_TYPE_LISTEN);
   RF230_receive_on = 1;
@@ -542,6 +689,7 @@ radio_on(void)
 
 /* If radio is off (slptr high), turn it on */
   if (hal_get_slptr()) {
+    woke = 1;
     ENERGEST_ON(ENERGEST_TYPE_LED_RED);
 #if RF230BB_CONF_LEDONPORTE1
     PORTE|=(1<<PE1); //ledon
@@ -570,17 +718,20 @@ radio_on(void)
  */
 //  uint8_t sreg = SREG;cli();
     hal_set_slptr_low();
-    delay_us(2*TIME_SLEEP_TO_TRX_OFF);
+    delay_us(WAKE_DELAY);
 //  SREG=sreg;
 #endif
   }
+  if (channel_pending) {
+    channel_pending = 0;
+    hal_subregister_write(SR_CHANNEL, channel);
+  }
+  if (RF230_CONF_FAST_WAKE && woke) {
+    radio_wake_to_state(RX_STATE);
+    return;
+  }
 
-#if RF230_CONF_AUTOACK
- // radio_set_trx_state(is_promiscuous?RX_ON:RX_AACK_ON);
-  radio_set_trx_state(RX_AACK_ON);
-#else
-  radio_set_trx_state(RX_ON);
-#endif
+  radio_set_trx_state(RX_STATE);
   rf230_waitidle();
 }
 static void
@@ -620,7 +771,9 @@ radio_off(void)
 #endif
 #endif /* RADIOALWAYSON */
 
-   ENERGEST_OFF(ENERGEST_TYPE_LISTEN);
+   /* A frame being received is lost */
+  rf230_rx_started = 0;
+  ENERGEST_OFF(ENERGEST_TYPE_LISTEN);
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -821,12 +974,17 @@ void rf230_warm_reset(void) {
   DDRB  &= ~(1<<7);
 #endif
   
-  hal_register_write(RG_IRQ_MASK, RF230_SUPPORTED_INTERRUPT_MASK);
+  hal_register_write(RG_IRQ_MASK, RF230_INTERRUPT_MASK);
 
   /* Set up number of automatic retries 0-15
    * (0 implies PLL_ON sends instead of the extended TX_ARET mode */
+#if RF230_COUNT_FRAME_RETRIES
+  /* rf230_transmit() repeats the attempts */
+  hal_subregister_write(SR_MAX_FRAME_RETRIES, 0);
+#else
   hal_subregister_write(SR_MAX_FRAME_RETRIES,
       (RF230_CONF_FRAME_RETRIES > 0) ? (RF230_CONF_FRAME_RETRIES - 1) : 0 );
+#endif
  
  /* Set up carrier sense/clear channel assesment parameters for extended operating mode */
   hal_subregister_write(SR_MAX_CSMA_RETRIES, RF230_CONF_CSMA_RETRIES );//highest allowed retries
@@ -881,6 +1039,11 @@ void rf230_warm_reset(void) {
 #ifdef RF230_MAX_TX_POWER
   set_txpower(RF230_MAX_TX_POWER);  //0=3dbm 15=-17.2dbm
 #endif
+
+  /* Restore the data rate, a reset clears TRX_CTRL_2 */
+  if (rf230_data_rate != RF230_DATA_RATE_250 && !rf230_set_data_rate(rf230_data_rate)) {
+    rf230_data_rate = RF230_DATA_RATE_250;
+  }
 }
 /*---------------------------------------------------------------------------*/
 static uint8_t buffer[RF230_MAX_TX_FRAME_LENGTH+AUX_LEN];
@@ -891,6 +1054,13 @@ rf230_transmit(unsigned short payload_len)
   int txpower;
   uint8_t total_len;
   uint8_t tx_result;
+  uint8_t woke = 0;
+#if LINK_STATS_TXPOWER
+  uint8_t txsteps = 0;
+#endif /* LINK_STATS_TXPOWER */
+#if RF230_COUNT_FRAME_RETRIES
+  uint8_t transmissions;
+#endif /* RF230_COUNT_FRAME_RETRIES */
 #if RF230_CONF_TIMESTAMPS
   struct timestamp timestamp;
 #endif /* RF230_CONF_TIMESTAMPS */
@@ -898,6 +1068,7 @@ rf230_transmit(unsigned short payload_len)
   /* If radio is sleeping we have to turn it on first */
   /* This automatically does the PLL calibrations */
   if (hal_get_slptr()) {
+    woke = 1;
 #if defined(__AVR_ATmega128RFA1__)
 	ENERGEST_ON(ENERGEST_TYPE_LED_RED);
 #if RF230BB_CONF_LEDONPORTE1
@@ -915,8 +1086,12 @@ rf230_transmit(unsigned short payload_len)
 #else
     hal_set_slptr_low();
     DEBUGFLOW('j');
-    delay_us(2*TIME_SLEEP_TO_TRX_OFF); //extra delay (2x) depends on board capacitance
+    delay_us(WAKE_DELAY); //extra delay depends on board capacitance
 #endif
+    if (channel_pending) {
+      channel_pending = 0;
+      hal_subregister_write(SR_CHANNEL, channel);
+    }
 
   } else {
 #if RADIO_CONF_CALIBRATE_INTERVAL
@@ -939,10 +1114,18 @@ rf230_transmit(unsigned short payload_len)
   }
   /* Prepare to transmit */
 #if RF230_CONF_FRAME_RETRIES
-  radio_set_trx_state(TX_ARET_ON);
+  if (RF230_CONF_FAST_WAKE && woke) {
+    radio_wake_to_state(TX_ARET_ON);
+  } else {
+    radio_set_trx_state(TX_ARET_ON);
+  }
   DEBUGFLOW('t');
 #else
-  radio_set_trx_state(PLL_ON);
+  if (RF230_CONF_FAST_WAKE && woke) {
+    radio_wake_to_state(PLL_ON);
+  } else {
+    radio_set_trx_state(PLL_ON);
+  }
   DEBUGFLOW('T');
 #endif
 
@@ -954,18 +1137,39 @@ rf230_transmit(unsigned short payload_len)
     /* Set the specified transmission power */
     set_txpower(packetbuf_attr(PACKETBUF_ATTR_RADIO_TXPOWER) - 1);
   }
+#if LINK_STATS_TXPOWER
+  else {
+    /* Lower the power towards neighbors that are heard well, higher
+     * register values are lower power */
+    txsteps = link_stats_txpower(packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
+    if(txsteps > 0) {
+      txpower = rf230_get_txpower();
+      set_txpower(txpower + txsteps);
+    }
+  }
+#endif /* LINK_STATS_TXPOWER */
 
   total_len = payload_len + AUX_LEN;
 
-#if RF230_CONF_TIMESTAMPS
-  rtimer_clock_t txtime = timesynch_time();
-#endif /* RF230_CONF_TIMESTAMPS */
-
   ENERGEST_ON(ENERGEST_TYPE_TRANSMIT);
+
+#if RF230_COUNT_FRAME_RETRIES
+  transmissions = 0;
+  do {
+#endif /* RF230_COUNT_FRAME_RETRIES */
   
 /* No interrupts across frame download! */
   HAL_ENTER_CRITICAL_REGION();
 
+#if RF230_CONF_TIMESTAMPS
+  /* Stamp each transmission, e.g. every strobe of contikimac and every
+   * retransmission by the MAC, with the time it goes on air. A frame
+   * sent after a CSMA retry of the radio is stamped too early. */
+  timestamp.authority_level = timesynch_authority_level();
+  timestamp.time = timesynch_time();
+  memcpy(buffer + payload_len, &timestamp, TIMESTAMP_LEN);
+#endif /* RF230_CONF_TIMESTAMPS */
+
   /* Toggle the SLP_TR pin to initiate the frame transmission, then transfer
    * the frame. We have about 16 us + the on-air transmission time of 40 bits
    * (for the synchronization header) before the transceiver sends the PHR. */
@@ -996,8 +1200,38 @@ rf230_transmit(unsigned short payload_len)
      accurate measurement of the transmission time.*/
   rf230_waitidle();
 
+#if RF230_COUNT_FRAME_RETRIES
+    tx_result = hal_subregister_read(SR_TRAC_STATUS);
+    if(tx_result != 3) {
+      /* Not a channel access failure, the frame went on air */
+      transmissions++;
+    }
+#if LINK_STATS_TXPOWER
+    if(tx_result == 5 && txsteps > 0) {
+      /* Repeat at the configured power */
+      set_txpower(txpower & 0xff);
+      txsteps = 0;
+    }
+#endif /* LINK_STATS_TXPOWER */
+    /* Repeat while the ACK is missing */
+  } while(tx_result == 5 && transmissions < RF230_CONF_FRAME_RETRIES);
+#endif /* RF230_COUNT_FRAME_RETRIES */
+
+  /* The transceiver is idle right after the frame and the ACK ended on
+   * air, which gives the start of the last attempt after hardware CSMA
+   * and retries */
+  {
+    uint32_t airtime = FRAME_AIRTIME_US(total_len);
+    if (buffer[0] & 0x20) {
+      airtime += ACK_AIRTIME_US;
+    }
+    last_tx_time = RTIMER_NOW() - US_TO_RTIMER(airtime);
+  }
+
  /* Get the transmission result */  
-#if RF230_CONF_FRAME_RETRIES
+#if RF230_COUNT_FRAME_RETRIES
+  /* Read in the loop above */
+#elif RF230_CONF_FRAME_RETRIES
   tx_result = hal_subregister_read(SR_TRAC_STATUS);
 #else
   tx_result=RADIO_TX_OK;
@@ -1011,18 +1245,12 @@ rf230_transmit(unsigned short payload_len)
  if(packetbuf_attr(PACKETBUF_ATTR_RADIO_TXPOWER) > 0) {
     set_txpower(txpower & 0xff);
   }
- 
-#if RF230_CONF_TIMESTAMPS
-  setup_time_for_transmission = txtime - timestamp.time;
-
-  if(num_transmissions < 10000) {
-    total_time_for_transmission += timesynch_time() - txtime;
-    total_transmission_len += total_len;
-    num_transmissions++;
+#if LINK_STATS_TXPOWER
+  else if(txsteps > 0) {
+    set_txpower(txpower & 0xff);
   }
-
-#endif /* RF230_CONF_TIMESTAMPS */
-
+#endif /* LINK_STATS_TXPOWER */
+ 
   ENERGEST_OFF(ENERGEST_TYPE_TRANSMIT);
   if(RF230_receive_on) {
     DEBUGFLOW('l');
@@ -1046,8 +1274,20 @@ rf230_transmit(unsigned short payload_len)
     tx_result=RADIO_TX_OK;           //handle as ordinary success
   }
 
+#if RF230_CONF_FRAME_RETRIES
+  /* Frames sent on air, for the link estimate of the MAC */
+#if RF230_COUNT_FRAME_RETRIES
+  packetbuf_set_attr(PACKETBUF_ATTR_MAC_TRANSMISSIONS, transmissions);
+#else
+  packetbuf_set_attr(PACKETBUF_ATTR_MAC_TRANSMISSIONS,
+                     tx_result == 5 ? RF230_CONF_FRAME_RETRIES :
+                     (tx_result == 3 ? 0 : 1));
+#endif
+#endif /* RF230_CONF_FRAME_RETRIES */
+
   if (tx_result==RADIO_TX_OK) {
     RIMESTATS_ADD(lltx);
+    RIMESTATS_ADD_VALUE(lltxbytes, total_len);
     if(packetbuf_attr(PACKETBUF_ATTR_RELIABLE))
       RIMESTATS_ADD(ackrx);		//ack was requested and received
 #if RF230_INSERTACK
@@ -1082,9 +1322,6 @@ rf230_prepare(const void *payload, unsigned short payload_len)
 {
   int ret = 0;
   uint8_t total_len,*pbuf;
-#if RF230_CONF_TIMESTAMPS
-  struct timestamp timestamp;
-#endif
 #if RF230_CONF_CHECKSUM
   uint16_t checksum;
 #endif
@@ -1118,17 +1355,16 @@ rf230_prepare(const void *payload, unsigned short payload_len)
   memcpy(pbuf,payload,payload_len);
   pbuf+=payload_len;
 
+#if RF230_CONF_TIMESTAMPS
+  /* Filled in by rf230_transmit() */
+  memset(pbuf,0,TIMESTAMP_LEN);
+  pbuf+=TIMESTAMP_LEN;
+#endif
+
 #if RF230_CONF_CHECKSUM
   memcpy(pbuf,&checksum,CHECKSUM_LEN);
   pbuf+=CHECKSUM_LEN;
 #endif
-
-#if RF230_CONF_TIMESTAMPS
-  timestamp.authority_level = timesynch_authority_level();
-  timestamp.time = timesynch_time();
-  memcpy(pbuf,&timestamp,TIMESTAMP_LEN);
-  pbuf+=TIMESTAMP_LEN;
-#endif
 /*------------------------------------------------------------*/  
 
 #ifdef RF230BB_HOOK_TX_PACKET
@@ -1223,7 +1459,43 @@ rf230_set_channel(uint8_t c)
   PRINTF("rf230: Set Channel %u\n",c);
   rf230_waitidle();
   channel=c;
-  hal_subregister_write(SR_CHANNEL, c);
+  if (hal_get_slptr()) {
+    /* No SPI access in SLEEP */
+    channel_pending = 1;
+  } else {
+    /* The PLL settles on the new channel within 11 us in any state */
+    hal_subregister_write(SR_CHANNEL, c);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Select one of the RF230_DATA_RATE_* OQPSK rates.
+ * Returns 0 if the transceiver has no high data rate modes.
+ */
+int
+rf230_set_data_rate(uint8_t rate)
+{
+  if (rate > RF230_DATA_RATE_2000) {
+    return 0;
+  }
+#if !defined(__AVR_ATmega128RFA1__)
+  if (hal_register_read(RG_PART_NUM) == RF230) {
+    return 0;
+  }
+#endif
+  PRINTF("rf230: Set data rate %u kbit/s\n",250 << rate);
+  /* Wait for any transmission to end. */
+  rf230_waitidle();
+  rf230_data_rate=rate;
+  hal_subregister_write(SR_OQPSK_DATA_RATE, rate);
+  /* Acknowledge after 2 instead of 12 symbols to match the shorter frames */
+  hal_subregister_write(SR_AACK_ACK_TIME, rate != RF230_DATA_RATE_250);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+rf230_get_data_rate(void)
+{
+  return rf230_data_rate;
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -1278,10 +1550,6 @@ rf230_set_pan_addr(unsigned pan,
 /*
  * Interrupt leaves frame intact in FIFO.
  */
-#if RF230_CONF_TIMESTAMPS
-static volatile rtimer_clock_t interrupt_time;
-static volatile int interrupt_time_set;
-#endif /* RF230_CONF_TIMESTAMPS */
 int
 rf230_interrupt(void)
 {
@@ -1290,16 +1558,11 @@ rf230_interrupt(void)
 if (RF230_receive_on) {
   DEBUGFLOW('+');
 #endif
-#if RF230_CONF_TIMESTAMPS
-  interrupt_time = timesynch_time();
-  interrupt_time_set = 1;
-#endif /* RF230_CONF_TIMESTAMPS */
-
   process_poll(&rf230_process);
   
   rf230_pending = 1;
   
-#if RADIOSTATS //TODO:This will double count buffered packets
+#if RADIOSTATS
   RF230_receivepackets++;
 #endif
   RIMESTATS_ADD(llrx);
@@ -1307,7 +1570,9 @@ if (RF230_receive_on) {
 #if RADIOALWAYSON
 } else {
   DEBUGFLOW('-');
-  rxframe[rxframe_head].length=0;
+  /* Drop the frame the ISR just buffered */
+  rxframe_tail = rxframe_tail ? rxframe_tail - 1 : RF230_CONF_RX_BUFFERS - 1;
+  rxframe[rxframe_tail].length=0;
 }
 #endif
   return 1;
@@ -1335,12 +1600,17 @@ PROCESS_THREAD(rf230_process, ev, data)
     PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
     RF230PROCESSFLAG(42);
 
-    packetbuf_clear();
-
     /* Turn off interrupts to avoid ISR writing to the same buffers we are reading. */
     HAL_ENTER_CRITICAL_REGION();
 
+#if RF230_CONF_RX_ZEROCOPY
+    /* The frame stays in its buffer until the stack has processed it */
+    packetbuf_borrow(rxframe[rxframe_head].data, 0);
+    len = rf230_read(NULL, PACKETBUF_SIZE);
+#else
+    packetbuf_clear();
     len = rf230_read(packetbuf_dataptr(), PACKETBUF_SIZE);
+#endif
 
     /* Restore interrupts. */
     HAL_LEAVE_CRITICAL_REGION();
@@ -1366,6 +1636,16 @@ PROCESS_THREAD(rf230_process, ev, data)
        RF230_receivefail++;
 #endif
     }
+#if RF230_CONF_RX_ZEROCOPY
+    if(rxframe_held) {
+      HAL_ENTER_CRITICAL_REGION();
+      /* Move the frame out if the stack still uses packetbuf */
+      packetbuf_compact();
+      rxframe_held = 0;
+      flushrx();
+      HAL_LEAVE_CRITICAL_REGION();
+    }
+#endif
   }
 
   PROCESS_END();
@@ -1390,6 +1670,8 @@ rf230_read_fakeack(void *buf, unsigned short bufsize)
 /*---------------------------------------------------------------------------*/
 /* Read packet that was uploaded from Radio in ISR, else return zero.
  * The two-byte checksum is appended but the returned length does not include it.
+ * With buf NULL the frame is not copied, its buffer stays held until the
+ * rf230 process frees it.
  * Frames are buffered in the interrupt routine so this routine
  * does not access the hardware or change its status.
  * However, this routine must be called with interrupts disabled to avoid ISR
@@ -1422,6 +1704,13 @@ rf230_read(void *buf, unsigned short bufsize)
  }
 #endif
 
+#if RF230_CONF_RX_ZEROCOPY
+  /* The buffer at rxframe_head is in use by the rf230 process */
+  if (rxframe_held) {
+    return 0;
+  }
+#endif
+
   /* The length includes the twp-byte checksum but not the LQI byte */
   len=rxframe[rxframe_head].length;
   if (len==0) {
@@ -1432,12 +1721,7 @@ rf230_read(void *buf, unsigned short bufsize)
   }
 
 #if RF230_CONF_TIMESTAMPS
-  if(interrupt_time_set) {
-    rf230_time_of_arrival = interrupt_time;
-    interrupt_time_set = 0;
-  } else {
-    rf230_time_of_arrival = 0;
-  }
+  rf230_time_of_arrival = rxframe[rxframe_head].time;
   rf230_time_of_departure = 0;
 #endif /* RF230_CONF_TIMESTAMPS */
 
@@ -1467,33 +1751,29 @@ rf230_read(void *buf, unsigned short bufsize)
 
  /* Transfer the frame, stripping the footer, but copying the checksum */
   framep=&(rxframe[rxframe_head].data[0]);
-  memcpy(buf,framep,len-AUX_LEN+CHECKSUM_LEN);
   rf230_last_correlation = rxframe[rxframe_head].lqi;
-
-  /* Clear the length field to allow buffering of the next packet */
-  rxframe[rxframe_head].length=0;
-  rxframe_head++;
-  if (rxframe_head >= RF230_CONF_RX_BUFFERS) {
-    rxframe_head=0;
-  }
-  /* If another packet has been buffered, schedule another receive poll */
-  if (rxframe[rxframe_head].length) {
-    rf230_interrupt();
-  }
-  else {
-    rf230_pending = 0;
+#if RF230_CONF_RX_ZEROCOPY
+  if (buf == NULL) {
+    buf = framep;
+    rxframe_held = 1;
+  } else
+#endif
+  {
+    memcpy(buf,framep,len-AUX_LEN+CHECKSUM_LEN);
+    /* Clear the length field to allow buffering of the next packet */
+    flushrx();
   }
   
- /* Point to the checksum */
+ /* Point to the timestamp and the checksum */
   framep+=len-AUX_LEN; 
-#if RF230_CONF_CHECKSUM
-  memcpy(&checksum,framep,CHECKSUM_LEN);
-#endif /* RF230_CONF_CHECKSUM */
-  framep+=CHECKSUM_LEN;
 #if RF230_CONF_TIMESTAMPS
   memcpy(&t,framep,TIMESTAMP_LEN);
 #endif /* RF230_CONF_TIMESTAMPS */
   framep+=TIMESTAMP_LEN;
+#if RF230_CONF_CHECKSUM
+  memcpy(&checksum,framep,CHECKSUM_LEN);
+#endif /* RF230_CONF_CHECKSUM */
+  framep+=CHECKSUM_LEN;
 #if FOOTER_LEN
   memcpy(footer,framep,FOOTER_LEN);
 #endif
@@ -1531,16 +1811,15 @@ rf230_read(void *buf, unsigned short bufsize)
     packetbuf_set_attr(PACKETBUF_ATTR_LINK_QUALITY, rf230_last_correlation);
 
     RIMESTATS_ADD(rx);
+    RIMESTATS_ADD_VALUE(llrxbytes, len);
 
 #if RF230_CONF_TIMESTAMPS
-    rf230_time_of_departure =
-      t.time +
-      setup_time_for_transmission +
-      (total_time_for_transmission * (len - 2)) / total_transmission_len;
-
+    rf230_time_of_departure = t.time + TIMESTAMP_DELAY;
     rf230_authority_level_of_sender = t.authority_level;
 
     packetbuf_set_attr(PACKETBUF_ATTR_TIMESTAMP, t.time);
+    timesynch_incoming_packet(t.authority_level, rf230_time_of_departure,
+                              rf230_time_of_arrival);
 #endif /* RF230_CONF_TIMESTAMPS */
 
 #if RF230_CONF_CHECKSUM
@@ -1682,7 +1961,7 @@ rf230_cca(void)
 //TODO:see if the status register works!
 //   cca=hal_register_read(RG_TRX_STATUS);
 #if RF230_CONF_AUTOACK
-    radio_set_trx_state(RX_AACK_ON);
+    radio_set_trx_state(RX_STATE);
 #endif
 
     /* Enable packet reception */
@@ -1744,6 +2023,9 @@ rf230_receiving_packet(void)
   uint8_t radio_state;
   if (hal_get_slptr()) {
     DEBUGFLOW('=');
+  } else if (rf230_rx_started) {
+    /* Until the interrupt has buffered the frame that started */
+    return 1;
   } else {  
     radio_state = hal_subregister_read(SR_TRX_STATUS);
     if ((radio_state==BUSY_RX) || (radio_state==BUSY_RX_AACK)) {
@@ -1754,6 +2036,16 @@ rf230_receiving_packet(void)
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+/* Start of the last transmitted frame on air, or of the last retry when
+ * the transceiver retransmits in hardware. ContikiMAC uses it to learn the
+ * wake-up phase of the receiver that acknowledged the frame.
+ */
+rtimer_clock_t
+rf230_last_tx_time(void)
+{
+  return last_tx_time;
+}
+/*---------------------------------------------------------------------------*/
 static int
 rf230_pending_packet(void)
 {
@@ -55,6 +55,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "hal.h"
+#include "sys/rtimer.h"
 #if defined(__AVR_ATmega128RFA1__)
 #include "atmega128rfa1_registermap.h"
 #else
@@ -107,6 +108,19 @@
 #ifndef RF_CHANNEL
 #define RF_CHANNEL              26
 #endif
+
+/* OQPSK data rates of the RF231 and ATmega128RFA1, see rf230_set_data_rate().
+ * Each step halves the airtime of a frame. Only 250 kbit/s is IEEE 802.15.4
+ * compliant, nodes must use the same rate to communicate.
+ */
+#define RF230_DATA_RATE_250                     ( 0 )
+#define RF230_DATA_RATE_500                     ( 1 )
+#define RF230_DATA_RATE_1000                    ( 2 )
+#define RF230_DATA_RATE_2000                    ( 3 )
+
+#ifndef RF230_CONF_DATA_RATE
+#define RF230_CONF_DATA_RATE                    RF230_DATA_RATE_250
+#endif
 /*============================ TYPEDEFS ======================================*/
 
 /** \brief  This macro defines the start value for the RADIO_* status constants.
@@ -215,8 +229,12 @@ uint8_t rf230_get_channel(void);
 void rf230_set_pan_addr(unsigned pan,unsigned addr,const uint8_t ieee_addr[8]);
 void rf230_set_txpower(uint8_t power);
 uint8_t rf230_get_txpower(void);
+int rf230_set_data_rate(uint8_t rate);
+uint8_t rf230_get_data_rate(void);
+rtimer_clock_t rf230_last_tx_time(void);
 
 void rf230_set_promiscuous_mode(bool isPromiscuous);
+void rf230_setpendingbit(uint8_t value);
 bool rf230_is_ready_to_send();
 
 extern uint8_t rf230_last_correlation,rf230_last_rssi,rf230_smallest_rssi;
@@ -50,6 +50,7 @@
 #include "sys/energest.h"
 #include "sys/rtimer.h"
 #include "rtimer-arch.h"
+#include "isr-stats.h"
 
 #if defined(__AVR_ATmega1284P__)
 #define ETIMSK TIMSK3
@@ -98,6 +99,8 @@ ISR(RTC32_OVF_vect)
 }
 #elif defined(TCNT3) && RTIMER_ARCH_PRESCALER
 ISR (TIMER3_COMPA_vect) {
+  ISR_STATS_ENTER(ISR_STATS_RTIMER);
+  ISR_STATS_LATENCY(ISR_STATS_RTIMER, TCNT3 - OCR3A);
   DEBUGFLOW('/');
   ENERGEST_ON(ENERGEST_TYPE_IRQ);
 
@@ -116,6 +119,7 @@ ISR (TIMER3_COMPA_vect) {
 
   ENERGEST_OFF(ENERGEST_TYPE_IRQ);
   DEBUGFLOW('\\');
+  ISR_STATS_EXIT(ISR_STATS_RTIMER);
 }
 
 #elif RTIMER_ARCH_PRESCALER
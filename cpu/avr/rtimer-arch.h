@@ -80,5 +80,9 @@
 	#endif
 #endif /* XMEGA */
 
+/* Interrupt lock for the rtimer task queue of core/sys/rtimer.c */
+#define RTIMER_ARCH_LOCK()   uint8_t rtimer_arch_sreg = SREG; cli()
+#define RTIMER_ARCH_UNLOCK() SREG = rtimer_arch_sreg
+
 void rtimer_arch_sleep(rtimer_clock_t howlong);
 #endif /* RTIMER_ARCH_H_ */
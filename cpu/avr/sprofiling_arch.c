@@ -5,6 +5,7 @@
 #include <avr/interrupt.h>
 
 #include "sys/sprofiling.h"
+#include "dev/rs232.h"
 
 
 /* For the INGA platform */
@@ -45,6 +46,11 @@ inline void sprofiling_arch_stop(void)
 	TIMSK2 &= ~_BV(OCIE2B);
 }
 
+void sprofiling_arch_putc(uint8_t c)
+{
+	rs232_send(RS232_PORT_0, c);
+}
+
 void sprofiling_arch_init(void)
 {
 	/* Call the interrupt at the same time the time is updated */
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Measurement of the main stack usage on AVR
+ */
+
+#include <avr/io.h>
+
+#include "stack-arch.h"
+
+/* End of .noinit, the first byte that is neither data nor bss */
+extern uint8_t __heap_start;
+
+void stack_arch_paint(void) __attribute__ ((naked, used, section (".init3")));
+
+/*---------------------------------------------------------------------------*/
+/* Runs from the startup code after the stack pointer and r1 are set up,
+   before .data and .bss are initialized. Must not use the stack. */
+void
+stack_arch_paint(void)
+{
+  uint8_t *p;
+
+  for(p = &__heap_start; p < (uint8_t *)SP; p++) {
+    *p = STACK_ARCH_PAINT;
+  }
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+stack_arch_size(void)
+{
+  return RAMEND + 1 - (uint16_t)&__heap_start;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+stack_arch_unused(void)
+{
+  uint8_t *p;
+
+  for(p = &__heap_start; p <= (uint8_t *)RAMEND; p++) {
+    if(*p != STACK_ARCH_PAINT) {
+      break;
+    }
+  }
+  return p - &__heap_start;
+}
+/*---------------------------------------------------------------------------*/
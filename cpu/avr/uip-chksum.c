@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         uIP checksum calculation for AVR
+ *
+ *         With UIP_ARCH_CHKSUM, uip.c and uip6.c leave all checksum
+ *         functions to this file.
+ */
+
+#include "net/uip.h"
+#include "net/uip_arch.h"
+
+#define asmv(arg...) __asm__ __volatile__(arg)
+
+#define BUF ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+/*---------------------------------------------------------------------------*/
+#if UIP_ARCH_CHKSUM
+/*
+ * Adds the 16-bit big endian words of data to sum. The carry of each
+ * addition goes into the next one and is folded back once at the end,
+ * dec leaves the carry flag alone. Returns sum in host byte order.
+ */
+static uint16_t
+chksum(uint16_t sum, const uint8_t *data, uint16_t len)
+{
+  uint16_t words;
+  uint16_t t;
+  uint8_t inner, outer, hi;
+
+  words = len >> 1;
+  if(words > 0) {
+    /* An inner count of 0 runs 256 times */
+    inner = words & 0xff;
+    outer = (words + 0xff) >> 8;
+    asmv("clc                           \n\t"
+         "1: ld %[hi], %a[data]+        \n\t"
+         "ld __tmp_reg__, %a[data]+     \n\t"
+         "adc %A[sum], __tmp_reg__      \n\t"
+         "adc %B[sum], %[hi]            \n\t"
+         "dec %[inner]                  \n\t"
+         "brne 1b                       \n\t"
+         "dec %[outer]                  \n\t"
+         "brne 1b                       \n\t"
+         /* The first end around carry may carry once more */
+         "adc %A[sum], __zero_reg__     \n\t"
+         "adc %B[sum], __zero_reg__     \n\t"
+         "adc %A[sum], __zero_reg__     \n\t"
+         "adc %B[sum], __zero_reg__     \n\t"
+         : [sum] "+r" (sum), [data] "+e" (data),
+           [inner] "+r" (inner), [outer] "+r" (outer), [hi] "=&r" (hi)
+         :
+         : "memory");
+  }
+
+  /* data points to the last byte if len is odd */
+  if(len & 1) {
+    t = (uint16_t)data[0] << 8;
+    sum += t;
+    if(sum < t) {
+      sum++;
+    }
+  }
+
+  return sum;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+uip_chksum(uint16_t *data, uint16_t len)
+{
+  return uip_htons(chksum(0, (uint8_t *)data, len));
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+uip_ipchksum(void)
+{
+  uint16_t sum;
+
+  sum = chksum(0, &uip_buf[UIP_LLH_LEN], UIP_IPH_LEN);
+  return (sum == 0) ? 0xffff : uip_htons(sum);
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+upper_layer_chksum(uint8_t proto)
+{
+  /* volatile for the same gcc -Os bug as in uip6.c */
+  volatile uint16_t upper_layer_len;
+  uint16_t sum;
+
+#if UIP_CONF_IPV6
+  upper_layer_len = (((uint16_t)(BUF->len[0]) << 8) + BUF->len[1] - uip_ext_len);
+#else /* UIP_CONF_IPV6 */
+  upper_layer_len = (((uint16_t)(BUF->len[0]) << 8) + BUF->len[1]) - UIP_IPH_LEN;
+#endif /* UIP_CONF_IPV6 */
+
+  /* First sum pseudoheader. */
+  /* IP protocol and length fields. This addition cannot carry. */
+  sum = upper_layer_len + proto;
+  /* Sum IP source and destination addresses. */
+  sum = chksum(sum, (uint8_t *)&BUF->srcipaddr, 2 * sizeof(uip_ipaddr_t));
+
+  /* Sum upper layer header and data. */
+#if UIP_CONF_IPV6
+  sum = chksum(sum, &uip_buf[UIP_IPH_LEN + UIP_LLH_LEN + uip_ext_len],
+               upper_layer_len);
+#else /* UIP_CONF_IPV6 */
+  sum = chksum(sum, &uip_buf[UIP_IPH_LEN + UIP_LLH_LEN], upper_layer_len);
+#endif /* UIP_CONF_IPV6 */
+
+  return (sum == 0) ? 0xffff : uip_htons(sum);
+}
+/*---------------------------------------------------------------------------*/
+#if UIP_CONF_IPV6
+uint16_t
+uip_icmp6chksum(void)
+{
+  return upper_layer_chksum(UIP_PROTO_ICMP6);
+}
+#endif /* UIP_CONF_IPV6 */
+/*---------------------------------------------------------------------------*/
+#if UIP_TCP || !UIP_CONF_IPV6
+uint16_t
+uip_tcpchksum(void)
+{
+  return upper_layer_chksum(UIP_PROTO_TCP);
+}
+#endif /* UIP_TCP || !UIP_CONF_IPV6 */
+/*---------------------------------------------------------------------------*/
+#if UIP_UDP_CHECKSUMS
+uint16_t
+uip_udpchksum(void)
+{
+  return upper_layer_chksum(UIP_PROTO_UDP);
+}
+#endif /* UIP_UDP_CHECKSUMS */
+#endif /* UIP_ARCH_CHKSUM */
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,368 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         File and RAM backed block devices for the native platform
+ */
+
+#include "dev/disk-native.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define DEBUG 0
+#if DEBUG
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+#ifndef DISK_NATIVE_CONF_OP_US
+#define DISK_NATIVE_CONF_OP_US    0
+#endif
+#ifndef DISK_NATIVE_CONF_SEEK_US
+#define DISK_NATIVE_CONF_SEEK_US  0
+#endif
+#ifndef DISK_NATIVE_CONF_READ_US
+#define DISK_NATIVE_CONF_READ_US  0
+#endif
+#ifndef DISK_NATIVE_CONF_WRITE_US
+#define DISK_NATIVE_CONF_WRITE_US 0
+#endif
+#ifndef DISK_NATIVE_CONF_ERASE_US
+#define DISK_NATIVE_CONF_ERASE_US 0
+#endif
+#ifndef DISK_NATIVE_CONF_SLEEP
+#define DISK_NATIVE_CONF_SLEEP    1
+#endif
+
+struct disk {
+  uint8_t initialized;
+  int fd;
+  uint8_t *ram;
+  uint32_t blocks;
+  /* Block after the previous access, for the seek cost */
+  uint32_t next;
+  /* Next block and remaining blocks of a multi block transfer */
+  uint32_t multi_addr;
+  uint32_t multi_left;
+  struct disk_native_latency latency;
+  struct disk_native_stats stats;
+};
+
+static struct disk disks[DISK_NATIVE_DISKS];
+static const char *file_name = DISK_NATIVE_FILE_NAME;
+
+static const struct disk_native_latency default_latency = {
+  DISK_NATIVE_CONF_OP_US, DISK_NATIVE_CONF_SEEK_US, DISK_NATIVE_CONF_READ_US,
+  DISK_NATIVE_CONF_WRITE_US, DISK_NATIVE_CONF_ERASE_US, DISK_NATIVE_CONF_SLEEP
+};
+/*---------------------------------------------------------------------------*/
+static struct disk *
+get_disk(uint8_t disk)
+{
+  if(disk >= DISK_NATIVE_DISKS || !disks[disk].initialized) {
+    return NULL;
+  }
+  return &disks[disk];
+}
+/*---------------------------------------------------------------------------*/
+/* Accounts an access of num blocks that cost per_block each */
+static void
+delay(struct disk *d, uint32_t addr, uint32_t num, uint32_t per_block)
+{
+  uint32_t us;
+
+  us = d->latency.op + num * per_block;
+  if(addr != d->next) {
+    us += d->latency.seek;
+    d->stats.seeks++;
+  }
+  d->next = addr + num;
+  d->stats.busy_us += us;
+
+  if(d->latency.sleep && us > 0) {
+    usleep(us);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+transfer(struct disk *d, uint32_t addr, uint8_t *buffer, uint8_t write)
+{
+  off_t offset;
+
+  if(addr >= d->blocks) {
+    PRINTF("disk-native: block %lu out of range\n", (unsigned long)addr);
+    return 1;
+  }
+
+  if(d->ram != NULL) {
+    if(write) {
+      memcpy(d->ram + addr * DISK_NATIVE_BLOCK_SIZE, buffer, DISK_NATIVE_BLOCK_SIZE);
+    } else {
+      memcpy(buffer, d->ram + addr * DISK_NATIVE_BLOCK_SIZE, DISK_NATIVE_BLOCK_SIZE);
+    }
+    return 0;
+  }
+
+  offset = (off_t)addr * DISK_NATIVE_BLOCK_SIZE;
+  if(write) {
+    return pwrite(d->fd, buffer, DISK_NATIVE_BLOCK_SIZE, offset) != DISK_NATIVE_BLOCK_SIZE;
+  }
+  return pread(d->fd, buffer, DISK_NATIVE_BLOCK_SIZE, offset) != DISK_NATIVE_BLOCK_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+disk_native_init(uint8_t disk)
+{
+  struct disk *d;
+  off_t size;
+
+  if(disk >= DISK_NATIVE_DISKS) {
+    return 1;
+  }
+  d = &disks[disk];
+  if(d->initialized) {
+    return 0;
+  }
+
+  memset(d, 0, sizeof(*d));
+  d->latency = default_latency;
+
+  if(disk == DISK_NATIVE_RAM) {
+    if(DISK_NATIVE_RAM_BLOCKS == 0) {
+      return 1;
+    }
+    d->ram = calloc(DISK_NATIVE_RAM_BLOCKS, DISK_NATIVE_BLOCK_SIZE);
+    if(d->ram == NULL) {
+      return 1;
+    }
+    d->blocks = DISK_NATIVE_RAM_BLOCKS;
+  } else {
+    if(DISK_NATIVE_FILE_BLOCKS == 0 || file_name == NULL) {
+      return 1;
+    }
+    d->fd = open(file_name, O_RDWR | O_CREAT, 0644);
+    if(d->fd < 0) {
+      perror(file_name);
+      return 1;
+    }
+    size = lseek(d->fd, 0, SEEK_END);
+    if(size < DISK_NATIVE_BLOCK_SIZE) {
+      /* A new image, the file system sees zeros until written */
+      size = (off_t)DISK_NATIVE_FILE_BLOCKS * DISK_NATIVE_BLOCK_SIZE;
+      if(ftruncate(d->fd, size) != 0) {
+        perror(file_name);
+        close(d->fd);
+        return 1;
+      }
+    }
+    d->blocks = size / DISK_NATIVE_BLOCK_SIZE;
+  }
+
+  PRINTF("disk-native: disk %u has %lu blocks\n", disk, (unsigned long)d->blocks);
+  d->initialized = 1;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+disk_native_set_file(const char *name)
+{
+  file_name = name;
+}
+/*---------------------------------------------------------------------------*/
+void
+disk_native_set_latency(uint8_t disk, const struct disk_native_latency *latency)
+{
+  if(disk < DISK_NATIVE_DISKS) {
+    disks[disk].latency = *latency;
+  }
+}
+/*---------------------------------------------------------------------------*/
+struct disk_native_stats *
+disk_native_get_stats(uint8_t disk)
+{
+  if(disk >= DISK_NATIVE_DISKS) {
+    return NULL;
+  }
+  return &disks[disk].stats;
+}
+/*---------------------------------------------------------------------------*/
+uint32_t
+disk_native_get_block_num(uint8_t disk)
+{
+  struct disk *d = get_disk(disk);
+
+  return d == NULL ? 0 : d->blocks;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+disk_native_read_block(uint8_t disk, uint32_t addr, uint8_t *buffer)
+{
+  struct disk *d = get_disk(disk);
+
+  if(d == NULL) {
+    return 1;
+  }
+  delay(d, addr, 1, d->latency.read);
+  d->stats.reads++;
+  return transfer(d, addr, buffer, 0);
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+disk_native_write_block(uint8_t disk, uint32_t addr, uint8_t *buffer)
+{
+  struct disk *d = get_disk(disk);
+
+  if(d == NULL) {
+    return 1;
+  }
+  delay(d, addr, 1, d->latency.write);
+  d->stats.writes++;
+  return transfer(d, addr, buffer, 1);
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+disk_native_read_multi_block_start(uint8_t disk, uint32_t addr)
+{
+  struct disk *d = get_disk(disk);
+
+  if(d == NULL || addr >= d->blocks) {
+    return 1;
+  }
+  /* The operation cost is paid once for the whole transfer */
+  delay(d, addr, 0, 0);
+  d->multi_addr = addr;
+  d->multi_left = d->blocks - addr;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+disk_native_read_multi_block_next(uint8_t disk, uint8_t *buffer)
+{
+  struct disk *d = get_disk(disk);
+
+  if(d == NULL || d->multi_left == 0) {
+    return 1;
+  }
+  d->stats.busy_us += d->latency.read;
+  if(d->latency.sleep && d->latency.read > 0) {
+    usleep(d->latency.read);
+  }
+  d->stats.reads++;
+  d->multi_left--;
+  d->next = d->multi_addr + 1;
+  return transfer(d, d->multi_addr++, buffer, 0);
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+disk_native_write_multi_block_start(uint8_t disk, uint32_t addr, uint32_t num_blocks)
+{
+  struct disk *d = get_disk(disk);
+
+  if(d == NULL || addr + num_blocks > d->blocks) {
+    return 1;
+  }
+  delay(d, addr, 0, 0);
+  d->multi_addr = addr;
+  d->multi_left = num_blocks;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+disk_native_write_multi_block_next(uint8_t disk, uint8_t *buffer)
+{
+  struct disk *d = get_disk(disk);
+
+  if(d == NULL || d->multi_left == 0) {
+    return 1;
+  }
+  d->stats.busy_us += d->latency.write;
+  if(d->latency.sleep && d->latency.write > 0) {
+    usleep(d->latency.write);
+  }
+  d->stats.writes++;
+  d->multi_left--;
+  d->next = d->multi_addr + 1;
+  return transfer(d, d->multi_addr++, buffer, 1);
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+disk_native_multi_block_stop(uint8_t disk)
+{
+  struct disk *d = get_disk(disk);
+
+  if(d == NULL) {
+    return 1;
+  }
+  d->multi_left = 0;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+disk_native_erase_blocks(uint8_t disk, uint32_t addr, uint32_t num_blocks)
+{
+  struct disk *d = get_disk(disk);
+  uint8_t zero[DISK_NATIVE_BLOCK_SIZE];
+  uint32_t i;
+
+  if(d == NULL || addr + num_blocks > d->blocks) {
+    return 1;
+  }
+  delay(d, addr, num_blocks, d->latency.erase);
+  d->stats.erases += num_blocks;
+
+  if(d->ram != NULL) {
+    memset(d->ram + addr * DISK_NATIVE_BLOCK_SIZE, 0, num_blocks * DISK_NATIVE_BLOCK_SIZE);
+    return 0;
+  }
+
+  memset(zero, 0, sizeof(zero));
+  for(i = 0; i < num_blocks; i++) {
+    if(transfer(d, addr + i, zero, 1)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+disk_native_sync(uint8_t disk)
+{
+  struct disk *d = get_disk(disk);
+
+  /* The writes are in the page cache of the host already, an fsync()
+     would only measure the host disk */
+  return d == NULL;
+}
+/*---------------------------------------------------------------------------*/
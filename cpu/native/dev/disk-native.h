@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         File and RAM backed block devices for the native platform
+ *
+ *         Two disks with 512 byte blocks stand in for the INGA storage
+ *         in host builds of the diskio layer. DISK_NATIVE_FILE keeps its
+ *         blocks in an image file and is used as SD card,
+ *         DISK_NATIVE_RAM keeps them in memory and is used as flash.
+ *
+ *         Every access can be delayed by a simple latency model: a fixed
+ *         cost per operation, a cost per block read, written or erased,
+ *         and a seek cost if an access does not continue where the last
+ *         one ended. The delays are added to the busy time of the disk
+ *         and, unless disk_native_latency.sleep is 0, slept.
+ */
+
+#ifndef DISK_NATIVE_H_
+#define DISK_NATIVE_H_
+
+#include <stdint.h>
+
+#define DISK_NATIVE_BLOCK_SIZE 512
+
+#define DISK_NATIVE_FILE 0
+#define DISK_NATIVE_RAM  1
+#define DISK_NATIVE_DISKS 2
+
+/** Image file of the file backed disk */
+#ifdef DISK_NATIVE_CONF_FILE
+#define DISK_NATIVE_FILE_NAME DISK_NATIVE_CONF_FILE
+#else
+#define DISK_NATIVE_FILE_NAME "disk-native.img"
+#endif
+
+/** Blocks of a newly created image file, 0 disables the file backed disk */
+#ifdef DISK_NATIVE_CONF_FILE_BLOCKS
+#define DISK_NATIVE_FILE_BLOCKS DISK_NATIVE_CONF_FILE_BLOCKS
+#else
+#define DISK_NATIVE_FILE_BLOCKS 65536UL
+#endif
+
+/** Blocks of the RAM backed disk, 0 disables it */
+#ifdef DISK_NATIVE_CONF_RAM_BLOCKS
+#define DISK_NATIVE_RAM_BLOCKS DISK_NATIVE_CONF_RAM_BLOCKS
+#else
+#define DISK_NATIVE_RAM_BLOCKS 4096UL
+#endif
+
+/** Latency model of a disk, all times in microseconds */
+struct disk_native_latency {
+  /** Cost of every operation */
+  uint32_t op;
+  /** Cost of an access that does not continue the previous one */
+  uint32_t seek;
+  /** Cost per block read */
+  uint32_t read;
+  /** Cost per block written */
+  uint32_t write;
+  /** Cost per block erased */
+  uint32_t erase;
+  /** Sleep for the delays instead of only accounting them */
+  uint8_t sleep;
+};
+
+/** Counters of a disk */
+struct disk_native_stats {
+  uint32_t reads;
+  uint32_t writes;
+  uint32_t erases;
+  uint32_t seeks;
+  /** Simulated time the disk was busy in microseconds */
+  uint64_t busy_us;
+};
+
+/**
+ * Opens the disk. Later calls do nothing.
+ * \return 0 on success, 1 if the disk is disabled or can not be opened
+ */
+uint8_t disk_native_init(uint8_t disk);
+
+/**
+ * Sets the image file of the file backed disk. Must be called before
+ * the disk is initialized.
+ */
+void disk_native_set_file(const char *name);
+
+/** Sets the latency model of the disk */
+void disk_native_set_latency(uint8_t disk, const struct disk_native_latency *latency);
+
+/** \return The counters of the disk */
+struct disk_native_stats *disk_native_get_stats(uint8_t disk);
+
+/** \return Number of blocks of the disk */
+uint32_t disk_native_get_block_num(uint8_t disk);
+
+/**
+ * The block functions return 0 on success and 1 on error, like the
+ * sdcard and at45db drivers.
+ */
+uint8_t disk_native_read_block(uint8_t disk, uint32_t addr, uint8_t *buffer);
+uint8_t disk_native_write_block(uint8_t disk, uint32_t addr, uint8_t *buffer);
+uint8_t disk_native_read_multi_block_start(uint8_t disk, uint32_t addr);
+uint8_t disk_native_read_multi_block_next(uint8_t disk, uint8_t *buffer);
+uint8_t disk_native_write_multi_block_start(uint8_t disk, uint32_t addr, uint32_t num_blocks);
+uint8_t disk_native_write_multi_block_next(uint8_t disk, uint8_t *buffer);
+uint8_t disk_native_multi_block_stop(uint8_t disk);
+/** Clears the blocks to 0x00 like an SD card erase */
+uint8_t disk_native_erase_blocks(uint8_t disk, uint32_t addr, uint32_t num_blocks);
+/** Does nothing but check the disk, written blocks are not cached */
+uint8_t disk_native_sync(uint8_t disk);
+
+#endif /* DISK_NATIVE_H_ */
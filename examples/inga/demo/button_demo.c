@@ -30,10 +30,12 @@ PROCESS(default_app_process, "Hello world process");
 AUTOSTART_PROCESSES(&default_app_process);
 /*---------------------------------------------------------------------------*/
 static struct etimer timer;
+PROCESS_SUBSCRIPTION(button_subscription);
 PROCESS_THREAD(default_app_process, ev, data)
 {
   PROCESS_BEGIN();
   SENSORS_ACTIVATE(button_sensor);
+  process_subscribe(&button_subscription, sensors_event);
 
   leds_init();	
   leds_on(2);
@@ -0,0 +1,495 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *      Storage benchmark
+ *
+ *      Built with CFS=fat (default) it measures raw diskio single and
+ *      multi block transfers and the FAT file system on BENCH_DEVICE.
+ *      Built with CFS=coffee it measures the same file tests on the coffee
+ *      device selected by COFFEE_DEVICE, e.g. 5 for the external flash or
+ *      2 for the EEPROM.
+ *
+ *      WARNING: The device is formatted, ALL DATA ON IT GETS LOST!
+ *
+ *      Every result is printed as one line:
+ *      BENCH <test> <size> <bytes> <ops> <ms> <bytes/s> <min us> <avg us> <max us>
+ *      size is the transfer size of one operation in bytes, the latencies
+ *      are measured per operation with the rtimer. Lines starting with
+ *      INFO describe the configuration the results were measured with.
+ *
+ *      Built for the native target every result is followed by
+ *      DISK <test> <size> <reads> <writes> <busy us> <bytes/s>
+ *      with the block accesses and the busy time of the simulated disks,
+ *      which unlike the wall clock time do not depend on the host.
+ *      The benchmark exits when it is done.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "lib/random.h"
+#include "sys/rtimer.h"
+#include "dev/watchdog.h"
+#if CFS_FAT
+#include "cfs-fat.h"
+#include "diskio.h"
+#elif CFS_COFFEE
+#include "cfs/cfs-coffee.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#if CONTIKI_TARGET_NATIVE
+#include <stdlib.h>
+#include "dev/disk-native.h"
+#endif
+
+/** Type of the device to benchmark (FAT only) */
+#ifndef BENCH_DEVICE
+#define BENCH_DEVICE (DISKIO_DEVICE_TYPE_SD_CARD | DISKIO_DEVICE_TYPE_PARTITION)
+#endif
+
+/** Number of blocks transferred by each raw diskio test */
+#ifndef BENCH_RAW_BLOCKS
+#define BENCH_RAW_BLOCKS 256
+#endif
+
+/** Size of the file used by the file tests */
+#ifndef BENCH_FILE_SIZE
+#if CFS_COFFEE && (COFFEE_DEVICE == 1 || COFFEE_DEVICE == 2)
+#define BENCH_FILE_SIZE 512UL
+#else
+#define BENCH_FILE_SIZE 65536UL
+#endif
+#endif
+
+/** Number of random seeks of the seek+read test */
+#ifndef BENCH_SEEKS
+#define BENCH_SEEKS 64
+#endif
+
+/** Number of open/close cycles of the churn tests */
+#ifndef BENCH_CHURN
+#define BENCH_CHURN 32
+#endif
+
+/** Seed of the random offsets, fixed to make runs comparable */
+#ifndef BENCH_SEED
+#define BENCH_SEED 4711
+#endif
+
+/* cfs-fat truncates files opened with CFS_WRITE, coffee requires it to write */
+#if CFS_FAT
+#define BENCH_APPEND_FLAGS CFS_APPEND
+#else
+#define BENCH_APPEND_FLAGS (CFS_WRITE | CFS_APPEND)
+#endif
+
+#define BENCH_BUFFER_SIZE 2048
+#define BENCH_FILE "BENCH.DAT"
+#define BENCH_CHURN_FILES 4
+
+struct bench_result {
+  clock_time_t start;
+  uint32_t bytes;
+  uint16_t ops;
+  rtimer_clock_t lat_min;
+  rtimer_clock_t lat_max;
+  uint32_t lat_sum;
+#if CONTIKI_TARGET_NATIVE
+  struct disk_native_stats disk;
+#endif
+};
+
+static uint8_t buffer[BENCH_BUFFER_SIZE];
+
+/* Transfer sizes of the file tests */
+static const uint16_t file_sizes[] = {16, 64, 512, 2048};
+#define NUM_FILE_SIZES (sizeof(file_sizes) / sizeof(file_sizes[0]))
+
+PROCESS(bench_process, "Storage benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+static uint32_t
+ticks_to_us(uint32_t ticks)
+{
+  return (uint32_t) (((uint64_t) ticks * 1000000UL) / RTIMER_SECOND);
+}
+/*---------------------------------------------------------------------------*/
+#if CONTIKI_TARGET_NATIVE
+/* Sums up the counters of all native disks */
+static void
+disk_stats(struct disk_native_stats *stats)
+{
+  uint8_t i;
+
+  memset(stats, 0, sizeof (struct disk_native_stats));
+  for (i = 0; i < DISK_NATIVE_DISKS; i++) {
+    struct disk_native_stats *disk = disk_native_get_stats(i);
+    stats->reads += disk->reads;
+    stats->writes += disk->writes;
+    stats->busy_us += disk->busy_us;
+  }
+}
+#endif
+/*---------------------------------------------------------------------------*/
+static void
+bench_begin(struct bench_result *r)
+{
+  memset(r, 0, sizeof (struct bench_result));
+  r->lat_min = (rtimer_clock_t) ~0;
+  r->start = clock_time();
+#if CONTIKI_TARGET_NATIVE
+  disk_stats(&r->disk);
+#endif
+}
+/*---------------------------------------------------------------------------*/
+/* Records one operation that started at the given rtimer time */
+static void
+bench_op(struct bench_result *r, rtimer_clock_t start, uint32_t bytes)
+{
+  rtimer_clock_t ticks = RTIMER_NOW() - start;
+
+  r->bytes += bytes;
+  r->ops++;
+  r->lat_sum += ticks;
+  if (ticks < r->lat_min) {
+    r->lat_min = ticks;
+  }
+  if (ticks > r->lat_max) {
+    r->lat_max = ticks;
+  }
+  watchdog_periodic();
+}
+/*---------------------------------------------------------------------------*/
+static void
+bench_end(struct bench_result *r, const char *test, uint16_t size)
+{
+  uint32_t ms = ((clock_time() - r->start) * 1000UL) / CLOCK_SECOND;
+
+  if (r->ops == 0) {
+    r->lat_min = 0;
+  }
+
+  printf("BENCH %s %u %lu %u %lu %lu %lu %lu %lu\n", test, size, r->bytes, r->ops, ms,
+          (ms > 0) ? (uint32_t) (((uint64_t) r->bytes * 1000) / ms) : 0,
+          ticks_to_us(r->lat_min),
+          (r->ops > 0) ? ticks_to_us(r->lat_sum / r->ops) : 0,
+          ticks_to_us(r->lat_max));
+
+#if CONTIKI_TARGET_NATIVE
+  {
+    struct disk_native_stats now;
+
+    disk_stats(&now);
+    now.reads -= r->disk.reads;
+    now.writes -= r->disk.writes;
+    now.busy_us -= r->disk.busy_us;
+    printf("DISK %s %u %lu %lu %llu %lu\n", test, size,
+            (unsigned long) now.reads, (unsigned long) now.writes,
+            (unsigned long long) now.busy_us,
+            (now.busy_us > 0) ? (unsigned long) (((uint64_t) r->bytes * 1000000) / now.busy_us) : 0UL);
+  }
+#endif
+}
+/*---------------------------------------------------------------------------*/
+static void
+fill_buffer(uint16_t len, uint8_t seed)
+{
+  uint16_t i;
+
+  for (i = 0; i < len; i++) {
+    buffer[i] = (uint8_t) (i + seed);
+  }
+}
+/*---------------------------------------------------------------------------*/
+#if CFS_FAT
+/* Single block transfers for size 512, multi block transfers above */
+static void
+bench_raw(struct diskio_device_info *dev)
+{
+  static const uint8_t read_blocks[] = {1, 2, 4};
+  static const uint8_t write_blocks[] = {1, 4, 16, 64};
+  struct bench_result r;
+  rtimer_clock_t t;
+  uint32_t addr;
+  uint8_t i, j, n;
+
+  fill_buffer(BENCH_BUFFER_SIZE, 0);
+
+  for (i = 0; i < sizeof (write_blocks); i++) {
+    n = write_blocks[i];
+    bench_begin(&r);
+    for (addr = 0; addr + n <= BENCH_RAW_BLOCKS; addr += n) {
+      t = RTIMER_NOW();
+      if (n == 1) {
+        diskio_write_block(dev, addr, buffer);
+      } else {
+        diskio_write_blocks_start(dev, addr, n);
+        for (j = 0; j < n; j++) {
+          diskio_write_blocks_next(dev, buffer);
+        }
+        diskio_write_blocks_done(dev);
+      }
+      bench_op(&r, t, n * 512UL);
+    }
+    bench_end(&r, (n == 1) ? "raw_write_single" : "raw_write_multi", n * 512);
+  }
+
+  for (i = 0; i < sizeof (read_blocks); i++) {
+    n = read_blocks[i];
+    bench_begin(&r);
+    for (addr = 0; addr + n <= BENCH_RAW_BLOCKS; addr += n) {
+      t = RTIMER_NOW();
+      if (n == 1) {
+        diskio_read_block(dev, addr, buffer);
+      } else {
+        diskio_read_blocks(dev, addr, n, buffer);
+      }
+      bench_op(&r, t, n * 512UL);
+    }
+    bench_end(&r, (n == 1) ? "raw_read_single" : "raw_read_multi", n * 512);
+  }
+}
+#endif /* CFS_FAT */
+/*---------------------------------------------------------------------------*/
+static void
+bench_append(uint16_t size)
+{
+  struct bench_result r;
+  rtimer_clock_t t;
+  uint32_t done;
+  int fd;
+
+  cfs_remove(BENCH_FILE);
+#if CFS_COFFEE
+  cfs_coffee_reserve(BENCH_FILE, BENCH_FILE_SIZE);
+#endif
+
+  fill_buffer(size, (uint8_t) size);
+
+  bench_begin(&r);
+  fd = cfs_open(BENCH_FILE, CFS_WRITE);
+  if (fd < 0) {
+    printf("ERROR append: open failed\n");
+    return;
+  }
+  for (done = 0; done + size <= BENCH_FILE_SIZE; done += size) {
+    t = RTIMER_NOW();
+    if (cfs_write(fd, buffer, size) != size) {
+      printf("ERROR append: write failed at %lu\n", done);
+      break;
+    }
+    bench_op(&r, t, size);
+  }
+  cfs_close(fd);
+  bench_end(&r, "append", size);
+}
+/*---------------------------------------------------------------------------*/
+static void
+bench_read(uint16_t size)
+{
+  struct bench_result r;
+  rtimer_clock_t t;
+  int fd, n;
+
+  bench_begin(&r);
+  fd = cfs_open(BENCH_FILE, CFS_READ);
+  if (fd < 0) {
+    printf("ERROR read: open failed\n");
+    return;
+  }
+  do {
+    t = RTIMER_NOW();
+    n = cfs_read(fd, buffer, size);
+    if (n > 0) {
+      bench_op(&r, t, n);
+    }
+  } while (n == size);
+  cfs_close(fd);
+  bench_end(&r, "read", size);
+}
+/*---------------------------------------------------------------------------*/
+static void
+bench_seek_read(uint16_t size)
+{
+  struct bench_result r;
+  rtimer_clock_t t;
+  uint32_t offset;
+  uint16_t i;
+  int fd, n;
+
+  random_init(BENCH_SEED);
+
+  fd = cfs_open(BENCH_FILE, CFS_READ);
+  if (fd < 0) {
+    printf("ERROR seek_read: open failed\n");
+    return;
+  }
+  bench_begin(&r);
+  for (i = 0; i < BENCH_SEEKS; i++) {
+    offset = (((uint32_t) random_rand() << 16) | random_rand()) % (BENCH_FILE_SIZE - size);
+    t = RTIMER_NOW();
+    cfs_seek(fd, offset, CFS_SEEK_SET);
+    n = cfs_read(fd, buffer, size);
+    bench_op(&r, t, (n > 0) ? n : 0);
+  }
+  bench_end(&r, "seek_read", size);
+  cfs_close(fd);
+}
+/*---------------------------------------------------------------------------*/
+static void
+bench_churn(void)
+{
+  struct bench_result r;
+  rtimer_clock_t t;
+  char name[] = "CHURN0.DAT";
+  uint16_t i;
+  int fd;
+
+  fill_buffer(16, 0);
+
+  for (i = 0; i < BENCH_CHURN_FILES; i++) {
+    name[5] = '0' + i;
+    cfs_remove(name);
+  }
+
+  bench_begin(&r);
+  for (i = 0; i < BENCH_CHURN; i++) {
+    name[5] = '0' + (i % BENCH_CHURN_FILES);
+    t = RTIMER_NOW();
+    fd = cfs_open(name, BENCH_APPEND_FLAGS);
+    if (fd >= 0) {
+      cfs_write(fd, buffer, 16);
+      cfs_close(fd);
+    }
+    bench_op(&r, t, 16);
+  }
+  bench_end(&r, "churn_write", 16);
+
+  bench_begin(&r);
+  for (i = 0; i < BENCH_CHURN; i++) {
+    name[5] = '0' + (i % BENCH_CHURN_FILES);
+    t = RTIMER_NOW();
+    fd = cfs_open(name, CFS_READ);
+    if (fd >= 0) {
+      cfs_close(fd);
+    }
+    bench_op(&r, t, 0);
+  }
+  bench_end(&r, "churn_open", 0);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static struct etimer timer;
+  static uint8_t i;
+#if CFS_FAT
+  static struct diskio_device_info *dev;
+  static struct FAT_Info fat;
+#endif
+
+  PROCESS_BEGIN();
+
+  etimer_set(&timer, CLOCK_SECOND);
+  PROCESS_WAIT_UNTIL(etimer_expired(&timer));
+
+  printf("INFO file_size %lu seeks %u churn %u seed %u\n",
+          BENCH_FILE_SIZE, BENCH_SEEKS, BENCH_CHURN, BENCH_SEED);
+
+#if CFS_FAT
+  diskio_detect_devices();
+  dev = diskio_devices();
+  for (i = 0; i < DISKIO_MAX_DEVICES; i++) {
+    if (dev[i].type == BENCH_DEVICE) {
+      break;
+    }
+  }
+  if (i == DISKIO_MAX_DEVICES) {
+    printf("ERROR device not found\n");
+    PROCESS_EXIT();
+  }
+  dev += i;
+
+  printf("INFO device type %u sectors %lu sector_size %u\n",
+          dev->type, dev->num_sectors, dev->sector_size);
+  printf("INFO fat sector_cache %u dir_cache %u cluster_runs %u sync %u\n",
+          FAT_SECTOR_CACHE_SIZE, FAT_DIR_CACHE_SIZE, FAT_CLUSTER_RUNS, FAT_SYNC);
+
+  bench_raw(dev);
+  PROCESS_PAUSE();
+
+  if (cfs_fat_mkfs(dev) != 0 || cfs_fat_mount_device(dev) != 0) {
+    printf("ERROR mkfs/mount failed\n");
+    PROCESS_EXIT();
+  }
+  diskio_set_default_device(dev);
+  cfs_fat_get_fat_info(&fat);
+  printf("INFO fat type %u sectors_per_cluster %u\n", fat.type, fat.BPB_SecPerClus);
+#elif CFS_COFFEE
+  printf("INFO coffee device %u\n", COFFEE_DEVICE);
+  if (cfs_coffee_format() != 0) {
+    printf("ERROR format failed\n");
+    PROCESS_EXIT();
+  }
+#endif
+
+  for (i = 0; i < NUM_FILE_SIZES; i++) {
+    if (file_sizes[i] > BENCH_FILE_SIZE) {
+      continue;
+    }
+    bench_append(file_sizes[i]);
+    PROCESS_PAUSE();
+    bench_read(file_sizes[i]);
+    PROCESS_PAUSE();
+  }
+
+  for (i = 0; i < NUM_FILE_SIZES; i++) {
+    if (file_sizes[i] >= BENCH_FILE_SIZE) {
+      continue;
+    }
+    bench_seek_read(file_sizes[i]);
+    PROCESS_PAUSE();
+  }
+
+  bench_churn();
+
+#if CFS_FAT
+  cfs_fat_umount_device();
+#endif
+
+  printf("INFO done\n");
+#if CONTIKI_TARGET_NATIVE
+  exit(0);
+#endif
+
+  PROCESS_END();
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *      Offers the files of the SD card to tools/inga/inga_offload
+ *
+ *      Build with e.g. DEFINES=FAT_OFFLOAD_CONF_BAUD=USART_BAUD_500000 to
+ *      switch the UART to 500 kbaud once the card is mounted.
+ */
+
+#include "contiki.h"
+#include <stdio.h>
+
+#include "fat/diskio.h"
+#include "fat/cfs-fat.h"
+#include "fat-offload.h"
+
+PROCESS(offload_process, "Offload process");
+AUTOSTART_PROCESSES(&offload_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(offload_process, ev, data)
+{
+  static struct etimer timer;
+  struct diskio_device_info *info;
+  int i;
+
+  PROCESS_BEGIN();
+
+  etimer_set(&timer, CLOCK_SECOND);
+  PROCESS_WAIT_UNTIL(etimer_expired(&timer));
+
+  diskio_detect_devices();
+  info = diskio_devices();
+  for (i = 0; i < DISKIO_MAX_DEVICES; i++) {
+    if ((info + i)->type == (DISKIO_DEVICE_TYPE_SD_CARD | DISKIO_DEVICE_TYPE_PARTITION)) {
+      info += i;
+      break;
+    }
+  }
+
+  if (i == DISKIO_MAX_DEVICES || cfs_fat_mount_device(info) != 0) {
+    printf("Error: no FAT volume on the SD card\n");
+    PROCESS_EXIT();
+  }
+  diskio_set_default_device(info);
+
+  printf("FAT volume mounted, waiting for inga_offload\n");
+  fat_offload_init();
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -47,6 +47,9 @@ PROCESS_THREAD(acc_process, ev, data)
 {
   PROCESS_BEGIN();
 
+  // the sensor is polled, no broadcast events needed
+  process_ignore_broadcasts();
+
   // just wait shortly to be sure sensor is available
   etimer_set(&timer, CLOCK_SECOND * 0.05);
   PROCESS_YIELD();
@@ -43,6 +43,7 @@ PROCESS(button_process, "button process");
 AUTOSTART_PROCESSES(&button_process);
 /*---------------------------------------------------------------------------*/
 static struct etimer timer;
+PROCESS_SUBSCRIPTION(button_subscription);
 PROCESS_THREAD(button_process, ev, data)
 {
   PROCESS_BEGIN();
@@ -61,6 +62,9 @@ PROCESS_THREAD(button_process, ev, data)
     printf("Error: Failed to init button sensor, aborting...\n");
     PROCESS_EXIT();
   }
+
+  // only wake up for sensor events, not for every broadcast
+  process_subscribe(&button_subscription, sensors_event);
   
   while (1) {
 
@@ -94,22 +94,6 @@ json_ws_udp_setup(const char *host, uint16_t port)
   return 1;
 }
 
-/*---------------------------------------------------------------------------*/
-
-static char *udp_buf;
-static int pos;
-static int size;
-
-static int
-putchar_udp(int c)
-{
-  if(udp_buf != NULL && pos <= size) {
-    udp_buf[pos++] = c;
-    return c;
-  }
-  return 0;
-}
-
 /*---------------------------------------------------------------------------*/
 void
 json_ws_udp_send(struct jsontree_value *tree, const char *path)
@@ -117,20 +101,15 @@ json_ws_udp_send(struct jsontree_value *tree, const char *path)
   struct jsontree_context json;
   /* maxsize = 70 bytes */
   char buf[70];
-
-  udp_buf = buf;
-
-  /* reset state and set max-size */
-  /* NOTE: packet will be truncated at 70 bytes */
-  pos = 0;
-  size = sizeof(buf);
+  int pos;
 
   json.values[0] = (struct json_value *)tree;
   jsontree_reset(&json);
   find_json_path(&json, path);
   json.path = json.depth;
-  json.putchar = putchar_udp;
-  while(jsontree_print_next(&json) && json.path <= json.depth);
+
+  /* NOTE: packet will be truncated at 70 bytes */
+  pos = jsontree_print_buf(&json, buf, sizeof(buf) - 1);
 
   printf("Real UDP size: %d\n", pos);
   buf[pos] = 0;
@@ -262,17 +262,19 @@ struct jsontree_callback json_leds_callback =
 
 #endif /* PLATFORM_HAS_LEDS */
 /*---------------------------------------------------------------------------*/
-static struct httpd_ws_state *json_putchar_context;
+/* Bytes of JSON to print into outbuf before it is sent */
 static int
-json_putchar(int c)
+chunk_size(struct httpd_ws_state *s)
 {
-  if(json_putchar_context != NULL &&
-     json_putchar_context->outbuf_pos < HTTPD_OUTBUF_SIZE) {
-    json_putchar_context->outbuf[json_putchar_context->outbuf_pos++] = c;
-    return c;
+#if HTTPD_WS_KEEPALIVE
+  /* Never send more than the announced length */
+  if(s->keepalive && s->response_len < UIP_TCP_MSS) {
+    return s->response_len;
   }
-  return 0;
+#endif /* HTTPD_WS_KEEPALIVE */
+  return UIP_TCP_MSS;
 }
+/*---------------------------------------------------------------------------*/
 static int putchar_size = 0;
 static int
 json_putchar_count(int c)
@@ -284,11 +286,8 @@ json_putchar_count(int c)
 static
 PT_THREAD(send_values(struct httpd_ws_state *s))
 {
-  json_putchar_context = s;
-
   PSOCK_BEGIN(&s->sout);
 
-  s->json.putchar = json_putchar;
   s->outbuf_pos = 0;
 
   if(s->json.values[0] == NULL) {
@@ -314,15 +313,27 @@ PT_THREAD(send_values(struct httpd_ws_state *s))
 
   } else {
     /* Get value */
-    while(jsontree_print_next(&s->json) && s->json.path <= s->json.depth) {
-      if(s->outbuf_pos >= UIP_TCP_MSS) {
-        SEND_STRING(&s->sout, s->outbuf, UIP_TCP_MSS);
-        s->outbuf_pos -= UIP_TCP_MSS;
-        if(s->outbuf_pos > 0) {
-          memcpy(s->outbuf, &s->outbuf[UIP_TCP_MSS], s->outbuf_pos);
-        }
+    while((s->outbuf_pos = jsontree_print_buf(&s->json, s->outbuf,
+                                              chunk_size(s))) > 0) {
+#if HTTPD_WS_KEEPALIVE
+      if(s->keepalive) {
+        s->response_len -= s->outbuf_pos;
       }
+#endif /* HTTPD_WS_KEEPALIVE */
+      SEND_STRING(&s->sout, s->outbuf, s->outbuf_pos);
     }
+#if HTTPD_WS_KEEPALIVE
+    /* A value may have become shorter since the length was counted,
+       fill up with white space */
+    while(s->keepalive && s->response_len > 0) {
+      s->outbuf_pos = s->response_len < UIP_TCP_MSS ?
+        s->response_len : UIP_TCP_MSS;
+      memset(s->outbuf, ' ', s->outbuf_pos);
+      s->response_len -= s->outbuf_pos;
+      SEND_STRING(&s->sout, s->outbuf, s->outbuf_pos);
+    }
+#endif /* HTTPD_WS_KEEPALIVE */
+    s->outbuf_pos = 0;
   }
 
   if(s->outbuf_pos > 0) {
@@ -415,6 +426,14 @@ httpd_ws_get_script(struct httpd_ws_state *s)
   if(v != NULL) {
     s->json.path = s->json.depth;
     s->content_type = http_content_type_json;
+#if HTTPD_WS_KEEPALIVE
+    if(s->request_type == HTTPD_WS_POST) {
+      s->response_len = 15;
+    } else {
+      s->response_len = calculate_json_size(s->filename[1] == '\0' ?
+                                            NULL : &s->filename[1], NULL);
+    }
+#endif /* HTTPD_WS_KEEPALIVE */
     return send_values;
   }
   return NULL;
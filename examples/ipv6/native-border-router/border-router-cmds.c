@@ -85,6 +85,14 @@ border_router_cmd_handler(const uint8_t *data, int len)
 	     data[2], data[3], data[4]);
       packet_sent(data[2], data[3], data[4]);
       return 1;
+    } else if(data[1] == 'W' && command_context == CMD_CONTEXT_RADIO) {
+      /* The slip-radio takes batches, see border-router-rdc.c */
+      printf("Radio window is:%d frames %d bytes\n", data[2],
+             (data[3] << 8) | data[4]);
+      border_router_rdc_set_window(data[2], (data[3] << 8) | data[4]);
+      /* The window keeps the radio from overrunning */
+      slip_set_send_delay(0);
+      return 1;
     } else if(data[1] == 'D' && command_context == CMD_CONTEXT_RADIO) {
       /* We need to know that this is from the slip-radio here... */
       PRINTF("Sensor data received\n");
@@ -40,6 +40,7 @@
 #include "net/packetbuf.h"
 #include "net/queuebuf.h"
 #include "net/netstack.h"
+#include "sys/ctimer.h"
 #include "packetutils.h"
 #include "border-router.h"
 #include <string.h>
@@ -55,6 +56,22 @@
 #define MAX_CALLBACKS 16
 static int callback_pos;
 
+/* 3 bytes per packet attribute is required for serialization */
+#define MAX_MSG_SIZE (PACKETBUF_NUM_ATTRS * 3 + PACKETBUF_SIZE + 3)
+
+/* Frames reported neither sent nor failed by then are given up */
+#ifdef BORDER_ROUTER_RDC_CONF_CREDIT_TIMEOUT
+#define CREDIT_TIMEOUT BORDER_ROUTER_RDC_CONF_CREDIT_TIMEOUT
+#else
+#define CREDIT_TIMEOUT (CLOCK_SECOND * 2)
+#endif
+
+enum {
+  CALLBACK_FREE,
+  CALLBACK_QUEUED,
+  CALLBACK_SENT
+};
+
 /* a structure for calling back when packet data is coming back
    from radio... */
 struct tx_callback {
@@ -62,23 +79,147 @@ struct tx_callback {
   void *ptr;
   struct packetbuf_attr attrs[PACKETBUF_NUM_ATTRS];
   struct packetbuf_addr addrs[PACKETBUF_NUM_ADDRS];
+  uint8_t state;
+  uint16_t len;
+  uint8_t msg[MAX_MSG_SIZE];
 };
 
 static struct tx_callback callbacks[MAX_CALLBACKS];
+
+/*
+ * Once the slip-radio answered "?W" with its window, the "!S" messages
+ * are queued here and sent in "!B" batches (see slip-radio.c) as long as
+ * the radio has credits left. Each "!R" report returns the credits of its
+ * frame. Without a window every frame is sent on its own right away.
+ */
+static uint8_t window_frames;
+static uint16_t window_bytes;
+static uint8_t credit_frames;
+static uint16_t credit_bytes;
+static int send_pos;
+static struct ctimer credit_timer;
+
+PROCESS(border_router_rdc_process, "Border router RDC batching");
+/*---------------------------------------------------------------------------*/
+static void
+call_sent_callback(struct tx_callback *callback, uint8_t status, uint8_t tx)
+{
+  packetbuf_clear();
+  packetbuf_attr_copyfrom(callback->attrs, callback->addrs);
+  mac_call_sent_callback(callback->cback, callback->ptr, status, tx);
+}
+/*---------------------------------------------------------------------------*/
+static void
+credit_timeout(void *ptr)
+{
+  int i;
+
+  PRINTF("br-rdc: reports lost, resetting credits\n");
+  for(i = 0; i < MAX_CALLBACKS; i++) {
+    if(callbacks[i].state == CALLBACK_SENT) {
+      callbacks[i].state = CALLBACK_FREE;
+      call_sent_callback(&callbacks[i], MAC_TX_ERR, 1);
+    }
+  }
+  credit_frames = window_frames;
+  credit_bytes = window_bytes;
+  process_poll(&border_router_rdc_process);
+}
 /*---------------------------------------------------------------------------*/
 void packet_sent(uint8_t sessionid, uint8_t status, uint8_t tx)
 {
   if(sessionid < MAX_CALLBACKS) {
     struct tx_callback *callback;
     callback = &callbacks[sessionid];
-    packetbuf_clear();
-    packetbuf_attr_copyfrom(callback->attrs, callback->addrs);
-    mac_call_sent_callback(callback->cback, callback->ptr, status, tx);
+    if(window_frames > 0) {
+      if(callback->state != CALLBACK_SENT) {
+        PRINTF("br-rdc: stale report for sid %d\n", sessionid);
+        return;
+      }
+      callback->state = CALLBACK_FREE;
+      credit_frames++;
+      credit_bytes += callback->len + 2;
+      if(credit_frames < window_frames) {
+        ctimer_restart(&credit_timer);
+      } else {
+        ctimer_stop(&credit_timer);
+      }
+      process_poll(&border_router_rdc_process);
+    }
+    call_sent_callback(callback, status, tx);
   } else {
     PRINTF("*** ERROR: too high session id %d\n", sessionid);
   }
 }
 /*---------------------------------------------------------------------------*/
+void
+border_router_rdc_set_window(uint8_t frames, uint16_t bytes)
+{
+  int i;
+
+  if(frames > MAX_CALLBACKS) {
+    frames = MAX_CALLBACKS;
+  }
+  if(bytes > MAX_MSG_SIZE + 2) {
+    bytes = MAX_MSG_SIZE + 2;
+  }
+  PRINTF("br-rdc: radio window %u frames %u bytes\n", frames, bytes);
+
+  /* Frames sent before are not accounted for */
+  for(i = 0; i < MAX_CALLBACKS; i++) {
+    callbacks[i].state = CALLBACK_FREE;
+  }
+  send_pos = callback_pos;
+  window_frames = credit_frames = frames;
+  window_bytes = credit_bytes = bytes;
+  ctimer_stop(&credit_timer);
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_batches(void)
+{
+  static uint8_t batch[MAX_MSG_SIZE + 4];
+  struct tx_callback *callback;
+  int len, count;
+
+  do {
+    len = 2;
+    count = 0;
+    for(callback = &callbacks[send_pos];
+        callback->state == CALLBACK_QUEUED;
+        callback = &callbacks[send_pos]) {
+      if(credit_frames == 0 || callback->len + 2 > credit_bytes) {
+        break;
+      }
+      batch[len++] = callback->len >> 8;
+      batch[len++] = callback->len & 0xff;
+      memcpy(&batch[len], callback->msg, callback->len);
+      len += callback->len;
+      count++;
+
+      callback->state = CALLBACK_SENT;
+      credit_frames--;
+      credit_bytes -= callback->len + 2;
+      if(++send_pos >= MAX_CALLBACKS) {
+        send_pos = 0;
+      }
+    }
+
+    if(count == 1) {
+      /* Not worth the batch header */
+      write_to_slip(&batch[4], len - 4);
+    } else if(count > 1) {
+      batch[0] = '!';
+      batch[1] = 'B';
+      write_to_slip(batch, len);
+    }
+  } while(count > 0);
+
+  if(credit_frames < window_frames && ctimer_expired(&credit_timer)) {
+    ctimer_set(&credit_timer, CREDIT_TIMEOUT, credit_timeout, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
 static int
 setup_callback(mac_callback_t sent, void *ptr)
 {
@@ -101,8 +242,7 @@ static void
 send_packet(mac_callback_t sent, void *ptr)
 {
   int size;
-  /* 3 bytes per packet attribute is required for serialization */
-  uint8_t buf[PACKETBUF_NUM_ATTRS * 3 + PACKETBUF_SIZE + 3];
+  uint8_t buf[MAX_MSG_SIZE];
   uint8_t sid;
 
   packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &rimeaddr_node_addr);
@@ -124,6 +264,14 @@ send_packet(mac_callback_t sent, void *ptr)
     if(size < 0 || size + packetbuf_totlen() + 3 > sizeof(buf)) {
       PRINTF("br-rdc: send failed, too large header\n");
       mac_call_sent_callback(sent, ptr, MAC_TX_ERR_FATAL, 1);
+    } else if(window_frames > 0 &&
+              size + packetbuf_totlen() + 3 + 2 > window_bytes) {
+      PRINTF("br-rdc: send failed, too large for the radio\n");
+      mac_call_sent_callback(sent, ptr, MAC_TX_ERR_FATAL, 1);
+    } else if(window_frames > 0 &&
+              callbacks[callback_pos].state != CALLBACK_FREE) {
+      /* All sessions are queued or on air, let the MAC back off */
+      mac_call_sent_callback(sent, ptr, MAC_TX_COLLISION, 0);
     } else {
       sid = setup_callback(sent, ptr);
 
@@ -134,7 +282,14 @@ send_packet(mac_callback_t sent, void *ptr)
       /* Copy packet data */
       memcpy(&buf[3 + size], packetbuf_hdrptr(), packetbuf_totlen());
 
-      write_to_slip(buf, packetbuf_totlen() + size + 3);
+      if(window_frames > 0) {
+        callbacks[sid].len = packetbuf_totlen() + size + 3;
+        memcpy(callbacks[sid].msg, buf, callbacks[sid].len);
+        callbacks[sid].state = CALLBACK_QUEUED;
+        process_poll(&border_router_rdc_process);
+      } else {
+        write_to_slip(buf, packetbuf_totlen() + size + 3);
+      }
     }
   }
 }
@@ -180,6 +335,9 @@ static void
 init(void)
 {
   callback_pos = 0;
+  send_pos = 0;
+  window_frames = 0;
+  process_start(&border_router_rdc_process, NULL);
 }
 /*---------------------------------------------------------------------------*/
 const struct rdc_driver border_router_rdc_driver = {
@@ -193,3 +351,15 @@ const struct rdc_driver border_router_rdc_driver = {
   channel_check_interval,
 };
 /*---------------------------------------------------------------------------*/
+PROCESS_THREAD(border_router_rdc_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
+    send_batches();
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
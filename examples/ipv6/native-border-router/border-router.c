@@ -241,6 +241,13 @@ request_mac(void)
   write_to_slip((uint8_t *)"?M", 2);
 }
 /*---------------------------------------------------------------------------*/
+static void
+request_window(void)
+{
+  /* Older slip-radios do not answer and get one frame per message */
+  write_to_slip((uint8_t *)"?W", 2);
+}
+/*---------------------------------------------------------------------------*/
 void
 border_router_set_mac(const uint8_t *data)
 {
@@ -321,6 +328,7 @@ PROCESS_THREAD(border_router_process, ev, data)
     request_mac();
     PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
   }
+  request_window();
 
   if(slip_config_ipaddr != NULL) {
     uip_ipaddr_t prefix;
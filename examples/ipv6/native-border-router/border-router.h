@@ -44,6 +44,8 @@
 int border_router_cmd_handler(const uint8_t *data, int len);
 int slip_config_handle_arguments(int argc, char **argv);
 void write_to_slip(const uint8_t *buf, int len);
+void slip_set_send_delay(clock_time_t delay);
+void border_router_rdc_set_window(uint8_t frames, uint16_t bytes);
 
 void border_router_set_prefix_64(const uip_ipaddr_t *prefix_64);
 void border_router_set_mac(const uint8_t *data);
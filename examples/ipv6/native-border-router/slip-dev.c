@@ -169,6 +169,55 @@ slip_packet_input(unsigned char *data, int len)
   NETSTACK_RDC.input();
 }
 /*---------------------------------------------------------------------------*/
+/* Handles one message from the slip-radio, "!B" carries several of them */
+static void
+slip_message_input(unsigned char *data, int len)
+{
+  int i, msg_len;
+
+  if(len >= 2 && data[0] == '!' && data[1] == 'B') {
+    for(i = 2; i + 2 <= len; i += msg_len) {
+      msg_len = (data[i] << 8) | data[i + 1];
+      i += 2;
+      if(msg_len == 0 || i + msg_len > len) {
+        fprintf(stderr, "*** dropping truncated batch\n");
+        break;
+      }
+      slip_message_input(&data[i], msg_len);
+    }
+  } else if(data[0] == '!') {
+    command_context = CMD_CONTEXT_RADIO;
+    cmd_input(data, len);
+  } else if(data[0] == '?') {
+#define DEBUG_LINE_MARKER '\r'
+  } else if(data[0] == DEBUG_LINE_MARKER) {
+    fwrite(data + 1, len - 1, 1, stdout);
+  } else if(is_sensible_string(data, len)) {
+    if(slip_config_verbose == 1) {   /* strings already echoed below for verbose>1 */
+      fwrite(data, len, 1, stdout);
+    }
+  } else {
+    if(slip_config_verbose > 2) {
+      printf("Packet from SLIP of length %d - write TUN\n", len);
+      if(slip_config_verbose > 4) {
+#if WIRESHARK_IMPORT_FORMAT
+        printf("0000");
+        for(i = 0; i < len; i++) printf(" %02x", data[i]);
+#else
+        printf("         ");
+        for(i = 0; i < len; i++) {
+          printf("%02x", data[i]);
+          if((i & 3) == 3) printf(" ");
+          if((i & 15) == 15) printf("\n         ");
+        }
+#endif
+        printf("\n");
+      }
+    }
+    slip_packet_input(data, len);
+  }
+}
+/*---------------------------------------------------------------------------*/
 /*
  * Read from serial, when we have a packet call slip_packet_input. No output
  * buffering, input buffered by stdio.
@@ -178,7 +227,7 @@ serial_input(FILE *inslip)
 {
   static unsigned char inbuf[2048];
   static int inbufptr = 0;
-  int ret,i;
+  int ret;
   unsigned char c;
 
 #ifdef linux
@@ -207,37 +256,7 @@ serial_input(FILE *inslip)
   switch(c) {
   case SLIP_END:
     if(inbufptr > 0) {
-      if(inbuf[0] == '!') {
-	command_context = CMD_CONTEXT_RADIO;
-	cmd_input(inbuf, inbufptr);
-      } else if(inbuf[0] == '?') {
-#define DEBUG_LINE_MARKER '\r'
-      } else if(inbuf[0] == DEBUG_LINE_MARKER) {
-	fwrite(inbuf + 1, inbufptr - 1, 1, stdout);
-      } else if(is_sensible_string(inbuf, inbufptr)) {
-        if(slip_config_verbose == 1) {   /* strings already echoed below for verbose>1 */
-          fwrite(inbuf, inbufptr, 1, stdout);
-        }
-      } else {
-        if(slip_config_verbose > 2) {
-          printf("Packet from SLIP of length %d - write TUN\n", inbufptr);
-          if(slip_config_verbose > 4) {
-#if WIRESHARK_IMPORT_FORMAT
-            printf("0000");
-	    for(i = 0; i < inbufptr; i++) printf(" %02x", inbuf[i]);
-#else
-            printf("         ");
-            for(i = 0; i < inbufptr; i++) {
-              printf("%02x", inbuf[i]);
-              if((i & 3) == 3) printf(" ");
-              if((i & 15) == 15) printf("\n         ");
-            }
-#endif
-            printf("\n");
-          }
-        }
-	slip_packet_input(inbuf, inbufptr);
-      }
+      slip_message_input(inbuf, inbufptr);
       inbufptr = 0;
     }
     break;
@@ -413,6 +432,12 @@ write_to_slip(const uint8_t *buf, int len)
   }
 }
 /*---------------------------------------------------------------------------*/
+void
+slip_set_send_delay(clock_time_t delay)
+{
+  send_delay = delay;
+}
+/*---------------------------------------------------------------------------*/
 static void
 stty_telos(int fd)
 {
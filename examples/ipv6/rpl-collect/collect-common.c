@@ -41,6 +41,7 @@
 #include "dev/serial-line.h"
 #include "dev/leds.h"
 #include "collect-common.h"
+#include "collect-view.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -85,12 +86,18 @@ collect_common_recv(const rimeaddr_t *originator, uint8_t seqno, uint8_t hops,
                     uint8_t *payload, uint16_t payload_len)
 {
   unsigned long time;
+#if !COLLECT_VIEW_RECORD
   uint16_t data;
   int i;
+#endif /* !COLLECT_VIEW_RECORD */
 
-  printf("%u", 8 + payload_len / 2);
   /* Timestamp. Ignore time synch for now. */
   time = get_time();
+#if COLLECT_VIEW_RECORD
+  collect_view_print_record(time, originator, seqno, hops,
+                            payload, payload_len);
+#else /* COLLECT_VIEW_RECORD */
+  printf("%u", 8 + payload_len / 2);
   printf(" %lu %lu 0", ((time >> 16) & 0xffff), time & 0xffff);
   /* Ignore latency for now */
   printf(" %u %u %u %u",
@@ -101,6 +108,7 @@ collect_common_recv(const rimeaddr_t *originator, uint8_t seqno, uint8_t hops,
     printf(" %u", data);
   }
   printf("\n");
+#endif /* COLLECT_VIEW_RECORD */
   leds_blink();
 }
 /*---------------------------------------------------------------------------*/
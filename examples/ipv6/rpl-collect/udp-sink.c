@@ -33,6 +33,7 @@
 #include "net/uip.h"
 #include "net/rpl/rpl.h"
 #include "net/rime/rimeaddr.h"
+#include "net/rime/timesynch.h"
 
 #include "net/netstack.h"
 #include "dev/button-sensor.h"
@@ -155,6 +156,10 @@ PROCESS_THREAD(udp_server_process, ev, data)
     uip_ip6addr(&ipaddr, 0xaaaa, 0, 0, 0, 0, 0, 0, 0);
     rpl_set_prefix(dag, &ipaddr, 64);
     PRINTF("created a new RPL dag\n");
+#if TIMESYNCH_CONF_ENABLED
+    /* The sink is the time source of the network */
+    timesynch_set_authority_level(0);
+#endif /* TIMESYNCH_CONF_ENABLED */
   } else {
     PRINTF("failed to create a new RPL DAG\n");
   }
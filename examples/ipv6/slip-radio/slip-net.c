@@ -32,6 +32,7 @@
 #include "net/uip.h"
 #include "net/packetbuf.h"
 #include "dev/slip.h"
+#include "slip-radio.h"
 #include <stdio.h>
 
 #define SLIP_END     0300
@@ -92,7 +93,7 @@ slipnet_input(void)
   }
 
   /* printf("SUT: %u\n", uip_len); */
-  slip_send_packet(uip_buf, uip_len);
+  slip_radio_send(uip_buf, uip_len);
 }
 /*---------------------------------------------------------------------------*/
 const struct network_driver slipnet_driver = {
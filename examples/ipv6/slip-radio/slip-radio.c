@@ -58,6 +58,32 @@ void slip_send_packet(const uint8_t *ptr, int len);
 uint8_t packet_ids[16];
 int packet_pos;
 
+/*
+ * Once the host asked for the window with "?W", the messages to the host
+ * are collected and sent as one "!B" message when the process is polled:
+ *
+ *   '!' 'B' { <length high> <length low> <message> }*
+ *
+ * The host batches its "!S" messages the same way. The window answer
+ * "!W" <frames> <bytes high> <bytes low> tells how many frames, and how
+ * many bytes of "!S" messages counting 2 bytes per message, the host may
+ * have outstanding until their "!R" reports arrive. The bytes fit into the
+ * SLIP input buffer, so nothing is dropped while a frame is on air.
+ */
+#ifdef SLIP_RADIO_CONF_BATCH_SIZE
+#define BATCH_SIZE SLIP_RADIO_CONF_BATCH_SIZE
+#else
+#define BATCH_SIZE 160
+#endif
+#define WINDOW_BYTES (UIP_BUFSIZE - UIP_LLH_LEN - 2)
+
+static uint8_t batch[BATCH_SIZE];
+static uint16_t batch_len;
+static uint8_t batch_count;
+static uint8_t batching;
+
+PROCESS_NAME(slip_radio_process);
+
 static int slip_radio_cmd_handler(const uint8_t *data, int len);
 
 #if CONTIKI_TARGET_NOOLIBERRY
@@ -76,6 +102,43 @@ CMD_HANDLERS(slip_radio_cmd_handler);
 #endif
 /*---------------------------------------------------------------------------*/
 static void
+batch_flush(void)
+{
+  if(batch_count == 1) {
+    /* Not worth the batch header */
+    slip_send_packet(&batch[4], batch_len - 4);
+  } else if(batch_count > 1) {
+    slip_send_packet(batch, batch_len);
+  }
+  batch_len = 0;
+  batch_count = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+slip_radio_send(const uint8_t *data, int len)
+{
+  if(!batching || len + 4 > BATCH_SIZE) {
+    batch_flush();
+    slip_send_packet(data, len);
+    return;
+  }
+
+  if(batch_len + 2 + len > BATCH_SIZE) {
+    batch_flush();
+  }
+  if(batch_len == 0) {
+    batch[batch_len++] = '!';
+    batch[batch_len++] = 'B';
+    process_poll(&slip_radio_process);
+  }
+  batch[batch_len++] = len >> 8;
+  batch[batch_len++] = len & 0xff;
+  memcpy(&batch[batch_len], data, len);
+  batch_len += len;
+  batch_count++;
+}
+/*---------------------------------------------------------------------------*/
+static void
 packet_sent(void *ptr, int status, int transmissions)
 {
   uint8_t buf[20];
@@ -132,19 +195,45 @@ slip_radio_cmd_handler(const uint8_t *data, int len)
 	packet_pos = 0;
       }
 
+      return 1;
+    } else if(data[1] == 'B') {
+      /* --- b a t c h --- */
+      int pos, msg_len;
+
+      for(pos = 2; pos + 2 <= len; pos += msg_len) {
+        msg_len = (data[pos] << 8) | data[pos + 1];
+        pos += 2;
+        if(msg_len == 0 || pos + msg_len > len) {
+          PRINTF("slip-radio: truncated batch\n");
+          break;
+        }
+        cmd_input(&data[pos], msg_len);
+      }
       return 1;
     }
-  } else if(uip_buf[0] == '?') {
-    PRINTF("Got request message of type %c\n", uip_buf[1]);
+  } else if(data[0] == '?') {
+    /* Replies are built in buf, data may point into a batch in uip_buf */
+    uint8_t buf[10];
+
+    PRINTF("Got request message of type %c\n", data[1]);
     if(data[1] == 'M') {
       /* this is just a test so far... just to see if it works */
-      uip_buf[0] = '!';
-      uip_buf[1] = 'M';
+      buf[0] = '!';
+      buf[1] = 'M';
       for(i = 0; i < 8; i++) {
-        uip_buf[2 + i] = uip_lladdr.addr[i];
+        buf[2 + i] = uip_lladdr.addr[i];
       }
-      uip_len = 10;
-      cmd_send(uip_buf, uip_len);
+      cmd_send(buf, 10);
+      return 1;
+    } else if(data[1] == 'W') {
+      buf[0] = '!';
+      buf[1] = 'W';
+      buf[2] = sizeof(packet_ids);
+      buf[3] = WINDOW_BYTES >> 8;
+      buf[4] = WINDOW_BYTES & 0xff;
+      cmd_send(buf, 5);
+      /* The host understands batches */
+      batching = 1;
       return 1;
     }
   }
@@ -154,7 +243,7 @@ slip_radio_cmd_handler(const uint8_t *data, int len)
 void
 slip_radio_cmd_output(const uint8_t *data, int data_len)
 {
-  slip_send_packet(data, data_len);
+  slip_radio_send(data, data_len);
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -175,6 +264,9 @@ init(void)
   process_start(&slip_process, NULL);
   slip_set_input_callback(slip_input_callback);
   packet_pos = 0;
+  batch_len = 0;
+  batch_count = 0;
+  batching = 0;
 }
 /*---------------------------------------------------------------------------*/
 #if !SLIP_RADIO_CONF_NO_PUTCHAR
@@ -227,6 +319,10 @@ PROCESS_THREAD(slip_radio_process, ev, data)
   while(1) {
     PROCESS_YIELD();
 
+    if(ev == PROCESS_EVENT_POLL) {
+      batch_flush();
+    }
+
     if(etimer_expired(&et)) {
       etimer_reset(&et);
 #ifdef SLIP_RADIO_CONF_SENSORS
@@ -38,4 +38,10 @@ struct slip_radio_sensors {
   void (* send)(void);
 };
 
+/**
+ * Sends a message to the host, batched with others once the host has
+ * requested the window
+ */
+void slip_radio_send(const uint8_t *data, int len);
+
 #endif /* SLIP_RADIO_H_ */
@@ -343,22 +343,17 @@ external_flash_write_page(coffee_page_t page, CFS_CONF_OFFSET_TYPE offset, uint8
     return;
   }
 
-  unsigned char buffer[COFFEE_PAGE_SIZE];
-
-  // Now read the current content of that page
-  at45db_read_page_bypassed(page, 0, buffer, COFFEE_PAGE_SIZE);
-
-  watchdog_periodic();
-
-  // Copy over the new content
-  memcpy(buffer + offset, buf, size);
-
-  // And write the page again
-  at45db_write_page(page, 0, buffer, COFFEE_PAGE_SIZE);
+  if (offset == 0 && size == COFFEE_PAGE_SIZE) {
+    // A whole page does not need the old content
+    at45db_write_page_async(page, 0, buf, size);
+  } else {
+    // Merge the new content into the page inside the chip
+    at45db_update_page(page, offset, buf, size);
+  }
 
   watchdog_periodic();
 
-  PRINTF("Page %u programmed with %u bytes (%u new)\n", page, COFFEE_PAGE_SIZE, size);
+  PRINTF("Page %u programmed with %u new bytes\n", page, size);
 }
 /*----------------------------------------------------------------------------*/
 void
@@ -440,34 +435,14 @@ external_flash_read(CFS_CONF_OFFSET_TYPE addr, uint8_t *buf, CFS_CONF_OFFSET_TYP
     return;
   }
 
-  // First of all: find out what the number of the page is
-  coffee_page_t current_page = addr / COFFEE_PAGE_SIZE;
-  CFS_CONF_OFFSET_TYPE read = 0;
-
-  while (read < size) {
-    // get the start address of the current page
-    CFS_CONF_OFFSET_TYPE page_start = current_page * COFFEE_PAGE_SIZE;
-    CFS_CONF_OFFSET_TYPE offset = 0;
-
-    if (addr > page_start) {
-      // Frist page offset
-      offset = addr - page_start;
-    }
-
-    CFS_CONF_OFFSET_TYPE length = size - read;
-
-    if (length > (COFFEE_PAGE_SIZE - offset)) {
-      length = (COFFEE_PAGE_SIZE - offset);
-    }
-
-    external_flash_read_page(current_page, offset, buf + read, length);
-
-//    PRINTF("Page %u read with %u bytes (offset %u)\n", h, length, offset);
-
-    read += length;
-    current_page++;
+  if (size > COFFEE_SIZE - addr) {
+    size = COFFEE_SIZE - addr;
   }
 
+  // One continuous read streams across all pages of the range
+  at45db_read_continuous(addr / COFFEE_PAGE_SIZE, addr % COFFEE_PAGE_SIZE, buf, size);
+  watchdog_periodic();
+
 #if DEBUG > 1
   int g;
   printf("READ: ");
@@ -479,40 +454,19 @@ external_flash_read(CFS_CONF_OFFSET_TYPE addr, uint8_t *buf, CFS_CONF_OFFSET_TYP
 }
 /*----------------------------------------------------------------------------*/
 void
-external_flash_erase(coffee_page_t page)
+external_flash_erase(coffee_page_t sector)
 {
-  if (page > COFFEE_PAGES) {
+  if (sector >= COFFEE_SIZE / COFFEE_SECTOR_SIZE) {
     return;
   }
 
-  PRINTF("external_flash_erase(page %u)\n", page);
+  PRINTF("external_flash_erase(sector %u)\n", sector);
 
-  at45db_erase_page(page);
+  // One sector is one block of the AT45DB
+  at45db_erase_block(sector);
   watchdog_periodic();
 }
 
-/*
-void external_flash_erase(coffee_page_t sector) {
-  if( sector > COFFEE_SECTORS ) {
-    return;
-  }
-
-  // This has to erase the contents of a whole sector
-  // AT45DB cannot directly delete a sector, we have to do it manually
-  PRINTF("external_flash_erase(sector %u)\n", sector);
-  CFS_CONF_OFFSET_TYPE h;
-
-  coffee_page_t start = sector * COFFEE_BLOCKS_PER_SECTOR;
-  coffee_page_t end = start + COFFEE_BLOCKS_PER_SECTOR;
-
-  for(h=start; h<end; h++) {
-    PRINTF("Deleting block %u\n", h);
-
-    at45db_erase_block(h);
-    watchdog_periodic();
-  }
-}
- */
 
 #endif /* COFFEE_INGA_EXTERNAL */
 
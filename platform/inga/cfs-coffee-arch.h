@@ -176,12 +176,13 @@ void avr_flash_write(CFS_CONF_OFFSET_TYPE addr, uint8_t *buf, CFS_CONF_OFFSET_TY
 #define COFFEE_START              (COFFEE_ADDRESS)
 #define COFFEE_SIZE               2162688UL
 
-/* These must agree with the parameters passed to makefsdata */
-#define COFFEE_SECTOR_SIZE        COFFEE_PAGE_SIZE
+/* A sector is one at45db block of 8 pages, which is erased with a
+ * single block erase instead of 8 page erases */
+#define COFFEE_SECTOR_SIZE        (COFFEE_PAGE_SIZE*8)
 #define COFFEE_NAME_LENGTH        16
 
 /* These are used internally by the coffee file system */
-/* Micro logs are not needed for single page sectors */
+/* Files are not modified in place, so micro logs are not needed */
 #define COFFEE_MAX_OPEN_FILES     6
 #define COFFEE_FD_SET_SIZE        8
 #define COFFEE_LOG_TABLE_LIMIT    16
@@ -189,6 +190,22 @@ void avr_flash_write(CFS_CONF_OFFSET_TYPE addr, uint8_t *buf, CFS_CONF_OFFSET_TY
 #define COFFEE_MICRO_LOGS         0
 #define COFFEE_LOG_SIZE           128
 
+/* Erasing all obsolete blocks at once can take seconds */
+#ifndef COFFEE_GC_INCREMENTAL
+#define COFFEE_GC_INCREMENTAL     1
+#endif
+
+/* Reading a header from the flash takes a full SPI transfer, so the
+ * free pages of each sector (512 bytes) and the header pages of up to
+ * 16 files (48 bytes) are kept in RAM */
+#ifndef COFFEE_PAGE_SUMMARY
+#define COFFEE_PAGE_SUMMARY       1
+#endif
+#define COFFEE_SUMMARY_TYPE       uint8_t
+#ifndef COFFEE_NAME_INDEX
+#define COFFEE_NAME_INDEX         16
+#endif
+
 /* coffee_page_t is used for page and sector numbering
  * uint8_t can handle 511 pages.
  * cfs_offset_t is used for full byte addresses
@@ -222,7 +239,9 @@ void external_flash_erase(coffee_page_t sector);
 #ifndef COFFEE_ADDRESS
 #define COFFEE_ADDRESS            0x0
 #endif
+#ifndef COFFEE_PAGES
 #define COFFEE_PAGES              500UL
+#endif
 #define COFFEE_START              (COFFEE_ADDRESS)
 #define COFFEE_SIZE               (COFFEE_PAGES * COFFEE_PAGE_SIZE)
 
@@ -239,6 +258,10 @@ void external_flash_erase(coffee_page_t sector);
 #define COFFEE_MICRO_LOGS         0
 #define COFFEE_LOG_SIZE           128
 
+#ifndef COFFEE_GC_INCREMENTAL
+#define COFFEE_GC_INCREMENTAL     1
+#endif
+
 /* coffee_page_t is used for page and sector numbering
  * uint8_t can handle 511 pages.
  * cfs_offset_t is used for full byte addresses
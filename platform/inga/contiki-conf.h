@@ -79,9 +79,51 @@
 /* 0 will disable the Rtimer code */
 //#define RTIMER_ARCH_PRESCALER 256UL /*0, 1, 8, 64, 256, 1024 */
 
+/* MAC timer events (ctimer_set_urgent()) are queued separately and
+ * delivered before tcpip, sensor and application events. */
+#ifndef PROCESS_CONF_URGENT_NUMEVENTS
+#define PROCESS_CONF_URGENT_NUMEVENTS 8
+#endif
+
+/* Do not wake the timer, sensor and network services for every
+ * broadcast event. */
+#ifndef PROCESS_CONF_SUBSCRIPTIONS
+#define PROCESS_CONF_SUBSCRIPTIONS 1
+#endif
+
+/* Queue rtimer tasks so the RDC, the radio driver and sensor sampling can
+ * have deadlines pending at the same time. */
+#ifndef RTIMER_CONF_MULTIPLE
+#define RTIMER_CONF_MULTIPLE 1
+#endif
+
+/* Program counter histogram size for PROFILE=1 builds, 4 bytes each */
+#if INGA_CONF_SPROFILING && !defined(SPROFILES_CONF_MAX)
+#define SPROFILES_CONF_MAX 128
+#endif
+
+/* Constant time allocation for the route, neighbor and queuebuf pools. */
+#ifndef MEMB_CONF_FREELIST
+#define MEMB_CONF_FREELIST 1
+#endif
+
 /* COM port to be used for SLIP connection. */
 #define SLIP_PORT RS232_PORT_0
 
+/* Drain SLIP and stdout output from the UART interrupt instead of polling,
+ * so that debug output does not stall the radio. */
+#ifndef RS232_CONF_TX_BUFFER_SIZE
+#if INGA_CONF_WITH_SLIP
+#define RS232_CONF_TX_BUFFER_SIZE 128
+#else
+#define RS232_CONF_TX_BUFFER_SIZE 64
+#endif
+#endif
+
+/* Set to drop stdout output instead of waiting when the TX buffer is full,
+ * see rs232_stdout_dropped(). Set RS232_CONF_LOG_ID for binary log records. */
+//#define RS232_CONF_STDOUT_DROP 1
+
 /* Pre-allocated memory for loadable modules heap space (in bytes)*/
 /* Default is 4096. Currently used only when elfloader is present. Not tested on Inga */
 //#define MMEM_CONF_SIZE 256
@@ -121,11 +163,57 @@
 /* Replace lower 2 bytes of MAC with node ID  */
 #define EUI64_BY_NODE_ID          1
 
-/* 211 bytes per queue buffer */
-#define QUEUEBUF_CONF_NUM         8
+/* 211 bytes per queue buffer, two more than before the constant tables
+ * and strings of shell, sicslowpan and er-coap moved to flash (sys/pgm.h) */
+#define QUEUEBUF_CONF_NUM         10
 /* 54 bytes per queue ref buffer */
 #define QUEUEBUF_CONF_REF_NUM     2
 
+/* -- ContikiMAC profile, about 1% radio duty cycle (make CONTIKIMAC=1) */
+#if INGA_CONF_CONTIKIMAC
+#ifndef NETSTACK_CONF_MAC
+#define NETSTACK_CONF_MAC     csma_driver
+#endif
+#ifndef NETSTACK_CONF_RDC
+#define NETSTACK_CONF_RDC     contikimac_driver
+#endif
+/* Two CCAs 0.5 ms apart every 125 ms */
+#define NETSTACK_CONF_RDC_CHANNEL_CHECK_RATE 8
+/* Every strobe is one attempt with CSMA and ACK detection in the transceiver */
+#define RDC_CONF_HARDWARE_CSMA    1
+#define RDC_CONF_HARDWARE_ACK     1
+/* RX_AACK_ON drops strobes to other nodes without waking the MCU, sleep
+ * again once one of them ended */
+#define RDC_CONF_HARDWARE_FILTER  1
+#define RF230_CONF_FRAME_RETRIES  1
+#define RF230_CONF_CSMA_RETRIES   1
+/* rf230_cca() waits for the 128 us measurement itself */
+#define CONTIKIMAC_CONF_CCA_CHECK_TIME 0
+/* TRX_STATUS flags a frame from its SFD on, so give up after 1.5 ms of
+ * activity without one instead of 5 ms */
+#define CONTIKIMAC_CONF_MAX_NONACTIVITY_PERIODS 3
+/* Learn the wake-up phase from when the acknowledged strobe went on air,
+ * after the hardware CSMA backoff */
+#define CONTIKIMAC_CONF_WITH_PHASE_OPTIMIZATION 1
+unsigned short rf230_last_tx_time(void);
+#define CONTIKIMAC_CONF_TX_TIMESTAMP(t) rf230_last_tx_time()
+/* Spread unicast traffic over several channels, e.g.
+ * #define CONTIKIMAC_CONF_CHANNELS { 11, 16, 21, 26 }
+ * All nodes need the same list. Broadcasts stay on RADIO_CHANNEL. */
+void rf230_set_channel(uint8_t c);
+uint8_t rf230_get_channel(void);
+#define CONTIKIMAC_CONF_SET_CHANNEL(c)  rf230_set_channel(c)
+#define CONTIKIMAC_CONF_GET_CHANNEL()   rf230_get_channel()
+#define PHASE_CONF_DRIFT_CORRECT  1
+/* The radio interrupt must preempt the powercycle in the rtimer interrupt */
+#define RTIMER_CONF_NESTED_INTERRUPTS 1
+/* Call csma, ContikiMAC and the rf230 directly, not through the driver
+ * structs. Other drivers need NETSTACK_CONF_STATIC 0, see netstack-static.h */
+#ifndef NETSTACK_CONF_STATIC
+#define NETSTACK_CONF_STATIC      1
+#endif
+#endif /* INGA_CONF_CONTIKIMAC */
+
 /* -- Default network stack */
 
 #ifndef NETSTACK_CONF_MAC
@@ -158,6 +246,8 @@
 #define UIP_CONF_IPV6_CHECKS      1
 #define UIP_CONF_IPV6_QUEUE_PKT   1
 #define UIP_CONF_IPV6_REASSEMBLY  0
+/* Checksums in assembly, see cpu/avr/uip-chksum.c */
+#define UIP_ARCH_CHKSUM           1
 /* -- SICSLOWPAN driver settings */
 #define SICSLOWPAN_CONF_COMPRESSION SICSLOWPAN_COMPRESSION_HC06
 /* Allow 6lowpan fragments (needed for large TCP maximum segment size) */
@@ -165,6 +255,13 @@
 /* Most browsers reissue GETs after 3 seconds which stops fragment reassembly
  * so a longer MAXAGE does no good */
 #define SICSLOWPAN_CONF_MAXAGE    3
+/* Hand the fragments of a datagram to the MAC as one burst */
+#define SICSLOWPAN_CONF_FRAG_BURST 1
+/* Datagrams reassembled at the same time, each takes a UIP_BUFSIZE buffer.
+ * Raise it on nodes with several children sending fragmented packets */
+#ifndef SICSLOWPAN_CONF_REASS_CONTEXTS
+#define SICSLOWPAN_CONF_REASS_CONTEXTS 1
+#endif
 /* Request 802.15.4 ACK on all packets sent (else autoretry).
  * This is primarily for testing. */
 #define SICSLOWPAN_CONF_ACK_ALL   0
@@ -201,14 +298,83 @@
 #define RF230_CONF_AUTOACK        1
 /* Make nullrdc wait for the proper ACK before proceeding */
 #define NULLRDC_CONF_802154_AUTOACK 1
+#if !INGA_CONF_CONTIKIMAC
 /* Let the RF230 radio driver generate fake acknowledgements to make nullrdc happy */
 #define RF320_CONF_INSERTACK 1
+#endif
 /* Number of CSMA attempts 0-7. 802.15.4 2003 standard max is 5. */
+#ifndef RF230_CONF_FRAME_RETRIES
 #define RF230_CONF_FRAME_RETRIES    5
+#endif
+#if !INGA_CONF_CONTIKIMAC
+/* The driver repeats the frames and reports how many went on air, csma
+ * counts them and does not back off again on top of the radio */
+#define RF230_CONF_COUNT_FRAME_RETRIES 1
+#ifndef CSMA_CONF_HARDWARE_CSMA
+#define CSMA_CONF_HARDWARE_CSMA     1
+#endif
+#endif
 /* CCA theshold energy -91 to -61 dBm (default -77).
  * Set this smaller than the expected minimum rssi to avoid packet collisions */
 /* The Jackdaw menu 'm' command is helpful for determining the smallest ever received rssi */
 #define RF230_CONF_CCA_THRES    -85
+/* OQPSK data rate at startup, can be changed with rf230_set_data_rate().
+ * RF230_DATA_RATE_250 (default), _500, _1000 or _2000 kbit/s */
+//#define RF230_CONF_DATA_RATE    RF230_DATA_RATE_1000
+/* ContikiMAC timing follows the current data rate, frames are half as long
+ * on air per step. The CCA gap must stay shorter than the shortest frame and
+ * longer than the gap between repeated frames. */
+extern uint8_t rf230_data_rate;
+#define CONTIKIMAC_CONF_CCA_SLEEP_TIME ((RTIMER_ARCH_SECOND / 2000 >> rf230_data_rate) + 1)
+#define CONTIKIMAC_CONF_INTER_PACKET_INTERVAL (RTIMER_ARCH_SECOND / 2500 >> rf230_data_rate)
+#define CONTIKIMAC_CONF_AFTER_ACK_DETECTECT_WAIT_TIME (RTIMER_ARCH_SECOND / 1500 >> rf230_data_rate)
+/* Link layer security uses the AES engine of the RF231 */
+#ifndef AES_128_CONF
+#define AES_128_CONF rf230_aes_128_driver
+#endif
+/* The RF231 leaves SLEEP in 380 us nominally (880 us for the RF230) */
+#ifndef RF230_CONF_WAKE_DELAY
+#define RF230_CONF_WAKE_DELAY     500
+#endif
+/* With that delay the RF231 is in TRX_OFF, skip polling its state */
+#ifndef RF230_CONF_FAST_WAKE
+#define RF230_CONF_FAST_WAKE      1
+#endif
+/* Buffer bursts of frames (e.g. 6lowpan fragments) instead of dropping them */
+#ifndef RF230_CONF_RX_BUFFERS
+#define RF230_CONF_RX_BUFFERS     3
+#endif
+/* Pass received frames to the MAC without copying them to packetbuf */
+#ifndef RF230_CONF_RX_ZEROCOPY
+#define RF230_CONF_RX_ZEROCOPY    1
+#endif
+/* Carry the network time in every frame and synchronize to it, see
+ * timesynch.h. The node with the time source sets authority level 0.
+ * All nodes need the same setting, the frames get a 3 byte trailer. */
+#ifndef RF230_CONF_TIMESTAMPS
+#define RF230_CONF_TIMESTAMPS     0
+#endif
+#if RF230_CONF_TIMESTAMPS
+#define TIMESYNCH_CONF_ENABLED    1
+#define TIMESYNCH_CONF_PIGGYBACK  1
+#endif
+/* Seed the ETX of new neighbors from the RSSI, which the RF230 reports
+ * in dB above its sensitivity */
+#ifndef LINK_STATS_CONF_INIT_ETX_FROM_RSSI
+#define LINK_STATS_CONF_INIT_ETX_FROM_RSSI 1
+#endif
+#ifndef LINK_STATS_CONF_RSSI_HIGH
+#define LINK_STATS_CONF_RSSI_HIGH 30
+#endif
+#ifndef LINK_STATS_CONF_RSSI_LOW
+#define LINK_STATS_CONF_RSSI_LOW  3
+#endif
+/* Per-neighbor TX power, one RF230 power step is 0.5-5 dB. Keep 13 dB
+ * above the sensitivity and reduce from 3 dBm at most to -9 dBm.
+ * #define LINK_STATS_CONF_TXPOWER 1 */
+#ifndef LINK_STATS_CONF_TXPOWER_STEPS
+#define LINK_STATS_CONF_TXPOWER_STEPS 13
+#endif
 
 /* -- UIP settings */
 #define UIP_CONF_UDP              1
@@ -231,9 +397,21 @@
 /* 2 bytes per TCP listening port */
 #define UIP_CONF_MAX_LISTENPORTS  1
 
+/* httpd-cfs reads files into the uip buffer instead of an MSS sized
+   buffer per connection */
+#ifndef WEBSERVER_CONF_CFS_SENDFILE
+#define WEBSERVER_CONF_CFS_SENDFILE 1
+#endif
+
 /* 25 bytes per UDP connection */
 #define UIP_CONF_UDP_CONNS        10
 
+/* Query names in use again 30 s before their record expires, a lookup
+   over 6LoWPAN takes seconds */
+#ifndef RESOLV_CONF_REFRESH_TIME
+#define RESOLV_CONF_REFRESH_TIME  30
+#endif
+
 #define UIP_CONF_IP_FORWARD       0
 #define UIP_CONF_FWCACHE_SIZE     0
 
@@ -304,6 +482,13 @@
  */
 
 #define UIP_CONF_ROUTER                 1
+#define SICSLOWPAN_CONF_FAST_FORWARD    1
+/* Compress addresses of the DAG prefix with context 15. The border
+ * router must know the context as well, see rpl-private.h */
+#define SICSLOWPAN_CONF_DYNAMIC_CONTEXTS 1
+#define RPL_CONF_PREFIX_CONTEXT         15
+/* Carry these UDP ports in 4 bits, the map must match network wide */
+//#define SICSLOWPAN_CONF_UDP_PORT_MAP    { 5683 }
 #define UIP_CONF_ND6_SEND_RA            0
 #define UIP_CONF_ND6_REACHABLE_TIME     600000
 #define UIP_CONF_ND6_RETRANS_TIMER      10000
@@ -51,6 +51,22 @@
 #define PRINTA(...)
 #endif
 
+/* If defined 1, prints the time spent in each boot step.
+ * Defaults to ANNOUNCE_BOOT.
+ */
+#ifndef INGA_CONF_BOOT_PROFILE
+#define INGA_BOOT_PROFILE ANNOUNCE_BOOT
+#else
+#define INGA_BOOT_PROFILE INGA_CONF_BOOT_PROFILE
+#endif
+
+/* Delay before the boot screen is printed [ms], gives a chance to see it. */
+#ifndef INGA_CONF_BOOT_DELAY
+#define INGA_BOOT_DELAY 200
+#else
+#define INGA_BOOT_DELAY INGA_CONF_BOOT_DELAY
+#endif
+
 /* If defined 1, prints debug infos. */
 #ifndef DEBUG
 #define DEBUG 0
@@ -71,6 +87,7 @@ uint8_t debugflowsize, debugflow[DEBUGFLOWSIZE];
 #endif
 
 #include <avr/io.h>
+#include <avr/pgmspace.h>
 #include <util/delay.h>
 #include <stdio.h>
 #include <stdbool.h>
@@ -109,6 +126,18 @@ uint8_t debugflowsize, debugflow[DEBUGFLOWSIZE];
 #include "contiki-net.h"
 #include "contiki-lib.h"
 #include "sys/node-id.h"
+#include "stack-arch.h"
+#include "isr-stats.h"
+#include "cfs/fat/fat_coop.h"
+#include "fat-coop-arch.h"
+#if INGA_CONF_SPROFILING
+#include "sys/sprofiling.h"
+#endif
+#if INGA_TICKLESS_IDLE
+#include <avr/sleep.h>
+#include "dev/clock-avr.h"
+#include "adc.h"
+#endif
 
 #include "dev/rs232.h"
 #include "dev/serial-line.h"
@@ -179,6 +208,13 @@ void uip_debug_lladdr_print(const uip_lladdr_t *addr);
 #endif
 
 
+/** Interval of the profile dumps [seconds] when built with PROFILE=1 */
+#ifndef INGA_CONF_SPROFILING_INTERVAL
+#define INGA_SPROFILING_INTERVAL 30
+#else
+#define INGA_SPROFILING_INTERVAL INGA_CONF_SPROFILING_INTERVAL
+#endif
+
 #ifndef USART_BAUD_INGA
 #define USART_BAUD_INGA USART_BAUD_19200
 #endif
@@ -246,6 +282,53 @@ uip_log(char *msg)
   printf("%s\n", msg);
 }
 /*----------------------------------------------------------------------------*/
+#if INGA_BOOT_PROFILE
+#define BOOT_STEPS_MAX 10
+
+/* Boot steps and the rtimer time they ended at. The rtimer is started
+ * first in init(), so the first step starts at 0. */
+static struct {
+  PGM_P name;
+  rtimer_clock_t end;
+} boot_steps[BOOT_STEPS_MAX];
+static uint8_t boot_step_count;
+
+#define BOOT_STEP(name) boot_step(PSTR(name))
+
+static void
+boot_step(PGM_P name)
+{
+  if (boot_step_count < BOOT_STEPS_MAX) {
+    boot_steps[boot_step_count].name = name;
+    boot_steps[boot_step_count].end = RTIMER_NOW();
+    boot_step_count++;
+  }
+}
+/*----------------------------------------------------------------------------*/
+static uint16_t
+ticks_to_ms(rtimer_clock_t ticks)
+{
+  return ((uint32_t) ticks * 1000UL) / RTIMER_SECOND;
+}
+/*----------------------------------------------------------------------------*/
+static void
+boot_profile_print(void)
+{
+  rtimer_clock_t start = 0;
+  uint8_t i;
+
+  printf_P(PSTR("Boot profile [ms]:\n"));
+  for (i = 0; i < boot_step_count; i++) {
+    printf_P(PSTR("  %S: %u\n"), boot_steps[i].name,
+        ticks_to_ms(boot_steps[i].end - start));
+    start = boot_steps[i].end;
+  }
+  printf_P(PSTR("  total: %u\n"), ticks_to_ms(start));
+}
+#else /* INGA_BOOT_PROFILE */
+#define BOOT_STEP(name)
+#endif /* INGA_BOOT_PROFILE */
+/*----------------------------------------------------------------------------*/
 // config variables, preset with default values
 uint8_t radio_tx_power = RADIO_TX_POWER;
 uint8_t radio_channel = RADIO_CHANNEL;
@@ -391,6 +474,10 @@ platform_radio_init(void)
   NETSTACK_MAC.init();
   NETSTACK_NETWORK.init();
 
+#if TIMESYNCH_CONF_ENABLED
+  timesynch_init();
+#endif /* TIMESYNCH_CONF_ENABLED */
+
   PRINTA("Netstack info:\n");
   PRINTA("  NET: %s\n  MAC: %s\n  RDC: %s\n",
       NETSTACK_NETWORK.name,
@@ -427,13 +514,21 @@ init(void)
   watchdog_init();
   watchdog_start();
 
+  /* rtimers needed for radio cycling, started first to time the boot */
+  rtimer_init();
+  isr_stats_init();
+
   /* Second rs232 port for debugging */
   rs232_init(RS232_PORT_0, USART_BAUD_INGA, USART_PARITY_NONE | USART_STOP_BITS_1 | USART_DATA_BITS_8);
   /* Redirect stdout to second port */
   rs232_redirect_stdout(RS232_PORT_0);
+  BOOT_STEP("serial");
 
+#if INGA_BOOT_DELAY
   /* wait here to get a chance to see boot screen. */
-  _delay_ms(200);
+  _delay_ms(INGA_BOOT_DELAY);
+  BOOT_STEP("delay");
+#endif
 
   PRINTA("\n*******Booting %s*******\nReset reason: ", CONTIKI_VERSION_STRING);
   /* Print out reset reason */
@@ -452,22 +547,12 @@ init(void)
     PRINTA("Watchdog possibly occured at address %p\n", wdt_addr);
 
   clock_init();
+  BOOT_STEP("clock");
 
-#if STACKMONITOR
-#define STACK_FREE_MARK 0x4242
-  /* Simple stack pointer highwater monitor.
-   * Places magic numbers in free RAM that are checked in the main loop.
-   * In conjuction with PERIODICPRINTS, never-used stack will be printed
-   * every STACKMONITOR seconds.
-   */
-  {
-    extern uint16_t __bss_end;
-    uint16_t p = (uint16_t) & __bss_end;
-    do {
-      *(uint16_t *) p = STACK_FREE_MARK;
-      p += 10;
-    } while (p < SP - 10); //don't overwrite our own stack
-  }
+#if INGA_CONF_SPROFILING
+  /* Samples share Timer2 with the clock, so start after clock_init() */
+  sprofiling_init();
+  sprofiling_start();
 #endif
 
   /* Get a random (or probably different) seed for the 802.15.4 packet sequence number.
@@ -481,15 +566,13 @@ init(void)
 
   /* Flash initialization */
   at45db_init();
+  BOOT_STEP("flash");
 
 #ifdef MICRO_SD_PWR_PIN
   /* set pin for micro sd card power switch to output */
   MICRO_SD_PWR_PORT_DDR |= (1 << MICRO_SD_PWR_PIN);
 #endif
 
-  /* rtimers needed for radio cycling */
-  rtimer_init();
-
   /* Initialize process subsystem */
   process_init();
 
@@ -506,9 +589,12 @@ init(void)
   process_start(&settings_delete_process, NULL);
 #endif    
 
+  BOOT_STEP("kernel");
+
 #if PLATFORM_RADIO
   // Init radio
   platform_radio_init();
+  BOOT_STEP("radio");
 #endif
 
   //--- Set Rime address based on eui64
@@ -549,10 +635,28 @@ init(void)
   PRINTA("\n");
 
 #endif /* UIP_CONF_IPV6 */
+  BOOT_STEP("network");
 
   PRINTA("******* Online *******\n\n");
 }
 
+/*---------------------------------------------------------------------------*/
+#if INGA_CONF_SPROFILING
+/* Sends the sampled profile and starts a new one */
+static void
+sprofiling_dump(void)
+{
+  static unsigned long last;
+
+  if(clock_seconds() - last >= INGA_SPROFILING_INTERVAL) {
+    last = clock_seconds();
+    sprofiling_stop();
+    sprofiling_report_binary();
+    sprofiling_reset();
+    sprofiling_start();
+  }
+}
+#endif /* INGA_CONF_SPROFILING */
 /*---------------------------------------------------------------------------*/
 #if PERIODICPRINTS
 static void
@@ -653,17 +757,10 @@ periodic_prints()
 #endif /* PER_ROUTES */
 
 #if STACKMONITOR
-    /* Checks for highest address with STACK_FREE_MARKs in RAM */
+    /* RAM is painted by the startup code, see stack-arch.c */
     if ((clocktime % STACKMONITOR) == 3) {
-      extern uint16_t __bss_end;
-      uint16_t p = (uint16_t) & __bss_end;
-      do {
-        if (*(uint16_t *) p != STACK_FREE_MARK) {
-          PRINTF("Never-used stack > %d bytes\n", p - (uint16_t) & __bss_end);
-          break;
-        }
-        p += 10;
-      } while (p < RAMEND - 10);
+      PRINTF("Never-used stack > %u of %u bytes, fat coop %d\n",
+          stack_arch_unused(), stack_arch_size(), calc_free_stack());
     }
 #endif /* STACKMONITOR */
   }
@@ -673,6 +770,46 @@ periodic_prints()
 /*------------------------- Main Scheduler loop----------------------------*/
 /*-------------------------------------------------------------------------*/
 
+#if INGA_TICKLESS_IDLE
+/*-------------------------------------------------------------------------*/
+/* Sleeps until the next etimer expires or an interrupt occurs. */
+extern uint8_t RF230_receive_on;
+
+static void
+idle(void)
+{
+  clock_time_t now, next, ticks = CLOCK_IDLE_MAX;
+
+  /* These interrupts do not wake the MCU from power-save */
+  if (RF230_receive_on || (TIMSK3 & _BV(OCIE3A)) || adc_scan_running()) {
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    cli();
+    if (process_nevents() == 0) {
+      sleep_enable();
+      sei();
+      sleep_cpu();
+      sleep_disable();
+    }
+    sei();
+    return;
+  }
+
+  if (etimer_pending()) {
+    now = clock_time();
+    next = etimer_next_expiration_time();
+    if ((clock_time_t) (next - now) > (clock_time_t) -1 / 2) {
+      /* already due, the etimer process will be polled on the next tick */
+      return;
+    }
+    if (next - now < ticks) {
+      ticks = next - now;
+    }
+  }
+
+  clock_idle(ticks);
+}
+#endif /* INGA_TICKLESS_IDLE */
+/*-------------------------------------------------------------------------*/
 // setup sensors
 SENSORS(&button_sensor, &acc_sensor, &gyro_sensor, &pressure_sensor, &battery_sensor);
 
@@ -682,11 +819,22 @@ main(void)
   init();
   /* Start sensor init process */
   process_start(&sensors_process, NULL);
+  BOOT_STEP("sensors");
   /* Autostart other processes */
   autostart_start(autostart_processes);
+  BOOT_STEP("autostart");
+#if INGA_BOOT_PROFILE
+  boot_profile_print();
+#endif
 
   while (1) {
+#if INGA_TICKLESS_IDLE
+    if (process_run() == 0) {
+      idle();
+    }
+#else
     process_run();
+#endif
     watchdog_periodic();
 
 #if DEBUGFLOWSIZE
@@ -703,6 +851,10 @@ main(void)
     periodic_prints();
 #endif /* PERIODICPRINTS */
 
+#if INGA_CONF_SPROFILING
+    sprofiling_dump();
+#endif
+
   }
   return 0;
 }
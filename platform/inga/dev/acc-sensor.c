@@ -36,21 +36,54 @@
  *      Enrico Jörns <e.joerns@tu-bs.de>
  */
 
+#include "contiki.h"
 #include "contiki.h"
 #include "lib/sensors.h"
 #include "adxl345.h"
 #include "acc-sensor.h"
 #include <stdbool.h>
+#include <avr/interrupt.h>
 
 #define FALSE 0
 #define TRUE  1
 
+/* ADXL345 INT1 pin, a pin change interrupt. May be overridden as a whole. */
+#ifndef ACC_INT_vect
+#define ACC_INT_vect      PCINT1_vect
+#define ACC_INT_PCMSK     PCMSK1
+#define ACC_INT_PCIE      PCIE1
+#define ACC_INT_DDR       DDRB
+#define ACC_INT_PIN       PINB
+#define ACC_INT_P         PB1
+#endif
+
+#define ACC_STREAM_MASK   (ACC_STREAM_CONF_SIZE - 1)
+
+PROCESS(acc_int_process, "Acc interrupt");
+
 const struct sensors_sensor acc_sensor;
 bool interrupt_mode = false; // TODO: needed for possible later implementations with interrupts/events
+#if INGA_LAZY_SENSORS
+/* Not probed yet */
+#define READY_UNKNOWN 0xff
+static uint8_t ready = READY_UNKNOWN;
+#else
 static uint8_t ready = 0;
+#endif
 static bool acc_active = false;
 static acc_data_t acc_data;
 
+static acc_data_t stream_buf[ACC_STREAM_CONF_SIZE];
+/* 8-bit indices, written by a single process each */
+static uint8_t stream_put, stream_get;
+static uint16_t stream_dropped;
+static uint8_t stream_active;
+
+/* activity threshold, 0 if motion detection is off */
+static uint8_t motion_thresh;
+static uint8_t motion_time = ACC_MOTION_CONF_TIME;
+static uint8_t motion;
+
 typedef struct {
   uint8_t active;
 } acc_sensor_t;
@@ -73,38 +106,185 @@ cond_update_acc_data(int ch)
   acc_data_obsolete_vec |= (1 << ch);
 }
 /*---------------------------------------------------------------------------*/
+ISR(ACC_INT_vect)
+{
+  if (ACC_INT_PIN & (1 << ACC_INT_P)) {
+    process_poll(&acc_int_process);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+stream_drain(void)
+{
+  uint8_t level = adxl345_read(ADXL345_FIFO_STATUS_REG) & 0x3F;
+
+  while (level--) {
+    if (((stream_put + 1) & ACC_STREAM_MASK) == stream_get) {
+      /* still pop the entry to clear the watermark */
+      adxl345_get();
+      stream_dropped++;
+      continue;
+    }
+    stream_buf[stream_put] = adxl345_get();
+    stream_put = (stream_put + 1) & ACC_STREAM_MASK;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+motion_check(void)
+{
+  uint8_t source = adxl345_get_int_source();
+
+  /* link mode alternates both, activity is the safe guess if both are set */
+  if (source & (1 << ADXL345_ACTIVITY)) {
+    motion = 1;
+  } else if (source & (1 << ADXL345_INACTIVITY)) {
+    motion = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(acc_int_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while (1) {
+    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
+    if (motion_thresh) {
+      motion_check();
+    }
+    if (stream_active) {
+      stream_drain();
+    }
+    sensors_changed(&acc_sensor);
+    /* new samples may have crossed the watermark during the readout */
+    if (ACC_INT_PIN & (1 << ACC_INT_P)) {
+      process_poll(&acc_int_process);
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+static void
+int_enable(void)
+{
+  if (!process_is_running(&acc_int_process)) {
+    process_start(&acc_int_process, NULL);
+  }
+  ACC_INT_DDR &= ~(1 << ACC_INT_P);
+  ACC_INT_PCMSK |= (1 << ACC_INT_P);
+  PCICR |= (1 << ACC_INT_PCIE);
+  /* INT1 may already be high */
+  process_poll(&acc_int_process);
+}
+/*---------------------------------------------------------------------------*/
+static void
+int_disable(void)
+{
+  if (!stream_active && !motion_thresh) {
+    ACC_INT_PCMSK &= ~(1 << ACC_INT_P);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+stream_start(uint8_t watermark)
+{
+  stream_put = stream_get = 0;
+  stream_dropped = 0;
+  stream_active = 1;
+  adxl345_set_fifomode(ADXL345_MODE_STREAM);
+  adxl345_set_watermark_int(watermark);
+  int_enable();
+}
+/*---------------------------------------------------------------------------*/
+static void
+stream_stop(void)
+{
+  stream_active = 0;
+  int_disable();
+  adxl345_set_watermark_int(0);
+  adxl345_set_fifomode(ADXL345_MODE_BYPASS);
+}
+/*---------------------------------------------------------------------------*/
+static void
+motion_start(int mg)
+{
+  /* 62.5 mg/LSB, rounded up */
+  long thresh = ((long)mg * 2 + 124) / 125;
+
+  motion_thresh = thresh > 0xFF ? 0xFF : thresh;
+  motion = 0;
+  /* same threshold for both, link mode turns it into a hysteresis */
+  adxl345_set_motion_int(motion_thresh, motion_thresh, motion_time);
+  int_enable();
+}
+/*---------------------------------------------------------------------------*/
+static void
+motion_stop(void)
+{
+  motion_thresh = 0;
+  motion = 0;
+  int_disable();
+  adxl345_set_motion_int(0, 0, 0);
+}
+/*---------------------------------------------------------------------------*/
+int
+acc_sensor_stream_get(acc_data_t *sample)
+{
+  if (stream_get == stream_put) {
+    return 0;
+  }
+  *sample = stream_buf[stream_get];
+  stream_get = (stream_get + 1) & ACC_STREAM_MASK;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
 static int
-value(int type)
+convert(const acc_data_t *data, int type)
 {
   switch (type) {
     case ACC_X_RAW:
-      cond_update_acc_data(ACC_X_RAW);
-      return acc_data.x;
-
+      return data->x;
     case ACC_Y_RAW:
-      cond_update_acc_data(ACC_Y_RAW);
-      return acc_data.y;
-
+      return data->y;
     case ACC_Z_RAW:
-      cond_update_acc_data(ACC_Z_RAW);
-      return acc_data.z;
-
+      return data->z;
     case ACC_X:
-      cond_update_acc_data(ACC_X);
-      return adxl345_raw_to_mg(acc_data.x);
-
+      return adxl345_raw_to_mg(data->x);
     case ACC_Y:
-      cond_update_acc_data(ACC_Y);
-      return adxl345_raw_to_mg(acc_data.y);
-
+      return adxl345_raw_to_mg(data->y);
     case ACC_Z:
-      cond_update_acc_data(ACC_Z);
-      return adxl345_raw_to_mg(acc_data.z);
+      return adxl345_raw_to_mg(data->z);
   }
   return 0;
 }
 /*---------------------------------------------------------------------------*/
 static int
+value(int type)
+{
+  if (type < ACC_X || type > ACC_Z_RAW) {
+    return 0;
+  }
+  cond_update_acc_data(type);
+  return convert(&acc_data, type);
+}
+/*---------------------------------------------------------------------------*/
+static int
+read_block(unsigned type_mask, int16_t *out)
+{
+  acc_data_t data = adxl345_get();
+  int type;
+  int n = 0;
+
+  for (type = 0; type < 16; type++) {
+    if (type_mask & (1U << type)) {
+      out[n++] = convert(&data, type);
+    }
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+static int
 status(int type)
 {
   switch (type) {
@@ -112,11 +292,25 @@ status(int type)
       return acc_active; // TODO: do check
       break;
     case SENSORS_READY:
+#if INGA_LAZY_SENSORS
+      if (ready == READY_UNKNOWN) {
+        ready = adxl345_available();
+      }
+#endif
       return ready;
       break;
     case ACC_STATUS_BUFFER_LEVEL:
       return adxl345_get_fifo_level();
       break;
+    case ACC_STATUS_STREAM_LEVEL:
+      return (stream_put - stream_get) & ACC_STREAM_MASK;
+      break;
+    case ACC_STATUS_STREAM_DROPPED:
+      return stream_dropped;
+      break;
+    case ACC_STATUS_MOTION:
+      return motion;
+      break;
   }
   return 0;
 }
@@ -128,6 +322,10 @@ configure(int type, int c)
   switch (type) {
 
     case SENSORS_HW_INIT:
+#if INGA_LAZY_SENSORS
+      ready = READY_UNKNOWN;
+      return 1;
+#else
       if (adxl345_available()) {
         ready = 1;
         return 1;
@@ -135,11 +333,17 @@ configure(int type, int c)
         ready = 0;
         return 0;
       }
+#endif
       break;
 
     case SENSORS_ACTIVE:
       if (c) {
-        return acc_active = (adxl345_init() == 0) ? 1 : 0;
+        acc_active = (adxl345_init() == 0) ? 1 : 0;
+#if INGA_LAZY_SENSORS
+        /* adxl345_init() probes the device */
+        ready = acc_active;
+#endif
+        return acc_active;
       } else {
         adxl345_deinit();
         return 1;
@@ -190,8 +394,23 @@ configure(int type, int c)
       break;
 
     case ACC_CONF_POWERMODE:
-      // TODO: implementation needed
-      return 0;
+      switch (c) {
+        case ACC_NOSLEEP:
+          value = ADXL345_PMODE_WAKEUP;
+          break;
+        case ACC_AUTOSLEEP:
+          /* needs inactivity detection, see ACC_CONF_MOTION */
+          if (!motion_thresh) {
+            return 0;
+          }
+          value = ADXL345_PMODE_AUTOSLEEP;
+          break;
+        default:
+          return 0;
+          break;
+      }
+      adxl345_set_powermode(value);
+      return 1;
       break;
 
     case ACC_CONF_DATA_RATE:
@@ -234,8 +453,43 @@ configure(int type, int c)
       return 1;
       break;
 
+    case ACC_CONF_STREAM:
+      if (c < 0 || c > 31) {
+        return 0;
+      }
+      if (c) {
+        stream_start(c);
+      } else {
+        stream_stop();
+      }
+      return 1;
+      break;
+
+    case ACC_CONF_MOTION:
+      if (c < 0 || c > 16000) {
+        return 0;
+      }
+      if (c) {
+        motion_start(c);
+      } else {
+        motion_stop();
+      }
+      return 1;
+      break;
+
+    case ACC_CONF_MOTION_TIME:
+      if (c < 1 || c > 255) {
+        return 0;
+      }
+      motion_time = c;
+      if (motion_thresh) {
+        adxl345_set_motion_int(motion_thresh, motion_thresh, motion_time);
+      }
+      return 1;
+      break;
+
   }
   return 0;
 }
 /*---------------------------------------------------------------------------*/
-SENSORS_SENSOR(acc_sensor, ACC_SENSOR, value, configure, status);
+SENSORS_SENSOR_BLOCK(acc_sensor, ACC_SENSOR, value, configure, status, read_block);
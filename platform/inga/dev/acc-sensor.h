@@ -62,6 +62,8 @@
  * The sensor interface allows to configure:
  * - Sensitivity (\ref ACC_CONF_SENSITIVITY)
  * - Data rate (\ref ACC_CONF_DATA_RATE)
+ * - Streaming (\ref ACC_CONF_STREAM)
+ * - Motion detection (\ref ACC_CONF_MOTION)
  *
  * Details of the different configurations are given in
  * the documentation of respective config.
@@ -102,9 +104,30 @@ int z = accsensor.value(ACC_Z);
 #define __ADXL345_SENSOR_H__
 
 #include "lib/sensors.h"
+#include "adxl345.h"
+
+/**
+ * Size of the stream sample buffer in samples, must be a power of two
+ * not larger than 128.
+ */
+#ifndef ACC_STREAM_CONF_SIZE
+#define ACC_STREAM_CONF_SIZE  64
+#endif
+
+/** Default time without motion until inactivity [s] */
+#ifndef ACC_MOTION_CONF_TIME
+#define ACC_MOTION_CONF_TIME  5
+#endif
 
 extern const struct sensors_sensor acc_sensor;
 
+/**
+ * Takes the oldest sample from the stream sample buffer.
+ * @param sample Sample storage
+ * @return 1 if a sample was taken, 0 if the buffer is empty
+ */
+int acc_sensor_stream_get(acc_data_t *sample);
+
 #define ACC_SENSOR "Acc"
 
 /**
@@ -163,6 +186,34 @@ extern const struct sensors_sensor acc_sensor;
  * 
  */
 #define ACC_CONF_DATA_RATE           40
+/**
+ * Streaming mode.
+ *
+ * A value of 1 to 31 sets the FIFO to stream mode with this watermark.
+ * Whenever the watermark is exceeded, the INT1 interrupt triggers a
+ * readout of the whole FIFO into the sample buffer, followed by a
+ * sensors event. Samples are taken with acc_sensor_stream_get().
+ * A value of 0 stops streaming and sets bypass mode.
+ */
+#define ACC_CONF_STREAM              60
+/**
+ * Motion detection (wake-on-motion).
+ *
+ * A value of 1 to 16000 enables activity and inactivity detection with
+ * this threshold in mg. Each change is reported via INT1 as a sensors
+ * event and can be read from \ref ACC_STATUS_MOTION, so the
+ * application can sleep until motion and start \ref ACC_CONF_STREAM
+ * only then. A value of 0 disables motion detection.
+ *
+ * With motion detection enabled, \ref ACC_CONF_POWERMODE
+ * \ref ACC_AUTOSLEEP lets the sensor sample at 8 Hz while inactive.
+ */
+#define ACC_CONF_MOTION              80
+/**
+ * Time without motion until inactivity is reported [1 - 255 s].
+ * Default: \ref ACC_MOTION_CONF_TIME
+ */
+#define ACC_CONF_MOTION_TIME         81
 /** @} */
 
 /**
@@ -176,6 +227,12 @@ extern const struct sensors_sensor acc_sensor;
  * two readouts or to adapt readout rate.
  */
 #define ACC_STATUS_BUFFER_LEVEL     50
+/** Number of samples in the stream sample buffer */
+#define ACC_STATUS_STREAM_LEVEL     70
+/** Number of samples dropped because the stream sample buffer was full */
+#define ACC_STATUS_STREAM_DROPPED   71
+/** 1 after activity, 0 after inactivity (see \ref ACC_CONF_MOTION) */
+#define ACC_STATUS_MOTION           72
 /** @} */
 
 
@@ -45,10 +45,39 @@
  */
 
 
+#include <avr/interrupt.h>
 #include "adc.h"
+#include "sys/energest.h"
+
+process_event_t adc_scan_event;
+
+PROCESS(adc_scan_process, "ADC scan");
+
+static struct {
+  uint8_t channels[ADC_SCAN_MAX_CHANNELS];
+  uint16_t latest[ADC_SCAN_MAX_CHANNELS];
+  uint8_t n;
+  /* position in the channel list of the running conversion */
+  uint8_t pos;
+  /* buffer being filled */
+  uint8_t fill;
+  /* full buffer waiting for delivery, 0xFF if none */
+  volatile uint8_t ready;
+  volatile uint8_t running;
+  uint16_t idx;
+  uint16_t limit;
+  volatile uint16_t dropped;
+  struct process *process;
+} scan;
+
+static uint16_t scan_buf[2][ADC_SCAN_CONF_BLOCK_SIZE];
+static struct adc_scan_block scan_block;
+/*----------------------------------------------------------------------------*/
 void
 adc_init(uint8_t mode, uint8_t ref)
 {
+  /* counted until adc_deinit(), the enabled ADC draws current even idle */
+  ENERGEST_SWITCH_ON(ENERGEST_TYPE_ADC);
   ADCSRA = ((ADC_ENABLE) | (ADC_PRESCALE_64));
   ADCSRB = 0x00;
   ADMUX = ref;
@@ -101,5 +130,159 @@ adc_deinit(void)
   ADCSRA = ADC_STOP;
   ADCSRB = ADC_STOP;
   ADMUX = ADC_STOP;
+  ENERGEST_OFF(ENERGEST_TYPE_ADC);
+}
+/*----------------------------------------------------------------------------*/
+ISR(ADC_vect)
+{
+  uint16_t value = ADCW;
+
+  /* re-arm the trigger, the ADC starts on a rising compare flag */
+  TIFR0 = (1 << OCF0A);
+
+  scan.latest[scan.pos] = value;
+  scan_buf[scan.fill][scan.idx++] = value;
+  if (++scan.pos == scan.n) {
+    scan.pos = 0;
+  }
+  ADMUX = (ADMUX & 0xE0) | scan.channels[scan.pos];
+
+  if (scan.idx == scan.limit) {
+    if (scan.ready == 0xFF) {
+      scan.ready = scan.fill;
+      scan.fill ^= 1;
+      process_poll(&adc_scan_process);
+    } else {
+      /* previous block not yet delivered, overwrite the current one */
+      scan.dropped++;
+    }
+    scan.idx = 0;
+  }
+}
+/*----------------------------------------------------------------------------*/
+PROCESS_THREAD(adc_scan_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while (1) {
+    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
+    if (scan.ready == 0xFF) {
+      continue;
+    }
+    scan_block.samples = scan_buf[scan.ready];
+    scan_block.count = scan.limit;
+    ADCSRA &= ~ADC_INTERRUPT_ENABLE;
+    scan_block.dropped = scan.dropped;
+    scan.dropped = 0;
+    if (scan.running) {
+      ADCSRA |= ADC_INTERRUPT_ENABLE;
+    }
+    if (scan.process != NULL) {
+      process_post_synch(scan.process, adc_scan_event, &scan_block);
+    }
+    scan.ready = 0xFF;
+  }
+
+  PROCESS_END();
+}
+/*----------------------------------------------------------------------------*/
+int8_t
+adc_scan_start(const uint8_t *channels, uint8_t n, uint8_t ref,
+        uint16_t rate, struct process *p)
+{
+  static const uint16_t prescaler[] = {8, 64, 256, 1024};
+  uint32_t top = 0;
+  uint8_t i;
+
+  if (n == 0 || n > ADC_SCAN_MAX_CHANNELS || n > ADC_SCAN_CONF_BLOCK_SIZE
+          || rate == 0) {
+    return -1;
+  }
+  for (i = 0; i < 4; i++) {
+    top = F_CPU / prescaler[i] / rate;
+    if (top <= 256) {
+      break;
+    }
+  }
+  if (i == 4 || top < 2) {
+    return -1;
+  }
+
+  adc_scan_stop();
+
+  if (adc_scan_event == 0) {
+    adc_scan_event = process_alloc_event();
+  }
+  if (!process_is_running(&adc_scan_process)) {
+    process_start(&adc_scan_process, NULL);
+  }
+
+  for (scan.n = 0; scan.n < n; scan.n++) {
+    scan.channels[scan.n] = channels[scan.n];
+    scan.latest[scan.n] = 0;
+    if (channels[scan.n] < 8) {
+      DIDR0 |= (1 << channels[scan.n]);
+    }
+  }
+  scan.pos = 0;
+  scan.fill = 0;
+  scan.idx = 0;
+  scan.ready = 0xFF;
+  scan.dropped = 0;
+  /* whole scans per block */
+  scan.limit = (ADC_SCAN_CONF_BLOCK_SIZE / n) * n;
+  scan.process = p;
+  scan.running = 1;
+
+  adc_init(ADC_TIMER0_COMP_FLAG, ref);
+  ADMUX = (ADMUX & 0xE0) | scan.channels[0];
+
+  /* Timer0 in CTC mode, compare match A is the trigger */
+  TCCR0B = 0;
+  TCNT0 = 0;
+  OCR0A = top - 1;
+  TCCR0A = (1 << WGM01);
+  TIFR0 = (1 << OCF0A);
+  /* CS0 = 2, 3, 4, 5 for the prescalers 8 to 1024 */
+  TCCR0B = i + 2;
+
+  return 0;
+}
+/*----------------------------------------------------------------------------*/
+void
+adc_scan_stop(void)
+{
+  if (!scan.running) {
+    return;
+  }
+  scan.running = 0;
+  TCCR0B = 0;
+  adc_deinit();
+  scan.ready = 0xFF;
+}
+/*----------------------------------------------------------------------------*/
+uint8_t
+adc_scan_running(void)
+{
+  return scan.running;
+}
+/*----------------------------------------------------------------------------*/
+int16_t
+adc_scan_latest(uint8_t mux)
+{
+  uint8_t i;
+  uint16_t value;
+
+  for (i = 0; i < scan.n; i++) {
+    if (scan.channels[i] == mux) {
+      ADCSRA &= ~ADC_INTERRUPT_ENABLE;
+      value = scan.latest[i];
+      if (scan.running) {
+        ADCSRA |= ADC_INTERRUPT_ENABLE;
+      }
+      return value;
+    }
+  }
+  return -1;
 }
 /*----------------------------------------------------------------------------*/
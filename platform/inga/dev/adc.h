@@ -77,6 +77,7 @@
 #define ADCCTR_H_
 
 #include <avr/io.h>
+#include "contiki.h"
 
 
 /********************************************************************
@@ -279,6 +280,79 @@ void adc_set_mux(uint8_t mux);
  */
 void adc_deinit(void);
 
+/**
+ * Number of samples in each of the two scan buffers.
+ */
+#ifndef ADC_SCAN_CONF_BLOCK_SIZE
+#define ADC_SCAN_CONF_BLOCK_SIZE  64
+#endif
+
+/**
+ * Maximum number of channels in a scan list.
+ */
+#define ADC_SCAN_MAX_CHANNELS     8
+
+/**
+ * \brief A block of scan samples, passed as data of \ref adc_scan_event.
+ *
+ * Samples are interleaved in scan list order, each block starts with
+ * the first channel of the list.
+ */
+struct adc_scan_block {
+  uint16_t *samples;
+  /** Number of valid samples, a multiple of the number of channels */
+  uint16_t count;
+  /** Number of blocks that were dropped before this one */
+  uint16_t dropped;
+};
+
+/**
+ * Event posted to the scan process when a block is full.
+ * The block stays valid until the process returns from the event
+ * handler, the other buffer is filled meanwhile.
+ */
+extern process_event_t adc_scan_event;
+
+/**
+ * \brief      Starts a timer triggered scan over a list of channels
+ *
+ * Timer0 triggers one conversion per period, the ADC interrupt
+ * stores the result and switches to the next channel of the list.
+ * Each channel is thus sampled with rate / n.
+ *
+ * \param channels ADC multiplexer values, see \ref adc_set_mux
+ * \param n        Number of channels, at most \ref ADC_SCAN_MAX_CHANNELS
+ * \param ref      The ADC reference voltage source
+ * \param rate     Conversion rate in Hz (all channels), 31 to 9000
+ * \param p        Process receiving \ref adc_scan_event
+ * \retval 0       scan started
+ * \retval -1      invalid parameters
+ */
+int8_t adc_scan_start(const uint8_t *channels, uint8_t n, uint8_t ref,
+        uint16_t rate, struct process *p);
+
+/**
+ * \brief      Stops a running scan and the ADC
+ */
+void adc_scan_stop(void);
+
+/**
+ * \brief      Checks if a scan is running
+ * \return     1 if running, otherwise 0
+ */
+uint8_t adc_scan_running(void);
+
+/**
+ * \brief      Returns the latest scan sample of a channel
+ *
+ * Single conversions would disturb a running scan, so sensors should
+ * use this value while adc_scan_running() is true.
+ *
+ * \param mux  ADC multiplexer value of the channel
+ * \return     Latest sample or -1 if the channel is not scanned
+ */
+int16_t adc_scan_latest(uint8_t mux);
+
 /** @} */
 /** @} */
 
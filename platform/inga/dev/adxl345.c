@@ -117,7 +117,12 @@ adxl345_set_powermode(uint8_t mode)
     case ADXL345_PMODE_WAKEUP:
       tmp_reg &= 0xF9;
       tmp_reg |= (1 << ADXL345_MEASURE);
-      tmp_reg &= ~(1 << ADXL345_SLEEP);
+      tmp_reg &= ~((1 << ADXL345_SLEEP) | (1 << ADXL345_AUTO_SLEEP) | (1 << ADXL345_LINK));
+      break;
+    // 8Hz readings while inactive, full rate after activity
+    case ADXL345_PMODE_AUTOSLEEP:
+      tmp_reg &= 0xF8;
+      tmp_reg |= (1 << ADXL345_LINK) | (1 << ADXL345_AUTO_SLEEP) | (1 << ADXL345_MEASURE);
       break;
     case ADXL345_PMODE_STANDBY:
       tmp_reg &= ~(1 << ADXL345_MEASURE);
@@ -132,54 +137,92 @@ adxl345_get_fifo_level()
   return adxl345_read(ADXL345_FIFO_STATUS_REG);
 }
 /*----------------------------------------------------------------------------*/
+void
+adxl345_set_watermark_int(uint8_t samples)
+{
+  uint8_t tmp_reg;
+
+  if (samples == 0) {
+    tmp_reg = adxl345_read(ADXL345_INT_ENABLE_REG);
+    adxl345_write(ADXL345_INT_ENABLE_REG, tmp_reg & ~(1 << ADXL345_WATERMARK));
+    return;
+  }
+  tmp_reg = adxl345_read(ADXL345_FIFO_CTL_REG);
+  adxl345_write(ADXL345_FIFO_CTL_REG, (tmp_reg & 0xE0) | (samples & 0x1F));
+  // map to INT1
+  tmp_reg = adxl345_read(ADXL345_INT_MAP_REG);
+  adxl345_write(ADXL345_INT_MAP_REG, tmp_reg & ~(1 << ADXL345_WATERMARK));
+  tmp_reg = adxl345_read(ADXL345_INT_ENABLE_REG);
+  adxl345_write(ADXL345_INT_ENABLE_REG, tmp_reg | (1 << ADXL345_WATERMARK));
+}
+/*----------------------------------------------------------------------------*/
+void
+adxl345_set_motion_int(uint8_t act_thresh, uint8_t inact_thresh, uint8_t inact_time)
+{
+  uint8_t mask = (1 << ADXL345_ACTIVITY) | (1 << ADXL345_INACTIVITY);
+  uint8_t tmp_reg;
+
+  tmp_reg = adxl345_read(ADXL345_INT_ENABLE_REG);
+  adxl345_write(ADXL345_INT_ENABLE_REG, tmp_reg & ~mask);
+  if (act_thresh == 0) {
+    return;
+  }
+  adxl345_write(ADXL345_THRESH_ACT_REG, act_thresh);
+  adxl345_write(ADXL345_THRESH_INACT_REG, inact_thresh);
+  adxl345_write(ADXL345_TIME_INACT_REG, inact_time);
+  // ac-coupled, x, y and z participating
+  adxl345_write(ADXL345_ACT_INACT_CTL_REG, 0xFF);
+  // map to INT1
+  tmp_reg = adxl345_read(ADXL345_INT_MAP_REG);
+  adxl345_write(ADXL345_INT_MAP_REG, tmp_reg & ~mask);
+  // drop stale events
+  adxl345_read(ADXL345_INT_SOURCE_REG);
+  tmp_reg = adxl345_read(ADXL345_INT_ENABLE_REG) | (1 << ADXL345_ACTIVITY);
+  if (inact_thresh) {
+    tmp_reg |= (1 << ADXL345_INACTIVITY);
+  }
+  adxl345_write(ADXL345_INT_ENABLE_REG, tmp_reg);
+}
+/*----------------------------------------------------------------------------*/
+uint8_t
+adxl345_get_int_source(void)
+{
+  return adxl345_read(ADXL345_INT_SOURCE_REG);
+}
+/*----------------------------------------------------------------------------*/
 int16_t
 adxl345_get_x(void)
 {
-  uint8_t byteLow;
-  uint8_t byteHigh;
-  byteLow = adxl345_read(ADXL345_OUTX_LOW_REG);
-  byteHigh = adxl345_read(ADXL345_OUTX_HIGH_REG);
-
-  return ((byteHigh << 8) + byteLow);
+  uint8_t buf[2];
+  adxl345_read_burst(ADXL345_OUTX_LOW_REG, buf, 2);
+  return (buf[1] << 8) + buf[0];
 }
 /*----------------------------------------------------------------------------*/
 int16_t
 adxl345_get_y(void)
 {
-  uint8_t byteLow;
-  uint8_t byteHigh;
-  byteLow = adxl345_read(ADXL345_OUTY_LOW_REG);
-  byteHigh = adxl345_read(ADXL345_OUTY_HIGH_REG);
-  return (byteHigh << 8) +byteLow;
+  uint8_t buf[2];
+  adxl345_read_burst(ADXL345_OUTY_LOW_REG, buf, 2);
+  return (buf[1] << 8) + buf[0];
 }
 /*----------------------------------------------------------------------------*/
 int16_t
 adxl345_get_z(void)
 {
-  uint8_t byteLow;
-  uint8_t byteHigh;
-  byteLow = adxl345_read(ADXL345_OUTZ_LOW_REG);
-  byteHigh = adxl345_read(ADXL345_OUTZ_HIGH_REG);
-  return (byteHigh << 8) +byteLow;
+  uint8_t buf[2];
+  adxl345_read_burst(ADXL345_OUTZ_LOW_REG, buf, 2);
+  return (buf[1] << 8) + buf[0];
 }
 /*----------------------------------------------------------------------------*/
 acc_data_t
 adxl345_get(void)
 {
   acc_data_t adxl345_data;
-  uint8_t lsb = 0, msb = 0;
-  mspi_chip_select(ADXL345_CS);
-  mspi_transceive(ADXL345_OUTX_LOW_REG | 0xC0); // read, multiple
-  lsb = mspi_transceive(MSPI_DUMMY_BYTE);
-  msb = mspi_transceive(MSPI_DUMMY_BYTE);
-  adxl345_data.x = (int16_t) ((msb << 8) + lsb);
-  lsb = mspi_transceive(MSPI_DUMMY_BYTE);
-  msb = mspi_transceive(MSPI_DUMMY_BYTE);
-  adxl345_data.y = (int16_t) ((msb << 8) + lsb);
-  lsb = mspi_transceive(MSPI_DUMMY_BYTE);
-  msb = mspi_transceive(MSPI_DUMMY_BYTE);
-  adxl345_data.z = (int16_t) ((msb << 8) + lsb);
-  mspi_chip_release(ADXL345_CS);
+  uint8_t buf[6];
+  adxl345_read_burst(ADXL345_OUTX_LOW_REG, buf, 6);
+  adxl345_data.x = (int16_t) ((buf[1] << 8) + buf[0]);
+  adxl345_data.y = (int16_t) ((buf[3] << 8) + buf[2]);
+  adxl345_data.z = (int16_t) ((buf[5] << 8) + buf[4]);
   return adxl345_data;
 }
 /*----------------------------------------------------------------------------*/
@@ -218,3 +261,13 @@ adxl345_read(uint8_t reg)
   return data;
 }
 /*----------------------------------------------------------------------------*/
+void
+adxl345_read_burst(uint8_t reg, uint8_t *buf, uint8_t len)
+{
+  mspi_chip_select(ADXL345_CS);
+  // read, multiple byte
+  mspi_transceive(reg | 0xC0);
+  mspi_read_block(buf, len);
+  mspi_chip_release(ADXL345_CS);
+}
+/*----------------------------------------------------------------------------*/
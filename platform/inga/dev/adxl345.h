@@ -71,6 +71,22 @@
 /** Device ID Register */
 #define ADXL345_DEVICE_ID_REG     0x00
 
+/** \name Activity/inactivity registers/bits
+ * \{ */
+/** Activity threshold register, 62.5 mg/LSB */
+#define ADXL345_THRESH_ACT_REG    0x24
+/** Inactivity threshold register, 62.5 mg/LSB */
+#define ADXL345_THRESH_INACT_REG  0x25
+/** Inactivity time register, 1 s/LSB */
+#define ADXL345_TIME_INACT_REG    0x26
+/** Axis enable and ac/dc coupling control register */
+#define ADXL345_ACT_INACT_CTL_REG 0x27
+/** ACT ac/dc bit pos. */
+#define ADXL345_ACT_AC        7
+/** INACT ac/dc bit pos. */
+#define ADXL345_INACT_AC      3
+/** \} */
+
 /** \name BW_RATE register/bits
  * \{ */
 /** ADXL Data Rate and Power Mode Control Register. */
@@ -97,6 +113,26 @@
 #define ADXL345_WAKEUP_L      0
 /** \} */
 
+/** \name INT_ENABLE/INT_MAP/INT_SOURCE registers/bits
+ * \{ */
+/** Interrupt enable register */
+#define ADXL345_INT_ENABLE_REG    0x2E
+/** Interrupt mapping register, a set bit maps to INT2 */
+#define ADXL345_INT_MAP_REG       0x2F
+/** Interrupt source register */
+#define ADXL345_INT_SOURCE_REG    0x30
+/** DATA_READY bit pos. */
+#define ADXL345_DATA_READY    7
+/** Activity bit pos. */
+#define ADXL345_ACTIVITY      4
+/** Inactivity bit pos. */
+#define ADXL345_INACTIVITY    3
+/** Watermark bit pos. */
+#define ADXL345_WATERMARK     1
+/** Overrun bit pos. */
+#define ADXL345_OVERRUN       0
+/** \} */
+
 /** \name DATA_FORMAT register/bits
  * \{ */
 /** ADXL Data Format Register Register. */
@@ -181,6 +217,8 @@
 #define ADXL345_PMODE_SLEEP       1
 #define ADXL345_PMODE_WAKEUP      3
 #define ADXL345_PMODE_STANDBY     4
+/** Measure, link activity/inactivity and sleep while inactive */
+#define ADXL345_PMODE_AUTOSLEEP   5
 /** \} */
 
 /**
@@ -282,7 +320,8 @@ void adxl345_set_fifomode(uint8_t mode);
 
 /**
  * 
- * @param mode One of ADXL345_PMODE_SLEEP, ADXL345_PMODE_WAKEUP, ADXL345_PMODE_STANDBY
+ * @param mode One of ADXL345_PMODE_SLEEP, ADXL345_PMODE_WAKEUP, ADXL345_PMODE_STANDBY,
+ * ADXL345_PMODE_AUTOSLEEP
  */
 void adxl345_set_powermode(uint8_t mode);
 
@@ -292,6 +331,32 @@ void adxl345_set_powermode(uint8_t mode);
  */
 uint8_t adxl345_get_fifo_level();
 
+/**
+ * Configures the FIFO watermark interrupt on the INT1 pin.
+ *
+ * INT1 stays high as long as the FIFO holds more than
+ * \p samples entries.
+ * @param samples Watermark [1 - 31], 0 disables the interrupt
+ */
+void adxl345_set_watermark_int(uint8_t samples);
+
+/**
+ * Configures the activity and inactivity interrupts on the INT1 pin.
+ *
+ * Detection is ac-coupled on all axes. INT1 stays high until
+ * the interrupt source is read with adxl345_get_int_source().
+ * @param act_thresh Activity threshold [62.5 mg/LSB], 0 disables both interrupts
+ * @param inact_thresh Inactivity threshold [62.5 mg/LSB], 0 disables inactivity
+ * @param inact_time Time below \p inact_thresh until inactivity [s]
+ */
+void adxl345_set_motion_int(uint8_t act_thresh, uint8_t inact_thresh, uint8_t inact_time);
+
+/**
+ * Reads and thereby clears the interrupt source register.
+ * @return ADXL345_INT_SOURCE_REG bits
+ */
+uint8_t adxl345_get_int_source(void);
+
 /**
  * \brief This function returns the current measured acceleration
  * at the x-axis of the adxl345
@@ -345,6 +410,15 @@ void adxl345_write(uint8_t reg, uint8_t data);
  */
 uint8_t adxl345_read(uint8_t reg);
 
+/**
+ * \brief This function reads consecutive registers of the
+ *        ADXL345 within a single chip select
+ * \param reg   The first register address
+ * \param buf   Buffer for the register values
+ * \param len   Number of registers to read
+ */
+void adxl345_read_burst(uint8_t reg, uint8_t *buf, uint8_t len);
+
 /** @} */
 /** @} */
 
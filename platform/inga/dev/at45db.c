@@ -45,6 +45,8 @@
  */
 
 #include "at45db.h"
+#include "sys/energest.h"
+#include "sys/ctimer.h"
 
 #define DEBUG 0
 
@@ -64,6 +66,135 @@
 static bufmgr_t buffer_mgr;
 static uint8_t initialized = 0;
 
+/*!
+ * Marks an SRAM buffer that does not cache a page for the block interface
+ */
+#define AT45DB_NO_PAGE 0xFFFF
+/*!
+ * Marks that no SRAM buffer is being programmed
+ */
+#define AT45DB_NO_BUFFER 0xFF
+
+/*!
+ * Pages cached in the SRAM buffers by at45db_write_block(). Only the
+ * bytes lo ... hi - 1 of the buffer were written, the rest still has to
+ * be taken from the page before it is programmed.
+ */
+static struct {
+  uint16_t page;
+  uint16_t lo;
+  uint16_t hi;
+} block_cache[2];
+/*! Buffer used last by the block interface */
+static uint8_t block_last = 0;
+/*! Buffer that was programmed last and may still be busy */
+static uint8_t block_programming = AT45DB_NO_BUFFER;
+
+/*!
+ * Bytes inverted at once before they are passed to mspi_write_block()
+ */
+#define AT45DB_WRITE_CHUNK 32
+
+/*!
+ * Clock ticks without access until the chip enters Deep Power-Down,
+ * 0 keeps it in standby
+ */
+#ifdef AT45DB_CONF_POWERDOWN_TIMEOUT
+#define POWERDOWN_TIMEOUT AT45DB_CONF_POWERDOWN_TIMEOUT
+#else
+#define POWERDOWN_TIMEOUT (CLOCK_SECOND / 8)
+#endif
+
+#if POWERDOWN_TIMEOUT
+static uint8_t powered_down = 0;
+static clock_time_t last_access;
+static struct ctimer powerdown_timer;
+#endif
+/*----------------------------------------------------------------------------*/
+#if POWERDOWN_TIMEOUT
+static void
+power_down(void) {
+  mspi_chip_select(AT45DB_CS);
+  mspi_transceive(AT45DB_DEEP_POWER_DOWN);
+  mspi_chip_release(AT45DB_CS);
+  powered_down = 1;
+  ENERGEST_OFF(ENERGEST_TYPE_FLASH_STANDBY);
+}
+/*----------------------------------------------------------------------------*/
+static void
+powerdown_check(void *ptr) {
+  clock_time_t idle = clock_time() - last_access;
+
+  if (powered_down) {
+    return;
+  }
+  if (idle < POWERDOWN_TIMEOUT) {
+    ctimer_set(&powerdown_timer, POWERDOWN_TIMEOUT - idle, powerdown_check, NULL);
+    return;
+  }
+  /* not called by the chip's user, so the bus may be held by another device */
+  if (mspi_transaction_begin(AT45DB_CS)) {
+    ctimer_set(&powerdown_timer, POWERDOWN_TIMEOUT, powerdown_check, NULL);
+    return;
+  }
+  /* the command would be ignored while a page is programmed */
+  if (!at45db_ready()) {
+    mspi_transaction_end(AT45DB_CS);
+    ctimer_set(&powerdown_timer, POWERDOWN_TIMEOUT, powerdown_check, NULL);
+    return;
+  }
+  power_down();
+  mspi_transaction_end(AT45DB_CS);
+}
+/*----------------------------------------------------------------------------*/
+/* Resumes the chip if necessary, called before each access */
+static void
+wake_up(void) {
+  if (powered_down) {
+    mspi_chip_select(AT45DB_CS);
+    mspi_transceive(AT45DB_RESUME);
+    mspi_chip_release(AT45DB_CS);
+    _delay_us(AT45DB_RESUME_US);
+    powered_down = 0;
+    ENERGEST_ON(ENERGEST_TYPE_FLASH_STANDBY);
+    /* the ctimer only checks the idle time, accesses just set last_access */
+    ctimer_set(&powerdown_timer, POWERDOWN_TIMEOUT, powerdown_check, NULL);
+  }
+  last_access = clock_time();
+}
+#else
+#define wake_up()
+#endif
+/*----------------------------------------------------------------------------*/
+/* The flash stores inverted data, so erased bytes read as 0x00 */
+static void
+at45db_read_data(uint8_t *buffer, uint16_t bytes)
+{
+  uint16_t i;
+
+  mspi_read_block(buffer, bytes);
+  for (i = 0; i < bytes; i++) {
+    buffer[i] = ~buffer[i];
+  }
+}
+/*----------------------------------------------------------------------------*/
+static void
+at45db_write_data(const uint8_t *buffer, uint16_t bytes)
+{
+  uint8_t chunk[AT45DB_WRITE_CHUNK];
+  uint8_t i, len;
+
+  while (bytes > 0) {
+    len = (bytes > AT45DB_WRITE_CHUNK) ? AT45DB_WRITE_CHUNK : bytes;
+    for (i = 0; i < len; i++) {
+      chunk[i] = ~(*buffer++);
+    }
+    mspi_write_block(chunk, len);
+    bytes -= len;
+  }
+}
+/*----------------------------------------------------------------------------*/
+
 int8_t
 at45db_init(void) {
   uint8_t i = 0, id = 0;
@@ -75,24 +206,47 @@ at45db_init(void) {
   buffer_mgr.buf_to_page_addr[1] = AT45DB_BUF_2_TO_PAGE;
   buffer_mgr.page_program[0] = AT45DB_PAGE_PROGRAM_1;
   buffer_mgr.page_program[1] = AT45DB_PAGE_PROGRAM_2;
+  buffer_mgr.page_to_buf[0] = AT45DB_PAGE_TO_BUF_1;
+  buffer_mgr.page_to_buf[1] = AT45DB_PAGE_TO_BUF_2;
+  buffer_mgr.read_buffer[0] = AT45DB_READ_BUFFER_1;
+  buffer_mgr.read_buffer[1] = AT45DB_READ_BUFFER_2;
+  block_cache[0].page = AT45DB_NO_PAGE;
+  block_cache[1].page = AT45DB_NO_PAGE;
 
   mspi_chip_release(AT45DB_CS);
   /*init mspi in mode3, at chip select pin 3 and max baud rate*/
   mspi_init(AT45DB_CS, MSPI_MODE_3, MSPI_BAUD_MAX);
+  /* bus transfers count as FLASH_READ, the programming time as FLASH_WRITE */
+  mspi_set_energest_type(AT45DB_CS, ENERGEST_TYPE_FLASH_READ);
 
-  while (id != 0x1F) {
+  /* the chip may still be powered down if only the MCU was reset */
+  mspi_chip_select(AT45DB_CS);
+  mspi_transceive(AT45DB_RESUME);
+  mspi_chip_release(AT45DB_CS);
+  _delay_us(AT45DB_RESUME_US);
+  ENERGEST_ON(ENERGEST_TYPE_FLASH_STANDBY);
+
+  while (1) {
     mspi_chip_select(AT45DB_CS);
     mspi_transceive(0x9F);
     id = mspi_transceive(0x00);
     mspi_chip_release(AT45DB_CS);
-    _delay_ms(10);
+    if (id == 0x1F) {
+      break;
+    }
     if (i++ > 10) {
       PRINTF("at45db.c: Initialization failed\n");
       initialized = 0;
       return -1;
     }
+    /* only wait if the flash did not answer yet */
+    _delay_ms(10);
   }
   initialized = 1;
+#if POWERDOWN_TIMEOUT
+  /* ctimers are not available yet, the first access starts the timeout */
+  power_down();
+#endif
   return 0;
 
 }
@@ -100,6 +254,8 @@ at45db_init(void) {
 void
 at45db_erase_chip(void) {
   if (!initialized) return;
+  /*a page may still be programmed by at45db_write_page_async()*/
+  at45db_busy_wait();
   /*chip erase command consists of 4 byte*/
   uint8_t cmd[4] = {0xC7, 0x94, 0x80, 0x9A};
   at45db_write_cmd(&cmd[0]);
@@ -113,6 +269,8 @@ at45db_erase_chip(void) {
 void
 at45db_erase_block(uint16_t addr) {
   if (!initialized) return;
+  /*a page may still be programmed by at45db_write_page_async()*/
+  at45db_busy_wait();
   /*block erase command consists of 4 byte*/
   uint8_t cmd[4] = {AT45DB_BLOCK_ERASE, (uint8_t) (addr >> 3),
     (uint8_t) (addr << 5), 0x00};
@@ -127,6 +285,8 @@ at45db_erase_block(uint16_t addr) {
 void
 at45db_erase_page(uint16_t addr) {
   if (!initialized) return;
+  /*a page may still be programmed by at45db_write_page_async()*/
+  at45db_busy_wait();
   /*block erase command consists of 4 byte*/
   uint8_t cmd[4] = {AT45DB_PAGE_ERASE, (uint8_t) (addr >> 6),
     (uint8_t) (addr << 2), 0x00};
@@ -140,7 +300,6 @@ at45db_erase_page(uint16_t addr) {
 /*----------------------------------------------------------------------------*/
 void
 at45db_write_buffer(uint16_t addr, uint8_t *buffer, uint16_t bytes) {
-  uint16_t i;
   if (!initialized) return;
   /*block erase command consists of 4 byte*/
   uint8_t cmd[4] = {buffer_mgr.buffer_addr[buffer_mgr.active_buffer], 0x00,
@@ -148,9 +307,7 @@ at45db_write_buffer(uint16_t addr, uint8_t *buffer, uint16_t bytes) {
 
   at45db_write_cmd(&cmd[0]);
 
-  for (i = 0; i < bytes; i++) {
-    mspi_transceive(~(*buffer++));
-  }
+  at45db_write_data(buffer, bytes);
 
   mspi_chip_release(AT45DB_CS);
 }
@@ -172,8 +329,10 @@ at45db_buffer_to_page(uint16_t addr) {
 /*----------------------------------------------------------------------------*/
 void
 at45db_write_page(uint16_t p_addr, uint16_t b_addr, uint8_t *buffer, uint16_t bytes) {
-  uint16_t i;
   if (!initialized) return;
+  /* the combined program command is not accepted while the other
+   * buffer is still being programmed */
+  at45db_busy_wait();
   /*block erase command consists of 4 byte*/
   uint8_t cmd[4] = {buffer_mgr.page_program[buffer_mgr.active_buffer],
     (uint8_t) (p_addr >> 6),
@@ -181,9 +340,7 @@ at45db_write_page(uint16_t p_addr, uint16_t b_addr, uint8_t *buffer, uint16_t by
     (uint8_t) (b_addr)};
   at45db_write_cmd(&cmd[0]);
 
-  for (i = 0; i < bytes; i++) {
-    mspi_transceive(~(*buffer++));
-  }
+  at45db_write_data(buffer, bytes);
 
   mspi_chip_release(AT45DB_CS);
 
@@ -193,6 +350,29 @@ at45db_write_page(uint16_t p_addr, uint16_t b_addr, uint8_t *buffer, uint16_t by
 }
 /*----------------------------------------------------------------------------*/
 void
+at45db_write_page_async(uint16_t p_addr, uint16_t b_addr, uint8_t *buffer, uint16_t bytes) {
+  if (!initialized) return;
+  /* the active buffer is free, while the other one may still be programmed */
+  at45db_write_buffer(b_addr, buffer, bytes);
+  /* waits for the previous program operation and switches the buffers */
+  at45db_buffer_to_page(p_addr);
+}
+/*----------------------------------------------------------------------------*/
+void
+at45db_update_page(uint16_t p_addr, uint16_t b_addr, uint8_t *buffer, uint16_t bytes) {
+  if (!initialized) return;
+  /* the page transfer needs the flash array, wait for programming */
+  at45db_busy_wait();
+  uint8_t cmd[4] = {buffer_mgr.page_to_buf[buffer_mgr.active_buffer],
+    (uint8_t) (p_addr >> 6), (uint8_t) (p_addr << 2), 0x00};
+  at45db_write_cmd(&cmd[0]);
+  mspi_chip_release(AT45DB_CS);
+  /* the buffer can be written once the transfer is completed */
+  at45db_busy_wait();
+  at45db_write_page_async(p_addr, b_addr, buffer, bytes);
+}
+/*----------------------------------------------------------------------------*/
+void
 at45db_read_page_buffered(uint16_t p_addr, uint16_t b_addr,
         uint8_t *buffer, uint16_t bytes) {
   if (!initialized) return;
@@ -221,9 +401,29 @@ at45db_read_page_bypassed(uint16_t p_addr, uint16_t b_addr,
     mspi_transceive(0x00);
   }
   /*now the data bytes can be received*/
-  for (i = 0; i < bytes; i++) {
-    *buffer++ = ~mspi_transceive(MSPI_DUMMY_BYTE);
+  at45db_read_data(buffer, bytes);
+  mspi_chip_release(AT45DB_CS);
+}
+/*----------------------------------------------------------------------------*/
+void
+at45db_read_continuous(uint16_t p_addr, uint16_t b_addr,
+        uint8_t *buffer, uint16_t bytes) {
+  uint16_t i;
+  if (!initialized) return;
+  /* wait until AT45DB161 is ready again */
+  at45db_busy_wait();
+  /* continuous read command consists of 4 cmd bytes and 4 don't care */
+  uint8_t cmd[4] = {AT45DB_CONTINUOUS_READ,
+    (uint8_t) (p_addr >> 6),
+    (((uint8_t) (p_addr << 2)) & 0xFC) | ((uint8_t) (b_addr >> 8) & 0x3),
+    (uint8_t) (b_addr)};
+  at45db_write_cmd(&cmd[0]);
+
+  for (i = 0; i < 4; i++) {
+    mspi_transceive(0x00);
   }
+  /* the internal address wraps to the next page automatically */
+  at45db_read_data(buffer, bytes);
   mspi_chip_release(AT45DB_CS);
 }
 /*----------------------------------------------------------------------------*/
@@ -231,6 +431,7 @@ void
 at45db_page_to_buf(uint16_t addr) {
 
   if (!initialized) return;
+  at45db_busy_wait();
   /* write active buffer to page command consists of 4 byte */
   uint8_t cmd[4] = {AT45DB_PAGE_TO_BUF,
     (uint8_t) (addr >> 6),
@@ -247,7 +448,6 @@ at45db_page_to_buf(uint16_t addr) {
 /*----------------------------------------------------------------------------*/
 void
 at45db_read_buffer(uint16_t b_addr, uint8_t *buffer, uint16_t bytes) {
-  uint16_t i;
   if (!initialized) return;
   uint8_t cmd[4] = {AT45DB_READ_BUFFER, 0x00, (uint8_t) (b_addr >> 8),
     (uint8_t) (b_addr)};
@@ -255,17 +455,228 @@ at45db_read_buffer(uint16_t b_addr, uint8_t *buffer, uint16_t bytes) {
   at45db_write_cmd(&cmd[0]);
   mspi_transceive(0x00);
 
-  for (i = 0; i < bytes; i++) {
-    *buffer++ = ~mspi_transceive(0x00);
+  at45db_read_data(buffer, bytes);
+  mspi_chip_release(AT45DB_CS);
+}
+/*----------------------------------------------------------------------------*/
+static void
+block_buffer_write(uint8_t b, uint16_t addr, const uint8_t *buffer, uint16_t bytes) {
+  uint8_t cmd[4] = {buffer_mgr.buffer_addr[b], 0x00,
+    (uint8_t) (addr >> 8), (uint8_t) (addr)};
+
+  at45db_write_cmd(&cmd[0]);
+  at45db_write_data(buffer, bytes);
+  mspi_chip_release(AT45DB_CS);
+}
+/*----------------------------------------------------------------------------*/
+static void
+block_buffer_read(uint8_t b, uint16_t addr, uint8_t *buffer, uint16_t bytes) {
+  uint8_t cmd[4] = {buffer_mgr.read_buffer[b], 0x00,
+    (uint8_t) (addr >> 8), (uint8_t) (addr)};
+
+  at45db_write_cmd(&cmd[0]);
+  mspi_transceive(0x00);
+  at45db_read_data(buffer, bytes);
+  mspi_chip_release(AT45DB_CS);
+}
+/*----------------------------------------------------------------------------*/
+/* Copies the bytes that were not written from the page into the buffer */
+static void
+block_cache_complete(uint8_t b) {
+  uint8_t chunk[AT45DB_WRITE_CHUNK];
+  uint16_t addr = 0, len;
+
+  while (addr < AT45DB_PAGE_SIZE) {
+    if (addr >= block_cache[b].lo && addr < block_cache[b].hi) {
+      addr = block_cache[b].hi;
+      continue;
+    }
+
+    len = AT45DB_PAGE_SIZE - addr;
+    if (addr < block_cache[b].lo && len > block_cache[b].lo - addr) {
+      len = block_cache[b].lo - addr;
+    }
+    if (len > AT45DB_WRITE_CHUNK) {
+      len = AT45DB_WRITE_CHUNK;
+    }
+
+    at45db_read_page_bypassed(block_cache[b].page, addr, chunk, len);
+    block_buffer_write(b, addr, chunk, len);
+    addr += len;
   }
+
+  block_cache[b].lo = 0;
+  block_cache[b].hi = AT45DB_PAGE_SIZE;
+}
+/*----------------------------------------------------------------------------*/
+/* Starts programming the buffer into its page, does not wait */
+static void
+block_cache_flush(uint8_t b) {
+  uint16_t page = block_cache[b].page;
+
+  if (page == AT45DB_NO_PAGE) {
+    return;
+  }
+
+  if (block_cache[b].lo != 0 || block_cache[b].hi != AT45DB_PAGE_SIZE) {
+    block_cache_complete(b);
+  }
+
+  at45db_busy_wait();
+  uint8_t cmd[4] = {buffer_mgr.buf_to_page_addr[b],
+    (uint8_t) (page >> 6), (uint8_t) (page << 2), 0x00};
+  at45db_write_cmd(&cmd[0]);
   mspi_chip_release(AT45DB_CS);
+
+  block_programming = b;
+  block_cache[b].page = AT45DB_NO_PAGE;
+}
+/*----------------------------------------------------------------------------*/
+/* Returns the buffer caching the page, or a free one for it */
+static uint8_t
+block_cache_slot(uint16_t page) {
+  uint8_t b;
+
+  for (b = 0; b < 2; b++) {
+    if (block_cache[b].page == page) {
+      return b;
+    }
+  }
+
+  /* prefer a free buffer that is not being programmed */
+  b = (block_programming == 0) ? 1 : 0;
+  if (block_cache[b].page != AT45DB_NO_PAGE) {
+    b ^= 1;
+  }
+  if (block_cache[b].page != AT45DB_NO_PAGE) {
+    /* both buffers hold partial pages, write back the older one */
+    b = block_last ^ 1;
+    block_cache_flush(b);
+  }
+  if (block_programming == b) {
+    at45db_busy_wait();
+    block_programming = AT45DB_NO_BUFFER;
+  }
+
+  block_cache[b].page = page;
+  block_cache[b].lo = AT45DB_PAGE_SIZE;
+  block_cache[b].hi = 0;
+  return b;
+}
+/*----------------------------------------------------------------------------*/
+static void
+block_write_segment(uint16_t page, uint16_t addr, const uint8_t *buffer, uint16_t bytes) {
+  uint8_t b = block_cache_slot(page);
+
+  /* only one contiguous range of written bytes is tracked */
+  if (block_cache[b].hi != 0
+          && (addr > block_cache[b].hi || addr + bytes < block_cache[b].lo)) {
+    block_cache_complete(b);
+  }
+
+  block_buffer_write(b, addr, buffer, bytes);
+
+  if (addr < block_cache[b].lo) {
+    block_cache[b].lo = addr;
+  }
+  if (addr + bytes > block_cache[b].hi) {
+    block_cache[b].hi = addr + bytes;
+  }
+  block_last = b;
+
+  if (block_cache[b].lo == 0 && block_cache[b].hi == AT45DB_PAGE_SIZE) {
+    block_cache_flush(b);
+  }
+}
+/*----------------------------------------------------------------------------*/
+static void
+block_read_segment(uint16_t page, uint16_t addr, uint8_t *buffer, uint16_t bytes) {
+  uint8_t b;
+
+  for (b = 0; b < 2; b++) {
+    if (block_cache[b].page == page) {
+      if (addr < block_cache[b].lo || addr + bytes > block_cache[b].hi) {
+        block_cache_complete(b);
+      }
+      block_buffer_read(b, addr, buffer, bytes);
+      return;
+    }
+  }
+
+  at45db_read_continuous(page, addr, buffer, bytes);
+}
+/*----------------------------------------------------------------------------*/
+void
+at45db_read_block(uint32_t block, uint8_t *buffer) {
+  uint32_t addr = block * AT45DB_BLOCK_SIZE;
+  uint16_t page = addr / AT45DB_PAGE_SIZE;
+  uint16_t offset = addr % AT45DB_PAGE_SIZE;
+  uint16_t len = AT45DB_PAGE_SIZE - offset;
+
+  if (!initialized) return;
+
+  if (block_cache[0].page != page && block_cache[1].page != page
+          && block_cache[0].page != page + 1 && block_cache[1].page != page + 1) {
+    /* nothing cached, read across the page boundary at once */
+    at45db_read_continuous(page, offset, buffer, AT45DB_BLOCK_SIZE);
+    return;
+  }
+
+  if (len > AT45DB_BLOCK_SIZE) {
+    len = AT45DB_BLOCK_SIZE;
+  }
+  block_read_segment(page, offset, buffer, len);
+  if (len < AT45DB_BLOCK_SIZE) {
+    block_read_segment(page + 1, 0, buffer + len, AT45DB_BLOCK_SIZE - len);
+  }
+}
+/*----------------------------------------------------------------------------*/
+void
+at45db_write_block(uint32_t block, uint8_t *buffer) {
+  uint32_t addr = block * AT45DB_BLOCK_SIZE;
+  uint16_t page = addr / AT45DB_PAGE_SIZE;
+  uint16_t offset = addr % AT45DB_PAGE_SIZE;
+  uint16_t len = AT45DB_PAGE_SIZE - offset;
+
+  if (!initialized) return;
+
+  if (len > AT45DB_BLOCK_SIZE) {
+    len = AT45DB_BLOCK_SIZE;
+  }
+  block_write_segment(page, offset, buffer, len);
+  if (len < AT45DB_BLOCK_SIZE) {
+    block_write_segment(page + 1, 0, buffer + len, AT45DB_BLOCK_SIZE - len);
+  }
+}
+/*----------------------------------------------------------------------------*/
+void
+at45db_flush_blocks(void) {
+  if (!initialized) return;
+  /* the older page first */
+  block_cache_flush(block_last ^ 1);
+  block_cache_flush(block_last);
+  at45db_busy_wait();
+  block_programming = AT45DB_NO_BUFFER;
 }
 /*----------------------------------------------------------------------------*/
 void
 at45db_write_cmd(uint8_t *cmd) {
   uint8_t i;
   if (!initialized) return;
+  wake_up();
   mspi_chip_select(AT45DB_CS);
+  switch (cmd[0]) {
+    case 0xC7: /* chip erase */
+    case AT45DB_BLOCK_ERASE:
+    case AT45DB_PAGE_ERASE:
+    case AT45DB_PAGE_PROGRAM_1:
+    case AT45DB_PAGE_PROGRAM_2:
+    case AT45DB_BUF_1_TO_PAGE:
+    case AT45DB_BUF_2_TO_PAGE:
+      /* the array is programmed until the status reports ready */
+      ENERGEST_SWITCH_ON(ENERGEST_TYPE_FLASH_WRITE);
+      break;
+  }
   for (i = 0; i < 4; i++) {
     mspi_transceive(*cmd++);
   }
@@ -275,14 +686,37 @@ void
 at45db_busy_wait(void) {
   uint16_t i = 0;
   if (!initialized) return;
+#if POWERDOWN_TIMEOUT
+  /* nothing is programmed while powered down */
+  if (powered_down) return;
+#endif
+  wake_up();
   mspi_chip_select(AT45DB_CS);
   mspi_transceive(AT45DB_STATUS_REG);
   while ((mspi_transceive(MSPI_DUMMY_BYTE) >> 7) != 0x01) {
     _delay_ms(1);
     if (i++ > 500) {
       PRINTF("at45db.c: at45db_busy_wait timeout\n");
-      return;
+      break;
     }
   }
+  ENERGEST_OFF(ENERGEST_TYPE_FLASH_WRITE);
   mspi_chip_release(AT45DB_CS);
 }
+/*----------------------------------------------------------------------------*/
+uint8_t
+at45db_ready(void) {
+  uint8_t status;
+  if (!initialized) return 1;
+#if POWERDOWN_TIMEOUT
+  if (powered_down) return 1;
+#endif
+  mspi_chip_select(AT45DB_CS);
+  mspi_transceive(AT45DB_STATUS_REG);
+  status = mspi_transceive(MSPI_DUMMY_BYTE);
+  mspi_chip_release(AT45DB_CS);
+  if (status >> 7) {
+    ENERGEST_OFF(ENERGEST_TYPE_FLASH_WRITE);
+  }
+  return status >> 7;
+}
@@ -60,6 +60,12 @@
  * only a command is necessary and the AT45DBxx1 will copy the buffer into
  * the flash section. To avoid latency, it is possible (and implemented)
  * to switch between the page buffers.
+ *
+ * \note
+ * The AT45DBxx1 is put into Deep Power-Down once it was not accessed for
+ * AT45DB_CONF_POWERDOWN_TIMEOUT clock ticks, and resumed by the next call.
+ * The SRAM buffers keep their content. ENERGEST_TYPE_FLASH_STANDBY is on
+ * while the chip is not powered down.
  * @{
  *
  */
@@ -78,6 +84,24 @@
  */
 #define AT45DB_CS 					1
 
+/*!
+ * Number of pages e.g. AT45DB161
+ */
+#define AT45DB_PAGES				4096
+/*!
+ * Size of one page and of the SRAM buffers in bytes
+ */
+#define AT45DB_PAGE_SIZE			528
+/*!
+ * Size of the logical blocks of the block interface
+ */
+#define AT45DB_BLOCK_SIZE			512
+/*!
+ * Number of logical blocks. The blocks are stored back to back over all
+ * bytes of the pages, so a block may span two pages.
+ */
+#define AT45DB_BLOCKS				((uint32_t) AT45DB_PAGES * AT45DB_PAGE_SIZE / AT45DB_BLOCK_SIZE)
+
 /*!
  * Status Register Address. Bit 7 signalizes if the device is
  * busy.
@@ -131,12 +155,45 @@
  *
  */
 #define AT45DB_PAGE_TO_BUF			0x55 //use buffer 2
+/*!
+ * Transfer page to buffer 1 Opcode
+ */
+#define AT45DB_PAGE_TO_BUF_1		0x53
+/*!
+ * Transfer page to buffer 2 Opcode
+ */
+#define AT45DB_PAGE_TO_BUF_2		AT45DB_PAGE_TO_BUF
 /*!
  * Read buffer 2 opcode
  * \note Only Buffer 2 is used to readout a page, because the read
  * respectively transfer latency is only about 200us
  */
 #define AT45DB_READ_BUFFER  		0xD6
+/*!
+ * Read buffer 1 opcode
+ */
+#define AT45DB_READ_BUFFER_1		0xD4
+/*!
+ * Read buffer 2 opcode
+ */
+#define AT45DB_READ_BUFFER_2		AT45DB_READ_BUFFER
+/*!
+ * Continuous array read Opcode (legacy command with 4 don't care bytes),
+ * the read continues across page boundaries
+ */
+#define AT45DB_CONTINUOUS_READ		0xE8
+/*!
+ * Deep Power-Down Opcode, ignored while a program or erase is in progress
+ */
+#define AT45DB_DEEP_POWER_DOWN		0xB9
+/*!
+ * Resume from Deep Power-Down Opcode
+ */
+#define AT45DB_RESUME				0xAB
+/*!
+ * Time until the chip accepts commands after the resume (tRDPD) in us
+ */
+#define AT45DB_RESUME_US			35
 
 
 /*!
@@ -167,6 +224,16 @@ typedef struct{
  * Main Memory Page Program (Erase Page + Reprogram directly in one operation)
  */
 	volatile uint8_t page_program[2];
+
+/*!
+ * Transfer page to buffer 1 and buffer 2
+ */
+	volatile uint8_t page_to_buf[2];
+
+/*!
+ * Read buffer 1 and buffer 2
+ */
+	volatile uint8_t read_buffer[2];
 }bufmgr_t;
 
 /**
@@ -244,6 +311,41 @@ void at45db_buffer_to_page(uint16_t addr);
  */
 void at45db_write_page(uint16_t p_addr, uint16_t b_addr, uint8_t *buffer, uint16_t bytes);
 
+/**
+ * \brief Streaming page writer. The data is written to the active buffer,
+ * which is possible while the other buffer is still being programmed.
+ * Then the function waits for the previous program operation, starts
+ * programming the active buffer into the page and switches the buffers.
+ * It returns without waiting for the program operation to complete, use
+ * at45db_ready() or at45db_busy_wait() for that.
+ *
+ * \param p_addr page address e.g. AT45DB161 (0 - 4095)
+ * \param b_addr byte address within the page e.g. AT45DB161 (0 - 527)
+ * \param *buffer Pointer to local byte buffer
+ * \param bytes Number of bytes (e.g. byte buffer size) which have to
+ *        be written to the page
+ *
+ * \note The whole page is programmed from the buffer. Bytes outside of
+ * the written range keep the previous content of the buffer, so write
+ * whole pages or use at45db_update_page().
+ */
+void at45db_write_page_async(uint16_t p_addr, uint16_t b_addr, uint8_t *buffer, uint16_t bytes);
+
+/**
+ * \brief Changes a part of a page. The page is transferred into the
+ * active buffer inside the chip, the bytes are written to the buffer and
+ * the buffer is programmed back into the page. Only the changed bytes
+ * are sent via SPI. Like at45db_write_page_async() it does not wait
+ * for the program operation to complete.
+ *
+ * \param p_addr page address e.g. AT45DB161 (0 - 4095)
+ * \param b_addr byte address within the page e.g. AT45DB161 (0 - 527)
+ * \param *buffer Pointer to local byte buffer
+ * \param bytes Number of bytes (e.g. byte buffer size) which have to
+ *        be written to the page
+ */
+void at45db_update_page(uint16_t p_addr, uint16_t b_addr, uint8_t *buffer, uint16_t bytes);
+
 /**
  * \brief Bytes can be read via buffer from a Flash EEPROM page. With this
  * function you select the page, the start byte within the page and the
@@ -272,6 +374,19 @@ void at45db_read_page_buffered(uint16_t p_addr, uint16_t b_addr, uint8_t *buffer
  */
 void at45db_read_page_bypassed(uint16_t p_addr, uint16_t b_addr, uint8_t *buffer, uint16_t bytes);
 
+/**
+ * \brief Reads consecutive bytes from the flash array with a single
+ * continuous array read command. The read is not limited to one page,
+ * it continues with the first byte of the next page.
+ *
+ * \param p_addr page address of the first byte e.g. AT45DB161 (0 - 4095)
+ * \param b_addr byte address within the first page e.g. AT45DB161 (0 - 527)
+ * \param *buffer Pointer to local byte buffer
+ * \param bytes Number of bytes (e.g. byte buffer size) which have to
+ *        be read to the local byte buffer
+ */
+void at45db_read_continuous(uint16_t p_addr, uint16_t b_addr, uint8_t *buffer, uint16_t bytes);
+
 /**
  * \brief Copies the given page into the buffer 2.
  * \note Only Buffer 2 is used to readout a page, because the read
@@ -293,6 +408,36 @@ void at45db_page_to_buf(uint16_t addr);
  */
 void at45db_read_buffer(uint16_t b_addr, uint8_t *buffer, uint16_t bytes);
 
+/**
+ * \brief Reads a logical block of AT45DB_BLOCK_SIZE bytes. Data that is
+ * still cached in one of the SRAM buffers is read from there.
+ *
+ * \param block block address (0 ... AT45DB_BLOCKS - 1)
+ * \param *buffer Pointer to a local buffer of AT45DB_BLOCK_SIZE bytes
+ */
+void at45db_read_block(uint32_t block, uint8_t *buffer);
+
+/**
+ * \brief Writes a logical block of AT45DB_BLOCK_SIZE bytes. Both SRAM buffers
+ * are used as a write-back cache of partially written pages. A page is
+ * programmed as soon as it was written completely, or when its buffer is
+ * needed for another page. Sequential blocks therefore never need to read
+ * back a page and fill one buffer while the other is programmed.
+ *
+ * \param block block address (0 ... AT45DB_BLOCKS - 1)
+ * \param *buffer Pointer to a local buffer of AT45DB_BLOCK_SIZE bytes
+ *
+ * \note The block interface must not be mixed with the page functions,
+ * which use the buffers as well, without calling at45db_flush_blocks().
+ */
+void at45db_write_block(uint32_t block, uint8_t *buffer);
+
+/**
+ * \brief Programs all pages that are cached in the SRAM buffers by
+ * at45db_write_block() and waits until they are written.
+ */
+void at45db_flush_blocks(void);
+
 /**
  * \brief The command word of the AT45DBxx1 normally consists of 4 bytes.
  * This function enables the chip select and sends the command (opcode +
@@ -309,6 +454,15 @@ void at45db_write_cmd(uint8_t *cmd);
  */
 void at45db_busy_wait(void);
 
+/**
+ * \brief Reads the status register once without waiting. A powered down
+ * chip is ready and stays powered down.
+ *
+ * \retval 1 the AT45DBxx1 is ready, e.g. a page program has completed
+ * \retval 0 the AT45DBxx1 is busy
+ */
+uint8_t at45db_ready(void);
+
 /** @} */
 /** @} */
 
@@ -35,6 +35,7 @@
  */
 
 #include "contiki.h"
+#include "sys/ctimer.h"
 #include "lib/sensors.h"
 #include "adc.h"
 #include "battery-sensor.h"
@@ -52,16 +53,80 @@
 static uint8_t ready = 0;
 static uint8_t initialized = 0;
 
+/* Averaged voltage in mV << BATTERY_SENSOR_CONF_CACHE_SHIFT, 0 = no sample yet */
+static uint32_t cached;
+static struct ctimer cache_timer;
+static clock_time_t cache_interval;
+
 const struct sensors_sensor battery_sensor;
 /*----------------------------------------------------------------------------*/
+static uint16_t
+read_channel(uint8_t chn)
+{
+  int16_t latest;
+
+  /* a single conversion would disturb a running scan */
+  if (adc_scan_running()) {
+    latest = adc_scan_latest(chn);
+    return (latest < 0) ? 0 : latest;
+  }
+  return adc_get_value_from(chn);
+}
+/*----------------------------------------------------------------------------*/
+static void
+cache_sample(void *ptr)
+{
+  uint16_t mv;
+
+  /* keep the ADC off between the samples if nobody else needs it */
+  if (!initialized && !adc_scan_running()) {
+    adc_init(ADC_SINGLE_CONVERSION, ADC_REF_2560MV_INT);
+    mv = adc_get_value_from(PWR_MONITOR_VCC_ADC) * BATTERY_SENSOR_V_SCALE;
+    adc_deinit();
+  } else {
+    mv = read_channel(PWR_MONITOR_VCC_ADC) * BATTERY_SENSOR_V_SCALE;
+  }
+
+  if (cached == 0) {
+    cached = (uint32_t) mv << BATTERY_SENSOR_CONF_CACHE_SHIFT;
+  } else {
+    cached = cached - (cached >> BATTERY_SENSOR_CONF_CACHE_SHIFT) + mv;
+  }
+
+  ctimer_set(&cache_timer, cache_interval, cache_sample, NULL);
+}
+/*----------------------------------------------------------------------------*/
+uint16_t
+battery_sensor_cached_voltage(void)
+{
+  return cached >> BATTERY_SENSOR_CONF_CACHE_SHIFT;
+}
+/*----------------------------------------------------------------------------*/
+uint8_t
+battery_sensor_residual_energy(void)
+{
+  uint16_t mv = battery_sensor_cached_voltage();
+
+  if (cached == 0 || mv >= BATTERY_SENSOR_CONF_FULL_MV) {
+    return 255;
+  }
+  if (mv <= BATTERY_SENSOR_CONF_EMPTY_MV) {
+    return 0;
+  }
+  return (uint32_t) (mv - BATTERY_SENSOR_CONF_EMPTY_MV) * 255
+          / (BATTERY_SENSOR_CONF_FULL_MV - BATTERY_SENSOR_CONF_EMPTY_MV);
+}
+/*----------------------------------------------------------------------------*/
 static int
 value(int type)
 {
   switch (type) {
+    case BATTERY_VOLTAGE_CACHED:
+      return battery_sensor_cached_voltage();
     case BATTERY_VOLTAGE:
-      return adc_get_value_from(PWR_MONITOR_VCC_ADC) * BATTERY_SENSOR_V_SCALE;
+      return read_channel(PWR_MONITOR_VCC_ADC) * BATTERY_SENSOR_V_SCALE;
     case BATTERY_CURRENT:
-      return adc_get_value_from(PWR_MONITOR_ICC_ADC) * BATTERY_SENSOR_I_SCALE;
+      return read_channel(PWR_MONITOR_ICC_ADC) * BATTERY_SENSOR_I_SCALE;
   }
   return 0;
 }
@@ -97,6 +162,16 @@ configure(int type, int c)
         return 1;
       }
       break;
+    case BATTERY_CONF_CACHE:
+      if (c) {
+        cache_interval = (clock_time_t) c * CLOCK_SECOND;
+        if (ctimer_expired(&cache_timer)) {
+          cache_sample(NULL);
+        }
+      } else {
+        ctimer_stop(&cache_timer);
+      }
+      return 1;
     default:
       return 0;
       break;
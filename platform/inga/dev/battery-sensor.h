@@ -53,6 +53,15 @@
  * - One provides battery current
  * A detailed list can be found at \ref batt_out_channels "Data Output Channels"
  *
+ * \section batt_cache Cached voltage
+ * Callers that ask often should not wake the ADC every time. After
+ * <code>battery_sensor.configure(BATTERY_CONF_CACHE, seconds)</code> the
+ * voltage is sampled once every interval and averaged.
+ * BATTERY_VOLTAGE_CACHED and battery_sensor_cached_voltage() return the
+ * average from RAM. With
+ * <code>#define RPL_CONF_RESIDUAL_ENERGY battery_sensor_residual_energy</code>
+ * in project-conf.h RPL includes it in the energy metric.
+ *
  * \section usage Example Usage
  *
 \code
@@ -71,6 +80,21 @@ int i = batterysensor.value(BATTERY_CURRENT);
 
 #include "lib/sensors.h"
 
+/** Weight of a new cached sample is 1 / 2^BATTERY_SENSOR_CONF_CACHE_SHIFT. */
+#ifndef BATTERY_SENSOR_CONF_CACHE_SHIFT
+#define BATTERY_SENSOR_CONF_CACHE_SHIFT 3
+#endif
+
+/** Voltage in mV treated as an empty battery by battery_sensor_residual_energy(). */
+#ifndef BATTERY_SENSOR_CONF_EMPTY_MV
+#define BATTERY_SENSOR_CONF_EMPTY_MV 2200
+#endif
+
+/** Voltage in mV treated as a full battery by battery_sensor_residual_energy(). */
+#ifndef BATTERY_SENSOR_CONF_FULL_MV
+#define BATTERY_SENSOR_CONF_FULL_MV 3000
+#endif
+
 extern const struct sensors_sensor battery_sensor;
 
 #define BATTERY_SENSOR "Batt"
@@ -84,8 +108,30 @@ extern const struct sensors_sensor battery_sensor;
 #define BATTERY_VOLTAGE   2
 /** Returns battery current im mA */
 #define BATTERY_CURRENT   3
+/** Returns the cached average battery voltage in mV, 0 before the first sample */
+#define BATTERY_VOLTAGE_CACHED 4
+/** @} */
+
+/**
+ * \name Configuration types
+ * @{ */
+/** Starts sampling the cached voltage every c seconds, stops it if c is 0 */
+#define BATTERY_CONF_CACHE 10
 /** @} */
 
+/**
+ * \return The cached average battery voltage in mV, 0 before the first sample
+ */
+uint16_t battery_sensor_cached_voltage(void);
+
+/**
+ * Maps the cached voltage between BATTERY_SENSOR_CONF_EMPTY_MV and
+ * BATTERY_SENSOR_CONF_FULL_MV linearly to 0 to 255.
+ *
+ * \return Residual energy, 255 before the first sample
+ */
+uint8_t battery_sensor_residual_energy(void);
+
 #endif	/* BATTERY_SENSOR_H */
 
 /** @} */
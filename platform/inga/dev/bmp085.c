@@ -39,6 +39,7 @@
  */
 
 #include "bmp085.h"
+#include "sys/ctimer.h"
 
 /*!
  * I2C address to read data
@@ -151,11 +152,25 @@ typedef struct {
  */
 static bmp085_calib_data bmp085_coeff;
 
-static uint8_t bmp085_read8bit_data(uint8_t addr);
 static uint16_t bmp085_read16bit_data(uint8_t addr);
 static void bmp085_read_calib_data(void);
-static int32_t bmp085_read_uncomp_pressure(uint8_t mode);
-static int32_t bmp085_read_uncomp_temperature(void);
+
+#define ASYNC_IDLE  0
+#define ASYNC_TEMP  1
+#define ASYNC_PRESS 2
+
+/*!
+ * State of the non-blocking measurement
+ */
+static struct {
+  struct ctimer timer;
+  void (*callback)(void);
+  int32_t b5;
+  int32_t pressure;
+  int16_t temperature;
+  uint8_t mode;
+  uint8_t state;
+} async;
 /*---------------------------------------------------------------------------*/
 int8_t
 bmp085_available(void)
@@ -163,6 +178,8 @@ bmp085_available(void)
   uint8_t i = 0;
 
   i2c_init();
+  /* Device supports I2C fast mode */
+  i2c_set_speed(BMP085_DEV_ADDR_W, 400000UL);
   while (bmp085_read16bit_data(BMP085_AC1_ADDR) == 0x00) {
     _delay_ms(10);
     if (i++ > 10) {
@@ -188,84 +205,85 @@ bmp085_deinit(void)
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+/*
+ * Conversion times in ms for the temperature and the four pressure modes.
+ */
+static const uint8_t conv_time[] = {5, 5, 8, 14, 26};
+static const uint8_t conv_ctrl[] = {
+  BMP085_CTRL_REG_TEMP,
+  BMP085_CTRL_REG_PRESS_0,
+  BMP085_CTRL_REG_PRESS_1,
+  BMP085_CTRL_REG_PRESS_2,
+  BMP085_CTRL_REG_PRESS_3
+};
+#define CONV_TEMP       0
+#define CONV_PRESS(m)   (1 + ((m) & 0x3))
+/*---------------------------------------------------------------------------*/
+static void
+bmp085_start_conversion(uint8_t conv)
+{
+  i2c_write_reg(BMP085_DEV_ADDR_W, BMP085_CTRL_REG_ADDR, conv_ctrl[conv]);
+}
+/*---------------------------------------------------------------------------*/
+static void
+bmp085_wait_conversion(uint8_t conv)
+{
+  uint8_t ms = conv_time[conv];
+  while (ms--) {
+    _delay_ms(1);
+  }
+}
+/*---------------------------------------------------------------------------*/
 static int32_t
-bmp085_read_uncomp_temperature(void)
+bmp085_fetch_uncomp_temperature(void)
 {
-  i2c_start(BMP085_DEV_ADDR_W);
-  i2c_write(BMP085_CTRL_REG_ADDR);
-  i2c_write(BMP085_CTRL_REG_TEMP);
-  i2c_stop();
-  _delay_ms(5);
   return (int32_t) (bmp085_read16bit_data(BMP085_DATA_REG_N));
 }
 /*---------------------------------------------------------------------------*/
 static int32_t
-bmp085_read_uncomp_pressure(uint8_t mode)
+bmp085_fetch_uncomp_pressure(uint8_t mode)
 {
   int32_t pressure;
-  i2c_start(BMP085_DEV_ADDR_W);
-  i2c_write(BMP085_CTRL_REG_ADDR);
-  switch (mode) {
-    case BMP085_ULTRA_LOW_POWER:
-      i2c_write(BMP085_CTRL_REG_PRESS_0);
-      i2c_stop();
-      _delay_ms(5);
-      break;
-    case BMP085_STANDARD:
-      i2c_write(BMP085_CTRL_REG_PRESS_1);
-      i2c_stop();
-      _delay_ms(8);
-      break;
-    case BMP085_HIGH_RESOLUTION:
-      i2c_write(BMP085_CTRL_REG_PRESS_2);
-      i2c_stop();
-      _delay_ms(14);
-      break;
-    case BMP085_ULTRA_HIGH_RES:
-      i2c_write(BMP085_CTRL_REG_PRESS_3);
-      i2c_stop();
-      _delay_ms(26);
-      break;
-  }
-  pressure = (int32_t) bmp085_read16bit_data(BMP085_DATA_REG_N) << 8;
-  pressure += bmp085_read8bit_data(BMP085_DATA_REG_X);
+  uint8_t buf[3] = {0};
+  // MSB, LSB and XLSB in one transfer
+  i2c_read_regs(BMP085_DEV_ADDR_W, BMP085_DATA_REG_N, buf, 3);
+  pressure = ((int32_t) buf[0] << 16) | ((uint16_t) buf[1] << 8) | buf[2];
   return (pressure >> (8 - mode));
 }
 /*---------------------------------------------------------------------------*/
-int16_t
-bmp085_read_temperature(void)
+static int32_t
+bmp085_read_uncomp_temperature(void)
 {
-  int32_t ut = 0;
-  int32_t x1, x2, b5;
-
-  ut = bmp085_read_uncomp_temperature();
+  bmp085_start_conversion(CONV_TEMP);
+  bmp085_wait_conversion(CONV_TEMP);
+  return bmp085_fetch_uncomp_temperature();
+}
+/*---------------------------------------------------------------------------*/
+static int32_t
+bmp085_read_uncomp_pressure(uint8_t mode)
+{
+  bmp085_start_conversion(CONV_PRESS(mode));
+  bmp085_wait_conversion(CONV_PRESS(mode));
+  return bmp085_fetch_uncomp_pressure(mode);
+}
+/*---------------------------------------------------------------------------*/
+static int32_t
+bmp085_calc_b5(int32_t ut)
+{
+  int32_t x1, x2;
 
   x1 = ((int32_t) ut - (int32_t) bmp085_coeff.ac6)
           * (int32_t) bmp085_coeff.ac5 >> 15;
   x2 = ((int32_t) bmp085_coeff.mc << 11) / (x1 + bmp085_coeff.md);
-  b5 = x1 + x2;
-
-  return (int16_t) ((b5 + 8) >> 4);
+  return x1 + x2;
 }
 /*---------------------------------------------------------------------------*/
-int32_t
-bmp085_read_pressure(uint8_t mode)
+static int32_t
+bmp085_calc_pressure(int32_t b5, int32_t up, uint8_t mode)
 {
-  int32_t ut = 0, compt = 0;
-  int32_t up = 0, compp = 0;
-
-  int32_t x1, x2, b5, b6, x3, b3, p;
+  int32_t x1, x2, b6, x3, b3, p;
   uint32_t b4, b7;
 
-  ut = bmp085_read_uncomp_temperature();
-  up = bmp085_read_uncomp_pressure(mode);
-
-  x1 = ((int32_t) ut - (int32_t) bmp085_coeff.ac6)
-          * (int32_t) bmp085_coeff.ac5 >> 15;
-  x2 = ((int32_t) bmp085_coeff.mc << 11) / (x1 + bmp085_coeff.md);
-  b5 = x1 + x2;
-  compt = (b5 + 8) >> 4;
-
   b6 = b5 - 4000;
   x1 = (bmp085_coeff.b2 * ((b6 * b6) >> 12)) >> 11;
   x2 = (bmp085_coeff.ac2 * b6) >> 11;
@@ -286,47 +304,126 @@ bmp085_read_pressure(uint8_t mode)
   x1 = (p >> 8) * (p >> 8);
   x1 = (x1 * 3038) >> 16;
   x2 = (-7357 * p) >> 16;
-  compp = p + ((x1 + x2 + 3791) >> 4);
-  return compp;
+  return p + ((x1 + x2 + 3791) >> 4);
+}
+/*---------------------------------------------------------------------------*/
+int16_t
+bmp085_read_temperature(void)
+{
+  int32_t b5 = bmp085_calc_b5(bmp085_read_uncomp_temperature());
+
+  return (int16_t) ((b5 + 8) >> 4);
+}
+/*---------------------------------------------------------------------------*/
+int32_t
+bmp085_read_pressure(uint8_t mode)
+{
+  int32_t b5 = bmp085_calc_b5(bmp085_read_uncomp_temperature());
+
+  return bmp085_calc_pressure(b5, bmp085_read_uncomp_pressure(mode), mode);
+}
+/*---------------------------------------------------------------------------*/
+int32_t
+bmp085_read_pressure_temp(uint8_t mode, int16_t *temperature)
+{
+  int32_t b5 = bmp085_calc_b5(bmp085_read_uncomp_temperature());
+
+  *temperature = (int16_t) ((b5 + 8) >> 4);
+  return bmp085_calc_pressure(b5, bmp085_read_uncomp_pressure(mode), mode);
+}
+/*---------------------------------------------------------------------------*/
+static clock_time_t
+conv_ticks(uint8_t conv)
+{
+  /* round up and add one tick, as the first tick may come at once */
+  return (conv_time[conv] * CLOCK_SECOND + 999) / 1000 + 1;
 }
 /*---------------------------------------------------------------------------*/
 static void
-bmp085_read_calib_data(void)
+async_step(void *ptr)
+{
+  switch (async.state) {
+    case ASYNC_TEMP:
+      async.b5 = bmp085_calc_b5(bmp085_fetch_uncomp_temperature());
+      async.temperature = (int16_t) ((async.b5 + 8) >> 4);
+      if (async.mode != BMP085_TEMP_ONLY) {
+        async.state = ASYNC_PRESS;
+        bmp085_start_conversion(CONV_PRESS(async.mode));
+        ctimer_set(&async.timer, conv_ticks(CONV_PRESS(async.mode)), async_step, NULL);
+        return;
+      }
+      break;
+    case ASYNC_PRESS:
+      async.pressure = bmp085_calc_pressure(async.b5,
+              bmp085_fetch_uncomp_pressure(async.mode), async.mode);
+      break;
+    default:
+      return;
+  }
+  async.state = ASYNC_IDLE;
+  if (async.callback != NULL) {
+    async.callback();
+  }
+}
+/*---------------------------------------------------------------------------*/
+int8_t
+bmp085_read_async(uint8_t mode, void (*callback)(void))
 {
-  bmp085_coeff.ac1 = bmp085_read16bit_data(BMP085_AC1_ADDR);
-  bmp085_coeff.ac2 = bmp085_read16bit_data(BMP085_AC2_ADDR);
-  bmp085_coeff.ac3 = bmp085_read16bit_data(BMP085_AC3_ADDR);
-  bmp085_coeff.ac4 = bmp085_read16bit_data(BMP085_AC4_ADDR);
-  bmp085_coeff.ac5 = bmp085_read16bit_data(BMP085_AC5_ADDR);
-  bmp085_coeff.ac6 = bmp085_read16bit_data(BMP085_AC6_ADDR);
-  bmp085_coeff.b1 = bmp085_read16bit_data(BMP085_B1_ADDR);
-  bmp085_coeff.b2 = bmp085_read16bit_data(BMP085_B2_ADDR);
-  bmp085_coeff.mb = bmp085_read16bit_data(BMP085_MB_ADDR);
-  bmp085_coeff.mc = bmp085_read16bit_data(BMP085_MC_ADDR);
-  bmp085_coeff.md = bmp085_read16bit_data(BMP085_MD_ADDR);
+  if (async.state != ASYNC_IDLE) {
+    return -1;
+  }
+  async.mode = mode;
+  async.callback = callback;
+  async.state = ASYNC_TEMP;
+  bmp085_start_conversion(CONV_TEMP);
+  ctimer_set(&async.timer, conv_ticks(CONV_TEMP), async_step, NULL);
+  return 0;
 }
 /*---------------------------------------------------------------------------*/
-static uint16_t
-bmp085_read16bit_data(uint8_t addr)
+uint8_t
+bmp085_async_busy(void)
+{
+  return async.state != ASYNC_IDLE;
+}
+/*---------------------------------------------------------------------------*/
+int16_t
+bmp085_async_temperature(void)
 {
-  uint8_t msb = 0, lsb = 0;
-  i2c_start(BMP085_DEV_ADDR_W);
-  i2c_write(addr);
-  i2c_rep_start(BMP085_DEV_ADDR_R);
-  i2c_read_ack(&msb);
-  i2c_read_nack(&lsb);
-  i2c_stop();
-  return (uint16_t) ((msb << 8) | lsb);
+  return async.temperature;
 }
 /*---------------------------------------------------------------------------*/
-static uint8_t
-bmp085_read8bit_data(uint8_t addr)
+int32_t
+bmp085_async_pressure(void)
+{
+  return async.pressure;
+}
+/*---------------------------------------------------------------------------*/
+static void
+bmp085_read_calib_data(void)
+{
+  uint8_t buf[BMP085_MD_ADDR + 2 - BMP085_AC1_ADDR];
+
+  // all 11 big endian coefficients (AC1..MD) in one transfer
+  i2c_read_regs(BMP085_DEV_ADDR_W, BMP085_AC1_ADDR, buf, sizeof (buf));
+#define BMP085_COEFF(a) ((buf[(a) - BMP085_AC1_ADDR] << 8) | buf[(a) + 1 - BMP085_AC1_ADDR])
+  bmp085_coeff.ac1 = BMP085_COEFF(BMP085_AC1_ADDR);
+  bmp085_coeff.ac2 = BMP085_COEFF(BMP085_AC2_ADDR);
+  bmp085_coeff.ac3 = BMP085_COEFF(BMP085_AC3_ADDR);
+  bmp085_coeff.ac4 = BMP085_COEFF(BMP085_AC4_ADDR);
+  bmp085_coeff.ac5 = BMP085_COEFF(BMP085_AC5_ADDR);
+  bmp085_coeff.ac6 = BMP085_COEFF(BMP085_AC6_ADDR);
+  bmp085_coeff.b1 = BMP085_COEFF(BMP085_B1_ADDR);
+  bmp085_coeff.b2 = BMP085_COEFF(BMP085_B2_ADDR);
+  bmp085_coeff.mb = BMP085_COEFF(BMP085_MB_ADDR);
+  bmp085_coeff.mc = BMP085_COEFF(BMP085_MC_ADDR);
+  bmp085_coeff.md = BMP085_COEFF(BMP085_MD_ADDR);
+#undef BMP085_COEFF
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+bmp085_read16bit_data(uint8_t addr)
 {
-  uint8_t lsb = 0;
-  i2c_start(BMP085_DEV_ADDR_W);
-  i2c_write(addr);
-  i2c_rep_start(BMP085_DEV_ADDR_R);
-  i2c_read_nack(&lsb);
-  i2c_stop();
-  return lsb;
+  uint8_t buf[2] = {0};
+  i2c_read_regs(BMP085_DEV_ADDR_W, addr, buf, 2);
+  return (uint16_t) ((buf[0] << 8) | buf[1]);
 }
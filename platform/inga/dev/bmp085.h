@@ -96,6 +96,8 @@ int16_t bmp085_read_temperature(void);
 #define BMP085_HIGH_RESOLUTION 2
 /// Ultra high resolution mode
 #define BMP085_ULTRA_HIGH_RES  3
+/// Temperature only, for bmp085_read_async()
+#define BMP085_TEMP_ONLY       0xFF
 /** @}*/
 
 /**
@@ -112,6 +114,46 @@ int16_t bmp085_read_temperature(void);
  */
 int32_t bmp085_read_pressure(uint8_t mode);
 
+/**
+ * \brief Reads the pressure and the temperature it was compensated with
+ *
+ * \param mode        Operation mode, see bmp085_read_pressure()
+ * \param temperature Returns the temperature in 0.1 Degree
+ * \return Pressure in Pa
+ */
+int32_t bmp085_read_pressure_temp(uint8_t mode, int16_t *temperature);
+
+/**
+ * \brief Starts a non-blocking temperature and pressure measurement
+ *
+ * The conversion times are waited for with a ctimer instead of a busy
+ * delay. When both values are compensated, \p callback is called from
+ * the ctimer process. The results are then available with
+ * bmp085_async_temperature() and bmp085_async_pressure().
+ *
+ * \param mode     Pressure operation mode, or \ref BMP085_TEMP_ONLY
+ * \param callback Called when done, may be NULL
+ * \retval 0  measurement started
+ * \retval -1 a measurement is still running
+ */
+int8_t bmp085_read_async(uint8_t mode, void (*callback)(void));
+
+/**
+ * \brief Checks if a non-blocking measurement is running
+ * \return 1 if running, otherwise 0
+ */
+uint8_t bmp085_async_busy(void);
+
+/**
+ * \return Temperature in 0.1 Degree of the last non-blocking measurement
+ */
+int16_t bmp085_async_temperature(void);
+
+/**
+ * \return Pressure in Pa of the last non-blocking measurement
+ */
+int32_t bmp085_async_pressure(void);
+
 #endif /* PRESSUREBMP085_H_ */
 
 /** @} */
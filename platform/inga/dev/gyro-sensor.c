@@ -39,11 +39,34 @@
 #include "lib/sensors.h"
 #include "l3g4200d.h"
 #include "gyro-sensor.h"
+#include <avr/interrupt.h>
+
+/* L3G4200D DRDY/INT2 pin, a pin change interrupt. May be overridden as a whole. */
+#ifndef GYRO_INT_vect
+#define GYRO_INT_vect     PCINT3_vect
+#define GYRO_INT_PCMSK    PCMSK3
+#define GYRO_INT_PCIE     PCIE3
+#define GYRO_INT_DDR      DDRD
+#define GYRO_INT_PIN      PIND
+#define GYRO_INT_P        PD7
+#endif
+
 const struct sensors_sensor gyro_sensor;
 static uint8_t initialized = 0;
+#if INGA_LAZY_SENSORS
+/* Not probed yet */
+#define READY_UNKNOWN 0xff
+static uint8_t ready = READY_UNKNOWN;
+#else
 static uint8_t ready = 0;
+#endif
 #define raw_to_dps(raw) TODO
 static angle_data_t gyro_data;
+
+PROCESS(gyro_stream_process, "Gyro stream");
+
+static struct gyro_batch batches[2];
+static struct gyro_batch *last_batch;
 /*---------------------------------------------------------------------------*/
 static void
 cond_update_gyro_data(int ch)
@@ -62,47 +85,137 @@ cond_update_gyro_data(int ch)
   gyro_data_obsolete_vec |= (1 << ch);
 }
 /*---------------------------------------------------------------------------*/
+ISR(GYRO_INT_vect)
+{
+  if (GYRO_INT_PIN & (1 << GYRO_INT_P)) {
+    process_poll(&gyro_stream_process);
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(gyro_stream_process, ev, data)
+{
+  struct gyro_batch *batch;
+
+  PROCESS_BEGIN();
+
+  while (1) {
+    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
+
+    batch = (last_batch == &batches[0]) ? &batches[1] : &batches[0];
+    batch->overrun = l3g4200d_fifo_overrun() ? 1 : 0;
+    batch->timestamp = RTIMER_NOW();
+    batch->count = l3g4200d_get_angle_fifo(batch->samples);
+    if (batch->count > 0) {
+      last_batch = batch;
+      sensors_changed(&gyro_sensor);
+    }
+    /* new samples may have reached the watermark during the readout */
+    if (GYRO_INT_PIN & (1 << GYRO_INT_P)) {
+      process_poll(&gyro_stream_process);
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+const struct gyro_batch *
+gyro_sensor_batch(void)
+{
+  return last_batch;
+}
+/*---------------------------------------------------------------------------*/
+static void
+stream_start(uint8_t watermark)
+{
+  last_batch = NULL;
+  if (!process_is_running(&gyro_stream_process)) {
+    process_start(&gyro_stream_process, NULL);
+  }
+  l3g4200d_fifo_enable();
+  l3g4200d_set_fifomode(L3G4200D_STREAM);
+  l3g4200d_set_watermark_int(watermark);
+
+  GYRO_INT_DDR &= ~(1 << GYRO_INT_P);
+  GYRO_INT_PCMSK |= (1 << GYRO_INT_P);
+  PCICR |= (1 << GYRO_INT_PCIE);
+  /* FIFO may already be above the watermark */
+  process_poll(&gyro_stream_process);
+}
+/*---------------------------------------------------------------------------*/
+static void
+stream_stop(void)
+{
+  GYRO_INT_PCMSK &= ~(1 << GYRO_INT_P);
+  l3g4200d_set_watermark_int(0);
+  l3g4200d_set_fifomode(L3G4200D_BYPASS);
+  l3g4200d_write8bit(L3G4200D_CTRL_REG5,
+          l3g4200d_read8bit(L3G4200D_CTRL_REG5) & ~(1 << L3G4200D_FIFO_EN));
+}
+/*---------------------------------------------------------------------------*/
 static int
-value(int type)
+convert(const angle_data_t *data, int type)
 {
   switch (type) {
     case GYRO_X:
-      cond_update_gyro_data(GYRO_X);
-      return l3g4200d_raw_to_dps(gyro_data.x);
-
+      return l3g4200d_raw_to_dps(data->x);
     case GYRO_Y:
-      cond_update_gyro_data(GYRO_Y);
-      return l3g4200d_raw_to_dps(gyro_data.y);
-
+      return l3g4200d_raw_to_dps(data->y);
     case GYRO_Z:
-      cond_update_gyro_data(GYRO_Z);
-      return l3g4200d_raw_to_dps(gyro_data.z);
-
+      return l3g4200d_raw_to_dps(data->z);
     case GYRO_X_RAW:
-      cond_update_gyro_data(GYRO_X_RAW);
-      return gyro_data.x;
-
+      return data->x;
     case GYRO_Y_RAW:
-      cond_update_gyro_data(GYRO_Y_RAW);
-      return gyro_data.y;
-
+      return data->y;
     case GYRO_Z_RAW:
-      cond_update_gyro_data(GYRO_Z_RAW);
-      return gyro_data.z;
-
-    case GYRO_TEMP:
-      return l3g4200d_get_temp();
+      return data->z;
   }
   return 0;
 }
 /*---------------------------------------------------------------------------*/
 static int
+value(int type)
+{
+  if (type == GYRO_TEMP) {
+    return l3g4200d_get_temp();
+  }
+  if (type < GYRO_X || type > GYRO_Z_RAW) {
+    return 0;
+  }
+  cond_update_gyro_data(type);
+  return convert(&gyro_data, type);
+}
+/*---------------------------------------------------------------------------*/
+static int
+read_block(unsigned type_mask, int16_t *out)
+{
+  angle_data_t data = {0, 0, 0};
+  int type;
+  int n = 0;
+
+  /* only read the angles if any of them is requested */
+  if (type_mask & ~(1U << GYRO_TEMP)) {
+    data = l3g4200d_get_angle();
+  }
+  for (type = 0; type < 16; type++) {
+    if (type_mask & (1U << type)) {
+      out[n++] = (type == GYRO_TEMP) ? l3g4200d_get_temp() : convert(&data, type);
+    }
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+static int
 status(int type)
 {
   switch (type) {
     case SENSORS_ACTIVE:
       return initialized;
     case SENSORS_READY:
+#if INGA_LAZY_SENSORS
+      if (ready == READY_UNKNOWN) {
+        ready = l3g4200d_available();
+      }
+#endif
       return ready;
   }
   return 0;
@@ -115,6 +228,10 @@ configure(int type, int c)
   switch (type) {
 
     case SENSORS_HW_INIT:
+#if INGA_LAZY_SENSORS
+      ready = READY_UNKNOWN;
+      return 1;
+#else
       if (l3g4200d_available()) {
         ready = 1;
         return 1;
@@ -122,14 +239,22 @@ configure(int type, int c)
         ready = 0;
         return 0;
       }
+#endif
       break;
 
     case SENSORS_ACTIVE:
       if (c) {
         if (l3g4200d_init() == 0) {
           initialized = 1;
+#if INGA_LAZY_SENSORS
+          /* l3g4200d_init() probes the device */
+          ready = 1;
+#endif
           return 1;
         }
+#if INGA_LAZY_SENSORS
+        ready = 0;
+#endif
       } else {
         if (l3g4200d_deinit() == 0) {
           initialized = 0;
@@ -170,8 +295,19 @@ configure(int type, int c)
       }
       return (l3g4200d_set_data_rate(value) == 0) ? 1 : 0;
 
+    case GYRO_CONF_STREAM:
+      if (c < 0 || c > 31) {
+        return 0;
+      }
+      if (c) {
+        stream_start(c);
+      } else {
+        stream_stop();
+      }
+      return 1;
+
   }
   return 0;
 }
 /*---------------------------------------------------------------------------*/
-SENSORS_SENSOR(gyro_sensor, GYRO_SENSOR, value, configure, status);
+SENSORS_SENSOR_BLOCK(gyro_sensor, GYRO_SENSOR, value, configure, status, read_block);
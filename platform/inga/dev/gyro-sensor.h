@@ -92,10 +92,33 @@ int z = gyrosensor.value(GYRO_Z);
 #ifndef __GYRO_SENSOR_H__
 #define __GYRO_SENSOR_H__
 
+#include "contiki.h"
 #include "lib/sensors.h"
+#include "l3g4200d.h"
 
 extern const struct sensors_sensor gyro_sensor;
 
+/** A batch of samples read from the FIFO in streaming mode. */
+struct gyro_batch {
+  /** rtimer time right before the readout, i.e. of the newest sample */
+  rtimer_clock_t timestamp;
+  /** Number of valid samples */
+  uint8_t count;
+  /** Nonzero if the FIFO overran and samples were lost before this batch */
+  uint8_t overrun;
+  /** Raw samples, oldest first */
+  angle_data_t samples[L3G4200D_FIFO_SIZE];
+};
+
+/**
+ * Returns the most recent batch in streaming mode.
+ *
+ * The batch is valid until the next but one sensors event of the
+ * gyro sensor.
+ * @return Latest batch or NULL if none was read yet
+ */
+const struct gyro_batch *gyro_sensor_batch(void);
+
 #define GYRO_SENSOR "Gyro"
 
 /** 
@@ -127,6 +150,13 @@ extern const struct sensors_sensor gyro_sensor;
  * Allowed values can be found in \ref rate_val "DATA_RATE Values"
  */
 #define GYRO_CONF_DATA_RATE    20
+/** Configures streaming mode.
+ * A value of 1 to 31 enables the FIFO in stream mode with this watermark.
+ * Each watermark interrupt triggers a readout of the whole FIFO into
+ * a batch, followed by a sensors event (see gyro_sensor_batch()).
+ * A value of 0 stops streaming and sets bypass mode.
+ */
+#define GYRO_CONF_STREAM       30
 /** @} */
 
 
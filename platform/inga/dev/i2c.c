@@ -45,31 +45,119 @@
  * @{
  */
 
+#include <avr/interrupt.h>
+#include <util/delay.h>
 #include "i2c.h"
+#include "sys/energest.h"
+#include "isr-stats.h"
 
 #ifndef PRR
 #define PRR PRR0
 #endif
-void
-i2c_init(void) {
-  TWSR &= ~((1 << TWPS1) | (1 << TWPS0));
+
+#define TWCR_ASYNC ((1 << TWINT) | (1 << TWEN) | (1 << TWIE))
+
+process_event_t i2c_event;
+
+PROCESS(i2c_process, "I2C process");
+
+/* Running transaction, followed by the rest of the queue */
+static struct i2c_transaction *volatile i2c_head;
+static struct i2c_transaction *i2c_tail;
+/* Completed transactions, waiting for delivery by i2c_process */
+static struct i2c_transaction *volatile i2c_done;
+/* Byte position in the current write or read phase */
+static uint8_t i2c_pos;
+/* Set by the ISR if a queued transaction ended with a bus error */
+static volatile uint8_t i2c_bus_error;
+
 #if I2C_HIGH_SPEED
-  TWBR = 2; //400KHz
+#define I2C_DEFAULT_TWBR 2 //400KHz
 #else
-  TWBR = 32; //100KHz
+#define I2C_DEFAULT_TWBR 32 //100KHz
 #endif
 
+/* Bus rates of single slaves, addr 0 marks unused entries */
+static struct {
+  uint8_t addr;
+  uint8_t twbr;
+} i2c_speeds[I2C_SPEED_ENTRIES];
+
+static void i2c_release(void);
+void
+i2c_init(void) {
+  TWSR &= ~((1 << TWPS1) | (1 << TWPS0));
+  TWBR = I2C_DEFAULT_TWBR;
+}
+/*----------------------------------------------------------------------------*/
+/* Returns the TWBR value for transactions with the given slave. */
+static uint8_t
+i2c_twbr(uint8_t addr) {
+  uint8_t i;
+
+  addr &= 0xFE;
+  for (i = 0; i < I2C_SPEED_ENTRIES; i++) {
+    if (i2c_speeds[i].addr == addr) {
+      return i2c_speeds[i].twbr;
+    }
+  }
+  return I2C_DEFAULT_TWBR;
+}
+/*----------------------------------------------------------------------------*/
+int8_t
+i2c_set_speed(uint8_t addr, uint32_t scl_hz) {
+  uint32_t twbr;
+  uint8_t i, free = I2C_SPEED_ENTRIES;
+
+  /* SCL = F_CPU / (16 + 2 * TWBR) with prescaler 1 */
+  twbr = (F_CPU + scl_hz - 1) / scl_hz;
+  twbr = (twbr > 16) ? (twbr - 16 + 1) / 2 : 0;
+  if (twbr > 0xFF) {
+    twbr = 0xFF;
+  }
+
+  addr &= 0xFE;
+  for (i = 0; i < I2C_SPEED_ENTRIES; i++) {
+    if (i2c_speeds[i].addr == addr) {
+      break;
+    }
+    if (i2c_speeds[i].addr == 0 && free == I2C_SPEED_ENTRIES) {
+      free = i;
+    }
+  }
+  if (i == I2C_SPEED_ENTRIES) {
+    if (free == I2C_SPEED_ENTRIES) {
+      return -1;
+    }
+    i = free;
+  }
+
+  i2c_speeds[i].twbr = (uint8_t) twbr;
+  i2c_speeds[i].addr = addr;
+  return 0;
 }
 /*----------------------------------------------------------------------------*/
 int8_t
 _i2c_start(uint8_t addr, uint8_t rep) {
   uint16_t i = 0;
+  uint8_t recovered = 0;
 
+retry:
   PRR &= ~(1 << PRTWI);
+  ENERGEST_SWITCH_ON(ENERGEST_TYPE_I2C);
   i2c_init();
+  TWBR = i2c_twbr(addr);
   TWCR = (1 << TWINT) | (1 << TWSTA) | (1 << TWEN);
   while (!(TWCR & (1 << TWINT))) {
     if( i++ > 800 ) {
+      /* A slave holding SDA low prevents the START */
+      if (!rep && !recovered) {
+        recovered = 1;
+        i = 0;
+        if (i2c_recover() == 0) {
+          goto retry;
+        }
+      }
       return -3;
     }
   }
@@ -146,6 +234,39 @@ i2c_read_nack(uint8_t *data) {
   return i2c_read(data, 0);
 }
 /*----------------------------------------------------------------------------*/
+int8_t
+i2c_read_regs(uint8_t addr, uint8_t reg, uint8_t *buf, uint8_t len) {
+  int8_t ret;
+
+  if ((ret = i2c_start(addr)) != 0
+          || (ret = i2c_write(reg)) != 0
+          || (ret = i2c_rep_start(addr | 1)) != 0) {
+    i2c_stop();
+    return ret;
+  }
+  while (len-- > 1) {
+    if ((ret = i2c_read_ack(buf++)) != 0) {
+      i2c_stop();
+      return ret;
+    }
+  }
+  ret = i2c_read_nack(buf);
+  i2c_stop();
+  return ret;
+}
+/*----------------------------------------------------------------------------*/
+int8_t
+i2c_write_reg(uint8_t addr, uint8_t reg, uint8_t data) {
+  int8_t ret;
+
+  if ((ret = i2c_start(addr)) == 0
+          && (ret = i2c_write(reg)) == 0) {
+    ret = i2c_write(data);
+  }
+  i2c_stop();
+  return ret;
+}
+/*----------------------------------------------------------------------------*/
 void
 i2c_stop(void) {
   uint16_t i = 0;
@@ -160,7 +281,233 @@ i2c_stop(void) {
   TWCR &= ~(1 << TWEN);
 
   PRR |= (1 << PRTWI);
+  ENERGEST_OFF(ENERGEST_TYPE_I2C);
+  DDRC &= ~((1 << PC0) | (1 << PC1));
+  PORTC |= ((1 << PC0) | (1 << PC1));
+
+}
+/*----------------------------------------------------------------------------*/
+static void
+i2c_release(void) {
+  uint16_t i = 0;
+
+  while (TWCR & (1 << TWSTO)) {
+    if (i++ > 800) {
+      break;
+    }
+  }
+
+  TWCR &= ~(1 << TWEN);
+
+  PRR |= (1 << PRTWI);
+  ENERGEST_OFF(ENERGEST_TYPE_I2C);
   DDRC &= ~((1 << PC0) | (1 << PC1));
   PORTC |= ((1 << PC0) | (1 << PC1));
+}
+/*----------------------------------------------------------------------------*/
+/* Drives an I2C line low or releases it to the pull-up. */
+#define I2C_LINE_LOW(pin)     {PORTC &= ~(1 << (pin)); DDRC |= (1 << (pin));}
+#define I2C_LINE_RELEASE(pin) {DDRC &= ~(1 << (pin)); PORTC |= (1 << (pin));}
+/* Half of a SCL period at 100 kHz */
+#define I2C_RECOVER_DELAY()   _delay_us(5)
+
+int8_t
+i2c_recover(void) {
+  uint8_t i;
+
+  i2c_release();
+  I2C_RECOVER_DELAY();
+
+  /* Clock the slave through the rest of the byte it is sending */
+  for (i = 0; i < 9 && !(PINC & (1 << PC1)); i++) {
+    I2C_LINE_LOW(PC0);
+    I2C_RECOVER_DELAY();
+    I2C_LINE_RELEASE(PC0);
+    I2C_RECOVER_DELAY();
+  }
+
+  /* STOP: SDA rises while SCL is high */
+  I2C_LINE_LOW(PC0);
+  I2C_RECOVER_DELAY();
+  I2C_LINE_LOW(PC1);
+  I2C_RECOVER_DELAY();
+  I2C_LINE_RELEASE(PC0);
+  I2C_RECOVER_DELAY();
+  I2C_LINE_RELEASE(PC1);
+  I2C_RECOVER_DELAY();
+
+  return (PINC & (1 << PC1)) ? 0 : -1;
+}
+/*----------------------------------------------------------------------------*/
+/* Completes the current transaction, called from the ISR. */
+static void
+i2c_finish(int8_t status) {
+  struct i2c_transaction *t = i2c_head;
+  struct i2c_transaction **d;
+
+  t->status = status;
+  if (status == I2C_ERR_BUS) {
+    i2c_bus_error = 1;
+  }
+  i2c_head = t->next;
+  t->next = NULL;
+  for (d = (struct i2c_transaction **) &i2c_done; *d != NULL; d = &(*d)->next);
+  *d = t;
+
+  if (i2c_head != NULL) {
+    /* STOP followed by START for the next transaction, both at the
+     * rate of the slower slave */
+    if (i2c_twbr(i2c_head->addr) > TWBR) {
+      TWBR = i2c_twbr(i2c_head->addr);
+    }
+    TWCR = TWCR_ASYNC | (1 << TWSTO) | (1 << TWSTA);
+  } else {
+    TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWSTO);
+  }
+  process_poll(&i2c_process);
+}
+/*----------------------------------------------------------------------------*/
+ISR(TWI_vect) {
+  struct i2c_transaction *t = i2c_head;
+  ISR_STATS_ENTER(ISR_STATS_TWI);
+
+  if (t == NULL) {
+    TWCR = (1 << TWINT) | (1 << TWEN);
+    ISR_STATS_EXIT(ISR_STATS_TWI);
+    return;
+  }
+
+  switch (TWSR & 0xF8) {
+    case I2C_START:
+      i2c_pos = 0;
+      TWBR = i2c_twbr(t->addr);
+      TWDR = t->wlen ? t->addr : (t->addr | 1);
+      TWCR = TWCR_ASYNC;
+      break;
+    case I2C_REP_START:
+      i2c_pos = 0;
+      TWDR = t->addr | 1;
+      TWCR = TWCR_ASYNC;
+      break;
+    case I2C_MT_SLA_ACK:
+    case I2C_MT_DATA_ACK:
+      if (i2c_pos < t->wlen) {
+        TWDR = t->wbuf[i2c_pos++];
+        TWCR = TWCR_ASYNC;
+      } else if (t->rlen) {
+        TWCR = TWCR_ASYNC | (1 << TWSTA);
+      } else {
+        i2c_finish(I2C_OK);
+      }
+      break;
+    case I2C_MR_DATA_ACK:
+      t->rbuf[i2c_pos++] = TWDR;
+      /* fall through */
+    case I2C_MR_SLA_ACK:
+      /* ACK all bytes but the last one */
+      TWCR = TWCR_ASYNC | ((i2c_pos + 1 < t->rlen) ? (1 << TWEA) : 0);
+      break;
+    case I2C_MR_DATA_NACK:
+      t->rbuf[i2c_pos] = TWDR;
+      i2c_finish(I2C_OK);
+      break;
+    case 0x38:
+      /* Arbitration lost, keep the bus released */
+      i2c_finish(I2C_ERR_BUS);
+      break;
+    case 0x20: /* MT SLA+W NACK */
+    case 0x30: /* MT data NACK */
+    case 0x48: /* MR SLA+R NACK */
+      i2c_finish(I2C_ERR_NACK);
+      break;
+    default:
+      i2c_finish(I2C_ERR_BUS);
+      break;
+  }
+  ISR_STATS_EXIT(ISR_STATS_TWI);
+}
+/*----------------------------------------------------------------------------*/
+int8_t
+i2c_queue(struct i2c_transaction *t) {
+  uint8_t sreg;
+
+  if (t->wlen == 0 && t->rlen == 0) {
+    return -1;
+  }
+
+  if (!process_is_running(&i2c_process)) {
+    i2c_event = process_alloc_event();
+    process_start(&i2c_process, NULL);
+  }
+
+  t->next = NULL;
+  t->status = I2C_PENDING;
+
+  sreg = SREG;
+  cli();
+  if (i2c_head == NULL) {
+    i2c_head = i2c_tail = t;
+    PRR &= ~(1 << PRTWI);
+    ENERGEST_SWITCH_ON(ENERGEST_TYPE_I2C);
+    i2c_init();
+    TWBR = i2c_twbr(t->addr);
+    TWCR = TWCR_ASYNC | (1 << TWSTA);
+  } else {
+    i2c_tail->next = t;
+    i2c_tail = t;
+  }
+  SREG = sreg;
+
+  return 0;
+}
+/*----------------------------------------------------------------------------*/
+uint8_t
+i2c_busy(void) {
+  return i2c_head != NULL;
+}
+/*----------------------------------------------------------------------------*/
+PROCESS_THREAD(i2c_process, ev, data) {
+  struct i2c_transaction *t;
+  uint8_t sreg;
+  uint8_t recover;
+
+  PROCESS_BEGIN();
+
+  while (1) {
+    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
+
+    while (1) {
+      recover = 0;
+      sreg = SREG;
+      cli();
+      t = i2c_done;
+      if (t != NULL) {
+        i2c_done = t->next;
+        t->next = NULL;
+      } else if (i2c_head == NULL && i2c_bus_error) {
+        /* A slave may still hold SDA low, recover with interrupts enabled */
+        i2c_bus_error = 0;
+        recover = 1;
+      } else if (i2c_head == NULL && (TWCR & (1 << TWEN))) {
+        /* Queue drained, power down the TWI */
+        i2c_release();
+      }
+      SREG = sreg;
+
+      if (recover) {
+        i2c_recover();
+      }
+
+      if (t == NULL) {
+        break;
+      }
+      if (t->callback != NULL) {
+        t->callback(t);
+      } else if (t->process != NULL) {
+        process_post(t->process, i2c_event, t);
+      }
+    }
+  }
 
+  PROCESS_END();
 }
@@ -45,6 +45,7 @@
  */
 
 #include <avr/io.h>
+#include "contiki.h"
 
 #ifndef I2CDRV_H_
 #define I2CDRV_H_
@@ -52,6 +53,12 @@
 
 #define I2C_HIGH_SPEED	 0
 
+/** Number of slaves that can have their own bus speed */
+#ifdef I2C_CONF_SPEED_ENTRIES
+#define I2C_SPEED_ENTRIES I2C_CONF_SPEED_ENTRIES
+#else
+#define I2C_SPEED_ENTRIES 4
+#endif
 
 #define I2C_START        0x08
 #define I2C_REP_START    0x10
@@ -61,6 +68,50 @@
 #define I2C_MR_DATA_ACK  0x50
 #define I2C_MR_DATA_NACK 0x58
 
+/** Transaction is queued or running */
+#define I2C_PENDING      1
+/** Transaction completed */
+#define I2C_OK           0
+/** Slave did not acknowledge its address or a data byte */
+#define I2C_ERR_NACK     -1
+/** Arbitration lost or unexpected bus state */
+#define I2C_ERR_BUS      -2
+
+struct i2c_transaction;
+
+/** Completion callback, called from process context */
+typedef void (*i2c_callback_t)(struct i2c_transaction *t);
+
+/**
+ * \brief Asynchronous I2C transaction.
+ *
+ * The engine first sends \a wlen bytes of \a wbuf to the slave, then
+ * reads \a rlen bytes into \a rbuf. If both are given, the read
+ * follows after a repeated start.
+ * Thus a register write is wbuf = {reg, data...} with rlen = 0, and a
+ * burst read is wbuf = {reg} with rlen = N.
+ *
+ * The structure and both buffers must stay valid until completion.
+ * On completion \a status is set, then \a callback is called or, if
+ * it is NULL, \a process receives i2c_event with the transaction as
+ * data.
+ */
+struct i2c_transaction {
+  struct i2c_transaction *next;
+  /** Slave address including R/W bit 0, as for i2c_start() */
+  uint8_t addr;
+  uint8_t *wbuf;
+  uint8_t wlen;
+  uint8_t *rbuf;
+  uint8_t rlen;
+  volatile int8_t status;
+  i2c_callback_t callback;
+  struct process *process;
+};
+
+/** Event posted on completion of a transaction without callback */
+extern process_event_t i2c_event;
+
 
 void i2c_init(void);
 void i2c_stop(void);
@@ -72,6 +123,69 @@ int8_t i2c_read(uint8_t *data, uint8_t ack);
 int8_t i2c_read_ack(uint8_t *data);
 int8_t i2c_read_nack(uint8_t *data);
 
+/**
+ * \brief Reads consecutive bytes starting at a register of a slave.
+ *
+ * Sends the register address followed by a repeated start and reads
+ * all bytes in a single transaction. Devices with an auto increment
+ * flag need it to be set in \a reg.
+ *
+ * \param addr Slave write address, as for i2c_start()
+ * \param reg  First register to read
+ * \param buf  Buffer to store the read bytes
+ * \param len  Number of bytes to read, at least 1
+ * \return 0 on success, negative on bus errors
+ */
+int8_t i2c_read_regs(uint8_t addr, uint8_t reg, uint8_t *buf, uint8_t len);
+
+/**
+ * \brief Writes a single register of a slave.
+ * \param addr Slave write address, as for i2c_start()
+ * \param reg  Register to write
+ * \param data Value to write
+ * \return 0 on success, negative on bus errors
+ */
+int8_t i2c_write_reg(uint8_t addr, uint8_t reg, uint8_t data);
+
+/**
+ * \brief Queues a transaction for the interrupt driven engine.
+ *
+ * Returns immediately. Transactions run in queue order.
+ * The polled functions above must not be used while
+ * i2c_busy() returns true.
+ *
+ * \return 0 if queued, -1 if the transaction is empty
+ */
+int8_t i2c_queue(struct i2c_transaction *t);
+
+/** \return Nonzero while queued transactions are pending */
+uint8_t i2c_busy(void);
+
+/**
+ * \brief Sets the SCL rate used for transactions with a slave.
+ *
+ * Slaves without an own rate use 400 kHz if I2C_HIGH_SPEED is set,
+ * 100 kHz otherwise. When switching from a fast to a slow slave,
+ * the STOP and START conditions in between use the slower rate.
+ *
+ * \param addr Slave address, the R/W bit is ignored
+ * \param scl_hz SCL rate in Hz, rounded down to the next possible rate
+ * \return 0 on success, -1 if all I2C_SPEED_ENTRIES are in use
+ */
+int8_t i2c_set_speed(uint8_t addr, uint32_t scl_hz);
+
+/**
+ * \brief Frees a bus whose SDA line is held low by a slave.
+ *
+ * Disables the TWI and clocks SCL up to 9 times until the slave
+ * releases SDA, then generates a STOP condition. Called automatically
+ * if a START can not be generated or a queued transaction ended with
+ * I2C_ERR_BUS. Must not be called while i2c_busy() returns true.
+ *
+ * \return 0 if the bus is free, -1 if SDA is still low
+ */
+int8_t i2c_recover(void);
+
 
 #endif /* I2CDRV_H_ */
 
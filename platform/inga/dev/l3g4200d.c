@@ -59,6 +59,8 @@ l3g4200d_available(void)
   uint8_t tries = 0;
 
   i2c_init();
+  /* Device supports I2C fast mode */
+  i2c_set_speed(L3G4200D_DEV_ADDR_W, 400000UL);
   while (l3g4200d_read8bit(L3G4200D_WHO_AM_I_REG) != L3G4200D_WHO_AM_I) {
     _delay_ms(10);
     if (tries++ > 10) {
@@ -150,32 +152,45 @@ angle_data_t
 l3g4200d_get_angle(void)
 {
   angle_data_t ret_data;
-  uint8_t lsb = 0, msb = 0;
-  i2c_start(L3G4200D_DEV_ADDR_W);
-  i2c_write((L3G4200D_OUT_X_L | 0x80));
-  i2c_rep_start(L3G4200D_DEV_ADDR_R);
-  i2c_read_ack(&lsb);
-  i2c_read_ack(&msb);
-  ret_data.x = (uint16_t) ((msb << 8) + lsb);
-  i2c_read_ack(&lsb);
-  i2c_read_ack(&msb);
-  ret_data.y = (uint16_t) ((msb << 8) + lsb);
-  i2c_read_ack(&lsb);
-  i2c_read_nack(&msb);
-  ret_data.z = (uint16_t) ((msb << 8) + lsb);
-  i2c_stop();
+  uint8_t buf[6] = {0};
+  // OUT_X_L..OUT_Z_H with auto increment
+  i2c_read_regs(L3G4200D_DEV_ADDR_W, L3G4200D_OUT_X_L | 0x80, buf, 6);
+  ret_data.x = (uint16_t) ((buf[1] << 8) + buf[0]);
+  ret_data.y = (uint16_t) ((buf[3] << 8) + buf[2]);
+  ret_data.z = (uint16_t) ((buf[5] << 8) + buf[4]);
   return ret_data;
 }
 /*----------------------------------------------------------------------------*/
+void
+l3g4200d_set_watermark_int(uint8_t samples)
+{
+  uint8_t tmpref = l3g4200d_read8bit(L3G4200D_CTRL_REG3);
+
+  if (samples == 0) {
+    l3g4200d_write8bit(L3G4200D_CTRL_REG3, tmpref & ~(1 << L3G4200D_I2_WTM));
+    return;
+  }
+  l3g4200d_write8bit(L3G4200D_CTRL_REG3, tmpref | (1 << L3G4200D_I2_WTM));
+  tmpref = l3g4200d_read8bit(L3G4200D_FIFO_CTRL_REG);
+  l3g4200d_write8bit(L3G4200D_FIFO_CTRL_REG, (tmpref & 0xE0) | (samples & 0x1F));
+}
+/*----------------------------------------------------------------------------*/
 int8_t
 l3g4200d_get_angle_fifo(angle_data_t* ret)
 {
-  uint8_t idx = 0;
-  uint8_t fifolevel = l3g4200d_read8bit(L3G4200D_FIFO_SRC_REG) & 0x1F;
+  uint8_t src = l3g4200d_read8bit(L3G4200D_FIFO_SRC_REG);
+  uint8_t fifolevel = src & 0x1F;
 
-  for (idx = 0; idx < fifolevel; idx++) {
-    ret[idx] = l3g4200d_get_angle();
+  if (src & (1 << L3G4200D_OVRN)) {
+    fifolevel = L3G4200D_FIFO_SIZE;
   }
+  if (fifolevel == 0) {
+    return 0;
+  }
+
+  // angle_data_t matches the register layout on the little endian AVR
+  i2c_read_regs(L3G4200D_DEV_ADDR_W, L3G4200D_OUT_X_L | 0x80,
+          (uint8_t *) ret, fifolevel * sizeof (angle_data_t));
 
   return fifolevel;
 }
@@ -209,32 +224,20 @@ uint8_t
 l3g4200d_read8bit(uint8_t addr)
 {
   uint8_t lsb = 0;
-  i2c_start(L3G4200D_DEV_ADDR_W);
-  i2c_write(addr);
-  i2c_rep_start(L3G4200D_DEV_ADDR_R);
-  i2c_read_nack(&lsb);
-  i2c_stop();
+  i2c_read_regs(L3G4200D_DEV_ADDR_W, addr, &lsb, 1);
   return lsb;
 }
 /*----------------------------------------------------------------------------*/
 uint16_t
 l3g4200d_read16bit(uint8_t addr)
 {
-  uint8_t lsb = 0, msb = 0;
-  i2c_start(L3G4200D_DEV_ADDR_W);
-  i2c_write((addr | 0x80));
-  i2c_rep_start(L3G4200D_DEV_ADDR_R);
-  i2c_read_ack(&lsb);
-  i2c_read_nack(&msb);
-  i2c_stop();
-  return (uint16_t) ((msb << 8) + lsb);
+  uint8_t buf[2] = {0};
+  i2c_read_regs(L3G4200D_DEV_ADDR_W, addr | 0x80, buf, 2);
+  return (uint16_t) ((buf[1] << 8) + buf[0]);
 }
 /*----------------------------------------------------------------------------*/
 void
 l3g4200d_write8bit(uint8_t addr, uint8_t data)
 {
-  i2c_start(L3G4200D_DEV_ADDR_W);
-  i2c_write(addr);
-  i2c_write(data);
-  i2c_stop();
+  i2c_write_reg(L3G4200D_DEV_ADDR_W, addr, data);
 }
@@ -364,7 +364,17 @@ extern inline int8_t l3g4200d_fifo_overrun(void);
 angle_data_t l3g4200d_get_angle(void);
 
 
+/** Configures the FIFO watermark interrupt on the DRDY/INT2 pin.
+ *
+ * @param samples Watermark [1 - 31], 0 disables the interrupt
+ */
+void l3g4200d_set_watermark_int(uint8_t samples);
+
+
 /** Reads angle values from fifo.
+ *
+ * All stored data sets are read in a single transfer, since the
+ * register auto increment wraps from OUT_Z_H to OUT_X_L in FIFO mode.
  *
  * @note This will only work if fifo/stream mode is enabled.
  *
@@ -41,6 +41,29 @@
  */
 
 #include "mpl115a.h"
+#include "sys/ctimer.h"
+
+/* Conversion time of START_B_CONV in ms */
+#define MPL115A_CONV_TIME 6
+
+/*
+ * Temperature dependent terms of the compensation,
+ * valid for the temperature in temp.
+ */
+static struct {
+  int32_t c12x2;
+  int32_t a2x2;
+  uint16_t temp;
+  uint8_t valid;
+} tcomp;
+
+static struct {
+  struct ctimer timer;
+  void (*callback)(int16_t pcomp);
+  int16_t pcomp;
+  uint8_t busy;
+} async;
+/*---------------------------------------------------------------------------*/
 void
 mpl115a_init(void) {
   mspi_chip_release(MPL115A_CS);
@@ -48,139 +71,128 @@ mpl115a_init(void) {
   mspi_init(MPL115A_CS, MSPI_MODE_0, MSPI_BAUD_MAX);
 }
 /*---------------------------------------------------------------------------*/
+/* Reads a left aligned 10 bit ADC value. */
+static uint16_t
+mpl115a_read_adc(uint8_t msb_reg, uint8_t lsb_reg) {
+  uint16_t value;
+  value = (uint16_t) mpl115a_cmd(msb_reg) << 8;
+  value |= mpl115a_cmd(lsb_reg);
+  return 0x03FF & (value >> 6);
+}
+/*---------------------------------------------------------------------------*/
 uint16_t
 mpl115a_get_pressure(void) {
-  uint8_t press_msb;
-  uint8_t press_lsb;
-  uint16_t pressure = 0x0000;
   /*start pressure measurement*/
   mpl115a_cmd(MPL115A_START_P_CONV);
   _delay_ms(6);
-  press_msb = mpl115a_cmd(MPL115A_PRESSURE_OUT_MSB);
-  press_lsb = mpl115a_cmd(MPL115A_PRESSURE_OUT_LSB);
-  pressure = (uint16_t) (press_msb << 8);
-  pressure &= (0xFF00 | ((uint16_t) (press_lsb)));
-  pressure = 0x03FF & (pressure >> 6);
-  return pressure;
+  return mpl115a_read_adc(MPL115A_PRESSURE_OUT_MSB, MPL115A_PRESSURE_OUT_LSB);
 }
 /*---------------------------------------------------------------------------*/
 uint16_t
 mpl115a_get_temp(void) {
-  uint8_t temp_msb;
-  uint8_t temp_lsb;
-  uint16_t temperature = 0x0000;
   /*start temperature measurement*/
   mpl115a_cmd(MPL115A_START_T_CONV);
   _delay_ms(6);
-  temp_msb = mpl115a_cmd(MPL115A_TEMP_OUT_MSB);
-  temp_lsb = mpl115a_cmd(MPL115A_TEMP_OUT_LSB);
-
-  temperature = (uint16_t) (temp_msb << 8);
-  temperature &= (0xFF00 | ((uint16_t) (temp_lsb)));
-  temperature = 0x03FF & (temperature >> 6);
-  return temperature;
+  return mpl115a_read_adc(MPL115A_TEMP_OUT_MSB, MPL115A_TEMP_OUT_LSB);
 }
 /*---------------------------------------------------------------------------*/
 void
 mpl115a_read_coefficients(void) {
   uint8_t i;
-  int8_t coeff_tmp_msb;
-  int8_t coeff_tmp_lsb;
+  uint8_t coeff_tmp_msb;
+  uint8_t coeff_tmp_lsb;
 
   for (i = 0; i < 6; i++) {
     coeff_tmp_msb = mpl115a_cmd(coefficients[i].addr[0]);
     coeff_tmp_lsb = mpl115a_cmd(coefficients[i].addr[1]);
-    uart_TXchar(coeff_tmp_msb);
-    uart_TXchar(coeff_tmp_lsb);
-
-
-    coefficients[i].value = (int16_t) (coeff_tmp_msb << 8);
-    coefficients[i].value &= (0xFF00 | ((int16_t) (coeff_tmp_lsb)));
+    coefficients[i].value = (int16_t) ((coeff_tmp_msb << 8) | coeff_tmp_lsb);
   }
-  uart_TXchar('\n');
+  tcomp.valid = 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Updates the temperature dependent terms if the temperature changed
+ * by more than MPL115A_CONF_TEMP_THRESHOLD. */
+static void
+mpl115a_update_tcomp(uint16_t temperature) {
+  int32_t a2;
+
+  if (tcomp.valid
+          && temperature <= tcomp.temp + MPL115A_CONF_TEMP_THRESHOLD
+          && temperature + MPL115A_CONF_TEMP_THRESHOLD >= tcomp.temp) {
+    return;
+  }
+  /*c12x2 = c12 * temperature*/
+  tcomp.c12x2 = (int32_t) coefficients[MPL115A_C12].value * temperature;
+  /*a2 = b2 + c22x2*/
+  a2 = (((int32_t) coefficients[MPL115A_B2].value << 15)
+          + (((int32_t) coefficients[MPL115A_C22].value * temperature) >> 1)) >> 16;
+  /*a2x2 = a2 * temperature*/
+  tcomp.a2x2 = a2 * temperature;
+  tcomp.temp = temperature;
+  tcomp.valid = 1;
+}
+/*---------------------------------------------------------------------------*/
+static int16_t
+mpl115a_calc_Pcomp(uint16_t pressure) {
+  int32_t a1, y1;
+
+  /*a11 = b1 + c11x1*/
+  a1 = (((int32_t) coefficients[MPL115A_B1].value << 14)
+          + (int32_t) coefficients[MPL115A_C11].value * pressure) >> 14;
+  /*a1 = a11 + c12x2*/
+  a1 = ((a1 << 11) + tcomp.c12x2) >> 11;
+  /*y1 = a0 + a1x1*/
+  y1 = (((int32_t) coefficients[MPL115A_A0].value << 10) + a1 * pressure) >> 10;
+  /*pcomp = y1 + a2x2*/
+  return (int16_t) (((y1 << 10) + tcomp.a2x2) >> 13);
+}
+/*---------------------------------------------------------------------------*/
+/* Reads both results of START_B_CONV and compensates them. */
+static int16_t
+mpl115a_fetch_Pcomp(void) {
+  uint16_t temperature;
+  uint16_t pressure;
+
+  temperature = mpl115a_read_adc(MPL115A_TEMP_OUT_MSB, MPL115A_TEMP_OUT_LSB);
+  pressure = mpl115a_read_adc(MPL115A_PRESSURE_OUT_MSB, MPL115A_PRESSURE_OUT_LSB);
+  mpl115a_update_tcomp(temperature);
+  return mpl115a_calc_Pcomp(pressure);
 }
 /*---------------------------------------------------------------------------*/
 int16_t
 mpl115a_get_Pcomp(void) {
-  int32_t tmp1_val, tmp2_val, tmp3_val;
-  int32_t tmp_help;
-  uint8_t msb, lsb;
-  uint16_t temperature = 0x0000;
-  uint16_t pressure = 0x0000;
-
   /*start both, temperature and pressure measurement*/
   mpl115a_cmd(MPL115A_START_B_CONV);
-  /*wait 3 ms*/
-  _delay_ms(6);
-  /*get temperature value*/
-  msb = mpl115a_cmd(MPL115A_TEMP_OUT_MSB);
-  lsb = mpl115a_cmd(MPL115A_TEMP_OUT_LSB);
-  temperature = (uint16_t) (msb << 8);
-  temperature &= (0xFF00 | ((uint16_t) (lsb)));
-  temperature = 0x03FF & (temperature >> 6);
-  /*get pressure value*/
-  msb = mpl115a_cmd(MPL115A_PRESSURE_OUT_MSB);
-  lsb = mpl115a_cmd(MPL115A_PRESSURE_OUT_LSB);
-  pressure = (uint16_t) (msb << 8);
-  pressure &= (0xFF00 | ((uint16_t) (lsb)));
-  pressure = 0x03FF & (pressure >> 6);
-
-  /* calculate the compensated pressure value with the coefficients
-   * and temperature value*/
-  tmp1_val = (int32_t) coefficients[MPL115A_C11].value;
-  tmp2_val = (int32_t) pressure;
-  /*c11x1 = tmp3_val = c11 * pressure*/
-  tmp3_val = tmp1_val * tmp2_val;
-
-  tmp1_val = (int32_t) (coefficients[MPL115A_B1].value << 14);
-  tmp2_val = (int32_t) tmp3_val;
-  tmp3_val = tmp1_val + tmp2_val;
-  /*a11 = tmp_help = b1 + c11x1*/
-  tmp_help = (int32_t) (tmp3_val >> 14);
-
-  tmp1_val = (int32_t) coefficients[MPL115A_C12].value;
-  tmp2_val = (int32_t) temperature;
-  /*c12x2 = tmp3_val = c12 * temperature*/
-  tmp3_val = tmp1_val * tmp2_val;
-
-  tmp1_val = (int32_t) (tmp_help << 11);
-  tmp2_val = (int32_t) tmp3_val;
-  tmp3_val = tmp1_val + tmp2_val;
-  /*tmp_help = a1 = a11 + c12x2*/
-  tmp_help = (int32_t) (tmp3_val >> 11);
-
-  tmp1_val = (int32_t) coefficients[MPL115A_C22].value;
-  tmp2_val = (int32_t) temperature;
-  /*c22x2 = tmp3_val = c22 * temperature*/
-  tmp3_val = tmp1_val * tmp2_val;
-
-  tmp1_val = (int32_t) (coefficients[MPL115A_B2].value << 15);
-  tmp2_val = (int32_t) (tmp3_val >> 1);
-  tmp3_val = tmp1_val + tmp2_val;
-
-  tmp1_val = (int32_t) tmp_help;
-  /*a2 = b2 + c22x2*/
-  tmp_help = (int32_t) (tmp3_val >> 16);
-  tmp2_val = (int32_t) pressure;
-  /*a1x1 = tmp3_val = a1 * pressure*/
-  tmp3_val = tmp1_val * tmp2_val;
-
-  tmp1_val = (int32_t) (coefficients[MPL115A_A0].value << 10);
-  tmp2_val = (int32_t) tmp3_val;
-  tmp3_val = tmp1_val + tmp2_val;
-
-  tmp1_val = (int32_t) tmp_help;
-  /*y1 = tmp_help = a0 + a1x1*/
-  tmp_help = (int32_t) (tmp3_val >> 10);
-  tmp2_val = (int32_t) temperature;
-  /*a2x2 = tmp3_val = a2 * temperature*/
-  tmp3_val = tmp1_val * tmp2_val;
-
-  tmp1_val = (int32_t) (tmp_help << 10);
-  tmp2_val = (int32_t) tmp3_val;
-  tmp3_val = tmp1_val + tmp2_val;
-
-  return (int16_t) (tmp3_val >> 13);
+  _delay_ms(MPL115A_CONV_TIME);
+  return mpl115a_fetch_Pcomp();
+}
+/*---------------------------------------------------------------------------*/
+static void
+async_done(void *ptr) {
+  async.pcomp = mpl115a_fetch_Pcomp();
+  async.busy = 0;
+  if (async.callback != NULL) {
+    async.callback(async.pcomp);
+  }
+}
+/*---------------------------------------------------------------------------*/
+int8_t
+mpl115a_start_Pcomp(void (*callback)(int16_t pcomp)) {
+  if (async.busy) {
+    return -1;
+  }
+  async.busy = 1;
+  async.callback = callback;
+  mpl115a_cmd(MPL115A_START_B_CONV);
+  /* round up and add one tick, as the first tick may come at once */
+  ctimer_set(&async.timer, (MPL115A_CONV_TIME * CLOCK_SECOND + 999) / 1000 + 1,
+          async_done, NULL);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int16_t
+mpl115a_last_Pcomp(void) {
+  return async.pcomp;
 }
 /*---------------------------------------------------------------------------*/
 uint8_t
@@ -71,6 +71,15 @@
  */
 #define MPL115A_CS					4
 
+/*!
+ * Temperature change in ADC counts (about 5.35 counts per degree)
+ * up to which the temperature dependent compensation terms are reused.
+ * 0 recomputes them on every temperature change.
+ */
+#ifndef MPL115A_CONF_TEMP_THRESHOLD
+#define MPL115A_CONF_TEMP_THRESHOLD 2
+#endif
+
 /*!
  * Pressure value high byte
  * <table border="1">
@@ -313,6 +322,25 @@ uint16_t mpl115a_get_temp(void);
  */
 int16_t mpl115a_get_Pcomp(void);
 
+/**
+ * \brief Starts a non-blocking compensated pressure measurement
+ *
+ * The conversion time is waited for with a ctimer. Then the result is
+ * compensated and passed to \p callback, called from the ctimer process.
+ *
+ * \param callback Called with the compensated pressure value, may be NULL
+ * \retval 0  measurement started
+ * \retval -1 a measurement is still running
+ */
+int8_t mpl115a_start_Pcomp(void (*callback)(int16_t pcomp));
+
+/**
+ * \brief Returns the result of the last non-blocking measurement
+ *
+ * \return Compensated pressure value
+ */
+int16_t mpl115a_last_Pcomp(void);
+
 /*
  * \brief This function reads out all coefficients from the
  * MPL115A ROM
@@ -49,9 +49,9 @@
  *    SPI device. But in higher software layers you are not interested in such
  *    details like SPI Mode. Therefore the SPI Bus Manager was implemented, to separate
  *    the low level hardware and register level from higher software layers.
- *    The SPI Bus Manager holds all devices, which are connected to the SPI Bus. With
- *    a checksum he can decide, if the SPI configuration has to change. So in some cases
- *    these reconfiguration can be avoid.</p>
+ *    The SPI Bus Manager holds all devices, which are connected to the SPI Bus.
+ *    Devices with the same SPI configuration share a configuration ID, so the
+ *    reconfiguration is skipped when switching between them.</p>
  *    \note If you know what you are doing, it is possible to disable the SPI Bus Manager
  *    by setting MSPI_BUS_MANAGER in the mspi-drv.h to 0.
  * @{
@@ -72,12 +72,13 @@
 typedef struct {
 	uint8_t dev_mode;
 	uint16_t dev_baud;
-	uint8_t checksum;
+	/*! Lowest chip select with the same mode and baud rate */
+	uint8_t config_id;
 }spi_dev;
 
 /**
  * \brief This function add a device to the SPI device table
- *        and calculates the specific checksum
+ *        and updates the configuration IDs
  *
  * \param cs  Chip Select: Device ID
  * \param mode Select the (M)SPI mode (MSPI_MODE_0 ...
@@ -45,15 +45,19 @@
  */
 
 #include "mspi.h"
+#include "sys/energest.h"
+#if MSPI_ASYNC
+#include "dev/rs232.h"
+#endif
 
 /*!
  * SPI Device Table: Holds the information about the SPI devices.
  * \note Index contains Chip Select information
  */
-static spi_dev spi_bus_config[MAX_SPI_DEVICES];
+static spi_dev spi_bus_config[MAX_SPI_DEVICES + 1];
 
 /*!
- * Holds the current SPI-Bus configuration
+ * Holds the configuration ID applied to the SPI-Bus
  */
 static uint8_t spi_current_config = 0xFF;
 
@@ -81,6 +85,19 @@ static uint8_t cs_bcd[8] = {
 
 };
 
+#if ENERGEST_CONF_ON
+/*!
+ * Energest type accounted while a device is selected, 0 for none.
+ * ENERGEST_TYPE_CPU (0) is never accounted here.
+ */
+static uint8_t cs_energest[8];
+
+/*!
+ * The device selected last, 0 if released
+ */
+static uint8_t cs_selected;
+#endif
+
 static usart_t usart_ports[2] = {
   { // MSPI UART0
     &UBRR0,
@@ -105,6 +122,19 @@ static usart_t usart_ports[2] = {
 
 /* global variable for the selected USART port*/
 uint8_t mspi_uart_port = MSPI_USART1;
+
+/*!
+ * The device holding the bus by mspi_transaction_begin(), 0 if free
+ */
+static uint8_t bus_owner;
+static uint8_t bus_depth;
+
+#if MSPI_ASYNC
+static const uint8_t *async_tx;
+static uint8_t *async_rx;
+static volatile uint16_t async_left = 0;
+static void (*async_done)(void);
+#endif
 void
 mspi_init(uint8_t cs, uint8_t mode, uint16_t baud)
 {
@@ -127,18 +157,64 @@ mspi_init(uint8_t cs, uint8_t mode, uint16_t baud)
 #endif
 }
 /*----------------------------------------------------------------------------*/
+uint8_t
+mspi_transaction_begin(uint8_t cs)
+{
+  if (bus_owner != 0 && bus_owner != cs) {
+    return 1;
+  }
+#if MSPI_ASYNC
+  if (async_left > 0 && bus_owner != cs) {
+    return 1;
+  }
+#endif
+  bus_owner = cs;
+  bus_depth++;
+  return 0;
+}
+/*----------------------------------------------------------------------------*/
 void
+mspi_transaction_end(uint8_t cs)
+{
+  if (bus_owner == cs && --bus_depth == 0) {
+    bus_owner = 0;
+  }
+}
+/*----------------------------------------------------------------------------*/
+uint8_t
 mspi_chip_select(uint8_t cs)
 {
+  /* another device holds the bus by mspi_transaction_begin() */
+  if (bus_owner != 0 && bus_owner != cs) {
+    return 1;
+  }
+#if MSPI_ASYNC
+  /* do not cut into the interrupt driven block transfer of another device */
+  if (cs != bus_owner) {
+    while (async_left > 0);
+  }
+#endif
 #if MSPI_BUS_MANAGER
-  if (spi_current_config != spi_bus_config[cs].checksum) {
+  if (spi_current_config != spi_bus_config[cs].config_id) {
     /*new mspi configuration is needed by this spi device*/
     mspi_mgr_change_mode(spi_bus_config[cs]);
-    spi_current_config = spi_bus_config[cs].checksum;
+    spi_current_config = spi_bus_config[cs].config_id;
+  }
+#endif
+#if ENERGEST_CONF_ON
+  if (cs != cs_selected) {
+    if (cs_energest[cs_selected]) {
+      ENERGEST_OFF(cs_energest[cs_selected]);
+    }
+    if (cs_energest[cs]) {
+      ENERGEST_ON(cs_energest[cs]);
+    }
+    cs_selected = cs;
   }
 #endif
   /*chip select*/
   MSPI_CS_PORT |= cs_bcd[cs];
+  return 0;
 }
 /*----------------------------------------------------------------------------*/
 void
@@ -146,6 +222,25 @@ mspi_chip_release(uint8_t cs)
 {
   /*chip deselect*/
   MSPI_CS_PORT &= ~((1 << MSPI_CS_PIN_0) | (1 << MSPI_CS_PIN_1) | (1 << MSPI_CS_PIN_2));
+#if ENERGEST_CONF_ON
+  if (cs_energest[cs_selected]) {
+    ENERGEST_OFF(cs_energest[cs_selected]);
+  }
+  cs_selected = 0;
+#endif
+}
+/*----------------------------------------------------------------------------*/
+void
+mspi_set_energest_type(uint8_t cs, uint8_t type)
+{
+#if ENERGEST_CONF_ON
+  if (cs < 8) {
+    if (cs == cs_selected && cs_energest[cs]) {
+      ENERGEST_OFF(cs_energest[cs]);
+    }
+    cs_energest[cs] = type;
+  }
+#endif
 }
 /*----------------------------------------------------------------------------*/
 uint8_t
@@ -174,6 +269,136 @@ mspi_transceive(uint8_t data)
 }
 /*----------------------------------------------------------------------------*/
 void
+mspi_read_block(uint8_t *buffer, uint16_t len)
+{
+  volatile uint8_t *ucsra = usart_ports[mspi_uart_port].UCSRnA;
+  volatile uint8_t *udr = usart_ports[mspi_uart_port].UDRn;
+  uint8_t *end = buffer + len - 1;
+
+  if (len == 0) {
+    return;
+  }
+
+  /* one byte is always ahead in the transmit buffer */
+  *udr = MSPI_DUMMY_BYTE;
+  while (buffer < end) {
+    while (!(*ucsra & (1 << UDRE0)));
+    *udr = MSPI_DUMMY_BYTE;
+    while (!(*ucsra & (1 << RXC0)));
+    *buffer++ = *udr;
+  }
+  while (!(*ucsra & (1 << RXC0)));
+  *buffer = *udr;
+}
+/*----------------------------------------------------------------------------*/
+void
+mspi_write_block(const uint8_t *buffer, uint16_t len)
+{
+  volatile uint8_t *ucsra = usart_ports[mspi_uart_port].UCSRnA;
+  volatile uint8_t *udr = usart_ports[mspi_uart_port].UDRn;
+  const uint8_t *end = buffer + len;
+  uint8_t dummy;
+
+  if (len == 0) {
+    return;
+  }
+
+  /* one byte is always ahead in the transmit buffer */
+  *udr = *buffer++;
+  while (buffer < end) {
+    while (!(*ucsra & (1 << UDRE0)));
+    *udr = *buffer++;
+    while (!(*ucsra & (1 << RXC0)));
+    dummy = *udr;
+  }
+  while (!(*ucsra & (1 << RXC0)));
+  dummy = *udr;
+  (void) dummy;
+}
+/*----------------------------------------------------------------------------*/
+void
+mspi_exchange_block(const uint8_t *tx, uint8_t *rx, uint16_t len)
+{
+  volatile uint8_t *ucsra = usart_ports[mspi_uart_port].UCSRnA;
+  volatile uint8_t *udr = usart_ports[mspi_uart_port].UDRn;
+  uint16_t i;
+
+  if (len == 0) {
+    return;
+  }
+
+  /* one byte is always ahead in the transmit buffer,
+   * tx[i + 1] is read before rx[i] is written, so rx may be tx */
+  *udr = tx[0];
+  for (i = 0; i < len - 1; i++) {
+    while (!(*ucsra & (1 << UDRE0)));
+    *udr = tx[i + 1];
+    while (!(*ucsra & (1 << RXC0)));
+    rx[i] = *udr;
+  }
+  while (!(*ucsra & (1 << RXC0)));
+  rx[len - 1] = *udr;
+}
+/*----------------------------------------------------------------------------*/
+#if MSPI_ASYNC
+/*----------------------------------------------------------------------------*/
+/* Called from the USART1 RX interrupt for every received byte */
+static int
+mspi_async_input(unsigned char c)
+{
+  if (async_rx != NULL) {
+    *async_rx++ = c;
+  }
+
+  if (--async_left > 0) {
+    UDR1 = (async_tx != NULL) ? *async_tx++ : MSPI_DUMMY_BYTE;
+    return 0;
+  }
+
+  /* transfer done */
+  UCSR1B &= ~(1 << RXCIE1);
+  rs232_set_input(RS232_PORT_1, NULL);
+  if (async_done != NULL) {
+    async_done();
+  }
+
+  return 1;
+}
+/*----------------------------------------------------------------------------*/
+uint8_t
+mspi_exchange_block_async(const uint8_t *tx, uint8_t *rx, uint16_t len, void (*done)(void))
+{
+  if (async_left > 0 || mspi_uart_port != MSPI_USART1) {
+    return 1;
+  }
+
+  if (len == 0) {
+    if (done != NULL) {
+      done();
+    }
+    return 0;
+  }
+
+  async_tx = tx;
+  async_rx = rx;
+  async_done = done;
+  async_left = len;
+
+  rs232_set_input(RS232_PORT_1, mspi_async_input);
+  UCSR1B |= (1 << RXCIE1);
+  UDR1 = (async_tx != NULL) ? *async_tx++ : MSPI_DUMMY_BYTE;
+
+  return 0;
+}
+/*----------------------------------------------------------------------------*/
+uint8_t
+mspi_async_busy(void)
+{
+  return async_left > 0;
+}
+#endif /* MSPI_ASYNC */
+/*----------------------------------------------------------------------------*/
+void
 mspi_deinit(void)
 {
   *(usart_ports[mspi_uart_port].UCSRnA) = MSPI_DISABLE;
@@ -181,14 +406,38 @@ mspi_deinit(void)
   *(usart_ports[mspi_uart_port].UCSRnC) = MSPI_DISABLE;
 }
 /*----------------------------------------------------------------------------*/
+void
+mspi_set_baud(uint8_t cs, uint16_t baud)
+{
+#if MSPI_BUS_MANAGER
+  mspi_mgr_add(cs, spi_bus_config[cs].dev_mode, baud);
+#else
+  *(usart_ports[mspi_uart_port].UBRRn) = baud;
+#endif
+}
+/*----------------------------------------------------------------------------*/
 
 #if MSPI_BUS_MANAGER
 void
 mspi_mgr_add(uint8_t cs, uint8_t mode, uint16_t baud)
 {
+  uint8_t i, j;
+
   spi_bus_config[cs].dev_mode = mode;
   spi_bus_config[cs].dev_baud = baud;
-  spi_bus_config[cs].checksum = mode + baud;
+
+  /* devices with equal configurations get the ID of the first one */
+  for (i = 0; i <= MAX_SPI_DEVICES; i++) {
+    for (j = 0; j < i; j++) {
+      if (spi_bus_config[j].dev_mode == spi_bus_config[i].dev_mode
+          && spi_bus_config[j].dev_baud == spi_bus_config[i].dev_baud) {
+        break;
+      }
+    }
+    spi_bus_config[i].config_id = j;
+  }
+  /* the IDs may have moved, force reconfiguration on next chip select */
+  spi_current_config = 0xFF;
 }
 /*----------------------------------------------------------------------------*/
 void
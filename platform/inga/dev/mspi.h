@@ -70,6 +70,15 @@
 #include "mspi-mgr.h"
 #endif
 
+/*!
+ * Enable the interrupt driven block transfer (mspi_exchange_block_async()).
+ * \note The RX interrupt of USART1 is hooked through the rs232 input handler
+ * of port 1, so this port must not be used as RS232 at the same time.
+ */
+#ifndef MSPI_ASYNC
+#define MSPI_ASYNC	0
+#endif
+
 #define MSPI_USART0			0
 #define MSPI_USART1			1
 /*\cond*/
@@ -210,13 +219,94 @@ void mspi_init(uint8_t cs, uint8_t mode, uint16_t baud);
  */
 uint8_t mspi_transceive(uint8_t data);
 
+/**
+ * \brief Receives a block of data, sending dummy bytes.
+ *
+ * The USART transmit buffer is kept filled, so the bus does not idle
+ * between the bytes.
+ *
+ * \param buffer Buffer to store the received bytes
+ * \param len    Number of bytes to receive
+ */
+void mspi_read_block(uint8_t *buffer, uint16_t len);
+
+/**
+ * \brief Transmits a block of data, discarding the received bytes.
+ *
+ * \param buffer Bytes to transmit
+ * \param len    Number of bytes to transmit
+ */
+void mspi_write_block(const uint8_t *buffer, uint16_t len);
+
+/**
+ * \brief Transmits a block of data and receives the answer.
+ *
+ * \param tx  Bytes to transmit
+ * \param rx  Buffer to store the received bytes, may be equal to tx
+ * \param len Number of bytes to exchange
+ */
+void mspi_exchange_block(const uint8_t *tx, uint8_t *rx, uint16_t len);
+
+#if MSPI_ASYNC
+/**
+ * \brief Starts an interrupt driven block transfer in the background.
+ *
+ * Each received byte triggers the transmission of the next one, the
+ * chip select must be kept until the transfer is done. The device should
+ * hold the bus by mspi_transaction_begin() until \e done was called.
+ * This only pays off at low SPI clock rates, since an interrupt costs
+ * about as much as a byte transfer at the maximum rate.
+ *
+ * \param tx   Bytes to transmit, NULL to transmit dummy bytes
+ * \param rx   Buffer to store the received bytes, NULL to discard them
+ * \param len  Number of bytes to exchange
+ * \param done Called (in interrupt context) after the last byte, may be NULL
+ * \return 0 if the transfer was started, 1 if a transfer is still running
+ *         or the MSPI does not use USART1
+ */
+uint8_t mspi_exchange_block_async(const uint8_t *tx, uint8_t *rx, uint16_t len, void (*done)(void));
+
+/**
+ * \brief Checks if an interrupt driven block transfer is running.
+ * \return 1 if running, otherwise 0
+ */
+uint8_t mspi_async_busy(void);
+#endif /* MSPI_ASYNC */
+
+/**
+ * \brief Claims the bus for a sequence of operations of one device
+ *
+ * While a device holds the bus, mspi_transaction_begin() fails for all
+ * other devices, so drivers can batch consecutive operations, e.g. a
+ * multi block transfer, without other transaction users switching the
+ * bus configuration in between. Calls of the same device nest.
+ * mspi_chip_select() refuses other devices until the bus is released.
+ *
+ * \param cs   Chip Select: Device ID
+ * \return 0 if the bus was claimed, 1 if it is held by another device
+ *         or an interrupt driven transfer is running
+ */
+uint8_t mspi_transaction_begin(uint8_t cs);
+
+/**
+ * \brief Releases the bus claimed by mspi_transaction_begin()
+ *
+ * \param cs   Chip Select: Device ID
+ */
+void mspi_transaction_end(uint8_t cs);
+
 /**
  * \brief This function enables the chip select by setting the
  *        needed I/O pins (BCD-Code)
  *
+ * The device is not selected while another device holds the bus by
+ * mspi_transaction_begin(). With MSPI_ASYNC this waits for a running
+ * interrupt driven transfer, unless \e cs holds the bus.
+ *
  * \param cs   Chip Select: Device ID
+ * \return 0 if selected, 1 if the bus is held by another device
  */
-void mspi_chip_select(uint8_t cs);
+uint8_t mspi_chip_select(uint8_t cs);
 
 /**
  * \brief This function disables the chip select
@@ -225,12 +315,34 @@ void mspi_chip_select(uint8_t cs);
  */
 void mspi_chip_release(uint8_t cs);
 
+/**
+ * \brief Accounts the time the device is selected to an energest type
+ *
+ * The type is switched on by mspi_chip_select() and off by
+ * mspi_chip_release(). Without ENERGEST_CONF_ON this does nothing.
+ *
+ * \param cs   Chip Select: Device ID
+ * \param type ENERGEST_TYPE_*, 0 to stop accounting the device
+ */
+void mspi_set_energest_type(uint8_t cs, uint8_t type);
+
 /**
  * \brief This function will set all MSPI registers to their
  *        default values.
  */
 void mspi_deinit(void);
 
+/**
+ * \brief Changes the MSPI BAUD rate used for the given device
+ *
+ * With the spi-bus manager the new rate is applied on the next chip
+ * select of the device, otherwise it is applied immediately.
+ *
+ * \param cs   Chip Select: Device ID
+ * \param baud The MSPI BAUD rate (content of the UBRR register)
+ */
+void mspi_set_baud(uint8_t cs, uint16_t baud);
+
 /** @} */ // mspi_driver
 /** @} */ // inga_bus_driver
 
@@ -41,18 +41,41 @@
 
 #define CFG_READY_  0
 #define CFG_ACTIVE_ 1
+#define CFG_ASYNC_  2
 #define CFG_MODE_   3
+/* Set once CFG_READY_ is valid */
+#define CFG_PROBED_ 5
 
 const struct sensors_sensor pressure_sensor;
 static uint8_t config = 0x00;
 static uint32_t pressure;
 /*----------------------------------------------------------------------------*/
+static void
+async_done(void)
+{
+  pressure = bmp085_async_pressure();
+  sensors_changed(&pressure_sensor);
+}
+/*----------------------------------------------------------------------------*/
 static int
 value(int type)
 {
   // if not activated, do not query data
   if (!(config & (1 << CFG_ACTIVE_))) return -1;
 
+  if (config & (1 << CFG_ASYNC_)) {
+    // results of the last non-blocking measurement
+    switch (type) {
+      case PRESS_H:
+        return (uint16_t) ((pressure >> 16) & 0xFFFF);
+      case PRESS_L:
+        return (uint16_t) (pressure & 0xFFFF);
+      case TEMP:
+        return bmp085_async_temperature();
+    }
+    return 0;
+  }
+
   switch (type) {
     case PRESS_H:
       // read with selected mode
@@ -67,10 +90,45 @@ value(int type)
 }
 /*----------------------------------------------------------------------------*/
 static int
+read_block(unsigned type_mask, int16_t *out)
+{
+  int16_t temperature;
+  int n = 0;
+
+  if (!(config & (1 << CFG_ACTIVE_))) return 0;
+
+  if (config & (1 << CFG_ASYNC_)) {
+    temperature = bmp085_async_temperature();
+  } else {
+    pressure = bmp085_read_pressure_temp((config & (0x3 << CFG_MODE_)) >> CFG_MODE_,
+            &temperature);
+  }
+  // ascending type order: TEMP, PRESS_L, PRESS_H
+  if (type_mask & (1 << TEMP)) {
+    out[n++] = temperature;
+  }
+  if (type_mask & (1 << PRESS_L)) {
+    out[n++] = (uint16_t) (pressure & 0xFFFF);
+  }
+  if (type_mask & (1 << PRESS_H)) {
+    out[n++] = (uint16_t) ((pressure >> 16) & 0xFFFF);
+  }
+  return n;
+}
+/*----------------------------------------------------------------------------*/
+static int
 status(int type)
 {
   switch (type) {
     case SENSORS_READY:
+#if INGA_LAZY_SENSORS
+      if (!(config & (1 << CFG_PROBED_))) {
+        config |= (1 << CFG_PROBED_);
+        if (bmp085_available()) {
+          config |= (1 << CFG_READY_);
+        }
+      }
+#endif
       return (config & (1 << CFG_READY_)) >> CFG_READY_;
       break;
     case SENSORS_ACTIVE:
@@ -85,18 +143,34 @@ configure(int type, int c)
 {
   switch (type) {
     case SENSORS_HW_INIT:
+#if INGA_LAZY_SENSORS
+      config &= ~((1 << CFG_READY_) | (1 << CFG_PROBED_));
+      return 1;
+#else
       if (bmp085_available()) {
         config |= (1 << CFG_READY_);
         return 1;
       } else {
-        config &= (1 << CFG_READY_);
+        config &= ~(1 << CFG_READY_);
         return 0;
       }
+#endif
       break;
     case SENSORS_ACTIVE:
       if (c) {
         config |= (1 << CFG_ACTIVE_);
-        return (bmp085_init() == 0) ? 1 : 0;
+        if (bmp085_init() != 0) {
+#if INGA_LAZY_SENSORS
+          /* bmp085_init() probes the device */
+          config |= (1 << CFG_PROBED_);
+          config &= ~(1 << CFG_READY_);
+#endif
+          return 0;
+        }
+#if INGA_LAZY_SENSORS
+        config |= (1 << CFG_PROBED_) | (1 << CFG_READY_);
+#endif
+        return 1;
       } else {
         config &= ~(1 << CFG_ACTIVE_);
         return (bmp085_deinit() == 0) ? 1 : 0;
@@ -105,6 +179,18 @@ configure(int type, int c)
     default:
       break;
 
+    case PRESSURE_CONF_START:
+      if (!c) {
+        config &= ~(1 << CFG_ASYNC_);
+        return 1;
+      }
+      if (!(config & (1 << CFG_ACTIVE_))) {
+        return 0;
+      }
+      config |= (1 << CFG_ASYNC_);
+      return (bmp085_read_async((config & (0x3 << CFG_MODE_)) >> CFG_MODE_,
+              async_done) == 0) ? 1 : 0;
+
     case PRESSURE_CONF_OPERATION_MODE:
       switch (c) {
         case PRESSURE_MODE_ULTRA_LOW_POWER:
@@ -129,4 +215,4 @@ configure(int type, int c)
   return 0;
 }
 /*----------------------------------------------------------------------------*/
-SENSORS_SENSOR(pressure_sensor, PRESSURE_SENSOR, value, configure, status);
+SENSORS_SENSOR_BLOCK(pressure_sensor, PRESSURE_SENSOR, value, configure, status, read_block);
@@ -87,6 +87,14 @@ extern const struct sensors_sensor pressure_sensor;
  * @{ */
 /** Selects the operation mode. */
 #define PRESSURE_CONF_OPERATION_MODE  10
+/**
+ * Starts a non-blocking measurement (value != 0).
+ *
+ * A sensors event is posted when the compensated values are ready.
+ * From then on value() returns the results of the last non-blocking
+ * measurement without blocking. A value of 0 returns to blocking reads.
+ */
+#define PRESSURE_CONF_START           20
 /** @} */
 
 /** \name OPERATION_MODE values
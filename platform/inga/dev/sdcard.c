@@ -48,7 +48,9 @@
 
 #include "sdcard.h"
 #include "dev/watchdog.h"
+#include "sys/energest.h"
 #include <util/delay.h>
+#include <util/crc16.h>
 
 #define DEBUG 0
 
@@ -78,6 +80,8 @@
 #define SDCARD_CMD9   9
 /** CMD10 -- SEND_CID */
 #define SDCARD_CMD10  10
+/** CMD12 -- STOP_TRANSMISSION */
+#define SDCARD_CMD12  12
 /** CMD13 -- SEND_STATUS */
 #define SDCARD_CMD13  13
 
@@ -113,6 +117,8 @@
 #define SDCARD_CMD55  55
 
 #define IS_ACMD       0x80
+/** ACMD13 -- SD_STATUS */
+#define SDCARD_ACMD13 (IS_ACMD | 13)
 /** ACMD23 -- SET_WR_BLK_ERASE_COUNT */
 #define SDCARD_ACMD23 (IS_ACMD | 23)
 /** ACMD41 -- SD_SEND_OP_COND */
@@ -170,6 +176,11 @@
  *       Only in context of multi-block write stop
  *       also 500ms are allowed. */
 #define BUSY_WAIT_MS  300
+/** Maximum time [ms] to wait for an erase operation to finish */
+#define ERASE_WAIT_MS 5000
+
+/* MSPI baud setting for the identification phase (at most 400 kHz) */
+#define SDCARD_INIT_BAUD  ((F_CPU + 2 * 400000UL - 1) / (2 * 400000UL) - 1)
 
 #define N_CX_MAX  8
 #define N_CR_MAX  8
@@ -194,12 +205,25 @@ static uint8_t sdcard_sdsc_card = 1;
  */
 static uint8_t sdcard_crc_enable = 0;
 
+/**
+ * \brief Indicates if the card is a Ver 1.X card or MMC (!=0) or not (==0).
+ */
+static uint8_t sdcard_ver1_card = 0;
+
+/**
+ * \brief MSPI baud setting for data transfer, obtained from the CSD.
+ */
+static uint16_t sdcard_baud = SDCARD_INIT_BAUD;
+
 static void get_csd_info(uint8_t *csd);
+static uint16_t get_max_baud(uint8_t tran_speed);
 /**
  * Waits for the busy signal to become high.
  * \retval 0 successfull
  */
 static uint8_t sdcard_busy_wait();
+static uint8_t sdcard_read_data(uint8_t *buffer);
+static void sdcard_write_data(uint8_t *buffer);
 
 /* Debugging functions */
 #if DEBUG
@@ -464,6 +488,42 @@ get_csd_info(uint8_t *csd)
   PRINTF("\nget_csd_info(): SECTOR_SIZE = %u", SECTOR_SIZE);
 }
 /*----------------------------------------------------------------------------*/
+/**
+ * \brief Calculates the fastest MSPI baud setting for the card.
+ *
+ * \param tran_speed TRAN_SPEED field of the CSD (max. data transfer rate)
+ * \return Smallest UBRR value that does not exceed the cards rate
+ */
+static uint16_t
+get_max_baud(uint8_t tran_speed)
+{
+  /* time values (x10) of the TRAN_SPEED field */
+  static const uint8_t time_value[16] = {0, 10, 12, 13, 15, 20, 25, 30, 35, 40, 45, 50, 55, 60, 70, 80};
+  uint8_t unit = tran_speed & 0x07;
+  uint32_t rate = time_value[(tran_speed >> 3) & 0x0F];
+  uint32_t div;
+
+  /* invalid value, stay at identification rate */
+  if (rate == 0) {
+    return SDCARD_INIT_BAUD;
+  }
+
+  /* rate unit: 0 = 100 kbit/s ... 3 = 100 Mbit/s, others reserved */
+  if (unit > 3) {
+    unit = 3;
+  }
+  rate *= 10000UL;
+  while (unit-- > 0) {
+    rate *= 10;
+  }
+
+  /* f_sck = f_osc / (2 * (UBRR + 1)) */
+  div = (F_CPU + 2 * rate - 1) / (2 * rate);
+  PRINTF("\nget_max_baud(): TRAN_SPEED = 0x%02x, rate = %lu, UBRR = %lu", tran_speed, rate, div > 0 ? div - 1 : 0);
+
+  return (div > 0) ? div - 1 : 0;
+}
+/*----------------------------------------------------------------------------*/
 /**
  * \brief This function calculates the CRC7 for SD Card commands.
  *
@@ -498,34 +558,102 @@ sdcard_cmd_crc(uint8_t *cmd)
 uint16_t
 sdcard_data_crc(uint8_t *data)
 {
-  uint32_t stream = (((uint32_t) data[0]) << 24) +
-          (((uint32_t) data[1]) << 16) +
-          (((uint32_t) data[2]) << 8) +
-          ((uint32_t) data[3]);
-  uint16_t i = 0;
-  uint32_t gen = ((uint32_t) 0x11021) << 15;
+  uint16_t i;
+  uint16_t crc = 0;
 
-  /* 4096 Bits = 512 Bytes a 8 Bits */
-  for (i = 0; i < 4096; i++) {
-    if (stream & (((uint32_t) 0x80) << 24)) {
-      stream ^= gen;
-    }
+  /* CRC16-CCITT (x^16 + x^12 + x^5 + 1), MSB first, as used by XMODEM */
+  for (i = 0; i < 512; i++) {
+    crc = _crc_xmodem_update(crc, data[i]);
+  }
 
-    stream = stream << 1;
-    if (((i + 1) % 8) == 0 && i < 4064) {
-      stream += data[((i + 1) / 8) + 3];
-    }
+  return crc;
+}
+/*----------------------------------------------------------------------------*/
+/**
+ * \brief Receives the 512 data bytes and the CRC of a data block.
+ *
+ * If CRC mode is enabled, the CRC16 is calculated while receiving and
+ * checked against the received one.
+ *
+ * \retval SDCARD_SUCCESS
+ * \retval SDCARD_DATA_ERROR CRC mismatch
+ */
+static uint8_t
+sdcard_read_data(uint8_t *buffer)
+{
+  uint16_t i;
+  uint16_t crc = 0;
+
+  if (!sdcard_crc_enable) {
+    mspi_read_block(buffer, 512);
+
+    /* Read CRC-Byte: don't care */
+    mspi_transceive(MSPI_DUMMY_BYTE);
+    mspi_transceive(MSPI_DUMMY_BYTE);
+
+    return SDCARD_SUCCESS;
   }
 
-  return (stream >> 16);
+  for (i = 0; i < 512; i++) {
+    buffer[i] = mspi_transceive(MSPI_DUMMY_BYTE);
+    crc = _crc_xmodem_update(crc, buffer[i]);
+  }
+
+  /* Feeding the received CRC into the calculation must result in 0 */
+  crc = _crc_xmodem_update(crc, mspi_transceive(MSPI_DUMMY_BYTE));
+  crc = _crc_xmodem_update(crc, mspi_transceive(MSPI_DUMMY_BYTE));
+
+  if (crc != 0) {
+    PRINTD("\nsdcard_read_data(): CRC error");
+    return SDCARD_DATA_ERROR;
+  }
+
+  return SDCARD_SUCCESS;
 }
 /*----------------------------------------------------------------------------*/
-uint8_t
-sdcard_init(void)
+/**
+ * \brief Sends the 512 data bytes and the CRC of a data block.
+ *
+ * If CRC mode is enabled, the CRC16 is calculated while sending,
+ * otherwise a dummy CRC is sent.
+ */
+static void
+sdcard_write_data(uint8_t *buffer)
+{
+  uint16_t i;
+  uint16_t crc = 0;
+
+  if (!sdcard_crc_enable) {
+    mspi_write_block(buffer, 512);
+
+    /* write dummy 16 bit CRC checksum */
+    mspi_transceive(MSPI_DUMMY_BYTE);
+    mspi_transceive(MSPI_DUMMY_BYTE);
+
+    return;
+  }
+
+  for (i = 0; i < 512; i++) {
+    mspi_transceive(buffer[i]);
+    crc = _crc_xmodem_update(crc, buffer[i]);
+  }
+
+  mspi_transceive((uint8_t) (crc >> 8));
+  mspi_transceive((uint8_t) crc);
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+ * \brief Brings the card into SPI mode and through its initialization.
+ *
+ * \param resume If set the card type, block count and transfer rate of the
+ * last initialization are reused, so neither the OCR nor the CSD is read.
+ */
+static uint8_t
+sdcard_start(uint8_t resume)
 {
   uint16_t i;
   uint8_t ret = 0;
-  sdcard_sdsc_card = 1;
 
   uint32_t cmd_arg = 0;
   /*Response Array for the R3 and R7 responses*/
@@ -536,8 +664,9 @@ sdcard_init(void)
   /* READY TO INITIALIZE micro SD / SD card */
   mspi_chip_release(MICRO_SD_CS);
 
-  /*init mspi in mode0, at chip select pin 2 and max baud rate */
-  mspi_init(MICRO_SD_CS, MSPI_MODE_0, MSPI_BAUD_2MBPS);
+  /* init mspi in mode0, at chip select pin 2 and identification rate */
+  mspi_init(MICRO_SD_CS, MSPI_MODE_0, SDCARD_INIT_BAUD);
+  mspi_set_energest_type(MICRO_SD_CS, ENERGEST_TYPE_SDCARD);
 
   /* set SPI mode by chip select (only necessary when mspi manager is active) */
   mspi_chip_select(MICRO_SD_CS);
@@ -593,7 +722,11 @@ sdcard_init(void)
   }
 
   /* Illegal command -> Ver 1.X SD Memory Card or Not SD Memory Card*/
-  if (ret & SD_R1_ILLEGAL_CMD) {
+  if (!resume) {
+    sdcard_ver1_card = (ret & SD_R1_ILLEGAL_CMD) ? 1 : 0;
+    sdcard_sdsc_card = 1;
+  }
+  if (sdcard_ver1_card) {
 
     /* CMD1: init CSD Version 1 and MMC cards*/
     i = 0;
@@ -636,6 +769,10 @@ sdcard_init(void)
       }
     }
 
+    if (resume) {
+      goto identified;
+    }
+
     /* CMD58: Gets the OCR-Register to check if card is SDSC or not */
     i = 0;
     resp[0] = SDCARD_RESP3;
@@ -662,27 +799,107 @@ sdcard_init(void)
     }
   }
 
-  /* Read card-specific data (CSD) register */
+  if (!resume) {
+    /* Read card-specific data (CSD) register */
+    i = 0;
+    while (sdcard_read_csd(csd) != SDCARD_SUCCESS) {
+      i++;
+      if (i > 100) {
+        mspi_chip_release(MICRO_SD_CS);
+        PRINTD("\nsdcard_init(): CSD read error");
+        return SDCARD_CSD_ERROR;
+      }
+    }
+    get_csd_info(csd);
+    sdcard_baud = get_max_baud(csd[3]);
+  }
+
+identified:
+  mspi_chip_release(MICRO_SD_CS);
+
+  /* Identification is done, switch to the fastest rate the card supports */
+  mspi_set_baud(MICRO_SD_CS, sdcard_baud);
+
+  return SDCARD_SUCCESS;
+}
+/*----------------------------------------------------------------------------*/
+uint8_t
+sdcard_init(void)
+{
+  return sdcard_start(0);
+}
+/*----------------------------------------------------------------------------*/
+uint8_t
+sdcard_resume(void)
+{
+  /* Nothing to reuse yet */
+  if (sdcard_card_block_count == 0) {
+    return sdcard_start(0);
+  }
+  return sdcard_start(1);
+}
+/*----------------------------------------------------------------------------*/
+uint32_t
+sdcard_get_au_size(void)
+{
+  /* Sizes [MB] of the AU_SIZE values 0xB to 0xF */
+  static const uint8_t au_mb[5] = {12, 16, 24, 32, 64};
+  uint8_t resp[2] = {SDCARD_RESP2, 0x00};
+  uint8_t au = 0;
+  uint8_t ret;
+  uint16_t i;
+
+  mspi_chip_select(MICRO_SD_CS);
+
+  if (sdcard_busy_wait() == SDCARD_BUSY_TIMEOUT) {
+    mspi_chip_release(MICRO_SD_CS);
+    return 0;
+  }
+
+  if (sdcard_write_cmd(SDCARD_ACMD13, NULL, resp) != 0x00) {
+    PRINTD("\nsdcard_get_au_size(): ACMD13 failure!");
+    mspi_chip_release(MICRO_SD_CS);
+    return 0;
+  }
+
+  /* wait for the 0xFE start byte */
   i = 0;
-  while (sdcard_read_csd(csd) != SDCARD_SUCCESS) {
-    i++;
-    if (i > 100) {
+  while ((ret = mspi_transceive(MSPI_DUMMY_BYTE)) == SD_DATA_HIGH) {
+    if (++i > 2000) {
+      PRINTD("\nsdcard_get_au_size(): No data token");
       mspi_chip_release(MICRO_SD_CS);
-      PRINTD("\nsdcard_init(): CSD read error");
-      return SDCARD_CSD_ERROR;
+      return 0;
+    }
+  }
+
+  if (ret == START_BLOCK_TOKEN) {
+    /* 64 byte SD Status followed by the CRC, AU_SIZE are bits 431:428 */
+    for (i = 0; i < 64 + 2; i++) {
+      ret = mspi_transceive(MSPI_DUMMY_BYTE);
+      if (i == 10) {
+        au = ret >> 4;
+      }
     }
   }
-  get_csd_info(csd);
 
   mspi_chip_release(MICRO_SD_CS);
 
-  return SDCARD_SUCCESS;
+  PRINTF("\nsdcard_get_au_size(): AU_SIZE = %u", au);
+
+  /* 16 KB * 2^(AU_SIZE - 1) up to 8 MB, 32 blocks are 16 KB */
+  if (au == 0) {
+    return 0;
+  } else if (au <= 0xA) {
+    return 32UL << (au - 1);
+  }
+  return (uint32_t) au_mb[au - 0xB] * 2048;
 }
 /*----------------------------------------------------------------------------*/
 uint8_t
 sdcard_erase_blocks(uint32_t startaddr, uint32_t endaddr)
 {
   uint16_t ret;
+  uint16_t i;
 
   /* calculate the start address: block_addr = addr * 512
    * this is only needed if the card is a SDSC card and uses
@@ -718,14 +935,27 @@ sdcard_erase_blocks(uint32_t startaddr, uint32_t endaddr)
     return ret;
   }
 
+  /* card signals busy until erasing is done, which takes much longer
+   * than a write operation */
+  for (i = 0; (mspi_transceive(MSPI_DUMMY_BYTE) != SD_DATA_HIGH)
+      && (mspi_transceive(MSPI_DUMMY_BYTE) != SD_DATA_HIGH); i++) {
+    if (i >= ERASE_WAIT_MS) {
+      mspi_chip_release(MICRO_SD_CS);
+      PRINTD("\nsdcard_erase_blocks(): Erase timeout");
+      return SDCARD_BUSY_TIMEOUT;
+    }
+    watchdog_periodic();
+    _delay_ms(1);
+  }
+
   /* release chip select and disable sdcard spi */
   mspi_chip_release(MICRO_SD_CS);
 
   return SDCARD_SUCCESS;
 }
 /*----------------------------------------------------------------------------*/
-uint8_t
-sdcard_read_block(uint32_t addr, uint8_t *buffer)
+static uint8_t
+read_block(uint32_t addr, uint8_t *buffer)
 {
   uint16_t i;
   uint8_t ret;
@@ -769,20 +999,147 @@ sdcard_read_block(uint32_t addr, uint8_t *buffer)
   }
 
   /* transfer block */
-  for (i = 0; i < 512; i++) {
-    buffer[i] = mspi_transceive(MSPI_DUMMY_BYTE);
+  ret = sdcard_read_data(buffer);
+
+  /* release chip select and disable sdcard spi */
+  mspi_chip_release(MICRO_SD_CS);
+
+  return ret;
+}
+/*----------------------------------------------------------------------------*/
+uint8_t
+sdcard_read_block(uint32_t addr, uint8_t *buffer)
+{
+  uint8_t ret;
+
+  if (mspi_transaction_begin(MICRO_SD_CS)) {
+    return SDCARD_BUS_BUSY;
   }
+  ret = read_block(addr, buffer);
+  mspi_transaction_end(MICRO_SD_CS);
 
-  /* Read CRC-Byte: don't care */
-  mspi_transceive(MSPI_DUMMY_BYTE);
-  mspi_transceive(MSPI_DUMMY_BYTE);
+  return ret;
+}
+/*----------------------------------------------------------------------------*/
+uint8_t
+sdcard_read_multi_block_start(uint32_t addr)
+{
+  uint8_t ret;
+
+  /* calculate the start address: byte_addr = block_addr * 512.
+   * this is only needed if the card is a SDSC card and uses
+   * byte addressing (Block size of 512 is set in sdcard_init()).
+   * SDHC and SDXC card use block-addressing with a fixed block size
+   * of 512 Bytes.
+   */
+  if (sdcard_sdsc_card) {
+    addr = addr << 9;
+  }
+
+  /* the whole transfer is done with the bus held */
+  if (mspi_transaction_begin(MICRO_SD_CS)) {
+    return SDCARD_BUS_BUSY;
+  }
+
+  mspi_chip_select(MICRO_SD_CS);
+
+  if (sdcard_busy_wait() == SDCARD_BUSY_TIMEOUT) {
+    mspi_transaction_end(MICRO_SD_CS);
+    return SDCARD_BUSY_TIMEOUT;
+  }
+
+  /* send CMD18 with address information. */
+  if ((ret = sdcard_write_cmd(SDCARD_CMD18, &addr, NULL)) != 0x00) {
+    PRINTD("\nsdcard_read_multi_block_start(): CMD18 failure! (%u)", ret);
+    mspi_chip_release(MICRO_SD_CS);
+    mspi_transaction_end(MICRO_SD_CS);
+    return SDCARD_CMD_ERROR;
+  }
+
+  mspi_chip_release(MICRO_SD_CS);
+
+  return SDCARD_SUCCESS;
+}
+/*----------------------------------------------------------------------------*/
+uint8_t
+sdcard_read_multi_block_next(uint8_t *buffer)
+{
+  uint16_t i;
+  uint8_t ret;
+
+  mspi_chip_select(MICRO_SD_CS);
+
+  /* wait for the 0xFE start byte */
+  i = 0;
+  while ((ret = mspi_transceive(MSPI_DUMMY_BYTE)) == SD_DATA_HIGH) {
+    i++;
+    if (i >= 2000) {
+      PRINTD("\nsdcard_read_multi_block_next(): No Start Byte recieved");
+      mspi_chip_release(MICRO_SD_CS);
+      return SDCARD_DATA_TIMEOUT;
+    }
+  }
+  /* exit on error response */
+  if (ret != START_BLOCK_TOKEN) {
+#if DEBUG
+    dbg_data_err(ret);
+#endif // debug
+    mspi_chip_release(MICRO_SD_CS);
+    return SDCARD_DATA_ERROR;
+  }
+
+  /* transfer block */
+  ret = sdcard_read_data(buffer);
+
+  /* release chip select and disable sdcard spi */
+  mspi_chip_release(MICRO_SD_CS);
+
+  return ret;
+}
+/*----------------------------------------------------------------------------*/
+uint8_t
+sdcard_read_multi_block_stop()
+{
+  uint8_t ret;
+
+  mspi_chip_select(MICRO_SD_CS);
+
+  /* send CMD12 to stop the data transmission */
+  ret = sdcard_write_cmd(SDCARD_CMD12, NULL, NULL);
+
+  /* wait until card finished (R1b response) */
+  if (sdcard_busy_wait() == SDCARD_BUSY_TIMEOUT) {
+    mspi_chip_release(MICRO_SD_CS);
+    mspi_transaction_end(MICRO_SD_CS);
+    return SDCARD_BUSY_TIMEOUT;
+  }
 
   /* release chip select and disable sdcard spi */
   mspi_chip_release(MICRO_SD_CS);
+  mspi_transaction_end(MICRO_SD_CS);
+
+  if (ret != 0x00) {
+    PRINTD("\nsdcard_read_multi_block_stop(): CMD12 failure! (%u)", ret);
+    return SDCARD_CMD_ERROR;
+  }
 
   return SDCARD_SUCCESS;
 }
 /*----------------------------------------------------------------------------*/
+uint8_t
+sdcard_is_busy(void)
+{
+  uint8_t busy;
+
+  mspi_chip_select(MICRO_SD_CS);
+  /* busy signal becomes high only when clocked before, so check twice */
+  busy = (mspi_transceive(MSPI_DUMMY_BYTE) != SD_DATA_HIGH)
+          && (mspi_transceive(MSPI_DUMMY_BYTE) != SD_DATA_HIGH);
+  mspi_chip_release(MICRO_SD_CS);
+
+  return busy;
+}
+/*----------------------------------------------------------------------------*/
 /* @TODO: currently not used in any way */
 uint16_t
 sdcard_get_status(void)
@@ -801,8 +1158,8 @@ sdcard_get_status(void)
   return ((uint16_t) resp[1] << 8) + ((uint16_t) resp[0]);
 }
 /*----------------------------------------------------------------------------*/
-uint8_t
-sdcard_write_block(uint32_t addr, uint8_t *buffer)
+static uint8_t
+write_block(uint32_t addr, uint8_t *buffer)
 {
   uint16_t i;
 
@@ -832,15 +1189,8 @@ sdcard_write_block(uint32_t addr, uint8_t *buffer)
    * of one data block (512byte) */
   mspi_transceive(START_BLOCK_TOKEN);
 
-  /* send 1 block (512byte) to the sdcard card */
-  for (i = 0; i < 512; i++) {
-    mspi_transceive(buffer[i]);
-  }
-
-  /* write dummy 16 bit CRC checksum */
-  /** @todo: handle crc enabled? */
-  mspi_transceive(MSPI_DUMMY_BYTE);
-  mspi_transceive(MSPI_DUMMY_BYTE);
+  /* send 1 block (512byte) and its CRC to the sdcard card */
+  sdcard_write_data(buffer);
 
   /* failure check: Data Response XXX0RRR1 */
   i = mspi_transceive(MSPI_DUMMY_BYTE) & 0x1F;
@@ -871,6 +1221,20 @@ sdcard_write_block(uint32_t addr, uint8_t *buffer)
 }
 /*----------------------------------------------------------------------------*/
 uint8_t
+sdcard_write_block(uint32_t addr, uint8_t *buffer)
+{
+  uint8_t ret;
+
+  if (mspi_transaction_begin(MICRO_SD_CS)) {
+    return SDCARD_BUS_BUSY;
+  }
+  ret = write_block(addr, buffer);
+  mspi_transaction_end(MICRO_SD_CS);
+
+  return ret;
+}
+/*----------------------------------------------------------------------------*/
+uint8_t
 sdcard_write_multi_block_start(uint32_t addr, uint32_t num_blocks)
 {
 
@@ -884,22 +1248,32 @@ sdcard_write_multi_block_start(uint32_t addr, uint32_t num_blocks)
     addr = addr << 9;
   }
 
+  /* the whole transfer is done with the bus held */
+  if (mspi_transaction_begin(MICRO_SD_CS)) {
+    return SDCARD_BUS_BUSY;
+  }
+
   mspi_chip_select(MICRO_SD_CS);
 
   if (sdcard_busy_wait() == SDCARD_BUSY_TIMEOUT) {
+    mspi_transaction_end(MICRO_SD_CS);
     return SDCARD_BUSY_TIMEOUT;
   }
 
   if (num_blocks != 0) {
-    /* Announce number of blocks to write to card for pre-erase
-     * Note. */
+    /* Announce number of blocks to write to card for pre-erase.
+     * The count has 23 bits, failing is not critical since it is a hint only. */
     PRINTF("\nPre-erasing %ld blocks", num_blocks);
-    sdcard_write_cmd(SDCARD_ACMD23, &num_blocks, NULL);
+    num_blocks &= 0x007FFFFF;
+    if (sdcard_write_cmd(SDCARD_ACMD23, &num_blocks, NULL) != 0x00) {
+      PRINTD("\nsdcard_write_multi_block_start(): ACMD23 failed");
+    }
   }
 
   /* send CMD25 with address information. */
   if (sdcard_write_cmd(SDCARD_CMD25, &addr, NULL) != 0x00) {
     mspi_chip_release(MICRO_SD_CS);
+    mspi_transaction_end(MICRO_SD_CS);
     return SDCARD_CMD_ERROR;
   }
 
@@ -921,15 +1295,8 @@ sdcard_write_multi_block_next(uint8_t *buffer)
    * of one data block (512byte) */
   mspi_transceive(MULTI_START_BLOCK_TOKEN);
 
-  /* send 1 block (512byte) to the sdcard card */
-  for (i = 0; i < 512; i++) {
-    mspi_transceive(buffer[i]);
-  }
-
-  /* write dummy 16 bit CRC checksum */
-  /** @todo: handle crc enabled? */
-  mspi_transceive(MSPI_DUMMY_BYTE);
-  mspi_transceive(MSPI_DUMMY_BYTE);
+  /* send 1 block (512byte) and its CRC to the sdcard card */
+  sdcard_write_data(buffer);
 
   /* failure check: Data Response XXX0RRR1 */
   i = mspi_transceive(MSPI_DUMMY_BYTE) & 0x1F;
@@ -962,6 +1329,7 @@ sdcard_write_multi_block_stop()
   mspi_chip_select(MICRO_SD_CS);
 
   if (sdcard_busy_wait() == SDCARD_BUSY_TIMEOUT) {
+    mspi_transaction_end(MICRO_SD_CS);
     return SDCARD_BUSY_TIMEOUT;
   }
 
@@ -971,6 +1339,7 @@ sdcard_write_multi_block_stop()
 
   /* release chip select and disable sdcard spi */
   mspi_chip_release(MICRO_SD_CS);
+  mspi_transaction_end(MICRO_SD_CS);
 
   return SDCARD_SUCCESS;
 }
@@ -1053,6 +1422,11 @@ sdcard_write_cmd(uint8_t cmd, uint32_t *arg, uint8_t *resp)
     mspi_transceive(*(cmd_seq + i));
   }
 
+  /* CMD12 is followed by a stuff byte that must be skipped */
+  if (cmd == SDCARD_CMD12) {
+    mspi_transceive(MSPI_DUMMY_BYTE);
+  }
+
   /* wait for the answer of the sd card */
   i = 0;
   do {
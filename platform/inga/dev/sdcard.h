@@ -47,11 +47,12 @@
  * This driver provides the following main features:
  *
  * - single block read
+ * - multi block read
  * - single block write
  * - multi block write
  *
- * Note that multiple bock write is faster than single block write
- * but only writes sequential block numbers
+ * Note that multiple bock read and write is faster than single block
+ * read and write but only accesses sequential block numbers
  *
  * \note CRC functionality is not fully implemented thus it sould not be used yet.
  *
@@ -95,6 +96,8 @@
 #define SDCARD_BUSY_TIMEOUT       8
 /** Failed reading CSD register */
 #define SDCARD_CSD_ERROR          10
+/** The SPI bus is held by another device, see mspi_transaction_begin() */
+#define SDCARD_BUS_BUSY           11
 /** \} */
 
 #define SDCARD_WRITE_COMMAND_ERROR  1
@@ -114,6 +117,22 @@
  */
 uint8_t sdcard_init(void);
 
+/**
+ * \brief Initializes the SD Card again after it was powered off.
+ *
+ * Only brings the card back into transfer state. The card type, block
+ * count and transfer rate found by the last sdcard_init() are reused, so
+ * the card must not have been changed in between.
+ * Falls back to sdcard_init() if the card was never initialized.
+ *
+ * \retval SDCARD_SUCCESS SD-Card was initialized without an error
+ * \retval SDCARD_CMD_ERROR
+ * \retval SDCARD_CMD_TIMEOUT
+ * \retval SDCARD_REJECTED
+ * \retval SDCARD_CSD_ERROR
+ */
+uint8_t sdcard_resume(void);
+
 /**
  * \brief This function will read the CSD (16 Bytes) of the SD-Card.
  *
@@ -148,6 +167,13 @@ uint16_t sdcard_get_block_size();
  */
 uint8_t sdcard_is_SDSC();
 
+/**
+ * \brief Checks if the card is busy without waiting.
+ *
+ * \return 1 if the card is busy (e.g. still programming), 0 otherwise
+ */
+uint8_t sdcard_is_busy(void);
+
 /**
  * Turns crc capabilities of the card on or off.
  *
@@ -169,7 +195,27 @@ uint64_t sdcard_get_card_size();
 uint32_t sdcard_get_block_num();
 
 /**
- * @note Not implemented
+ * \brief Returns the size of the cards allocation unit (AU).
+ *
+ * The AU is the unit the card manages its flash in. Writes aligned to
+ * it are considerably faster. The size is read from the SD Status (ACMD13).
+ *
+ * \return AU size in blocks, 0 if the card does not report it
+ */
+uint32_t sdcard_get_au_size(void);
+
+/**
+ * \brief Erases the blocks from startaddr to endaddr (inclusive).
+ *
+ * Waits until the card finished erasing.
+ * Erased blocks read as all 0x00 or all 0xFF, depending on the card.
+ *
+ * \param startaddr First block to erase
+ * \param endaddr Last block to erase
+ *
+ * \retval SDCARD_SUCCESS Erasing was successful
+ * \retval SDCARD_BUSY_TIMEOUT Card did not finish erasing in time
+ * \return otherwise the R1 response of the failed command
  */
 uint8_t sdcard_erase_blocks(uint32_t startaddr, uint32_t endaddr);
 
@@ -184,9 +230,43 @@ uint8_t sdcard_erase_blocks(uint32_t startaddr, uint32_t endaddr);
  * \retval SDCARD_BUSY_TIMEOUT
  * \retval SDCARD_DATA_TIMEOUT
  * \retval SDCARD_DATA_ERROR
+ * \retval SDCARD_BUS_BUSY
  */
 uint8_t sdcard_read_block(uint32_t addr, uint8_t *buffer);
 
+/**
+ * \brief Prepares to read multiple blocks sequentially.
+ *
+ * On success the SPI bus is held for the card until
+ * sdcard_read_multi_block_stop().
+ *
+ * \param addr Address of first block
+ * \retval SDCARD_SUCCESS Starting multi block read was successful
+ * \retval SDCARD_CMD_ERROR CMD18 failure
+ * \retval SDCARD_BUSY_TIMEOUT
+ * \retval SDCARD_BUS_BUSY
+ */
+uint8_t sdcard_read_multi_block_start(uint32_t addr);
+
+/**
+ * \brief Reads next of multiple sequential blocks.
+ *
+ * \param buffer Pointer to a block buffer (needs to be as long as sdcard_get_block_size()).
+ * \retval SDCARD_SUCCESS Successfully read block
+ * \retval SDCARD_DATA_TIMEOUT
+ * \retval SDCARD_DATA_ERROR
+ */
+uint8_t sdcard_read_multi_block_next(uint8_t *buffer);
+
+/**
+ * \brief Stops multiple block read.
+ *
+ * \retval SDCARD_SUCCESS successfull
+ * \retval SDCARD_CMD_ERROR CMD12 failure
+ * \retval SDCARD_BUSY_TIMEOUT
+ */
+uint8_t sdcard_read_multi_block_stop();
+
 /**
  * \brief This function will write one block (512, 1024, 2048 or 4096Byte) of the SD-Card.
  *
@@ -197,18 +277,23 @@ uint8_t sdcard_read_block(uint32_t addr, uint8_t *buffer);
  * \retval SDCARD_CMD_ERROR CMD24 failure
  * \retval SDCARD_BUSY_TIMEOUT
  * \retval SDCARD_DATA_ERROR
+ * \retval SDCARD_BUS_BUSY
  */
 uint8_t sdcard_write_block(uint32_t addr, uint8_t *buffer);
 
 /**
  * \brief Prepares to write multiple blocks sequentially.
  *
+ * On success the SPI bus is held for the card until
+ * sdcard_write_multi_block_stop().
+ *
  * \param addr Address of first block
  * \param num_blocks Number of blocks that should be written (0 means not known yet).
  *        Givin a number here could speed up writing due to possible sector pre-erase
  * \retval SDCARD_SUCCESS Starting mutli lock write was successful
  * \retval SDCARD_CMD_ERROR CMD25 failure
  * \retval SDCARD_BUSY_TIMEOUT
+ * \retval SDCARD_BUS_BUSY
  */
 uint8_t sdcard_write_multi_block_start(uint32_t addr, uint32_t num_blocks);
 
@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2012, TU Braunschweig.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *      Sampling scheduler for the INGA sensors
+ */
+
+/**
+ * \addtogroup inga_sensor_sampler
+ * @{
+ */
+
+#include "contiki.h"
+#include "sensor-sampler.h"
+#include "adxl345.h"
+#include "l3g4200d.h"
+#include "bmp085.h"
+#include "battery-sensor.h"
+
+/* Operation mode of the pressure readout */
+#ifndef SENSOR_SAMPLER_CONF_PRESSURE_MODE
+#define SENSOR_SAMPLER_CONF_PRESSURE_MODE BMP085_STANDARD
+#endif
+
+/* true if time t has been reached at now, wrap safe */
+#define TIME_REACHED(now, t) \
+  ((clock_time_t) ((now) - (t)) <= ((clock_time_t) -1 >> 1))
+
+process_event_t sensor_sampler_event;
+
+PROCESS(sensor_sampler_process, "Sensor sampler");
+
+static struct {
+  clock_time_t period;
+  clock_time_t next;
+} schedule[SENSOR_SAMPLER_NUM];
+
+static struct process *subscribers[SENSOR_SAMPLER_CONF_SUBSCRIBERS];
+static struct etimer timer;
+static rtimer_clock_t pressure_time;
+/*---------------------------------------------------------------------------*/
+static void
+publish(struct sensor_sampler_record *rec)
+{
+  uint8_t i;
+
+  for (i = 0; i < SENSOR_SAMPLER_CONF_SUBSCRIBERS; i++) {
+    if (subscribers[i] != NULL) {
+      process_post_synch(subscribers[i], sensor_sampler_event, rec);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+pressure_done(void)
+{
+  struct sensor_sampler_record rec;
+  int32_t pressure = bmp085_async_pressure();
+
+  rec.time = pressure_time;
+  rec.sensor = SENSOR_SAMPLER_PRESSURE;
+  rec.count = 3;
+  rec.value[0] = (int16_t) (pressure >> 16);
+  rec.value[1] = (int16_t) (pressure & 0xFFFF);
+  rec.value[2] = bmp085_async_temperature();
+  publish(&rec);
+}
+/*---------------------------------------------------------------------------*/
+static void
+sample(uint8_t sensor)
+{
+  struct sensor_sampler_record rec;
+  acc_data_t acc;
+  angle_data_t angle;
+
+  rec.sensor = sensor;
+  rec.time = RTIMER_NOW();
+  switch (sensor) {
+    case SENSOR_SAMPLER_ACC:
+      acc = adxl345_get();
+      rec.count = 3;
+      rec.value[0] = acc.x;
+      rec.value[1] = acc.y;
+      rec.value[2] = acc.z;
+      break;
+    case SENSOR_SAMPLER_GYRO:
+      angle = l3g4200d_get_angle();
+      rec.count = 3;
+      rec.value[0] = angle.x;
+      rec.value[1] = angle.y;
+      rec.value[2] = angle.z;
+      break;
+    case SENSOR_SAMPLER_PRESSURE:
+      /* published by pressure_done(), a busy sensor skips this period */
+      if (bmp085_read_async(SENSOR_SAMPLER_CONF_PRESSURE_MODE, pressure_done) == 0) {
+        pressure_time = rec.time;
+      }
+      return;
+    case SENSOR_SAMPLER_BATTERY:
+      rec.count = 2;
+      rec.value[0] = battery_sensor.value(BATTERY_VOLTAGE);
+      rec.value[1] = battery_sensor.value(BATTERY_CURRENT);
+      break;
+    default:
+      return;
+  }
+  publish(&rec);
+}
+/*---------------------------------------------------------------------------*/
+/* Reads all sensors due at now and returns the time until the next one. */
+static clock_time_t
+run_schedule(clock_time_t now)
+{
+  clock_time_t wait = 0;
+  clock_time_t left;
+  uint8_t i;
+
+  for (i = 0; i < SENSOR_SAMPLER_NUM; i++) {
+    if (schedule[i].period == 0) {
+      continue;
+    }
+    if (TIME_REACHED(now, schedule[i].next)) {
+      sample(i);
+      schedule[i].next += schedule[i].period;
+      /* skip missed periods instead of catching up */
+      if (TIME_REACHED(now, schedule[i].next)) {
+        schedule[i].next = now + schedule[i].period;
+      }
+    }
+    left = schedule[i].next - now;
+    if (wait == 0 || left < wait) {
+      wait = left;
+    }
+  }
+  return wait;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(sensor_sampler_process, ev, data)
+{
+  clock_time_t wait;
+
+  PROCESS_BEGIN();
+
+  while (1) {
+    wait = run_schedule(clock_time());
+    if (wait == 0) {
+      /* nothing scheduled, wait for a new period */
+      PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+    } else {
+      etimer_set(&timer, wait);
+      PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL || etimer_expired(&timer));
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+int8_t
+sensor_sampler_set_period(uint8_t sensor, clock_time_t period)
+{
+  uint8_t i;
+
+  if (sensor >= SENSOR_SAMPLER_NUM) {
+    return -1;
+  }
+  schedule[sensor].period = period;
+  schedule[sensor].next = clock_time();
+  /* align to a running sensor with a matching period, so both
+   * are read in the same pass */
+  for (i = 0; i < SENSOR_SAMPLER_NUM; i++) {
+    if (i != sensor && schedule[i].period != 0 && period != 0
+            && (schedule[i].period % period == 0 || period % schedule[i].period == 0)) {
+      schedule[sensor].next = schedule[i].next;
+      break;
+    }
+  }
+
+  if (sensor_sampler_event == 0) {
+    sensor_sampler_event = process_alloc_event();
+  }
+  if (!process_is_running(&sensor_sampler_process)) {
+    process_start(&sensor_sampler_process, NULL);
+  } else {
+    process_poll(&sensor_sampler_process);
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int8_t
+sensor_sampler_subscribe(struct process *p)
+{
+  uint8_t i;
+
+  if (sensor_sampler_event == 0) {
+    sensor_sampler_event = process_alloc_event();
+  }
+  for (i = 0; i < SENSOR_SAMPLER_CONF_SUBSCRIBERS; i++) {
+    if (subscribers[i] == p) {
+      return 0;
+    }
+  }
+  for (i = 0; i < SENSOR_SAMPLER_CONF_SUBSCRIBERS; i++) {
+    if (subscribers[i] == NULL) {
+      subscribers[i] = p;
+      return 0;
+    }
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+void
+sensor_sampler_unsubscribe(struct process *p)
+{
+  uint8_t i;
+
+  for (i = 0; i < SENSOR_SAMPLER_CONF_SUBSCRIBERS; i++) {
+    if (subscribers[i] == p) {
+      subscribers[i] = NULL;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+
+/** @} */
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2012, TU Braunschweig.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *      Sampling scheduler for the INGA sensors
+ */
+
+/**
+ * \addtogroup inga_sensors
+ * @{
+ */
+
+/**
+ * \defgroup inga_sensor_sampler Sensor Sampling Scheduler
+ *
+ * The sampler reads the INGA sensors at individual rates from a single
+ * process. All sensors due at the same clock tick are read in one pass,
+ * each device within one bus transaction, and every sample is stamped
+ * with the rtimer time of its readout.
+ *
+ * Subscribed processes receive each sample as \ref sensor_sampler_event
+ * with a struct sensor_sampler_record as data.
+ *
+ * The sensors have to be activated by the application before, the
+ * sampler only reads them.
+ *
+\code
+SENSORS_ACTIVATE(acc_sensor);
+sensor_sampler_subscribe(PROCESS_CURRENT());
+sensor_sampler_set_period(SENSOR_SAMPLER_ACC, CLOCK_SECOND / 32);
+[...]
+PROCESS_WAIT_EVENT_UNTIL(ev == sensor_sampler_event);
+rec = (struct sensor_sampler_record *) data;
+\endcode
+ * @{
+ */
+
+#ifndef SENSOR_SAMPLER_H_
+#define SENSOR_SAMPLER_H_
+
+#include "contiki.h"
+
+/**
+ * \name Sensor identifiers
+ * @{ */
+/** Accelerometer, raw x, y, z */
+#define SENSOR_SAMPLER_ACC       0
+/** Gyroscope, raw x, y, z */
+#define SENSOR_SAMPLER_GYRO      1
+/** Pressure [Pa] high and low word, temperature [0.1 C] */
+#define SENSOR_SAMPLER_PRESSURE  2
+/** Battery voltage [mV] and current */
+#define SENSOR_SAMPLER_BATTERY   3
+#define SENSOR_SAMPLER_NUM       4
+/** @} */
+
+/** Maximum number of subscribed processes */
+#ifndef SENSOR_SAMPLER_CONF_SUBSCRIBERS
+#define SENSOR_SAMPLER_CONF_SUBSCRIBERS 2
+#endif
+
+/** A single timestamped sample */
+struct sensor_sampler_record {
+  /** rtimer time of the readout */
+  rtimer_clock_t time;
+  /** One of the sensor identifiers */
+  uint8_t sensor;
+  /** Number of valid values */
+  uint8_t count;
+  int16_t value[3];
+};
+
+/** Event posted to subscribers for every record */
+extern process_event_t sensor_sampler_event;
+
+PROCESS_NAME(sensor_sampler_process);
+
+/**
+ * \brief Sets the sampling period of a sensor.
+ *
+ * Starts the sampler if needed. Periods are given in clock ticks,
+ * sensors with equal or multiple periods are read in the same pass.
+ *
+ * \param sensor One of the sensor identifiers
+ * \param period Sampling period, 0 stops sampling the sensor
+ * \return 0 on success, -1 for an unknown sensor
+ */
+int8_t sensor_sampler_set_period(uint8_t sensor, clock_time_t period);
+
+/**
+ * \brief Subscribes a process to the records.
+ * \return 0 on success, -1 if all subscriber slots are used
+ */
+int8_t sensor_sampler_subscribe(struct process *p);
+
+/**
+ * \brief Removes a process from the subscribers.
+ */
+void sensor_sampler_unsubscribe(struct process *p);
+
+#endif /* SENSOR_SAMPLER_H_ */
+
+/** @} */
+/** @} */
@@ -49,25 +49,48 @@
         sdcard_write_block( block_start_address, buffer )
 #define SD_INIT() \
         sdcard_init()
+#define SD_RESUME() \
+        sdcard_resume()
+#define SD_POWER_ON() \
+        SDCARD_POWER_ON()
+#define SD_POWER_OFF() \
+        SDCARD_POWER_OFF()
 #define SD_GET_BLOCK_NUM() \
         sdcard_get_block_num()
 #define SD_GET_BLOCK_SIZE() \
         sdcard_get_block_size()
+#define SD_IS_BUSY() \
+        sdcard_is_busy()
+#define SD_GET_ERASE_UNIT() \
+        sdcard_get_au_size()
+#define SD_READ_BLOCKS_START(blocks_start_address, num_blocks) \
+        sdcard_read_multi_block_start(blocks_start_address)
+#define SD_READ_BLOCKS_NEXT(buffer) \
+        sdcard_read_multi_block_next(buffer)
+#define SD_READ_BLOCKS_DONE() \
+        sdcard_read_multi_block_stop()
 #define SD_WRITE_BLOCKS_START(blocks_start_address, num_blocks) \
         sdcard_write_multi_block_start(blocks_start_address, num_blocks)
 #define SD_WRITE_BLOCKS_NEXT(buffer) \
         sdcard_write_multi_block_next(buffer)
 #define SD_WRITE_BLOCKS_DONE() \
         sdcard_write_multi_block_stop()
+#define SD_ERASE_BLOCKS(blocks_start_address, num_blocks) \
+        sdcard_erase_blocks(blocks_start_address, \
+        (blocks_start_address) + (num_blocks) - 1)
 
 
-#define FLASH_READ_BLOCK(block_start_address, offset, buffer, length) \
-        at45db_read_page_bypassed( block_start_address, offset, buffer, length)
-#define FLASH_WRITE_BLOCK(block_start_address, offset, buffer, length) \
-        at45db_write_buffer( offset, buffer, length ); \
-        at45db_buffer_to_page( block_start_address );
+#define FLASH_READ_BLOCK(block_start_address, buffer) \
+        at45db_read_block( block_start_address, buffer )
+#define FLASH_WRITE_BLOCK(block_start_address, buffer) \
+        at45db_write_block( block_start_address, buffer )
+#define FLASH_SYNC() \
+        at45db_flush_blocks()
 #define FLASH_INIT() \
         at45db_init()
+/* 512 byte blocks are packed into all 528 bytes of the pages */
+#define FLASH_ARCH_NUM_SECTORS	AT45DB_BLOCKS
+#define FLASH_ARCH_SECTOR_SIZE	AT45DB_BLOCK_SIZE
 
 #endif /* DISKIO_ARCH_H */
 
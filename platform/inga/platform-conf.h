@@ -60,6 +60,28 @@
 #define INGA_REVISION INGA_CONF_REVISION
 #endif
 
+/** Sleep in power-save mode until the next etimer expires when no process
+ * has work left. The radio, UART and rtimer interrupts can not wake the MCU
+ * from power-save, so the node falls back to idle sleep while the radio is
+ * on, an rtimer is scheduled or an ADC scan is running. Serial input is
+ * lost while sleeping.
+ */
+#ifndef INGA_CONF_TICKLESS_IDLE
+#define INGA_TICKLESS_IDLE 0
+#else
+#define INGA_TICKLESS_IDLE INGA_CONF_TICKLESS_IDLE
+#endif
+
+/** Probe the acceleration, gyroscope and pressure sensors when their
+ * SENSORS_READY status is queried or they are activated first, instead of
+ * at boot. A missing sensor delays the boot by more than 100 ms otherwise.
+ */
+#ifndef INGA_CONF_LAZY_SENSORS
+#define INGA_LAZY_SENSORS 1
+#else
+#define INGA_LAZY_SENSORS INGA_CONF_LAZY_SENSORS
+#endif
+
 #define PLATFORM       PLATFORM_AVR
 
 /** Currently all INGA revisions use same HAL */
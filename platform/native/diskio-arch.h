@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *      Diskio driver definitions - Platform Specific
+ *
+ *      The file backed disk of dev/disk-native.h is used as SD card, the
+ *      RAM backed disk as flash.
+ */
+
+#ifndef DISKIO_ARCH_H
+#define DISKIO_ARCH_H
+
+#include "dev/disk-native.h"
+#include <unistd.h>
+
+/* Used by the diskio retry loops */
+#define _delay_ms(ms) usleep((ms) * 1000UL)
+
+#define SD_READ_BLOCK(block_start_address, buffer) \
+        disk_native_read_block(DISK_NATIVE_FILE, block_start_address, buffer)
+#define SD_WRITE_BLOCK(block_start_address, buffer) \
+        disk_native_write_block(DISK_NATIVE_FILE, block_start_address, buffer)
+#define SD_INIT() \
+        disk_native_init(DISK_NATIVE_FILE)
+#define SD_GET_BLOCK_NUM() \
+        disk_native_get_block_num(DISK_NATIVE_FILE)
+#define SD_GET_BLOCK_SIZE() \
+        DISK_NATIVE_BLOCK_SIZE
+#define SD_READ_BLOCKS_START(blocks_start_address, num_blocks) \
+        disk_native_read_multi_block_start(DISK_NATIVE_FILE, blocks_start_address)
+#define SD_READ_BLOCKS_NEXT(buffer) \
+        disk_native_read_multi_block_next(DISK_NATIVE_FILE, buffer)
+#define SD_READ_BLOCKS_DONE() \
+        disk_native_multi_block_stop(DISK_NATIVE_FILE)
+#define SD_WRITE_BLOCKS_START(blocks_start_address, num_blocks) \
+        disk_native_write_multi_block_start(DISK_NATIVE_FILE, blocks_start_address, num_blocks)
+#define SD_WRITE_BLOCKS_NEXT(buffer) \
+        disk_native_write_multi_block_next(DISK_NATIVE_FILE, buffer)
+#define SD_WRITE_BLOCKS_DONE() \
+        disk_native_multi_block_stop(DISK_NATIVE_FILE)
+#define SD_ERASE_BLOCKS(blocks_start_address, num_blocks) \
+        disk_native_erase_blocks(DISK_NATIVE_FILE, blocks_start_address, num_blocks)
+
+#define FLASH_READ_BLOCK(block_start_address, buffer) \
+        disk_native_read_block(DISK_NATIVE_RAM, block_start_address, buffer)
+#define FLASH_WRITE_BLOCK(block_start_address, buffer) \
+        disk_native_write_block(DISK_NATIVE_RAM, block_start_address, buffer)
+#define FLASH_SYNC() \
+        disk_native_sync(DISK_NATIVE_RAM)
+#define FLASH_INIT() \
+        disk_native_init(DISK_NATIVE_RAM)
+#define FLASH_ARCH_NUM_SECTORS	DISK_NATIVE_RAM_BLOCKS
+#define FLASH_ARCH_SECTOR_SIZE	DISK_NATIVE_BLOCK_SIZE
+
+#endif /* DISKIO_ARCH_H */
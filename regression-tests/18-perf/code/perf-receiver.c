@@ -0,0 +1,55 @@
+#include "contiki.h"
+#include "contiki-lib.h"
+#include "contiki-net.h"
+
+#include <stdio.h>
+
+#define UDP_PORT 61619
+
+static struct simple_udp_connection connection;
+
+/*---------------------------------------------------------------------------*/
+PROCESS(perf_receiver_process, "UDP goodput receiver");
+AUTOSTART_PROCESSES(&perf_receiver_process);
+/*---------------------------------------------------------------------------*/
+static void
+receiver(struct simple_udp_connection *c,
+         const uip_ipaddr_t *sender_addr,
+         uint16_t sender_port,
+         const uip_ipaddr_t *receiver_addr,
+         uint16_t receiver_port,
+         const uint8_t *data,
+         uint16_t datalen)
+{
+  static uint16_t last_seqno;
+  uint16_t seqno;
+  uip_ipaddr_t addr;
+
+  if(datalen < 2) {
+    return;
+  }
+  seqno = data[0] | (data[1] << 8);
+
+  /* Retransmissions are acknowledged again but not counted */
+  if(seqno != last_seqno) {
+    last_seqno = seqno;
+    printf("Perf data %u %u\n", seqno, datalen);
+  }
+
+  uip_create_linklocal_allnodes_mcast(&addr);
+  simple_udp_sendto(&connection, data, 2, &addr);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(perf_receiver_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  simple_udp_register(&connection, UDP_PORT,
+                      NULL, UDP_PORT,
+                      receiver);
+
+  printf("Perf receiver started\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
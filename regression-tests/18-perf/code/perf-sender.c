@@ -0,0 +1,93 @@
+#include "contiki.h"
+#include "contiki-lib.h"
+#include "contiki-net.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define UDP_PORT 61619
+
+/* Payload of each datagram, fragmented by 6LoWPAN */
+#ifndef PERF_SIZE
+#define PERF_SIZE 400
+#endif
+
+/* Number of datagrams to transfer */
+#ifndef PERF_PACKETS
+#define PERF_PACKETS 100
+#endif
+
+/* Time to wait for an acknowledgement before resending */
+#define PERF_TIMEOUT (CLOCK_SECOND / 2)
+
+static struct simple_udp_connection connection;
+static uint16_t seqno;
+static uint8_t acked;
+
+/*---------------------------------------------------------------------------*/
+PROCESS(perf_sender_process, "UDP goodput sender");
+AUTOSTART_PROCESSES(&perf_sender_process);
+/*---------------------------------------------------------------------------*/
+static void
+receiver(struct simple_udp_connection *c,
+         const uip_ipaddr_t *sender_addr,
+         uint16_t sender_port,
+         const uip_ipaddr_t *receiver_addr,
+         uint16_t receiver_port,
+         const uint8_t *data,
+         uint16_t datalen)
+{
+  if(datalen >= 2 && (data[0] | (data[1] << 8)) == seqno) {
+    acked = 1;
+    process_poll(&perf_sender_process);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_packet(void)
+{
+  static uint8_t buf[PERF_SIZE];
+  uip_ipaddr_t addr;
+
+  memset(buf, seqno, sizeof(buf));
+  buf[0] = seqno & 0xff;
+  buf[1] = seqno >> 8;
+
+  uip_create_linklocal_allnodes_mcast(&addr);
+  simple_udp_sendto(&connection, buf, sizeof(buf), &addr);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(perf_sender_process, ev, data)
+{
+  static struct etimer timer;
+  static uint16_t retransmissions;
+
+  PROCESS_BEGIN();
+
+  simple_udp_register(&connection, UDP_PORT,
+                      NULL, UDP_PORT,
+                      receiver);
+
+  /* Give the receiver time to boot */
+  etimer_set(&timer, 10 * CLOCK_SECOND);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&timer));
+
+  printf("Perf start %u %u\n", PERF_PACKETS, PERF_SIZE);
+
+  for(seqno = 1; seqno <= PERF_PACKETS; seqno++) {
+    acked = 0;
+    while(!acked) {
+      send_packet();
+      etimer_set(&timer, PERF_TIMEOUT);
+      PROCESS_WAIT_EVENT_UNTIL(acked || etimer_expired(&timer));
+      if(!acked) {
+        retransmissions++;
+      }
+    }
+  }
+
+  printf("Perf done %u retransmissions\n", retransmissions);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,3 @@
+/* Room for a PERF_SIZE byte datagram and its headers */
+#undef UIP_CONF_BUFFER_SIZE
+#define UIP_CONF_BUFFER_SIZE 600
@@ -0,0 +1,27 @@
+/*
+ * Goodput of 6LoWPAN fragmented UDP datagrams between two nodes.
+ * Reports "PERF sixlowpan.goodput <bits/s> higher".
+ */
+TIMEOUT(600000, log.log("last message: " + msg + "\n"));
+
+start = -1;
+bytes = 0;
+while(true) {
+    YIELD();
+    if(msg.startsWith('Perf start')) {
+        start = time;
+    }
+    if(msg.startsWith('Perf data') && start >= 0) {
+        bytes += parseInt(msg.split(" ")[3]);
+    }
+    if(msg.startsWith('Perf done')) {
+        if(start < 0 || time == start || bytes == 0) {
+            log.testFailed();
+        }
+        /* Simulation time is in microseconds */
+        goodput = Math.round(bytes * 8 * 1000000 / (time - start));
+        log.log("Received " + bytes + " bytes in " + (time - start) + " us, " + msg + "\n");
+        log.log("PERF sixlowpan.goodput " + goodput + " higher\n");
+        log.testOK();
+    }
+}
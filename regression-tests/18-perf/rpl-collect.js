@@ -0,0 +1,81 @@
+/*
+ * RPL convergence and ContikiMAC duty cycle of a 25 node collect network.
+ * Reports "PERF rpl.convergence <ms> lower", the time from the boot of
+ * the last node until the sink heard from every node, and
+ * "PERF contikimac.duty_cycle <percent> lower", the radio on time of all
+ * senders during the following measure period.
+ */
+TIMEOUT(1200000, log.log("last message: " + msg + "\n"));
+
+/* Conf. */
+sink = 1;
+nrNodes = 25;
+measure = 300000000; /* us */
+
+booted = new Array();
+reported = new Array();
+for(i = 1; i <= nrNodes; i++) {
+  booted[i] = false;
+  reported[i] = false;
+}
+
+/* Wait until all nodes have started */
+nodes_starting = true;
+while(nodes_starting) {
+  YIELD_THEN_WAIT_UNTIL(msg.startsWith('Star'));
+  booted[id] = true;
+  for(i = 1; i <= nrNodes; i++) {
+    if(!booted[i]) {
+      break;
+    }
+    if(i == nrNodes) {
+      nodes_starting = false;
+    }
+  }
+}
+started = time;
+log.log("All nodes booted at " + started + " us\n");
+
+converged = -1;
+missing = nrNodes - 1;
+on = 0;
+total = 0;
+while(true) {
+  YIELD();
+
+  if(msg.contains("ÿ")) {
+    msg = msg.replace("ÿ", "");
+  }
+  data = msg.split(" ");
+  if(!data[24]) {
+    continue;
+  }
+
+  source = parseInt(data[4]) & 0xff;
+  if(converged < 0) {
+    if(source != sink && !reported[source]) {
+      reported[source] = true;
+      missing--;
+      if(missing == 0) {
+        converged = time;
+        log.log("Heard from all nodes at " + converged + " us\n");
+        log.log("PERF rpl.convergence " +
+                Math.round((converged - started) / 1000) + " lower\n");
+      }
+    }
+    continue;
+  }
+
+  /* Energest times of the reporting interval: cpu lpm transmit listen */
+  on += parseInt(data[13]) + parseInt(data[14]);
+  total += parseInt(data[11]) + parseInt(data[12]);
+
+  if(time - converged >= measure) {
+    if(total == 0) {
+      log.testFailed();
+    }
+    log.log("PERF contikimac.duty_cycle " +
+            (Math.round(on * 10000 / total) / 100) + " lower\n");
+    log.testOK();
+  }
+}
@@ -0,0 +1,48 @@
+#!/bin/bash
+# Compares performance results against a baseline.
+#
+#   perf-compare.sh RESULTS BASELINE
+#
+# RESULTS has "<metric> <value> <higher|lower>" lines, BASELINE has
+# "<metric> <value> <higher|lower> <tolerance in percent>" lines. Prints
+# one line per metric: OK if it is within the tolerance or better, FAIL
+# if it got worse by more than the tolerance or is missing from the
+# results, NEW if the baseline does not know it yet.
+
+RESULTS=$1
+BASELINE=$2
+
+# Without a baseline every metric is new
+if [ ! -f "$BASELINE" ] ; then
+  BASELINE=/dev/null
+fi
+
+awk '
+FILENAME == ARGV[1] {
+  base[$1] = $2; better[$1] = $3; tolerance[$1] = $4
+  next
+}
+{
+  seen[$1] = 1
+  if(!($1 in base)) {
+    printf("%s %s: NEW\n", $1, $2)
+    next
+  }
+  b = base[$1]; v = $2
+  if(b == 0) {
+    change = (v == 0) ? 0 : 100
+  } else {
+    change = (v - b) * 100 / b
+  }
+  worse = (better[$1] == "higher") ? -change : change
+  status = (worse > tolerance[$1]) ? "FAIL ಠ_ಠ" : "OK"
+  printf("%s %s (baseline %s, %+.1f%%, tolerance %s%%): %s\n",
+         $1, v, b, change, tolerance[$1], status)
+}
+END {
+  for(m in base) {
+    if(!(m in seen)) {
+      printf("%s missing (baseline %s): FAIL ಠ_ಠ\n", m, base[m]) | "sort"
+    }
+  }
+}' "$BASELINE" "$RESULTS"
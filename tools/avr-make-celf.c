@@ -0,0 +1,469 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Converts an AVR ELF module (ld -r output) into a compact module for
+ * celfloader_load() (core/loader/celfloader.h). Undefined symbols are
+ * resolved against symbols.c, as generated by avr-make-symbols for the
+ * firmware that will load the module, and the relocations are sorted
+ * by offset.
+ *
+ * Usage: avr-make-celf symbols.c module.ce module.celf
+ *
+ * Build: gcc -o avr-make-celf -I../platform/native -I../cpu/native -I../core \
+ *          avr-make-celf.c ../core/lib/crc16.c
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <err.h>
+
+#include "lib/crc16.h"
+#include "loader/celfloader.h"
+
+#define ET_REL       1
+#define EM_AVR       83
+#define SHT_SYMTAB   2
+#define SHT_RELA     4
+#define SHT_REL      9
+#define SHF_ALLOC    2
+#define SHN_UNDEF    0
+#define SHN_COMMON   0xfff2
+
+#define SYM_SIZE     16
+#define RELA_SIZE    12
+
+struct module {
+  const uint8_t *elf;
+  size_t size;
+  unsigned shnum;
+  int text, rodata, data, bss;
+  int symtab;
+  uint32_t textsize;
+};
+
+struct reloc {
+  struct celf_reloc r;
+  unsigned order;
+};
+
+static char **fw_names;
+static unsigned fw_nelts;
+static uint16_t fw_crc;
+
+static struct reloc *relocs[2];
+static unsigned nrelocs[2];
+
+/*---------------------------------------------------------------------------*/
+static uint8_t *
+read_file(const char *name, size_t *size)
+{
+  uint8_t *data = NULL;
+  FILE *fp;
+  size_t n;
+
+  if((fp = fopen(name, "rb")) == NULL) {
+    err(1, "%s", name);
+  }
+  *size = 0;
+  while(!feof(fp)) {
+    data = realloc(data, *size + 4096 + 1);
+    if(data == NULL) {
+      err(1, "realloc");
+    }
+    n = fread(data + *size, 1, 4096, fp);
+    if(ferror(fp)) {
+      err(1, "%s", name);
+    }
+    *size += n;
+  }
+  data[*size] = 0;
+  fclose(fp);
+  return data;
+}
+/*---------------------------------------------------------------------------*/
+static void
+read_symbols(const char *name)
+{
+  char *text, *p, *end;
+  size_t size;
+
+  /* The table lists "{(const char*)s_<name>, (void*)<value>}," in
+     the order of symbols[]. */
+  text = (char *)read_file(name, &size);
+  p = strstr(text, "symbols[] = {");
+  if(p == NULL) {
+    errx(1, "%s: no symbol table", name);
+  }
+  while((p = strstr(p, "{(const char*)s_")) != NULL) {
+    p += strlen("{(const char*)s_");
+    end = strchr(p, ',');
+    if(end == NULL) {
+      break;
+    }
+    fw_names = realloc(fw_names, (fw_nelts + 1) * sizeof(fw_names[0]));
+    if(fw_names == NULL) {
+      err(1, "realloc");
+    }
+    fw_names[fw_nelts++] = strndup(p, end - p);
+    fw_crc = crc16_data((unsigned char *)p, end - p, fw_crc);
+    fw_crc = crc16_add(0, fw_crc);
+    p = end;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+find_symbol(const char *name)
+{
+  unsigned start, end, middle;
+  int r;
+
+  /* symbols[] is sorted, like symtab_lookup() expects. */
+  for(start = 0, end = fw_nelts; start < end;) {
+    middle = (start + end) / 2;
+    r = strcmp(name, fw_names[middle]);
+    if(r == 0) {
+      return middle;
+    } else if(r < 0) {
+      end = middle;
+    } else {
+      start = middle + 1;
+    }
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+get32(const uint8_t *p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+get16(const uint8_t *p)
+{
+  return p[0] | (p[1] << 8);
+}
+/*---------------------------------------------------------------------------*/
+static const uint8_t *
+at(const struct module *m, uint32_t offset, uint32_t len)
+{
+  if(offset > m->size || len > m->size - offset) {
+    errx(1, "truncated ELF file");
+  }
+  return m->elf + offset;
+}
+/*---------------------------------------------------------------------------*/
+/* Section header fields. */
+static const uint8_t *
+shdr(const struct module *m, int i)
+{
+  return at(m, get32(m->elf + 32) + i * get16(m->elf + 46), 40);
+}
+static uint32_t sh_name(const struct module *m, int i) { return get32(shdr(m, i)); }
+static uint32_t sh_type(const struct module *m, int i) { return get32(shdr(m, i) + 4); }
+static uint32_t sh_flags(const struct module *m, int i) { return get32(shdr(m, i) + 8); }
+static uint32_t sh_offset(const struct module *m, int i) { return get32(shdr(m, i) + 16); }
+static uint32_t sh_size(const struct module *m, int i) { return get32(shdr(m, i) + 20); }
+static uint32_t sh_link(const struct module *m, int i) { return get32(shdr(m, i) + 24); }
+static uint32_t sh_info(const struct module *m, int i) { return get32(shdr(m, i) + 28); }
+/*---------------------------------------------------------------------------*/
+static const char *
+string(const struct module *m, int strtab, uint32_t offset)
+{
+  const char *s;
+
+  if(offset >= sh_size(m, strtab)) {
+    errx(1, "bad string offset %lu", (unsigned long)offset);
+  }
+  s = (const char *)at(m, sh_offset(m, strtab), sh_size(m, strtab)) + offset;
+  if(memchr(s, 0, sh_size(m, strtab) - offset) == NULL) {
+    errx(1, "unterminated string");
+  }
+  return s;
+}
+/*---------------------------------------------------------------------------*/
+static int
+section_target(const struct module *m, int shndx, uint32_t value,
+	       uint8_t *target, uint16_t *out)
+{
+  if(shndx == m->text) {
+    *target = CELF_TARGET_ROM;
+  } else if(shndx == m->rodata) {
+    *target = CELF_TARGET_ROM;
+    value += m->textsize;
+  } else if(shndx == m->data) {
+    *target = CELF_TARGET_DATA;
+  } else if(shndx == m->bss) {
+    *target = CELF_TARGET_BSS;
+  } else {
+    return -1;
+  }
+  if(value > 0xffff) {
+    errx(1, "symbol value 0x%lx does not fit", (unsigned long)value);
+  }
+  *out = value;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+find_sections(struct module *m)
+{
+  const uint8_t *e = m->elf;
+  unsigned i, shstrndx;
+  const char *name;
+
+  if(m->size < 52 || memcmp(e, "\177ELF\1\1\1", 7) != 0) {
+    errx(1, "not a 32-bit little-endian ELF file");
+  }
+  if(get16(e + 16) != ET_REL || get16(e + 18) != EM_AVR) {
+    errx(1, "not a relocatable AVR object");
+  }
+  m->shnum = get16(e + 48);
+  shstrndx = get16(e + 50);
+  m->text = m->rodata = m->data = m->bss = m->symtab = -1;
+
+  for(i = 1; i < m->shnum; i++) {
+    name = string(m, shstrndx, sh_name(m, i));
+    if(sh_type(m, i) == SHT_SYMTAB) {
+      m->symtab = i;
+    } else if(strcmp(name, ".text") == 0) {
+      m->text = i;
+    } else if(strcmp(name, ".rodata") == 0) {
+      m->rodata = i;
+    } else if(strcmp(name, ".data") == 0) {
+      m->data = i;
+    } else if(strcmp(name, ".bss") == 0) {
+      m->bss = i;
+    } else if(sh_type(m, i) == SHT_REL) {
+      errx(1, "%s: only RELA relocations are supported", name);
+    } else if((sh_flags(m, i) & SHF_ALLOC) && sh_size(m, i) > 0) {
+      errx(1, "%s: unsupported section", name);
+    }
+  }
+  if(m->symtab < 0) {
+    errx(1, "no symbol table");
+  }
+  if(m->text < 0) {
+    errx(1, "no .text section");
+  }
+  m->textsize = sh_size(m, m->text);
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_relocs(const struct module *m, int relsec)
+{
+  const uint8_t *rela, *sym;
+  const char *name;
+  struct reloc *r;
+  uint32_t offset, info, nsyms;
+  int32_t addend;
+  int seg, section, index, strtab;
+  unsigned i, n;
+
+  section = sh_info(m, relsec);
+  if(section == m->text) {
+    seg = 0;
+  } else if(section == m->rodata) {
+    seg = 0;
+  } else if(section == m->data) {
+    seg = 1;
+  } else {
+    errx(1, "relocations for unsupported section %d", section);
+  }
+
+  strtab = sh_link(m, m->symtab);
+  nsyms = sh_size(m, m->symtab) / SYM_SIZE;
+  n = sh_size(m, relsec) / RELA_SIZE;
+  rela = at(m, sh_offset(m, relsec), n * RELA_SIZE);
+
+  for(i = 0; i < n; i++, rela += RELA_SIZE) {
+    offset = get32(rela);
+    info = get32(rela + 4);
+    addend = (int32_t)get32(rela + 8);
+    if(info >> 8 >= nsyms) {
+      errx(1, "bad symbol index %lu", (unsigned long)(info >> 8));
+    }
+    sym = at(m, sh_offset(m, m->symtab) + (info >> 8) * SYM_SIZE, SYM_SIZE);
+
+    relocs[seg] = realloc(relocs[seg], (nrelocs[seg] + 1) * sizeof(*r));
+    if(relocs[seg] == NULL) {
+      err(1, "realloc");
+    }
+    r = &relocs[seg][nrelocs[seg]];
+    r->order = nrelocs[seg]++;
+
+    if(section == m->rodata) {
+      offset += m->textsize;
+    }
+    if(offset > 0xffff || addend < -0x8000 || addend > 0x7fff) {
+      errx(1, "relocation at 0x%lx does not fit", (unsigned long)offset);
+    }
+    r->r.offset = offset;
+    r->r.type = info & 0xff;
+    r->r.addend = addend;
+
+    /* Symbols defined in the module need no lookup at all. */
+    if(section_target(m, get16(sym + 14), get32(sym + 4),
+		      &r->r.target, &r->r.value) == 0) {
+      continue;
+    }
+
+    name = string(m, strtab, get32(sym));
+    if(get16(sym + 14) == SHN_COMMON) {
+      errx(1, "%s: common symbol, compile with -fno-common", name);
+    }
+    if(get16(sym + 14) != SHN_UNDEF || *name == 0) {
+      errx(1, "%s: symbol in unsupported section", name);
+    }
+    index = find_symbol(name);
+    if(index < 0) {
+      errx(1, "%s: undefined symbol", name);
+    }
+    r->r.target = CELF_TARGET_SYMBOL;
+    r->r.value = index;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+compare_relocs(const void *a, const void *b)
+{
+  const struct reloc *ra = a, *rb = b;
+
+  if(ra->r.offset != rb->r.offset) {
+    return ra->r.offset < rb->r.offset ? -1 : 1;
+  }
+  return ra->order < rb->order ? -1 : 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+put16(FILE *out, unsigned value)
+{
+  putc(value & 0xff, out);
+  putc((value >> 8) & 0xff, out);
+}
+/*---------------------------------------------------------------------------*/
+static void
+put_section(FILE *out, const struct module *m, int i)
+{
+  if(i >= 0) {
+    fwrite(at(m, sh_offset(m, i), sh_size(m, i)), 1, sh_size(m, i), out);
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char **argv)
+{
+  struct module m;
+  const uint8_t *sym;
+  uint32_t romsize, datasize, bsssize;
+  uint8_t autostart_target = CELF_TARGET_NONE;
+  uint16_t autostart_value = 0;
+  unsigned i, j;
+  FILE *out;
+  long size;
+
+  if(argc != 4) {
+    errx(1, "usage: avr-make-celf symbols.c module.ce module.celf");
+  }
+  read_symbols(argv[1]);
+  m.elf = read_file(argv[2], &m.size);
+  find_sections(&m);
+
+  romsize = m.textsize + (m.rodata >= 0 ? sh_size(&m, m.rodata) : 0);
+  datasize = m.data >= 0 ? sh_size(&m, m.data) : 0;
+  bsssize = m.bss >= 0 ? sh_size(&m, m.bss) : 0;
+  if(romsize > 0xffff || datasize + bsssize > 0xffff) {
+    errx(1, "module too large");
+  }
+
+  for(i = 1; i < m.shnum; i++) {
+    if(sh_type(&m, i) == SHT_RELA) {
+      add_relocs(&m, i);
+    }
+  }
+  for(i = 0; i < 2; i++) {
+    if(nrelocs[i] > 0) {
+      qsort(relocs[i], nrelocs[i], sizeof(relocs[i][0]), compare_relocs);
+    }
+  }
+
+  for(i = 1; i < sh_size(&m, m.symtab) / SYM_SIZE; i++) {
+    sym = at(&m, sh_offset(&m, m.symtab) + i * SYM_SIZE, SYM_SIZE);
+    if(strcmp(string(&m, sh_link(&m, m.symtab), get32(sym)),
+	      "autostart_processes") == 0 &&
+       section_target(&m, get16(sym + 14), get32(sym + 4),
+		      &autostart_target, &autostart_value) == 0) {
+      break;
+    }
+  }
+  if(autostart_target == CELF_TARGET_NONE) {
+    warnx("no autostart_processes");
+  }
+
+  if((out = fopen(argv[3], "wb")) == NULL) {
+    err(1, "%s", argv[3]);
+  }
+  fwrite(CELF_MAGIC, 1, 4, out);
+  putc(CELF_VERSION, out);
+  putc(autostart_target, out);
+  put16(out, autostart_value);
+  put16(out, fw_nelts);
+  put16(out, fw_crc);
+  put16(out, romsize);
+  put16(out, datasize);
+  put16(out, bsssize);
+  put16(out, nrelocs[0]);
+  put16(out, nrelocs[1]);
+
+  put_section(out, &m, m.text);
+  put_section(out, &m, m.rodata);
+  put_section(out, &m, m.data);
+
+  for(i = 0; i < 2; i++) {
+    for(j = 0; j < nrelocs[i]; j++) {
+      put16(out, relocs[i][j].r.offset);
+      putc(relocs[i][j].r.type, out);
+      putc(relocs[i][j].r.target, out);
+      put16(out, relocs[i][j].r.value);
+      put16(out, (uint16_t)relocs[i][j].r.addend);
+    }
+  }
+
+  size = ftell(out);
+  if(ferror(out) || fclose(out) != 0) {
+    err(1, "%s", argv[3]);
+  }
+  printf("%lu bytes of ELF, %ld bytes of compact module\n",
+	 (unsigned long)m.size, size);
+
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
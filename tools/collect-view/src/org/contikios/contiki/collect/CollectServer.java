@@ -114,7 +114,11 @@ public class CollectServer implements SerialConnectionListener {
   private String configFile;
   private Properties configTable = new Properties();
 
-  private ArrayList<SensorData> sensorDataList = new ArrayList<SensorData>();
+  /* The most recent sensor data of all nodes, the oldest is dropped when full */
+  private RingBuffer<SensorData> sensorDataList =
+    new RingBuffer<SensorData>(Integer.getInteger("collect.history", 100000));
+  /* Sensor data not yet delivered to the visualizers */
+  private ArrayList<SensorData> pendingSensorData = new ArrayList<SensorData>();
   private PrintWriter sensorDataOutput;
   private boolean isSensorLogUsed;
 
@@ -1176,13 +1180,32 @@ public class CollectServer implements SerialConnectionListener {
       sensorDataList.add(sensorData);
       handleLinks(sensorData);
       if (visualizers != null) {
-        SwingUtilities.invokeLater(new Runnable() {
-          public void run() {
-            for (int i = 0, n = visualizers.length; i < n; i++) {
-              visualizers[i].nodeDataReceived(sensorData);
+        boolean isScheduled;
+        synchronized (pendingSensorData) {
+          isScheduled = !pendingSensorData.isEmpty();
+          pendingSensorData.add(sensorData);
+        }
+        if (!isScheduled) {
+          // Deliver everything received until the event thread gets to it at once
+          SwingUtilities.invokeLater(new Runnable() {
+            public void run() {
+              deliverSensorData();
             }
-          }
-        });
+          });
+        }
+      }
+    }
+  }
+
+  private void deliverSensorData() {
+    SensorData[] data;
+    synchronized (pendingSensorData) {
+      data = pendingSensorData.toArray(new SensorData[pendingSensorData.size()]);
+      pendingSensorData.clear();
+    }
+    for (SensorData sensorData : data) {
+      for (int i = 0, n = visualizers.length; i < n; i++) {
+        visualizers[i].nodeDataReceived(sensorData);
       }
     }
   }
@@ -1255,6 +1278,9 @@ public class CollectServer implements SerialConnectionListener {
   }
 
   private void clearSensorData() {
+    synchronized (pendingSensorData) {
+      pendingSensorData.clear();
+    }
     sensorDataList.clear();
     Node[] nodes = getNodes();
     this.selectedNodes = null;
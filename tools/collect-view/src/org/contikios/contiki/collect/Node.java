@@ -48,8 +48,11 @@ public class Node implements Comparable<Node> {
 
   private static final boolean SINGLE_LINK = true;
 
+  /* Number of sensor data kept per node, the oldest is dropped when full */
+  private static final int HISTORY = Integer.getInteger("collect.node.history", 2000);
+
   private SensorDataAggregator sensorDataAggregator;
-  private ArrayList<SensorData> sensorDataList = new ArrayList<SensorData>();
+  private RingBuffer<SensorData> sensorDataList = new RingBuffer<SensorData>(HISTORY);
   private ArrayList<Link> links = new ArrayList<Link>();
 
   private final String id;
@@ -157,8 +160,8 @@ public class Node implements Comparable<Node> {
   }
 
   public boolean addSensorData(SensorData data) {
-    if (sensorDataList.size() > 0) {
-      SensorData last = sensorDataList.get(sensorDataList.size() - 1);
+    SensorData last = sensorDataList.getLast();
+    if (last != null) {
       if (data.getNodeTime() < last.getNodeTime()) {
         // Sensor data already added
         System.out.println("SensorData: ignoring (time " + (data.getNodeTime() - last.getNodeTime())
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ *
+ *
+ * -----------------------------------------------------------------
+ *
+ * RingBuffer
+ */
+
+package org.contikios.contiki.collect;
+
+/**
+ * A list with a fixed capacity that drops its oldest element when a new
+ * element is added to a full list. Index 0 is the oldest element.
+ */
+public class RingBuffer<T> {
+
+  private final Object[] elements;
+  private int first;
+  private int size;
+
+  public RingBuffer(int capacity) {
+    if (capacity < 1) {
+      throw new IllegalArgumentException("capacity must be positive");
+    }
+    this.elements = new Object[capacity];
+  }
+
+  public int capacity() {
+    return elements.length;
+  }
+
+  public synchronized int size() {
+    return size;
+  }
+
+  /**
+   * Adds an element last.
+   *
+   * @param element - the element to add
+   * @return the dropped oldest element or <code>null</code> if the list had room
+   */
+  @SuppressWarnings("unchecked")
+  public synchronized T add(T element) {
+    T dropped = null;
+    if (size == elements.length) {
+      dropped = (T) elements[first];
+      elements[first] = element;
+      first = (first + 1) % elements.length;
+    } else {
+      elements[(first + size) % elements.length] = element;
+      size++;
+    }
+    return dropped;
+  }
+
+  @SuppressWarnings("unchecked")
+  public synchronized T get(int index) {
+    if (index < 0 || index >= size) {
+      throw new IndexOutOfBoundsException("index " + index + " of " + size);
+    }
+    return (T) elements[(first + index) % elements.length];
+  }
+
+  public synchronized T getLast() {
+    return size > 0 ? get(size - 1) : null;
+  }
+
+  public synchronized void clear() {
+    for (int i = 0; i < size; i++) {
+      elements[(first + i) % elements.length] = null;
+    }
+    first = 0;
+    size = 0;
+  }
+
+  public synchronized T[] toArray(T[] array) {
+    if (array.length < size) {
+      array = java.util.Arrays.copyOf(array, size);
+    }
+    for (int i = 0; i < size; i++) {
+      array[i] = get(i);
+    }
+    return array;
+  }
+
+}
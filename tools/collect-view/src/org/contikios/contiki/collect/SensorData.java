@@ -45,6 +45,9 @@ import java.util.Arrays;
  */
 public class SensorData implements SensorInfo {
 
+  /** Starts a compact sensor data record, see apps/collect-view */
+  public static final char RECORD_PREFIX = '@';
+
   private final Node node;
   private final int[] values;
   private final long nodeTime;
@@ -117,7 +120,14 @@ public class SensorData implements SensorInfo {
   }
 
   public static SensorData parseSensorData(CollectServer server, String line, long systemTime) {
-    String[] components = line.trim().split("[ \t]+");
+    int record = line.indexOf(RECORD_PREFIX);
+    if (record >= 0) {
+      return parseSensorRecord(server, line, record, systemTime);
+    }
+    String[] components = split(line);
+    if (components.length == 0) {
+      return null;
+    }
     // Check if COOJA log
     if (components.length == VALUES_COUNT + 2 && components[1].startsWith("ID:")) {
       if (!components[2].equals("" + VALUES_COUNT)) {
@@ -154,10 +164,83 @@ public class SensorData implements SensorInfo {
     return new SensorData(node, data, systemTime);
   }
 
+  /**
+   * Parses a compact record as printed by collect_view_print_record():
+   * RECORD_PREFIX followed by four hex digits per value. Anything before
+   * the prefix is either a system time or a log prefix (COOJA).
+   */
+  private static SensorData parseSensorRecord(CollectServer server, String line,
+      int record, long systemTime) {
+    int start = record + 1;
+    int end = line.length();
+    while (end > start && line.charAt(end - 1) <= ' ') {
+      end--;
+    }
+    if (end - start != VALUES_COUNT * 4
+        || (record > 0 && line.charAt(record - 1) > ' ')) {
+      // Not a sensor data record
+      return null;
+    }
+    int[] data = new int[VALUES_COUNT];
+    for (int i = 0, pos = start; i < VALUES_COUNT; i++) {
+      int v = 0;
+      for (int j = 0; j < 4; j++, pos++) {
+        int d = Character.digit(line.charAt(pos), 16);
+        if (d < 0) {
+          System.err.println("Failed to parse data record: '" + line + "'");
+          return null;
+        }
+        v = (v << 4) | d;
+      }
+      data[i] = v;
+    }
+    if (data[0] != VALUES_COUNT) {
+      // Ignore records of other formats
+      return null;
+    }
+    if (record > 0) {
+      String[] prefix = split(line.substring(0, record));
+      if (prefix.length > 0) {
+        try {
+          systemTime = Long.parseLong(prefix[0]);
+        } catch (NumberFormatException e) {
+          // First column does not seem to be system time
+        }
+      }
+    }
+    String nodeID = mapNodeID(data[NODE_ID]);
+    Node node = server.addNode(nodeID);
+    return new SensorData(node, data, systemTime);
+  }
+
   public static String mapNodeID(int nodeID) {
     return "" + (nodeID & 0xff) + '.' + ((nodeID >> 8) & 0xff);
   }
 
+  /* Splits at whitespace without the overhead of a regular expression */
+  private static String[] split(String line) {
+    String[] parts = new String[VALUES_COUNT + 2];
+    int count = 0;
+    int i = 0, n = line.length();
+    while (i < n) {
+      while (i < n && (line.charAt(i) == ' ' || line.charAt(i) == '\t')) {
+        i++;
+      }
+      if (i == n) {
+        break;
+      }
+      int start = i;
+      while (i < n && line.charAt(i) != ' ' && line.charAt(i) != '\t') {
+        i++;
+      }
+      if (count == parts.length) {
+        parts = Arrays.copyOf(parts, count * 2);
+      }
+      parts[count++] = line.substring(start, i);
+    }
+    return count == parts.length ? parts : Arrays.copyOf(parts, count);
+  }
+
   private static int[] parseToInt(String[] text) {
     try {
       int[] data = new int[text.length];
@@ -50,6 +50,8 @@ public class SensorDataAggregator implements SensorInfo {
   private int maxSeqno = Integer.MIN_VALUE;
   private int seqnoDelta = 0;
   private int dataCount;
+  private int packetCount;
+  private long firstTime;
   private int duplicates = 0;
   private int lost = 0;
   private int nodeRestartCount = 0;
@@ -88,6 +90,8 @@ public class SensorDataAggregator implements SensorInfo {
   }
 
   public void addSensorData(SensorData data) {
+    // The node only keeps its most recent sensor data
+    packetCount++;
     int seqn = data.getValue(SEQNO);
     int s = seqn + seqnoDelta;
 
@@ -152,6 +156,7 @@ public class SensorDataAggregator implements SensorInfo {
       }
       if (dataCount == 0) {
         // First packet from node.
+        firstTime = data.getNodeTime();
       } else if (maxSeqno - s > 2) {
         // Handle sequence number overflow.
         seqnoDelta = maxSeqno + 1;
@@ -185,6 +190,8 @@ public class SensorDataAggregator implements SensorInfo {
       values[i] = 0L;
     }
     dataCount = 0;
+    packetCount = 0;
+    firstTime = 0;
     duplicates = 0;
     lost = 0;
     nodeRestartCount = 0;
@@ -273,7 +280,7 @@ public class SensorDataAggregator implements SensorInfo {
   }
 
   public int getPacketCount() {
-    return node.getSensorDataCount();
+    return packetCount;
   }
 
   public int getNextHopChangeCount() {
@@ -302,9 +309,8 @@ public class SensorDataAggregator implements SensorInfo {
 
   public long getAveragePeriod() {
     if (dataCount > 1) {
-      long first = node.getSensorData(0).getNodeTime();
       long last = node.getSensorData(node.getSensorDataCount() - 1).getNodeTime();
-      return (last - first) / dataCount;
+      return (last - firstTime) / dataCount;
     }
     return 0;
   }
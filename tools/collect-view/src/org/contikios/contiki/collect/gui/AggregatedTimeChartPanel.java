@@ -38,11 +38,14 @@ package org.contikios.contiki.collect.gui;
 import java.awt.BorderLayout;
 import java.awt.Component;
 import java.awt.Dimension;
+import java.awt.event.ActionEvent;
+import java.awt.event.ActionListener;
 import java.util.Date;
 import java.util.HashMap;
 import java.util.Map;
 
 import javax.swing.JPanel;
+import javax.swing.Timer;
 
 import org.jfree.chart.ChartFactory;
 import org.jfree.chart.ChartPanel;
@@ -64,6 +67,9 @@ public abstract class AggregatedTimeChartPanel<T> extends JPanel implements Visu
 
   private static final long serialVersionUID = 2100788758213434540L;
 
+  /* Recalculating the charts is done at most once per this many milliseconds */
+  private static final int UPDATE_DELAY = 500;
+
   protected final CollectServer server;
   protected final String category;
   protected final String title;
@@ -74,6 +80,7 @@ public abstract class AggregatedTimeChartPanel<T> extends JPanel implements Visu
 
   private Node[] selectedNodes;
   private HashMap<Node,T> selectedMap = new HashMap<Node,T>();
+  private final Timer updateTimer;
 
   public AggregatedTimeChartPanel(CollectServer server, String category, String title,
       String timeAxisLabel, String valueAxisLabel) {
@@ -91,6 +98,15 @@ public abstract class AggregatedTimeChartPanel<T> extends JPanel implements Visu
     this.chartPanel.setPreferredSize(new Dimension(500, 270));
     setBaseShapeVisible(false);
     add(chartPanel, BorderLayout.CENTER);
+
+    this.updateTimer = new Timer(UPDATE_DELAY, new ActionListener() {
+      public void actionPerformed(ActionEvent e) {
+        if (isVisible()) {
+          updateCharts();
+        }
+      }
+    });
+    this.updateTimer.setRepeats(false);
   }
 
   @Override
@@ -135,8 +151,9 @@ public abstract class AggregatedTimeChartPanel<T> extends JPanel implements Visu
 
   @Override
   public void nodeDataReceived(SensorData data) {
-    if (isVisible() && selectedMap.get(data.getNode()) != null) {
-      updateCharts();
+    if (isVisible() && selectedMap.get(data.getNode()) != null
+        && !updateTimer.isRunning()) {
+      updateTimer.start();
     }
   }
 
@@ -148,6 +165,7 @@ public abstract class AggregatedTimeChartPanel<T> extends JPanel implements Visu
   }
 
   private void updateCharts() {
+    updateTimer.stop();
     int duplicates = 0;
     int total = 0;
     series.clear();
@@ -43,9 +43,11 @@ import java.awt.Component;
 import java.awt.Cursor;
 import java.awt.Font;
 import java.awt.event.ActionEvent;
+import java.awt.event.ActionListener;
 import java.awt.event.MouseAdapter;
 import java.awt.event.MouseEvent;
 import java.util.Comparator;
+import java.util.HashMap;
 import java.util.Properties;
 
 import javax.swing.AbstractAction;
@@ -56,6 +58,7 @@ import javax.swing.JPopupMenu;
 import javax.swing.JScrollPane;
 import javax.swing.JTable;
 import javax.swing.SwingUtilities;
+import javax.swing.Timer;
 import javax.swing.table.AbstractTableModel;
 import javax.swing.table.DefaultTableCellRenderer;
 import javax.swing.table.JTableHeader;
@@ -458,14 +461,26 @@ public class NodeInfoPanel extends JPanel implements Visualizer, Configurable {
 
     private static final long serialVersionUID = 1692207305977527004L;
 
+    /* The average row is recalculated at most once per this many milliseconds */
+    private static final int UPDATE_DELAY = 500;
+
     private final TableData[] columns;
     private Node[] nodes;
+    private HashMap<Node,Integer> rows = new HashMap<Node,Integer>();
+    private final Timer averageTimer;
 
     public NodeModel(TableData[] columns) {
       this.columns = columns;
+      this.averageTimer = new Timer(UPDATE_DELAY, new ActionListener() {
+        public void actionPerformed(ActionEvent e) {
+          recalculateAverage();
+        }
+      });
+      this.averageTimer.setRepeats(false);
     }
 
     public void recalculateAverage() {
+      averageTimer.stop();
       for(TableData td : columns) {
         td.clearAverageCache();
       }
@@ -507,20 +522,22 @@ public class NodeInfoPanel extends JPanel implements Visualizer, Configurable {
         fireTableRowsDeleted(0, this.nodes.length - 1);
       }
       this.nodes = nodes;
+      this.rows.clear();
       if (this.nodes != null && this.nodes.length > 0) {
+        for(int row = 0; row < this.nodes.length; row++) {
+          this.rows.put(this.nodes[row], row);
+        }
         fireTableRowsInserted(0, this.nodes.length - 1);
       }
       recalculateAverage();
     }
 
     public void updateNode(Node node) {
-      if (this.nodes != null) {
-        for(int row = 0; row < this.nodes.length; row++) {
-          if (this.nodes[row] == node) {
-            fireTableRowsUpdated(row, row);
-            recalculateAverage();
-            break;
-          }
+      Integer row = rows.get(node);
+      if (row != null) {
+        fireTableRowsUpdated(row, row);
+        if (!averageTimer.isRunning()) {
+          averageTimer.start();
         }
       }
     }
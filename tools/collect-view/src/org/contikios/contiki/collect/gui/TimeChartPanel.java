@@ -41,8 +41,12 @@ package org.contikios.contiki.collect.gui;
 import java.awt.BorderLayout;
 import java.awt.Component;
 import java.awt.Dimension;
+import java.awt.event.ActionEvent;
+import java.awt.event.ActionListener;
 import java.util.Date;
+import java.util.HashSet;
 import javax.swing.JPanel;
+import javax.swing.Timer;
 import org.jfree.chart.ChartFactory;
 import org.jfree.chart.ChartPanel;
 import org.jfree.chart.JFreeChart;
@@ -62,6 +66,9 @@ public abstract class TimeChartPanel extends JPanel implements Visualizer {
 
   private static final long serialVersionUID = -607864439709540641L;
 
+  /* Grouped series are recalculated at most once per this many milliseconds */
+  private static final int UPDATE_DELAY = 500;
+
   protected final CollectServer server;
   protected final String category;
   protected final String title;
@@ -76,7 +83,10 @@ public abstract class TimeChartPanel extends JPanel implements Visualizer {
   private int rangeTick = 0;
   private boolean hasGlobalRange;
   private int maxItemCount;
-  
+
+  private final HashSet<Node> updatedNodes = new HashSet<Node>();
+  private final Timer updateTimer;
+
   public TimeChartPanel(CollectServer server, String category, String title,
       String chartTitle, String timeAxisLabel, String valueAxisLabel) {
     super(new BorderLayout());
@@ -93,6 +103,13 @@ public abstract class TimeChartPanel extends JPanel implements Visualizer {
     setBaseShapeVisible(true);
     setMaxItemCount(server.getDefaultMaxItemCount());
     add(chartPanel, BorderLayout.CENTER);
+
+    this.updateTimer = new Timer(UPDATE_DELAY, new ActionListener() {
+      public void actionPerformed(ActionEvent e) {
+        updateGroupedSeries();
+      }
+    });
+    this.updateTimer.setRepeats(false);
   }
 
   @Override
@@ -153,18 +170,36 @@ public abstract class TimeChartPanel extends JPanel implements Visualizer {
           TimeSeries series = timeSeries.getSeries(i);
           int groupSize = getGroupSize(node);
           if (groupSize > 1) {
-            series.clear();
-            updateSeries(series, node, groupSize);
+            // Regrouping is expensive and done later for all received data
+            updatedNodes.add(node);
+            if (!updateTimer.isRunning()) {
+              updateTimer.start();
+            }
           } else {
             series.addOrUpdate(new Second(new Date(data.getNodeTime())), getSensorDataValue(data));
+            chartPanel.repaint();
           }
-          chartPanel.repaint();
           break;
         }
       }
     }
   }
 
+  private void updateGroupedSeries() {
+    if (isVisible() && selectedNodes != null && selectedNodes.length == timeSeries.getSeriesCount()) {
+      for (int i = 0, n = selectedNodes.length; i < n; i++) {
+        Node node = selectedNodes[i];
+        if (updatedNodes.contains(node)) {
+          TimeSeries series = timeSeries.getSeries(i);
+          series.clear();
+          updateSeries(series, node, getGroupSize(node));
+        }
+      }
+      chartPanel.repaint();
+    }
+    updatedNodes.clear();
+  }
+
   @Override
   public void clearNodeData() {
     if (isVisible()) {
@@ -173,6 +208,8 @@ public abstract class TimeChartPanel extends JPanel implements Visualizer {
   }
 
   private void updateCharts() {
+    updateTimer.stop();
+    updatedNodes.clear();
     timeSeries.removeAllSeries();
     if (this.selectedNodes != null) {
       for(Node node: this.selectedNodes) {
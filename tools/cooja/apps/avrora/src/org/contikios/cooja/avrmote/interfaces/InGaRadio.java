@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2009, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+package org.contikios.cooja.avrmote.interfaces;
+
+import org.apache.log4j.Logger;
+
+import org.contikios.cooja.ClassDescription;
+import org.contikios.cooja.Mote;
+import org.contikios.cooja.avrmote.InGaMote;
+import org.contikios.cooja.emulatedmote.Radio802154;
+import org.contikios.cooja.interfaces.CustomDataRadio;
+import avrora.sim.FiniteStateMachine;
+import avrora.sim.FiniteStateMachine.Probe;
+import avrora.sim.radio.AT86RF231Radio;
+import avrora.sim.radio.Medium;
+
+/**
+ * AT86RF231 to COOJA wrapper.
+ *
+ * @author Joakim Eriksson
+ */
+@ClassDescription("AT86RF231")
+public class InGaRadio extends Radio802154 {
+  private static Logger logger = Logger.getLogger(InGaRadio.class);
+
+  /* States of the radio FSM from TRX_OFF on have the oscillator running,
+   * states from RX_ON on listen or transmit */
+  private static final int STATE_RX_ON = 3;
+
+  private AT86RF231Radio rf231;
+
+  Medium.Transmitter trans;
+  AT86RF231Radio.Receiver recv;
+  FiniteStateMachine fsm;
+
+  public InGaRadio(Mote mote) {
+    super(mote);
+    rf231 = (AT86RF231Radio) ((InGaMote)mote).getPlatform().getDevice("radio");
+
+    trans = rf231.getTransmitter();
+    fsm = rf231.getFiniteStateMachine();
+    recv = (AT86RF231Radio.Receiver) rf231.getReceiver();
+    trans.insertProbe(new Medium.Probe.Empty() {
+        public void fireBeforeTransmit(Medium.Transmitter t, byte val) {
+            handleTransmit(val);
+        }
+    });
+    fsm.insertProbe(new Probe() {
+        public void fireBeforeTransition(int arg0, int arg1) {
+        }
+        public void fireAfterTransition(int arg0, int arg1) {
+            RadioEvent re = null;
+            if (arg1 >= STATE_RX_ON && arg0 < STATE_RX_ON) {
+                re = RadioEvent.HW_ON;
+            } else if (arg1 < STATE_RX_ON && arg0 >= STATE_RX_ON) {
+                re = RadioEvent.HW_OFF;
+            }
+            if (re != null) {
+                lastEvent = re;
+                lastEventTime = InGaRadio.this.mote.getSimulation().getSimulationTime();
+                setChanged();
+                notifyObservers();
+            }
+        }
+    });
+  }
+
+  public int getChannel() {
+    return 0;
+  }
+
+  public int getFrequency() {
+      return (int) rf231.getFrequency();
+  }
+
+  public boolean isRadioOn() {
+      return fsm.getCurrentState() >= STATE_RX_ON;
+  }
+
+  public double getCurrentOutputPower() {
+    return 3.0;
+  }
+
+  public int getCurrentOutputPowerIndicator() {
+    return 15;
+  }
+
+  public int getOutputPowerIndicatorMax() {
+    return 15;
+  }
+
+  public double getCurrentSignalStrength() {
+    return 1;
+  }
+
+  public void setCurrentSignalStrength(double signalStrength) {
+  }
+
+  protected void handleEndOfReception() {
+      /* tell the receiver that the packet is ended */
+      recv.nextByte(false, (byte)0);
+  }
+
+  protected void handleReceive(byte b) {
+      recv.nextByte(true, (byte)b);
+  }
+
+  public boolean canReceiveFrom(CustomDataRadio radio) {
+    if (radio.getClass().equals(this.getClass())) {
+      return true;
+    }
+    return false;
+  }
+}
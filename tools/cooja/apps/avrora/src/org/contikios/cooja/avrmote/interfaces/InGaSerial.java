@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2009, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+package org.contikios.cooja.avrmote.interfaces;
+
+import avrora.sim.mcu.AtmelMicrocontroller;
+import org.contikios.cooja.Mote;
+import org.contikios.cooja.avrmote.InGaMote;
+import org.contikios.cooja.dialogs.SerialUI;
+
+/**
+ * Output of USART0, the USB serial port of INGA.
+ */
+public class InGaSerial extends SerialUI {
+
+  InGaMote mote;
+
+  public InGaSerial(Mote ingaMote) {
+    mote = (InGaMote) ingaMote;
+    AtmelMicrocontroller mcu = (AtmelMicrocontroller) mote.getPlatform().getMicrocontroller();
+    avrora.sim.mcu.USART usart = (avrora.sim.mcu.USART) mcu.getDevice("usart0");
+    if (usart != null) {
+      usart.connect(  new avrora.sim.mcu.USART.USARTDevice() {
+        public avrora.sim.mcu.USART.Frame transmitFrame() {
+          return null;
+        }
+        public void receiveFrame(avrora.sim.mcu.USART.Frame frame) {
+          dataReceived(frame.value);
+        }
+      });
+    } else {
+     System.out.println("*** Warning INGA: could not find usart0 interface...");
+    }
+  }
+
+  public Mote getMote() {
+    return mote;
+  }
+
+  /* not yet implemented ...*/
+  public void writeArray(byte[] s) {
+  }
+
+  public void writeByte(byte b) {
+  }
+
+  public void writeString(String s) {
+  }
+}
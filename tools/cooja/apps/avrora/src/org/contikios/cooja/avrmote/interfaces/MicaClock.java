@@ -40,7 +40,6 @@ import org.jdom.Element;
 import org.contikios.cooja.ClassDescription;
 import org.contikios.cooja.Mote;
 import org.contikios.cooja.Simulation;
-import org.contikios.cooja.avrmote.MicaZMote;
 import org.contikios.cooja.interfaces.Clock;
 
 /**
@@ -51,13 +50,13 @@ public class MicaClock extends Clock {
   private static Logger logger = Logger.getLogger(MicaClock.class);
 
   private Simulation simulation;
-  private MicaZMote myMote;
+  private Mote myMote;
 
   private long timeDrift; /* Microseconds */
   
   public MicaClock(Mote mote) {
     simulation = mote.getSimulation();
-    myMote = (MicaZMote) mote;
+    myMote = mote;
   }
 
   public void setTime(long newTime) {
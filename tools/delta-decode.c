@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Converts sample logs written with the delta codec (core/lib/delta-codec.h)
+ * back to text, one sample per line with tab separated values.
+ *
+ * Build: gcc -o delta-decode -I../platform/native -I../cpu/native -I../core \
+ *          -DDELTA_CODEC_CONF_SIMPLE8B=1 delta-decode.c ../core/lib/delta-codec.c
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <err.h>
+
+#include "lib/delta-codec.h"
+
+static uint8_t *data;
+static size_t size;
+
+/*---------------------------------------------------------------------------*/
+static void
+print_sample(const int16_t *values, int channels)
+{
+  int i;
+
+  for(i = 0; i < channels; i++) {
+    printf(i == 0 ? "%d" : "\t%d", values[i]);
+  }
+  printf("\n");
+}
+/*---------------------------------------------------------------------------*/
+static void
+decode_varint(struct delta_codec *codec)
+{
+  int16_t values[DELTA_CODEC_MAX_CHANNELS];
+  size_t pos = 0;
+  int n;
+
+  while(pos < size) {
+    n = delta_codec_decode(codec, data + pos,
+                           size - pos > 0xffff ? 0xffff : size - pos, values);
+    if(n < 0) {
+      errx(1, "malformed sample at offset %lu", (unsigned long)pos);
+    }
+    if(n == 0) {
+      warnx("%lu trailing bytes", (unsigned long)(size - pos));
+      break;
+    }
+    print_sample(values, codec->channels);
+    pos += n;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+decode_simple8b(struct delta_codec *codec)
+{
+  uint16_t zz[60 + DELTA_CODEC_MAX_CHANNELS];
+  int16_t values[DELTA_CODEC_MAX_CHANNELS];
+  size_t pos;
+  int fill = 0, n, i;
+
+  for(pos = 0; pos + 8 <= size; pos += 8) {
+    n = delta_codec_unpack(data + pos, zz + fill, 60);
+    if(n < 0) {
+      errx(1, "invalid word at offset %lu", (unsigned long)pos);
+    }
+    fill += n;
+    for(i = 0; i + codec->channels <= fill; i += codec->channels) {
+      delta_codec_undelta(codec, zz + i, values);
+      print_sample(values, codec->channels);
+    }
+    memmove(zz, zz + i, (fill - i) * sizeof(zz[0]));
+    fill -= i;
+  }
+  if(pos != size || fill != 0) {
+    warnx("incomplete sample at end of input");
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char **argv)
+{
+  struct delta_codec codec;
+  FILE *in = stdin;
+  int c, channels, simple8b = 0;
+  size_t n;
+
+  while((c = getopt(argc, argv, "sh")) != -1) {
+    switch(c) {
+    case 's':
+      simple8b = 1;
+      break;
+    default:
+      errx(1, "usage: delta-decode [-s] channels [file]");
+    }
+  }
+  argc -= optind;
+  argv += optind;
+
+  if(argc < 1 || argc > 2) {
+    errx(1, "usage: delta-decode [-s] channels [file]");
+  }
+  channels = atoi(argv[0]);
+  if(channels < 1 || channels > DELTA_CODEC_MAX_CHANNELS) {
+    errx(1, "channels must be 1 to %d", DELTA_CODEC_MAX_CHANNELS);
+  }
+  if(argc == 2 && (in = fopen(argv[1], "rb")) == NULL) {
+    err(1, "%s", argv[1]);
+  }
+
+  /* Logs are small, read all at once */
+  while(!feof(in)) {
+    data = realloc(data, size + 4096);
+    if(data == NULL) {
+      err(1, "realloc");
+    }
+    n = fread(data + size, 1, 4096, in);
+    if(ferror(in)) {
+      err(1, "read");
+    }
+    size += n;
+  }
+
+  delta_codec_init(&codec, channels);
+  if(simple8b) {
+    decode_simple8b(&codec);
+  } else {
+    decode_varint(&codec);
+  }
+
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Creates a patch that rebuilds a new firmware image or ELF module from
+ * the one that the nodes already hold. Nodes apply it with
+ * deluge_patch_apply() (apps/deluge/deluge-patch.h).
+ *
+ * Build: gcc -o deluge-mkpatch -I../platform/native -I../cpu/native -I../core \
+ *          -I../apps/deluge deluge-mkpatch.c ../core/lib/crc16.c
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <err.h>
+
+#include "lib/crc16.h"
+#include "deluge-patch.h"
+
+/* Base blocks that are indexed, and the shortest copy worth encoding.
+   A copy costs 7 bytes, against len + 3 for an insert. */
+#define BLOCK_SIZE	16
+#define HASH_SIZE	4096
+#define MAX_LENGTH	0xffff
+
+struct file {
+  unsigned char *data;
+  size_t size;
+};
+
+static long hash_table[HASH_SIZE];
+static FILE *out;
+static size_t copies, inserts, inserted;
+
+/*---------------------------------------------------------------------------*/
+static void
+read_file(const char *name, struct file *file)
+{
+  FILE *fp;
+  size_t n;
+
+  if((fp = fopen(name, "rb")) == NULL) {
+    err(1, "%s", name);
+  }
+  file->data = NULL;
+  file->size = 0;
+  while(!feof(fp)) {
+    file->data = realloc(file->data, file->size + 4096);
+    if(file->data == NULL) {
+      err(1, "realloc");
+    }
+    n = fread(file->data + file->size, 1, 4096, fp);
+    if(ferror(fp)) {
+      err(1, "%s", name);
+    }
+    file->size += n;
+  }
+  fclose(fp);
+}
+/*---------------------------------------------------------------------------*/
+static unsigned
+hash(const unsigned char *p)
+{
+  unsigned h;
+  int i;
+
+  for(h = 0, i = 0; i < BLOCK_SIZE; i++) {
+    h = h * 31 + p[i];
+  }
+  return h % HASH_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+static void
+put_number(unsigned long value, int size)
+{
+  for(; size > 0; size--, value >>= 8) {
+    putc(value & 0xff, out);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+emit_insert(const unsigned char *data, size_t length)
+{
+  size_t n;
+
+  while(length > 0) {
+    n = length > MAX_LENGTH ? MAX_LENGTH : length;
+    putc(DELUGE_PATCH_OP_INSERT, out);
+    put_number(n, 2);
+    fwrite(data, 1, n, out);
+    data += n;
+    length -= n;
+    inserts++;
+    inserted += n;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+emit_copy(size_t offset, size_t length)
+{
+  size_t n;
+
+  while(length > 0) {
+    n = length > MAX_LENGTH ? MAX_LENGTH : length;
+    putc(DELUGE_PATCH_OP_COPY, out);
+    put_number(offset, 4);
+    put_number(n, 2);
+    offset += n;
+    length -= n;
+    copies++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+make_patch(const struct file *base, const struct file *target)
+{
+  size_t pos, pending, offset, length;
+  long candidate;
+
+  memset(hash_table, -1, sizeof(hash_table));
+  for(offset = 0; offset + BLOCK_SIZE <= base->size; offset += BLOCK_SIZE) {
+    if(hash_table[hash(base->data + offset)] < 0) {
+      hash_table[hash(base->data + offset)] = offset;
+    }
+  }
+
+  /* Target bytes from pending up to pos are not yet encoded. */
+  for(pending = pos = 0; pos + BLOCK_SIZE <= target->size;) {
+    candidate = hash_table[hash(target->data + pos)];
+    if(candidate < 0 ||
+       memcmp(base->data + candidate, target->data + pos, BLOCK_SIZE) != 0) {
+      pos++;
+      continue;
+    }
+
+    /* Grow the match in both directions. */
+    offset = candidate;
+    length = BLOCK_SIZE;
+    while(offset > 0 && pos > pending &&
+	  base->data[offset - 1] == target->data[pos - 1]) {
+      offset--;
+      pos--;
+      length++;
+    }
+    while(offset + length < base->size && pos + length < target->size &&
+	  base->data[offset + length] == target->data[pos + length]) {
+      length++;
+    }
+
+    emit_insert(target->data + pending, pos - pending);
+    emit_copy(offset, length);
+    pos += length;
+    pending = pos;
+  }
+  emit_insert(target->data + pending, target->size - pending);
+  putc(DELUGE_PATCH_OP_END, out);
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char **argv)
+{
+  struct file base, target;
+  long size;
+
+  if(argc != 4) {
+    errx(1, "usage: deluge-mkpatch base target patch");
+  }
+  read_file(argv[1], &base);
+  read_file(argv[2], &target);
+  if(base.size > 0xffffffffUL || target.size > 0xffffffffUL) {
+    errx(1, "images must be smaller than 4 GB");
+  }
+
+  if((out = fopen(argv[3], "wb")) == NULL) {
+    err(1, "%s", argv[3]);
+  }
+  putc(DELUGE_PATCH_MAGIC_0, out);
+  putc(DELUGE_PATCH_MAGIC_1, out);
+  putc(DELUGE_PATCH_VERSION, out);
+  putc(0, out);
+  put_number(base.size, 4);
+  put_number(target.size, 4);
+  put_number(crc16_data(base.data, base.size, 0), 2);
+  put_number(crc16_data(target.data, target.size, 0), 2);
+
+  make_patch(&base, &target);
+
+  size = ftell(out);
+  if(ferror(out) || fclose(out) != 0) {
+    err(1, "%s", argv[3]);
+  }
+  printf("%ld bytes: %lu copies, %lu inserts of %lu bytes\n",
+	 size, (unsigned long)copies,
+	 (unsigned long)inserts, (unsigned long)inserted);
+
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,481 @@
+/* Download files from the SD card of an INGA node
+ *
+ * Copyright (c) 2013, Institute of Operating Systems and Computer Networks (TU Braunschweig).
+ * All Rights Reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/* The node runs apps/fat-offload, see fat-offload.h for the protocol. */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/time.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <popt.h>
+
+#define FRAME_SYNC 0xfe
+#define FRAME_SIZE 1024
+
+#define OFFLOAD_LIST   'L'
+#define OFFLOAD_GET    'G'
+#define OFFLOAD_ACK    'A'
+#define OFFLOAD_NACK   'N'
+#define OFFLOAD_ABORT  'X'
+#define OFFLOAD_ENTRY  'l'
+#define OFFLOAD_STATUS 'g'
+#define OFFLOAD_DATA   'd'
+
+#define OFFLOAD_OK 0
+
+/* Reply timeout and number of attempts */
+#define TIMEOUT_MS 1000
+#define RETRIES 10
+
+/* A frame is cut when the line is idle for this long */
+#define FRAME_TIMEOUT_MS 20
+
+#define VERBOSE(fmt, ...) do { if (cfg.verbose) fprintf(stderr, fmt, ## __VA_ARGS__); } while (0)
+
+struct config_t {
+	char *device;
+	int baud;
+	int window;
+	int list;
+	int resume;
+	char *output;
+	const char *name;
+	int verbose;
+};
+
+struct frame_t {
+	uint8_t type;
+	uint32_t value;
+	uint8_t *data;
+	uint16_t len;
+	uint8_t buf[FRAME_SIZE];
+};
+
+static struct config_t cfg;
+static int tty;
+
+/* Same as crc16_add() of Contiki */
+static uint16_t crc16_add(uint8_t b, uint16_t acc)
+{
+	acc ^= b;
+	acc  = (acc >> 8) | (acc << 8);
+	acc ^= (acc & 0xff00) << 4;
+	acc ^= (acc >> 8) >> 4;
+	acc ^= (acc & 0xff00) >> 5;
+	return acc;
+}
+
+static speed_t baud_to_speed(int baud)
+{
+	switch (baud) {
+	case 38400: return B38400;
+	case 57600: return B57600;
+	case 115200: return B115200;
+	case 230400: return B230400;
+	case 500000: return B500000;
+	case 1000000: return B1000000;
+	default: return 0;
+	}
+}
+
+static int open_tty(const char *device, int baud)
+{
+	struct termios tio;
+	speed_t speed = baud_to_speed(baud);
+	int fd;
+
+	if (!speed) {
+		fprintf(stderr, "Unsupported baud rate %d\n", baud);
+		return -1;
+	}
+
+	fd = open(device, O_RDWR | O_NOCTTY);
+	if (fd < 0) {
+		perror("Could not open device");
+		return -1;
+	}
+
+	if (tcgetattr(fd, &tio) < 0) {
+		perror("tcgetattr");
+		close(fd);
+		return -1;
+	}
+	cfmakeraw(&tio);
+	tio.c_cflag |= CLOCAL | CREAD;
+	tio.c_cflag &= ~CRTSCTS;
+	tio.c_cc[VMIN] = 0;
+	tio.c_cc[VTIME] = 0;
+	cfsetispeed(&tio, speed);
+	cfsetospeed(&tio, speed);
+	if (tcsetattr(fd, TCSANOW, &tio) < 0) {
+		perror("tcsetattr");
+		close(fd);
+		return -1;
+	}
+	tcflush(fd, TCIOFLUSH);
+
+	return fd;
+}
+
+static int send_frame(uint8_t type, uint32_t value, const void *data, uint16_t len)
+{
+	uint8_t buf[FRAME_SIZE + 8];
+	uint16_t crc = 0;
+	int i, n = 0;
+
+	if (len > FRAME_SIZE - 5)
+		return -1;
+
+	buf[n++] = FRAME_SYNC;
+	buf[n++] = (len + 5) & 0xff;
+	buf[n++] = (len + 5) >> 8;
+	buf[n++] = type;
+	for (i = 0; i < 4; i++)
+		buf[n++] = value >> (8 * i);
+	memcpy(&buf[n], data, len);
+	n += len;
+	for (i = 1; i < n; i++)
+		crc = crc16_add(buf[i], crc);
+	buf[n++] = crc & 0xff;
+	buf[n++] = crc >> 8;
+
+	if (write(tty, buf, n) != n) {
+		perror("write");
+		return -1;
+	}
+	return 0;
+}
+
+/* Reads bytes until a frame was received. Everything else, e.g. debug output
+ * of the node, is skipped. Returns 1 for a frame, -1 for a frame with a bad
+ * CRC and 0 on timeout. */
+static int read_frame(struct frame_t *frame, int timeout_ms)
+{
+	static uint8_t rx[256];
+	static int rx_len, rx_pos;
+	struct timeval end, now, tv;
+	int state = 0, pos = 0;
+	uint16_t len = 0, crc = 0;
+
+	gettimeofday(&end, NULL);
+	end.tv_sec += timeout_ms / 1000;
+	end.tv_usec += (timeout_ms % 1000) * 1000;
+	if (end.tv_usec >= 1000000) {
+		end.tv_sec++;
+		end.tv_usec -= 1000000;
+	}
+
+	while (1) {
+		uint8_t c;
+
+		if (rx_pos == rx_len) {
+			fd_set fds;
+
+			gettimeofday(&now, NULL);
+			timersub(&end, &now, &tv);
+			if (tv.tv_sec < 0)
+				return state ? -1 : 0;
+			if (state && (tv.tv_sec > 0 || tv.tv_usec > FRAME_TIMEOUT_MS * 1000)) {
+				tv.tv_sec = 0;
+				tv.tv_usec = FRAME_TIMEOUT_MS * 1000;
+			}
+
+			FD_ZERO(&fds);
+			FD_SET(tty, &fds);
+			if (select(tty + 1, &fds, NULL, NULL, &tv) <= 0) {
+				if (state) {
+					/* A byte of the frame got lost */
+					VERBOSE("Dropping incomplete frame\n");
+					return -1;
+				}
+				return 0;
+			}
+			rx_len = read(tty, rx, sizeof(rx));
+			rx_pos = 0;
+			if (rx_len <= 0) {
+				rx_len = 0;
+				continue;
+			}
+		}
+		c = rx[rx_pos++];
+
+		switch (state) {
+		case 0:
+			if (c == FRAME_SYNC)
+				state = 1;
+			break;
+		case 1:
+			len = c;
+			state = 2;
+			break;
+		case 2:
+			len |= c << 8;
+			pos = 0;
+			state = (len >= 5 && len <= FRAME_SIZE) ? 3 : 0;
+			break;
+		case 3:
+			frame->buf[pos++] = c;
+			if (pos == len)
+				state = 4;
+			break;
+		case 4:
+			crc = c;
+			state = 5;
+			break;
+		case 5:
+			crc |= c << 8;
+			state = 0;
+			{
+				uint16_t check = crc16_add(len & 0xff, 0);
+				int i;
+
+				check = crc16_add(len >> 8, check);
+				for (i = 0; i < len; i++)
+					check = crc16_add(frame->buf[i], check);
+				if (check != crc) {
+					VERBOSE("Dropping frame with bad CRC\n");
+					return -1;
+				}
+			}
+			frame->type = frame->buf[0];
+			frame->value = frame->buf[1] | frame->buf[2] << 8 |
+				frame->buf[3] << 16 | (uint32_t)frame->buf[4] << 24;
+			frame->data = &frame->buf[5];
+			frame->len = len - 5;
+			return 1;
+		}
+	}
+}
+
+static int list(const char *dir)
+{
+	struct frame_t frame;
+	int tries, rc;
+
+	for (tries = 0; tries < RETRIES; tries++) {
+		if (send_frame(OFFLOAD_LIST, 0, dir, strlen(dir)) < 0)
+			return -1;
+		while ((rc = read_frame(&frame, TIMEOUT_MS)) != 0) {
+			if (rc < 0 || frame.type != OFFLOAD_ENTRY)
+				continue;
+			if (frame.len == 0)
+				return 0;
+			printf("%10u %.*s\n", frame.value, frame.len, frame.data);
+		}
+		VERBOSE("No reply, retrying\n");
+	}
+	fprintf(stderr, "Node does not answer\n");
+	return -1;
+}
+
+static int get(const char *name, const char *output, int resume)
+{
+	struct frame_t frame;
+	struct timeval start, now;
+	uint8_t request[FRAME_SIZE];
+	uint32_t size = 0, expected = 0;
+	int tries, rc, nacked = 0;
+	FILE *out;
+
+	out = fopen(output, resume ? "ab" : "wb");
+	if (!out) {
+		perror("Could not open output file");
+		return -1;
+	}
+	if (resume) {
+		fseek(out, 0, SEEK_END);
+		expected = ftell(out);
+	}
+
+	if (strlen(name) + 1 > sizeof(request) - 5) {
+		fclose(out);
+		return -1;
+	}
+	request[0] = cfg.window;
+	memcpy(&request[1], name, strlen(name));
+
+	for (tries = 0; tries < RETRIES; tries++) {
+		if (send_frame(OFFLOAD_GET, expected, request, strlen(name) + 1) < 0)
+			goto fail;
+		while ((rc = read_frame(&frame, TIMEOUT_MS)) != 0 &&
+				(rc < 0 || frame.type != OFFLOAD_STATUS));
+		if (rc > 0)
+			break;
+		VERBOSE("No reply, retrying\n");
+	}
+	if (tries == RETRIES) {
+		fprintf(stderr, "Node does not answer\n");
+		goto fail;
+	}
+	if (frame.len < 1 || frame.data[0] != OFFLOAD_OK) {
+		fprintf(stderr, "Could not open %s on the node\n", name);
+		goto fail;
+	}
+	size = frame.value;
+	VERBOSE("%s: %u bytes, starting at %u\n", name, size, expected);
+
+	gettimeofday(&start, NULL);
+	tries = 0;
+	while (expected < size) {
+		rc = read_frame(&frame, TIMEOUT_MS);
+		if (rc < 0) {
+			/* Do not wait for the node to time out. The lost frame may
+			 * have been a resent one, so always ask again. */
+			send_frame(OFFLOAD_NACK, expected, NULL, 0);
+			nacked = 1;
+			continue;
+		}
+		if (rc == 0) {
+			if (++tries > RETRIES) {
+				fprintf(stderr, "Node does not answer\n");
+				goto fail;
+			}
+			VERBOSE("Timeout at %u\n", expected);
+			send_frame(OFFLOAD_NACK, expected, NULL, 0);
+			nacked = 1;
+			continue;
+		}
+
+		if (frame.type == OFFLOAD_STATUS && frame.len >= 1 && frame.data[0] != OFFLOAD_OK) {
+			fprintf(stderr, "Read error on the node at %u\n", expected);
+			goto fail;
+		}
+		if (frame.type != OFFLOAD_DATA)
+			continue;
+
+		if (frame.value == expected && frame.len > 0) {
+			if (fwrite(frame.data, frame.len, 1, out) != 1) {
+				perror("fwrite");
+				send_frame(OFFLOAD_ABORT, 0, NULL, 0);
+				goto fail;
+			}
+			expected += frame.len;
+			tries = 0;
+			nacked = 0;
+			send_frame(OFFLOAD_ACK, expected, NULL, 0);
+		} else if (frame.value > expected && !nacked) {
+			/* A frame was lost, ask once for a resend */
+			VERBOSE("Gap at %u\n", expected);
+			send_frame(OFFLOAD_NACK, expected, NULL, 0);
+			nacked = 1;
+		}
+	}
+
+	gettimeofday(&now, NULL);
+	timersub(&now, &start, &now);
+	fprintf(stderr, "%s: %u bytes in %ld.%03ld s\n", name, size,
+			(long)now.tv_sec, (long)now.tv_usec / 1000);
+
+	fclose(out);
+	return 0;
+
+fail:
+	fclose(out);
+	return -1;
+}
+
+static void parse_options(int argc, const char **argv)
+{
+	int rc;
+	poptContext poptc;
+
+	struct poptOption options[] = {
+		{"device", 'd', POPT_ARG_STRING, &cfg.device, 0, "Path to the serial device",
+			"pathname"},
+		{"baud", 'b', POPT_ARG_INT, &cfg.baud, 0, "Baud rate (default 500000)",
+			"rate"},
+		{"window", 'w', POPT_ARG_INT, &cfg.window, 0, "Unacknowledged frames in flight (default 8)",
+			"frames"},
+		{"list", 'l', POPT_ARG_NONE, &cfg.list, 0, "List the directory instead of downloading a file",
+			NULL},
+		{"output", 'o', POPT_ARG_STRING, &cfg.output, 0, "Output file (default the name of the file)",
+			"pathname"},
+		{"continue", 'c', POPT_ARG_NONE, &cfg.resume, 0, "Continue an interrupted download",
+			NULL},
+		{"verbose", 'v', POPT_ARG_NONE, &cfg.verbose, 0, "Be verbose",
+			NULL},
+		POPT_AUTOHELP
+		{ NULL, 0, 0, NULL, 0}
+	};
+
+	cfg.baud = 500000;
+	cfg.window = 8;
+
+	poptc = poptGetContext(NULL, argc, argv, options, 0);
+	poptSetOtherOptionHelp(poptc, "[OPTIONS] <file>|<directory>");
+
+	while ((rc = poptGetNextOpt(poptc)) >= 0);
+
+	if (rc < -1) {
+		/* Option parsing error */
+		fprintf(stderr, "%s: %s\n", poptBadOption(poptc, POPT_BADOPTION_NOALIAS), poptStrerror(rc));
+		exit(EXIT_FAILURE);
+	}
+
+	cfg.name = poptGetArg(poptc);
+	if (cfg.name)
+		cfg.name = strdup(cfg.name);
+
+	if (!cfg.device || (!cfg.list && !cfg.name) || cfg.window < 1 || cfg.window > 255) {
+		poptPrintUsage(poptc, stderr, 0);
+		exit(EXIT_FAILURE);
+	}
+
+	poptFreeContext(poptc);
+}
+
+int main(int argc, const char **argv)
+{
+	int rc;
+
+	parse_options(argc, argv);
+
+	tty = open_tty(cfg.device, cfg.baud);
+	if (tty < 0)
+		exit(EXIT_FAILURE);
+
+	if (cfg.list) {
+		rc = list(cfg.name ? cfg.name : "");
+	} else {
+		const char *base = strrchr(cfg.name, '/');
+
+		rc = get(cfg.name, cfg.output ? cfg.output : (base ? base + 1 : cfg.name), cfg.resume);
+	}
+
+	close(tty);
+	exit(rc < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -39,6 +39,8 @@
 #include <sys/stat.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <time.h>
+#include <sys/wait.h>
 
 #include <popt.h>
 
@@ -48,6 +50,7 @@ enum {
 	MODE_RESET,
 	MODE_UPDATE_EEPROM,
 	MODE_READ_SERIAL,
+	MODE_EXEC,
 };
 
 struct config_t {
@@ -55,6 +58,13 @@ struct config_t {
 
 	int mode;
 	int verbose;
+	/* Multi-node configuration */
+	int all;
+	int jobs;
+	int retries;
+	int first_node;
+	char *product;
+	char *exec;
 	/* EEPROM configuration */
 	int eep_cbusio;
 	uint16_t eep_vendor_id;
@@ -339,6 +349,202 @@ out:
 	inga_usb_free_device(usbdev);
 }
 
+/* Expand %d (device path), %s (USB serial) and %n (node number) in the
+ * --exec command */
+static char *expand_command(struct config_t *cfg, int node)
+{
+	char *command;
+	size_t size;
+	const char *p;
+	FILE *f;
+
+	f = open_memstream(&command, &size);
+	if (!f)
+		return NULL;
+
+	for (p = cfg->exec; *p; p++) {
+		if (p[0] != '%' || p[1] == 0) {
+			fputc(*p, f);
+			continue;
+		}
+		switch (*++p) {
+		case 'd':
+			fputs(cfg->usb.device_path ? cfg->usb.device_path : "", f);
+			break;
+		case 's':
+			fputs(cfg->usb.device_serial ? cfg->usb.device_serial : "", f);
+			break;
+		case 'n':
+			fprintf(f, "%i", node);
+			break;
+		default:
+			fputc(*p, f);
+			break;
+		}
+	}
+	fclose(f);
+
+	return command;
+}
+
+void inga_exec(struct config_t *cfg, int node)
+{
+	int rc;
+	char *command;
+
+	command = expand_command(cfg, node);
+	if (!command) {
+		fprintf(stderr, "Could not build command\n");
+		exit(EXIT_FAILURE);
+	}
+
+	/* Reset into the bootloader, which only waits a short time for
+	 * avrdude, like the reset target of the platform Makefile */
+	inga_reset(cfg);
+	usleep(500000);
+
+	VERBOSE("Running %s\n", command);
+	rc = system(command);
+	if (rc == -1 || !WIFEXITED(rc) || WEXITSTATUS(rc) != 0) {
+		fprintf(stderr, "Command failed: %s\n", command);
+		exit(EXIT_FAILURE);
+	}
+	free(command);
+}
+
+void inga_run(struct config_t *cfg, int node)
+{
+	if (cfg->mode == MODE_RESET)
+		inga_reset(cfg);
+	else if (cfg->mode == MODE_UPDATE_EEPROM)
+		inga_eeprom(cfg);
+	else if (cfg->mode == MODE_READ_SERIAL)
+		inga_serial(cfg);
+	else if (cfg->mode == MODE_EXEC)
+		inga_exec(cfg, node);
+}
+
+/* State of one node in --all mode */
+struct node_t {
+	struct inga_usb_node_t *usb;
+	pid_t pid;
+	int attempts;
+	int done;
+	int failed;
+	time_t start;
+	time_t end;
+};
+
+static void inga_all_start(struct config_t *cfg, struct node_t *node, int number)
+{
+	if (node->attempts == 0)
+		node->start = time(NULL);
+	node->attempts++;
+
+	fflush(stdout);
+	fflush(stderr);
+
+	node->pid = fork();
+	if (node->pid < 0) {
+		perror("fork");
+		node->pid = 0;
+		node->done = node->failed = 1;
+		node->end = time(NULL);
+		return;
+	}
+
+	if (node->pid == 0) {
+		/* Each worker opens its own USB handles, the failure paths of
+		 * the single node functions just end the worker */
+		cfg->usb.device_path = node->usb->device_path;
+		cfg->usb.device_serial = node->usb->device_serial;
+		inga_run(cfg, number);
+		exit(EXIT_SUCCESS);
+	}
+
+	VERBOSE("Started worker %i for %s (attempt %i)\n", node->pid, node->usb->device_path, node->attempts);
+}
+
+void inga_all(struct config_t *cfg)
+{
+	struct inga_usb_node_t *usbnodes;
+	struct node_t *nodes;
+	int count, i, running, finished, failed, status;
+	pid_t pid;
+
+	count = inga_usb_find_all(cfg->product, &usbnodes, cfg->verbose);
+	if (count <= 0) {
+		fprintf(stderr, "No INGA nodes found\n");
+		exit(EXIT_FAILURE);
+	}
+	printf("Found %i INGA nodes\n", count);
+
+	nodes = calloc(count, sizeof(struct node_t));
+	if (!nodes) {
+		fprintf(stderr, "Out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+	for (i = 0; i < count; i++)
+		nodes[i].usb = &usbnodes[i];
+
+	running = finished = 0;
+	while (finished < count) {
+		/* Start workers for the waiting nodes, up to the job limit */
+		for (i = 0; i < count && (cfg->jobs <= 0 || running < cfg->jobs); i++) {
+			if (nodes[i].done || nodes[i].pid != 0)
+				continue;
+			inga_all_start(cfg, &nodes[i], cfg->first_node + i);
+			if (nodes[i].pid != 0)
+				running++;
+			else
+				finished++;
+		}
+		if (running == 0)
+			continue;
+
+		pid = wait(&status);
+		if (pid < 0) {
+			perror("wait");
+			exit(EXIT_FAILURE);
+		}
+		for (i = 0; i < count && nodes[i].pid != pid; i++);
+		if (i == count)
+			continue;
+
+		running--;
+		nodes[i].pid = 0;
+		if (WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS) {
+			nodes[i].done = 1;
+		} else if (nodes[i].attempts > cfg->retries) {
+			nodes[i].done = nodes[i].failed = 1;
+		} else {
+			fprintf(stderr, "%s failed, retrying\n", nodes[i].usb->device_path);
+			continue;
+		}
+		nodes[i].end = time(NULL);
+		finished++;
+	}
+
+	failed = 0;
+	for (i = 0; i < count; i++)
+		failed += nodes[i].failed;
+
+	printf("\nSummary: %i nodes, %i succeeded, %i failed\n", count, count - failed, failed);
+	for (i = 0; i < count; i++) {
+		printf("  %-14s serial %-10s node %-4i %-6s %i attempt(s) %lis\n",
+			nodes[i].usb->device_path,
+			nodes[i].usb->device_serial ? nodes[i].usb->device_serial : "-",
+			cfg->first_node + i, nodes[i].failed ? "FAILED" : "ok",
+			nodes[i].attempts, (long) (nodes[i].end - nodes[i].start));
+	}
+
+	free(nodes);
+	inga_usb_free_nodes(usbnodes, count);
+
+	if (failed)
+		exit(EXIT_FAILURE);
+}
+
 void usage(poptContext poptc, int exitcode, char *error, char *addl)
 {
 	poptPrintUsage(poptc, stderr, 0);
@@ -369,6 +575,18 @@ void parse_options(int argc, const char **argv, struct config_t *cfg)
 			NULL},
 		{"max-power", 'p', POPT_ARG_INT, &cfg->eep_max_power, 0, "Maximum current to draw from USB (mA)",
 			"current"},
+		{"exec", 'x', POPT_ARG_STRING, &cfg->exec, 0, "Reset into the bootloader and run command (%d device, %s USB serial, %n node number)",
+			"command"},
+		{"all", 'a', POPT_ARG_NONE, &cfg->all, 0, "Run on all attached INGA nodes in parallel",
+			NULL},
+		{"product", 'P', POPT_ARG_STRING, &cfg->product, 0, "USB product string of the nodes for --all (\"\" for any FTDI)",
+			"product"},
+		{"jobs", 'j', POPT_ARG_INT, &cfg->jobs, 0, "Maximum number of nodes handled at once with --all (default all)",
+			"count"},
+		{"retries", 'R', POPT_ARG_INT, &cfg->retries, 0, "Retries for a failed node with --all (default 2)",
+			"count"},
+		{"first-node", 'n', POPT_ARG_INT, &cfg->first_node, 0, "Node number of the first node with --all (default 1)",
+			"number"},
 		POPT_AUTOHELP
 		{ NULL, 0, 0, NULL, 0}
 	};
@@ -390,7 +608,13 @@ void parse_options(int argc, const char **argv, struct config_t *cfg)
 		exit(EXIT_FAILURE);
 	}
 
-	if (!cfg->usb.device_path && !cfg->usb.device_serial)
+	if (cfg->exec)
+		cfg->mode = MODE_EXEC;
+
+	if (cfg->all && (cfg->usb.device_path || cfg->usb.device_serial))
+		usage(poptc, 1, "--all can not be combined with --device or --usbserial", "");
+
+	if (!cfg->all && !cfg->usb.device_path && !cfg->usb.device_serial)
 		usage(poptc, 1, "At least one of --device or --serial has to be set", "");
 
 	poptFreeContext(poptc);
@@ -428,6 +652,11 @@ struct config_t *init_config(void)
 	cfg->eep_prod = "INGA";
 	cfg->eep_max_power = -1;
 
+	/* Nodes for --all are found by the product string set above */
+	cfg->product = "INGA";
+	cfg->retries = 2;
+	cfg->first_node = 1;
+
 	return cfg;
 }
 
@@ -445,12 +674,10 @@ int main(int argc, const char **argv)
 
 	VERBOSE("Config: path: %s, serial: %s, id: %s\n", cfg->usb.device_path, cfg->usb.device_serial, cfg->usb.device_id);
 
-	if (cfg->mode == MODE_RESET)
-		inga_reset(cfg);
-	else if (cfg->mode == MODE_UPDATE_EEPROM)
-		inga_eeprom(cfg);
-	else if (cfg->mode == MODE_READ_SERIAL)
-		inga_serial(cfg);
+	if (cfg->all)
+		inga_all(cfg);
+	else
+		inga_run(cfg, cfg->first_node);
 
 	exit(EXIT_SUCCESS);
 }
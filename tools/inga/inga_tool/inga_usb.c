@@ -755,6 +755,98 @@ static void inga_usb_resolve(struct inga_usb_config_t *cfg, int verbose)
 	}
 }
 
+static int inga_usb_node_cmp(const void *a, const void *b)
+{
+	const char *pa = ((const struct inga_usb_node_t *) a)->device_path;
+	const char *pb = ((const struct inga_usb_node_t *) b)->device_path;
+
+	/* Shorter paths first, so that ttyUSB2 comes before ttyUSB10 */
+	if (strlen(pa) != strlen(pb))
+		return strlen(pa) - strlen(pb);
+
+	return strcmp(pa, pb);
+}
+
+int inga_usb_find_all(const char *product, struct inga_usb_node_t **nodes, int verbose)
+{
+	struct udev *udev;
+	struct udev_enumerate *enumerate;
+	struct udev_list_entry *entry;
+	struct udev_device *dev, *usbdev;
+	struct inga_usb_node_t *tmp;
+	const char *vendor, *usbproduct, *serial, *devnode;
+	int count = 0;
+
+	*nodes = NULL;
+
+	udev = udev_new();
+	if (!udev) {
+		fprintf(stderr, "Failed to initialize udev\n");
+		return -1;
+	}
+
+	enumerate = udev_enumerate_new(udev);
+	udev_enumerate_add_match_subsystem(enumerate, "tty");
+	udev_enumerate_scan_devices(enumerate);
+
+	udev_list_entry_foreach(entry, udev_enumerate_get_list_entry(enumerate)) {
+		dev = udev_device_new_from_syspath(udev, udev_list_entry_get_name(entry));
+		if (!dev)
+			continue;
+
+		/* The parent is owned by dev and must not be unref'ed */
+		usbdev = udev_device_get_parent_with_subsystem_devtype(dev, "usb", "usb_device");
+		devnode = udev_device_get_devnode(dev);
+		if (!usbdev || !devnode) {
+			udev_device_unref(dev);
+			continue;
+		}
+
+		vendor = udev_device_get_sysattr_value(usbdev, "idVendor");
+		usbproduct = udev_device_get_sysattr_value(usbdev, "product");
+		serial = udev_device_get_sysattr_value(usbdev, "serial");
+
+		if (!vendor || strcmp(vendor, "0403") ||
+		    (product[0] && (!usbproduct || strcmp(usbproduct, product)))) {
+			udev_device_unref(dev);
+			continue;
+		}
+
+		tmp = realloc(*nodes, (count + 1) * sizeof(struct inga_usb_node_t));
+		if (!tmp) {
+			udev_device_unref(dev);
+			break;
+		}
+		*nodes = tmp;
+		(*nodes)[count].device_path = strdup(devnode);
+		(*nodes)[count].device_serial = serial ? strdup(serial) : NULL;
+
+		VERBOSE("Found %s with USB serial %s\n", devnode, serial ? serial : "(none)");
+		count++;
+
+		udev_device_unref(dev);
+	}
+
+	udev_enumerate_unref(enumerate);
+	udev_unref(udev);
+
+	if (count > 0)
+		qsort(*nodes, count, sizeof(struct inga_usb_node_t), inga_usb_node_cmp);
+
+	return count;
+}
+
+void inga_usb_free_nodes(struct inga_usb_node_t *nodes, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		free(nodes[i].device_path);
+		free(nodes[i].device_serial);
+	}
+	free(nodes);
+}
+
 int inga_usb_ftdi_init(struct inga_usb_ftdi_t **ftdi)
 {
 	*ftdi = (struct inga_usb_ftdi_t *) malloc(sizeof(struct inga_usb_ftdi_t));
@@ -78,11 +78,23 @@ struct inga_usb_config_t {
 	int devnum;
 };
 
+/* An attached FTDI found by inga_usb_find_all() */
+struct inga_usb_node_t {
+	char *device_path;
+	char *device_serial;
+};
+
 struct inga_usb_device_t;
 struct inga_usb_ftdi_t;
 
 struct inga_usb_device_t *inga_usb_find_device(struct inga_usb_config_t *cfg, int verbose);
 
+/* Find the serial devices of all attached FTDIs whose USB product string
+ * is product (any FTDI if product is empty), sorted by device path.
+ * Returns the number of nodes, or -1 on error. */
+int inga_usb_find_all(const char *product, struct inga_usb_node_t **nodes, int verbose);
+void inga_usb_free_nodes(struct inga_usb_node_t *nodes, int count);
+
 void inga_usb_free_device(struct inga_usb_device_t *usb);
 
 int inga_usb_ftdi_init(struct inga_usb_ftdi_t **ftdi);
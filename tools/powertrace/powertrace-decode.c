@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2013, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Decodes binary powertrace records (apps/powertrace/powertrace.h) from
+ * a serial log into the text P and PD lines that powertrace_print()
+ * writes, so that the parse-* scripts work unchanged. Totals are the
+ * sums of the records seen for a node. Everything that is not a valid
+ * frame is skipped.
+ *
+ * Build: gcc -o powertrace-decode -I../platform/native -I../cpu/native \
+ *          -I../core -I../apps/powertrace powertrace/powertrace-decode.c \
+ *          ../core/lib/crc16.c
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "lib/crc16.h"
+#include "powertrace.h"
+
+#define RECORD_SIZE sizeof(struct powertrace_record)
+#define MAX_NODES   1024
+
+struct node {
+  uint8_t addr[2];
+  unsigned long total[POWERTRACE_NUM_CHANNELS];
+};
+
+static struct node nodes[MAX_NODES];
+static int num_nodes;
+
+/*---------------------------------------------------------------------------*/
+static unsigned long
+get16(const uint8_t *p)
+{
+  return p[0] | ((unsigned long)p[1] << 8);
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+get32(const uint8_t *p)
+{
+  return get16(p) | (get16(p + 2) << 16);
+}
+/*---------------------------------------------------------------------------*/
+static struct node *
+find_node(const uint8_t *addr)
+{
+  int i;
+
+  for(i = 0; i < num_nodes; i++) {
+    if(memcmp(nodes[i].addr, addr, 2) == 0) {
+      return &nodes[i];
+    }
+  }
+  if(num_nodes == MAX_NODES) {
+    return NULL;
+  }
+  memcpy(nodes[num_nodes].addr, addr, 2);
+  return &nodes[num_nodes++];
+}
+/*---------------------------------------------------------------------------*/
+static void
+print_record(const uint8_t *r)
+{
+  unsigned long ticks[POWERTRACE_NUM_CHANNELS];
+  unsigned long clock, seqno;
+  const uint8_t *addr;
+  struct node *n;
+  int i;
+
+  if(r[offsetof(struct powertrace_record, version)] !=
+     POWERTRACE_RECORD_VERSION ||
+     r[offsetof(struct powertrace_record, nchannels)] !=
+     POWERTRACE_NUM_CHANNELS) {
+    return;
+  }
+  seqno = get16(r + offsetof(struct powertrace_record, seqno));
+  clock = get32(r + offsetof(struct powertrace_record, clock));
+  addr = r + offsetof(struct powertrace_record, node);
+
+  n = find_node(addr);
+  if(n == NULL) {
+    fprintf(stderr, "powertrace-decode: too many nodes\n");
+    return;
+  }
+  for(i = 0; i < POWERTRACE_NUM_CHANNELS; i++) {
+    ticks[i] = get32(r + offsetof(struct powertrace_record, ticks) + 4 * i);
+    n->total[i] += ticks[i];
+  }
+
+  printf("%lu P %d.%d %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu\n",
+         clock, addr[0], addr[1], seqno,
+         n->total[POWERTRACE_CPU], n->total[POWERTRACE_LPM],
+         n->total[POWERTRACE_TRANSMIT], n->total[POWERTRACE_LISTEN],
+         n->total[POWERTRACE_IDLE_TRANSMIT], n->total[POWERTRACE_IDLE_LISTEN],
+         ticks[POWERTRACE_CPU], ticks[POWERTRACE_LPM],
+         ticks[POWERTRACE_TRANSMIT], ticks[POWERTRACE_LISTEN],
+         ticks[POWERTRACE_IDLE_TRANSMIT], ticks[POWERTRACE_IDLE_LISTEN]);
+  printf("%lu PD %d.%d %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu\n",
+         clock, addr[0], addr[1], seqno,
+         n->total[POWERTRACE_SDCARD], n->total[POWERTRACE_FLASH_READ],
+         n->total[POWERTRACE_FLASH_WRITE], n->total[POWERTRACE_I2C],
+         n->total[POWERTRACE_ADC],
+         ticks[POWERTRACE_SDCARD], ticks[POWERTRACE_FLASH_READ],
+         ticks[POWERTRACE_FLASH_WRITE], ticks[POWERTRACE_I2C],
+         ticks[POWERTRACE_ADC]);
+}
+/*---------------------------------------------------------------------------*/
+static size_t
+resync(uint8_t *frame, size_t len)
+{
+  size_t i;
+
+  /* Drop bytes until the buffer starts with what can be the beginning
+     of a frame. */
+  for(i = 1; i < len; i++) {
+    if(frame[i] == POWERTRACE_FRAME_START &&
+       (i + 1 == len || frame[i + 1] == RECORD_SIZE)) {
+      break;
+    }
+  }
+  memmove(frame, frame + i, len - i);
+  return len - i;
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char *argv[])
+{
+  /* Start byte, length, record and CRC */
+  uint8_t frame[2 + RECORD_SIZE + 2];
+  size_t len;
+  int c;
+
+  len = 0;
+  while((c = getchar()) != EOF) {
+    if(len == 0 && c != POWERTRACE_FRAME_START) {
+      continue;
+    }
+    frame[len++] = c;
+    if(len == 2 && frame[1] != RECORD_SIZE) {
+      len = resync(frame, len);
+      continue;
+    }
+    if(len < sizeof(frame)) {
+      continue;
+    }
+
+    if(crc16_data(frame + 2, RECORD_SIZE, 0) ==
+       get16(frame + 2 + RECORD_SIZE)) {
+      print_record(frame + 2);
+      len = 0;
+    } else {
+      len = resync(frame, len);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,112 @@
+#!/usr/bin/env python
+"""Symbolize the statistical profiles dumped by sprofiling_report_binary().
+
+Build the application with PROFILE=1, log the serial output to a file
+(e.g. make login > serial.log) and run
+
+    sprof-report.py app.inga serial.log
+
+Every dump is decoded, the sampled program counters are mapped to
+functions with avr-nm and the functions are printed by sample count.
+Without a log file the dumps are read from stdin.
+"""
+
+import argparse
+import bisect
+import struct
+import subprocess
+import sys
+
+MARKER = b"\nSPROFB"
+
+
+def crc16_add(b, acc):
+    """Same CCITT CRC as core/lib/crc16.c."""
+    acc ^= b
+    acc = ((acc >> 8) | (acc << 8)) & 0xffff
+    acc ^= (acc & 0xff00) << 4
+    acc &= 0xffff
+    acc ^= (acc >> 8) >> 4
+    acc ^= (acc & 0xff00) >> 5
+    return acc & 0xffff
+
+
+def parse_dumps(data):
+    """Yields (samples, [(pc, calls)]) for every intact dump in data."""
+    pos = data.find(MARKER)
+    while pos >= 0:
+        start = pos + len(MARKER)
+        header = data[start:start + 6]
+        if len(header) < 6:
+            break
+        sites, samples = struct.unpack("<HL", header)
+        end = start + 6 + 4 * sites
+        if end + 2 > len(data):
+            break
+        crc = 0
+        for b in bytearray(data[start:end]):
+            crc = crc16_add(b, crc)
+        if struct.unpack("<H", data[end:end + 2])[0] == crc:
+            records = struct.unpack("<" + "HH" * sites, data[start + 6:end])
+            # The AVR samples word addresses, nm prints byte addresses
+            yield samples, [(records[i] * 2, records[i + 1])
+                            for i in range(0, len(records), 2)]
+            pos = data.find(MARKER, end + 2)
+        else:
+            sys.stderr.write("skipping corrupted dump at offset %d\n" % pos)
+            pos = data.find(MARKER, start)
+
+
+def read_symbols(elf, nm):
+    """Returns the sorted start addresses and names of all functions."""
+    out = subprocess.check_output([nm, "-n", "-C", "--defined-only", elf])
+    addrs, names = [], []
+    for line in out.decode("ascii", "replace").splitlines():
+        fields = line.split(None, 2)
+        if len(fields) == 3 and fields[1] in "tTwW":
+            addrs.append(int(fields[0], 16))
+            names.append(fields[2])
+    return addrs, names
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Report hot functions")
+    parser.add_argument("elf", help="the application ELF file")
+    parser.add_argument("log", nargs="?", help="serial log, default stdin")
+    parser.add_argument("--nm", default="avr-nm", help="nm to use")
+    parser.add_argument("-n", "--top", type=int, default=20,
+                        help="number of functions to print")
+    parser.add_argument("--last", action="store_true",
+                        help="only report the last dump")
+    args = parser.parse_args()
+
+    if args.log:
+        with open(args.log, "rb") as f:
+            data = f.read()
+    else:
+        data = getattr(sys.stdin, "buffer", sys.stdin).read()
+
+    dumps = list(parse_dumps(data))
+    if not dumps:
+        sys.exit("no profile dumps found")
+    if args.last:
+        dumps = dumps[-1:]
+
+    addrs, names = read_symbols(args.elf, args.nm)
+    functions = {}
+    total = 0
+    for samples, sites in dumps:
+        total += samples
+        for pc, calls in sites:
+            i = bisect.bisect_right(addrs, pc) - 1
+            name = names[i] if i >= 0 else "0x%05x" % pc
+            functions[name] = functions.get(name, 0) + calls
+
+    print("%d dumps, %d samples" % (len(dumps), total))
+    hot = sorted(functions.items(), key=lambda f: f[1], reverse=True)
+    for name, calls in hot[:args.top]:
+        print("%6.2f%% %8d  %s" % (100.0 * calls / max(total, 1), calls, name))
+
+
+if __name__ == "__main__":
+    main()
@@ -57,25 +57,51 @@
 #include <err.h>
 
 int verbose = 1;
-const char *ipaddr;
-const char *netmask;
-int slipfd = 0;
-uint16_t basedelay=0,delaymsec=0;
-uint32_t startsec,startmsec,delaystartsec,delaystartmsec;
+uint16_t basedelay=0;
 int timestamp = 0, flowcontrol=0;
 
+/* Serial links served by one process, each with its own tun device */
+#define MAX_LINKS 8
+
+/* Output buffer of a link, room for several encoded packets */
+#define SLIP_OUTBUF_SIZE 8192
+/* Worst case size of an encoded packet read from tun */
+#define SLIP_MAX_ENCODED (2 * 2000 + 1)
+
+struct slip_link {
+  int fd;
+  const char *siodev;
+  const char *ipaddr;
+  char tundev[32];
+  int tunfd;
+
+  /* Input, decoded as it is read */
+  unsigned char inbuf[2000];
+  int inbufptr;
+  int esc;
+
+  /* Output, encoded packets waiting for the serial line */
+  unsigned char outbuf[SLIP_OUTBUF_SIZE];
+  int out_begin, out_end;
+
+  /* Delay after the last outgoing packet, see -d */
+  uint16_t delaymsec;
+  uint32_t delaystartsec, delaystartmsec;
+};
+
+struct slip_link links[MAX_LINKS];
+int nlinks;
+
 int ssystem(const char *fmt, ...)
      __attribute__((__format__ (__printf__, 1, 2)));
-void write_to_serial(int outfd, void *inbuf, int len);
+void write_to_serial(struct slip_link *l, void *inbuf, int len);
 
-void slip_send(int fd, unsigned char c);
-void slip_send_char(int fd, unsigned char c);
+void slip_send(struct slip_link *l, unsigned char c);
+void slip_send_char(struct slip_link *l, unsigned char c);
 
 //#define PROGRESS(s) fprintf(stderr, s)
 #define PROGRESS(s) do { } while (0)
 
-char tundev[32] = { "" };
-
 int
 ssystem(const char *fmt, ...) __attribute__((__format__ (__printf__, 1, 2)));
 
@@ -151,241 +177,252 @@ is_sensible_string(const unsigned char *s, int len)
 }
 
 /*
- * Read from serial, when we have a packet write it to tun. No output
- * buffering, input buffered by stdio.
+ * Handle a complete frame from serial: a debug line, a request from the
+ * border router or a packet for tun.
  */
 void
-serial_to_tun(FILE *inslip, int outfd)
+serial_frame(struct slip_link *l)
 {
-  static union {
-    unsigned char inbuf[2000];
-  } uip;
-  static int inbufptr = 0;
-  int ret,i;
-  unsigned char c;
-
-#ifdef linux
-  ret = fread(&c, 1, 1, inslip);
-  if(ret == -1 || ret == 0) err(1, "serial_to_tun: read");
-  goto after_fread;
-#endif
+  unsigned char *inbuf = l->inbuf;
+  int inbufptr = l->inbufptr;
+  int i;
 
- read_more:
-  if(inbufptr >= sizeof(uip.inbuf)) {
-     if(timestamp) stamptime();
-     fprintf(stderr, "*** dropping large %d byte packet\n",inbufptr);
-	 inbufptr = 0;
-  }
-  ret = fread(&c, 1, 1, inslip);
-#ifdef linux
- after_fread:
-#endif
-  if(ret == -1) {
-    err(1, "serial_to_tun: read");
-  }
-  if(ret == 0) {
-    clearerr(inslip);
-    return;
-  }
-  /*  fprintf(stderr, ".");*/
-  switch(c) {
-  case SLIP_END:
-    if(inbufptr > 0) {
-      if(uip.inbuf[0] == '!') {
-	if(uip.inbuf[1] == 'M') {
-	  /* Read gateway MAC address and autoconfigure tap0 interface */
-	  char macs[24];
-	  int i, pos;
-	  for(i = 0, pos = 0; i < 16; i++) {
-	    macs[pos++] = uip.inbuf[2 + i];
-	    if((i & 1) == 1 && i < 14) {
-	      macs[pos++] = ':';
-	    }
-	  }
-          if(timestamp) stamptime();
-	  macs[pos] = '\0';
-//	  printf("*** Gateway's MAC address: %s\n", macs);
-	  fprintf(stderr,"*** Gateway's MAC address: %s\n", macs);
-          if (timestamp) stamptime();
-	  ssystem("ifconfig %s down", tundev);
-          if (timestamp) stamptime();
-	  ssystem("ifconfig %s hw ether %s", tundev, &macs[6]);
-          if (timestamp) stamptime();
-	  ssystem("ifconfig %s up", tundev);
+  if(inbuf[0] == '!') {
+    if(inbuf[1] == 'M') {
+      /* Read gateway MAC address and autoconfigure tap0 interface */
+      char macs[24];
+      int i, pos;
+      for(i = 0, pos = 0; i < 16; i++) {
+	macs[pos++] = inbuf[2 + i];
+	if((i & 1) == 1 && i < 14) {
+	  macs[pos++] = ':';
 	}
-      } else if(uip.inbuf[0] == '?') {
-	if(uip.inbuf[1] == 'P') {
-          /* Prefix info requested */
-          struct in6_addr addr;
-	  int i;
-	  char *s = strchr(ipaddr, '/');
-	  if(s != NULL) {
-	    *s = '\0';
-	  }
-          inet_pton(AF_INET6, ipaddr, &addr);
-          if(timestamp) stamptime();
-          fprintf(stderr,"*** Address:%s => %02x%02x:%02x%02x:%02x%02x:%02x%02x\n",
+      }
+      if(timestamp) stamptime();
+      macs[pos] = '\0';
+//	  printf("*** Gateway's MAC address: %s\n", macs);
+      fprintf(stderr,"*** Gateway's MAC address: %s\n", macs);
+      if (timestamp) stamptime();
+      ssystem("ifconfig %s down", l->tundev);
+      if (timestamp) stamptime();
+      ssystem("ifconfig %s hw ether %s", l->tundev, &macs[6]);
+      if (timestamp) stamptime();
+      ssystem("ifconfig %s up", l->tundev);
+    }
+  } else if(inbuf[0] == '?') {
+    if(inbuf[1] == 'P') {
+      /* Prefix info requested */
+      struct in6_addr addr;
+      char prefix[INET6_ADDRSTRLEN];
+      char *s;
+      strncpy(prefix, l->ipaddr, sizeof(prefix) - 1);
+      prefix[sizeof(prefix) - 1] = '\0';
+      s = strchr(prefix, '/');
+      if(s != NULL) {
+	*s = '\0';
+      }
+      inet_pton(AF_INET6, prefix, &addr);
+      if(timestamp) stamptime();
+      fprintf(stderr,"*** Address:%s => %02x%02x:%02x%02x:%02x%02x:%02x%02x\n",
  //         printf("*** Address:%s => %02x%02x:%02x%02x:%02x%02x:%02x%02x\n",
-		 ipaddr, 
-		 addr.s6_addr[0], addr.s6_addr[1],
-		 addr.s6_addr[2], addr.s6_addr[3],
-		 addr.s6_addr[4], addr.s6_addr[5],
-		 addr.s6_addr[6], addr.s6_addr[7]);
-	  slip_send(slipfd, '!');
-	  slip_send(slipfd, 'P');
-	  for(i = 0; i < 8; i++) {
-	    /* need to call the slip_send_char for stuffing */
-	    slip_send_char(slipfd, addr.s6_addr[i]);
-	  }
-	  slip_send(slipfd, SLIP_END);
-        }
+	     prefix, 
+	     addr.s6_addr[0], addr.s6_addr[1],
+	     addr.s6_addr[2], addr.s6_addr[3],
+	     addr.s6_addr[4], addr.s6_addr[5],
+	     addr.s6_addr[6], addr.s6_addr[7]);
+      slip_send(l, '!');
+      slip_send(l, 'P');
+      for(i = 0; i < 8; i++) {
+	/* need to call the slip_send_char for stuffing */
+	slip_send_char(l, addr.s6_addr[i]);
+      }
+      slip_send(l, SLIP_END);
+    }
 #define DEBUG_LINE_MARKER '\r'
-      } else if(uip.inbuf[0] == DEBUG_LINE_MARKER) {    
-	fwrite(uip.inbuf + 1, inbufptr - 1, 1, stdout);
-      } else if(is_sensible_string(uip.inbuf, inbufptr)) {
-        if(verbose==1) {   /* strings already echoed below for verbose>1 */
-          if (timestamp) stamptime();
-          fwrite(uip.inbuf, inbufptr, 1, stdout);
-        }
-      } else {
-        if(verbose>2) {
-          if (timestamp) stamptime();
-          printf("Packet from SLIP of length %d - write TUN\n", inbufptr);
-          if (verbose>4) {
+  } else if(inbuf[0] == DEBUG_LINE_MARKER) {    
+    fwrite(inbuf + 1, inbufptr - 1, 1, stdout);
+  } else if(is_sensible_string(inbuf, inbufptr)) {
+    if(verbose==1) {   /* strings already echoed below for verbose>1 */
+      if (timestamp) stamptime();
+      fwrite(inbuf, inbufptr, 1, stdout);
+    }
+  } else {
+    if(verbose>2) {
+      if (timestamp) stamptime();
+      printf("Packet from SLIP of length %d - write TUN %s\n", inbufptr,
+             l->tundev);
+      if (verbose>4) {
 #if WIRESHARK_IMPORT_FORMAT
-            printf("0000");
-	        for(i = 0; i < inbufptr; i++) printf(" %02x",uip.inbuf[i]);
+	printf("0000");
+	for(i = 0; i < inbufptr; i++) printf(" %02x",inbuf[i]);
 #else
-            printf("         ");
-            for(i = 0; i < inbufptr; i++) {
-              printf("%02x", uip.inbuf[i]);
-              if((i & 3) == 3) printf(" ");
-              if((i & 15) == 15) printf("\n         ");
-            }
-#endif
-            printf("\n");
-          }
-        }
-	if(write(outfd, uip.inbuf, inbufptr) != inbufptr) {
-	  err(1, "serial_to_tun: write");
+	printf("         ");
+	for(i = 0; i < inbufptr; i++) {
+	  printf("%02x", inbuf[i]);
+	  if((i & 3) == 3) printf(" ");
+	  if((i & 15) == 15) printf("\n         ");
 	}
+#endif
+	printf("\n");
       }
-      inbufptr = 0;
     }
-    break;
+    if(write(l->tunfd, inbuf, inbufptr) != inbufptr) {
+      err(1, "serial_to_tun: write");
+    }
+  }
+}
+/*
+ * Read from serial, when we have a packet write it to tun. Reads all
+ * that the serial driver has and decodes every frame in it.
+ */
+void
+serial_to_tun(struct slip_link *l)
+{
+  unsigned char buf[4096];
+  int n, i;
+  unsigned char c;
 
-  case SLIP_ESC:
-    if(fread(&c, 1, 1, inslip) != 1) {
-      clearerr(inslip);
-      /* Put ESC back and give up! */
-      ungetc(SLIP_ESC, inslip);
+  n = read(l->fd, buf, sizeof(buf));
+  if(n == -1) {
+    if(errno == EAGAIN || errno == EINTR) {
       return;
     }
+    err(1, "serial_to_tun: read");
+  }
+#ifdef linux
+  if(n == 0) err(1, "serial_to_tun: read");
+#endif
+
+  for(i = 0; i < n; i++) {
+    c = buf[i];
+
+    if(l->inbufptr >= sizeof(l->inbuf)) {
+      if(timestamp) stamptime();
+      fprintf(stderr, "*** dropping large %d byte packet\n", l->inbufptr);
+      l->inbufptr = 0;
+    }
 
-    switch(c) {
-    case SLIP_ESC_END:
-      c = SLIP_END;
-      break;
-    case SLIP_ESC_ESC:
-      c = SLIP_ESC;
-      break;
+    if(l->esc) {
+      l->esc = 0;
+      switch(c) {
+      case SLIP_ESC_END:
+	c = SLIP_END;
+	break;
+      case SLIP_ESC_ESC:
+	c = SLIP_ESC;
+	break;
+      }
+    } else if(c == SLIP_END) {
+      if(l->inbufptr > 0) {
+	serial_frame(l);
+	l->inbufptr = 0;
+      }
+      continue;
+    } else if(c == SLIP_ESC) {
+      l->esc = 1;
+      continue;
     }
-    /* FALLTHROUGH */
-  default:
-    uip.inbuf[inbufptr++] = c;
+
+    l->inbuf[l->inbufptr++] = c;
 
     /* Echo lines as they are received for verbose=2,3,5+ */
     /* Echo all printable characters for verbose==4 */
     if((verbose==2) || (verbose==3) || (verbose>4)) {
       if(c=='\n') {
-        if(is_sensible_string(uip.inbuf, inbufptr)) {
-          if (timestamp) stamptime();
-          fwrite(uip.inbuf, inbufptr, 1, stdout);
-          inbufptr=0;
-        }
+	if(is_sensible_string(l->inbuf, l->inbufptr)) {
+	  if (timestamp) stamptime();
+	  fwrite(l->inbuf, l->inbufptr, 1, stdout);
+	  l->inbufptr=0;
+	}
       }
     } else if(verbose==4) {
       if(c == 0 || c == '\r' || c == '\n' || c == '\t' || (c >= ' ' && c <= '~')) {
 	fwrite(&c, 1, 1, stdout);
-        if(c=='\n') if(timestamp) stamptime();
+	if(c=='\n') if(timestamp) stamptime();
       }
     }
-    
-    break;
   }
-
-  goto read_more;
 }
 
-unsigned char slip_buf[2000];
-int slip_end, slip_begin;
-
 void
-slip_send_char(int fd, unsigned char c)
+slip_send_char(struct slip_link *l, unsigned char c)
 {
   switch(c) {
   case SLIP_END:
-    slip_send(fd, SLIP_ESC);
-    slip_send(fd, SLIP_ESC_END);
+    slip_send(l, SLIP_ESC);
+    slip_send(l, SLIP_ESC_END);
     break;
   case SLIP_ESC:
-    slip_send(fd, SLIP_ESC);
-    slip_send(fd, SLIP_ESC_ESC);
+    slip_send(l, SLIP_ESC);
+    slip_send(l, SLIP_ESC_ESC);
     break;
   default:
-    slip_send(fd, c);
+    slip_send(l, c);
     break;
   }
 }
 
 void
-slip_send(int fd, unsigned char c)
+slip_send(struct slip_link *l, unsigned char c)
 {
-  if(slip_end >= sizeof(slip_buf)) {
+  if(l->out_end >= sizeof(l->outbuf)) {
     err(1, "slip_send overflow");
   }
-  slip_buf[slip_end] = c;
-  slip_end++;
+  l->outbuf[l->out_end] = c;
+  l->out_end++;
 }
 
 int
-slip_empty()
+slip_empty(struct slip_link *l)
 {
-  return slip_end == 0;
+  return l->out_end == 0;
+}
+
+/* Room for another packet from tun? */
+int
+slip_room(struct slip_link *l)
+{
+  return l->out_end + SLIP_MAX_ENCODED <= sizeof(l->outbuf);
 }
 
 void
-slip_flushbuf(int fd)
+slip_flushbuf(struct slip_link *l)
 {
   int n;
   
-  if(slip_empty()) {
+  if(slip_empty(l)) {
     return;
   }
 
-  n = write(fd, slip_buf + slip_begin, (slip_end - slip_begin));
+  n = write(l->fd, l->outbuf + l->out_begin, (l->out_end - l->out_begin));
 
   if(n == -1 && errno != EAGAIN) {
     err(1, "slip_flushbuf write failed");
   } else if(n == -1) {
     PROGRESS("Q");		/* Outqueueis full! */
   } else {
-    slip_begin += n;
-    if(slip_begin == slip_end) {
-      slip_begin = slip_end = 0;
+    l->out_begin += n;
+    if(l->out_begin == l->out_end) {
+      l->out_begin = l->out_end = 0;
+    } else {
+      /* Make room for the next packets from tun */
+      memmove(l->outbuf, l->outbuf + l->out_begin, l->out_end - l->out_begin);
+      l->out_end -= l->out_begin;
+      l->out_begin = 0;
     }
   }
 }
 
 void
-write_to_serial(int outfd, void *inbuf, int len)
+write_to_serial(struct slip_link *l, void *inbuf, int len)
 {
   u_int8_t *p = inbuf;
+  unsigned char *out;
   int i;
 
   if(verbose>2) {
     if (timestamp) stamptime();
-    printf("Packet from TUN of length %d - write SLIP\n", len);
+    printf("Packet from TUN %s of length %d - write SLIP\n", l->tundev, len);
     if (verbose>4) {
 #if WIRESHARK_IMPORT_FORMAT
       printf("0000");
@@ -405,43 +442,59 @@ write_to_serial(int outfd, void *inbuf, int len)
   /* It would be ``nice'' to send a SLIP_END here but it's not
    * really necessary.
    */
-  /* slip_send(outfd, SLIP_END); */
+  /* slip_send(l, SLIP_END); */
 
+  if(l->out_end + 2 * len + 1 > sizeof(l->outbuf)) {
+    err(1, "slip_send overflow");
+  }
+  out = &l->outbuf[l->out_end];
   for(i = 0; i < len; i++) {
     switch(p[i]) {
     case SLIP_END:
-      slip_send(outfd, SLIP_ESC);
-      slip_send(outfd, SLIP_ESC_END);
+      *out++ = SLIP_ESC;
+      *out++ = SLIP_ESC_END;
       break;
     case SLIP_ESC:
-      slip_send(outfd, SLIP_ESC);
-      slip_send(outfd, SLIP_ESC_ESC);
+      *out++ = SLIP_ESC;
+      *out++ = SLIP_ESC_ESC;
       break;
     default:
-      slip_send(outfd, p[i]);
+      *out++ = p[i];
       break;
     }
   }
-  slip_send(outfd, SLIP_END);
+  *out++ = SLIP_END;
+  l->out_end = out - l->outbuf;
   PROGRESS("t");
 }
 
 
 /*
- * Read from tun, write to slip.
+ * Read from tun, write to slip. Without a delay between packets, all
+ * packets that tun has queued and that fit are encoded and go out with
+ * one write.
  */
 int
-tun_to_serial(int infd, int outfd)
+tun_to_serial(struct slip_link *l)
 {
   struct {
     unsigned char inbuf[2000];
   } uip;
-  int size;
+  int size, total = 0;
+
+  do {
+    if((size = read(l->tunfd, uip.inbuf, 2000)) == -1) {
+      if(errno == EAGAIN) {
+        break;
+      }
+      err(1, "tun_to_serial: read");
+    }
 
-  if((size = read(infd, uip.inbuf, 2000)) == -1) err(1, "tun_to_serial: read");
+    write_to_serial(l, uip.inbuf, size);
+    total += size;
+  } while(basedelay == 0 && slip_room(l));
 
-  write_to_serial(outfd, uip.inbuf, size);
-  return size;
+  return total;
 }
 
 #ifndef BAUDRATE
@@ -544,7 +597,7 @@ tun_alloc(char *dev, int tap)
 #endif
 
 void
-cleanup(void)
+cleanup_link(const char *tundev, const char *ipaddr)
 {
 #ifndef __APPLE__
   if (timestamp) stamptime();
@@ -573,6 +626,18 @@ cleanup(void)
 #endif
 }
 
+void
+cleanup(void)
+{
+  int i;
+
+  for(i = 0; i < nlinks; i++) {
+    if(links[i].tunfd != -1) {
+      cleanup_link(links[i].tundev, links[i].ipaddr);
+    }
+  }
+}
+
 void
 sigcleanup(int signo)
 {
@@ -685,21 +750,56 @@ ifconf(const char *tundev, const char *ipaddr)
   ssystem("ifconfig %s\n", tundev);
 }
 
+/*
+ * Open the serial device of a link, or the first default device that
+ * can be opened.
+ */
+void
+siodev_open(struct slip_link *l)
+{
+  if(l->siodev != NULL) {
+    l->fd = devopen(l->siodev, O_RDWR | O_NONBLOCK);
+    if(l->fd == -1) {
+      err(1, "can't open siodev ``/dev/%s''", l->siodev);
+    }
+  } else {
+    static const char *siodevs[] = {
+      "ttyUSB0", "cuaU0", "ucom0" /* linux, fbsd6, fbsd5 */
+    };
+    int i;
+    for(i = 0; i < 3; i++) {
+      l->siodev = siodevs[i];
+      l->fd = devopen(l->siodev, O_RDWR | O_NONBLOCK);
+      if(l->fd != -1) {
+        break;
+      }
+    }
+    if(l->fd == -1) {
+      err(1, "can't open siodev");
+    }
+  }
+  if (timestamp) stamptime();
+  fprintf(stderr, "********SLIP started on ``/dev/%s''\n", l->siodev);
+  stty_telos(l->fd);
+}
+
 int
 main(int argc, char **argv)
 {
   int c;
-  int tunfd, maxfd;
+  int maxfd;
   int ret;
+  int i;
   fd_set rset, wset;
-  FILE *inslip;
-  const char *siodev = NULL;
+  struct slip_link *l;
+  const char *siodevs[MAX_LINKS];
+  const char *tundevs[MAX_LINKS];
+  int nsiodevs = 0, ntundevs = 0;
   const char *host = NULL;
   const char *port = NULL;
   const char *prog;
   int baudrate = -2;
   int tap = 0;
-  slipfd = 0;
 
   prog = argv[0];
   setvbuf(stdout, NULL, _IOLBF, 0); /* Line buffered output. */
@@ -719,18 +819,24 @@ main(int argc, char **argv)
       break;
 
     case 's':
+      if(nsiodevs == MAX_LINKS) {
+        err(1, "at most %d serial devices", MAX_LINKS);
+      }
       if(strncmp("/dev/", optarg, 5) == 0) {
-	siodev = optarg + 5;
+	siodevs[nsiodevs++] = optarg + 5;
       } else {
-	siodev = optarg;
+	siodevs[nsiodevs++] = optarg;
       }
       break;
 
     case 't':
+      if(ntundevs == MAX_LINKS) {
+        err(1, "at most %d tun devices", MAX_LINKS);
+      }
       if(strncmp("/dev/", optarg, 5) == 0) {
-	strncpy(tundev, optarg + 5, sizeof(tundev));
+	tundevs[ntundevs++] = optarg + 5;
       } else {
-	strncpy(tundev, optarg, sizeof(tundev));
+	tundevs[ntundevs++] = optarg;
       }
       break;
 
@@ -759,19 +865,22 @@ main(int argc, char **argv)
     case '?':
     case 'h':
     default:
-fprintf(stderr,"usage:  %s [options] ipaddress\n", prog);
+fprintf(stderr,"usage:  %s [options] ipaddress [ipaddress...]\n", prog);
 fprintf(stderr,"example: tunslip6 -L -v2 -s ttyUSB1 aaaa::1/64\n");
+fprintf(stderr,"example: tunslip6 -B 1000000 -s ttyUSB0 -s ttyUSB1 aaaa::1/64 bbbb::1/64\n");
 fprintf(stderr,"Options are:\n");
 #ifndef __APPLE__
-fprintf(stderr," -B baudrate    9600,19200,38400,57600,115200 (default),230400,460800,921600\n");
+fprintf(stderr," -B baudrate    9600,19200,38400,57600,115200 (default),230400,460800,500000,921600,1000000\n");
 #else
 fprintf(stderr," -B baudrate    9600,19200,38400,57600,115200 (default),230400\n");
 #endif
 fprintf(stderr," -H             Hardware CTS/RTS flow control (default disabled)\n");
 fprintf(stderr," -L             Log output format (adds time stamps)\n");
 fprintf(stderr," -s siodev      Serial device (default /dev/ttyUSB0)\n");
+fprintf(stderr,"                Repeat -s to serve several links, one ipaddress each\n");
 fprintf(stderr," -T             Make tap interface (default is tun interface)\n");
-fprintf(stderr," -t tundev      Name of interface (default tap0 or tun0)\n");
+fprintf(stderr," -t tundev      Name of interface (default tap0 or tun0, tun1, ...)\n");
+fprintf(stderr,"                Repeat -t to name the interfaces of several links\n");
 fprintf(stderr," -v[level]      Verbosity level\n");
 fprintf(stderr,"    -v0         No messages\n");
 fprintf(stderr,"    -v1         Encapsulated SLIP debug messages (default)\n");
@@ -783,6 +892,7 @@ fprintf(stderr,"    -v          Equivalent to -v3\n");
 fprintf(stderr," -d[basedelay]  Minimum delay between outgoing SLIP packets.\n");
 fprintf(stderr,"                Actual delay is basedelay*(#6LowPAN fragments) milliseconds.\n");
 fprintf(stderr,"                -d is equivalent to -d10.\n");
+fprintf(stderr,"                Without a delay, queued packets are sent in batches.\n");
 fprintf(stderr," -a serveraddr  \n");
 fprintf(stderr," -p serverport  \n");
 exit(1);
@@ -792,10 +902,14 @@ exit(1);
   argc -= (optind - 1);
   argv += (optind - 1);
 
-  if(argc != 2 && argc != 3) {
-    err(1, "usage: %s [-B baudrate] [-H] [-L] [-s siodev] [-t tundev] [-T] [-v verbosity] [-d delay] [-a serveraddress] [-p serverport] ipaddress", prog);
+  nlinks = nsiodevs > 0 ? nsiodevs : 1;
+  if(host != NULL && nsiodevs > 0) {
+    err(1, "%s: -a cannot be used with -s", prog);
+  }
+  if(ntundevs > nlinks || argc < nlinks + 1 ||
+     (argc != nlinks + 1 && !(nlinks == 1 && argc == 3))) {
+    err(1, "usage: %s [-B baudrate] [-H] [-L] [-s siodev]... [-t tundev]... [-T] [-v verbosity] [-d delay] [-a serveraddress] [-p serverport] ipaddress [ipaddress...]", prog);
   }
-  ipaddr = argv[1];
 
   switch(baudrate) {
   case -2:
@@ -825,20 +939,40 @@ exit(1);
   case 921600:
     b_rate = B921600;
     break;
+#endif
+#ifdef B500000
+  case 500000:
+    b_rate = B500000;
+    break;
+#endif
+#ifdef B1000000
+  /* The FTDI chip of INGA runs at 500k and 1M baud */
+  case 1000000:
+    b_rate = B1000000;
+    break;
 #endif
   default:
     err(1, "unknown baudrate %d", baudrate);
     break;
   }
 
-  if(*tundev == '\0') {
-    /* Use default. */
-    if(tap) {
-      strcpy(tundev, "tap0");
+  for(i = 0; i < nlinks; i++) {
+    l = &links[i];
+    l->fd = -1;
+    l->tunfd = -1;
+    l->siodev = nsiodevs > 0 ? siodevs[i] : NULL;
+    l->ipaddr = argv[1 + i];
+    if(i < ntundevs) {
+      strncpy(l->tundev, tundevs[i], sizeof(l->tundev) - 1);
+    } else if(nlinks == 1) {
+      /* Use default. */
+      strcpy(l->tundev, tap ? "tap0" : "tun0");
     } else {
-      strcpy(tundev, "tun0");
+      sprintf(l->tundev, "%s%d", tap ? "tap" : "tun", i);
     }
   }
+
+  l = &links[0];
   if(host != NULL) {
     struct addrinfo hints, *servinfo, *p;
     int rv;
@@ -858,14 +992,14 @@ exit(1);
 
     /* loop through all the results and connect to the first we can */
     for(p = servinfo; p != NULL; p = p->ai_next) {
-      if((slipfd = socket(p->ai_family, p->ai_socktype,
-                          p->ai_protocol)) == -1) {
+      if((l->fd = socket(p->ai_family, p->ai_socktype,
+                         p->ai_protocol)) == -1) {
         perror("client: socket");
         continue;
       }
 
-      if(connect(slipfd, p->ai_addr, p->ai_addrlen) == -1) {
-        close(slipfd);
+      if(connect(l->fd, p->ai_addr, p->ai_addrlen) == -1) {
+        close(l->fd);
         perror("client: connect");
         continue;
       }
@@ -876,7 +1010,7 @@ exit(1);
       err(1, "can't connect to ``%s:%s''", host, port);
     }
 
-    fcntl(slipfd, F_SETFL, O_NONBLOCK);
+    fcntl(l->fd, F_SETFL, O_NONBLOCK);
 
     inet_ntop(p->ai_family, get_in_addr((struct sockaddr *)p->ai_addr),
               s, sizeof(s));
@@ -886,47 +1020,31 @@ exit(1);
     freeaddrinfo(servinfo);
 
   } else {
-    if(siodev != NULL) {
-      slipfd = devopen(siodev, O_RDWR | O_NONBLOCK);
-      if(slipfd == -1) {
-	err(1, "can't open siodev ``/dev/%s''", siodev);
-      }
-    } else {
-      static const char *siodevs[] = {
-        "ttyUSB0", "cuaU0", "ucom0" /* linux, fbsd6, fbsd5 */
-      };
-      int i;
-      for(i = 0; i < 3; i++) {
-        siodev = siodevs[i];
-        slipfd = devopen(siodev, O_RDWR | O_NONBLOCK);
-        if(slipfd != -1) {
-          break;
-        }
-      }
-      if(slipfd == -1) {
-        err(1, "can't open siodev");
-      }
+    for(i = 0; i < nlinks; i++) {
+      siodev_open(&links[i]);
     }
-    if (timestamp) stamptime();
-    fprintf(stderr, "********SLIP started on ``/dev/%s''\n", siodev);
-    stty_telos(slipfd);
   }
-  slip_send(slipfd, SLIP_END);
-  inslip = fdopen(slipfd, "r");
-  if(inslip == NULL) err(1, "main: fdopen");
-
-  tunfd = tun_alloc(tundev, tap);
-  if(tunfd == -1) err(1, "main: open");
-  if (timestamp) stamptime();
-  fprintf(stderr, "opened %s device ``/dev/%s''\n",
-          tap ? "tap" : "tun", tundev);
 
   atexit(cleanup);
   signal(SIGHUP, sigcleanup);
   signal(SIGTERM, sigcleanup);
   signal(SIGINT, sigcleanup);
   signal(SIGALRM, sigalarm);
-  ifconf(tundev, ipaddr);
+
+  for(i = 0; i < nlinks; i++) {
+    l = &links[i];
+    slip_send(l, SLIP_END);
+
+    l->tunfd = tun_alloc(l->tundev, tap);
+    if(l->tunfd == -1) err(1, "main: open");
+    /* Nonblocking, tun_to_serial() reads until tun is empty */
+    fcntl(l->tunfd, F_SETFL, O_NONBLOCK);
+    if (timestamp) stamptime();
+    fprintf(stderr, "opened %s device ``/dev/%s''\n",
+            tap ? "tap" : "tun", l->tundev);
+
+    ifconf(l->tundev, l->ipaddr);
+  }
 
   while(1) {
     maxfd = 0;
@@ -936,63 +1054,72 @@ exit(1);
 /* do not send IPA all the time... - add get MAC later... */
 /*     if(got_sigalarm) { */
 /*       /\* Send "?IPA". *\/ */
-/*       slip_send(slipfd, '?'); */
-/*       slip_send(slipfd, 'I'); */
-/*       slip_send(slipfd, 'P'); */
-/*       slip_send(slipfd, 'A'); */
-/*       slip_send(slipfd, SLIP_END); */
+/*       slip_send(l, '?'); */
+/*       slip_send(l, 'I'); */
+/*       slip_send(l, 'P'); */
+/*       slip_send(l, 'A'); */
+/*       slip_send(l, SLIP_END); */
 /*       got_sigalarm = 0; */
 /*     } */
 
-    if(!slip_empty()) {		/* Anything to flush? */
-      FD_SET(slipfd, &wset);
-    }
+    for(i = 0; i < nlinks; i++) {
+      l = &links[i];
+
+      if(!slip_empty(l)) {	/* Anything to flush? */
+        FD_SET(l->fd, &wset);
+      }
+
+      FD_SET(l->fd, &rset);	/* Read from slip ASAP! */
+      if(l->fd > maxfd) maxfd = l->fd;
 
-    FD_SET(slipfd, &rset);	/* Read from slip ASAP! */
-    if(slipfd > maxfd) maxfd = slipfd;
-    
-    /* We only have one packet at a time queued for slip output. */
-    if(slip_empty()) {
-      FD_SET(tunfd, &rset);
-      if(tunfd > maxfd) maxfd = tunfd;
+      /* With a delay, only one packet at a time is queued for slip
+         output. Otherwise packets are queued while there is room. */
+      if(basedelay ? slip_empty(l) : slip_room(l)) {
+        FD_SET(l->tunfd, &rset);
+        if(l->tunfd > maxfd) maxfd = l->tunfd;
+      }
     }
 
     ret = select(maxfd + 1, &rset, &wset, NULL, NULL);
     if(ret == -1 && errno != EINTR) {
       err(1, "select");
     } else if(ret > 0) {
-      if(FD_ISSET(slipfd, &rset)) {
-        serial_to_tun(inslip, tunfd);
-      }
-      
-      if(FD_ISSET(slipfd, &wset)) {
-	slip_flushbuf(slipfd);
-	sigalarm_reset();
-      }
- 
-      /* Optional delay between outgoing packets */
-      /* Base delay times number of 6lowpan fragments to be sent */
-      if(delaymsec) {
-       struct timeval tv;
-       int dmsec;
-       gettimeofday(&tv, NULL) ;
-       dmsec=(tv.tv_sec-delaystartsec)*1000+tv.tv_usec/1000-delaystartmsec;
-       if(dmsec<0) delaymsec=0;
-       if(dmsec>delaymsec) delaymsec=0;
-      }
-      if(delaymsec==0) {
-        int size;
-        if(slip_empty() && FD_ISSET(tunfd, &rset)) {
-          size=tun_to_serial(tunfd, slipfd);
-          slip_flushbuf(slipfd);
+      for(i = 0; i < nlinks; i++) {
+        l = &links[i];
+
+        if(FD_ISSET(l->fd, &rset)) {
+          serial_to_tun(l);
+        }
+
+        if(FD_ISSET(l->fd, &wset)) {
+          slip_flushbuf(l);
           sigalarm_reset();
-          if(basedelay) {
-            struct timeval tv;
-            gettimeofday(&tv, NULL) ;
- //         delaymsec=basedelay*(1+(size/120));//multiply by # of 6lowpan packets?
-            delaymsec=basedelay;
-            delaystartsec =tv.tv_sec;
-            delaystartmsec=tv.tv_usec/1000;
+        }
+
+        /* Optional delay between outgoing packets */
+        /* Base delay times number of 6lowpan fragments to be sent */
+        if(l->delaymsec) {
+          struct timeval tv;
+          int dmsec;
+          gettimeofday(&tv, NULL) ;
+          dmsec=(tv.tv_sec-l->delaystartsec)*1000+tv.tv_usec/1000-l->delaystartmsec;
+          if(dmsec<0) l->delaymsec=0;
+          if(dmsec>l->delaymsec) l->delaymsec=0;
+        }
+        if(l->delaymsec==0) {
+          if(FD_ISSET(l->tunfd, &rset) &&
+             (basedelay ? slip_empty(l) : slip_room(l))) {
+            tun_to_serial(l);
+            slip_flushbuf(l);
+            sigalarm_reset();
+            if(basedelay) {
+              struct timeval tv;
+              gettimeofday(&tv, NULL) ;
+   //         delaymsec=basedelay*(1+(size/120));//multiply by # of 6lowpan packets?
+              l->delaymsec=basedelay;
+              l->delaystartsec =tv.tv_sec;
+              l->delaystartmsec=tv.tv_usec/1000;
+            }
           }
         }
       }